@@ -16,6 +16,8 @@ folly::StringPiece congestionControlTypeToString(CongestionControlType type) {
       return kCongestionControlCubicStr;
     case CongestionControlType::BBR:
       return kCongestionControlBbrStr;
+    case CongestionControlType::BBR2:
+      return kCongestionControlBbr2Str;
     case CongestionControlType::Copa:
       return kCongestionControlCopaStr;
     case CongestionControlType::NewReno:
@@ -33,6 +35,8 @@ folly::Optional<CongestionControlType> congestionControlStrToType(
     return quic::CongestionControlType::Cubic;
   } else if (str == kCongestionControlBbrStr) {
     return quic::CongestionControlType::BBR;
+  } else if (str == kCongestionControlBbr2Str) {
+    return quic::CongestionControlType::BBR2;
   } else if (str == kCongestionControlCopaStr) {
     return quic::CongestionControlType::Copa;
   } else if (str == kCongestionControlNewRenoStr) {
@@ -98,6 +102,8 @@ folly::StringPiece writeDataReasonString(WriteDataReason reason) {
       return "Reset";
     case WriteDataReason::PATHCHALLENGE:
       return "PathChallenge";
+    case WriteDataReason::DATAGRAM:
+      return "Datagram";
     case WriteDataReason::NO_WRITE:
       return "NoWrite";
   }
@@ -138,4 +144,18 @@ folly::StringPiece readNoReadReasonString(NoReadReason reason) {
   folly::assume_unreachable();
 }
 
+folly::StringPiece hotLoopMitigationString(HotLoopMitigation mitigation) {
+  switch (mitigation) {
+    case HotLoopMitigation::NONE:
+      return "None";
+    case HotLoopMitigation::PACE:
+      return "Pace";
+    case HotLoopMitigation::RAISE_BURST:
+      return "Raise burst";
+    case HotLoopMitigation::CLOSE:
+      return "Close";
+  }
+  folly::assume_unreachable();
+}
+
 } // namespace quic
@@ -42,10 +42,34 @@ constexpr uint16_t kMinMaxUDPPayload = 1200;
 // EMSGSIZE.
 constexpr uint16_t kDefaultMsgSizeBackOffSize = 50;
 
+// Largest packet size that path MTU discovery probes by default: an Ethernet
+// MTU less the IPv6 and UDP headers.
+constexpr uint64_t kDefaultMaxPathMtuProbeSize = kDefaultMaxUDPPayload;
+
+// Probes of one size lost in a row before the size is taken not to fit the
+// path.
+constexpr uint8_t kMaxPathMtuProbes = 3;
+
+// Path MTU discovery stops once the largest size that fits is known to within
+// this many bytes.
+constexpr uint64_t kPathMtuSearchGranularity = 16;
+
+// How long after path MTU discovery ends, or falls back from a black hole,
+// before it searches again.
+constexpr std::chrono::seconds kPathMtuRaiseTimeout{600};
+
+// Packets larger than the base packet size lost in a row, without one of them
+// being acked, before the path is taken to drop all of them.
+constexpr uint64_t kPathMtuBlackHoleThreshold = 6;
+
 // Size of read buffer we provide to AsyncUDPSocket. The packet size cannot be
 // larger than this, unless configured otherwise.
 constexpr uint16_t kDefaultUDPReadBufferSize = 1500;
 
+// Size of read buffer we provide to AsyncUDPSocket when UDP GRO is enabled.
+// The kernel never coalesces more than 64KB into a single read.
+constexpr uint32_t kDefaultGROReadBufferSize = 65535;
+
 constexpr uint16_t kMaxNumCoalescedPackets = 5;
 // As per version 20 of the spec, transport parameters for private use must
 // have ids with first byte being 0xff.
@@ -99,6 +123,11 @@ enum class FrameType : uint8_t {
   // CONNECTION_CLOSE_APP_ERR frametype is use to indicate application errors
   CONNECTION_CLOSE_APP_ERR = 0x1D,
   HANDSHAKE_DONE = 0x1E,
+  // RFC 9221. A DATAGRAM frame without a length runs to the end of the packet.
+  DATAGRAM = 0x30,
+  DATAGRAM_LEN = 0x31,
+  ACK_FREQUENCY = 0xAF, // draft-iyengar-quic-delayed-ack
+  FEC_REPAIR = 0xFC, // subject to change
   MIN_STREAM_DATA = 0xFE, // subject to change
   EXPIRED_STREAM_DATA = 0xFF, // subject to change
 };
@@ -176,6 +205,7 @@ enum class LocalErrorCode : uint32_t {
   STREAM_LIMIT_EXCEEDED = 0x40000018,
   CONNECTION_ABANDONED = 0x40000019,
   CALLBACK_ALREADY_INSTALLED = 0x4000001A,
+  HOT_LOOP = 0x4000001B,
 };
 
 enum class QuicNodeType : bool {
@@ -197,6 +227,38 @@ using TransportPartialReliabilitySetting = bool;
 
 constexpr uint16_t kPartialReliabilityParameterId = 0xFF00; // subject to change
 
+// The min_ack_delay transport parameter, advertising support for receiving
+// ACK_FREQUENCY frames.
+constexpr uint16_t kMinAckDelayParameterId = 0xFF02; // subject to change
+
+// Advertises support for receiving FEC_REPAIR frames.
+constexpr uint16_t kFecSupportParameterId = 0xFF03; // subject to change
+
+// Default number of DATAGRAMs buffered on each side of the application before
+// the oldest are dropped.
+constexpr uint32_t kDefaultMaxDatagramsBuffered = 75;
+
+// Default amount of a file given to writeFile() that is read into the write
+// buffer of its stream ahead of being sent.
+constexpr uint64_t kDefaultFileWriteBufferSize = 256 * 1024;
+
+// Largest short header and AEAD tag of a packet carrying a DATAGRAM frame.
+constexpr uint16_t kMaxDatagramPacketOverhead = 1 + 20 + 4 + 16;
+// Type and length of a DATAGRAM frame, for payloads up to 16383 bytes.
+constexpr uint16_t kMaxDatagramFrameOverhead = 1 + 2;
+
+/* Forward error correction */
+// Most packets with stream data a FEC_REPAIR frame can protect, one for each
+// bit of its packet mask.
+constexpr uint64_t kMaxFecWindowSize = 64;
+// Largest short header and AEAD tag of a packet carrying a FEC_REPAIR frame.
+constexpr uint16_t kMaxFecRepairPacketOverhead = 1 + 20 + 4 + 16;
+// Type, first packet number, packet mask and symbol length of a FEC_REPAIR
+// frame.
+constexpr uint16_t kMaxFecRepairFrameOverhead = 2 + 8 + 8 + 2;
+// Source symbols of received packets kept for recovering a lost one.
+constexpr size_t kMaxFecReceivedSymbols = 2 * kMaxFecWindowSize;
+
 constexpr uint32_t kDrainFactor = 3;
 
 // batching mode
@@ -213,6 +275,17 @@ QuicBatchingMode getQuicBatchingMode(uint32_t val);
 // by BATCHING_MODE_GSO
 constexpr uint32_t kDefaultQuicMaxBatchSize = 16;
 
+// With TransportSettings::adaptiveBatchSize, a batch holds at most this
+// fraction of the congestion window, as it leaves as a single burst.
+constexpr uint32_t kAdaptiveBatchCwndFraction = 4;
+
+// A connection looping hot (see TransportSettings::hotLoopMinBytesPerWakeup)
+// is judged on its wakeups over this window.
+constexpr std::chrono::milliseconds kDefaultHotLoopWindow{1000};
+constexpr uint64_t kDefaultHotLoopMinWakeups = 10000;
+// The RAISE_BURST mitigation multiplies the packets of a pacing burst by this.
+constexpr uint64_t kHotLoopBurstFactor = 4;
+
 // rfc6298:
 constexpr int kRttAlpha = 8;
 constexpr int kRttBeta = 4;
@@ -232,8 +305,27 @@ constexpr uint32_t kReorderingThreshold = 3;
 constexpr DurationRep kDefaultTimeReorderingThreshDividend = 5;
 constexpr DurationRep kDefaultTimeReorderingThreshDivisor = 4;
 
+// Number of packets declared lost that are remembered, so that an ack that
+// comes for them later can tell the loss was spurious.
+constexpr size_t kMaxRecentlyLostPackets = 64;
+// A lost packet not acked within this many PTOs after it was declared lost is
+// no longer expected to be.
+constexpr uint8_t kLostPacketTrackingPTOs = 3;
+// With adaptive reordering, each spurious loss widens the time reordering
+// window by rtt / kReorderingWindowStepDivisor, up to kMaxReorderingWindowSteps
+// steps, and raises the packet threshold up to kMaxReorderingThreshold.
+constexpr uint8_t kReorderingWindowStepDivisor = 8;
+constexpr uint8_t kMaxReorderingWindowSteps = 8;
+constexpr uint32_t kMaxReorderingThreshold = 64;
+// Number of loss events without a spurious loss after which the window is
+// narrowed by one step.
+constexpr uint32_t kReorderingWindowDecayLossEvents = 16;
+
 constexpr auto kPacketToSendForPTO = 2;
 
+// Lower bound of the first PTO when it is armed as a tail loss probe.
+constexpr std::chrono::milliseconds kMinTailLossProbeTimeout{10};
+
 // Maximum number of packets to write per writeConnectionDataToSocket call.
 constexpr uint64_t kDefaultWriteConnectionDataPacketLimit = 5;
 // Minimum number of packets to write per burst in pacing
@@ -249,16 +341,33 @@ constexpr DurationRep kDefaultWriteLimitRttFraction = 25;
 // Congestion control:
 constexpr folly::StringPiece kCongestionControlCubicStr = "cubic";
 constexpr folly::StringPiece kCongestionControlBbrStr = "bbr";
+constexpr folly::StringPiece kCongestionControlBbr2Str = "bbr2";
 constexpr folly::StringPiece kCongestionControlCopaStr = "copa";
 constexpr folly::StringPiece kCongestionControlNewRenoStr = "newreno";
 constexpr folly::StringPiece kCongestionControlNoneStr = "none";
 
 constexpr DurationRep kPersistentCongestionThreshold = 3;
-enum class CongestionControlType : uint8_t { Cubic, NewReno, Copa, BBR, None };
+enum class CongestionControlType : uint8_t {
+  Cubic,
+  NewReno,
+  Copa,
+  BBR,
+  BBR2,
+  None
+};
 folly::StringPiece congestionControlTypeToString(CongestionControlType type);
 folly::Optional<CongestionControlType> congestionControlStrToType(
     folly::StringPiece str);
 
+// ECN codepoints, the two low bits of the IP TOS / traffic class byte.
+enum class EcnCodepoint : uint8_t {
+  NotEct = 0x00,
+  Ect1 = 0x01,
+  Ect0 = 0x02,
+  Ce = 0x03,
+};
+constexpr uint8_t kEcnMask = 0x03;
+
 // This is an approximation of a small enough number for cwnd to be blocked.
 constexpr size_t kBlockedSizeBytes = 20;
 
@@ -272,6 +381,10 @@ constexpr uint64_t kDefaultMaxCwndInMss = 2000;
 // Max cwnd limit for perf test purpose
 constexpr uint64_t kLargeMaxCwndInMss = 860000;
 
+// Default relative change of the bandwidth estimate reported to the
+// application's BandwidthEstimateCallback.
+constexpr float kDefaultBandwidthEstimateChangeThreshold = 0.2f;
+
 // When server receives early data attempt without valid source address token,
 // server will limit bytes in flight to avoid amplification attack until CFIN
 // is received which proves sender owns the address.
@@ -289,6 +402,27 @@ constexpr std::chrono::microseconds kDelayIncreaseUpperBound(8);
 // Hystart's lower bound for DelayIncrease
 constexpr std::chrono::microseconds kDelayIncreaseLowerBound(2);
 
+/* HyStart++ (RFC 9406): */
+// Bounds of the rtt increase that ends slow start
+constexpr std::chrono::milliseconds kHystartPlusPlusMinRttThresh(4);
+constexpr std::chrono::milliseconds kHystartPlusPlusMaxRttThresh(16);
+// The rtt increase threshold is the last round's min rtt over this
+constexpr uint8_t kHystartPlusPlusMinRttDivisor = 8;
+// Conservative Slow Start grows cwnd by this fraction of slow start
+constexpr uint8_t kHystartPlusPlusCssGrowthDivisor = 4;
+// Number of Conservative Slow Start rounds before congestion avoidance
+constexpr uint8_t kHystartPlusPlusCssRounds = 5;
+// Cwnd growth per ack in MSS without pacing
+constexpr uint64_t kHystartPlusPlusAckIncreaseLimitInMss = 8;
+
+/* Copa competitive mode: */
+// Fraction of (max rtt - min rtt) above min rtt that counts as an empty queue
+constexpr double kCopaNearlyEmptyQueueThreshold = 0.1;
+// Rtts without an empty queue before Copa competes with buffer fillers
+constexpr uint8_t kCopaCompetitiveModeRtts = 5;
+// Lower bound of delta in competitive mode
+constexpr double kCopaMinCompetitiveDelta = 0.004;
+
 /* Cubic */
 // Default cwnd reduction factor:
 constexpr double kDefaultCubicReductionFactor = 0.8;
@@ -307,6 +441,10 @@ constexpr float kCubicTCPFriendlyEstimateIncreaseFactor =
 // Default flow control window for HTTP/2 + 1K for headers
 constexpr uint64_t kDefaultStreamWindowSize = (64 + 1) * 1024;
 constexpr uint64_t kDefaultConnectionWindowSize = 1024 * 1024;
+// Upper bound of a flow control window grown by receive window auto-tuning.
+constexpr uint64_t kDefaultMaxReceiveWindowSize = 16 * 1024 * 1024;
+// A window is doubled when the peer fills it faster than this many RTTs.
+constexpr uint16_t kReceiveWindowAutotuneRttMultiplier = 2;
 
 /* Stream Limits */
 constexpr uint64_t kDefaultMaxStreamsBidirectional = 2048;
@@ -314,6 +452,9 @@ constexpr uint64_t kDefaultMaxStreamsUnidirectional = 2048;
 constexpr uint64_t kMaxStreamId = 1ull << 62;
 constexpr uint64_t kMaxMaxStreams = 1ull << 60;
 
+// Default longest time stream data is held back by a corked connection.
+constexpr std::chrono::milliseconds kDefaultMaxCorkDelay{1};
+
 /* Idle timeout parameters */
 // Default idle timeout to advertise.
 constexpr auto kDefaultIdleTimeout = 60000ms;
@@ -345,8 +486,25 @@ constexpr double kAckTimerFactor = 0.25;
 // max ack timeout: 25ms
 constexpr std::chrono::microseconds kMaxAckTimeout = 25000us;
 
+/* Ack frequency */
+// Smallest ack delay we advertise support for through min_ack_delay.
+constexpr std::chrono::microseconds kDefaultMinAckDelay = 1000us;
+// Number of ACKs per congestion window asked from the peer.
+constexpr uint64_t kAckFrequencyAcksPerCwnd = 8;
+// Bounds of the packet tolerance asked from the peer.
+constexpr uint64_t kMinAckFrequencyPacketTolerance = 2;
+constexpr uint64_t kMaxAckFrequencyPacketTolerance = 100;
+
 constexpr uint64_t kAckPurgingThresh = 10;
 
+// Most ack ranges kept per packet number space. A peer that reorders a lot,
+// or never acks our acks, would otherwise grow them without bound.
+constexpr uint64_t kDefaultMaxAckRanges = 128;
+
+// Number of destroyed stream states a connection keeps the storage of, to
+// make new streams in.
+constexpr size_t kDefaultMaxFreeStreamStates = 16;
+
 // Default number of packets to buffer if keys are not present.
 constexpr uint32_t kDefaultMaxBufferedPackets = 20;
 
@@ -382,14 +540,28 @@ constexpr std::chrono::milliseconds kHappyEyeballsV4Delay = 100ms;
 constexpr std::chrono::milliseconds kHappyEyeballsConnAttemptDelayWithCache =
     15s;
 
+// Lower bound of the connection attempt delay, from RFC 8305.
+constexpr std::chrono::milliseconds kHappyEyeballsMinConnAttemptDelay = 10ms;
+
+// Races in a row a family has to win before the other one isn't raced.
+constexpr uint32_t kHappyEyeballsSkipRaceAfterWins = 3;
+
 constexpr size_t kMaxNumTokenSourceAddresses = 3;
 
 // Amount of time to retain zero rtt keys until they are dropped after handshake
 // completion.
 constexpr std::chrono::seconds kTimeToRetainZeroRttKeys = 20s;
 
+// Amount of time to retain the 1-RTT read keys of the previous key phase
+// after a key update, for packets reordered around it.
+constexpr std::chrono::seconds kTimeToRetainOldOneRttKeys = 3s;
+
 constexpr std::chrono::seconds kTimeToRetainLastCongestionAndRttState = 60s;
 
+// Number of paths, other than the last one, whose congestion and rtt state a
+// server connection keeps to restore when the client migrates back to them.
+constexpr size_t kMaxEarlierCongestionAndRttStates = 4;
+
 constexpr uint32_t kMaxNumMigrationsAllowed = 6;
 
 constexpr auto kExpectedNumOfParamsInTheTicket = 8;
@@ -448,6 +620,7 @@ enum class WriteDataReason {
   SIMPLE,
   RESET,
   PATHCHALLENGE,
+  DATAGRAM,
 };
 
 enum class NoWriteReason {
@@ -469,7 +642,17 @@ enum class NoReadReason {
 
 folly::StringPiece writeDataReasonString(WriteDataReason reason);
 folly::StringPiece writeNoWriteReasonString(NoWriteReason reason);
+// What is done about a connection that wakes up its EventBase far more often
+// than the bytes it moves warrant, from the mildest to the last resort.
+enum class HotLoopMitigation {
+  NONE,
+  PACE,
+  RAISE_BURST,
+  CLOSE,
+};
+
 folly::StringPiece readNoReadReasonString(NoReadReason reason);
+folly::StringPiece hotLoopMitigationString(HotLoopMitigation mitigation);
 
 /**
  * Filter the versions that are currently supported.
@@ -118,6 +118,8 @@ folly::StringPiece toString(LocalErrorCode code) {
       return "Stream limit exceeded";
     case LocalErrorCode::CONNECTION_ABANDONED:
       return "Connection abandoned";
+    case LocalErrorCode::HOT_LOOP:
+      return "Hot loop";
   }
   LOG(WARNING) << "toString has unhandled ErrorCode";
   return "Unknown error";
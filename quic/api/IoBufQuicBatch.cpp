@@ -9,6 +9,7 @@
 #include <quic/api/IoBufQuicBatch.h>
 
 #include <quic/happyeyeballs/QuicHappyEyeballsFunctions.h>
+#include <quic/state/QuicTracepoints.h>
 
 namespace quic {
 IOBufQuicBatch::IOBufQuicBatch(
@@ -35,7 +36,9 @@ bool IOBufQuicBatch::write(
   }
 
   // try to append the new buffers
-  if (batchWriter_->append(std::move(buf), encodedSize)) {
+  bool needsFlush = batchWriter_->append(std::move(buf), encodedSize);
+  pktsInBatch_++;
+  if (needsFlush) {
     // return if we get an error here
     return flush();
   }
@@ -57,6 +60,7 @@ void IOBufQuicBatch::setContinueOnNetworkUnreachable(
 
 void IOBufQuicBatch::reset() {
   batchWriter_->reset();
+  pktsInBatch_ = 0;
 }
 
 bool IOBufQuicBatch::isNetworkUnreachable(int err) {
@@ -164,6 +168,13 @@ bool IOBufQuicBatch::flushInternal() {
   // Reset the deadline after successful write
   conn_.continueOnNetworkUnreachableDeadline = folly::none;
 
+  conn_.writeLoopStats.batchFlushes++;
+  conn_.writeLoopStats.packetsFlushed += pktsInBatch_;
+  conn_.writeLoopStats.bytesFlushed += batchWriter_->size();
+  QUIC_STATS(
+      conn_.statsCallback, onBatchFlushed, pktsInBatch_, batchWriter_->size());
+  QUIC_TRACEPOINT(batch_flush, conn_, pktsInBatch_, batchWriter_->size());
+
   return true; // success, not done yet
 }
 } // namespace quic
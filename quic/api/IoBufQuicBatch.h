@@ -53,6 +53,8 @@ class IOBufQuicBatch {
   QuicConnectionStateBase& conn_;
   QuicConnectionStateBase::HappyEyeballsState& happyEyeballsState_;
   uint64_t pktSent_{0};
+  // Packets appended since the last flush.
+  uint64_t pktsInBatch_{0};
   bool continueOnNetworkUnreachable_{false};
 };
 
@@ -25,6 +25,15 @@ class LoopDetectorCallback {
   virtual void onSuspiciousReadLoops(
       uint64_t emptyLoopCount,
       NoReadReason noReadReason) = 0;
+
+  /**
+   * The connection woke up wakeups times in the last hotLoopWindow while
+   * moving only bytes bytes, and got mitigation applied.
+   */
+  virtual void onHotLoop(
+      uint64_t /* wakeups */,
+      uint64_t /* bytes */,
+      HotLoopMitigation /* mitigation */) {}
 };
 
 } // namespace quic
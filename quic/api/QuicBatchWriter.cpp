@@ -8,15 +8,55 @@
 
 #include <quic/api/QuicBatchWriter.h>
 
+#include <quic/common/SocketUtil.h>
+#include <quic/state/QuicStateFunctions.h>
+
 namespace quic {
 // BatchWriter
 bool BatchWriter::needsFlush(size_t /*unused*/) {
   return false;
 }
 
+void BatchWriter::setBufArena(PacketBufArena* bufArena) {
+  bufArena_ = bufArena;
+}
+
+void BatchWriter::releaseBuf(std::unique_ptr<folly::IOBuf> buf) {
+  if (bufArena_ && buf) {
+    bufArena_->recycle(std::move(buf));
+  }
+}
+
+void BatchWriter::setZeroCopyTracker(ZeroCopySendTracker* zeroCopyTracker) {
+  zeroCopyTracker_ = zeroCopyTracker;
+}
+
+folly::Optional<int> BatchWriter::writeZeroCopy(
+    folly::AsyncUDPSocket& sock,
+    const folly::SocketAddress& address,
+    const std::unique_ptr<folly::IOBuf>* bufs,
+    const int* gso,
+    size_t count,
+    size_t size) {
+  if (!zeroCopyTracker_ || !zeroCopyTracker_->shouldZeroCopy(sock, size)) {
+    return folly::none;
+  }
+  int ret = writemGSOZeroCopy(sock, address, bufs, gso, count);
+  if (ret < 0 && errno == ENOBUFS) {
+    // Out of option memory for the pending ones, this one can be copied.
+    return folly::none;
+  }
+  for (int i = 0; i < ret; ++i) {
+    // Shared, so that neither the arena nor anyone else writes to the data
+    // before the kernel is done with it.
+    zeroCopyTracker_->onSent(bufs[i]->clone());
+  }
+  return ret;
+}
+
 // SinglePacketBatchWriter
 void SinglePacketBatchWriter::reset() {
-  buf_.reset();
+  releaseBuf(std::move(buf_));
 }
 
 bool SinglePacketBatchWriter::append(
@@ -39,7 +79,7 @@ GSOPacketBatchWriter::GSOPacketBatchWriter(size_t maxBufs)
     : maxBufs_(maxBufs) {}
 
 void GSOPacketBatchWriter::reset() {
-  buf_.reset(nullptr);
+  releaseBuf(std::move(buf_));
   currBufs_ = 0;
   prevSize_ = 0;
 }
@@ -86,11 +126,100 @@ bool GSOPacketBatchWriter::append(
 ssize_t GSOPacketBatchWriter::write(
     folly::AsyncUDPSocket& sock,
     const folly::SocketAddress& address) {
+  if (currBufs_ > 1) {
+    int gso = static_cast<int>(prevSize_);
+    auto ret = writeZeroCopy(sock, address, &buf_, &gso, 1, size());
+    if (ret) {
+      return *ret > 0 ? size() : *ret;
+    }
+  }
   return (currBufs_ > 1)
       ? sock.writeGSO(address, buf_, static_cast<int>(prevSize_))
       : sock.write(address, buf_);
 }
 
+// GSOInplacePacketBatchWriter
+GSOInplacePacketBatchWriter::GSOInplacePacketBatchWriter(
+    QuicConnectionStateBase& conn,
+    size_t maxPackets)
+    : conn_(conn), maxPackets_(maxPackets) {
+  CHECK(conn_.bufAccessor) << "In-place batch writer needs a BufAccessor";
+}
+
+bool GSOInplacePacketBatchWriter::empty() const {
+  return numPackets_ == 0;
+}
+
+size_t GSOInplacePacketBatchWriter::size() const {
+  if (empty()) {
+    return 0;
+  }
+  auto buf = conn_.bufAccessor->obtain();
+  CHECK(lastPacketEnd_ >= buf->data() && lastPacketEnd_ <= buf->tail());
+  size_t ret = lastPacketEnd_ - buf->data();
+  conn_.bufAccessor->release(std::move(buf));
+  return ret;
+}
+
+void GSOInplacePacketBatchWriter::reset() {
+  if (lastPacketEnd_) {
+    // A packet that arrived after needsFlush() is still in the buffer, behind
+    // the ones we have just written. Move it to the front for the next batch.
+    auto buf = conn_.bufAccessor->obtain();
+    CHECK(lastPacketEnd_ >= buf->data() && lastPacketEnd_ <= buf->tail());
+    size_t leftover = buf->tail() - lastPacketEnd_;
+    const uint8_t* leftoverStart = lastPacketEnd_;
+    buf->clear();
+    if (leftover) {
+      memmove(buf->writableData(), leftoverStart, leftover);
+      buf->append(leftover);
+    }
+    conn_.bufAccessor->release(std::move(buf));
+  }
+  lastPacketEnd_ = nullptr;
+  prevSize_ = 0;
+  numPackets_ = 0;
+}
+
+bool GSOInplacePacketBatchWriter::needsFlush(size_t size) {
+  // if we get a packet with a size that is greater
+  // than the prev one we need to flush
+  return prevSize_ && size > prevSize_;
+}
+
+bool GSOInplacePacketBatchWriter::append(
+    std::unique_ptr<folly::IOBuf>&& /*buf*/,
+    size_t size) {
+  CHECK(!needsFlush(size));
+  auto buf = conn_.bufAccessor->obtain();
+  lastPacketEnd_ = buf->tail();
+  conn_.bufAccessor->release(std::move(buf));
+  if (numPackets_++ == 0) {
+    prevSize_ = size;
+    return numPackets_ == maxPackets_;
+  }
+  // A smaller packet ends the batch since the segment size is fixed.
+  return size < prevSize_ || numPackets_ == maxPackets_;
+}
+
+ssize_t GSOInplacePacketBatchWriter::write(
+    folly::AsyncUDPSocket& sock,
+    const folly::SocketAddress& address) {
+  CHECK(lastPacketEnd_);
+  auto buf = conn_.bufAccessor->obtain();
+  CHECK(lastPacketEnd_ >= buf->data() && lastPacketEnd_ <= buf->tail());
+  // Only write the packets that are part of this batch. The buffer is only
+  // restored here; reset() moves any newer packet to the front.
+  size_t leftover = buf->tail() - lastPacketEnd_;
+  buf->trimEnd(leftover);
+  auto ret = (numPackets_ > 1)
+      ? sock.writeGSO(address, buf, static_cast<int>(prevSize_))
+      : sock.write(address, buf);
+  buf->append(leftover);
+  conn_.bufAccessor->release(std::move(buf));
+  return ret;
+}
+
 // SendmmsgPacketBatchWriter
 SendmmsgPacketBatchWriter::SendmmsgPacketBatchWriter(size_t maxBufs)
     : maxBufs_(maxBufs) {
@@ -106,6 +235,9 @@ size_t SendmmsgPacketBatchWriter::size() const {
 }
 
 void SendmmsgPacketBatchWriter::reset() {
+  for (auto& buf : bufs_) {
+    releaseBuf(std::move(buf));
+  }
   bufs_.clear();
   currSize_ = 0;
 }
@@ -164,6 +296,9 @@ size_t SendmmsgGSOPacketBatchWriter::size() const {
 }
 
 void SendmmsgGSOPacketBatchWriter::reset() {
+  for (auto& buf : bufs_) {
+    releaseBuf(std::move(buf));
+  }
   bufs_.clear();
   gso_.clear();
   currBufs_ = 0;
@@ -214,12 +349,75 @@ ssize_t SendmmsgGSOPacketBatchWriter::write(
     folly::AsyncUDPSocket& sock,
     const folly::SocketAddress& address) {
   CHECK_GT(bufs_.size(), 0);
-  if (bufs_.size() == 1) {
+  auto zeroCopied = writeZeroCopy(
+      sock, address, bufs_.data(), gso_.data(), bufs_.size(), currSize_);
+  if (!zeroCopied && bufs_.size() == 1) {
     return (currBufs_ > 1) ? sock.writeGSO(address, bufs_[0], gso_[0])
                            : sock.write(address, bufs_[0]);
   }
 
-  int ret = sock.writemGSO(address, bufs_.data(), bufs_.size(), gso_.data());
+  int ret = zeroCopied
+      ? *zeroCopied
+      : sock.writemGSO(address, bufs_.data(), bufs_.size(), gso_.data());
+
+  if (ret <= 0) {
+    return ret;
+  }
+
+  if (static_cast<size_t>(ret) == bufs_.size()) {
+    return currSize_;
+  }
+
+  // this is a partial write - we just need to
+  // return a different number than currSize_
+  return 0;
+}
+
+// TxTimePacketBatchWriter
+TxTimePacketBatchWriter::TxTimePacketBatchWriter(
+    QuicConnectionStateBase& conn,
+    size_t maxBufs)
+    : conn_(conn), maxBufs_(maxBufs) {
+  CHECK(conn_.pacer) << "TxTime batch writer needs a pacer";
+  bufs_.reserve(maxBufs);
+  txTimes_.reserve(maxBufs);
+}
+
+bool TxTimePacketBatchWriter::empty() const {
+  return !currSize_;
+}
+
+size_t TxTimePacketBatchWriter::size() const {
+  return currSize_;
+}
+
+void TxTimePacketBatchWriter::reset() {
+  for (auto& buf : bufs_) {
+    releaseBuf(std::move(buf));
+  }
+  bufs_.clear();
+  txTimes_.clear();
+  currSize_ = 0;
+}
+
+bool TxTimePacketBatchWriter::append(
+    std::unique_ptr<folly::IOBuf>&& buf,
+    size_t size) {
+  CHECK_LT(bufs_.size(), maxBufs_);
+  txTimes_.push_back(conn_.pacer->getDepartureTime(Clock::now(), size));
+  bufs_.emplace_back(std::move(buf));
+  currSize_ += size;
+
+  // reached max buffers
+  return bufs_.size() == maxBufs_;
+}
+
+ssize_t TxTimePacketBatchWriter::write(
+    folly::AsyncUDPSocket& sock,
+    const folly::SocketAddress& address) {
+  CHECK_GT(bufs_.size(), 0);
+  int ret = writemWithTxTime(
+      sock, address, bufs_.data(), txTimes_.data(), bufs_.size());
 
   if (ret <= 0) {
     return ret;
@@ -235,6 +433,32 @@ ssize_t SendmmsgGSOPacketBatchWriter::write(
 }
 
 // BatchWriterFactory
+// SharedEgressPacketBatchWriter
+SharedEgressPacketBatchWriter::SharedEgressPacketBatchWriter(
+    SharedEgressBatch& egressBatch)
+    : egressBatch_(egressBatch) {}
+
+void SharedEgressPacketBatchWriter::reset() {
+  releaseBuf(std::move(buf_));
+}
+
+bool SharedEgressPacketBatchWriter::append(
+    std::unique_ptr<folly::IOBuf>&& buf,
+    size_t /*unused*/) {
+  buf_ = std::move(buf);
+
+  // handed to the shared batch right away, it does the batching
+  return true;
+}
+
+ssize_t SharedEgressPacketBatchWriter::write(
+    folly::AsyncUDPSocket& sock,
+    const folly::SocketAddress& address) {
+  auto size = buf_->computeChainDataLength();
+  egressBatch_.enqueue(sock.getNetworkSocket(), address, std::move(buf_));
+  return size;
+}
+
 std::unique_ptr<BatchWriter> BatchWriterFactory::makeBatchWriter(
     folly::AsyncUDPSocket& sock,
     const quic::QuicBatchingMode& batchingMode,
@@ -264,4 +488,34 @@ std::unique_ptr<BatchWriter> BatchWriterFactory::makeBatchWriter(
   folly::assume_unreachable();
 }
 
+std::unique_ptr<BatchWriter> BatchWriterFactory::makeBatchWriter(
+    folly::AsyncUDPSocket& sock,
+    const quic::QuicBatchingMode& batchingMode,
+    uint32_t batchSize,
+    DataPathType dataPathType,
+    QuicConnectionStateBase& conn) {
+  if (isConnectionPacedByTxTime(conn)) {
+    return std::make_unique<TxTimePacketBatchWriter>(
+        conn,
+        batchingMode == quic::QuicBatchingMode::BATCHING_MODE_NONE
+            ? 1
+            : batchSize);
+  }
+  if (conn.egressBatch) {
+    // Packets in continuous memory would be overwritten before the flush.
+    DCHECK(dataPathType == DataPathType::ChainedMemory);
+    return std::make_unique<SharedEgressPacketBatchWriter>(*conn.egressBatch);
+  }
+  if (dataPathType == DataPathType::ContinuousMemory && conn.bufAccessor) {
+    if (batchingMode == quic::QuicBatchingMode::BATCHING_MODE_NONE) {
+      return std::make_unique<GSOInplacePacketBatchWriter>(conn, 1);
+    }
+    if (batchingMode == quic::QuicBatchingMode::BATCHING_MODE_GSO &&
+        sock.getGSO() >= 0) {
+      return std::make_unique<GSOInplacePacketBatchWriter>(conn, batchSize);
+    }
+  }
+  return makeBatchWriter(sock, batchingMode, batchSize);
+}
+
 } // namespace quic
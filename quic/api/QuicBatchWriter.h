@@ -11,6 +11,9 @@
 #include <folly/io/IOBuf.h>
 #include <folly/io/async/AsyncUDPSocket.h>
 #include <quic/QuicConstants.h>
+#include <quic/common/SharedEgressBatch.h>
+#include <quic/common/ZeroCopySendTracker.h>
+#include <quic/state/StateData.h>
 
 namespace quic {
 class BatchWriter {
@@ -37,6 +40,36 @@ class BatchWriter {
   virtual ssize_t write(
       folly::AsyncUDPSocket& sock,
       const folly::SocketAddress& address) = 0;
+
+  // If set, buffers are given back to the arena on reset() instead of being
+  // freed.
+  void setBufArena(PacketBufArena* bufArena);
+
+  // If set, large GSO batches on the tracker's socket are written with
+  // MSG_ZEROCOPY.
+  void setZeroCopyTracker(ZeroCopySendTracker* zeroCopyTracker);
+
+ protected:
+  // Drops a buffer that has been written, recycling it if possible.
+  void releaseBuf(std::unique_ptr<folly::IOBuf> buf);
+
+  /**
+   * Writes bufs with MSG_ZEROCOPY if the tracker says it's worth it, and hands
+   * clones of the ones that went out to the tracker. Returns the number of
+   * bufs written or -1, or folly::none if they should be written the usual
+   * way instead.
+   */
+  folly::Optional<int> writeZeroCopy(
+      folly::AsyncUDPSocket& sock,
+      const folly::SocketAddress& address,
+      const std::unique_ptr<folly::IOBuf>* bufs,
+      const int* gso,
+      size_t count,
+      size_t size);
+
+ private:
+  PacketBufArena* bufArena_{nullptr};
+  ZeroCopySendTracker* zeroCopyTracker_{nullptr};
 };
 
 class IOBufBatchWriter : public BatchWriter {
@@ -89,6 +122,41 @@ class GSOPacketBatchWriter : public IOBufBatchWriter {
   size_t prevSize_{0};
 };
 
+/**
+ * GSO batch writer for DataPathType::ContinuousMemory. Packets are already
+ * laid out back to back in the connection's BufAccessor buffer, so this
+ * writer only keeps track of packet boundaries and never owns the data.
+ */
+class GSOInplacePacketBatchWriter : public BatchWriter {
+ public:
+  explicit GSOInplacePacketBatchWriter(
+      QuicConnectionStateBase& conn,
+      size_t maxPackets);
+  ~GSOInplacePacketBatchWriter() override = default;
+
+  bool empty() const override;
+
+  size_t size() const override;
+
+  void reset() override;
+  bool needsFlush(size_t size) override;
+  bool append(std::unique_ptr<folly::IOBuf>&& buf, size_t size) override;
+  ssize_t write(
+      folly::AsyncUDPSocket& sock,
+      const folly::SocketAddress& address) override;
+
+ private:
+  QuicConnectionStateBase& conn_;
+  // max number of packets we can accumulate before we need to flush
+  size_t maxPackets_;
+  // end of the last packet appended to this writer
+  const uint8_t* lastPacketEnd_{nullptr};
+  // size of the first packet, which is also the GSO segment size
+  size_t prevSize_{0};
+  // current number of packets appended to this writer
+  size_t numPackets_{0};
+};
+
 class SendmmsgPacketBatchWriter : public BatchWriter {
  public:
   explicit SendmmsgPacketBatchWriter(size_t maxBufs);
@@ -142,12 +210,76 @@ class SendmmsgGSOPacketBatchWriter : public BatchWriter {
   std::vector<int> gso_;
 };
 
+/**
+ * Batch writer for connections paced with SCM_TXTIME. Each packet is its own
+ * datagram stamped with the departure time the pacer gives it, and the whole
+ * batch goes out with one sendmmsg call. The fq qdisc then releases the
+ * packets at their departure times.
+ */
+class TxTimePacketBatchWriter : public BatchWriter {
+ public:
+  TxTimePacketBatchWriter(QuicConnectionStateBase& conn, size_t maxBufs);
+  ~TxTimePacketBatchWriter() override = default;
+
+  bool empty() const override;
+
+  size_t size() const override;
+
+  void reset() override;
+  bool append(std::unique_ptr<folly::IOBuf>&& buf, size_t size) override;
+  ssize_t write(
+      folly::AsyncUDPSocket& sock,
+      const folly::SocketAddress& address) override;
+
+ private:
+  QuicConnectionStateBase& conn_;
+  // max number of buffer chains we can accumulate before we need to flush
+  size_t maxBufs_{1};
+  // size of data in all the buffers
+  size_t currSize_{0};
+  std::vector<std::unique_ptr<folly::IOBuf>> bufs_;
+  // departure time of each of bufs_
+  std::vector<TimePoint> txTimes_;
+};
+
+/**
+ * Batch writer for connections sharing a SharedEgressBatch. Each packet is
+ * handed to the shared batch on write(), to go out with the packets of the
+ * other connections at the end of the loop, so the write always succeeds.
+ */
+class SharedEgressPacketBatchWriter : public IOBufBatchWriter {
+ public:
+  explicit SharedEgressPacketBatchWriter(SharedEgressBatch& egressBatch);
+  ~SharedEgressPacketBatchWriter() override = default;
+
+  void reset() override;
+  bool append(std::unique_ptr<folly::IOBuf>&& buf, size_t /*unused*/) override;
+  ssize_t write(
+      folly::AsyncUDPSocket& sock,
+      const folly::SocketAddress& address) override;
+
+ private:
+  SharedEgressBatch& egressBatch_;
+};
+
 class BatchWriterFactory {
  public:
   static std::unique_ptr<BatchWriter> makeBatchWriter(
       folly::AsyncUDPSocket& sock,
       const quic::QuicBatchingMode& batchingMode,
       uint32_t batchSize);
+
+  // Same as above, but picks the in-place writer when the connection writes
+  // into continuous memory. Only BATCHING_MODE_NONE and BATCHING_MODE_GSO have
+  // an in-place writer; other modes get the writer of the 3-arg version.
+  // Connections paced with SCM_TXTIME always get a TxTimePacketBatchWriter,
+  // other connections with an egressBatch a SharedEgressPacketBatchWriter.
+  static std::unique_ptr<BatchWriter> makeBatchWriter(
+      folly::AsyncUDPSocket& sock,
+      const quic::QuicBatchingMode& batchingMode,
+      uint32_t batchSize,
+      DataPathType dataPathType,
+      QuicConnectionStateBase& conn);
 };
 
 } // namespace quic
@@ -58,7 +58,14 @@ folly::Optional<PacketNum> AckScheduler::writeAcksImpl(
            ? std::chrono::duration_cast<std::chrono::microseconds>(
                  ackingTime - receivedTime)
            : 0us);
-  AckFrameMetaData meta(ackState_.acks, ackDelay, ackDelayExponentToUse);
+  AckFrameMetaData meta(
+      ackState_.acks,
+      ackDelay,
+      ackDelayExponentToUse,
+      &ackState_.acksEncoding);
+  if (!ackState_.ecnCounts.empty()) {
+    meta.ecnCounts = &ackState_.ecnCounts;
+  }
   auto ackWriteResult = writeAckFrame(meta, builder);
   if (!ackWriteResult) {
     return folly::none;
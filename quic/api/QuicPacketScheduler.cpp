@@ -8,6 +8,10 @@
 
 #include <quic/api/QuicPacketScheduler.h>
 
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
 namespace quic {
 
 bool hasAcksToSchedule(const AckState& ackState) {
@@ -81,13 +85,19 @@ FrameScheduler::Builder& FrameScheduler::Builder::simpleFrames() {
   return *this;
 }
 
+FrameScheduler::Builder& FrameScheduler::Builder::datagramFrames() {
+  datagramFrameScheduler_ = true;
+  return *this;
+}
+
 FrameScheduler FrameScheduler::Builder::build() && {
   FrameScheduler scheduler(std::move(name_));
   if (retransmissionScheduler_) {
     scheduler.retransmissionScheduler_.emplace(RetransmissionScheduler(conn_));
   }
   if (streamFrameScheduler_) {
-    scheduler.streamFrameScheduler_.emplace(StreamFrameScheduler(conn_));
+    scheduler.streamFrameScheduler_.emplace(StreamFrameScheduler(
+        conn_, encryptionLevel_ == EncryptionLevel::EarlyData));
   }
   if (ackScheduler_) {
     scheduler.ackScheduler_.emplace(
@@ -109,6 +119,9 @@ FrameScheduler FrameScheduler::Builder::build() && {
   if (simpleFrameScheduler_) {
     scheduler.simpleFrameScheduler_.emplace(SimpleFrameScheduler(conn_));
   }
+  if (datagramFrameScheduler_) {
+    scheduler.datagramFrameScheduler_.emplace(DatagramFrameScheduler(conn_));
+  }
   return scheduler;
 }
 
@@ -163,6 +176,12 @@ SchedulingResult FrameScheduler::scheduleFramesForPacket(
       simpleFrameScheduler_->hasPendingSimpleFrames()) {
     simpleFrameScheduler_->writeSimpleFrames(wrapper);
   }
+  // Datagrams are latency sensitive and can't be split, so they go before the
+  // stream data which would otherwise fill the packet.
+  if (datagramFrameScheduler_ &&
+      datagramFrameScheduler_->hasPendingDatagramFrames()) {
+    datagramFrameScheduler_->writeDatagramFrames(wrapper);
+  }
   if (retransmissionScheduler_ && retransmissionScheduler_->hasPendingData()) {
     retransmissionScheduler_->writeRetransmissionStreams(wrapper);
   }
@@ -188,7 +207,9 @@ bool FrameScheduler::hasImmediateData() const {
        windowUpdateScheduler_->hasPendingWindowUpdates()) ||
       (blockedScheduler_ && blockedScheduler_->hasPendingBlockedFrames()) ||
       (simpleFrameScheduler_ &&
-       simpleFrameScheduler_->hasPendingSimpleFrames());
+       simpleFrameScheduler_->hasPendingSimpleFrames()) ||
+      (datagramFrameScheduler_ &&
+       datagramFrameScheduler_->hasPendingDatagramFrames());
 }
 
 std::string FrameScheduler::name() const {
@@ -201,9 +222,31 @@ RetransmissionScheduler::RetransmissionScheduler(
 
 void RetransmissionScheduler::writeRetransmissionStreams(
     PacketBuilderInterface& builder) {
+  lossStreams_.clear();
   for (auto streamId : conn_.streamManager->lossStreams()) {
     auto stream = conn_.streamManager->findStream(streamId);
     CHECK(stream);
+    lossStreams_.push_back(stream);
+  }
+  auto sortKey = [](const QuicStreamState* stream) {
+    // Control streams first, then by urgency, sequential before incremental.
+    auto firstLossOffset = stream->lossBuffer.empty()
+        ? std::numeric_limits<uint64_t>::max()
+        : stream->lossBuffer.front().offset;
+    return std::make_tuple(
+        !stream->isControl,
+        stream->priority.urgency,
+        stream->priority.incremental,
+        firstLossOffset,
+        stream->id);
+  };
+  std::sort(
+      lossStreams_.begin(),
+      lossStreams_.end(),
+      [&](const QuicStreamState* a, const QuicStreamState* b) {
+        return sortKey(a) < sortKey(b);
+      });
+  for (auto stream : lossStreams_) {
     for (auto buffer = stream->lossBuffer.cbegin();
          buffer != stream->lossBuffer.cend();
          ++buffer) {
@@ -221,8 +264,11 @@ void RetransmissionScheduler::writeRetransmissionStreams(
                 << " offset=" << buffer->offset << " bytes=" << *dataLen
                 << " fin=" << (buffer->eof && *dataLen == bufferLen) << " "
                 << conn_;
-      } else {
+      } else if (builder.remainingSpaceInPkt() == 0) {
         return;
+      } else {
+        // The next stream's frame header may be shorter.
+        break;
       }
     }
   }
@@ -232,29 +278,58 @@ bool RetransmissionScheduler::hasPendingData() const {
   return !conn_.streamManager->lossStreams().empty();
 }
 
-StreamFrameScheduler::StreamFrameScheduler(QuicConnectionStateBase& conn)
-    : conn_(conn) {}
+StreamFrameScheduler::StreamFrameScheduler(
+    QuicConnectionStateBase& conn,
+    bool earlyData)
+    : conn_(conn), earlyData_(earlyData) {}
 
-StreamId StreamFrameScheduler::writeStreamsHelper(
+void StreamFrameScheduler::writeStreamsHelper(
     PacketBuilderInterface& builder,
-    const std::set<StreamId>& writableStreams,
-    StreamId nextScheduledStream,
-    uint64_t& connWritableBytes) {
-  MiddleStartingIterationWrapper wrapper(writableStreams, nextScheduledStream);
-  auto writableStreamItr = wrapper.cbegin();
-  // This will write the stream frames in a round robin fashion ordered by
-  // stream id. The iterator will wrap around the collection at the end, and we
-  // keep track of the value at the next iteration. This allows us to start
-  // writing at the next stream when building the next packet.
-  // TODO experiment with writing streams with an actual prioritization scheme.
-  while (writableStreamItr != wrapper.cend() && connWritableBytes > 0) {
-    if (writeNextStreamFrame(builder, *writableStreamItr, connWritableBytes)) {
-      writableStreamItr++;
-    } else {
+    RoundRobinStreamSet& writableStreams,
+    bool incremental,
+    uint64_t& connWritableBytes,
+    uint64_t quantum) {
+  // This will write the stream frames in a round robin fashion. We stop after
+  // one full round, and remember the stream we stopped at so that the next
+  // packet starts writing from there. The streams that were fully written are
+  // removed from the set once the packet is sent, which moves the cursor past
+  // them.
+  auto start = writableStreams.getNextScheduled();
+  auto streamId = start;
+  if (incremental && quantum > 0) {
+    do {
+      auto next = writableStreams.following(streamId);
+      if (writeNextStreamFrameInTurn(
+              builder,
+              streamId,
+              next == start,
+              connWritableBytes,
+              quantum) &&
+          builder.remainingSpaceInPkt() == 0) {
+        // The stream's turn isn't over, the next packet starts with it.
+        break;
+      }
+      streamId = next;
+    } while (streamId != start && connWritableBytes > 0 &&
+             builder.remainingSpaceInPkt() > 0);
+    writableStreams.setNextScheduled(streamId);
+    return;
+  }
+  do {
+    if (!writeNextStreamFrame(builder, streamId, connWritableBytes) &&
+        builder.remainingSpaceInPkt() == 0) {
       break;
     }
+    // A stream that didn't fit may just have a longer frame header than the
+    // next one, e.g. at a larger offset, so the rest of the round still gets
+    // to fill the packet.
+    streamId = writableStreams.following(streamId);
+  } while (streamId != start && connWritableBytes > 0);
+  // Sequential streams keep the cursor on the first stream until all of its
+  // data is sent.
+  if (incremental) {
+    writableStreams.setNextScheduled(streamId);
   }
-  return *writableStreamItr;
 }
 
 void StreamFrameScheduler::writeStreams(PacketBuilderInterface& builder) {
@@ -264,49 +339,93 @@ void StreamFrameScheduler::writeStreams(PacketBuilderInterface& builder) {
     return;
   }
   // Write the control streams first as a naive binary priority mechanism.
-  const auto& writableControlStreams =
-      conn_.streamManager->writableControlStreams();
+  auto& writableControlStreams = conn_.streamManager->writableControlStreams();
   if (!writableControlStreams.empty()) {
-    conn_.schedulingState.nextScheduledControlStream = writeStreamsHelper(
+    writeStreamsHelper(
         builder,
         writableControlStreams,
-        conn_.schedulingState.nextScheduledControlStream,
-        connWritableBytes);
-  }
-  if (connWritableBytes == 0) {
-    return;
-  }
-  const auto& writableStreams = conn_.streamManager->writableStreams();
-  if (!writableStreams.empty()) {
-    conn_.schedulingState.nextScheduledStream = writeStreamsHelper(
-        builder,
-        writableStreams,
-        conn_.schedulingState.nextScheduledStream,
+        true /* incremental */,
         connWritableBytes);
   }
-} // namespace quic
+  // Then the other streams, most urgent level first. A less urgent level only
+  // gets to write if the more urgent ones leave room in the packet.
+  conn_.streamManager->writableStreams().forEachLevel(
+      [&](RoundRobinStreamSet& level, bool incremental) {
+        if (connWritableBytes == 0 || builder.remainingSpaceInPkt() == 0) {
+          return false;
+        }
+        writeStreamsHelper(
+            builder,
+            level,
+            incremental,
+            connWritableBytes,
+            conn_.transportSettings.streamSchedulingQuantum);
+        return true;
+      });
+}
 
 bool StreamFrameScheduler::hasPendingData() const {
   return conn_.streamManager->hasWritable() &&
       getSendConnFlowControlBytesWire(conn_) > 0;
 }
 
+bool StreamFrameScheduler::writeNextStreamFrameInTurn(
+    PacketBuilderInterface& builder,
+    StreamId streamId,
+    bool lastInRound,
+    uint64_t& connWritableBytes,
+    uint64_t quantum) {
+  auto stream = conn_.streamManager->findStream(streamId);
+  CHECK(stream);
+  if (stream->sendQuantumLeft <= 0) {
+    // A new turn. A stream that overdrew its last one may still be in debt
+    // and sit this round out.
+    stream->sendQuantumLeft += static_cast<int64_t>(quantum);
+    if (stream->sendQuantumLeft <= 0) {
+      return false;
+    }
+  }
+  // The last stream of the round may overdraw its quantum to fill the packet,
+  // since no other stream can write into it anymore.
+  uint64_t maxBytes = lastInRound
+      ? std::numeric_limits<uint64_t>::max()
+      : static_cast<uint64_t>(stream->sendQuantumLeft);
+  auto bufferLen = stream->writeBuffer.chainLength();
+  auto connWritableBytesBefore = connWritableBytes;
+  writeNextStreamFrame(builder, streamId, connWritableBytes, maxBytes);
+  auto bytesWritten = connWritableBytesBefore - connWritableBytes;
+  if (bytesWritten == bufferLen) {
+    // Nothing left to send, the stream starts afresh when it has more.
+    stream->sendQuantumLeft = 0;
+    return false;
+  }
+  stream->sendQuantumLeft -= static_cast<int64_t>(bytesWritten);
+  return stream->sendQuantumLeft > 0;
+}
+
 bool StreamFrameScheduler::writeNextStreamFrame(
     PacketBuilderInterface& builder,
     StreamId streamId,
-    uint64_t& connWritableBytes) {
+    uint64_t& connWritableBytes,
+    uint64_t maxBytes) {
   if (builder.remainingSpaceInPkt() == 0) {
     return false;
   }
   auto stream = conn_.streamManager->findStream(streamId);
   CHECK(stream);
+  if (earlyData_ && !stream->earlyDataAllowed) {
+    // Waits for the 1-RTT keys, the app didn't mark it as replay safe.
+    return false;
+  }
 
   // hasWritableData is the condition which has to be satisfied for the
   // stream to be in writableList
   DCHECK(stream->hasWritableData());
 
-  uint64_t flowControlLen =
-      std::min(getSendStreamFlowControlBytesWire(*stream), connWritableBytes);
+  uint64_t flowControlLen = std::min(
+      {getSendStreamFlowControlBytesWire(*stream),
+       connWritableBytes,
+       maxBytes});
   uint64_t bufferLen = stream->writeBuffer.chainLength();
   bool canWriteFin =
       stream->finalWriteOffset.has_value() && bufferLen <= flowControlLen;
@@ -350,11 +469,10 @@ bool RstStreamScheduler::writeRsts(PacketBuilderInterface& builder) {
   bool rstWritten = false;
   for (const auto& resetStream : conn_.pendingEvents.resets) {
     // TODO: here, maybe coordinate scheduling of RST_STREAMS and streams.
-    auto bytesWritten = writeFrame(resetStream.second, builder);
-    if (!bytesWritten) {
-      break;
+    // One that doesn't fit doesn't stop the smaller ones after it.
+    if (writeFrame(resetStream.second, builder)) {
+      rstWritten = true;
     }
-    rstWritten = true;
   }
   return rstWritten;
 }
@@ -376,10 +494,43 @@ bool SimpleFrameScheduler::writeSimpleFrames(PacketBuilderInterface& builder) {
 
   bool framesWritten = false;
   for (auto& frame : conn_.pendingEvents.frames) {
-    auto bytesWritten = writeSimpleFrame(QuicSimpleFrame(frame), builder);
-    if (!bytesWritten) {
+    // The frames vary in size a lot, a small one may fit after a large one
+    // that didn't.
+    if (writeSimpleFrame(QuicSimpleFrame(frame), builder)) {
+      framesWritten = true;
+    } else if (builder.remainingSpaceInPkt() == 0) {
+      break;
+    }
+  }
+  return framesWritten;
+}
+
+DatagramFrameScheduler::DatagramFrameScheduler(QuicConnectionStateBase& conn)
+    : conn_(conn) {}
+
+bool DatagramFrameScheduler::hasPendingDatagramFrames() const {
+  return !conn_.datagramState.writeBuffer.empty();
+}
+
+bool DatagramFrameScheduler::writeDatagramFrames(
+    PacketBuilderInterface& builder) {
+  bool framesWritten = false;
+  auto& writeBuffer = conn_.datagramState.writeBuffer;
+  while (!writeBuffer.empty()) {
+    auto& payload = writeBuffer.front();
+    auto length = payload ? payload->computeChainDataLength() : 0;
+    // Writing takes the payload, so it has to be known to fit first.
+    QuicInteger lengthInt(length);
+    QuicInteger frameTypeInt(
+        static_cast<FrameTypeType>(FrameType::DATAGRAM_LEN));
+    if (frameTypeInt.getSize() + lengthInt.getSize() + length >
+        builder.remainingSpaceInPkt()) {
       break;
     }
+    auto bytesWritten =
+        writeFrame(DatagramFrame(length, std::move(payload)), builder);
+    CHECK_GT(bytesWritten, 0);
+    writeBuffer.pop_front();
     framesWritten = true;
   }
   return framesWritten;
@@ -405,6 +556,11 @@ void WindowUpdateScheduler::writeWindowUpdates(
     }
   }
   for (const auto& windowUpdateStream : conn_.streamManager->windowUpdates()) {
+    // Nothing smaller than this fits, so don't bother building the frame.
+    if (builder.remainingSpaceInPkt() <
+        maxStreamDataFrameSize(windowUpdateStream, 0)) {
+      break;
+    }
     auto stream = conn_.streamManager->findStream(windowUpdateStream);
     if (!stream) {
       continue;
@@ -413,7 +569,8 @@ void WindowUpdateScheduler::writeWindowUpdates(
     auto maximumData = maxStreamDataFrame.maximumData;
     auto bytes = writeFrame(std::move(maxStreamDataFrame), builder);
     if (!bytes) {
-      break;
+      // The next stream's may be shorter.
+      continue;
     }
     VLOG(4) << "Wrote max_stream_data stream=" << stream->id
             << " maximumData=" << maximumData << " " << conn_;
@@ -429,8 +586,8 @@ bool BlockedScheduler::hasPendingBlockedFrames() const {
 
 void BlockedScheduler::writeBlockedFrames(PacketBuilderInterface& builder) {
   for (const auto& blockedStream : conn_.streamManager->blockedStreams()) {
-    auto bytesWritten = writeFrame(blockedStream.second, builder);
-    if (!bytesWritten) {
+    writeFrame(blockedStream.second, builder);
+    if (builder.remainingSpaceInPkt() == 0) {
       break;
     }
   }
@@ -473,7 +630,11 @@ bool CryptoStreamScheduler::writeCryptoData(PacketBuilderInterface& builder) {
     const LongHeader* longHeader = builder.getPacketHeader().asLong();
     bool initialPacket =
         longHeader && longHeader->getHeaderType() == LongHeader::Types::Initial;
-    if (initialPacket) {
+    // A server coalescing packets leaves room for its Handshake packets, the
+    // client's Initials have to fill a datagram.
+    bool padded = conn_.nodeType == QuicNodeType::Client ||
+        !conn_.transportSettings.coalescePackets;
+    if (initialPacket && padded) {
       // This is the initial packet, we need to fill er up.
       while (builder.remainingSpaceInPkt() > 0) {
         writeFrame(PaddingFrame(), builder);
@@ -518,6 +679,15 @@ SchedulingResult CloningScheduler::scheduleFramesForPacket(
     return frameScheduler_.scheduleFramesForPacket(
         std::move(builder), writableBytes);
   }
+  // The output buffer in ContinuousMemory mode is shared by all builders, so
+  // the header the passed-in builder has written has to go before we start
+  // writing clones into the same buffer.
+  bool useInplaceBuilder =
+      conn_.transportSettings.dataPathType == DataPathType::ContinuousMemory &&
+      conn_.bufAccessor;
+  if (useInplaceBuilder) {
+    std::move(builder).releaseOutputBuffer();
+  }
   // Look for an outstanding packet that's no larger than the writableBytes
   for (auto iter = conn_.outstandingPackets.rbegin();
        iter != conn_.outstandingPackets.rend();
@@ -526,19 +696,6 @@ SchedulingResult CloningScheduler::scheduleFramesForPacket(
     if (opPnSpace != PacketNumberSpace::AppData) {
       continue;
     }
-    // Reusing the RegularQuicPacketBuilder throughout loop bodies will lead to
-    // frames belong to different original packets being written into the same
-    // clone packet. So re-create a RegularQuicPacketBuilder every time.
-    // TODO: We can avoid the copy & rebuild of the header by creating an
-    // independent header builder.
-    auto builderPnSpace = builder.getPacketHeader().getPacketNumberSpace();
-    CHECK_EQ(builderPnSpace, PacketNumberSpace::AppData);
-    // TODO: This needs to be provided from outside now
-    RegularQuicPacketBuilder regularBuilder(
-        conn_.udpSendPacketLen,
-        builder.getPacketHeader(),
-        getAckState(conn_, builderPnSpace).largestAckedByPeer);
-    PacketRebuilder rebuilder(regularBuilder, conn_);
     // We shouldn't clone Handshake packet.
     if (iter->isHandshake) {
       continue;
@@ -557,12 +714,36 @@ SchedulingResult CloningScheduler::scheduleFramesForPacket(
       continue;
     }
 
+    // Reusing the same builder throughout loop bodies will lead to frames
+    // belong to different original packets being written into the same clone
+    // packet. So re-create a builder every time.
+    // TODO: We can avoid the copy & rebuild of the header by creating an
+    // independent header builder.
+    auto builderPnSpace = builder.getPacketHeader().getPacketNumberSpace();
+    CHECK_EQ(builderPnSpace, PacketNumberSpace::AppData);
+    std::unique_ptr<PacketBuilderInterface> internalBuilder;
+    if (useInplaceBuilder) {
+      internalBuilder = std::make_unique<InplaceQuicPacketBuilder>(
+          *conn_.bufAccessor,
+          conn_.udpSendPacketLen,
+          builder.getPacketHeader(),
+          getAckState(conn_, builderPnSpace).largestAckedByPeer);
+    } else {
+      internalBuilder = std::make_unique<RegularQuicPacketBuilder>(
+          conn_.udpSendPacketLen,
+          builder.getPacketHeader(),
+          getAckState(conn_, builderPnSpace).largestAckedByPeer);
+    }
+    PacketRebuilder rebuilder(*internalBuilder, conn_);
+
     // Rebuilder will write the rest of frames
     auto rebuildResult = rebuilder.rebuildFromPacket(*iter);
     if (rebuildResult) {
       return SchedulingResult(
-          std::move(rebuildResult), std::move(regularBuilder).buildPacket());
+          std::move(rebuildResult), std::move(*internalBuilder).buildPacket());
     }
+    // Drop whatever the failed rebuild has written.
+    std::move(*internalBuilder).releaseOutputBuffer();
   }
   return SchedulingResult(folly::none, folly::none);
 }
@@ -8,7 +8,6 @@
 
 #pragma once
 
-#include <boost/iterator/iterator_facade.hpp>
 #include <folly/Overload.h>
 #include <quic/QuicConstants.h>
 #include <quic/QuicException.h>
@@ -67,17 +66,31 @@ class RetransmissionScheduler {
  public:
   explicit RetransmissionScheduler(const QuicConnectionStateBase& conn);
 
+  /**
+   * Writes lost data in the order the stream scheduler would serve the
+   * streams, and among streams of the same priority the one whose first gap
+   * has the lowest offset first, being the one the peer is likely blocked on
+   * the longest.
+   */
   void writeRetransmissionStreams(PacketBuilderInterface& builder);
 
   bool hasPendingData() const;
 
  private:
   const QuicConnectionStateBase& conn_;
+  // Reused for sorting the streams with loss.
+  std::vector<const QuicStreamState*> lossStreams_;
 };
 
 class StreamFrameScheduler {
  public:
-  explicit StreamFrameScheduler(QuicConnectionStateBase& conn);
+  /**
+   * A scheduler for 0-RTT packets (earlyData) only writes the streams that
+   * allow early data.
+   */
+  explicit StreamFrameScheduler(
+      QuicConnectionStateBase& conn,
+      bool earlyData = false);
 
   /**
    * Return: the first boolean indicates if at least one Blocked frame
@@ -89,91 +102,18 @@ class StreamFrameScheduler {
 
  private:
   /**
-   * A helper iterator adaptor class that starts iteration of streams from a
-   * specific stream id.
+   * Writes the streams in writableStreams, starting from the one scheduled
+   * next. For incremental streams the cursor then moves to where the next
+   * packet should start, so that streams share the connection round robin.
+   * With a quantum, each incremental stream writes up to quantum bytes per
+   * turn (deficit round robin), so streams interleave within packets.
    */
-  class MiddleStartingIterationWrapper {
-   public:
-    using MapType = std::set<StreamId>;
-
-    class MiddleStartingIterator
-        : public boost::iterator_facade<
-              MiddleStartingIterator,
-              const MiddleStartingIterationWrapper::MapType::value_type,
-              boost::forward_traversal_tag> {
-      friend class boost::iterator_core_access;
-
-     public:
-      using MapType = MiddleStartingIterationWrapper::MapType;
-
-      MiddleStartingIterator() = default;
-
-      MiddleStartingIterator(
-          const MapType* streams,
-          const MapType::key_type& start)
-          : streams_(streams) {
-        itr_ = streams_->lower_bound(start);
-        checkForWrapAround();
-        // We don't want to mark it as wrapped around initially, instead just
-        // act as if start was the first element.
-        wrappedAround_ = false;
-      }
-
-      const MapType::value_type& dereference() const {
-        return *itr_;
-      }
-
-      bool equal(const MiddleStartingIterator& other) const {
-        return wrappedAround_ == other.wrappedAround_ && itr_ == other.itr_;
-      }
-
-      void increment() {
-        ++itr_;
-        checkForWrapAround();
-      }
-
-      void checkForWrapAround() {
-        if (itr_ == streams_->cend()) {
-          wrappedAround_ = true;
-          itr_ = streams_->cbegin();
-        }
-      }
-
-     private:
-      friend class MiddleStartingIterationWrapper;
-      bool wrappedAround_{false};
-      const MapType* streams_{nullptr};
-      MapType::const_iterator itr_;
-    };
-
-    MiddleStartingIterationWrapper(
-        const MapType& streams,
-        const MapType::key_type& start)
-        : streams_(streams), start_(start) {}
-
-    MiddleStartingIterator cbegin() const {
-      return MiddleStartingIterator(&streams_, start_);
-    }
-
-    MiddleStartingIterator cend() const {
-      MiddleStartingIterator itr(&streams_, start_);
-      itr.wrappedAround_ = true;
-      return itr;
-    }
-
-   private:
-    const MapType& streams_;
-    const MapType::key_type& start_;
-  };
-
-  StreamId writeStreamsHelper(
+  void writeStreamsHelper(
       PacketBuilderInterface& builder,
-      const std::set<StreamId>& writableStreams,
-      StreamId nextScheduledStream,
-      uint64_t& connWritableBytes);
-
-  using WritableStreamItr =
-      MiddleStartingIterationWrapper::MiddleStartingIterator;
+      RoundRobinStreamSet& writableStreams,
+      bool incremental,
+      uint64_t& connWritableBytes,
+      uint64_t quantum = 0);
 
   /**
    * Helper function to write either stream data if stream is not flow
@@ -186,9 +126,22 @@ class StreamFrameScheduler {
   bool writeNextStreamFrame(
       PacketBuilderInterface& builder,
       StreamId streamId,
-      uint64_t& connWritableBytes);
+      uint64_t& connWritableBytes,
+      uint64_t maxBytes = std::numeric_limits<uint64_t>::max());
+
+  /**
+   * Writes the next stream of a deficit round robin round. Returns whether
+   * the stream's turn goes on in the next packet.
+   */
+  bool writeNextStreamFrameInTurn(
+      PacketBuilderInterface& builder,
+      StreamId streamId,
+      bool lastInRound,
+      uint64_t& connWritableBytes,
+      uint64_t quantum);
 
   QuicConnectionStateBase& conn_;
+  bool earlyData_;
 };
 
 class AckScheduler {
@@ -257,6 +210,22 @@ class SimpleFrameScheduler {
   const QuicConnectionStateBase& conn_;
 };
 
+/*
+ * Datagrams the app wrote, which go out once and are never retransmitted. The
+ * scheduler removes the datagrams it writes from the connection.
+ */
+class DatagramFrameScheduler {
+ public:
+  explicit DatagramFrameScheduler(QuicConnectionStateBase& conn);
+
+  bool hasPendingDatagramFrames() const;
+
+  bool writeDatagramFrames(PacketBuilderInterface& builder);
+
+ private:
+  QuicConnectionStateBase& conn_;
+};
+
 class WindowUpdateScheduler {
  public:
   explicit WindowUpdateScheduler(const QuicConnectionStateBase& conn);
@@ -323,6 +292,7 @@ class FrameScheduler : public QuicPacketScheduler {
     Builder& blockedFrames();
     Builder& cryptoFrames();
     Builder& simpleFrames();
+    Builder& datagramFrames();
 
     FrameScheduler build() &&;
 
@@ -341,6 +311,7 @@ class FrameScheduler : public QuicPacketScheduler {
     bool blockedScheduler_{false};
     bool cryptoStreamScheduler_{false};
     bool simpleFrameScheduler_{false};
+    bool datagramFrameScheduler_{false};
   };
 
   explicit FrameScheduler(std::string name);
@@ -366,6 +337,7 @@ class FrameScheduler : public QuicPacketScheduler {
   folly::Optional<BlockedScheduler> blockedScheduler_;
   folly::Optional<CryptoStreamScheduler> cryptoStreamScheduler_;
   folly::Optional<SimpleFrameScheduler> simpleFrameScheduler_;
+  folly::Optional<DatagramFrameScheduler> datagramFrameScheduler_;
   std::string name_;
 };
 
@@ -11,8 +11,11 @@
 #include <folly/Expected.h>
 #include <folly/Optional.h>
 #include <folly/io/IOBuf.h>
+#include <folly/portability/IOVec.h>
 #include <quic/QuicConstants.h>
 #include <quic/codec/Types.h>
+#include <quic/congestion_control/Bandwidth.h>
+#include <quic/state/ConnectionMemoryUsage.h>
 #include <quic/state/StateData.h>
 
 #include <chrono>
@@ -113,6 +116,11 @@ class QuicSocket {
     uint32_t totalPTOCount{0};
     PacketNum largestPacketAckedByPeer{0};
     PacketNum largestPacketSent{0};
+    HandshakeTimings handshakeTimings;
+    // The negotiated cipher suite, once the handshake has picked one.
+    folly::Optional<std::string> cipherSuite;
+    // Added up over the connection's buffers and packets on every call.
+    ConnectionMemoryUsage memoryUsage;
   };
 
   /**
@@ -279,6 +287,47 @@ class QuicSocket {
    */
   virtual TransportInfo getTransportInfo() const = 0;
 
+  /**
+   * Get the transport's current estimate of the connection's delivery rate.
+   * It comes from the congestion controller when it models bandwidth, and is
+   * the congestion window over srtt otherwise. Returns folly::none when
+   * there isn't enough data for an estimate yet.
+   */
+  virtual folly::Optional<Bandwidth> getBandwidthEstimate() const = 0;
+
+  /**
+   * Estimate how long it takes to deliver bytes to the peer at the current
+   * bandwidth estimate, not counting data already buffered or in flight.
+   * Returns folly::none if there is no bandwidth estimate.
+   */
+  virtual folly::Optional<std::chrono::microseconds> estimateTimeToSend(
+      uint64_t bytes) const = 0;
+
+  /**
+   * Callback class for bandwidth estimate changes
+   */
+  class BandwidthEstimateCallback {
+   public:
+    virtual ~BandwidthEstimateCallback() = default;
+
+    /**
+     * Invoked when the bandwidth estimate has moved by more than the change
+     * threshold since the last invocation, or when the first estimate is
+     * available.
+     */
+    virtual void onBandwidthEstimateChanged(Bandwidth estimate) noexcept = 0;
+  };
+
+  /**
+   * Set the callback to be invoked when the bandwidth estimate changes by
+   * more than changeThreshold, a fraction of the last reported estimate. The
+   * estimate is checked after processing data from the network. Pass nullptr
+   * to unset the callback.
+   */
+  virtual void setBandwidthEstimateCallback(
+      BandwidthEstimateCallback* cb,
+      float changeThreshold = kDefaultBandwidthEstimateChangeThreshold) = 0;
+
   /**
    * Get internal transport info similar to TCP information.
    * Returns LocalErrorCode::STREAM_NOT_EXISTS if the stream is not found
@@ -490,6 +539,36 @@ class QuicSocket {
       StreamId id,
       size_t maxLen) = 0;
 
+  /**
+   * Same as read(), but returns the data as a vector of unchained IOBufs, each
+   * pointing straight into the buffer of the packet it was received in. Apps
+   * that hand the data on as iovecs avoid walking or coalescing a chain.
+   */
+  virtual folly::Expected<std::pair<std::vector<Buf>, bool>, LocalErrorCode>
+  readSlices(StreamId id, size_t maxLen) = 0;
+
+  /**
+   * Sets a buffer that the in-order data of the given stream is copied into
+   * as it arrives, instead of being kept until read() is called.  The read
+   * callback fires once some of it is filled, or the stream reached EOF, and
+   * takeReadBuffer() returns how much.  Data already received is copied in
+   * right away.  The buffer must stay valid until takeReadBuffer() is called
+   * or the read callback gets an error.
+   *
+   * read() returns INVALID_OPERATION while a buffer is set, and only one
+   * buffer can be set on a stream at a time.
+   */
+  virtual folly::Expected<folly::Unit, LocalErrorCode> setReadBuffer(
+      StreamId id,
+      folly::MutableByteRange buffer) = 0;
+
+  /**
+   * Unsets the buffer set with setReadBuffer(), and returns how many bytes
+   * were copied into it and whether EOF was reached on the stream.
+   */
+  virtual folly::Expected<std::pair<size_t, bool>, LocalErrorCode>
+  takeReadBuffer(StreamId id) = 0;
+
   /**
    * ===== Peek/Consume API =====
    */
@@ -532,6 +611,41 @@ class QuicSocket {
       StreamId id,
       PeekCallback* cb) = 0;
 
+  /**
+   * Appends an iovec for each IOBuf of the peeked data that is contiguous
+   * with the start of it, in stream order, without copying or chaining
+   * anything. Returns the number of bytes the appended iovecs cover, which is
+   * what to consume() once they were used if the peek data starts at the
+   * read offset of the stream. The iovecs are only valid as long as the peek
+   * range is.
+   */
+  static size_t peekDataToIovecs(
+      const folly::Range<PeekIterator>& peekData,
+      std::vector<struct iovec>& iovecs) {
+    size_t bytes = 0;
+    folly::Optional<uint64_t> nextOffset;
+    for (const auto& streamBuffer : peekData) {
+      if (nextOffset && streamBuffer.offset != *nextOffset) {
+        break;
+      }
+      nextOffset = streamBuffer.offset + streamBuffer.data.chainLength();
+      const folly::IOBuf* front = streamBuffer.data.front();
+      if (!front) {
+        continue;
+      }
+      const folly::IOBuf* current = front;
+      do {
+        if (current->length() > 0) {
+          iovecs.push_back(
+              {const_cast<uint8_t*>(current->data()), current->length()});
+          bytes += current->length();
+        }
+        current = current->next();
+      } while (current != front);
+    }
+    return bytes;
+  }
+
   /**
    * Pause/Resume peek callback being triggered when data is available.
    */
@@ -623,6 +737,17 @@ class QuicSocket {
   virtual folly::Expected<folly::Optional<uint64_t>, LocalErrorCode>
   sendDataExpired(StreamId id, uint64_t offset) = 0;
 
+  /**
+   * Expire each write made to the stream from now on once ttl has passed
+   * since it was made, as sendDataExpired() would, or stop with folly::none.
+   * Data is only expired if some of it is still unsent or unacked, and that
+   * is checked whenever the transport may write, so stale data is dropped
+   * rather than sent or retransmitted.
+   */
+  virtual folly::Expected<folly::Unit, LocalErrorCode> setStreamWriteTimeToLive(
+      StreamId id,
+      folly::Optional<std::chrono::milliseconds> ttl) = 0;
+
   class DataRejectedCallback {
    public:
     virtual ~DataRejectedCallback() = default;
@@ -814,6 +939,74 @@ class QuicSocket {
       bool cork,
       DeliveryCallback* cb = nullptr) = 0;
 
+  /**
+   * One of the writes of writeMany.
+   */
+  struct StreamWrite {
+    StreamId id;
+    Buf data;
+    bool eof{false};
+    DeliveryCallback* cb{nullptr};
+
+    StreamWrite(
+        StreamId idIn,
+        Buf dataIn,
+        bool eofIn,
+        DeliveryCallback* cbIn = nullptr)
+        : id(idIn), data(std::move(dataIn)), eof(eofIn), cb(cbIn) {}
+  };
+
+  /**
+   * Applies a batch of writes, possibly to many streams, in order.  Each
+   * write behaves like writeChain, but the transport schedules writing to the
+   * socket once for the whole batch rather than once per write.
+   *
+   * Returns the error of each write, in the order of the writes, none for
+   * the ones that were applied.  A write that fails does not stop the rest
+   * of the batch, unless it closed the connection.
+   */
+  virtual std::vector<folly::Optional<LocalErrorCode>> writeMany(
+      std::vector<StreamWrite> writes) = 0;
+
+  /**
+   * Write data/eof to the given stream from memory the application owns,
+   * without copying it into transport owned buffers.  The memory is
+   * referenced by the write and retransmission buffers of the stream until
+   * the peer has acknowledged all of it, or until the stream is reset or the
+   * connection is closed, and is only copied into packets when they are
+   * encrypted.  It must not be modified or freed until onRelease is invoked,
+   * which happens exactly once, also when the write fails.
+   *
+   * Otherwise this behaves like writeChain.
+   */
+  virtual WriteResult writeExternal(
+      StreamId id,
+      folly::ByteRange data,
+      folly::Function<void()> onRelease,
+      bool eof,
+      bool cork,
+      DeliveryCallback* cb = nullptr) = 0;
+
+  /**
+   * Write len bytes of the file fd from offset on, and eof if set, to the
+   * given stream.  The file is read lazily, as the stream drains, so that at
+   * most the fileWriteBufferSize transport setting of it is held in the
+   * write buffer at a time.  The application must keep fd open and the range
+   * unchanged until the delivery callback fires, or the stream is reset, and
+   * must not write anything else to the stream before the whole range was
+   * read, which returns INVALID_OPERATION.
+   *
+   * The range has to fit in the flow control window eventually, or the rest
+   * is read once the peer opens it.  A failed read resets the stream.
+   */
+  virtual folly::Expected<folly::Unit, LocalErrorCode> writeFile(
+      StreamId id,
+      int fd,
+      off_t offset,
+      size_t len,
+      bool eof,
+      DeliveryCallback* cb = nullptr) = 0;
+
   /**
    * Register a callback to be invoked when the peer has acknowledged the
    * given offset on the given stream
@@ -872,6 +1065,104 @@ class QuicSocket {
       PingCallback* callback,
       std::chrono::milliseconds pingTimeout) = 0;
 
+  /**
+   * Corks or uncorks the connection.  While corked, stream data written is
+   * held back until a full packet of it is buffered, the maxCorkDelay
+   * transport setting passed since it was first held back, or flush() is
+   * called, so that many small writes go out in full packets.  Acks, control
+   * frames and retransmissions are never held back, and stream data goes out
+   * along with them.  Uncorking writes what is held back.
+   */
+  virtual void setCork(bool cork) = 0;
+
+  /**
+   * Writes the stream data a cork holds back.  The connection stays corked.
+   */
+  virtual void flush() = 0;
+
+  /**
+   * Callback class for received DATAGRAM frames.
+   */
+  class DatagramCallback {
+   public:
+    virtual ~DatagramCallback() = default;
+
+    /**
+     * Invoked after datagrams were added to the read buffer. They stay there
+     * until readDatagrams() takes them, or newer datagrams push them out.
+     */
+    virtual void onDatagramsAvailable() noexcept = 0;
+  };
+
+  /**
+   * Set the callback for received datagrams. The callback may be nullptr to
+   * stop the notifications. Datagrams are only received when the transport
+   * settings advertise a non zero maxDatagramFrameSize.
+   */
+  virtual folly::Expected<folly::Unit, LocalErrorCode> setDatagramCallback(
+      DatagramCallback* cb) = 0;
+
+  /**
+   * Largest datagram payload writeDatagram() accepts, 0 until the peer said
+   * it supports DATAGRAM frames.
+   */
+  virtual uint16_t getDatagramSizeLimit() const = 0;
+
+  /**
+   * Queue a datagram to be sent unreliably, once, without flow control. If
+   * the write buffer is full the oldest queued datagram is dropped to make
+   * room for it.
+   */
+  virtual folly::Expected<folly::Unit, LocalErrorCode> writeDatagram(
+      Buf buf) = 0;
+
+  /**
+   * Take up to atMost received datagrams, oldest first, or all of them if
+   * atMost is 0.
+   */
+  virtual folly::Expected<std::vector<Buf>, LocalErrorCode> readDatagrams(
+      size_t atMost = 0) = 0;
+
+  /**
+   * Callback class for receiving the readiness and delivery events of many
+   * streams in one call per event loop iteration, instead of one call per
+   * stream and event.
+   */
+  class BatchedStreamCallback {
+   public:
+    virtual ~BatchedStreamCallback() = default;
+
+    /**
+     * Invoked instead of ReadCallback::readAvailable, with all the streams
+     * that have data to read and a resumed read callback. Read errors are
+     * still given to the read callback of each stream.
+     */
+    virtual void onStreamsReadable(
+        const std::vector<StreamId>& streams) noexcept = 0;
+
+    struct DeliveryAck {
+      StreamId id;
+      uint64_t offset;
+      DeliveryCallback* cb;
+    };
+
+    /**
+     * Invoked instead of DeliveryCallback::onDeliveryAck, with all the
+     * delivery callbacks whose offsets got acked, in the order they would
+     * have been invoked. Cancellations still go to each callback.
+     */
+    virtual void onDeliveryAcks(
+        const std::vector<DeliveryAck>& acks,
+        std::chrono::microseconds rtt) noexcept = 0;
+  };
+
+  /**
+   * Set the callback that batches the stream events of the connection. The
+   * callback may be nullptr to go back to per stream callbacks.
+   */
+  virtual folly::Expected<folly::Unit, LocalErrorCode> setBatchedStreamCallback(
+      BatchedStreamCallback* cb) = 0;
+
   /**
    * Get information on the state of the quic connection. Should only be used
    * for logging.
@@ -913,9 +1204,49 @@ class QuicSocket {
    */
   virtual folly::Optional<LocalErrorCode> setControlStream(StreamId id) = 0;
 
+  /**
+   * Set the priority of a stream's data, following the HTTP/3 extensible
+   * priority scheme. Data of streams with a lower urgency is sent first, 0
+   * being the most urgent and kNumPriorityUrgencies - 1 the least. Streams of
+   * the same urgency share the connection round robin when incremental is
+   * true, and are sent one after another otherwise. Control streams are always
+   * sent before any other stream.
+   */
+  virtual folly::Expected<folly::Unit, LocalErrorCode> setStreamPriority(
+      StreamId id,
+      PriorityUrgency urgency,
+      bool incremental) = 0;
+
+  /**
+   * Get the priority of a stream's data.
+   */
+  virtual folly::Expected<Priority, LocalErrorCode> getStreamPriority(
+      StreamId id) = 0;
+
+  /**
+   * Set whether the data of a stream may be sent in 0-RTT packets, which an
+   * attacker can replay to the server. Only streams carrying replay safe
+   * (e.g. idempotent) requests should allow it; the others wait for the
+   * handshake to complete. The default comes from
+   * TransportSettings::earlyDataAllowedByDefault. Data sent in 0-RTT that the
+   * server rejects is sent again in 1-RTT packets by the transport.
+   */
+  virtual folly::Expected<folly::Unit, LocalErrorCode> setStreamEarlyData(
+      StreamId id,
+      bool allowed) = 0;
+
   /**
    * Set congestion control type.
    */
   virtual void setCongestionControl(CongestionControlType type) = 0;
+
+  /**
+   * Cap the rate the connection is paced at, in bytes per second, e.g. at the
+   * bitrate of a video, so that data that was written ahead waits in the
+   * transport rather than in the queue of the bottleneck. folly::none lifts
+   * the cap. Pacing has to be enabled in the transport settings.
+   */
+  virtual folly::Expected<folly::Unit, LocalErrorCode> setMaxPacingRate(
+      folly::Optional<uint64_t> maxRateBytesPerSec) = 0;
 };
 } // namespace quic
@@ -9,6 +9,7 @@
 #include <quic/api/QuicTransportBase.h>
 
 #include <folly/ScopeGuard.h>
+#include <folly/portability/Unistd.h>
 #include <quic/api/LoopDetectorCallback.h>
 #include <quic/api/QuicTransportFunctions.h>
 #include <quic/common/TimeUtil.h>
@@ -19,6 +20,7 @@
 #include <quic/state/QuicStateFunctions.h>
 #include <quic/state/QuicStreamFunctions.h>
 #include <quic/state/QuicStreamUtilities.h>
+#include <quic/state/QuicTracepoints.h>
 #include <quic/state/SimpleFrameFunctions.h>
 #include <quic/state/stream/StreamSendHandlers.h>
 
@@ -33,24 +35,23 @@ QuicTransportBase::QuicTransportBase(
       ackTimeout_(this),
       pathValidationTimeout_(this),
       idleTimeout_(this),
+      idleCompactionTimeout_(this),
       drainTimeout_(this),
       pingTimeout_(this),
-      readLooper_(new FunctionLooper(
-          evb,
-          [this](bool /* ignored */) { invokeReadDataAndCallbacks(); },
-          LooperType::ReadLooper)),
-      peekLooper_(new FunctionLooper(
-          evb,
-          [this](bool /* ignored */) { invokePeekDataAndCallbacks(); },
-          LooperType::PeekLooper)),
+      corkTimeout_(this),
+      windowUpdateTimeout_(this),
       writeLooper_(new FunctionLooper(
           evb,
           [this](bool fromTimer) { pacedWriteDataToSocket(fromTimer); },
           LooperType::WriteLooper)) {
   writeLooper_->setPacingFunction([this]() -> auto {
     if (isConnectionPaced(*conn_)) {
-      conn_->pacer->onPacedWriteScheduled(Clock::now());
-      return conn_->pacer->getTimeUntilNextWrite();
+      auto now = Clock::now();
+      conn_->pacer->onPacedWriteScheduled(now);
+      auto interval = conn_->pacer->getTimeUntilNextWrite();
+      pacedWriteDueTime_ = now + interval;
+      pacedWriteInterval_ = interval;
+      return interval;
     }
     return 0us;
   });
@@ -59,16 +60,37 @@ QuicTransportBase::QuicTransportBase(
 void QuicTransportBase::setPacingTimer(
     TimerHighRes::SharedPtr pacingTimer) noexcept {
   if (pacingTimer) {
+    highResTimer_ = pacingTimer;
     writeLooper_->setPacingTimer(std::move(pacingTimer));
   }
 }
 
+void QuicTransportBase::setPacingScheduler(
+    PacingScheduler::SharedPtr pacingScheduler) noexcept {
+  if (pacingScheduler) {
+    writeLooper_->setPacingScheduler(std::move(pacingScheduler));
+  }
+}
+
+void QuicTransportBase::setReceiveBufferAccountant(
+    std::shared_ptr<ReceiveBufferAccountant> accountant) noexcept {
+  conn_->receiveBufferAccount =
+      ReceiveBufferAccountant::Account(std::move(accountant));
+}
+
 void QuicTransportBase::setCongestionControllerFactory(
     std::shared_ptr<CongestionControllerFactory> ccFactory) {
   CHECK(ccFactory);
   ccFactory_ = ccFactory;
 }
 
+void QuicTransportBase::setEncryptExecutor(
+    std::shared_ptr<folly::Executor> executor) {
+  conn_->parallelEncryptor = executor
+      ? std::make_unique<ParallelEncryptor>(std::move(executor))
+      : nullptr;
+}
+
 folly::EventBase* QuicTransportBase::getEventBase() const {
   return evb_.load();
 }
@@ -140,9 +162,25 @@ bool QuicTransportBase::error() const {
   return conn_->localConnectionError.has_value();
 }
 
+QuicTransportBase::ScopedGuard::ScopedGuard(QuicTransportBase& transport)
+    : transport_(transport) {
+  if (transport_.scopedGuardDepth_ == 0) {
+    transport_.scopedGuardSelf_ = transport_.sharedGuard();
+  }
+  ++transport_.scopedGuardDepth_;
+}
+
+QuicTransportBase::ScopedGuard::~ScopedGuard() {
+  if (--transport_.scopedGuardDepth_ == 0) {
+    // This may be the last reference, so the transport is not to be touched
+    // once it goes.
+    auto self = std::move(transport_.scopedGuardSelf_);
+  }
+}
+
 void QuicTransportBase::close(
     folly::Optional<std::pair<QuicErrorCode, std::string>> errorCode) {
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
   // The caller probably doesn't need a conn callback any more because they
   // explicitly called close.
   connCallback_ = nullptr;
@@ -161,7 +199,7 @@ void QuicTransportBase::close(
 void QuicTransportBase::closeNow(
     folly::Optional<std::pair<QuicErrorCode, std::string>> errorCode) {
   DCHECK(getEventBase() && getEventBase()->isInEventBaseThread());
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
   VLOG(4) << __func__ << " " << *this;
   if (!errorCode) {
     errorCode = std::make_pair(
@@ -186,7 +224,7 @@ void QuicTransportBase::closeGracefully() {
       closeState_ == CloseState::GRACEFUL_CLOSING) {
     return;
   }
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
   connCallback_ = nullptr;
   closeState_ = CloseState::GRACEFUL_CLOSING;
   updatePacingOnClose(*conn_);
@@ -203,8 +241,8 @@ void QuicTransportBase::closeGracefully() {
 
   // Stop reads and cancel all the app callbacks.
   VLOG(10) << "Stopping read and peek loopers due to graceful close " << *this;
-  readLooper_->stop();
-  peekLooper_->stop();
+  stopLooper(readLooper_);
+  stopLooper(peekLooper_);
   cancelAllAppCallbacks(std::make_pair(
       QuicErrorCode(LocalErrorCode::NO_ERROR), "Graceful Close"));
   // All streams are closed, close the transport for realz.
@@ -343,13 +381,22 @@ void QuicTransportBase::closeImpl(
   if (idleTimeout_.isScheduled()) {
     idleTimeout_.cancelTimeout();
   }
+  if (idleCompactionTimeout_.isScheduled()) {
+    idleCompactionTimeout_.cancelTimeout();
+  }
   if (pingTimeout_.isScheduled()) {
     pingTimeout_.cancelTimeout();
   }
+  if (corkTimeout_.isScheduled()) {
+    corkTimeout_.cancelTimeout();
+  }
+  if (windowUpdateTimeout_.isScheduled()) {
+    windowUpdateTimeout_.cancelTimeout();
+  }
 
   VLOG(10) << "Stopping read looper due to immediate close " << *this;
-  readLooper_->stop();
-  peekLooper_->stop();
+  stopLooper(readLooper_);
+  stopLooper(peekLooper_);
   writeLooper_->stop();
 
   // TODO: invoke connection close callbacks.
@@ -407,6 +454,14 @@ void QuicTransportBase::closeImpl(
   // can't invoke connection callbacks any more.
   connCallback_ = nullptr;
 
+  // Nor the files that are not read yet.
+  fileWrites_.clear();
+  writeDeadlineStreams_.clear();
+
+  // Don't need the datagrams either.
+  conn_->datagramState.readBuffer.clear();
+  conn_->datagramState.writeBuffer.clear();
+
   // Don't need outstanding packets.
   conn_->outstandingPackets.clear();
   conn_->outstandingHandshakePacketsCount = 0;
@@ -426,13 +481,13 @@ void QuicTransportBase::closeImpl(
     }
   }
   drainConnection = drainConnection && !isReset && !isAbandon;
-  if (drainConnection) {
+  auto drainPeriod = kDrainFactor * calculatePTO(*conn_);
+  if (drainConnection && !handOffDraining(drainPeriod)) {
     // We ever drain once, and the object ever gets created once.
     DCHECK(!drainTimeout_.isScheduled());
     getEventBase()->timer().scheduleTimeout(
         &drainTimeout_,
-        std::chrono::duration_cast<std::chrono::milliseconds>(
-            kDrainFactor * calculatePTO(*conn_)));
+        std::chrono::duration_cast<std::chrono::milliseconds>(drainPeriod));
   } else {
     drainTimeoutExpired();
   }
@@ -544,9 +599,51 @@ QuicSocket::TransportInfo QuicTransportBase::getTransportInfo() const {
   transportInfo.largestPacketAckedByPeer =
       conn_->ackStates.appDataAckState.largestAckedByPeer;
   transportInfo.largestPacketSent = conn_->lossState.largestSent;
+  transportInfo.handshakeTimings = conn_->handshakeTimings;
+  if (conn_->handshakeLayer) {
+    transportInfo.cipherSuite = conn_->handshakeLayer->getCipherSuite();
+  }
+  transportInfo.memoryUsage = getConnectionMemoryUsage(*conn_);
   return transportInfo;
 }
 
+folly::Optional<Bandwidth> QuicTransportBase::getBandwidthEstimate() const {
+  if (!conn_->congestionController) {
+    return folly::none;
+  }
+  auto bandwidth = conn_->congestionController->getBandwidth();
+  if (bandwidth) {
+    return bandwidth;
+  }
+  if (conn_->lossState.srtt == 0us) {
+    return folly::none;
+  }
+  return Bandwidth(
+      conn_->congestionController->getCongestionWindow(),
+      conn_->lossState.srtt);
+}
+
+folly::Optional<std::chrono::microseconds>
+QuicTransportBase::estimateTimeToSend(uint64_t bytes) const {
+  auto bandwidth = getBandwidthEstimate();
+  if (!bandwidth || !*bandwidth) {
+    return folly::none;
+  }
+  // Go through double so that large writes don't overflow.
+  return std::chrono::microseconds(static_cast<uint64_t>(std::ceil(
+      static_cast<double>(bytes) * bandwidth->interval.count() /
+      bandwidth->units)));
+}
+
+void QuicTransportBase::setBandwidthEstimateCallback(
+    BandwidthEstimateCallback* cb,
+    float changeThreshold) {
+  CHECK_GE(changeThreshold, 0.0f);
+  bandwidthEstimateCallback_ = cb;
+  bandwidthEstimateChangeThreshold_ = changeThreshold;
+  lastReportedBandwidthEstimate_.clear();
+}
+
 folly::Optional<std::string> QuicTransportBase::getAppProtocol() const {
   return conn_->handshakeLayer->getApplicationProtocol();
 }
@@ -676,7 +773,12 @@ QuicTransportBase::setReadCallbackInternal(
     if (!cb) {
       return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
     }
-    readCbIt = readCallbacks_.emplace(id, ReadCallbackData(cb)).first;
+    readCbIt = readCallbacks_
+                   .emplace(
+                       id,
+                       ReadCallbackData(
+                           cb, conn_->streamManager->getStream(id)))
+                   .first;
   }
   auto& readCb = readCbIt->second.readCb;
   if (readCb == nullptr && cb != nullptr) {
@@ -685,6 +787,7 @@ QuicTransportBase::setReadCallbackInternal(
   } else {
     readCb = cb;
     if (readCb == nullptr) {
+      maybeReleaseClosedStream(id);
       return stopSending(id, GenericApplicationErrorCode::NO_ERROR);
     }
   }
@@ -744,28 +847,52 @@ QuicTransportBase::pauseOrResumeRead(StreamId id, bool resume) {
 }
 
 void QuicTransportBase::invokeReadDataAndCallbacks() {
-  auto self = sharedGuard();
+  ScopedGuard self(*this);
+  CpuTimeScope cpuTimeScope(
+      self->conn_->cpuTime,
+      self->conn_->transportSettings.trackCpuTime,
+      CpuTimeCategory::CALLBACKS);
   SCOPE_EXIT {
     self->checkForClosedStream();
     self->updateReadLooper();
     self->updateWriteLooper(true);
   };
-  // Need a copy since the set can change during callbacks.
-  std::vector<StreamId> readableStreamsCopy;
+  // Need a copy since the set can change during callbacks. It's taken out of
+  // the member for the duration, in case a callback gets back in here.
+  auto readableStreamsCopy = std::move(self->readableStreamsScratch_);
   const auto& readableStreams = self->conn_->streamManager->readableStreams();
-  readableStreamsCopy.reserve(readableStreams.size());
-  std::copy(
-      readableStreams.begin(),
-      readableStreams.end(),
-      std::back_inserter(readableStreamsCopy));
+  readableStreamsCopy.assign(readableStreams.begin(), readableStreams.end());
+  if (self->nextReadableStream_) {
+    // Picks up where the budget ran out the last time.
+    auto next = std::find(
+        readableStreamsCopy.begin(),
+        readableStreamsCopy.end(),
+        *self->nextReadableStream_);
+    std::rotate(readableStreamsCopy.begin(), next, readableStreamsCopy.end());
+    self->nextReadableStream_ = folly::none;
+  }
+  folly::Optional<TimePoint> deadline;
+  if (self->conn_->transportSettings.loopWorkBudget.count() > 0) {
+    deadline = Clock::now() + self->conn_->transportSettings.loopWorkBudget;
+  }
+  bool invoked = false;
+  auto batchedReadable = std::move(self->batchedReadableScratch_);
+  batchedReadable.clear();
   for (StreamId streamId : readableStreamsCopy) {
+    if (invoked && deadline && Clock::now() >= *deadline) {
+      // The rest go in the next loop, the read looper is still running.
+      VLOG(10) << "Read callbacks out of budget at stream=" << streamId << " "
+               << *this;
+      self->nextReadableStream_ = streamId;
+      break;
+    }
     auto callback = self->readCallbacks_.find(streamId);
     if (callback == self->readCallbacks_.end()) {
       self->conn_->streamManager->readableStreams().erase(streamId);
       continue;
     }
     auto readCb = callback->second.readCb;
-    auto stream = conn_->streamManager->getStream(streamId);
+    auto stream = callback->second.stream;
     if (readCb && stream->streamReadError) {
       self->conn_->streamManager->readableStreams().erase(streamId);
       readCallbacks_.erase(callback);
@@ -773,23 +900,44 @@ void QuicTransportBase::invokeReadDataAndCallbacks() {
       // we cannot peek into it as well.
       self->conn_->streamManager->peekableStreams().erase(streamId);
       peekCallbacks_.erase(streamId);
+      self->maybeReleaseClosedStream(streamId);
       VLOG(10) << "invoking read error callbacks on stream=" << streamId << " "
                << *this;
       readCb->readError(
           streamId, std::make_pair(*stream->streamReadError, folly::none));
+      invoked = true;
     } else if (
         readCb && callback->second.resumed && stream->hasReadableData()) {
+      if (batchedStreamCallback_) {
+        batchedReadable.push_back(streamId);
+        continue;
+      }
       VLOG(10) << "invoking read callbacks on stream=" << streamId << " "
                << *this;
       readCb->readAvailable(streamId);
+      invoked = true;
     }
   }
+  if (!batchedReadable.empty() && closeState_ == CloseState::OPEN &&
+      batchedStreamCallback_) {
+    VLOG(10) << "invoking batched read callback on "
+             << batchedReadable.size() << " streams " << *this;
+    batchedStreamCallback_->onStreamsReadable(batchedReadable);
+  }
+  self->readableStreamsScratch_ = std::move(readableStreamsCopy);
+  self->batchedReadableScratch_ = std::move(batchedReadable);
+}
+
+void QuicTransportBase::stopLooper(FunctionLooper::Ptr& looper) {
+  if (looper) {
+    looper->stop();
+  }
 }
 
 void QuicTransportBase::updateReadLooper() {
   if (closeState_ != CloseState::OPEN) {
     VLOG(10) << "Stopping read looper " << *this;
-    readLooper_->stop();
+    stopLooper(readLooper_);
     return;
   }
   auto iter = std::find_if(
@@ -806,10 +954,16 @@ void QuicTransportBase::updateReadLooper() {
       });
   if (iter != conn_->streamManager->readableStreams().end()) {
     VLOG(10) << "Scheduling read looper " << *this;
+    if (!readLooper_) {
+      readLooper_.reset(new FunctionLooper(
+          getEventBase(),
+          [this](bool /* ignored */) { invokeReadDataAndCallbacks(); },
+          LooperType::ReadLooper));
+    }
     readLooper_->run();
   } else {
     VLOG(10) << "Stopping read looper " << *this;
-    readLooper_->stop();
+    stopLooper(readLooper_);
   }
 }
 
@@ -838,11 +992,17 @@ QuicTransportBase::setPeekCallbackInternal(
     if (!cb) {
       return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
     }
-    peekCbIt = peekCallbacks_.emplace(id, PeekCallbackData(cb)).first;
+    peekCbIt = peekCallbacks_
+                   .emplace(
+                       id,
+                       PeekCallbackData(
+                           cb, conn_->streamManager->getStream(id)))
+                   .first;
   }
   if (!cb) {
     VLOG(10) << "Resetting the peek callback to nullptr "
              << "stream=" << id << " peekCb=" << peekCbIt->second.peekCb;
+    maybeReleaseClosedStream(id);
   }
   peekCbIt->second.peekCb = cb;
   updatePeekLooper();
@@ -881,7 +1041,11 @@ QuicTransportBase::pauseOrResumePeek(StreamId id, bool resume) {
 }
 
 void QuicTransportBase::invokePeekDataAndCallbacks() {
-  auto self = sharedGuard();
+  ScopedGuard self(*this);
+  CpuTimeScope cpuTimeScope(
+      self->conn_->cpuTime,
+      self->conn_->transportSettings.trackCpuTime,
+      CpuTimeCategory::CALLBACKS);
   SCOPE_EXIT {
     self->checkForClosedStream();
     self->updatePeekLooper();
@@ -892,13 +1056,9 @@ void QuicTransportBase::invokePeekDataAndCallbacks() {
   // is called and decremented when peek is done. once counter transitions
   // to 0 we can execute "consume" calls that were done during "peek", for that,
   // we would need to keep stack of them.
-  std::vector<StreamId> peekableStreamsCopy;
+  auto peekableStreamsCopy = std::move(self->peekableStreamsScratch_);
   const auto& peekableStreams = self->conn_->streamManager->peekableStreams();
-  peekableStreamsCopy.reserve(peekableStreams.size());
-  std::copy(
-      peekableStreams.begin(),
-      peekableStreams.end(),
-      std::back_inserter(peekableStreamsCopy));
+  peekableStreamsCopy.assign(peekableStreams.begin(), peekableStreams.end());
   VLOG(10) << __func__
            << " peekableListCopy.size()=" << peekableStreamsCopy.size();
   for (StreamId streamId : peekableStreamsCopy) {
@@ -914,7 +1074,7 @@ void QuicTransportBase::invokePeekDataAndCallbacks() {
       continue;
     }
     auto peekCb = callback->second.peekCb;
-    auto stream = conn_->streamManager->getStream(streamId);
+    auto stream = callback->second.stream;
     if (peekCb && !stream->streamReadError && stream->hasPeekableData()) {
       VLOG(10) << "invoking peek callbacks on stream=" << streamId << " "
                << *this;
@@ -928,6 +1088,7 @@ void QuicTransportBase::invokePeekDataAndCallbacks() {
       VLOG(10) << "Not invoking peek callbacks on stream=" << streamId;
     }
   }
+  self->peekableStreamsScratch_ = std::move(peekableStreamsCopy);
 }
 
 folly::Expected<folly::Unit, LocalErrorCode>
@@ -968,7 +1129,7 @@ QuicTransportBase::setDataExpiredCallback(
 }
 
 void QuicTransportBase::invokeDataExpiredCallbacks() {
-  auto self = sharedGuard();
+  ScopedGuard self(*this);
   if (closeState_ != CloseState::OPEN) {
     return;
   }
@@ -1021,6 +1182,54 @@ QuicTransportBase::sendDataExpired(StreamId id, uint64_t offset) {
   return folly::makeExpected<LocalErrorCode>(newOffset);
 }
 
+folly::Expected<folly::Unit, LocalErrorCode>
+QuicTransportBase::setStreamWriteTimeToLive(
+    StreamId id,
+    folly::Optional<std::chrono::milliseconds> ttl) {
+  if (!conn_->partialReliabilityEnabled) {
+    return folly::makeUnexpected(LocalErrorCode::APP_ERROR);
+  }
+  if (isReceivingStream(conn_->nodeType, id)) {
+    return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
+  }
+  if (closeState_ != CloseState::OPEN) {
+    return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
+  }
+  if (!conn_->streamManager->streamExists(id)) {
+    return folly::makeUnexpected(LocalErrorCode::STREAM_NOT_EXISTS);
+  }
+  auto stream = conn_->streamManager->getStream(id);
+  stream->writeTimeToLive = ttl;
+  if (ttl) {
+    writeDeadlineStreams_.insert(id);
+  }
+  return folly::unit;
+}
+
+void QuicTransportBase::expireStreamData() {
+  // Canceling the delivery callbacks may change the set.
+  std::vector<StreamId> streamIds(
+      writeDeadlineStreams_.begin(), writeDeadlineStreams_.end());
+  auto now = Clock::now();
+  for (auto id : streamIds) {
+    auto stream = conn_->streamManager->findStream(id);
+    if (!stream ||
+        (!stream->writeTimeToLive && stream->writeDeadlines.empty())) {
+      writeDeadlineStreams_.erase(id);
+      continue;
+    }
+    auto newOffset = expireStreamDataPastDeadline(stream, now);
+    if (newOffset) {
+      VLOG(10) << "Expired data before offset=" << *newOffset
+               << " on stream=" << id << " " << *this;
+      cancelDeliveryCallbacksForStream(id, *newOffset);
+      if (closeState_ != CloseState::OPEN) {
+        return;
+      }
+    }
+  }
+}
+
 folly::Expected<folly::Unit, LocalErrorCode>
 QuicTransportBase::setDataRejectedCallback(
     StreamId id,
@@ -1059,7 +1268,7 @@ QuicTransportBase::setDataRejectedCallback(
 }
 
 void QuicTransportBase::invokeDataRejectedCallbacks() {
-  auto self = sharedGuard();
+  ScopedGuard self(*this);
   if (closeState_ != CloseState::OPEN) {
     return;
   }
@@ -1114,7 +1323,7 @@ QuicTransportBase::sendDataRejected(StreamId id, uint64_t offset) {
 void QuicTransportBase::updatePeekLooper() {
   if (peekCallbacks_.empty() || closeState_ != CloseState::OPEN) {
     VLOG(10) << "Stopping peek looper " << *this;
-    peekLooper_->stop();
+    stopLooper(peekLooper_);
     return;
   }
   VLOG(10) << "Updating peek looper, has "
@@ -1141,11 +1350,25 @@ void QuicTransportBase::updatePeekLooper() {
       });
   if (iter != conn_->streamManager->peekableStreams().end()) {
     VLOG(10) << "Scheduling peek looper " << *this;
+    if (!peekLooper_) {
+      peekLooper_.reset(new FunctionLooper(
+          getEventBase(),
+          [this](bool /* ignored */) { invokePeekDataAndCallbacks(); },
+          LooperType::PeekLooper));
+    }
     peekLooper_->run();
   } else {
     VLOG(10) << "Stopping peek looper " << *this;
-    peekLooper_->stop();
+    stopLooper(peekLooper_);
+  }
+}
+
+void QuicTransportBase::updateWriteLooperForNewWork() {
+  if (closeState_ == CloseState::OPEN && !corked_ &&
+      writeLooper_->isRunning()) {
+    return;
   }
+  updateWriteLooper(true);
 }
 
 void QuicTransportBase::updateWriteLooper(bool thisIteration) {
@@ -1155,9 +1378,65 @@ void QuicTransportBase::updateWriteLooper(bool thisIteration) {
     writeLooper_->stop();
     return;
   }
+  if (closeState_ == CloseState::OPEN && !fileWrites_.empty()) {
+    fillFileWrites();
+  }
+  if (closeState_ == CloseState::OPEN && !writeDeadlineStreams_.empty()) {
+    expireStreamData();
+  }
   // TODO: Also listens to write event from libevent. Only schedule write when
   // the socket itself is writable.
   auto writeDataReason = shouldWriteData(*conn_);
+  if (congestionControlWritableBytes(*conn_) == 0) {
+    if (!conn_->cwndBlockedTime) {
+      conn_->cwndBlockedTime = Clock::now();
+    }
+  } else if (conn_->cwndBlockedTime) {
+    auto cwndBlockedTime =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - *conn_->cwndBlockedTime);
+    conn_->totalCwndBlockedTime += cwndBlockedTime;
+    QUIC_STATS(conn_->statsCallback, onCwndBlockedDuration, cwndBlockedTime);
+    conn_->cwndBlockedTime = folly::none;
+  }
+  // Stream data is checked for before the frames that come after it, which
+  // are not held back.
+  bool onlyStreamData = writeDataReason == WriteDataReason::STREAM &&
+      conn_->pendingEvents.frames.empty() &&
+      !conn_->pendingEvents.pathChallenge &&
+      conn_->datagramState.writeBuffer.empty() &&
+      !conn_->streamManager->hasWindowUpdates() &&
+      !conn_->pendingEvents.connWindowUpdate;
+  if (onlyStreamData && corked_ && !flushCork_ &&
+      conn_->flowControlState.sumCurStreamBufferLen < conn_->udpSendPacketLen) {
+    // Wait for more to fill the packet, but not for longer than maxCorkDelay.
+    if (!corkTimeout_.isScheduled()) {
+      getEventBase()->timer().scheduleTimeout(
+          &corkTimeout_, conn_->transportSettings.maxCorkDelay);
+    }
+    writeDataReason = WriteDataReason::NO_WRITE;
+  }
+  // Flow control updates are checked for last, so these reasons mean there is
+  // nothing else to write.
+  bool onlyWindowUpdates =
+      writeDataReason == WriteDataReason::STREAM_WINDOW_UPDATE ||
+      writeDataReason == WriteDataReason::CONN_WINDOW_UPDATE;
+  if (onlyWindowUpdates && !flushWindowUpdates_ &&
+      conn_->transportSettings.maxWindowUpdateDelay.count() > 0) {
+    // Wait for an ack or data to carry them, but not for longer than
+    // maxWindowUpdateDelay.
+    if (!windowUpdateTimeout_.isScheduled()) {
+      getEventBase()->timer().scheduleTimeout(
+          &windowUpdateTimeout_, conn_->transportSettings.maxWindowUpdateDelay);
+    }
+    writeDataReason = WriteDataReason::NO_WRITE;
+  } else if (
+      windowUpdateTimeout_.isScheduled() &&
+      !conn_->streamManager->hasWindowUpdates() &&
+      !conn_->pendingEvents.connWindowUpdate) {
+    // Went out with something else.
+    windowUpdateTimeout_.cancelTimeout();
+  }
   if (writeDataReason != WriteDataReason::NO_WRITE) {
     VLOG(10) << nodeToString(conn_->nodeType)
              << " running write looper thisIteration=" << thisIteration << " "
@@ -1202,6 +1481,7 @@ void QuicTransportBase::cancelDeliveryCallbacksForStream(StreamId streamId) {
     }
   }
   deliveryCallbacks_.erase(deliveryCallbackIter);
+  maybeReleaseClosedStream(streamId);
 }
 
 void QuicTransportBase::cancelDeliveryCallbacksForStream(
@@ -1241,19 +1521,37 @@ void QuicTransportBase::cancelDeliveryCallbacksForStream(
   if (deliveryCallbackIter->second.empty()) {
     conn_->streamManager->removeDeliverable(streamId);
     deliveryCallbacks_.erase(deliveryCallbackIter);
+    maybeReleaseClosedStream(streamId);
   }
 }
 
 folly::Expected<std::pair<Buf, bool>, LocalErrorCode> QuicTransportBase::read(
     StreamId id,
     size_t maxLen) {
+  return readImpl<Buf>(id, [maxLen](QuicStreamState& stream) {
+    return readDataFromQuicStream(stream, maxLen);
+  });
+}
+
+folly::Expected<std::pair<std::vector<Buf>, bool>, LocalErrorCode>
+QuicTransportBase::readSlices(StreamId id, size_t maxLen) {
+  return readImpl<std::vector<Buf>>(id, [maxLen](QuicStreamState& stream) {
+    return readSlicesFromQuicStream(stream, maxLen);
+  });
+}
+
+template <typename Data>
+folly::Expected<std::pair<Data, bool>, LocalErrorCode>
+QuicTransportBase::readImpl(
+    StreamId id,
+    folly::FunctionRef<std::pair<Data, bool>(QuicStreamState&)> readFn) {
   if (isSendingStream(conn_->nodeType, id)) {
     return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
   }
   if (closeState_ != CloseState::OPEN) {
     return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
   }
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
   SCOPE_EXIT {
     updateReadLooper();
     updatePeekLooper(); // read can affect "peek" API
@@ -1264,7 +1562,11 @@ folly::Expected<std::pair<Buf, bool>, LocalErrorCode> QuicTransportBase::read(
       return folly::makeUnexpected(LocalErrorCode::STREAM_NOT_EXISTS);
     }
     auto stream = conn_->streamManager->getStream(id);
-    auto result = readDataFromQuicStream(*stream, maxLen);
+    if (stream->appReadBuffer) {
+      // The data goes to the buffer of the application.
+      return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
+    }
+    auto result = readFn(*stream);
     if (result.second) {
       VLOG(10) << "Delivered eof to app for stream=" << stream->id << " "
                << *this;
@@ -1274,6 +1576,7 @@ folly::Expected<std::pair<Buf, bool>, LocalErrorCode> QuicTransportBase::read(
         // callback so we don't deal with the case of someone installing a read
         // callback after reading the EOM.
         it->second.deliveredEOM = true;
+        maybeReleaseClosedStream(id);
       }
     }
     return folly::makeExpected<LocalErrorCode>(std::move(result));
@@ -1299,6 +1602,69 @@ folly::Expected<std::pair<Buf, bool>, LocalErrorCode> QuicTransportBase::read(
   }
 }
 
+folly::Expected<folly::Unit, LocalErrorCode> QuicTransportBase::setReadBuffer(
+    StreamId id,
+    folly::MutableByteRange buffer) {
+  if (isSendingStream(conn_->nodeType, id)) {
+    return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
+  }
+  if (closeState_ != CloseState::OPEN) {
+    return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
+  }
+  if (buffer.empty()) {
+    return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
+  }
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
+  SCOPE_EXIT {
+    updateReadLooper();
+    updatePeekLooper();
+    updateWriteLooper(true);
+  };
+  if (!conn_->streamManager->streamExists(id)) {
+    return folly::makeUnexpected(LocalErrorCode::STREAM_NOT_EXISTS);
+  }
+  auto stream = conn_->streamManager->getStream(id);
+  if (stream->appReadBuffer) {
+    return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
+  }
+  stream->appReadBuffer = QuicStreamState::AppReadBuffer{buffer};
+  fillAppReadBuffer(*stream);
+  return folly::unit;
+}
+
+folly::Expected<std::pair<size_t, bool>, LocalErrorCode>
+QuicTransportBase::takeReadBuffer(StreamId id) {
+  if (isSendingStream(conn_->nodeType, id)) {
+    return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
+  }
+  if (closeState_ != CloseState::OPEN) {
+    return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
+  }
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
+  SCOPE_EXIT {
+    updateReadLooper();
+    updatePeekLooper();
+  };
+  if (!conn_->streamManager->streamExists(id)) {
+    return folly::makeUnexpected(LocalErrorCode::STREAM_NOT_EXISTS);
+  }
+  auto stream = conn_->streamManager->getStream(id);
+  if (!stream->appReadBuffer) {
+    return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
+  }
+  auto result = takeAppReadBuffer(*stream);
+  if (result.second) {
+    VLOG(10) << "Delivered eof to app for stream=" << stream->id << " "
+             << *this;
+    auto it = readCallbacks_.find(id);
+    if (it != readCallbacks_.end()) {
+      it->second.deliveredEOM = true;
+      maybeReleaseClosedStream(id);
+    }
+  }
+  return result;
+}
+
 folly::Expected<folly::Unit, LocalErrorCode> QuicTransportBase::peek(
     StreamId id,
     const folly::Function<void(StreamId id, const folly::Range<PeekIterator>&)
@@ -1306,7 +1672,7 @@ folly::Expected<folly::Unit, LocalErrorCode> QuicTransportBase::peek(
   if (closeState_ != CloseState::OPEN) {
     return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
   }
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
   SCOPE_EXIT {
     updatePeekLooper();
     updateWriteLooper(true);
@@ -1353,7 +1719,7 @@ folly::
     return folly::makeUnexpected(
         ConsumeError{LocalErrorCode::CONNECTION_CLOSED, folly::none});
   }
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
   SCOPE_EXIT {
     updatePeekLooper();
     updateReadLooper(); // consume may affect "read" API
@@ -1428,10 +1794,42 @@ void QuicTransportBase::handlePingCallback() {
   conn_->pendingEvents.cancelPingTimeout = false;
 }
 
+void QuicTransportBase::handleBandwidthEstimateCallback() {
+  if (!bandwidthEstimateCallback_) {
+    return;
+  }
+  auto estimate = getBandwidthEstimate();
+  if (!estimate || !*estimate) {
+    return;
+  }
+  if (lastReportedBandwidthEstimate_) {
+    auto lastRate = lastReportedBandwidthEstimate_->normalize();
+    auto rate = estimate->normalize();
+    auto change = rate > lastRate ? rate - lastRate : lastRate - rate;
+    if (change <= lastRate * bandwidthEstimateChangeThreshold_) {
+      return;
+    }
+  }
+  lastReportedBandwidthEstimate_ = estimate;
+  bandwidthEstimateCallback_->onBandwidthEstimateChanged(*estimate);
+}
+
+void QuicTransportBase::handleDatagramCallback() {
+  // Like readAvailable, this keeps firing as long as datagrams are buffered.
+  if (!datagramCallback_ || conn_->datagramState.readBuffer.empty()) {
+    return;
+  }
+  datagramCallback_->onDatagramsAvailable();
+}
+
 void QuicTransportBase::processCallbacksAfterNetworkData() {
   if (closeState_ != CloseState::OPEN) {
     return;
   }
+  CpuTimeScope cpuTimeScope(
+      conn_->cpuTime,
+      conn_->transportSettings.trackCpuTime,
+      CpuTimeCategory::CALLBACKS);
   // TODO move all of this callback processing to individual functions.
   for (const auto& stream : conn_->streamManager->newPeerStreams()) {
     CHECK_NOTNULL(connCallback_);
@@ -1449,6 +1847,16 @@ void QuicTransportBase::processCallbacksAfterNetworkData() {
   // Handle pingCallbacks
   handlePingCallback();
 
+  handleBandwidthEstimateCallback();
+  if (closeState_ != CloseState::OPEN) {
+    return;
+  }
+
+  handleDatagramCallback();
+  if (closeState_ != CloseState::OPEN) {
+    return;
+  }
+
   // TODO: we're currently assuming that canceling write callbacks will not
   // cause reset of random streams. Maybe get rid of that assumption later.
   for (auto pendingResetIt = conn_->pendingEvents.resets.begin();
@@ -1457,39 +1865,58 @@ void QuicTransportBase::processCallbacksAfterNetworkData() {
        pendingResetIt++) {
     cancelDeliveryCallbacksForStream(pendingResetIt->first);
   }
+  std::vector<BatchedStreamCallback::DeliveryAck> batchedDeliveryAcks;
+  DeliveryCallbackQueue delivered;
   auto deliverableStreamId = conn_->streamManager->popDeliverable();
   while (closeState_ == CloseState::OPEN && deliverableStreamId.has_value()) {
     auto streamId = *deliverableStreamId;
+    deliverableStreamId = conn_->streamManager->popDeliverable();
+    auto deliveryCallbacksForAckedStream = deliveryCallbacks_.find(streamId);
+    if (deliveryCallbacksForAckedStream == deliveryCallbacks_.end()) {
+      continue;
+    }
     auto stream = conn_->streamManager->getStream(streamId);
     auto minOffsetToDeliver = getStreamNextOffsetToDeliver(*stream);
 
-    while (closeState_ == CloseState::OPEN) {
-      auto deliveryCallbacksForAckedStream = deliveryCallbacks_.find(streamId);
-      if (deliveryCallbacksForAckedStream == deliveryCallbacks_.end() ||
-          deliveryCallbacksForAckedStream->second.empty()) {
-        break;
-      }
-      if (deliveryCallbacksForAckedStream->second.front().first >
-          minOffsetToDeliver) {
-        break;
-      }
-      auto deliveryCallbackAndOffset =
-          deliveryCallbacksForAckedStream->second.front();
-      deliveryCallbacksForAckedStream->second.pop_front();
+    // Take the delivered callbacks off first, with one lookup, since the
+    // callbacks may change the map. The cost is then that of the callbacks
+    // fired, not of the ones still outstanding.
+    auto& callbacks = deliveryCallbacksForAckedStream->second;
+    delivered.clear();
+    while (!callbacks.empty() &&
+           callbacks.front().first <= minOffsetToDeliver) {
+      delivered.push_back(callbacks.front());
+      callbacks.pop_front();
+    }
+    if (callbacks.empty()) {
+      deliveryCallbacks_.erase(deliveryCallbacksForAckedStream);
+      maybeReleaseClosedStream(streamId);
+    }
+
+    for (const auto& deliveryCallbackAndOffset : delivered) {
       auto currentDeliveryCallbackOffset = deliveryCallbackAndOffset.first;
       auto deliveryCallback = deliveryCallbackAndOffset.second;
+      if (closeState_ != CloseState::OPEN) {
+        // Closing cancelled the ones still in the map, these are no longer
+        // there.
+        deliveryCallback->onCanceled(streamId, currentDeliveryCallbackOffset);
+        continue;
+      }
+      if (batchedStreamCallback_) {
+        batchedDeliveryAcks.push_back(
+            {streamId, currentDeliveryCallbackOffset, deliveryCallback});
+        continue;
+      }
       deliveryCallback->onDeliveryAck(
           streamId, currentDeliveryCallbackOffset, conn_->lossState.srtt);
     }
+  }
+  if (!batchedDeliveryAcks.empty() && closeState_ == CloseState::OPEN) {
+    batchedStreamCallback_->onDeliveryAcks(
+        batchedDeliveryAcks, conn_->lossState.srtt);
     if (closeState_ != CloseState::OPEN) {
-      break;
-    }
-    auto deliveryCallbacksForAckedStream = deliveryCallbacks_.find(streamId);
-    if (deliveryCallbacksForAckedStream != deliveryCallbacks_.end() &&
-        deliveryCallbacksForAckedStream->second.empty()) {
-      deliveryCallbacks_.erase(deliveryCallbacksForAckedStream);
+      return;
     }
-    deliverableStreamId = conn_->streamManager->popDeliverable();
   }
 
   invokeDataExpiredCallbacks();
@@ -1531,6 +1958,10 @@ void QuicTransportBase::processCallbacksAfterNetworkData() {
     conn_->streamManager->clearStopSending();
   }
 
+  invokeWriteReadyCallbacks();
+}
+
+void QuicTransportBase::invokeWriteReadyCallbacks() {
   auto maxConnWrite = maxWritableOnConn();
   // We don't need onConnectionWriteReady notifications when we are closed.
   if (closeState_ == CloseState::OPEN && maxConnWrite != 0) {
@@ -1569,10 +2000,25 @@ void QuicTransportBase::processCallbacksAfterNetworkData() {
   }
 }
 
+void QuicTransportBase::writeAcksDuringRead() {
+  if (closeState_ != CloseState::OPEN || (corked_ && !flushCork_) ||
+      !hasAckDataToWrite(*conn_)) {
+    return;
+  }
+  // As onNetworkData() does before it writes after the read.
+  updateOneRttKeys(*conn_);
+  conn_->receivedNewPacketBeforeWrite = true;
+  writeSocketData();
+}
+
 void QuicTransportBase::onNetworkData(
     const folly::SocketAddress& peer,
     NetworkData&& networkData) noexcept {
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
+  CpuTimeScope cpuTimeScope(
+      conn_->cpuTime,
+      conn_->transportSettings.trackCpuTime,
+      CpuTimeCategory::READ);
   SCOPE_EXIT {
     checkForClosedStream();
     updateReadLooper();
@@ -1582,13 +2028,42 @@ void QuicTransportBase::onNetworkData(
   try {
     conn_->lossState.totalBytesRecvd += networkData.totalData;
     auto originalAckVersion = currentAckStateVersion(*conn_);
-    for (auto& packet : networkData.packets) {
+    const auto& settings = conn_->transportSettings;
+    bool timedRead = settings.readTimeBeforeWrite.count() > 0;
+    bool budgetedRead = settings.readPacketsBeforeWrite > 0 || timedRead;
+    uint32_t packetsSinceWrite = 0;
+    TimePoint lastWriteTime = timedRead ? Clock::now() : TimePoint();
+    for (size_t i = 0; i < networkData.packets.size(); ++i) {
+      QUIC_TRACEPOINT(
+          packet_recv,
+          *conn_,
+          networkData.packets[i]->computeChainDataLength());
       onReadData(
           peer,
-          NetworkDataSingle(std::move(packet), networkData.receiveTimePoint));
+          NetworkDataSingle(
+              std::move(networkData.packets[i]),
+              networkData.getReceiveTimePoint(i),
+              networkData.getEcnCodepoint(i)));
+      if (!budgetedRead || i + 1 == networkData.packets.size()) {
+        continue;
+      }
+      ++packetsSinceWrite;
+      if ((settings.readPacketsBeforeWrite > 0 &&
+           packetsSinceWrite >= settings.readPacketsBeforeWrite) ||
+          (timedRead &&
+           Clock::now() - lastWriteTime >= settings.readTimeBeforeWrite)) {
+        packetsSinceWrite = 0;
+        writeAcksDuringRead();
+        if (timedRead) {
+          lastWriteTime = Clock::now();
+        }
+      }
     }
     processCallbacksAfterNetworkData();
     if (closeState_ != CloseState::CLOSED) {
+      // Before writing, so that what we write answers a key update the peer
+      // started.
+      updateOneRttKeys(*conn_);
       if (currentAckStateVersion(*conn_) != originalAckVersion) {
         setIdleTimer();
         conn_->receivedNewPacketBeforeWrite = true;
@@ -1611,6 +2086,7 @@ void QuicTransportBase::onNetworkData(
       // Received data could contain valid path response, in which case
       // path validation timeout should be canceled
       schedulePathValidationTimeout();
+      updateHotLoopState(networkData.totalData);
     } else {
       // In the closed state, we would want to write a close if possible however
       // the write looper will not be set.
@@ -1644,13 +2120,27 @@ void QuicTransportBase::setIdleTimer() {
   if (closeState_ == CloseState::CLOSED) {
     return;
   }
+  auto idleTimeout = conn_->transportSettings.idleTimeout;
+  lastIdleActivity_ = Clock::now();
+  auto compactionTimeout = conn_->transportSettings.idleCompactionTimeout;
+  if (compactionTimeout > std::chrono::milliseconds::zero() &&
+      !idleCompactionTimeout_.isScheduled()) {
+    getEventBase()->timer().scheduleTimeout(
+        &idleCompactionTimeout_, compactionTimeout);
+  }
+  if (conn_->transportSettings.lazyIdleTimer && idleTimeout_.isScheduled() &&
+      idleTimeout > std::chrono::milliseconds::zero() &&
+      lastIdleActivity_ + idleTimeout >= idleTimerDeadline_) {
+    // The timer fires no later than the new deadline, and then waits for the
+    // rest.
+    return;
+  }
   if (idleTimeout_.isScheduled()) {
     idleTimeout_.cancelTimeout();
   }
-  if (conn_->transportSettings.idleTimeout >
-      std::chrono::milliseconds::zero()) {
-    getEventBase()->timer().scheduleTimeout(
-        &idleTimeout_, conn_->transportSettings.idleTimeout);
+  if (idleTimeout > std::chrono::milliseconds::zero()) {
+    idleTimerDeadline_ = lastIdleActivity_ + idleTimeout;
+    getEventBase()->timer().scheduleTimeout(&idleTimeout_, idleTimeout);
   }
 }
 
@@ -1808,13 +2298,36 @@ uint64_t QuicTransportBase::maxWritableOnStream(const QuicStreamState& stream) {
   auto streamFlowControlBytes = getSendStreamFlowControlBytesAPI(stream);
   auto flowControlAllowedBytes =
       std::min(streamFlowControlBytes, connWritableBytes);
+  auto watermark = notSentLowWatermark();
+  if (watermark != 0) {
+    auto unsent = stream.writeBuffer.chainLength();
+    flowControlAllowedBytes = std::min(
+        flowControlAllowedBytes, unsent < watermark ? watermark - unsent : 0);
+  }
   return flowControlAllowedBytes;
 }
 
 uint64_t QuicTransportBase::maxWritableOnConn() {
   auto connWritableBytes = getSendConnFlowControlBytesAPI(*conn_);
   auto availableBufferSpace = bufferSpaceAvailable();
-  return std::min(connWritableBytes, availableBufferSpace);
+  auto maxWritable = std::min(connWritableBytes, availableBufferSpace);
+  auto watermark = notSentLowWatermark();
+  if (watermark != 0) {
+    auto unsent = conn_->flowControlState.sumCurStreamBufferLen;
+    maxWritable =
+        std::min(maxWritable, unsent < watermark ? watermark - unsent : 0);
+  }
+  return maxWritable;
+}
+
+uint64_t QuicTransportBase::notSentLowWatermark() const {
+  auto watermark = conn_->transportSettings.notSentLowWatermark;
+  if (conn_->transportSettings.autoNotSentLowWatermark &&
+      conn_->congestionController) {
+    watermark = std::max(
+        watermark, conn_->congestionController->getCongestionWindow());
+  }
+  return watermark;
 }
 
 QuicSocket::WriteResult QuicTransportBase::writeChain(
@@ -1823,22 +2336,94 @@ QuicSocket::WriteResult QuicTransportBase::writeChain(
     bool eof,
     bool /*cork*/,
     DeliveryCallback* cb) {
+  auto error =
+      writeChainImpl(id, std::move(data), eof, true /* mayCopy */, cb);
+  if (error) {
+    return folly::makeUnexpected(*error);
+  }
+  updateWriteLooperForNewWork();
+  return nullptr;
+}
+
+std::vector<folly::Optional<LocalErrorCode>> QuicTransportBase::writeMany(
+    std::vector<StreamWrite> writes) {
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
+  std::vector<folly::Optional<LocalErrorCode>> errors;
+  errors.reserve(writes.size());
+  bool anyWritten = false;
+  for (auto& write : writes) {
+    // A transport error closes the connection, which fails the rest of the
+    // writes with CONNECTION_CLOSED.
+    errors.push_back(writeChainImpl(
+        write.id,
+        std::move(write.data),
+        write.eof,
+        true /* mayCopy */,
+        write.cb));
+    anyWritten |= !errors.back().hasValue();
+  }
+  if (anyWritten) {
+    updateWriteLooperForNewWork();
+  }
+  return errors;
+}
+
+QuicSocket::WriteResult QuicTransportBase::writeExternal(
+    StreamId id,
+    folly::ByteRange data,
+    folly::Function<void()> onRelease,
+    bool eof,
+    bool /*cork*/,
+    DeliveryCallback* cb) {
+  // The IOBuf frees what it took ownership of once the last of its clones in
+  // the write, loss and retransmission buffers is gone, which is when it hands
+  // the memory back to the application.
+  auto release = new folly::Function<void()>(std::move(onRelease));
+  Buf buf = folly::IOBuf::takeOwnership(
+      const_cast<uint8_t*>(data.data()),
+      data.size(),
+      data.size(),
+      [](void* /* buf */, void* userData) {
+        auto releaseFn = static_cast<folly::Function<void()>*>(userData);
+        (*releaseFn)();
+        delete releaseFn;
+      },
+      release);
+  auto error =
+      writeChainImpl(id, std::move(buf), eof, false /* mayCopy */, cb);
+  if (error) {
+    return folly::makeUnexpected(*error);
+  }
+  updateWriteLooperForNewWork();
+  return nullptr;
+}
+
+folly::Optional<LocalErrorCode> QuicTransportBase::writeChainImpl(
+    StreamId id,
+    Buf data,
+    bool eof,
+    bool mayCopy,
+    DeliveryCallback* cb) {
   if (isReceivingStream(conn_->nodeType, id)) {
-    return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
+    return LocalErrorCode::INVALID_OPERATION;
   }
   if (closeState_ != CloseState::OPEN) {
-    return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
+    return LocalErrorCode::CONNECTION_CLOSED;
   }
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
   try {
     // Check whether stream exists before calling getStream to avoid
     // creating a peer stream if it does not exist yet.
     if (!conn_->streamManager->streamExists(id)) {
-      return folly::makeUnexpected(LocalErrorCode::STREAM_NOT_EXISTS);
+      return LocalErrorCode::STREAM_NOT_EXISTS;
     }
     auto stream = conn_->streamManager->getStream(id);
     if (!stream->writable()) {
-      return folly::makeUnexpected(LocalErrorCode::STREAM_CLOSED);
+      return LocalErrorCode::STREAM_CLOSED;
+    }
+    if (fileWrites_.count(id)) {
+      // The rest of a file comes first.
+      return LocalErrorCode::INVALID_OPERATION;
     }
     // Register DeliveryCallback for the data + eof offset.
     if (cb) {
@@ -1850,22 +2435,26 @@ QuicSocket::WriteResult QuicTransportBase::writeChain(
             id, currentLargestWriteOffset + dataLength - 1, cb);
       }
     }
-    writeDataToQuicStream(*stream, std::move(data), eof);
-    updateWriteLooper(true);
+    if (stream->writeTimeToLive && data && !data->empty()) {
+      stream->writeDeadlines.emplace_back(
+          getLargestWriteOffsetSeen(*stream) + data->computeChainDataLength(),
+          Clock::now() + *stream->writeTimeToLive);
+    }
+    writeDataToQuicStream(*stream, std::move(data), eof, mayCopy);
   } catch (const QuicTransportException& ex) {
     VLOG(4) << __func__ << " streamId=" << id << " " << ex.what() << " "
             << *this;
     exceptionCloseWhat_ = ex.what();
     closeImpl(std::make_pair(
         QuicErrorCode(ex.errorCode()), std::string("writeChain() error")));
-    return folly::makeUnexpected(LocalErrorCode::TRANSPORT_ERROR);
+    return LocalErrorCode::TRANSPORT_ERROR;
   } catch (const QuicInternalException& ex) {
     VLOG(4) << __func__ << " streamId=" << id << " " << ex.what() << " "
             << *this;
     exceptionCloseWhat_ = ex.what();
     closeImpl(std::make_pair(
         QuicErrorCode(ex.errorCode()), std::string("writeChain() error")));
-    return folly::makeUnexpected(ex.errorCode());
+    return ex.errorCode();
   } catch (const std::exception& ex) {
     VLOG(4) << __func__ << " streamId=" << id << " " << ex.what() << " "
             << *this;
@@ -1873,9 +2462,108 @@ QuicSocket::WriteResult QuicTransportBase::writeChain(
     closeImpl(std::make_pair(
         QuicErrorCode(TransportErrorCode::INTERNAL_ERROR),
         std::string("writeChain() error")));
-    return folly::makeUnexpected(LocalErrorCode::INTERNAL_ERROR);
+    return LocalErrorCode::INTERNAL_ERROR;
+  }
+  return folly::none;
+}
+
+folly::Expected<folly::Unit, LocalErrorCode> QuicTransportBase::writeFile(
+    StreamId id,
+    int fd,
+    off_t offset,
+    size_t len,
+    bool eof,
+    DeliveryCallback* cb) {
+  if (isReceivingStream(conn_->nodeType, id)) {
+    return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
+  }
+  if (closeState_ != CloseState::OPEN) {
+    return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
+  }
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
+  if (len == 0) {
+    auto error = writeChainImpl(id, nullptr, eof, true /* mayCopy */, cb);
+    if (error) {
+      return folly::makeUnexpected(*error);
+    }
+    updateWriteLooper(true);
+    return folly::unit;
+  }
+  if (!conn_->streamManager->streamExists(id)) {
+    return folly::makeUnexpected(LocalErrorCode::STREAM_NOT_EXISTS);
+  }
+  auto stream = conn_->streamManager->getStream(id);
+  if (!stream->writable()) {
+    return folly::makeUnexpected(LocalErrorCode::STREAM_CLOSED);
+  }
+  if (fileWrites_.count(id)) {
+    return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
+  }
+  if (cb) {
+    auto currentLargestWriteOffset = getLargestWriteOffsetSeen(*stream);
+    registerDeliveryCallback(
+        id, currentLargestWriteOffset + len + (eof ? 1 : 0) - 1, cb);
+  }
+  fileWrites_.emplace(id, FileWrite{fd, offset, len, eof});
+  updateWriteLooper(true);
+  return folly::unit;
+}
+
+void QuicTransportBase::fillFileWrites() {
+  std::vector<StreamId> failed;
+  for (auto it = fileWrites_.begin(); it != fileWrites_.end();) {
+    auto& fileWrite = it->second;
+    auto stream = conn_->streamManager->findStream(it->first);
+    if (!stream || !stream->writable()) {
+      it = fileWrites_.erase(it);
+      continue;
+    }
+    uint64_t buffered = stream->writeBuffer.chainLength();
+    uint64_t bufferSize = conn_->transportSettings.fileWriteBufferSize;
+    uint64_t toRead = std::min<uint64_t>(
+        {fileWrite.remaining,
+         bufferSize > buffered ? bufferSize - buffered : 0,
+         getSendStreamFlowControlBytesAPI(*stream)});
+    if (toRead == 0) {
+      ++it;
+      continue;
+    }
+    auto buf = folly::IOBuf::create(toRead);
+    while (buf->length() < toRead) {
+      auto ret = pread(
+          fileWrite.fd,
+          buf->writableTail(),
+          toRead - buf->length(),
+          fileWrite.offset + buf->length());
+      if (ret < 0 && errno == EINTR) {
+        continue;
+      }
+      if (ret <= 0) {
+        // Either an error, or the file is shorter than the range.
+        break;
+      }
+      buf->append(ret);
+    }
+    if (buf->length() < toRead) {
+      VLOG(4) << __func__ << " read failed streamId=" << it->first
+              << " errno=" << errno << " " << *this;
+      failed.push_back(it->first);
+      it = fileWrites_.erase(it);
+      continue;
+    }
+    fileWrite.offset += toRead;
+    fileWrite.remaining -= toRead;
+    bool done = fileWrite.remaining == 0;
+    writeDataToQuicStream(*stream, std::move(buf), done && fileWrite.eof);
+    if (done) {
+      it = fileWrites_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (auto id : failed) {
+    resetStream(id, GenericApplicationErrorCode::UNKNOWN);
   }
-  return nullptr;
 }
 
 folly::Expected<folly::Unit, LocalErrorCode>
@@ -1889,17 +2577,19 @@ QuicTransportBase::registerDeliveryCallback(
   if (closeState_ != CloseState::OPEN) {
     return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
   }
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
   if (!conn_->streamManager->streamExists(id)) {
     return folly::makeUnexpected(LocalErrorCode::STREAM_NOT_EXISTS);
   }
   if (cb) {
     auto deliveryCallbackIt = deliveryCallbacks_.find(id);
     if (deliveryCallbackIt == deliveryCallbacks_.end()) {
-      deliveryCallbacks_.emplace(
-          id,
-          std::initializer_list<decltype(
-              deliveryCallbacks_)::mapped_type::value_type>({{offset, cb}}));
+      deliveryCallbacks_[id].emplace_back(offset, cb);
+    } else if (
+        deliveryCallbackIt->second.empty() ||
+        deliveryCallbackIt->second.back().first <= offset) {
+      // Usually registered in the order of the writes.
+      deliveryCallbackIt->second.emplace_back(offset, cb);
     } else {
       // Keep DeliveryCallbacks for the same stream sorted by offsets:
       auto pos = std::upper_bound(
@@ -1955,7 +2645,7 @@ folly::Expected<folly::Unit, LocalErrorCode> QuicTransportBase::resetStream(
   if (closeState_ != CloseState::OPEN) {
     return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
   }
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
   SCOPE_EXIT {
     checkForClosedStream();
     updateReadLooper();
@@ -2010,15 +2700,17 @@ void QuicTransportBase::checkForClosedStream() {
   if (closeState_ == CloseState::CLOSED) {
     return;
   }
-  auto itr = conn_->streamManager->closedStreams().begin();
-  while (itr != conn_->streamManager->closedStreams().end()) {
+  auto& closedStreams = conn_->streamManager->closedStreams();
+  bool removed = false;
+  for (auto itr = closedStreams.begin(); itr != closedStreams.end();
+       itr = closedStreams.erase(itr)) {
     // We may be in an active read cb when we close the stream
     auto readCbIt = readCallbacks_.find(*itr);
     if (readCbIt != readCallbacks_.end() &&
         readCbIt->second.readCb != nullptr && !readCbIt->second.deliveredEOM) {
       VLOG(10) << "Not closing stream=" << *itr
                << " because it has active read callback";
-      ++itr;
+      heldClosedStreams_.insert(*itr);
       continue;
     }
     // We may be in the active peek cb when we close the stream
@@ -2027,7 +2719,7 @@ void QuicTransportBase::checkForClosedStream() {
         peekCbIt->second.peekCb != nullptr) {
       VLOG(10) << "Not closing stream=" << *itr
                << " because it has active peek callback";
-      ++itr;
+      heldClosedStreams_.insert(*itr);
       continue;
     }
     // We might be in the process of delivering all the delivery callbacks for
@@ -2036,7 +2728,7 @@ void QuicTransportBase::checkForClosedStream() {
     if (deliveryCbCount > 0) {
       VLOG(10) << "Not closing stream=" << *itr
                << " because it is waiting for the delivery callback";
-      ++itr;
+      heldClosedStreams_.insert(*itr);
       continue;
     }
 
@@ -2046,15 +2738,18 @@ void QuicTransportBase::checkForClosedStream() {
           getClosingStream(folly::to<std::string>(*itr)));
     }
     conn_->streamManager->removeClosedStream(*itr);
-    maybeSendStreamLimitUpdates(*conn_);
+    removed = true;
     if (readCbIt != readCallbacks_.end()) {
       readCallbacks_.erase(readCbIt);
     }
     if (peekCbIt != peekCallbacks_.end()) {
       peekCallbacks_.erase(peekCbIt);
     }
-    itr = conn_->streamManager->closedStreams().erase(itr);
-  } // while
+  }
+  if (removed) {
+    // Only the latest limits matter, once for all the streams removed.
+    maybeSendStreamLimitUpdates(*conn_);
+  }
 
   if (closeState_ == CloseState::GRACEFUL_CLOSING &&
       conn_->streamManager->streamCount() == 0) {
@@ -2062,6 +2757,12 @@ void QuicTransportBase::checkForClosedStream() {
   }
 }
 
+void QuicTransportBase::maybeReleaseClosedStream(StreamId id) {
+  if (heldClosedStreams_.erase(id) > 0) {
+    conn_->streamManager->addClosed(id);
+  }
+}
+
 void QuicTransportBase::sendPing(
     PingCallback* callback,
     std::chrono::milliseconds pingTimeout) {
@@ -2072,16 +2773,87 @@ void QuicTransportBase::sendPing(
 
   // Step 1: Send a simple ping frame
   quic::sendSimpleFrame(*conn_, PingFrame());
-  updateWriteLooper(true);
+  updateWriteLooperForNewWork();
 
   // Step 2: Schedule the timeout on event base
   schedulePingTimeout(callback, pingTimeout);
 }
 
+folly::Expected<folly::Unit, LocalErrorCode>
+QuicTransportBase::setDatagramCallback(DatagramCallback* cb) {
+  if (closeState_ != CloseState::OPEN) {
+    return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
+  }
+  datagramCallback_ = cb;
+  return folly::unit;
+}
+
+folly::Expected<folly::Unit, LocalErrorCode>
+QuicTransportBase::setBatchedStreamCallback(BatchedStreamCallback* cb) {
+  if (closeState_ != CloseState::OPEN) {
+    return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
+  }
+  batchedStreamCallback_ = cb;
+  return folly::unit;
+}
+
+uint16_t QuicTransportBase::getDatagramSizeLimit() const {
+  CHECK(conn_);
+  uint64_t maxFrameSize = std::min<uint64_t>(
+      conn_->datagramState.maxWriteFrameSize,
+      conn_->udpSendPacketLen > kMaxDatagramPacketOverhead
+          ? conn_->udpSendPacketLen - kMaxDatagramPacketOverhead
+          : 0);
+  return maxFrameSize > kMaxDatagramFrameOverhead
+      ? maxFrameSize - kMaxDatagramFrameOverhead
+      : 0;
+}
+
+folly::Expected<folly::Unit, LocalErrorCode> QuicTransportBase::writeDatagram(
+    Buf buf) {
+  if (closeState_ != CloseState::OPEN) {
+    return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
+  }
+  auto size = buf ? buf->computeChainDataLength() : 0;
+  if (size > getDatagramSizeLimit()) {
+    return folly::makeUnexpected(LocalErrorCode::INVALID_WRITE_DATA);
+  }
+  auto& writeBuffer = conn_->datagramState.writeBuffer;
+  if (writeBuffer.size() >= conn_->transportSettings.datagramWriteBufferSize) {
+    if (writeBuffer.empty()) {
+      return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
+    }
+    // The newest datagram is the most useful one to an app that can't wait
+    // for retransmissions.
+    writeBuffer.pop_front();
+  }
+  writeBuffer.emplace_back(std::move(buf));
+  updateWriteLooperForNewWork();
+  return folly::unit;
+}
+
+folly::Expected<std::vector<Buf>, LocalErrorCode>
+QuicTransportBase::readDatagrams(size_t atMost) {
+  if (closeState_ != CloseState::OPEN) {
+    return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
+  }
+  auto& readBuffer = conn_->datagramState.readBuffer;
+  if (atMost == 0 || atMost > readBuffer.size()) {
+    atMost = readBuffer.size();
+  }
+  std::vector<Buf> datagrams;
+  datagrams.reserve(atMost);
+  for (size_t i = 0; i < atMost; ++i) {
+    datagrams.emplace_back(std::move(readBuffer.front()));
+    readBuffer.pop_front();
+  }
+  return datagrams;
+}
+
 void QuicTransportBase::lossTimeoutExpired() noexcept {
   CHECK_NE(closeState_, CloseState::CLOSED);
   // onLossDetectionAlarm will set packetToSend in pending events
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
   try {
     onLossDetectionAlarm(*conn_, markPacketLoss);
     // TODO: remove this trace when Pacing is ready to land
@@ -2114,11 +2886,37 @@ void QuicTransportBase::lossTimeoutExpired() noexcept {
 void QuicTransportBase::ackTimeoutExpired() noexcept {
   CHECK_NE(closeState_, CloseState::CLOSED);
   VLOG(10) << __func__ << " " << *this;
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
   updateAckStateOnAckTimeout(*conn_);
   pacedWriteDataToSocket(false);
 }
 
+void QuicTransportBase::corkTimeoutExpired() noexcept {
+  flush();
+}
+
+void QuicTransportBase::windowUpdateTimeoutExpired() noexcept {
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
+  flushWindowUpdates_ = true;
+  updateWriteLooper(true);
+}
+
+void QuicTransportBase::setCork(bool cork) {
+  corked_ = cork;
+  if (!cork) {
+    flush();
+  }
+}
+
+void QuicTransportBase::flush() {
+  if (corkTimeout_.isScheduled()) {
+    corkTimeout_.cancelTimeout();
+  }
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
+  flushCork_ = true;
+  updateWriteLooper(true);
+}
+
 void QuicTransportBase::pingTimeoutExpired() noexcept {
   // If timeout expired just call the  call back Provided
   if (pingCallback_ == nullptr) {
@@ -2138,15 +2936,29 @@ void QuicTransportBase::pathValidationTimeoutExpired() noexcept {
 
   // TODO junqiw probing is not supported, so pathValidation==connMigration
   // We decide to close conn when pathValidation to migrated path fails.
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
   closeImpl(std::make_pair(
       QuicErrorCode(TransportErrorCode::INVALID_MIGRATION),
       std::string("Path validation timed out")));
 }
 
 void QuicTransportBase::idleTimeoutExpired(bool drain) noexcept {
+  if (drain && conn_->transportSettings.lazyIdleTimer) {
+    auto now = Clock::now();
+    auto idleDeadline =
+        lastIdleActivity_ + conn_->transportSettings.idleTimeout;
+    if (idleDeadline > now) {
+      // There has been activity since the timer was armed.
+      idleTimerDeadline_ = idleDeadline;
+      getEventBase()->timer().scheduleTimeout(
+          &idleTimeout_,
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              idleDeadline - now));
+      return;
+    }
+  }
   VLOG(4) << __func__ << " " << *this;
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
   // idle timeout is expired, just close the connection and drain or
   // send connection close immediately depending on 'drain'
   DCHECK_NE(closeState_, CloseState::CLOSED);
@@ -2158,13 +2970,44 @@ void QuicTransportBase::idleTimeoutExpired(bool drain) noexcept {
       !drain /* sendCloseImmediately */);
 }
 
-void QuicTransportBase::scheduleLossTimeout(std::chrono::milliseconds timeout) {
+void QuicTransportBase::idleCompactionTimeoutExpired() noexcept {
+  if (closeState_ == CloseState::CLOSED) {
+    return;
+  }
+  auto now = Clock::now();
+  auto idleDeadline =
+      lastIdleActivity_ + conn_->transportSettings.idleCompactionTimeout;
+  if (idleDeadline > now) {
+    getEventBase()->timer().scheduleTimeout(
+        &idleCompactionTimeout_,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            idleDeadline - now));
+    return;
+  }
+  VLOG(10) << "Compacting idle connection " << *this;
+  compactIdleConnection(*conn_);
+}
+
+TimerHighRes* QuicTransportBase::getHighResTimer() const {
+  return conn_->transportSettings.useHighResTimers ? highResTimer_.get()
+                                                   : nullptr;
+}
+
+void QuicTransportBase::scheduleLossTimeout(std::chrono::microseconds timeout) {
   if (closeState_ == CloseState::CLOSED) {
     return;
   }
+  lossTimeout_.cancelTimeout();
+  if (auto highResTimer = getHighResTimer()) {
+    timeout = timeMax(timeout, highResTimer->getTickInterval());
+    highResTimer->scheduleTimeout(&lossTimeout_, timeout);
+    return;
+  }
   auto& wheelTimer = getEventBase()->timer();
-  timeout = timeMax(timeout, wheelTimer.getTickInterval());
-  wheelTimer.scheduleTimeout(&lossTimeout_, timeout);
+  auto timeoutMs = timeMax(
+      std::chrono::duration_cast<std::chrono::milliseconds>(timeout),
+      wheelTimer.getTickInterval());
+  wheelTimer.scheduleTimeout(&lossTimeout_, timeoutMs);
 }
 
 void QuicTransportBase::scheduleAckTimeout() {
@@ -2175,11 +3018,23 @@ void QuicTransportBase::scheduleAckTimeout() {
     if (!ackTimeout_.isScheduled()) {
       auto factoredRtt = std::chrono::duration_cast<std::chrono::microseconds>(
           kAckTimerFactor * conn_->lossState.srtt);
+      auto maxAckDelay = timeMin(kMaxAckTimeout, factoredRtt);
+      if (conn_->ackFrequencyState.received) {
+        maxAckDelay = conn_->ackFrequencyState.received->updateMaxAckDelay;
+      }
+      if (auto highResTimer = getHighResTimer()) {
+        auto timeout = timeMax(highResTimer->getTickInterval(), maxAckDelay);
+        VLOG(10) << __func__ << " timeout=" << timeout.count() << "us"
+                 << " factoredRtt=" << factoredRtt.count() << "us"
+                 << " " << *this;
+        highResTimer->scheduleTimeout(&ackTimeout_, timeout);
+        return;
+      }
       auto& wheelTimer = getEventBase()->timer();
       auto timeout = timeMax(
           std::chrono::duration_cast<std::chrono::microseconds>(
               wheelTimer.getTickInterval()),
-          timeMin(kMaxAckTimeout, factoredRtt));
+          maxAckDelay);
       auto timeoutMs =
           std::chrono::duration_cast<std::chrono::milliseconds>(timeout);
       VLOG(10) << __func__ << " timeout=" << timeoutMs.count() << "ms"
@@ -2289,8 +3144,16 @@ void QuicTransportBase::cancelAllAppCallbacks(
   }
   VLOG(4) << "Clearing " << peekCallbacks_.size() << " peek callbacks";
   peekCallbacks_.clear();
+  // Nothing holds the closed streams back anymore.
+  for (auto id : heldClosedStreams_) {
+    conn_->streamManager->addClosed(id);
+  }
+  heldClosedStreams_.clear();
   dataExpiredCallbacks_.clear();
   dataRejectedCallbacks_.clear();
+  bandwidthEstimateCallback_ = nullptr;
+  datagramCallback_ = nullptr;
+  batchedStreamCallback_ = nullptr;
 
   if (connWriteCallback_) {
     auto connWriteCallback = connWriteCallback_;
@@ -2307,7 +3170,19 @@ void QuicTransportBase::cancelAllAppCallbacks(
 
 void QuicTransportBase::writeSocketData() {
   if (socket_) {
+    CpuTimeScope cpuTimeScope(
+        conn_->cpuTime,
+        conn_->transportSettings.trackCpuTime,
+        CpuTimeCategory::WRITE);
     auto packetsBefore = conn_->outstandingPackets.size();
+    updateAckFrequency(*conn_);
+    if (conn_->transportSettings.loopWorkBudget.count() > 0) {
+      conn_->loopWorkDeadline =
+          Clock::now() + conn_->transportSettings.loopWorkBudget;
+    }
+    SCOPE_EXIT {
+      conn_->loopWorkDeadline = folly::none;
+    };
     writeData();
     if (closeState_ != CloseState::CLOSED) {
       if (conn_->pendingEvents.closeTransport == true) {
@@ -2351,6 +3226,14 @@ void QuicTransportBase::writeSocketData() {
           currentSendBufLen < conn_->udpSendPacketLen && lossBufferEmpty &&
           conn_->congestionController->getWritableBytes()) {
         conn_->congestionController->setAppLimited();
+        if (!conn_->appLimitedTime) {
+          conn_->appLimitedTime = Clock::now();
+        }
+      } else if (conn_->appLimitedTime) {
+        conn_->totalAppLimitedTime +=
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                Clock::now() - *conn_->appLimitedTime);
+        conn_->appLimitedTime = folly::none;
       }
     }
   }
@@ -2363,7 +3246,11 @@ void QuicTransportBase::writeSocketData() {
 }
 
 void QuicTransportBase::writeSocketDataAndCatch() {
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
+  // What a cork held back is being written now.
+  flushCork_ = false;
+  flushWindowUpdates_ = false;
+  auto bytesSentBefore = conn_->lossState.totalBytesSent;
   try {
     writeSocketData();
   } catch (const QuicTransportException& ex) {
@@ -2385,12 +3272,87 @@ void QuicTransportBase::writeSocketDataAndCatch() {
         QuicErrorCode(TransportErrorCode::INTERNAL_ERROR),
         std::string("writeSocketDataAndCatch()  error")));
   }
+  updateHotLoopState(conn_->lossState.totalBytesSent - bytesSentBefore);
+  // What was sent may have taken the unsent data below the watermark.
+  if (closeState_ == CloseState::OPEN && notSentLowWatermark() != 0 &&
+      (connWriteCallback_ || !pendingWriteCallbacks_.empty())) {
+    invokeWriteReadyCallbacks();
+  }
+}
+
+void QuicTransportBase::updateHotLoopState(uint64_t bytes) {
+  const auto& settings = conn_->transportSettings;
+  if (settings.hotLoopMinBytesPerWakeup == 0 ||
+      closeState_ != CloseState::OPEN) {
+    return;
+  }
+  auto& state = conn_->hotLoopState;
+  ++state.wakeups;
+  state.bytes += bytes;
+  auto now = Clock::now();
+  if (now - state.windowStart < settings.hotLoopWindow) {
+    return;
+  }
+  auto wakeups = state.wakeups;
+  auto windowBytes = state.bytes;
+  state.windowStart = now;
+  state.wakeups = 0;
+  state.bytes = 0;
+  if (wakeups >= settings.hotLoopMinWakeups &&
+      windowBytes < wakeups * settings.hotLoopMinBytesPerWakeup) {
+    mitigateHotLoop(wakeups, windowBytes);
+  }
+}
+
+void QuicTransportBase::mitigateHotLoop(uint64_t wakeups, uint64_t bytes) {
+  auto& settings = conn_->transportSettings;
+  auto& mitigation = conn_->hotLoopState.mitigation;
+  switch (mitigation) {
+    case HotLoopMitigation::NONE:
+      // A connection paced already goes straight to larger bursts.
+      mitigation = settings.pacingEnabled ? HotLoopMitigation::RAISE_BURST
+                                          : HotLoopMitigation::PACE;
+      break;
+    case HotLoopMitigation::PACE:
+      mitigation = HotLoopMitigation::RAISE_BURST;
+      break;
+    case HotLoopMitigation::RAISE_BURST:
+    case HotLoopMitigation::CLOSE:
+      mitigation = HotLoopMitigation::CLOSE;
+      break;
+  }
+  VLOG(2) << "Hot loop wakeups=" << wakeups << " bytes=" << bytes
+          << " mitigation=" << hotLoopMitigationString(mitigation) << " "
+          << *this;
+  QUIC_STATS(conn_->statsCallback, onHotLoopMitigation, mitigation);
+  if (conn_->loopDetectorCallback) {
+    conn_->loopDetectorCallback->onHotLoop(wakeups, bytes, mitigation);
+  }
+  switch (mitigation) {
+    case HotLoopMitigation::NONE:
+      break;
+    case HotLoopMitigation::PACE:
+      settings.pacingEnabled = true;
+      conn_->pacer =
+          std::make_unique<DefaultPacer>(*conn_, settings.minCwndInMss);
+      if (maxPacingRate_) {
+        conn_->pacer->setMaxPacingRate(maxPacingRate_);
+      }
+      break;
+    case HotLoopMitigation::RAISE_BURST:
+      settings.minBurstPackets *= kHotLoopBurstFactor;
+      break;
+    case HotLoopMitigation::CLOSE:
+      closeImpl(std::make_pair(
+          QuicErrorCode(LocalErrorCode::HOT_LOOP),
+          toString(LocalErrorCode::HOT_LOOP).str()));
+      break;
+  }
 }
 
 void QuicTransportBase::cancelDeliveryCallbacks(
     StreamId id,
-    const std::deque<std::pair<uint64_t, QuicSocket::DeliveryCallback*>>&
-        deliveryCallbacks) {
+    const DeliveryCallbackQueue& deliveryCallbacks) {
   for (auto iter = deliveryCallbacks.begin(); iter != deliveryCallbacks.end();
        iter++) {
     auto currentDeliveryCallbackOffset = iter->first;
@@ -2400,9 +3362,7 @@ void QuicTransportBase::cancelDeliveryCallbacks(
 }
 
 void QuicTransportBase::cancelDeliveryCallbacks(
-    const folly::F14FastMap<
-        StreamId,
-        std::deque<std::pair<uint64_t, QuicSocket::DeliveryCallback*>>>&
+    const folly::F14FastMap<StreamId, DeliveryCallbackQueue>&
         deliveryCallbacks) {
   for (auto iter = deliveryCallbacks.begin(); iter != deliveryCallbacks.end();
        iter++) {
@@ -2424,10 +3384,38 @@ void QuicTransportBase::setTransportSettings(
   if (conn_->transportSettings.pacingEnabled) {
     conn_->pacer = std::make_unique<DefaultPacer>(
         *conn_,
-        transportSettings.defaultCongestionController ==
-                CongestionControlType::BBR
+        (transportSettings.defaultCongestionController ==
+             CongestionControlType::BBR ||
+         transportSettings.defaultCongestionController ==
+             CongestionControlType::BBR2)
             ? kMinCwndInMssForBbr
             : conn_->transportSettings.minCwndInMss);
+    if (maxPacingRate_) {
+      conn_->pacer->setMaxPacingRate(maxPacingRate_);
+    }
+  }
+}
+
+void QuicTransportBase::updateLiveTransportSettings(
+    const TransportSettings& transportSettings) {
+  if (closeState_ != CloseState::OPEN) {
+    return;
+  }
+  auto& settings = conn_->transportSettings;
+  auto paced = settings.pacingEnabled;
+  copyLiveTransportSettings(settings, transportSettings);
+  setCongestionControl(settings.defaultCongestionController);
+  auto ccType = conn_->congestionController->type();
+  if (ccType == CongestionControlType::BBR ||
+      ccType == CongestionControlType::BBR2) {
+    // BBR needs the pacer.
+    settings.pacingEnabled = true;
+  } else if (settings.pacingEnabled && (!paced || !conn_->pacer)) {
+    conn_->pacer =
+        std::make_unique<DefaultPacer>(*conn_, settings.minCwndInMss);
+    if (maxPacingRate_) {
+      conn_->pacer->setMaxPacingRate(maxPacingRate_);
+    }
   }
 }
 
@@ -2446,10 +3434,14 @@ void QuicTransportBase::setCongestionControl(CongestionControlType type) {
     CHECK(ccFactory_);
 
     // We need to enable pacing if we're switching to BBR.
-    if (type == CongestionControlType::BBR) {
+    if (type == CongestionControlType::BBR ||
+        type == CongestionControlType::BBR2) {
       conn_->transportSettings.pacingEnabled = true;
       conn_->pacer =
           std::make_unique<DefaultPacer>(*conn_, kMinCwndInMssForBbr);
+      if (maxPacingRate_) {
+        conn_->pacer->setMaxPacingRate(maxPacingRate_);
+      }
     }
 
     conn_->congestionController =
@@ -2457,6 +3449,21 @@ void QuicTransportBase::setCongestionControl(CongestionControlType type) {
   }
 }
 
+folly::Expected<folly::Unit, LocalErrorCode>
+QuicTransportBase::setMaxPacingRate(
+    folly::Optional<uint64_t> maxRateBytesPerSec) {
+  if (closeState_ != CloseState::OPEN) {
+    return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
+  }
+  if (!conn_->pacer || (maxRateBytesPerSec && *maxRateBytesPerSec == 0)) {
+    return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
+  }
+  maxPacingRate_ = maxRateBytesPerSec;
+  conn_->pacer->setMaxPacingRate(maxRateBytesPerSec);
+  updateWriteLooper(true);
+  return folly::unit;
+}
+
 bool QuicTransportBase::isDetachable() {
   // only the client is detachable.
   return conn_->nodeType == QuicNodeType::Client;
@@ -2475,8 +3482,12 @@ void QuicTransportBase::attachEventBase(folly::EventBase* evb) {
   schedulePathValidationTimeout();
   setIdleTimer();
 
-  readLooper_->attachEventBase(evb);
-  peekLooper_->attachEventBase(evb);
+  if (readLooper_) {
+    readLooper_->attachEventBase(evb);
+  }
+  if (peekLooper_) {
+    peekLooper_->attachEventBase(evb);
+  }
   writeLooper_->attachEventBase(evb);
   updateReadLooper();
   updatePeekLooper();
@@ -2495,9 +3506,14 @@ void QuicTransportBase::detachEventBase() {
   ackTimeout_.cancelTimeout();
   pathValidationTimeout_.cancelTimeout();
   idleTimeout_.cancelTimeout();
+  idleCompactionTimeout_.cancelTimeout();
   drainTimeout_.cancelTimeout();
-  readLooper_->detachEventBase();
-  peekLooper_->detachEventBase();
+  if (readLooper_) {
+    readLooper_->detachEventBase();
+  }
+  if (peekLooper_) {
+    peekLooper_->detachEventBase();
+  }
   writeLooper_->detachEventBase();
   evb_ = nullptr;
 }
@@ -2512,6 +3528,49 @@ folly::Optional<LocalErrorCode> QuicTransportBase::setControlStream(
   return folly::none;
 }
 
+folly::Expected<folly::Unit, LocalErrorCode>
+QuicTransportBase::setStreamPriority(
+    StreamId id,
+    PriorityUrgency urgency,
+    bool incremental) {
+  if (closeState_ != CloseState::OPEN) {
+    return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
+  }
+  if (urgency >= kNumPriorityUrgencies) {
+    return folly::makeUnexpected(LocalErrorCode::INVALID_OPERATION);
+  }
+  if (!conn_->streamManager->streamExists(id)) {
+    return folly::makeUnexpected(LocalErrorCode::STREAM_NOT_EXISTS);
+  }
+  auto stream = conn_->streamManager->getStream(id);
+  conn_->streamManager->setStreamPriority(
+      *stream, Priority(urgency, incremental));
+  return folly::unit;
+}
+
+folly::Expected<Priority, LocalErrorCode> QuicTransportBase::getStreamPriority(
+    StreamId id) {
+  if (closeState_ != CloseState::OPEN) {
+    return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
+  }
+  if (!conn_->streamManager->streamExists(id)) {
+    return folly::makeUnexpected(LocalErrorCode::STREAM_NOT_EXISTS);
+  }
+  return conn_->streamManager->getStream(id)->priority;
+}
+
+folly::Expected<folly::Unit, LocalErrorCode>
+QuicTransportBase::setStreamEarlyData(StreamId id, bool allowed) {
+  if (closeState_ != CloseState::OPEN) {
+    return folly::makeUnexpected(LocalErrorCode::CONNECTION_CLOSED);
+  }
+  if (!conn_->streamManager->streamExists(id)) {
+    return folly::makeUnexpected(LocalErrorCode::STREAM_NOT_EXISTS);
+  }
+  conn_->streamManager->getStream(id)->earlyDataAllowed = allowed;
+  return folly::unit;
+}
+
 void QuicTransportBase::runOnEvbAsync(
     folly::Function<void(std::shared_ptr<QuicTransportBase>)> func) {
   auto evb = getEventBase();
@@ -2527,8 +3586,8 @@ void QuicTransportBase::runOnEvbAsync(
       true);
 }
 
-void QuicTransportBase::pacedWriteDataToSocket(bool /* fromTimer */) {
-  FOLLY_MAYBE_UNUSED auto self = sharedGuard();
+void QuicTransportBase::pacedWriteDataToSocket(bool fromTimer) {
+  FOLLY_MAYBE_UNUSED ScopedGuard self(*this);
 
   if (!isConnectionPaced(*conn_)) {
     // Not paced and connection is still open, normal write. Even if pacing is
@@ -2549,7 +3608,32 @@ void QuicTransportBase::pacedWriteDataToSocket(bool /* fromTimer */) {
 
   // Do a burst write before waiting for an interval. This will also call
   // updateWriteLooper, but inside FunctionLooper we will ignore that.
+  if (!fromTimer || !pacedWriteDueTime_ || !conn_->statsCallback) {
+    writeSocketDataAndCatch();
+    return;
+  }
+  auto now = Clock::now();
+  auto timerLateness = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::max(now - *pacedWriteDueTime_, Clock::duration::zero()));
+  std::chrono::microseconds intervalError{0us};
+  if (lastPacedWriteTime_) {
+    auto actualInterval =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            now - *lastPacedWriteTime_);
+    intervalError = actualInterval > pacedWriteInterval_
+        ? actualInterval - pacedWriteInterval_
+        : pacedWriteInterval_ - actualInterval;
+  }
+  pacedWriteDueTime_ = folly::none;
+  lastPacedWriteTime_ = now;
+  auto nextPacketNum = conn_->ackStates.appDataAckState.nextPacketNum;
   writeSocketDataAndCatch();
+  QUIC_STATS(
+      conn_->statsCallback,
+      onPacedWrite,
+      conn_->ackStates.appDataAckState.nextPacketNum - nextPacketNum,
+      timerLateness,
+      intervalError);
 }
 
 folly::Expected<QuicSocket::StreamTransportInfo, LocalErrorCode>
@@ -12,6 +12,8 @@
 #include <quic/QuicException.h>
 #include <quic/api/QuicSocket.h>
 #include <quic/common/FunctionLooper.h>
+#include <quic/common/PacingScheduler.h>
+#include <quic/common/SmallDeque.h>
 #include <quic/common/Timers.h>
 #include <quic/congestion_control/CongestionControllerFactory.h>
 #include <quic/congestion_control/Copa.h>
@@ -20,6 +22,7 @@
 #include <quic/state/StateData.h>
 
 #include <folly/ExceptionWrapper.h>
+#include <folly/Function.h>
 #include <folly/io/async/AsyncUDPSocket.h>
 #include <folly/io/async/HHWheelTimer.h>
 
@@ -43,8 +46,29 @@ class QuicTransportBase : public QuicSocket {
 
   ~QuicTransportBase() override;
 
+  /**
+   * Sets the high res timer shared by the connections of a worker. It paces
+   * the writes, and with TransportSettings::useHighResTimers also runs the
+   * loss and ack timers.
+   */
   void setPacingTimer(TimerHighRes::SharedPtr pacingTimer) noexcept;
 
+  void setPacingScheduler(PacingScheduler::SharedPtr pacingScheduler) noexcept;
+
+  /**
+   * Account the bytes this connection buffers for reading in a budget shared
+   * with other connections. Must be set before any data is received.
+   */
+  void setReceiveBufferAccountant(
+      std::shared_ptr<ReceiveBufferAccountant> accountant) noexcept;
+
+  /**
+   * Encrypt large batches of packets on threads of the executor as well as on
+   * the EventBase thread, for connections that are CPU bound on one core. See
+   * TransportSettings::encryptOffloadMinBatchSize.
+   */
+  void setEncryptExecutor(std::shared_ptr<folly::Executor> executor);
+
   folly::EventBase* getEventBase() const override;
 
   folly::Optional<ConnectionId> getClientConnectionId() const override;
@@ -86,6 +110,15 @@ class QuicTransportBase : public QuicSocket {
 
   TransportInfo getTransportInfo() const override;
 
+  folly::Optional<Bandwidth> getBandwidthEstimate() const override;
+
+  folly::Optional<std::chrono::microseconds> estimateTimeToSend(
+      uint64_t bytes) const override;
+
+  void setBandwidthEstimateCallback(
+      BandwidthEstimateCallback* cb,
+      float changeThreshold) override;
+
   folly::Expected<StreamTransportInfo, LocalErrorCode> getStreamTransportInfo(
       StreamId id) const override;
 
@@ -128,6 +161,16 @@ class QuicTransportBase : public QuicSocket {
       StreamId id,
       size_t maxLen) override;
 
+  folly::Expected<std::pair<std::vector<Buf>, bool>, LocalErrorCode>
+  readSlices(StreamId id, size_t maxLen) override;
+
+  folly::Expected<folly::Unit, LocalErrorCode> setReadBuffer(
+      StreamId id,
+      folly::MutableByteRange buffer) override;
+
+  folly::Expected<std::pair<size_t, bool>, LocalErrorCode> takeReadBuffer(
+      StreamId id) override;
+
   folly::Expected<folly::Unit, LocalErrorCode> setPeekCallback(
       StreamId id,
       PeekCallback* cb) override;
@@ -157,6 +200,10 @@ class QuicTransportBase : public QuicSocket {
       StreamId id,
       uint64_t offset) override;
 
+  folly::Expected<folly::Unit, LocalErrorCode> setStreamWriteTimeToLive(
+      StreamId id,
+      folly::Optional<std::chrono::milliseconds> ttl) override;
+
   folly::Expected<folly::Unit, LocalErrorCode> setDataRejectedCallback(
       StreamId id,
       DataRejectedCallback* cb) override;
@@ -193,6 +240,25 @@ class QuicTransportBase : public QuicSocket {
       bool cork,
       DeliveryCallback* cb = nullptr) override;
 
+  std::vector<folly::Optional<LocalErrorCode>> writeMany(
+      std::vector<StreamWrite> writes) override;
+
+  WriteResult writeExternal(
+      StreamId id,
+      folly::ByteRange data,
+      folly::Function<void()> onRelease,
+      bool eof,
+      bool cork,
+      DeliveryCallback* cb = nullptr) override;
+
+  folly::Expected<folly::Unit, LocalErrorCode> writeFile(
+      StreamId id,
+      int fd,
+      off_t offset,
+      size_t len,
+      bool eof,
+      DeliveryCallback* cb = nullptr) override;
+
   folly::Expected<folly::Unit, LocalErrorCode> registerDeliveryCallback(
       StreamId id,
       uint64_t offset,
@@ -211,6 +277,23 @@ class QuicTransportBase : public QuicSocket {
   void sendPing(PingCallback* callback, std::chrono::milliseconds pingTimeout)
       override;
 
+  void setCork(bool cork) override;
+
+  void flush() override;
+
+  folly::Expected<folly::Unit, LocalErrorCode> setDatagramCallback(
+      DatagramCallback* cb) override;
+
+  folly::Expected<folly::Unit, LocalErrorCode> setBatchedStreamCallback(
+      BatchedStreamCallback* cb) override;
+
+  uint16_t getDatagramSizeLimit() const override;
+
+  folly::Expected<folly::Unit, LocalErrorCode> writeDatagram(Buf buf) override;
+
+  folly::Expected<std::vector<Buf>, LocalErrorCode> readDatagrams(
+      size_t atMost = 0) override;
+
   const QuicConnectionStateBase* getState() const override {
     return conn_.get();
   }
@@ -238,15 +321,33 @@ class QuicTransportBase : public QuicSocket {
 
   folly::Optional<LocalErrorCode> setControlStream(StreamId id) override;
 
+  folly::Expected<folly::Unit, LocalErrorCode> setStreamPriority(
+      StreamId id,
+      PriorityUrgency urgency,
+      bool incremental) override;
+
+  folly::Expected<Priority, LocalErrorCode> getStreamPriority(
+      StreamId id) override;
+
+  folly::Expected<folly::Unit, LocalErrorCode> setStreamEarlyData(
+      StreamId id,
+      bool allowed) override;
+
+  /**
+   * The delivery callbacks of a stream, sorted by offset. Most streams have
+   * only a few outstanding, which are kept inline.
+   */
+  using DeliveryCallbackQueue =
+      SmallDeque<std::pair<uint64_t, QuicSocket::DeliveryCallback*>, 4>;
+
   /**
    * Invoke onCanceled for all the delivery callbacks in the deliveryCallbacks
-   * passed in. This is supposed to be a copy of the real deque of the delivery
+   * passed in. This is supposed to be a copy of the real queue of the delivery
    * callbacks for the stream, so there is no need to pop anything off of it.
    */
   static void cancelDeliveryCallbacks(
       StreamId id,
-      const std::deque<std::pair<uint64_t, QuicSocket::DeliveryCallback*>>&
-          deliveryCallbacks);
+      const DeliveryCallbackQueue& deliveryCallbacks);
 
   /**
    * Invoke onCanceled for all the delivery callbacks in the deliveryCallbacks
@@ -254,9 +355,7 @@ class QuicTransportBase : public QuicSocket {
    * callbacks of the transport, so there is no need to erase anything from it.
    */
   static void cancelDeliveryCallbacks(
-      const folly::F14FastMap<
-          StreamId,
-          std::deque<std::pair<uint64_t, QuicSocket::DeliveryCallback*>>>&
+      const folly::F14FastMap<StreamId, DeliveryCallbackQueue>&
           deliveryCallbacks);
 
   /**
@@ -264,6 +363,13 @@ class QuicTransportBase : public QuicSocket {
    */
   void setTransportSettings(TransportSettings transportSettings) override;
 
+  /**
+   * Applies the fields of transportSettings which can change on a live
+   * connection, see copyLiveTransportSettings(), also after the handshake.
+   * Switching the congestion controller starts the new one from scratch.
+   */
+  void updateLiveTransportSettings(const TransportSettings& transportSettings);
+
   /**
    * Set factory to create specific congestion controller instances
    * for a given connection
@@ -309,6 +415,16 @@ class QuicTransportBase : public QuicSocket {
    */
   virtual void unbindConnection() = 0;
 
+  /**
+   * Invoked when the transport closes and would drain for drainPeriod.
+   * Returns whether the sub-class handed the draining off to something
+   * smaller than the transport, in which case the connection is unbound right
+   * away.
+   */
+  virtual bool handOffDraining(std::chrono::microseconds /* drainPeriod */) {
+    return false;
+  }
+
   /**
    * Returns whether or not the connection has a write cipher. This will be used
    * to decide to return the onTransportReady() callbacks.
@@ -336,7 +452,7 @@ class QuicTransportBase : public QuicSocket {
       override;
 
   // Timeout functions
-  class LossTimeout : public folly::HHWheelTimer::Callback {
+  class LossTimeout : public DualTimerCallback {
    public:
     ~LossTimeout() override = default;
 
@@ -357,7 +473,7 @@ class QuicTransportBase : public QuicSocket {
     QuicTransportBase* transport_;
   };
 
-  class AckTimeout : public folly::HHWheelTimer::Callback {
+  class AckTimeout : public DualTimerCallback {
    public:
     ~AckTimeout() override = default;
 
@@ -397,6 +513,63 @@ class QuicTransportBase : public QuicSocket {
     QuicTransportBase* transport_;
   };
 
+  class IdleCompactionTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    ~IdleCompactionTimeout() override = default;
+
+    explicit IdleCompactionTimeout(QuicTransportBase* transport)
+        : transport_(transport) {}
+
+    void timeoutExpired() noexcept override {
+      transport_->idleCompactionTimeoutExpired();
+    }
+
+    void callbackCanceled() noexcept override {}
+
+   private:
+    QuicTransportBase* transport_;
+  };
+
+  class CorkTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    ~CorkTimeout() override = default;
+
+    explicit CorkTimeout(QuicTransportBase* transport)
+        : transport_(transport) {}
+
+    void timeoutExpired() noexcept override {
+      transport_->corkTimeoutExpired();
+    }
+
+    void callbackCanceled() noexcept override {
+      // ignore, as this happens only when event  base dies
+      return;
+    }
+
+   private:
+    QuicTransportBase* transport_;
+  };
+
+  class WindowUpdateTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    ~WindowUpdateTimeout() override = default;
+
+    explicit WindowUpdateTimeout(QuicTransportBase* transport)
+        : transport_(transport) {}
+
+    void timeoutExpired() noexcept override {
+      transport_->windowUpdateTimeoutExpired();
+    }
+
+    void callbackCanceled() noexcept override {
+      // ignore, as this happens only when event  base dies
+      return;
+    }
+
+   private:
+    QuicTransportBase* transport_;
+  };
+
   class PathValidationTimeout : public folly::HHWheelTimer::Callback {
    public:
     ~PathValidationTimeout() override = default;
@@ -457,13 +630,16 @@ class QuicTransportBase : public QuicSocket {
     QuicTransportBase* transport_;
   };
 
-  void scheduleLossTimeout(std::chrono::milliseconds timeout);
+  void scheduleLossTimeout(std::chrono::microseconds timeout);
   void cancelLossTimeout();
   bool isLossTimeoutScheduled() const;
 
   // If you don't set it, the default is Cubic
   void setCongestionControl(CongestionControlType type) override;
 
+  folly::Expected<folly::Unit, LocalErrorCode> setMaxPacingRate(
+      folly::Optional<uint64_t> maxRateBytesPerSec) override;
+
   void describe(std::ostream& os) const;
 
   void setLogger(std::shared_ptr<Logger> logger) {
@@ -482,15 +658,86 @@ class QuicTransportBase : public QuicSocket {
       const std::pair<QuicErrorCode, folly::StringPiece>& error) noexcept;
 
  protected:
+  /**
+   * Keeps the transport alive for a scope, like holding sharedGuard(). The
+   * entry points that take one nest a lot, such as the app calling read() or
+   * writeChain() from a callback run by onNetworkData(), so only the outermost
+   * guard copies sharedGuard(). The ones inside it only count, which needs no
+   * atomics as a transport is only used from its EventBase thread.
+   */
+  class ScopedGuard {
+   public:
+    explicit ScopedGuard(QuicTransportBase& transport);
+    ~ScopedGuard();
+
+    ScopedGuard(const ScopedGuard&) = delete;
+    ScopedGuard& operator=(const ScopedGuard&) = delete;
+
+    QuicTransportBase* operator->() const {
+      return &transport_;
+    }
+
+    QuicTransportBase& operator*() const {
+      return transport_;
+    }
+
+   private:
+    QuicTransportBase& transport_;
+  };
+
   void processCallbacksAfterNetworkData();
   void invokeReadDataAndCallbacks();
   void invokePeekDataAndCallbacks();
   void invokeDataExpiredCallbacks();
   void invokeDataRejectedCallbacks();
+  static void stopLooper(FunctionLooper::Ptr& looper);
   void updateReadLooper();
   void updatePeekLooper();
   void updateWriteLooper(bool thisIteration);
+  /**
+   * updateWriteLooper() for the paths that only add write work, like writes of
+   * stream data. Nothing they do can stop a write looper that already runs, so
+   * this doesn't evaluate shouldWriteData() again for them, unless the
+   * transport is corked and may still hold the data back.
+   */
+  void updateWriteLooperForNewWork();
+  /**
+   * Writes, in the middle of a batch of packets that onNetworkData() reads,
+   * when acks are due, as set with TransportSettings::readPacketsBeforeWrite
+   * and readTimeBeforeWrite. The acks go first in what is written, and
+   * whatever else is ready to go goes with them.
+   */
+  void writeAcksDuringRead();
   void handlePingCallback();
+  void handleBandwidthEstimateCallback();
+  void handleDatagramCallback();
+
+  // The part of read() and readSlices() around the read itself, which only
+  // differ in the shape of the data they return.
+  template <typename Data>
+  folly::Expected<std::pair<Data, bool>, LocalErrorCode> readImpl(
+      StreamId id,
+      folly::FunctionRef<std::pair<Data, bool>(QuicStreamState&)> readFn);
+
+  // Appends data to the write buffer of the stream without scheduling the
+  // write looper, which is left to the caller so that writeMany() schedules
+  // it once. External data must not be copied into the chunks of the write
+  // buffer.
+  folly::Optional<LocalErrorCode> writeChainImpl(
+      StreamId id,
+      Buf data,
+      bool eof,
+      bool mayCopy,
+      DeliveryCallback* cb);
+
+  // Reads what the file writes in fileWrites_ may add to the write buffers of
+  // their streams, and drops the ones that are done or whose stream was
+  // closed.
+  void fillFileWrites();
+
+  // Expires the writes past their deadline on the streams in
+  // writeDeadlineStreams_, and drops the streams that have none left.
+  void expireStreamData();
 
   void runOnEvbAsync(
       folly::Function<void(std::shared_ptr<QuicTransportBase>)> func);
@@ -506,6 +753,11 @@ class QuicTransportBase : public QuicSocket {
       StreamId id,
       bool resume);
   void checkForClosedStream();
+  /**
+   * Hands a closed stream that checkForClosedStream() held back for its
+   * callbacks back to it, once one of them is done with it.
+   */
+  void maybeReleaseClosedStream(StreamId id);
   folly::Expected<folly::Unit, LocalErrorCode> setReadCallbackInternal(
       StreamId id,
       ReadCallback* cb) noexcept;
@@ -547,15 +799,30 @@ class QuicTransportBase : public QuicSocket {
   uint64_t maxWritableOnStream(const QuicStreamState&);
   uint64_t maxWritableOnConn();
 
+  // How much written data may be unsent for the write ready callbacks to be
+  // called, 0 for no limit.
+  uint64_t notSentLowWatermark() const;
+  // Calls the connection and stream write ready callbacks that can write now.
+  void invokeWriteReadyCallbacks();
+
   void lossTimeoutExpired() noexcept;
   void ackTimeoutExpired() noexcept;
   void pathValidationTimeoutExpired() noexcept;
   void idleTimeoutExpired(bool drain) noexcept;
+  void idleCompactionTimeoutExpired() noexcept;
   void drainTimeoutExpired() noexcept;
   void pingTimeoutExpired() noexcept;
+  void corkTimeoutExpired() noexcept;
+  void windowUpdateTimeoutExpired() noexcept;
 
   void setIdleTimer();
+  // The timer the loss and ack timeouts go on, null for the EventBase's wheel.
+  TimerHighRes* getHighResTimer() const;
   void scheduleAckTimeout();
+  // Counts a read or write loop run that moved bytes towards the hot loop
+  // detection, see TransportSettings::hotLoopMinBytesPerWakeup.
+  void updateHotLoopState(uint64_t bytes);
+  void mitigateHotLoop(uint64_t wakeups, uint64_t bytes);
   void schedulePathValidationTimeout();
   void schedulePingTimeout(
       PingCallback* callback,
@@ -569,19 +836,27 @@ class QuicTransportBase : public QuicSocket {
       unique_ptr<QuicConnectionStateBase, folly::DelayedDestruction::Destructor>
           conn_;
 
+  // The stream is kept beside its callbacks, so that the read and peek loops
+  // don't look it up again. It outlives them: a stream is only removed in
+  // checkForClosedStream() together with its callbacks, or on close after
+  // all of them are cancelled.
   struct ReadCallbackData {
     ReadCallback* readCb;
+    QuicStreamState* stream;
     bool resumed{true};
     bool deliveredEOM{false};
 
-    ReadCallbackData(ReadCallback* readCallback) : readCb(readCallback) {}
+    ReadCallbackData(ReadCallback* readCallback, QuicStreamState* streamIn)
+        : readCb(readCallback), stream(streamIn) {}
   };
 
   struct PeekCallbackData {
     PeekCallback* peekCb;
+    QuicStreamState* stream;
     bool resumed{true};
 
-    PeekCallbackData(PeekCallback* peekCallback) : peekCb(peekCallback) {}
+    PeekCallbackData(PeekCallback* peekCallback, QuicStreamState* streamIn)
+        : peekCb(peekCallback), stream(streamIn) {}
   };
 
   struct DataExpiredCallbackData {
@@ -600,24 +875,76 @@ class QuicTransportBase : public QuicSocket {
 
   folly::F14FastMap<StreamId, ReadCallbackData> readCallbacks_;
   folly::F14FastMap<StreamId, PeekCallbackData> peekCallbacks_;
-  folly::
-      F14FastMap<StreamId, std::deque<std::pair<uint64_t, DeliveryCallback*>>>
-          deliveryCallbacks_;
+  folly::F14FastMap<StreamId, DeliveryCallbackQueue> deliveryCallbacks_;
+  // The part of a writeFile() range that is not read yet.
+  struct FileWrite {
+    int fd;
+    off_t offset;
+    size_t remaining;
+    bool eof;
+  };
+
   folly::F14FastMap<StreamId, DataExpiredCallbackData> dataExpiredCallbacks_;
   folly::F14FastMap<StreamId, DataRejectedCallbackData> dataRejectedCallbacks_;
   PingCallback* pingCallback_;
+  BandwidthEstimateCallback* bandwidthEstimateCallback_{nullptr};
+  folly::F14FastMap<StreamId, FileWrite> fileWrites_;
+  // The streams with a write time to live, or writes that may still expire.
+  folly::F14FastSet<StreamId> writeDeadlineStreams_;
+  // Closed streams kept for a read, peek or delivery callback that is not done
+  // with them. They are out of the closed streams of the stream manager, so
+  // that checkForClosedStream() doesn't look at them again every time, until
+  // maybeReleaseClosedStream() puts them back.
+  folly::F14FastSet<StreamId> heldClosedStreams_;
+  DatagramCallback* datagramCallback_{nullptr};
+  BatchedStreamCallback* batchedStreamCallback_{nullptr};
+  // Where the read callbacks carry on, if they ran out of
+  // TransportSettings::loopWorkBudget.
+  folly::Optional<StreamId> nextReadableStream_;
+  // Reused by the read and peek loops for their copies of the readable and
+  // peekable sets, so that they don't allocate on every loop.
+  std::vector<StreamId> readableStreamsScratch_;
+  std::vector<StreamId> batchedReadableScratch_;
+  std::vector<StreamId> peekableStreamsScratch_;
+  float bandwidthEstimateChangeThreshold_{
+      kDefaultBandwidthEstimateChangeThreshold};
+  // The estimate last given to bandwidthEstimateCallback_
+  folly::Optional<Bandwidth> lastReportedBandwidthEstimate_;
 
   WriteCallback* connWriteCallback_{nullptr};
   std::map<StreamId, WriteCallback*> pendingWriteCallbacks_;
   CloseState closeState_{CloseState::OPEN};
   bool transportReadyNotified_{false};
 
+  // Declared before the timeouts scheduled on it, which cancel themselves
+  // when destroyed.
+  TimerHighRes::SharedPtr highResTimer_;
   LossTimeout lossTimeout_;
   AckTimeout ackTimeout_;
   PathValidationTimeout pathValidationTimeout_;
   IdleTimeout idleTimeout_;
+  // Last time the idle timer was refreshed. With lazyIdleTimer the connection
+  // is idle from lastIdleActivity_ + idleTimeout, which may be after
+  // idleTimerDeadline_, when the armed timer fires.
+  TimePoint lastIdleActivity_;
+  TimePoint idleTimerDeadline_;
+  // Armed by activity when TransportSettings::idleCompactionTimeout is set,
+  // and rearmed for the rest when it fires early, like a lazy idle timer.
+  IdleCompactionTimeout idleCompactionTimeout_;
   DrainTimeout drainTimeout_;
   PingTimeout pingTimeout_;
+  CorkTimeout corkTimeout_;
+  // Set with setCork().
+  bool corked_{false};
+  // Set when what the cork holds back is to be written with the next write.
+  bool flushCork_{false};
+  WindowUpdateTimeout windowUpdateTimeout_;
+  // Set when held back flow control updates are to be written with the next
+  // write.
+  bool flushWindowUpdates_{false};
+  // The read and peek loopers are only made once a stream has data for a
+  // callback, so connections that never get that far, such as the half open
+  // ones of an Initial flood, don't pay for them.
   FunctionLooper::Ptr readLooper_;
   FunctionLooper::Ptr peekLooper_;
   FunctionLooper::Ptr writeLooper_;
@@ -627,8 +954,20 @@ class QuicTransportBase : public QuicSocket {
   folly::SocketAddress localFallbackAddress;
   // CongestionController factory
   std::shared_ptr<CongestionControllerFactory> ccFactory_{nullptr};
+  // Set on the pacer again whenever it is replaced.
+  folly::Optional<uint64_t> maxPacingRate_;
+  // When the next paced burst is due, the interval it was scheduled with,
+  // and when the last burst from the pacing timer was written, to report how
+  // accurately the connection is paced.
+  folly::Optional<TimePoint> pacedWriteDueTime_;
+  std::chrono::microseconds pacedWriteInterval_{0us};
+  folly::Optional<TimePoint> lastPacedWriteTime_;
 
   folly::Optional<std::string> exceptionCloseWhat_;
+
+  // Held by the outermost ScopedGuard, for as long as there are any.
+  std::shared_ptr<QuicTransportBase> scopedGuardSelf_;
+  uint32_t scopedGuardDepth_{0};
 };
 
 std::ostream& operator<<(std::ostream& os, const QuicTransportBase& qt);
@@ -15,11 +15,14 @@
 #include <quic/codec/QuicPacketBuilder.h>
 #include <quic/codec/QuicWriteCodec.h>
 #include <quic/codec/Types.h>
+#include <quic/common/SharedEgressBatch.h>
 #include <quic/flowcontrol/QuicFlowController.h>
 #include <quic/happyeyeballs/QuicHappyEyeballsFunctions.h>
 #include <quic/logging/QuicLogger.h>
+#include <quic/state/QuicFecFunctions.h>
 #include <quic/state/QuicStateFunctions.h>
 #include <quic/state/QuicStreamFunctions.h>
+#include <quic/state/QuicTracepoints.h>
 #include <quic/state/SimpleFrameFunctions.h>
 
 namespace {
@@ -89,7 +92,16 @@ uint64_t writeQuicDataToSocketImpl(
     QuicVersion version,
     uint64_t packetLimit,
     bool exceptCryptoStream) {
-  auto builder = ShortHeaderBuilder();
+  if (connection.transportSettings.ackOnlyFastPath &&
+      !connection.pendingEvents.numProbePackets && packetLimit > 0 &&
+      !connection.coalescedPackets &&
+      connection.happyEyeballsState.shouldWriteToFirstSocket &&
+      !connection.happyEyeballsState.shouldWriteToSecondSocket &&
+      toWriteAppDataAcks(connection) &&
+      hasNonAckDataToWrite(connection) == WriteDataReason::NO_WRITE) {
+    return writeAckOnlyPacket(sock, connection, dstConnId, aead, headerCipher);
+  }
+  auto builder = ShortHeaderBuilder(getOneRttWriteKeyPhase(connection));
   // TODO: In FrameScheduler, Retx is prioritized over new data. We should
   // add a flag to the Scheduler to control the priority between them and see
   // which way is better.
@@ -134,7 +146,8 @@ uint64_t writeQuicDataToSocketImpl(
           .resetFrames()
           .windowUpdateFrames()
           .blockedFrames()
-          .simpleFrames();
+          .simpleFrames()
+          .datagramFrames();
   if (!exceptCryptoStream) {
     schedulerBuilder.cryptoFrames();
   }
@@ -152,6 +165,10 @@ uint64_t writeQuicDataToSocketImpl(
       aead,
       headerCipher,
       version);
+  if (written < packetLimit) {
+    written +=
+        writePathMtuProbe(sock, connection, dstConnId, aead, headerCipher);
+  }
   VLOG_IF(10, written > 0) << nodeToString(connection.nodeType)
                            << " written data "
                            << (exceptCryptoStream ? "without crypto data " : "")
@@ -161,6 +178,198 @@ uint64_t writeQuicDataToSocketImpl(
   return written;
 }
 
+/**
+ * Packets built by the chained memory data path whose bodies are not encrypted
+ * yet. They are encrypted together with one Aead::encryptBatch call once
+ * maxSize of them are pending or before the batch is flushed, then header
+ * protected and written in the order they were built.
+ */
+class PendingEncryptBatch {
+ public:
+  PendingEncryptBatch(
+      QuicConnectionStateBase& conn,
+      IOBufQuicBatch& ioBufBatch,
+      const Aead& aead,
+      const PacketNumberCipher& headerCipher,
+      size_t maxSize,
+      bool holdBackPackets)
+      : conn_(conn),
+        ioBufBatch_(ioBufBatch),
+        aead_(aead),
+        headerCipher_(headerCipher),
+        maxSize_(maxSize),
+        holdBackPackets_(holdBackPackets) {
+    entries_.reserve(maxSize_);
+    headers_.reserve(maxSize_);
+    samples_.reserve(maxSize_);
+    masks_.reserve(maxSize_);
+  }
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+  /**
+   * Packets put in conn.coalescedPackets by this batch, less the datagrams of
+   * them written on their own, so that size() plus this plus the packets sent
+   * by the IOBufQuicBatch are the packets built.
+   */
+  int64_t numHeldBack() const {
+    return static_cast<int64_t>(numHeldBack_) -
+        static_cast<int64_t>(numWrittenAlone_);
+  }
+
+  /**
+   * Queues a packet. The body has to have the header's length as headroom and
+   * the cipher overhead as tailroom. Returns false if the packet filled the
+   * batch and writing it failed.
+   */
+  bool add(
+      Buf header,
+      Buf body,
+      HeaderForm headerForm,
+      PacketNum packetNum) {
+    entries_.push_back({std::move(body), header.get(), packetNum});
+    headers_.push_back({std::move(header), headerForm, 0});
+    if (entries_.size() < maxSize_) {
+      return true;
+    }
+    return encryptAndWrite();
+  }
+
+  /**
+   * Encrypts and writes all pending packets. Returns false if a write failed,
+   * in which case the packets after it are dropped.
+   */
+  bool encryptAndWrite() {
+    if (entries_.empty()) {
+      return true;
+    }
+    encryptBodies();
+    bool ret = true;
+    for (size_t i = 0; i < entries_.size() && ret; ++i) {
+      auto& packetBuf = entries_[i].buf;
+      encryptPacketHeader(
+          headers_[i].headerForm,
+          packetBuf->writableData(),
+          headers_[i].headerLen,
+          masks_[i],
+          headerCipher_);
+      auto encodedSize = packetBuf->computeChainDataLength();
+      if (holdBackPackets_) {
+        if (conn_.coalescedPackets) {
+          conn_.coalescedPackets->prependChain(std::move(packetBuf));
+        } else {
+          conn_.coalescedPackets = std::move(packetBuf);
+        }
+        numHeldBack_++;
+        QUIC_STATS(conn_.statsCallback, onWrite, encodedSize);
+        QUIC_STATS(conn_.statsCallback, onPacketSent);
+        continue;
+      }
+      auto datagramSize = encodedSize;
+      if (conn_.coalescedPackets) {
+        // The packets held back go first, a short header packet has to be
+        // the last one in a datagram.
+        datagramSize += conn_.coalescedPackets->computeChainDataLength();
+        conn_.coalescedPackets->prependChain(std::move(packetBuf));
+        packetBuf = std::move(conn_.coalescedPackets);
+      }
+      ret = ioBufBatch_.write(std::move(packetBuf), datagramSize);
+      if (ret) {
+        // update stats and connection
+        QUIC_STATS(conn_.statsCallback, onWrite, encodedSize);
+        QUIC_STATS(conn_.statsCallback, onPacketSent);
+      }
+    }
+    entries_.clear();
+    headers_.clear();
+    return ret;
+  }
+
+  /**
+   * Writes the packets in conn.coalescedPackets as a datagram of their own.
+   */
+  bool writeCoalescedPackets() {
+    if (!conn_.coalescedPackets) {
+      return true;
+    }
+    auto size = conn_.coalescedPackets->computeChainDataLength();
+    numWrittenAlone_++;
+    return ioBufBatch_.write(std::move(conn_.coalescedPackets), size);
+  }
+
+  /**
+   * Writes all pending packets and flushes the batch.
+   */
+  bool flush() {
+    bool ret = encryptAndWrite();
+    return ioBufBatch_.flush() && ret;
+  }
+
+ private:
+  struct PendingHeader {
+    Buf header;
+    HeaderForm headerForm;
+    size_t headerLen{0};
+  };
+
+  /**
+   * Encrypts the pending bodies, moves the headers in front of them and
+   * computes the header protection masks.
+   */
+  void encryptBodies() {
+    CpuTimeScope cpuTimeScope(
+        conn_.cpuTime,
+        conn_.transportSettings.trackCpuTime,
+        CpuTimeCategory::CRYPTO);
+    const auto& settings = conn_.transportSettings;
+    if (conn_.parallelEncryptor && settings.encryptOffloadMinBatchSize > 0 &&
+        entries_.size() >= settings.encryptOffloadMinBatchSize) {
+      conn_.parallelEncryptor->encryptBatch(
+          aead_, folly::range(entries_), settings.encryptOffloadMaxHelpers);
+    } else {
+      aead_.encryptBatch(folly::range(entries_));
+    }
+    // Header protection samples the ciphertext, so the masks of the whole batch
+    // are computed together once it is all encrypted.
+    samples_.clear();
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      auto& packetBuf = entries_[i].buf;
+      auto& header = headers_[i].header;
+      auto headerLen = header->length();
+      DCHECK(packetBuf->headroom() == headerLen);
+      samples_.push_back(getPacketHeaderSample(
+          header->data(), packetBuf->data(), packetBuf->length()));
+      packetBuf->prepend(headerLen);
+      folly::io::Cursor(header.get())
+          .pull(packetBuf->writableData(), headerLen);
+      headers_[i].headerLen = headerLen;
+      if (conn_.bufArena) {
+        // The header has been copied into packetBuf.
+        conn_.bufArena->recycle(std::move(header));
+      }
+    }
+    masks_.resize(samples_.size());
+    headerCipher_.batchMask(folly::range(samples_), folly::range(masks_));
+  }
+
+  QuicConnectionStateBase& conn_;
+  IOBufQuicBatch& ioBufBatch_;
+  const Aead& aead_;
+  const PacketNumberCipher& headerCipher_;
+  size_t maxSize_;
+  // Whether packets go to conn.coalescedPackets instead of the socket.
+  bool holdBackPackets_;
+  uint64_t numHeldBack_{0};
+  uint64_t numWrittenAlone_{0};
+  std::vector<Aead::BatchEntry> entries_;
+  // The associated data of entries_[i] points into headers_[i].
+  std::vector<PendingHeader> headers_;
+  std::vector<Sample> samples_;
+  std::vector<HeaderProtectionMask> masks_;
+};
+
 DataPathResult iobufChainBasedBuildScheduleEncrypt(
     QuicConnectionStateBase& connection,
     PacketHeader header,
@@ -168,20 +377,20 @@ DataPathResult iobufChainBasedBuildScheduleEncrypt(
     PacketNum packetNum,
     uint64_t cipherOverhead,
     QuicPacketScheduler& scheduler,
+    uint32_t packetSizeLimit,
     uint64_t writableBytes,
-    IOBufQuicBatch& ioBufBatch,
-    const Aead& aead,
-    const PacketNumberCipher& headerCipher) {
+    PendingEncryptBatch& pendingEncrypt) {
   RegularQuicPacketBuilder pktBuilder(
-      connection.udpSendPacketLen,
+      packetSizeLimit,
       std::move(header),
-      getAckState(connection, pnSpace).largestAckedByPeer);
+      getAckState(connection, pnSpace).largestAckedByPeer,
+      connection.bufArena);
   pktBuilder.setCipherOverhead(cipherOverhead);
   auto result =
       scheduler.scheduleFramesForPacket(std::move(pktBuilder), writableBytes);
   auto& packet = result.packet;
   if (!packet || packet->packet.frames.empty()) {
-    ioBufBatch.flush();
+    pendingEncrypt.flush();
     if (connection.loopDetectorCallback) {
       connection.writeDebugState.noWriteReason = NoWriteReason::NO_FRAME;
     }
@@ -189,7 +398,7 @@ DataPathResult iobufChainBasedBuildScheduleEncrypt(
   }
   if (!packet->body) {
     // No more space remaining.
-    ioBufBatch.flush();
+    pendingEncrypt.flush();
     if (connection.loopDetectorCallback) {
       connection.writeDebugState.noWriteReason = NoWriteReason::NO_BODY;
     }
@@ -198,30 +407,109 @@ DataPathResult iobufChainBasedBuildScheduleEncrypt(
   packet->header->coalesce();
   auto headerLen = packet->header->length();
   auto bodyLen = packet->body->computeChainDataLength();
+  auto packetLen = headerLen + bodyLen + cipherOverhead;
   auto unencrypted =
-      folly::IOBuf::create(headerLen + bodyLen + aead.getCipherOverhead());
+      (connection.bufArena && packetLen <= connection.bufArena->slabSize())
+      ? connection.bufArena->allocate()
+      : folly::IOBuf::create(packetLen);
   auto bodyCursor = folly::io::Cursor(packet->body.get());
   bodyCursor.pull(unencrypted->writableData() + headerLen, bodyLen);
   unencrypted->advance(headerLen);
   unencrypted->append(bodyLen);
-  auto packetBuf =
-      aead.encrypt(std::move(unencrypted), packet->header.get(), packetNum);
-  DCHECK(packetBuf->headroom() == headerLen);
-  packetBuf->clear();
-  auto headerCursor = folly::io::Cursor(packet->header.get());
-  headerCursor.pull(packetBuf->writableData(), headerLen);
-  packetBuf->append(headerLen + bodyLen + aead.getCipherOverhead());
-
-  HeaderForm headerForm = packet->packet.header.getHeaderForm();
-  encryptPacketHeader(
-      headerForm,
-      packetBuf->writableData(),
-      headerLen,
-      packetBuf->data() + headerLen,
-      packetBuf->length() - headerLen,
-      headerCipher);
-  auto encodedSize = packetBuf->computeChainDataLength();
-  bool ret = ioBufBatch.write(std::move(packetBuf), encodedSize);
+  if (connection.transportSettings.sentPayloadCacheSize > 0 &&
+      pnSpace == PacketNumberSpace::AppData) {
+    // Kept as is, its clones may not need to be rebuilt.
+    addSentPayload(connection, packetNum, std::move(packet->body));
+  } else if (connection.bufArena) {
+    // The body has been copied into unencrypted.
+    connection.bufArena->recycle(std::move(packet->body));
+  }
+  // The header is the associated data, so the batch keeps it until the packet
+  // is encrypted.
+  bool ret = pendingEncrypt.add(
+      std::move(packet->header),
+      std::move(unencrypted),
+      packet->packet.header.getHeaderForm(),
+      packetNum);
+  return DataPathResult::makeWriteResult(ret, std::move(result), packetLen);
+}
+
+DataPathResult continuousMemoryBuildScheduleEncrypt(
+    QuicConnectionStateBase& connection,
+    PacketHeader header,
+    PacketNumberSpace pnSpace,
+    PacketNum packetNum,
+    uint64_t cipherOverhead,
+    QuicPacketScheduler& scheduler,
+    uint64_t writableBytes,
+    IOBufQuicBatch& ioBufBatch,
+    const Aead& aead,
+    const PacketNumberCipher& headerCipher) {
+  auto& bufAccessor = *connection.bufAccessor;
+  auto buf = bufAccessor.obtain();
+  if (buf->tailroom() < connection.udpSendPacketLen + cipherOverhead) {
+    // Not enough room behind the batched packets for another one.
+    bufAccessor.release(std::move(buf));
+    ioBufBatch.flush();
+    buf = bufAccessor.obtain();
+  }
+  auto prevSize = buf->length();
+  bufAccessor.release(std::move(buf));
+
+  InplaceQuicPacketBuilder pktBuilder(
+      bufAccessor,
+      connection.udpSendPacketLen,
+      std::move(header),
+      getAckState(connection, pnSpace).largestAckedByPeer);
+  pktBuilder.setCipherOverhead(cipherOverhead);
+  auto result =
+      scheduler.scheduleFramesForPacket(std::move(pktBuilder), writableBytes);
+  // A scheduler may bail out without building a packet.
+  std::move(pktBuilder).releaseOutputBuffer();
+  auto& packet = result.packet;
+  bool noFrame = !packet || packet->packet.frames.empty();
+  if (noFrame || !packet->body) {
+    // Drop the header and whatever else was written for this packet.
+    buf = bufAccessor.obtain();
+    buf->trimEnd(buf->length() - prevSize);
+    bufAccessor.release(std::move(buf));
+    ioBufBatch.flush();
+    if (connection.loopDetectorCallback) {
+      connection.writeDebugState.noWriteReason =
+          noFrame ? NoWriteReason::NO_FRAME : NoWriteReason::NO_BODY;
+    }
+    return DataPathResult::makeBuildFailure();
+  }
+  auto headerLen = packet->header->length();
+  buf = bufAccessor.obtain();
+  CHECK_EQ(buf->length(), prevSize + headerLen + packet->body->length());
+  // Encrypt the body in place. The header wraps the bytes in front of it,
+  // which are left untouched until header protection below.
+  buf->trimStart(prevSize + headerLen);
+  {
+    CpuTimeScope cpuTimeScope(
+        connection.cpuTime,
+        connection.transportSettings.trackCpuTime,
+        CpuTimeCategory::CRYPTO);
+    const folly::IOBuf* bufPtr = buf.get();
+    buf = aead.inplaceEncrypt(std::move(buf), packet->header.get(), packetNum);
+    CHECK(buf.get() == bufPtr);
+    CHECK_GE(buf->headroom(), prevSize + headerLen);
+    buf->prepend(headerLen);
+
+    HeaderForm headerForm = packet->packet.header.getHeaderForm();
+    encryptPacketHeader(
+        headerForm,
+        buf->writableData(),
+        headerLen,
+        buf->data() + headerLen,
+        buf->length() - headerLen,
+        headerCipher);
+  }
+  auto encodedSize = buf->length();
+  buf->prepend(prevSize);
+  bufAccessor.release(std::move(buf));
+  bool ret = ioBufBatch.write(nullptr, encodedSize);
   if (ret) {
     // update stats and connection
     QUIC_STATS(connection.statsCallback, onWrite, encodedSize);
@@ -230,6 +518,92 @@ DataPathResult iobufChainBasedBuildScheduleEncrypt(
   return DataPathResult::makeWriteResult(ret, std::move(result), encodedSize);
 }
 
+uint32_t getWriteBatchSize(QuicConnectionStateBase& conn, TimePoint now) {
+  const auto& settings = conn.transportSettings;
+  if (!settings.adaptiveBatchSize || settings.maxBatchSize <= 1) {
+    return settings.maxBatchSize;
+  }
+  if (conn.burstTolerance == 0) {
+    conn.burstTolerance = settings.maxBatchSize;
+    conn.burstToleranceUpdateTime = now;
+  } else if (
+      conn.burstTolerance < settings.maxBatchSize &&
+      conn.lossState.srtt > 0us &&
+      now - conn.burstToleranceUpdateTime >= conn.lossState.srtt) {
+    ++conn.burstTolerance;
+    conn.burstToleranceUpdateTime = now;
+  }
+  uint64_t batchSize =
+      std::min<uint64_t>(settings.maxBatchSize, conn.burstTolerance);
+  if (conn.congestionController && conn.udpSendPacketLen > 0) {
+    auto cwndPackets = conn.congestionController->getCongestionWindow() /
+        conn.udpSendPacketLen;
+    batchSize = std::min<uint64_t>(
+        batchSize,
+        std::max<uint64_t>(1, cwndPackets / kAdaptiveBatchCwndFraction));
+  }
+  // The write loop of a pacing tick ends with its burst, and so does the
+  // batch then.
+  if (isConnectionPaced(conn) && !isConnectionPacedByTxTime(conn)) {
+    auto burst = conn.pacer->getCachedWriteBatchSize();
+    if (burst > 0) {
+      auto numBatches = (burst + batchSize - 1) / batchSize;
+      batchSize = (burst + numBatches - 1) / numBatches;
+    }
+  }
+  return folly::to<uint32_t>(std::max<uint64_t>(1, batchSize));
+}
+
+/**
+ * Whether this write loop can build packets straight into the connection's
+ * BufAccessor. This needs a batch writer that understands the buffer layout,
+ * which only exists for no batching and GSO.
+ */
+bool shouldUseContinuousMemory(
+    folly::AsyncUDPSocket& sock,
+    QuicConnectionStateBase& connection,
+    const Aead& aead) {
+  const auto& settings = connection.transportSettings;
+  if (settings.dataPathType != DataPathType::ContinuousMemory ||
+      !connection.bufAccessor || isConnectionPacedByTxTime(connection) ||
+      connection.egressBatch) {
+    return false;
+  }
+  if (settings.batchingMode != QuicBatchingMode::BATCHING_MODE_NONE &&
+      (settings.batchingMode != QuicBatchingMode::BATCHING_MODE_GSO ||
+       sock.getGSO() < 0)) {
+    return false;
+  }
+  auto buf = connection.bufAccessor->obtain();
+  // Nothing should be left behind by a previous write loop, but a socket
+  // error may have thrown out of one. Those packets are lost anyway.
+  buf->clear();
+  bool fits = buf->capacity() >=
+      connection.udpSendPacketLen + aead.getCipherOverhead();
+  connection.bufAccessor->release(std::move(buf));
+  return fits;
+}
+
+void onWriteLoopEnd(
+    QuicConnectionStateBase& connection,
+    WriteLoopEndReason reason,
+    uint64_t packetsWritten,
+    uint64_t batchFlushes) {
+  auto& stats = connection.writeLoopStats;
+  stats.endReasons[static_cast<size_t>(reason)]++;
+  stats.writeLoops++;
+  stats.packetsWritten += packetsWritten;
+  QUIC_STATS(connection.statsCallback, onWriteLoopEnd, reason, packetsWritten);
+  if (connection.qLogger) {
+    connection.qLogger->addWriteLoopEnd(
+        toString(reason), packetsWritten, batchFlushes);
+  }
+  if (reason == WriteLoopEndReason::APP_LIMITED) {
+    // Nothing follows the last packets for a while, so cover them now.
+    flushFecRepair(connection);
+  }
+}
+
 } // namespace
 
 namespace quic {
@@ -340,7 +714,8 @@ void updateConnection(
     folly::Optional<PacketEvent> packetEvent,
     RegularQuicWritePacket packet,
     TimePoint sentTime,
-    uint32_t encodedSize) {
+    uint32_t encodedSize,
+    bool isPathMtuProbe) {
   auto packetNum = packet.header.getPacketSequenceNum();
   bool retransmittable = false; // AckFrame and PaddingFrame are not retx-able.
   bool isHandshake = false;
@@ -353,11 +728,32 @@ void updateConnection(
   if (conn.qLogger) {
     conn.qLogger->addPacket(packet, encodedSize);
   }
+  QUIC_TRACEPOINT(
+      packet_sent,
+      conn,
+      static_cast<uint8_t>(packetNumberSpace),
+      packetNum,
+      encodedSize);
+  if (packetNumberSpace == PacketNumberSpace::Initial) {
+    recordHandshakeTiming(
+        conn.handshakeTimings.firstInitialSent, conn.connectionTime, sentTime);
+  }
+  if (packet.header.getHeaderForm() == HeaderForm::Short) {
+    auto& keyUpdateState = conn.oneRttKeyUpdateState;
+    if (!keyUpdateState.firstPacketInWritePhase) {
+      keyUpdateState.firstPacketInWritePhase = packetNum;
+    }
+    ++keyUpdateState.packetsInWritePhase;
+  }
   for (const auto& frame : packet.frames) {
     switch (frame.type()) {
       case QuicWriteFrame::Type::WriteStreamFrame_E: {
         const WriteStreamFrame& writeStreamFrame = *frame.asWriteStreamFrame();
         retransmittable = true;
+        recordHandshakeTiming(
+            conn.handshakeTimings.firstAppDataSent,
+            conn.connectionTime,
+            sentTime);
         auto stream = CHECK_NOTNULL(
             conn.streamManager->getStream(writeStreamFrame.streamId));
         auto newStreamDataWritten = handleStreamWritten(
@@ -490,6 +886,7 @@ void updateConnection(
         retransmittable = true;
     }
   }
+  onFecSourcePacketSent(conn, packet);
 
   increaseNextPacketNum(conn, packetNumberSpace);
   conn.lossState.largestSent = std::max(conn.lossState.largestSent, packetNum);
@@ -524,6 +921,7 @@ void updateConnection(
   pkt.isAppLimited = conn.congestionController
       ? conn.congestionController->isAppLimited()
       : false;
+  pkt.isPathMtuProbe = isPathMtuProbe;
   if (conn.lossState.lastAckedTime.has_value() &&
       conn.lossState.lastAckedPacketSentTime.has_value()) {
     pkt.lastAckedPacketInfo.emplace(
@@ -616,6 +1014,77 @@ uint64_t unlimitedWritableBytes(const QuicConnectionStateBase&) {
   return std::numeric_limits<uint64_t>::max();
 }
 
+uint64_t writePathMtuProbe(
+    folly::AsyncUDPSocket& sock,
+    QuicConnectionStateBase& connection,
+    const ConnectionId& dstConnId,
+    const Aead& aead,
+    const PacketNumberCipher& headerCipher) {
+  if (connection.pathMtuState.phase != PathMtuState::Phase::Searching) {
+    return 0;
+  }
+  auto now = Clock::now();
+  auto probeSize = getNextPathMtuProbe(connection, now);
+  // The probe counts against the congestion window like any other packet.
+  if (!probeSize || congestionControlWritableBytes(connection) < *probeSize) {
+    return 0;
+  }
+  auto cipherOverhead = aead.getCipherOverhead();
+  auto packetNum = getNextPacketNum(connection, PacketNumberSpace::AppData);
+  ShortHeader header(getOneRttWriteKeyPhase(connection), dstConnId, packetNum);
+  RegularQuicPacketBuilder packetBuilder(
+      *probeSize - cipherOverhead,
+      std::move(header),
+      getAckState(connection, PacketNumberSpace::AppData).largestAckedByPeer);
+  packetBuilder.setCipherOverhead(cipherOverhead);
+  if (writeSimpleFrame(PingFrame(), packetBuilder) == 0) {
+    return 0;
+  }
+  // PADDING frames are single zero bytes, so they are written all at once.
+  auto paddingLen = packetBuilder.remainingSpaceInPkt();
+  if (paddingLen > 0) {
+    auto padding = folly::IOBuf::create(paddingLen);
+    memset(padding->writableData(), 0, paddingLen);
+    padding->append(paddingLen);
+    packetBuilder.insert(std::move(padding));
+    packetBuilder.appendFrame(PaddingFrame());
+  }
+  auto packet = std::move(packetBuilder).buildPacket();
+  packet.header->coalesce();
+  auto body =
+      aead.encrypt(std::move(packet.body), packet.header.get(), packetNum);
+  body->coalesce();
+  encryptPacketHeader(
+      HeaderForm::Short,
+      packet.header->writableData(),
+      packet.header->length(),
+      body->data(),
+      body->length(),
+      headerCipher);
+  auto packetBuf = std::move(packet.header);
+  packetBuf->prependChain(std::move(body));
+  auto packetSize = packetBuf->computeChainDataLength();
+  VLOG(10) << nodeToString(connection.nodeType)
+           << " sent path mtu probe packetNum=" << packetNum
+           << " size=" << packetSize << " " << connection;
+  // A probe that doesn't make it is lost like any other, so there is nothing
+  // to do when the write fails.
+  auto ret = sock.write(connection.peerAddress, packetBuf);
+  if (ret >= 0) {
+    QUIC_STATS(connection.statsCallback, onWrite, ret);
+    QUIC_STATS(connection.statsCallback, onPacketSent);
+  }
+  updateConnection(
+      connection,
+      folly::none,
+      std::move(packet.packet),
+      now,
+      folly::to<uint32_t>(packetSize),
+      true /* isPathMtuProbe */);
+  onPathMtuProbeSent(connection);
+  return 1;
+}
+
 HeaderBuilder LongHeaderBuilder(LongHeader::Types packetType) {
   return [packetType](
              const ConnectionId& srcConnId,
@@ -628,13 +1097,14 @@ HeaderBuilder LongHeaderBuilder(LongHeader::Types packetType) {
   };
 }
 
-HeaderBuilder ShortHeaderBuilder() {
-  return [](const ConnectionId& /* srcConnId */,
-            const ConnectionId& dstConnId,
-            PacketNum packetNum,
-            QuicVersion,
-            const std::string&) {
-    return ShortHeader(ProtectionType::KeyPhaseZero, dstConnId, packetNum);
+HeaderBuilder ShortHeaderBuilder(ProtectionType keyPhase) {
+  return [keyPhase](
+             const ConnectionId& /* srcConnId */,
+             const ConnectionId& dstConnId,
+             PacketNum packetNum,
+             QuicVersion,
+             const std::string&) {
+    return ShortHeader(keyPhase, dstConnId, packetNum);
   };
 }
 
@@ -675,7 +1145,8 @@ uint64_t writeCryptoAndAckDataToSocket(
       cleartextCipher,
       headerCipher,
       version,
-      token);
+      token,
+      connection.transportSettings.coalescePackets);
   VLOG_IF(10, written > 0) << nodeToString(connection.nodeType)
                            << " written crypto and acks data type="
                            << packetType << " packets=" << written << " "
@@ -684,6 +1155,32 @@ uint64_t writeCryptoAndAckDataToSocket(
   return written;
 }
 
+void writeCoalescedPackets(
+    folly::AsyncUDPSocket& sock,
+    QuicConnectionStateBase& connection) {
+  if (!connection.coalescedPackets) {
+    return;
+  }
+  auto batchWriter = BatchWriterFactory::makeBatchWriter(
+      sock,
+      QuicBatchingMode::BATCHING_MODE_NONE,
+      1,
+      DataPathType::ChainedMemory,
+      connection);
+  batchWriter->setBufArena(connection.bufArena);
+  IOBufQuicBatch ioBufBatch(
+      std::move(batchWriter),
+      sock,
+      connection.peerAddress,
+      connection,
+      connection.happyEyeballsState);
+  ioBufBatch.setContinueOnNetworkUnreachable(
+      connection.transportSettings.continueOnNetworkUnreachable);
+  auto size = connection.coalescedPackets->computeChainDataLength();
+  ioBufBatch.write(std::move(connection.coalescedPackets), size);
+  ioBufBatch.flush();
+}
+
 uint64_t writeQuicDataToSocket(
     folly::AsyncUDPSocket& sock,
     QuicConnectionStateBase& connection,
@@ -754,6 +1251,18 @@ uint64_t writeZeroRttDataToSocket(
                     .blockedFrames()
                     .simpleFrames())
           .build();
+  auto zeroRttWritableBytes = [](const QuicConnectionStateBase& conn) {
+    auto writableBytes = congestionControlWritableBytes(conn);
+    auto maxZeroRttBytes = conn.transportSettings.maxZeroRttBytes;
+    if (maxZeroRttBytes == 0) {
+      return writableBytes;
+    }
+    if (conn.zeroRttBytesSent >= maxZeroRttBytes) {
+      return uint64_t(0);
+    }
+    return std::min(writableBytes, maxZeroRttBytes - conn.zeroRttBytesSent);
+  };
+  auto bytesSentBefore = connection.lossState.totalBytesSent;
   auto written = writeConnectionDataToSocket(
       socket,
       connection,
@@ -762,11 +1271,13 @@ uint64_t writeZeroRttDataToSocket(
       std::move(builder),
       LongHeader::typeToPacketNumberSpace(type),
       scheduler,
-      congestionControlWritableBytes,
+      std::move(zeroRttWritableBytes),
       packetLimit,
       aead,
       headerCipher,
       version);
+  connection.zeroRttBytesSent +=
+      connection.lossState.totalBytesSent - bytesSentBefore;
   VLOG_IF(10, written > 0) << nodeToString(connection.nodeType)
                            << " written zero rtt data, packets=" << written
                            << " " << connection;
@@ -862,9 +1373,20 @@ void writeCloseCommon(
   // Increment the sequence number.
   // TODO: Do not increase pn if write fails
   increaseNextPacketNum(connection, pnSpace);
+  if (connection.transportSettings.compactDrainingState) {
+    connection.lastClosePacket = packetBuf->clone();
+  }
+  connection.lossState.totalBytesSent += packetSize;
+  if (connection.egressBatch) {
+    // Goes out with the packets of the other connections, which matters when
+    // many of them close at once.
+    connection.egressBatch->enqueue(
+        sock.getNetworkSocket(), connection.peerAddress, std::move(packetBuf));
+    QUIC_STATS(connection.statsCallback, onWrite, packetSize);
+    return;
+  }
   // best effort writing to the socket, ignore any errors.
   auto ret = sock.write(connection.peerAddress, packetBuf);
-  connection.lossState.totalBytesSent += packetSize;
   if (ret < 0) {
     VLOG(4) << "Error writing connection close " << folly::errnoStr(errno)
             << " " << connection;
@@ -873,6 +1395,60 @@ void writeCloseCommon(
   }
 }
 
+uint64_t writeAckOnlyPacket(
+    folly::AsyncUDPSocket& sock,
+    QuicConnectionStateBase& connection,
+    const ConnectionId& dstConnId,
+    const Aead& aead,
+    const PacketNumberCipher& headerCipher) {
+  auto& ackState = connection.ackStates.appDataAckState;
+  if (!hasAcksToSchedule(ackState)) {
+    return 0;
+  }
+  auto packetNum = getNextPacketNum(connection, PacketNumberSpace::AppData);
+  RegularQuicPacketBuilder packetBuilder(
+      connection.udpSendPacketLen,
+      ShortHeader(getOneRttWriteKeyPhase(connection), dstConnId, packetNum),
+      ackState.largestAckedByPeer);
+  packetBuilder.setCipherOverhead(aead.getCipherOverhead());
+  AckScheduler ackScheduler(connection, ackState);
+  if (!ackScheduler.writeNextAcks(packetBuilder, AckMode::Immediate)) {
+    return 0;
+  }
+  auto packet = std::move(packetBuilder).buildPacket();
+  packet.header->coalesce();
+  auto body =
+      aead.encrypt(std::move(packet.body), packet.header.get(), packetNum);
+  body->coalesce();
+  encryptPacketHeader(
+      HeaderForm::Short,
+      packet.header->writableData(),
+      packet.header->length(),
+      body->data(),
+      body->length(),
+      headerCipher);
+  auto packetBuf = std::move(packet.header);
+  packetBuf->prependChain(std::move(body));
+  auto encodedSize = packetBuf->computeChainDataLength();
+  // As with the scheduled packets, the connection is updated whether or not
+  // the write goes through.
+  updateConnection(
+      connection,
+      folly::none,
+      std::move(packet.packet),
+      Clock::now(),
+      folly::to<uint32_t>(encodedSize));
+  auto ret = sock.write(connection.peerAddress, packetBuf);
+  if (ret < 0) {
+    VLOG(4) << "Error writing ack " << folly::errnoStr(errno) << " "
+            << connection;
+  } else {
+    QUIC_STATS(connection.statsCallback, onWrite, encodedSize);
+    QUIC_STATS(connection.statsCallback, onPacketSent);
+  }
+  return 1;
+}
+
 void writeLongClose(
     folly::AsyncUDPSocket& sock,
     QuicConnectionStateBase& connection,
@@ -912,7 +1488,7 @@ void writeShortClose(
     const Aead& aead,
     const PacketNumberCipher& headerCipher) {
   auto header = ShortHeader(
-      ProtectionType::KeyPhaseZero,
+      getOneRttWriteKeyPhase(connection),
       connId,
       getNextPacketNum(connection, PacketNumberSpace::AppData));
   writeCloseCommon(
@@ -933,6 +1509,25 @@ void encryptPacketHeader(
     const PacketNumberCipher& headerCipher) {
   // Header encryption.
   auto packetNumberLength = parsePacketNumberLength(*header);
+  auto sample = getPacketHeaderSample(header, encryptedBody, bodyLen);
+
+  folly::MutableByteRange initialByteRange(header, 1);
+  folly::MutableByteRange packetNumByteRange(
+      header + headerLen - packetNumberLength, packetNumberLength);
+  if (headerForm == HeaderForm::Short) {
+    headerCipher.encryptShortHeader(
+        sample, initialByteRange, packetNumByteRange);
+  } else {
+    headerCipher.encryptLongHeader(
+        sample, initialByteRange, packetNumByteRange);
+  }
+}
+
+Sample getPacketHeaderSample(
+    const uint8_t* header,
+    const uint8_t* encryptedBody,
+    size_t bodyLen) {
+  auto packetNumberLength = parsePacketNumberLength(*header);
   Sample sample;
   size_t sampleBytesToUse = kMaxPacketNumEncodingSize - packetNumberLength;
   // If there were less than 4 bytes in the packet number, some of the payload
@@ -940,16 +1535,25 @@ void encryptPacketHeader(
   CHECK_GE(bodyLen, sampleBytesToUse + sample.size());
   encryptedBody += sampleBytesToUse;
   memcpy(sample.data(), encryptedBody, sample.size());
+  return sample;
+}
 
+void encryptPacketHeader(
+    HeaderForm headerForm,
+    uint8_t* header,
+    size_t headerLen,
+    const HeaderProtectionMask& headerMask,
+    const PacketNumberCipher& headerCipher) {
+  auto packetNumberLength = parsePacketNumberLength(*header);
   folly::MutableByteRange initialByteRange(header, 1);
   folly::MutableByteRange packetNumByteRange(
       header + headerLen - packetNumberLength, packetNumberLength);
   if (headerForm == HeaderForm::Short) {
-    headerCipher.encryptShortHeader(
-        sample, initialByteRange, packetNumByteRange);
+    headerCipher.encryptShortHeaderWithMask(
+        headerMask, initialByteRange, packetNumByteRange);
   } else {
-    headerCipher.encryptLongHeader(
-        sample, initialByteRange, packetNumByteRange);
+    headerCipher.encryptLongHeaderWithMask(
+        headerMask, initialByteRange, packetNumByteRange);
   }
 }
 
@@ -966,15 +1570,27 @@ uint64_t writeConnectionDataToSocket(
     const Aead& aead,
     const PacketNumberCipher& headerCipher,
     QuicVersion version,
-    const std::string& token) {
+    const std::string& token,
+    bool holdBackPackets) {
   VLOG(10) << nodeToString(connection.nodeType)
            << " writing data using scheduler=" << scheduler.name() << " "
            << connection;
 
+  // Packets are coalesced one at a time, as the room left for each depends on
+  // the ones before it.
+  bool coalescing = holdBackPackets || connection.coalescedPackets;
+  bool useContinuousMemory =
+      !coalescing && shouldUseContinuousMemory(sock, connection, aead);
+  auto batchSize = getWriteBatchSize(connection, Clock::now());
   auto batchWriter = BatchWriterFactory::makeBatchWriter(
       sock,
       connection.transportSettings.batchingMode,
-      connection.transportSettings.maxBatchSize);
+      batchSize,
+      useContinuousMemory ? DataPathType::ContinuousMemory
+                          : DataPathType::ChainedMemory,
+      connection);
+  batchWriter->setBufArena(connection.bufArena);
+  batchWriter->setZeroCopyTracker(connection.zeroCopyTracker);
 
   IOBufQuicBatch ioBufBatch(
       std::move(batchWriter),
@@ -992,26 +1608,68 @@ uint64_t writeConnectionDataToSocket(
       connection.writeDebugState.noWriteReason = NoWriteReason::EMPTY_SCHEDULER;
     }
   }
+  // Without batching every packet is written right away, so there is nothing
+  // to encrypt together.
+  PendingEncryptBatch pendingEncrypt(
+      connection,
+      ioBufBatch,
+      aead,
+      headerCipher,
+      coalescing || connection.transportSettings.batchingMode ==
+              QuicBatchingMode::BATCHING_MODE_NONE
+          ? 1
+          : batchSize,
+      holdBackPackets);
+  // Packets that are built, including the ones still waiting for encryption
+  // or held back.
+  auto pktBuilt = [&]() {
+    return ioBufBatch.getPktSent() + pendingEncrypt.size() +
+        pendingEncrypt.numHeldBack();
+  };
   auto writeLoopBeginTime = Clock::now();
+  auto batchFlushesBefore = connection.writeLoopStats.batchFlushes;
+  auto endWriteLoop = [&](WriteLoopEndReason reason) {
+    if (!holdBackPackets && connection.coalescedPackets) {
+      // Nothing was written for them to go along with.
+      pendingEncrypt.writeCoalescedPackets();
+      ioBufBatch.flush();
+    }
+    onWriteLoopEnd(
+        connection,
+        reason,
+        pktBuilt(),
+        connection.writeLoopStats.batchFlushes - batchFlushesBefore);
+    return pktBuilt();
+  };
   // helper functor to check if we have been write in a loop for longer than the
   // RTT fraction that we are allowed to write. Only kicks in if we have write
   // one batch in batching write mode.
   auto timeLimitHelper = [&]() -> bool {
-    auto batchSize = connection.transportSettings.batchingMode ==
+    uint64_t loopBatchSize = connection.transportSettings.batchingMode ==
             quic::QuicBatchingMode::BATCHING_MODE_NONE
         ? connection.transportSettings.writeConnectionDataPacketsLimit
-        : connection.transportSettings.maxBatchSize;
-    return ioBufBatch.getPktSent() < batchSize ||
-        connection.lossState.srtt == 0us ||
+        : batchSize;
+    return pktBuilt() < loopBatchSize || connection.lossState.srtt == 0us ||
         Clock::now() - writeLoopBeginTime < connection.lossState.srtt /
             connection.transportSettings.writeLimitRttFraction;
   };
-  while (scheduler.hasData() && ioBufBatch.getPktSent() < packetLimit &&
-         timeLimitHelper()) {
+  auto workBudgetLeft = [&]() -> bool {
+    return !connection.loopWorkDeadline || pktBuilt() == 0 ||
+        Clock::now() < *connection.loopWorkDeadline;
+  };
+  while (scheduler.hasData() && pktBuilt() < packetLimit &&
+         timeLimitHelper() && workBudgetLeft()) {
     auto packetNum = getNextPacketNum(connection, pnSpace);
     auto header = builder(srcConnId, dstConnId, packetNum, version, token);
+    // The packets held back take up the front of the datagram.
+    uint32_t packetSizeLimit = connection.udpSendPacketLen;
+    if (connection.coalescedPackets) {
+      packetSizeLimit -= std::min<uint32_t>(
+          packetSizeLimit,
+          connection.coalescedPackets->computeChainDataLength());
+    }
     uint32_t writableBytes = folly::to<uint32_t>(std::min<uint64_t>(
-        connection.udpSendPacketLen, writableBytesFunc(connection)));
+        packetSizeLimit, writableBytesFunc(connection)));
     uint64_t cipherOverhead = aead.getCipherOverhead();
     if (writableBytes < cipherOverhead) {
       writableBytes = 0;
@@ -1019,22 +1677,42 @@ uint64_t writeConnectionDataToSocket(
       writableBytes -= cipherOverhead;
     }
 
-    // TODO: Select a different DataPathFunc based on TransportSettings
-    const auto& dataPlainFunc = iobufChainBasedBuildScheduleEncrypt;
-    auto ret = dataPlainFunc(
-        connection,
-        std::move(header),
-        pnSpace,
-        packetNum,
-        cipherOverhead,
-        scheduler,
-        writableBytes,
-        ioBufBatch,
-        aead,
-        headerCipher);
+    auto ret = useContinuousMemory
+        ? continuousMemoryBuildScheduleEncrypt(
+              connection,
+              std::move(header),
+              pnSpace,
+              packetNum,
+              cipherOverhead,
+              scheduler,
+              writableBytes,
+              ioBufBatch,
+              aead,
+              headerCipher)
+        : iobufChainBasedBuildScheduleEncrypt(
+              connection,
+              std::move(header),
+              pnSpace,
+              packetNum,
+              cipherOverhead,
+              scheduler,
+              packetSizeLimit,
+              writableBytes,
+              pendingEncrypt);
 
+    if (!ret.buildSuccess &&
+        packetSizeLimit < connection.udpSendPacketLen) {
+      // Nothing fit behind the packets held back, so they go on their own
+      // and the packet gets the whole datagram.
+      if (!pendingEncrypt.writeCoalescedPackets() || !ioBufBatch.flush()) {
+        return endWriteLoop(WriteLoopEndReason::SOCKET_ERROR);
+      }
+      continue;
+    }
     if (!ret.buildSuccess) {
-      return ioBufBatch.getPktSent();
+      return endWriteLoop(
+          writableBytes == 0 ? WriteLoopEndReason::CWND_LIMITED
+                             : WriteLoopEndReason::APP_LIMITED);
     }
 
     // If we build a packet, we updateConnection(), even if write might have
@@ -1057,12 +1735,23 @@ uint64_t writeConnectionDataToSocket(
         connection.writeDebugState.noWriteReason =
             NoWriteReason::SOCKET_FAILURE;
       }
-      return ioBufBatch.getPktSent();
+      return endWriteLoop(WriteLoopEndReason::SOCKET_ERROR);
     }
   }
 
-  ioBufBatch.flush();
-  return ioBufBatch.getPktSent();
+  pendingEncrypt.flush();
+  if (!scheduler.hasData()) {
+    return endWriteLoop(WriteLoopEndReason::APP_LIMITED);
+  }
+  if (pktBuilt() >= packetLimit) {
+    return endWriteLoop(
+        isConnectionPaced(connection) ? WriteLoopEndReason::PACING_LIMIT
+                                      : WriteLoopEndReason::PACKET_LIMIT);
+  }
+  if (!workBudgetLeft()) {
+    return endWriteLoop(WriteLoopEndReason::WORK_BUDGET);
+  }
+  return endWriteLoop(WriteLoopEndReason::TIME_LIMIT);
 }
 
 uint64_t writeProbingDataToSocket(
@@ -1151,12 +1840,6 @@ WriteDataReason hasNonAckDataToWrite(const QuicConnectionStateBase& conn) {
   if (!conn.pendingEvents.resets.empty()) {
     return WriteDataReason::RESET;
   }
-  if (conn.streamManager->hasWindowUpdates()) {
-    return WriteDataReason::STREAM_WINDOW_UPDATE;
-  }
-  if (conn.pendingEvents.connWindowUpdate) {
-    return WriteDataReason::CONN_WINDOW_UPDATE;
-  }
   if (conn.streamManager->hasBlocked()) {
     return WriteDataReason::BLOCKED;
   }
@@ -1173,6 +1856,17 @@ WriteDataReason hasNonAckDataToWrite(const QuicConnectionStateBase& conn) {
   if ((conn.pendingEvents.pathChallenge != folly::none)) {
     return WriteDataReason::PATHCHALLENGE;
   }
+  if (!conn.datagramState.writeBuffer.empty()) {
+    return WriteDataReason::DATAGRAM;
+  }
+  // Last, so that the transport can tell when these are all there is to write
+  // and hold them back for something else to carry them.
+  if (conn.streamManager->hasWindowUpdates()) {
+    return WriteDataReason::STREAM_WINDOW_UPDATE;
+  }
+  if (conn.pendingEvents.connWindowUpdate) {
+    return WriteDataReason::CONN_WINDOW_UPDATE;
+  }
   return WriteDataReason::NO_WRITE;
 }
 
@@ -88,7 +88,9 @@ uint64_t writeQuicDataToSocket(
     uint64_t packetLimit);
 
 /**
- * Writes only the crypto and ack frames to the socket.
+ * Writes only the crypto and ack frames to the socket. With
+ * TransportSettings::coalescePackets the packets are held back in
+ * conn.coalescedPackets, to share a datagram with the ones written next.
  *
  * return the number of packets written to socket.
  */
@@ -104,6 +106,30 @@ uint64_t writeCryptoAndAckDataToSocket(
     uint64_t packetLimit,
     const std::string& token = std::string());
 
+/**
+ * Writes one packet of only the app data acks, built straight from the ack
+ * state and written to the socket on its own, without the FrameScheduler and
+ * the write loop. writeQuicDataToSocket() uses it with
+ * TransportSettings::ackOnlyFastPath when the acks are all there is to write.
+ *
+ * return the number of packets written to socket.
+ */
+uint64_t writeAckOnlyPacket(
+    folly::AsyncUDPSocket& sock,
+    QuicConnectionStateBase& connection,
+    const ConnectionId& dstConnId,
+    const Aead& aead,
+    const PacketNumberCipher& headerCipher);
+
+/**
+ * Writes out the packets held back in conn.coalescedPackets, if any, as one
+ * datagram. Writes that hold packets back must be followed by a write of
+ * short header packets or this before the loop ends.
+ */
+void writeCoalescedPackets(
+    folly::AsyncUDPSocket& sock,
+    QuicConnectionStateBase& connection);
+
 /**
  * Writes out all the data streams without writing out crypto streams.
  * This is useful when the crypto stream still needs to be sent in separate
@@ -187,7 +213,8 @@ void updateConnection(
     folly::Optional<PacketEvent> packetEvent,
     RegularQuicWritePacket packet,
     TimePoint time,
-    uint32_t encodedSize);
+    uint32_t encodedSize,
+    bool isPathMtuProbe = false);
 
 /**
  * Returns the minimum available bytes window out of path validation rate
@@ -197,6 +224,15 @@ uint64_t congestionControlWritableBytes(const QuicConnectionStateBase& conn);
 
 uint64_t unlimitedWritableBytes(const QuicConnectionStateBase&);
 
+/**
+ * The number of packets a batch of the connection's next write loop holds.
+ * TransportSettings::maxBatchSize, unless adaptiveBatchSize is set: then no
+ * more than its burst tolerance nor a fraction of its congestion window,
+ * and, when it is paced, the pacer's burst split into even batches so the
+ * last one of a burst isn't a runt.
+ */
+uint32_t getWriteBatchSize(QuicConnectionStateBase& conn, TimePoint now);
+
 void writeCloseCommon(
     folly::AsyncUDPSocket& sock,
     QuicConnectionStateBase& connection,
@@ -246,11 +282,35 @@ void encryptPacketHeader(
     size_t bodyLen,
     const PacketNumberCipher& headerCipher);
 
+/**
+ * Returns the header protection sample of a packet. It will verify whether or
+ * not there are enough bytes to sample from the encryptedBody via a CHECK.
+ */
+Sample getPacketHeaderSample(
+    const uint8_t* header,
+    const uint8_t* encryptedBody,
+    size_t bodyLen);
+
+/**
+ * Encrypts the packet header for the header type, with a mask that was
+ * computed from the packet's sample, e.g. by PacketNumberCipher::batchMask.
+ */
+void encryptPacketHeader(
+    HeaderForm headerForm,
+    uint8_t* header,
+    size_t headerLen,
+    const HeaderProtectionMask& headerMask,
+    const PacketNumberCipher& headerCipher);
+
 /**
  * Writes the connections data to the socket using the header
  * builder as well as the scheduler. This will write the amount of
  * data allowed by the writableBytesFunc and will only write a maximum
  * number of packetLimit packets at each invocation.
+ *
+ * Packets held back in conn.coalescedPackets go out in the datagram of the
+ * first packet written. With holdBackPackets, the packets this writes are
+ * added to them instead of being sent.
  */
 uint64_t writeConnectionDataToSocket(
     folly::AsyncUDPSocket& sock,
@@ -265,7 +325,8 @@ uint64_t writeConnectionDataToSocket(
     const Aead& aead,
     const PacketNumberCipher& headerCipher,
     QuicVersion version,
-    const std::string& token = std::string());
+    const std::string& token = std::string(),
+    bool holdBackPackets = false);
 
 uint64_t writeProbingDataToSocket(
     folly::AsyncUDPSocket& sock,
@@ -280,8 +341,21 @@ uint64_t writeProbingDataToSocket(
     const PacketNumberCipher& headerCipher,
     QuicVersion version);
 
+/**
+ * Writes a path MTU probe, a PING padded to the size getNextPathMtuProbe
+ * picks, if one is due and the congestion window has room for it. Returns the
+ * number of packets written.
+ */
+uint64_t writePathMtuProbe(
+    folly::AsyncUDPSocket& sock,
+    QuicConnectionStateBase& connection,
+    const ConnectionId& dstConnId,
+    const Aead& aead,
+    const PacketNumberCipher& headerCipher);
+
 HeaderBuilder LongHeaderBuilder(LongHeader::Types packetType);
-HeaderBuilder ShortHeaderBuilder();
+HeaderBuilder ShortHeaderBuilder(
+    ProtectionType keyPhase = ProtectionType::KeyPhaseZero);
 
 void maybeSendStreamLimitUpdates(QuicConnectionStateBase& conn);
 
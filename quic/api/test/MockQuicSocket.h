@@ -55,6 +55,13 @@ class MockQuicSocket : public QuicSocket {
       getStreamWriteBufferedBytes,
       folly::Expected<size_t, LocalErrorCode>(StreamId));
   MOCK_CONST_METHOD0(getTransportInfo, QuicSocket::TransportInfo());
+  MOCK_CONST_METHOD0(getBandwidthEstimate, folly::Optional<Bandwidth>());
+  MOCK_CONST_METHOD1(
+      estimateTimeToSend,
+      folly::Optional<std::chrono::microseconds>(uint64_t));
+  MOCK_METHOD2(
+      setBandwidthEstimateCallback,
+      void(BandwidthEstimateCallback*, float));
   MOCK_CONST_METHOD1(
       getStreamTransportInfo,
       folly::Expected<QuicSocket::StreamTransportInfo, LocalErrorCode>(
@@ -119,6 +126,30 @@ class MockQuicSocket : public QuicSocket {
   using ReadResult =
       folly::Expected<std::pair<folly::IOBuf*, bool>, LocalErrorCode>;
   MOCK_METHOD2(readNaked, ReadResult(StreamId, size_t));
+  folly::Expected<std::pair<std::vector<Buf>, bool>, LocalErrorCode>
+  readSlices(StreamId id, size_t maxRead) override {
+    auto res = readSlicesNaked(id, maxRead);
+    if (res.hasError()) {
+      return folly::makeUnexpected(res.error());
+    }
+    std::vector<Buf> slices;
+    for (auto slice : res.value().first) {
+      slices.emplace_back(slice);
+    }
+    return std::make_pair(std::move(slices), res.value().second);
+  }
+  using ReadSlicesResult = folly::Expected<
+      std::pair<std::vector<folly::IOBuf*>, bool>,
+      LocalErrorCode>;
+  MOCK_METHOD2(readSlicesNaked, ReadSlicesResult(StreamId, size_t));
+  MOCK_METHOD2(
+      setReadBuffer,
+      folly::Expected<folly::Unit, LocalErrorCode>(
+          StreamId,
+          folly::MutableByteRange));
+  using TakeReadBufferResult =
+      folly::Expected<std::pair<size_t, bool>, LocalErrorCode>;
+  MOCK_METHOD1(takeReadBuffer, TakeReadBufferResult(StreamId));
   MOCK_METHOD1(
       createBidirectionalStream,
       folly::Expected<StreamId, LocalErrorCode>(bool));
@@ -158,6 +189,46 @@ class MockQuicSocket : public QuicSocket {
   MOCK_METHOD5(
       writeChain,
       WriteResult(StreamId, SharedBuf, bool, bool, DeliveryCallback*));
+  std::vector<folly::Optional<LocalErrorCode>> writeMany(
+      std::vector<StreamWrite> writes) override {
+    std::vector<folly::Optional<LocalErrorCode>> errors;
+    for (auto& write : writes) {
+      auto res = writeChain(
+          write.id, std::move(write.data), write.eof, false, write.cb);
+      errors.push_back(
+          res.hasError() ? folly::Optional<LocalErrorCode>(res.error())
+                         : folly::none);
+    }
+    return errors;
+  }
+  folly::Expected<Buf, LocalErrorCode> writeExternal(
+      StreamId id,
+      folly::ByteRange data,
+      folly::Function<void()> onRelease,
+      bool eof,
+      bool cork,
+      DeliveryCallback* cb) override {
+    auto res = writeExternalNaked(id, data, eof, cork, cb);
+    // Nothing references the data once the mock returns.
+    onRelease();
+    if (res.hasError()) {
+      return folly::makeUnexpected(res.error());
+    } else {
+      return Buf(res.value());
+    }
+  }
+  MOCK_METHOD5(
+      writeExternalNaked,
+      WriteResult(StreamId, folly::ByteRange, bool, bool, DeliveryCallback*));
+  MOCK_METHOD6(
+      writeFile,
+      folly::Expected<folly::Unit, LocalErrorCode>(
+          StreamId,
+          int,
+          off_t,
+          size_t,
+          bool,
+          DeliveryCallback*));
   MOCK_METHOD3(
       registerDeliveryCallback,
       folly::Expected<folly::Unit, LocalErrorCode>(
@@ -175,11 +246,55 @@ class MockQuicSocket : public QuicSocket {
       maybeResetStreamFromReadError,
       folly::Expected<folly::Unit, LocalErrorCode>(StreamId, QuicErrorCode));
   MOCK_METHOD2(sendPing, void(PingCallback*, std::chrono::milliseconds));
+  MOCK_METHOD1(setCork, void(bool));
+  MOCK_METHOD0(flush, void());
+  MOCK_METHOD1(
+      setDatagramCallback,
+      folly::Expected<folly::Unit, LocalErrorCode>(DatagramCallback*));
+  MOCK_METHOD1(
+      setBatchedStreamCallback,
+      folly::Expected<folly::Unit, LocalErrorCode>(BatchedStreamCallback*));
+  MOCK_CONST_METHOD0(getDatagramSizeLimit, uint16_t());
+  folly::Expected<folly::Unit, LocalErrorCode> writeDatagram(
+      Buf data) override {
+    SharedBuf sharedData(data.release());
+    return writeDatagram(sharedData);
+  }
+  MOCK_METHOD1(
+      writeDatagram,
+      folly::Expected<folly::Unit, LocalErrorCode>(SharedBuf));
+  folly::Expected<std::vector<Buf>, LocalErrorCode> readDatagrams(
+      size_t atMost) override {
+    auto res = readDatagramsNaked(atMost);
+    if (res.hasError()) {
+      return folly::makeUnexpected(res.error());
+    }
+    std::vector<Buf> datagrams;
+    for (auto datagram : res.value()) {
+      datagrams.emplace_back(datagram);
+    }
+    return datagrams;
+  }
+  using ReadDatagramsResult =
+      folly::Expected<std::vector<folly::IOBuf*>, LocalErrorCode>;
+  MOCK_METHOD1(readDatagramsNaked, ReadDatagramsResult(size_t));
   MOCK_CONST_METHOD0(getState, const QuicConnectionStateBase*());
   MOCK_METHOD0(isDetachable, bool());
   MOCK_METHOD1(attachEventBase, void(folly::EventBase*));
   MOCK_METHOD0(detachEventBase, void());
   MOCK_METHOD1(setControlStream, folly::Optional<LocalErrorCode>(StreamId));
+  MOCK_METHOD3(
+      setStreamPriority,
+      folly::Expected<folly::Unit, LocalErrorCode>(
+          StreamId,
+          PriorityUrgency,
+          bool));
+  MOCK_METHOD1(
+      getStreamPriority,
+      folly::Expected<Priority, LocalErrorCode>(StreamId));
+  MOCK_METHOD2(
+      setStreamEarlyData,
+      folly::Expected<folly::Unit, LocalErrorCode>(StreamId, bool));
 
   MOCK_METHOD2(
       setPeekCallback,
@@ -223,6 +338,12 @@ class MockQuicSocket : public QuicSocket {
           StreamId,
           uint64_t offset));
 
+  MOCK_METHOD2(
+      setStreamWriteTimeToLive,
+      folly::Expected<folly::Unit, LocalErrorCode>(
+          StreamId,
+          folly::Optional<std::chrono::milliseconds>));
+
   MOCK_METHOD2(
       setDataRejectedCallback,
       folly::Expected<folly::Unit, LocalErrorCode>(
@@ -236,6 +357,9 @@ class MockQuicSocket : public QuicSocket {
           uint64_t offset));
 
   MOCK_METHOD1(setCongestionControl, void(CongestionControlType));
+  MOCK_METHOD1(
+      setMaxPacingRate,
+      folly::Expected<folly::Unit, LocalErrorCode>(folly::Optional<uint64_t>));
 
   ConnectionCallback* cb_;
 
@@ -133,6 +133,36 @@ class MockDataRejectedCallback : public QuicSocket::DataRejectedCallback {
   GMOCK_METHOD2_(, noexcept, , onDataRejected, void(StreamId, uint64_t));
 };
 
+class MockDatagramCallback : public QuicSocket::DatagramCallback {
+ public:
+  ~MockDatagramCallback() override = default;
+  GMOCK_METHOD0_(, noexcept, , onDatagramsAvailable, void());
+};
+
+class MockBatchedStreamCallback : public QuicSocket::BatchedStreamCallback {
+ public:
+  ~MockBatchedStreamCallback() override = default;
+  GMOCK_METHOD1_(
+      ,
+      noexcept,
+      ,
+      onStreamsReadable,
+      void(const std::vector<StreamId>&));
+  GMOCK_METHOD2_(
+      ,
+      noexcept,
+      ,
+      onDeliveryAcks,
+      void(const std::vector<DeliveryAck>&, std::chrono::microseconds));
+};
+
+class MockBandwidthEstimateCallback
+    : public QuicSocket::BandwidthEstimateCallback {
+ public:
+  ~MockBandwidthEstimateCallback() override = default;
+  GMOCK_METHOD1_(, noexcept, , onBandwidthEstimateChanged, void(Bandwidth));
+};
+
 class MockQuicTransport : public QuicServerTransport {
  public:
   using Ptr = std::shared_ptr<MockQuicTransport>;
@@ -190,6 +220,13 @@ class MockQuicTransport : public QuicServerTransport {
 
   GMOCK_METHOD1_(, noexcept, , setPacingTimer, void(TimerHighRes::SharedPtr));
 
+  GMOCK_METHOD1_(
+      ,
+      noexcept,
+      ,
+      setPacingScheduler,
+      void(PacingScheduler::SharedPtr));
+
   void onNetworkData(
       const folly::SocketAddress& peer,
       NetworkData&& networkData) noexcept override {
@@ -261,6 +298,25 @@ class MockQuicTransport : public QuicServerTransport {
       void(QuicTransportStatsCallback*));
 
   GMOCK_METHOD1_(, noexcept, , setConnectionIdAlgo, void(ConnectionIdAlgo*));
+
+  GMOCK_METHOD1_(, noexcept, , setBufAccessor, void(BufAccessor*));
+
+  GMOCK_METHOD1_(, noexcept, , setPacketBufArena, void(PacketBufArena*));
+
+  GMOCK_METHOD1_(, noexcept, , setEgressBatch, void(SharedEgressBatch*));
+
+  GMOCK_METHOD1_(
+      ,
+      noexcept,
+      ,
+      setConnectedSocketFactory,
+      void(QuicUDPSocketFactory*));
+
+  MOCK_METHOD0(isDetachable, bool());
+
+  MOCK_METHOD0(detachEventBase, void());
+
+  MOCK_METHOD1(attachEventBase, void(folly::EventBase*));
 };
 
 class MockLoopDetectorCallback : public LoopDetectorCallback {
@@ -270,6 +326,7 @@ class MockLoopDetectorCallback : public LoopDetectorCallback {
       onSuspiciousWriteLoops,
       void(uint64_t, WriteDataReason, NoWriteReason, const std::string&));
   MOCK_METHOD2(onSuspiciousReadLoops, void(uint64_t, NoReadReason));
+  MOCK_METHOD3(onHotLoop, void(uint64_t, uint64_t, HotLoopMitigation));
 };
 
 inline std::ostream& operator<<(std::ostream& os, const MockQuicTransport&) {
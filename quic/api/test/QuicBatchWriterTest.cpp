@@ -9,6 +9,7 @@
 #include <quic/api/QuicBatchWriter.h>
 
 #include <gtest/gtest.h>
+#include <quic/state/test/Mocks.h>
 
 namespace quic {
 namespace testing {
@@ -269,5 +270,287 @@ TEST(QuicBatchWriter, TestBatchingSendmmsgGSOBatcBigSmallPacket) {
   }
 }
 
+TEST(QuicBatchWriter, ResetRecyclesIntoArena) {
+  folly::EventBase evb;
+  folly::AsyncUDPSocket sock(&evb);
+  sock.setReuseAddr(false);
+  sock.bind(folly::SocketAddress("127.0.0.1", 0));
+  PacketBufArena arena(kStrLen, kBatchNum);
+
+  auto batchWriter = quic::BatchWriterFactory::makeBatchWriter(
+      sock, quic::QuicBatchingMode::BATCHING_MODE_SENDMMSG, kBatchNum);
+  CHECK(batchWriter);
+  batchWriter->setBufArena(&arena);
+  for (size_t i = 0; i < kBatchNum; i++) {
+    auto buf = arena.allocate();
+    buf->append(kStrLen);
+    batchWriter->append(std::move(buf), kStrLen);
+  }
+  EXPECT_EQ(0, arena.numCachedSlabs());
+  batchWriter->reset();
+  EXPECT_TRUE(batchWriter->empty());
+  EXPECT_EQ(kBatchNum, arena.numCachedSlabs());
+}
+
+TEST(QuicBatchWriter, InplaceWriterNeedsFlush) {
+  folly::EventBase evb;
+  folly::AsyncUDPSocket sock(&evb);
+  sock.setReuseAddr(false);
+  sock.bind(folly::SocketAddress("127.0.0.1", 0));
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  SimpleBufAccessor bufAccessor(kStrLen * kBatchNum * 2);
+  conn.bufAccessor = &bufAccessor;
+
+  auto batchWriter = quic::BatchWriterFactory::makeBatchWriter(
+      sock,
+      quic::QuicBatchingMode::BATCHING_MODE_GSO,
+      kBatchNum,
+      DataPathType::ContinuousMemory,
+      conn);
+  CHECK(batchWriter);
+  // only if GSO is available
+  if (sock.getGSO() >= 0) {
+    EXPECT_TRUE(batchWriter->empty());
+    EXPECT_FALSE(batchWriter->needsFlush(kStrLen));
+    auto buf = bufAccessor.obtain();
+    buf->append(kStrLen);
+    bufAccessor.release(std::move(buf));
+    EXPECT_FALSE(batchWriter->append(nullptr, kStrLen));
+    EXPECT_EQ(kStrLen, batchWriter->size());
+    EXPECT_FALSE(batchWriter->needsFlush(kStrLen));
+    EXPECT_TRUE(batchWriter->needsFlush(kStrLenGT));
+  }
+}
+
+TEST(QuicBatchWriter, InplaceWriterAppendLimit) {
+  folly::EventBase evb;
+  folly::AsyncUDPSocket sock(&evb);
+  sock.setReuseAddr(false);
+  sock.bind(folly::SocketAddress("127.0.0.1", 0));
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  SimpleBufAccessor bufAccessor(kStrLen * kBatchNum * 2);
+  conn.bufAccessor = &bufAccessor;
+
+  auto batchWriter = quic::BatchWriterFactory::makeBatchWriter(
+      sock,
+      quic::QuicBatchingMode::BATCHING_MODE_GSO,
+      kBatchNum,
+      DataPathType::ContinuousMemory,
+      conn);
+  CHECK(batchWriter);
+  // only if GSO is available
+  if (sock.getGSO() >= 0) {
+    for (size_t i = 0; i < kBatchNum - 1; i++) {
+      auto buf = bufAccessor.obtain();
+      buf->append(kStrLen);
+      bufAccessor.release(std::move(buf));
+      EXPECT_FALSE(batchWriter->append(nullptr, kStrLen));
+    }
+    auto buf = bufAccessor.obtain();
+    buf->append(kStrLen);
+    bufAccessor.release(std::move(buf));
+    EXPECT_TRUE(batchWriter->append(nullptr, kStrLen));
+    EXPECT_EQ(kStrLen * kBatchNum, batchWriter->size());
+  }
+}
+
+TEST(QuicBatchWriter, InplaceWriterAppendSmaller) {
+  folly::EventBase evb;
+  folly::AsyncUDPSocket sock(&evb);
+  sock.setReuseAddr(false);
+  sock.bind(folly::SocketAddress("127.0.0.1", 0));
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  SimpleBufAccessor bufAccessor(kStrLen * kBatchNum * 2);
+  conn.bufAccessor = &bufAccessor;
+
+  auto batchWriter = quic::BatchWriterFactory::makeBatchWriter(
+      sock,
+      quic::QuicBatchingMode::BATCHING_MODE_GSO,
+      kBatchNum,
+      DataPathType::ContinuousMemory,
+      conn);
+  CHECK(batchWriter);
+  // only if GSO is available
+  if (sock.getGSO() >= 0) {
+    auto buf = bufAccessor.obtain();
+    buf->append(kStrLen);
+    bufAccessor.release(std::move(buf));
+    EXPECT_FALSE(batchWriter->append(nullptr, kStrLen));
+    buf = bufAccessor.obtain();
+    buf->append(kStrLenLT);
+    bufAccessor.release(std::move(buf));
+    EXPECT_TRUE(batchWriter->append(nullptr, kStrLenLT));
+    EXPECT_EQ(kStrLen + kStrLenLT, batchWriter->size());
+  }
+}
+
+TEST(QuicBatchWriter, InplaceWriterResetKeepsLeftover) {
+  folly::EventBase evb;
+  folly::AsyncUDPSocket sock(&evb);
+  sock.setReuseAddr(false);
+  sock.bind(folly::SocketAddress("127.0.0.1", 0));
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  SimpleBufAccessor bufAccessor(kStrLen * kBatchNum * 2);
+  conn.bufAccessor = &bufAccessor;
+
+  auto batchWriter = quic::BatchWriterFactory::makeBatchWriter(
+      sock,
+      quic::QuicBatchingMode::BATCHING_MODE_GSO,
+      kBatchNum,
+      DataPathType::ContinuousMemory,
+      conn);
+  CHECK(batchWriter);
+  // only if GSO is available
+  if (sock.getGSO() >= 0) {
+    auto buf = bufAccessor.obtain();
+    memset(buf->writableTail(), 'A', kStrLen);
+    buf->append(kStrLen);
+    bufAccessor.release(std::move(buf));
+    EXPECT_FALSE(batchWriter->append(nullptr, kStrLen));
+    // A bigger packet shows up after the batched one.
+    buf = bufAccessor.obtain();
+    memset(buf->writableTail(), 'B', kStrLenGT);
+    buf->append(kStrLenGT);
+    bufAccessor.release(std::move(buf));
+    EXPECT_TRUE(batchWriter->needsFlush(kStrLenGT));
+    batchWriter->reset();
+    EXPECT_TRUE(batchWriter->empty());
+    buf = bufAccessor.obtain();
+    EXPECT_EQ(kStrLenGT, buf->length());
+    EXPECT_EQ(std::string(kStrLenGT, 'B'), buf->moveToFbString().toStdString());
+  }
+}
+
+TEST(QuicBatchWriter, InplaceWriterFallback) {
+  folly::EventBase evb;
+  folly::AsyncUDPSocket sock(&evb);
+  sock.setReuseAddr(false);
+  sock.bind(folly::SocketAddress("127.0.0.1", 0));
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+
+  // Without a BufAccessor we get a regular writer that takes IOBufs.
+  auto batchWriter = quic::BatchWriterFactory::makeBatchWriter(
+      sock,
+      quic::QuicBatchingMode::BATCHING_MODE_NONE,
+      kBatchNum,
+      DataPathType::ContinuousMemory,
+      conn);
+  CHECK(batchWriter);
+  auto buf = folly::IOBuf::copyBuffer(std::string(kStrLen, 'A'));
+  EXPECT_TRUE(batchWriter->append(std::move(buf), kStrLen));
+  EXPECT_EQ(kStrLen, batchWriter->size());
+}
+
+TEST(QuicBatchWriter, TxTimeWriterStampsEachPacket) {
+  folly::EventBase evb;
+  folly::AsyncUDPSocket sock(&evb);
+  sock.setReuseAddr(false);
+  sock.bind(folly::SocketAddress("127.0.0.1", 0));
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  conn.transportSettings.pacingEnabled = true;
+  conn.transportSettings.pacingUsesTxTime = true;
+  conn.canBePaced = true;
+  auto mockPacer = std::make_unique<quic::test::MockPacer>();
+  auto rawPacer = mockPacer.get();
+  conn.pacer = std::move(mockPacer);
+
+  auto batchWriter = quic::BatchWriterFactory::makeBatchWriter(
+      sock,
+      quic::QuicBatchingMode::BATCHING_MODE_GSO,
+      kBatchNum,
+      DataPathType::ContinuousMemory,
+      conn);
+  CHECK(batchWriter);
+  EXPECT_NE(
+      nullptr, dynamic_cast<TxTimePacketBatchWriter*>(batchWriter.get()));
+  std::string strTest(kStrLen, 'A');
+  EXPECT_CALL(*rawPacer, getDepartureTime(::testing::_, kStrLen))
+      .Times(kBatchNum)
+      .WillRepeatedly(::testing::Return(Clock::now()));
+  for (auto j = 0; j < kBatchNum - 1; j++) {
+    EXPECT_FALSE(
+        batchWriter->append(folly::IOBuf::copyBuffer(strTest), kStrLen));
+  }
+  EXPECT_TRUE(batchWriter->append(folly::IOBuf::copyBuffer(strTest), kStrLen));
+  EXPECT_EQ(kStrLen * kBatchNum, batchWriter->size());
+  batchWriter->reset();
+  EXPECT_TRUE(batchWriter->empty());
+}
+
+TEST(QuicBatchWriter, SharedEgressWriterDefersToLoop) {
+  folly::EventBase evb;
+  folly::AsyncUDPSocket sock(&evb);
+  sock.setReuseAddr(false);
+  sock.bind(folly::SocketAddress("127.0.0.1", 0));
+  std::vector<std::unique_ptr<folly::AsyncUDPSocket>> peers;
+  for (auto j = 0; j < 2; j++) {
+    peers.push_back(std::make_unique<folly::AsyncUDPSocket>(&evb));
+    peers.back()->bind(folly::SocketAddress("127.0.0.1", 0));
+  }
+  SharedEgressBatch egressBatch(&evb);
+  QuicConnectionStateBase conn(QuicNodeType::Server);
+  conn.egressBatch = &egressBatch;
+
+  auto batchWriter = quic::BatchWriterFactory::makeBatchWriter(
+      sock,
+      quic::QuicBatchingMode::BATCHING_MODE_SENDMMSG,
+      kBatchNum,
+      DataPathType::ChainedMemory,
+      conn);
+  CHECK(batchWriter);
+  EXPECT_NE(
+      nullptr,
+      dynamic_cast<SharedEgressPacketBatchWriter*>(batchWriter.get()));
+  std::string strTest(kStrLen, 'A');
+  for (auto& peer : peers) {
+    EXPECT_TRUE(
+        batchWriter->append(folly::IOBuf::copyBuffer(strTest), kStrLen));
+    EXPECT_EQ(kStrLen, batchWriter->write(sock, peer->address()));
+    batchWriter->reset();
+  }
+  EXPECT_EQ(2, egressBatch.numPending());
+
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_EQ(0, egressBatch.numPending());
+  EXPECT_EQ(0, egressBatch.numDropped());
+  for (auto& peer : peers) {
+    char buf[kStrLenGT];
+    EXPECT_EQ(
+        kStrLen,
+        ::recv(
+            peer->getNetworkSocket().toFd(), buf, sizeof(buf), MSG_DONTWAIT));
+  }
+}
+
+TEST(QuicBatchWriter, SharedEgressBatchFlushesOnOtherFd) {
+  folly::EventBase evb;
+  std::vector<std::unique_ptr<folly::AsyncUDPSocket>> socks;
+  for (auto j = 0; j < 3; j++) {
+    socks.push_back(std::make_unique<folly::AsyncUDPSocket>(&evb));
+    socks.back()->bind(folly::SocketAddress("127.0.0.1", 0));
+  }
+  auto& peer = *socks[2];
+  SharedEgressBatch egressBatch(&evb, kBatchNum);
+  std::string strTest(kStrLen, 'A');
+  egressBatch.enqueue(
+      socks[0]->getNetworkSocket(),
+      peer.address(),
+      folly::IOBuf::copyBuffer(strTest));
+  egressBatch.enqueue(
+      socks[1]->getNetworkSocket(),
+      peer.address(),
+      folly::IOBuf::copyBuffer(strTest));
+  EXPECT_EQ(1, egressBatch.numPending());
+  for (auto j = 0; j < kBatchNum - 1; j++) {
+    egressBatch.enqueue(
+        socks[1]->getNetworkSocket(),
+        peer.address(),
+        folly::IOBuf::copyBuffer(strTest));
+  }
+  // Full.
+  EXPECT_EQ(0, egressBatch.numPending());
+  EXPECT_EQ(0, egressBatch.numDropped());
+}
+
 } // namespace testing
 } // namespace quic
@@ -709,7 +709,42 @@ TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerAllFit) {
       folly::IOBuf::copyBuffer("some data"),
       false);
   scheduler.writeStreams(builder);
-  EXPECT_EQ(conn.schedulingState.nextScheduledStream, 0);
+  EXPECT_EQ(
+      conn.streamManager->writableStreams()
+          .level(kDefaultPriority)
+          .getNextScheduled(),
+      0);
+}
+
+TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerEarlyData) {
+  QuicClientConnectionState conn(
+      FizzClientQuicHandshakeContext::Builder().build());
+  conn.streamManager->setMaxLocalBidirectionalStreams(10);
+  conn.flowControlState.peerAdvertisedMaxOffset = 100000;
+  conn.flowControlState.peerAdvertisedInitialMaxStreamOffsetBidiRemote = 100000;
+  auto connId = getTestConnectionId();
+  StreamFrameScheduler scheduler(conn, true /* earlyData */);
+  LongHeader header(
+      LongHeader::Types::ZeroRtt,
+      getTestConnectionId(1),
+      connId,
+      getNextPacketNum(conn, PacketNumberSpace::AppData),
+      QuicVersion::MVFST);
+  RegularQuicPacketBuilder builder(
+      conn.udpSendPacketLen,
+      std::move(header),
+      conn.ackStates.appDataAckState.largestAckedByPeer);
+  auto stream1 = conn.streamManager->createNextBidirectionalStream().value();
+  auto stream2 = conn.streamManager->createNextBidirectionalStream().value();
+  stream1->earlyDataAllowed = false;
+  writeDataToQuicStream(*stream1, folly::IOBuf::copyBuffer("not safe"), false);
+  writeDataToQuicStream(*stream2, folly::IOBuf::copyBuffer("safe"), false);
+  scheduler.writeStreams(builder);
+  auto packet = std::move(builder).buildPacket().packet;
+  ASSERT_EQ(1, packet.frames.size());
+  auto& frame = *packet.frames[0].asWriteStreamFrame();
+  EXPECT_EQ(stream2->id, frame.streamId);
+  EXPECT_EQ(4, frame.len);
 }
 
 TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerRoundRobin) {
@@ -751,10 +786,16 @@ TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerRoundRobin) {
       *conn.streamManager->findStream(stream3),
       folly::IOBuf::copyBuffer("some data"),
       false);
-  // Force the wraparound initially.
-  conn.schedulingState.nextScheduledStream = stream3 + 8;
+  // Not a writable stream, so writing starts from the first writable one.
+  conn.streamManager->writableStreams()
+      .level(kDefaultPriority)
+      .setNextScheduled(stream3 + 8);
   scheduler.writeStreams(builder1);
-  EXPECT_EQ(conn.schedulingState.nextScheduledStream, 4);
+  EXPECT_EQ(
+      conn.streamManager->writableStreams()
+          .level(kDefaultPriority)
+          .getNextScheduled(),
+      4);
 
   // Should write frames for stream2, stream3, followed by stream1 again.
   NiceMock<MockQuicPacketBuilder> builder2;
@@ -776,6 +817,50 @@ TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerRoundRobin) {
   EXPECT_EQ(*frames[2].asWriteStreamFrame(), f3);
 }
 
+TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerQuantum) {
+  QuicClientConnectionState conn(
+      FizzClientQuicHandshakeContext::Builder().build());
+  conn.transportSettings.streamSchedulingQuantum = 100;
+  conn.streamManager->setMaxLocalBidirectionalStreams(10);
+  conn.flowControlState.peerAdvertisedMaxOffset = 100000;
+  conn.flowControlState.peerAdvertisedInitialMaxStreamOffsetBidiRemote = 100000;
+  StreamFrameScheduler scheduler(conn);
+  auto stream1 = conn.streamManager->createNextBidirectionalStream().value();
+  auto stream2 = conn.streamManager->createNextBidirectionalStream().value();
+  auto stream3 = conn.streamManager->createNextBidirectionalStream().value();
+  writeDataToQuicStream(*stream1, buildRandomInputData(1000), false);
+  writeDataToQuicStream(*stream2, buildRandomInputData(150), false);
+  writeDataToQuicStream(*stream3, buildRandomInputData(1000), false);
+
+  // Each stream writes a quantum, except for the last one of the round which
+  // fills the rest of the packet.
+  NiceMock<MockQuicPacketBuilder> builder;
+  EXPECT_CALL(builder, remainingSpaceInPkt()).WillRepeatedly(Return(4096));
+  EXPECT_CALL(builder, appendFrame(_)).WillRepeatedly(Invoke([&](auto f) {
+    builder.frames_.push_back(f);
+  }));
+  scheduler.writeStreams(builder);
+  auto& frames = builder.frames_;
+  ASSERT_EQ(frames.size(), 3);
+  WriteStreamFrame f1(stream1->id, 0, 100, false);
+  WriteStreamFrame f2(stream2->id, 0, 100, false);
+  WriteStreamFrame f3(stream3->id, 0, 1000, false);
+  ASSERT_TRUE(frames[0].asWriteStreamFrame());
+  EXPECT_EQ(*frames[0].asWriteStreamFrame(), f1);
+  ASSERT_TRUE(frames[1].asWriteStreamFrame());
+  EXPECT_EQ(*frames[1].asWriteStreamFrame(), f2);
+  ASSERT_TRUE(frames[2].asWriteStreamFrame());
+  EXPECT_EQ(*frames[2].asWriteStreamFrame(), f3);
+  EXPECT_EQ(0, stream1->sendQuantumLeft);
+  EXPECT_EQ(0, stream2->sendQuantumLeft);
+  EXPECT_EQ(0, stream3->sendQuantumLeft);
+  EXPECT_EQ(
+      conn.streamManager->writableStreams()
+          .level(kDefaultPriority)
+          .getNextScheduled(),
+      stream1->id);
+}
+
 TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerRoundRobinControl) {
   QuicClientConnectionState conn(
       FizzClientQuicHandshakeContext::Builder().build());
@@ -825,11 +910,18 @@ TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerRoundRobinControl) {
       *conn.streamManager->findStream(stream4),
       folly::IOBuf::copyBuffer("some data"),
       false);
-  // Force the wraparound initially.
-  conn.schedulingState.nextScheduledStream = stream4 + 8;
+  // Not a writable stream, so writing starts from the first writable one.
+  conn.streamManager->writableStreams()
+      .level(kDefaultPriority)
+      .setNextScheduled(stream4 + 8);
   scheduler.writeStreams(builder1);
-  EXPECT_EQ(conn.schedulingState.nextScheduledStream, stream3);
-  EXPECT_EQ(conn.schedulingState.nextScheduledControlStream, stream2);
+  EXPECT_EQ(
+      conn.streamManager->writableStreams()
+          .level(kDefaultPriority)
+          .getNextScheduled(),
+      stream3);
+  EXPECT_EQ(
+      conn.streamManager->writableControlStreams().getNextScheduled(), stream2);
 
   // Should write frames for stream2, stream4, followed by stream 3 then 1.
   NiceMock<MockQuicPacketBuilder> builder2;
@@ -853,8 +945,209 @@ TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerRoundRobinControl) {
   ASSERT_TRUE(frames[3].asWriteStreamFrame());
   EXPECT_EQ(*frames[3].asWriteStreamFrame(), f4);
 
-  EXPECT_EQ(conn.schedulingState.nextScheduledStream, stream3);
-  EXPECT_EQ(conn.schedulingState.nextScheduledControlStream, stream2);
+  EXPECT_EQ(
+      conn.streamManager->writableStreams()
+          .level(kDefaultPriority)
+          .getNextScheduled(),
+      stream3);
+  EXPECT_EQ(
+      conn.streamManager->writableControlStreams().getNextScheduled(), stream2);
+}
+
+TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerUrgency) {
+  QuicClientConnectionState conn(
+      FizzClientQuicHandshakeContext::Builder().build());
+  conn.streamManager->setMaxLocalBidirectionalStreams(10);
+  conn.flowControlState.peerAdvertisedMaxOffset = 100000;
+  conn.flowControlState.peerAdvertisedInitialMaxStreamOffsetBidiRemote = 100000;
+  StreamFrameScheduler scheduler(conn);
+  auto stream1 = conn.streamManager->createNextBidirectionalStream().value();
+  auto stream2 = conn.streamManager->createNextBidirectionalStream().value();
+  auto stream3 = conn.streamManager->createNextBidirectionalStream().value();
+  writeDataToQuicStream(*stream1, folly::IOBuf::copyBuffer("some data"), false);
+  writeDataToQuicStream(*stream2, folly::IOBuf::copyBuffer("some data"), false);
+  writeDataToQuicStream(*stream3, folly::IOBuf::copyBuffer("some data"), false);
+  conn.streamManager->setStreamPriority(*stream3, Priority(0, true));
+  EXPECT_TRUE(conn.streamManager->writableStreams().contains(
+      stream3->id, Priority(0, true)));
+  EXPECT_FALSE(conn.streamManager->writableStreams().contains(
+      stream3->id, kDefaultPriority));
+
+  NiceMock<MockQuicPacketBuilder> builder;
+  EXPECT_CALL(builder, remainingSpaceInPkt()).WillRepeatedly(Return(4096));
+  EXPECT_CALL(builder, appendFrame(_)).WillRepeatedly(Invoke([&](auto f) {
+    builder.frames_.push_back(f);
+  }));
+  scheduler.writeStreams(builder);
+  auto& frames = builder.frames_;
+  ASSERT_EQ(frames.size(), 3);
+  ASSERT_TRUE(frames[0].asWriteStreamFrame());
+  EXPECT_EQ(frames[0].asWriteStreamFrame()->streamId, stream3->id);
+  ASSERT_TRUE(frames[1].asWriteStreamFrame());
+  EXPECT_EQ(frames[1].asWriteStreamFrame()->streamId, stream1->id);
+  ASSERT_TRUE(frames[2].asWriteStreamFrame());
+  EXPECT_EQ(frames[2].asWriteStreamFrame()->streamId, stream2->id);
+}
+
+TEST_F(QuicPacketSchedulerTest, SimpleFramesFillPacketTail) {
+  QuicClientConnectionState conn(
+      FizzClientQuicHandshakeContext::Builder().build());
+  ShortHeader shortHeader(
+      ProtectionType::KeyPhaseZero, getTestConnectionId(), 1);
+  RegularQuicPacketBuilder builder(
+      conn.udpSendPacketLen, std::move(shortHeader), 0 /* largestAcked */);
+  while (builder.remainingSpaceInPkt() > 10) {
+    writeFrame(PaddingFrame(), builder);
+  }
+  // Doesn't fit, but the smaller one after it does.
+  conn.pendingEvents.frames.emplace_back(NewConnectionIdFrame(
+      1, 0, getTestConnectionId(), StatelessResetToken()));
+  conn.pendingEvents.frames.emplace_back(MaxStreamsFrame(100, true));
+  SimpleFrameScheduler scheduler(conn);
+  EXPECT_TRUE(scheduler.writeSimpleFrames(builder));
+  auto packet = std::move(builder).buildPacket();
+  std::vector<QuicSimpleFrame::Type> written;
+  for (const auto& frame : packet.packet.frames) {
+    if (frame.asQuicSimpleFrame()) {
+      written.push_back(frame.asQuicSimpleFrame()->type());
+    }
+  }
+  EXPECT_EQ(
+      std::vector<QuicSimpleFrame::Type>{
+          QuicSimpleFrame::Type::MaxStreamsFrame_E},
+      written);
+}
+
+TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerFillsPacketTail) {
+  QuicClientConnectionState conn(
+      FizzClientQuicHandshakeContext::Builder().build());
+  conn.streamManager->setMaxLocalBidirectionalStreams(10);
+  conn.flowControlState.peerAdvertisedMaxOffset = 100000;
+  conn.flowControlState.peerAdvertisedInitialMaxStreamOffsetBidiRemote = 100000;
+  auto stream1 = conn.streamManager->createNextBidirectionalStream().value();
+  auto stream2 = conn.streamManager->createNextBidirectionalStream().value();
+  // The frame header of stream1 takes up the whole tail, the one of stream2
+  // leaves room for data.
+  uint64_t largeOffset = 1ULL << 40;
+  stream1->currentWriteOffset = largeOffset;
+  stream1->flowControlState.peerAdvertisedMaxOffset = largeOffset + 100000;
+  conn.flowControlState.sumCurWriteOffset = largeOffset;
+  conn.flowControlState.peerAdvertisedMaxOffset = largeOffset + 100000;
+  writeDataToQuicStream(*stream1, folly::IOBuf::copyBuffer("some data"), false);
+  writeDataToQuicStream(*stream2, folly::IOBuf::copyBuffer("some data"), false);
+
+  ShortHeader shortHeader(
+      ProtectionType::KeyPhaseZero, getTestConnectionId(), 1);
+  RegularQuicPacketBuilder builder(
+      conn.udpSendPacketLen, std::move(shortHeader), 0 /* largestAcked */);
+  while (builder.remainingSpaceInPkt() > 10) {
+    writeFrame(PaddingFrame(), builder);
+  }
+  StreamFrameScheduler scheduler(conn);
+  scheduler.writeStreams(builder);
+  auto packet = std::move(builder).buildPacket();
+  std::vector<StreamId> written;
+  for (const auto& frame : packet.packet.frames) {
+    if (frame.asWriteStreamFrame()) {
+      written.push_back(frame.asWriteStreamFrame()->streamId);
+    }
+  }
+  EXPECT_EQ(std::vector<StreamId>{stream2->id}, written);
+}
+
+TEST_F(QuicPacketSchedulerTest, RetransmissionSchedulerOrder) {
+  QuicClientConnectionState conn(
+      FizzClientQuicHandshakeContext::Builder().build());
+  conn.streamManager->setMaxLocalBidirectionalStreams(10);
+  auto stream1 = conn.streamManager->createNextBidirectionalStream().value();
+  auto stream2 = conn.streamManager->createNextBidirectionalStream().value();
+  auto stream3 = conn.streamManager->createNextBidirectionalStream().value();
+  auto stream4 = conn.streamManager->createNextBidirectionalStream().value();
+  conn.streamManager->setStreamPriority(*stream3, Priority(0, true));
+  conn.streamManager->setStreamPriority(*stream4, Priority(3, false));
+  auto addLoss = [&](QuicStreamState& stream, uint64_t offset) {
+    stream.lossBuffer.emplace_back(
+        folly::IOBuf::copyBuffer("lost data"), offset, false);
+    conn.streamManager->updateLossStreams(stream);
+  };
+  addLoss(*stream1, 100);
+  addLoss(*stream1, 200);
+  addLoss(*stream2, 0);
+  addLoss(*stream3, 500);
+  addLoss(*stream4, 1000);
+
+  RetransmissionScheduler scheduler(conn);
+  NiceMock<MockQuicPacketBuilder> builder;
+  EXPECT_CALL(builder, remainingSpaceInPkt()).WillRepeatedly(Return(4096));
+  EXPECT_CALL(builder, appendFrame(_)).WillRepeatedly(Invoke([&](auto f) {
+    builder.frames_.push_back(f);
+  }));
+  scheduler.writeRetransmissionStreams(builder);
+  auto& frames = builder.frames_;
+  ASSERT_EQ(frames.size(), 5);
+  std::vector<std::pair<StreamId, uint64_t>> written;
+  for (auto& frame : frames) {
+    ASSERT_TRUE(frame.asWriteStreamFrame());
+    written.emplace_back(
+        frame.asWriteStreamFrame()->streamId,
+        frame.asWriteStreamFrame()->offset);
+  }
+  std::vector<std::pair<StreamId, uint64_t>> expected{
+      {stream3->id, 500},
+      {stream4->id, 1000},
+      {stream2->id, 0},
+      {stream1->id, 100},
+      {stream1->id, 200}};
+  EXPECT_EQ(expected, written);
+}
+
+TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerSequential) {
+  QuicClientConnectionState conn(
+      FizzClientQuicHandshakeContext::Builder().build());
+  conn.streamManager->setMaxLocalBidirectionalStreams(10);
+  conn.flowControlState.peerAdvertisedMaxOffset = 100000;
+  conn.flowControlState.peerAdvertisedInitialMaxStreamOffsetBidiRemote = 100000;
+  auto connId = getTestConnectionId();
+  StreamFrameScheduler scheduler(conn);
+  ShortHeader shortHeader(
+      ProtectionType::KeyPhaseZero,
+      connId,
+      getNextPacketNum(conn, PacketNumberSpace::AppData));
+  RegularQuicPacketBuilder builder1(
+      conn.udpSendPacketLen,
+      std::move(shortHeader),
+      conn.ackStates.appDataAckState.largestAckedByPeer);
+  auto stream1 = conn.streamManager->createNextBidirectionalStream().value();
+  auto stream2 = conn.streamManager->createNextBidirectionalStream().value();
+  Priority sequential(1, false);
+  conn.streamManager->setStreamPriority(*stream1, sequential);
+  conn.streamManager->setStreamPriority(*stream2, sequential);
+  auto largeBuf = folly::IOBuf::createChain(conn.udpSendPacketLen * 2, 4096);
+  auto curBuf = largeBuf.get();
+  do {
+    curBuf->append(curBuf->capacity());
+    curBuf = curBuf->next();
+  } while (curBuf != largeBuf.get());
+  writeDataToQuicStream(*stream1, std::move(largeBuf), false);
+  writeDataToQuicStream(*stream2, folly::IOBuf::copyBuffer("some data"), false);
+  scheduler.writeStreams(builder1);
+  // The first stream keeps the cursor until all of its data is written.
+  EXPECT_EQ(
+      conn.streamManager->writableStreams()
+          .level(sequential)
+          .getNextScheduled(),
+      stream1->id);
+
+  NiceMock<MockQuicPacketBuilder> builder2;
+  EXPECT_CALL(builder2, remainingSpaceInPkt()).WillRepeatedly(Return(4096));
+  EXPECT_CALL(builder2, appendFrame(_)).WillRepeatedly(Invoke([&](auto f) {
+    builder2.frames_.push_back(f);
+  }));
+  scheduler.writeStreams(builder2);
+  auto& frames = builder2.frames_;
+  ASSERT_FALSE(frames.empty());
+  ASSERT_TRUE(frames[0].asWriteStreamFrame());
+  EXPECT_EQ(frames[0].asWriteStreamFrame()->streamId, stream1->id);
 }
 
 TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerOneStream) {
@@ -876,7 +1169,11 @@ TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerOneStream) {
   auto stream1 = conn.streamManager->createNextBidirectionalStream().value();
   writeDataToQuicStream(*stream1, folly::IOBuf::copyBuffer("some data"), false);
   scheduler.writeStreams(builder);
-  EXPECT_EQ(conn.schedulingState.nextScheduledStream, 0);
+  EXPECT_EQ(
+      conn.streamManager->writableStreams()
+          .level(kDefaultPriority)
+          .getNextScheduled(),
+      0);
 }
 
 TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerRemoveOne) {
@@ -914,12 +1211,47 @@ TEST_F(QuicPacketSchedulerTest, StreamFrameSchedulerRemoveOne) {
   // Manually remove a stream and set the next scheduled to that stream.
   builder.frames_.clear();
   conn.streamManager->removeWritable(*conn.streamManager->findStream(stream2));
-  conn.schedulingState.nextScheduledStream = stream2;
+  conn.streamManager->writableStreams()
+      .level(kDefaultPriority)
+      .setNextScheduled(stream2);
   scheduler.writeStreams(builder);
   ASSERT_EQ(builder.frames_.size(), 1);
   ASSERT_TRUE(builder.frames_[0].asWriteStreamFrame());
   EXPECT_EQ(*builder.frames_[0].asWriteStreamFrame(), f1);
 }
 
+TEST_F(QuicPacketSchedulerTest, DatagramFrameScheduler) {
+  QuicClientConnectionState conn(
+      FizzClientQuicHandshakeContext::Builder().build());
+  auto connId = getTestConnectionId();
+  DatagramFrameScheduler scheduler(conn);
+  EXPECT_FALSE(scheduler.hasPendingDatagramFrames());
+  conn.datagramState.writeBuffer.emplace_back(
+      folly::IOBuf::copyBuffer("first"));
+  // Too large to join the first one in the packet.
+  conn.datagramState.writeBuffer.emplace_back(
+      buildRandomInputData(conn.udpSendPacketLen - 50));
+  EXPECT_TRUE(scheduler.hasPendingDatagramFrames());
+
+  ShortHeader shortHeader(
+      ProtectionType::KeyPhaseZero,
+      connId,
+      getNextPacketNum(conn, PacketNumberSpace::AppData));
+  RegularQuicPacketBuilder builder(
+      conn.udpSendPacketLen,
+      std::move(shortHeader),
+      conn.ackStates.appDataAckState.largestAckedByPeer);
+  PacketBuilderWrapper builderWrapper(builder, 100);
+  EXPECT_TRUE(scheduler.writeDatagramFrames(builderWrapper));
+  auto packet = std::move(builder).buildPacket();
+  ASSERT_EQ(packet.packet.frames.size(), 1);
+  EXPECT_EQ(packet.packet.frames[0].asDatagramFrame()->length, 5);
+  // Only the datagram that was sent is gone.
+  ASSERT_EQ(conn.datagramState.writeBuffer.size(), 1);
+  EXPECT_EQ(
+      conn.datagramState.writeBuffer.front()->computeChainDataLength(),
+      conn.udpSendPacketLen - 50);
+}
+
 } // namespace test
 } // namespace quic
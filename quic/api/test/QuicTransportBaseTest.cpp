@@ -8,6 +8,7 @@
 
 #include <quic/api/test/Mocks.h>
 
+#include <folly/FileUtil.h>
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
 
@@ -20,6 +21,9 @@
 #include <quic/state/test/Mocks.h>
 
 #include <folly/io/async/test/MockAsyncUDPSocket.h>
+#include <folly/testing/TestUtil.h>
+
+#include <thread>
 
 using namespace testing;
 using namespace folly;
@@ -241,6 +245,10 @@ class TestQuicTransport
     idleTimeout_.timeoutExpired();
   }
 
+  bool isIdleTimeoutScheduled() const {
+    return idleTimeout_.isScheduled();
+  }
+
   void invokeAckTimeout() {
     ackTimeout_.timeoutExpired();
   }
@@ -259,6 +267,34 @@ class TestQuicTransport
     handlePingCallback();
   }
 
+  void invokeHandleBandwidthEstimateCallback() {
+    handleBandwidthEstimateCallback();
+  }
+
+  void invokeHandleDatagramCallback() {
+    handleDatagramCallback();
+  }
+
+  void invokeUpdateWriteLooper() {
+    updateWriteLooper(true);
+  }
+
+  void invokeWriteReadyCallbacks() {
+    QuicTransportBase::invokeWriteReadyCallbacks();
+  }
+
+  bool isCorkTimeoutScheduled() const {
+    return corkTimeout_.isScheduled();
+  }
+
+  bool isWindowUpdateTimeoutScheduled() const {
+    return windowUpdateTimeout_.isScheduled();
+  }
+
+  void invokeWindowUpdateTimeoutExpired() {
+    windowUpdateTimeoutExpired();
+  }
+
   bool isPingTimeoutScheduled() {
     if (pingTimeout_.isScheduled()) {
       return true;
@@ -361,6 +397,10 @@ class TestQuicTransport
     writeSocketData();
   }
 
+  void invokeUpdateHotLoopState(uint64_t bytes) {
+    updateHotLoopState(bytes);
+  }
+
   QuicServerConnectionState* transportConn;
   std::unique_ptr<Aead> aead;
   std::unique_ptr<PacketNumberCipher> headerCipher;
@@ -420,6 +460,66 @@ TEST_F(QuicTransportImplTest, IdleTimeoutExpiredDestroysTransport) {
   transport->invokeIdleTimeout();
 }
 
+TEST_F(QuicTransportImplTest, ReadCallbackDestroysTransport) {
+  auto stream = transport->createBidirectionalStream().value();
+  NiceMock<MockReadCallback> readCb;
+  transport->setReadCallback(stream, &readCb);
+  transport->addDataToStream(
+      stream, StreamBuffer(folly::IOBuf::copyBuffer("actual stream data"), 0));
+  std::weak_ptr<TestQuicTransport> weakTransport = transport;
+  EXPECT_CALL(readCb, readAvailable(stream)).WillOnce(Invoke([&](StreamId id) {
+    auto rawTransport = transport.get();
+    transport = nullptr;
+    // The read loop keeps it, also across the nested read.
+    EXPECT_FALSE(weakTransport.expired());
+    EXPECT_TRUE(rawTransport->read(id, 100).hasValue());
+    EXPECT_FALSE(weakTransport.expired());
+  }));
+  evb->loopOnce();
+  EXPECT_TRUE(weakTransport.expired());
+}
+
+TEST_F(QuicTransportImplTest, LazyIdleTimer) {
+  auto& transportSettings = transport->transportConn->transportSettings;
+  transportSettings.lazyIdleTimer = true;
+  transportSettings.idleTimeout = 60s;
+  transport->setIdleTimeout();
+  EXPECT_TRUE(transport->isIdleTimeoutScheduled());
+
+  // The timer fires before the deadline pushed by the activity since, and
+  // just waits for the rest.
+  transport->setIdleTimeout();
+  EXPECT_CALL(connCallback, onConnectionEnd()).Times(0);
+  transport->invokeIdleTimeout();
+  EXPECT_TRUE(transport->isIdleTimeoutScheduled());
+  Mock::VerifyAndClearExpectations(&connCallback);
+
+  // A deadline that moves earlier rearms the timer.
+  transportSettings.idleTimeout = 1ms;
+  transport->setIdleTimeout();
+  std::this_thread::sleep_for(2ms);
+  EXPECT_CALL(connCallback, onConnectionEnd()).WillOnce(Invoke([&]() {
+    transport = nullptr;
+  }));
+  transport->invokeIdleTimeout();
+}
+
+TEST_F(QuicTransportImplTest, LazyIdleTimerUsesLastActivity) {
+  auto& transportSettings = transport->transportConn->transportSettings;
+  EXPECT_TRUE(transportSettings.lazyIdleTimer);
+  transportSettings.idleTimeout = 60s;
+  transport->setIdleTimeout();
+
+  // The idle period is counted from the last activity with the current
+  // timeout, not from when the timer was armed.
+  transportSettings.idleTimeout = 1ms;
+  std::this_thread::sleep_for(2ms);
+  EXPECT_CALL(connCallback, onConnectionEnd()).WillOnce(Invoke([&]() {
+    transport = nullptr;
+  }));
+  transport->invokeIdleTimeout();
+}
+
 TEST_F(QuicTransportImplTest, WriteAckPacketUnsetsLooper) {
   // start looper in running state first
   transport->writeLooper()->run(true);
@@ -444,6 +544,41 @@ TEST_F(QuicTransportImplTest, WriteAckPacketUnsetsLooper) {
   EXPECT_FALSE(transport->writeLooper()->isLoopCallbackScheduled());
 }
 
+TEST_F(QuicTransportImplTest, BatchedStreamCallbackReadable) {
+  auto stream1 = transport->createBidirectionalStream().value();
+  auto stream2 = transport->createBidirectionalStream().value();
+  auto stream3 = transport->createBidirectionalStream().value();
+
+  NiceMock<MockReadCallback> readCb;
+  NiceMock<MockBatchedStreamCallback> batchedCb;
+  transport->setBatchedStreamCallback(&batchedCb);
+  transport->setReadCallback(stream1, &readCb);
+  transport->setReadCallback(stream2, &readCb);
+  transport->setReadCallback(stream3, &readCb);
+
+  for (auto stream : {stream1, stream2}) {
+    transport->addDataToStream(
+        stream, StreamBuffer(folly::IOBuf::copyBuffer("actual data"), 0));
+  }
+  transport->addDataToStream(
+      stream3, StreamBuffer(folly::IOBuf::copyBuffer("actual data"), 10));
+
+  EXPECT_CALL(readCb, readAvailable(_)).Times(0);
+  EXPECT_CALL(batchedCb, onStreamsReadable(_))
+      .WillOnce(Invoke([&](const std::vector<StreamId>& streams) {
+        EXPECT_THAT(streams, UnorderedElementsAre(stream1, stream2));
+      }));
+  transport->driveReadCallbacks();
+  Mock::VerifyAndClearExpectations(&readCb);
+  Mock::VerifyAndClearExpectations(&batchedCb);
+
+  transport->setBatchedStreamCallback(nullptr);
+  EXPECT_CALL(readCb, readAvailable(stream1));
+  EXPECT_CALL(readCb, readAvailable(stream2));
+  transport->driveReadCallbacks();
+  transport->close(folly::none);
+}
+
 TEST_F(QuicTransportImplTest, ReadCallbackDataAvailable) {
   auto stream1 = transport->createBidirectionalStream().value();
   auto stream2 = transport->createBidirectionalStream().value();
@@ -491,6 +626,36 @@ TEST_F(QuicTransportImplTest, ReadCallbackDataAvailable) {
   transport.reset();
 }
 
+TEST_F(QuicTransportImplTest, ReadCallbacksYieldAfterWorkBudget) {
+  transport->transportConn->transportSettings.loopWorkBudget = 1us;
+  auto stream1 = transport->createBidirectionalStream().value();
+  auto stream2 = transport->createBidirectionalStream().value();
+  NiceMock<MockReadCallback> readCb;
+  transport->setReadCallback(stream1, &readCb);
+  transport->setReadCallback(stream2, &readCb);
+  transport->addDataToStream(
+      stream1, StreamBuffer(folly::IOBuf::copyBuffer("actual stream data"), 0));
+  transport->addDataToStream(
+      stream2, StreamBuffer(folly::IOBuf::copyBuffer("actual stream data"), 0));
+
+  std::vector<StreamId> invoked;
+  EXPECT_CALL(readCb, readAvailable(_))
+      .WillRepeatedly(Invoke([&](StreamId id) {
+        invoked.push_back(id);
+        std::this_thread::sleep_for(1ms);
+      }));
+  transport->driveReadCallbacks();
+  ASSERT_EQ(1, invoked.size());
+  // The other stream goes first in the next loop.
+  transport->driveReadCallbacks();
+  ASSERT_EQ(2, invoked.size());
+  EXPECT_NE(invoked[0], invoked[1]);
+  transport->driveReadCallbacks();
+  ASSERT_EQ(3, invoked.size());
+  EXPECT_EQ(invoked[0], invoked[2]);
+  transport.reset();
+}
+
 TEST_F(QuicTransportImplTest, ReadCallbackChangeReadCallback) {
   auto stream1 = transport->createBidirectionalStream().value();
 
@@ -1112,6 +1277,50 @@ TEST_F(QuicTransportImplTest, LossTimeoutNoLessThanTickInterval) {
       2);
 }
 
+TEST_F(QuicTransportImplTest, LossTimeoutOnHighResTimer) {
+  transport->setPacingTimer(TimerHighRes::newTimer(evb.get(), 100us));
+  transport->transportConn->transportSettings.useHighResTimers = true;
+  auto wheelTimeouts = evb->timer().count();
+  transport->scheduleLossTimeout(300us);
+  EXPECT_TRUE(transport->isLossTimeoutScheduled());
+  EXPECT_EQ(wheelTimeouts, evb->timer().count());
+  transport->cancelLossTimeout();
+  EXPECT_FALSE(transport->isLossTimeoutScheduled());
+}
+
+TEST_F(QuicTransportImplTest, HotLoopMitigation) {
+  auto loopDetector = std::make_shared<MockLoopDetectorCallback>();
+  transport->setLoopDetectorCallback(loopDetector);
+  auto& settings = transport->transportConn->transportSettings;
+  settings.hotLoopMinBytesPerWakeup = 100;
+  settings.hotLoopMinWakeups = 1;
+  settings.hotLoopWindow = 0ms;
+  settings.pacingEnabled = false;
+  auto minBurstPackets = settings.minBurstPackets;
+  auto& hotLoopState = transport->transportConn->hotLoopState;
+
+  // Enough bytes for the wakeup.
+  transport->invokeUpdateHotLoopState(1000);
+  EXPECT_EQ(HotLoopMitigation::NONE, hotLoopState.mitigation);
+
+  // Each window spent looping hot escalates the mitigation.
+  EXPECT_CALL(*loopDetector, onHotLoop(1, 10, HotLoopMitigation::PACE));
+  transport->invokeUpdateHotLoopState(10);
+  EXPECT_TRUE(settings.pacingEnabled);
+  EXPECT_NE(nullptr, transport->transportConn->pacer);
+
+  EXPECT_CALL(*loopDetector, onHotLoop(1, 10, HotLoopMitigation::RAISE_BURST));
+  transport->invokeUpdateHotLoopState(10);
+  EXPECT_EQ(minBurstPackets * kHotLoopBurstFactor, settings.minBurstPackets);
+
+  EXPECT_CALL(*loopDetector, onHotLoop(1, 10, HotLoopMitigation::CLOSE));
+  transport->invokeUpdateHotLoopState(10);
+  EXPECT_TRUE(transport->isClosed());
+  EXPECT_EQ(
+      transport->getConnectionError(),
+      QuicErrorCode(LocalErrorCode::HOT_LOOP));
+}
+
 TEST_F(QuicTransportImplTest, CloseStreamAfterReadError) {
   auto qLogger = std::make_shared<FileQLogger>(VantagePoint::Client);
   transport->transportConn->qLogger = qLogger;
@@ -1137,6 +1346,26 @@ TEST_F(QuicTransportImplTest, CloseStreamAfterReadError) {
   EXPECT_EQ(event->update, getClosingStream("1"));
 }
 
+TEST_F(QuicTransportImplTest, CloseStreamHeldByReadCallback) {
+  auto stream1 = transport->createBidirectionalStream().value();
+  auto stream2 = transport->createBidirectionalStream().value();
+  NiceMock<MockReadCallback> readCb1;
+  transport->setReadCallback(stream1, &readCb1);
+
+  // stream2 goes right away, stream1 waits until its callback is done.
+  transport->closeStream(stream1);
+  transport->closeStream(stream2);
+  auto& streamManager = *transport->transportConn->streamManager;
+  EXPECT_TRUE(streamManager.streamExists(stream1));
+  EXPECT_FALSE(streamManager.streamExists(stream2));
+  EXPECT_TRUE(streamManager.closedStreams().empty());
+
+  transport->setReadCallback(stream1, nullptr);
+  transport->driveReadCallbacks();
+  EXPECT_FALSE(streamManager.streamExists(stream1));
+  transport.reset();
+}
+
 TEST_F(QuicTransportImplTest, CloseStreamAfterReadFin) {
   auto stream2 = transport->createBidirectionalStream().value();
   NiceMock<MockReadCallback> readCb2;
@@ -1159,7 +1388,7 @@ TEST_F(QuicTransportImplTest, CloseStreamAfterReadFin) {
 TEST_F(QuicTransportImplTest, CancelAllDeliveryCallbacksDeque) {
   NiceMock<MockDeliveryCallback> mockedDeliveryCallback1,
       mockedDeliveryCallback2;
-  std::deque<std::pair<uint64_t, QuicSocket::DeliveryCallback*>> callbacks;
+  QuicTransportBase::DeliveryCallbackQueue callbacks;
   callbacks.emplace_back(0, &mockedDeliveryCallback1);
   callbacks.emplace_back(100, &mockedDeliveryCallback2);
   StreamId id = 0x123;
@@ -1171,9 +1400,7 @@ TEST_F(QuicTransportImplTest, CancelAllDeliveryCallbacksDeque) {
 TEST_F(QuicTransportImplTest, CancelAllDeliveryCallbacksMap) {
   NiceMock<MockDeliveryCallback> mockedDeliveryCallback1,
       mockedDeliveryCallback2;
-  folly::F14FastMap<
-      StreamId,
-      std::deque<std::pair<uint64_t, QuicSocket::DeliveryCallback*>>>
+  folly::F14FastMap<StreamId, QuicTransportBase::DeliveryCallbackQueue>
       callbacks;
   callbacks[0x123].emplace_back(0, &mockedDeliveryCallback1);
   callbacks[0x135].emplace_back(100, &mockedDeliveryCallback2);
@@ -1682,6 +1909,27 @@ TEST_P(QuicTransportImplTestUniBidi, AppIdleTestOnlyControlStreams) {
   transport->closeStream(ctrlStream2);
 }
 
+TEST_F(QuicTransportImplTest, StreamPriority) {
+  auto stream = transport->createBidirectionalStream().value();
+  EXPECT_EQ(kDefaultPriority, transport->getStreamPriority(stream).value());
+  EXPECT_TRUE(transport->setStreamPriority(stream, 0, false).hasValue());
+  EXPECT_EQ(Priority(0, false), transport->getStreamPriority(stream).value());
+  EXPECT_EQ(
+      LocalErrorCode::INVALID_OPERATION,
+      transport->setStreamPriority(stream, kNumPriorityUrgencies, true)
+          .error());
+  EXPECT_EQ(
+      LocalErrorCode::STREAM_NOT_EXISTS,
+      transport->setStreamPriority(stream + 4, 1, true).error());
+  EXPECT_EQ(
+      LocalErrorCode::STREAM_NOT_EXISTS,
+      transport->getStreamPriority(stream + 4).error());
+  transport->closeNow(folly::none);
+  EXPECT_EQ(
+      LocalErrorCode::CONNECTION_CLOSED,
+      transport->setStreamPriority(stream, 1, true).error());
+}
+
 TEST_F(QuicTransportImplTest, UnidirectionalInvalidReadFuncs) {
   auto stream = transport->createUnidirectionalStream().value();
   EXPECT_THROW(
@@ -2590,6 +2838,67 @@ TEST_F(QuicTransportImplTest, FailedPing) {
   EXPECT_EQ(conn->pendingEvents.cancelPingTimeout, false);
 }
 
+TEST_F(QuicTransportImplTest, BandwidthEstimate) {
+  auto& conn = transport->getConnectionState();
+  auto mockCongestionController =
+      std::make_unique<NiceMock<MockCongestionController>>();
+  auto rawCongestionController = mockCongestionController.get();
+  conn.congestionController = std::move(mockCongestionController);
+  EXPECT_CALL(*rawCongestionController, getCongestionWindow())
+      .WillRepeatedly(Return(10000));
+
+  conn.lossState.srtt = 0us;
+  EXPECT_FALSE(transport->getBandwidthEstimate().hasValue());
+  EXPECT_FALSE(transport->estimateTimeToSend(1000).hasValue());
+
+  // Without a bandwidth model, it's cwnd over srtt.
+  conn.lossState.srtt = 100ms;
+  auto estimate = transport->getBandwidthEstimate();
+  ASSERT_TRUE(estimate.hasValue());
+  EXPECT_EQ(100000, estimate->normalize());
+  EXPECT_EQ(50ms, *transport->estimateTimeToSend(5000));
+
+  EXPECT_CALL(*rawCongestionController, getBandwidth())
+      .WillRepeatedly(Return(Bandwidth(1000, 1ms)));
+  estimate = transport->getBandwidthEstimate();
+  ASSERT_TRUE(estimate.hasValue());
+  EXPECT_EQ(1000000, estimate->normalize());
+  EXPECT_EQ(2ms, *transport->estimateTimeToSend(2000));
+  EXPECT_EQ(0us, *transport->estimateTimeToSend(0));
+}
+
+TEST_F(QuicTransportImplTest, BandwidthEstimateCallback) {
+  auto& conn = transport->getConnectionState();
+  auto mockCongestionController =
+      std::make_unique<NiceMock<MockCongestionController>>();
+  auto rawCongestionController = mockCongestionController.get();
+  conn.congestionController = std::move(mockCongestionController);
+  NiceMock<MockBandwidthEstimateCallback> bandwidthCallback;
+  transport->setBandwidthEstimateCallback(&bandwidthCallback, 0.5);
+
+  Bandwidth bandwidth(1000, 1ms);
+  EXPECT_CALL(*rawCongestionController, getBandwidth())
+      .WillRepeatedly(Invoke([&]() { return bandwidth; }));
+  EXPECT_CALL(bandwidthCallback, onBandwidthEstimateChanged(bandwidth));
+  transport->invokeHandleBandwidthEstimateCallback();
+
+  // Within the threshold of the last reported estimate.
+  bandwidth = Bandwidth(1400, 1ms);
+  EXPECT_CALL(bandwidthCallback, onBandwidthEstimateChanged(_)).Times(0);
+  transport->invokeHandleBandwidthEstimateCallback();
+  Mock::VerifyAndClearExpectations(&bandwidthCallback);
+
+  bandwidth = Bandwidth(400, 1ms);
+  EXPECT_CALL(bandwidthCallback, onBandwidthEstimateChanged(bandwidth));
+  transport->invokeHandleBandwidthEstimateCallback();
+  Mock::VerifyAndClearExpectations(&bandwidthCallback);
+
+  transport->setBandwidthEstimateCallback(nullptr, 0.5);
+  bandwidth = Bandwidth(4000, 1ms);
+  EXPECT_CALL(bandwidthCallback, onBandwidthEstimateChanged(_)).Times(0);
+  transport->invokeHandleBandwidthEstimateCallback();
+}
+
 TEST_F(QuicTransportImplTest, StreamWriteCallbackUnregister) {
   auto stream = transport->createBidirectionalStream().value();
   // Unset before set
@@ -2624,5 +2933,274 @@ TEST_F(QuicTransportImplTest, StreamWriteCallbackUnregister) {
   evb->loopOnce();
 }
 
+TEST_F(QuicTransportImplTest, WriteMany) {
+  transport->transportConn->oneRttWriteCipher = test::createNoOpAead();
+  auto& conn = transport->getConnectionState();
+  auto stream1 = transport->createBidirectionalStream().value();
+  auto stream2 = transport->createBidirectionalStream().value();
+  // The peer's unidirectional stream with the same index.
+  auto receiveOnly = transport->createUnidirectionalStream().value() ^ 0x1;
+  NiceMock<MockDeliveryCallback> dcb;
+
+  std::vector<QuicSocket::StreamWrite> writes;
+  writes.emplace_back(stream1, folly::IOBuf::copyBuffer("Hey"), false, &dcb);
+  writes.emplace_back(receiveOnly, folly::IOBuf::copyBuffer("No"), false);
+  writes.emplace_back(stream2, folly::IOBuf::copyBuffer("Hello"), true);
+  writes.emplace_back(stream1, folly::IOBuf::copyBuffer(" there"), true);
+  EXPECT_FALSE(transport->writeLooper()->isRunning());
+  auto errors = transport->writeMany(std::move(writes));
+  EXPECT_TRUE(transport->writeLooper()->isRunning());
+
+  ASSERT_EQ(errors.size(), 4);
+  EXPECT_FALSE(errors[0].hasValue());
+  EXPECT_EQ(errors[1], LocalErrorCode::INVALID_OPERATION);
+  EXPECT_FALSE(errors[2].hasValue());
+  EXPECT_FALSE(errors[3].hasValue());
+  auto streamState1 = conn.streamManager->getStream(stream1);
+  EXPECT_EQ(streamState1->writeBuffer.chainLength(), 9);
+  EXPECT_EQ(*streamState1->finalWriteOffset, 9);
+  auto streamState2 = conn.streamManager->getStream(stream2);
+  EXPECT_EQ(streamState2->writeBuffer.chainLength(), 5);
+  EXPECT_EQ(*streamState2->finalWriteOffset, 5);
+  transport->close(folly::none);
+}
+
+TEST_F(QuicTransportImplTest, CorkHoldsBackSmallWrites) {
+  transport->transportConn->oneRttWriteCipher = test::createNoOpAead();
+  auto& conn = transport->getConnectionState();
+  auto stream = transport->createBidirectionalStream().value();
+  transport->setCork(true);
+  transport->writeChain(stream, folly::IOBuf::copyBuffer("Hey"), false, false);
+  EXPECT_FALSE(transport->writeLooper()->isRunning());
+  EXPECT_TRUE(transport->isCorkTimeoutScheduled());
+
+  transport->flush();
+  EXPECT_TRUE(transport->writeLooper()->isRunning());
+  EXPECT_FALSE(transport->isCorkTimeoutScheduled());
+
+  // A full packet of data goes out right away.
+  evb->loopOnce();
+  EXPECT_FALSE(transport->writeLooper()->isRunning());
+  transport->writeChain(
+      stream, buildRandomInputData(conn.udpSendPacketLen), false, false);
+  EXPECT_TRUE(transport->writeLooper()->isRunning());
+
+  evb->loopOnce();
+  transport->writeChain(stream, folly::IOBuf::copyBuffer("Hey"), false, false);
+  EXPECT_FALSE(transport->writeLooper()->isRunning());
+  transport->setCork(false);
+  EXPECT_TRUE(transport->writeLooper()->isRunning());
+  transport->close(folly::none);
+}
+
+TEST_F(QuicTransportImplTest, WritesWhileWriteLooperRuns) {
+  transport->transportConn->oneRttWriteCipher = test::createNoOpAead();
+  auto& conn = transport->getConnectionState();
+  auto stream1 = transport->createBidirectionalStream().value();
+  auto stream2 = transport->createBidirectionalStream().value();
+  transport->writeChain(stream1, folly::IOBuf::copyBuffer("Hey"), false, false);
+  EXPECT_TRUE(transport->writeLooper()->isRunning());
+  transport->writeChain(stream2, folly::IOBuf::copyBuffer("Hey"), true, false);
+  EXPECT_TRUE(transport->writeLooper()->isRunning());
+
+  // Both go out in the same loop, after which there is nothing to write.
+  evb->loopOnce();
+  EXPECT_FALSE(transport->writeLooper()->isRunning());
+  EXPECT_TRUE(conn.streamManager->getStream(stream1)->writeBuffer.empty());
+  EXPECT_TRUE(conn.streamManager->getStream(stream2)->writeBuffer.empty());
+  transport->close(folly::none);
+}
+
+TEST_F(QuicTransportImplTest, WindowUpdatesWaitForOtherData) {
+  transport->transportConn->oneRttWriteCipher = test::createNoOpAead();
+  auto& conn = transport->getConnectionState();
+  conn.transportSettings.maxWindowUpdateDelay = 10ms;
+  auto stream = transport->createBidirectionalStream().value();
+  conn.streamManager->queueWindowUpdate(stream);
+  conn.pendingEvents.connWindowUpdate = true;
+  transport->invokeUpdateWriteLooper();
+  EXPECT_FALSE(transport->writeLooper()->isRunning());
+  EXPECT_TRUE(transport->isWindowUpdateTimeoutScheduled());
+
+  // They go out with the next stream data.
+  transport->writeChain(stream, folly::IOBuf::copyBuffer("Hey"), false, false);
+  EXPECT_TRUE(transport->writeLooper()->isRunning());
+  evb->loopOnce();
+  EXPECT_FALSE(conn.streamManager->hasWindowUpdates());
+  EXPECT_FALSE(conn.pendingEvents.connWindowUpdate);
+  EXPECT_FALSE(transport->isWindowUpdateTimeoutScheduled());
+
+  // Or on their own once they've waited long enough.
+  conn.pendingEvents.connWindowUpdate = true;
+  transport->invokeUpdateWriteLooper();
+  EXPECT_FALSE(transport->writeLooper()->isRunning());
+  transport->invokeWindowUpdateTimeoutExpired();
+  EXPECT_TRUE(transport->writeLooper()->isRunning());
+  evb->loopOnce();
+  EXPECT_FALSE(conn.pendingEvents.connWindowUpdate);
+  transport->close(folly::none);
+}
+
+TEST_F(QuicTransportImplTest, WriteFileReadsAsStreamDrains) {
+  auto& conn = transport->getConnectionState();
+  conn.transportSettings.fileWriteBufferSize = 10;
+  folly::test::TemporaryFile file;
+  auto contents = buildRandomInputData(25)->moveToFbString();
+  ASSERT_EQ(
+      folly::writeFull(file.fd(), contents.data(), contents.size()),
+      contents.size());
+
+  auto stream = transport->createBidirectionalStream().value();
+  EXPECT_FALSE(transport->writeFile(stream, file.fd(), 5, 20, true).hasError());
+  auto streamState = conn.streamManager->getStream(stream);
+  EXPECT_EQ(streamState->writeBuffer.chainLength(), 10);
+  EXPECT_FALSE(streamState->finalWriteOffset.hasValue());
+  EXPECT_EQ(
+      transport->writeChain(stream, folly::IOBuf::copyBuffer("a"), false, false)
+          .error(),
+      LocalErrorCode::INVALID_OPERATION);
+
+  // As if what is buffered was sent.
+  auto written = streamState->writeBuffer.move();
+  streamState->currentWriteOffset += 10;
+  conn.flowControlState.sumCurStreamBufferLen -= 10;
+  transport->invokeUpdateWriteLooper();
+  EXPECT_EQ(streamState->writeBuffer.chainLength(), 10);
+  EXPECT_EQ(*streamState->finalWriteOffset, 20);
+  written->prependChain(streamState->writeBuffer.move());
+  EXPECT_EQ(written->moveToFbString(), contents.substr(5, 20));
+
+  // Past the end of the file.
+  conn.transportSettings.fileWriteBufferSize = 100;
+  auto stream2 = transport->createBidirectionalStream().value();
+  EXPECT_FALSE(
+      transport->writeFile(stream2, file.fd(), 10, 20, false).hasError());
+  EXPECT_FALSE(conn.streamManager->getStream(stream2)->writable());
+  transport->close(folly::none);
+}
+
+TEST_F(QuicTransportImplTest, NotSentLowWatermark) {
+  auto& conn = transport->getConnectionState();
+  conn.transportSettings.notSentLowWatermark = 100;
+  auto stream = transport->createBidirectionalStream().value();
+  auto streamState = conn.streamManager->getStream(stream);
+  // As if this much was written and is not sent yet.
+  streamState->writeBuffer.append(
+      folly::IOBuf::copyBuffer(std::string(100, 'a')));
+  conn.flowControlState.sumCurStreamBufferLen += 100;
+
+  NiceMock<MockWriteCallback> wcb;
+  NiceMock<MockWriteCallback> connWcb;
+  EXPECT_CALL(wcb, onStreamWriteReady(_, _)).Times(0);
+  EXPECT_CALL(connWcb, onConnectionWriteReady(_)).Times(0);
+  EXPECT_FALSE(transport->notifyPendingWriteOnStream(stream, &wcb).hasError());
+  EXPECT_FALSE(transport->notifyPendingWriteOnConnection(&connWcb).hasError());
+  evb->loopOnce();
+  Mock::VerifyAndClearExpectations(&wcb);
+  Mock::VerifyAndClearExpectations(&connWcb);
+
+  // As if 60 bytes were sent.
+  streamState->writeBuffer.splitAtMost(60);
+  streamState->currentWriteOffset += 60;
+  conn.flowControlState.sumCurStreamBufferLen -= 60;
+  EXPECT_CALL(wcb, onStreamWriteReady(stream, 60));
+  EXPECT_CALL(connWcb, onConnectionWriteReady(60));
+  transport->invokeWriteReadyCallbacks();
+
+  // Up to the congestion window when it's larger.
+  conn.transportSettings.autoNotSentLowWatermark = true;
+  auto cwnd = conn.congestionController->getCongestionWindow();
+  ASSERT_GT(cwnd, 100);
+  EXPECT_CALL(wcb, onStreamWriteReady(stream, cwnd - 40));
+  EXPECT_FALSE(transport->notifyPendingWriteOnStream(stream, &wcb).hasError());
+  evb->loopOnce();
+  transport->close(folly::none);
+}
+
+TEST_F(QuicTransportImplTest, WriteExternalReleasesOnceUnreferenced) {
+  auto& conn = transport->getConnectionState();
+  // Small writes would be copied into chunks otherwise.
+  conn.transportSettings.writeBufferChunkSize = 1000;
+  std::string payload = "external data";
+  folly::ByteRange data(folly::StringPiece(payload));
+  bool released = false;
+
+  auto result = transport->writeExternal(
+      0 /* not created */,
+      data,
+      [&] { released = true; },
+      false,
+      false);
+  EXPECT_TRUE(result.hasError());
+  EXPECT_TRUE(released);
+
+  released = false;
+  auto stream = transport->createBidirectionalStream().value();
+  result = transport->writeExternal(
+      stream, data, [&] { released = true; }, false, false);
+  ASSERT_FALSE(result.hasError());
+  auto streamState = conn.streamManager->getStream(stream);
+  ASSERT_NE(streamState->writeBuffer.front(), nullptr);
+  EXPECT_EQ(streamState->writeBuffer.front()->data(), data.data());
+  EXPECT_EQ(streamState->writeBuffer.chainLength(), payload.size());
+  EXPECT_FALSE(released);
+
+  transport->resetStream(stream, GenericApplicationErrorCode::UNKNOWN);
+  EXPECT_TRUE(released);
+  transport->close(folly::none);
+}
+
+TEST_F(QuicTransportImplTest, WriteDatagramDropsOldest) {
+  auto& conn = transport->getConnectionState();
+  EXPECT_EQ(transport->getDatagramSizeLimit(), 0);
+  EXPECT_TRUE(transport->writeDatagram(folly::IOBuf::copyBuffer("a"))
+                  .hasError());
+
+  conn.datagramState.maxWriteFrameSize = 100;
+  conn.transportSettings.datagramWriteBufferSize = 2;
+  EXPECT_EQ(
+      transport->getDatagramSizeLimit(), 100 - kMaxDatagramFrameOverhead);
+  EXPECT_TRUE(transport->writeDatagram(buildRandomInputData(100)).hasError());
+  EXPECT_TRUE(transport->writeDatagram(folly::IOBuf::copyBuffer("a")));
+  EXPECT_TRUE(transport->writeDatagram(folly::IOBuf::copyBuffer("b")));
+  EXPECT_TRUE(transport->writeDatagram(folly::IOBuf::copyBuffer("c")));
+  auto& writeBuffer = conn.datagramState.writeBuffer;
+  ASSERT_EQ(writeBuffer.size(), 2);
+  EXPECT_EQ(writeBuffer.front()->moveToFbString().toStdString(), "b");
+  EXPECT_EQ(writeBuffer.back()->moveToFbString().toStdString(), "c");
+}
+
+TEST_F(QuicTransportImplTest, ReadDatagrams) {
+  auto& conn = transport->getConnectionState();
+  NiceMock<MockDatagramCallback> datagramCallback;
+  transport->setDatagramCallback(&datagramCallback);
+  EXPECT_CALL(datagramCallback, onDatagramsAvailable()).Times(0);
+  transport->invokeHandleDatagramCallback();
+  Mock::VerifyAndClearExpectations(&datagramCallback);
+
+  conn.transportSettings.maxDatagramFrameSize = 100;
+  conn.transportSettings.datagramReadBufferSize = 2;
+  for (auto payload : {"a", "b", "c"}) {
+    DatagramFrame frame(1, folly::IOBuf::copyBuffer(payload));
+    handleDatagram(conn, frame);
+  }
+  EXPECT_CALL(datagramCallback, onDatagramsAvailable());
+  transport->invokeHandleDatagramCallback();
+  Mock::VerifyAndClearExpectations(&datagramCallback);
+
+  auto first = transport->readDatagrams(1);
+  ASSERT_FALSE(first.hasError());
+  ASSERT_EQ(first->size(), 1);
+  EXPECT_EQ(first->front()->moveToFbString().toStdString(), "b");
+  auto rest = transport->readDatagrams();
+  ASSERT_FALSE(rest.hasError());
+  ASSERT_EQ(rest->size(), 1);
+  EXPECT_EQ(rest->front()->moveToFbString().toStdString(), "c");
+  EXPECT_TRUE(transport->readDatagrams()->empty());
+
+  DatagramFrame tooLarge(101, buildRandomInputData(101));
+  EXPECT_THROW(handleDatagram(conn, tooLarge), QuicTransportException);
+}
+
 } // namespace test
 } // namespace quic
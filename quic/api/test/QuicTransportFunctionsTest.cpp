@@ -10,9 +10,11 @@
 
 #include <folly/io/async/test/MockAsyncUDPSocket.h>
 #include <quic/api/test/Mocks.h>
+#include <quic/common/test/AllocationCounter.h>
 #include <quic/common/test/TestUtils.h>
 #include <quic/logging/FileQLogger.h>
 #include <quic/logging/QLoggerConstants.h>
+#include <quic/loss/QuicLossFunctions.h>
 #include <quic/server/state/ServerStateMachine.h>
 #include <quic/state/test/MockQuicStats.h>
 #include <quic/state/test/Mocks.h>
@@ -1040,6 +1042,51 @@ TEST_F(QuicTransportFunctionsTest, WriteQuicdataToSocketWithPacer) {
       conn->transportSettings.writeConnectionDataPacketsLimit);
 }
 
+TEST_F(QuicTransportFunctionsTest, WriteQuicDataToSocketContinuousMemory) {
+  auto conn = createConn();
+  conn->transportSettings.dataPathType = DataPathType::ContinuousMemory;
+  conn->transportSettings.batchingMode = QuicBatchingMode::BATCHING_MODE_NONE;
+  SimpleBufAccessor bufAccessor(
+      kDefaultMaxUDPPayload * conn->transportSettings.maxBatchSize);
+  conn->bufAccessor = &bufAccessor;
+
+  EventBase evb;
+  auto socket =
+      std::make_unique<NiceMock<folly::test::MockAsyncUDPSocket>>(&evb);
+  auto rawSocket = socket.get();
+
+  auto stream1 = conn->streamManager->createNextBidirectionalStream().value();
+  auto buf = buildRandomInputData(conn->udpSendPacketLen * 2);
+  writeDataToQuicStream(*stream1, buf->clone(), true);
+
+  std::vector<size_t> writtenSizes;
+  EXPECT_CALL(*rawSocket, write(_, _))
+      .WillRepeatedly(Invoke([&](const SocketAddress&,
+                                 const std::unique_ptr<folly::IOBuf>& iobuf) {
+        EXPECT_FALSE(iobuf->isChained());
+        EXPECT_LE(iobuf->length(), conn->udpSendPacketLen);
+        writtenSizes.push_back(iobuf->length());
+        return iobuf->length();
+      }));
+  auto written = writeQuicDataToSocket(
+      *rawSocket,
+      *conn,
+      *conn->clientConnectionId,
+      *conn->serverConnectionId,
+      *aead,
+      *headerCipher,
+      getVersion(*conn),
+      conn->transportSettings.writeConnectionDataPacketsLimit);
+  EXPECT_EQ(3, written);
+  ASSERT_EQ(written, writtenSizes.size());
+  ASSERT_EQ(written, conn->outstandingPackets.size());
+  for (size_t i = 0; i < written; i++) {
+    EXPECT_EQ(writtenSizes[i], conn->outstandingPackets[i].encodedSize);
+  }
+  EXPECT_TRUE(bufAccessor.ownsBuffer());
+  EXPECT_EQ(0, bufAccessor.obtain()->length());
+}
+
 TEST_F(QuicTransportFunctionsTest, WriteQuicDataToSocketLimitTest) {
   auto conn = createConn();
   auto mockCongestionController =
@@ -1135,6 +1182,121 @@ TEST_F(QuicTransportFunctionsTest, WriteQuicDataToSocketLimitTest) {
           conn->transportSettings.writeConnectionDataPacketsLimit));
 }
 
+TEST_F(QuicTransportFunctionsTest, WriteLoopYieldsAfterWorkBudget) {
+  auto conn = createConn();
+  EventBase evb;
+  auto socket =
+      std::make_unique<NiceMock<folly::test::MockAsyncUDPSocket>>(&evb);
+  auto rawSocket = socket.get();
+  EXPECT_CALL(*rawSocket, write(_, _))
+      .WillRepeatedly(Invoke([&](const SocketAddress&,
+                                 const std::unique_ptr<folly::IOBuf>& iobuf) {
+        return iobuf->computeChainDataLength();
+      }));
+  auto stream = conn->streamManager->createNextBidirectionalStream().value();
+  writeDataToQuicStream(
+      *stream, buildRandomInputData(conn->udpSendPacketLen * 3), false);
+
+  // Out of budget already, but it still makes progress.
+  conn->loopWorkDeadline = Clock::now();
+  EXPECT_CALL(
+      *transportInfoCb_, onWriteLoopEnd(WriteLoopEndReason::WORK_BUDGET, 1));
+  EXPECT_EQ(
+      1,
+      writeQuicDataToSocket(
+          *rawSocket,
+          *conn,
+          *conn->clientConnectionId,
+          *conn->serverConnectionId,
+          *aead,
+          *headerCipher,
+          getVersion(*conn),
+          conn->transportSettings.writeConnectionDataPacketsLimit));
+  EXPECT_EQ(conn->writeLoopStats.numEnded(WriteLoopEndReason::WORK_BUDGET), 1);
+  Mock::VerifyAndClearExpectations(transportInfoCb_.get());
+
+  conn->loopWorkDeadline = folly::none;
+  EXPECT_CALL(
+      *transportInfoCb_, onWriteLoopEnd(WriteLoopEndReason::APP_LIMITED, _));
+  EXPECT_LT(
+      1,
+      writeQuicDataToSocket(
+          *rawSocket,
+          *conn,
+          *conn->clientConnectionId,
+          *conn->serverConnectionId,
+          *aead,
+          *headerCipher,
+          getVersion(*conn),
+          conn->transportSettings.writeConnectionDataPacketsLimit));
+}
+
+TEST_F(QuicTransportFunctionsTest, WriteLoopStats) {
+  auto conn = createConn();
+  conn->qLogger = std::make_shared<quic::FileQLogger>(VantagePoint::Server);
+  EventBase evb;
+  auto socket =
+      std::make_unique<NiceMock<folly::test::MockAsyncUDPSocket>>(&evb);
+  auto rawSocket = socket.get();
+  EXPECT_CALL(*rawSocket, write(_, _))
+      .WillRepeatedly(Invoke([&](const SocketAddress&,
+                                 const std::unique_ptr<folly::IOBuf>& iobuf) {
+        return iobuf->computeChainDataLength();
+      }));
+  auto stream = conn->streamManager->createNextBidirectionalStream().value();
+  writeDataToQuicStream(
+      *stream, buildRandomInputData(conn->udpSendPacketLen * 3), false);
+
+  EXPECT_CALL(
+      *transportInfoCb_, onWriteLoopEnd(WriteLoopEndReason::PACKET_LIMIT, 2));
+  EXPECT_CALL(*transportInfoCb_, onBatchFlushed(1, _)).Times(2);
+  EXPECT_EQ(
+      2,
+      writeQuicDataToSocket(
+          *rawSocket,
+          *conn,
+          *conn->clientConnectionId,
+          *conn->serverConnectionId,
+          *aead,
+          *headerCipher,
+          getVersion(*conn),
+          2));
+  EXPECT_EQ(conn->writeLoopStats.numEnded(WriteLoopEndReason::PACKET_LIMIT), 1);
+  EXPECT_EQ(conn->writeLoopStats.writeLoops, 1);
+  EXPECT_EQ(conn->writeLoopStats.packetsWritten, 2);
+  EXPECT_EQ(conn->writeLoopStats.batchFlushes, 2);
+  EXPECT_EQ(conn->writeLoopStats.packetsFlushed, 2);
+  EXPECT_GT(conn->writeLoopStats.bytesFlushed, conn->udpSendPacketLen);
+  Mock::VerifyAndClearExpectations(transportInfoCb_.get());
+
+  EXPECT_CALL(
+      *transportInfoCb_, onWriteLoopEnd(WriteLoopEndReason::APP_LIMITED, _));
+  writeQuicDataToSocket(
+      *rawSocket,
+      *conn,
+      *conn->clientConnectionId,
+      *conn->serverConnectionId,
+      *aead,
+      *headerCipher,
+      getVersion(*conn),
+      conn->transportSettings.writeConnectionDataPacketsLimit);
+  EXPECT_EQ(conn->writeLoopStats.numEnded(WriteLoopEndReason::APP_LIMITED), 1);
+  EXPECT_EQ(conn->writeLoopStats.writeLoops, 2);
+  EXPECT_EQ(
+      conn->writeLoopStats.packetsFlushed, conn->writeLoopStats.packetsWritten);
+
+  std::shared_ptr<quic::FileQLogger> qLogger =
+      std::dynamic_pointer_cast<quic::FileQLogger>(conn->qLogger);
+  std::vector<int> indices =
+      getQLogEventIndices(QLogEventType::WriteLoopEnd, qLogger);
+  ASSERT_EQ(indices.size(), 2);
+  auto event = dynamic_cast<QLogWriteLoopEndEvent*>(
+      qLogger->logs[indices[0]].get());
+  EXPECT_EQ(event->reason, "PACKET_LIMIT");
+  EXPECT_EQ(event->packetsWritten, 2);
+  EXPECT_EQ(event->batchFlushes, 2);
+}
+
 TEST_F(
     QuicTransportFunctionsTest,
     WriteQuicDataToSocketWhenInFlightBytesAreLimited) {
@@ -1247,6 +1409,44 @@ TEST_F(QuicTransportFunctionsTest, WriteQuicDataToSocketRetxBufferSorted) {
   EXPECT_EQ(2, stream->retransmissionBuffer.size());
 }
 
+TEST_F(QuicTransportFunctionsTest, WriteFullPacketAllocations) {
+  EventBase evb;
+  NiceMock<folly::test::MockAsyncUDPSocket> socket(&evb);
+  EXPECT_CALL(socket, write(_, _))
+      .WillRepeatedly(Invoke([](const SocketAddress&,
+                                const std::unique_ptr<folly::IOBuf>& iobuf) {
+        return iobuf->computeChainDataLength();
+      }));
+  auto conn = createConn();
+  conn->statsCallback = nullptr;
+  auto stream = conn->streamManager->createNextBidirectionalStream().value();
+  writeDataToQuicStream(
+      *stream, buildRandomInputData(conn->udpSendPacketLen * 10), false);
+  auto writeOnePacket = [&]() {
+    return writeQuicDataToSocket(
+        socket,
+        *conn,
+        *conn->clientConnectionId,
+        *conn->serverConnectionId,
+        *aead,
+        *headerCipher,
+        getVersion(*conn),
+        1 /* packetLimit */);
+  };
+  // The first packets set up the buffers that are reused after.
+  writeOnePacket();
+  writeOnePacket();
+  // The StreamBuffer kept for retransmission and the IOBuf of its data, the
+  // header and body of the packet and the block of outstandingPackets it may
+  // start.
+  constexpr uint64_t kFullPacketAllocations = 5;
+  uint64_t written = 0;
+  EXPECT_ALLOCATIONS_AT_MOST(
+      kFullPacketAllocations, written = writeOnePacket());
+  EXPECT_EQ(1, written);
+  EXPECT_EQ(3, conn->outstandingPackets.size());
+}
+
 TEST_F(QuicTransportFunctionsTest, NothingWritten) {
   auto conn = createConn();
   auto mockCongestionController =
@@ -1594,6 +1794,115 @@ TEST_F(QuicTransportFunctionsTest, TestCryptoWritingIsHandshakeInOutstanding) {
                   ->isHandshake);
 }
 
+TEST_F(QuicTransportFunctionsTest, CoalescePackets) {
+  auto conn = createConn();
+  conn->transportSettings.coalescePackets = true;
+  conn->handshakeWriteCipher = createNoOpAead();
+  conn->handshakeWriteHeaderCipher = createNoOpHeaderCipher();
+  writeDataToQuicStream(
+      conn->cryptoState->initialStream, buildRandomInputData(100));
+  writeDataToQuicStream(
+      conn->cryptoState->handshakeStream, buildRandomInputData(100));
+  auto stream = conn->streamManager->createNextBidirectionalStream().value();
+  writeDataToQuicStream(*stream, buildRandomInputData(100), true);
+  EventBase evb;
+  auto socket =
+      std::make_unique<NiceMock<folly::test::MockAsyncUDPSocket>>(&evb);
+  auto rawSocket = socket.get();
+
+  // All three go out in one datagram.
+  uint64_t datagramSize = 0;
+  EXPECT_CALL(*rawSocket, write(_, _))
+      .WillOnce(Invoke([&](const SocketAddress&,
+                           const std::unique_ptr<folly::IOBuf>& iobuf) {
+        datagramSize = iobuf->computeChainDataLength();
+        return datagramSize;
+      }));
+  EXPECT_EQ(
+      1,
+      writeCryptoAndAckDataToSocket(
+          *rawSocket,
+          *conn,
+          *conn->serverConnectionId,
+          *conn->clientConnectionId,
+          LongHeader::Types::Initial,
+          *conn->initialWriteCipher,
+          *conn->initialHeaderCipher,
+          getVersion(*conn),
+          conn->transportSettings.writeConnectionDataPacketsLimit));
+  EXPECT_EQ(
+      1,
+      writeCryptoAndAckDataToSocket(
+          *rawSocket,
+          *conn,
+          *conn->serverConnectionId,
+          *conn->clientConnectionId,
+          LongHeader::Types::Handshake,
+          *conn->handshakeWriteCipher,
+          *conn->handshakeWriteHeaderCipher,
+          getVersion(*conn),
+          conn->transportSettings.writeConnectionDataPacketsLimit));
+  EXPECT_NE(nullptr, conn->coalescedPackets);
+  EXPECT_EQ(
+      1,
+      writeQuicDataToSocket(
+          *rawSocket,
+          *conn,
+          *conn->serverConnectionId,
+          *conn->clientConnectionId,
+          *aead,
+          *headerCipher,
+          getVersion(*conn),
+          conn->transportSettings.writeConnectionDataPacketsLimit));
+  EXPECT_EQ(nullptr, conn->coalescedPackets);
+  EXPECT_EQ(3, conn->outstandingPackets.size());
+  // The server Initial isn't padded to fill the datagram.
+  EXPECT_GT(datagramSize, 300);
+  EXPECT_LT(datagramSize, conn->udpSendPacketLen);
+}
+
+TEST_F(QuicTransportFunctionsTest, CoalescedPacketsWrittenAlone) {
+  auto conn = createConn();
+  conn->transportSettings.coalescePackets = true;
+  writeDataToQuicStream(
+      conn->cryptoState->initialStream,
+      buildRandomInputData(conn->udpSendPacketLen));
+  EventBase evb;
+  auto socket =
+      std::make_unique<NiceMock<folly::test::MockAsyncUDPSocket>>(&evb);
+  auto rawSocket = socket.get();
+
+  // The first packet fills a datagram, so it goes out once the second one is
+  // built, and the second one with writeCoalescedPackets().
+  std::vector<uint64_t> datagramSizes;
+  EXPECT_CALL(*rawSocket, write(_, _))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](const SocketAddress&,
+                                 const std::unique_ptr<folly::IOBuf>& iobuf) {
+        datagramSizes.push_back(iobuf->computeChainDataLength());
+        return iobuf->computeChainDataLength();
+      }));
+  EXPECT_EQ(
+      2,
+      writeCryptoAndAckDataToSocket(
+          *rawSocket,
+          *conn,
+          *conn->serverConnectionId,
+          *conn->clientConnectionId,
+          LongHeader::Types::Initial,
+          *conn->initialWriteCipher,
+          *conn->initialHeaderCipher,
+          getVersion(*conn),
+          conn->transportSettings.writeConnectionDataPacketsLimit));
+  ASSERT_EQ(1, datagramSizes.size());
+  EXPECT_NE(nullptr, conn->coalescedPackets);
+  writeCoalescedPackets(*rawSocket, *conn);
+  EXPECT_EQ(nullptr, conn->coalescedPackets);
+  ASSERT_EQ(2, datagramSizes.size());
+  EXPECT_LE(datagramSizes[0], conn->udpSendPacketLen);
+  EXPECT_EQ(2, conn->outstandingPackets.size());
+}
+
 TEST_F(QuicTransportFunctionsTest, WritePureAckWhenNoWritableBytes) {
   auto conn = createConn();
   auto mockCongestionController =
@@ -1638,6 +1947,58 @@ TEST_F(QuicTransportFunctionsTest, WritePureAckWhenNoWritableBytes) {
   EXPECT_EQ(0, conn->outstandingPackets.size());
 }
 
+TEST_F(QuicTransportFunctionsTest, WriteAckOnlyFastPath) {
+  auto conn = createConn();
+  conn->transportSettings.ackOnlyFastPath = true;
+  conn->oneRttWriteCipher = test::createNoOpAead();
+  auto mockCongestionController =
+      std::make_unique<NiceMock<MockCongestionController>>();
+  auto rawCongestionController = mockCongestionController.get();
+  conn->congestionController = std::move(mockCongestionController);
+
+  EventBase evb;
+  auto socket =
+      std::make_unique<NiceMock<folly::test::MockAsyncUDPSocket>>(&evb);
+  auto rawSocket = socket.get();
+
+  addAckStatesWithCurrentTimestamps(conn->ackStates.appDataAckState, 0, 100);
+  conn->ackStates.appDataAckState.needsToSendAckImmediately = true;
+  auto packetNum = getNextPacketNum(*conn, PacketNumberSpace::AppData);
+
+  EXPECT_CALL(*rawSocket, write(_, _))
+      .WillOnce(Invoke([&](const SocketAddress&,
+                           const std::unique_ptr<folly::IOBuf>& iobuf) {
+        return iobuf->computeChainDataLength();
+      }));
+  EXPECT_CALL(*rawCongestionController, onPacketSent(_)).Times(0);
+  EXPECT_EQ(
+      1,
+      writeQuicDataToSocket(
+          *rawSocket,
+          *conn,
+          *conn->clientConnectionId,
+          *conn->serverConnectionId,
+          *aead,
+          *headerCipher,
+          getVersion(*conn),
+          conn->transportSettings.writeConnectionDataPacketsLimit));
+  EXPECT_EQ(0, conn->outstandingPackets.size());
+  EXPECT_EQ(packetNum + 1, getNextPacketNum(*conn, PacketNumberSpace::AppData));
+  EXPECT_FALSE(conn->ackStates.appDataAckState.needsToSendAckImmediately);
+  EXPECT_EQ(100, *conn->ackStates.appDataAckState.largestAckScheduled);
+
+  // Nothing more until there is something new to ack.
+  EXPECT_CALL(*rawSocket, write(_, _)).Times(0);
+  EXPECT_EQ(
+      0,
+      writeAckOnlyPacket(
+          *rawSocket,
+          *conn,
+          *conn->serverConnectionId,
+          *aead,
+          *headerCipher));
+}
+
 TEST_F(QuicTransportFunctionsTest, ShouldWriteDataTest) {
   auto conn = createConn();
 
@@ -2067,5 +2428,44 @@ TEST_F(QuicTransportFunctionsTest, CongestionControlWritableBytesRoundUp) {
   EXPECT_EQ(conn->udpSendPacketLen * 2, congestionControlWritableBytes(*conn));
 }
 
+TEST_F(QuicTransportFunctionsTest, AdaptiveBatchSize) {
+  auto conn = createConn();
+  conn->udpSendPacketLen = 1000;
+  conn->transportSettings.maxBatchSize = 16;
+  auto now = Clock::now();
+  EXPECT_EQ(16, getWriteBatchSize(*conn, now));
+
+  conn->transportSettings.adaptiveBatchSize = true;
+  auto mockCongestionController =
+      std::make_unique<NiceMock<MockCongestionController>>();
+  auto rawCongestionController = mockCongestionController.get();
+  conn->congestionController = std::move(mockCongestionController);
+  // A quarter of the congestion window.
+  EXPECT_CALL(*rawCongestionController, getCongestionWindow())
+      .WillRepeatedly(Return(40000));
+  EXPECT_EQ(10, getWriteBatchSize(*conn, now));
+  EXPECT_CALL(*rawCongestionController, getCongestionWindow())
+      .WillRepeatedly(Return(1000000));
+  EXPECT_EQ(16, getWriteBatchSize(*conn, now));
+
+  // Halved on loss, and grown back by one each round trip.
+  conn->lossState.srtt = 10ms;
+  onLossEventForBatchSize(*conn);
+  EXPECT_EQ(8, conn->burstTolerance);
+  EXPECT_EQ(8, getWriteBatchSize(*conn, conn->burstToleranceUpdateTime));
+  EXPECT_EQ(
+      9, getWriteBatchSize(*conn, conn->burstToleranceUpdateTime + 10ms));
+
+  // A paced burst of 20 goes out in two even batches.
+  conn->burstTolerance = 16;
+  conn->transportSettings.pacingEnabled = true;
+  conn->canBePaced = true;
+  auto mockPacer = std::make_unique<NiceMock<MockPacer>>();
+  EXPECT_CALL(*mockPacer, getCachedWriteBatchSize())
+      .WillRepeatedly(Return(20));
+  conn->pacer = std::move(mockPacer);
+  EXPECT_EQ(10, getWriteBatchSize(*conn, conn->burstToleranceUpdateTime));
+}
+
 } // namespace test
 } // namespace quic
@@ -2031,6 +2031,31 @@ TEST_F(QuicTransportTest, NotifyPendingWriteConnAsync) {
       NetworkData(IOBuf::copyBuffer("fake data"), Clock::now()));
 }
 
+TEST_F(QuicTransportTest, UpdateLiveTransportSettings) {
+  auto& conn = transport_->getConnectionState();
+  conn.transportParametersEncoded = true;
+  auto idleTimeout = conn.transportSettings.idleTimeout;
+  ASSERT_EQ(nullptr, conn.pacer);
+
+  TransportSettings transportSettings = conn.transportSettings;
+  transportSettings.pacingEnabled = true;
+  transportSettings.writeConnectionDataPacketsLimit = 3;
+  transportSettings.maxBatchSize = 4;
+  transportSettings.rxPacketsBeforeAckAfterInit = 5;
+  transportSettings.idleTimeout = idleTimeout + std::chrono::seconds(1);
+  // Ignored once the transport parameters are out.
+  transport_->setTransportSettings(transportSettings);
+  EXPECT_FALSE(conn.transportSettings.pacingEnabled);
+
+  transport_->updateLiveTransportSettings(transportSettings);
+  EXPECT_TRUE(conn.transportSettings.pacingEnabled);
+  EXPECT_NE(nullptr, conn.pacer);
+  EXPECT_EQ(3, conn.transportSettings.writeConnectionDataPacketsLimit);
+  EXPECT_EQ(4, conn.transportSettings.maxBatchSize);
+  EXPECT_EQ(5, conn.transportSettings.rxPacketsBeforeAckAfterInit);
+  EXPECT_EQ(idleTimeout, conn.transportSettings.idleTimeout);
+}
+
 TEST_F(QuicTransportTest, NotifyPendingWriteConnBufferFreeUpSpace) {
   TransportSettings transportSettings;
   transportSettings.totalBufferSpaceAvailable = 100;
@@ -2343,7 +2368,9 @@ TEST_F(QuicTransportTest, WriteStreamFromMiddleOfMap) {
   conn.outstandingPackets.clear();
 
   // Start from stream2 instead of stream1
-  conn.schedulingState.nextScheduledStream = s2;
+  conn.streamManager->writableStreams()
+      .level(kDefaultPriority)
+      .setNextScheduled(s2);
   writableBytes = kDefaultUDPSendPacketLen - 100;
 
   EXPECT_CALL(*socket_, write(_, _)).WillOnce(Invoke(bufLength));
@@ -2366,7 +2393,9 @@ TEST_F(QuicTransportTest, WriteStreamFromMiddleOfMap) {
   conn.outstandingPackets.clear();
 
   // Test wrap around
-  conn.schedulingState.nextScheduledStream = s2;
+  conn.streamManager->writableStreams()
+      .level(kDefaultPriority)
+      .setNextScheduled(s2);
   writableBytes = kDefaultUDPSendPacketLen;
   EXPECT_CALL(*socket_, write(_, _)).WillOnce(Invoke(bufLength));
   writeQuicDataToSocket(
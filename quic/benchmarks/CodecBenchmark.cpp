@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/io/Cursor.h>
+
+#include <quic/codec/Decode.h>
+#include <quic/codec/QuicInteger.h>
+#include <quic/codec/QuicPacketBuilder.h>
+#include <quic/codec/QuicWriteCodec.h>
+#include <quic/common/test/TestUtils.h>
+
+#include <array>
+
+using namespace quic;
+using namespace quic::test;
+
+namespace {
+
+// One value for each of the four quic integer encodings.
+const std::array<uint64_t, 4> kIntegers = {
+    37, 15293, 494878333, 151288809941952652};
+
+constexpr size_t kPacketLen = kDefaultUDPSendPacketLen;
+
+RegularQuicPacketBuilder makeBuilder() {
+  ShortHeader header(ProtectionType::KeyPhaseZero, getTestConnectionId(), 1);
+  return RegularQuicPacketBuilder(kPacketLen, std::move(header), 0);
+}
+
+ShortHeader makeHeader() {
+  return ShortHeader(ProtectionType::KeyPhaseZero, getTestConnectionId(), 1);
+}
+
+Buf makeEncodedIntegers() {
+  auto buf = folly::IOBuf::create(kIntegers.size() * sizeof(uint64_t));
+  BufAppender appender(buf.get(), buf->capacity());
+  for (auto value : kIntegers) {
+    encodeQuicInteger(value, [&](auto val) { appender.writeBE(val); });
+  }
+  return buf;
+}
+
+// A packet body holding a single stream frame with the given payload length.
+Buf makeStreamFrame(size_t dataLen) {
+  auto builder = makeBuilder();
+  auto data = buildRandomInputData(dataLen);
+  auto dataWritten = writeStreamFrameHeader(
+      builder, 4, 1000, dataLen, dataLen, false /* fin */);
+  CHECK(dataWritten.hasValue());
+  writeStreamFrameData(builder, std::move(data), *dataWritten);
+  return std::move(builder).buildPacket().body;
+}
+
+AckBlocks makeAckBlocks(size_t numBlocks) {
+  AckBlocks ackBlocks;
+  for (PacketNum start = 0; start < numBlocks * 4; start += 4) {
+    ackBlocks.insert(start, start + 1);
+  }
+  return ackBlocks;
+}
+
+} // namespace
+
+BENCHMARK(EncodeQuicInteger, iters) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    for (auto value : kIntegers) {
+      encodeQuicInteger(value, [&](auto val) { sum += val; });
+    }
+  }
+  folly::doNotOptimizeAway(sum);
+}
+
+BENCHMARK(DecodeQuicInteger, iters) {
+  Buf buf;
+  BENCHMARK_SUSPEND {
+    buf = makeEncodedIntegers();
+  }
+  uint64_t sum = 0;
+  for (size_t i = 0; i < iters; ++i) {
+    folly::io::Cursor cursor(buf.get());
+    for (size_t j = 0; j < kIntegers.size(); ++j) {
+      sum += decodeQuicInteger(cursor)->first;
+    }
+  }
+  folly::doNotOptimizeAway(sum);
+}
+
+BENCHMARK_DRAW_LINE();
+
+void decodeStreamFrameBench(size_t iters, size_t dataLen) {
+  Buf frame;
+  BENCHMARK_SUSPEND {
+    frame = makeStreamFrame(dataLen);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    BufQueue queue(frame->clone());
+    // Stream frame types always fit in one byte.
+    StreamTypeField frameType(*queue.front()->data());
+    queue.trimStart(1);
+    auto streamFrame = decodeStreamFrame(queue, frameType);
+    folly::doNotOptimizeAway(streamFrame);
+  }
+}
+
+BENCHMARK_PARAM(decodeStreamFrameBench, 100);
+BENCHMARK_PARAM(decodeStreamFrameBench, 1200);
+
+void parseFrameBench(size_t iters, size_t dataLen) {
+  Buf frame;
+  BENCHMARK_SUSPEND {
+    frame = makeStreamFrame(dataLen);
+  }
+  auto header = makeHeader();
+  CodecParameters params(kDefaultAckDelayExponent, QuicVersion::MVFST);
+  for (size_t i = 0; i < iters; ++i) {
+    BufQueue queue(frame->clone());
+    auto parsed = parseFrame(queue, header, params);
+    folly::doNotOptimizeAway(parsed);
+  }
+}
+
+BENCHMARK_PARAM(parseFrameBench, 100);
+BENCHMARK_PARAM(parseFrameBench, 1200);
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(WriteStreamFrameHeader, iters) {
+  folly::BenchmarkSuspender suspender;
+  for (size_t i = 0; i < iters; ++i) {
+    auto builder = makeBuilder();
+    suspender.dismiss();
+    auto dataLen = writeStreamFrameHeader(
+        builder, 4, i * 1000, 1000, 1000, false /* fin */);
+    folly::doNotOptimizeAway(dataLen);
+    suspender.rehire();
+  }
+}
+
+void writeAckFrameBench(size_t iters, size_t numBlocks) {
+  folly::BenchmarkSuspender suspender;
+  auto ackBlocks = makeAckBlocks(numBlocks);
+  AckFrameMetaData meta(
+      ackBlocks, std::chrono::microseconds(100), kDefaultAckDelayExponent);
+  for (size_t i = 0; i < iters; ++i) {
+    auto builder = makeBuilder();
+    suspender.dismiss();
+    auto result = writeAckFrame(meta, builder);
+    folly::doNotOptimizeAway(result);
+    suspender.rehire();
+  }
+}
+
+BENCHMARK_PARAM(writeAckFrameBench, 1);
+BENCHMARK_PARAM(writeAckFrameBench, 64);
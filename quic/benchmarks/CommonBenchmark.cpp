@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <folly/Benchmark.h>
+
+#include <quic/QuicConstants.h>
+#include <quic/codec/Types.h>
+#include <quic/common/BufUtil.h>
+#include <quic/common/IntervalSet.h>
+
+using namespace quic;
+
+namespace {
+
+constexpr size_t kIntervalSetPoints = 1000;
+
+} // namespace
+
+// Packet numbers received in order, which extend the last interval.
+BENCHMARK(IntervalSetInsertInOrder, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    AckBlocks ackBlocks;
+    for (PacketNum num = 0; num < kIntervalSetPoints; ++num) {
+      ackBlocks.insert(num);
+    }
+    folly::doNotOptimizeAway(ackBlocks.size());
+  }
+}
+
+// Every other packet number is missing, so each insert adds an interval.
+BENCHMARK_RELATIVE(IntervalSetInsertWithGaps, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    AckBlocks ackBlocks;
+    for (PacketNum num = 0; num < kIntervalSetPoints * 2; num += 2) {
+      ackBlocks.insert(num);
+    }
+    folly::doNotOptimizeAway(ackBlocks.size());
+  }
+}
+
+// The gaps from above are then filled backwards, merging the intervals.
+BENCHMARK_RELATIVE(IntervalSetInsertFillGaps, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    AckBlocks ackBlocks;
+    BENCHMARK_SUSPEND {
+      for (PacketNum num = 0; num < kIntervalSetPoints * 2; num += 2) {
+        ackBlocks.insert(num);
+      }
+    }
+    for (size_t j = kIntervalSetPoints; j > 0; --j) {
+      ackBlocks.insert(j * 2 - 1);
+    }
+    folly::doNotOptimizeAway(ackBlocks.size());
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+// Appends numBufs buffers of 1000 bytes, then splits them back into packet
+// sized chunks, which is what the stream write path does.
+void bufQueueSplitBench(size_t iters, size_t numBufs) {
+  for (size_t i = 0; i < iters; ++i) {
+    BufQueue queue;
+    BENCHMARK_SUSPEND {
+      for (size_t j = 0; j < numBufs; ++j) {
+        auto buf = folly::IOBuf::create(1000);
+        buf->append(1000);
+        queue.append(std::move(buf));
+      }
+    }
+    while (!queue.empty()) {
+      auto chunk = queue.splitAtMost(kDefaultUDPSendPacketLen);
+      folly::doNotOptimizeAway(chunk);
+    }
+  }
+}
+
+void bufQueueAppendBench(size_t iters, size_t numBufs) {
+  std::vector<Buf> bufs;
+  bufs.reserve(numBufs);
+  for (size_t i = 0; i < iters; ++i) {
+    BENCHMARK_SUSPEND {
+      for (size_t j = 0; j < numBufs; ++j) {
+        auto buf = folly::IOBuf::create(1000);
+        buf->append(1000);
+        bufs.push_back(std::move(buf));
+      }
+    }
+    BufQueue queue;
+    for (auto& buf : bufs) {
+      queue.append(std::move(buf));
+    }
+    folly::doNotOptimizeAway(queue.chainLength());
+    BENCHMARK_SUSPEND {
+      bufs.clear();
+      queue.move();
+    }
+  }
+}
+
+BENCHMARK_PARAM(bufQueueAppendBench, 16);
+BENCHMARK_PARAM(bufQueueSplitBench, 16);
+BENCHMARK_PARAM(bufQueueSplitBench, 256);
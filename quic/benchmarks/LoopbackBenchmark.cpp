@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <folly/Benchmark.h>
+
+#include <quic/common/test/LoopbackTransportPair.h>
+#include <quic/common/test/TestUtils.h>
+
+using namespace quic;
+using namespace quic::test;
+
+namespace {
+
+constexpr size_t kRequestSize = 100;
+
+} // namespace
+
+// The full handshake of a new connection, up to both ends being done with it,
+// then the client closing it.
+BENCHMARK(LoopbackHandshakeAndClose, iters) {
+  folly::BenchmarkSuspender suspender;
+  folly::EventBase evb;
+  for (size_t i = 0; i < iters; ++i) {
+    LoopbackConnectionHandler clientHandler;
+    LoopbackConnectionHandler serverHandler;
+    LoopbackTransportPair pair(
+        evb,
+        clientHandler,
+        serverHandler,
+        LoopbackTransportPair::benchmarkSettings(),
+        LoopbackTransportPair::benchmarkSettings());
+    suspender.dismiss();
+    pair.connect();
+    pair.client().close(folly::none);
+    pair.loopUntil([&] { return serverHandler.connectionEnded; });
+    suspender.rehire();
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+// One request of kRequestSize bytes and its response of responseSize bytes,
+// each on a new stream of one connection, one after the other.
+void requestResponseBench(size_t iters, size_t responseSize) {
+  folly::BenchmarkSuspender suspender;
+  folly::EventBase evb;
+  LoopbackConnectionHandler clientHandler;
+  LoopbackConnectionHandler serverHandler;
+  serverHandler.response = buildRandomInputData(responseSize);
+  LoopbackTransportPair pair(
+      evb,
+      clientHandler,
+      serverHandler,
+      LoopbackTransportPair::benchmarkSettings(),
+      LoopbackTransportPair::benchmarkSettings());
+  pair.connect();
+  clientHandler.socket = &pair.client();
+  serverHandler.socket = &pair.server();
+  auto request = buildRandomInputData(kRequestSize);
+  suspender.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    auto id = pair.client().createBidirectionalStream().value();
+    pair.client().setReadCallback(id, &clientHandler);
+    pair.client().writeChain(id, request->clone(), true, false /* cork */);
+    pair.loopUntil([&] { return clientHandler.streamsDone == i + 1; });
+  }
+  suspender.rehire();
+}
+
+BENCHMARK_PARAM(requestResponseBench, 100);
+BENCHMARK_PARAM(requestResponseBench, 10000);
+BENCHMARK_PARAM(requestResponseBench, 1000000);
+
+BENCHMARK_DRAW_LINE();
+
+// Sends chunkSize bytes on one stream of one connection and waits for the
+// server to read them. The time per byte is the time per iteration divided by
+// chunkSize.
+void bulkTransferBench(size_t iters, size_t chunkSize) {
+  folly::BenchmarkSuspender suspender;
+  folly::EventBase evb;
+  LoopbackConnectionHandler clientHandler;
+  LoopbackConnectionHandler serverHandler;
+  LoopbackTransportPair pair(
+      evb,
+      clientHandler,
+      serverHandler,
+      LoopbackTransportPair::benchmarkSettings(),
+      LoopbackTransportPair::benchmarkSettings());
+  pair.connect();
+  clientHandler.socket = &pair.client();
+  serverHandler.socket = &pair.server();
+  auto chunk = buildRandomInputData(chunkSize);
+  auto id = pair.client().createBidirectionalStream().value();
+  suspender.dismiss();
+  for (size_t i = 0; i < iters; ++i) {
+    pair.client().writeChain(id, chunk->clone(), false, false /* cork */);
+    pair.loopUntil(
+        [&] { return serverHandler.bytesRead == (i + 1) * chunkSize; });
+  }
+  suspender.rehire();
+}
+
+BENCHMARK_PARAM(bulkTransferBench, 16384);
+BENCHMARK_PARAM(bulkTransferBench, 1048576);
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <folly/Benchmark.h>
+
+#include <quic/api/QuicPacketScheduler.h>
+#include <quic/codec/QuicInteger.h>
+#include <quic/codec/QuicPacketBuilder.h>
+#include <quic/common/test/TestUtils.h>
+#include <quic/server/state/ServerStateMachine.h>
+#include <quic/state/AckHandlers.h>
+#include <quic/state/QuicStateFunctions.h>
+#include <quic/state/QuicStreamFunctions.h>
+
+using namespace quic;
+using namespace quic::test;
+
+namespace {
+
+RegularQuicPacketBuilder makeBuilder(QuicConnectionStateBase& conn) {
+  ShortHeader header(
+      ProtectionType::KeyPhaseZero,
+      getTestConnectionId(),
+      getNextPacketNum(conn, PacketNumberSpace::AppData));
+  return RegularQuicPacketBuilder(
+      conn.udpSendPacketLen,
+      std::move(header),
+      conn.ackStates.appDataAckState.largestAckedByPeer);
+}
+
+} // namespace
+
+// Builds one packet out of numStreams writable streams with 100 bytes each.
+// The scheduler doesn't consume the stream data, so every packet starts where
+// the previous one stopped in the round robin.
+void writeStreamsBench(size_t iters, size_t numStreams) {
+  folly::BenchmarkSuspender suspender;
+  QuicServerConnectionState conn;
+  conn.streamManager->setMaxLocalBidirectionalStreams(numStreams);
+  conn.flowControlState.peerAdvertisedMaxOffset = kEightByteLimit;
+  conn.flowControlState.peerAdvertisedInitialMaxStreamOffsetBidiRemote =
+      kEightByteLimit;
+  for (size_t i = 0; i < numStreams; ++i) {
+    auto stream = conn.streamManager->createNextBidirectionalStream().value();
+    writeDataToQuicStream(*stream, buildRandomInputData(100), false);
+  }
+  StreamFrameScheduler scheduler(conn);
+  for (size_t i = 0; i < iters; ++i) {
+    auto builder = makeBuilder(conn);
+    suspender.dismiss();
+    scheduler.writeStreams(builder);
+    suspender.rehire();
+    folly::doNotOptimizeAway(builder.remainingSpaceInPkt());
+  }
+}
+
+BENCHMARK_PARAM(writeStreamsBench, 1);
+BENCHMARK_PARAM(writeStreamsBench, 100);
+BENCHMARK_PARAM(writeStreamsBench, 10000);
+
+BENCHMARK_DRAW_LINE();
+
+// Acks every other one of numPackets outstanding packets, newest first, which
+// is the worst case for the number of ack blocks.
+void processAckFrameBench(size_t iters, size_t numPackets) {
+  folly::BenchmarkSuspender suspender;
+  QuicServerConnectionState conn;
+  // Nothing should be declared lost by the acks.
+  conn.lossState.reorderingThreshold = numPackets;
+  conn.lossState.srtt = std::chrono::seconds(10);
+  ReadAckFrame ackFrame;
+  ackFrame.largestAcked = numPackets - 1;
+  for (size_t i = 0; i < numPackets / 2; ++i) {
+    PacketNum num = numPackets - 1 - i * 2;
+    ackFrame.ackBlocks.emplace_back(num, num);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    auto sentTime = Clock::now();
+    for (PacketNum num = 0; num < numPackets; ++num) {
+      conn.outstandingPackets.emplace_back(OutstandingPacket(
+          createNewPacket(num, PacketNumberSpace::AppData),
+          sentTime,
+          kDefaultUDPSendPacketLen,
+          false /* isHandshake */,
+          num * kDefaultUDPSendPacketLen));
+    }
+    suspender.dismiss();
+    processAckFrame(
+        conn,
+        PacketNumberSpace::AppData,
+        ackFrame,
+        [](const auto&, const auto&, const auto&) {},
+        [](auto&, auto&, bool, PacketNum) {},
+        sentTime);
+    suspender.rehire();
+    conn.outstandingPackets.clear();
+  }
+}
+
+BENCHMARK_PARAM(processAckFrameBench, 100);
+BENCHMARK_PARAM(processAckFrameBench, 1000);
+BENCHMARK_PARAM(processAckFrameBench, 10000);
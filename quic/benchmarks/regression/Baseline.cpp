@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/benchmarks/regression/Baseline.h>
+
+#include <folly/Conv.h>
+
+namespace quic {
+namespace regression {
+
+folly::Expected<Baseline, std::string> parseBaseline(
+    const folly::dynamic& json) {
+  if (!json.isObject()) {
+    return folly::makeUnexpected(std::string("Baseline is not an object"));
+  }
+  Baseline baseline;
+  for (const auto& entry : json.items()) {
+    const auto& metric = entry.first;
+    const auto& fields = entry.second;
+    if (!metric.isString() || !fields.isObject()) {
+      return folly::makeUnexpected(
+          folly::to<std::string>("Bad baseline entry: ", metric.asString()));
+    }
+    MetricBaseline metricBaseline;
+    auto value = fields.get_ptr("value");
+    if (value && !value->isNull()) {
+      if (!value->isNumber()) {
+        return folly::makeUnexpected(folly::to<std::string>(
+            "Value of ", metric.asString(), " is not a number"));
+      }
+      metricBaseline.value = value->asDouble();
+    }
+    auto tolerance = fields.get_ptr("tolerance");
+    if (tolerance) {
+      if (!tolerance->isNumber() || tolerance->asDouble() < 0) {
+        return folly::makeUnexpected(folly::to<std::string>(
+            "Tolerance of ", metric.asString(), " is not a fraction"));
+      }
+      metricBaseline.tolerance = tolerance->asDouble();
+    }
+    baseline.emplace(metric.asString(), metricBaseline);
+  }
+  return baseline;
+}
+
+folly::dynamic toDynamic(const Baseline& baseline) {
+  folly::dynamic json = folly::dynamic::object;
+  for (const auto& entry : baseline) {
+    folly::dynamic fields =
+        folly::dynamic::object("tolerance", entry.second.tolerance);
+    if (entry.second.value) {
+      fields["value"] = *entry.second.value;
+    }
+    json[entry.first] = std::move(fields);
+  }
+  return json;
+}
+
+Baseline updateBaseline(
+    const Baseline& baseline,
+    const std::vector<ScenarioResult>& results) {
+  Baseline updated = baseline;
+  for (const auto& result : results) {
+    updated[result.metric].value = result.value;
+  }
+  return updated;
+}
+
+std::vector<MetricComparison> compareToBaseline(
+    const std::vector<ScenarioResult>& results,
+    const Baseline& baseline) {
+  std::vector<MetricComparison> comparisons;
+  for (const auto& result : results) {
+    MetricComparison comparison;
+    comparison.metric = result.metric;
+    comparison.value = result.value;
+    auto itr = baseline.find(result.metric);
+    if (itr != baseline.end() && itr->second.value &&
+        *itr->second.value > 0) {
+      auto expected = *itr->second.value;
+      comparison.baseline = expected;
+      comparison.change = (result.value - expected) / expected;
+      comparison.regressed = *comparison.change < -itr->second.tolerance;
+    }
+    comparisons.push_back(std::move(comparison));
+  }
+  return comparisons;
+}
+
+} // namespace regression
+} // namespace quic
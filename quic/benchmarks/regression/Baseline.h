@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Expected.h>
+#include <folly/Optional.h>
+#include <folly/dynamic.h>
+
+#include <quic/benchmarks/regression/RegressionScenarios.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace quic {
+namespace regression {
+
+struct MetricBaseline {
+  // None until a run on the reference machine recorded it.
+  folly::Optional<double> value;
+  // How far below value a result may fall, as a fraction of value, before it
+  // counts as a regression.
+  double tolerance{0.05};
+};
+
+/**
+ * The expected results, keyed by metric, in the JSON form
+ *   {"metric": {"value": 123.4, "tolerance": 0.05}, ...}
+ * where value may be left out.
+ */
+using Baseline = std::map<std::string, MetricBaseline>;
+
+folly::Expected<Baseline, std::string> parseBaseline(
+    const folly::dynamic& json);
+
+folly::dynamic toDynamic(const Baseline& baseline);
+
+/**
+ * The baseline with the values of results, and the tolerances of the old one,
+ * or the default one for new metrics.
+ */
+Baseline updateBaseline(
+    const Baseline& baseline,
+    const std::vector<ScenarioResult>& results);
+
+struct MetricComparison {
+  std::string metric;
+  double value;
+  folly::Optional<double> baseline;
+  // value relative to baseline, e.g. -0.1 for 10% lower.
+  folly::Optional<double> change;
+  bool regressed{false};
+};
+
+/**
+ * Compares every result with its baseline. A metric without a baseline value
+ * is reported but never regressed.
+ */
+std::vector<MetricComparison> compareToBaseline(
+    const std::vector<ScenarioResult>& results,
+    const Baseline& baseline);
+
+} // namespace regression
+} // namespace quic
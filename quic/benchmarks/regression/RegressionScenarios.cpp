@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/benchmarks/regression/RegressionScenarios.h>
+
+#include <quic/common/test/LoopbackTransportPair.h>
+#include <quic/common/test/TestUtils.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace quic {
+namespace regression {
+
+namespace {
+using test::LoopbackConnectionHandler;
+using test::LoopbackTransportPair;
+
+constexpr size_t kBulkChunkSize = 1024 * 1024;
+constexpr size_t kBulkChunks = 256;
+constexpr size_t kLossyBulkChunks = 32;
+constexpr size_t kSmallRequestSize = 100;
+constexpr size_t kSmallRequests = 5000;
+constexpr size_t kHandshakes = 200;
+// Every this many datagrams of the client, one is dropped in the lossy
+// scenario.
+constexpr uint64_t kLossyDropInterval = 100;
+
+using Seconds = std::chrono::duration<double>;
+
+size_t scaled(size_t n, double scale) {
+  return std::max<size_t>(1, n * scale);
+}
+
+// A connected pair with both handlers set up.
+struct ConnectedPair {
+  explicit ConnectedPair(folly::EventBase& evb)
+      : pair(
+            evb,
+            clientHandler,
+            serverHandler,
+            LoopbackTransportPair::benchmarkSettings(),
+            LoopbackTransportPair::benchmarkSettings()) {
+    pair.connect();
+    clientHandler.socket = &pair.client();
+    serverHandler.socket = &pair.server();
+  }
+
+  LoopbackConnectionHandler clientHandler;
+  LoopbackConnectionHandler serverHandler;
+  LoopbackTransportPair pair;
+};
+
+// MB a second for chunks of kBulkChunkSize bytes on one stream.
+double bulkTransfer(size_t chunks, bool lossy) {
+  folly::EventBase evb;
+  ConnectedPair connected(evb);
+  auto& pair = connected.pair;
+  if (lossy) {
+    uint64_t datagrams = 0;
+    pair.setDropFn([datagrams](bool fromClient, const folly::IOBuf&) mutable {
+      return fromClient && ++datagrams % kLossyDropInterval == 0;
+    });
+  }
+  auto chunk = test::buildRandomInputData(kBulkChunkSize);
+  auto id = pair.client().createBidirectionalStream().value();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < chunks; ++i) {
+    pair.client().writeChain(id, chunk->clone(), false, false /* cork */);
+    pair.loopUntil([&] {
+      return connected.serverHandler.bytesRead == (i + 1) * kBulkChunkSize;
+    });
+  }
+  Seconds elapsed = std::chrono::steady_clock::now() - start;
+  return chunks * kBulkChunkSize / elapsed.count() / 1e6;
+}
+
+double smallRequests(size_t requests) {
+  folly::EventBase evb;
+  ConnectedPair connected(evb);
+  auto& pair = connected.pair;
+  connected.serverHandler.response =
+      test::buildRandomInputData(kSmallRequestSize);
+  auto request = test::buildRandomInputData(kSmallRequestSize);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < requests; ++i) {
+    auto id = pair.client().createBidirectionalStream().value();
+    pair.client().setReadCallback(id, &connected.clientHandler);
+    pair.client().writeChain(id, request->clone(), true, false /* cork */);
+    pair.loopUntil(
+        [&] { return connected.clientHandler.streamsDone == i + 1; });
+  }
+  Seconds elapsed = std::chrono::steady_clock::now() - start;
+  return requests / elapsed.count();
+}
+
+double handshakes(size_t count) {
+  folly::EventBase evb;
+  Seconds elapsed{0};
+  for (size_t i = 0; i < count; ++i) {
+    LoopbackConnectionHandler clientHandler;
+    LoopbackConnectionHandler serverHandler;
+    LoopbackTransportPair pair(
+        evb,
+        clientHandler,
+        serverHandler,
+        LoopbackTransportPair::benchmarkSettings(),
+        LoopbackTransportPair::benchmarkSettings());
+    // Only the handshake is timed, not making the contexts or closing.
+    auto start = std::chrono::steady_clock::now();
+    pair.connect();
+    elapsed += std::chrono::steady_clock::now() - start;
+  }
+  return count / elapsed.count();
+}
+
+template <class Scenario>
+double bestOf(uint32_t runs, Scenario scenario) {
+  double best = 0;
+  for (uint32_t i = 0; i < std::max<uint32_t>(runs, 1); ++i) {
+    best = std::max(best, scenario());
+  }
+  return best;
+}
+} // namespace
+
+std::vector<ScenarioResult> runScenarios(const ScenarioOptions& options) {
+  std::vector<ScenarioResult> results;
+  results.push_back({"loopback_bulk_MBps", bestOf(options.runs, [&] {
+                       return bulkTransfer(
+                           scaled(kBulkChunks, options.scale), false);
+                     })});
+  results.push_back({"small_requests_per_sec", bestOf(options.runs, [&] {
+                       return smallRequests(
+                           scaled(kSmallRequests, options.scale));
+                     })});
+  results.push_back({"lossy_bulk_MBps", bestOf(options.runs, [&] {
+                       return bulkTransfer(
+                           scaled(kLossyBulkChunks, options.scale), true);
+                     })});
+  results.push_back({"handshakes_per_sec", bestOf(options.runs, [&] {
+                       return handshakes(scaled(kHandshakes, options.scale));
+                     })});
+  return results;
+}
+
+folly::dynamic toDynamic(const std::vector<ScenarioResult>& results) {
+  folly::dynamic metrics = folly::dynamic::object;
+  for (const auto& result : results) {
+    metrics[result.metric] = result.value;
+  }
+  return folly::dynamic::object("results", std::move(metrics));
+}
+
+} // namespace regression
+} // namespace quic
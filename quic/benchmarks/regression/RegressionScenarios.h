@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/dynamic.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace quic {
+namespace regression {
+
+/**
+ * One number a scenario measured. All of them are rates, so higher is better.
+ */
+struct ScenarioResult {
+  std::string metric;
+  double value;
+};
+
+struct ScenarioOptions {
+  // Each scenario runs this many times and keeps its best run, which is the
+  // least disturbed by the rest of the machine.
+  uint32_t runs{3};
+  // Scales the work of every scenario, for quick runs.
+  double scale{1.0};
+};
+
+/**
+ * Runs the fixed matrix over a LoopbackTransportPair, in this order:
+ * - loopback_bulk_MBps: one stream carrying a large transfer.
+ * - small_requests_per_sec: 100 byte requests with 100 byte responses, one
+ *   stream each, one after the other.
+ * - lossy_bulk_MBps: the bulk transfer with every 100th datagram of the
+ *   client dropped.
+ * - handshakes_per_sec: new connections, from the first datagram to both ends
+ *   being done with the handshake.
+ */
+std::vector<ScenarioResult> runScenarios(const ScenarioOptions& options);
+
+folly::dynamic toDynamic(const std::vector<ScenarioResult>& results);
+
+} // namespace regression
+} // namespace quic
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <glog/logging.h>
+
+#include <folly/FileUtil.h>
+#include <folly/init/Init.h>
+#include <folly/json.h>
+#include <folly/portability/GFlags.h>
+
+#include <quic/benchmarks/regression/Baseline.h>
+#include <quic/benchmarks/regression/RegressionScenarios.h>
+
+DEFINE_string(
+    baseline,
+    "",
+    "Baseline to compare the results with, e.g. "
+    "quic/benchmarks/regression/baseline.json");
+DEFINE_bool(
+    write_baseline,
+    false,
+    "Write the results as the values of --baseline instead of comparing");
+DEFINE_string(output, "", "Where to write the results as JSON");
+DEFINE_uint32(runs, 3, "Runs of each scenario, the best one counts");
+DEFINE_double(scale, 1.0, "Scales the work of every scenario");
+
+using namespace quic::regression;
+
+int main(int argc, char* argv[]) {
+#if FOLLY_HAVE_LIBGFLAGS
+  // Enable glog logging to stderr by default.
+  gflags::SetCommandLineOptionWithMode(
+      "logtostderr", "1", gflags::SET_FLAGS_DEFAULT);
+#endif
+  gflags::ParseCommandLineFlags(&argc, &argv, false);
+  folly::Init init(&argc, &argv);
+
+  Baseline baseline;
+  if (!FLAGS_baseline.empty()) {
+    std::string contents;
+    if (folly::readFile(FLAGS_baseline.c_str(), contents)) {
+      auto parsed = parseBaseline(folly::parseJson(contents));
+      if (parsed.hasError()) {
+        LOG(ERROR) << "Bad baseline " << FLAGS_baseline << ": "
+                   << parsed.error();
+        return 1;
+      }
+      baseline = std::move(*parsed);
+    } else if (!FLAGS_write_baseline) {
+      LOG(ERROR) << "Can't read baseline: " << FLAGS_baseline;
+      return 1;
+    }
+  }
+
+  ScenarioOptions options;
+  options.runs = FLAGS_runs;
+  options.scale = FLAGS_scale;
+  auto results = runScenarios(options);
+
+  if (!FLAGS_output.empty() &&
+      !folly::writeFile(
+          folly::toPrettyJson(toDynamic(results)), FLAGS_output.c_str())) {
+    LOG(ERROR) << "Can't write results: " << FLAGS_output;
+    return 1;
+  }
+  if (FLAGS_write_baseline) {
+    if (FLAGS_baseline.empty() ||
+        !folly::writeFile(
+            folly::toPrettyJson(toDynamic(updateBaseline(baseline, results))),
+            FLAGS_baseline.c_str())) {
+      LOG(ERROR) << "Can't write baseline: " << FLAGS_baseline;
+      return 1;
+    }
+  }
+
+  bool regressed = false;
+  for (const auto& comparison : compareToBaseline(results, baseline)) {
+    if (!comparison.baseline || FLAGS_write_baseline) {
+      LOG(INFO) << comparison.metric << "=" << comparison.value;
+      continue;
+    }
+    LOG(INFO) << comparison.metric << "=" << comparison.value
+              << " baseline=" << *comparison.baseline
+              << " change=" << *comparison.change * 100 << "%"
+              << (comparison.regressed ? " REGRESSED" : "");
+    regressed |= comparison.regressed;
+  }
+  return regressed ? 2 : 0;
+}
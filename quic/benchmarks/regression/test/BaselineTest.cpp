@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/benchmarks/regression/Baseline.h>
+
+#include <gtest/gtest.h>
+
+namespace quic {
+namespace regression {
+namespace test {
+
+TEST(BaselineTest, Parse) {
+  auto json = folly::dynamic::object(
+      "bulk", folly::dynamic::object("value", 100)("tolerance", 0.1))(
+      "requests", folly::dynamic::object("tolerance", 0.2))(
+      "handshakes", folly::dynamic::object);
+  auto baseline = parseBaseline(json);
+  ASSERT_TRUE(baseline.hasValue()) << baseline.error();
+  EXPECT_EQ(100, *baseline->at("bulk").value);
+  EXPECT_EQ(0.1, baseline->at("bulk").tolerance);
+  EXPECT_FALSE(baseline->at("requests").value.has_value());
+  EXPECT_EQ(0.2, baseline->at("requests").tolerance);
+  EXPECT_EQ(MetricBaseline().tolerance, baseline->at("handshakes").tolerance);
+
+  auto again = parseBaseline(toDynamic(*baseline));
+  ASSERT_TRUE(again.hasValue());
+  EXPECT_EQ(100, *again->at("bulk").value);
+  EXPECT_FALSE(again->at("requests").value.has_value());
+}
+
+TEST(BaselineTest, ParseErrors) {
+  EXPECT_TRUE(parseBaseline(folly::dynamic::array()).hasError());
+  EXPECT_TRUE(parseBaseline(folly::dynamic::object("bulk", 100)).hasError());
+  EXPECT_TRUE(parseBaseline(folly::dynamic::object(
+                                "bulk", folly::dynamic::object("value", "fast")))
+                  .hasError());
+  EXPECT_TRUE(
+      parseBaseline(folly::dynamic::object(
+                        "bulk", folly::dynamic::object("tolerance", -1)))
+          .hasError());
+}
+
+TEST(BaselineTest, Compare) {
+  Baseline baseline;
+  baseline["bulk"].value = 100;
+  baseline["bulk"].tolerance = 0.05;
+  baseline["requests"].value = 1000;
+  baseline["requests"].tolerance = 0.05;
+  baseline["handshakes"].tolerance = 0.05;
+  std::vector<ScenarioResult> results = {
+      {"bulk", 96}, {"requests", 900}, {"handshakes", 10}, {"new", 1}};
+  auto comparisons = compareToBaseline(results, baseline);
+  ASSERT_EQ(4, comparisons.size());
+  EXPECT_FALSE(comparisons[0].regressed);
+  EXPECT_DOUBLE_EQ(-0.04, *comparisons[0].change);
+  EXPECT_TRUE(comparisons[1].regressed);
+  EXPECT_DOUBLE_EQ(-0.1, *comparisons[1].change);
+  // No value recorded yet, or no baseline at all.
+  EXPECT_FALSE(comparisons[2].baseline.has_value());
+  EXPECT_FALSE(comparisons[2].regressed);
+  EXPECT_FALSE(comparisons[3].baseline.has_value());
+  EXPECT_FALSE(comparisons[3].regressed);
+}
+
+TEST(BaselineTest, Update) {
+  Baseline baseline;
+  baseline["bulk"].value = 100;
+  baseline["bulk"].tolerance = 0.2;
+  auto updated = updateBaseline(baseline, {{"bulk", 120}, {"new", 5}});
+  EXPECT_EQ(120, *updated.at("bulk").value);
+  EXPECT_EQ(0.2, updated.at("bulk").tolerance);
+  EXPECT_EQ(5, *updated.at("new").value);
+  EXPECT_EQ(MetricBaseline().tolerance, updated.at("new").tolerance);
+}
+
+} // namespace test
+} // namespace regression
+} // namespace quic
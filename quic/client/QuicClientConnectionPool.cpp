@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/client/QuicClientConnectionPool.h>
+
+#include <folly/hash/Hash.h>
+
+#include <algorithm>
+
+namespace quic {
+
+size_t QuicClientConnectionPool::KeyHash::operator()(const Key& key) const {
+  return folly::hash::hash_combine(key.host, key.port, key.alpn);
+}
+
+QuicClientConnectionPool::PooledConnection::PooledConnection(
+    QuicClientConnectionPool& poolIn,
+    Key keyIn)
+    : pool(&poolIn), key(std::move(keyIn)), idleSince(Clock::now()) {}
+
+void QuicClientConnectionPool::PooledConnection::onNewBidirectionalStream(
+    StreamId id) noexcept {
+  socket->stopSending(id, GenericApplicationErrorCode::UNKNOWN);
+  socket->resetStream(id, GenericApplicationErrorCode::UNKNOWN);
+}
+
+void QuicClientConnectionPool::PooledConnection::onNewUnidirectionalStream(
+    StreamId id) noexcept {
+  socket->stopSending(id, GenericApplicationErrorCode::UNKNOWN);
+}
+
+void QuicClientConnectionPool::PooledConnection::onStopSending(
+    StreamId /*id*/,
+    ApplicationErrorCode /*error*/) noexcept {
+  // The owner of the stream finds out from its write.
+}
+
+void QuicClientConnectionPool::PooledConnection::onConnectionEnd() noexcept {
+  ended = true;
+  if (pool) {
+    pool->onConnectionGone(this);
+  }
+}
+
+void QuicClientConnectionPool::PooledConnection::onConnectionError(
+    std::pair<QuicErrorCode, std::string> code) noexcept {
+  VLOG(4) << "Pooled connection to " << key.host << ":" << key.port
+          << " failed: " << code.second;
+  ended = true;
+  if (pool) {
+    pool->onConnectionGone(this);
+  }
+}
+
+void QuicClientConnectionPool::PooledConnection::pingAcknowledged() noexcept {
+  pingOutstanding = false;
+}
+
+void QuicClientConnectionPool::PooledConnection::pingTimeout() noexcept {
+  pingOutstanding = false;
+  if (pool) {
+    VLOG(4) << "Pooled connection to " << key.host << ":" << key.port
+            << " didn't answer ping";
+    pool->closeGracefully(this);
+  }
+}
+
+bool QuicClientConnectionPool::PooledConnection::hasRoom(
+    uint64_t maxStreams) const {
+  return (maxStreams == 0 || streams.size() < maxStreams) &&
+      socket->getNumOpenableBidirectionalStreams() > 0;
+}
+
+QuicClientConnectionPool::QuicClientConnectionPool(
+    folly::EventBase* evb,
+    ConnectionFactory factory,
+    Settings settings)
+    : evb_(evb),
+      factory_(std::move(factory)),
+      settings_(std::move(settings)),
+      healthCheckTimeout_(*this) {
+  scheduleHealthCheck();
+}
+
+QuicClientConnectionPool::~QuicClientConnectionPool() {
+  healthCheckTimeout_.cancelTimeout();
+  std::vector<std::unique_ptr<PooledConnection>> conns;
+  for (auto& conn : connections_) {
+    conns.push_back(std::move(conn.second));
+  }
+  for (auto& conn : closing_) {
+    conns.push_back(std::move(conn.second));
+  }
+  connections_.clear();
+  byKey_.clear();
+  closing_.clear();
+  for (auto& conn : conns) {
+    conn->pool = nullptr;
+    if (!conn->ended) {
+      conn->socket->closeNow(folly::none);
+    }
+    destroyLater(std::move(conn));
+  }
+}
+
+folly::Expected<QuicClientConnectionPool::PooledStream, LocalErrorCode>
+QuicClientConnectionPool::createBidirectionalStream(
+    const Key& key,
+    bool replaySafe) {
+  if (draining_) {
+    return folly::makeUnexpected(LocalErrorCode::SHUTTING_DOWN);
+  }
+  PooledConnection* best = nullptr;
+  size_t numConns = 0;
+  auto keyIt = byKey_.find(key);
+  if (keyIt != byKey_.end()) {
+    numConns = keyIt->second.size();
+    for (auto conn : keyIt->second) {
+      if (conn->hasRoom(settings_.maxStreamsPerConnection) &&
+          (!best || conn->streams.size() > best->streams.size())) {
+        best = conn;
+      }
+    }
+  }
+  if (!best) {
+    if (numConns >= settings_.maxConnectionsPerKey) {
+      return folly::makeUnexpected(LocalErrorCode::STREAM_LIMIT_EXCEEDED);
+    }
+    best = openConnection(key);
+    if (!best) {
+      return folly::makeUnexpected(LocalErrorCode::CONNECT_FAILED);
+    }
+  }
+  auto id = best->socket->createBidirectionalStream(replaySafe);
+  if (id.hasError()) {
+    return folly::makeUnexpected(id.error());
+  }
+  best->streams.insert(*id);
+  return PooledStream{best->socket, *id};
+}
+
+size_t QuicClientConnectionPool::preconnect(
+    const Key& key,
+    size_t numConnections) {
+  numConnections = std::min(numConnections, settings_.maxConnectionsPerKey);
+  while (!draining_ && this->numConnections(key) < numConnections) {
+    if (!openConnection(key)) {
+      break;
+    }
+  }
+  return this->numConnections(key);
+}
+
+void QuicClientConnectionPool::releaseStream(const PooledStream& stream) {
+  auto it = connections_.find(stream.connection.get());
+  if (it == connections_.end()) {
+    // Closing already, or gone.
+    return;
+  }
+  auto conn = it->second.get();
+  if (conn->streams.erase(stream.id) && conn->streams.empty()) {
+    conn->idleSince = Clock::now();
+    if (draining_) {
+      closeGracefully(conn);
+    }
+  }
+}
+
+void QuicClientConnectionPool::checkHealth() {
+  auto now = Clock::now();
+  std::vector<PooledConnection*> idle;
+  for (auto& conn : connections_) {
+    if (conn.second->streams.empty()) {
+      idle.push_back(conn.second.get());
+    }
+  }
+  for (auto conn : idle) {
+    if (now - conn->idleSince >= settings_.idleTimeout) {
+      closeGracefully(conn);
+    } else if (!conn->pingOutstanding) {
+      conn->pingOutstanding = true;
+      conn->socket->sendPing(conn, settings_.pingTimeout);
+    }
+  }
+}
+
+void QuicClientConnectionPool::drain(folly::Function<void()> drained) {
+  draining_ = true;
+  drained_ = std::move(drained);
+  std::vector<PooledConnection*> idle;
+  for (auto& conn : connections_) {
+    if (conn.second->streams.empty()) {
+      idle.push_back(conn.second.get());
+    }
+  }
+  for (auto conn : idle) {
+    closeGracefully(conn);
+  }
+  maybeDrained();
+}
+
+size_t QuicClientConnectionPool::numConnections() const {
+  return connections_.size();
+}
+
+size_t QuicClientConnectionPool::numConnections(const Key& key) const {
+  auto it = byKey_.find(key);
+  return it == byKey_.end() ? 0 : it->second.size();
+}
+
+QuicClientConnectionPool::PooledConnection*
+QuicClientConnectionPool::openConnection(const Key& key) {
+  auto conn = std::make_unique<PooledConnection>(*this, key);
+  // The connection isn't known to the pool until the factory returns, in
+  // case it fails right away.
+  conn->socket = factory_(key, conn.get());
+  if (!conn->socket || conn->ended) {
+    if (conn->socket) {
+      destroyLater(std::move(conn));
+    }
+    return nullptr;
+  }
+  auto opened = conn.get();
+  byKey_[key].push_back(opened);
+  connections_.emplace(opened->socket.get(), std::move(conn));
+  VLOG(10) << "New pooled connection to " << key.host << ":" << key.port
+           << " alpn=" << key.alpn;
+  return opened;
+}
+
+void QuicClientConnectionPool::scheduleHealthCheck() {
+  if (settings_.healthCheckInterval.count() > 0) {
+    evb_->timer().scheduleTimeout(
+        &healthCheckTimeout_, settings_.healthCheckInterval);
+  }
+}
+
+void QuicClientConnectionPool::closeGracefully(PooledConnection* conn) {
+  auto owned = takeConnection(conn);
+  if (!owned) {
+    return;
+  }
+  auto socket = conn->socket;
+  closing_.emplace(conn, std::move(owned));
+  // Which may end the connection right away if it has no streams.
+  socket->closeGracefully();
+}
+
+void QuicClientConnectionPool::onConnectionGone(PooledConnection* conn) {
+  auto owned = takeConnection(conn);
+  if (!owned) {
+    auto it = closing_.find(conn);
+    if (it == closing_.end()) {
+      return;
+    }
+    owned = std::move(it->second);
+    closing_.erase(it);
+  }
+  destroyLater(std::move(owned));
+  maybeDrained();
+}
+
+std::unique_ptr<QuicClientConnectionPool::PooledConnection>
+QuicClientConnectionPool::takeConnection(PooledConnection* conn) {
+  auto it = connections_.find(conn->socket.get());
+  if (it == connections_.end()) {
+    return nullptr;
+  }
+  auto owned = std::move(it->second);
+  connections_.erase(it);
+  auto keyIt = byKey_.find(conn->key);
+  DCHECK(keyIt != byKey_.end());
+  auto& conns = keyIt->second;
+  conns.erase(std::find(conns.begin(), conns.end(), conn));
+  if (conns.empty()) {
+    byKey_.erase(keyIt);
+  }
+  return owned;
+}
+
+void QuicClientConnectionPool::destroyLater(
+    std::unique_ptr<PooledConnection> conn) {
+  conn->pool = nullptr;
+  evb_->runInLoop([conn = std::move(conn)]() mutable { conn.reset(); });
+}
+
+void QuicClientConnectionPool::maybeDrained() {
+  if (!draining_ || !connections_.empty() || !closing_.empty() || !drained_) {
+    return;
+  }
+  auto drained = std::move(drained_);
+  drained_ = nullptr;
+  drained();
+}
+
+} // namespace quic
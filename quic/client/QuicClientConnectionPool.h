@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/api/QuicSocket.h>
+
+#include <folly/Function.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/HHWheelTimer.h>
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace quic {
+
+constexpr size_t kDefaultMaxPooledConnectionsPerKey = 4;
+// Below kDefaultIdleTimeout, so that the pool closes an idle connection
+// before its transport times out.
+constexpr std::chrono::milliseconds kDefaultPooledConnectionIdleTimeout =
+    std::chrono::seconds(30);
+constexpr std::chrono::milliseconds kDefaultPoolHealthCheckInterval =
+    std::chrono::seconds(10);
+constexpr std::chrono::milliseconds kDefaultPoolPingTimeout =
+    std::chrono::seconds(2);
+
+/**
+ * Pool of client connections, keyed by host, port and ALPN, which opens
+ * streams on connections that are already up instead of setting up one per
+ * request. New streams go to the busiest connection that has room for them,
+ * so that the others go idle and get closed after idleTimeout. A connection
+ * is only set up when none of the pooled ones has room, up to
+ * maxConnectionsPerKey.
+ *
+ * Idle connections are pinged every healthCheckInterval, and the ones that
+ * don't answer within pingTimeout are dropped. The pool doesn't handle
+ * streams the peer opens, it cancels them.
+ *
+ * Not thread safe, everything must happen on the EventBase of the
+ * connections.
+ */
+class QuicClientConnectionPool {
+ public:
+  struct Key {
+    std::string host;
+    uint16_t port{0};
+    std::string alpn;
+
+    bool operator==(const Key& other) const {
+      return port == other.port && host == other.host && alpn == other.alpn;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  struct Settings {
+    size_t maxConnectionsPerKey{kDefaultMaxPooledConnectionsPerKey};
+    // 0 to only go by the limit of the peer.
+    uint64_t maxStreamsPerConnection{0};
+    std::chrono::milliseconds idleTimeout{kDefaultPooledConnectionIdleTimeout};
+    // 0 to only check when checkHealth() is called.
+    std::chrono::milliseconds healthCheckInterval{
+        kDefaultPoolHealthCheckInterval};
+    std::chrono::milliseconds pingTimeout{kDefaultPoolPingTimeout};
+  };
+
+  /**
+   * Sets up a connection for the key. It must hand the callback to the
+   * transport when starting it, e.g. with QuicClientTransport::start(), and
+   * may return nullptr if it can't set one up.
+   */
+  using ConnectionFactory = folly::Function<std::shared_ptr<QuicSocket>(
+      const Key&,
+      QuicSocket::ConnectionCallback*)>;
+
+  struct PooledStream {
+    std::shared_ptr<QuicSocket> connection;
+    StreamId id{0};
+  };
+
+  QuicClientConnectionPool(
+      folly::EventBase* evb,
+      ConnectionFactory factory,
+      Settings settings = Settings());
+
+  /**
+   * Closes all the connections right away.
+   */
+  ~QuicClientConnectionPool();
+
+  QuicClientConnectionPool(const QuicClientConnectionPool&) = delete;
+  QuicClientConnectionPool& operator=(const QuicClientConnectionPool&) =
+      delete;
+
+  /**
+   * Opens a bidirectional stream to the key, on a pooled connection if one has
+   * room. The stream must be given back with releaseStream() once the caller
+   * is done with it.
+   *
+   * Fails with SHUTTING_DOWN once draining, and STREAM_LIMIT_EXCEEDED if all
+   * the connections for the key are full.
+   */
+  folly::Expected<PooledStream, LocalErrorCode> createBidirectionalStream(
+      const Key& key,
+      bool replaySafe = true);
+
+  /**
+   * Sets up connections to the key ahead of the first stream, so that the
+   * handshake is done by the time the app has something to send, or the
+   * 0-RTT keys are ready if the factory resumes a session. Opens connections
+   * until the key has numConnections, at most maxConnectionsPerKey, and
+   * returns how many it has.
+   *
+   * The connections are idle until a stream is opened on them, so they are
+   * pinged and closed after idleTimeout like other idle connections.
+   */
+  size_t preconnect(const Key& key, size_t numConnections = 1);
+
+  void releaseStream(const PooledStream& stream);
+
+  /**
+   * Drops connections that are gone or have been idle for too long, and
+   * pings the other idle ones. It runs every healthCheckInterval.
+   */
+  void checkHealth();
+
+  /**
+   * Stops opening streams, and closes each connection gracefully once its
+   * streams have been released. drained is called when no connection is
+   * left.
+   */
+  void drain(folly::Function<void()> drained = nullptr);
+
+  size_t numConnections() const;
+
+  size_t numConnections(const Key& key) const;
+
+ private:
+  class PooledConnection : public QuicSocket::ConnectionCallback,
+                           public QuicSocket::PingCallback {
+   public:
+    PooledConnection(QuicClientConnectionPool& pool, Key key);
+
+    void onNewBidirectionalStream(StreamId id) noexcept override;
+    void onNewUnidirectionalStream(StreamId id) noexcept override;
+    void onStopSending(StreamId id, ApplicationErrorCode error) noexcept
+        override;
+    void onConnectionEnd() noexcept override;
+    void onConnectionError(
+        std::pair<QuicErrorCode, std::string> code) noexcept override;
+
+    void pingAcknowledged() noexcept override;
+    void pingTimeout() noexcept override;
+
+    bool hasRoom(uint64_t maxStreams) const;
+
+    // Null once the connection has left the pool.
+    QuicClientConnectionPool* pool;
+    Key key;
+    std::shared_ptr<QuicSocket> socket;
+    std::unordered_set<StreamId> streams;
+    TimePoint idleSince;
+    bool pingOutstanding{false};
+    // Whether the transport reported the end of the connection.
+    bool ended{false};
+  };
+
+  class HealthCheckTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit HealthCheckTimeout(QuicClientConnectionPool& pool)
+        : pool_(pool) {}
+
+    void timeoutExpired() noexcept override {
+      pool_.checkHealth();
+      pool_.scheduleHealthCheck();
+    }
+
+    void callbackCanceled() noexcept override {}
+
+   private:
+    QuicClientConnectionPool& pool_;
+  };
+
+  /**
+   * Returns nullptr if the factory couldn't set up the connection.
+   */
+  PooledConnection* openConnection(const Key& key);
+
+  void scheduleHealthCheck();
+
+  /**
+   * Takes the connection out of the pool and closes it once its streams are
+   * done. It's kept until the transport reports the end of the connection.
+   */
+  void closeGracefully(PooledConnection* conn);
+
+  void onConnectionGone(PooledConnection* conn);
+
+  std::unique_ptr<PooledConnection> takeConnection(PooledConnection* conn);
+
+  /**
+   * The transport may still have callbacks to it queued on the EventBase, so
+   * it goes away on the next loop.
+   */
+  void destroyLater(std::unique_ptr<PooledConnection> conn);
+
+  void maybeDrained();
+
+  folly::EventBase* evb_;
+  ConnectionFactory factory_;
+  Settings settings_;
+  // Connections that streams can be opened on.
+  std::unordered_map<const QuicSocket*, std::unique_ptr<PooledConnection>>
+      connections_;
+  std::unordered_map<Key, std::vector<PooledConnection*>, KeyHash> byKey_;
+  // Connections waiting for their streams to finish before closing.
+  std::unordered_map<PooledConnection*, std::unique_ptr<PooledConnection>>
+      closing_;
+  HealthCheckTimeout healthCheckTimeout_;
+  bool draining_{false};
+  folly::Function<void()> drained_;
+};
+
+} // namespace quic
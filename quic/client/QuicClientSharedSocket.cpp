@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/client/QuicClientSharedSocket.h>
+
+#include <quic/codec/Decode.h>
+#include <quic/common/SocketUtil.h>
+
+#include <folly/io/Cursor.h>
+
+#include <cstring>
+
+#ifndef MSG_WAITFORONE
+#define RECVMMSG_FLAGS 0
+#else
+#define RECVMMSG_FLAGS MSG_WAITFORONE
+#endif
+
+namespace quic {
+
+QuicClientSharedSocket::TransportSocket::TransportSocket(
+    QuicClientSharedSocket& shared)
+    : folly::AsyncUDPSocket(shared.socket_->getEventBase()), shared_(&shared) {
+  setFD(
+      shared.socket_->getNetworkSocket(),
+      folly::AsyncUDPSocket::FDOwnership::SHARED);
+}
+
+QuicClientSharedSocket::TransportSocket::~TransportSocket() {
+  if (shared_) {
+    shared_->removeTransportSocket(this);
+  }
+}
+
+void QuicClientSharedSocket::TransportSocket::close() {
+  readCallback_ = nullptr;
+  if (shared_) {
+    shared_->removeTransportSocket(this);
+  }
+  // Leaves the fd open, it's shared.
+  folly::AsyncUDPSocket::close();
+}
+
+ssize_t QuicClientSharedSocket::TransportSocket::write(
+    const folly::SocketAddress& address,
+    const std::unique_ptr<folly::IOBuf>& buf) {
+  maybeAddRoute(*buf);
+  return folly::AsyncUDPSocket::write(address, buf);
+}
+
+ssize_t QuicClientSharedSocket::TransportSocket::writeGSO(
+    const folly::SocketAddress& address,
+    const std::unique_ptr<folly::IOBuf>& buf,
+    int gso) {
+  maybeAddRoute(*buf);
+  return folly::AsyncUDPSocket::writeGSO(address, buf, gso);
+}
+
+int QuicClientSharedSocket::TransportSocket::writem(
+    const folly::SocketAddress& address,
+    const std::unique_ptr<folly::IOBuf>* bufs,
+    size_t count) {
+  if (count > 0) {
+    maybeAddRoute(*bufs[0]);
+  }
+  return folly::AsyncUDPSocket::writem(address, bufs, count);
+}
+
+int QuicClientSharedSocket::TransportSocket::writemGSO(
+    const folly::SocketAddress& address,
+    const std::unique_ptr<folly::IOBuf>* bufs,
+    size_t count,
+    const int* gso) {
+  if (count > 0) {
+    maybeAddRoute(*bufs[0]);
+  }
+  return folly::AsyncUDPSocket::writemGSO(address, bufs, count, gso);
+}
+
+void QuicClientSharedSocket::TransportSocket::maybeAddRoute(
+    const folly::IOBuf& buf) {
+  if (connId_ || !shared_ || buf.empty()) {
+    return;
+  }
+  folly::io::Cursor cursor(&buf);
+  auto initialByte = cursor.readBE<uint8_t>();
+  if (getHeaderForm(initialByte) != HeaderForm::Long) {
+    return;
+  }
+  auto parsed = parseLongHeaderInvariant(initialByte, cursor);
+  if (!parsed) {
+    return;
+  }
+  auto& srcConnId = parsed->invariant.srcConnId;
+  DCHECK_EQ(srcConnId.size(), shared_->connIdSize_)
+      << "Short headers to this transport can't be routed";
+  VLOG(10) << "Shared socket route to " << srcConnId.hex();
+  connId_ = srcConnId;
+  shared_->routes_[srcConnId] = this;
+}
+
+QuicClientSharedSocket::QuicClientSharedSocket(
+    std::unique_ptr<folly::AsyncUDPSocket> socket,
+    size_t connIdSize,
+    size_t maxRecvBatchSize,
+    bool useGRO)
+    : socket_(std::move(socket)),
+      connIdSize_(connIdSize),
+      maxRecvBatchSize_(maxRecvBatchSize),
+      readBufferSize_(
+          useGRO && socket_->setGRO(true) ? kDefaultGROReadBufferSize
+                                          : kDefaultUDPReadBufferSize) {
+  CHECK(socket_->isBound());
+  CHECK_GT(connIdSize_, 0) << "Can't route zero length connection ids";
+  socket_->resumeRead(this);
+}
+
+QuicClientSharedSocket::~QuicClientSharedSocket() {
+  socket_->pauseRead();
+  for (auto transportSocket : transportSockets_) {
+    transportSocket->shared_ = nullptr;
+  }
+}
+
+std::unique_ptr<folly::AsyncUDPSocket>
+QuicClientSharedSocket::makeTransportSocket() {
+  auto transportSocket = std::make_unique<TransportSocket>(*this);
+  transportSockets_.insert(transportSocket.get());
+  return transportSocket;
+}
+
+const folly::SocketAddress& QuicClientSharedSocket::address() const {
+  return socket_->address();
+}
+
+size_t QuicClientSharedSocket::numRoutes() const {
+  return routes_.size();
+}
+
+void QuicClientSharedSocket::getReadBuffer(void** buf, size_t* len) noexcept {
+  // Reads are all done in onNotifyDataAvailable.
+  *buf = nullptr;
+  *len = 0;
+}
+
+void QuicClientSharedSocket::onDataAvailable(
+    const folly::SocketAddress& /*peer*/,
+    size_t /*len*/,
+    bool /*truncated*/,
+    OnDataAvailableParams /*params*/) noexcept {}
+
+void QuicClientSharedSocket::onReadError(
+    const folly::AsyncSocketException& ex) noexcept {
+  LOG(ERROR) << "Shared client socket read error: " << ex.what();
+  // The transports are told in turn, which may close them.
+  std::vector<ReadCallback*> callbacks;
+  for (auto transportSocket : transportSockets_) {
+    if (transportSocket->readCallback_) {
+      callbacks.push_back(transportSocket->readCallback_);
+    }
+  }
+  for (auto callback : callbacks) {
+    callback->onReadError(ex);
+  }
+}
+
+void QuicClientSharedSocket::onNotifyDataAvailable(
+    folly::AsyncUDPSocket& sock) noexcept {
+  const size_t addrLen = sizeof(struct sockaddr_storage);
+  recvmmsgStorage_.resize(maxRecvBatchSize_);
+  auto& msgs = recvmmsgStorage_.msgs;
+  auto& addrs = recvmmsgStorage_.addrs;
+  auto& readBuffers = recvmmsgStorage_.readBuffers;
+  auto& iovecs = recvmmsgStorage_.iovecs;
+  auto& controls = recvmmsgStorage_.controls;
+
+  for (size_t i = 0; i < maxRecvBatchSize_; ++i) {
+    // The datagrams are copied out to the transports, so the buffers are
+    // kept for the next read.
+    if (!readBuffers[i]) {
+      readBuffers[i] = folly::IOBuf::create(readBufferSize_);
+    }
+    iovecs[i].iov_base = readBuffers[i]->writableData();
+    iovecs[i].iov_len = readBufferSize_;
+
+    auto* rawAddr = reinterpret_cast<sockaddr*>(&addrs[i]);
+    rawAddr->sa_family = sock.address().getFamily();
+
+    struct msghdr* msg = &msgs[i].msg_hdr;
+    msg->msg_name = rawAddr;
+    msg->msg_namelen = addrLen;
+    msg->msg_iov = &iovecs[i];
+    msg->msg_iovlen = 1;
+    msg->msg_control = controls[i].data();
+    msg->msg_controllen = controls[i].size();
+  }
+
+  int numMsgsRecvd =
+      sock.recvmmsg(msgs.data(), maxRecvBatchSize_, RECVMMSG_FLAGS, nullptr);
+  if (numMsgsRecvd < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return;
+    }
+    sock.pauseRead();
+    return onReadError(folly::AsyncSocketException(
+        folly::AsyncSocketException::INTERNAL_ERROR,
+        "::recvmmsg() failed",
+        errno));
+  }
+
+  folly::SocketAddress peer;
+  for (int i = 0; i < numMsgsRecvd; ++i) {
+    size_t bytesRead = msgs[i].msg_len;
+    if (bytesRead == 0) {
+      continue;
+    }
+    peer.setFromSockaddr(reinterpret_cast<sockaddr*>(&addrs[i]), addrLen);
+    auto& data = *readBuffers[i];
+    data.clear();
+    data.append(bytesRead);
+    route(peer, data, getGROSegmentSize(msgs[i].msg_hdr));
+  }
+}
+
+void QuicClientSharedSocket::route(
+    const folly::SocketAddress& peer,
+    const folly::IOBuf& data,
+    size_t groSize) {
+  folly::io::Cursor cursor(&data);
+  auto initialByte = cursor.readBE<uint8_t>();
+  folly::Optional<ConnectionId> dstConnId;
+  if (getHeaderForm(initialByte) == HeaderForm::Long) {
+    auto parsed = parseLongHeaderInvariant(initialByte, cursor);
+    if (parsed) {
+      dstConnId = std::move(parsed->invariant.dstConnId);
+    }
+  } else {
+    auto parsed = parseShortHeaderInvariants(initialByte, cursor, connIdSize_);
+    if (parsed) {
+      dstConnId = std::move(parsed->destinationConnId);
+    }
+  }
+  if (!dstConnId) {
+    VLOG(6) << "Shared socket dropped unparsable packet from " << peer;
+    return;
+  }
+
+  size_t offset = 0;
+  while (offset < data.length()) {
+    // Looked up again for each piece, the transport may go away while
+    // reading the previous one.
+    auto it = routes_.find(*dstConnId);
+    if (it == routes_.end() || !it->second->readCallback_) {
+      VLOG(6) << "Shared socket dropped packet for " << dstConnId->hex();
+      return;
+    }
+    auto readCallback = it->second->readCallback_;
+    void* buf = nullptr;
+    size_t len = 0;
+    readCallback->getReadBuffer(&buf, &len);
+    size_t size = data.length() - offset;
+    ReadCallback::OnDataAvailableParams params;
+    if (groSize > 0 && size > groSize) {
+      if (size <= len) {
+        params.gro_ = groSize;
+      } else {
+        size = groSize;
+      }
+    }
+    size_t copied = std::min(size, len);
+    memcpy(buf, data.data() + offset, copied);
+    offset += size;
+    readCallback->onDataAvailable(peer, copied, size > len, params);
+  }
+}
+
+void QuicClientSharedSocket::removeTransportSocket(TransportSocket* socket) {
+  transportSockets_.erase(socket);
+  if (socket->connId_) {
+    auto it = routes_.find(*socket->connId_);
+    if (it != routes_.end() && it->second == socket) {
+      routes_.erase(it);
+    }
+  }
+  socket->shared_ = nullptr;
+}
+
+} // namespace quic
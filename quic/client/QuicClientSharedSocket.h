@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/codec/QuicConnectionId.h>
+#include <quic/state/StateData.h>
+
+#include <folly/io/async/AsyncUDPSocket.h>
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace quic {
+
+/**
+ * One UDP socket that many client transports on the same EventBase send and
+ * receive through, in place of a socket each. Each transport gets a socket
+ * from makeTransportSocket() that writes to the shared fd directly. Reads are
+ * done in batches on the shared socket only, and each datagram is handed to
+ * the transport its destination connection id belongs to, the way the server
+ * worker routes them.
+ *
+ * The connection id of a transport is learned from the source connection id
+ * of the first long header packet it sends. Since short headers don't carry
+ * the length of the connection id, every transport must use connIdSize for
+ * its own. Transports must not set connectUDP, and errors from the error
+ * queue aren't passed on. The shared socket must outlive the transports.
+ */
+class QuicClientSharedSocket : private folly::AsyncUDPSocket::ReadCallback {
+ public:
+  /**
+   * socket must be bound already. With useGRO, the datagrams the kernel
+   * coalesces are handed on whole to the transports that read with GRO, and
+   * one packet at a time to the others.
+   */
+  explicit QuicClientSharedSocket(
+      std::unique_ptr<folly::AsyncUDPSocket> socket,
+      size_t connIdSize = kDefaultConnectionIdSize,
+      size_t maxRecvBatchSize = kDefaultQuicMaxBatchSize,
+      bool useGRO = false);
+
+  ~QuicClientSharedSocket() override;
+
+  QuicClientSharedSocket(const QuicClientSharedSocket&) = delete;
+  QuicClientSharedSocket& operator=(const QuicClientSharedSocket&) = delete;
+
+  std::unique_ptr<folly::AsyncUDPSocket> makeTransportSocket();
+
+  const folly::SocketAddress& address() const;
+
+  size_t numRoutes() const;
+
+ private:
+  class TransportSocket : public folly::AsyncUDPSocket {
+   public:
+    explicit TransportSocket(QuicClientSharedSocket& shared);
+
+    ~TransportSocket() override;
+
+    // Bound already, as the shared one is.
+    void bind(const folly::SocketAddress& /*address*/) override {}
+
+    // Reads come from the shared socket.
+    void resumeRead(ReadCallback* cob) override {
+      readCallback_ = cob;
+    }
+
+    void pauseRead() override {
+      readCallback_ = nullptr;
+    }
+
+    void setErrMessageCallback(
+        ErrMessageCallback* /*errMessageCallback*/) override {}
+
+    void close() override;
+
+    ssize_t write(
+        const folly::SocketAddress& address,
+        const std::unique_ptr<folly::IOBuf>& buf) override;
+
+    ssize_t writeGSO(
+        const folly::SocketAddress& address,
+        const std::unique_ptr<folly::IOBuf>& buf,
+        int gso) override;
+
+    int writem(
+        const folly::SocketAddress& address,
+        const std::unique_ptr<folly::IOBuf>* bufs,
+        size_t count) override;
+
+    int writemGSO(
+        const folly::SocketAddress& address,
+        const std::unique_ptr<folly::IOBuf>* bufs,
+        size_t count,
+        const int* gso) override;
+
+   private:
+    friend class QuicClientSharedSocket;
+
+    void maybeAddRoute(const folly::IOBuf& buf);
+
+    // Null once either side has gone away.
+    QuicClientSharedSocket* shared_;
+    ReadCallback* readCallback_{nullptr};
+    folly::Optional<ConnectionId> connId_;
+  };
+
+  // From AsyncUDPSocket::ReadCallback
+  void getReadBuffer(void** buf, size_t* len) noexcept override;
+  void onDataAvailable(
+      const folly::SocketAddress& peer,
+      size_t len,
+      bool truncated,
+      OnDataAvailableParams params) noexcept override;
+  void onReadError(const folly::AsyncSocketException& ex) noexcept override;
+  void onReadClosed() noexcept override {}
+  bool shouldOnlyNotify() override {
+    return true;
+  }
+  void onNotifyDataAvailable(folly::AsyncUDPSocket& sock) noexcept override;
+
+  /**
+   * Copies data into read buffers of the transport it is for. A datagram the
+   * kernel coalesced goes on whole if the transport has room for it, else one
+   * packet at a time.
+   */
+  void route(
+      const folly::SocketAddress& peer,
+      const folly::IOBuf& data,
+      size_t groSize);
+
+  void removeTransportSocket(TransportSocket* socket);
+
+  std::unique_ptr<folly::AsyncUDPSocket> socket_;
+  const size_t connIdSize_;
+  const size_t maxRecvBatchSize_;
+  const uint64_t readBufferSize_;
+  RecvmmsgStorage recvmmsgStorage_;
+  std::unordered_map<ConnectionId, TransportSocket*, ConnectionIdHash> routes_;
+  std::unordered_set<TransportSocket*> transportSockets_;
+};
+
+} // namespace quic
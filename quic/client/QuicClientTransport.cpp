@@ -8,6 +8,7 @@
 
 #include <quic/client/QuicClientTransport.h>
 
+#include <folly/ScopeGuard.h>
 #include <folly/portability/Sockets.h>
 
 #include <quic/api/LoopDetectorCallback.h>
@@ -15,12 +16,17 @@
 #include <quic/client/handshake/ClientHandshakeFactory.h>
 #include <quic/client/handshake/ClientTransportParametersExtension.h>
 #include <quic/client/state/ClientStateMachine.h>
+#include <quic/common/BufUtil.h>
+#include <quic/common/SocketUtil.h>
 #include <quic/flowcontrol/QuicFlowController.h>
 #include <quic/handshake/CryptoFactory.h>
+#include <quic/happyeyeballs/QuicHappyEyeballsCache.h>
 #include <quic/happyeyeballs/QuicHappyEyeballsFunctions.h>
 #include <quic/logging/QLoggerConstants.h>
 #include <quic/loss/QuicLossFunctions.h>
 #include <quic/state/AckHandlers.h>
+#include <quic/state/PathMtuDiscovery.h>
+#include <quic/state/QuicFecFunctions.h>
 #include <quic/state/QuicPacingFunctions.h>
 #include <quic/state/SimpleFrameFunctions.h>
 #include <quic/state/stream/StreamReceiveHandlers.h>
@@ -86,6 +92,9 @@ QuicClientTransport::~QuicClientTransport() {
   // The caller probably doesn't need the conn callback after destroying the
   // transport.
   connCallback_ = nullptr;
+  if (usedHappyEyeballsCache_) {
+    happyEyeballsCache_->onConnectionClosed(*hostname_, *conn_);
+  }
   // Close without draining.
   closeImpl(
       std::make_pair(
@@ -125,7 +134,8 @@ void QuicClientTransport::processUDPData(
   for (uint16_t processedPackets = 0;
        !udpData.empty() && processedPackets < kMaxNumCoalescedPackets;
        processedPackets++) {
-    processPacketData(peer, networkData.receiveTimePoint, udpData);
+    processPacketData(
+        peer, networkData.receiveTimePoint, networkData.ecn, udpData);
   }
   VLOG_IF(4, !udpData.empty())
       << "Leaving " << udpData.chainLength()
@@ -136,13 +146,20 @@ void QuicClientTransport::processUDPData(
 void QuicClientTransport::processPacketData(
     const folly::SocketAddress& peer,
     TimePoint receiveTimePoint,
+    EcnCodepoint ecn,
     BufQueue& packetQueue) {
   auto packetSize = packetQueue.chainLength();
   if (packetSize == 0) {
     return;
   }
-  auto parsedPacket = conn_->readCodec->parsePacket(
-      packetQueue, conn_->ackStates, conn_->clientConnectionId->size());
+  auto parsedPacket = [&] {
+    CpuTimeScope cpuTimeScope(
+        conn_->cpuTime,
+        conn_->transportSettings.trackCpuTime,
+        CpuTimeCategory::CRYPTO);
+    return conn_->readCodec->parsePacket(
+        packetQueue, conn_->ackStates, conn_->clientConnectionId->size());
+  }();
   StatelessReset* statelessReset = parsedPacket.statelessReset();
   if (statelessReset) {
     auto& token = clientConn_->statelessResetToken;
@@ -203,9 +220,18 @@ void QuicClientTransport::processPacketData(
     QUIC_TRACE(packet_drop, *conn_, "parse");
     return;
   }
-  if (happyEyeballsEnabled_) {
+  SCOPE_EXIT {
+    if (conn_->readCodec) {
+      conn_->readCodec->recycleFrames(std::move(regularOptional->frames));
+    }
+  };
+  if (happyEyeballsEnabled_ && !conn_->happyEyeballsState.finished) {
     happyEyeballsOnDataReceived(
         *conn_, happyEyeballsConnAttemptDelayTimeout_, socket_, peer);
+    if (usedHappyEyeballsCache_) {
+      happyEyeballsCache_->onRaceWon(
+          *hostname_, conn_->peerAddress.getFamily(), receiveTimePoint);
+    }
   }
 
   LongHeader* longHeader = regularOptional->header.asLong();
@@ -216,29 +242,21 @@ void QuicClientTransport::processPacketData(
 
   auto packetNum = regularOptional->header.getPacketSequenceNum();
   auto pnSpace = regularOptional->header.getPacketNumberSpace();
+  if (isDuplicatePacket(getAckState(*conn_, pnSpace), packetNum)) {
+    VLOG(10) << "drop duplicate packet=" << packetNum << " " << *this;
+    if (conn_->qLogger) {
+      conn_->qLogger->addPacketDrop(packetSize, kDuplicate);
+    }
+    QUIC_TRACE(packet_drop, *conn_, "duplicate");
+    return;
+  }
 
-  bool isProtectedPacket = protectionLevel == ProtectionType::KeyPhaseZero ||
-      protectionLevel == ProtectionType::KeyPhaseOne;
-
+  // The codec already rejected Initial and Handshake packets with frames
+  // they can't carry.
   auto& regularPacket = *regularOptional;
   if (conn_->qLogger) {
     conn_->qLogger->addPacket(regularPacket, packetSize);
   }
-  if (!isProtectedPacket) {
-    for (auto& quicFrame : regularPacket.frames) {
-      auto isPadding = quicFrame.asPaddingFrame();
-      auto isAck = quicFrame.asReadAckFrame();
-      auto isClose = quicFrame.asConnectionCloseFrame();
-      auto isCrypto = quicFrame.asReadCryptoFrame();
-      auto isSimple = quicFrame.asQuicSimpleFrame();
-      auto isPing = isSimple ? isSimple->asPingFrame() : nullptr;
-      // TODO: add path challenge and response
-      if (!isPadding && !isAck && !isClose && !isCrypto && !isPing) {
-        throw QuicTransportException(
-            "Invalid frame", TransportErrorCode::PROTOCOL_VIOLATION);
-      }
-    }
-  }
 
   // We got a packet that was not the version negotiation packet, that means
   // that the version is now bound to the new packet.
@@ -272,12 +290,24 @@ void QuicClientTransport::processPacketData(
         "Invalid connection id", TransportErrorCode::PROTOCOL_VIOLATION);
   }
   auto& ackState = getAckState(*conn_, pnSpace);
-  auto outOfOrder =
-      updateLargestReceivedPacketNum(ackState, packetNum, receiveTimePoint);
+  auto outOfOrder = updateLargestReceivedPacketNum(
+      ackState, packetNum, receiveTimePoint, ecn);
+  limitAckRanges(ackState, conn_->transportSettings.maxAckRanges);
+  if (pnSpace == PacketNumberSpace::Initial) {
+    recordHandshakeTiming(
+        conn_->handshakeTimings.firstInitialReceived,
+        conn_->connectionTime,
+        receiveTimePoint);
+  }
 
   bool pktHasRetransmittableData = false;
   bool pktHasCryptoData = false;
 
+  if (pnSpace == PacketNumberSpace::AppData) {
+    // Before the stream frames are moved out of the packet.
+    onFecSourcePacketReceived(*conn_, packetNum, regularPacket);
+  }
+
   for (auto& quicFrame : regularPacket.frames) {
     switch (quicFrame.type()) {
       case QuicFrame::Type::ReadAckFrame_E: {
@@ -487,6 +517,12 @@ void QuicClientTransport::processPacketData(
       case QuicFrame::Type::PaddingFrame_E: {
         break;
       }
+      case QuicFrame::Type::DatagramFrame_E: {
+        VLOG(10) << "Client received datagram " << *this;
+        pktHasRetransmittableData = true;
+        handleDatagram(*conn_, *quicFrame.asDatagramFrame());
+        break;
+      }
       case QuicFrame::Type::QuicSimpleFrame_E: {
         QuicSimpleFrame& simpleFrame = *quicFrame.asQuicSimpleFrame();
         pktHasRetransmittableData = true;
@@ -505,7 +541,13 @@ void QuicClientTransport::processPacketData(
   auto handshakeLayer = clientConn_->clientHandshakeLayer;
   if (cryptoData) {
     bool hadOneRttKey = conn_->oneRttWriteCipher != nullptr;
-    handshakeLayer->doHandshake(std::move(cryptoData), encryptionLevel);
+    {
+      CpuTimeScope cpuTimeScope(
+          conn_->cpuTime,
+          conn_->transportSettings.trackCpuTime,
+          CpuTimeCategory::CRYPTO);
+      handshakeLayer->doHandshake(std::move(cryptoData), encryptionLevel);
+    }
     bool oneRttKeyDerivationTriggered = false;
     if (!hadOneRttKey && conn_->oneRttWriteCipher) {
       oneRttKeyDerivationTriggered = true;
@@ -607,6 +649,10 @@ void QuicClientTransport::processPacketData(
     DCHECK(conn_->oneRttWriteCipher);
     clientConn_->clientHandshakeLayer->onRecvOneRttProtectedData();
     conn_->readCodec->onHandshakeDone(receiveTimePoint);
+    recordHandshakeTiming(
+        conn_->handshakeTimings.handshakeDone,
+        conn_->connectionTime,
+        receiveTimePoint);
   }
   updateAckSendStateOnRecvPacket(
       *conn_,
@@ -645,8 +691,12 @@ void QuicClientTransport::onReadData(
   if (connCallback_ && !replaySafeNotified_ && conn_->oneRttWriteCipher) {
     replaySafeNotified_ = true;
     // We don't need this any more. Also unset it so that we don't allow random
-    // middleboxes to shutdown our connection once we have crypto keys.
-    socket_->setErrMessageCallback(nullptr);
+    // middleboxes to shutdown our connection once we have crypto keys. Zero
+    // copy completions still come on the error queue, errMessage() ignores
+    // the rest from now on.
+    if (!zeroCopyTracker_) {
+      socket_->setErrMessageCallback(nullptr);
+    }
     connCallback_->onReplaySafe();
   }
 }
@@ -687,6 +737,18 @@ void QuicClientTransport::writeData() {
           *conn_->initialWriteCipher,
           *conn_->initialHeaderCipher,
           version);
+    } else if (conn_->handshakeWriteCipher) {
+      CHECK(conn_->handshakeWriteHeaderCipher);
+      writeLongClose(
+          *socket_,
+          *conn_,
+          srcConnId /* src */,
+          *destConnId /* dst */,
+          LongHeader::Types::Handshake,
+          conn_->localConnectionError,
+          *conn_->handshakeWriteCipher,
+          *conn_->handshakeWriteHeaderCipher,
+          version);
     }
     return;
   }
@@ -700,10 +762,11 @@ void QuicClientTransport::writeData() {
   CryptoStreamScheduler handshakeScheduler(
       *conn_,
       *getCryptoStream(*conn_->cryptoState, EncryptionLevel::Handshake));
-  if (initialScheduler.hasData() ||
-      (conn_->ackStates.initialAckState.needsToSendAckImmediately &&
-       hasAcksToSchedule(conn_->ackStates.initialAckState))) {
-    CHECK(conn_->initialWriteCipher);
+  // The keys of a space are gone once it's done with.
+  if (conn_->initialWriteCipher &&
+      (initialScheduler.hasData() ||
+       (conn_->ackStates.initialAckState.needsToSendAckImmediately &&
+        hasAcksToSchedule(conn_->ackStates.initialAckState)))) {
     CHECK(conn_->initialHeaderCipher);
     packetLimit -= writeCryptoAndAckDataToSocket(
         *socket_,
@@ -718,14 +781,15 @@ void QuicClientTransport::writeData() {
         clientConn_->retryToken);
   }
   if (!packetLimit) {
+    writeCoalescedPackets(*socket_, *conn_);
     return;
   }
-  if (handshakeScheduler.hasData() ||
-      (conn_->ackStates.handshakeAckState.needsToSendAckImmediately &&
-       hasAcksToSchedule(conn_->ackStates.handshakeAckState))) {
-    CHECK(conn_->handshakeWriteCipher);
+  if (conn_->handshakeWriteCipher &&
+      (handshakeScheduler.hasData() ||
+       (conn_->ackStates.handshakeAckState.needsToSendAckImmediately &&
+        hasAcksToSchedule(conn_->ackStates.handshakeAckState)))) {
     CHECK(conn_->handshakeWriteHeaderCipher);
-    packetLimit -= writeCryptoAndAckDataToSocket(
+    auto handshakePackets = writeCryptoAndAckDataToSocket(
         *socket_,
         *conn_,
         srcConnId /* src */,
@@ -735,8 +799,15 @@ void QuicClientTransport::writeData() {
         *conn_->handshakeWriteHeaderCipher,
         version,
         packetLimit);
+    packetLimit -= handshakePackets;
+    if (handshakePackets > 0) {
+      // The server has what it needs from the Initial space once it gets a
+      // Handshake packet from us.
+      discardPacketNumberSpace(*conn_, PacketNumberSpace::Initial);
+    }
   }
   if (!packetLimit) {
+    writeCoalescedPackets(*socket_, *conn_);
     return;
   }
   if (clientConn_->zeroRttWriteCipher && !conn_->oneRttWriteCipher) {
@@ -752,6 +823,7 @@ void QuicClientTransport::writeData() {
         packetLimit);
   }
   if (!packetLimit) {
+    writeCoalescedPackets(*socket_, *conn_);
     return;
   }
   if (conn_->oneRttWriteCipher) {
@@ -766,6 +838,8 @@ void QuicClientTransport::writeData() {
         version,
         packetLimit);
   }
+  // The packets held back had no 1-RTT packet to go with.
+  writeCoalescedPackets(*socket_, *conn_);
 }
 
 void QuicClientTransport::startCryptoHandshake() {
@@ -797,6 +871,9 @@ void QuicClientTransport::startCryptoHandshake() {
 
   // Add partial reliability parameter to customTransportParameters_.
   setPartialReliabilityTransportParameter();
+  setMinAckDelayTransportParameter();
+  setMaxDatagramFrameSizeTransportParameter();
+  setFecSupportTransportParameter();
 
   auto paramsExtension = std::make_shared<ClientTransportParametersExtension>(
       conn_->originalVersion.value(),
@@ -840,6 +917,12 @@ bool QuicClientTransport::isTLSResumed() const {
 
 void QuicClientTransport::errMessage(
     FOLLY_MAYBE_UNUSED const cmsghdr& cmsg) noexcept {
+  if (zeroCopyTracker_ && zeroCopyTracker_->onErrMessage(cmsg)) {
+    return;
+  }
+  if (replaySafeNotified_) {
+    return;
+  }
 #ifdef FOLLY_HAVE_MSG_ERRQUEUE
   if ((cmsg.cmsg_level == SOL_IP && cmsg.cmsg_type == IP_RECVERR) ||
       (cmsg.cmsg_level == SOL_IPV6 && cmsg.cmsg_type == IPV6_RECVERR)) {
@@ -879,17 +962,26 @@ void QuicClientTransport::onReadError(
 
 void QuicClientTransport::getReadBuffer(void** buf, size_t* len) noexcept {
   DCHECK(conn_) << "trying to receive packets without a connection";
-  auto readBufferSize = conn_->transportSettings.maxRecvPacketSize;
+  auto readBufferSize = getReadBufferSize();
   readBuffer_ = folly::IOBuf::create(readBufferSize);
   *buf = readBuffer_->writableData();
   *len = readBufferSize;
 }
 
+uint64_t QuicClientTransport::getReadBufferSize() const {
+  auto readBufferSize = conn_->transportSettings.maxRecvPacketSize;
+  if (conn_->transportSettings.shouldUseGROForRecv) {
+    readBufferSize =
+        std::max<uint64_t>(readBufferSize, kDefaultGROReadBufferSize);
+  }
+  return readBufferSize;
+}
+
 void QuicClientTransport::onDataAvailable(
     const folly::SocketAddress& server,
     size_t len,
     bool truncated,
-    OnDataAvailableParams /*params*/) noexcept {
+    OnDataAvailableParams params) noexcept {
   VLOG(10) << "Got data from socket peer=" << server << " len=" << len;
   auto packetReceiveTime = Clock::now();
   Buf data = std::move(readBuffer_);
@@ -912,7 +1004,15 @@ void QuicClientTransport::onDataAvailable(
   if (conn_->qLogger) {
     conn_->qLogger->addDatagramReceived(len);
   }
-  NetworkData networkData(std::move(data), packetReceiveTime);
+  if (params.gro_ <= 0) {
+    NetworkData networkData(std::move(data), packetReceiveTime);
+    onNetworkData(server, std::move(networkData));
+    return;
+  }
+  NetworkData networkData;
+  networkData.receiveTimePoint = packetReceiveTime;
+  networkData.totalData = len;
+  splitGROBuffer(std::move(data), params.gro_, networkData.packets);
   onNetworkData(server, std::move(networkData));
 }
 
@@ -949,6 +1049,13 @@ void QuicClientTransport::recvMsg(
     msg.msg_namelen = size_t(addrLen);
     msg.msg_iov = &vec;
     msg.msg_iovlen = 1;
+    char control[kRecvControlSize] = {};
+    if (conn_->transportSettings.shouldUseGROForRecv ||
+        conn_->transportSettings.enableEcn ||
+        conn_->transportSettings.enableRecvTimestamps) {
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+    }
 
     ssize_t ret = sock.recvmsg(&msg, 0);
     if (ret < 0) {
@@ -980,7 +1087,18 @@ void QuicClientTransport::recvMsg(
     }
     VLOG(10) << "Got data from socket peer=" << *server << " len=" << bytesRead;
     readBuffer->append(bytesRead);
-    networkData.packets.emplace_back(std::move(readBuffer));
+    auto firstPacket = networkData.packets.size();
+    splitGROBuffer(
+        std::move(readBuffer), getGROSegmentSize(msg), networkData.packets);
+    if (conn_->transportSettings.enableEcn) {
+      networkData.setEcnCodepoints(firstPacket, getEcnCodepoint(msg));
+    }
+    if (conn_->transportSettings.enableRecvTimestamps) {
+      auto receiveTime = getRecvTimestamp(msg);
+      if (receiveTime) {
+        networkData.setReceiveTimePoints(firstPacket, *receiveTime);
+      }
+    }
     if (conn_->qLogger) {
       conn_->qLogger->addDatagramReceived(bytesRead);
     }
@@ -1001,6 +1119,7 @@ void QuicClientTransport::recvMmsg(
   auto& addrs = networkData.recvmmsgStorage.addrs;
   auto& readBuffers = networkData.recvmmsgStorage.readBuffers;
   auto& iovecs = networkData.recvmmsgStorage.iovecs;
+  auto& controls = networkData.recvmmsgStorage.controls;
 
   for (int i = 0; i < numPackets; ++i) {
     // We create 1 buffer per packet so that it is not shared, this enables
@@ -1019,6 +1138,12 @@ void QuicClientTransport::recvMmsg(
     msg->msg_namelen = addrLen;
     msg->msg_iov = &iovecs[i];
     msg->msg_iovlen = 1;
+    if (conn_->transportSettings.shouldUseGROForRecv ||
+        conn_->transportSettings.enableEcn ||
+        conn_->transportSettings.enableRecvTimestamps) {
+      msg->msg_control = controls[i].data();
+      msg->msg_controllen = controls[i].size();
+    }
   }
 
   int numMsgsRecvd =
@@ -1061,7 +1186,21 @@ void QuicClientTransport::recvMmsg(
 
     VLOG(10) << "Got data from socket peer=" << *server << " len=" << bytesRead;
     readBuffers[i]->append(bytesRead);
-    networkData.packets.emplace_back(std::move(readBuffers[i]));
+    auto firstPacket = networkData.packets.size();
+    splitGROBuffer(
+        std::move(readBuffers[i]),
+        getGROSegmentSize(msgs[i].msg_hdr),
+        networkData.packets);
+    if (conn_->transportSettings.enableEcn) {
+      networkData.setEcnCodepoints(
+          firstPacket, getEcnCodepoint(msgs[i].msg_hdr));
+    }
+    if (conn_->transportSettings.enableRecvTimestamps) {
+      auto receiveTime = getRecvTimestamp(msgs[i].msg_hdr);
+      if (receiveTime) {
+        networkData.setReceiveTimePoints(firstPacket, *receiveTime);
+      }
+    }
     QUIC_TRACE(udp_recvd, *conn_, bytesRead);
     if (conn_->qLogger) {
       conn_->qLogger->addDatagramReceived(bytesRead);
@@ -1072,7 +1211,7 @@ void QuicClientTransport::recvMmsg(
 void QuicClientTransport::onNotifyDataAvailable(
     folly::AsyncUDPSocket& sock) noexcept {
   DCHECK(conn_) << "trying to receive packets without a connection";
-  auto readBufferSize = conn_->transportSettings.maxRecvPacketSize;
+  auto readBufferSize = getReadBufferSize();
   const int numPackets = conn_->transportSettings.maxRecvBatchSize;
 
   NetworkData networkData;
@@ -1101,10 +1240,8 @@ void QuicClientTransport::onNotifyDataAvailable(
     return;
   }
   DCHECK(server.has_value());
-  // TODO: we can get better receive time accuracy than this, with
-  // SO_TIMESTAMP or SIOCGSTAMP.
-  auto packetReceiveTime = Clock::now();
-  networkData.receiveTimePoint = packetReceiveTime;
+  // For the packets the kernel hasn't timestamped.
+  networkData.receiveTimePoint = Clock::now();
   networkData.totalData = totalData;
   onNetworkData(*server, std::move(networkData));
 }
@@ -1120,15 +1257,30 @@ void QuicClientTransport::
 
 void QuicClientTransport::start(ConnectionCallback* cb) {
   if (happyEyeballsEnabled_) {
-    // TODO Supply v4 delay amount from somewhere when we want to tune this
+    sa_family_t cachedFamily = happyEyeballsCachedFamily_;
+    auto connAttemptDelay = cachedFamily == AF_UNSPEC
+        ? kHappyEyeballsV4Delay
+        : kHappyEyeballsConnAttemptDelayWithCache;
+    if (happyEyeballsCache_ && hostname_) {
+      usedHappyEyeballsCache_ = true;
+      auto entry = happyEyeballsCache_->get(*hostname_, Clock::now());
+      if (entry) {
+        cachedFamily = entry->family;
+        connAttemptDelay = happyEyeballsConnAttemptDelay(*entry);
+        if (happyEyeballsShouldSkipRace(*entry)) {
+          happyEyeballsSkipRace(*conn_, cachedFamily);
+        }
+      } else {
+        cachedFamily = AF_UNSPEC;
+        connAttemptDelay = kHappyEyeballsV4Delay;
+      }
+    }
     startHappyEyeballs(
         *conn_,
         evb_,
-        happyEyeballsCachedFamily_,
+        cachedFamily,
         happyEyeballsConnAttemptDelayTimeout_,
-        happyEyeballsCachedFamily_ == AF_UNSPEC
-            ? kHappyEyeballsV4Delay
-            : kHappyEyeballsConnAttemptDelayWithCache,
+        connAttemptDelay,
         this,
         this,
         socketOptions_);
@@ -1141,6 +1293,12 @@ void QuicClientTransport::start(ConnectionCallback* cb) {
   }
   QUIC_TRACE(fst_trace, *conn_, "start");
   setConnectionCallback(cb);
+  if (conn_->transportSettings.dataPathType ==
+      DataPathType::ContinuousMemory) {
+    bufAccessor_ = std::make_unique<SimpleBufAccessor>(
+        kDefaultMaxUDPPayload * conn_->transportSettings.maxBatchSize);
+    conn_->bufAccessor = bufAccessor_.get();
+  }
   try {
     happyEyeballsSetUpSocket(
         *socket_,
@@ -1150,6 +1308,10 @@ void QuicClientTransport::start(ConnectionCallback* cb) {
         this,
         this,
         socketOptions_);
+    if (conn_->transportSettings.pacingUsesTxTime && !enableTxTime(*socket_)) {
+      conn_->transportSettings.pacingUsesTxTime = false;
+    }
+    setUpZeroCopy();
     startCryptoHandshake();
   } catch (const QuicTransportException& ex) {
     runOnEvbAsync([ex](auto self) {
@@ -1207,6 +1369,11 @@ void QuicClientTransport::setHappyEyeballsCachedFamily(
   happyEyeballsCachedFamily_ = cachedFamily;
 }
 
+void QuicClientTransport::setHappyEyeballsCache(
+    std::shared_ptr<QuicHappyEyeballsCache> cache) {
+  happyEyeballsCache_ = std::move(cache);
+}
+
 void QuicClientTransport::addNewSocket(
     std::unique_ptr<folly::AsyncUDPSocket> socket) {
   happyEyeballsAddSocket(*conn_, std::move(socket));
@@ -1261,6 +1428,44 @@ void QuicClientTransport::setPartialReliabilityTransportParameter() {
   }
 }
 
+void QuicClientTransport::setMinAckDelayTransportParameter() {
+  if (!conn_->transportSettings.advertiseMinAckDelay) {
+    return;
+  }
+  auto minAckDelayCustomParam =
+      std::make_unique<CustomIntegralTransportParameter>(
+          kMinAckDelayParameterId,
+          conn_->transportSettings.minAckDelay.count());
+
+  if (!setCustomTransportParameter(std::move(minAckDelayCustomParam))) {
+    LOG(ERROR) << "failed to set min ack delay transport setting";
+  }
+}
+
+void QuicClientTransport::setFecSupportTransportParameter() {
+  if (!conn_->transportSettings.advertiseFecSupport) {
+    return;
+  }
+  auto fecSupportCustomParam =
+      std::make_unique<CustomIntegralTransportParameter>(
+          kFecSupportParameterId, 1);
+
+  if (!setCustomTransportParameter(std::move(fecSupportCustomParam))) {
+    LOG(ERROR) << "failed to set fec support transport setting";
+  }
+}
+
+void QuicClientTransport::setMaxDatagramFrameSizeTransportParameter() {
+  if (conn_->transportSettings.maxDatagramFrameSize == 0) {
+    return;
+  }
+  // max_datagram_frame_size is a registered parameter, so it does not go
+  // through the private range check of setCustomTransportParameter.
+  customTransportParameters_.push_back(encodeIntegerParameter(
+      TransportParameterId::max_datagram_frame_size,
+      conn_->transportSettings.maxDatagramFrameSize));
+}
+
 void QuicClientTransport::closeTransport() {
   happyEyeballsConnAttemptDelayTimeout_.cancelTimeout();
 }
@@ -1308,12 +1513,63 @@ void QuicClientTransport::onNetworkSwitch(
         this,
         this,
         socketOptions_);
+    if (conn_->transportSettings.pacingUsesTxTime && !enableTxTime(*socket_)) {
+      conn_->transportSettings.pacingUsesTxTime = false;
+    }
+    setUpZeroCopy();
+    resetCongestionAndRttState();
     if (conn_->qLogger) {
       conn_->qLogger->addConnectionMigrationUpdate(true);
     }
   }
 }
 
+void QuicClientTransport::setUpZeroCopy() {
+  // The completions of the sends on a previous socket won't be read any more.
+  // The kernel has the pages of their buffers pinned until it's done, all
+  // they can lose is what was sent on a network we've left.
+  conn_->zeroCopyTracker = nullptr;
+  zeroCopyTracker_ = nullptr;
+  if (!conn_->transportSettings.enableZeroCopySend) {
+    return;
+  }
+  if (!conn_->transportSettings.enableSocketErrMsgCallback) {
+    // Nothing would read the completions off the error queue.
+    LOG(WARNING) << "Zero copy sends need enableSocketErrMsgCallback "
+                 << *this;
+    return;
+  }
+  if (!enableZeroCopy(*socket_)) {
+    return;
+  }
+  zeroCopyTracker_ = std::make_unique<ZeroCopySendTracker>(
+      socket_->getNetworkSocket(), conn_->bufArena);
+  conn_->zeroCopyTracker = zeroCopyTracker_.get();
+}
+
+void QuicClientTransport::resetCongestionAndRttState() {
+  // The new network is a new path, what was learned about the old one says
+  // nothing about how much it carries or how fast.
+  if (conn_->congestionController && ccFactory_) {
+    conn_->congestionController = ccFactory_->makeCongestionController(
+        *conn_, conn_->congestionController->type());
+  } else if (conn_->congestionController) {
+    // The one the client starts with.
+    conn_->congestionController = std::make_unique<Cubic>(*conn_);
+  }
+  conn_->lossState.srtt = std::chrono::microseconds::zero();
+  conn_->lossState.lrtt = std::chrono::microseconds::zero();
+  conn_->lossState.rttvar = std::chrono::microseconds::zero();
+  conn_->lossState.mrtt = kDefaultMinRtt;
+  auto& pathMtuState = conn_->pathMtuState;
+  if (pathMtuState.phase != PathMtuState::Phase::Disabled) {
+    bool probeInFlight = pathMtuState.probeInFlight;
+    conn_->udpSendPacketLen = pathMtuState.baseSize;
+    startPathMtuDiscovery(*conn_, pathMtuState.maxSize);
+    pathMtuState.probeInFlight = probeInFlight;
+  }
+}
+
 void QuicClientTransport::setTransportStatsCallback(
     std::shared_ptr<QuicTransportStatsCallback> statsCallback) noexcept {
   CHECK(conn_);
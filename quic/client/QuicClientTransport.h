@@ -16,10 +16,12 @@
 #include <quic/api/QuicTransportBase.h>
 #include <quic/client/state/ClientStateMachine.h>
 #include <quic/common/BufUtil.h>
+#include <quic/common/ZeroCopySendTracker.h>
 
 namespace quic {
 
 class ClientHandshakeFactory;
+class QuicHappyEyeballsCache;
 
 class QuicClientTransport
     : public QuicTransportBase,
@@ -77,6 +79,13 @@ class QuicClientTransport
   void setHappyEyeballsEnabled(bool happyEyeballsEnabled);
   virtual void setHappyEyeballsCachedFamily(sa_family_t cachedFamily);
 
+  /**
+   * Shares what previous races to the hostname learned, in place of
+   * setHappyEyeballsCachedFamily(), and records how this one goes. Must be
+   * set before start().
+   */
+  void setHappyEyeballsCache(std::shared_ptr<QuicHappyEyeballsCache> cache);
+
   /**
    * Starts the connection.
    */
@@ -168,6 +177,8 @@ class QuicClientTransport
       OnDataAvailableParams params) noexcept override;
   bool shouldOnlyNotify() override;
   void onNotifyDataAvailable(folly::AsyncUDPSocket& sock) noexcept override;
+  // Size of the buffer handed to the socket for a single read.
+  uint64_t getReadBufferSize() const;
   void recvMsg(
       folly::AsyncUDPSocket& sock,
       uint64_t readBufferSize,
@@ -190,6 +201,7 @@ class QuicClientTransport
   void processPacketData(
       const folly::SocketAddress& peer,
       TimePoint receiveTimePoint,
+      EcnCodepoint ecn,
       BufQueue& packetQueue);
 
   void startCryptoHandshake();
@@ -206,7 +218,15 @@ class QuicClientTransport
   HappyEyeballsConnAttemptDelayTimeout happyEyeballsConnAttemptDelayTimeout_;
 
  private:
+  // Starts the congestion controller, the rtt and the path MTU over for the
+  // path of a new network.
+  void resetCongestionAndRttState();
+  // Sets up MSG_ZEROCOPY sends on socket_ if the settings ask for them.
+  void setUpZeroCopy();
   void setPartialReliabilityTransportParameter();
+  void setMinAckDelayTransportParameter();
+  void setMaxDatagramFrameSizeTransportParameter();
+  void setFecSupportTransportParameter();
 
   bool replaySafeNotified_{false};
   // Set it QuicClientTransport is in a self owning mode. This will be cleaned
@@ -214,9 +234,16 @@ class QuicClientTransport
   std::shared_ptr<QuicClientTransport> selfOwning_;
   bool happyEyeballsEnabled_{false};
   sa_family_t happyEyeballsCachedFamily_{AF_UNSPEC};
+  std::shared_ptr<QuicHappyEyeballsCache> happyEyeballsCache_;
+  // Whether start() went by happyEyeballsCache_.
+  bool usedHappyEyeballsCache_{false};
   QuicClientConnectionState* clientConn_;
   std::vector<TransportParameter> customTransportParameters_;
   folly::SocketOptionMap socketOptions_;
   std::shared_ptr<QuicTransportStatsCallback> statsCallback_;
+  // Output buffer for DataPathType::ContinuousMemory writes.
+  std::unique_ptr<BufAccessor> bufAccessor_;
+  // Set if TransportSettings::enableZeroCopySend and socket_ supports it.
+  std::unique_ptr<ZeroCopySendTracker> zeroCopyTracker_;
 };
 } // namespace quic
@@ -23,6 +23,8 @@ struct CachedServerTransportParameters {
   uint64_t initialMaxStreamDataUni;
   uint64_t initialMaxStreamsBidi;
   uint64_t initialMaxStreamsUni;
+  // Smoothed rtt in microseconds when the session was cached, 0 if unknown.
+  uint64_t srtt{0};
 };
 
 } // namespace quic
@@ -182,6 +182,8 @@ void ClientHandshake::computeCiphers(CipherKind kind, folly::ByteRange secret) {
     case CipherKind::HandshakeWrite:
       conn_->handshakeWriteCipher = std::move(aead);
       conn_->handshakeWriteHeaderCipher = std::move(packetNumberCipher);
+      recordHandshakeTiming(
+          conn_->handshakeTimings.handshakeKeysDerived, conn_->connectionTime);
       break;
     case CipherKind::HandshakeRead:
       conn_->readCodec->setHandshakeReadCipher(std::move(aead));
@@ -190,6 +192,8 @@ void ClientHandshake::computeCiphers(CipherKind kind, folly::ByteRange secret) {
     case CipherKind::OneRttWrite:
       conn_->oneRttWriteCipher = std::move(aead);
       conn_->oneRttWriteHeaderCipher = std::move(packetNumberCipher);
+      recordHandshakeTiming(
+          conn_->handshakeTimings.oneRttKeysAvailable, conn_->connectionTime);
       break;
     case CipherKind::OneRttRead:
       conn_->readCodec->setOneRttReadCipher(std::move(aead));
@@ -85,6 +85,14 @@ void processServerInitialParams(
   auto partialReliability = getIntegerParameter(
       static_cast<TransportParameterId>(kPartialReliabilityParameterId),
       serverParams.parameters);
+  auto minAckDelay = getIntegerParameter(
+      static_cast<TransportParameterId>(kMinAckDelayParameterId),
+      serverParams.parameters);
+  auto maxDatagramFrameSize = getIntegerParameter(
+      TransportParameterId::max_datagram_frame_size, serverParams.parameters);
+  auto fecSupport = getIntegerParameter(
+      static_cast<TransportParameterId>(kFecSupportParameterId),
+      serverParams.parameters);
   auto activeConnectionIdLimit = getIntegerParameter(
       TransportParameterId::active_connection_id_limit,
       serverParams.parameters);
@@ -139,6 +147,9 @@ void processServerInitialParams(
     }
     conn.udpSendPacketLen = *packetSize;
   }
+  if (conn.transportSettings.enablePathMtuDiscovery) {
+    startPathMtuDiscovery(conn, *packetSize);
+  }
 
   // Currently no-op for a client; it doesn't issue connection ids
   // to the server.
@@ -152,6 +163,14 @@ void processServerInitialParams(
   VLOG(10) << "conn.partialReliabilityEnabled="
            << conn.partialReliabilityEnabled;
 
+  if (minAckDelay) {
+    conn.peerMinAckDelay = std::chrono::microseconds(*minAckDelay);
+  }
+  if (maxDatagramFrameSize) {
+    conn.datagramState.maxWriteFrameSize = *maxDatagramFrameSize;
+  }
+  conn.fecState.peerSupported = fecSupport && *fecSupport != 0;
+
   conn.statelessResetToken = std::move(statelessResetToken);
   // Update the existing streams, because we allow streams to be created before
   // the connection is established.
@@ -207,6 +226,7 @@ CachedServerTransportParameters getServerCachedTransportParameters(
       conn.peerAdvertisedInitialMaxStreamsBidi;
   transportParams.initialMaxStreamsUni =
       conn.peerAdvertisedInitialMaxStreamsUni;
+  transportParams.srtt = conn.lossState.srtt.count();
 
   return transportParams;
 }
@@ -230,5 +250,11 @@ void updateTransportParamsFromCachedEarlyParams(
       transportParams.initialMaxStreamsBidi);
   conn.streamManager->setMaxLocalUnidirectionalStreams(
       transportParams.initialMaxStreamsUni);
+  // The session is only resumed with a valid 0-rtt ticket, so this is a path
+  // the client has been on before.
+  if (conn.transportSettings.cachePathState && transportParams.srtt > 0) {
+    conn.transportSettings.initialRtt =
+        std::chrono::microseconds(transportParams.srtt);
+  }
 }
 } // namespace quic
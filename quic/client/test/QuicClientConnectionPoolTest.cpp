@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/client/QuicClientConnectionPool.h>
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+
+#include <quic/api/test/MockQuicSocket.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+class QuicClientConnectionPoolTest : public Test {
+ public:
+  using Key = QuicClientConnectionPool::Key;
+
+  void SetUp() override {
+    settings_.healthCheckInterval = std::chrono::milliseconds(0);
+  }
+
+  void makePool() {
+    pool_ = std::make_unique<QuicClientConnectionPool>(
+        &evb_,
+        [this](const Key&, QuicSocket::ConnectionCallback* cb) {
+          auto socket = std::make_shared<NiceMock<MockQuicSocket>>(&evb_, *cb);
+          ON_CALL(*socket, getNumOpenableBidirectionalStreams())
+              .WillByDefault(Return(100));
+          auto nextId = std::make_shared<StreamId>(0);
+          ON_CALL(*socket, createBidirectionalStream(_))
+              .WillByDefault(Invoke([nextId](bool) {
+                auto id = *nextId;
+                *nextId += 4;
+                return folly::Expected<StreamId, LocalErrorCode>(id);
+              }));
+          ON_CALL(*socket, closeGracefully()).WillByDefault(Invoke([cb]() {
+            cb->onConnectionEnd();
+          }));
+          sockets_.push_back(socket);
+          callbacks_.push_back(cb);
+          return socket;
+        },
+        settings_);
+  }
+
+  QuicClientConnectionPool::PooledStream createStream(const Key& key) {
+    auto stream = pool_->createBidirectionalStream(key);
+    EXPECT_FALSE(stream.hasError());
+    return stream.value_or(QuicClientConnectionPool::PooledStream());
+  }
+
+ protected:
+  folly::EventBase evb_;
+  QuicClientConnectionPool::Settings settings_;
+  std::vector<std::shared_ptr<NiceMock<MockQuicSocket>>> sockets_;
+  std::vector<QuicSocket::ConnectionCallback*> callbacks_;
+  std::unique_ptr<QuicClientConnectionPool> pool_;
+  Key key_{"example.com", 443, "h3"};
+  Key otherKey_{"example.com", 443, "hq"};
+};
+
+TEST_F(QuicClientConnectionPoolTest, ReusesConnections) {
+  makePool();
+  auto stream1 = createStream(key_);
+  auto stream2 = createStream(key_);
+  EXPECT_EQ(stream1.connection, stream2.connection);
+  EXPECT_NE(stream1.id, stream2.id);
+  auto stream3 = createStream(otherKey_);
+  EXPECT_NE(stream1.connection, stream3.connection);
+  EXPECT_EQ(2, pool_->numConnections());
+  EXPECT_EQ(1, pool_->numConnections(key_));
+
+  // The connection stays up for the next stream.
+  pool_->releaseStream(stream1);
+  pool_->releaseStream(stream2);
+  EXPECT_EQ(stream1.connection, createStream(key_).connection);
+  EXPECT_EQ(2, sockets_.size());
+}
+
+TEST_F(QuicClientConnectionPoolTest, OpensMoreConnectionsWhenFull) {
+  settings_.maxStreamsPerConnection = 2;
+  settings_.maxConnectionsPerKey = 2;
+  makePool();
+  auto stream1 = createStream(key_);
+  auto stream2 = createStream(key_);
+  auto stream3 = createStream(key_);
+  EXPECT_EQ(stream1.connection, stream2.connection);
+  EXPECT_NE(stream1.connection, stream3.connection);
+  EXPECT_EQ(stream3.connection, createStream(key_).connection);
+  auto full = pool_->createBidirectionalStream(key_);
+  ASSERT_TRUE(full.hasError());
+  EXPECT_EQ(LocalErrorCode::STREAM_LIMIT_EXCEEDED, full.error());
+
+  pool_->releaseStream(stream1);
+  EXPECT_EQ(stream1.connection, createStream(key_).connection);
+
+  // Nor past what the peer allows.
+  pool_->releaseStream(stream3);
+  EXPECT_CALL(*sockets_[1], getNumOpenableBidirectionalStreams())
+      .WillRepeatedly(Return(0));
+  EXPECT_TRUE(pool_->createBidirectionalStream(key_).hasError());
+}
+
+TEST_F(QuicClientConnectionPoolTest, DropsEndedConnections) {
+  makePool();
+  auto stream = createStream(key_);
+  callbacks_[0]->onConnectionError(
+      std::make_pair(LocalErrorCode::CONNECTION_RESET, "reset"));
+  EXPECT_EQ(0, pool_->numConnections());
+  pool_->releaseStream(stream);
+  EXPECT_NE(stream.connection, createStream(key_).connection);
+  EXPECT_EQ(2, sockets_.size());
+}
+
+TEST_F(QuicClientConnectionPoolTest, PingsIdleConnections) {
+  makePool();
+  auto stream = createStream(key_);
+  EXPECT_CALL(*sockets_[0], sendPing(_, _)).Times(0);
+  pool_->checkHealth();
+  Mock::VerifyAndClearExpectations(sockets_[0].get());
+
+  pool_->releaseStream(stream);
+  QuicSocket::PingCallback* pingCallback = nullptr;
+  EXPECT_CALL(*sockets_[0], sendPing(_, settings_.pingTimeout))
+      .Times(2)
+      .WillRepeatedly(SaveArg<0>(&pingCallback));
+  pool_->checkHealth();
+  // Not again until it's answered.
+  pool_->checkHealth();
+  ASSERT_NE(nullptr, pingCallback);
+  pingCallback->pingAcknowledged();
+  EXPECT_EQ(1, pool_->numConnections());
+  pool_->checkHealth();
+
+  EXPECT_CALL(*sockets_[0], closeGracefully());
+  pingCallback->pingTimeout();
+  EXPECT_EQ(0, pool_->numConnections());
+}
+
+TEST_F(QuicClientConnectionPoolTest, ClosesIdleConnections) {
+  settings_.idleTimeout = std::chrono::milliseconds(0);
+  makePool();
+  auto stream = createStream(key_);
+  EXPECT_CALL(*sockets_[0], closeGracefully()).Times(0);
+  pool_->checkHealth();
+  Mock::VerifyAndClearExpectations(sockets_[0].get());
+
+  pool_->releaseStream(stream);
+  EXPECT_CALL(*sockets_[0], closeGracefully());
+  pool_->checkHealth();
+  EXPECT_EQ(0, pool_->numConnections());
+}
+
+TEST_F(QuicClientConnectionPoolTest, Drain) {
+  makePool();
+  auto busy = createStream(key_);
+  pool_->releaseStream(createStream(otherKey_));
+  bool drained = false;
+  EXPECT_CALL(*sockets_[1], closeGracefully());
+  pool_->drain([&]() { drained = true; });
+  EXPECT_FALSE(drained);
+  auto stream = pool_->createBidirectionalStream(key_);
+  ASSERT_TRUE(stream.hasError());
+  EXPECT_EQ(LocalErrorCode::SHUTTING_DOWN, stream.error());
+
+  EXPECT_CALL(*sockets_[0], closeGracefully());
+  pool_->releaseStream(busy);
+  EXPECT_TRUE(drained);
+  EXPECT_EQ(0, pool_->numConnections());
+}
+
+TEST_F(QuicClientConnectionPoolTest, Preconnect) {
+  settings_.maxConnectionsPerKey = 2;
+  makePool();
+  EXPECT_EQ(1, pool_->preconnect(key_));
+  EXPECT_EQ(1, sockets_.size());
+  // Already has one.
+  EXPECT_EQ(1, pool_->preconnect(key_));
+  EXPECT_EQ(1, sockets_.size());
+  EXPECT_EQ(2, pool_->preconnect(key_, 5));
+  EXPECT_EQ(2, sockets_.size());
+
+  // Streams go on the warm connections.
+  createStream(key_);
+  createStream(key_);
+  EXPECT_EQ(2, sockets_.size());
+
+  pool_->drain();
+  EXPECT_EQ(0, pool_->preconnect(otherKey_));
+}
+
+TEST_F(QuicClientConnectionPoolTest, CancelsPeerStreams) {
+  makePool();
+  createStream(key_);
+  EXPECT_CALL(*sockets_[0], stopSending(1, _));
+  EXPECT_CALL(*sockets_[0], resetStream(1, _));
+  callbacks_[0]->onNewBidirectionalStream(1);
+  EXPECT_CALL(*sockets_[0], stopSending(3, _));
+  callbacks_[0]->onNewUnidirectionalStream(3);
+}
+
+} // namespace test
+} // namespace quic
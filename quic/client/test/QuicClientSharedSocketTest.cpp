@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/client/QuicClientSharedSocket.h>
+
+#include <folly/io/Cursor.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/portability/GTest.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+namespace {
+ConnectionId makeConnId(uint8_t value) {
+  return ConnectionId(std::vector<uint8_t>(kDefaultConnectionIdSize, value));
+}
+
+Buf makeLongHeaderPacket(const ConnectionId& dst, const ConnectionId& src) {
+  auto buf = folly::IOBuf::create(64);
+  folly::io::Appender appender(buf.get(), 64);
+  // Header form and fixed bits, for an Initial.
+  appender.writeBE<uint8_t>(0xC0);
+  appender.writeBE<uint32_t>(static_cast<uint32_t>(QuicVersion::MVFST));
+  appender.writeBE<uint8_t>(dst.size());
+  appender.push(dst.data(), dst.size());
+  appender.writeBE<uint8_t>(src.size());
+  appender.push(src.data(), src.size());
+  appender.writeBE<uint32_t>(0xFACEB00C);
+  return buf;
+}
+
+Buf makeShortHeaderPacket(const ConnectionId& dst) {
+  auto buf = folly::IOBuf::create(64);
+  folly::io::Appender appender(buf.get(), 64);
+  appender.writeBE<uint8_t>(0x40);
+  appender.push(dst.data(), dst.size());
+  appender.writeBE<uint32_t>(0xFACEB00C);
+  return buf;
+}
+
+class TestReadCallback : public folly::AsyncUDPSocket::ReadCallback {
+ public:
+  void getReadBuffer(void** buf, size_t* len) noexcept override {
+    buffer_ = folly::IOBuf::create(kDefaultUDPReadBufferSize);
+    *buf = buffer_->writableData();
+    *len = kDefaultUDPReadBufferSize;
+  }
+
+  void onDataAvailable(
+      const folly::SocketAddress& /*peer*/,
+      size_t len,
+      bool truncated,
+      OnDataAvailableParams /*params*/) noexcept override {
+    EXPECT_FALSE(truncated);
+    buffer_->append(len);
+    packets.push_back(std::move(buffer_));
+  }
+
+  void onReadError(const folly::AsyncSocketException&) noexcept override {}
+
+  void onReadClosed() noexcept override {}
+
+  std::vector<Buf> packets;
+
+ private:
+  Buf buffer_;
+};
+} // namespace
+
+class QuicClientSharedSocketTest : public Test {
+ public:
+  void SetUp() override {
+    auto socket = std::make_unique<folly::AsyncUDPSocket>(&evb_);
+    socket->bind(folly::SocketAddress("127.0.0.1", 0));
+    shared_ = std::make_unique<QuicClientSharedSocket>(std::move(socket));
+    peer_ = std::make_unique<folly::AsyncUDPSocket>(&evb_);
+    peer_->bind(folly::SocketAddress("127.0.0.1", 0));
+  }
+
+  // Starts a transport socket whose connection id is connId.
+  std::unique_ptr<folly::AsyncUDPSocket> startTransportSocket(
+      const ConnectionId& connId,
+      TestReadCallback& readCallback) {
+    auto socket = shared_->makeTransportSocket();
+    socket->bind(folly::SocketAddress("127.0.0.1", 0));
+    socket->resumeRead(&readCallback);
+    EXPECT_GT(
+        socket->write(
+            peer_->address(), makeLongHeaderPacket(serverConnId_, connId)),
+        0);
+    return socket;
+  }
+
+  void sendFromPeer(Buf packet) {
+    EXPECT_GT(peer_->write(shared_->address(), packet), 0);
+  }
+
+  void readAll() {
+    // Loopback sends are in the receive queue by the time write returns.
+    for (int i = 0; i < 10; ++i) {
+      evb_.loopOnce(EVLOOP_NONBLOCK);
+    }
+  }
+
+ protected:
+  folly::EventBase evb_;
+  std::unique_ptr<QuicClientSharedSocket> shared_;
+  std::unique_ptr<folly::AsyncUDPSocket> peer_;
+  ConnectionId serverConnId_{makeConnId(0xFF)};
+};
+
+TEST_F(QuicClientSharedSocketTest, RoutesByConnectionId) {
+  TestReadCallback readCallback1;
+  TestReadCallback readCallback2;
+  auto connId1 = makeConnId(1);
+  auto connId2 = makeConnId(2);
+  auto socket1 = startTransportSocket(connId1, readCallback1);
+  auto socket2 = startTransportSocket(connId2, readCallback2);
+  EXPECT_EQ(2, shared_->numRoutes());
+  EXPECT_EQ(shared_->address(), socket1->address());
+
+  sendFromPeer(makeShortHeaderPacket(connId1));
+  sendFromPeer(makeLongHeaderPacket(connId2, serverConnId_));
+  sendFromPeer(makeShortHeaderPacket(makeConnId(3)));
+  sendFromPeer(makeShortHeaderPacket(connId2));
+  readAll();
+
+  ASSERT_EQ(1, readCallback1.packets.size());
+  EXPECT_TRUE(folly::IOBufEqualTo()(
+      makeShortHeaderPacket(connId1), readCallback1.packets[0]));
+  ASSERT_EQ(2, readCallback2.packets.size());
+  EXPECT_TRUE(folly::IOBufEqualTo()(
+      makeLongHeaderPacket(connId2, serverConnId_), readCallback2.packets[0]));
+}
+
+TEST_F(QuicClientSharedSocketTest, RouteGoesAwayWithTransportSocket) {
+  TestReadCallback readCallback1;
+  TestReadCallback readCallback2;
+  auto connId1 = makeConnId(1);
+  auto socket1 = startTransportSocket(connId1, readCallback1);
+  auto socket2 = startTransportSocket(makeConnId(2), readCallback2);
+  socket1->close();
+  EXPECT_EQ(1, shared_->numRoutes());
+  socket2.reset();
+  EXPECT_EQ(0, shared_->numRoutes());
+
+  sendFromPeer(makeShortHeaderPacket(connId1));
+  readAll();
+  EXPECT_TRUE(readCallback1.packets.empty());
+}
+
+} // namespace test
+} // namespace quic
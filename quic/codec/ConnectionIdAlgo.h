@@ -9,6 +9,7 @@
 #pragma once
 
 #include <folly/Expected.h>
+#include <folly/Optional.h>
 #include <quic/QuicException.h>
 #include <quic/codec/QuicConnectionId.h>
 
@@ -37,6 +38,20 @@ class ConnectionIdAlgo {
   virtual folly::Expected<ServerConnectionIdParams, QuicInternalException>
   parseConnectionId(const ConnectionId& id) noexcept = 0;
 
+  /**
+   * parseConnectionId() for the routing of each packet, which only needs to
+   * know whether it failed. Implementations can decode without making the
+   * error, which is much of the cost of a failure.
+   */
+  virtual folly::Optional<ServerConnectionIdParams> tryParseConnectionId(
+      const ConnectionId& id) noexcept {
+    auto params = parseConnectionId(id);
+    if (!params) {
+      return folly::none;
+    }
+    return *params;
+  }
+
   /**
    * Encodes the given ServerConnectionIdParams into connection id
    */
@@ -137,9 +137,45 @@ ReadAckFrame decodeAckFrame(
       nextAckedPacketLen(largestAcked, firstAckBlockLen->first);
   frame.largestAcked = largestAcked;
   frame.ackDelay = std::chrono::microseconds(adjustedAckDelay);
+  // Frames with up to kNumInitialAckBlocksPerFrame blocks fit in the inline
+  // storage. Larger ones allocate once up front rather than growing, bounded by
+  // what the rest of the buffer can hold since every block takes at least two
+  // bytes.
+  if (additionalAckBlocks->first >= frame.ackBlocks.capacity()) {
+    uint64_t maxAckBlocks = 1 +
+        std::min<uint64_t>(
+            additionalAckBlocks->first, cursor.totalLength() / 2);
+    frame.ackBlocks.reserve(
+        std::min<uint64_t>(maxAckBlocks, frame.ackBlocks.max_size()));
+  }
   frame.ackBlocks.emplace_back(currentPacketNum, largestAcked);
-  for (uint64_t numBlocks = 0; numBlocks < additionalAckBlocks->first;
-       ++numBlocks) {
+  auto addAckBlock = [&](uint64_t gap, uint64_t blockLen) {
+    PacketNum nextEndPacket = nextAckedPacketGap(currentPacketNum, gap);
+    currentPacketNum = nextAckedPacketLen(nextEndPacket, blockLen);
+    // We don't need to add the entry when the block length is zero since we
+    // already would have processed it in the previous iteration.
+    frame.ackBlocks.emplace_back(currentPacketNum, nextEndPacket);
+  };
+  uint64_t numBlocks = 0;
+  while (numBlocks < additionalAckBlocks->first) {
+    // As long as the current buffer has room for a gap and a block length at
+    // their largest encoding, decode them straight out of it and only move
+    // the cursor once at the end.
+    auto bytes = cursor.peekBytes();
+    size_t offset = 0;
+    while (numBlocks < additionalAckBlocks->first &&
+           bytes.size() - offset >= 2 * sizeof(uint64_t)) {
+      auto currentGap = decodeQuicIntegerUnchecked(bytes.data() + offset);
+      offset += currentGap.second;
+      auto blockLen = decodeQuicIntegerUnchecked(bytes.data() + offset);
+      offset += blockLen.second;
+      addAckBlock(currentGap.first, blockLen.first);
+      ++numBlocks;
+    }
+    cursor.skip(offset);
+    if (numBlocks == additionalAckBlocks->first) {
+      break;
+    }
     auto currentGap = decodeQuicInteger(cursor);
     if (!currentGap) {
       throw QuicTransportException(
@@ -154,12 +190,8 @@ ReadAckFrame decodeAckFrame(
           quic::TransportErrorCode::FRAME_ENCODING_ERROR,
           quic::FrameType::ACK);
     }
-    PacketNum nextEndPacket =
-        nextAckedPacketGap(currentPacketNum, currentGap->first);
-    currentPacketNum = nextAckedPacketLen(nextEndPacket, blockLen->first);
-    // We don't need to add the entry when the block length is zero since we
-    // already would have processed it in the previous iteration.
-    frame.ackBlocks.emplace_back(currentPacketNum, nextEndPacket);
+    addAckBlock(currentGap->first, blockLen->first);
+    ++numBlocks;
   }
   return frame;
 }
@@ -168,9 +200,7 @@ ReadAckFrame decodeAckFrameWithECN(
     folly::io::Cursor& cursor,
     const PacketHeader& header,
     const CodecParameters& params) {
-  // TODO this is incomplete
   auto readAckFrame = decodeAckFrame(cursor, header, params);
-  // TODO we simply ignore ECN blocks in ACK-ECN frames for now.
   auto ect_0 = decodeQuicInteger(cursor);
   if (!ect_0) {
     throw QuicTransportException(
@@ -192,6 +222,10 @@ ReadAckFrame decodeAckFrameWithECN(
         quic::TransportErrorCode::FRAME_ENCODING_ERROR,
         quic::FrameType::ACK_ECN);
   }
+  readAckFrame.ecnCounts = EcnCounts();
+  readAckFrame.ecnCounts->ect0 = ect_0->first;
+  readAckFrame.ecnCounts->ect1 = ect_1->first;
+  readAckFrame.ecnCounts->ce = ect_ce->first;
   return readAckFrame;
 }
 
@@ -348,6 +382,39 @@ ReadStreamFrame decodeStreamFrame(
       folly::to<StreamId>(streamId->first), offset, std::move(data), fin);
 }
 
+DatagramFrame decodeDatagramFrame(BufQueue& queue, bool hasLen) {
+  if (queue.empty() && !hasLen) {
+    // An empty datagram ending the packet.
+    return DatagramFrame(0);
+  }
+  if (queue.empty()) {
+    throw QuicTransportException(
+        "Invalid length",
+        quic::TransportErrorCode::FRAME_ENCODING_ERROR,
+        quic::FrameType::DATAGRAM_LEN);
+  }
+  folly::io::Cursor cursor(queue.front());
+  size_t length = queue.chainLength();
+  if (hasLen) {
+    auto dataLength = decodeQuicInteger(cursor);
+    if (!dataLength) {
+      throw QuicTransportException(
+          "Invalid length",
+          quic::TransportErrorCode::FRAME_ENCODING_ERROR,
+          quic::FrameType::DATAGRAM_LEN);
+    }
+    if (cursor.totalLength() < dataLength->first) {
+      throw QuicTransportException(
+          "Length mismatch",
+          quic::TransportErrorCode::FRAME_ENCODING_ERROR,
+          quic::FrameType::DATAGRAM_LEN);
+    }
+    length = dataLength->first;
+  }
+  queue.trimStart(cursor - queue.front());
+  return DatagramFrame(length, queue.splitAtMost(length));
+}
+
 MaxDataFrame decodeMaxDataFrame(folly::io::Cursor& cursor) {
   auto maximumData = decodeQuicInteger(cursor);
   if (!maximumData) {
@@ -649,6 +716,90 @@ HandshakeDoneFrame decodeHandshakeDoneFrame(folly::io::Cursor& /*cursor*/) {
   return HandshakeDoneFrame();
 }
 
+AckFrequencyFrame decodeAckFrequencyFrame(folly::io::Cursor& cursor) {
+  auto sequenceNumber = decodeQuicInteger(cursor);
+  if (!sequenceNumber) {
+    throw QuicTransportException(
+        "Invalid sequence number",
+        quic::TransportErrorCode::FRAME_ENCODING_ERROR,
+        quic::FrameType::ACK_FREQUENCY);
+  }
+  auto packetTolerance = decodeQuicInteger(cursor);
+  if (!packetTolerance || packetTolerance->first == 0) {
+    throw QuicTransportException(
+        "Invalid packet tolerance",
+        quic::TransportErrorCode::FRAME_ENCODING_ERROR,
+        quic::FrameType::ACK_FREQUENCY);
+  }
+  auto updateMaxAckDelay = decodeQuicInteger(cursor);
+  if (!updateMaxAckDelay ||
+      updateMaxAckDelay->first >
+          static_cast<uint64_t>(
+              std::numeric_limits<std::chrono::microseconds::rep>::max())) {
+    throw QuicTransportException(
+        "Invalid update max ack delay",
+        quic::TransportErrorCode::FRAME_ENCODING_ERROR,
+        quic::FrameType::ACK_FREQUENCY);
+  }
+  if (!cursor.canAdvance(sizeof(uint8_t))) {
+    throw QuicTransportException(
+        "Missing ignore order",
+        quic::TransportErrorCode::FRAME_ENCODING_ERROR,
+        quic::FrameType::ACK_FREQUENCY);
+  }
+  auto ignoreOrder = cursor.readBE<uint8_t>();
+  if (ignoreOrder > 1) {
+    throw QuicTransportException(
+        "Invalid ignore order",
+        quic::TransportErrorCode::FRAME_ENCODING_ERROR,
+        quic::FrameType::ACK_FREQUENCY);
+  }
+  return AckFrequencyFrame(
+      sequenceNumber->first,
+      packetTolerance->first,
+      std::chrono::microseconds(updateMaxAckDelay->first),
+      ignoreOrder == 1);
+}
+
+RepairFrame decodeRepairFrame(folly::io::Cursor& cursor) {
+  auto firstPacketNum = decodeQuicInteger(cursor);
+  if (!firstPacketNum) {
+    throw QuicTransportException(
+        "Invalid first packet number",
+        quic::TransportErrorCode::FRAME_ENCODING_ERROR,
+        quic::FrameType::FEC_REPAIR);
+  }
+  if (!cursor.canAdvance(sizeof(uint64_t))) {
+    throw QuicTransportException(
+        "Missing packet mask",
+        quic::TransportErrorCode::FRAME_ENCODING_ERROR,
+        quic::FrameType::FEC_REPAIR);
+  }
+  auto packetMask = cursor.readBE<uint64_t>();
+  if (packetMask == 0) {
+    throw QuicTransportException(
+        "Empty packet mask",
+        quic::TransportErrorCode::FRAME_ENCODING_ERROR,
+        quic::FrameType::FEC_REPAIR);
+  }
+  auto symbolLength = decodeQuicInteger(cursor);
+  if (!symbolLength) {
+    throw QuicTransportException(
+        "Invalid length",
+        quic::TransportErrorCode::FRAME_ENCODING_ERROR,
+        quic::FrameType::FEC_REPAIR);
+  }
+  if (cursor.totalLength() < symbolLength->first) {
+    throw QuicTransportException(
+        "Length mismatch",
+        quic::TransportErrorCode::FRAME_ENCODING_ERROR,
+        quic::FrameType::FEC_REPAIR);
+  }
+  Buf symbol;
+  cursor.clone(symbol, symbolLength->first);
+  return RepairFrame(firstPacketNum->first, packetMask, std::move(symbol));
+}
+
 QuicFrame parseFrame(
     BufQueue& queue,
     const PacketHeader& header,
@@ -666,6 +817,7 @@ QuicFrame parseFrame(
         "Invalid frame-type field", TransportErrorCode::FRAME_ENCODING_ERROR);
   }
   queue.trimStart(cursor - queue.front());
+  // Stream and datagram frames consume the queue themselves.
   bool isStream = false;
   bool error = false;
   SCOPE_EXIT {
@@ -739,6 +891,15 @@ QuicFrame parseFrame(
         return QuicFrame(decodeExpiredStreamDataFrame(cursor));
       case FrameType::HANDSHAKE_DONE:
         return QuicFrame(decodeHandshakeDoneFrame(cursor));
+      case FrameType::ACK_FREQUENCY:
+        return QuicFrame(decodeAckFrequencyFrame(cursor));
+      case FrameType::FEC_REPAIR:
+        return QuicFrame(decodeRepairFrame(cursor));
+      case FrameType::DATAGRAM:
+      case FrameType::DATAGRAM_LEN:
+        isStream = true;
+        return QuicFrame(decodeDatagramFrame(
+            queue, frameType == FrameType::DATAGRAM_LEN));
     }
   } catch (const std::exception&) {
     error = true;
@@ -757,15 +918,47 @@ QuicFrame parseFrame(
 
 // Parse packet
 
+namespace {
+
+// The only frames Initial and Handshake packets can carry.
+bool isHandshakeFrame(const QuicFrame& frame) {
+  // TODO: add path challenge and response
+  switch (frame.type()) {
+    case QuicFrame::Type::PaddingFrame_E:
+    case QuicFrame::Type::ReadAckFrame_E:
+    case QuicFrame::Type::ConnectionCloseFrame_E:
+    case QuicFrame::Type::ReadCryptoFrame_E:
+      return true;
+    case QuicFrame::Type::QuicSimpleFrame_E:
+      return frame.asQuicSimpleFrame()->asPingFrame() != nullptr;
+    default:
+      return false;
+  }
+}
+
+} // namespace
+
 RegularQuicPacket decodeRegularPacket(
     PacketHeader&& header,
     const CodecParameters& params,
-    std::unique_ptr<folly::IOBuf> packetData) {
+    std::unique_ptr<folly::IOBuf> packetData,
+    RegularQuicPacket::Vec frames) {
   RegularQuicPacket packet(std::move(header));
+  frames.clear();
+  packet.frames = std::move(frames);
+  auto protectionType = packet.header.getProtectionType();
+  bool handshakePacket = protectionType == ProtectionType::Initial ||
+      protectionType == ProtectionType::Handshake;
   BufQueue queue;
   queue.append(std::move(packetData));
   while (queue.chainLength() > 0) {
     packet.frames.push_back(parseFrame(queue, packet.header, params));
+    // Checked as they are decoded so that the packet is rejected before any
+    // of its frames are processed, there is no rolling them back.
+    if (handshakePacket && !isHandshakeFrame(packet.frames.back())) {
+      throw QuicTransportException(
+          "Invalid frame", TransportErrorCode::PROTOCOL_VIOLATION);
+    }
   }
   return packet;
 }
@@ -938,14 +1131,14 @@ folly::Expected<ParsedLongHeader, TransportErrorCode> parseLongHeaderVariants(
       return folly::makeUnexpected(TransportErrorCode::FRAME_ENCODING_ERROR);
     }
 
-    Buf token;
-    cursor.clone(token, cursor.totalLength() - kRetryIntegrityTagLen);
+    std::string token(cursor.totalLength() - kRetryIntegrityTagLen, '\0');
+    cursor.pull(&token[0], token.size());
 
     return ParsedLongHeader(
         LongHeader(
             type,
             std::move(parsedLongHeaderInvariant.invariant),
-            token ? token->moveToFbString().toStdString() : std::string()),
+            std::move(token)),
         PacketLength(0, 0));
   }
 
@@ -959,7 +1152,7 @@ folly::Expected<ParsedLongHeader, TransportErrorCode> parseLongHeaderVariants(
     return folly::makeUnexpected(TransportErrorCode::FRAME_ENCODING_ERROR);
   }
 
-  Buf token;
+  std::string token;
   if (type == LongHeader::Types::Initial) {
     auto tokenLen = decodeQuicInteger(cursor);
     if (!tokenLen) {
@@ -972,10 +1165,11 @@ folly::Expected<ParsedLongHeader, TransportErrorCode> parseLongHeaderVariants(
     }
 
     if (tokenLen->first > 0) {
-      Buf tokenBuf;
-      // If tokenLen > token's actual length then the cursor will throw.
-      cursor.clone(tokenBuf, tokenLen->first);
-      token = std::move(tokenBuf);
+      // Copied straight into the string the header keeps, rather than cloned,
+      // as a clone would mark the whole receive buffer as shared and prevent
+      // decrypting it in place.
+      token.resize(tokenLen->first);
+      cursor.pull(&token[0], tokenLen->first);
     }
   }
   auto pktLen = decodeQuicInteger(cursor);
@@ -999,7 +1193,7 @@ folly::Expected<ParsedLongHeader, TransportErrorCode> parseLongHeaderVariants(
       LongHeader(
           type,
           std::move(parsedLongHeaderInvariant.invariant),
-          token ? token->moveToFbString().toStdString() : std::string()),
+          std::move(token)),
       PacketLength(pktLen->first, pktLen->second));
 }
 
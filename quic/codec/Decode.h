@@ -53,11 +53,15 @@ folly::Optional<VersionNegotiationPacket> decodeVersionNegotiation(
  * PacketData represents data from 1 QUIC packet.
  * Throws with a QuicException if the data in the cursor is not a complete QUIC
  * packet or the packet could not be decoded correctly.
+ * The frames are decoded into frames, which is cleared first, so that the
+ * storage of an earlier packet can be reused. Throws a PROTOCOL_VIOLATION as
+ * soon as an Initial or Handshake packet has a frame they can't carry.
  */
 RegularQuicPacket decodeRegularPacket(
     PacketHeader&& header,
     const CodecParameters& params,
-    std::unique_ptr<folly::IOBuf> packetData);
+    std::unique_ptr<folly::IOBuf> packetData,
+    RegularQuicPacket::Vec frames = RegularQuicPacket::Vec());
 
 /**
  * Parses a single frame from the queue. Throws a QuicException if the frame
@@ -129,10 +133,16 @@ ReadStreamFrame decodeStreamFrame(
 
 ReadCryptoFrame decodeCryptoFrame(folly::io::Cursor& cursor);
 
+DatagramFrame decodeDatagramFrame(BufQueue& queue, bool hasLen);
+
 ReadNewTokenFrame decodeNewTokenFrame(folly::io::Cursor& cursor);
 
 HandshakeDoneFrame decodeHandshakeDoneFrame(folly::io::Cursor& cursor);
 
+AckFrequencyFrame decodeAckFrequencyFrame(folly::io::Cursor& cursor);
+
+RepairFrame decodeRepairFrame(folly::io::Cursor& cursor);
+
 /**
  * Parse the Invariant fields in Long Header.
  *
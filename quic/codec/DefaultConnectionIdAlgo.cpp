@@ -211,6 +211,22 @@ DefaultConnectionIdAlgo::parseConnectionId(const ConnectionId& id) noexcept {
   return serverConnIdParams;
 }
 
+folly::Optional<ServerConnectionIdParams>
+DefaultConnectionIdAlgo::tryParseConnectionId(const ConnectionId& id) noexcept {
+  if (UNLIKELY(id.size() < kMinSelfConnectionIdSize)) {
+    return folly::none;
+  }
+  // The same bits as the getters above read.
+  const uint8_t* data = id.data();
+  uint8_t version = (kShortVersionBitsMask & data[0]) >> 6;
+  uint16_t hostId = ((kHostIdFirstByteMask & data[0]) << 10) |
+      ((kHostIdSecondByteMask & data[1]) << 2) |
+      ((kHostIdThirdByteMask & data[2]) >> 6);
+  uint8_t processId = (kProcessIdBitMask & data[3]) >> 5;
+  uint8_t workerId = (data[2] << 2) | (data[3] >> 6);
+  return ServerConnectionIdParams(version, hostId, processId, workerId);
+}
+
 folly::Expected<ConnectionId, QuicInternalException>
 DefaultConnectionIdAlgo::encodeConnectionId(
     const ServerConnectionIdParams& params) noexcept {
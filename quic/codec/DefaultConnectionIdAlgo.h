@@ -46,6 +46,12 @@ class DefaultConnectionIdAlgo : public ConnectionIdAlgo {
   folly::Expected<ServerConnectionIdParams, QuicInternalException>
   parseConnectionId(const ConnectionId& id) noexcept override;
 
+  /**
+   * Decodes all the fields at once, with a single check of the length.
+   */
+  folly::Optional<ServerConnectionIdParams> tryParseConnectionId(
+      const ConnectionId& id) noexcept override;
+
   /**
    * Encodes the given ServerConnectionIdParams into connection id
    */
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <folly/Optional.h>
+#include <folly/Range.h>
 #include <folly/io/Cursor.h>
 
 namespace quic {
@@ -24,6 +25,14 @@ class PacketNumberCipher {
 
   virtual HeaderProtectionMask mask(folly::ByteRange sample) const = 0;
 
+  /**
+   * Computes the masks of a batch of samples, masks[i] being the mask of
+   * samples[i]. The default implementation calls mask on every sample.
+   */
+  virtual void batchMask(
+      folly::Range<const Sample*> samples,
+      folly::Range<HeaderProtectionMask*> masks) const;
+
   /**
    * Decrypts a long header from a sample.
    * sample should be 16 bytes long.
@@ -66,6 +75,24 @@ class PacketNumberCipher {
       folly::MutableByteRange initialByte,
       folly::MutableByteRange packetNumberBytes) const;
 
+  /**
+   * Encrypts a long header with a mask that was computed from its sample, e.g.
+   * by batchMask.
+   */
+  void encryptLongHeaderWithMask(
+      const HeaderProtectionMask& headerMask,
+      folly::MutableByteRange initialByte,
+      folly::MutableByteRange packetNumberBytes) const;
+
+  /**
+   * Encrypts a short header with a mask that was computed from its sample,
+   * e.g. by batchMask.
+   */
+  void encryptShortHeaderWithMask(
+      const HeaderProtectionMask& headerMask,
+      folly::MutableByteRange initialByte,
+      folly::MutableByteRange packetNumberBytes) const;
+
   /**
    * Returns the length of key needed for the pn cipher.
    */
@@ -79,6 +106,12 @@ class PacketNumberCipher {
       uint8_t initialByteMask,
       uint8_t packetNumLengthMask) const;
 
+  void cipherHeaderWithMask(
+      const HeaderProtectionMask& headerMask,
+      folly::MutableByteRange initialByte,
+      folly::MutableByteRange packetNumberBytes,
+      uint8_t initialByteMask) const;
+
   virtual void decipherHeader(
       folly::ByteRange sample,
       folly::MutableByteRange initialByte,
@@ -13,6 +13,7 @@
 namespace quic {
 
 uint8_t* ConnectionId::data() {
+  hashValid_ = false;
   return connid.data();
 }
 
@@ -58,6 +59,18 @@ ConnectionId::ConnectionId(folly::io::Cursor& cursor, size_t len) {
   cursor.pull(connid.data(), len);
 }
 
+ConnectionId::ConnectionId(const uint8_t* data, size_t len) {
+  if (len > kMaxConnectionIdSize) {
+    // We can't throw a transport error here because of the dependency. This is
+    // sad because this will cause an internal error downstream.
+    throw std::runtime_error("ConnectionId invalid size");
+  }
+  connidLen = len;
+  if (connidLen != 0) {
+    memcpy(connid.data(), data, connidLen);
+  }
+}
+
 ConnectionId ConnectionId::createWithoutChecks(
     const std::vector<uint8_t>& connidIn) {
   ConnectionId connid;
@@ -69,8 +82,9 @@ ConnectionId ConnectionId::createWithoutChecks(
 }
 
 bool ConnectionId::operator==(const ConnectionId& other) const {
-  return connidLen == other.connidLen &&
-      memcmp(connid.data(), other.connid.data(), connidLen) == 0;
+  // A compare of the whole array is a few fixed size loads, instead of a
+  // memcmp call for each length.
+  return connidLen == other.connidLen && connid == other.connid;
 }
 
 bool ConnectionId::operator!=(const ConnectionId& other) const {
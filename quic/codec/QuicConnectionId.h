@@ -37,6 +37,7 @@ constexpr uint64_t kDefaultConnectionIdLimit = 2;
 constexpr uint64_t kInitialSequenceNumber = 0x0;
 
 struct ConnectionId {
+  // The bytes may be changed through it, so it drops the cached hash.
   uint8_t* data();
 
   const uint8_t* data() const;
@@ -47,9 +48,26 @@ struct ConnectionId {
 
   explicit ConnectionId(folly::io::Cursor& cursor, size_t len);
 
+  /**
+   * Copies len bytes from data, which must have at least that many.
+   */
+  ConnectionId(const uint8_t* data, size_t len);
+
   bool operator==(const ConnectionId& other) const;
   bool operator!=(const ConnectionId& other) const;
 
+  /**
+   * Hash of the bytes, computed once and kept with the id, and its copies, as
+   * the routing of every packet hashes the same id more than once.
+   */
+  size_t hash() const {
+    if (!hashValid_) {
+      hash_ = folly::hash::fnv32_buf(connid.data(), connidLen);
+      hashValid_ = true;
+    }
+    return hash_;
+  }
+
   std::string hex() const;
 
   /**
@@ -60,13 +78,16 @@ struct ConnectionId {
  private:
   ConnectionId() = default;
 
-  std::array<uint8_t, kMaxConnectionIdSize> connid;
+  // Zero past connidLen, so that ids compare as whole arrays.
+  std::array<uint8_t, kMaxConnectionIdSize> connid{};
   uint8_t connidLen;
+  mutable bool hashValid_{false};
+  mutable uint32_t hash_{0};
 };
 
 struct ConnectionIdHash {
   size_t operator()(const ConnectionId& connId) const {
-    return folly::hash::fnv32_buf(connId.data(), connId.size());
+    return connId.hash();
   }
 };
 
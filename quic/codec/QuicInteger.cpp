@@ -55,7 +55,14 @@ folly::Optional<std::pair<uint64_t, size_t>> decodeQuicInteger(
              << cursor.totalLength();
     return folly::none;
   }
-  const uint8_t firstByte = *cursor.peekBytes().data();
+  auto bytes = cursor.peekBytes();
+  if (atMost >= sizeof(uint64_t) && bytes.size() >= sizeof(uint64_t)) {
+    // Enough contiguous bytes for any encoding, skip the per length checks.
+    auto decoded = decodeQuicIntegerUnchecked(bytes.data());
+    cursor.skip(decoded.second);
+    return decoded;
+  }
+  const uint8_t firstByte = *bytes.data();
   const uint8_t varintType = (firstByte >> 6) & 0x03;
   const uint8_t unmaskedFirstByte = firstByte & 0x3F;
   uint8_t* resultPtr = reinterpret_cast<uint8_t*>(&result);
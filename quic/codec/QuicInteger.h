@@ -53,6 +53,18 @@ uint64_t encodeEightBytes(BufOp bufop, uint64_t value) {
 }
 } // namespace
 
+/**
+ * Returns the encoded size of value, which has to fit in a quic integer. It's
+ * constexpr so that the size of the fields known at compile time, such as
+ * frame types, folds to a constant.
+ */
+constexpr size_t quicIntegerSize(uint64_t value) {
+  return value <= kOneByteLimit ? 1
+      : value <= kTwoByteLimit  ? 2
+      : value <= kFourByteLimit ? 4
+                                : 8;
+}
+
 /**
  * Encodes the integer and writes it out to appender. Returns the number of
  * bytes written, or an error if value is too large to be represented with the
@@ -108,6 +120,21 @@ folly::Optional<std::pair<uint64_t, size_t>> decodeQuicInteger(
  */
 uint8_t decodeQuicIntegerLength(uint8_t firstByte);
 
+/**
+ * Decodes the integer at the start of data and returns a pair with the integer
+ * and the number of bytes read. data must have at least sizeof(uint64_t)
+ * readable bytes, so that any encoding can be read with a single load and no
+ * bounds check.
+ */
+inline std::pair<uint64_t, size_t> decodeQuicIntegerUnchecked(
+    const uint8_t* data) {
+  size_t numBytes = size_t(1) << (data[0] >> 6);
+  size_t shift = (sizeof(uint64_t) - numBytes) * 8;
+  uint64_t word = folly::Endian::big(folly::loadUnaligned<uint64_t>(data));
+  // Keep the numBytes leading bytes and drop the two length bits.
+  return std::make_pair((word >> shift) & (kEightByteLimit >> shift), numBytes);
+}
+
 /**
  * Returns number of bytes needed to encode value as a QUIC integer, or an error
  * if value is too large to be represented with the variable
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/codec/QuicLbConnectionIdAlgo.h>
+
+#include <folly/Random.h>
+#include <openssl/evp.h>
+
+namespace {
+constexpr size_t kAesBlockLength = 16;
+constexpr size_t kConfigIdShift = 5;
+// The plaintext is split into a left half of this many octets and a right
+// half of the rest.
+constexpr size_t kLeftHalfLength = 3;
+constexpr uint8_t kProcessIdBitMask = 0x80;
+constexpr uint8_t kNonceFirstByteMask = 0x7f;
+} // namespace
+
+namespace quic {
+
+QuicLbConnectionIdAlgo::QuicLbConnectionIdAlgo(
+    uint8_t configId,
+    folly::ByteRange key)
+    : configId_(configId) {
+  if (configId > kQuicLbMaxConfigId) {
+    throw std::runtime_error("Invalid QUIC-LB config id");
+  }
+  if (key.size() != kQuicLbKeyLength) {
+    throw std::runtime_error("Invalid QUIC-LB key length");
+  }
+  encryptCtx_.reset(EVP_CIPHER_CTX_new());
+  if (encryptCtx_ == nullptr) {
+    throw std::runtime_error("Unable to allocate an EVP_CIPHER_CTX object");
+  }
+  if (EVP_EncryptInit_ex(
+          encryptCtx_.get(), EVP_aes_128_ecb(), nullptr, key.data(), nullptr) !=
+          1 ||
+      EVP_CIPHER_CTX_set_padding(encryptCtx_.get(), 0) != 1) {
+    throw std::runtime_error("Init error");
+  }
+}
+
+bool QuicLbConnectionIdAlgo::feistelPass(Plaintext& text, uint8_t pass) const
+    noexcept {
+  // Odd passes mix the left half into the right one, even passes the reverse.
+  bool intoRight = pass % 2 == 1;
+  size_t inBegin = intoRight ? 0 : kLeftHalfLength;
+  size_t inEnd = intoRight ? kLeftHalfLength : kPlaintextLength;
+  size_t outBegin = intoRight ? kLeftHalfLength : 0;
+  size_t outEnd = intoRight ? kPlaintextLength : kLeftHalfLength;
+
+  std::array<uint8_t, kAesBlockLength> block{};
+  std::copy(text.begin() + inBegin, text.begin() + inEnd, block.begin());
+  block[kAesBlockLength - 2] = kPlaintextLength;
+  block[kAesBlockLength - 1] = pass;
+  std::array<uint8_t, kAesBlockLength> pad;
+  int outLen = 0;
+  if (EVP_EncryptUpdate(
+          encryptCtx_.get(),
+          pad.data(),
+          &outLen,
+          block.data(),
+          block.size()) != 1 ||
+      static_cast<size_t>(outLen) != pad.size()) {
+    return false;
+  }
+  for (size_t i = outBegin; i < outEnd; ++i) {
+    text[i] ^= pad[i - outBegin];
+  }
+  return true;
+}
+
+bool QuicLbConnectionIdAlgo::canParse(const ConnectionId& id) const noexcept {
+  return id.size() == kDefaultConnectionIdSize &&
+      id.data()[0] == ((configId_ << kConfigIdShift) | kPlaintextLength);
+}
+
+folly::Expected<ServerConnectionIdParams, QuicInternalException>
+QuicLbConnectionIdAlgo::parseConnectionId(const ConnectionId& id) noexcept {
+  if (UNLIKELY(!canParse(id))) {
+    return folly::makeUnexpected(QuicInternalException(
+        "ConnectionId is not from this QUIC-LB config",
+        LocalErrorCode::INTERNAL_ERROR));
+  }
+  Plaintext text;
+  std::copy(id.data() + 1, id.data() + id.size(), text.begin());
+  for (uint8_t pass = 4; pass > 0; --pass) {
+    if (UNLIKELY(!feistelPass(text, pass))) {
+      return folly::makeUnexpected(QuicInternalException(
+          "Decryption error", LocalErrorCode::INTERNAL_ERROR));
+    }
+  }
+  uint16_t hostId = (text[0] << 8) | text[1];
+  uint8_t processId = (text[3] & kProcessIdBitMask) ? 1 : 0;
+  return ServerConnectionIdParams(
+      kShortVersionId, hostId, processId, text[2] /* workerId */);
+}
+
+folly::Expected<ConnectionId, QuicInternalException>
+QuicLbConnectionIdAlgo::encodeConnectionId(
+    const ServerConnectionIdParams& params) noexcept {
+  Plaintext text;
+  // Random nonce, with the server id written over the front.
+  folly::Random::secureRandom(text.data(), text.size());
+  text[0] = params.hostId >> 8;
+  text[1] = params.hostId & 0xff;
+  text[2] = params.workerId;
+  text[3] &= kNonceFirstByteMask;
+  if (params.processId) {
+    text[3] |= kProcessIdBitMask;
+  }
+  for (uint8_t pass = 1; pass <= 4; ++pass) {
+    if (UNLIKELY(!feistelPass(text, pass))) {
+      return folly::makeUnexpected(QuicInternalException(
+          "Encryption error", LocalErrorCode::INTERNAL_ERROR));
+    }
+  }
+  std::vector<uint8_t> connIdData(kDefaultConnectionIdSize);
+  connIdData[0] = (configId_ << kConfigIdShift) | kPlaintextLength;
+  std::copy(text.begin(), text.end(), connIdData.begin() + 1);
+  return ConnectionId(std::move(connIdData));
+}
+
+} // namespace quic
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Expected.h>
+#include <folly/Range.h>
+#include <folly/ssl/OpenSSLPtrTypes.h>
+#include <quic/QuicException.h>
+#include <quic/codec/ConnectionIdAlgo.h>
+#include <quic/codec/QuicConnectionId.h>
+
+namespace quic {
+
+constexpr size_t kQuicLbKeyLength = 16;
+// The config rotation codepoint 0b111 is reserved for ids which the load
+// balancer can't route.
+constexpr uint8_t kQuicLbMaxConfigId = 6;
+
+/**
+ * Connection ids that a load balancer holding the key can route, in the
+ * layout of the QUIC-LB draft (draft-ietf-quic-load-balancers), but which look
+ * random to anyone else:
+ *
+ * The first octet is in clear: three bits of config rotation, then the length
+ * of the rest of the id.
+ * The other seven octets are encrypted with AES-128 in four Feistel passes,
+ * since they are shorter than a block:
+   0      1        2         3         4              ...      6
+  |  SERVER_ID(host id)  | WORKER_ID | SERVER_ID(process) | NONCE (31 bits)  |
+ *
+ * It keeps to kDefaultConnectionIdSize, the size the server parses short
+ * headers with.
+ */
+class QuicLbConnectionIdAlgo : public ConnectionIdAlgo {
+ public:
+  /**
+   * Throws if the key is not kQuicLbKeyLength long or the config id is over
+   * kQuicLbMaxConfigId.
+   */
+  QuicLbConnectionIdAlgo(uint8_t configId, folly::ByteRange key);
+
+  ~QuicLbConnectionIdAlgo() override = default;
+
+  /**
+   * Check if this implementation of algorithm can parse the given ConnectionId
+   */
+  bool canParse(const ConnectionId& id) const noexcept override;
+
+  /**
+   * Parses ServerConnectionIdParams from the given connection id.
+   */
+  folly::Expected<ServerConnectionIdParams, QuicInternalException>
+  parseConnectionId(const ConnectionId& id) noexcept override;
+
+  /**
+   * Encodes the given ServerConnectionIdParams into connection id
+   */
+  folly::Expected<ConnectionId, QuicInternalException> encodeConnectionId(
+      const ServerConnectionIdParams& params) noexcept override;
+
+ private:
+  static constexpr size_t kPlaintextLength = kDefaultConnectionIdSize - 1;
+
+  using Plaintext = std::array<uint8_t, kPlaintextLength>;
+
+  // XORs the next pass's pad into one half of the plaintext.
+  bool feistelPass(Plaintext& text, uint8_t pass) const noexcept;
+
+  uint8_t configId_;
+  folly::ssl::EvpCipherCtxUniquePtr encryptCtx_;
+};
+
+/**
+ * Factory to create QuicLbConnectionIdAlgo instances with the same config.
+ */
+class QuicLbConnectionIdAlgoFactory : public ConnectionIdAlgoFactory {
+ public:
+  QuicLbConnectionIdAlgoFactory(uint8_t configId, folly::ByteRange key)
+      : configId_(configId), key_(key.begin(), key.end()) {}
+
+  ~QuicLbConnectionIdAlgoFactory() override = default;
+
+  std::unique_ptr<ConnectionIdAlgo> make() override {
+    return std::make_unique<QuicLbConnectionIdAlgo>(
+        configId_, folly::range(key_));
+  }
+
+ private:
+  uint8_t configId_;
+  std::vector<uint8_t> key_;
+};
+
+} // namespace quic
@@ -116,11 +116,16 @@ folly::Optional<PacketNumEncodingResult> encodeShortHeaderHelper(
 RegularQuicPacketBuilder::RegularQuicPacketBuilder(
     uint32_t remainingBytes,
     PacketHeader header,
-    PacketNum largestAckedPacketNum)
+    PacketNum largestAckedPacketNum,
+    PacketBufArena* bufArena)
     : remainingBytes_(remainingBytes),
       packet_(std::move(header)),
-      header_(folly::IOBuf::create(kLongHeaderHeaderSize)),
-      body_(folly::IOBuf::create(kAppenderGrowthSize)),
+      header_(
+          bufArena ? bufArena->allocate()
+                   : folly::IOBuf::create(kLongHeaderHeaderSize)),
+      body_(
+          bufArena ? bufArena->allocate()
+                   : folly::IOBuf::create(kAppenderGrowthSize)),
       headerAppender_(header_.get(), kLongHeaderHeaderSize),
       bodyAppender_(body_.get(), kAppenderGrowthSize) {
   writeHeaderBytes(largestAckedPacketNum);
@@ -279,22 +284,74 @@ void RegularQuicPacketBuilder::setCipherOverhead(uint8_t overhead) noexcept {
 StatelessResetPacketBuilder::StatelessResetPacketBuilder(
     uint16_t maxPacketSize,
     const StatelessResetToken& resetToken)
-    : data_(folly::IOBuf::create(kAppenderGrowthSize)) {
-  BufAppender appender(data_.get(), kAppenderGrowthSize);
+    : StatelessResetPacketBuilder(
+          maxPacketSize,
+          resetToken,
+          folly::IOBuf::create(maxPacketSize)) {}
+
+StatelessResetPacketBuilder::StatelessResetPacketBuilder(
+    uint16_t maxPacketSize,
+    const StatelessResetToken& resetToken,
+    Buf buf)
+    : data_(std::move(buf)) {
+  CHECK(data_);
+  CHECK_GT(maxPacketSize, resetToken.size());
+  data_->clear();
+  CHECK_GE(data_->tailroom(), maxPacketSize);
   // TODO: randomize the length
   uint16_t randomOctetLength = maxPacketSize - resetToken.size() - 1;
-  uint8_t initialByte = ShortHeader::kFixedBitMask;
-  appender.writeBE<uint8_t>(initialByte);
-  auto randomOctets = folly::IOBuf::create(randomOctetLength);
-  folly::Random::secureRandom(randomOctets->writableData(), randomOctetLength);
-  appender.push(randomOctets->data(), randomOctetLength);
-  appender.push(resetToken.data(), resetToken.size());
+  auto out = data_->writableTail();
+  *out = ShortHeader::kFixedBitMask;
+  folly::Random::secureRandom(out + 1, randomOctetLength);
+  memcpy(out + 1 + randomOctetLength, resetToken.data(), resetToken.size());
+  data_->append(maxPacketSize);
 }
 
 Buf StatelessResetPacketBuilder::buildPacket() && {
   return std::move(data_);
 }
 
+RetryPacketBuilder::RetryPacketBuilder(
+    QuicVersion quicVersion,
+    const ConnectionId& sourceConnectionId,
+    const ConnectionId& destinationConnectionId,
+    folly::ByteRange retryToken)
+    : data_(folly::IOBuf::create(kAppenderGrowthSize)) {
+  BufAppender appender(data_.get(), kAppenderGrowthSize);
+  // The low four bits are unused in a Retry.
+  uint8_t initialByte = kHeaderFormMask | LongHeader::kFixedBitMask |
+      (static_cast<uint8_t>(LongHeader::Types::Retry)
+       << LongHeader::kTypeShift) |
+      (folly::Random::secureRand32() & LongHeader::kTypeBitsMask);
+  appender.writeBE<uint8_t>(initialByte);
+  appender.writeBE<QuicVersionType>(static_cast<QuicVersionType>(quicVersion));
+  appender.writeBE<uint8_t>(destinationConnectionId.size());
+  appender.push(destinationConnectionId.data(), destinationConnectionId.size());
+  appender.writeBE<uint8_t>(sourceConnectionId.size());
+  appender.push(sourceConnectionId.data(), sourceConnectionId.size());
+  appender.push(retryToken.data(), retryToken.size());
+}
+
+Buf RetryPacketBuilder::buildPacket(
+    const Aead& retryAead,
+    const ConnectionId& originalDestinationConnectionId) && {
+  // The tag authenticates a pseudo packet, which is the packet prefixed with
+  // the original destination connection id.
+  auto pseudoRetryPacket =
+      folly::IOBuf::create(1 + originalDestinationConnectionId.size());
+  BufAppender appender(pseudoRetryPacket.get(), kAppenderGrowthSize);
+  appender.writeBE<uint8_t>(originalDestinationConnectionId.size());
+  appender.push(
+      originalDestinationConnectionId.data(),
+      originalDestinationConnectionId.size());
+  pseudoRetryPacket->prependChain(data_->clone());
+  pseudoRetryPacket->coalesce();
+  auto integrityTag = retryAead.encrypt(
+      std::make_unique<folly::IOBuf>(), pseudoRetryPacket.get(), 0);
+  data_->prependChain(std::move(integrityTag));
+  return std::move(data_);
+}
+
 VersionNegotiationPacketBuilder::VersionNegotiationPacketBuilder(
     ConnectionId sourceConnectionId,
     ConnectionId destinationConnectionId,
@@ -361,22 +418,57 @@ bool VersionNegotiationPacketBuilder::canBuildPacket() const noexcept {
   return remainingBytes_ != 0;
 }
 
+Buf VersionNegotiationPacketBuilder::patchConnectionIds(
+    const folly::IOBuf& tmpl,
+    const ConnectionId& sourceConnectionId,
+    const ConnectionId& destinationConnectionId) {
+  // The packet type and version, then a zero length for each connection id.
+  constexpr size_t kPrefixLen =
+      sizeof(decltype(VersionNegotiationPacket::packetType)) +
+      sizeof(QuicVersionType);
+  constexpr size_t kTemplateHeaderLen = kPrefixLen + 2 * sizeof(uint8_t);
+  DCHECK(!tmpl.isChained());
+  CHECK_GE(tmpl.length(), kTemplateHeaderLen);
+  size_t headerLen = kTemplateHeaderLen + destinationConnectionId.size() +
+      sourceConnectionId.size();
+  size_t versionsLen = std::min<size_t>(
+      tmpl.length() - kTemplateHeaderLen,
+      (kDefaultUDPSendPacketLen - headerLen) / sizeof(QuicVersionType) *
+          sizeof(QuicVersionType));
+  auto packet = folly::IOBuf::create(headerLen + versionsLen);
+  auto out = packet->writableTail();
+  memcpy(out, tmpl.data(), kPrefixLen);
+  out += kPrefixLen;
+  *out++ = destinationConnectionId.size();
+  memcpy(out, destinationConnectionId.data(), destinationConnectionId.size());
+  out += destinationConnectionId.size();
+  *out++ = sourceConnectionId.size();
+  memcpy(out, sourceConnectionId.data(), sourceConnectionId.size());
+  out += sourceConnectionId.size();
+  memcpy(out, tmpl.data() + kTemplateHeaderLen, versionsLen);
+  packet->append(headerLen + versionsLen);
+  return packet;
+}
+
 InplaceQuicPacketBuilder::InplaceQuicPacketBuilder(
-    folly::IOBuf& iobuf,
+    BufAccessor& bufAccessor,
     uint32_t remainingBytes,
     PacketHeader header,
     PacketNum largestAckedPacketNum)
-    : iobuf_(iobuf),
-      bufWriter_(iobuf, remainingBytes),
+    : bufAccessor_(bufAccessor),
+      iobuf_(bufAccessor_.obtain()),
+      outputBuf_(*iobuf_),
+      bufWriter_(outputBuf_, remainingBytes),
       remainingBytes_(remainingBytes),
-      packet_(std::move(header)) {
+      packet_(std::move(header)),
+      headerStart_(outputBuf_.writableTail()) {
   if (packet_.header.getHeaderForm() == HeaderForm::Long) {
     LongHeader& longHeader = *packet_.header.asLong();
     packetNumberEncoding_ = encodeLongHeaderHelper(
-        longHeader, bufWriter_, remainingBytes, largestAckedPacketNum);
+        longHeader, bufWriter_, remainingBytes_, largestAckedPacketNum);
     if (longHeader.getHeaderType() != LongHeader::Types::Retry) {
       // Remember the position to write packet number and packet length.
-      packetLenOffset_ = iobuf_.length();
+      packetLenOffset_ = outputBuf_.length();
       // With this builder, we will have to always use kMaxPacketLenSize to
       // write packet length.
       packetNumOffset_ = packetLenOffset_ + kMaxPacketLenSize;
@@ -395,7 +487,17 @@ InplaceQuicPacketBuilder::InplaceQuicPacketBuilder(
           packetNumberEncoding_->length);
     }
   }
-  bodyStart_ = iobuf_.writableTail();
+  bodyStart_ = outputBuf_.writableTail();
+}
+
+InplaceQuicPacketBuilder::~InplaceQuicPacketBuilder() {
+  releaseBufferIfHeld();
+}
+
+void InplaceQuicPacketBuilder::releaseBufferIfHeld() {
+  if (iobuf_) {
+    bufAccessor_.release(std::move(iobuf_));
+  }
 }
 
 uint32_t InplaceQuicPacketBuilder::remainingSpaceInPkt() const {
@@ -468,7 +570,7 @@ PacketBuilderInterface::Packet InplaceQuicPacketBuilder::buildPacket() && {
   size_t minBodySize = kMaxPacketNumEncodingSize -
       packetNumberEncoding_->length + sizeof(Sample);
   size_t extraDataWritten = 0;
-  size_t bodyLength = iobuf_.writableTail() - bodyStart_;
+  size_t bodyLength = outputBuf_.writableTail() - bodyStart_;
   while (bodyLength + extraDataWritten + cipherOverhead_ < minBodySize &&
          !packet_.frames.empty() && remainingBytes_ > kMaxPacketLenSize) {
     // We can add padding frames, but we don't need to store them.
@@ -477,8 +579,10 @@ PacketBuilderInterface::Packet InplaceQuicPacketBuilder::buildPacket() && {
     extraDataWritten++;
   }
   if (longHeader && longHeader->getHeaderType() != LongHeader::Types::Retry) {
+    // Padding above is part of the body, so measure it again.
     QuicInteger pktLen(
-        packetNumberEncoding_->length + bodyLength + cipherOverhead_);
+        packetNumberEncoding_->length +
+        (outputBuf_.writableTail() - bodyStart_) + cipherOverhead_);
     pktLen.encode(
         [&](auto val) {
           auto bigEndian = folly::Endian::big(val);
@@ -497,17 +601,26 @@ PacketBuilderInterface::Packet InplaceQuicPacketBuilder::buildPacket() && {
   }
   CHECK(
       !bodyStart_ ||
-      (bodyStart_ >= iobuf_.data() && bodyStart_ <= iobuf_.tail()));
-  // TODO: Get rid of these two wrapBuffer when Fizz::AEAD has a new interface
-  // for encryption.
+      (bodyStart_ >= outputBuf_.data() && bodyStart_ <= outputBuf_.tail()));
+  // The header and body only wrap the accessor's memory. Writers that encrypt
+  // in place take the buffer back from the BufAccessor instead.
+  auto header = bodyStart_
+      ? folly::IOBuf::wrapBuffer(headerStart_, (bodyStart_ - headerStart_))
+      : nullptr;
+  auto body = bodyStart_
+      ? folly::IOBuf::wrapBuffer(bodyStart_, outputBuf_.tail() - bodyStart_)
+      : nullptr;
+  releaseBufferIfHeld();
   return PacketBuilderInterface::Packet(
-      std::move(packet_),
-      (bodyStart_ ? folly::IOBuf::wrapBuffer(
-                        iobuf_.data(), (bodyStart_ - iobuf_.data()))
-                  : nullptr),
-      (bodyStart_
-           ? folly::IOBuf::wrapBuffer(bodyStart_, iobuf_.tail() - bodyStart_)
-           : nullptr));
+      std::move(packet_), std::move(header), std::move(body));
+}
+
+void InplaceQuicPacketBuilder::releaseOutputBuffer() && {
+  if (iobuf_) {
+    // Roll back everything this builder has written.
+    iobuf_->trimEnd(iobuf_->tail() - headerStart_);
+  }
+  releaseBufferIfHeld();
 }
 
 void InplaceQuicPacketBuilder::setCipherOverhead(uint8_t overhead) noexcept {
@@ -524,11 +637,9 @@ bool InplaceQuicPacketBuilder::canBuildPacket() const noexcept {
 }
 
 uint32_t InplaceQuicPacketBuilder::getHeaderBytes() const {
-  bool isLongHeader = packet_.header.getHeaderForm() == HeaderForm::Long;
   CHECK(packetNumberEncoding_)
       << "packetNumberEncoding_ should be valid after ctor";
-  return folly::to<uint32_t>(bodyStart_ - iobuf_.data()) +
-      (isLongHeader ? packetNumberEncoding_->length + kMaxPacketLenSize : 0);
+  return folly::to<uint32_t>(bodyStart_ - headerStart_);
 }
 
 } // namespace quic
@@ -11,7 +11,9 @@
 #include <quic/codec/PacketNumber.h>
 #include <quic/codec/QuicInteger.h>
 #include <quic/codec/Types.h>
+#include <quic/common/BufAccessor.h>
 #include <quic/common/BufUtil.h>
+#include <quic/common/PacketBufArena.h>
 #include <quic/handshake/HandshakeLayer.h>
 
 namespace quic {
@@ -99,17 +101,24 @@ class PacketBuilderInterface {
   [[nodiscard]] virtual uint32_t getHeaderBytes() const = 0;
 
   virtual Packet buildPacket() && = 0;
+
+  /**
+   * Abandon the packet being built. Builders that write into a borrowed
+   * buffer roll back what they have written and hand the buffer back.
+   */
+  virtual void releaseOutputBuffer() && = 0;
 };
 
 /**
- * Build packet into user provided IOBuf
+ * Build packet into the IOBuf obtained from a BufAccessor. The buffer is
+ * handed back to the accessor in buildPacket() or releaseOutputBuffer().
  */
 class InplaceQuicPacketBuilder final : public PacketBuilderInterface {
  public:
-  ~InplaceQuicPacketBuilder() override = default;
+  ~InplaceQuicPacketBuilder() override;
 
   explicit InplaceQuicPacketBuilder(
-      folly::IOBuf& iobuf,
+      BufAccessor& bufAccessor,
       uint32_t remainingBytes,
       PacketHeader header,
       PacketNum largestAckedPacketNum);
@@ -137,6 +146,8 @@ class InplaceQuicPacketBuilder final : public PacketBuilderInterface {
 
   PacketBuilderInterface::Packet buildPacket() && override;
 
+  void releaseOutputBuffer() && override;
+
   [[nodiscard]] bool canBuildPacket() const noexcept override;
 
   void setCipherOverhead(uint8_t overhead) noexcept override;
@@ -144,7 +155,13 @@ class InplaceQuicPacketBuilder final : public PacketBuilderInterface {
   [[nodiscard]] uint32_t getHeaderBytes() const override;
 
  private:
-  folly::IOBuf& iobuf_;
+  void releaseBufferIfHeld();
+
+ private:
+  BufAccessor& bufAccessor_;
+  Buf iobuf_;
+  // Keeps pointing at the accessor's buffer after it has been released.
+  folly::IOBuf& outputBuf_;
   BufWriter bufWriter_;
   uint32_t remainingBytes_;
   RegularQuicWritePacket packet_;
@@ -154,6 +171,8 @@ class InplaceQuicPacketBuilder final : public PacketBuilderInterface {
   size_t packetLenOffset_{0};
   // The offset in the IOBuf writable area to write Packet Number.
   size_t packetNumOffset_{0};
+  // The position where this packet starts in the buffer.
+  uint8_t* headerStart_{nullptr};
   // The position to write body. This is only for byte counting purpose.
   uint8_t* bodyStart_{nullptr};
 };
@@ -169,10 +188,15 @@ class RegularQuicPacketBuilder final : public PacketBuilderInterface {
 
   using Packet = PacketBuilderInterface::Packet;
 
+  /**
+   * If bufArena is set, the header and the first body buffer are taken from
+   * it instead of being allocated.
+   */
   RegularQuicPacketBuilder(
       uint32_t remainingBytes,
       PacketHeader header,
-      PacketNum largestAckedPacketNum);
+      PacketNum largestAckedPacketNum,
+      PacketBufArena* bufArena = nullptr);
 
   [[nodiscard]] uint32_t getHeaderBytes() const override;
 
@@ -199,6 +223,9 @@ class RegularQuicPacketBuilder final : public PacketBuilderInterface {
   [[nodiscard]] const PacketHeader& getPacketHeader() const override;
 
   Packet buildPacket() && override;
+
+  void releaseOutputBuffer() && override {}
+
   /**
    * Whether the packet builder is able to build a packet. This should be
    * checked right after the creation of a packet builder object.
@@ -245,6 +272,16 @@ class VersionNegotiationPacketBuilder {
    */
   bool canBuildPacket() const noexcept;
 
+  /**
+   * Makes the packet for the given connection ids out of tmpl, a packet built
+   * with empty ones, so that the versions don't have to be encoded again for
+   * every packet. Versions that don't fit any more are left out.
+   */
+  static Buf patchConnectionIds(
+      const folly::IOBuf& tmpl,
+      const ConnectionId& sourceConnectionId,
+      const ConnectionId& destinationConnectionId);
+
  private:
   void writeVersionNegotiationPacket(const std::vector<QuicVersion>& versions);
 
@@ -262,12 +299,45 @@ class StatelessResetPacketBuilder {
       uint16_t maxPacketSize,
       const StatelessResetToken& resetToken);
 
+  /**
+   * Writes the packet into buf, which is cleared first and must have room
+   * for maxPacketSize bytes then. No allocation is made, so that a buffer
+   * can be reused for every reset.
+   */
+  StatelessResetPacketBuilder(
+      uint16_t maxPacketSize,
+      const StatelessResetToken& resetToken,
+      Buf buf);
+
   Buf buildPacket() &&;
 
  private:
   std::unique_ptr<folly::IOBuf> data_;
 };
 
+/**
+ * Writes a Retry packet, ending with the integrity tag of the QUIC-TLS draft.
+ */
+class RetryPacketBuilder {
+ public:
+  RetryPacketBuilder(
+      QuicVersion quicVersion,
+      const ConnectionId& sourceConnectionId,
+      const ConnectionId& destinationConnectionId,
+      folly::ByteRange retryToken);
+
+  /**
+   * Appends the integrity tag, which retryAead computes over the packet and
+   * the destination connection id of the Initial it answers.
+   */
+  Buf buildPacket(
+      const Aead& retryAead,
+      const ConnectionId& originalDestinationConnectionId) &&;
+
+ private:
+  std::unique_ptr<folly::IOBuf> data_;
+};
+
 /**
  * A PacketBuilder that wraps in another PacketBuilder that may have a different
  * writableBytes limit. The minimum between the limit will be used to limit the
@@ -350,6 +420,10 @@ class PacketBuilderWrapper : public PacketBuilderInterface {
     return std::move(builder).buildPacket();
   }
 
+  void releaseOutputBuffer() && override {
+    std::move(builder).releaseOutputBuffer();
+  }
+
   void setCipherOverhead(uint8_t overhead) noexcept override {
     builder.setCipherOverhead(overhead);
   }
@@ -9,13 +9,14 @@
 #include <quic/codec/QuicPacketRebuilder.h>
 #include <quic/codec/QuicWriteCodec.h>
 #include <quic/flowcontrol/QuicFlowController.h>
+#include <quic/state/QuicStateFunctions.h>
 #include <quic/state/QuicStreamFunctions.h>
 #include <quic/state/SimpleFrameFunctions.h>
 
 namespace quic {
 
 PacketRebuilder::PacketRebuilder(
-    RegularQuicPacketBuilder& regularBuilder,
+    PacketBuilderInterface& regularBuilder,
     QuicConnectionStateBase& conn)
     : builder_(regularBuilder), conn_(conn) {}
 
@@ -45,6 +46,9 @@ folly::Optional<PacketEvent> PacketRebuilder::rebuildFromPacket(
   // now, then we cannot clone everything in the packet.
 
   // TODO: make sure this cannot be called on handshake packets.
+  if (rebuildAsIs(packet)) {
+    return cloneOutstandingPacket(packet);
+  }
   bool writeSuccess = false;
   bool windowUpdateWritten = false;
   bool shouldWriteWindowUpdate = false;
@@ -66,6 +70,11 @@ folly::Optional<PacketEvent> PacketRebuilder::rebuildFromPacket(
           ackBlocks.insert(block.start, block.end);
         }
         AckFrameMetaData meta(ackBlocks, ackFrame.ackDelay, ackDelayExponent);
+        // The counts only grow, so the current ones are still right.
+        const auto& ecnCounts = conn_.ackStates.appDataAckState.ecnCounts;
+        if (ackFrame.ecn && !ecnCounts.empty()) {
+          meta.ecnCounts = &ecnCounts;
+        }
         auto ackWriteResult = writeAckFrame(meta, builder_);
         writeSuccess = ackWriteResult.has_value();
         break;
@@ -110,10 +119,11 @@ folly::Optional<PacketEvent> PacketRebuilder::rebuildFromPacket(
         // initialStream and handshakeStream can only be in handshake packet,
         // so they are not clonable
         CHECK(!packet.isHandshake);
-        // key update not supported
         DCHECK(
             packet.packet.header.getProtectionType() ==
-            ProtectionType::KeyPhaseZero);
+                ProtectionType::KeyPhaseZero ||
+            packet.packet.header.getProtectionType() ==
+                ProtectionType::KeyPhaseOne);
         auto& stream = conn_.cryptoState->oneRttStream;
         auto buf = cloneCryptoRetransmissionBuffer(cryptoFrame, stream);
 
@@ -175,6 +185,12 @@ folly::Optional<PacketEvent> PacketRebuilder::rebuildFromPacket(
         writeSuccess = ret;
         break;
       }
+      case QuicWriteFrame::Type::DatagramFrame_E: {
+        // Datagrams are never retransmitted, and the outstanding packet
+        // doesn't keep their payload anyway.
+        writeSuccess = true;
+        break;
+      }
       default: {
         bool ret = writeFrame(QuicWriteFrame(frame), builder_) != 0;
         notPureAck |= ret;
@@ -196,6 +212,50 @@ folly::Optional<PacketEvent> PacketRebuilder::rebuildFromPacket(
   return cloneOutstandingPacket(packet);
 }
 
+bool PacketRebuilder::rebuildAsIs(const OutstandingPacket& packet) {
+  auto body =
+      findSentPayload(conn_, packet.packet.header.getPacketSequenceNum());
+  if (!body ||
+      body->computeChainDataLength() > builder_.remainingSpaceInPkt()) {
+    return false;
+  }
+  bool hasStreamData = false;
+  for (const auto& frame : packet.packet.frames) {
+    switch (frame.type()) {
+      case QuicWriteFrame::Type::WriteStreamFrame_E: {
+        const WriteStreamFrame& streamFrame = *frame.asWriteStreamFrame();
+        auto stream = conn_.streamManager->getStream(streamFrame.streamId);
+        // Anything but data that is still unacked in full would be written
+        // differently, or not at all.
+        if (!stream || !retransmittable(*stream) || streamFrame.len == 0 ||
+            !cloneRetransmissionBuffer(streamFrame, stream)) {
+          return false;
+        }
+        hasStreamData = true;
+        break;
+      }
+      case QuicWriteFrame::Type::WriteAckFrame_E:
+        // Rebuilding only updates the ECN counts.
+        if (frame.asWriteAckFrame()->ecn) {
+          return false;
+        }
+        break;
+      case QuicWriteFrame::Type::PaddingFrame_E:
+        break;
+      default:
+        return false;
+    }
+  }
+  if (!hasStreamData) {
+    return false;
+  }
+  builder_.insert(body->clone());
+  for (const auto& frame : packet.packet.frames) {
+    builder_.appendFrame(QuicWriteFrame(frame));
+  }
+  return true;
+}
+
 const BufQueue* PacketRebuilder::cloneCryptoRetransmissionBuffer(
     const WriteCryptoFrame& frame,
     const QuicCryptoStream& stream) {
@@ -25,7 +25,7 @@ namespace quic {
 class PacketRebuilder {
  public:
   PacketRebuilder(
-      RegularQuicPacketBuilder& regularBuilder,
+      PacketBuilderInterface& regularBuilder,
       QuicConnectionStateBase& conn);
 
   folly::Optional<PacketEvent> rebuildFromPacket(OutstandingPacket& packet);
@@ -42,6 +42,13 @@ class PacketRebuilder {
    */
   PacketEvent cloneOutstandingPacket(OutstandingPacket& packet);
 
+  /**
+   * Writes the body kept for packet as is if none of its frames would be
+   * written any differently by rebuilding. Returns false, having written
+   * nothing, otherwise.
+   */
+  bool rebuildAsIs(const OutstandingPacket& packet);
+
   bool retransmittable(const QuicStreamState& stream) const {
     return stream.sendState == StreamSendState::Open_E;
   }
@@ -55,7 +62,7 @@ class PacketRebuilder {
       const QuicStreamState* stream);
 
  private:
-  RegularQuicPacketBuilder& builder_;
+  PacketBuilderInterface& builder_;
   QuicConnectionStateBase& conn_;
 };
 } // namespace quic
@@ -16,6 +16,22 @@ quic::ConnectionId zeroConnId() {
   std::vector<uint8_t> zeroData(quic::kDefaultConnectionIdSize, 0);
   return quic::ConnectionId(zeroData);
 }
+
+// A uniquely owned contiguous packet is decrypted in place, so that the frames
+// decoded from it reference the receive buffer instead of a copy. Packets that
+// were coalesced with others share their buffer and are decrypted out of
+// place.
+folly::Optional<quic::Buf> decryptPacketData(
+    const quic::Aead& cipher,
+    quic::Buf encryptedData,
+    const folly::IOBuf* associatedData,
+    quic::PacketNum packetNum) {
+  if (!encryptedData->isShared() && !encryptedData->isChained()) {
+    return cipher.tryInplaceDecrypt(
+        std::move(encryptedData), associatedData, packetNum);
+  }
+  return cipher.tryDecrypt(std::move(encryptedData), associatedData, packetNum);
+}
 } // namespace
 
 namespace quic {
@@ -201,23 +217,19 @@ CodecResult QuicReadCodec::parseLongHeaderPacket(
       initialByteRange.data()[0], packetNumberByteRange, expectedNextPacketNum);
 
   longHeader.setPacketNumber(packetNum.first);
-  BufQueue decryptQueue;
-  decryptQueue.append(std::move(currentPacketData));
+  // Same as for short headers, reference the header without cloning so that
+  // the packet can be decrypted in place. Parsing verifies that packetLength >=
+  // packet number length, so what's left after the header is exactly the
+  // encrypted data, if possibly empty.
+  DCHECK(!currentPacketData->isChained());
   size_t aadLen = packetNumberOffset + packetNum.second;
-  auto headerData = decryptQueue.splitAtMost(aadLen);
-  // parsing verifies that packetLength >= packet number length.
-  auto encryptedData = decryptQueue.splitAtMost(
-      parsedLongHeader->packetLength.packetLength - packetNum.second);
-  if (!encryptedData) {
-    // There should normally be some integrity tag at least in the data,
-    // however allowing the aead to process the data even if the tag is not
-    // present helps with writing tests.
-    encryptedData = folly::IOBuf::create(0);
-  }
+  folly::IOBuf headerData =
+      folly::IOBuf::wrapBufferAsValue(currentPacketData->data(), aadLen);
+  currentPacketData->trimStart(aadLen);
 
   Buf decrypted;
-  auto decryptAttempt = cipher->tryDecrypt(
-      std::move(encryptedData), headerData.get(), packetNum.first);
+  auto decryptAttempt = decryptPacketData(
+      *cipher, std::move(currentPacketData), &headerData, packetNum.first);
   if (!decryptAttempt) {
     VLOG(4) << "Unable to decrypt packet=" << packetNum.first
             << " packetNumLen=" << parsePacketNumberLength(initialByte)
@@ -233,7 +245,10 @@ CodecResult QuicReadCodec::parseLongHeaderPacket(
   }
 
   return decodeRegularPacket(
-      std::move(longHeader), params_, std::move(decrypted));
+      std::move(longHeader),
+      params_,
+      std::move(decrypted),
+      std::move(frameBuffer_));
 }
 
 CodecResult QuicReadCodec::parsePacket(
@@ -244,17 +259,18 @@ CodecResult QuicReadCodec::parsePacket(
     return CodecResult(Nothing());
   }
   DCHECK(!queue.front()->isChained());
-  folly::io::Cursor cursor(queue.front());
-  if (!cursor.canAdvance(sizeof(uint8_t))) {
+  // Short header packets are nearly all of what an established connection
+  // reads, so they are parsed straight off the contiguous front buffer rather
+  // than through a Cursor and parseShortHeader().
+  const folly::IOBuf* front = queue.front();
+  if (front->empty()) {
     return CodecResult(Nothing());
   }
-  uint8_t initialByte = cursor.readBE<uint8_t>();
-  auto headerForm = getHeaderForm(initialByte);
+  auto headerForm = getHeaderForm(front->data()[0]);
   if (headerForm == HeaderForm::Long) {
     return parseLongHeaderPacket(queue, ackStates);
   }
   // Short header:
-  // TODO: support key phase one.
   if (!oneRttReadCipher_ || !oneRttHeaderCipher_) {
     VLOG(4) << nodeToString(nodeType_) << " cannot read key phase zero packet";
     VLOG(20) << "cannot read data="
@@ -266,42 +282,73 @@ CodecResult QuicReadCodec::parsePacket(
 
   // TODO: allow other connid lengths from the state.
   size_t packetNumberOffset = 1 + dstConnIdSize;
-  PacketNum expectedNextPacketNum =
-      ackStates.appDataAckState.largestReceivedPacketNum
-      ? (1 + *ackStates.appDataAckState.largestReceivedPacketNum)
-      : 0;
   size_t sampleOffset = packetNumberOffset + kMaxPacketNumEncodingSize;
   Sample sample;
-  if (queue.chainLength() < sampleOffset + sample.size()) {
+  if (dstConnIdSize > kMaxConnectionIdSize) {
+    VLOG(10) << "Dropping packet, bad dstConnIdSize=" << dstConnIdSize << " "
+             << connIdToHex();
+    queue.move();
+    return CodecResult(Nothing());
+  }
+  if (front->length() < sampleOffset + sample.size()) {
     VLOG(10) << "Dropping packet, too small for sample " << connIdToHex();
     // There's not enough space for the short header packet, clear the queue
     // to indicate there's no more parse-able data.
     queue.move();
     return CodecResult(Nothing());
   }
+  PacketNum expectedNextPacketNum =
+      ackStates.appDataAckState.largestReceivedPacketNum
+      ? (1 + *ackStates.appDataAckState.largestReceivedPacketNum)
+      : 0;
   // Take it out of the queue so we can do some writing.
   auto data = queue.move();
-  folly::MutableByteRange initialByteRange(data->writableData(), 1);
+  uint8_t* packet = data->writableData();
+  folly::MutableByteRange initialByteRange(packet, 1);
   folly::MutableByteRange packetNumberByteRange(
-      data->writableData() + packetNumberOffset, kMaxPacketNumEncodingSize);
-  folly::ByteRange sampleByteRange(
-      data->writableData() + sampleOffset, sample.size());
+      packet + packetNumberOffset, kMaxPacketNumEncodingSize);
+  folly::ByteRange sampleByteRange(packet + sampleOffset, sample.size());
 
   oneRttHeaderCipher_->decryptShortHeader(
       sampleByteRange, initialByteRange, packetNumberByteRange);
-  std::pair<PacketNum, size_t> packetNum = parsePacketNumber(
-      initialByteRange.data()[0], packetNumberByteRange, expectedNextPacketNum);
-  auto shortHeader =
-      parseShortHeader(initialByteRange.data()[0], cursor, dstConnIdSize);
-  if (!shortHeader) {
+  uint8_t initialByte = packet[0];
+  if (!(initialByte & ShortHeader::kFixedBitMask) ||
+      (initialByte & ShortHeader::kReservedBitsMask)) {
     VLOG(10) << "Dropping packet, cannot parse " << connIdToHex();
     return CodecResult(Nothing());
   }
-  shortHeader->setPacketNumber(packetNum.first);
-  if (shortHeader->getProtectionType() == ProtectionType::KeyPhaseOne) {
-    VLOG(4) << nodeToString(nodeType_) << " cannot read key phase one packet "
-            << connIdToHex();
-    return CodecResult(Nothing());
+  std::pair<PacketNum, size_t> packetNum = parsePacketNumber(
+      initialByte, packetNumberByteRange, expectedNextPacketNum);
+  auto protectionType = initialByte & ShortHeader::kKeyPhaseMask
+      ? ProtectionType::KeyPhaseOne
+      : ProtectionType::KeyPhaseZero;
+  auto currentKeyPhase = oneRttReadKeyGeneration_ % 2
+      ? ProtectionType::KeyPhaseOne
+      : ProtectionType::KeyPhaseZero;
+  const Aead* cipher = oneRttReadCipher_.get();
+  bool keyUpdate = false;
+  if (protectionType != currentKeyPhase) {
+    if (previousOneRttReadCipher_ && firstPacketInReadPhase_ &&
+        packetNum.first < *firstPacketInReadPhase_) {
+      // Sent before the key update.
+      if (Clock::now() - oneRttReadKeyUpdateTime_ >
+          kTimeToRetainOldOneRttKeys) {
+        VLOG(4) << nodeToString(nodeType_)
+                << " dropping packet for exceeding old key phase timeout "
+                << connIdToHex();
+        previousOneRttReadCipher_ = nullptr;
+        return CodecResult(Nothing());
+      }
+      cipher = previousOneRttReadCipher_.get();
+    } else if (nextOneRttReadCipher_) {
+      cipher = nextOneRttReadCipher_.get();
+      keyUpdate = true;
+    } else {
+      VLOG(4) << nodeToString(nodeType_) << " cannot read "
+              << toString(protectionType) << " packet "
+              << connIdToHex();
+      return CodecResult(Nothing());
+    }
   }
 
   // We know that the iobuf is not chained. This means that we can safely have a
@@ -326,14 +373,13 @@ CodecResult QuicReadCodec::parsePacket(
         data->data() + (encryptedDataLength - sizeof(StatelessResetToken)),
         token->size());
   }
-  auto decryptAttempt = oneRttReadCipher_->tryDecrypt(
-      std::move(data), &headerData, packetNum.first);
+  auto decryptAttempt =
+      decryptPacketData(*cipher, std::move(data), &headerData, packetNum.first);
   if (!decryptAttempt) {
     // Can't return the data now, already consumed it to try decrypting it.
     if (token) {
       return StatelessReset(*token);
     }
-    auto protectionType = shortHeader->getProtectionType();
     VLOG(10) << "Unable to decrypt packet=" << packetNum.first
              << " protectionType=" << (int)protectionType << " "
              << connIdToHex();
@@ -344,15 +390,49 @@ CodecResult QuicReadCodec::parsePacket(
     // TODO better way of handling this (tests break without this)
     decrypted = folly::IOBuf::create(0);
   }
-
+  if (keyUpdate) {
+    // Only once the packet proves the peer has the new keys.
+    VLOG(10) << nodeToString(nodeType_) << " peer updated 1-RTT keys at packet="
+             << packetNum.first << " " << connIdToHex();
+    previousOneRttReadCipher_ = std::move(oneRttReadCipher_);
+    oneRttReadCipher_ = std::move(nextOneRttReadCipher_);
+    ++oneRttReadKeyGeneration_;
+    firstPacketInReadPhase_ = packetNum.first;
+    oneRttReadKeyUpdateTime_ = Clock::now();
+  }
+
+  // Only build the header once the packet is known to be good.
+  ShortHeader shortHeader(
+      protectionType,
+      ConnectionId(packet + 1, dstConnIdSize),
+      packetNum.first);
   return decodeRegularPacket(
-      std::move(*shortHeader), params_, std::move(decrypted));
+      std::move(shortHeader),
+      params_,
+      std::move(decrypted),
+      std::move(frameBuffer_));
+}
+
+void QuicReadCodec::recycleFrames(RegularQuicPacket::Vec&& frames) {
+  // Only worth keeping if it grew past what a fresh one has.
+  if (frames.capacity() > frameBuffer_.capacity()) {
+    frames.clear();
+    frameBuffer_ = std::move(frames);
+  }
+}
+
+void QuicReadCodec::releaseFrameBuffer() {
+  frameBuffer_ = RegularQuicPacket::Vec();
 }
 
 const Aead* QuicReadCodec::getOneRttReadCipher() const {
   return oneRttReadCipher_.get();
 }
 
+const Aead* QuicReadCodec::getNextOneRttReadCipher() const {
+  return nextOneRttReadCipher_.get();
+}
+
 const Aead* QuicReadCodec::getZeroRttReadCipher() const {
   return zeroRttReadCipher_.get();
 }
@@ -380,6 +460,11 @@ void QuicReadCodec::setOneRttReadCipher(
   oneRttReadCipher_ = std::move(oneRttReadCipher);
 }
 
+void QuicReadCodec::setNextOneRttReadCipher(
+    std::unique_ptr<Aead> nextOneRttReadCipher) {
+  nextOneRttReadCipher_ = std::move(nextOneRttReadCipher);
+}
+
 void QuicReadCodec::setZeroRttReadCipher(
     std::unique_ptr<Aead> zeroRttReadCipher) {
   if (nodeType_ == QuicNodeType::Client) {
@@ -461,6 +546,10 @@ folly::Optional<TimePoint> QuicReadCodec::getHandshakeDoneTime() {
   return handshakeDoneTime_;
 }
 
+uint64_t QuicReadCodec::getOneRttReadKeyGeneration() const {
+  return oneRttReadKeyGeneration_;
+}
+
 std::string QuicReadCodec::connIdToHex() {
   static ConnectionId zeroConn = zeroConnId();
   const auto& serverId = serverConnectionId_.value_or(zeroConn);
@@ -113,6 +113,7 @@ class QuicReadCodec {
       BufQueue& queue);
 
   const Aead* getOneRttReadCipher() const;
+  const Aead* getNextOneRttReadCipher() const;
   const Aead* getZeroRttReadCipher() const;
   const Aead* getHandshakeReadCipher() const;
 
@@ -129,6 +130,12 @@ class QuicReadCodec {
 
   void setInitialReadCipher(std::unique_ptr<Aead> initialReadCipher);
   void setOneRttReadCipher(std::unique_ptr<Aead> oneRttReadCipher);
+  /**
+   * The 1-RTT read cipher of the next key phase. The first packet in that
+   * phase it opens makes it the current one, which is a key update by the
+   * peer.
+   */
+  void setNextOneRttReadCipher(std::unique_ptr<Aead> nextOneRttReadCipher);
   void setZeroRttReadCipher(std::unique_ptr<Aead> zeroRttReadCipher);
   void setHandshakeReadCipher(std::unique_ptr<Aead> handshakeReadCipher);
 
@@ -154,6 +161,24 @@ class QuicReadCodec {
 
   folly::Optional<TimePoint> getHandshakeDoneTime();
 
+  /**
+   * Key updates of the 1-RTT read keys so far. The key phase bit of the
+   * packets being read is its parity.
+   */
+  uint64_t getOneRttReadKeyGeneration() const;
+
+  /**
+   * Hands back the frames of a packet parsePacket returned once the caller is
+   * done with them, so that their storage is reused for the next packet.
+   */
+  void recycleFrames(RegularQuicPacket::Vec&& frames);
+
+  /**
+   * Frees the frame storage kept for the next packet, for an idle
+   * connection.
+   */
+  void releaseFrameBuffer();
+
  private:
   CodecResult parseLongHeaderPacket(
       BufQueue& queue,
@@ -171,6 +196,10 @@ class QuicReadCodec {
   std::unique_ptr<Aead> initialReadCipher_;
 
   std::unique_ptr<Aead> oneRttReadCipher_;
+  std::unique_ptr<Aead> nextOneRttReadCipher_;
+  // The 1-RTT read cipher before the last key update, for the packets that
+  // were reordered around it.
+  std::unique_ptr<Aead> previousOneRttReadCipher_;
   std::unique_ptr<Aead> zeroRttReadCipher_;
   std::unique_ptr<Aead> handshakeReadCipher_;
 
@@ -181,6 +210,16 @@ class QuicReadCodec {
 
   folly::Optional<StatelessResetToken> statelessResetToken_;
   folly::Optional<TimePoint> handshakeDoneTime_;
+
+  uint64_t oneRttReadKeyGeneration_{0};
+  // The packet that moved the 1-RTT read keys on to the current phase, and
+  // when it arrived.
+  folly::Optional<PacketNum> firstPacketInReadPhase_;
+  TimePoint oneRttReadKeyUpdateTime_;
+
+  // Storage recycled from an earlier packet that didn't fit in the inline
+  // storage of the frames.
+  RegularQuicPacket::Vec frameBuffer_;
 };
 
 } // namespace quic
@@ -9,6 +9,7 @@
 #include <quic/codec/QuicWriteCodec.h>
 
 #include <algorithm>
+#include <cstring>
 
 #include <quic/QuicConstants.h>
 #include <quic/QuicException.h>
@@ -25,6 +26,44 @@ bool packetSpaceCheck(uint64_t limit, size_t require);
 bool packetSpaceCheck(uint64_t limit, size_t require) {
   return (folly::to<uint64_t>(require) <= limit);
 }
+
+/**
+ * Collects the fields of a frame header on the stack, so that they reach the
+ * builder with a single push: one bounds check and one virtual call, rather
+ * than one of each per field. The caller has checked the header fits.
+ */
+class FrameHeaderBuffer {
+ public:
+  template <typename T>
+  void writeBE(T data) {
+    DCHECK_LE(len_ + sizeof(T), sizeof(buf_));
+    auto bigEndian = folly::Endian::big(data);
+    memcpy(buf_ + len_, &bigEndian, sizeof(T));
+    len_ += sizeof(T);
+  }
+
+  // Frame types that fit in one byte, known at compile time.
+  template <quic::FrameType type>
+  void writeFrameType() {
+    static_assert(
+        static_cast<uint64_t>(type) <= quic::kOneByteLimit,
+        "Frame type takes more than one byte");
+    writeBE(static_cast<uint8_t>(type));
+  }
+
+  void write(const quic::QuicInteger& quicInteger) {
+    quicInteger.encode([&](auto val) { writeBE(val); });
+  }
+
+  void writeTo(quic::PacketBuilderInterface& builder) {
+    builder.push(buf_, len_);
+  }
+
+ private:
+  // Enough for a frame type and four 8 byte integers.
+  uint8_t buf_[33];
+  size_t len_{0};
+};
 } // namespace
 
 namespace quic {
@@ -121,14 +160,16 @@ folly::Optional<uint64_t> writeStreamFrameHeader(
     streamTypeBuilder.setFin();
   }
   auto streamType = streamTypeBuilder.build();
-  builder.writeBE(streamType.fieldValue());
-  builder.write(idInt);
+  FrameHeaderBuffer header;
+  header.writeBE(streamType.fieldValue());
+  header.write(idInt);
   if (offset != 0) {
-    builder.write(offsetInt);
+    header.write(offsetInt);
   }
   if (dataLenLen > 0) {
-    builder.write(QuicInteger(dataLen));
+    header.write(QuicInteger(dataLen));
   }
+  header.writeTo(builder);
   builder.appendFrame(
       WriteStreamFrame(id, offset, dataLen, streamType.hasFin()));
   DCHECK(dataLen <= builder.remainingSpaceInPkt());
@@ -180,82 +221,80 @@ folly::Optional<WriteCryptoFrame> writeCryptoFrame(
         std::string("Length bytes representation"),
         LocalErrorCode::CODEC_ERROR);
   }
-  builder.write(intFrameType);
-  builder.write(offsetInteger);
-  builder.write(lengthVarInt);
+  FrameHeaderBuffer header;
+  header.writeFrameType<FrameType::CRYPTO_FRAME>();
+  header.write(offsetInteger);
+  header.write(lengthVarInt);
+  header.writeTo(builder);
   builder.insert(data, writableData);
   builder.appendFrame(WriteCryptoFrame(offsetIn, lengthVarInt.getValue()));
   return WriteCryptoFrame(offsetIn, lengthVarInt.getValue());
 }
 
 /*
- * This function will fill the parameter ack frame with ack blocks from the
- * parameter ackBlocks until it runs out of space (bytesLimit). The largest
- * ack block should have been inserted by the caller.
+ * Extends encoding with the additional ack blocks of ackBlocks, largest first,
+ * until it holds at least bytesLimit bytes or every block.
  */
-static size_t fillFrameWithAckBlocks(
+static void encodeAckBlocks(
     const AckBlocks& ackBlocks,
-    WriteAckFrame& ackFrame,
+    AckBlocksEncoding& encoding,
     uint64_t bytesLimit) {
-  PacketNum currentSeqNum = ackBlocks.crbegin()->start;
-
-  // starts off with 0 which is what we assumed the initial ack block to be for
-  // the largest acked.
-  size_t numAdditionalAckBlocks = 0;
-  size_t previousNumAckBlocks = 0;
-
-  // Skip the largest, as it has already been emplaced.
-  for (auto blockItr = ackBlocks.crbegin() + 1; blockItr != ackBlocks.crend();
-       ++blockItr) {
-    const auto& currBlock = *blockItr;
+  auto appendOp = [&](auto val) {
+    auto bigEndian = folly::Endian::big(val);
+    auto bytes = reinterpret_cast<const uint8_t*>(&bigEndian);
+    encoding.encoded.insert(
+        encoding.encoded.end(), bytes, bytes + sizeof(bigEndian));
+  };
+  auto prevBlockItr = ackBlocks.crbegin() + encoding.blockEnds.size();
+  for (auto blockItr = prevBlockItr + 1;
+       blockItr != ackBlocks.crend() && encoding.encoded.size() < bytesLimit;
+       prevBlockItr = blockItr++) {
     // These must be true because of the properties of the interval set.
-    CHECK_GE(currentSeqNum, currBlock.end + 2);
-    PacketNum gap = currentSeqNum - currBlock.end - 2;
-    PacketNum currBlockLen = currBlock.end - currBlock.start;
-
-    // TODO this is still extra work, as we end up duplicating these
-    // calculations in the caller, we could store the results so they
-    // can be reused by the caller when writing the frame.
-    size_t gapSize = getQuicIntegerSizeThrows(gap);
-    size_t currBlockLenSize = getQuicIntegerSizeThrows(currBlockLen);
-    size_t numAdditionalAckBlocksSize =
-        getQuicIntegerSizeThrows(numAdditionalAckBlocks + 1);
-    size_t previousNumAckBlocksSize =
-        getQuicIntegerSizeThrows(previousNumAckBlocks);
-
-    size_t additionalSize = gapSize + currBlockLenSize +
-        (numAdditionalAckBlocksSize - previousNumAckBlocksSize);
-    if (bytesLimit < additionalSize) {
-      break;
-    }
-    numAdditionalAckBlocks++;
-    bytesLimit -= additionalSize;
-    previousNumAckBlocks = numAdditionalAckBlocks;
-    currentSeqNum = currBlock.start;
-    ackFrame.ackBlocks.emplace_back(currBlock.start, currBlock.end);
+    CHECK_GE(prevBlockItr->start, blockItr->end + 2);
+    QuicInteger gap(prevBlockItr->start - blockItr->end - 2);
+    QuicInteger blockLen(blockItr->end - blockItr->start);
+    gap.encode(appendOp);
+    blockLen.encode(appendOp);
+    encoding.blockEnds.push_back(encoding.encoded.size());
   }
-  return numAdditionalAckBlocks;
+}
+
+/*
+ * Returns how many additional ack blocks of encoding fit into bytesLimit,
+ * along with the additional ack block count growing past its one byte
+ * encoding.
+ */
+static size_t numAckBlocksThatFit(
+    const AckBlocksEncoding& encoding,
+    uint64_t bytesLimit) {
+  const auto& blockEnds = encoding.blockEnds;
+  size_t numBlocks =
+      std::upper_bound(blockEnds.begin(), blockEnds.end(), bytesLimit) -
+      blockEnds.begin();
+  // The count was budgeted as one byte by the caller.
+  while (numBlocks > 0 &&
+         blockEnds[numBlocks - 1] + getQuicIntegerSizeThrows(numBlocks) - 1 >
+             bytesLimit) {
+    --numBlocks;
+  }
+  return numBlocks;
 }
 
 folly::Optional<AckFrameWriteResult> writeAckFrame(
     const quic::AckFrameMetaData& ackFrameMetaData,
     PacketBuilderInterface& builder) {
-  if (ackFrameMetaData.ackBlocks.empty()) {
+  const auto& ackBlocks = ackFrameMetaData.ackBlocks;
+  if (ackBlocks.empty()) {
     return folly::none;
   }
   // The last block must be the largest block.
-  auto largestAckedPacket = ackFrameMetaData.ackBlocks.back().end;
+  auto largestAckedPacket = ackBlocks.back().end;
   // ackBlocks are already an interval set so each value is naturally
   // non-overlapping.
-  auto firstAckBlockLength =
-      largestAckedPacket - ackFrameMetaData.ackBlocks.back().start;
+  auto firstAckBlockLength = largestAckedPacket - ackBlocks.back().start;
 
-  WriteAckFrame ackFrame;
   uint64_t spaceLeft = builder.remainingSpaceInPkt();
   uint64_t beginningSpace = spaceLeft;
-  // Reserve enough space a full packet of ACKs with 2 byte varints.
-  // TODO is this a good heuristic?
-  ackFrame.ackBlocks.reserve(spaceLeft / 4);
 
   // We could technically split the range if the size of the representation of
   // the integer is too large, but that gets super tricky and is of dubious
@@ -268,43 +307,71 @@ folly::Optional<AckFrameWriteResult> writeAckFrame(
   encodedAckDelay = encodedAckDelay >> ackFrameMetaData.ackDelayExponent;
   QuicInteger ackDelayInt(encodedAckDelay);
   QuicInteger minAdditionalAckBlockCount(0);
+  const auto* ecnCounts = ackFrameMetaData.ecnCounts;
 
   // Required fields are Type, LargestAcked, AckDelay, AckBlockCount,
-  // firstAckBlockLength
-  QuicInteger encodedintFrameType(static_cast<uint8_t>(FrameType::ACK));
+  // firstAckBlockLength, and the ECN counts for ACK_ECN.
+  QuicInteger encodedintFrameType(static_cast<uint8_t>(
+      ecnCounts ? FrameType::ACK_ECN : FrameType::ACK));
   auto headerSize = encodedintFrameType.getSize() +
       largestAckedPacketInt.getSize() + ackDelayInt.getSize() +
       minAdditionalAckBlockCount.getSize() + firstAckBlockLengthInt.getSize();
+  if (ecnCounts) {
+    headerSize += QuicInteger(ecnCounts->ect0).getSize() +
+        QuicInteger(ecnCounts->ect1).getSize() +
+        QuicInteger(ecnCounts->ce).getSize();
+  }
   if (spaceLeft < headerSize) {
     return folly::none;
   }
   spaceLeft -= headerSize;
 
-  ackFrame.ackBlocks.push_back(ackFrameMetaData.ackBlocks.back());
-  auto numAdditionalAckBlocks =
-      fillFrameWithAckBlocks(ackFrameMetaData.ackBlocks, ackFrame, spaceLeft);
+  // Only the ack delay changes between ACK frames for the same ack blocks, so
+  // the additional blocks are encoded once per version of them.
+  AckBlocksEncoding localEncoding;
+  auto& encoding =
+      ackFrameMetaData.encoding ? *ackFrameMetaData.encoding : localEncoding;
+  if (encoding.version != ackBlocks.version()) {
+    encoding.version = ackBlocks.version();
+    encoding.encoded.clear();
+    encoding.blockEnds.clear();
+  }
+  encodeAckBlocks(ackBlocks, encoding, spaceLeft);
+  auto numAdditionalAckBlocks = numAckBlocksThatFit(encoding, spaceLeft);
 
   QuicInteger numAdditionalAckBlocksInt(numAdditionalAckBlocks);
-  builder.write(encodedintFrameType);
-  builder.write(largestAckedPacketInt);
-  builder.write(ackDelayInt);
-  builder.write(numAdditionalAckBlocksInt);
-  builder.write(firstAckBlockLengthInt);
-
-  PacketNum currentSeqNum = ackFrameMetaData.ackBlocks.back().start;
-  for (auto it = ackFrame.ackBlocks.cbegin() + 1;
-       it != ackFrame.ackBlocks.cend();
-       ++it) {
-    CHECK_GE(currentSeqNum, it->end + 2);
-    PacketNum gap = currentSeqNum - it->end - 2;
-    PacketNum currBlockLen = it->end - it->start;
-    QuicInteger gapInt(gap);
-    QuicInteger currentBlockLenInt(currBlockLen);
-    builder.write(gapInt);
-    builder.write(currentBlockLenInt);
-    currentSeqNum = it->start;
+  FrameHeaderBuffer header;
+  if (ecnCounts) {
+    header.writeFrameType<FrameType::ACK_ECN>();
+  } else {
+    header.writeFrameType<FrameType::ACK>();
+  }
+  header.write(largestAckedPacketInt);
+  header.write(ackDelayInt);
+  header.write(numAdditionalAckBlocksInt);
+  header.write(firstAckBlockLengthInt);
+  header.writeTo(builder);
+  if (numAdditionalAckBlocks > 0) {
+    builder.push(
+        encoding.encoded.data(),
+        encoding.blockEnds[numAdditionalAckBlocks - 1]);
   }
+  if (ecnCounts) {
+    FrameHeaderBuffer counts;
+    counts.write(QuicInteger(ecnCounts->ect0));
+    counts.write(QuicInteger(ecnCounts->ect1));
+    counts.write(QuicInteger(ecnCounts->ce));
+    counts.writeTo(builder);
+  }
+
+  WriteAckFrame ackFrame;
+  ackFrame.ackBlocks.reserve(1 + numAdditionalAckBlocks);
+  ackFrame.ackBlocks.insert(
+      ackFrame.ackBlocks.end(),
+      ackBlocks.crbegin(),
+      ackBlocks.crbegin() + 1 + numAdditionalAckBlocks);
   ackFrame.ackDelay = ackFrameMetaData.ackDelay;
+  ackFrame.ecn = ecnCounts != nullptr;
   builder.appendFrame(std::move(ackFrame));
   return AckFrameWriteResult(
       beginningSpace - builder.remainingSpaceInPkt(),
@@ -321,11 +388,11 @@ size_t writeSimpleFrame(
   switch (frame.type()) {
     case QuicSimpleFrame::Type::PingFrame_E: {
       const PingFrame& pingFrame = *frame.asPingFrame();
-      QuicInteger intFrameType(static_cast<uint8_t>(FrameType::PING));
-      if (packetSpaceCheck(spaceLeft, intFrameType.getSize())) {
-        builder.write(intFrameType);
+      constexpr auto pingSize = pingFrameSize();
+      if (packetSpaceCheck(spaceLeft, pingSize)) {
+        builder.writeBE(static_cast<uint8_t>(FrameType::PING));
         builder.appendFrame(QuicSimpleFrame(pingFrame));
-        return intFrameType.getSize();
+        return pingSize;
       }
       // no space left in packet
       return size_t(0);
@@ -491,10 +558,87 @@ size_t writeSimpleFrame(
       // no space left in packet
       return size_t(0);
     }
+    case QuicSimpleFrame::Type::AckFrequencyFrame_E: {
+      const AckFrequencyFrame& ackFrequencyFrame =
+          *frame.asAckFrequencyFrame();
+      QuicInteger intFrameType(static_cast<uint8_t>(FrameType::ACK_FREQUENCY));
+      QuicInteger sequenceNumber(ackFrequencyFrame.sequenceNumber);
+      QuicInteger packetTolerance(ackFrequencyFrame.packetTolerance);
+      QuicInteger updateMaxAckDelay(
+          ackFrequencyFrame.updateMaxAckDelay.count());
+      auto ackFrequencyFrameSize = intFrameType.getSize() +
+          sequenceNumber.getSize() + packetTolerance.getSize() +
+          updateMaxAckDelay.getSize() + sizeof(uint8_t);
+      if (packetSpaceCheck(spaceLeft, ackFrequencyFrameSize)) {
+        builder.write(intFrameType);
+        builder.write(sequenceNumber);
+        builder.write(packetTolerance);
+        builder.write(updateMaxAckDelay);
+        builder.writeBE(
+            static_cast<uint8_t>(ackFrequencyFrame.ignoreOrder ? 1 : 0));
+        builder.appendFrame(QuicSimpleFrame(ackFrequencyFrame));
+        return ackFrequencyFrameSize;
+      }
+      // no space left in packet
+      return size_t(0);
+    }
+    case QuicSimpleFrame::Type::RepairFrame_E: {
+      RepairFrame& repairFrame = *frame.asRepairFrame();
+      QuicInteger intFrameType(static_cast<uint8_t>(FrameType::FEC_REPAIR));
+      QuicInteger firstPacketNum(repairFrame.firstPacketNum);
+      size_t symbolLength =
+          repairFrame.symbol ? repairFrame.symbol->computeChainDataLength() : 0;
+      QuicInteger length(symbolLength);
+      auto repairFrameSize = intFrameType.getSize() +
+          firstPacketNum.getSize() + sizeof(uint64_t) + length.getSize() +
+          symbolLength;
+      if (packetSpaceCheck(spaceLeft, repairFrameSize)) {
+        builder.write(intFrameType);
+        builder.write(firstPacketNum);
+        builder.writeBE(repairFrame.packetMask);
+        builder.write(length);
+        if (symbolLength > 0) {
+          builder.insert(std::move(repairFrame.symbol), symbolLength);
+        }
+        // The outstanding packet doesn't need the symbol.
+        builder.appendFrame(QuicSimpleFrame(RepairFrame(
+            repairFrame.firstPacketNum, repairFrame.packetMask, nullptr)));
+        return repairFrameSize;
+      }
+      // no space left in packet
+      return size_t(0);
+    }
   }
   folly::assume_unreachable();
 }
 
+size_t writeFrame(MaxDataFrame&& frame, PacketBuilderInterface& builder) {
+  auto frameSize = maxDataFrameSize(frame.maximumData);
+  if (!packetSpaceCheck(builder.remainingSpaceInPkt(), frameSize)) {
+    return size_t(0);
+  }
+  FrameHeaderBuffer buffer;
+  buffer.writeFrameType<FrameType::MAX_DATA>();
+  buffer.write(QuicInteger(frame.maximumData));
+  buffer.writeTo(builder);
+  builder.appendFrame(std::move(frame));
+  return frameSize;
+}
+
+size_t writeFrame(MaxStreamDataFrame&& frame, PacketBuilderInterface& builder) {
+  auto frameSize = maxStreamDataFrameSize(frame.streamId, frame.maximumData);
+  if (!packetSpaceCheck(builder.remainingSpaceInPkt(), frameSize)) {
+    return size_t(0);
+  }
+  FrameHeaderBuffer buffer;
+  buffer.writeFrameType<FrameType::MAX_STREAM_DATA>();
+  buffer.write(QuicInteger(frame.streamId));
+  buffer.write(QuicInteger(frame.maximumData));
+  buffer.writeTo(builder);
+  builder.appendFrame(std::move(frame));
+  return frameSize;
+}
+
 size_t writeFrame(QuicWriteFrame&& frame, PacketBuilderInterface& builder) {
   using FrameTypeType = std::underlying_type<FrameType>::type;
 
@@ -531,38 +675,10 @@ size_t writeFrame(QuicWriteFrame&& frame, PacketBuilderInterface& builder) {
       // no space left in packet
       return size_t(0);
     }
-    case QuicWriteFrame::Type::MaxDataFrame_E: {
-      MaxDataFrame& maxDataFrame = *frame.asMaxDataFrame();
-      QuicInteger intFrameType(static_cast<uint8_t>(FrameType::MAX_DATA));
-      QuicInteger maximumData(maxDataFrame.maximumData);
-      auto frameSize = intFrameType.getSize() + maximumData.getSize();
-      if (packetSpaceCheck(spaceLeft, frameSize)) {
-        builder.write(intFrameType);
-        builder.write(maximumData);
-        builder.appendFrame(std::move(maxDataFrame));
-        return frameSize;
-      }
-      // no space left in packet
-      return size_t(0);
-    }
-    case QuicWriteFrame::Type::MaxStreamDataFrame_E: {
-      MaxStreamDataFrame& maxStreamDataFrame = *frame.asMaxStreamDataFrame();
-      QuicInteger intFrameType(
-          static_cast<uint8_t>(FrameType::MAX_STREAM_DATA));
-      QuicInteger streamId(maxStreamDataFrame.streamId);
-      QuicInteger maximumData(maxStreamDataFrame.maximumData);
-      auto maxStreamDataFrameSize =
-          intFrameType.getSize() + streamId.getSize() + maximumData.getSize();
-      if (packetSpaceCheck(spaceLeft, maxStreamDataFrameSize)) {
-        builder.write(intFrameType);
-        builder.write(streamId);
-        builder.write(maximumData);
-        builder.appendFrame(std::move(maxStreamDataFrame));
-        return maxStreamDataFrameSize;
-      }
-      // no space left in packet
-      return size_t(0);
-    }
+    case QuicWriteFrame::Type::MaxDataFrame_E:
+      return writeFrame(std::move(*frame.asMaxDataFrame()), builder);
+    case QuicWriteFrame::Type::MaxStreamDataFrame_E:
+      return writeFrame(std::move(*frame.asMaxStreamDataFrame()), builder);
     case QuicWriteFrame::Type::DataBlockedFrame_E: {
       DataBlockedFrame& blockedFrame = *frame.asDataBlockedFrame();
       QuicInteger intFrameType(static_cast<uint8_t>(FrameType::DATA_BLOCKED));
@@ -658,6 +774,27 @@ size_t writeFrame(QuicWriteFrame&& frame, PacketBuilderInterface& builder) {
       // no space left in packet
       return size_t(0);
     }
+    case QuicWriteFrame::Type::DatagramFrame_E: {
+      DatagramFrame& datagramFrame = *frame.asDatagramFrame();
+      // Always with a length, so that other frames can follow it.
+      QuicInteger intFrameType(
+          static_cast<FrameTypeType>(FrameType::DATAGRAM_LEN));
+      QuicInteger length(datagramFrame.length);
+      auto datagramFrameSize =
+          intFrameType.getSize() + length.getSize() + datagramFrame.length;
+      if (packetSpaceCheck(spaceLeft, datagramFrameSize)) {
+        builder.write(intFrameType);
+        builder.write(length);
+        if (datagramFrame.length > 0) {
+          builder.insert(std::move(datagramFrame.data), datagramFrame.length);
+        }
+        // The outstanding packet doesn't need the payload.
+        builder.appendFrame(DatagramFrame(datagramFrame.length));
+        return datagramFrameSize;
+      }
+      // no space left in packet
+      return size_t(0);
+    }
     case QuicWriteFrame::Type::QuicSimpleFrame_E: {
       return writeSimpleFrame(std::move(*frame.asQuicSimpleFrame()), builder);
     }
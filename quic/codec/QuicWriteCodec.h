@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <quic/codec/QuicInteger.h>
 #include <quic/codec/QuicPacketBuilder.h>
 #include <quic/codec/Types.h>
 #include <quic/common/IntervalSet.h>
@@ -22,14 +23,21 @@ struct AckFrameMetaData {
   std::chrono::microseconds ackDelay;
   // The ack delay exponent to use.
   uint8_t ackDelayExponent;
+  // Optional encoding of ackBlocks kept across writes. It's brought up to date
+  // with ackBlocks as needed.
+  AckBlocksEncoding* encoding;
+  // When set, the frame is written as an ACK_ECN frame carrying these counts.
+  const EcnCounts* ecnCounts{nullptr};
 
   AckFrameMetaData(
       const AckBlocks& acksIn,
       std::chrono::microseconds ackDelayIn,
-      uint8_t ackDelayExponentIn)
+      uint8_t ackDelayExponentIn,
+      AckBlocksEncoding* encodingIn = nullptr)
       : ackBlocks(acksIn),
         ackDelay(ackDelayIn),
-        ackDelayExponent(ackDelayExponentIn) {}
+        ackDelayExponent(ackDelayExponentIn),
+        encoding(encodingIn) {}
 };
 
 struct AckFrameWriteResult {
@@ -59,6 +67,35 @@ size_t writeSimpleFrame(
  */
 size_t writeFrame(QuicWriteFrame&& frame, PacketBuilderInterface& builder);
 
+/**
+ * Encoded size of the frames with a fixed shape, so that callers can check the
+ * space left before building them. They are constants when the fields are.
+ */
+constexpr size_t pingFrameSize() {
+  return quicIntegerSize(static_cast<uint64_t>(FrameType::PING));
+}
+
+constexpr size_t maxDataFrameSize(uint64_t maximumData) {
+  return quicIntegerSize(static_cast<uint64_t>(FrameType::MAX_DATA)) +
+      quicIntegerSize(maximumData);
+}
+
+constexpr size_t maxStreamDataFrameSize(
+    StreamId streamId,
+    uint64_t maximumData) {
+  return quicIntegerSize(static_cast<uint64_t>(FrameType::MAX_STREAM_DATA)) +
+      quicIntegerSize(streamId) + quicIntegerSize(maximumData);
+}
+
+/**
+ * Write a MAX_DATA or MAX_STREAM_DATA frame into builder, without going
+ * through the dispatch over QuicWriteFrame. Returns the number of bytes
+ * written, or 0 if the frame doesn't fit.
+ */
+size_t writeFrame(MaxDataFrame&& frame, PacketBuilderInterface& builder);
+
+size_t writeFrame(MaxStreamDataFrame&& frame, PacketBuilderInterface& builder);
+
 /**
  * Write a complete stream frame header into builder
  * This writes the stream frame header into the parameter builder and returns
@@ -163,12 +163,12 @@ ProtectionType PacketHeader::getProtectionType() const {
 LongHeader::LongHeader(
     Types type,
     LongHeaderInvariant invariant,
-    const std::string& token,
+    std::string token,
     folly::Optional<ConnectionId> originalDstConnId)
     : longHeaderType_(type),
       invariant_(std::move(invariant)),
-      token_(token),
-      originalDstConnId_(originalDstConnId) {}
+      token_(std::move(token)),
+      originalDstConnId_(std::move(originalDstConnId)) {}
 
 LongHeader::LongHeader(
     Types type,
@@ -398,6 +398,13 @@ std::string toString(FrameType frame) {
       return "EXPIRED_STREAM_DATA";
     case FrameType::HANDSHAKE_DONE:
       return "HANDSHAKE_DONE";
+    case FrameType::DATAGRAM:
+    case FrameType::DATAGRAM_LEN:
+      return "DATAGRAM";
+    case FrameType::ACK_FREQUENCY:
+      return "ACK_FREQUENCY";
+    case FrameType::FEC_REPAIR:
+      return "FEC_REPAIR";
   }
   LOG(WARNING) << "toString has unhandled frame type";
   return "UNKNOWN";
@@ -100,6 +100,20 @@ struct AckBlock {
  |                    Additional ACK Block (i)                 ...
  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
  */
+/**
+ * Number of packets received with each ECN codepoint, as carried by ACK_ECN
+ * frames.
+ */
+struct EcnCounts {
+  uint64_t ect0{0};
+  uint64_t ect1{0};
+  uint64_t ce{0};
+
+  bool empty() const {
+    return ect0 == 0 && ect1 == 0 && ce == 0;
+  }
+};
+
 struct ReadAckFrame {
   PacketNum largestAcked;
   std::chrono::microseconds ackDelay{0us};
@@ -107,6 +121,8 @@ struct ReadAckFrame {
   // These are ordered in descending order by start packet.
   using Vec = SmallVec<AckBlock, kNumInitialAckBlocksPerFrame, uint16_t>;
   Vec ackBlocks;
+  // Only set for ACK_ECN frames.
+  folly::Optional<EcnCounts> ecnCounts;
 
   bool operator==(const ReadAckFrame& /*rhs*/) const {
     // Can't compare ackBlocks, function is just here to appease compiler.
@@ -122,6 +138,10 @@ struct WriteAckFrame {
   AckBlockVec ackBlocks;
   // Delay in sending ack from time that packet was received.
   std::chrono::microseconds ackDelay{0us};
+  // Set when the frame was written as an ACK_ECN frame. The counts aren't
+  // kept, they only grow, so the current ones are written when the frame is
+  // written again.
+  bool ecn{false};
 
   bool operator==(const WriteAckFrame& /*rhs*/) const {
     // Can't compare ackBlocks, function is just here to appease compiler.
@@ -129,6 +149,19 @@ struct WriteAckFrame {
   }
 };
 
+/**
+ * The encoded gap and block length pairs that follow the first ack block of
+ * an ACK frame, largest first, for a prefix of an AckBlocks. Keeping it around
+ * lets an ACK frame for unchanged AckBlocks be written again by copying bytes.
+ */
+struct AckBlocksEncoding {
+  // AckBlocks::version() the encoding was made from.
+  folly::Optional<uint64_t> version;
+  std::vector<uint8_t> encoded;
+  // Offset in encoded where each additional ack block ends.
+  std::vector<size_t> blockEnds;
+};
+
 struct RstStreamFrame {
   StreamId streamId;
   ApplicationErrorCode errorCode;
@@ -242,6 +275,42 @@ struct ReadNewTokenFrame {
   }
 };
 
+/**
+ * An unreliable DATAGRAM frame (RFC 9221). Its payload is handed to the
+ * application as is, and it is never retransmitted. Read frames carry the
+ * payload. Written frames only need it until the packet is built, the copy
+ * kept with the outstanding packet has just the length.
+ */
+struct DatagramFrame {
+  size_t length;
+  Buf data;
+
+  explicit DatagramFrame(size_t lengthIn, Buf dataIn = nullptr)
+      : length(lengthIn), data(std::move(dataIn)) {}
+
+  // Stuff stored in a variant type needs to be copyable.
+  DatagramFrame(const DatagramFrame& other) : length(other.length) {
+    if (other.data) {
+      data = other.data->clone();
+    }
+  }
+
+  DatagramFrame(DatagramFrame&& other) noexcept = default;
+
+  DatagramFrame& operator=(const DatagramFrame& other) {
+    length = other.length;
+    data = other.data ? other.data->clone() : nullptr;
+    return *this;
+  }
+
+  DatagramFrame& operator=(DatagramFrame&& other) noexcept = default;
+
+  bool operator==(const DatagramFrame& other) const {
+    folly::IOBufEqualTo eq;
+    return length == other.length && eq(data, other.data);
+  }
+};
+
 /**
  The structure of the stream frame used for writes.
  0                   1                   2                   3
@@ -555,6 +624,81 @@ struct HandshakeDoneFrame {
   }
 };
 
+/**
+ * Asks the peer to change how often it sends ACKs. Only sent to peers that
+ * advertised min_ack_delay.
+ */
+struct AckFrequencyFrame {
+  // Frames with a smaller sequence number than one already received are
+  // ignored, so reordered frames don't undo newer ones.
+  uint64_t sequenceNumber;
+  // Number of ack-eliciting packets that can be received before sending an ACK.
+  uint64_t packetTolerance;
+  // The ack delay to use from now on.
+  std::chrono::microseconds updateMaxAckDelay;
+  // Whether out of order packets no longer trigger an immediate ACK.
+  bool ignoreOrder;
+
+  AckFrequencyFrame(
+      uint64_t sequenceNumberIn,
+      uint64_t packetToleranceIn,
+      std::chrono::microseconds updateMaxAckDelayIn,
+      bool ignoreOrderIn)
+      : sequenceNumber(sequenceNumberIn),
+        packetTolerance(packetToleranceIn),
+        updateMaxAckDelay(updateMaxAckDelayIn),
+        ignoreOrder(ignoreOrderIn) {}
+
+  bool operator==(const AckFrequencyFrame& rhs) const {
+    return sequenceNumber == rhs.sequenceNumber &&
+        packetTolerance == rhs.packetTolerance &&
+        updateMaxAckDelay == rhs.updateMaxAckDelay &&
+        ignoreOrder == rhs.ignoreOrder;
+  }
+};
+
+/**
+ * Forward error correction for the stream frames of the packets in the
+ * mask, see QuicFecFunctions.h. Bit i of packetMask stands for packet
+ * firstPacketNum + i. Only sent to peers that advertised support for them.
+ */
+struct RepairFrame {
+  PacketNum firstPacketNum;
+  uint64_t packetMask;
+  // The XOR of the source symbols of the packets.
+  Buf symbol;
+
+  RepairFrame(PacketNum firstPacketNumIn, uint64_t packetMaskIn, Buf symbolIn)
+      : firstPacketNum(firstPacketNumIn),
+        packetMask(packetMaskIn),
+        symbol(std::move(symbolIn)) {}
+
+  // Stuff stored in a variant type needs to be copyable.
+  RepairFrame(const RepairFrame& other)
+      : firstPacketNum(other.firstPacketNum), packetMask(other.packetMask) {
+    if (other.symbol) {
+      symbol = other.symbol->clone();
+    }
+  }
+
+  RepairFrame(RepairFrame&& other) noexcept = default;
+
+  RepairFrame& operator=(const RepairFrame& other) {
+    firstPacketNum = other.firstPacketNum;
+    packetMask = other.packetMask;
+    symbol = other.symbol ? other.symbol->clone() : nullptr;
+    return *this;
+  }
+
+  RepairFrame& operator=(RepairFrame&& other) noexcept = default;
+
+  // The symbol isn't compared, outstanding packets don't keep it.
+  bool operator==(const RepairFrame& rhs) const {
+    return firstPacketNum == rhs.firstPacketNum &&
+        packetMask == rhs.packetMask;
+  }
+};
+
 // Frame to represent ones we skip
 struct NoopFrame {
   bool operator==(const NoopFrame&) const {
@@ -575,36 +719,52 @@ struct StatelessReset {
   F(ExpiredStreamDataFrame, __VA_ARGS__)  \
   F(PathChallengeFrame, __VA_ARGS__)      \
   F(PathResponseFrame, __VA_ARGS__)       \
-  F(NewConnectionIdFrame, __VA_ARGS__)    \
   F(MaxStreamsFrame, __VA_ARGS__)         \
   F(RetireConnectionIdFrame, __VA_ARGS__) \
   F(PingFrame, __VA_ARGS__)               \
-  F(HandshakeDoneFrame, __VA_ARGS__)
+  F(HandshakeDoneFrame, __VA_ARGS__)      \
+  F(AckFrequencyFrame, __VA_ARGS__)       \
+  F(RepairFrame, __VA_ARGS__)
+
+// Frames that are rarely sent and much larger than the others. They are
+// boxed so that they don't set the size of every frame, which outstanding
+// packets keep a few of each.
+#define QUIC_BOXED_SIMPLE_FRAME(F, ...) F(NewConnectionIdFrame, __VA_ARGS__)
 
-DECLARE_VARIANT_TYPE(QuicSimpleFrame, QUIC_SIMPLE_FRAME)
+DECLARE_VARIANT_TYPE_WITH_BOXED(
+    QuicSimpleFrame,
+    QUIC_SIMPLE_FRAME,
+    QUIC_BOXED_SIMPLE_FRAME)
 
 #define QUIC_FRAME(F, ...)               \
   F(PaddingFrame, __VA_ARGS__)           \
   F(RstStreamFrame, __VA_ARGS__)         \
-  F(ConnectionCloseFrame, __VA_ARGS__)   \
   F(MaxDataFrame, __VA_ARGS__)           \
   F(MaxStreamDataFrame, __VA_ARGS__)     \
   F(DataBlockedFrame, __VA_ARGS__)       \
   F(StreamDataBlockedFrame, __VA_ARGS__) \
   F(StreamsBlockedFrame, __VA_ARGS__)    \
-  F(ReadAckFrame, __VA_ARGS__)           \
   F(ReadStreamFrame, __VA_ARGS__)        \
   F(ReadCryptoFrame, __VA_ARGS__)        \
   F(ReadNewTokenFrame, __VA_ARGS__)      \
+  F(DatagramFrame, __VA_ARGS__)          \
   F(QuicSimpleFrame, __VA_ARGS__)        \
   F(NoopFrame, __VA_ARGS__)
 
-DECLARE_VARIANT_TYPE(QuicFrame, QUIC_FRAME)
+#define QUIC_BOXED_FRAME(F, ...) F(ConnectionCloseFrame, __VA_ARGS__)
+
+// ReadAckFrame keeps its first ack blocks inline, which makes it an order of
+// magnitude larger than any other frame. Boxed, the decoded frames of most
+// packets fit in the inline storage of RegularQuicPacket::frames.
+#define QUIC_BOXED_READ_FRAME(F, ...) \
+  QUIC_BOXED_FRAME(F, __VA_ARGS__)    \
+  F(ReadAckFrame, __VA_ARGS__)
+
+DECLARE_VARIANT_TYPE_WITH_BOXED(QuicFrame, QUIC_FRAME, QUIC_BOXED_READ_FRAME)
 
 #define QUIC_WRITE_FRAME(F, ...)         \
   F(PaddingFrame, __VA_ARGS__)           \
   F(RstStreamFrame, __VA_ARGS__)         \
-  F(ConnectionCloseFrame, __VA_ARGS__)   \
   F(MaxDataFrame, __VA_ARGS__)           \
   F(MaxStreamDataFrame, __VA_ARGS__)     \
   F(DataBlockedFrame, __VA_ARGS__)       \
@@ -613,11 +773,15 @@ DECLARE_VARIANT_TYPE(QuicFrame, QUIC_FRAME)
   F(WriteAckFrame, __VA_ARGS__)          \
   F(WriteStreamFrame, __VA_ARGS__)       \
   F(WriteCryptoFrame, __VA_ARGS__)       \
+  F(DatagramFrame, __VA_ARGS__)          \
   F(QuicSimpleFrame, __VA_ARGS__)        \
   F(NoopFrame, __VA_ARGS__)
 
 // Types of frames which are written.
-DECLARE_VARIANT_TYPE(QuicWriteFrame, QUIC_WRITE_FRAME)
+DECLARE_VARIANT_TYPE_WITH_BOXED(
+    QuicWriteFrame,
+    QUIC_WRITE_FRAME,
+    QUIC_BOXED_FRAME)
 
 enum class HeaderForm : bool {
   Long = 1,
@@ -682,10 +846,11 @@ struct LongHeader {
       const std::string& token = std::string(),
       folly::Optional<ConnectionId> originalDstConnId = folly::none);
 
+  // The token is moved in, parsed headers hand over the one they read.
   LongHeader(
       Types type,
       LongHeaderInvariant invariant,
-      const std::string& token = std::string(),
+      std::string token = std::string(),
       folly::Optional<ConnectionId> originalDstConnId = folly::none);
 
   LongHeader(const LongHeader& other) = default;
@@ -220,6 +220,63 @@ TEST_F(DecodeTest, ValidAckFrame) {
   EXPECT_EQ(ackFrame.ackDelay.count(), 100 << kDefaultAckDelayExponent);
 }
 
+TEST_F(DecodeTest, AckEcnFrame) {
+  QuicInteger largestAcked(1000);
+  QuicInteger ackDelay(100);
+  QuicInteger numAdditionalBlocks(0);
+  QuicInteger firstAckBlockLength(10);
+
+  std::vector<NormalizedAckBlock> ackBlocks;
+  auto result = createAckFrame(
+      largestAcked,
+      ackDelay,
+      numAdditionalBlocks,
+      firstAckBlockLength,
+      ackBlocks);
+  BufAppender wcursor(result.get(), 10);
+  auto appenderOp = [&](auto val) { wcursor.writeBE(val); };
+  QuicInteger(20).encode(appenderOp);
+  QuicInteger(0).encode(appenderOp);
+  QuicInteger(3).encode(appenderOp);
+  folly::io::Cursor cursor(result.get());
+  auto ackFrame = decodeAckFrameWithECN(
+      cursor,
+      makeHeader(),
+      CodecParameters(kDefaultAckDelayExponent, QuicVersion::MVFST));
+  EXPECT_EQ(ackFrame.ackBlocks.size(), 1);
+  EXPECT_EQ(ackFrame.largestAcked, 1000);
+  ASSERT_TRUE(ackFrame.ecnCounts.has_value());
+  EXPECT_EQ(ackFrame.ecnCounts->ect0, 20);
+  EXPECT_EQ(ackFrame.ecnCounts->ect1, 0);
+  EXPECT_EQ(ackFrame.ecnCounts->ce, 3);
+  EXPECT_TRUE(cursor.isAtEnd());
+}
+
+TEST_F(DecodeTest, AckEcnFrameMissingCounts) {
+  QuicInteger largestAcked(1000);
+  QuicInteger ackDelay(100);
+  QuicInteger numAdditionalBlocks(0);
+  QuicInteger firstAckBlockLength(10);
+
+  std::vector<NormalizedAckBlock> ackBlocks;
+  auto result = createAckFrame(
+      largestAcked,
+      ackDelay,
+      numAdditionalBlocks,
+      firstAckBlockLength,
+      ackBlocks);
+  BufAppender wcursor(result.get(), 10);
+  auto appenderOp = [&](auto val) { wcursor.writeBE(val); };
+  QuicInteger(20).encode(appenderOp);
+  folly::io::Cursor cursor(result.get());
+  EXPECT_THROW(
+      decodeAckFrameWithECN(
+          cursor,
+          makeHeader(),
+          CodecParameters(kDefaultAckDelayExponent, QuicVersion::MVFST)),
+      QuicTransportException);
+}
+
 TEST_F(DecodeTest, AckFrameLargestAckExceedsRange) {
   // An integer larger than the representable range of quic integer.
   QuicInteger largestAcked(std::numeric_limits<uint64_t>::max());
@@ -352,6 +409,25 @@ TEST_F(DecodeTest, AckFrameAdditionalBlocksOverflow) {
       CodecParameters(kDefaultAckDelayExponent, QuicVersion::MVFST));
 }
 
+TEST_F(DecodeTest, AckFrameHugeBlockCount) {
+  // The block count is not trusted for sizing the block storage.
+  std::vector<NormalizedAckBlock> ackBlocks;
+  ackBlocks.emplace_back(QuicInteger(10), QuicInteger(10));
+  auto result = createAckFrame(
+      QuicInteger(1000),
+      QuicInteger(100),
+      QuicInteger(kFourByteLimit),
+      QuicInteger(10),
+      ackBlocks);
+  folly::io::Cursor cursor(result.get());
+  EXPECT_THROW(
+      decodeAckFrame(
+          cursor,
+          makeHeader(),
+          CodecParameters(kDefaultAckDelayExponent, QuicVersion::MVFST)),
+      QuicTransportException);
+}
+
 TEST_F(DecodeTest, AckFrameMissingFields) {
   QuicInteger largestAcked(1000);
   QuicInteger ackDelay(100);
@@ -518,6 +594,59 @@ TEST_F(DecodeTest, AckFrameBlockLengthZero) {
   EXPECT_EQ(readAckFrame.ackBlocks[3].startPacket, 944);
 }
 
+TEST_F(DecodeTest, AckFrameManyBlocksChained) {
+  // Enough blocks of every encoding length that some of them straddle the
+  // boundaries of the chained buffers below.
+  std::vector<NormalizedAckBlock> ackBlocks;
+  std::vector<uint64_t> values = {0, 1, 100, 20000};
+  for (size_t i = 0; i < 64; ++i) {
+    ackBlocks.emplace_back(
+        QuicInteger(values[i % values.size()]),
+        QuicInteger(values[(i / values.size()) % values.size()]));
+  }
+  auto frame = createAckFrame(
+      QuicInteger(kFourByteLimit),
+      QuicInteger(100),
+      QuicInteger(ackBlocks.size()),
+      QuicInteger(10),
+      ackBlocks);
+  folly::io::Cursor contiguousCursor(frame.get());
+  auto expected = decodeAckFrame(
+      contiguousCursor,
+      makeHeader(),
+      CodecParameters(kDefaultAckDelayExponent, QuicVersion::MVFST));
+  ASSERT_EQ(ackBlocks.size() + 1, expected.ackBlocks.size());
+
+  PacketNum currentPacketNum = kFourByteLimit - 10;
+  for (size_t i = 0; i < ackBlocks.size(); ++i) {
+    auto endPacket = currentPacketNum - ackBlocks[i].gap.getValue() - 2;
+    currentPacketNum = endPacket - ackBlocks[i].blockLen.getValue();
+    EXPECT_EQ(endPacket, expected.ackBlocks[i + 1].endPacket);
+    EXPECT_EQ(currentPacketNum, expected.ackBlocks[i + 1].startPacket);
+  }
+
+  for (size_t chunkLen : {1, 7, 13, 50}) {
+    BufQueue queue(frame->clone());
+    Buf chained = queue.splitAtMost(chunkLen);
+    while (!queue.empty()) {
+      chained->prependChain(queue.splitAtMost(chunkLen));
+    }
+    folly::io::Cursor cursor(chained.get());
+    auto ackFrame = decodeAckFrame(
+        cursor,
+        makeHeader(),
+        CodecParameters(kDefaultAckDelayExponent, QuicVersion::MVFST));
+    EXPECT_TRUE(cursor.isAtEnd());
+    ASSERT_EQ(expected.ackBlocks.size(), ackFrame.ackBlocks.size());
+    for (size_t i = 0; i < ackFrame.ackBlocks.size(); ++i) {
+      EXPECT_EQ(
+          expected.ackBlocks[i].startPacket, ackFrame.ackBlocks[i].startPacket);
+      EXPECT_EQ(
+          expected.ackBlocks[i].endPacket, ackFrame.ackBlocks[i].endPacket);
+    }
+  }
+}
+
 TEST_F(DecodeTest, StreamDecodeSuccess) {
   QuicInteger streamId(10);
   QuicInteger offset(10);
@@ -737,5 +866,180 @@ TEST_F(DecodeTest, DecodeExpiredStreamDataFrame) {
   EXPECT_EQ(result.minimumStreamOffset, 100);
 }
 
+std::unique_ptr<folly::IOBuf> createAckFrequencyFrame(
+    QuicInteger sequenceNumber,
+    QuicInteger packetTolerance,
+    QuicInteger updateMaxAckDelay,
+    folly::Optional<uint8_t> ignoreOrder) {
+  std::unique_ptr<folly::IOBuf> buf = folly::IOBuf::create(0);
+  BufAppender wcursor(buf.get(), 20);
+  auto appenderOp = [&](auto val) { wcursor.writeBE(val); };
+  sequenceNumber.encode(appenderOp);
+  packetTolerance.encode(appenderOp);
+  updateMaxAckDelay.encode(appenderOp);
+  if (ignoreOrder) {
+    wcursor.writeBE(*ignoreOrder);
+  }
+  return buf;
+}
+
+TEST_F(DecodeTest, DecodeAckFrequencyFrame) {
+  auto frameBuf = createAckFrequencyFrame(
+      QuicInteger(1), QuicInteger(10), QuicInteger(25000), uint8_t(1));
+  folly::io::Cursor cursor(frameBuf.get());
+  auto result = decodeAckFrequencyFrame(cursor);
+  EXPECT_EQ(result.sequenceNumber, 1);
+  EXPECT_EQ(result.packetTolerance, 10);
+  EXPECT_EQ(result.updateMaxAckDelay, 25000us);
+  EXPECT_TRUE(result.ignoreOrder);
+  EXPECT_TRUE(cursor.isAtEnd());
+}
+
+TEST_F(DecodeTest, DecodeAckFrequencyFrameInvalid) {
+  auto noIgnoreOrder = createAckFrequencyFrame(
+      QuicInteger(1), QuicInteger(10), QuicInteger(25000), folly::none);
+  folly::io::Cursor cursor0(noIgnoreOrder.get());
+  EXPECT_THROW(decodeAckFrequencyFrame(cursor0), QuicTransportException);
+
+  auto badIgnoreOrder = createAckFrequencyFrame(
+      QuicInteger(1), QuicInteger(10), QuicInteger(25000), uint8_t(2));
+  folly::io::Cursor cursor1(badIgnoreOrder.get());
+  EXPECT_THROW(decodeAckFrequencyFrame(cursor1), QuicTransportException);
+
+  auto zeroTolerance = createAckFrequencyFrame(
+      QuicInteger(1), QuicInteger(0), QuicInteger(25000), uint8_t(0));
+  folly::io::Cursor cursor2(zeroTolerance.get());
+  EXPECT_THROW(decodeAckFrequencyFrame(cursor2), QuicTransportException);
+}
+
+std::unique_ptr<folly::IOBuf> createRepairFrame(
+    QuicInteger firstPacketNum,
+    uint64_t packetMask,
+    QuicInteger symbolLength,
+    std::unique_ptr<folly::IOBuf> symbol) {
+  std::unique_ptr<folly::IOBuf> buf = folly::IOBuf::create(0);
+  BufAppender wcursor(buf.get(), 20);
+  auto appenderOp = [&](auto val) { wcursor.writeBE(val); };
+  firstPacketNum.encode(appenderOp);
+  wcursor.writeBE(packetMask);
+  symbolLength.encode(appenderOp);
+  buf->prependChain(std::move(symbol));
+  return buf;
+}
+
+TEST_F(DecodeTest, DecodeRepairFrame) {
+  auto frameBuf = createRepairFrame(
+      QuicInteger(10),
+      0b101,
+      QuicInteger(5),
+      folly::IOBuf::copyBuffer("hello"));
+  folly::io::Cursor cursor(frameBuf.get());
+  auto result = decodeRepairFrame(cursor);
+  EXPECT_EQ(result.firstPacketNum, 10);
+  EXPECT_EQ(result.packetMask, 0b101);
+  EXPECT_TRUE(folly::IOBufEqualTo()(
+      *result.symbol, *folly::IOBuf::copyBuffer("hello")));
+  EXPECT_TRUE(cursor.isAtEnd());
+}
+
+TEST_F(DecodeTest, DecodeRepairFrameInvalid) {
+  auto noPackets = createRepairFrame(
+      QuicInteger(10), 0, QuicInteger(5), folly::IOBuf::copyBuffer("hello"));
+  folly::io::Cursor cursor0(noPackets.get());
+  EXPECT_THROW(decodeRepairFrame(cursor0), QuicTransportException);
+
+  auto badLength = createRepairFrame(
+      QuicInteger(10), 1, QuicInteger(6), folly::IOBuf::copyBuffer("hello"));
+  folly::io::Cursor cursor1(badLength.get());
+  EXPECT_THROW(decodeRepairFrame(cursor1), QuicTransportException);
+}
+
+std::unique_ptr<folly::IOBuf> createDatagramFrame(
+    folly::Optional<QuicInteger> length,
+    std::unique_ptr<folly::IOBuf> data) {
+  std::unique_ptr<folly::IOBuf> buf = folly::IOBuf::create(0);
+  BufAppender wcursor(buf.get(), 20);
+  auto appenderOp = [&](auto val) { wcursor.writeBE(val); };
+  if (length) {
+    length->encode(appenderOp);
+  }
+  if (data) {
+    buf->prependChain(std::move(data));
+  }
+  return buf;
+}
+
+TEST_F(DecodeTest, DecodeDatagramFrame) {
+  BufQueue queue(createDatagramFrame(
+      QuicInteger(5), folly::IOBuf::copyBuffer("helloworld")));
+  auto frame = decodeDatagramFrame(queue, true /* hasLen */);
+  EXPECT_EQ(frame.length, 5);
+  EXPECT_TRUE(folly::IOBufEqualTo()(
+      *frame.data, *folly::IOBuf::copyBuffer("hello")));
+  // The rest of the packet is left for the next frame.
+  EXPECT_EQ(queue.chainLength(), 5);
+}
+
+TEST_F(DecodeTest, DecodeDatagramFrameNoLength) {
+  BufQueue queue(
+      createDatagramFrame(folly::none, folly::IOBuf::copyBuffer("hello")));
+  auto frame = decodeDatagramFrame(queue, false /* hasLen */);
+  EXPECT_EQ(frame.length, 5);
+  EXPECT_TRUE(folly::IOBufEqualTo()(
+      *frame.data, *folly::IOBuf::copyBuffer("hello")));
+  EXPECT_TRUE(queue.empty());
+
+  BufQueue emptyQueue;
+  EXPECT_EQ(decodeDatagramFrame(emptyQueue, false /* hasLen */).length, 0);
+}
+
+TEST_F(DecodeTest, DecodeDatagramFrameInvalidLength) {
+  BufQueue queue(createDatagramFrame(
+      QuicInteger(10), folly::IOBuf::copyBuffer("hello")));
+  EXPECT_THROW(
+      decodeDatagramFrame(queue, true /* hasLen */), QuicTransportException);
+
+  BufQueue emptyQueue;
+  EXPECT_THROW(
+      decodeDatagramFrame(emptyQueue, true /* hasLen */),
+      QuicTransportException);
+}
+
+TEST_F(DecodeTest, HandshakePacketFrames) {
+  CodecParameters params(kDefaultAckDelayExponent, QuicVersion::MVFST);
+  auto makeHeader = [](LongHeader::Types type) {
+    return LongHeader(
+        type,
+        getTestConnectionId(0),
+        getTestConnectionId(1),
+        1,
+        QuicVersion::MVFST);
+  };
+  // PING then MAX_DATA.
+  std::string frames("\x01\x10\x01", 3);
+  EXPECT_THROW(
+      decodeRegularPacket(
+          makeHeader(LongHeader::Types::Initial),
+          params,
+          folly::IOBuf::copyBuffer(frames)),
+      QuicTransportException);
+  EXPECT_THROW(
+      decodeRegularPacket(
+          makeHeader(LongHeader::Types::Handshake),
+          params,
+          folly::IOBuf::copyBuffer(frames)),
+      QuicTransportException);
+  auto packet = decodeRegularPacket(
+      makeHeader(LongHeader::Types::ZeroRtt),
+      params,
+      folly::IOBuf::copyBuffer(frames));
+  EXPECT_EQ(2, packet.frames.size());
+  auto pingPacket = decodeRegularPacket(
+      makeHeader(LongHeader::Types::Initial),
+      params,
+      folly::IOBuf::copyBuffer(frames.substr(0, 1)));
+  EXPECT_EQ(1, pingPacket.frames.size());
+}
+
 } // namespace test
 } // namespace quic
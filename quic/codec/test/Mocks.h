@@ -111,6 +111,8 @@ class MockQuicPacketBuilder : public PacketBuilderInterface {
     CHECK(false) << "Use buildTestPacket()";
   }
 
+  void releaseOutputBuffer() && override {}
+
   std::pair<RegularQuicWritePacket, Buf> buildTestPacket() && {
     ShortHeader header(
         ProtectionType::KeyPhaseZero, getTestConnectionId(), 0x01);
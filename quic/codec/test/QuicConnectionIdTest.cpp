@@ -38,6 +38,18 @@ TEST(ConnectionIdTest, TestZeroLenConnid) {
   EXPECT_EQ(static_cast<size_t>(connid.size()), out.size());
 }
 
+TEST(ConnectionIdTest, FromPointer) {
+  std::string out = folly::unhexlify("ffaabbee00");
+  ConnectionId connid(reinterpret_cast<const uint8_t*>(out.data()), 4);
+  EXPECT_EQ(4, connid.size());
+  EXPECT_EQ(connid.hex(), "ffaabbee");
+  ConnectionId empty(nullptr, 0);
+  EXPECT_EQ(0, empty.size());
+  std::vector<uint8_t> tooLong(kMaxConnectionIdSize + 1);
+  EXPECT_THROW(
+      ConnectionId(tooLong.data(), tooLong.size()), std::runtime_error);
+}
+
 TEST(ConnectionIdTest, CompareConnId) {
   ConnectionId connid1(std::vector<uint8_t>{});
   ConnectionId connid2(std::vector<uint8_t>{});
@@ -52,6 +64,29 @@ TEST(ConnectionIdTest, CompareConnId) {
   EXPECT_EQ(connid4, connid3);
 }
 
+TEST(ConnectionIdTest, CompareConnIdOfDifferentLength) {
+  ConnectionId connid1(std::vector<uint8_t>{0x00, 0x01, 0x02, 0x03});
+  ConnectionId connid2(std::vector<uint8_t>{0x00, 0x01, 0x02, 0x03, 0x00});
+  EXPECT_NE(connid1, connid2);
+}
+
+TEST(ConnectionIdTest, HashConnId) {
+  ConnectionId connid1(std::vector<uint8_t>{0x00, 0x01, 0x02, 0x03});
+  ConnectionId connid2(std::vector<uint8_t>{0x00, 0x01, 0x02, 0x03});
+  EXPECT_EQ(ConnectionIdHash()(connid1), ConnectionIdHash()(connid2));
+  EXPECT_EQ(
+      ConnectionIdHash()(connid1),
+      folly::hash::fnv32_buf(connid1.data(), connid1.size()));
+
+  // Changed through data(), it hashes again.
+  auto copy = connid1;
+  copy.data()[0] = 0xff;
+  EXPECT_EQ(
+      ConnectionIdHash()(copy),
+      folly::hash::fnv32_buf(copy.data(), copy.size()));
+  EXPECT_NE(ConnectionIdHash()(copy), ConnectionIdHash()(connid1));
+}
+
 TEST(ConnectionIdTest, ConnIdSize) {
   std::vector<uint8_t> testconnid;
   for (size_t i = 0; i < kMaxConnectionIdSize + 2; ++i) {
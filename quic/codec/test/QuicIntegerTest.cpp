@@ -72,6 +72,19 @@ TEST_P(QuicIntegerDecodeTest, DecodeAtMost) {
   }
 }
 
+TEST_P(QuicIntegerDecodeTest, DecodeUnchecked) {
+  if (GetParam().error) {
+    return;
+  }
+  // Trailing bytes past the integer must not change the result.
+  std::string encodedBytes =
+      folly::unhexlify(GetParam().hexEncoded) + std::string(8, '\xff');
+  auto decodedValue = decodeQuicIntegerUnchecked(
+      reinterpret_cast<const uint8_t*>(encodedBytes.data()));
+  EXPECT_EQ(decodedValue.first, GetParam().decoded);
+  EXPECT_EQ(decodedValue.second, GetParam().encodedLength);
+}
+
 TEST_P(QuicIntegerEncodeTest, Encode) {
   auto queue = folly::IOBuf::create(0);
   BufAppender appender(queue.get(), 10);
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <folly/portability/GTest.h>
+#include <quic/codec/DefaultConnectionIdAlgo.h>
+#include <quic/codec/QuicLbConnectionIdAlgo.h>
+
+namespace quic {
+namespace test {
+
+namespace {
+const std::array<uint8_t, kQuicLbKeyLength> kKey = {
+    0x8f, 0x95, 0xf0, 0x92, 0x45, 0x76, 0x5f, 0x80,
+    0x25, 0x6d, 0x9e, 0x81, 0x73, 0x1b, 0x9c, 0x4e};
+} // namespace
+
+TEST(QuicLbConnectionIdAlgoTest, EncodeDecode) {
+  QuicLbConnectionIdAlgo algo(1, folly::range(kKey));
+  for (uint16_t hostId : {0, 1, 0x1234, 0xffff}) {
+    for (uint8_t workerId : {0, 7, 255}) {
+      for (uint8_t processId : {0, 1}) {
+        ServerConnectionIdParams params(hostId, processId, workerId);
+        auto connId = algo.encodeConnectionId(params);
+        ASSERT_FALSE(connId.hasError());
+        EXPECT_EQ(kDefaultConnectionIdSize, connId->size());
+        EXPECT_TRUE(algo.canParse(*connId));
+        auto parsed = algo.parseConnectionId(*connId);
+        ASSERT_FALSE(parsed.hasError());
+        EXPECT_EQ(params, *parsed);
+      }
+    }
+  }
+}
+
+TEST(QuicLbConnectionIdAlgoTest, ServerIdIsNotInClear) {
+  QuicLbConnectionIdAlgo algo(0, folly::range(kKey));
+  ServerConnectionIdParams params(0x1234, 0, 5);
+  auto first = *algo.encodeConnectionId(params);
+  auto second = *algo.encodeConnectionId(params);
+  // Only the first octet stays the same between ids of the same worker.
+  EXPECT_EQ(first.data()[0], second.data()[0]);
+  EXPECT_NE(first, second);
+  EXPECT_NE(
+      0,
+      memcmp(
+          first.data() + 1, second.data() + 1, kDefaultConnectionIdSize - 1));
+  // Decrypting with the wrong key gives another server id.
+  std::array<uint8_t, kQuicLbKeyLength> otherKey = kKey;
+  otherKey[0] ^= 0xff;
+  QuicLbConnectionIdAlgo other(0, folly::range(otherKey));
+  ASSERT_TRUE(other.canParse(first));
+  EXPECT_NE(params, *other.parseConnectionId(first));
+}
+
+TEST(QuicLbConnectionIdAlgoTest, CanParse) {
+  QuicLbConnectionIdAlgo algo(2, folly::range(kKey));
+  QuicLbConnectionIdAlgo otherConfig(3, folly::range(kKey));
+  ServerConnectionIdParams params(1, 0, 1);
+  auto connId = *algo.encodeConnectionId(params);
+  EXPECT_EQ(0x47, connId.data()[0]);
+  EXPECT_FALSE(otherConfig.canParse(connId));
+  EXPECT_TRUE(otherConfig.parseConnectionId(connId).hasError());
+
+  auto defaultConnId = *DefaultConnectionIdAlgo().encodeConnectionId(params);
+  EXPECT_FALSE(algo.canParse(defaultConnId));
+  EXPECT_FALSE(algo.canParse(ConnectionId(std::vector<uint8_t>{0x47, 1})));
+}
+
+TEST(QuicLbConnectionIdAlgoTest, InvalidConfig) {
+  EXPECT_THROW(
+      QuicLbConnectionIdAlgo(kQuicLbMaxConfigId + 1, folly::range(kKey)),
+      std::runtime_error);
+  std::array<uint8_t, 8> shortKey{};
+  EXPECT_THROW(
+      QuicLbConnectionIdAlgo(0, folly::range(shortKey)), std::runtime_error);
+}
+
+TEST(QuicLbConnectionIdAlgoTest, Factory) {
+  QuicLbConnectionIdAlgoFactory factory(1, folly::range(kKey));
+  auto encoder = factory.make();
+  auto decoder = factory.make();
+  ServerConnectionIdParams params(300, 1, 9);
+  auto connId = *encoder->encodeConnectionId(params);
+  EXPECT_EQ(params, *decoder->parseConnectionId(connId));
+}
+} // namespace test
+} // namespace quic
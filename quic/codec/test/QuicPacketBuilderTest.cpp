@@ -24,14 +24,15 @@ using namespace testing;
 enum TestFlavor { Regular, Inplace };
 
 struct BuilderWithBuffer {
+  // The accessor has to outlive the builder that borrows from it.
+  std::unique_ptr<BufAccessor> bufAccessor;
   std::unique_ptr<PacketBuilderInterface> builder;
-  Buf buf;
 
   BuilderWithBuffer() = default;
   explicit BuilderWithBuffer(
       std::unique_ptr<PacketBuilderInterface> builderIn,
-      Buf bufIn)
-      : builder(std::move(builderIn)), buf(std::move(bufIn)) {}
+      std::unique_ptr<BufAccessor> bufAccessorIn)
+      : bufAccessor(std::move(bufAccessorIn)), builder(std::move(builderIn)) {}
 };
 
 BuilderWithBuffer testBuilderProvider(
@@ -48,14 +49,10 @@ BuilderWithBuffer testBuilderProvider(
           nullptr);
 
     case TestFlavor::Inplace:
-      auto outputBuf = folly::IOBuf::create(*outputBufSize);
-      return BuilderWithBuffer(
-          std::make_unique<InplaceQuicPacketBuilder>(
-              *outputBuf,
-              pktSizeLimit,
-              std::move(header),
-              largestAckedPacketNum),
-          std::move(outputBuf));
+      auto bufAccessor = std::make_unique<SimpleBufAccessor>(*outputBufSize);
+      auto builder = std::make_unique<InplaceQuicPacketBuilder>(
+          *bufAccessor, pktSizeLimit, std::move(header), largestAckedPacketNum);
+      return BuilderWithBuffer(std::move(builder), std::move(bufAccessor));
   }
   folly::assume_unreachable();
 }
@@ -149,6 +146,62 @@ TEST_F(QuicPacketBuilderTest, SimpleVersionNegotiationPacket) {
   EXPECT_EQ(decodedVersionNegotiationPacket->versions, versions);
 }
 
+TEST_F(QuicPacketBuilderTest, VersionNegotiationFromTemplate) {
+  auto versions = versionList({1, 2, 3, 4, 5, 6, 7});
+  ConnectionId empty(std::vector<uint8_t>{});
+  auto tmpl =
+      VersionNegotiationPacketBuilder(empty, empty, versions).buildPacket();
+
+  auto srcConnId = getTestConnectionId(0), destConnId = getTestConnectionId(1);
+  auto patched = VersionNegotiationPacketBuilder::patchConnectionIds(
+      *tmpl.second, srcConnId, destConnId);
+  auto expected =
+      VersionNegotiationPacketBuilder(srcConnId, destConnId, versions)
+          .buildPacket();
+  EXPECT_TRUE(folly::IOBufEqualTo()(*expected.second, *patched));
+}
+
+TEST_F(QuicPacketBuilderTest, RetryPacket) {
+  auto srcConnId = getTestConnectionId(0), destConnId = getTestConnectionId(1);
+  auto originalDestConnId = getTestConnectionId(2);
+  std::string token = "retry token";
+  RetryPacketBuilder builder(
+      QuicVersion::MVFST,
+      srcConnId,
+      destConnId,
+      folly::ByteRange(folly::StringPiece(token)));
+  auto retryAead = FizzCryptoFactory().makeRetryAead();
+  auto packetQueue = bufToQueue(
+      std::move(builder).buildPacket(*retryAead, originalDestConnId));
+  AckStates ackStates;
+  auto parsedPacket = makeCodec(destConnId, QuicNodeType::Client)
+                          ->parsePacket(packetQueue, ackStates);
+  auto retryPacket = parsedPacket.retryPacket();
+  ASSERT_NE(retryPacket, nullptr);
+  EXPECT_EQ(retryPacket->header.getVersion(), QuicVersion::MVFST);
+  EXPECT_EQ(retryPacket->header.getSourceConnId(), srcConnId);
+  EXPECT_EQ(retryPacket->header.getDestinationConnId(), destConnId);
+  EXPECT_EQ(retryPacket->header.getToken(), token);
+
+  // The tag covers the packet and the original destination connection id.
+  folly::IOBuf pseudoRetryPacket;
+  BufAppender appender(&pseudoRetryPacket, 100);
+  appender.writeBE<uint8_t>(originalDestConnId.size());
+  appender.push(originalDestConnId.data(), originalDestConnId.size());
+  appender.writeBE<uint8_t>(retryPacket->initialByte);
+  appender.writeBE<QuicVersionType>(
+      static_cast<QuicVersionType>(QuicVersion::MVFST));
+  appender.writeBE<uint8_t>(destConnId.size());
+  appender.push(destConnId.data(), destConnId.size());
+  appender.writeBE<uint8_t>(srcConnId.size());
+  appender.push(srcConnId.data(), srcConnId.size());
+  appender.push((const uint8_t*)token.data(), token.size());
+  auto expectedIntegrityTag = retryAead->encrypt(
+      std::make_unique<folly::IOBuf>(), &pseudoRetryPacket, 0);
+  EXPECT_TRUE(folly::IOBufEqualTo()(
+      *expectedIntegrityTag, *retryPacket->integrityTag));
+}
+
 TEST_F(QuicPacketBuilderTest, TooManyVersions) {
   std::vector<QuicVersion> versions;
   for (size_t i = 0; i < 1000; i++) {
@@ -208,7 +261,7 @@ TEST_P(QuicPacketBuilderTest, LongHeaderRegularPacket) {
         kDefaultUDPSendPacketLen * 2);
     PacketBuilderInterface* builder = builderAndBuf.builder.get();
     pinnedBuilderAndBuf.builder = std::move(builderAndBuf.builder);
-    pinnedBuilderAndBuf.buf = std::move(builderAndBuf.buf);
+    pinnedBuilderAndBuf.bufAccessor = std::move(builderAndBuf.bufAccessor);
     return builder;
   };
 
@@ -434,6 +487,117 @@ TEST_P(QuicPacketBuilderTest, ShortHeaderBytesCounting) {
       headerBytes);
 }
 
+TEST_F(QuicPacketBuilderTest, RegularBuilderWithArena) {
+  ConnectionId cid = getTestConnectionId();
+  PacketBufArena arena;
+  auto headerSlab = arena.allocate();
+  auto bodySlab = arena.allocate();
+  auto rawHeaderSlab = headerSlab.get();
+  auto rawBodySlab = bodySlab.get();
+  arena.recycle(std::move(bodySlab));
+  arena.recycle(std::move(headerSlab));
+  RegularQuicPacketBuilder builder(
+      kDefaultUDPSendPacketLen,
+      ShortHeader(ProtectionType::KeyPhaseZero, cid, 10),
+      0,
+      &arena);
+  EXPECT_EQ(0, arena.numCachedSlabs());
+  writeFrame(PingFrame(), builder);
+  auto packet = std::move(builder).buildPacket();
+  EXPECT_EQ(rawHeaderSlab, packet.header.get());
+  EXPECT_EQ(rawBodySlab, packet.body.get());
+}
+
+TEST_F(QuicPacketBuilderTest, InplaceBuilderReleaseBufferInBuild) {
+  PacketNum pktNum = 8 * 24;
+  ConnectionId cid = getTestConnectionId();
+  PacketNum largestAcked = 8 + 24;
+  SimpleBufAccessor bufAccessor(2000);
+  auto builder = std::make_unique<InplaceQuicPacketBuilder>(
+      bufAccessor,
+      1000,
+      ShortHeader(ProtectionType::KeyPhaseZero, cid, pktNum),
+      largestAcked);
+  EXPECT_FALSE(bufAccessor.ownsBuffer());
+  writeFrame(PingFrame(), *builder);
+  auto builtOut = std::move(*builder).buildPacket();
+  EXPECT_TRUE(bufAccessor.ownsBuffer());
+  auto buf = bufAccessor.obtain();
+  EXPECT_EQ(builtOut.header->length() + builtOut.body->length(), buf->length());
+  EXPECT_EQ(buf->data(), builtOut.header->data());
+  bufAccessor.release(std::move(buf));
+}
+
+TEST_F(QuicPacketBuilderTest, InplaceBuilderReleaseOutputBufferRollsBack) {
+  PacketNum pktNum = 8 * 24;
+  ConnectionId cid = getTestConnectionId();
+  PacketNum largestAcked = 8 + 24;
+  SimpleBufAccessor bufAccessor(2000);
+  auto buf = bufAccessor.obtain();
+  buf->append(20);
+  bufAccessor.release(std::move(buf));
+  auto builder = std::make_unique<InplaceQuicPacketBuilder>(
+      bufAccessor,
+      1000,
+      ShortHeader(ProtectionType::KeyPhaseZero, cid, pktNum),
+      largestAcked);
+  writeFrame(PingFrame(), *builder);
+  std::move(*builder).releaseOutputBuffer();
+  EXPECT_TRUE(bufAccessor.ownsBuffer());
+  buf = bufAccessor.obtain();
+  EXPECT_EQ(20, buf->length());
+  bufAccessor.release(std::move(buf));
+}
+
+TEST_F(QuicPacketBuilderTest, InplaceBuilderAppendsAfterPreviousPacket) {
+  ConnectionId cid = getTestConnectionId();
+  PacketNum largestAcked = 0;
+  SimpleBufAccessor bufAccessor(2000);
+  auto builder1 = std::make_unique<InplaceQuicPacketBuilder>(
+      bufAccessor,
+      1000,
+      ShortHeader(ProtectionType::KeyPhaseZero, cid, 1),
+      largestAcked);
+  writeFrame(PingFrame(), *builder1);
+  auto packet1 = std::move(*builder1).buildPacket();
+  auto builder2 = std::make_unique<InplaceQuicPacketBuilder>(
+      bufAccessor,
+      1000,
+      ShortHeader(ProtectionType::KeyPhaseZero, cid, 2),
+      largestAcked);
+  EXPECT_EQ(packet1.header->length(), builder2->getHeaderBytes());
+  writeFrame(PingFrame(), *builder2);
+  auto packet2 = std::move(*builder2).buildPacket();
+  EXPECT_EQ(packet1.body->tail(), packet2.header->data());
+  auto buf = bufAccessor.obtain();
+  EXPECT_EQ(
+      packet1.header->length() + packet1.body->length() +
+          packet2.header->length() + packet2.body->length(),
+      buf->length());
+  bufAccessor.release(std::move(buf));
+}
+
+TEST_F(QuicPacketBuilderTest, StatelessResetBuilderReusesBuffer) {
+  StatelessResetToken token;
+  token.fill(0xab);
+  auto buf = folly::IOBuf::create(kDefaultUDPSendPacketLen);
+  buf->append(10);
+  auto raw = buf->data();
+  auto packet =
+      StatelessResetPacketBuilder(100, token, std::move(buf)).buildPacket();
+  EXPECT_EQ(raw, packet->data());
+  ASSERT_EQ(100, packet->length());
+  EXPECT_FALSE(packet->isChained());
+  EXPECT_EQ(ShortHeader::kFixedBitMask, packet->data()[0]);
+  EXPECT_EQ(
+      0, memcmp(packet->tail() - token.size(), token.data(), token.size()));
+
+  packet =
+      StatelessResetPacketBuilder(50, token, std::move(packet)).buildPacket();
+  EXPECT_EQ(raw, packet->data());
+  EXPECT_EQ(50, packet->length());
+}
+
 INSTANTIATE_TEST_CASE_P(
     QuicPacketBuilderTests,
     QuicPacketBuilderTest,
@@ -226,6 +226,54 @@ TEST_F(QuicPacketRebuilderTest, RebuildAfterResetStream) {
   EXPECT_FALSE(rebuilder.rebuildFromPacket(outstanding).has_value());
 }
 
+TEST_F(QuicPacketRebuilderTest, RebuildAsIsFromSentPayload) {
+  ShortHeader shortHeader1(
+      ProtectionType::KeyPhaseZero, getTestConnectionId(), 0);
+  RegularQuicPacketBuilder regularBuilder1(
+      kDefaultUDPSendPacketLen, std::move(shortHeader1), 0 /* largestAcked */);
+  QuicServerConnectionState conn;
+  conn.transportSettings.sentPayloadCacheSize = 4;
+  conn.streamManager->setMaxLocalBidirectionalStreams(10);
+  auto stream = conn.streamManager->createNextBidirectionalStream().value();
+  auto streamId = stream->id;
+  auto buf = folly::IOBuf::copyBuffer("Sent once and again as it was.");
+  auto bufLen = buf->computeChainDataLength();
+  writeStreamFrameHeader(regularBuilder1, streamId, 0, bufLen, bufLen, false);
+  writeStreamFrameData(regularBuilder1, buf->clone(), bufLen);
+  auto packet1 = std::move(regularBuilder1).buildPacket();
+  stream->retransmissionBuffer.emplace(
+      std::piecewise_construct,
+      std::forward_as_tuple(0),
+      std::forward_as_tuple(
+          std::make_unique<StreamBuffer>(buf->clone(), 0, false)));
+  auto body1 = packet1.body->clone();
+  body1->coalesce();
+  addSentPayload(conn, 0, body1->clone());
+  conn.sentPayloads.front().second->unshare();
+
+  ShortHeader shortHeader2(
+      ProtectionType::KeyPhaseZero, getTestConnectionId(), 1);
+  RegularQuicPacketBuilder regularBuilder2(
+      kDefaultUDPSendPacketLen, std::move(shortHeader2), 0 /* largestAcked */);
+  PacketRebuilder rebuilder(regularBuilder2, conn);
+  auto outstanding = makeDummyOutstandingPacket(packet1.packet, 1000);
+  EXPECT_TRUE(rebuilder.rebuildFromPacket(outstanding).has_value());
+  // The kept body went in, rather than a copy of it.
+  EXPECT_TRUE(conn.sentPayloads.front().second->isSharedOne());
+  auto packet2 = std::move(regularBuilder2).buildPacket();
+  EXPECT_EQ(packet1.packet.frames.size(), packet2.packet.frames.size());
+  EXPECT_TRUE(folly::IOBufEqualTo()(*body1, *packet2.body));
+
+  // Once the data is acked, it is neither written as is nor rebuilt.
+  stream->retransmissionBuffer.clear();
+  ShortHeader shortHeader3(
+      ProtectionType::KeyPhaseZero, getTestConnectionId(), 2);
+  RegularQuicPacketBuilder regularBuilder3(
+      kDefaultUDPSendPacketLen, std::move(shortHeader3), 0 /* largestAcked */);
+  PacketRebuilder rebuilder3(regularBuilder3, conn);
+  EXPECT_FALSE(rebuilder3.rebuildFromPacket(outstanding).has_value());
+}
+
 TEST_F(QuicPacketRebuilderTest, FinOnlyStreamRebuild) {
   ShortHeader shortHeader1(
       ProtectionType::KeyPhaseZero, getTestConnectionId(), 0);
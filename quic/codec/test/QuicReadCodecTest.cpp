@@ -10,6 +10,7 @@
 #include <folly/io/Cursor.h>
 #include <folly/portability/GTest.h>
 #include <quic/QuicException.h>
+#include <quic/codec/QuicWriteCodec.h>
 #include <quic/common/test/TestUtils.h>
 #include <quic/fizz/handshake/FizzCryptoFactory.h>
 
@@ -215,6 +216,34 @@ TEST_F(QuicReadCodecTest, StreamWithShortHeader) {
   EXPECT_TRUE(parseSuccess(std::move(packet)));
 }
 
+TEST_F(QuicReadCodecTest, RecycleFrames) {
+  auto connId = getTestConnectionId();
+  auto codec = makeEncryptedCodec(connId, createNoOpAead());
+  AckStates ackStates;
+  auto parseManyFrames = [&](PacketNum packetNum) {
+    ShortHeader header(ProtectionType::KeyPhaseZero, connId, packetNum);
+    RegularQuicPacketBuilder builder(
+        kDefaultUDPSendPacketLen, std::move(header), 0 /* largestAcked */);
+    builder.setCipherOverhead(0);
+    for (StreamId id = 0; id < 40; id += 4) {
+      writeFrame(MaxStreamDataFrame(id, 1000), builder);
+    }
+    auto packetQueue =
+        bufToQueue(packetToBuf(std::move(builder).buildPacket()));
+    auto result = codec->parsePacket(packetQueue, ackStates);
+    auto regularPacket = result.regularPacket();
+    CHECK(regularPacket);
+    EXPECT_EQ(10, regularPacket->frames.size());
+    auto frames = std::move(regularPacket->frames);
+    auto storage = frames.data();
+    codec->recycleFrames(std::move(frames));
+    return storage;
+  };
+  auto storage = parseManyFrames(1);
+  // The second packet decodes into the storage of the first.
+  EXPECT_EQ(storage, parseManyFrames(2));
+}
+
 TEST_F(QuicReadCodecTest, StreamWithShortHeaderOnlyHeader) {
   auto connId = getTestConnectionId();
   PacketNum packetNum = 12321;
@@ -351,6 +380,45 @@ TEST_F(QuicReadCodecTest, KeyPhaseOnePacket) {
   EXPECT_FALSE(parseSuccess(std::move(packet)));
 }
 
+TEST_F(QuicReadCodecTest, KeyUpdate) {
+  auto connId = getTestConnectionId();
+  auto codec = makeEncryptedCodec(connId, createNoOpAead());
+  auto parse = [&](PacketNum packetNum, ProtectionType keyPhase) {
+    auto data = folly::IOBuf::copyBuffer("hello");
+    auto streamPacket = createStreamPacket(
+        connId,
+        connId,
+        packetNum,
+        2 /* streamId */,
+        *data,
+        0 /* cipherOverhead */,
+        0 /* largestAcked */,
+        folly::none,
+        true,
+        keyPhase);
+    AckStates ackStates;
+    auto packetQueue = bufToQueue(packetToBuf(streamPacket));
+    return parseSuccess(codec->parsePacket(packetQueue, ackStates));
+  };
+
+  EXPECT_TRUE(parse(10, ProtectionType::KeyPhaseZero));
+  EXPECT_FALSE(parse(12, ProtectionType::KeyPhaseOne));
+  EXPECT_EQ(0, codec->getOneRttReadKeyGeneration());
+
+  codec->setNextOneRttReadCipher(createNoOpAead());
+  EXPECT_TRUE(parse(12, ProtectionType::KeyPhaseOne));
+  EXPECT_EQ(1, codec->getOneRttReadKeyGeneration());
+  EXPECT_EQ(nullptr, codec->getNextOneRttReadCipher());
+  EXPECT_TRUE(parse(13, ProtectionType::KeyPhaseOne));
+  // Reordered from before the key update.
+  EXPECT_TRUE(parse(11, ProtectionType::KeyPhaseZero));
+  // Past it, key phase zero would be the next key update.
+  EXPECT_FALSE(parse(14, ProtectionType::KeyPhaseZero));
+  codec->setNextOneRttReadCipher(createNoOpAead());
+  EXPECT_TRUE(parse(14, ProtectionType::KeyPhaseZero));
+  EXPECT_EQ(2, codec->getOneRttReadKeyGeneration());
+}
+
 TEST_F(QuicReadCodecTest, FailToDecryptLeadsToReset) {
   auto connId = getTestConnectionId();
   auto aead = std::make_unique<MockAead>();
@@ -691,6 +691,87 @@ TEST_F(QuicWriteCodecTest, WriteSimpleAckFrame) {
   EXPECT_EQ(decodedAckFrame.ackBlocks[1].endPacket, 400);
 }
 
+TEST_F(QuicWriteCodecTest, WriteAckEcnFrame) {
+  MockQuicPacketBuilder pktBuilder;
+  setupCommonExpects(pktBuilder);
+  auto ackDelay = 111us;
+  AckBlocks ackBlocks = {{501, 1000}, {101, 400}};
+  EcnCounts ecnCounts;
+  ecnCounts.ect0 = 100;
+  ecnCounts.ce = 2;
+  AckFrameMetaData meta(ackBlocks, ackDelay, kDefaultAckDelayExponent);
+  meta.ecnCounts = &ecnCounts;
+
+  // 11 bytes as in WriteSimpleAckFrame, plus 2 bytes for ECT(0), 1 byte for
+  // ECT(1) and 1 byte for CE => 15 bytes
+  auto result = *writeAckFrame(meta, pktBuilder);
+
+  EXPECT_EQ(15, result.bytesWritten);
+  EXPECT_EQ(kDefaultUDPSendPacketLen - 15, pktBuilder.remainingSpaceInPkt());
+  auto builtOut = std::move(pktBuilder).buildTestPacket();
+  auto regularPacket = builtOut.first;
+  WriteAckFrame& ackFrame = *regularPacket.frames.back().asWriteAckFrame();
+  EXPECT_TRUE(ackFrame.ecn);
+
+  auto wireBuf = std::move(builtOut.second);
+  BufQueue queue;
+  queue.append(wireBuf->clone());
+  QuicFrame decodedFrame = parseQuicFrame(queue);
+  auto& decodedAckFrame = *decodedFrame.asReadAckFrame();
+  EXPECT_EQ(decodedAckFrame.largestAcked, 1000);
+  EXPECT_EQ(decodedAckFrame.ackBlocks.size(), 2);
+  ASSERT_TRUE(decodedAckFrame.ecnCounts.has_value());
+  EXPECT_EQ(decodedAckFrame.ecnCounts->ect0, 100);
+  EXPECT_EQ(decodedAckFrame.ecnCounts->ect1, 0);
+  EXPECT_EQ(decodedAckFrame.ecnCounts->ce, 2);
+}
+
+TEST_F(QuicWriteCodecTest, WriteAckFrameWithEncoding) {
+  AckBlocks ackBlocks = {{501, 1000}, {101, 400}, {10, 20}};
+  AckBlocksEncoding encoding;
+  auto writeAndDecode = [&](std::chrono::microseconds ackDelay) {
+    MockQuicPacketBuilder pktBuilder;
+    setupCommonExpects(pktBuilder);
+    AckFrameMetaData meta(
+        ackBlocks, ackDelay, kDefaultAckDelayExponent, &encoding);
+    auto result = writeAckFrame(meta, pktBuilder);
+    EXPECT_TRUE(result.hasValue());
+    EXPECT_EQ(ackBlocks.size(), result->ackBlocksWritten);
+    auto builtOut = std::move(pktBuilder).buildTestPacket();
+    BufQueue queue;
+    queue.append(std::move(builtOut.second));
+    auto decodedFrame = parseQuicFrame(queue);
+    return *decodedFrame.asReadAckFrame();
+  };
+
+  auto decodedAckFrame = writeAndDecode(111us);
+  ASSERT_EQ(ackBlocks.version(), encoding.version);
+  EXPECT_EQ(2, encoding.blockEnds.size());
+  EXPECT_EQ(
+      decodedAckFrame.ackDelay.count(),
+      computeExpectedDelay(111us, kDefaultAckDelayExponent));
+
+  // Unchanged blocks reuse the encoding with the new ack delay.
+  auto encoded = encoding.encoded;
+  decodedAckFrame = writeAndDecode(2000us);
+  EXPECT_EQ(encoded, encoding.encoded);
+  EXPECT_EQ(
+      decodedAckFrame.ackDelay.count(),
+      computeExpectedDelay(2000us, kDefaultAckDelayExponent));
+  ASSERT_EQ(3, decodedAckFrame.ackBlocks.size());
+  EXPECT_EQ(10, decodedAckFrame.ackBlocks[2].startPacket);
+  EXPECT_EQ(20, decodedAckFrame.ackBlocks[2].endPacket);
+
+  // Withdrawing blocks invalidates it.
+  ackBlocks.withdraw({0, 20});
+  decodedAckFrame = writeAndDecode(111us);
+  EXPECT_EQ(ackBlocks.version(), encoding.version);
+  EXPECT_EQ(1, encoding.blockEnds.size());
+  ASSERT_EQ(2, decodedAckFrame.ackBlocks.size());
+  EXPECT_EQ(101, decodedAckFrame.ackBlocks[1].startPacket);
+  EXPECT_EQ(400, decodedAckFrame.ackBlocks[1].endPacket);
+}
+
 TEST_F(QuicWriteCodecTest, WriteAckFrameWillSaveAckDelay) {
   MockQuicPacketBuilder pktBuilder;
   setupCommonExpects(pktBuilder);
@@ -997,6 +1078,36 @@ TEST_F(QuicWriteCodecTest, NoSpaceForMaxData) {
   EXPECT_EQ(0, writeFrame(maxDataFrame, pktBuilder));
 }
 
+TEST_F(QuicWriteCodecTest, FixedShapeFrameSizes) {
+  static_assert(pingFrameSize() == 1, "");
+  static_assert(maxDataFrameSize(0) == 2, "");
+  static_assert(maxStreamDataFrameSize(0, 0) == 3, "");
+  EXPECT_EQ(1 + 8, maxDataFrameSize(kEightByteLimit));
+  EXPECT_EQ(1 + 2 + 4, maxStreamDataFrameSize(kTwoByteLimit, kFourByteLimit));
+
+  MockQuicPacketBuilder pktBuilder;
+  setupCommonExpects(pktBuilder);
+  StreamId id = 0x4000;
+  uint64_t maximumData = 0x40000000;
+  auto bytesWritten =
+      writeFrame(MaxStreamDataFrame(id, maximumData), pktBuilder);
+  EXPECT_EQ(maxStreamDataFrameSize(id, maximumData), bytesWritten);
+  bytesWritten += writeFrame(MaxDataFrame(maximumData), pktBuilder);
+
+  auto builtOut = std::move(pktBuilder).buildTestPacket();
+  auto wireBuf = std::move(builtOut.second);
+  EXPECT_EQ(bytesWritten, wireBuf->computeChainDataLength());
+  BufQueue queue;
+  queue.append(wireBuf->clone());
+  QuicFrame decodedFrame = parseQuicFrame(queue);
+  auto& wireMaxStreamDataFrame = *decodedFrame.asMaxStreamDataFrame();
+  EXPECT_EQ(id, wireMaxStreamDataFrame.streamId);
+  EXPECT_EQ(maximumData, wireMaxStreamDataFrame.maximumData);
+  decodedFrame = parseQuicFrame(queue);
+  EXPECT_EQ(maximumData, decodedFrame.asMaxDataFrame()->maximumData);
+  EXPECT_EQ(queue.chainLength(), 0);
+}
+
 TEST_F(QuicWriteCodecTest, WriteMaxStreamId) {
   for (uint64_t i = 0; i < 100; i++) {
     MockQuicPacketBuilder pktBuilder;
@@ -1408,6 +1519,56 @@ TEST_F(QuicWriteCodecTest, WriteRetireConnId) {
   EXPECT_EQ(queue.chainLength(), 0);
 }
 
+TEST_F(QuicWriteCodecTest, WriteAckFrequency) {
+  MockQuicPacketBuilder pktBuilder;
+  setupCommonExpects(pktBuilder);
+  AckFrequencyFrame ackFrequency(7, 10, 25000us, true);
+  auto bytesWritten = writeFrame(QuicSimpleFrame(ackFrequency), pktBuilder);
+
+  auto builtOut = std::move(pktBuilder).buildTestPacket();
+  auto regularPacket = builtOut.first;
+  // 2 byte type + sequence + tolerance + 4 byte delay + ignore order
+  EXPECT_EQ(bytesWritten, 9);
+  EXPECT_EQ(
+      *regularPacket.frames[0].asQuicSimpleFrame()->asAckFrequencyFrame(),
+      ackFrequency);
+
+  auto wireBuf = std::move(builtOut.second);
+  BufQueue queue;
+  queue.append(wireBuf->clone());
+  QuicFrame decodedFrame = parseQuicFrame(queue);
+  QuicSimpleFrame& simpleFrame = *decodedFrame.asQuicSimpleFrame();
+  EXPECT_EQ(*simpleFrame.asAckFrequencyFrame(), ackFrequency);
+  EXPECT_EQ(queue.chainLength(), 0);
+}
+
+TEST_F(QuicWriteCodecTest, WriteRepair) {
+  MockQuicPacketBuilder pktBuilder;
+  setupCommonExpects(pktBuilder);
+  RepairFrame repair(7, 0b11, folly::IOBuf::copyBuffer("hello"));
+  auto bytesWritten = writeFrame(QuicSimpleFrame(repair), pktBuilder);
+
+  auto builtOut = std::move(pktBuilder).buildTestPacket();
+  auto regularPacket = builtOut.first;
+  // 2 byte type + first packet + 8 byte mask + length + symbol
+  EXPECT_EQ(bytesWritten, 17);
+  // The symbol isn't kept with the packet.
+  const auto& written =
+      *regularPacket.frames[0].asQuicSimpleFrame()->asRepairFrame();
+  EXPECT_EQ(written, repair);
+  EXPECT_EQ(written.symbol, nullptr);
+
+  auto wireBuf = std::move(builtOut.second);
+  BufQueue queue;
+  queue.append(wireBuf->clone());
+  QuicFrame decodedFrame = parseQuicFrame(queue);
+  QuicSimpleFrame& simpleFrame = *decodedFrame.asQuicSimpleFrame();
+  const auto& decoded = *simpleFrame.asRepairFrame();
+  EXPECT_EQ(decoded, repair);
+  EXPECT_TRUE(folly::IOBufEqualTo()(*decoded.symbol, *repair.symbol));
+  EXPECT_EQ(queue.chainLength(), 0);
+}
+
 TEST_F(QuicWriteCodecTest, WriteStopSending) {
   MockQuicPacketBuilder pktBuilder;
   setupCommonExpects(pktBuilder);
@@ -1558,5 +1719,40 @@ TEST_F(QuicWriteCodecTest, WritePathResponse) {
   EXPECT_EQ(wirePathResponseFrame.pathData, pathData);
   EXPECT_EQ(queue.chainLength(), 0);
 }
+
+TEST_F(QuicWriteCodecTest, WriteDatagram) {
+  MockQuicPacketBuilder pktBuilder;
+  setupCommonExpects(pktBuilder);
+  auto data = folly::IOBuf::copyBuffer("datagram");
+  DatagramFrame datagramFrame(data->length(), data->clone());
+  auto bytesWritten = writeFrame(datagramFrame, pktBuilder);
+  // DATAGRAM_LEN type, length and payload.
+  EXPECT_EQ(bytesWritten, 1 + 1 + 8);
+
+  auto builtOut = std::move(pktBuilder).buildTestPacket();
+  auto regularPacket = builtOut.first;
+  auto& resultFrame = *regularPacket.frames[0].asDatagramFrame();
+  EXPECT_EQ(resultFrame.length, 8);
+  // The outstanding packet doesn't keep the payload.
+  EXPECT_EQ(resultFrame.data, nullptr);
+
+  auto wireBuf = std::move(builtOut.second);
+  BufQueue queue;
+  queue.append(wireBuf->clone());
+  QuicFrame decodedFrame = parseQuicFrame(queue);
+  auto& wireFrame = *decodedFrame.asDatagramFrame();
+  EXPECT_EQ(wireFrame.length, 8);
+  EXPECT_TRUE(folly::IOBufEqualTo()(*wireFrame.data, *data));
+  EXPECT_EQ(queue.chainLength(), 0);
+}
+
+TEST_F(QuicWriteCodecTest, NoSpaceForDatagram) {
+  MockQuicPacketBuilder pktBuilder;
+  pktBuilder.remaining_ = 9;
+  setupCommonExpects(pktBuilder);
+  auto data = folly::IOBuf::copyBuffer("datagram");
+  DatagramFrame datagramFrame(data->length(), std::move(data));
+  EXPECT_EQ(0, writeFrame(datagramFrame, pktBuilder));
+}
 } // namespace test
 } // namespace quic
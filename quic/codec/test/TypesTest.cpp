@@ -211,6 +211,20 @@ TEST_F(TypesTest, TestConnIdWorkerId) {
   EXPECT_FALSE(connIdAlgo->canParse(*connIdAlgo->encodeConnectionId(vParam)));
 }
 
+TEST_F(TypesTest, TestConnIdTryParse) {
+  auto connIdAlgo = std::make_unique<DefaultConnectionIdAlgo>();
+  for (uint8_t i = 0; i <= 254; i++) {
+    ServerConnectionIdParams params(
+        folly::Random::rand32() % 4095, i % 2, 254 - i);
+    auto connId = *connIdAlgo->encodeConnectionId(params);
+    EXPECT_EQ(
+        *connIdAlgo->parseConnectionId(connId),
+        *connIdAlgo->tryParseConnectionId(connId));
+  }
+  EXPECT_FALSE(
+      connIdAlgo->tryParseConnectionId(ConnectionId({1, 2, 3})).has_value());
+}
+
 TEST_F(TypesTest, ShortHeaderPacketNumberSpace) {
   ShortHeader shortHeaderZero(
       ProtectionType::KeyPhaseZero, ConnectionId({1, 3, 5, 7, 8}), 100);
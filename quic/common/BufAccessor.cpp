@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/common/BufAccessor.h>
+
+namespace quic {
+
+SimpleBufAccessor::SimpleBufAccessor(size_t capacity)
+    : buf_(folly::IOBuf::create(capacity)), capacity_(buf_->capacity()) {}
+
+Buf SimpleBufAccessor::obtain() {
+  CHECK(buf_) << "Buffer is already obtained";
+  return std::move(buf_);
+}
+
+void SimpleBufAccessor::release(Buf buf) {
+  CHECK(!buf_) << "Buffer is already owned by the accessor";
+  CHECK(buf && buf->capacity() == capacity_)
+      << "Released buffer is not the one that was obtained";
+  CHECK(!buf->isChained());
+  buf_ = std::move(buf);
+}
+
+bool SimpleBufAccessor::ownsBuffer() const {
+  return (buf_ != nullptr);
+}
+} // namespace quic
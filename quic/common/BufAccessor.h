@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/common/BufUtil.h>
+
+namespace quic {
+
+/**
+ * Hands out a single, preallocated write buffer. Only one user can hold the
+ * buffer at any time: obtain() transfers its ownership to the caller, and the
+ * caller has to give it back with release() before anyone else can obtain it.
+ */
+class BufAccessor {
+ public:
+  virtual ~BufAccessor() = default;
+
+  /**
+   * BufAccessor gives up the ownership of its buffer to the caller, and
+   * expects it back via release().
+   */
+  virtual Buf obtain() = 0;
+
+  /**
+   * Give the buffer back to the BufAccessor. The released buffer has to be
+   * the same one that was obtained.
+   */
+  virtual void release(Buf buf) = 0;
+
+  /**
+   * Whether the BufAccessor currently holds its buffer.
+   */
+  virtual bool ownsBuffer() const = 0;
+};
+
+class SimpleBufAccessor : public BufAccessor {
+ public:
+  explicit SimpleBufAccessor(size_t capacity);
+
+  ~SimpleBufAccessor() override = default;
+
+  Buf obtain() override;
+
+  void release(Buf buf) override;
+
+  bool ownsBuffer() const override;
+
+ private:
+  Buf buf_;
+  size_t capacity_;
+};
+} // namespace quic
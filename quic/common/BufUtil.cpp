@@ -2,6 +2,8 @@
 
 #include "quic/common/BufUtil.h"
 
+#include <folly/io/Cursor.h>
+
 namespace quic {
 
 Buf BufQueue::splitAtMost(size_t len) {
@@ -11,6 +13,12 @@ Buf BufQueue::splitAtMost(size_t len) {
     DCHECK_EQ(chainLength_, 0);
     return folly::IOBuf::create(0);
   }
+  if (len > 0 && len >= chainLength_) {
+    // Taking everything, which is what most stream frames do, doesn't need
+    // to find where the split is.
+    chainLength_ = 0;
+    return std::move(chain_);
+  }
   size_t remaining = len;
   while (remaining != 0) {
     if (current->length() < remaining) {
@@ -62,6 +70,12 @@ size_t BufQueue::trimStartAtMost(size_t amount) {
   if (current == nullptr || amount == 0) {
     return 0;
   }
+  if (amount >= chainLength_) {
+    auto trimmed = chainLength_;
+    chain_ = nullptr;
+    chainLength_ = 0;
+    return trimmed;
+  }
   while (amount > 0) {
     if (current->length() >= amount) {
       current->trimStart(amount);
@@ -115,6 +129,46 @@ void BufQueue::append(Buf&& buf) {
   appendToChain(chain_, std::move(buf));
 }
 
+void BufQueue::append(BufQueue&& other) {
+  if (&other == this) {
+    return;
+  }
+  auto otherLength = other.chainLength();
+  auto otherChain = other.move();
+  if (otherLength == 0) {
+    return;
+  }
+  chainLength_ += otherLength;
+  appendToChain(chain_, std::move(otherChain));
+}
+
+void BufQueue::append(Buf&& buf, size_t chunkSize) {
+  if (!buf || buf->empty()) {
+    return;
+  }
+  auto len = buf->computeChainDataLength();
+  if (len >= chunkSize) {
+    append(std::move(buf));
+    return;
+  }
+  chainLength_ += len;
+  folly::IOBuf* tail = chain_ ? chain_->prev() : nullptr;
+  folly::io::Cursor cursor(buf.get());
+  while (len > 0) {
+    // Anything split off the queue shares its buffer with what stays, so a
+    // shared tail must not be written to.
+    if (!tail || tail->isSharedOne() || tail->tailroom() == 0) {
+      auto chunk = folly::IOBuf::create(chunkSize);
+      tail = chunk.get();
+      appendToChain(chain_, std::move(chunk));
+    }
+    auto toCopy = std::min<size_t>(len, tail->tailroom());
+    cursor.pull(tail->writableTail(), toCopy);
+    tail->append(toCopy);
+    len -= toCopy;
+  }
+}
+
 void BufQueue::appendToChain(Buf& dst, Buf&& src) {
   if (dst == nullptr) {
     dst = std::move(src);
@@ -204,4 +258,20 @@ void BufWriter::backFill(const uint8_t* data, size_t len, size_t destOffset) {
   CHECK_LE(destOffset + len, iobuf_.length());
   memcpy(iobuf_.writableData() + destOffset, data, len);
 }
+
+void splitGROBuffer(Buf data, size_t segmentSize, std::vector<Buf>& packets) {
+  CHECK(!data->isChained());
+  if (segmentSize == 0 || data->length() <= segmentSize) {
+    packets.push_back(std::move(data));
+    return;
+  }
+  while (data->length() > segmentSize) {
+    auto packet = data->cloneOne();
+    packet->trimEnd(packet->length() - segmentSize);
+    data->trimStart(segmentSize);
+    packets.push_back(std::move(packet));
+  }
+  packets.push_back(std::move(data));
+}
+
 } // namespace quic
@@ -2,6 +2,7 @@
 
 #pragma once
 #include <folly/io/IOBuf.h>
+#include <vector>
 
 namespace quic {
 using Buf = std::unique_ptr<folly::IOBuf>;
@@ -58,6 +59,20 @@ class BufQueue {
 
   void append(Buf&& buf);
 
+  /**
+   * Moves the whole chain of other to the end of this queue. Unlike appending
+   * other.move(), this doesn't walk the chain to compute its length.
+   */
+  void append(BufQueue&& other);
+
+  /**
+   * Same as append, but a buf shorter than chunkSize is copied into the last
+   * buffer of the chain, or into a new chunkSize buffer when that one is full
+   * or shared. Many small appends then end up in a few buffers, so splitting
+   * the queue later clones far fewer IOBufs.
+   */
+  void append(Buf&& buf, size_t chunkSize);
+
  private:
   void appendToChain(Buf& dst, Buf&& src);
   Buf chain_;
@@ -134,4 +149,12 @@ class BufWriter {
   size_t appendCount_{0};
 };
 
+/**
+ * Splits a buffer filled by a single UDP GRO read back into the datagrams the
+ * kernel coalesced, and appends them to packets. Every datagram but the last
+ * one is exactly segmentSize bytes long. The resulting buffers share the
+ * memory of data. A segmentSize of 0 means data was not coalesced.
+ */
+void splitGROBuffer(Buf data, size_t segmentSize, std::vector<Buf>& packets);
+
 } // namespace quic
@@ -23,6 +23,11 @@ void FunctionLooper::setPacingTimer(
   pacingTimer_ = std::move(pacingTimer);
 }
 
+void FunctionLooper::setPacingScheduler(
+    PacingScheduler::SharedPtr pacingScheduler) noexcept {
+  pacingScheduler_ = std::move(pacingScheduler);
+}
+
 void FunctionLooper::setPacingFunction(
     folly::Function<std::chrono::microseconds()>&& pacingFunc) {
   pacingFunc_ = std::move(pacingFunc);
@@ -48,16 +53,26 @@ void FunctionLooper::commonLoopBody(bool fromTimer) noexcept {
 }
 
 bool FunctionLooper::schedulePacingTimeout(bool /* fromTimer */) noexcept {
-  if (pacingFunc_ && pacingTimer_ && !isScheduled()) {
+  if (pacingFunc_ && (pacingTimer_ || pacingScheduler_) &&
+      !isPacingScheduled()) {
     auto nextPacingTime = (*pacingFunc_)();
     if (nextPacingTime != 0us) {
-      pacingTimer_->scheduleTimeout(this, nextPacingTime);
+      if (pacingScheduler_) {
+        pacingScheduler_->scheduleTimeout(this, nextPacingTime);
+      } else {
+        pacingTimer_->scheduleTimeout(this, nextPacingTime);
+      }
       return true;
     }
   }
   return false;
 }
 
+void FunctionLooper::cancelPacing() noexcept {
+  cancelTimeout();
+  cancelPacingTimeout();
+}
+
 void FunctionLooper::runLoopCallback() noexcept {
   folly::DelayedDestruction::DestructorGuard dg(this);
   commonLoopBody(false);
@@ -68,12 +83,12 @@ void FunctionLooper::run(bool thisIteration) noexcept {
   running_ = true;
   // Caller can call run() in func_. But if we are in pacing mode, we should
   // prevent such loop.
-  if (pacingTimer_ && inLoopBody_) {
+  if ((pacingTimer_ || pacingScheduler_) && inLoopBody_) {
     VLOG(4) << __func__ << ": " << type_
             << " in loop body and using pacing - not rescheduling";
     return;
   }
-  if (isLoopCallbackScheduled() || isScheduled()) {
+  if (isLoopCallbackScheduled() || isPacingScheduled()) {
     VLOG(10) << __func__ << ": " << type_ << " already scheduled";
     return;
   }
@@ -84,7 +99,7 @@ void FunctionLooper::stop() noexcept {
   VLOG(10) << __func__ << ": " << type_;
   running_ = false;
   cancelLoopCallback();
-  cancelTimeout();
+  cancelPacing();
 }
 
 bool FunctionLooper::isRunning() const {
@@ -102,7 +117,7 @@ void FunctionLooper::detachEventBase() {
   VLOG(10) << __func__ << ": " << type_;
   DCHECK(evb_ && evb_->isInEventBaseThread());
   stop();
-  cancelTimeout();
+  cancelPacing();
   evb_ = nullptr;
 }
 
@@ -115,8 +130,20 @@ void FunctionLooper::callbackCanceled() noexcept {
   return;
 }
 
+void FunctionLooper::pacingTimeoutExpired() noexcept {
+  folly::DelayedDestruction::DestructorGuard dg(this);
+  commonLoopBody(true);
+}
+
+bool FunctionLooper::isPacingScheduled() const {
+  return isScheduled() || isPacingTimeoutScheduled();
+}
+
 folly::Optional<std::chrono::microseconds>
 FunctionLooper::getTimerTickInterval() noexcept {
+  if (pacingScheduler_) {
+    return pacingScheduler_->getTickInterval();
+  }
   if (pacingTimer_) {
     return pacingTimer_->getTickInterval();
   }
@@ -21,11 +21,31 @@ IntervalSet<T, Unit, Container>::IntervalSet(
 template <typename T, T Unit, template <typename... I> class Container>
 void IntervalSet<T, Unit, Container>::insert(
     const Interval<T, Unit>& interval) {
+  // Packets and stream data mostly arrive in order, so the interval usually
+  // lands after or on the last one, which doesn't need a search or a move.
+  if (container_type::empty() ||
+      interval.start >
+          container_type::back().end + interval_type::unitValue()) {
+    insertVersion_++;
+    version_++;
+    container_type::push_back(interval);
+    return;
+  }
+  auto& last = container_type::back();
+  if (interval.start >= last.start) {
+    if (interval.end > last.end) {
+      insertVersion_++;
+      version_++;
+      last.end = interval.end;
+    }
+    return;
+  }
   auto intersectionRange = intersectingRange(interval);
   auto firstIt = intersectionRange.first;
   auto endIt = intersectionRange.second;
   if (firstIt == endIt) {
     insertVersion_++;
+    version_++;
     container_type::insert(firstIt, std::move(interval));
     return;
   }
@@ -37,6 +57,7 @@ void IntervalSet<T, Unit, Container>::insert(
   auto newDifference = firstIt->end - firstIt->start;
   if (newDifference > originalDifference) {
     insertVersion_++;
+    version_++;
   }
   container_type::erase(std::next(firstIt), endIt);
 }
@@ -51,6 +72,7 @@ void IntervalSet<T, Unit, Container>::withdraw(
     // No intersection, doesn't need to do anything
     return;
   }
+  version_++;
   auto erasureStart = first;
   auto erasureEnd = end;
   auto last = std::prev(end);
@@ -114,4 +136,23 @@ template <typename T, T Unit, template <typename... I> class Container>
 uint64_t IntervalSet<T, Unit, Container>::insertVersion() const {
   return insertVersion_;
 }
+
+template <typename T, T Unit, template <typename... I> class Container>
+uint64_t IntervalSet<T, Unit, Container>::version() const {
+  return version_;
+}
+
+template <typename T, T Unit, template <typename... I> class Container>
+void IntervalSet<T, Unit, Container>::clear() {
+  if (!container_type::empty()) {
+    version_++;
+  }
+  container_type::clear();
+}
+
+template <typename T, T Unit, template <typename... I> class Container>
+void IntervalSet<T, Unit, Container>::pop_back() {
+  version_++;
+  container_type::pop_back();
+}
 } // namespace quic
@@ -81,15 +81,24 @@ class IntervalSet : private Container<Interval<T, Unit>> {
    */
   uint64_t insertVersion() const;
 
+  /**
+   * Unlike insertVersion(), this version changes whenever the set changes at
+   * all, including withdrawals. It can be used to tell whether anything
+   * derived from the set is stale.
+   */
+  uint64_t version() const;
+
+  void clear();
+
+  void pop_back();
+
   using container_type::back;
   using container_type::cbegin;
   using container_type::cend;
-  using container_type::clear;
   using container_type::crbegin;
   using container_type::crend;
   using container_type::empty;
   using container_type::front;
-  using container_type::pop_back;
   using container_type::size;
 
  private:
@@ -103,6 +112,7 @@ class IntervalSet : private Container<Interval<T, Unit>> {
   auto intersectingRange(const interval_type& interval) -> decltype(auto);
 
   uint64_t insertVersion_{kDefaultIntervalSetVersion};
+  uint64_t version_{kDefaultIntervalSetVersion};
 };
 } // namespace quic
 #include <quic/common/IntervalSet-inl.h>
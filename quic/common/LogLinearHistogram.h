@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/lang/Bits.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace quic {
+
+/**
+ * A fixed size histogram of uint64_t values, e.g. durations in microseconds.
+ * Values below 2^kSubBucketBits get a bucket each, and every power of two
+ * above is split in 2^kSubBucketBits linear buckets, so a bucket is never
+ * wider than 1/2^kSubBucketBits of its values. Adding a value is a few bit
+ * operations and an increment, without allocation, so that it can be kept
+ * per connection or per worker in a stats callback.
+ */
+class LogLinearHistogram {
+ public:
+  static constexpr uint8_t kSubBucketBits = 3;
+  static constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+  static constexpr size_t kNumBuckets =
+      kSubBuckets + (64 - kSubBucketBits) * kSubBuckets;
+
+  void addValue(uint64_t value) noexcept {
+    ++buckets_[bucketIndex(value)];
+    ++count_;
+    sum_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  void merge(const LogLinearHistogram& other) noexcept {
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+      buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  void clear() noexcept {
+    *this = LogLinearHistogram();
+  }
+
+  uint64_t count() const noexcept {
+    return count_;
+  }
+
+  uint64_t sum() const noexcept {
+    return sum_;
+  }
+
+  // 0 when empty.
+  uint64_t min() const noexcept {
+    return count_ ? min_ : 0;
+  }
+
+  uint64_t max() const noexcept {
+    return max_;
+  }
+
+  /**
+   * An upper bound of the value at quantile (between 0 and 1), within the
+   * width of its bucket. 0 when empty.
+   */
+  uint64_t quantile(double quantile) const noexcept {
+    if (count_ == 0) {
+      return 0;
+    }
+    quantile = std::min(std::max(quantile, 0.0), 1.0);
+    auto rank = std::max<uint64_t>(1, std::ceil(quantile * count_));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+      seen += buckets_[i];
+      if (seen >= rank) {
+        return std::max(std::min(bucketUpperBound(i), max_), min_);
+      }
+    }
+    return max_;
+  }
+
+  uint64_t bucketCount(size_t index) const noexcept {
+    return buckets_[index];
+  }
+
+  static size_t bucketIndex(uint64_t value) noexcept {
+    if (value < kSubBuckets) {
+      return value;
+    }
+    // The position of the highest set bit picks the power of two and the
+    // kSubBucketBits below it the linear bucket within.
+    size_t shift = folly::findLastSet(value) - 1 - kSubBucketBits;
+    return kSubBuckets + shift * kSubBuckets +
+        ((value >> shift) - kSubBuckets);
+  }
+
+  static uint64_t bucketLowerBound(size_t index) noexcept {
+    if (index < kSubBuckets) {
+      return index;
+    }
+    auto shift = (index - kSubBuckets) / kSubBuckets;
+    return (kSubBuckets + (index - kSubBuckets) % kSubBuckets) << shift;
+  }
+
+  static uint64_t bucketUpperBound(size_t index) noexcept {
+    if (index + 1 == kNumBuckets) {
+      return std::numeric_limits<uint64_t>::max();
+    }
+    return bucketLowerBound(index + 1) - 1;
+  }
+
+ private:
+  std::array<uint64_t, kNumBuckets> buckets_{};
+  uint64_t count_{0};
+  uint64_t sum_{0};
+  uint64_t min_{std::numeric_limits<uint64_t>::max()};
+  uint64_t max_{0};
+};
+} // namespace quic
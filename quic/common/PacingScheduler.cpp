@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/common/PacingScheduler.h>
+
+#include <folly/lang/Bits.h>
+
+namespace quic {
+
+PacingScheduler::Callback::~Callback() {
+  cancelPacingTimeout();
+}
+
+bool PacingScheduler::Callback::isPacingTimeoutScheduled() const {
+  return scheduler_ != nullptr;
+}
+
+void PacingScheduler::Callback::cancelPacingTimeout() {
+  if (scheduler_) {
+    scheduler_->cancel(this);
+  }
+}
+
+PacingScheduler::PacingScheduler(
+    TimerHighRes::SharedPtr timer,
+    size_t numBuckets)
+    : timer_(std::move(timer)), start_(Clock::now()) {
+  CHECK(timer_);
+  CHECK_GT(numBuckets, 0);
+  tickInterval_ = timer_->getTickInterval();
+  CHECK_GT(tickInterval_.count(), 0);
+  buckets_.resize(folly::nextPowTwo(numBuckets));
+}
+
+PacingScheduler::~PacingScheduler() {
+  for (auto& bucket : buckets_) {
+    while (!bucket.empty()) {
+      cancel(&bucket.front());
+    }
+  }
+  // The timer may go away with timer_, so this can't wait for the base class.
+  cancelTimeout();
+}
+
+void PacingScheduler::scheduleTimeout(
+    Callback* callback,
+    std::chrono::microseconds timeout) {
+  CHECK(callback);
+  callback->cancelPacingTimeout();
+  // A writer is never due before the next tick, so that the bucket being
+  // drained never grows.
+  uint64_t ticks = std::max<uint64_t>(
+      1, (timeout.count() + tickInterval_.count() - 1) / tickInterval_.count());
+  callback->dueTick_ = std::max(tickAt(Clock::now()), lastTick_) + ticks;
+  callback->scheduler_ = this;
+  buckets_[callback->dueTick_ & (buckets_.size() - 1)].push_back(*callback);
+  ++numScheduled_;
+  if (!isScheduled()) {
+    scheduleNextTick();
+  }
+}
+
+std::chrono::microseconds PacingScheduler::getTickInterval() const {
+  return tickInterval_;
+}
+
+size_t PacingScheduler::numScheduled() const {
+  return numScheduled_;
+}
+
+void PacingScheduler::timeoutExpired() noexcept {
+  auto nowTick = tickAt(Clock::now());
+  CallbackList due;
+  // The timer can fire late, so catch up on every bucket passed since the
+  // last tick, but go around the wheel at most once.
+  uint64_t ticksToDrain = nowTick > lastTick_ ? nowTick - lastTick_ : 0;
+  ticksToDrain = std::min<uint64_t>(ticksToDrain, buckets_.size());
+  for (uint64_t i = 1; i <= ticksToDrain; ++i) {
+    auto& bucket = buckets_[(lastTick_ + i) & (buckets_.size() - 1)];
+    for (auto it = bucket.begin(); it != bucket.end();) {
+      auto& callback = *it++;
+      if (callback.dueTick_ <= nowTick) {
+        callback.hook_.unlink();
+        due.push_back(callback);
+      }
+    }
+  }
+  lastTick_ = std::max(lastTick_, nowTick);
+  // A callback can reschedule itself, or destroy other due callbacks, which
+  // takes them off the due list.
+  while (!due.empty()) {
+    auto& callback = due.front();
+    cancel(&callback);
+    callback.pacingTimeoutExpired();
+  }
+  if (numScheduled_ > 0 && !isScheduled()) {
+    scheduleNextTick();
+  }
+}
+
+void PacingScheduler::callbackCanceled() noexcept {
+  return;
+}
+
+uint64_t PacingScheduler::tickAt(Clock::time_point time) const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(time - start_)
+             .count() /
+      tickInterval_.count();
+}
+
+void PacingScheduler::cancel(Callback* callback) {
+  DCHECK_EQ(callback->scheduler_, this);
+  callback->hook_.unlink();
+  callback->scheduler_ = nullptr;
+  --numScheduled_;
+}
+
+void PacingScheduler::scheduleNextTick() {
+  timer_->scheduleTimeout(this, tickInterval_);
+}
+} // namespace quic
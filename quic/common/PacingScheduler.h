@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <folly/IntrusiveList.h>
+#include <quic/common/Timers.h>
+
+namespace quic {
+
+constexpr size_t kDefaultPacingSchedulerBuckets = 1024;
+
+/**
+ * A calendar queue of paced writers shared by all the connections of a worker.
+ * Each writer sits in the bucket of the timer tick it is due at, and only one
+ * timeout is kept on the underlying timer, for the next tick. On each tick the
+ * due writers, and only those, are run.
+ *
+ * This saves the per connection reschedules on the wheel timer when there are
+ * many paced connections. Must only be used on the evb of the timer.
+ */
+class PacingScheduler : public TimerHighRes::Callback {
+ public:
+  using SharedPtr = std::shared_ptr<PacingScheduler>;
+  using Clock = std::chrono::steady_clock;
+
+  class Callback {
+   public:
+    virtual ~Callback();
+
+    virtual void pacingTimeoutExpired() noexcept = 0;
+
+    bool isPacingTimeoutScheduled() const;
+
+    void cancelPacingTimeout();
+
+   private:
+    friend class PacingScheduler;
+
+    folly::IntrusiveListHook hook_;
+    PacingScheduler* scheduler_{nullptr};
+    uint64_t dueTick_{0};
+  };
+
+  /**
+   * numBuckets is rounded up to a power of two. Writers due further than
+   * numBuckets ticks away wait in their bucket for the wheel to come around.
+   */
+  explicit PacingScheduler(
+      TimerHighRes::SharedPtr timer,
+      size_t numBuckets = kDefaultPacingSchedulerBuckets);
+
+  ~PacingScheduler() override;
+
+  /**
+   * Runs callback once timeout has passed, rounded up to the tick interval.
+   * Rescheduling an already scheduled callback moves it.
+   */
+  void scheduleTimeout(Callback* callback, std::chrono::microseconds timeout);
+
+  std::chrono::microseconds getTickInterval() const;
+
+  size_t numScheduled() const;
+
+  void timeoutExpired() noexcept override;
+
+  void callbackCanceled() noexcept override;
+
+ private:
+  using CallbackList = folly::IntrusiveList<Callback, &Callback::hook_>;
+
+  uint64_t tickAt(Clock::time_point time) const;
+  void cancel(Callback* callback);
+  void scheduleNextTick();
+
+  TimerHighRes::SharedPtr timer_;
+  std::chrono::microseconds tickInterval_;
+  Clock::time_point start_;
+  std::vector<CallbackList> buckets_;
+  // The last tick whose bucket has been drained.
+  uint64_t lastTick_{0};
+  size_t numScheduled_{0};
+};
+} // namespace quic
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/common/PacketBufArena.h>
+
+#include <algorithm>
+
+namespace quic {
+
+PacketBufArena::PacketBufArena(size_t slabSize, size_t maxSlabs)
+    : slabSize_(slabSize), maxSlabs_(maxSlabs) {
+  slabs_.reserve(maxSlabs_);
+}
+
+Buf PacketBufArena::allocate() {
+  if (slabs_.empty()) {
+    return folly::IOBuf::create(slabSize_);
+  }
+  auto slab = std::move(slabs_.back());
+  slabs_.pop_back();
+  return slab;
+}
+
+void PacketBufArena::recycle(Buf buf) {
+  while (buf) {
+    auto next = buf->pop();
+    recycleOne(std::move(buf));
+    buf = std::move(next);
+  }
+}
+
+void PacketBufArena::prefill(size_t numSlabs) {
+  numSlabs = std::min(numSlabs, maxSlabs_);
+  while (slabs_.size() < numSlabs) {
+    slabs_.push_back(folly::IOBuf::create(slabSize_));
+  }
+}
+
+void PacketBufArena::recycleOne(Buf buf) {
+  DCHECK(!buf->isChained());
+  // Someone else may still read a shared buffer, e.g. a clone in a stream's
+  // retransmission buffer, so only unique user owned memory is reused.
+  if (slabs_.size() >= maxSlabs_ || buf->isShared() ||
+      !buf->isManagedOne() || buf->capacity() < slabSize_) {
+    return;
+  }
+  buf->clear();
+  slabs_.push_back(std::move(buf));
+}
+} // namespace quic
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/QuicConstants.h>
+#include <quic/common/BufUtil.h>
+
+#include <vector>
+
+namespace quic {
+
+// Roughly a few batches worth of packets.
+constexpr size_t kDefaultPacketBufArenaMaxSlabs = 128;
+
+/**
+ * A pool of packet sized buffers (slabs) shared by everything that writes
+ * packets on one EventBase, e.g. all transports of a QuicServerWorker. Slabs
+ * are handed out by allocate() and given back by recycle() once their data has
+ * been written to the socket, so steady state writes don't malloc and free an
+ * IOBuf for every packet.
+ *
+ * This is not thread safe. It's supposed to be used from a single EventBase.
+ */
+class PacketBufArena {
+ public:
+  explicit PacketBufArena(
+      size_t slabSize = kDefaultMaxUDPPayload,
+      size_t maxSlabs = kDefaultPacketBufArenaMaxSlabs);
+
+  /**
+   * Returns an empty, unshared and unchained buffer with at least slabSize()
+   * bytes of tailroom. Falls back to a new allocation if no slab is cached.
+   */
+  Buf allocate();
+
+  /**
+   * Gives buffers back to the arena. The chain is broken up and every element
+   * that is a reusable slab is cached. Shared buffers, buffers smaller than a
+   * slab and anything over the cache limit are freed.
+   */
+  void recycle(Buf buf);
+
+  /**
+   * Caches new slabs until numSlabs of them, or the limit, are cached, so
+   * that the first writes don't allocate either.
+   */
+  void prefill(size_t numSlabs);
+
+  size_t slabSize() const {
+    return slabSize_;
+  }
+
+  size_t numCachedSlabs() const {
+    return slabs_.size();
+  }
+
+ private:
+  void recycleOne(Buf buf);
+
+  size_t slabSize_;
+  size_t maxSlabs_;
+  std::vector<Buf> slabs_;
+};
+} // namespace quic
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/common/SharedEgressBatch.h>
+
+#include <quic/common/SocketUtil.h>
+
+namespace quic {
+
+SharedEgressBatch::SharedEgressBatch(
+    folly::EventBase* evb,
+    size_t maxBatchSize)
+    : evb_(evb), maxBatchSize_(maxBatchSize) {
+  CHECK(evb_);
+  CHECK_GT(maxBatchSize_, 0);
+  addresses_.reserve(maxBatchSize_);
+  bufs_.reserve(maxBatchSize_);
+}
+
+SharedEgressBatch::~SharedEgressBatch() {
+  cancelLoopCallback();
+  numDropped_ += bufs_.size();
+  clear();
+}
+
+void SharedEgressBatch::enqueue(
+    folly::NetworkSocket fd,
+    const folly::SocketAddress& address,
+    std::unique_ptr<folly::IOBuf> buf) {
+  DCHECK(evb_->isInEventBaseThread());
+  if (!bufs_.empty() && fd != fd_) {
+    flush();
+  }
+  fd_ = fd;
+  addresses_.push_back(address);
+  bufs_.push_back(std::move(buf));
+  if (bufs_.size() == maxBatchSize_) {
+    flush();
+  } else if (!isLoopCallbackScheduled()) {
+    evb_->runInLoop(this);
+  }
+}
+
+void SharedEgressBatch::flush() {
+  cancelLoopCallback();
+  size_t sent = 0;
+  while (sent < bufs_.size()) {
+    int ret = writemToAddresses(
+        fd_,
+        addresses_.data() + sent,
+        bufs_.data() + sent,
+        bufs_.size() - sent);
+    if (ret > 0) {
+      sent += ret;
+      continue;
+    }
+    if (ret == 0 || errno == EAGAIN || errno == EWOULDBLOCK ||
+        errno == ENOBUFS) {
+      // The socket is full, none of the rest would make it either.
+      VLOG(4) << "Shared egress batch dropped " << bufs_.size() - sent
+              << " packets, socket full";
+      numDropped_ += bufs_.size() - sent;
+      break;
+    }
+    // Only the first packet failed, e.g. its peer is unreachable.
+    VLOG(4) << "Shared egress batch dropped packet to " << addresses_[sent]
+            << " errno=" << errno;
+    ++numDropped_;
+    ++sent;
+  }
+  clear();
+}
+
+void SharedEgressBatch::setBufArena(PacketBufArena* bufArena) {
+  bufArena_ = bufArena;
+}
+
+size_t SharedEgressBatch::numPending() const {
+  return bufs_.size();
+}
+
+uint64_t SharedEgressBatch::numDropped() const {
+  return numDropped_;
+}
+
+void SharedEgressBatch::runLoopCallback() noexcept {
+  flush();
+}
+
+void SharedEgressBatch::clear() {
+  if (bufArena_) {
+    for (auto& buf : bufs_) {
+      bufArena_->recycle(std::move(buf));
+    }
+  }
+  bufs_.clear();
+  addresses_.clear();
+}
+} // namespace quic
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/SocketAddress.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/net/NetworkSocket.h>
+#include <quic/common/PacketBufArena.h>
+
+#include <vector>
+
+namespace quic {
+
+// Well under the UIO_MAXIOV messages a sendmmsg call takes.
+constexpr size_t kDefaultSharedEgressBatchSize = 256;
+
+/**
+ * Packets of all the connections on one EventBase, e.g. all transports of a
+ * QuicServerWorker, queued up to go out in a single sendmmsg call at the end
+ * of the current loop, instead of one write call or more per connection. Each
+ * datagram keeps its own destination address.
+ *
+ * A packet for another fd than the queued ones, or one past maxBatchSize,
+ * flushes the queue first. The write is deferred, so a write error can't be
+ * reported back to the connection the packet came from. Such packets are
+ * dropped and declared lost later like any other. Writes go straight to the
+ * fd, bypassing any write overrides of the socket they were handed for.
+ *
+ * This is not thread safe. It's supposed to be used from evb only.
+ */
+class SharedEgressBatch : private folly::EventBase::LoopCallback {
+ public:
+  explicit SharedEgressBatch(
+      folly::EventBase* evb,
+      size_t maxBatchSize = kDefaultSharedEgressBatchSize);
+
+  // Queued packets are dropped, their fd may be gone already.
+  ~SharedEgressBatch() override;
+
+  SharedEgressBatch(const SharedEgressBatch&) = delete;
+  SharedEgressBatch& operator=(const SharedEgressBatch&) = delete;
+
+  void enqueue(
+      folly::NetworkSocket fd,
+      const folly::SocketAddress& address,
+      std::unique_ptr<folly::IOBuf> buf);
+
+  // Writes out the queued packets now.
+  void flush();
+
+  // If set, buffers are given back to the arena once written.
+  void setBufArena(PacketBufArena* bufArena);
+
+  size_t numPending() const;
+
+  // Packets dropped on write errors so far.
+  uint64_t numDropped() const;
+
+ private:
+  void runLoopCallback() noexcept override;
+
+  void clear();
+
+  folly::EventBase* evb_;
+  const size_t maxBatchSize_;
+  PacketBufArena* bufArena_{nullptr};
+  // The fd all of bufs_ go out on.
+  folly::NetworkSocket fd_;
+  std::vector<folly::SocketAddress> addresses_;
+  std::vector<std::unique_ptr<folly::IOBuf>> bufs_;
+  uint64_t numDropped_{0};
+};
+} // namespace quic
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/small_vector.h>
+
+#include <cstddef>
+#include <utility>
+
+namespace quic {
+
+/**
+ * A queue of usually few elements, popped from the front and mostly pushed to
+ * the back. Up to N elements are kept inline, so that a queue per stream,
+ * like its delivery callbacks, doesn't allocate the way a std::deque does on
+ * its first element.
+ *
+ * Popping from the front only moves the head; the space in front of it is
+ * reclaimed when the queue empties, or when it is most of the storage.
+ */
+template <class T, size_t N>
+class SmallDeque {
+  using Storage = folly::small_vector<T, N>;
+
+ public:
+  using value_type = T;
+  using iterator = typename Storage::iterator;
+  using const_iterator = typename Storage::const_iterator;
+
+  iterator begin() {
+    return items_.begin() + head_;
+  }
+
+  iterator end() {
+    return items_.end();
+  }
+
+  const_iterator begin() const {
+    return items_.begin() + head_;
+  }
+
+  const_iterator end() const {
+    return items_.end();
+  }
+
+  bool empty() const {
+    return head_ == items_.size();
+  }
+
+  size_t size() const {
+    return items_.size() - head_;
+  }
+
+  T& front() {
+    return items_[head_];
+  }
+
+  const T& front() const {
+    return items_[head_];
+  }
+
+  T& back() {
+    return items_.back();
+  }
+
+  const T& back() const {
+    return items_.back();
+  }
+
+  template <class... Args>
+  void emplace_back(Args&&... args) {
+    compact();
+    items_.emplace_back(std::forward<Args>(args)...);
+  }
+
+  void push_back(T value) {
+    emplace_back(std::move(value));
+  }
+
+  template <class... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    auto index = pos - items_.cbegin();
+    if (head_ > 0 && index == static_cast<ptrdiff_t>(head_)) {
+      // In front, into the space the pops left.
+      --head_;
+      items_[head_] = T(std::forward<Args>(args)...);
+      return begin();
+    }
+    return items_.emplace(
+        items_.cbegin() + index, std::forward<Args>(args)...);
+  }
+
+  void pop_front() {
+    ++head_;
+    if (head_ == items_.size()) {
+      clear();
+    }
+  }
+
+  iterator erase(const_iterator pos) {
+    if (pos == items_.cbegin() + head_) {
+      pop_front();
+      return begin();
+    }
+    return items_.erase(pos);
+  }
+
+  void clear() {
+    items_.clear();
+    head_ = 0;
+  }
+
+ private:
+  void compact() {
+    if (head_ > 0 && head_ >= items_.size() / 2 &&
+        items_.size() == items_.capacity()) {
+      items_.erase(items_.begin(), items_.begin() + head_);
+      head_ = 0;
+    }
+  }
+
+  Storage items_;
+  // Index of the front in items_.
+  size_t head_{0};
+};
+
+} // namespace quic
@@ -33,4 +33,426 @@ void applySocketOptions(
   sock.applyOptions(validOptions, pos);
 }
 
+size_t getGROSegmentSize(const struct msghdr& msg) noexcept {
+#ifdef UDP_GRO
+  if (!msg.msg_control || msg.msg_controllen == 0) {
+    return 0;
+  }
+  for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&msg), cmsg)) {
+    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+      int segmentSize = 0;
+      memcpy(&segmentSize, CMSG_DATA(cmsg), sizeof(segmentSize));
+      return segmentSize > 0 ? size_t(segmentSize) : 0;
+    }
+  }
+#else
+  (void)msg;
+#endif
+  return 0;
+}
+
+void applyEcnSocketOptions(
+    AsyncUDPSocket& sock,
+    sa_family_t family) noexcept {
+  auto fd = sock.getNetworkSocket();
+  int level = family == AF_INET6 ? IPPROTO_IPV6 : IPPROTO_IP;
+  int tosOption = family == AF_INET6 ? IPV6_TCLASS : IP_TOS;
+  int recvTosOption = family == AF_INET6 ? IPV6_RECVTCLASS : IP_RECVTOS;
+  int tos = 0;
+  socklen_t tosLen = sizeof(tos);
+  if (folly::netops::getsockopt(fd, level, tosOption, &tos, &tosLen) != 0) {
+    tos = 0;
+  }
+  tos = (tos & ~kEcnMask) | static_cast<uint8_t>(EcnCodepoint::Ect0);
+  if (folly::netops::setsockopt(fd, level, tosOption, &tos, sizeof(tos)) !=
+      0) {
+    VLOG(4) << "Failed to set ECT(0) on the socket, errno=" << errno;
+    return;
+  }
+  int enable = 1;
+  if (folly::netops::setsockopt(
+          fd, level, recvTosOption, &enable, sizeof(enable)) != 0) {
+    VLOG(4) << "Failed to enable receiving the TOS byte, errno=" << errno;
+  }
+}
+
+EcnCodepoint getEcnCodepoint(const struct msghdr& msg) noexcept {
+  if (!msg.msg_control || msg.msg_controllen == 0) {
+    return EcnCodepoint::NotEct;
+  }
+  for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&msg), cmsg)) {
+    bool isTos = (cmsg->cmsg_level == IPPROTO_IP &&
+                  (cmsg->cmsg_type == IP_TOS || cmsg->cmsg_type == IP_RECVTOS));
+    bool isTrafficClass =
+        cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_TCLASS;
+    if (!isTos && !isTrafficClass) {
+      continue;
+    }
+    // IPv4 hands out a single byte, IPv6 an int.
+    uint8_t tos = 0;
+    if (cmsg->cmsg_len >= CMSG_LEN(sizeof(int))) {
+      int value = 0;
+      memcpy(&value, CMSG_DATA(cmsg), sizeof(value));
+      tos = static_cast<uint8_t>(value);
+    } else {
+      memcpy(&tos, CMSG_DATA(cmsg), sizeof(tos));
+    }
+    return static_cast<EcnCodepoint>(tos & kEcnMask);
+  }
+  return EcnCodepoint::NotEct;
+}
+
+#ifdef __linux__
+namespace {
+// Same layout as struct sock_txtime from linux/net_tstamp.h.
+struct SockTxTime {
+  clockid_t clockid;
+  uint32_t flags;
+};
+
+// From linux/net_tstamp.h.
+constexpr int kTimestampingRxSoftware = 1 << 3;
+constexpr int kTimestampingSoftware = 1 << 4;
+} // namespace
+#endif
+
+bool enableRecvTimestamps(AsyncUDPSocket& sock) noexcept {
+#ifdef __linux__
+  // Hardware timestamps would be in the clock of the NIC, which isn't one we
+  // can compare with.
+  int flags = kTimestampingRxSoftware | kTimestampingSoftware;
+  if (folly::netops::setsockopt(
+          sock.getNetworkSocket(),
+          SOL_SOCKET,
+          SO_TIMESTAMPING,
+          &flags,
+          sizeof(flags)) != 0) {
+    VLOG(4) << "Failed to enable RX timestamps on the socket, errno=" << errno;
+    return false;
+  }
+  return true;
+#else
+  (void)sock;
+  return false;
+#endif
+}
+
+folly::Optional<TimePoint> getRecvTimestamp(const struct msghdr& msg) noexcept {
+#ifdef __linux__
+  if (!msg.msg_control || msg.msg_controllen == 0) {
+    return folly::none;
+  }
+  for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&msg), cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING ||
+        cmsg->cmsg_len < CMSG_LEN(sizeof(struct timespec))) {
+      continue;
+    }
+    // The software timestamp comes first, the hardware ones after it.
+    struct timespec ts {};
+    memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+    if (ts.tv_sec == 0 && ts.tv_nsec == 0) {
+      return folly::none;
+    }
+    auto receiveTime = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::seconds(ts.tv_sec) +
+            std::chrono::nanoseconds(ts.tv_nsec)));
+    auto age = std::chrono::system_clock::now() - receiveTime;
+    auto now = Clock::now();
+    if (age <= std::chrono::system_clock::duration::zero()) {
+      // The realtime clock was stepped back since.
+      return now;
+    }
+    return now - std::chrono::duration_cast<Clock::duration>(age);
+  }
+#else
+  (void)msg;
+#endif
+  return folly::none;
+}
+
+bool enableSocketDropCount(AsyncUDPSocket& sock) noexcept {
+#ifdef __linux__
+  int enable = 1;
+  if (folly::netops::setsockopt(
+          sock.getNetworkSocket(),
+          SOL_SOCKET,
+          SO_RXQ_OVFL,
+          &enable,
+          sizeof(enable)) != 0) {
+    VLOG(4) << "Failed to enable SO_RXQ_OVFL on the socket, errno=" << errno;
+    return false;
+  }
+  return true;
+#else
+  (void)sock;
+  return false;
+#endif
+}
+
+folly::Optional<uint32_t> getSocketDropCount(
+    const struct msghdr& msg) noexcept {
+#ifdef __linux__
+  if (!msg.msg_control || msg.msg_controllen == 0) {
+    return folly::none;
+  }
+  for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(const_cast<struct msghdr*>(&msg), cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL &&
+        cmsg->cmsg_len >= CMSG_LEN(sizeof(uint32_t))) {
+      uint32_t dropCount = 0;
+      memcpy(&dropCount, CMSG_DATA(cmsg), sizeof(dropCount));
+      return dropCount;
+    }
+  }
+#else
+  (void)msg;
+#endif
+  return folly::none;
+}
+
+uint32_t getSocketRecvBufferSize(AsyncUDPSocket& sock) noexcept {
+  int size = 0;
+  socklen_t sizeLen = sizeof(size);
+  if (folly::netops::getsockopt(
+          sock.getNetworkSocket(), SOL_SOCKET, SO_RCVBUF, &size, &sizeLen) !=
+          0 ||
+      size <= 0) {
+    return 0;
+  }
+#ifdef __linux__
+  // Linux reports twice what was set, the rest is room for its bookkeeping.
+  size /= 2;
+#endif
+  return size;
+}
+
+bool setSocketRecvBufferSize(AsyncUDPSocket& sock, uint32_t size) noexcept {
+  int value = std::min<uint32_t>(size, std::numeric_limits<int>::max());
+  if (folly::netops::setsockopt(
+          sock.getNetworkSocket(),
+          SOL_SOCKET,
+          SO_RCVBUF,
+          &value,
+          sizeof(value)) != 0) {
+    VLOG(4) << "Failed to set SO_RCVBUF on the socket, errno=" << errno;
+    return false;
+  }
+  return true;
+}
+
+bool enableTxTime(AsyncUDPSocket& sock) noexcept {
+#ifdef __linux__
+  // steady_clock is CLOCK_MONOTONIC, which is also the only clock fq takes.
+  SockTxTime txTime{CLOCK_MONOTONIC, 0};
+  if (folly::netops::setsockopt(
+          sock.getNetworkSocket(),
+          SOL_SOCKET,
+          SO_TXTIME,
+          &txTime,
+          sizeof(txTime)) != 0) {
+    VLOG(4) << "Failed to enable SO_TXTIME on the socket, errno=" << errno;
+    return false;
+  }
+  return true;
+#else
+  (void)sock;
+  return false;
+#endif
+}
+
+bool enableBusyPoll(
+    AsyncUDPSocket& sock,
+    std::chrono::microseconds busyPoll) noexcept {
+#ifdef __linux__
+  int usec = busyPoll.count();
+  if (folly::netops::setsockopt(
+          sock.getNetworkSocket(),
+          SOL_SOCKET,
+          SO_BUSY_POLL,
+          &usec,
+          sizeof(usec)) != 0) {
+    VLOG(4) << "Failed to set SO_BUSY_POLL on the socket, errno=" << errno;
+    return false;
+  }
+  return true;
+#else
+  (void)sock;
+  (void)busyPoll;
+  return false;
+#endif
+}
+
+int writemWithTxTime(
+    AsyncUDPSocket& sock,
+    const folly::SocketAddress& address,
+    const std::unique_ptr<folly::IOBuf>* bufs,
+    const TimePoint* txTimes,
+    size_t count) {
+#ifdef __linux__
+  sockaddr_storage addrStorage;
+  socklen_t addrLen = address.getAddress(&addrStorage);
+
+  size_t numIovecs = 0;
+  for (size_t i = 0; i < count; ++i) {
+    numIovecs += bufs[i]->countChainElements();
+  }
+  std::vector<struct iovec> iovecs;
+  iovecs.reserve(numIovecs);
+  std::vector<std::array<char, CMSG_SPACE(sizeof(uint64_t))>> controls(count);
+  std::vector<struct mmsghdr> msgs(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto firstIovec = iovecs.size();
+    for (const auto& range : *bufs[i]) {
+      if (!range.empty()) {
+        iovecs.push_back(
+            {const_cast<uint8_t*>(range.data()), size_t(range.size())});
+      }
+    }
+    struct msghdr& msg = msgs[i].msg_hdr;
+    msg.msg_name = &addrStorage;
+    msg.msg_namelen = addrLen;
+    msg.msg_iov = iovecs.data() + firstIovec;
+    msg.msg_iovlen = iovecs.size() - firstIovec;
+    msg.msg_control = controls[i].data();
+    msg.msg_controllen = controls[i].size();
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_TXTIME;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+    uint64_t txTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            txTimes[i].time_since_epoch())
+                            .count();
+    memcpy(CMSG_DATA(cmsg), &txTimeNs, sizeof(txTimeNs));
+  }
+  return ::sendmmsg(
+      sock.getNetworkSocket().toFd(), msgs.data(), msgs.size(), 0);
+#else
+  (void)sock;
+  (void)address;
+  (void)bufs;
+  (void)txTimes;
+  (void)count;
+  errno = ENOTSUP;
+  return -1;
+#endif
+}
+
+bool enableZeroCopy(AsyncUDPSocket& sock) noexcept {
+#ifdef __linux__
+  int enable = 1;
+  if (folly::netops::setsockopt(
+          sock.getNetworkSocket(),
+          SOL_SOCKET,
+          SO_ZEROCOPY,
+          &enable,
+          sizeof(enable)) != 0) {
+    VLOG(4) << "Failed to enable SO_ZEROCOPY on the socket, errno=" << errno;
+    return false;
+  }
+  return true;
+#else
+  (void)sock;
+  return false;
+#endif
+}
+
+int writemGSOZeroCopy(
+    AsyncUDPSocket& sock,
+    const folly::SocketAddress& address,
+    const std::unique_ptr<folly::IOBuf>* bufs,
+    const int* gso,
+    size_t count) {
+#ifdef __linux__
+  sockaddr_storage addrStorage;
+  socklen_t addrLen = address.getAddress(&addrStorage);
+
+  size_t numIovecs = 0;
+  for (size_t i = 0; i < count; ++i) {
+    numIovecs += bufs[i]->countChainElements();
+  }
+  std::vector<struct iovec> iovecs;
+  iovecs.reserve(numIovecs);
+  std::vector<std::array<char, CMSG_SPACE(sizeof(uint16_t))>> controls(count);
+  std::vector<struct mmsghdr> msgs(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto firstIovec = iovecs.size();
+    for (const auto& range : *bufs[i]) {
+      if (!range.empty()) {
+        iovecs.push_back(
+            {const_cast<uint8_t*>(range.data()), size_t(range.size())});
+      }
+    }
+    struct msghdr& msg = msgs[i].msg_hdr;
+    msg.msg_name = &addrStorage;
+    msg.msg_namelen = addrLen;
+    msg.msg_iov = iovecs.data() + firstIovec;
+    msg.msg_iovlen = iovecs.size() - firstIovec;
+    if (gso[i] > 0) {
+      msg.msg_control = controls[i].data();
+      msg.msg_controllen = controls[i].size();
+      struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+      uint16_t segmentSize = gso[i];
+      memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(segmentSize));
+    }
+  }
+  return ::sendmmsg(
+      sock.getNetworkSocket().toFd(), msgs.data(), msgs.size(), MSG_ZEROCOPY);
+#else
+  (void)sock;
+  (void)address;
+  (void)bufs;
+  (void)gso;
+  (void)count;
+  errno = ENOTSUP;
+  return -1;
+#endif
+}
+
+int writemToAddresses(
+    folly::NetworkSocket fd,
+    const folly::SocketAddress* addresses,
+    const std::unique_ptr<folly::IOBuf>* bufs,
+    size_t count) {
+  size_t numIovecs = 0;
+  for (size_t i = 0; i < count; ++i) {
+    numIovecs += bufs[i]->countChainElements();
+  }
+  std::vector<struct iovec> iovecs;
+  iovecs.reserve(numIovecs);
+  std::vector<sockaddr_storage> addrStorages(count);
+  std::vector<struct mmsghdr> msgs(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto firstIovec = iovecs.size();
+    for (const auto& range : *bufs[i]) {
+      if (!range.empty()) {
+        iovecs.push_back(
+            {const_cast<uint8_t*>(range.data()), size_t(range.size())});
+      }
+    }
+    struct msghdr& msg = msgs[i].msg_hdr;
+    msg.msg_name = &addrStorages[i];
+    msg.msg_namelen = addresses[i].getAddress(&addrStorages[i]);
+    msg.msg_iov = iovecs.data() + firstIovec;
+    msg.msg_iovlen = iovecs.size() - firstIovec;
+    msg.msg_control = nullptr;
+    msg.msg_controllen = 0;
+    msg.msg_flags = 0;
+  }
+#ifdef __linux__
+  return ::sendmmsg(fd.toFd(), msgs.data(), msgs.size(), 0);
+#else
+  if (count == 0) {
+    return 0;
+  }
+  return folly::netops::sendmsg(fd, &msgs[0].msg_hdr, 0) < 0 ? -1 : 1;
+#endif
+}
+
 } // namespace quic
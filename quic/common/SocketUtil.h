@@ -8,16 +8,183 @@
 
 #pragma once
 
+#include <folly/Optional.h>
 #include <folly/io/SocketOptionMap.h>
 #include <folly/io/async/AsyncUDPSocket.h>
 #include <folly/net/NetOps.h>
+#include <quic/QuicConstants.h>
+
+#if defined(__linux__) && !defined(UDP_GRO)
+#define UDP_GRO 104
+#endif
+
+#if defined(__linux__) && !defined(SO_TXTIME)
+#define SO_TXTIME 61
+#define SCM_TXTIME SO_TXTIME
+#endif
+
+#if defined(__linux__) && !defined(SO_BUSY_POLL)
+#define SO_BUSY_POLL 46
+#endif
+
+#if defined(__linux__) && !defined(SO_ZEROCOPY)
+#define SO_ZEROCOPY 60
+#endif
+
+#if defined(__linux__) && !defined(MSG_ZEROCOPY)
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+#if defined(__linux__) && !defined(UDP_SEGMENT)
+#define UDP_SEGMENT 103
+#endif
+
+#if defined(__linux__) && !defined(SO_RXQ_OVFL)
+#define SO_RXQ_OVFL 40
+#endif
+
+#if defined(__linux__) && !defined(SO_TIMESTAMPING)
+#define SO_TIMESTAMPING 37
+#define SCM_TIMESTAMPING SO_TIMESTAMPING
+#endif
 
 namespace quic {
 
+// Control buffer size needed to receive the UDP GRO segment size, the ECN
+// codepoint, the RX timestamp and the socket drop count cmsgs.
+constexpr size_t kRecvControlSize = 2 * CMSG_SPACE(sizeof(int)) +
+    CMSG_SPACE(3 * sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t));
+
 void applySocketOptions(
     folly::AsyncUDPSocket& sock,
     const folly::SocketOptionMap& options,
     sa_family_t family,
     folly::SocketOptionKey::ApplyPos pos) noexcept;
 
+/**
+ * Returns the UDP GRO segment size carried in the control data of msg, or 0
+ * if the datagram read into msg was not coalesced by the kernel.
+ */
+size_t getGROSegmentSize(const struct msghdr& msg) noexcept;
+
+/**
+ * Marks the packets sent on sock with ECT(0), keeping the DSCP bits, and asks
+ * the kernel to deliver the TOS / traffic class byte of the received packets
+ * as a cmsg. Failures are logged and leave ECN off.
+ */
+void applyEcnSocketOptions(
+    folly::AsyncUDPSocket& sock,
+    sa_family_t family) noexcept;
+
+/**
+ * Returns the ECN codepoint carried in the control data of msg, or NotEct if
+ * there is none.
+ */
+EcnCodepoint getEcnCodepoint(const struct msghdr& msg) noexcept;
+
+/**
+ * Asks the kernel for software RX timestamps of the packets received on sock,
+ * delivered as an SCM_TIMESTAMPING cmsg. Returns false if it doesn't support
+ * them.
+ */
+bool enableRecvTimestamps(folly::AsyncUDPSocket& sock) noexcept;
+
+/**
+ * Returns when the kernel received the datagram read into msg, going by the
+ * software RX timestamp in its control data, or folly::none if there is none.
+ * The timestamp is taken with the realtime clock, it's moved over to Clock by
+ * how long ago it was.
+ */
+folly::Optional<TimePoint> getRecvTimestamp(const struct msghdr& msg) noexcept;
+
+/**
+ * Sets SO_RXQ_OVFL on sock, so that the datagrams read from it carry the
+ * number of packets the kernel has dropped on it so far for want of room in
+ * its receive buffer. Returns false if the kernel doesn't support it.
+ */
+bool enableSocketDropCount(folly::AsyncUDPSocket& sock) noexcept;
+
+/**
+ * Returns the count of packets dropped on the socket carried in the control
+ * data of msg, or folly::none if there is none, which the kernel leaves out
+ * until the first drop.
+ */
+folly::Optional<uint32_t> getSocketDropCount(const struct msghdr& msg) noexcept;
+
+/**
+ * Returns the SO_RCVBUF of sock, as it would be passed to setsockopt, or 0 if
+ * it can't be read.
+ */
+uint32_t getSocketRecvBufferSize(folly::AsyncUDPSocket& sock) noexcept;
+
+/**
+ * Sets the SO_RCVBUF of sock to size. Returns false if it couldn't.
+ */
+bool setSocketRecvBufferSize(
+    folly::AsyncUDPSocket& sock,
+    uint32_t size) noexcept;
+
+/**
+ * Enables SO_TXTIME on sock with the CLOCK_MONOTONIC clock, so that packets
+ * can carry an earliest departure time for the fq qdisc. Returns false if the
+ * kernel doesn't support it.
+ */
+bool enableTxTime(folly::AsyncUDPSocket& sock) noexcept;
+
+/**
+ * Sets SO_BUSY_POLL on sock, so that reads poll the device queue for up to
+ * busyPoll when the socket has nothing queued. Returns false if the kernel
+ * doesn't support it, or doesn't allow it, going past net.core.busy_read
+ * takes CAP_NET_ADMIN.
+ */
+bool enableBusyPoll(
+    folly::AsyncUDPSocket& sock,
+    std::chrono::microseconds busyPoll) noexcept;
+
+/**
+ * Writes each of bufs as its own datagram to address, with the matching
+ * departure time of txTimes attached as an SCM_TXTIME cmsg, using a single
+ * sendmmsg call. sock must have SO_TXTIME enabled. Returns the number of
+ * datagrams written, or -1 with errno set.
+ */
+int writemWithTxTime(
+    folly::AsyncUDPSocket& sock,
+    const folly::SocketAddress& address,
+    const std::unique_ptr<folly::IOBuf>* bufs,
+    const TimePoint* txTimes,
+    size_t count);
+
+/**
+ * Sets SO_ZEROCOPY on sock, so that it can be written to with MSG_ZEROCOPY.
+ * Returns false if the kernel doesn't support it.
+ */
+bool enableZeroCopy(folly::AsyncUDPSocket& sock) noexcept;
+
+/**
+ * Writes each of bufs to address with MSG_ZEROCOPY, split in datagrams of the
+ * matching GSO segment size of gso when it isn't 0, using a single sendmmsg
+ * call. sock must have SO_ZEROCOPY enabled, and the data of the bufs that
+ * were written must be left alone until the kernel reports it's done with
+ * them, see ZeroCopySendTracker. Returns the number of bufs written, or -1
+ * with errno set.
+ */
+int writemGSOZeroCopy(
+    folly::AsyncUDPSocket& sock,
+    const folly::SocketAddress& address,
+    const std::unique_ptr<folly::IOBuf>* bufs,
+    const int* gso,
+    size_t count);
+
+/**
+ * Writes each of bufs as its own datagram to the matching address of
+ * addresses, using a single sendmmsg call on fd. Returns the number of
+ * datagrams written, or -1 with errno set. On platforms without sendmmsg
+ * only the first datagram is written.
+ */
+int writemToAddresses(
+    folly::NetworkSocket fd,
+    const folly::SocketAddress* addresses,
+    const std::unique_ptr<folly::IOBuf>* bufs,
+    size_t count);
+
 } // namespace quic
@@ -49,4 +49,38 @@ using TimerHighRes = TimerFDTimerHighRes;
 #else
 using TimerHighRes = folly::HHWheelTimerHighRes;
 #endif
+
+/**
+ * A timeout that can be scheduled either on the EventBase's millisecond
+ * HHWheelTimer or on a microsecond TimerHighRes, so that a transport can move
+ * its timers to the high res timer its worker shares. Subclasses implement
+ * timeoutExpired() and callbackCanceled() once for both. It must be canceled
+ * before being scheduled on the other timer.
+ */
+class DualTimerCallback : public folly::HHWheelTimer::Callback,
+                          public folly::HHWheelTimerHighRes::Callback {
+ public:
+  using LowResCallback = folly::HHWheelTimer::Callback;
+  using HighResCallback = folly::HHWheelTimerHighRes::Callback;
+
+  ~DualTimerCallback() override = default;
+
+  bool isScheduled() const {
+    return LowResCallback::isScheduled() || HighResCallback::isScheduled();
+  }
+
+  void cancelTimeout() {
+    LowResCallback::cancelTimeout();
+    HighResCallback::cancelTimeout();
+  }
+
+  // Rounded down to milliseconds on either timer.
+  std::chrono::milliseconds getTimeRemaining() const {
+    if (HighResCallback::isScheduled()) {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+          HighResCallback::getTimeRemaining());
+    }
+    return LowResCallback::getTimeRemaining();
+  }
+};
 } // namespace quic
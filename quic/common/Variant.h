@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <memory>
+
 namespace quic {
 
 #define UNION_TYPE(X, ...) X X##_;
@@ -59,34 +61,107 @@ namespace quic {
   case Type::X##_E:                    \
     return X##_ == *other.as##X();
 
-#define DECLARE_VARIANT_TYPE(NAME, X)                         \
+// Boxed members are kept on the heap, so that a large member that is rarely
+// used doesn't make every instance of the variant as large as it is. They
+// are accessed the same way as the other members.
+#define BOXED_UNION_TYPE(X, ...) std::unique_ptr<X> X##_;
+
+#define BOXED_UNION_ACCESSOR(X, ...) \
+  X* as##X() {                       \
+    if (type_ == Type::X##_E) {      \
+      return X##_.get();             \
+    }                                \
+    return nullptr;                  \
+  }
+
+#define BOXED_CONST_UNION_ACCESSOR(X, ...) \
+  const X* as##X() const {                 \
+    if (type_ == Type::X##_E) {            \
+      return X##_.get();                   \
+    }                                      \
+    return nullptr;                        \
+  }
+
+#define BOXED_UNION_CTORS(X, NAME)                                     \
+  NAME(X&& x) : type_(Type::X##_E) {                                   \
+    new (&X##_) std::unique_ptr<X>(std::make_unique<X>(std::move(x))); \
+  }
+
+#define BOXED_UNION_COPY_CTORS(X, NAME)                     \
+  NAME(const X& x) : type_(Type::X##_E) {                   \
+    new (&X##_) std::unique_ptr<X>(std::make_unique<X>(x)); \
+  }
+
+#define BOXED_UNION_MOVE_CASES(X, other)                   \
+  case Type::X##_E:                                        \
+    new (&X##_) std::unique_ptr<X>(std::move(other.X##_)); \
+    break;
+
+#define BOXED_UNION_COPY_CASES(X, other)                          \
+  case Type::X##_E:                                               \
+    new (&X##_) std::unique_ptr<X>(                               \
+        other.X##_ ? std::make_unique<X>(*other.X##_) : nullptr); \
+    break;
+
+#define BOXED_DESTRUCTOR_CASES(X, ...) \
+  case Type::X##_E:                    \
+    X##_.~unique_ptr();                \
+    break;
+
+#define BOXED_UNION_EQUALITY_CASES(X, other) \
+  case Type::X##_E:                          \
+    return *X##_ == *other.as##X();
+
+#define NO_BOXED_VARIANT_TYPES(F, ...)
+
+#define DECLARE_VARIANT_TYPE(NAME, X) \
+  DECLARE_VARIANT_TYPE_WITH_BOXED(NAME, X, NO_BOXED_VARIANT_TYPES)
+
+/**
+ * Same as DECLARE_VARIANT_TYPE, with the members listed in B boxed.
+ */
+#define DECLARE_VARIANT_TYPE_WITH_BOXED(NAME, X, B)           \
   struct NAME {                                               \
-    enum class Type { X(ENUM_TYPES) };                        \
+    enum class Type { X(ENUM_TYPES) B(ENUM_TYPES) };          \
                                                               \
     X(UNION_CTORS, NAME)                                      \
+    B(BOXED_UNION_CTORS, NAME)                                \
                                                               \
     X(UNION_COPY_CTORS, NAME)                                 \
+    B(BOXED_UNION_COPY_CTORS, NAME)                           \
                                                               \
     NAME(NAME&& other) {                                      \
-      switch (other.type_) { X(UNION_MOVE_CASES, other) }     \
+      switch (other.type_) {                                  \
+        X(UNION_MOVE_CASES, other)                            \
+        B(BOXED_UNION_MOVE_CASES, other)                      \
+      }                                                       \
       type_ = other.type_;                                    \
     }                                                         \
                                                               \
     NAME& operator=(NAME&& other) {                           \
       destroyVariant();                                       \
-      switch (other.type_) { X(UNION_MOVE_CASES, other) }     \
+      switch (other.type_) {                                  \
+        X(UNION_MOVE_CASES, other)                            \
+        B(BOXED_UNION_MOVE_CASES, other)                      \
+      }                                                       \
       type_ = other.type_;                                    \
       return *this;                                           \
     }                                                         \
                                                               \
     NAME(const NAME& other) {                                 \
-      switch (other.type_) { X(UNION_COPY_CASES, other) }     \
+      switch (other.type_) {                                  \
+        X(UNION_COPY_CASES, other)                            \
+        B(BOXED_UNION_COPY_CASES, other)                      \
+      }                                                       \
       type_ = other.type_;                                    \
     }                                                         \
                                                               \
     NAME& operator=(const NAME& other) {                      \
       destroyVariant();                                       \
-      switch (other.type_) { X(UNION_COPY_CASES, other) }     \
+      switch (other.type_) {                                  \
+        X(UNION_COPY_CASES, other)                            \
+        B(BOXED_UNION_COPY_CASES, other)                      \
+      }                                                       \
       type_ = other.type_;                                    \
       return *this;                                           \
     }                                                         \
@@ -95,7 +170,10 @@ namespace quic {
       if (other.type() != type_) {                            \
         return false;                                         \
       }                                                       \
-      switch (other.type_) { X(UNION_EQUALITY_CASES, other) } \
+      switch (other.type_) {                                  \
+        X(UNION_EQUALITY_CASES, other)                        \
+        B(BOXED_UNION_EQUALITY_CASES, other)                  \
+      }                                                       \
       return false;                                           \
     }                                                         \
                                                               \
@@ -108,16 +186,22 @@ namespace quic {
     }                                                         \
                                                               \
     X(UNION_ACCESSOR)                                         \
+    B(BOXED_UNION_ACCESSOR)                                   \
                                                               \
     X(CONST_UNION_ACCESSOR)                                   \
+    B(BOXED_CONST_UNION_ACCESSOR)                             \
                                                               \
    private:                                                   \
     union {                                                   \
       X(UNION_TYPE)                                           \
+      B(BOXED_UNION_TYPE)                                     \
     };                                                        \
                                                               \
     void destroyVariant() {                                   \
-      switch (type_) { X(DESTRUCTOR_CASES) }                  \
+      switch (type_) {                                        \
+        X(DESTRUCTOR_CASES)                                   \
+        B(BOXED_DESTRUCTOR_CASES)                             \
+      }                                                       \
     }                                                         \
                                                               \
     Type type_;                                               \
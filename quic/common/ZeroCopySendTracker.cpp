@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/common/ZeroCopySendTracker.h>
+
+namespace quic {
+
+ZeroCopySendTracker::ZeroCopySendTracker(
+    folly::NetworkSocket fd,
+    PacketBufArena* bufArena)
+    : fd_(fd), bufArena_(bufArena) {}
+
+bool ZeroCopySendTracker::shouldZeroCopy(
+    const folly::AsyncUDPSocket& sock,
+    size_t size) const {
+  return !kernelCopied_ && size >= kMinZeroCopySendSize &&
+      pending_.size() < kMaxPendingZeroCopySends &&
+      sock.getNetworkSocket() == fd_;
+}
+
+void ZeroCopySendTracker::onSent(Buf buf) {
+  pending_.emplace_back(nextId_++, std::move(buf));
+}
+
+bool ZeroCopySendTracker::onErrMessage(const struct cmsghdr& cmsg) {
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  if (!(cmsg.cmsg_level == SOL_IP && cmsg.cmsg_type == IP_RECVERR) &&
+      !(cmsg.cmsg_level == SOL_IPV6 && cmsg.cmsg_type == IPV6_RECVERR)) {
+    return false;
+  }
+  const struct sock_extended_err* serr =
+      reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(&cmsg));
+  if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+    return false;
+  }
+  if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+    VLOG(4) << "Kernel copied zero copy sends, fd=" << fd_;
+    kernelCopied_ = true;
+  }
+  // The range is inclusive, and the numbers wrap around.
+  uint32_t lo = serr->ee_info;
+  uint32_t hi = serr->ee_data;
+  for (auto it = pending_.begin(); it != pending_.end();) {
+    if (it->first - lo > hi - lo) {
+      ++it;
+      continue;
+    }
+    if (bufArena_) {
+      bufArena_->recycle(std::move(it->second));
+    }
+    it = pending_.erase(it);
+  }
+  return true;
+#else
+  (void)cmsg;
+  return false;
+#endif
+}
+
+} // namespace quic
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/io/async/AsyncUDPSocket.h>
+#include <quic/common/BufUtil.h>
+#include <quic/common/PacketBufArena.h>
+
+#include <deque>
+
+#if defined(FOLLY_HAVE_MSG_ERRQUEUE) && !defined(SO_EE_ORIGIN_ZEROCOPY)
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+
+#if defined(FOLLY_HAVE_MSG_ERRQUEUE) && !defined(SO_EE_CODE_ZEROCOPY_COPIED)
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
+namespace quic {
+
+// Below this a send is cheaper to copy than to pin and wait for.
+constexpr size_t kMinZeroCopySendSize = 16 * 1024;
+
+// Past this many sends the kernel hasn't completed yet, sends are copied
+// again, the kernel would run out of option memory for them soon anyway.
+constexpr size_t kMaxPendingZeroCopySends = 64;
+
+/**
+ * Keeps the buffers of the MSG_ZEROCOPY sends on one socket alive until the
+ * kernel says on the error queue that it's done with them. The kernel numbers
+ * the zero copy sends of a socket from 0, and reports them done in ranges of
+ * those numbers.
+ *
+ * The socket needs SO_ZEROCOPY and an error message callback that hands the
+ * cmsgs to onErrMessage(). This is not thread safe, it's supposed to be used
+ * from the EventBase of the socket.
+ */
+class ZeroCopySendTracker {
+ public:
+  explicit ZeroCopySendTracker(
+      folly::NetworkSocket fd,
+      PacketBufArena* bufArena = nullptr);
+
+  /**
+   * Whether a send of size bytes on sock should be zero copy. Once the kernel
+   * reports that it had to copy anyway, e.g. because the device can't do
+   * scatter gather, it's never worth it again.
+   */
+  bool shouldZeroCopy(const folly::AsyncUDPSocket& sock, size_t size) const;
+
+  /**
+   * Keeps buf until the kernel is done with the send it went out in. Has to be
+   * called once for each zero copy send that succeeded, in order. buf is
+   * usually a clone of what was sent, so that nobody writes to the data.
+   */
+  void onSent(Buf buf);
+
+  /**
+   * Releases the buffers of the sends cmsg reports done. Returns false if it
+   * isn't a zero copy completion, which is left to the caller.
+   */
+  bool onErrMessage(const struct cmsghdr& cmsg);
+
+  size_t numPendingSends() const {
+    return pending_.size();
+  }
+
+  bool kernelCopied() const {
+    return kernelCopied_;
+  }
+
+ private:
+  folly::NetworkSocket fd_;
+  PacketBufArena* bufArena_;
+  // Number the kernel gives the next zero copy send.
+  uint32_t nextId_{0};
+  std::deque<std::pair<uint32_t, Buf>> pending_;
+  bool kernelCopied_{false};
+};
+
+} // namespace quic
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/common/test/AllocationCounter.h>
+
+namespace {
+// Plain data, so that malloc can use it before static initialization.
+thread_local uint64_t threadAllocations = 0;
+} // namespace
+
+#ifdef QUIC_COUNT_ALLOCATIONS
+// Wraps the allocator of glibc rather than operator new, so that buffers from
+// malloc, like those of folly::IOBuf, count as well.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) noexcept {
+  ++threadAllocations;
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size) noexcept {
+  ++threadAllocations;
+  return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+  ++threadAllocations;
+  return __libc_realloc(ptr, size);
+}
+}
+#endif
+
+namespace quic {
+namespace test {
+
+AllocationCounter::AllocationCounter() : start_(threadAllocations) {}
+
+uint64_t AllocationCounter::count() const {
+  return threadAllocations - start_;
+}
+
+bool AllocationCounter::enabled() {
+#ifdef QUIC_COUNT_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+} // namespace test
+} // namespace quic
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/portability/GTest.h>
+
+#include <cstdint>
+
+namespace quic {
+namespace test {
+
+/**
+ * Counts the heap allocations made by the current thread while it is alive.
+ * Allocations are only counted in builds with QUIC_COUNT_ALLOCATIONS, which
+ * wraps malloc of glibc in the test binaries; otherwise count() is always 0.
+ */
+class AllocationCounter {
+ public:
+  AllocationCounter();
+
+  uint64_t count() const;
+
+  /**
+   * Whether this build counts allocations at all.
+   */
+  static bool enabled();
+
+ private:
+  uint64_t start_;
+};
+
+} // namespace test
+} // namespace quic
+
+/**
+ * Runs statement and expects it to make at most max heap allocations on this
+ * thread. It only checks in builds with QUIC_COUNT_ALLOCATIONS.
+ */
+#define EXPECT_ALLOCATIONS_AT_MOST(max, statement)             \
+  do {                                                         \
+    ::quic::test::AllocationCounter allocationCounter_;        \
+    statement;                                                 \
+    if (::quic::test::AllocationCounter::enabled()) {          \
+      EXPECT_LE(allocationCounter_.count(), uint64_t(max))     \
+          << "Allocations in: " #statement;                    \
+    }                                                          \
+  } while (false)
+
+#define EXPECT_NO_ALLOCATIONS(statement) \
+  EXPECT_ALLOCATIONS_AT_MOST(0, statement)
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/common/test/AllocationCounter.h>
+
+#include <folly/io/IOBuf.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+namespace quic {
+namespace test {
+
+TEST(AllocationCounterTest, CountsAllocations) {
+  AllocationCounter counter;
+  EXPECT_EQ(0, counter.count());
+  auto value = std::make_unique<uint64_t>(1);
+  auto buf = folly::IOBuf::create(100);
+  if (AllocationCounter::enabled()) {
+    EXPECT_GE(counter.count(), 2);
+  } else {
+    EXPECT_EQ(0, counter.count());
+  }
+}
+
+TEST(AllocationCounterTest, Expectations) {
+  uint64_t number = 0;
+  EXPECT_NO_ALLOCATIONS(number = 1);
+  EXPECT_EQ(1, number);
+  std::unique_ptr<uint64_t> value;
+  EXPECT_ALLOCATIONS_AT_MOST(1, value = std::make_unique<uint64_t>(1));
+  EXPECT_EQ(1, *value);
+}
+
+} // namespace test
+} // namespace quic
@@ -69,6 +69,53 @@ TEST(BufQueue, AppendStringPiece) {
   EXPECT_EQ(0, memcmp(chain->data(), chain2->data(), s.length()));
 }
 
+TEST(BufQueue, AppendQueue) {
+  BufQueue queue;
+  queue.append(IOBuf::copyBuffer(SCL("Hello")));
+  BufQueue queue2;
+  queue2.append(IOBuf::copyBuffer(SCL(", ")));
+  queue2.append(IOBuf::copyBuffer(SCL("World")));
+  queue.append(std::move(queue2));
+  checkConsistency(queue);
+  checkConsistency(queue2);
+  EXPECT_EQ(12, queue.chainLength());
+  EXPECT_TRUE(queue2.empty());
+  EXPECT_EQ(nullptr, queue2.front());
+
+  // Appending an empty queue changes nothing.
+  queue.append(BufQueue());
+  checkConsistency(queue);
+  EXPECT_EQ(3, queue.front()->countChainElements());
+  EXPECT_EQ("Hello, World", queue.move()->moveToFbString().toStdString());
+}
+
+TEST(BufQueue, AppendChunked) {
+  BufQueue queue;
+  for (int i = 0; i < 10; ++i) {
+    queue.append(IOBuf::copyBuffer(SCL("Hello")), 1000);
+  }
+  checkConsistency(queue);
+  EXPECT_EQ(50, queue.chainLength());
+  EXPECT_EQ(1, queue.front()->countChainElements());
+
+  // Whatever is split off shares the last chunk, which then isn't reused.
+  auto split = queue.splitAtMost(queue.chainLength() - 1);
+  queue.append(IOBuf::copyBuffer(SCL("World")), 1000);
+  checkConsistency(queue);
+  EXPECT_EQ(2, queue.front()->countChainElements());
+  EXPECT_EQ(49, split->computeChainDataLength());
+
+  // Writes of at least chunkSize are chained without a copy.
+  auto big = IOBuf::copyBuffer(std::string(1000, 'a'));
+  auto bigPtr = big.get();
+  queue.append(std::move(big), 1000);
+  checkConsistency(queue);
+  EXPECT_EQ(bigPtr, queue.front()->prev());
+
+  std::string expected = "oWorld" + std::string(1000, 'a');
+  EXPECT_EQ(expected, queue.move()->moveToFbString().toStdString());
+}
+
 TEST(BufQueue, Split) {
   BufQueue queue;
   queue.append(IOBuf::copyBuffer(SCL("Hello")));
@@ -134,6 +181,20 @@ TEST(BufQueue, SplitEmptt) {
   EXPECT_EQ(res->computeChainDataLength(), 0);
 }
 
+TEST(BufQueue, SplitEverything) {
+  BufQueue queue;
+  queue.append(IOBuf::copyBuffer(SCL("Hello")));
+  queue.append(IOBuf::copyBuffer(SCL("World")));
+  auto front = queue.front();
+  // The chain is handed over as it is.
+  auto buf = queue.splitAtMost(100);
+  EXPECT_EQ(front, buf.get());
+  EXPECT_EQ(10, buf->computeChainDataLength());
+  EXPECT_EQ(nullptr, queue.front());
+  EXPECT_TRUE(queue.empty());
+  checkConsistency(queue);
+}
+
 TEST(BufQueue, TrimStartAtMost) {
   BufQueue queue;
   queue.append(IOBuf::copyBuffer(SCL("Hello")));
@@ -502,3 +563,58 @@ TEST(BufWriterTest, TwoWriters) {
   EXPECT_EQ(15, outputBuffer->length());
   EXPECT_EQ("Destroyer Saint", reader.readFixedString(outputBuffer->length()));
 }
+
+TEST(SimpleBufAccessor, BasicAccess) {
+  SimpleBufAccessor accessor(1000);
+  EXPECT_TRUE(accessor.ownsBuffer());
+  auto buf = accessor.obtain();
+  EXPECT_LE(1000, buf->capacity());
+  EXPECT_FALSE(accessor.ownsBuffer());
+  EXPECT_DEATH(accessor.obtain(), "");
+  accessor.release(buf->clone());
+  EXPECT_TRUE(accessor.ownsBuffer());
+  EXPECT_DEATH(accessor.release(std::move(buf)), "");
+}
+
+TEST(SimpleBufAccessor, CapacityMatch) {
+  SimpleBufAccessor accessor(1000);
+  auto buf = accessor.obtain();
+  buf = folly::IOBuf::create(2000);
+  EXPECT_DEATH(accessor.release(std::move(buf)), "");
+}
+
+TEST(SimpleBufAccessor, RefuseChainedBuf) {
+  SimpleBufAccessor accessor(1000);
+  auto buf = accessor.obtain();
+  buf->prependChain(folly::IOBuf::create(0));
+  EXPECT_DEATH(accessor.release(std::move(buf)), "");
+}
+
+TEST(SplitGROBuffer, NotCoalesced) {
+  std::vector<Buf> packets;
+  splitGROBuffer(folly::IOBuf::copyBuffer("Iron Man"), 0, packets);
+  ASSERT_EQ(1, packets.size());
+  EXPECT_EQ("Iron Man", packets.front()->moveToFbString().toStdString());
+}
+
+TEST(SplitGROBuffer, SplitBySegmentSize) {
+  std::vector<Buf> packets;
+  packets.push_back(folly::IOBuf::copyBuffer("Hulk"));
+  splitGROBuffer(folly::IOBuf::copyBuffer("ThorLokiOdinHel"), 4, packets);
+  ASSERT_EQ(5, packets.size());
+  EXPECT_EQ("Hulk", packets[0]->moveToFbString().toStdString());
+  EXPECT_EQ("Thor", packets[1]->moveToFbString().toStdString());
+  EXPECT_EQ("Loki", packets[2]->moveToFbString().toStdString());
+  EXPECT_EQ("Odin", packets[3]->moveToFbString().toStdString());
+  EXPECT_EQ("Hel", packets[4]->moveToFbString().toStdString());
+}
+
+TEST(SplitGROBuffer, ExactMultiple) {
+  std::vector<Buf> packets;
+  splitGROBuffer(folly::IOBuf::copyBuffer("ThorLoki"), 4, packets);
+  ASSERT_EQ(2, packets.size());
+  EXPECT_EQ(4, packets[0]->length());
+  EXPECT_EQ(4, packets[1]->length());
+  EXPECT_FALSE(packets[0]->isChained());
+  EXPECT_FALSE(packets[1]->isChained());
+}
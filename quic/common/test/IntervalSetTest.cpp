@@ -169,6 +169,31 @@ TEST(IntervalSet, insertVersionDoesNotChange) {
   EXPECT_EQ(version2, version1);
 }
 
+TEST(IntervalSet, versionChangesOnWithdraw) {
+  IntervalSet<int> set;
+  set.insert(1, 4);
+  set.insert(6, 8);
+  auto insertVersion = set.insertVersion();
+  auto version = set.version();
+
+  // No intersection, nothing changes.
+  set.withdraw({10, 12});
+  EXPECT_EQ(version, set.version());
+
+  set.withdraw({2, 3});
+  EXPECT_EQ(insertVersion, set.insertVersion());
+  EXPECT_NE(version, set.version());
+
+  version = set.version();
+  set.pop_back();
+  EXPECT_NE(version, set.version());
+
+  version = set.version();
+  set.clear();
+  EXPECT_NE(version, set.version());
+  EXPECT_EQ(insertVersion, set.insertVersion());
+}
+
 TEST(IntervalSet, withdrawBeforeFront) {
   IntervalSet<int> set;
   set.insert(4, 5);
@@ -302,3 +327,29 @@ TEST(IntervalSet, withdrawWithOverflow) {
   auto interval = set.front();
   EXPECT_EQ(interval, Interval<int>(3, 5));
 }
+
+TEST(IntervalSet, insertInOrder) {
+  IntervalSet<int> set;
+  set.insert(1, 2);
+  auto version1 = set.insertVersion();
+  // Adjacent to the last interval extends it.
+  set.insert(3, 4);
+  auto version2 = set.insertVersion();
+  EXPECT_EQ(1, set.size());
+  EXPECT_EQ(set.back(), Interval<int>(1, 4));
+  EXPECT_GT(version2, version1);
+  // Already covered by the last interval.
+  set.insert(2, 4);
+  EXPECT_EQ(version2, set.insertVersion());
+  EXPECT_EQ(set.back(), Interval<int>(1, 4));
+  // A gap starts a new interval.
+  set.insert(6);
+  EXPECT_EQ(2, set.size());
+  EXPECT_EQ(set.back(), Interval<int>(6, 6));
+  EXPECT_GT(set.insertVersion(), version2);
+  // Overlapping the start of the last interval still merges with the ones
+  // before it.
+  set.insert(4, 6);
+  EXPECT_EQ(1, set.size());
+  EXPECT_EQ(set.back(), Interval<int>(1, 6));
+}
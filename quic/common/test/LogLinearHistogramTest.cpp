@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/common/LogLinearHistogram.h>
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+TEST(LogLinearHistogramTest, BucketBounds) {
+  for (uint64_t value = 0; value < 8; ++value) {
+    EXPECT_EQ(value, LogLinearHistogram::bucketIndex(value));
+  }
+  // Every value lands in a bucket whose bounds contain it.
+  for (uint64_t value :
+       {8ul, 9ul, 15ul, 16ul, 17ul, 1000ul, 123456789ul, 1ul << 40}) {
+    auto index = LogLinearHistogram::bucketIndex(value);
+    EXPECT_LE(LogLinearHistogram::bucketLowerBound(index), value);
+    EXPECT_GE(LogLinearHistogram::bucketUpperBound(index), value);
+  }
+  EXPECT_EQ(16, LogLinearHistogram::bucketLowerBound(16));
+  EXPECT_EQ(17, LogLinearHistogram::bucketUpperBound(16));
+  EXPECT_EQ(
+      LogLinearHistogram::kNumBuckets - 1,
+      LogLinearHistogram::bucketIndex(std::numeric_limits<uint64_t>::max()));
+}
+
+TEST(LogLinearHistogramTest, RelativeError) {
+  for (uint64_t value = 8; value < 100000; value += 7) {
+    auto index = LogLinearHistogram::bucketIndex(value);
+    auto width = LogLinearHistogram::bucketUpperBound(index) -
+        LogLinearHistogram::bucketLowerBound(index) + 1;
+    EXPECT_LE(width * LogLinearHistogram::kSubBuckets, value);
+  }
+}
+
+TEST(LogLinearHistogramTest, Quantiles) {
+  LogLinearHistogram histogram;
+  EXPECT_EQ(0, histogram.quantile(0.5));
+  EXPECT_EQ(0, histogram.min());
+  for (uint64_t value = 1; value <= 100; ++value) {
+    histogram.addValue(value);
+  }
+  EXPECT_EQ(100, histogram.count());
+  EXPECT_EQ(5050, histogram.sum());
+  EXPECT_EQ(1, histogram.min());
+  EXPECT_EQ(100, histogram.max());
+  EXPECT_EQ(1, histogram.quantile(0));
+  EXPECT_EQ(100, histogram.quantile(1));
+  auto median = histogram.quantile(0.5);
+  EXPECT_GE(median, 50);
+  EXPECT_LE(median, 50 + 50 / LogLinearHistogram::kSubBuckets);
+  auto p99 = histogram.quantile(0.99);
+  EXPECT_GE(p99, 99);
+  EXPECT_LE(p99, 100);
+}
+
+TEST(LogLinearHistogramTest, MergeAndClear) {
+  LogLinearHistogram first, second;
+  first.addValue(10);
+  second.addValue(1000);
+  second.addValue(3);
+  first.merge(second);
+  EXPECT_EQ(3, first.count());
+  EXPECT_EQ(1013, first.sum());
+  EXPECT_EQ(3, first.min());
+  EXPECT_EQ(1000, first.max());
+  EXPECT_EQ(1, first.bucketCount(LogLinearHistogram::bucketIndex(1000)));
+
+  first.clear();
+  EXPECT_EQ(0, first.count());
+  EXPECT_EQ(0, first.max());
+  EXPECT_EQ(0, first.quantile(0.9));
+}
+} // namespace test
+} // namespace quic
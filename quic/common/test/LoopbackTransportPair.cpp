@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/common/test/LoopbackTransportPair.h>
+
+#include <folly/io/Cursor.h>
+#include <folly/ssl/Init.h>
+#include <quic/codec/Decode.h>
+#include <quic/codec/DefaultConnectionIdAlgo.h>
+#include <quic/common/test/TestUtils.h>
+#include <quic/congestion_control/CongestionControllerFactory.h>
+#include <quic/fizz/client/handshake/FizzClientQuicHandshakeContext.h>
+
+namespace quic {
+namespace test {
+
+namespace {
+constexpr auto kAlpn = "h1q-fb";
+} // namespace
+
+LoopbackUDPSocket::LoopbackUDPSocket(
+    folly::EventBase* evb,
+    LoopbackTransportPair& pair,
+    bool fromClient,
+    const folly::SocketAddress& address)
+    : folly::AsyncUDPSocket(evb),
+      pair_(pair),
+      fromClient_(fromClient),
+      address_(address) {}
+
+void LoopbackUDPSocket::bind(
+    const folly::SocketAddress& /* address */,
+    BindOptions /* options */) {
+  // The pipe has its own addresses.
+}
+
+ssize_t LoopbackUDPSocket::write(
+    const folly::SocketAddress& /* address */,
+    const std::unique_ptr<folly::IOBuf>& buf) {
+  auto len = buf->computeChainDataLength();
+  if (!closed_) {
+    pair_.onDatagram(fromClient_, buf->clone());
+  }
+  return len;
+}
+
+ssize_t LoopbackUDPSocket::writeGSO(
+    const folly::SocketAddress& address,
+    const std::unique_ptr<folly::IOBuf>& buf,
+    int gso) {
+  if (gso <= 0) {
+    return write(address, buf);
+  }
+  auto len = buf->computeChainDataLength();
+  if (closed_) {
+    return len;
+  }
+  folly::io::Cursor cursor(buf.get());
+  while (!cursor.isAtEnd()) {
+    std::unique_ptr<folly::IOBuf> segment;
+    cursor.clone(segment, std::min<size_t>(gso, cursor.totalLength()));
+    pair_.onDatagram(fromClient_, std::move(segment));
+  }
+  return len;
+}
+
+int LoopbackUDPSocket::writem(
+    const folly::SocketAddress& address,
+    const std::unique_ptr<folly::IOBuf>* bufs,
+    size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    write(address, bufs[i]);
+  }
+  return count;
+}
+
+int LoopbackUDPSocket::writemGSO(
+    const folly::SocketAddress& address,
+    const std::unique_ptr<folly::IOBuf>* bufs,
+    size_t count,
+    const int* gso) {
+  for (size_t i = 0; i < count; ++i) {
+    writeGSO(address, bufs[i], gso ? gso[i] : 0);
+  }
+  return count;
+}
+
+const folly::SocketAddress& LoopbackTransportPair::clientAddress() {
+  static const folly::SocketAddress address("127.0.0.1", 1000);
+  return address;
+}
+
+const folly::SocketAddress& LoopbackTransportPair::serverAddress() {
+  static const folly::SocketAddress address("127.0.0.1", 4433);
+  return address;
+}
+
+TransportSettings LoopbackTransportPair::benchmarkSettings() {
+  TransportSettings settings;
+  settings.rxPacketsBeforeAckBeforeInit = 2;
+  settings.rxPacketsBeforeAckAfterInit = 2;
+  settings.advertisedInitialConnectionWindowSize = 64 * 1024 * 1024;
+  settings.advertisedInitialBidiLocalStreamWindowSize = 16 * 1024 * 1024;
+  settings.advertisedInitialBidiRemoteStreamWindowSize = 16 * 1024 * 1024;
+  return settings;
+}
+
+LoopbackTransportPair::LoopbackTransportPair(
+    folly::EventBase& evb,
+    QuicSocket::ConnectionCallback& clientCallback,
+    QuicSocket::ConnectionCallback& serverCallback,
+    TransportSettings clientSettings,
+    TransportSettings serverSettings)
+    : evb_(evb),
+      clientCallback_(clientCallback),
+      serverCallback_(serverCallback),
+      serverSettings_(std::move(serverSettings)),
+      connIdAlgo_(std::make_unique<DefaultConnectionIdAlgo>()) {
+  folly::ssl::init();
+  serverCtx_ = createServerCtx();
+  serverCtx_->setSupportedAlpns({kAlpn});
+  if (!serverSettings_.statelessResetTokenSecret) {
+    serverSettings_.statelessResetTokenSecret = getRandSecret();
+  }
+  auto clientCtx = std::make_shared<fizz::client::FizzClientContext>();
+  clientCtx->setSupportedAlpns({kAlpn});
+  auto sock = std::make_unique<LoopbackUDPSocket>(
+      &evb_, *this, true /* fromClient */, clientAddress());
+  client_ = std::make_shared<QuicClientTransport>(
+      &evb_,
+      std::move(sock),
+      FizzClientQuicHandshakeContext::Builder()
+          .setFizzClientContext(std::move(clientCtx))
+          .setCertificateVerifier(createTestCertificateVerifier())
+          .build());
+  // Fizz is the hostname of the test certificate.
+  client_->setHostname("Fizz");
+  client_->addNewPeerAddress(serverAddress());
+  client_->setCongestionControllerFactory(
+      std::make_shared<DefaultCongestionControllerFactory>());
+  // There is no real socket to connect.
+  clientSettings.connectUDP = false;
+  client_->setTransportSettings(std::move(clientSettings));
+}
+
+LoopbackTransportPair::~LoopbackTransportPair() {
+  if (server_) {
+    server_->setRoutingCallback(nullptr);
+    server_->closeNow(folly::none);
+  }
+  client_->closeNow(folly::none);
+}
+
+void LoopbackTransportPair::connect() {
+  client_->start(&clientCallback_);
+  loopUntil([&] { return handshakeDone(); });
+}
+
+void LoopbackTransportPair::loopUntil(folly::Function<bool()> done) {
+  while (!done()) {
+    evb_.loopOnce();
+  }
+}
+
+bool LoopbackTransportPair::handshakeDone() const {
+  return client_->replaySafe() && server_ &&
+      server_->getConn().handshakeTimings.handshakeDone.has_value();
+}
+
+void LoopbackTransportPair::onDatagram(
+    bool fromClient,
+    std::unique_ptr<folly::IOBuf> buf) {
+  if (dropFn_ && dropFn_(fromClient, *buf)) {
+    return;
+  }
+  auto& networkData = fromClient ? toServer_ : toClient_;
+  networkData.totalData += buf->computeChainDataLength();
+  networkData.packets.push_back(std::move(buf));
+  fromClient ? datagramsToServer_++ : datagramsToClient_++;
+  if (!isLoopCallbackScheduled()) {
+    evb_.runInLoop(this);
+  }
+}
+
+void LoopbackTransportPair::makeServer(const folly::IOBuf& initial) {
+  folly::io::Cursor cursor(&initial);
+  auto initialByte = cursor.readBE<uint8_t>();
+  auto parsed = parseLongHeaderInvariant(initialByte, cursor);
+  CHECK(parsed.hasValue()) << "The first datagram must be an initial";
+  auto sock = std::make_unique<LoopbackUDPSocket>(
+      &evb_, *this, false /* fromClient */, serverAddress());
+  server_ = QuicServerTransport::make(
+      &evb_, std::move(sock), serverCallback_, serverCtx_);
+  server_->setRoutingCallback(this);
+  server_->setSupportedVersions(
+      {QuicVersion::MVFST, QuicVersion::MVFST_D24, QuicVersion::QUIC_DRAFT});
+  server_->setOriginalPeerAddress(clientAddress());
+  server_->setCongestionControllerFactory(
+      std::make_shared<DefaultCongestionControllerFactory>());
+  server_->setTransportSettings(serverSettings_);
+  server_->setConnectionIdAlgo(connIdAlgo_.get());
+  server_->setClientConnectionId(parsed->invariant.srcConnId);
+  server_->setClientChosenDestConnectionId(parsed->invariant.dstConnId);
+  server_->setServerConnectionIdParams(ServerConnectionIdParams(0, 0, 0));
+  server_->accept();
+}
+
+void LoopbackTransportPair::runLoopCallback() noexcept {
+  // The transports write while they process what they got, which lands in
+  // toServer_ and toClient_ again for the next loop.
+  if (!toServer_.packets.empty()) {
+    if (!server_) {
+      makeServer(*toServer_.packets.front());
+    }
+    auto server = server_;
+    NetworkData networkData = std::move(toServer_);
+    toServer_ = NetworkData();
+    networkData.receiveTimePoint = Clock::now();
+    server->onNetworkData(clientAddress(), std::move(networkData));
+  }
+  if (!toClient_.packets.empty()) {
+    auto client = client_;
+    NetworkData networkData = std::move(toClient_);
+    toClient_ = NetworkData();
+    networkData.receiveTimePoint = Clock::now();
+    client->onNetworkData(serverAddress(), std::move(networkData));
+  }
+}
+} // namespace test
+} // namespace quic
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Function.h>
+#include <folly/io/async/AsyncUDPSocket.h>
+#include <folly/io/async/EventBase.h>
+#include <quic/client/QuicClientTransport.h>
+#include <quic/codec/ConnectionIdAlgo.h>
+#include <quic/server/QuicServerTransport.h>
+
+namespace quic {
+namespace test {
+
+class LoopbackTransportPair;
+
+/**
+ * A socket that hands the datagrams written to it to a LoopbackTransportPair
+ * instead of the network. Nothing is ever read from it, the pair delivers the
+ * datagrams of the peer straight to the transport.
+ */
+class LoopbackUDPSocket : public folly::AsyncUDPSocket {
+ public:
+  LoopbackUDPSocket(
+      folly::EventBase* evb,
+      LoopbackTransportPair& pair,
+      bool fromClient,
+      const folly::SocketAddress& address);
+
+  ~LoopbackUDPSocket() override = default;
+
+  void bind(const folly::SocketAddress& address, BindOptions options)
+      override;
+
+  void setDFAndTurnOffPMTU() override {}
+
+  void dontFragment(bool /* df */) override {}
+
+  void setErrMessageCallback(
+      ErrMessageCallback* /* errMessageCallback */) override {}
+
+  void resumeRead(ReadCallback* /* cob */) override {}
+
+  void pauseRead() override {}
+
+  void close() override {
+    closed_ = true;
+  }
+
+  bool isBound() const override {
+    return true;
+  }
+
+  const folly::SocketAddress& address() const override {
+    return address_;
+  }
+
+  ssize_t write(
+      const folly::SocketAddress& address,
+      const std::unique_ptr<folly::IOBuf>& buf) override;
+
+  ssize_t writeGSO(
+      const folly::SocketAddress& address,
+      const std::unique_ptr<folly::IOBuf>& buf,
+      int gso) override;
+
+  int writem(
+      const folly::SocketAddress& address,
+      const std::unique_ptr<folly::IOBuf>* bufs,
+      size_t count) override;
+
+  int writemGSO(
+      const folly::SocketAddress& address,
+      const std::unique_ptr<folly::IOBuf>* bufs,
+      size_t count,
+      const int* gso) override;
+
+ private:
+  LoopbackTransportPair& pair_;
+  bool fromClient_;
+  folly::SocketAddress address_;
+  bool closed_{false};
+};
+
+/**
+ * A QuicClientTransport connected to a QuicServerTransport through an in
+ * memory packet pipe, both on one EventBase. The datagrams written are
+ * delivered to the peer from a loop callback, all the datagrams for one end
+ * in a single NetworkData like a recvmmsg batch. Nothing is lost or reordered,
+ * and no time passes between a write and its delivery other than the time the
+ * stack takes, which makes it a way to measure the CPU cost of the full stack
+ * without the kernel in the way.
+ *
+ * The loop still waits for timers, such as the ack timer, when nothing else
+ * is left to do. Benchmarks should pick settings that make the peer answer
+ * without them, or the wall time includes the wait.
+ *
+ * Both transports are closed when the pair is destroyed, so the connection and
+ * stream callbacks given to them have to outlive it.
+ */
+class LoopbackTransportPair : private QuicServerTransport::RoutingCallback,
+                              private folly::EventBase::LoopCallback {
+ public:
+  LoopbackTransportPair(
+      folly::EventBase& evb,
+      QuicSocket::ConnectionCallback& clientCallback,
+      QuicSocket::ConnectionCallback& serverCallback,
+      TransportSettings clientSettings = TransportSettings(),
+      TransportSettings serverSettings = TransportSettings());
+
+  ~LoopbackTransportPair() override;
+
+  /**
+   * Starts the client and loops until both ends are done with the handshake.
+   * The server transport is made from the first datagram of the client, the
+   * way a QuicServerWorker makes its transports.
+   */
+  void connect();
+
+  /**
+   * Loops the EventBase until done returns true.
+   */
+  void loopUntil(folly::Function<bool()> done);
+
+  bool handshakeDone() const;
+
+  QuicClientTransport& client() {
+    return *client_;
+  }
+
+  QuicServerTransport& server() {
+    CHECK(server_) << "The client did not send anything yet";
+    return *server_;
+  }
+
+  uint64_t datagramsToServer() const {
+    return datagramsToServer_;
+  }
+
+  uint64_t datagramsToClient() const {
+    return datagramsToClient_;
+  }
+
+  /**
+   * Datagrams that dropFn returns true for are dropped instead of delivered,
+   * to emulate loss. fromClient tells which way the datagram goes.
+   */
+  void setDropFn(
+      folly::Function<bool(bool fromClient, const folly::IOBuf&)> dropFn) {
+    dropFn_ = std::move(dropFn);
+  }
+
+  static const folly::SocketAddress& clientAddress();
+  static const folly::SocketAddress& serverAddress();
+
+  /**
+   * Acks every other packet, so that nothing waits on the ack timer, and
+   * opens the flow control windows wide enough that nothing waits on window
+   * updates.
+   */
+  static TransportSettings benchmarkSettings();
+
+ private:
+  friend class LoopbackUDPSocket;
+
+  void onDatagram(bool fromClient, std::unique_ptr<folly::IOBuf> buf);
+
+  void makeServer(const folly::IOBuf& initial);
+
+  void runLoopCallback() noexcept override;
+
+  void onConnectionIdAvailable(
+      QuicServerTransport::Ptr /* transport */,
+      ConnectionId /* id */) noexcept override {}
+
+  void onConnectionIdBound(
+      QuicServerTransport::Ptr /* transport */) noexcept override {}
+
+  void onConnectionUnbound(
+      QuicServerTransport* /* transport */,
+      const QuicServerTransport::SourceIdentity& /* address */,
+      const std::vector<ConnectionIdData>& /* connectionIdData */) noexcept
+      override {}
+
+  folly::EventBase& evb_;
+  QuicSocket::ConnectionCallback& clientCallback_;
+  QuicSocket::ConnectionCallback& serverCallback_;
+  TransportSettings serverSettings_;
+  std::shared_ptr<fizz::server::FizzServerContext> serverCtx_;
+  std::unique_ptr<ConnectionIdAlgo> connIdAlgo_;
+  std::shared_ptr<QuicClientTransport> client_;
+  QuicServerTransport::Ptr server_;
+  // Written and not delivered yet.
+  NetworkData toServer_;
+  NetworkData toClient_;
+  uint64_t datagramsToServer_{0};
+  uint64_t datagramsToClient_{0};
+  folly::Function<bool(bool, const folly::IOBuf&)> dropFn_;
+};
+
+/**
+ * The connection and stream callbacks of one end of a LoopbackTransportPair
+ * for benchmarks: it reads everything the peer sends, and answers every
+ * stream the peer finishes with response if that is set.
+ */
+class LoopbackConnectionHandler : public QuicSocket::ConnectionCallback,
+                                  public QuicSocket::ReadCallback {
+ public:
+  ~LoopbackConnectionHandler() override = default;
+
+  void onNewBidirectionalStream(StreamId id) noexcept override {
+    socket->setReadCallback(id, this);
+  }
+
+  void onNewUnidirectionalStream(StreamId id) noexcept override {
+    socket->setReadCallback(id, this);
+  }
+
+  void onStopSending(StreamId, ApplicationErrorCode) noexcept override {}
+
+  void onConnectionEnd() noexcept override {
+    connectionEnded = true;
+  }
+
+  void onConnectionError(
+      std::pair<QuicErrorCode, std::string> error) noexcept override {
+    LOG(FATAL) << "Connection error " << toString(error.first) << " "
+               << error.second;
+  }
+
+  void readAvailable(StreamId id) noexcept override {
+    auto data = socket->read(id, 0);
+    CHECK(data.hasValue());
+    if (data->first) {
+      bytesRead += data->first->computeChainDataLength();
+    }
+    if (data->second) {
+      streamsDone++;
+      if (response) {
+        socket->writeChain(id, response->clone(), true, false /* cork */);
+      }
+    }
+  }
+
+  void readError(
+      StreamId,
+      std::pair<QuicErrorCode, folly::Optional<folly::StringPiece>>
+          error) noexcept override {
+    LOG(FATAL) << "Read error " << toString(error.first);
+  }
+
+  // Set once the transport exists.
+  QuicSocket* socket{nullptr};
+  // Written back on each stream the peer finished, if set.
+  std::unique_ptr<folly::IOBuf> response;
+  uint64_t bytesRead{0};
+  uint64_t streamsDone{0};
+  bool connectionEnded{false};
+};
+} // namespace test
+} // namespace quic
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/common/test/LoopbackTransportPair.h>
+
+#include <folly/io/IOBufQueue.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <quic/api/test/Mocks.h>
+#include <quic/common/test/TestUtils.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+class LoopbackTransportPairTest : public Test {
+ protected:
+  folly::EventBase evb_;
+  NiceMock<MockConnectionCallback> clientCallback_;
+  NiceMock<MockConnectionCallback> serverCallback_;
+  NiceMock<MockReadCallback> clientReadCallback_;
+  NiceMock<MockReadCallback> serverReadCallback_;
+};
+
+TEST_F(LoopbackTransportPairTest, Handshake) {
+  LoopbackTransportPair pair(evb_, clientCallback_, serverCallback_);
+  EXPECT_CALL(clientCallback_, onTransportReady());
+  EXPECT_CALL(clientCallback_, onReplaySafe());
+  EXPECT_CALL(serverCallback_, onTransportReady());
+  pair.connect();
+  EXPECT_TRUE(pair.handshakeDone());
+  EXPECT_GT(pair.datagramsToServer(), 0);
+  EXPECT_GT(pair.datagramsToClient(), 0);
+  EXPECT_EQ(
+      pair.client().getState()->serverConnectionId,
+      pair.server().getState()->serverConnectionId);
+}
+
+TEST_F(LoopbackTransportPairTest, Echo) {
+  LoopbackTransportPair pair(evb_, clientCallback_, serverCallback_);
+  pair.connect();
+
+  auto& client = pair.client();
+  auto& server = pair.server();
+  EXPECT_CALL(serverCallback_, onNewBidirectionalStream(_))
+      .WillOnce(Invoke([&](StreamId id) {
+        server.setReadCallback(id, &serverReadCallback_);
+      }));
+  EXPECT_CALL(serverReadCallback_, readAvailable(_))
+      .WillRepeatedly(Invoke([&](StreamId id) {
+        auto data = server.read(id, 0);
+        ASSERT_TRUE(data.hasValue());
+        server.writeChain(
+            id, std::move(data->first), data->second, false /* cork */);
+      }));
+
+  folly::IOBufQueue received{folly::IOBufQueue::cacheChainLength()};
+  bool eof = false;
+  auto streamId = client.createBidirectionalStream().value();
+  client.setReadCallback(streamId, &clientReadCallback_);
+  EXPECT_CALL(clientReadCallback_, readAvailable(streamId))
+      .WillRepeatedly(Invoke([&](StreamId id) {
+        auto data = client.read(id, 0);
+        ASSERT_TRUE(data.hasValue());
+        if (data->first) {
+          received.append(std::move(data->first));
+        }
+        eof = data->second;
+      }));
+
+  // Takes many packets and a few rounds of acks.
+  auto sent = buildRandomInputData(200 * 1000);
+  client.writeChain(streamId, sent->clone(), true, false /* cork */);
+  pair.loopUntil([&] { return eof; });
+  EXPECT_TRUE(folly::IOBufEqualTo()(*sent, *received.move()));
+}
+} // namespace test
+} // namespace quic
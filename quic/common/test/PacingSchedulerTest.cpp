@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/common/FunctionLooper.h>
+#include <quic/common/PacingScheduler.h>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+using namespace std;
+using namespace folly;
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+class TestPacingCallback : public PacingScheduler::Callback {
+ public:
+  explicit TestPacingCallback(std::function<void()> func = nullptr)
+      : func_(std::move(func)) {}
+
+  void pacingTimeoutExpired() noexcept override {
+    ++runCount;
+    if (func_) {
+      func_();
+    }
+  }
+
+  uint32_t runCount{0};
+
+ private:
+  std::function<void()> func_;
+};
+
+TEST(PacingSchedulerTest, RunsOnlyDueCallbacks) {
+  EventBase evb;
+  PacingScheduler scheduler(TimerHighRes::newTimer(&evb, 1ms));
+  TestPacingCallback soon, later;
+  scheduler.scheduleTimeout(&soon, 1ms);
+  scheduler.scheduleTimeout(&later, 3600000ms);
+  EXPECT_TRUE(soon.isPacingTimeoutScheduled());
+  EXPECT_TRUE(later.isPacingTimeoutScheduled());
+  EXPECT_EQ(2, scheduler.numScheduled());
+  EXPECT_TRUE(scheduler.isScheduled());
+
+  std::this_thread::sleep_for(2ms);
+  scheduler.timeoutExpired();
+  EXPECT_EQ(1, soon.runCount);
+  EXPECT_FALSE(soon.isPacingTimeoutScheduled());
+  EXPECT_EQ(0, later.runCount);
+  EXPECT_TRUE(later.isPacingTimeoutScheduled());
+  EXPECT_EQ(1, scheduler.numScheduled());
+  EXPECT_TRUE(scheduler.isScheduled());
+
+  later.cancelPacingTimeout();
+  EXPECT_EQ(0, scheduler.numScheduled());
+}
+
+TEST(PacingSchedulerTest, WrapsAroundTheWheel) {
+  EventBase evb;
+  // Two buckets of 1ms, so a callback 5ms away shares a bucket with earlier
+  // ticks and has to wait for its own.
+  PacingScheduler scheduler(TimerHighRes::newTimer(&evb, 1ms), 2);
+  TestPacingCallback callback;
+  scheduler.scheduleTimeout(&callback, 5ms);
+  std::this_thread::sleep_for(1ms);
+  scheduler.timeoutExpired();
+  EXPECT_EQ(0, callback.runCount);
+  std::this_thread::sleep_for(5ms);
+  scheduler.timeoutExpired();
+  EXPECT_EQ(1, callback.runCount);
+}
+
+TEST(PacingSchedulerTest, RescheduleFromCallback) {
+  EventBase evb;
+  PacingScheduler scheduler(TimerHighRes::newTimer(&evb, 1ms));
+  TestPacingCallback* self = nullptr;
+  TestPacingCallback callback(
+      [&]() { scheduler.scheduleTimeout(self, 1ms); });
+  self = &callback;
+  scheduler.scheduleTimeout(&callback, 1ms);
+  std::this_thread::sleep_for(2ms);
+  scheduler.timeoutExpired();
+  // Rescheduling lands on a later tick and doesn't run it again right away.
+  EXPECT_EQ(1, callback.runCount);
+  EXPECT_TRUE(callback.isPacingTimeoutScheduled());
+  callback.cancelPacingTimeout();
+}
+
+TEST(PacingSchedulerTest, DestroyDueCallbackFromCallback) {
+  EventBase evb;
+  PacingScheduler scheduler(TimerHighRes::newTimer(&evb, 1ms));
+  auto second = std::make_unique<TestPacingCallback>();
+  TestPacingCallback first([&]() { second.reset(); });
+  scheduler.scheduleTimeout(&first, 1ms);
+  scheduler.scheduleTimeout(second.get(), 1ms);
+  std::this_thread::sleep_for(2ms);
+  scheduler.timeoutExpired();
+  EXPECT_EQ(1, first.runCount);
+  EXPECT_EQ(nullptr, second);
+  EXPECT_EQ(0, scheduler.numScheduled());
+}
+
+TEST(PacingSchedulerTest, SchedulerGoesAwayFirst) {
+  EventBase evb;
+  TestPacingCallback callback;
+  {
+    PacingScheduler scheduler(TimerHighRes::newTimer(&evb, 1ms));
+    scheduler.scheduleTimeout(&callback, 1ms);
+  }
+  EXPECT_FALSE(callback.isPacingTimeoutScheduled());
+}
+
+TEST(PacingSchedulerTest, LooperPacesOnScheduler) {
+  EventBase evb;
+  TimerHighRes::SharedPtr pacingTimer(TimerHighRes::newTimer(&evb, 123ms));
+  auto scheduler = std::make_shared<PacingScheduler>(pacingTimer);
+  std::vector<bool> fromTimerVec;
+  auto func = [&](bool fromTimer) { fromTimerVec.push_back(fromTimer); };
+  FunctionLooper::Ptr looper(
+      new FunctionLooper(&evb, std::move(func), LooperType::WriteLooper));
+  looper->setPacingTimer(pacingTimer);
+  looper->setPacingScheduler(scheduler);
+  looper->setPacingFunction([]() { return 3600000ms; });
+  EXPECT_EQ(123ms, looper->getTimerTickInterval());
+  looper->run();
+  evb.loopOnce();
+  EXPECT_EQ(1, fromTimerVec.size());
+  EXPECT_FALSE(fromTimerVec.back());
+  // The looper waits on the scheduler, not on its own timeout.
+  EXPECT_TRUE(looper->isPacingTimeoutScheduled());
+  EXPECT_FALSE(looper->isScheduled());
+  EXPECT_FALSE(looper->isLoopCallbackScheduled());
+  EXPECT_EQ(1, scheduler->numScheduled());
+
+  looper->cancelPacingTimeout();
+  looper->pacingTimeoutExpired();
+  EXPECT_EQ(2, fromTimerVec.size());
+  EXPECT_TRUE(fromTimerVec.back());
+  EXPECT_TRUE(looper->isPacingScheduled());
+
+  looper->stop();
+  EXPECT_FALSE(looper->isPacingScheduled());
+  EXPECT_EQ(0, scheduler->numScheduled());
+}
+} // namespace test
+} // namespace quic
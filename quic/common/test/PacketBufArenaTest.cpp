@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <quic/common/PacketBufArena.h>
+
+using namespace quic;
+
+TEST(PacketBufArenaTest, AllocateWithoutCache) {
+  PacketBufArena arena(1000, 2);
+  auto buf = arena.allocate();
+  EXPECT_LE(1000, buf->tailroom());
+  EXPECT_EQ(0, buf->length());
+  EXPECT_EQ(0, arena.numCachedSlabs());
+}
+
+TEST(PacketBufArenaTest, RecycleAndReuse) {
+  PacketBufArena arena(1000, 2);
+  auto buf = arena.allocate();
+  buf->append(500);
+  auto rawBuf = buf.get();
+  arena.recycle(std::move(buf));
+  EXPECT_EQ(1, arena.numCachedSlabs());
+  buf = arena.allocate();
+  EXPECT_EQ(rawBuf, buf.get());
+  EXPECT_EQ(0, buf->length());
+  EXPECT_LE(1000, buf->tailroom());
+  EXPECT_EQ(0, arena.numCachedSlabs());
+}
+
+TEST(PacketBufArenaTest, RecycleChain) {
+  PacketBufArena arena(1000, 2);
+  auto buf = arena.allocate();
+  buf->prependChain(arena.allocate());
+  buf->prependChain(arena.allocate());
+  arena.recycle(std::move(buf));
+  // Only up to the limit is cached.
+  EXPECT_EQ(2, arena.numCachedSlabs());
+  EXPECT_FALSE(arena.allocate()->isChained());
+}
+
+TEST(PacketBufArenaTest, Prefill) {
+  PacketBufArena arena(1000, 3);
+  arena.prefill(2);
+  EXPECT_EQ(2, arena.numCachedSlabs());
+  arena.prefill(10);
+  EXPECT_EQ(3, arena.numCachedSlabs());
+  auto buf = arena.allocate();
+  EXPECT_GE(buf->tailroom(), 1000);
+  EXPECT_EQ(2, arena.numCachedSlabs());
+}
+
+TEST(PacketBufArenaTest, DropUnusableBufs) {
+  PacketBufArena arena(1000, 10);
+  arena.recycle(folly::IOBuf::create(10));
+  EXPECT_EQ(0, arena.numCachedSlabs());
+
+  auto buf = arena.allocate();
+  auto clone = buf->clone();
+  arena.recycle(std::move(buf));
+  EXPECT_EQ(0, arena.numCachedSlabs());
+
+  uint8_t data[2000];
+  arena.recycle(folly::IOBuf::wrapBuffer(data, sizeof(data)));
+  EXPECT_EQ(0, arena.numCachedSlabs());
+}
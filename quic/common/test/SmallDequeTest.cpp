@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <quic/common/SmallDeque.h>
+
+#include <vector>
+
+using namespace quic;
+
+namespace {
+template <class Deque>
+std::vector<int> toVector(const Deque& deque) {
+  return std::vector<int>(deque.begin(), deque.end());
+}
+} // namespace
+
+TEST(SmallDequeTest, PushPop) {
+  SmallDeque<int, 4> deque;
+  EXPECT_TRUE(deque.empty());
+  for (int i = 0; i < 10; ++i) {
+    deque.push_back(i);
+  }
+  EXPECT_EQ(10, deque.size());
+  EXPECT_EQ(0, deque.front());
+  EXPECT_EQ(9, deque.back());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, deque.front());
+    deque.pop_front();
+  }
+  EXPECT_TRUE(deque.empty());
+  EXPECT_EQ(0, deque.size());
+}
+
+TEST(SmallDequeTest, InterleavedPushPop) {
+  // Like the delivery callbacks of a stream, pushed on writes and popped on
+  // acks, which should keep reusing the same storage.
+  SmallDeque<int, 4> deque;
+  int next = 0;
+  int expected = 0;
+  for (int round = 0; round < 100; ++round) {
+    deque.push_back(next++);
+    deque.push_back(next++);
+    EXPECT_EQ(expected++, deque.front());
+    deque.pop_front();
+  }
+  EXPECT_EQ(100, deque.size());
+  for (auto value : deque) {
+    EXPECT_EQ(expected++, value);
+  }
+}
+
+TEST(SmallDequeTest, EmplaceAndErase) {
+  SmallDeque<int, 4> deque;
+  deque.push_back(1);
+  deque.push_back(2);
+  deque.push_back(4);
+  deque.pop_front();
+  deque.emplace(deque.begin() + 1, 3);
+  EXPECT_EQ((std::vector<int>{2, 3, 4}), toVector(deque));
+  // Into the space left by the pop.
+  deque.emplace(deque.begin(), 1);
+  EXPECT_EQ((std::vector<int>{1, 2, 3, 4}), toVector(deque));
+  deque.emplace(deque.end(), 5);
+  EXPECT_EQ((std::vector<int>{1, 2, 3, 4, 5}), toVector(deque));
+
+  deque.erase(deque.begin() + 2);
+  EXPECT_EQ((std::vector<int>{1, 2, 4, 5}), toVector(deque));
+  deque.erase(deque.begin());
+  EXPECT_EQ((std::vector<int>{2, 4, 5}), toVector(deque));
+  deque.clear();
+  EXPECT_TRUE(deque.empty());
+}
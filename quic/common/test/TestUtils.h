@@ -125,6 +125,8 @@ bool isState(const S& s) {
       [](const auto&) { return false; });
 }
 
+std::shared_ptr<fizz::SelfCert> readCert();
+
 std::shared_ptr<fizz::server::FizzServerContext> createServerCtx();
 
 void setupCtxWithTestCert(fizz::server::FizzServerContext& ctx);
@@ -147,3 +147,40 @@ TEST(Variant, TestCopyVariantDifferentType) {
   ASSERT_NE(variantA.asB(), nullptr);
   EXPECT_TRUE(variantA.asB()->copied);
 }
+
+#define TEST_BOXED_VARIANT(F, ...) F(A, __VA_ARGS__)
+
+#define TEST_UNBOXED_VARIANT(F, ...) \
+  F(B, __VA_ARGS__)                  \
+  F(C, __VA_ARGS__)
+
+DECLARE_VARIANT_TYPE_WITH_BOXED(
+    TestBoxedVariant,
+    TEST_UNBOXED_VARIANT,
+    TEST_BOXED_VARIANT)
+
+TEST(Variant, TestBoxedVariant) {
+  TestBoxedVariant variantA{A()};
+  TestBoxedVariant variantB{B()};
+  EXPECT_EQ(variantA.type(), TestBoxedVariant::Type::A_E);
+  ASSERT_NE(variantA.asA(), nullptr);
+  EXPECT_EQ(variantA.asB(), nullptr);
+  EXPECT_EQ(variantB.asA(), nullptr);
+
+  // Moving the variant moves the box, not what is in it.
+  const A* boxed = variantA.asA();
+  TestBoxedVariant variantA1{std::move(variantA)};
+  EXPECT_EQ(variantA1.asA(), boxed);
+
+  TestBoxedVariant variantA2{variantA1};
+  ASSERT_NE(variantA2.asA(), nullptr);
+  EXPECT_NE(variantA2.asA(), boxed);
+  EXPECT_TRUE(variantA2.asA()->copied);
+  EXPECT_TRUE(variantA2 == variantA1);
+
+  destructor_called() = false;
+  variantA2 = std::move(variantB);
+  EXPECT_TRUE(destructor_called());
+  ASSERT_NE(variantA2.asB(), nullptr);
+  EXPECT_TRUE(variantA2.asB()->moved);
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/common/ZeroCopySendTracker.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+class ZeroCopySendTrackerTest : public Test {
+ public:
+  void SetUp() override {
+    sock_.bind(folly::SocketAddress("127.0.0.1", 0));
+    tracker_ = std::make_unique<ZeroCopySendTracker>(
+        sock_.getNetworkSocket(), &arena_);
+  }
+
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+  bool complete(uint32_t lo, uint32_t hi, bool copied = false) {
+    std::array<char, CMSG_SPACE(sizeof(sock_extended_err))> control{};
+    auto cmsg = reinterpret_cast<cmsghdr*>(control.data());
+    cmsg->cmsg_level = SOL_IP;
+    cmsg->cmsg_type = IP_RECVERR;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(sock_extended_err));
+    sock_extended_err serr{};
+    serr.ee_origin = SO_EE_ORIGIN_ZEROCOPY;
+    serr.ee_code = copied ? SO_EE_CODE_ZEROCOPY_COPIED : 0;
+    serr.ee_info = lo;
+    serr.ee_data = hi;
+    memcpy(CMSG_DATA(cmsg), &serr, sizeof(serr));
+    return tracker_->onErrMessage(*cmsg);
+  }
+#endif
+
+ protected:
+  folly::EventBase evb_;
+  folly::AsyncUDPSocket sock_{&evb_};
+  PacketBufArena arena_;
+  std::unique_ptr<ZeroCopySendTracker> tracker_;
+};
+
+TEST_F(ZeroCopySendTrackerTest, ShouldZeroCopy) {
+  auto& tracker = *tracker_;
+  EXPECT_TRUE(tracker.shouldZeroCopy(sock_, kMinZeroCopySendSize));
+  EXPECT_FALSE(tracker.shouldZeroCopy(sock_, kMinZeroCopySendSize - 1));
+
+  folly::AsyncUDPSocket otherSock(&evb_);
+  otherSock.bind(folly::SocketAddress("127.0.0.1", 0));
+  EXPECT_FALSE(tracker.shouldZeroCopy(otherSock, kMinZeroCopySendSize));
+
+  for (size_t i = 0; i < kMaxPendingZeroCopySends; ++i) {
+    tracker.onSent(folly::IOBuf::create(10));
+  }
+  EXPECT_FALSE(tracker.shouldZeroCopy(sock_, kMinZeroCopySendSize));
+}
+
+#ifdef FOLLY_HAVE_MSG_ERRQUEUE
+TEST_F(ZeroCopySendTrackerTest, Completions) {
+  for (int i = 0; i < 4; ++i) {
+    auto buf = arena_.allocate();
+    buf->append(10);
+    tracker_->onSent(std::move(buf));
+  }
+  EXPECT_TRUE(complete(0, 1));
+  EXPECT_EQ(2, tracker_->numPendingSends());
+  EXPECT_EQ(2, arena_.numCachedSlabs());
+  // Out of order.
+  EXPECT_TRUE(complete(3, 3));
+  EXPECT_EQ(1, tracker_->numPendingSends());
+  EXPECT_FALSE(tracker_->kernelCopied());
+  EXPECT_TRUE(complete(2, 2, true));
+  EXPECT_EQ(0, tracker_->numPendingSends());
+  EXPECT_TRUE(tracker_->kernelCopied());
+  EXPECT_FALSE(tracker_->shouldZeroCopy(sock_, kMinZeroCopySendSize));
+}
+
+TEST_F(ZeroCopySendTrackerTest, OtherErrors) {
+  tracker_->onSent(folly::IOBuf::create(10));
+  std::array<char, CMSG_SPACE(sizeof(sock_extended_err))> control{};
+  auto cmsg = reinterpret_cast<cmsghdr*>(control.data());
+  cmsg->cmsg_level = SOL_IP;
+  cmsg->cmsg_type = IP_RECVERR;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(sock_extended_err));
+  sock_extended_err serr{};
+  serr.ee_errno = ECONNREFUSED;
+  serr.ee_origin = SO_EE_ORIGIN_ICMP;
+  memcpy(CMSG_DATA(cmsg), &serr, sizeof(serr));
+  EXPECT_FALSE(tracker_->onErrMessage(*cmsg));
+  EXPECT_EQ(1, tracker_->numPendingSends());
+}
+#endif
+
+} // namespace test
+} // namespace quic
@@ -50,7 +50,7 @@ bool BbrCongestionController::updateRoundTripCounter(
     TimePoint largestAckedSentTime) noexcept {
   if (largestAckedSentTime > endOfRoundTrip_) {
     roundTripCounter_++;
-    endOfRoundTrip_ = Clock::now();
+    endOfRoundTrip_ = endOfSentPackets(lastSentTime_);
     return true;
   }
   return false;
@@ -69,7 +69,7 @@ void BbrCongestionController::setBandwidthSampler(
 void BbrCongestionController::onPacketLoss(
     const LossEvent& loss,
     uint64_t ackedBytes) {
-  endOfRecovery_ = Clock::now();
+  endOfRecovery_ = endOfSentPackets(lastSentTime_);
 
   if (!inRecovery()) {
     recoveryState_ = BbrCongestionController::RecoveryState::CONSERVATIVE;
@@ -82,7 +82,7 @@ void BbrCongestionController::onPacketLoss(
 
     // We need to make sure CONSERVATIVE can last for a round trip, so update
     // endOfRoundTrip_ to the latest sent packet.
-    endOfRoundTrip_ = Clock::now();
+    endOfRoundTrip_ = *endOfRecovery_;
 
     // TODO: maybe set appLimited in recovery based on config
   }
@@ -117,6 +117,7 @@ void BbrCongestionController::onPacketSent(const OutstandingPacket& packet) {
     exitingQuiescene_ = true;
   }
   addAndCheckOverflow(conn_.lossState.inflightBytes, packet.encodedSize);
+  lastSentTime_ = std::max(lastSentTime_, packet.time);
   if (!ackAggregationStartTime_) {
     ackAggregationStartTime_ = packet.time;
   }
@@ -572,6 +573,14 @@ uint64_t BbrCongestionController::getCongestionWindow() const noexcept {
   return cwnd_;
 }
 
+folly::Optional<Bandwidth> BbrCongestionController::getBandwidth() const {
+  auto bandwidthEst = bandwidth();
+  if (!bandwidthEst) {
+    return folly::none;
+  }
+  return bandwidthEst;
+}
+
 void BbrCongestionController::detectBottleneckBandwidth(bool appLimitedSample) {
   if (btlbwFound_) {
     return;
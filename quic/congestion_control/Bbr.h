@@ -120,6 +120,7 @@ class BbrCongestionController : public CongestionController {
   uint64_t getWritableBytes() const noexcept override;
 
   uint64_t getCongestionWindow() const noexcept override;
+  folly::Optional<Bandwidth> getBandwidth() const override;
   CongestionControlType type() const noexcept override;
   void setAppIdle(bool idle, TimePoint eventTime) noexcept override;
   void setAppLimited() override;
@@ -202,6 +203,8 @@ class BbrCongestionController : public CongestionController {
   // When a packet with send time later than endOfRecovery_ is acked, the
   // connection is no longer in recovery
   folly::Optional<TimePoint> endOfRecovery_;
+  // Latest send time of the packets sent so far.
+  TimePoint lastSentTime_;
   // Cwnd in bytes
   uint64_t cwnd_;
   // Initial cwnd in bytes
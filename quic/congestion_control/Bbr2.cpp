@@ -0,0 +1,694 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/congestion_control/Bbr2.h>
+#include <folly/Random.h>
+#include <quic/QuicConstants.h>
+#include <quic/common/TimeUtil.h>
+#include <quic/congestion_control/CongestionControlFunctions.h>
+#include <quic/logging/QLoggerConstants.h>
+#include <quic/logging/QuicLogger.h>
+
+using namespace std::chrono_literals;
+
+namespace {
+quic::Bandwidth kLowPacingRateForSendQuantum{1200 * 1000, 1s};
+quic::Bandwidth kHighPacingRateForSendQuantum{24, 1us};
+// See BBRInflight(gain) function in
+// https://tools.ietf.org/html/draft-cardwell-iccrg-bbr-congestion-control-00#section-4.2.3.2
+uint64_t kQuantaFactor = 3;
+// Caps the exponential growth of inflightHi_ in ProbeBw Up.
+uint8_t kMaxProbeUpRounds = 30;
+} // namespace
+
+namespace quic {
+
+Bbr2CongestionController::Bbr2CongestionController(
+    QuicConnectionStateBase& conn)
+    : conn_(conn),
+      cwnd_(conn.udpSendPacketLen * conn.transportSettings.initCwndInMss),
+      initialCwnd_(
+          conn.udpSendPacketLen * conn.transportSettings.initCwndInMss),
+      pacingWindow_(
+          conn.udpSendPacketLen * conn.transportSettings.initCwndInMss) {
+  QUIC_TRACE(initcwnd, conn_, initialCwnd_);
+}
+
+CongestionControlType Bbr2CongestionController::type() const noexcept {
+  return CongestionControlType::BBR2;
+}
+
+bool Bbr2CongestionController::updateRoundTripCounter(
+    TimePoint largestAckedSentTime) noexcept {
+  if (largestAckedSentTime > endOfRoundTrip_) {
+    roundTripCounter_++;
+    endOfRoundTrip_ = endOfSentPackets(lastSentTime_);
+    return true;
+  }
+  return false;
+}
+
+void Bbr2CongestionController::setRttSampler(
+    std::unique_ptr<BbrCongestionController::MinRttSampler> sampler) noexcept {
+  minRttSampler_ = std::move(sampler);
+}
+
+void Bbr2CongestionController::setBandwidthSampler(
+    std::unique_ptr<BbrCongestionController::BandwidthSampler>
+        sampler) noexcept {
+  bandwidthSampler_ = std::move(sampler);
+}
+
+void Bbr2CongestionController::onPacketSent(const OutstandingPacket& packet) {
+  if (!conn_.lossState.inflightBytes && isAppLimited()) {
+    exitingQuiescene_ = true;
+  }
+  addAndCheckOverflow(conn_.lossState.inflightBytes, packet.encodedSize);
+  lastSentTime_ = std::max(lastSentTime_, packet.time);
+}
+
+void Bbr2CongestionController::onPacketAckOrLoss(
+    folly::Optional<AckEvent> ackEvent,
+    folly::Optional<LossEvent> lossEvent) {
+  auto prevInflightBytes = conn_.lossState.inflightBytes;
+  if (ackEvent) {
+    subtractAndCheckUnderflow(
+        conn_.lossState.inflightBytes, ackEvent->ackedBytes);
+  }
+  if (lossEvent) {
+    subtractAndCheckUnderflow(
+        conn_.lossState.inflightBytes, lossEvent->lostBytes);
+  }
+  if (lossEvent) {
+    onPacketLoss(*lossEvent, prevInflightBytes);
+    if (conn_.pacer) {
+      conn_.pacer->onPacketsLoss();
+    }
+  }
+  if (ackEvent && ackEvent->largestAckedPacket.has_value()) {
+    CHECK(!ackEvent->ackedPackets.empty());
+    onPacketAcked(*ackEvent, prevInflightBytes);
+  }
+}
+
+void Bbr2CongestionController::onPacketLoss(
+    const LossEvent& loss,
+    uint64_t prevInflightBytes) {
+  lostBytesInRound_ += loss.lostBytes;
+  lostPacketsInRound_ += loss.lostPackets;
+  if (isInflightTooHigh()) {
+    handleInflightTooHigh(prevInflightBytes, loss.lossTime);
+  }
+
+  if (loss.persistentCongestion) {
+    cwnd_ = conn_.udpSendPacketLen * kMinCwndInMssForBbr;
+    inflightLo_ = cwnd_;
+    if (conn_.qLogger) {
+      conn_.qLogger->addCongestionMetricUpdate(
+          conn_.lossState.inflightBytes,
+          getCongestionWindow(),
+          kPersistentCongestion,
+          bbr2StateToString(state_));
+    }
+    QUIC_TRACE(
+        bbr2_persistent_congestion,
+        conn_,
+        bbr2StateToString(state_),
+        cwnd_,
+        conn_.lossState.inflightBytes);
+  }
+}
+
+void Bbr2CongestionController::onPacketsCeMarked(
+    uint64_t ceMarkedPackets,
+    TimePoint /* largestAckedSentTime */) {
+  // CE marks back off the short term bounds at the end of the round, like
+  // loss does. They don't count towards the loss rate of inflightHi_.
+  ceMarkedPacketsInRound_ += ceMarkedPackets;
+  if (conn_.qLogger) {
+    conn_.qLogger->addCongestionMetricUpdate(
+        conn_.lossState.inflightBytes,
+        getCongestionWindow(),
+        kCongestionPacketsCeMarked,
+        bbr2StateToString(state_));
+  }
+}
+
+bool Bbr2CongestionController::isInflightTooHigh() const noexcept {
+  if (lostPacketsInRound_ == 0) {
+    return false;
+  }
+  return lostBytesInRound_ >
+      (ackedBytesInRound_ + lostBytesInRound_) * kBbr2LossThreshold;
+}
+
+void Bbr2CongestionController::handleInflightTooHigh(
+    uint64_t prevInflightBytes,
+    TimePoint lossTime) noexcept {
+  if (state_ == Bbr2State::Startup) {
+    // A single lost packet doesn't say much about the bottleneck yet.
+    if (lostPacketsInRound_ < kBbr2StartupFullLossCount) {
+      return;
+    }
+    btlbwFound_ = true;
+    inflightHi_ = std::max(prevInflightBytes, calculateTargetCwnd(1.0));
+    return;
+  }
+  if (state_ == Bbr2State::ProbeBw &&
+      (probeBwPhase_ == ProbeBwPhase::Refill ||
+       probeBwPhase_ == ProbeBwPhase::Up)) {
+    // The probe went past what the path can hold, remember that and back off.
+    inflightHi_ = std::max<uint64_t>(
+        prevInflightBytes, calculateTargetCwnd(1.0) * kBbr2Beta);
+    startProbeBwPhase(ProbeBwPhase::Down, lossTime);
+  }
+}
+
+void Bbr2CongestionController::adaptLowerBounds(TimePoint ackTime) noexcept {
+  if (state_ == Bbr2State::Startup ||
+      (state_ == Bbr2State::ProbeBw &&
+       (probeBwPhase_ == ProbeBwPhase::Refill ||
+        probeBwPhase_ == ProbeBwPhase::Up))) {
+    // Loss while probing is handled by inflightHi_.
+    return;
+  }
+  auto maxBandwidth =
+      bandwidthSampler_ ? bandwidthSampler_->getBandwidth() : Bandwidth();
+  if (maxBandwidth) {
+    if (!bwLo_) {
+      bwLo_ = maxBandwidth;
+    }
+    Bandwidth latestBandwidth;
+    if (roundStart_ && ackTime > *roundStart_) {
+      latestBandwidth = Bandwidth(
+          ackedBytesInRound_,
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              ackTime - *roundStart_));
+    }
+    auto backedOffBandwidth = *bwLo_ * kBbr2Beta;
+    bwLo_ = latestBandwidth > backedOffBandwidth ? latestBandwidth
+                                                 : backedOffBandwidth;
+  }
+  if (!inflightLo_) {
+    inflightLo_ = cwnd_;
+  }
+  inflightLo_ =
+      std::max<uint64_t>(ackedBytesInRound_, *inflightLo_ * kBbr2Beta);
+}
+
+void Bbr2CongestionController::resetLowerBounds() noexcept {
+  bwLo_ = folly::none;
+  inflightLo_ = folly::none;
+}
+
+void Bbr2CongestionController::probeInflightHiUpward(
+    uint64_t ackedBytes,
+    uint64_t prevInflightBytes) noexcept {
+  if (!inflightHi_ ||
+      prevInflightBytes + conn_.udpSendPacketLen < *inflightHi_) {
+    // Only grow the bound when it's what limits the sending.
+    return;
+  }
+  // inflightHi_ grows by 2^probeUpRounds_ packets per cwnd of acked bytes, so
+  // the growth doubles every round.
+  probeUpAckedBytes_ += ackedBytes;
+  auto cwnd = getCongestionWindow();
+  if (probeUpAckedBytes_ < cwnd) {
+    return;
+  }
+  auto cwndsAcked = probeUpAckedBytes_ / cwnd;
+  probeUpAckedBytes_ -= cwndsAcked * cwnd;
+  inflightHi_ = std::min(
+      *inflightHi_ +
+          cwndsAcked * (conn_.udpSendPacketLen << probeUpRounds_),
+      conn_.udpSendPacketLen * conn_.transportSettings.maxCwndInMss);
+}
+
+void Bbr2CongestionController::onPacketAcked(
+    const AckEvent& ack,
+    uint64_t prevInflightBytes) {
+  if (ack.mrttSample && minRttSampler_) {
+    minRttSampler_->newRttSample(ack.mrttSample.value(), ack.ackTime);
+  }
+
+  bool newRoundTrip = updateRoundTripCounter(ack.largestAckedPacketSentTime);
+  bool lastAckedPacketAppLimited =
+      ack.ackedPackets.empty() ? false : ack.largestAckedPacketAppLimited;
+  if (bandwidthSampler_) {
+    bool wasAppLimited = bandwidthSampler_->isAppLimited();
+    bandwidthSampler_->onPacketAcked(ack, roundTripCounter_);
+    if (wasAppLimited && !bandwidthSampler_->isAppLimited()) {
+      if (conn_.pacer) {
+        conn_.pacer->setAppLimited(false);
+      }
+    }
+  }
+
+  if (newRoundTrip) {
+    if (lostPacketsInRound_ > 0 || ceMarkedPacketsInRound_ > 0) {
+      adaptLowerBounds(ack.ackTime);
+    }
+    ackedBytesInRound_ = 0;
+    lostBytesInRound_ = 0;
+    lostPacketsInRound_ = 0;
+    ceMarkedPacketsInRound_ = 0;
+    roundStart_ = ack.ackTime;
+  } else if (!roundStart_) {
+    roundStart_ = ack.ackTime;
+  }
+  ackedBytesInRound_ += ack.ackedBytes;
+
+  if (state_ == Bbr2State::ProbeBw) {
+    handleAckInProbeBw(
+        newRoundTrip, ack.ackTime, ack.ackedBytes, prevInflightBytes);
+  }
+
+  if (newRoundTrip && !lastAckedPacketAppLimited) {
+    detectBottleneckBandwidth(lastAckedPacketAppLimited);
+  }
+
+  if (state_ == Bbr2State::Startup && btlbwFound_) {
+    transitToDrain();
+  }
+
+  if (state_ == Bbr2State::Drain &&
+      conn_.lossState.inflightBytes <= calculateTargetCwnd(1.0)) {
+    transitToProbeBw(ack.ackTime);
+  }
+
+  if (shouldProbeRtt()) {
+    transitToProbeRtt();
+  }
+  exitingQuiescene_ = false;
+
+  if (state_ == Bbr2State::ProbeRtt && minRttSampler_) {
+    handleAckInProbeRtt(newRoundTrip, ack.ackTime);
+  }
+
+  updateCwnd(ack.ackedBytes);
+  updatePacing();
+  if (conn_.qLogger) {
+    conn_.qLogger->addCongestionMetricUpdate(
+        conn_.lossState.inflightBytes,
+        getCongestionWindow(),
+        kCongestionPacketAck,
+        bbr2StateToString(state_));
+  }
+  QUIC_TRACE(
+      bbr2_ack,
+      conn_,
+      bbr2StateToString(state_),
+      bbr2ProbeBwPhaseToString(probeBwPhase_),
+      getCongestionWindow(),
+      cwnd_,
+      sendQuantum_,
+      conn_.lossState.inflightBytes);
+}
+
+void Bbr2CongestionController::updatePacing() noexcept {
+  if (!conn_.pacer) {
+    return;
+  }
+  if (conn_.lossState.totalBytesSent < initialCwnd_) {
+    return;
+  }
+  auto bandwidthEstimate = bandwidth();
+  if (!bandwidthEstimate) {
+    return;
+  }
+  auto mrtt = minRtt();
+  uint64_t targetPacingWindow = bandwidthEstimate * pacingGain_ * mrtt;
+  if (btlbwFound_) {
+    pacingWindow_ = targetPacingWindow;
+  } else {
+    pacingWindow_ = std::max(pacingWindow_, targetPacingWindow);
+  }
+  conn_.pacer->refreshPacingRate(pacingWindow_, mrtt);
+}
+
+void Bbr2CongestionController::handleAckInProbeBw(
+    bool newRoundTrip,
+    TimePoint ackTime,
+    uint64_t ackedBytes,
+    uint64_t prevInflightBytes) noexcept {
+  switch (probeBwPhase_) {
+    case ProbeBwPhase::Down: {
+      if (ackTime - cycleStart_ >= probeWait_) {
+        startProbeBwPhase(ProbeBwPhase::Refill, ackTime);
+        break;
+      }
+      // Done draining once inflight fits in both the bdp and the headroom
+      // under inflightHi_.
+      auto drainTarget = calculateTargetCwnd(1.0);
+      if (inflightHi_) {
+        drainTarget = std::min<uint64_t>(
+            drainTarget, *inflightHi_ * (1.0f - kBbr2Headroom));
+      }
+      if (conn_.lossState.inflightBytes <= drainTarget) {
+        startProbeBwPhase(ProbeBwPhase::Cruise, ackTime);
+      }
+      break;
+    }
+    case ProbeBwPhase::Cruise:
+      if (ackTime - cycleStart_ >= probeWait_) {
+        startProbeBwPhase(ProbeBwPhase::Refill, ackTime);
+      }
+      break;
+    case ProbeBwPhase::Refill:
+      // Refill lasts one round, so the pipe is full before probing up.
+      if (newRoundTrip) {
+        startProbeBwPhase(ProbeBwPhase::Up, ackTime);
+      }
+      break;
+    case ProbeBwPhase::Up:
+      if (newRoundTrip && probeUpRounds_ < kMaxProbeUpRounds) {
+        probeUpRounds_++;
+      }
+      probeInflightHiUpward(ackedBytes, prevInflightBytes);
+      if (ackTime - phaseStart_ > minRtt() &&
+          prevInflightBytes >= calculateTargetCwnd(kBbr2ProbeUpPacingGain)) {
+        startProbeBwPhase(ProbeBwPhase::Down, ackTime);
+      }
+      break;
+  }
+}
+
+void Bbr2CongestionController::startProbeBwPhase(
+    ProbeBwPhase phase,
+    TimePoint eventTime) noexcept {
+  DCHECK(state_ == Bbr2State::ProbeBw);
+  probeBwPhase_ = phase;
+  phaseStart_ = eventTime;
+  switch (phase) {
+    case ProbeBwPhase::Down:
+      pacingGain_ = kBbr2ProbeDownPacingGain;
+      cycleStart_ = eventTime;
+      probeWait_ = kBbr2ProbeWaitBase +
+          std::chrono::milliseconds(
+                       folly::Random::rand32(kBbr2ProbeWaitRandom.count()));
+      break;
+    case ProbeBwPhase::Cruise:
+      pacingGain_ = 1.0f;
+      break;
+    case ProbeBwPhase::Refill:
+      resetLowerBounds();
+      probeUpRounds_ = 0;
+      probeUpAckedBytes_ = 0;
+      pacingGain_ = 1.0f;
+      // Make sure Refill lasts for a full round trip.
+      endOfRoundTrip_ = endOfSentPackets(lastSentTime_);
+      break;
+    case ProbeBwPhase::Up:
+      pacingGain_ = kBbr2ProbeUpPacingGain;
+      break;
+  }
+}
+
+bool Bbr2CongestionController::shouldProbeRtt() const noexcept {
+  return state_ != Bbr2State::ProbeRtt && minRttSampler_ &&
+      !exitingQuiescene_ && minRttSampler_->minRttExpired();
+}
+
+void Bbr2CongestionController::handleAckInProbeRtt(
+    bool newRoundTrip,
+    TimePoint ackTime) noexcept {
+  DCHECK(state_ == Bbr2State::ProbeRtt);
+  CHECK(minRttSampler_);
+
+  if (bandwidthSampler_) {
+    bandwidthSampler_->onAppLimited();
+  }
+  if (!earliestTimeToExitProbeRtt_ &&
+      conn_.lossState.inflightBytes <
+          getCongestionWindow() + conn_.udpSendPacketLen) {
+    earliestTimeToExitProbeRtt_ = ackTime + kProbeRttDuration;
+    probeRttRound_ = folly::none;
+    return;
+  }
+  if (earliestTimeToExitProbeRtt_) {
+    if (!probeRttRound_ && newRoundTrip) {
+      probeRttRound_ = roundTripCounter_;
+    }
+    if (probeRttRound_ && *earliestTimeToExitProbeRtt_ <= ackTime) {
+      minRttSampler_->timestampMinRtt(ackTime);
+      if (btlbwFound_) {
+        // Go back to ProbeBw without probing right away, the cycle restarts
+        // from Cruise.
+        resetLowerBounds();
+        transitToProbeBw(ackTime);
+        startProbeBwPhase(ProbeBwPhase::Cruise, ackTime);
+      } else {
+        transitToStartup();
+      }
+    }
+  }
+}
+
+void Bbr2CongestionController::transitToStartup() noexcept {
+  state_ = Bbr2State::Startup;
+  pacingGain_ = kBbr2StartupPacingGain;
+  cwndGain_ = kBbr2StartupCwndGain;
+}
+
+void Bbr2CongestionController::transitToProbeRtt() noexcept {
+  state_ = Bbr2State::ProbeRtt;
+  pacingGain_ = 1.0f;
+  earliestTimeToExitProbeRtt_ = folly::none;
+  probeRttRound_ = folly::none;
+  if (bandwidthSampler_) {
+    bandwidthSampler_->onAppLimited();
+  }
+}
+
+void Bbr2CongestionController::transitToDrain() noexcept {
+  state_ = Bbr2State::Drain;
+  pacingGain_ = 1.0f / kBbr2StartupPacingGain;
+  cwndGain_ = kBbr2StartupCwndGain;
+}
+
+void Bbr2CongestionController::transitToProbeBw(TimePoint eventTime) noexcept {
+  state_ = Bbr2State::ProbeBw;
+  cwndGain_ = kBbr2ProbeBwCwndGain;
+  startProbeBwPhase(ProbeBwPhase::Down, eventTime);
+}
+
+Bbr2CongestionController::Bbr2State Bbr2CongestionController::state() const
+    noexcept {
+  return state_;
+}
+
+Bbr2CongestionController::ProbeBwPhase
+Bbr2CongestionController::probeBwPhase() const noexcept {
+  return probeBwPhase_;
+}
+
+folly::Optional<uint64_t> Bbr2CongestionController::inflightHi() const
+    noexcept {
+  return inflightHi_;
+}
+
+folly::Optional<uint64_t> Bbr2CongestionController::inflightLo() const
+    noexcept {
+  return inflightLo_;
+}
+
+uint64_t Bbr2CongestionController::getWritableBytes() const noexcept {
+  return getCongestionWindow() > conn_.lossState.inflightBytes
+      ? getCongestionWindow() - conn_.lossState.inflightBytes
+      : 0;
+}
+
+std::chrono::microseconds Bbr2CongestionController::minRtt() const noexcept {
+  return minRttSampler_ ? minRttSampler_->minRtt() : 0us;
+}
+
+Bandwidth Bbr2CongestionController::bandwidth() const noexcept {
+  auto maxBandwidth =
+      bandwidthSampler_ ? bandwidthSampler_->getBandwidth() : Bandwidth();
+  if (bwLo_ && *bwLo_ < maxBandwidth) {
+    return *bwLo_;
+  }
+  return maxBandwidth;
+}
+
+uint64_t Bbr2CongestionController::calculateTargetCwnd(float gain) const
+    noexcept {
+  auto bandwidthEst = bandwidth();
+  auto minRttEst = minRtt();
+  if (!bandwidthEst || minRttEst == 0us) {
+    return gain * initialCwnd_;
+  }
+  uint64_t bdp = bandwidthEst * minRttEst;
+  return bdp * gain + kQuantaFactor * sendQuantum_;
+}
+
+void Bbr2CongestionController::updateCwnd(uint64_t ackedBytes) noexcept {
+  if (state_ == Bbr2State::ProbeRtt) {
+    return;
+  }
+
+  auto pacingRate = bandwidth() * pacingGain_;
+  if (pacingRate < kLowPacingRateForSendQuantum) {
+    sendQuantum_ = conn_.udpSendPacketLen;
+  } else if (pacingRate < kHighPacingRateForSendQuantum) {
+    sendQuantum_ = conn_.udpSendPacketLen * 2;
+  } else {
+    sendQuantum_ = std::min(pacingRate * 1000us, k64K);
+  }
+  auto targetCwnd = calculateTargetCwnd(cwndGain_);
+  if (btlbwFound_) {
+    cwnd_ = std::min(targetCwnd, cwnd_ + ackedBytes);
+  } else if (
+      cwnd_ < targetCwnd || conn_.lossState.totalBytesAcked < initialCwnd_) {
+    cwnd_ += ackedBytes;
+  }
+
+  cwnd_ = boundedCwnd(
+      cwnd_,
+      conn_.udpSendPacketLen,
+      conn_.transportSettings.maxCwndInMss,
+      kMinCwndInMssForBbr);
+}
+
+void Bbr2CongestionController::setAppIdle(
+    bool idle,
+    TimePoint /* eventTime */) noexcept {
+  if (conn_.qLogger) {
+    conn_.qLogger->addAppIdleUpdate(kAppIdle, idle);
+  }
+  QUIC_TRACE(bbr2_appidle, conn_, idle);
+}
+
+void Bbr2CongestionController::setAppLimited() {
+  if (conn_.lossState.inflightBytes > getCongestionWindow()) {
+    return;
+  }
+  if (bandwidthSampler_) {
+    bandwidthSampler_->onAppLimited();
+  }
+  if (conn_.pacer) {
+    conn_.pacer->setAppLimited(true);
+  }
+}
+
+bool Bbr2CongestionController::isAppLimited() const noexcept {
+  return bandwidthSampler_ ? bandwidthSampler_->isAppLimited() : false;
+}
+
+uint64_t Bbr2CongestionController::getCongestionWindow() const noexcept {
+  if (state_ == Bbr2State::ProbeRtt) {
+    return boundedCwnd(
+        calculateTargetCwnd(kBbr2ProbeRttCwndGain),
+        conn_.udpSendPacketLen,
+        conn_.transportSettings.maxCwndInMss,
+        kMinCwndInMssForBbr);
+  }
+
+  uint64_t cwnd = cwnd_;
+  if (inflightHi_) {
+    // Only probing is allowed to use all of inflightHi_.
+    bool probing = state_ == Bbr2State::Startup ||
+        (state_ == Bbr2State::ProbeBw &&
+         (probeBwPhase_ == ProbeBwPhase::Refill ||
+          probeBwPhase_ == ProbeBwPhase::Up));
+    uint64_t inflightCap =
+        probing ? *inflightHi_ : *inflightHi_ * (1.0f - kBbr2Headroom);
+    cwnd = std::min(cwnd, inflightCap);
+  }
+  if (inflightLo_) {
+    cwnd = std::min(cwnd, *inflightLo_);
+  }
+  return boundedCwnd(
+      cwnd,
+      conn_.udpSendPacketLen,
+      conn_.transportSettings.maxCwndInMss,
+      kMinCwndInMssForBbr);
+}
+
+folly::Optional<Bandwidth> Bbr2CongestionController::getBandwidth() const {
+  auto bandwidthEst = bandwidth();
+  if (!bandwidthEst) {
+    return folly::none;
+  }
+  return bandwidthEst;
+}
+
+void Bbr2CongestionController::detectBottleneckBandwidth(
+    bool appLimitedSample) {
+  if (btlbwFound_) {
+    return;
+  }
+  if (appLimitedSample) {
+    return;
+  }
+
+  auto bandwidthTarget = previousStartupBandwidth_ * kExpectedStartupGrowth;
+  auto realBandwidth = bandwidth();
+  if (realBandwidth >= bandwidthTarget) {
+    previousStartupBandwidth_ = realBandwidth;
+    slowStartupRoundCounter_ = 0;
+    return;
+  }
+
+  if (++slowStartupRoundCounter_ >= kStartupSlowGrowRoundLimit) {
+    btlbwFound_ = true;
+  }
+}
+
+void Bbr2CongestionController::onRemoveBytesFromInflight(
+    uint64_t bytesToRemove) {
+  subtractAndCheckUnderflow(conn_.lossState.inflightBytes, bytesToRemove);
+}
+
+std::string bbr2StateToString(Bbr2CongestionController::Bbr2State state) {
+  switch (state) {
+    case Bbr2CongestionController::Bbr2State::Startup:
+      return "Startup";
+    case Bbr2CongestionController::Bbr2State::Drain:
+      return "Drain";
+    case Bbr2CongestionController::Bbr2State::ProbeBw:
+      return "ProbeBw";
+    case Bbr2CongestionController::Bbr2State::ProbeRtt:
+      return "ProbeRtt";
+  }
+  return "BadBbr2State";
+}
+
+std::string bbr2ProbeBwPhaseToString(
+    Bbr2CongestionController::ProbeBwPhase phase) {
+  switch (phase) {
+    case Bbr2CongestionController::ProbeBwPhase::Down:
+      return "Down";
+    case Bbr2CongestionController::ProbeBwPhase::Cruise:
+      return "Cruise";
+    case Bbr2CongestionController::ProbeBwPhase::Refill:
+      return "Refill";
+    case Bbr2CongestionController::ProbeBwPhase::Up:
+      return "Up";
+  }
+  return "BadProbeBwPhase";
+}
+
+std::ostream& operator<<(
+    std::ostream& os,
+    const Bbr2CongestionController& bbr) {
+  os << "Bbr2: state=" << bbr2StateToString(bbr.state_)
+     << ", phase=" << bbr2ProbeBwPhaseToString(bbr.probeBwPhase_)
+     << ", pacingWindow_=" << bbr.pacingWindow_
+     << ", pacingGain_=" << bbr.pacingGain_
+     << ", minRtt=" << bbr.minRtt().count()
+     << "us, bandwidth=" << bbr.bandwidth();
+  if (bbr.inflightHi_) {
+    os << ", inflightHi_=" << *bbr.inflightHi_;
+  }
+  if (bbr.inflightLo_) {
+    os << ", inflightLo_=" << *bbr.inflightLo_;
+  }
+  return os;
+}
+} // namespace quic
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/congestion_control/Bandwidth.h>
+#include <quic/congestion_control/Bbr.h>
+#include <quic/state/StateData.h>
+#include <quic/state/TransportSettings.h>
+
+namespace quic {
+
+// Pacing gain during STARTUP. This is 4 * ln(2), which is the smallest gain
+// that still doubles the delivery rate every round.
+constexpr float kBbr2StartupPacingGain = 2.77f;
+// Cwnd gain during STARTUP
+constexpr float kBbr2StartupCwndGain = 2.0f;
+// Cwnd gain during ProbeBw
+constexpr float kBbr2ProbeBwCwndGain = 2.0f;
+// Pacing gains of the ProbeBw phases
+constexpr float kBbr2ProbeDownPacingGain = 0.9f;
+constexpr float kBbr2ProbeUpPacingGain = 1.25f;
+// Cwnd gain during ProbeRtt
+constexpr float kBbr2ProbeRttCwndGain = 0.5f;
+// The highest loss rate in one round that is not taken as a congestion signal
+constexpr float kBbr2LossThreshold = 0.02f;
+// Multiplicative decrease of the short term bounds upon a round with loss
+constexpr float kBbr2Beta = 0.7f;
+// Fraction of inflightHi_ left unused when not probing, so that cross traffic
+// has room to grow.
+constexpr float kBbr2Headroom = 0.15f;
+// Number of lost packets in one round that, together with a loss rate above
+// kBbr2LossThreshold, ends STARTUP.
+constexpr uint64_t kBbr2StartupFullLossCount = 8;
+// BBRv2 probes min rtt more often with a smaller cwnd drop than BBR.
+constexpr std::chrono::seconds kBbr2RttSamplerExpiration{5};
+// Time spent in ProbeBw Cruise before the next bandwidth probe is between
+// kBbr2ProbeWaitBase and kBbr2ProbeWaitBase + kBbr2ProbeWaitRandom.
+constexpr std::chrono::milliseconds kBbr2ProbeWaitBase{2000};
+constexpr std::chrono::milliseconds kBbr2ProbeWaitRandom{1000};
+
+/**
+ * BBRv2 (draft-cardwell-iccrg-bbr-congestion-control-01). On top of the BBR
+ * model of bottleneck bandwidth and min rtt, it keeps a long term bound on
+ * inflight bytes (inflightHi_) learned from loss when probing, and short term
+ * bounds (bwLo_, inflightLo_) that back off upon rounds with loss.
+ *
+ * It uses the same samplers as BbrCongestionController.
+ */
+class Bbr2CongestionController : public CongestionController {
+ public:
+  explicit Bbr2CongestionController(QuicConnectionStateBase& conn);
+
+  void setRttSampler(
+      std::unique_ptr<BbrCongestionController::MinRttSampler> sampler) noexcept;
+  void setBandwidthSampler(
+      std::unique_ptr<BbrCongestionController::BandwidthSampler>
+          sampler) noexcept;
+
+  enum class Bbr2State : uint8_t {
+    Startup,
+    Drain,
+    ProbeBw,
+    ProbeRtt,
+  };
+
+  enum class ProbeBwPhase : uint8_t {
+    Down,
+    Cruise,
+    Refill,
+    Up,
+  };
+
+  void onRemoveBytesFromInflight(uint64_t bytesToRemove) override;
+  void onPacketSent(const OutstandingPacket&) override;
+  void onPacketAckOrLoss(
+      folly::Optional<AckEvent> ackEvent,
+      folly::Optional<LossEvent> lossEvent) override;
+  void onPacketsCeMarked(
+      uint64_t ceMarkedPackets,
+      TimePoint largestAckedSentTime) override;
+  uint64_t getWritableBytes() const noexcept override;
+
+  uint64_t getCongestionWindow() const noexcept override;
+  folly::Optional<Bandwidth> getBandwidth() const override;
+  CongestionControlType type() const noexcept override;
+  void setAppIdle(bool idle, TimePoint eventTime) noexcept override;
+  void setAppLimited() override;
+
+  bool isAppLimited() const noexcept override;
+
+  Bbr2State state() const noexcept;
+  ProbeBwPhase probeBwPhase() const noexcept;
+  folly::Optional<uint64_t> inflightHi() const noexcept;
+  folly::Optional<uint64_t> inflightLo() const noexcept;
+
+ private:
+  /* prevInflightBytes: the inflightBytes value before the current
+   *                    onPacketAckOrLoss invocation.
+   */
+  void onPacketAcked(const AckEvent& ack, uint64_t prevInflightBytes);
+  void onPacketLoss(const LossEvent& loss, uint64_t prevInflightBytes);
+  void updatePacing() noexcept;
+
+  /*
+   * Return if we are at the start of a new round trip.
+   */
+  bool updateRoundTripCounter(TimePoint largestAckedSentTime) noexcept;
+
+  /**
+   * Whether the loss seen so far in the current round is over
+   * kBbr2LossThreshold.
+   */
+  bool isInflightTooHigh() const noexcept;
+  void handleInflightTooHigh(
+      uint64_t prevInflightBytes,
+      TimePoint lossTime) noexcept;
+  // Back off the short term bounds at the end of a round with loss.
+  void adaptLowerBounds(TimePoint ackTime) noexcept;
+  void resetLowerBounds() noexcept;
+  // Grow inflightHi_ while probing up and not seeing too much loss.
+  void probeInflightHiUpward(
+      uint64_t ackedBytes,
+      uint64_t prevInflightBytes) noexcept;
+
+  void detectBottleneckBandwidth(bool appLimitedSample);
+  bool shouldProbeRtt() const noexcept;
+  void transitToDrain() noexcept;
+  void transitToProbeBw(TimePoint eventTime) noexcept;
+  void transitToProbeRtt() noexcept;
+  void transitToStartup() noexcept;
+  void startProbeBwPhase(ProbeBwPhase phase, TimePoint eventTime) noexcept;
+
+  void handleAckInProbeBw(
+      bool newRoundTrip,
+      TimePoint ackTime,
+      uint64_t ackedBytes,
+      uint64_t prevInflightBytes) noexcept;
+  void handleAckInProbeRtt(bool newRoundTrip, TimePoint ackTime) noexcept;
+
+  uint64_t calculateTargetCwnd(float gain) const noexcept;
+  void updateCwnd(uint64_t ackedBytes) noexcept;
+  std::chrono::microseconds minRtt() const noexcept;
+  // The max filtered bandwidth, bounded by bwLo_.
+  Bandwidth bandwidth() const noexcept;
+
+  QuicConnectionStateBase& conn_;
+  Bbr2State state_{Bbr2State::Startup};
+  ProbeBwPhase probeBwPhase_{ProbeBwPhase::Down};
+
+  // Number of round trips the connection has witnessed
+  uint64_t roundTripCounter_{0};
+  // When a packet with send time later than endOfRoundTrip_ is acked, the
+  // current round strip is ended.
+  TimePoint endOfRoundTrip_;
+  // Latest send time of the packets sent so far.
+  TimePoint lastSentTime_;
+  // Start time of the current round, to estimate its delivery rate.
+  folly::Optional<TimePoint> roundStart_;
+  // Cwnd in bytes
+  uint64_t cwnd_;
+  // Initial cwnd in bytes
+  uint64_t initialCwnd_;
+  // Number of bytes we expect to send over one RTT when paced write.
+  uint64_t pacingWindow_{0};
+
+  float cwndGain_{kBbr2StartupCwndGain};
+  float pacingGain_{kBbr2StartupPacingGain};
+
+  // Whether we have found the bottleneck link bandwidth
+  bool btlbwFound_{false};
+  uint64_t sendQuantum_{0};
+
+  std::unique_ptr<BbrCongestionController::MinRttSampler> minRttSampler_;
+  std::unique_ptr<BbrCongestionController::BandwidthSampler> bandwidthSampler_;
+
+  Bandwidth previousStartupBandwidth_;
+  // Counter of continuous round trips in STARTUP that bandwidth isn't growing
+  // fast enough
+  uint8_t slowStartupRoundCounter_{0};
+
+  // Delivery, loss and CE marks in the current round
+  uint64_t ackedBytesInRound_{0};
+  uint64_t lostBytesInRound_{0};
+  uint64_t lostPacketsInRound_{0};
+  uint64_t ceMarkedPacketsInRound_{0};
+
+  // Long term max inflight bytes, set when probing hits too much loss.
+  folly::Optional<uint64_t> inflightHi_;
+  // Short term bounds, lowered by rounds with loss.
+  folly::Optional<uint64_t> inflightLo_;
+  folly::Optional<Bandwidth> bwLo_;
+
+  // The start of the current ProbeBw cycle, which begins with Down.
+  TimePoint cycleStart_;
+  // The start of the current ProbeBw phase.
+  TimePoint phaseStart_;
+  // Time after cycleStart_ to wait before probing again.
+  std::chrono::milliseconds probeWait_{kBbr2ProbeWaitBase};
+  // Number of rounds spent probing up, which drives how fast inflightHi_
+  // grows.
+  uint8_t probeUpRounds_{0};
+  uint64_t probeUpAckedBytes_{0};
+
+  // Once in ProbeRtt state, we cannot exit ProbeRtt before at least we spend
+  // some duration with low inflight bytes. earliestTimeToExitProbeRtt_ is that
+  // time point.
+  folly::Optional<TimePoint> earliestTimeToExitProbeRtt_;
+  // We also cannot exit ProbeRtt if are not at least at the low inflight bytes
+  // mode for one RTT round. probeRttRound_ tracks that.
+  folly::Optional<uint64_t> probeRttRound_;
+
+  // The connection was very inactive and we are leaving that.
+  bool exitingQuiescene_{false};
+
+  friend std::ostream& operator<<(
+      std::ostream& os,
+      const Bbr2CongestionController& bbr);
+};
+
+std::ostream& operator<<(std::ostream& os, const Bbr2CongestionController& bbr);
+
+std::string bbr2StateToString(Bbr2CongestionController::Bbr2State state);
+
+std::string bbr2ProbeBwPhaseToString(
+    Bbr2CongestionController::ProbeBwPhase phase);
+} // namespace quic
@@ -9,6 +9,7 @@
 // Copyright 2004-present Facebook.  All rights reserved.
 
 #include <quic/congestion_control/BbrBandwidthSampler.h>
+#include <quic/congestion_control/DeliveryRateSampler.h>
 #include <quic/logging/QLoggerConstants.h>
 #include <quic/logging/QuicLogger.h>
 
@@ -37,61 +38,22 @@ void BbrBandwidthSampler::onPacketAcked(
       }
     }
   }
-  // TODO: If i'm smart enough, maybe we don't have to loop through the acked
-  // packets. Can we calculate the bandwidth based on aggregated stats?
-  bool bandwidthUpdated = false;
-  for (auto const& ackedPacket : ackEvent.ackedPackets) {
-    if (ackedPacket.encodedSize == 0) {
-      continue;
-    }
-    Bandwidth sendRate, ackRate;
-    if (ackedPacket.lastAckedPacketInfo) {
-      DCHECK(ackedPacket.sentTime > ackedPacket.lastAckedPacketInfo->sentTime);
-      DCHECK_GE(
-          ackedPacket.totalBytesSentThen,
-          ackedPacket.lastAckedPacketInfo->totalBytesSent);
-      sendRate = Bandwidth(
-          ackedPacket.totalBytesSentThen -
-              ackedPacket.lastAckedPacketInfo->totalBytesSent,
-          std::chrono::duration_cast<std::chrono::microseconds>(
-              ackedPacket.sentTime -
-              ackedPacket.lastAckedPacketInfo->sentTime));
-
-      DCHECK(ackEvent.ackTime > ackedPacket.lastAckedPacketInfo->ackTime);
-      DCHECK_GE(
-          conn_.lossState.totalBytesAcked,
-          ackedPacket.lastAckedPacketInfo->totalBytesAcked);
-      ackRate = Bandwidth(
-          conn_.lossState.totalBytesAcked -
-              ackedPacket.lastAckedPacketInfo->totalBytesAcked,
-          std::chrono::duration_cast<std::chrono::microseconds>(
-              ackEvent.ackTime - ackedPacket.lastAckedPacketInfo->ackTime));
-    } else if (ackEvent.ackTime > ackedPacket.sentTime) {
-      // No previous ack info from outstanding packet, fallback to units/lrtt.
-      // This is a per packet delivery rate. Given there can be multiple packets
-      // inflight during the time, this is clearly under estimating bandwidth.
-      // But it's better than nothing.
-      //
-      // Note that this if condition:
-      //   ack.Event.ackTime > ackedPacket.sentTime
-      // will almost always be true unless your network is very very fast, or
-      // your clock is broken, or isn't steady. Anyway, in the rare cases that
-      // it isn't true, divide by zero will crash.
-      sendRate = Bandwidth(
-          ackedPacket.encodedSize,
-          std::chrono::duration_cast<std::chrono::microseconds>(
-              ackEvent.ackTime - ackedPacket.sentTime));
-    }
-    Bandwidth measuredBandwidth = sendRate > ackRate ? sendRate : ackRate;
-    // If a sample is from a packet sent during app-limited period, we should
-    // still use this sample if it's >= current best value.
-    if (measuredBandwidth >= windowedFilter_.GetBest() ||
-        !ackedPacket.isAppLimited) {
-      windowedFilter_.Update(measuredBandwidth, rttCounter);
-      bandwidthUpdated = true;
-    }
+  // processAckFrame samples the delivery rate for every ack, but events that
+  // don't come from it may not carry a sample.
+  auto rateSample = ackEvent.rateSample
+      ? ackEvent.rateSample
+      : sampleDeliveryRate(conn_, ackEvent);
+  if (!rateSample) {
+    return;
+  }
+  // If a sample is from a packet sent during app-limited period, we should
+  // still use this sample if it's >= current best value.
+  if (rateSample->bandwidth < windowedFilter_.GetBest() &&
+      rateSample->isAppLimited) {
+    return;
   }
-  if (bandwidthUpdated && conn_.qLogger) {
+  windowedFilter_.Update(rateSample->bandwidth, rttCounter);
+  if (conn_.qLogger) {
     auto newBandwidth = getBandwidth();
     conn_.qLogger->addBandwidthEstUpdate(
         newBandwidth.units, newBandwidth.interval);
@@ -24,6 +24,10 @@ uint64_t boundedCwnd(
       minCwndInMss * packetLength);
 }
 
+TimePoint endOfSentPackets(TimePoint lastSentTime) noexcept {
+  return std::max(Clock::now(), lastSentTime);
+}
+
 PacingRate calculatePacingRate(
     const QuicConnectionStateBase& conn,
     uint64_t cwnd,
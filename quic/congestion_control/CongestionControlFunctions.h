@@ -27,6 +27,13 @@ PacingRate calculatePacingRate(
     uint64_t minCwndInMss,
     std::chrono::microseconds rtt);
 
+/**
+ * The time no packet sent so far is later than, that ends a round or a
+ * recovery period once a packet sent after it is acked. Usually that's now,
+ * but packets can be stamped ahead of the clock, e.g. in a simulation.
+ */
+TimePoint endOfSentPackets(TimePoint lastSentTime) noexcept;
+
 template <class T1, class T2>
 void addAndCheckOverflow(T1& value, const T2& toAdd) {
   if (std::numeric_limits<T1>::max() - toAdd < value) {
@@ -9,11 +9,13 @@
 #include <quic/congestion_control/CongestionControllerFactory.h>
 
 #include <quic/congestion_control/Bbr.h>
+#include <quic/congestion_control/Bbr2.h>
 #include <quic/congestion_control/BbrBandwidthSampler.h>
 #include <quic/congestion_control/BbrRttSampler.h>
 #include <quic/congestion_control/Copa.h>
 #include <quic/congestion_control/NewReno.h>
 #include <quic/congestion_control/QuicCubic.h>
+#include <quic/state/StateData.h>
 
 #include <memory>
 
@@ -22,6 +24,15 @@ std::unique_ptr<CongestionController>
 DefaultCongestionControllerFactory::makeCongestionController(
     QuicConnectionStateBase& conn,
     CongestionControlType type) {
+  const auto& name = conn.transportSettings.congestionControllerName;
+  if (!name.empty()) {
+    auto it = customMakers_.find(name);
+    if (it != customMakers_.end()) {
+      return it->second(conn);
+    }
+    LOG(WARNING) << "Unknown congestion controller name=" << name
+                 << ", falling back to " << congestionControlTypeToString(type);
+  }
   std::unique_ptr<CongestionController> congestionController;
   switch (type) {
     case CongestionControlType::NewReno:
@@ -41,9 +52,30 @@ DefaultCongestionControllerFactory::makeCongestionController(
       congestionController = std::move(bbr);
       break;
     }
+    case CongestionControlType::BBR2: {
+      auto bbr2 = std::make_unique<Bbr2CongestionController>(conn);
+      bbr2->setRttSampler(
+          std::make_unique<BbrRttSampler>(kBbr2RttSamplerExpiration));
+      bbr2->setBandwidthSampler(std::make_unique<BbrBandwidthSampler>(conn));
+      congestionController = std::move(bbr2);
+      break;
+    }
     case CongestionControlType::None:
       break;
   }
   return congestionController;
 }
+
+void DefaultCongestionControllerFactory::registerCongestionController(
+    std::string name,
+    MakeCongestionControllerFn makeFn) {
+  CHECK(!name.empty());
+  CHECK(makeFn);
+  customMakers_[std::move(name)] = std::move(makeFn);
+}
+
+bool DefaultCongestionControllerFactory::isRegistered(
+    const std::string& name) const {
+  return customMakers_.count(name) > 0;
+}
 } // namespace quic
@@ -10,7 +10,11 @@
 
 #include <quic/QuicConstants.h>
 
+#include <folly/container/F14Map.h>
+
+#include <functional>
 #include <memory>
+#include <string>
 
 namespace quic {
 struct CongestionController;
@@ -30,13 +34,38 @@ class CongestionControllerFactory {
       CongestionControlType type) = 0;
 };
 
+/**
+ * Makes the built-in congestion controllers, and custom ones registered under
+ * a name. A connection gets the custom controller named by its
+ * TransportSettings::congestionControllerName, so a transport settings
+ * override can pick one per connection. The custom controller reads its
+ * config from the connection's transport settings.
+ */
 class DefaultCongestionControllerFactory : public CongestionControllerFactory {
  public:
+  using MakeCongestionControllerFn =
+      std::function<std::unique_ptr<CongestionController>(
+          QuicConnectionStateBase&)>;
+
   ~DefaultCongestionControllerFactory() override = default;
 
   std::unique_ptr<CongestionController> makeCongestionController(
       QuicConnectionStateBase& conn,
       CongestionControlType type) override;
+
+  /**
+   * Registers a custom congestion controller. Replaces any controller
+   * registered under the same name. Not thread safe, register before the
+   * factory is handed to the transports.
+   */
+  void registerCongestionController(
+      std::string name,
+      MakeCongestionControllerFn makeFn);
+
+  bool isRegistered(const std::string& name) const;
+
+ private:
+  folly::F14FastMap<std::string, MakeCongestionControllerFn> customMakers_;
 };
 
 } // namespace quic
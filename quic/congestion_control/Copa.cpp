@@ -24,6 +24,10 @@ Copa::Copa(QuicConnectionStateBase& conn)
       standingRTTFilter_(
           100000, /*100ms*/
           0us,
+          0),
+      maxRTTFilter_(
+          400000, /*400ms*/
+          0us,
           0) {
   VLOG(10) << __func__ << " writable=" << getWritableBytes()
            << " cwnd=" << cwndBytes_
@@ -31,6 +35,7 @@ Copa::Copa(QuicConnectionStateBase& conn)
   if (conn_.transportSettings.latencyFactor.has_value()) {
     latencyFactor_ = conn_.transportSettings.latencyFactor.value();
   }
+  deltaInverse_ = 1 / latencyFactor_;
   QUIC_TRACE(initcwnd, conn_, cwndBytes_);
 }
 
@@ -156,6 +161,12 @@ void Copa::onPacketAcked(const AckEvent& ack) {
       std::chrono::duration_cast<microseconds>(ack.ackTime.time_since_epoch())
           .count());
   auto rttStandingMicroSec = standingRTTFilter_.GetBest().count();
+  maxRTTFilter_.SetWindowLength(4 * conn_.lossState.srtt.count());
+  maxRTTFilter_.Update(
+      conn_.lossState.lrtt,
+      std::chrono::duration_cast<microseconds>(ack.ackTime.time_since_epoch())
+          .count());
+  updateMode(ack.ackTime, rttMin, standingRTTFilter_.GetBest());
 
   VLOG(10) << __func__ << "ack size=" << ack.ackedBytes
            << " num packets acked=" << ack.ackedBytes / conn_.udpSendPacketLen
@@ -175,7 +186,8 @@ void Copa::onPacketAcked(const AckEvent& ack) {
     conn_.qLogger->addCongestionMetricUpdate(
         conn_.lossState.inflightBytes,
         getCongestionWindow(),
-        kCongestionPacketAck);
+        kCongestionPacketAck,
+        modeString());
   }
 
   auto delayInMicroSec =
@@ -204,7 +216,7 @@ void Copa::onPacketAcked(const AckEvent& ack) {
     increaseCwnd = true;
   } else {
     auto targetRate = (1.0 * conn_.udpSendPacketLen * 1000000) /
-        (latencyFactor_ * delayInMicroSec);
+        (delta() * delayInMicroSec);
     auto currentRate = (1.0 * cwndBytes_ * 1000000) / rttStandingMicroSec;
 
     VLOG(10) << __func__ << " estimated target rate=" << targetRate
@@ -242,7 +254,7 @@ void Copa::onPacketAcked(const AckEvent& ack) {
       }
       uint64_t addition = (ack.ackedPackets.size() * conn_.udpSendPacketLen *
                            conn_.udpSendPacketLen * velocityState_.velocity) /
-          (latencyFactor_ * cwndBytes_);
+          (delta() * cwndBytes_);
       VLOG(10) << __func__ << " increasing cwnd from=" << cwndBytes_ << " by "
                << addition << " " << conn_;
       addAndCheckOverflow(cwndBytes_, addition);
@@ -258,7 +270,7 @@ void Copa::onPacketAcked(const AckEvent& ack) {
     }
     uint64_t reduction = (ack.ackedPackets.size() * conn_.udpSendPacketLen *
                           conn_.udpSendPacketLen * velocityState_.velocity) /
-        (latencyFactor_ * cwndBytes_);
+        (delta() * cwndBytes_);
     VLOG(10) << __func__ << " decreasing cwnd from=" << cwndBytes_ << " by "
              << reduction << " " << conn_;
     isSlowStart_ = false;
@@ -282,10 +294,19 @@ void Copa::onPacketLoss(const LossEvent& loss) {
     conn_.qLogger->addCongestionMetricUpdate(
         conn_.lossState.inflightBytes,
         getCongestionWindow(),
-        kCongestionPacketLoss);
+        kCongestionPacketLoss,
+        modeString());
   }
   DCHECK(loss.largestLostPacketNum.has_value());
   subtractAndCheckUnderflow(conn_.lossState.inflightBytes, loss.lostBytes);
+  // Multiplicative decrease of 1 / delta, at most once per rtt.
+  if (mode_ == Mode::Competitive &&
+      loss.lossTime - lastDeltaDecreaseTime_ >= conn_.lossState.srtt) {
+    deltaInverse_ = std::max(deltaInverse_ / 2, 1 / latencyFactor_);
+    lastDeltaDecreaseTime_ = loss.lossTime;
+    VLOG(10) << __func__ << " competitive mode delta=" << delta() << " "
+             << conn_;
+  }
   if (loss.persistentCongestion) {
     // TODO See if we should go to slowStart here
     VLOG(10) << __func__ << " writable=" << getWritableBytes()
@@ -304,6 +325,64 @@ void Copa::onPacketLoss(const LossEvent& loss) {
   }
 }
 
+/**
+ * The queue should be nearly empty at least once every 5 rtts if all the flows
+ * sharing the bottleneck are Copa. If it isn't, there is buffer filling cross
+ * traffic that would starve Copa in its default mode.
+ */
+void Copa::updateMode(
+    TimePoint ackTime,
+    std::chrono::microseconds rttMin,
+    std::chrono::microseconds rttStanding) {
+  const auto& config = conn_.transportSettings.copaConfig;
+  if (!config.competitiveModeEnabled) {
+    return;
+  }
+  auto nearlyEmptyQueueDelay =
+      (maxRTTFilter_.GetBest() - rttMin) * config.nearlyEmptyQueueThreshold;
+  if (!lastQueueNearlyEmptyTime_ ||
+      rttStanding - rttMin <= nearlyEmptyQueueDelay) {
+    lastQueueNearlyEmptyTime_ = ackTime;
+  }
+  auto newMode = ackTime - *lastQueueNearlyEmptyTime_ >
+          config.competitiveModeRtts * conn_.lossState.srtt
+      ? Mode::Competitive
+      : Mode::Default;
+  if (newMode != mode_) {
+    mode_ = newMode;
+    deltaInverse_ = 1 / latencyFactor_;
+    lastDeltaIncreaseTime_ = ackTime;
+    VLOG(10) << __func__ << " switched to " << modeString() << " mode "
+             << conn_;
+    if (conn_.qLogger) {
+      conn_.qLogger->addCongestionMetricUpdate(
+          conn_.lossState.inflightBytes,
+          getCongestionWindow(),
+          kCopaModeSwitch,
+          modeString());
+    }
+  } else if (
+      mode_ == Mode::Competitive &&
+      ackTime - lastDeltaIncreaseTime_ >= conn_.lossState.srtt) {
+    // Additive increase of 1 / delta once per rtt.
+    deltaInverse_ =
+        std::min(deltaInverse_ + 1, 1 / config.minCompetitiveDelta);
+    lastDeltaIncreaseTime_ = ackTime;
+  }
+}
+
+std::string Copa::modeString() const {
+  return mode_ == Mode::Competitive ? kCopaCompetitiveMode : kCopaDefaultMode;
+}
+
+Copa::Mode Copa::mode() const noexcept {
+  return mode_;
+}
+
+double Copa::delta() const noexcept {
+  return mode_ == Mode::Competitive ? 1 / deltaInverse_ : latencyFactor_;
+}
+
 uint64_t Copa::getWritableBytes() const noexcept {
   if (conn_.lossState.inflightBytes > cwndBytes_) {
     return 0;
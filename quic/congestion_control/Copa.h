@@ -24,6 +24,11 @@ constexpr std::chrono::microseconds kMinRTTWindowLength{10s};
  * Algorithm description https://fb.quip.com/kgubABy1yuYR
  * Original paper
  * https://www.usenix.org/system/files/conference/nsdi18/nsdi18-arun.pdf
+ *
+ * With TransportSettings::copaConfig.competitiveModeEnabled, Copa also does
+ * the mode switching of the paper: it stays in default mode with delta at
+ * latencyFactor while the queue drains every few rtts, and otherwise competes
+ * with buffer filling flows by varying 1 / delta with AIMD.
  */
 
 class Copa : public CongestionController {
@@ -46,9 +51,24 @@ class Copa : public CongestionController {
   void setAppLimited() override;
   bool isAppLimited() const noexcept override;
 
+  enum class Mode : uint8_t {
+    Default,
+    Competitive,
+  };
+
+  Mode mode() const noexcept;
+
+  // The delta currently in use, latencyFactor in default mode.
+  double delta() const noexcept;
+
  private:
   void onPacketAcked(const AckEvent&);
   void onPacketLoss(const LossEvent&);
+  void updateMode(
+      TimePoint ackTime,
+      std::chrono::microseconds rttMin,
+      std::chrono::microseconds rttStanding);
+  std::string modeString() const;
 
   struct VelocityState {
     uint64_t velocity{1};
@@ -89,6 +109,13 @@ class Copa : public CongestionController {
       uint64_t>
       standingRTTFilter_; // To get min RTT over srtt/2
 
+  WindowedFilter<
+      std::chrono::microseconds,
+      MaxFilter<std::chrono::microseconds>,
+      uint64_t,
+      uint64_t>
+      maxRTTFilter_; // To get max RTT over 4 srtt
+
   VelocityState velocityState_;
   /**
    * latencyFactor_ determines how latency sensitive the algorithm is. Lower
@@ -96,5 +123,14 @@ class Copa : public CongestionController {
    * it will minimize delay at expense of throughput.
    */
   double latencyFactor_{0.50};
+
+  Mode mode_{Mode::Default};
+  // 1 / delta in competitive mode
+  double deltaInverse_{1 / 0.50};
+  // Last time the standing rtt showed a nearly empty queue
+  folly::Optional<TimePoint> lastQueueNearlyEmptyTime_;
+  // Last times 1 / delta was increased, and halved upon loss
+  TimePoint lastDeltaIncreaseTime_;
+  TimePoint lastDeltaDecreaseTime_;
 };
 } // namespace quic
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/congestion_control/DeliveryRateSampler.h>
+
+namespace quic {
+
+folly::Optional<CongestionController::DeliveryRateSample> sampleDeliveryRate(
+    const QuicConnectionStateBase& conn,
+    const CongestionController::AckEvent& ackEvent) {
+  folly::Optional<CongestionController::DeliveryRateSample> rateSample;
+  // TODO: If i'm smart enough, maybe we don't have to loop through the acked
+  // packets. Can we calculate the bandwidth based on aggregated stats?
+  for (auto const& ackedPacket : ackEvent.ackedPackets) {
+    if (ackedPacket.encodedSize == 0) {
+      continue;
+    }
+    Bandwidth sendRate, ackRate;
+    if (ackedPacket.lastAckedPacketInfo) {
+      DCHECK(ackedPacket.sentTime > ackedPacket.lastAckedPacketInfo->sentTime);
+      DCHECK_GE(
+          ackedPacket.totalBytesSentThen,
+          ackedPacket.lastAckedPacketInfo->totalBytesSent);
+      sendRate = Bandwidth(
+          ackedPacket.totalBytesSentThen -
+              ackedPacket.lastAckedPacketInfo->totalBytesSent,
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              ackedPacket.sentTime -
+              ackedPacket.lastAckedPacketInfo->sentTime));
+
+      DCHECK(ackEvent.ackTime > ackedPacket.lastAckedPacketInfo->ackTime);
+      DCHECK_GE(
+          conn.lossState.totalBytesAcked,
+          ackedPacket.lastAckedPacketInfo->totalBytesAcked);
+      ackRate = Bandwidth(
+          conn.lossState.totalBytesAcked -
+              ackedPacket.lastAckedPacketInfo->totalBytesAcked,
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              ackEvent.ackTime - ackedPacket.lastAckedPacketInfo->ackTime));
+    } else if (ackEvent.ackTime > ackedPacket.sentTime) {
+      // No previous ack info from outstanding packet, fallback to units/lrtt.
+      // This is a per packet delivery rate. Given there can be multiple packets
+      // inflight during the time, this is clearly under estimating bandwidth.
+      // But it's better than nothing.
+      //
+      // Note that this if condition:
+      //   ack.Event.ackTime > ackedPacket.sentTime
+      // will almost always be true unless your network is very very fast, or
+      // your clock is broken, or isn't steady. Anyway, in the rare cases that
+      // it isn't true, divide by zero will crash.
+      sendRate = Bandwidth(
+          ackedPacket.encodedSize,
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              ackEvent.ackTime - ackedPacket.sentTime));
+    }
+    Bandwidth measuredBandwidth = sendRate > ackRate ? sendRate : ackRate;
+    // On a tie, a sample that isn't app-limited is the more useful one.
+    if (!rateSample || measuredBandwidth > rateSample->bandwidth ||
+        (measuredBandwidth == rateSample->bandwidth &&
+         !ackedPacket.isAppLimited)) {
+      rateSample = CongestionController::DeliveryRateSample{
+          measuredBandwidth, ackedPacket.isAppLimited};
+    }
+  }
+  return rateSample;
+}
+} // namespace quic
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/state/StateData.h>
+
+namespace quic {
+
+/**
+ * Samples the delivery rate from the packets acked by ackEvent. For each acked
+ * packet, the rate is the larger of the send rate and the ack rate measured
+ * since the packet that was last acked when it was sent. Without that info, it
+ * falls back to the packet's size over its rtt, which underestimates.
+ *
+ * The sample is the highest of these rates, and is app-limited when it comes
+ * from a packet sent while the connection was app-limited. Returns none if
+ * the event acks no packet with a size.
+ */
+folly::Optional<CongestionController::DeliveryRateSample> sampleDeliveryRate(
+    const QuicConnectionStateBase& conn,
+    const CongestionController::AckEvent& ackEvent);
+
+} // namespace quic
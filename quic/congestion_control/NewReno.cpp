@@ -38,6 +38,8 @@ void NewReno::onRemoveBytesFromInflight(uint64_t bytes) {
 
 void NewReno::onPacketSent(const OutstandingPacket& packet) {
   addAndCheckOverflow(conn_.lossState.inflightBytes, packet.encodedSize);
+  lastSentTime_ = std::max(lastSentTime_, packet.time);
+  prr_.onPacketSent(packet.encodedSize);
   VLOG(10) << __func__ << " writable=" << getWritableBytes()
            << " cwnd=" << cwndBytes_
            << " inflight=" << conn_.lossState.inflightBytes
@@ -54,6 +56,16 @@ void NewReno::onPacketSent(const OutstandingPacket& packet) {
 void NewReno::onAckEvent(const AckEvent& ack) {
   DCHECK(ack.largestAckedPacket.has_value() && !ack.ackedPackets.empty());
   subtractAndCheckUnderflow(conn_.lossState.inflightBytes, ack.ackedBytes);
+  if (prr_.inRecovery()) {
+    if (endOfRecovery_ && ack.largestAckedPacketSentTime >= *endOfRecovery_) {
+      prr_.stop();
+    } else {
+      prr_.onAck(
+          ack.ackedBytes,
+          conn_.lossState.inflightBytes,
+          conn_.udpSendPacketLen);
+    }
+  }
   VLOG(10) << __func__ << " writable=" << getWritableBytes()
            << " cwnd=" << cwndBytes_
            << " inflight=" << conn_.lossState.inflightBytes << " " << conn_;
@@ -110,15 +122,12 @@ void NewReno::onPacketLoss(const LossEvent& loss) {
       loss.largestLostSentTime.has_value());
   subtractAndCheckUnderflow(conn_.lossState.inflightBytes, loss.lostBytes);
   if (!endOfRecovery_ || *endOfRecovery_ < *loss.largestLostSentTime) {
-    endOfRecovery_ = Clock::now();
-    cwndBytes_ = (cwndBytes_ >> kRenoLossReductionFactorShift);
-    cwndBytes_ = boundedCwnd(
-        cwndBytes_,
-        conn_.udpSendPacketLen,
-        conn_.transportSettings.maxCwndInMss,
-        conn_.transportSettings.minCwndInMss);
-    // This causes us to exit slow start.
-    ssthresh_ = cwndBytes_;
+    undoState_ =
+        UndoState{cwndBytes_, ssthresh_, endOfRecovery_, loss.lossTime};
+    reduceCwnd();
+    if (conn_.transportSettings.proportionalRateReduction) {
+      prr_.start(conn_.lossState.inflightBytes + loss.lostBytes, cwndBytes_);
+    }
     VLOG(10) << __func__ << " exit slow start, ssthresh=" << ssthresh_
              << " packetNum=" << *loss.largestLostPacketNum
              << " writable=" << getWritableBytes() << " cwnd=" << cwndBytes_
@@ -128,6 +137,9 @@ void NewReno::onPacketLoss(const LossEvent& loss) {
              << " writable=" << getWritableBytes() << " cwnd=" << cwndBytes_
              << " inflight=" << conn_.lossState.inflightBytes << " " << conn_;
   }
+  if (undoState_) {
+    undoState_->lostPackets += loss.lostPackets;
+  }
 
   if (conn_.qLogger) {
     conn_.qLogger->addCongestionMetricUpdate(
@@ -136,6 +148,8 @@ void NewReno::onPacketLoss(const LossEvent& loss) {
         kCongestionPacketLoss);
   }
   if (loss.persistentCongestion) {
+    undoState_.clear();
+    prr_.stop();
     VLOG(10) << __func__ << " writable=" << getWritableBytes()
              << " cwnd=" << cwndBytes_
              << " inflight=" << conn_.lossState.inflightBytes << " " << conn_;
@@ -149,7 +163,71 @@ void NewReno::onPacketLoss(const LossEvent& loss) {
   }
 }
 
+void NewReno::onPacketsCeMarked(
+    uint64_t ceMarkedPackets,
+    TimePoint largestAckedSentTime) {
+  // Same reaction as to a loss, once per recovery period.
+  if (endOfRecovery_ && largestAckedSentTime < *endOfRecovery_) {
+    return;
+  }
+  // A CE mark is no reordering, this reduction is for good.
+  undoState_.clear();
+  reduceCwnd();
+  if (conn_.transportSettings.proportionalRateReduction) {
+    prr_.start(conn_.lossState.inflightBytes, cwndBytes_);
+  }
+  VLOG(10) << __func__ << " ceMarkedPackets=" << ceMarkedPackets
+           << " ssthresh=" << ssthresh_ << " writable=" << getWritableBytes()
+           << " cwnd=" << cwndBytes_
+           << " inflight=" << conn_.lossState.inflightBytes << " " << conn_;
+  if (conn_.qLogger) {
+    conn_.qLogger->addCongestionMetricUpdate(
+        conn_.lossState.inflightBytes,
+        getCongestionWindow(),
+        kCongestionPacketsCeMarked);
+  }
+}
+
+void NewReno::undoLoss(TimePoint lossTime) {
+  if (!undoState_ || lossTime < undoState_->firstLossTime) {
+    return;
+  }
+  DCHECK_GT(undoState_->lostPackets, 0);
+  if (--undoState_->lostPackets > 0) {
+    return;
+  }
+  cwndBytes_ = std::max(cwndBytes_, undoState_->cwndBytes);
+  ssthresh_ = std::max(ssthresh_, undoState_->ssthresh);
+  endOfRecovery_ = undoState_->endOfRecovery;
+  undoState_.clear();
+  prr_.stop();
+  VLOG(10) << __func__ << " ssthresh=" << ssthresh_
+           << " writable=" << getWritableBytes() << " cwnd=" << cwndBytes_
+           << " inflight=" << conn_.lossState.inflightBytes << " " << conn_;
+  if (conn_.qLogger) {
+    conn_.qLogger->addCongestionMetricUpdate(
+        conn_.lossState.inflightBytes,
+        getCongestionWindow(),
+        kCongestionLossUndo);
+  }
+}
+
+void NewReno::reduceCwnd() noexcept {
+  endOfRecovery_ = endOfSentPackets(lastSentTime_);
+  cwndBytes_ = (cwndBytes_ >> kRenoLossReductionFactorShift);
+  cwndBytes_ = boundedCwnd(
+      cwndBytes_,
+      conn_.udpSendPacketLen,
+      conn_.transportSettings.maxCwndInMss,
+      conn_.transportSettings.minCwndInMss);
+  // This causes us to exit slow start.
+  ssthresh_ = cwndBytes_;
+}
+
 uint64_t NewReno::getWritableBytes() const noexcept {
+  if (prr_.inRecovery()) {
+    return prr_.getWritableBytes();
+  }
   if (conn_.lossState.inflightBytes > cwndBytes_) {
     return 0;
   } else {
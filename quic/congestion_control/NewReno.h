@@ -9,6 +9,7 @@
 #pragma once
 
 #include <quic/QuicException.h>
+#include <quic/congestion_control/ProportionalRateReduction.h>
 #include <quic/state/StateData.h>
 
 #include <limits>
@@ -22,6 +23,10 @@ class NewReno : public CongestionController {
   void onPacketSent(const OutstandingPacket& packet) override;
   void onPacketAckOrLoss(folly::Optional<AckEvent>, folly::Optional<LossEvent>)
       override;
+  void onPacketsCeMarked(
+      uint64_t ceMarkedPackets,
+      TimePoint largestAckedSentTime) override;
+  void undoLoss(TimePoint lossTime) override;
 
   uint64_t getWritableBytes() const noexcept override;
   uint64_t getCongestionWindow() const noexcept override;
@@ -38,6 +43,7 @@ class NewReno : public CongestionController {
 
  private:
   void onPacketLoss(const LossEvent&);
+  void reduceCwnd() noexcept;
   void onAckEvent(const AckEvent&);
   void onPacketAcked(const CongestionController::AckEvent::AckPacket&);
 
@@ -46,5 +52,23 @@ class NewReno : public CongestionController {
   uint64_t ssthresh_;
   uint64_t cwndBytes_;
   folly::Optional<TimePoint> endOfRecovery_;
+  // Latest send time of the packets sent so far.
+  TimePoint lastSentTime_;
+  // What may be sent in a recovery period, if
+  // TransportSettings::proportionalRateReduction is set.
+  ProportionalRateReduction prr_;
+
+  // What the current recovery period reduced, to restore if all the losses
+  // counted in it turn out to be spurious.
+  struct UndoState {
+    uint64_t cwndBytes;
+    uint64_t ssthresh;
+    folly::Optional<TimePoint> endOfRecovery;
+    // lossTime of the LossEvent that started the recovery period
+    TimePoint firstLossTime;
+    // Packets lost in the recovery period and not acked yet
+    uint64_t lostPackets{0};
+  };
+  folly::Optional<UndoState> undoState_;
 };
 } // namespace quic
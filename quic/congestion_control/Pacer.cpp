@@ -29,14 +29,20 @@ DefaultPacer::DefaultPacer(
 void DefaultPacer::refreshPacingRate(
     uint64_t cwndBytes,
     std::chrono::microseconds rtt) {
+  lastRefresh_ = std::make_pair(cwndBytes, rtt);
   if (rtt < conn_.transportSettings.pacingTimerTickInterval) {
     writeInterval_ = 0us;
     batchSize_ = conn_.transportSettings.writeConnectionDataPacketsLimit;
+    capPacingRate();
+    if (writeInterval_ != 0us) {
+      tokens_ += batchSize_;
+    }
   } else {
     const PacingRate pacingRate =
         pacingRateCalculator_(conn_, cwndBytes, minCwndInMss_, rtt);
     writeInterval_ = pacingRate.interval;
     batchSize_ = pacingRate.burstSize;
+    capPacingRate();
     tokens_ += batchSize_;
   }
   if (conn_.qLogger) {
@@ -62,14 +68,18 @@ void DefaultPacer::onPacketsLoss() {
 }
 
 std::chrono::microseconds DefaultPacer::getTimeUntilNextWrite() const {
-  return (appLimited_ || tokens_) ? 0us : writeInterval_;
+  if (conn_.transportSettings.pacingUsesTxTime) {
+    // The kernel holds the packets back, there is nothing to wait for.
+    return 0us;
+  }
+  return (unpaced() || tokens_) ? 0us : writeInterval_;
 }
 
 uint64_t DefaultPacer::updateAndGetWriteBatchSize(TimePoint currentTime) {
   SCOPE_EXIT {
     scheduledWriteTime_.reset();
   };
-  if (appLimited_) {
+  if (unpaced() || conn_.transportSettings.pacingUsesTxTime) {
     cachedBatchSize_ = conn_.transportSettings.writeConnectionDataPacketsLimit;
     return cachedBatchSize_;
   }
@@ -96,6 +106,22 @@ uint64_t DefaultPacer::getCachedWriteBatchSize() const {
   return cachedBatchSize_;
 }
 
+TimePoint DefaultPacer::getDepartureTime(
+    TimePoint currentTime,
+    uint64_t packetSize) {
+  if (unpaced() || writeInterval_ == 0us || batchSize_ == 0) {
+    nextDepartureTime_ = currentTime;
+    return currentTime;
+  }
+  // Time that went by without sending is not made up for with a burst.
+  auto departureTime = std::max(currentTime, nextDepartureTime_);
+  // batchSize_ full sized packets go out every writeInterval_.
+  nextDepartureTime_ = departureTime +
+      std::chrono::duration_cast<std::chrono::nanoseconds>(writeInterval_) *
+          packetSize / (batchSize_ * conn_.udpSendPacketLen);
+  return departureTime;
+}
+
 void DefaultPacer::setPacingRateCalculator(
     PacingRateCalculator pacingRateCalculator) {
   pacingRateCalculator_ = std::move(pacingRateCalculator);
@@ -105,4 +131,45 @@ void DefaultPacer::setAppLimited(bool limited) {
   appLimited_ = limited;
 }
 
+void DefaultPacer::setMaxPacingRate(
+    folly::Optional<uint64_t> maxRateBytesPerSec) {
+  DCHECK(!maxRateBytesPerSec || *maxRateBytesPerSec > 0);
+  maxPacingRate_ = maxRateBytesPerSec;
+  if (lastRefresh_) {
+    refreshPacingRate(lastRefresh_->first, lastRefresh_->second);
+  } else {
+    writeInterval_ = 0us;
+    batchSize_ = conn_.transportSettings.writeConnectionDataPacketsLimit;
+    capPacingRate();
+    cachedBatchSize_ = batchSize_;
+  }
+}
+
+bool DefaultPacer::unpaced() const {
+  return appLimited_ && !maxPacingRate_;
+}
+
+void DefaultPacer::capPacingRate() {
+  if (!maxPacingRate_ || conn_.udpSendPacketLen == 0) {
+    return;
+  }
+  auto interval = std::max(
+      writeInterval_,
+      std::max<std::chrono::microseconds>(
+          conn_.transportSettings.pacingTimerTickInterval, 1us));
+  uint64_t maxBatchSize = *maxPacingRate_ * interval.count() /
+      (conn_.udpSendPacketLen * std::micro::den);
+  if (maxBatchSize == 0) {
+    // Less than a packet a tick, so a packet every so many ticks.
+    batchSize_ = 1;
+    writeInterval_ = std::chrono::microseconds(
+        conn_.udpSendPacketLen * std::micro::den / *maxPacingRate_);
+  } else if (writeInterval_ == 0us) {
+    batchSize_ = maxBatchSize;
+    writeInterval_ = interval;
+  } else {
+    batchSize_ = std::min(batchSize_, maxBatchSize);
+  }
+}
+
 } // namespace quic
@@ -41,12 +41,23 @@ class DefaultPacer : public Pacer {
 
   uint64_t getCachedWriteBatchSize() const override;
 
+  TimePoint getDepartureTime(TimePoint currentTime, uint64_t packetSize)
+      override;
+
   void setAppLimited(bool limited) override;
 
   void onPacketSent() override;
   void onPacketsLoss() override;
 
+  void setMaxPacingRate(folly::Optional<uint64_t> maxRateBytesPerSec) override;
+
  private:
+  // Writes go out unpaced while app limited, unless the rate is capped.
+  bool unpaced() const;
+  // Spreads the writes out further if they would go faster than
+  // maxPacingRate_.
+  void capPacingRate();
+
   const QuicConnectionStateBase& conn_;
   uint64_t minCwndInMss_;
   uint64_t batchSize_;
@@ -56,5 +67,12 @@ class DefaultPacer : public Pacer {
   uint64_t cachedBatchSize_;
   bool appLimited_{false};
   uint64_t tokens_;
+  // Departure time of the next packet when pacing with SCM_TXTIME.
+  TimePoint nextDepartureTime_;
+  folly::Optional<uint64_t> maxPacingRate_;
+  // What the pacing rate was last refreshed with, to refresh it again when
+  // the cap changes.
+  folly::Optional<std::pair<uint64_t, std::chrono::microseconds>>
+      lastRefresh_;
 };
 } // namespace quic
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/congestion_control/ProportionalRateReduction.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace quic {
+
+void ProportionalRateReduction::start(
+    uint64_t recoverFs,
+    uint64_t ssthresh) noexcept {
+  inRecovery_ = true;
+  recoverFs_ = std::max<uint64_t>(recoverFs, 1);
+  ssthresh_ = ssthresh;
+  delivered_ = 0;
+  sent_ = 0;
+  sendQuota_ = 0;
+}
+
+void ProportionalRateReduction::stop() noexcept {
+  inRecovery_ = false;
+  sendQuota_ = 0;
+}
+
+void ProportionalRateReduction::onAck(
+    uint64_t deliveredBytes,
+    uint64_t inflightBytes,
+    uint64_t mss) noexcept {
+  if (!inRecovery_) {
+    return;
+  }
+  delivered_ += deliveredBytes;
+  if (inflightBytes > ssthresh_) {
+    // Sends ssthresh for every recoverFs the peer delivers.
+    auto target = static_cast<uint64_t>(std::ceil(
+        static_cast<double>(delivered_) * ssthresh_ / recoverFs_));
+    sendQuota_ = target > sent_ ? target - sent_ : 0;
+  } else {
+    // Slow start back up to ssthresh, by at most an mss more than delivered.
+    uint64_t limit =
+        std::max(delivered_ > sent_ ? delivered_ - sent_ : 0, deliveredBytes) +
+        mss;
+    sendQuota_ = std::min(ssthresh_ - inflightBytes, limit);
+  }
+}
+
+void ProportionalRateReduction::onPacketSent(uint64_t bytes) noexcept {
+  if (!inRecovery_) {
+    return;
+  }
+  sent_ += bytes;
+  sendQuota_ -= std::min(sendQuota_, bytes);
+}
+
+} // namespace quic
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace quic {
+
+/**
+ * Proportional Rate Reduction (RFC 6937) of what a loss based congestion
+ * controller sends in a recovery period. Rather than waiting for the bytes in
+ * flight to drain below the reduced cwnd and then sending it all at once, the
+ * sender keeps sending in proportion to what the peer delivers, so that the
+ * bytes in flight come down to ssthresh by the end of the recovery period.
+ * If they fall below ssthresh, they grow back to it no faster than slow
+ * start (PRR-SSRB).
+ */
+class ProportionalRateReduction {
+ public:
+  /**
+   * Starts a recovery period, with recoverFs bytes in flight when it started,
+   * the lost ones included, and ssthresh the bytes in flight to get down to.
+   * Nothing may be sent until the next ack.
+   */
+  void start(uint64_t recoverFs, uint64_t ssthresh) noexcept;
+
+  void stop() noexcept;
+
+  bool inRecovery() const noexcept {
+    return inRecovery_;
+  }
+
+  // Upon an ack that delivered deliveredBytes and left inflightBytes.
+  void onAck(
+      uint64_t deliveredBytes,
+      uint64_t inflightBytes,
+      uint64_t mss) noexcept;
+
+  void onPacketSent(uint64_t bytes) noexcept;
+
+  // What may be sent until the next ack.
+  uint64_t getWritableBytes() const noexcept {
+    return sendQuota_;
+  }
+
+ private:
+  bool inRecovery_{false};
+  uint64_t recoverFs_{0};
+  uint64_t ssthresh_{0};
+  // prr_delivered and prr_out of the RFC.
+  uint64_t delivered_{0};
+  uint64_t sent_{0};
+  uint64_t sendQuota_{0};
+};
+
+} // namespace quic
@@ -34,6 +34,9 @@ CubicStates Cubic::state() const noexcept {
 }
 
 uint64_t Cubic::getWritableBytes() const noexcept {
+  if (prr_.inRecovery()) {
+    return prr_.getWritableBytes();
+  }
   return cwndBytes_ > conn_.lossState.inflightBytes
       ? cwndBytes_ - conn_.lossState.inflightBytes
       : 0;
@@ -62,6 +65,8 @@ void Cubic::onPersistentCongestion() {
   quiescenceStart_ = folly::none;
   hystartState_.found = Cubic::HystartFound::No;
   hystartState_.inRttRound = false;
+  hystartState_.cssBaselineMinRtt = folly::none;
+  hystartState_.cssRounds = 0;
 
   state_ = CubicStates::Hystart;
 
@@ -89,6 +94,8 @@ void Cubic::onPacketSent(const OutstandingPacket& packet) {
         LocalErrorCode::INFLIGHT_BYTES_OVERFLOW);
   }
   conn_.lossState.inflightBytes += packet.encodedSize;
+  lastSentTime_ = std::max(lastSentTime_, packet.time);
+  prr_.onPacketSent(packet.encodedSize);
 }
 
 void Cubic::onPacketLoss(const LossEvent& loss) {
@@ -102,15 +109,17 @@ void Cubic::onPacketLoss(const LossEvent& loss) {
   // as it was already accounted for in a recovery period.
   if (*loss.largestLostSentTime >=
       recoveryState_.endOfRecovery.value_or(*loss.largestLostSentTime)) {
-    recoveryState_.endOfRecovery = Clock::now();
-    cubicReduction(loss.lossTime);
-    if (state_ == CubicStates::Hystart || state_ == CubicStates::Steady) {
-      state_ = CubicStates::FastRecovery;
-    }
-    ssthresh_ = cwndBytes_;
-    if (conn_.pacer) {
-      conn_.pacer->refreshPacingRate(
-          cwndBytes_ * pacingGain(), conn_.lossState.srtt);
+    undoState_ = UndoState{state_,
+                           cwndBytes_,
+                           ssthresh_,
+                           lossCwndBytes_,
+                           lossSsthresh_,
+                           steadyState_,
+                           recoveryState_,
+                           loss.lossTime};
+    enterRecovery(loss.lossTime);
+    if (conn_.transportSettings.proportionalRateReduction) {
+      prr_.start(conn_.lossState.inflightBytes + loss.lostBytes, cwndBytes_);
     }
     QUIC_TRACE(
         cubic_loss,
@@ -137,12 +146,97 @@ void Cubic::onPacketLoss(const LossEvent& loss) {
           cubicStateToString(state_).str());
     }
   }
+  if (undoState_) {
+    undoState_->lostPackets += loss.lostPackets;
+  }
 
   if (loss.persistentCongestion) {
+    undoState_.clear();
+    prr_.stop();
     onPersistentCongestion();
   }
 }
 
+void Cubic::onPacketsCeMarked(
+    uint64_t ceMarkedPackets,
+    TimePoint largestAckedSentTime) {
+  // A CE mark is handled like a loss, at most once per recovery period, but
+  // nothing needs to be retransmitted.
+  if (recoveryState_.endOfRecovery &&
+      largestAckedSentTime < *recoveryState_.endOfRecovery) {
+    return;
+  }
+  // A CE mark is no reordering, this reduction is for good.
+  undoState_.clear();
+  enterRecovery(Clock::now());
+  if (conn_.transportSettings.proportionalRateReduction) {
+    prr_.start(conn_.lossState.inflightBytes, cwndBytes_);
+  }
+  VLOG(10) << __func__ << " ceMarkedPackets=" << ceMarkedPackets
+           << " cwnd=" << cwndBytes_
+           << " inflight=" << conn_.lossState.inflightBytes << " " << conn_;
+  QUIC_TRACE(
+      cubic_ce_marked,
+      conn_,
+      cubicStateToString(state_).str().data(),
+      cwndBytes_,
+      conn_.lossState.inflightBytes,
+      ceMarkedPackets);
+  if (conn_.qLogger) {
+    conn_.qLogger->addCongestionMetricUpdate(
+        conn_.lossState.inflightBytes,
+        getCongestionWindow(),
+        kCongestionPacketsCeMarked,
+        cubicStateToString(state_).str());
+  }
+}
+
+void Cubic::undoLoss(TimePoint lossTime) {
+  if (!undoState_ || lossTime < undoState_->firstLossTime) {
+    return;
+  }
+  DCHECK_GT(undoState_->lostPackets, 0);
+  if (--undoState_->lostPackets > 0) {
+    return;
+  }
+  state_ = undoState_->state;
+  cwndBytes_ = std::max(cwndBytes_, undoState_->cwndBytes);
+  ssthresh_ = std::max(ssthresh_, undoState_->ssthresh);
+  lossCwndBytes_ = undoState_->lossCwndBytes;
+  lossSsthresh_ = undoState_->lossSsthresh;
+  steadyState_ = undoState_->steadyState;
+  recoveryState_ = undoState_->recoveryState;
+  undoState_.clear();
+  prr_.stop();
+  VLOG(10) << __func__ << " state=" << cubicStateToString(state_)
+           << " cwnd=" << cwndBytes_
+           << " inflight=" << conn_.lossState.inflightBytes << " " << conn_;
+  if (conn_.pacer) {
+    conn_.pacer->refreshPacingRate(
+        cwndBytes_ * pacingGain(), conn_.lossState.srtt);
+  }
+  if (conn_.qLogger) {
+    conn_.qLogger->addCongestionMetricUpdate(
+        conn_.lossState.inflightBytes,
+        getCongestionWindow(),
+        kCongestionLossUndo,
+        cubicStateToString(state_).str());
+  }
+}
+
+void Cubic::enterRecovery(TimePoint eventTime) noexcept {
+  recoveryState_.endOfRecovery = endOfSentPackets(lastSentTime_);
+  cubicReduction(eventTime);
+  if (state_ == CubicStates::Hystart || state_ == CubicStates::Steady) {
+    state_ = CubicStates::FastRecovery;
+  }
+  ssthresh_ = cwndBytes_;
+  if (conn_.pacer) {
+    conn_.pacer->refreshPacingRate(
+        cwndBytes_ * pacingGain(), conn_.lossState.srtt);
+  }
+}
+
 void Cubic::onRemoveBytesFromInflight(uint64_t bytes) {
   DCHECK_LE(bytes, conn_.lossState.inflightBytes);
   conn_.lossState.inflightBytes -= bytes;
@@ -366,6 +460,8 @@ void Cubic::onPacketAcked(const AckEvent& ack) {
   conn_.lossState.inflightBytes -= ack.ackedBytes;
   if (recoveryState_.endOfRecovery.has_value() &&
       *recoveryState_.endOfRecovery >= ack.largestAckedPacketSentTime) {
+    prr_.onAck(
+        ack.ackedBytes, conn_.lossState.inflightBytes, conn_.udpSendPacketLen);
     QUIC_TRACE(fst_trace, conn_, "cubic_skip_ack");
     if (conn_.qLogger) {
       conn_.qLogger->addCongestionMetricUpdate(
@@ -376,6 +472,8 @@ void Cubic::onPacketAcked(const AckEvent& ack) {
     }
     return;
   }
+  // Past the recovery period.
+  prr_.stop();
   switch (state_) {
     case CubicStates::Hystart:
       onPacketAckedInHystart(ack);
@@ -424,9 +522,12 @@ void Cubic::startHystartRttRound(TimePoint time) noexcept {
   hystartState_.ackCount = 0;
   hystartState_.lastSampledRtt = hystartState_.currSampledRtt;
   hystartState_.currSampledRtt = folly::none;
-  hystartState_.rttRoundEndTarget = Clock::now();
+  hystartState_.rttRoundEndTarget = endOfSentPackets(lastSentTime_);
   hystartState_.inRttRound = true;
   hystartState_.found = HystartFound::No;
+  hystartState_.lastRoundMinRtt = hystartState_.currRoundMinRtt;
+  hystartState_.currRoundMinRtt = folly::none;
+  hystartState_.rttSampleCount = 0;
 }
 
 bool Cubic::isRecovered(TimePoint packetSentTime) noexcept {
@@ -476,6 +577,10 @@ float Cubic::pacingGain() const noexcept {
 }
 
 void Cubic::onPacketAckedInHystart(const AckEvent& ack) {
+  if (conn_.transportSettings.cubicConfig.hystartPlusPlus) {
+    onPacketAckedInHystartPlusPlus(ack);
+    return;
+  }
   if (!hystartState_.inRttRound) {
     startHystartRttRound(ack.ackTime);
   }
@@ -507,17 +612,7 @@ void Cubic::onPacketAckedInHystart(const AckEvent& ack) {
                << (*exitReason == Cubic::ExitReason::SSTHRESH
                        ? "cwnd > ssthresh"
                        : "found exit point");
-      hystartState_.inRttRound = false;
-      ssthresh_ = cwndBytes_;
-      /* Now we exit slow start, reset currSampledRtt to be maximal value so
-       * that next time we go back to slow start, we won't be using a very old
-       * sampled RTT as the lastSampledRtt:
-       */
-      hystartState_.currSampledRtt = folly::none;
-      steadyState_.lastMaxCwndBytes = folly::none;
-      steadyState_.lastReductionTime = folly::none;
-      quiescenceStart_ = folly::none;
-      state_ = CubicStates::Steady;
+      exitSlowStart();
     } else {
       // No exit yet, but we may still need to end this RTT round
       VLOG(20) << "Cubic Hystart, mayEndHystartRttRound, largestAckedPacketNum="
@@ -600,6 +695,97 @@ void Cubic::onPacketAckedInHystart(const AckEvent& ack) {
   }
 }
 
+void Cubic::onPacketAckedInHystartPlusPlus(const AckEvent& ack) {
+  const auto& config = conn_.transportSettings.cubicConfig;
+  if (!hystartState_.inRttRound) {
+    startHystartRttRound(ack.ackTime);
+  }
+
+  uint64_t cwndIncrease = ack.ackedBytes;
+  // Without pacing, the per ack growth is limited to avoid bursts.
+  if (!conn_.transportSettings.pacingEnabled) {
+    cwndIncrease = std::min(
+        cwndIncrease,
+        kHystartPlusPlusAckIncreaseLimitInMss * conn_.udpSendPacketLen);
+  }
+  if (hystartState_.cssBaselineMinRtt) {
+    cwndIncrease /= std::max<uint8_t>(config.cssGrowthDivisor, 1);
+  }
+  if (std::numeric_limits<decltype(cwndBytes_)>::max() - cwndBytes_ <
+      cwndIncrease) {
+    throw QuicInternalException(
+        "Cubic Hystart: cwnd overflow", LocalErrorCode::CWND_OVERFLOW);
+  }
+  VLOG(15) << "Cubic HyStart++ increase cwnd=" << cwndBytes_ << ", by "
+           << cwndIncrease;
+  cwndBytes_ = boundedCwnd(
+      cwndBytes_ + cwndIncrease,
+      conn_.udpSendPacketLen,
+      conn_.transportSettings.maxCwndInMss,
+      conn_.transportSettings.minCwndInMss);
+  if (cwndBytes_ >= ssthresh_) {
+    VLOG(15) << "Cubic exit slow start, reason = cwnd > ssthresh";
+    exitSlowStart();
+    return;
+  }
+
+  if (ack.mrttSample) {
+    hystartState_.currRoundMinRtt = std::min(
+        *ack.mrttSample,
+        hystartState_.currRoundMinRtt.value_or(*ack.mrttSample));
+    hystartState_.rttSampleCount++;
+  }
+  if (hystartState_.rttSampleCount >= kAckSampling &&
+      hystartState_.currRoundMinRtt && hystartState_.lastRoundMinRtt) {
+    if (!hystartState_.cssBaselineMinRtt) {
+      std::chrono::microseconds rttThresh = std::max<std::chrono::microseconds>(
+          kHystartPlusPlusMinRttThresh,
+          std::min<std::chrono::microseconds>(
+              *hystartState_.lastRoundMinRtt / kHystartPlusPlusMinRttDivisor,
+              kHystartPlusPlusMaxRttThresh));
+      if (*hystartState_.currRoundMinRtt >=
+          *hystartState_.lastRoundMinRtt + rttThresh) {
+        VLOG(15) << "Cubic HyStart++: rtt increased to "
+                 << hystartState_.currRoundMinRtt->count()
+                 << "us, enter Conservative Slow Start";
+        hystartState_.cssBaselineMinRtt = hystartState_.currRoundMinRtt;
+        hystartState_.cssRounds = 0;
+      }
+    } else if (
+        *hystartState_.currRoundMinRtt < *hystartState_.cssBaselineMinRtt) {
+      // The rtt increase was spurious, go back to slow start.
+      VLOG(15) << "Cubic HyStart++: rtt decreased, resume slow start";
+      hystartState_.cssBaselineMinRtt = folly::none;
+    }
+  }
+
+  if (ack.largestAckedPacketSentTime > hystartState_.rttRoundEndTarget) {
+    hystartState_.inRttRound = false;
+    if (hystartState_.cssBaselineMinRtt &&
+        ++hystartState_.cssRounds >= config.cssRounds) {
+      VLOG(15) << "Cubic exit slow start, reason = found exit point";
+      exitSlowStart();
+    }
+  }
+}
+
+void Cubic::exitSlowStart() noexcept {
+  hystartState_.inRttRound = false;
+  ssthresh_ = cwndBytes_;
+  /* Now we exit slow start, reset currSampledRtt to be maximal value so
+   * that next time we go back to slow start, we won't be using a very old
+   * sampled RTT as the lastSampledRtt:
+   */
+  hystartState_.currSampledRtt = folly::none;
+  hystartState_.currRoundMinRtt = folly::none;
+  hystartState_.cssBaselineMinRtt = folly::none;
+  hystartState_.cssRounds = 0;
+  steadyState_.lastMaxCwndBytes = folly::none;
+  steadyState_.lastReductionTime = folly::none;
+  quiescenceStart_ = folly::none;
+  state_ = CubicStates::Steady;
+}
+
 /**
  * Note: The Cubic paper, and linux/chromium implementation differ on the
  * definition of "time to origin", or the variable K in the paper. In the paper,
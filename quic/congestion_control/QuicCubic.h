@@ -10,6 +10,7 @@
 
 #include <quic/QuicException.h>
 #include <quic/congestion_control/CongestionControlFunctions.h>
+#include <quic/congestion_control/ProportionalRateReduction.h>
 #include <quic/logging/QuicLogger.h>
 #include <quic/state/StateData.h>
 
@@ -92,6 +93,10 @@ class Cubic : public CongestionController {
       override;
   void onRemoveBytesFromInflight(uint64_t) override;
   void onPacketSent(const OutstandingPacket& packet) override;
+  void onPacketsCeMarked(
+      uint64_t ceMarkedPackets,
+      TimePoint largestAckedSentTime) override;
+  void undoLoss(TimePoint lossTime) override;
 
   uint64_t getWritableBytes() const noexcept override;
   uint64_t getCongestionWindow() const noexcept override;
@@ -109,6 +114,9 @@ class Cubic : public CongestionController {
   bool isAppIdle() const noexcept;
   void onPacketAcked(const AckEvent& ack);
   void onPacketAckedInHystart(const AckEvent& ack);
+  void onPacketAckedInHystartPlusPlus(const AckEvent& ack);
+  // Moves from slow start to congestion avoidance with ssthresh at cwnd.
+  void exitSlowStart() noexcept;
   void onPacketAckedInSteady(const AckEvent& ack);
   void onPacketAckedInRecovery(const AckEvent& ack);
 
@@ -121,6 +129,8 @@ class Cubic : public CongestionController {
   void startHystartRttRound(TimePoint time) noexcept;
 
   void cubicReduction(TimePoint lossTime) noexcept;
+  // Reduces cwnd and starts a new recovery period upon a congestion event.
+  void enterRecovery(TimePoint eventTime) noexcept;
   void updateTimeToOrigin() noexcept;
   int64_t calculateCubicCwndDelta(TimePoint timePoint) noexcept;
   uint64_t calculateCubicCwnd(int64_t delta) noexcept;
@@ -158,6 +168,16 @@ class Cubic : public CongestionController {
     // When a packet with sent time >= rttRoundEndTarget is acked, end the
     // current RTT round
     TimePoint rttRoundEndTarget;
+
+    // HyStart++ state. The min of the ack rtt samples in the current and the
+    // last RTT round, and the number of samples in the current one.
+    folly::Optional<std::chrono::microseconds> currRoundMinRtt;
+    folly::Optional<std::chrono::microseconds> lastRoundMinRtt;
+    uint32_t rttSampleCount{0};
+    // Set while in Conservative Slow Start, to the min rtt that started it.
+    folly::Optional<std::chrono::microseconds> cssBaselineMinRtt;
+    // RTT rounds ended in Conservative Slow Start
+    uint8_t cssRounds{0};
   };
 
   struct SteadyState {
@@ -188,6 +208,28 @@ class Cubic : public CongestionController {
   HystartState hystartState_;
   SteadyState steadyState_;
   RecoveryState recoveryState_;
+  // Latest send time of the packets sent so far.
+  TimePoint lastSentTime_;
+  // What may be sent in a recovery period, if
+  // TransportSettings::proportionalRateReduction is set.
+  ProportionalRateReduction prr_;
+
+  // The state before the current recovery period, to restore if all the
+  // losses counted in it turn out to be spurious.
+  struct UndoState {
+    CubicStates state;
+    uint64_t cwndBytes;
+    uint64_t ssthresh;
+    folly::Optional<uint64_t> lossCwndBytes;
+    folly::Optional<uint64_t> lossSsthresh;
+    SteadyState steadyState;
+    RecoveryState recoveryState;
+    // lossTime of the LossEvent that started the recovery period
+    TimePoint firstLossTime;
+    // Packets lost in the recovery period and not acked yet
+    uint64_t lostPackets{0};
+  };
+  folly::Optional<UndoState> undoState_;
 
   // When spreadAcrossRtt_ is set to true, the pacing writes will be distributed
   // evenly across an RTT. Otherwise, we will use the first N number of pacing
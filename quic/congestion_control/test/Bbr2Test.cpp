@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/congestion_control/Bbr2.h>
+#include <folly/portability/GTest.h>
+#include <quic/common/test/TestUtils.h>
+
+#include <thread>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+class Bbr2Test : public Test {};
+
+TEST_F(Bbr2Test, InitStates) {
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  conn.udpSendPacketLen = 1000;
+  Bbr2CongestionController bbr2(conn);
+  EXPECT_EQ(CongestionControlType::BBR2, bbr2.type());
+  EXPECT_EQ("Startup", bbr2StateToString(bbr2.state()));
+  EXPECT_FALSE(bbr2.inflightHi().has_value());
+  EXPECT_FALSE(bbr2.inflightLo().has_value());
+  EXPECT_EQ(
+      1000 * conn.transportSettings.initCwndInMss, bbr2.getCongestionWindow());
+  EXPECT_EQ(bbr2.getWritableBytes(), bbr2.getCongestionWindow());
+}
+
+TEST_F(Bbr2Test, StartupExitOnLoss) {
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  conn.udpSendPacketLen = 1000;
+  conn.transportSettings.initCwndInMss = 10;
+  Bbr2CongestionController bbr2(conn);
+  auto sentTime = Clock::now();
+  bbr2.onPacketSent(makeTestingWritePacket(0, 100000, 100000, sentTime));
+
+  // A little loss doesn't end Startup.
+  CongestionController::LossEvent loss;
+  loss.lostBytes = 1000;
+  loss.lostPackets = 1;
+  bbr2.onPacketAckOrLoss(folly::none, loss);
+  EXPECT_FALSE(bbr2.inflightHi().has_value());
+
+  CongestionController::LossEvent loss2;
+  loss2.lostBytes = 10000;
+  loss2.lostPackets = 10;
+  bbr2.onPacketAckOrLoss(folly::none, loss2);
+  EXPECT_EQ(99000, *bbr2.inflightHi());
+  EXPECT_EQ(Bbr2CongestionController::Bbr2State::Startup, bbr2.state());
+
+  bbr2.onPacketAckOrLoss(
+      makeAck(1, 1000, Clock::now() + 1ms, sentTime), folly::none);
+  EXPECT_EQ(Bbr2CongestionController::Bbr2State::Drain, bbr2.state());
+}
+
+TEST_F(Bbr2Test, ProbeBwLossBounds) {
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  conn.udpSendPacketLen = 1000;
+  conn.transportSettings.initCwndInMss = 10;
+  Bbr2CongestionController bbr2(conn);
+  auto sentTime = Clock::now();
+  bbr2.onPacketSent(makeTestingWritePacket(0, 100000, 100000, sentTime));
+
+  CongestionController::LossEvent loss;
+  loss.lostBytes = 10000;
+  loss.lostPackets = 10;
+  bbr2.onPacketAckOrLoss(folly::none, loss);
+  bbr2.onPacketAckOrLoss(
+      makeAck(1, 1000, Clock::now() + 1ms, sentTime), folly::none);
+  EXPECT_EQ(Bbr2CongestionController::Bbr2State::Drain, bbr2.state());
+
+  // Draining down to the initial cwnd, which is the target without samplers,
+  // moves on to ProbeBw.
+  bbr2.onPacketAckOrLoss(
+      makeAck(2, 80000, Clock::now() + 1ms, sentTime), folly::none);
+  EXPECT_EQ(Bbr2CongestionController::Bbr2State::ProbeBw, bbr2.state());
+  EXPECT_EQ(Bbr2CongestionController::ProbeBwPhase::Down, bbr2.probeBwPhase());
+  bbr2.onPacketAckOrLoss(
+      makeAck(3, 1000, Clock::now() + 1ms, sentTime), folly::none);
+  EXPECT_EQ(
+      Bbr2CongestionController::ProbeBwPhase::Cruise, bbr2.probeBwPhase());
+  auto cwnd = bbr2.getCongestionWindow();
+
+  // A round with loss lowers the short term bounds.
+  std::this_thread::sleep_for(1ms);
+  auto roundSentTime = Clock::now();
+  bbr2.onPacketAckOrLoss(
+      makeAck(4, 1000, roundSentTime + 1ms, roundSentTime), folly::none);
+  CongestionController::LossEvent loss2;
+  loss2.lostBytes = 1000;
+  loss2.lostPackets = 1;
+  bbr2.onPacketAckOrLoss(folly::none, loss2);
+  EXPECT_FALSE(bbr2.inflightLo().has_value());
+  std::this_thread::sleep_for(1ms);
+  roundSentTime = Clock::now();
+  bbr2.onPacketAckOrLoss(
+      makeAck(5, 1000, roundSentTime + 1ms, roundSentTime), folly::none);
+  ASSERT_TRUE(bbr2.inflightLo().has_value());
+  EXPECT_LT(bbr2.getCongestionWindow(), cwnd);
+  EXPECT_EQ(*bbr2.inflightLo(), bbr2.getCongestionWindow());
+  EXPECT_EQ(100000, *bbr2.inflightHi());
+
+  // Once the probe wait is over, Refill resets the short term bounds and
+  // probing up starts one round later.
+  bbr2.onPacketAckOrLoss(
+      makeAck(6, 1000, Clock::now() + 4s, sentTime), folly::none);
+  EXPECT_EQ(
+      Bbr2CongestionController::ProbeBwPhase::Refill, bbr2.probeBwPhase());
+  EXPECT_FALSE(bbr2.inflightLo().has_value());
+  std::this_thread::sleep_for(1ms);
+  roundSentTime = Clock::now();
+  bbr2.onPacketAckOrLoss(
+      makeAck(7, 1000, roundSentTime + 4s, roundSentTime), folly::none);
+  EXPECT_EQ(Bbr2CongestionController::ProbeBwPhase::Up, bbr2.probeBwPhase());
+
+  // Too much loss while probing lowers inflightHi and goes back to Down.
+  CongestionController::LossEvent loss3;
+  loss3.lostBytes = 1000;
+  loss3.lostPackets = 1;
+  bbr2.onPacketAckOrLoss(folly::none, loss3);
+  EXPECT_EQ(Bbr2CongestionController::ProbeBwPhase::Down, bbr2.probeBwPhase());
+  EXPECT_LT(*bbr2.inflightHi(), 100000);
+}
+
+TEST_F(Bbr2Test, PersistentCongestion) {
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  conn.udpSendPacketLen = 1000;
+  Bbr2CongestionController bbr2(conn);
+  bbr2.onPacketSent(makeTestingWritePacket(0, 10000, 10000));
+  CongestionController::LossEvent loss;
+  loss.lostBytes = 5000;
+  loss.lostPackets = 5;
+  loss.persistentCongestion = true;
+  bbr2.onPacketAckOrLoss(folly::none, loss);
+  EXPECT_EQ(
+      conn.udpSendPacketLen * kMinCwndInMssForBbr, bbr2.getCongestionWindow());
+}
+
+TEST_F(Bbr2Test, RemoveInflightBytes) {
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  conn.udpSendPacketLen = 1000;
+  Bbr2CongestionController bbr2(conn);
+  auto writableBytesAfterInit = bbr2.getWritableBytes();
+  bbr2.onPacketSent(makeTestingWritePacket(0, 1000, 1000));
+  EXPECT_EQ(writableBytesAfterInit - 1000, bbr2.getWritableBytes());
+  bbr2.onRemoveBytesFromInflight(1000);
+  EXPECT_EQ(writableBytesAfterInit, bbr2.getWritableBytes());
+}
+
+} // namespace test
+} // namespace quic
@@ -53,6 +53,22 @@ TEST_F(BbrBandwidthSamplerTest, NoPreviousAckedPacketFallback) {
   EXPECT_EQ(50ms, sampler.getBandwidth().interval);
 }
 
+TEST_F(BbrBandwidthSamplerTest, AckEventRateSample) {
+  BbrBandwidthSampler sampler(conn_);
+  CongestionController::AckEvent ackEvent;
+  ackEvent.ackedBytes = 1000;
+  ackEvent.rateSample = CongestionController::DeliveryRateSample{
+      Bandwidth(3000, 1ms), false};
+  // The sample carried by the event is used as is.
+  sampler.onPacketAcked(ackEvent, 0);
+  EXPECT_EQ(Bandwidth(3000, 1ms), sampler.getBandwidth());
+
+  ackEvent.rateSample = CongestionController::DeliveryRateSample{
+      Bandwidth(1000, 1ms), true};
+  sampler.onPacketAcked(ackEvent, 1);
+  EXPECT_EQ(Bandwidth(3000, 1ms), sampler.getBandwidth());
+}
+
 TEST_F(BbrBandwidthSamplerTest, RateCalculation) {
   BbrBandwidthSampler sampler(conn_);
   CongestionController::AckEvent ackEvent;
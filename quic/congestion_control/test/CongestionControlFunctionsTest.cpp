@@ -72,6 +72,11 @@ TEST_F(CongestionControlFunctionsTest, RttSmallerThanInterval) {
       conn.transportSettings.writeConnectionDataPacketsLimit, result.burstSize);
 }
 
+TEST_F(CongestionControlFunctionsTest, EndOfSentPackets) {
+  auto now = Clock::now();
+  EXPECT_LE(now, endOfSentPackets(now - 1s));
+  EXPECT_EQ(now + 1h, endOfSentPackets(now + 1h));
+}
 
 } // namespace test
 } // namespace quic
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/congestion_control/CongestionControllerFactory.h>
+
+#include <folly/portability/GTest.h>
+#include <quic/congestion_control/NewReno.h>
+#include <quic/state/StateData.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+class CongestionControllerFactoryTest : public Test {};
+
+TEST_F(CongestionControllerFactoryTest, BuiltInTypes) {
+  QuicConnectionStateBase conn(QuicNodeType::Server);
+  DefaultCongestionControllerFactory factory;
+  EXPECT_EQ(
+      CongestionControlType::Cubic,
+      factory.makeCongestionController(conn, CongestionControlType::Cubic)
+          ->type());
+  EXPECT_EQ(
+      CongestionControlType::BBR2,
+      factory.makeCongestionController(conn, CongestionControlType::BBR2)
+          ->type());
+  EXPECT_EQ(
+      nullptr,
+      factory.makeCongestionController(conn, CongestionControlType::None));
+}
+
+TEST_F(CongestionControllerFactoryTest, CustomByName) {
+  QuicConnectionStateBase conn(QuicNodeType::Server);
+  DefaultCongestionControllerFactory factory;
+  uint32_t madeCount = 0;
+  factory.registerCongestionController(
+      "datacenter", [&](QuicConnectionStateBase& c) {
+        ++madeCount;
+        return std::make_unique<NewReno>(c);
+      });
+  EXPECT_TRUE(factory.isRegistered("datacenter"));
+  EXPECT_FALSE(factory.isRegistered("cellular"));
+
+  conn.transportSettings.congestionControllerName = "datacenter";
+  auto cc =
+      factory.makeCongestionController(conn, CongestionControlType::Cubic);
+  EXPECT_EQ(1, madeCount);
+  EXPECT_EQ(CongestionControlType::NewReno, cc->type());
+
+  // An unknown name falls back to the type.
+  conn.transportSettings.congestionControllerName = "cellular";
+  cc = factory.makeCongestionController(conn, CongestionControlType::Cubic);
+  EXPECT_EQ(1, madeCount);
+  EXPECT_EQ(CongestionControlType::Cubic, cc->type());
+}
+} // namespace test
+} // namespace quic
@@ -470,5 +470,62 @@ TEST_F(CopaTest, PacketLossInvokesPacer) {
   copa.onPacketAckOrLoss(folly::none, lossEvent);
 }
 
+TEST_F(CopaTest, CompetitiveMode) {
+  QuicServerConnectionState conn;
+  conn.transportSettings.copaConfig.competitiveModeEnabled = true;
+  Copa copa(conn);
+  auto qLogger = std::make_shared<FileQLogger>(VantagePoint::Server);
+  conn.qLogger = qLogger;
+  copa.onPacketSent(createPacket(0, 100000, 100000));
+  EXPECT_EQ(Copa::Mode::Default, copa.mode());
+  EXPECT_EQ(0.5, copa.delta());
+
+  auto now = Clock::now();
+  PacketNum packetNum = 1;
+  conn.lossState.srtt = 100ms;
+  conn.lossState.lrtt = 50ms;
+  copa.onPacketAckOrLoss(createAckEvent(packetNum++, 10, now), folly::none);
+
+  // The queue doesn't drain for more than 5 rtts. The standing rtt still sees
+  // the drained queue on the first of these acks.
+  conn.lossState.lrtt = 150ms;
+  for (int i = 0; i < 11; i++) {
+    now += 50ms;
+    copa.onPacketAckOrLoss(createAckEvent(packetNum++, 10, now), folly::none);
+    EXPECT_EQ(Copa::Mode::Default, copa.mode());
+  }
+  now += 50ms;
+  copa.onPacketAckOrLoss(createAckEvent(packetNum++, 10, now), folly::none);
+  EXPECT_EQ(Copa::Mode::Competitive, copa.mode());
+  auto indices =
+      getQLogEventIndices(QLogEventType::CongestionMetricUpdate, qLogger);
+  bool loggedSwitch = false;
+  for (auto index : indices) {
+    auto event = dynamic_cast<QLogCongestionMetricUpdateEvent*>(
+        qLogger->logs[index].get());
+    if (event->congestionEvent == kCopaModeSwitch) {
+      EXPECT_EQ(kCopaCompetitiveMode, event->state);
+      loggedSwitch = true;
+    }
+  }
+  EXPECT_TRUE(loggedSwitch);
+
+  // 1 / delta grows by one per rtt, and halves upon loss.
+  now += 100ms;
+  copa.onPacketAckOrLoss(createAckEvent(packetNum++, 10, now), folly::none);
+  EXPECT_DOUBLE_EQ(1.0 / 3, copa.delta());
+  now += 100ms;
+  copa.onPacketAckOrLoss(createAckEvent(packetNum++, 10, now), folly::none);
+  EXPECT_DOUBLE_EQ(1.0 / 4, copa.delta());
+  copa.onPacketAckOrLoss(folly::none, createLossEvent({{packetNum++, 10}}));
+  EXPECT_DOUBLE_EQ(1.0 / 2, copa.delta());
+
+  // Back to default mode once the queue drains.
+  conn.lossState.lrtt = 50ms;
+  now += 50ms;
+  copa.onPacketAckOrLoss(createAckEvent(packetNum++, 10, now), folly::none);
+  EXPECT_EQ(Copa::Mode::Default, copa.mode());
+  EXPECT_EQ(0.5, copa.delta());
+}
 } // namespace test
 } // namespace quic
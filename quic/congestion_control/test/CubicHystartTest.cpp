@@ -303,5 +303,103 @@ TEST_F(CubicHystartTest, ReduceByCubicReductionFactor) {
   EXPECT_EQ(initCwnd * kDefaultCubicReductionFactor, cubic.getWritableBytes());
   EXPECT_EQ(CubicStates::FastRecovery, cubic.state());
 }
+
+TEST_F(CubicHystartTest, HystartPlusPlusAckIncreaseLimit) {
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  conn.udpSendPacketLen = 100;
+  conn.transportSettings.cubicConfig.hystartPlusPlus = true;
+  Cubic cubic(conn);
+  auto initCwnd = cubic.getCongestionWindow();
+  conn.lossState.inflightBytes = 10000;
+  auto now = Clock::now();
+  cubic.onPacketAckOrLoss(makeAck(0, 2000, now, now - 1ms), folly::none);
+  // Without pacing cwnd grows by at most 8 MSS per ack.
+  EXPECT_EQ(
+      initCwnd + kHystartPlusPlusAckIncreaseLimitInMss * conn.udpSendPacketLen,
+      cubic.getCongestionWindow());
+}
+
+TEST_F(CubicHystartTest, HystartPlusPlusConservativeSlowStart) {
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  conn.udpSendPacketLen = 100;
+  conn.transportSettings.cubicConfig.hystartPlusPlus = true;
+  Cubic cubic(conn);
+  conn.lossState.inflightBytes = 1000000;
+  PacketNum packetNum = 0;
+  auto ackInRound = [&](std::chrono::microseconds rtt) {
+    auto now = Clock::now();
+    auto ack = makeAck(packetNum++, 100, now, now - 1s);
+    ack.mrttSample = rtt;
+    cubic.onPacketAckOrLoss(std::move(ack), folly::none);
+  };
+  auto ackEndOfRound = [&](std::chrono::microseconds rtt) {
+    // Sent after the round started, so it ends the round.
+    auto now = Clock::now();
+    auto ack = makeAck(packetNum++, 100, now + 2h, now + 1h);
+    ack.mrttSample = rtt;
+    cubic.onPacketAckOrLoss(std::move(ack), folly::none);
+  };
+
+  for (int i = 0; i < kAckSampling; i++) {
+    ackInRound(20ms);
+  }
+  ackEndOfRound(20ms);
+  // An rtt increase of 4ms over the 20ms of the last round is the threshold.
+  for (int i = 0; i < kAckSampling - 1; i++) {
+    ackInRound(24ms);
+  }
+  auto cwnd = cubic.getCongestionWindow();
+  ackInRound(24ms);
+  EXPECT_EQ(cwnd + 100, cubic.getCongestionWindow());
+  // Conservative Slow Start grows a quarter as fast.
+  cwnd = cubic.getCongestionWindow();
+  ackInRound(24ms);
+  EXPECT_EQ(
+      cwnd + 100 / kHystartPlusPlusCssGrowthDivisor,
+      cubic.getCongestionWindow());
+  EXPECT_EQ(CubicStates::Hystart, cubic.state());
+
+  for (int i = 0; i < kHystartPlusPlusCssRounds - 1; i++) {
+    ackEndOfRound(24ms);
+    EXPECT_EQ(CubicStates::Hystart, cubic.state());
+  }
+  ackEndOfRound(24ms);
+  EXPECT_EQ(CubicStates::Steady, cubic.state());
+}
+
+TEST_F(CubicHystartTest, HystartPlusPlusSpuriousRttIncrease) {
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  conn.udpSendPacketLen = 100;
+  conn.transportSettings.cubicConfig.hystartPlusPlus = true;
+  Cubic cubic(conn);
+  conn.lossState.inflightBytes = 1000000;
+  PacketNum packetNum = 0;
+  auto ack = [&](std::chrono::microseconds rtt, bool endOfRound) {
+    auto now = endOfRound ? Clock::now() + 1h : Clock::now() - 1s;
+    auto ackEvent = makeAck(packetNum++, 100, now + 1ms, now);
+    ackEvent.mrttSample = rtt;
+    cubic.onPacketAckOrLoss(std::move(ackEvent), folly::none);
+  };
+  for (int i = 0; i < kAckSampling; i++) {
+    ack(20ms, false);
+  }
+  ack(20ms, true);
+  for (int i = 0; i < kAckSampling; i++) {
+    ack(30ms, false);
+  }
+  // In Conservative Slow Start from here.
+  ack(30ms, true);
+  // A lower rtt in the next round goes back to slow start.
+  for (int i = 0; i < kAckSampling; i++) {
+    ack(25ms, false);
+  }
+  auto cwnd = cubic.getCongestionWindow();
+  ack(25ms, false);
+  EXPECT_EQ(cwnd + 100, cubic.getCongestionWindow());
+  for (int i = 0; i < kHystartPlusPlusCssRounds; i++) {
+    ack(25ms, true);
+  }
+  EXPECT_EQ(CubicStates::Hystart, cubic.state());
+}
 } // namespace test
 } // namespace quic
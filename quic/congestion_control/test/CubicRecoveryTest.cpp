@@ -166,5 +166,48 @@ TEST_F(CubicRecoveryTest, AckNotLargestNotChangeCwnd) {
   // Cwnd never changed during the whole time, and inflight is 0 at this point:
   EXPECT_EQ(cwndAfterLoss, cubic.getWritableBytes());
 }
+
+TEST_F(CubicRecoveryTest, UndoSpuriousLoss) {
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  Cubic cubic(conn);
+  auto originalCwnd = cubic.getCongestionWindow();
+  auto packet0 = makeTestingWritePacket(0, 1000, 1000);
+  auto packet1 = makeTestingWritePacket(1, 1000, 2000);
+  cubic.onPacketSent(packet0);
+  cubic.onPacketSent(packet1);
+  conn.lossState.largestSent = 1;
+  CongestionController::LossEvent loss;
+  loss.addLostPacket(packet0);
+  auto lossTime = loss.lossTime;
+  cubic.onPacketAckOrLoss(folly::none, std::move(loss));
+  EXPECT_EQ(CubicStates::FastRecovery, cubic.state());
+  auto cwndAfterLoss = cubic.getCongestionWindow();
+  EXPECT_GT(originalCwnd, cwndAfterLoss);
+
+  // Another loss in the same recovery period.
+  CongestionController::LossEvent loss2;
+  loss2.addLostPacket(packet1);
+  auto lossTime2 = loss2.lossTime;
+  cubic.onPacketAckOrLoss(folly::none, std::move(loss2));
+  EXPECT_EQ(cwndAfterLoss, cubic.getCongestionWindow());
+
+  cubic.undoLoss(lossTime2);
+  EXPECT_EQ(CubicStates::FastRecovery, cubic.state());
+  EXPECT_EQ(cwndAfterLoss, cubic.getCongestionWindow());
+  cubic.undoLoss(lossTime);
+  EXPECT_EQ(CubicStates::Hystart, cubic.state());
+  EXPECT_EQ(originalCwnd, cubic.getCongestionWindow());
+
+  // The undone recovery period is over, the next loss starts a new one.
+  auto packet2 = makeTestingWritePacket(2, 1000, 3000);
+  cubic.onPacketSent(packet2);
+  conn.lossState.largestSent = 2;
+  CongestionController::LossEvent loss3;
+  loss3.addLostPacket(packet2);
+  cubic.onPacketAckOrLoss(folly::none, std::move(loss3));
+  EXPECT_EQ(CubicStates::FastRecovery, cubic.state());
+  EXPECT_GT(originalCwnd, cubic.getCongestionWindow());
+}
+
 } // namespace test
 } // namespace quic
@@ -222,5 +222,88 @@ TEST_F(NewRenoTest, RemoveBytesWithoutLossOrAck) {
   reno.onRemoveBytesFromInflight(2);
   EXPECT_EQ(reno.getWritableBytes(), originalWritableBytes - ackedSize + 2);
 }
+
+TEST_F(NewRenoTest, CeMarksOncePerRecovery) {
+  QuicServerConnectionState conn;
+  NewReno reno(conn);
+  EXPECT_TRUE(reno.inSlowStart());
+  auto originalCwnd = reno.getCongestionWindow();
+
+  auto sentTime = Clock::now();
+  reno.onPacketsCeMarked(2, sentTime);
+  EXPECT_FALSE(reno.inSlowStart());
+  auto reducedCwnd = reno.getCongestionWindow();
+  EXPECT_LT(reducedCwnd, originalCwnd);
+
+  // Marks on packets sent before the recovery started are the same event.
+  reno.onPacketsCeMarked(1, sentTime);
+  EXPECT_EQ(reducedCwnd, reno.getCongestionWindow());
+
+  reno.onPacketsCeMarked(1, Clock::now() + 1ms);
+  EXPECT_LT(reno.getCongestionWindow(), reducedCwnd);
+}
+
+TEST_F(NewRenoTest, UndoSpuriousLoss) {
+  QuicServerConnectionState conn;
+  NewReno reno(conn);
+  auto originalCwnd = reno.getCongestionWindow();
+  reno.onPacketSent(createPacket(1, 10, Clock::now()));
+  reno.onPacketSent(createPacket(2, 10, Clock::now()));
+  auto loss = createLossEvent({std::make_pair(1, 10), std::make_pair(2, 20)});
+  auto lossTime = loss.lossTime;
+  reno.onPacketAckOrLoss(folly::none, std::move(loss));
+  EXPECT_FALSE(reno.inSlowStart());
+  auto reducedCwnd = reno.getCongestionWindow();
+  EXPECT_LT(reducedCwnd, originalCwnd);
+
+  // A loss from before the recovery period doesn't count.
+  reno.undoLoss(lossTime - 1ms);
+  reno.undoLoss(lossTime);
+  EXPECT_EQ(reducedCwnd, reno.getCongestionWindow());
+  // Once every loss of the recovery period is spurious, it's all undone.
+  reno.undoLoss(lossTime);
+  EXPECT_EQ(originalCwnd, reno.getCongestionWindow());
+  EXPECT_TRUE(reno.inSlowStart());
+  reno.undoLoss(lossTime);
+  EXPECT_EQ(originalCwnd, reno.getCongestionWindow());
+}
+
+TEST_F(NewRenoTest, ProportionalRateReduction) {
+  QuicServerConnectionState conn;
+  conn.transportSettings.proportionalRateReduction = true;
+  NewReno reno(conn);
+  auto sentTime = Clock::now();
+  for (PacketNum packetNum = 0; packetNum < 10; packetNum++) {
+    reno.onPacketSent(createPacket(packetNum, 1000, sentTime));
+  }
+  reno.onPacketAckOrLoss(
+      folly::none, createLossEvent({std::make_pair(0, 1000)}));
+  auto ssthresh = reno.getCongestionWindow();
+  EXPECT_LT(ssthresh, reno.getBytesInFlight());
+  EXPECT_EQ(0, reno.getWritableBytes());
+
+  // ssthresh is sent for each of the 10000 bytes in flight at the loss that
+  // are delivered, even though the bytes in flight are still above cwnd.
+  auto ack = createAckEvent(1, 1000, sentTime);
+  ack.largestAckedPacketSentTime = sentTime;
+  reno.onPacketAckOrLoss(std::move(ack), folly::none);
+  auto writable = (1000 * ssthresh + 9999) / 10000;
+  EXPECT_EQ(writable, reno.getWritableBytes());
+  reno.onPacketSent(createPacket(10, writable, sentTime));
+  EXPECT_EQ(0, reno.getWritableBytes());
+
+  // The recovery period ends with the ack of a packet sent after it started.
+  auto laterSentTime = sentTime + std::chrono::seconds(1);
+  reno.onPacketSent(createPacket(11, 1000, laterSentTime));
+  ack = createAckEvent(11, 1000, laterSentTime);
+  ack.largestAckedPacketSentTime = laterSentTime;
+  reno.onPacketAckOrLoss(std::move(ack), folly::none);
+  EXPECT_EQ(
+      reno.getCongestionWindow() > reno.getBytesInFlight()
+          ? reno.getCongestionWindow() - reno.getBytesInFlight()
+          : 0,
+      reno.getWritableBytes());
+}
+
 } // namespace test
 } // namespace quic
@@ -201,5 +201,76 @@ TEST_F(PacerTest, Tokens) {
   EXPECT_EQ(20, pacer.updateAndGetWriteBatchSize(curTime + 20ms));
 }
 
+TEST_F(PacerTest, MaxPacingRate) {
+  conn.udpSendPacketLen = 1000;
+  conn.transportSettings.pacingTimerTickInterval = 1ms;
+  // Pacing rate: 10 mss per 1 ms
+  pacer.setPacingRateCalculator([](const QuicConnectionStateBase&,
+                                   uint64_t,
+                                   uint64_t,
+                                   std::chrono::microseconds) {
+    return PacingRate::Builder().setInterval(1ms).setBurstSize(10).build();
+  });
+  pacer.refreshPacingRate(100, 100ms);
+  EXPECT_EQ(10, pacer.getCachedWriteBatchSize());
+
+  // 2 mss per ms.
+  pacer.setMaxPacingRate(2000000);
+  EXPECT_EQ(2, pacer.getCachedWriteBatchSize());
+  consumeTokensHelper(pacer, 100);
+  EXPECT_EQ(1ms, pacer.getTimeUntilNextWrite());
+  // Even when app limited.
+  pacer.setAppLimited(true);
+  EXPECT_EQ(1ms, pacer.getTimeUntilNextWrite());
+
+  // Less than a packet per tick.
+  pacer.setMaxPacingRate(500000);
+  EXPECT_EQ(1, pacer.getCachedWriteBatchSize());
+  consumeTokensHelper(pacer, 100);
+  EXPECT_EQ(2ms, pacer.getTimeUntilNextWrite());
+
+  // Not slower than the cap when it would be unpaced otherwise.
+  pacer.refreshPacingRate(100, 1us);
+  EXPECT_EQ(1, pacer.getCachedWriteBatchSize());
+  pacer.setMaxPacingRate(5000000);
+  EXPECT_EQ(5, pacer.getCachedWriteBatchSize());
+
+  pacer.setMaxPacingRate(folly::none);
+  EXPECT_EQ(0us, pacer.getTimeUntilNextWrite());
+  EXPECT_EQ(
+      conn.transportSettings.writeConnectionDataPacketsLimit,
+      pacer.getCachedWriteBatchSize());
+}
+
+TEST_F(PacerTest, TxTimeDepartureTimes) {
+  conn.transportSettings.pacingUsesTxTime = true;
+  conn.udpSendPacketLen = 1000;
+  // Pacing rate: 10 mss per 10 ms
+  pacer.setPacingRateCalculator([](const QuicConnectionStateBase&,
+                                   uint64_t,
+                                   uint64_t,
+                                   std::chrono::microseconds) {
+    return PacingRate::Builder().setInterval(10ms).setBurstSize(10).build();
+  });
+  pacer.refreshPacingRate(100, 100ms);
+
+  // Writes are never held back by the timer, the kernel does the spacing.
+  EXPECT_EQ(0us, pacer.getTimeUntilNextWrite());
+  EXPECT_EQ(
+      conn.transportSettings.writeConnectionDataPacketsLimit,
+      pacer.updateAndGetWriteBatchSize(Clock::now()));
+
+  auto now = Clock::now();
+  EXPECT_EQ(now, pacer.getDepartureTime(now, 1000));
+  EXPECT_EQ(now + 1ms, pacer.getDepartureTime(now, 500));
+  EXPECT_EQ(now + 1500us, pacer.getDepartureTime(now, 1000));
+  // An idle pacing clock starts again from the current time.
+  EXPECT_EQ(now + 1s, pacer.getDepartureTime(now + 1s, 1000));
+
+  pacer.setAppLimited(true);
+  EXPECT_EQ(now + 2s, pacer.getDepartureTime(now + 2s, 1000));
+  EXPECT_EQ(now + 2s, pacer.getDepartureTime(now + 2s, 1000));
+}
+
 } // namespace test
 } // namespace quic
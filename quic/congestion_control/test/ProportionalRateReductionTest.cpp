@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/congestion_control/ProportionalRateReduction.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+TEST(ProportionalRateReductionTest, Proportional) {
+  ProportionalRateReduction prr;
+  EXPECT_FALSE(prr.inRecovery());
+  prr.start(10000, 5000);
+  EXPECT_TRUE(prr.inRecovery());
+  EXPECT_EQ(0, prr.getWritableBytes());
+
+  // Half of what is delivered while above ssthresh.
+  prr.onAck(1000, 8000, 1000);
+  EXPECT_EQ(500, prr.getWritableBytes());
+  prr.onPacketSent(300);
+  EXPECT_EQ(200, prr.getWritableBytes());
+  // What wasn't sent carries over.
+  prr.onAck(1000, 7000, 1000);
+  EXPECT_EQ(700, prr.getWritableBytes());
+
+  prr.stop();
+  EXPECT_FALSE(prr.inRecovery());
+  EXPECT_EQ(0, prr.getWritableBytes());
+}
+
+TEST(ProportionalRateReductionTest, SlowStartReductionBound) {
+  ProportionalRateReduction prr;
+  prr.start(10000, 5000);
+  // Far below ssthresh after a large loss, it grows back by at most an mss
+  // more than what is delivered.
+  prr.onAck(1000, 1000, 1200);
+  EXPECT_EQ(2200, prr.getWritableBytes());
+  prr.onPacketSent(2200);
+  // Close to ssthresh, only up to it.
+  prr.onAck(3000, 4500, 1200);
+  EXPECT_EQ(500, prr.getWritableBytes());
+}
+
+} // namespace test
+} // namespace quic
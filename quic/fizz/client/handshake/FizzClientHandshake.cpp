@@ -17,15 +17,8 @@
 #include <fizz/client/EarlyDataRejectionPolicy.h>
 #include <fizz/protocol/Protocol.h>
 
-#include <fizz/crypto/aead/AESGCM128.h>
-
 namespace quic {
 
-constexpr folly::StringPiece retryPacketKey =
-    "\x4d\x32\xec\xdb\x2a\x21\x33\xc8\x41\xe4\x04\x3d\xf2\x7d\x44\x30";
-constexpr folly::StringPiece retryPacketNonce =
-    "\x4d\x16\x11\xd0\x55\x13\xa5\x52\xc5\x87\xd5\x75";
-
 FizzClientHandshake::FizzClientHandshake(
     QuicClientConnectionState* conn,
     std::shared_ptr<FizzClientQuicHandshakeContext> fizzContext)
@@ -47,7 +40,8 @@ FizzClientHandshake::connectImpl(folly::Optional<std::string> hostname) {
   auto context = std::make_shared<fizz::client::FizzClientContext>(
       *fizzContext_->getContext());
   context->setFactory(cryptoFactory_.getFizzFactory());
-  context->setSupportedCiphers({fizz::CipherSuite::TLS_AES_128_GCM_SHA256});
+  // Offered fastest first, which the server goes by when it has no preference.
+  context->setSupportedCiphers(getCipherSuitesBySpeed());
   context->setCompatibilityMode(false);
   // Since Draft-17, EOED should not be sent
   context->setOmitEarlyRecordLayer(true);
@@ -103,14 +97,30 @@ FizzClientHandshake::getApplicationProtocol() const {
   }
 }
 
+folly::Optional<std::string> FizzClientHandshake::getCipherSuite() const {
+  if (!state_.cipher()) {
+    return folly::none;
+  }
+  return fizz::toString(*state_.cipher());
+}
+
+std::unique_ptr<Aead> FizzClientHandshake::getNextOneRttReadCipher() {
+  if (oneRttReadSecret_.empty() || !state_.cipher()) {
+    return nullptr;
+  }
+  return cryptoFactory_.makeNextOneRttAead(*state_.cipher(), oneRttReadSecret_);
+}
+
+std::unique_ptr<Aead> FizzClientHandshake::getNextOneRttWriteCipher() {
+  if (oneRttWriteSecret_.empty() || !state_.cipher()) {
+    return nullptr;
+  }
+  return cryptoFactory_.makeNextOneRttAead(
+      *state_.cipher(), oneRttWriteSecret_);
+}
+
 std::unique_ptr<Aead> FizzClientHandshake::getRetryPacketCipher() {
-  std::unique_ptr<fizz::Aead> aead =
-      fizz::OpenSSLEVPCipher::makeCipher<fizz::AESGCM128>();
-  fizz::TrafficKey trafficKey;
-  trafficKey.key = folly::IOBuf::copyBuffer(retryPacketKey);
-  trafficKey.iv = folly::IOBuf::copyBuffer(retryPacketNonce);
-  aead->setKey(std::move(trafficKey));
-  return FizzAead::wrap(std::move(aead));
+  return cryptoFactory_.makeRetryAead();
 }
 
 bool FizzClientHandshake::isTLSResumed() const {
@@ -142,15 +152,19 @@ FizzClientHandshake::buildCiphers(CipherKind kind, folly::ByteRange secret) {
   fizz::KeyScheduler& keyScheduler =
       isEarlyTraffic ? *keySchedulerPtr : *state_.keyScheduler();
 
-  auto aead = FizzAead::wrap(fizz::Protocol::deriveRecordAeadWithLabel(
-      *state_.context()->getFactory(),
-      keyScheduler,
-      cipher,
-      secret,
-      kQuicKeyLabel,
-      kQuicIVLabel));
+  auto aead = FizzAead::wrap(
+      fizz::Protocol::deriveRecordAeadWithLabel(
+          *state_.context()->getFactory(),
+          keyScheduler,
+          cipher,
+          secret,
+          kQuicKeyLabel,
+          kQuicIVLabel),
+      state_.context()->getFactory(),
+      cipher);
 
-  auto packetNumberCipher = cryptoFactory_.makePacketNumberCipher(secret);
+  auto packetNumberCipher =
+      cryptoFactory_.makePacketNumberCipher(cipher, secret);
 
   return {std::move(aead), std::move(packetNumberCipher)};
 }
@@ -278,11 +292,13 @@ class FizzClientHandshake::ActionMoveVisitor {
             client_.computeCiphers(
                 CipherKind::OneRttWrite,
                 folly::range(secretAvailable.secret.secret));
+            client_.oneRttWriteSecret_ = secretAvailable.secret.secret;
             break;
           case fizz::AppTrafficSecrets::ServerAppTraffic:
             client_.computeCiphers(
                 CipherKind::OneRttRead,
                 folly::range(secretAvailable.secret.secret));
+            client_.oneRttReadSecret_ = secretAvailable.secret.secret;
             break;
         }
         break;
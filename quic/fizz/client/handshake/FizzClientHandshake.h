@@ -31,6 +31,12 @@ class FizzClientHandshake : public ClientHandshake {
 
   const folly::Optional<std::string>& getApplicationProtocol() const override;
 
+  folly::Optional<std::string> getCipherSuite() const override;
+
+  std::unique_ptr<Aead> getNextOneRttReadCipher() override;
+
+  std::unique_ptr<Aead> getNextOneRttWriteCipher() override;
+
   std::unique_ptr<Aead> getRetryPacketCipher() override;
 
   bool isTLSResumed() const override;
@@ -63,6 +69,9 @@ class FizzClientHandshake : public ClientHandshake {
   fizz::client::ClientStateMachine machine_;
 
   FizzCryptoFactory cryptoFactory_;
+  // The 1-RTT secrets of the latest key phase derived, for key updates.
+  std::vector<uint8_t> oneRttReadSecret_;
+  std::vector<uint8_t> oneRttWriteSecret_;
 
   std::shared_ptr<FizzClientQuicHandshakeContext> fizzContext_;
 };
@@ -9,6 +9,7 @@
 #include <quic/fizz/client/handshake/FizzClientQuicHandshakeContext.h>
 
 #include <quic/fizz/client/handshake/FizzClientHandshake.h>
+#include <quic/fizz/handshake/FizzCertCompression.h>
 
 namespace quic {
 
@@ -53,7 +54,9 @@ void FizzClientQuicHandshakeContext::removePsk(
 std::shared_ptr<FizzClientQuicHandshakeContext>
 FizzClientQuicHandshakeContext::Builder::build() {
   if (!context_) {
-    context_ = std::make_shared<const fizz::client::FizzClientContext>();
+    auto context = std::make_shared<fizz::client::FizzClientContext>();
+    enableCertificateDecompression(*context);
+    context_ = std::move(context);
   }
   if (!verifier_) {
     verifier_ = std::make_shared<const fizz::DefaultCertificateVerifier>(
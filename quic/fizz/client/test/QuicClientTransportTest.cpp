@@ -29,6 +29,7 @@
 #include <quic/fizz/handshake/FizzCryptoFactory.h>
 #include <quic/handshake/TransportParameters.h>
 #include <quic/handshake/test/Mocks.h>
+#include <quic/happyeyeballs/QuicHappyEyeballsCache.h>
 #include <quic/happyeyeballs/QuicHappyEyeballsFunctions.h>
 #include <quic/logging/FileQLogger.h>
 #include <quic/logging/test/Mocks.h>
@@ -1826,6 +1827,28 @@ TEST_F(QuicClientTransportTest, onNetworkSwitchReplaceAfterHandshake) {
   client->closeNow(folly::none);
 }
 
+TEST_F(QuicClientTransportTest, onNetworkSwitchResetsCongestionAndRtt) {
+  auto& conn = client->getNonConstConn();
+  conn.oneRttWriteCipher = test::createNoOpAead();
+  auto oldCongestionController = conn.congestionController.get();
+  conn.lossState.srtt = 50ms;
+  conn.lossState.lrtt = 40ms;
+  conn.lossState.rttvar = 10ms;
+  conn.lossState.mrtt = 30ms;
+
+  auto newSocket = std::make_unique<NiceMock<folly::test::MockAsyncUDPSocket>>(
+      eventbase_.get());
+  client->onNetworkSwitch(std::move(newSocket));
+  ASSERT_NE(nullptr, conn.congestionController);
+  EXPECT_NE(oldCongestionController, conn.congestionController.get());
+  EXPECT_EQ(0us, conn.lossState.srtt);
+  EXPECT_EQ(0us, conn.lossState.lrtt);
+  EXPECT_EQ(0us, conn.lossState.rttvar);
+  EXPECT_EQ(kDefaultMinRtt, conn.lossState.mrtt);
+
+  client->closeNow(folly::none);
+}
+
 TEST_F(QuicClientTransportTest, onNetworkSwitchReplaceNoHandshake) {
   auto newSocket = std::make_unique<NiceMock<folly::test::MockAsyncUDPSocket>>(
       eventbase_.get());
@@ -2667,6 +2690,48 @@ TEST_F(QuicClientTransportHappyEyeballsTest, V4FirstAndV6BindFailure) {
   secondBindFailure(serverAddrV4, serverAddrV6);
 }
 
+namespace {
+const std::string kHost = "example.com";
+} // namespace
+
+TEST_F(QuicClientTransportHappyEyeballsTest, CacheRecordsWinner) {
+  auto cache = std::make_shared<QuicHappyEyeballsCache>();
+  client->setHostname(kHost);
+  client->setHappyEyeballsCache(cache);
+  secondWin(serverAddrV6, serverAddrV4);
+  auto entry = cache->get(kHost, Clock::now());
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(AF_INET, entry->family);
+  EXPECT_EQ(1, entry->wins);
+}
+
+TEST_F(QuicClientTransportHappyEyeballsTest, CacheStartsWithWinner) {
+  auto cache = std::make_shared<QuicHappyEyeballsCache>();
+  cache->onRaceWon(kHost, AF_INET, Clock::now());
+  client->setHostname(kHost);
+  client->setHappyEyeballsCache(cache);
+  firstWinBeforeSecondStart(serverAddrV4, serverAddrV6);
+  auto entry = cache->get(kHost, Clock::now());
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(2, entry->wins);
+}
+
+TEST_F(QuicClientTransportHappyEyeballsTest, CacheSkipsRace) {
+  auto cache = std::make_shared<QuicHappyEyeballsCache>();
+  for (uint32_t i = 0; i < kHappyEyeballsSkipRaceAfterWins; ++i) {
+    cache->onRaceWon(kHost, AF_INET, Clock::now());
+  }
+  client->setHostname(kHost);
+  client->setHappyEyeballsCache(cache);
+  auto& conn = client->getConn();
+  EXPECT_CALL(*sock, write(serverAddrV4, _));
+  client->start(&clientConnCallback);
+  EXPECT_EQ(conn.peerAddress, serverAddrV4);
+  EXPECT_FALSE(conn.happyEyeballsState.secondSocket);
+  EXPECT_FALSE(client->happyEyeballsConnAttemptDelayTimeout().isScheduled());
+  EXPECT_TRUE(conn.happyEyeballsState.finished);
+}
+
 TEST_F(
     QuicClientTransportHappyEyeballsTest,
     V4FirstAndV4NonFatalErrorBeforeV6Start) {
@@ -3950,6 +4015,9 @@ TEST_F(QuicClientTransportAfterStartTest, IdleTimerResetNoOutstandingPackets) {
 TEST_F(QuicClientTransportAfterStartTest, IdleTimeoutExpired) {
   EXPECT_CALL(*sock, close());
   socketWrites.clear();
+  // The idle timer was just refreshed, so expire it right away rather
+  // than rearming it for the rest of the idle period.
+  client->getNonConstConn().transportSettings.lazyIdleTimer = false;
   client->idleTimeout().timeoutExpired();
 
   EXPECT_FALSE(client->idleTimeout().isScheduled());
@@ -3969,6 +4037,9 @@ TEST_F(QuicClientTransportAfterStartTest, RecvDataAfterIdleTimeout) {
   auto qLogger = std::make_shared<FileQLogger>(VantagePoint::Client);
   client->getNonConstConn().qLogger = qLogger;
   EXPECT_CALL(*sock, close());
+  // The idle timer was just refreshed, so expire it right away rather
+  // than rearming it for the rest of the idle period.
+  client->getNonConstConn().transportSettings.lazyIdleTimer = false;
   client->idleTimeout().timeoutExpired();
 
   socketWrites.clear();
@@ -8,8 +8,23 @@
 
 #include <quic/fizz/handshake/FizzBridge.h>
 
+#include <fizz/protocol/Factory.h>
+
 namespace quic {
 
+std::unique_ptr<Aead> FizzAead::clone() const {
+  if (!factory_) {
+    return nullptr;
+  }
+  auto key = fizzAead->getKey();
+  if (!key) {
+    return nullptr;
+  }
+  auto aead = factory_->makeAead(cipher_);
+  aead->setKey(std::move(*key));
+  return wrap(std::move(aead), factory_, cipher_);
+}
+
 EncryptionLevel getEncryptionLevelFromFizz(
     const fizz::EncryptionLevel encryptionLevel) {
   switch (encryptionLevel) {
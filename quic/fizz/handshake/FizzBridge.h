@@ -16,6 +16,10 @@
 #include <memory>
 #include <utility>
 
+namespace fizz {
+class Factory;
+} // namespace fizz
+
 namespace quic {
 
 class FizzAead final : public Aead {
@@ -29,6 +33,22 @@ class FizzAead final : public Aead {
     return std::unique_ptr<FizzAead>(new FizzAead(std::move(fizzAeadIn)));
   }
 
+  /**
+   * Same as above, but the aead can be cloned through the factory it was made
+   * by, which has to outlive it and its clones.
+   */
+  static std::unique_ptr<FizzAead> wrap(
+      std::unique_ptr<fizz::Aead> fizzAeadIn,
+      const fizz::Factory* factory,
+      fizz::CipherSuite cipher) {
+    auto aead = wrap(std::move(fizzAeadIn));
+    if (aead) {
+      aead->factory_ = factory;
+      aead->cipher_ = cipher;
+    }
+    return aead;
+  }
+
   /**
    * Simply forward all calls to fizz::Aead.
    */
@@ -38,6 +58,27 @@ class FizzAead final : public Aead {
       uint64_t seqNum) const override {
     return fizzAead->encrypt(std::move(plaintext), associatedData, seqNum);
   }
+  std::unique_ptr<folly::IOBuf> inplaceEncrypt(
+      std::unique_ptr<folly::IOBuf>&& plaintext,
+      const folly::IOBuf* associatedData,
+      uint64_t seqNum) const override {
+    // fizz encrypts an unshared buffer in place as long as the tag fits into
+    // its tailroom.
+    if (plaintext->isShared() ||
+        plaintext->tailroom() < fizzAead->getCipherOverhead()) {
+      return Aead::inplaceEncrypt(
+          std::move(plaintext), associatedData, seqNum);
+    }
+    return fizzAead->encrypt(std::move(plaintext), associatedData, seqNum);
+  }
+  void encryptBatch(folly::Range<BatchEntry*> entries) const override {
+    // fizz only exposes single packet encryption, so this saves the virtual
+    // dispatch per packet. A multi buffer cipher would be plugged in here.
+    for (auto& entry : entries) {
+      entry.buf = fizzAead->encrypt(
+          std::move(entry.buf), entry.associatedData, entry.seqNum);
+    }
+  }
   std::unique_ptr<folly::IOBuf> decrypt(
       std::unique_ptr<folly::IOBuf>&& ciphertext,
       const folly::IOBuf* associatedData,
@@ -50,10 +91,25 @@ class FizzAead final : public Aead {
       uint64_t seqNum) const override {
     return fizzAead->tryDecrypt(std::move(ciphertext), associatedData, seqNum);
   }
+  folly::Optional<std::unique_ptr<folly::IOBuf>> tryInplaceDecrypt(
+      std::unique_ptr<folly::IOBuf>&& ciphertext,
+      const folly::IOBuf* associatedData,
+      uint64_t seqNum) const override {
+    // fizz decrypts an unshared buffer in place, only a shared one needs the
+    // copy.
+    if (ciphertext->isShared()) {
+      return Aead::tryInplaceDecrypt(
+          std::move(ciphertext), associatedData, seqNum);
+    }
+    CHECK(!ciphertext->isChained());
+    return fizzAead->tryDecrypt(std::move(ciphertext), associatedData, seqNum);
+  }
   size_t getCipherOverhead() const override {
     return fizzAead->getCipherOverhead();
   }
 
+  std::unique_ptr<Aead> clone() const override;
+
   // For testing.
   const fizz::Aead* getFizzAead() const {
     return fizzAead.get();
@@ -61,6 +117,8 @@ class FizzAead final : public Aead {
 
  private:
   std::unique_ptr<fizz::Aead> fizzAead;
+  const fizz::Factory* factory_{nullptr};
+  fizz::CipherSuite cipher_{fizz::CipherSuite::TLS_AES_128_GCM_SHA256};
   explicit FizzAead(std::unique_ptr<fizz::Aead> fizzAeadIn)
       : fizzAead(std::move(fizzAeadIn)) {}
 };
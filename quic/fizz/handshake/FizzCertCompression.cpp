@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/fizz/handshake/FizzCertCompression.h>
+
+#include <fizz/compression/CertDecompressionManager.h>
+#include <fizz/compression/ZlibCertificateDecompressor.h>
+
+namespace quic {
+
+void enableCertificateCompression(fizz::server::FizzServerContext& ctx) {
+  ctx.setSupportedCompressionAlgorithms(
+      {fizz::CertificateCompressionAlgorithm::zlib});
+}
+
+void enableCertificateDecompression(fizz::client::FizzClientContext& ctx) {
+  auto decompressionManager =
+      std::make_shared<fizz::CertDecompressionManager>();
+  decompressionManager->setDecompressors(
+      {std::make_shared<fizz::ZlibCertificateDecompressor>()});
+  ctx.setCertDecompressionManager(std::move(decompressionManager));
+}
+
+} // namespace quic
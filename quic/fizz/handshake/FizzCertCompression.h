@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <fizz/client/FizzClientContext.h>
+#include <fizz/compression/ZlibCertificateCompressor.h>
+#include <fizz/protocol/Certificate.h>
+#include <fizz/server/FizzServerContext.h>
+
+namespace quic {
+
+// The chain is only compressed once per cert, so the slowest level costs
+// nothing per handshake.
+constexpr int kDefaultCertCompressionLevel = 9;
+
+/**
+ * Compresses the chain of cert with zlib, as RFC 8879 has it, so that the
+ * server can send it in place of the Certificate message to clients that
+ * support it. That keeps more of the first flight under the anti-amplification
+ * limit. The compressed chain is kept in cert, it isn't redone per handshake.
+ */
+template <fizz::KeyType T>
+void compressCertificate(
+    fizz::SelfCertImpl<T>& cert,
+    int level = kDefaultCertCompressionLevel) {
+  cert.setCompressors(
+      {std::make_shared<fizz::ZlibCertificateCompressor>(level)});
+}
+
+/**
+ * Has ctx negotiate zlib certificate compression. Only the certs that went
+ * through compressCertificate() are sent compressed.
+ */
+void enableCertificateCompression(fizz::server::FizzServerContext& ctx);
+
+/**
+ * Has ctx offer zlib certificate compression, and decompress the chains the
+ * server sends compressed.
+ */
+void enableCertificateDecompression(fizz::client::FizzClientContext& ctx);
+
+} // namespace quic
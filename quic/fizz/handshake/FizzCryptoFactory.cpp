@@ -12,6 +12,68 @@
 #include <quic/fizz/handshake/FizzPacketNumberCipher.h>
 #include <quic/handshake/HandshakeLayer.h>
 
+#include <algorithm>
+#include <chrono>
+
+namespace {
+constexpr folly::StringPiece kRetryPacketKey =
+    "\x4d\x32\xec\xdb\x2a\x21\x33\xc8\x41\xe4\x04\x3d\xf2\x7d\x44\x30";
+constexpr folly::StringPiece kRetryPacketNonce =
+    "\x4d\x16\x11\xd0\x55\x13\xa5\x52\xc5\x87\xd5\x75";
+
+constexpr size_t kCipherBenchmarkPackets = 64;
+
+std::chrono::steady_clock::duration timeSeal(
+    const fizz::Factory& factory,
+    fizz::CipherSuite cipher) {
+  auto aead = factory.makeAead(cipher);
+  fizz::TrafficKey trafficKey;
+  trafficKey.key = folly::IOBuf::create(aead->keyLength());
+  memset(trafficKey.key->writableData(), 0x5a, aead->keyLength());
+  trafficKey.key->append(aead->keyLength());
+  trafficKey.iv = folly::IOBuf::create(aead->ivLength());
+  memset(trafficKey.iv->writableData(), 0xa5, aead->ivLength());
+  trafficKey.iv->append(aead->ivLength());
+  aead->setKey(std::move(trafficKey));
+  auto packet = folly::IOBuf::create(quic::kDefaultUDPSendPacketLen);
+  memset(packet->writableData(), 0, quic::kDefaultUDPSendPacketLen);
+  packet->append(quic::kDefaultUDPSendPacketLen);
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kCipherBenchmarkPackets; ++i) {
+    aead->encrypt(packet->clone(), nullptr, i);
+  }
+  return std::chrono::steady_clock::now() - start;
+}
+
+std::vector<fizz::CipherSuite> rankCipherSuitesBySpeed() {
+  quic::QuicFizzFactory factory;
+  std::vector<std::pair<std::chrono::steady_clock::duration, fizz::CipherSuite>>
+      timings;
+  for (auto cipher : {fizz::CipherSuite::TLS_AES_128_GCM_SHA256,
+                      fizz::CipherSuite::TLS_CHACHA20_POLY1305_SHA256}) {
+    // The first run warms up the cipher, e.g. its lazily loaded tables.
+    timeSeal(factory, cipher);
+    timings.emplace_back(timeSeal(factory, cipher), cipher);
+  }
+  // Ties go to AES-128-GCM, which everyone supports.
+  std::stable_sort(
+      timings.begin(), timings.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+      });
+  std::vector<fizz::CipherSuite> ciphers;
+  for (const auto& timing : timings) {
+    VLOG(4) << "Sealing with " << fizz::toString(timing.second) << " took "
+            << std::chrono::duration_cast<std::chrono::microseconds>(
+                   timing.first)
+                   .count()
+            << "us";
+    ciphers.push_back(timing.second);
+  }
+  return ciphers;
+}
+} // namespace
+
 namespace quic {
 
 Buf FizzCryptoFactory::makeInitialTrafficSecret(
@@ -68,21 +130,66 @@ std::unique_ptr<Aead> FizzCryptoFactory::makeInitialAead(
 
   fizz::TrafficKey trafficKey = {std::move(key), std::move(iv)};
   aead->setKey(std::move(trafficKey));
-  return FizzAead::wrap(std::move(aead));
+  return FizzAead::wrap(
+      std::move(aead),
+      fizzFactory_.get(),
+      fizz::CipherSuite::TLS_AES_128_GCM_SHA256);
 }
 
 std::unique_ptr<PacketNumberCipher> FizzCryptoFactory::makePacketNumberCipher(
     folly::ByteRange baseSecret) const {
-  auto pnCipher =
-      makePacketNumberCipher(fizz::CipherSuite::TLS_AES_128_GCM_SHA256);
-  auto deriver =
-      fizzFactory_->makeKeyDeriver(fizz::CipherSuite::TLS_AES_128_GCM_SHA256);
+  return makePacketNumberCipher(
+      fizz::CipherSuite::TLS_AES_128_GCM_SHA256, baseSecret);
+}
+
+std::unique_ptr<PacketNumberCipher> FizzCryptoFactory::makePacketNumberCipher(
+    fizz::CipherSuite cipher,
+    folly::ByteRange baseSecret) const {
+  auto pnCipher = makePacketNumberCipher(cipher);
+  auto deriver = fizzFactory_->makeKeyDeriver(cipher);
   auto pnKey = deriver->expandLabel(
       baseSecret, kQuicPNLabel, folly::IOBuf::create(0), pnCipher->keyLength());
   pnCipher->setKey(pnKey->coalesce());
   return pnCipher;
 }
 
+std::unique_ptr<Aead> FizzCryptoFactory::makeNextOneRttAead(
+    fizz::CipherSuite cipher,
+    std::vector<uint8_t>& secret) const {
+  auto deriver = fizzFactory_->makeKeyDeriver(cipher);
+  auto nextSecret = deriver->expandLabel(
+      folly::range(secret),
+      kQuicKeyUpdateLabel,
+      folly::IOBuf::create(0),
+      deriver->hashLength());
+  nextSecret->coalesce();
+  secret.assign(nextSecret->data(), nextSecret->tail());
+
+  auto aead = fizzFactory_->makeAead(cipher);
+  auto key = deriver->expandLabel(
+      folly::range(secret),
+      kQuicKeyLabel,
+      folly::IOBuf::create(0),
+      aead->keyLength());
+  auto iv = deriver->expandLabel(
+      folly::range(secret),
+      kQuicIVLabel,
+      folly::IOBuf::create(0),
+      aead->ivLength());
+  fizz::TrafficKey trafficKey = {std::move(key), std::move(iv)};
+  aead->setKey(std::move(trafficKey));
+  return FizzAead::wrap(std::move(aead), fizzFactory_.get(), cipher);
+}
+
+std::unique_ptr<Aead> FizzCryptoFactory::makeRetryAead() const {
+  auto aead = fizzFactory_->makeAead(fizz::CipherSuite::TLS_AES_128_GCM_SHA256);
+  fizz::TrafficKey trafficKey;
+  trafficKey.key = folly::IOBuf::copyBuffer(kRetryPacketKey);
+  trafficKey.iv = folly::IOBuf::copyBuffer(kRetryPacketNonce);
+  aead->setKey(std::move(trafficKey));
+  return FizzAead::wrap(std::move(aead));
+}
+
 std::unique_ptr<PacketNumberCipher> FizzCryptoFactory::makePacketNumberCipher(
     fizz::CipherSuite cipher) const {
   switch (cipher) {
@@ -90,9 +197,17 @@ std::unique_ptr<PacketNumberCipher> FizzCryptoFactory::makePacketNumberCipher(
       return std::make_unique<Aes128PacketNumberCipher>();
     case fizz::CipherSuite::TLS_AES_256_GCM_SHA384:
       return std::make_unique<Aes256PacketNumberCipher>();
+    case fizz::CipherSuite::TLS_CHACHA20_POLY1305_SHA256:
+      return std::make_unique<ChaCha20PacketNumberCipher>();
     default:
       throw std::runtime_error("Packet number cipher not implemented");
   }
 }
 
+const std::vector<fizz::CipherSuite>& getCipherSuitesBySpeed() {
+  static const std::vector<fizz::CipherSuite> ciphers =
+      rankCipherSuitesBySpeed();
+  return ciphers;
+}
+
 } // namespace quic
@@ -30,9 +30,27 @@ class FizzCryptoFactory : public CryptoFactory {
   std::unique_ptr<PacketNumberCipher> makePacketNumberCipher(
       folly::ByteRange baseSecret) const override;
 
+  std::unique_ptr<Aead> makeRetryAead() const override;
+
   virtual std::unique_ptr<PacketNumberCipher> makePacketNumberCipher(
       fizz::CipherSuite cipher) const;
 
+  /**
+   * The header protection cipher for a secret of the given cipher suite,
+   * keyed from the secret.
+   */
+  std::unique_ptr<PacketNumberCipher> makePacketNumberCipher(
+      fizz::CipherSuite cipher,
+      folly::ByteRange baseSecret) const;
+
+  /**
+   * Moves a 1-RTT secret of the given cipher suite on to the next key phase,
+   * and returns the packet protection of the new secret.
+   */
+  std::unique_ptr<Aead> makeNextOneRttAead(
+      fizz::CipherSuite cipher,
+      std::vector<uint8_t>& secret) const;
+
   std::shared_ptr<fizz::Factory> getFizzFactory() {
     return fizzFactory_;
   }
@@ -41,4 +59,12 @@ class FizzCryptoFactory : public CryptoFactory {
   std::shared_ptr<QuicFizzFactory> fizzFactory_;
 };
 
+/**
+ * The cipher suites QUIC can protect packets with, fastest first on this
+ * machine, e.g. ChaCha20-Poly1305 ahead of AES-GCM where there is no AES
+ * hardware. Timed once, by sealing a few packets with each, the first time it
+ * is called.
+ */
+const std::vector<fizz::CipherSuite>& getCipherSuitesBySpeed();
+
 } // namespace quic
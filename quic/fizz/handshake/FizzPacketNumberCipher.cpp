@@ -43,6 +43,32 @@ static HeaderProtectionMask maskImpl(
   return outMask;
 }
 
+// AES-ECB encrypts every block independently, so one call over the
+// concatenated samples lets the cipher pipeline several blocks at a time.
+static void batchMaskImpl(
+    const folly::ssl::EvpCipherCtxUniquePtr& context,
+    folly::Range<const Sample*> samples,
+    folly::Range<HeaderProtectionMask*> masks) {
+  static_assert(
+      sizeof(Sample) == sizeof(HeaderProtectionMask),
+      "A mask is one cipher block of its sample");
+  CHECK_EQ(samples.size(), masks.size());
+  if (samples.empty()) {
+    return;
+  }
+  int inLen = samples.size() * sizeof(Sample);
+  int outLen = 0;
+  if (EVP_EncryptUpdate(
+          context.get(),
+          masks.data()->data(),
+          &outLen,
+          samples.data()->data(),
+          inLen) != 1 ||
+      outLen != inLen) {
+    throw std::runtime_error("Encryption error");
+  }
+}
+
 void Aes128PacketNumberCipher::setKey(folly::ByteRange key) {
   return setKeyImpl(encryptCtx_, EVP_aes_128_ecb(), key);
 }
@@ -51,6 +77,10 @@ void Aes256PacketNumberCipher::setKey(folly::ByteRange key) {
   return setKeyImpl(encryptCtx_, EVP_aes_256_ecb(), key);
 }
 
+void ChaCha20PacketNumberCipher::setKey(folly::ByteRange key) {
+  return setKeyImpl(encryptCtx_, EVP_chacha20(), key);
+}
+
 HeaderProtectionMask Aes128PacketNumberCipher::mask(
     folly::ByteRange sample) const {
   return maskImpl(encryptCtx_, sample);
@@ -61,6 +91,42 @@ HeaderProtectionMask Aes256PacketNumberCipher::mask(
   return maskImpl(encryptCtx_, sample);
 }
 
+// The sample is the block counter and nonce, and the mask is the start of the
+// key stream, which is what encrypting zeroes gives.
+HeaderProtectionMask ChaCha20PacketNumberCipher::mask(
+    folly::ByteRange sample) const {
+  static const HeaderProtectionMask kZeroes{};
+  HeaderProtectionMask outMask;
+  CHECK_EQ(sample.size(), outMask.size());
+  if (EVP_EncryptInit_ex(
+          encryptCtx_.get(), nullptr, nullptr, nullptr, sample.data()) != 1) {
+    throw std::runtime_error("Init error");
+  }
+  int outLen = 0;
+  if (EVP_EncryptUpdate(
+          encryptCtx_.get(),
+          outMask.data(),
+          &outLen,
+          kZeroes.data(),
+          kZeroes.size()) != 1 ||
+      static_cast<HeaderProtectionMask::size_type>(outLen) != outMask.size()) {
+    throw std::runtime_error("Encryption error");
+  }
+  return outMask;
+}
+
+void Aes128PacketNumberCipher::batchMask(
+    folly::Range<const Sample*> samples,
+    folly::Range<HeaderProtectionMask*> masks) const {
+  batchMaskImpl(encryptCtx_, samples, masks);
+}
+
+void Aes256PacketNumberCipher::batchMask(
+    folly::Range<const Sample*> samples,
+    folly::Range<HeaderProtectionMask*> masks) const {
+  batchMaskImpl(encryptCtx_, samples, masks);
+}
+
 constexpr size_t kAES128KeyLength = 16;
 
 size_t Aes128PacketNumberCipher::keyLength() const {
@@ -73,4 +139,10 @@ size_t Aes256PacketNumberCipher::keyLength() const {
   return kAES256KeyLength;
 }
 
+constexpr size_t kChaCha20KeyLength = 32;
+
+size_t ChaCha20PacketNumberCipher::keyLength() const {
+  return kChaCha20KeyLength;
+}
+
 } // namespace quic
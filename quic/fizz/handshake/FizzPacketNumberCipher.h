@@ -22,6 +22,10 @@ class Aes128PacketNumberCipher : public PacketNumberCipher {
 
   HeaderProtectionMask mask(folly::ByteRange sample) const override;
 
+  void batchMask(
+      folly::Range<const Sample*> samples,
+      folly::Range<HeaderProtectionMask*> masks) const override;
+
   size_t keyLength() const override;
 
  private:
@@ -36,6 +40,24 @@ class Aes256PacketNumberCipher : public PacketNumberCipher {
 
   HeaderProtectionMask mask(folly::ByteRange sample) const override;
 
+  void batchMask(
+      folly::Range<const Sample*> samples,
+      folly::Range<HeaderProtectionMask*> masks) const override;
+
+  size_t keyLength() const override;
+
+ private:
+  folly::ssl::EvpCipherCtxUniquePtr encryptCtx_;
+};
+
+class ChaCha20PacketNumberCipher : public PacketNumberCipher {
+ public:
+  ~ChaCha20PacketNumberCipher() override = default;
+
+  void setKey(folly::ByteRange key) override;
+
+  HeaderProtectionMask mask(folly::ByteRange sample) const override;
+
   size_t keyLength() const override;
 
  private:
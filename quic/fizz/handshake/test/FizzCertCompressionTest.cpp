@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <folly/portability/GTest.h>
+
+#include <fizz/compression/CertDecompressionManager.h>
+#include <fizz/compression/ZlibCertificateDecompressor.h>
+#include <fizz/crypto/test/TestUtil.h>
+#include <quic/fizz/handshake/FizzCertCompression.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+TEST(FizzCertCompressionTest, CompressesOncePerCert) {
+  std::vector<folly::ssl::X509UniquePtr> certs;
+  certs.emplace_back(fizz::test::getCert(fizz::test::kP256Certificate));
+  fizz::SelfCertImpl<fizz::KeyType::P256> cert(
+      fizz::test::getPrivateKey(fizz::test::kP256Key), std::move(certs));
+  compressCertificate(cert);
+
+  auto compressed =
+      cert.getCompressedCert(fizz::CertificateCompressionAlgorithm::zlib);
+  EXPECT_EQ(fizz::CertificateCompressionAlgorithm::zlib, compressed.algorithm);
+  EXPECT_LT(
+      compressed.compressed_certificate_message->computeChainDataLength(),
+      compressed.uncompressed_length);
+
+  fizz::ZlibCertificateDecompressor decompressor;
+  auto certMsg = decompressor.decompress(compressed);
+  EXPECT_EQ(1, certMsg.certificate_list.size());
+}
+
+TEST(FizzCertCompressionTest, EnablesContexts) {
+  fizz::server::FizzServerContext serverCtx;
+  enableCertificateCompression(serverCtx);
+  EXPECT_EQ(
+      std::vector<fizz::CertificateCompressionAlgorithm>{
+          fizz::CertificateCompressionAlgorithm::zlib},
+      serverCtx.getSupportedCompressionAlgorithms());
+
+  fizz::client::FizzClientContext clientCtx;
+  enableCertificateDecompression(clientCtx);
+  auto decompressionManager = clientCtx.getCertDecompressionManager();
+  ASSERT_NE(nullptr, decompressionManager);
+  EXPECT_NE(
+      nullptr,
+      decompressionManager->getDecompressor(
+          fizz::CertificateCompressionAlgorithm::zlib));
+}
+
+} // namespace test
+} // namespace quic
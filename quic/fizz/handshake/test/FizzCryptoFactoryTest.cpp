@@ -137,5 +137,92 @@ TEST_F(FizzCryptoFactoryTest, TestPacketEncryptionKey) {
   EXPECT_EQ(secretHex2, expectedKey2);
 }
 
+TEST_F(FizzCryptoFactoryTest, CipherSuitesBySpeed) {
+  const auto& ciphers = getCipherSuitesBySpeed();
+  EXPECT_THAT(
+      ciphers,
+      UnorderedElementsAre(
+          fizz::CipherSuite::TLS_AES_128_GCM_SHA256,
+          fizz::CipherSuite::TLS_CHACHA20_POLY1305_SHA256));
+  // Only timed the once.
+  EXPECT_EQ(&ciphers, &getCipherSuitesBySpeed());
+}
+
+TEST_F(FizzCryptoFactoryTest, NextOneRttAead) {
+  // The ChaCha20-Poly1305 example of RFC 9001, appendix A.5.
+  FizzCryptoFactory cryptoFactory;
+  auto secretString = folly::unhexlify(
+      "9ac312a7f877468ebe69422748ad00a15443f18203a07d6060f688f30f21632b");
+  std::vector<uint8_t> secret(secretString.begin(), secretString.end());
+  auto aead = cryptoFactory.makeNextOneRttAead(
+      fizz::CipherSuite::TLS_CHACHA20_POLY1305_SHA256, secret);
+  EXPECT_NE(nullptr, aead);
+  EXPECT_EQ(
+      "1223504755036d556342ee9361d253421a826c9ecdf3c7148684b36b714881f9",
+      folly::hexlify(secret));
+}
+
+TEST_F(FizzCryptoFactoryTest, TestEncryptBatch) {
+  auto connId = getTestConnectionId();
+  FizzCryptoFactory cryptoFactory;
+  auto batchAead =
+      cryptoFactory.getClientInitialCipher(connId, QuicVersion::QUIC_DRAFT);
+  auto aead =
+      cryptoFactory.getClientInitialCipher(connId, QuicVersion::QUIC_DRAFT);
+
+  auto header = folly::IOBuf::copyBuffer("header");
+  std::vector<Aead::BatchEntry> entries;
+  std::vector<std::unique_ptr<folly::IOBuf>> expected;
+  for (uint64_t seqNum = 0; seqNum < 3; ++seqNum) {
+    auto plaintext = buildRandomInputData(100 * (seqNum + 1));
+    expected.push_back(aead->encrypt(plaintext->clone(), header.get(), seqNum));
+    entries.push_back({std::move(plaintext), header.get(), seqNum});
+  }
+  batchAead->encryptBatch(folly::range(entries));
+  folly::IOBufEqualTo eq;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    EXPECT_TRUE(eq(expected[i], entries[i].buf));
+  }
+}
+
+TEST_F(FizzCryptoFactoryTest, TestInplaceDecrypt) {
+  auto connId = getTestConnectionId();
+  FizzCryptoFactory cryptoFactory;
+  auto writeAead =
+      cryptoFactory.getClientInitialCipher(connId, QuicVersion::QUIC_DRAFT);
+  auto readAead =
+      cryptoFactory.getClientInitialCipher(connId, QuicVersion::QUIC_DRAFT);
+
+  auto header = folly::IOBuf::copyBuffer("header");
+  auto plaintext = buildRandomInputData(1000);
+  auto ciphertext =
+      writeAead->encrypt(plaintext->clone(), header.get(), 0)->cloneCoalesced();
+  auto ciphertextCopy = ciphertext->clone();
+  ciphertextCopy->unshare();
+  folly::IOBufEqualTo eq;
+
+  // An unshared buffer is decrypted where it is.
+  auto ciphertextData = ciphertext->data();
+  auto decrypted =
+      readAead->tryInplaceDecrypt(std::move(ciphertext), header.get(), 0);
+  ASSERT_TRUE(decrypted.has_value());
+  EXPECT_EQ(ciphertextData, (*decrypted)->data());
+  EXPECT_TRUE(eq(plaintext, *decrypted));
+
+  // A shared one is decrypted out of place and copied back into it.
+  auto otherRef = ciphertextCopy->clone();
+  auto sharedData = ciphertextCopy->data();
+  auto sharedDecrypted =
+      readAead->tryInplaceDecrypt(std::move(ciphertextCopy), header.get(), 0);
+  ASSERT_TRUE(sharedDecrypted.has_value());
+  EXPECT_EQ(sharedData, (*sharedDecrypted)->data());
+  EXPECT_TRUE(eq(plaintext, *sharedDecrypted));
+
+  auto corrupted = buildRandomInputData(1000);
+  EXPECT_FALSE(
+      readAead->tryInplaceDecrypt(std::move(corrupted), header.get(), 0)
+          .has_value());
+}
+
 } // namespace test
 } // namespace quic
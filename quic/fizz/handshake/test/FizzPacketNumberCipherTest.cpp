@@ -89,6 +89,59 @@ TEST_P(LongPacketNumberCipherTest, TestEncryptDecrypt) {
       GetParam().decryptedPacketNumberBytes);
 }
 
+TEST_P(LongPacketNumberCipherTest, TestBatchMask) {
+  FizzCryptoFactory cryptoFactory;
+  auto cipher = cryptoFactory.makePacketNumberCipher(GetParam().cipher);
+  auto key = folly::unhexlify(GetParam().key);
+  cipher->setKey(folly::range(key));
+  std::vector<Sample> samples;
+  for (uint8_t i = 0; i < 5; ++i) {
+    auto sample = hexToBytes<Sample>(GetParam().sample);
+    sample[0] ^= i;
+    samples.push_back(sample);
+  }
+  std::vector<HeaderProtectionMask> masks(samples.size());
+  cipher->batchMask(folly::range(samples), folly::range(masks));
+  for (size_t i = 0; i < samples.size(); ++i) {
+    EXPECT_EQ(cipher->mask(folly::range(samples[i])), masks[i]);
+  }
+
+  CipherBytes cipherBytes(
+      GetParam().sample,
+      GetParam().decryptedInitialByte,
+      GetParam().decryptedPacketNumberBytes);
+  cipher->encryptLongHeaderWithMask(
+      masks[0],
+      folly::range(cipherBytes.initial),
+      folly::range(cipherBytes.packetNumber));
+  EXPECT_EQ(folly::hexlify(cipherBytes.initial), GetParam().initialByte);
+  EXPECT_EQ(
+      folly::hexlify(cipherBytes.packetNumber), GetParam().packetNumberBytes);
+}
+
+TEST(ChaCha20PacketNumberCipherTest, Mask) {
+  // The short header example of RFC 9001, appendix A.5.
+  FizzCryptoFactory cryptoFactory;
+  auto cipher = cryptoFactory.makePacketNumberCipher(
+      fizz::CipherSuite::TLS_CHACHA20_POLY1305_SHA256);
+  auto key = folly::unhexlify(
+      "25a282b9e82f06f21f488917a4fc8f1b73573685608597d0efcb076b0ab7a7a4");
+  EXPECT_EQ(cipher->keyLength(), key.size());
+  cipher->setKey(folly::range(key));
+  auto sample = hexToBytes<Sample>("5e5cd55c41f69080575d7999c25a5bfb");
+  auto mask = cipher->mask(folly::range(sample));
+  EXPECT_EQ("aefefe7d03", folly::hexlify(folly::range(mask).subpiece(0, 5)));
+
+  // The same sample gives the same mask, and batches match too.
+  std::vector<Sample> samples{sample, sample};
+  samples[1][0] ^= 1;
+  std::vector<HeaderProtectionMask> masks(samples.size());
+  cipher->batchMask(folly::range(samples), folly::range(masks));
+  EXPECT_EQ(mask, masks[0]);
+  EXPECT_EQ(cipher->mask(folly::range(samples[1])), masks[1]);
+  EXPECT_NE(masks[0], masks[1]);
+}
+
 INSTANTIATE_TEST_CASE_P(
     LongPacketNumberCipherTests,
     LongPacketNumberCipherTest,
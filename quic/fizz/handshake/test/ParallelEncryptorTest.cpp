@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/synchronization/Baton.h>
+#include <quic/common/test/TestUtils.h>
+#include <quic/fizz/handshake/FizzCryptoFactory.h>
+#include <quic/handshake/ParallelEncryptor.h>
+#include <quic/handshake/test/Mocks.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+class ParallelEncryptorTest : public Test {
+ public:
+  void SetUp() override {
+    aead_ = factory_.getClientInitialCipher(connId_, QuicVersion::MVFST);
+    makeEntries();
+  }
+
+  void makeEntries() {
+    headers_.clear();
+    entries_.clear();
+    for (size_t i = 0; i < 32; ++i) {
+      headers_.push_back(folly::IOBuf::copyBuffer(folly::to<std::string>(i)));
+      entries_.push_back(
+          {folly::IOBuf::copyBuffer(std::string(100 + i, 'a' + i % 26)),
+           headers_.back().get(),
+           i});
+    }
+  }
+
+  // What encrypting the batch one packet at a time gives.
+  std::vector<std::string> expected() {
+    auto aead = factory_.getClientInitialCipher(connId_, QuicVersion::MVFST);
+    std::vector<std::string> ciphertexts;
+    for (auto& entry : entries_) {
+      ciphertexts.push_back(aead->encrypt(
+                                    entry.buf->clone(),
+                                    entry.associatedData,
+                                    entry.seqNum)
+                                ->moveToFbString()
+                                .toStdString());
+    }
+    return ciphertexts;
+  }
+
+  std::vector<std::string> ciphertexts() {
+    std::vector<std::string> ciphertexts;
+    for (auto& entry : entries_) {
+      ciphertexts.push_back(entry.buf->moveToFbString().toStdString());
+    }
+    return ciphertexts;
+  }
+
+ protected:
+  FizzCryptoFactory factory_;
+  ConnectionId connId_{getTestConnectionId()};
+  std::unique_ptr<Aead> aead_;
+  std::vector<Buf> headers_;
+  std::vector<Aead::BatchEntry> entries_;
+  std::shared_ptr<folly::CPUThreadPoolExecutor> executor_{
+      std::make_shared<folly::CPUThreadPoolExecutor>(4)};
+};
+
+TEST_F(ParallelEncryptorTest, Clone) {
+  auto clone = aead_->clone();
+  ASSERT_NE(nullptr, clone);
+  auto plaintext = folly::IOBuf::copyBuffer("plaintext");
+  EXPECT_TRUE(folly::IOBufEqualTo()(
+      aead_->encrypt(plaintext->clone(), headers_[0].get(), 1),
+      clone->encrypt(plaintext->clone(), headers_[0].get(), 1)));
+}
+
+TEST_F(ParallelEncryptorTest, EncryptsInOrder) {
+  auto want = expected();
+  ParallelEncryptor encryptor(executor_);
+  encryptor.encryptBatch(*aead_, folly::range(entries_), 3);
+  EXPECT_EQ(want, ciphertexts());
+
+  // Again with the clones from the first batch.
+  makeEntries();
+  encryptor.encryptBatch(*aead_, folly::range(entries_), 3);
+  EXPECT_EQ(want, ciphertexts());
+}
+
+TEST_F(ParallelEncryptorTest, BusyExecutor) {
+  auto want = expected();
+  // Nothing runs on the executor until the batch is done.
+  auto executor = std::make_shared<folly::CPUThreadPoolExecutor>(1);
+  folly::Baton<> blocked;
+  executor->add([&] { blocked.wait(); });
+  ParallelEncryptor encryptor(executor);
+  encryptor.encryptBatch(*aead_, folly::range(entries_), 3);
+  EXPECT_EQ(want, ciphertexts());
+  blocked.post();
+  executor->join();
+}
+
+TEST_F(ParallelEncryptorTest, NotCloneable) {
+  MockAead aead;
+  aead.setDefaults();
+  EXPECT_CALL(aead, _encrypt(_, _, _)).Times(entries_.size());
+  ParallelEncryptor encryptor(executor_);
+  encryptor.encryptBatch(aead, folly::range(entries_), 3);
+}
+
+} // namespace test
+} // namespace quic
@@ -44,6 +44,35 @@ folly::Optional<uint64_t> calculateNewWindowUpdate(
   return folly::none;
 }
 
+/**
+ * Receive window auto-tuning. An update that is due sooner than
+ * kReceiveWindowAutotuneRttMultiplier RTTs after the previous one means the
+ * window, not the application, limits the peer, so the window is doubled.
+ * Returns whether windowSize changed.
+ */
+bool maybeAutotuneWindow(
+    uint64_t& windowSize,
+    const std::chrono::microseconds& srtt,
+    const TransportSettings& transportSettings,
+    const folly::Optional<TimePoint>& lastSendTime,
+    const TimePoint& updateTime) {
+  if (!transportSettings.autotuneReceiveWindow || !lastSendTime ||
+      srtt == std::chrono::microseconds::zero() ||
+      updateTime < *lastSendTime ||
+      updateTime - *lastSendTime >=
+          kReceiveWindowAutotuneRttMultiplier * srtt) {
+    return false;
+  }
+  auto maxWindowSize = std::min(
+      transportSettings.maxReceiveWindowSize,
+      transportSettings.totalBufferSpaceAvailable);
+  if (windowSize >= maxWindowSize) {
+    return false;
+  }
+  windowSize = windowSize > maxWindowSize / 2 ? maxWindowSize : windowSize * 2;
+  return true;
+}
+
 template <typename T>
 inline void incrementWithOverFlowCheck(T& num, T diff) {
   if (num > std::numeric_limits<T>::max() - diff) {
@@ -53,9 +82,32 @@ inline void incrementWithOverFlowCheck(T& num, T diff) {
   num += diff;
 }
 
+/**
+ * The window to advertise, smaller while the receive buffers shared with other
+ * connections are over budget.
+ */
+inline uint64_t receiveWindowSize(
+    const QuicConnectionStateBase& conn,
+    uint64_t windowSize) {
+  if (conn.receiveBufferAccount.underPressure()) {
+    return windowSize / kReceiveBufferPressureWindowDivisor;
+  }
+  return windowSize;
+}
+
+inline void updateReceiveBufferAccount(QuicConnectionStateBase& conn) {
+  const auto& flowControlState = conn.flowControlState;
+  conn.receiveBufferAccount.update(
+      flowControlState.sumMaxObservedOffset -
+      std::min(
+          flowControlState.sumCurReadOffset,
+          flowControlState.sumMaxObservedOffset));
+}
+
 inline uint64_t calculateMaximumData(const QuicStreamState& stream) {
   return std::max(
-      stream.currentReadOffset + stream.flowControlState.windowSize,
+      stream.currentReadOffset +
+          receiveWindowSize(stream.conn, stream.flowControlState.windowSize),
       stream.flowControlState.advertisedMaxOffset);
 }
 } // namespace
@@ -72,12 +124,20 @@ bool maybeSendConnWindowUpdate(
   auto newAdvertisedOffset = calculateNewWindowUpdate(
       flowControlState.sumCurReadOffset,
       flowControlState.advertisedMaxOffset,
-      flowControlState.windowSize,
+      receiveWindowSize(conn, flowControlState.windowSize),
       conn.lossState.srtt,
       conn.transportSettings,
       flowControlState.timeOfLastFlowControlUpdate,
       updateTime);
   if (newAdvertisedOffset) {
+    if (maybeAutotuneWindow(
+            flowControlState.windowSize,
+            conn.lossState.srtt,
+            conn.transportSettings,
+            flowControlState.timeOfLastFlowControlUpdate,
+            updateTime)) {
+      VLOG(4) << "Auto-tuned conn window=" << flowControlState.windowSize;
+    }
     conn.pendingEvents.connWindowUpdate = true;
     QUIC_STATS(conn.statsCallback, onConnFlowControlUpdate);
     if (conn.qLogger) {
@@ -103,12 +163,21 @@ bool maybeSendStreamWindowUpdate(
   auto newAdvertisedOffset = calculateNewWindowUpdate(
       stream.currentReadOffset,
       flowControlState.advertisedMaxOffset,
-      flowControlState.windowSize,
+      receiveWindowSize(stream.conn, flowControlState.windowSize),
       stream.conn.lossState.srtt,
       stream.conn.transportSettings,
       flowControlState.timeOfLastFlowControlUpdate,
       updateTime);
   if (newAdvertisedOffset) {
+    if (maybeAutotuneWindow(
+            flowControlState.windowSize,
+            stream.conn.lossState.srtt,
+            stream.conn.transportSettings,
+            flowControlState.timeOfLastFlowControlUpdate,
+            updateTime)) {
+      VLOG(4) << "Auto-tuned stream=" << stream.id
+              << " window=" << flowControlState.windowSize;
+    }
     VLOG(10) << "Queued flow control update for stream=" << stream.id
              << " offset=" << *newAdvertisedOffset;
     stream.conn.streamManager->queueWindowUpdate(stream.id);
@@ -142,6 +211,7 @@ void updateFlowControlOnStreamData(
   incrementWithOverFlowCheck(
       connFlowControlState.sumMaxObservedOffset,
       curMaxOffsetObserved - previousMaxOffsetObserved);
+  updateReceiveBufferAccount(stream.conn);
 }
 
 void updateFlowControlOnRead(
@@ -152,6 +222,7 @@ void updateFlowControlOnRead(
   auto diff = stream.currentReadOffset - lastReadOffset;
   incrementWithOverFlowCheck(
       stream.conn.flowControlState.sumCurReadOffset, diff);
+  updateReceiveBufferAccount(stream.conn);
   if (maybeSendConnWindowUpdate(stream.conn, readTime)) {
     VLOG(4) << "Read trigger conn window update "
             << " readOffset=" << stream.conn.flowControlState.sumCurReadOffset
@@ -186,6 +257,9 @@ void updateFlowControlOnWriteToSocket(
         stream.id,
         stream.conn.flowControlState.sumCurWriteOffset);
     QUIC_STATS(stream.conn.statsCallback, onConnFlowControlBlocked);
+    if (!stream.conn.flowControlState.timeOfBlocked) {
+      stream.conn.flowControlState.timeOfBlocked = Clock::now();
+    }
   }
 }
 
@@ -213,6 +287,9 @@ void maybeWriteBlockAfterAPIWrite(QuicStreamState& stream) {
         stream.id,
         stream.flowControlState.peerAdvertisedMaxOffset);
     QUIC_STATS(stream.conn.statsCallback, onStreamFlowControlBlocked);
+    if (!stream.flowControlState.timeOfBlocked) {
+      stream.flowControlState.timeOfBlocked = Clock::now();
+    }
   }
 }
 
@@ -238,6 +315,9 @@ void maybeWriteBlockAfterSocketWrite(QuicStreamState& stream) {
         stream.id,
         stream.flowControlState.peerAdvertisedMaxOffset);
     QUIC_STATS(stream.conn.statsCallback, onStreamFlowControlBlocked);
+    if (!stream.flowControlState.timeOfBlocked) {
+      stream.flowControlState.timeOfBlocked = Clock::now();
+    }
   }
 }
 
@@ -247,6 +327,15 @@ void handleStreamWindowUpdate(
     PacketNum packetNum) {
   if (stream.flowControlState.peerAdvertisedMaxOffset <= maximumData) {
     stream.flowControlState.peerAdvertisedMaxOffset = maximumData;
+    if (stream.flowControlState.timeOfBlocked &&
+        maximumData > stream.currentWriteOffset) {
+      QUIC_STATS(
+          stream.conn.statsCallback,
+          onStreamFlowControlBlockedDuration,
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              Clock::now() - *stream.flowControlState.timeOfBlocked));
+      stream.flowControlState.timeOfBlocked = folly::none;
+    }
     if (stream.flowControlState.peerAdvertisedMaxOffset >
         stream.currentWriteOffset + stream.writeBuffer.chainLength()) {
       updateFlowControlList(stream);
@@ -274,6 +363,15 @@ void handleConnWindowUpdate(
     PacketNum packetNum) {
   if (conn.flowControlState.peerAdvertisedMaxOffset <= frame.maximumData) {
     conn.flowControlState.peerAdvertisedMaxOffset = frame.maximumData;
+    if (conn.flowControlState.timeOfBlocked &&
+        frame.maximumData > conn.flowControlState.sumCurWriteOffset) {
+      QUIC_STATS(
+          conn.statsCallback,
+          onConnFlowControlBlockedDuration,
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              Clock::now() - *conn.flowControlState.timeOfBlocked));
+      conn.flowControlState.timeOfBlocked = folly::none;
+    }
     if (conn.qLogger) {
       conn.qLogger->addTransportStateUpdate(
           getRxConnWU(packetNum, frame.maximumData));
@@ -420,7 +518,8 @@ void updateFlowControlStateWithSettings(
 
 MaxDataFrame generateMaxDataFrame(const QuicConnectionStateBase& conn) {
   return MaxDataFrame(std::max(
-      conn.flowControlState.sumCurReadOffset + conn.flowControlState.windowSize,
+      conn.flowControlState.sumCurReadOffset +
+          receiveWindowSize(conn, conn.flowControlState.windowSize),
       conn.flowControlState.advertisedMaxOffset));
 }
 
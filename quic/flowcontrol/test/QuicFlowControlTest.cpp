@@ -71,6 +71,55 @@ TEST_F(QuicFlowControlTest, MaybeSendConnWindowUpdateTimeElapsed) {
   EXPECT_TRUE(conn_.pendingEvents.connWindowUpdate);
 }
 
+TEST_F(QuicFlowControlTest, AutotuneConnWindow) {
+  conn_.transportSettings.autotuneReceiveWindow = true;
+  conn_.transportSettings.maxReceiveWindowSize = 1500;
+  conn_.flowControlState.windowSize = 500;
+  conn_.flowControlState.advertisedMaxOffset = 400;
+  conn_.flowControlState.sumCurReadOffset = 300;
+  conn_.lossState.srtt = 100us;
+  auto lastUpdate = Clock::now();
+  conn_.flowControlState.timeOfLastFlowControlUpdate = lastUpdate;
+
+  // Half the window is consumed within 2 RTTs of the last update.
+  EXPECT_CALL(*transportInfoCb_, onConnFlowControlUpdate()).Times(1);
+  EXPECT_TRUE(maybeSendConnWindowUpdate(conn_, lastUpdate + 100us));
+  EXPECT_EQ(1000, conn_.flowControlState.windowSize);
+  EXPECT_EQ(1300, generateMaxDataFrame(conn_).maximumData);
+
+  // Bounded by maxReceiveWindowSize.
+  conn_.pendingEvents.connWindowUpdate = false;
+  conn_.flowControlState.advertisedMaxOffset = 800;
+  conn_.flowControlState.sumCurReadOffset = 700;
+  EXPECT_CALL(*transportInfoCb_, onConnFlowControlUpdate()).Times(1);
+  EXPECT_TRUE(maybeSendConnWindowUpdate(conn_, lastUpdate + 100us));
+  EXPECT_EQ(1500, conn_.flowControlState.windowSize);
+
+  // And by totalBufferSpaceAvailable.
+  conn_.transportSettings.maxReceiveWindowSize = 10000;
+  conn_.transportSettings.totalBufferSpaceAvailable = 2000;
+  conn_.pendingEvents.connWindowUpdate = false;
+  conn_.flowControlState.advertisedMaxOffset = 1000;
+  conn_.flowControlState.sumCurReadOffset = 900;
+  EXPECT_CALL(*transportInfoCb_, onConnFlowControlUpdate()).Times(1);
+  EXPECT_TRUE(maybeSendConnWindowUpdate(conn_, lastUpdate + 100us));
+  EXPECT_EQ(2000, conn_.flowControlState.windowSize);
+}
+
+TEST_F(QuicFlowControlTest, NoAutotuneConnWindowWhenSlow) {
+  conn_.transportSettings.autotuneReceiveWindow = true;
+  conn_.flowControlState.windowSize = 500;
+  conn_.flowControlState.advertisedMaxOffset = 400;
+  conn_.flowControlState.sumCurReadOffset = 300;
+  conn_.lossState.srtt = 100us;
+  auto lastUpdate = Clock::now();
+  conn_.flowControlState.timeOfLastFlowControlUpdate = lastUpdate;
+
+  EXPECT_CALL(*transportInfoCb_, onConnFlowControlUpdate()).Times(1);
+  EXPECT_TRUE(maybeSendConnWindowUpdate(conn_, lastUpdate + 300us));
+  EXPECT_EQ(500, conn_.flowControlState.windowSize);
+}
+
 TEST_F(QuicFlowControlTest, DontSendConnFlowControlTwice) {
   conn_.flowControlState.windowSize = 500;
   conn_.flowControlState.advertisedMaxOffset = 400;
@@ -221,6 +270,23 @@ TEST_F(QuicFlowControlTest, MaybeSendStreamWindowUpdateTimeElapsed) {
   EXPECT_TRUE(conn_.streamManager->pendingWindowUpdate(stream.id));
 }
 
+TEST_F(QuicFlowControlTest, AutotuneStreamWindow) {
+  conn_.transportSettings.autotuneReceiveWindow = true;
+  StreamId id = 3;
+  QuicStreamState stream(id, conn_);
+  stream.currentReadOffset = 300;
+  stream.flowControlState.windowSize = 500;
+  stream.flowControlState.advertisedMaxOffset = 400;
+  conn_.lossState.srtt = 100us;
+  auto lastUpdate = Clock::now();
+  stream.flowControlState.timeOfLastFlowControlUpdate = lastUpdate;
+
+  EXPECT_CALL(*transportInfoCb_, onStreamFlowControlUpdate()).Times(1);
+  EXPECT_TRUE(maybeSendStreamWindowUpdate(stream, lastUpdate + 100us));
+  EXPECT_EQ(1000, stream.flowControlState.windowSize);
+  EXPECT_EQ(1300, generateMaxStreamDataFrame(stream).maximumData);
+}
+
 TEST_F(QuicFlowControlTest, DontSendStreamWindowUpdateTwice) {
   StreamId id = 3;
   QuicStreamState stream(id, conn_);
@@ -334,6 +400,48 @@ TEST_F(QuicFlowControlTest, MaybeWriteBlockedAfterSocketWrite) {
   EXPECT_TRUE(conn_.streamManager->hasBlocked());
 }
 
+TEST_F(QuicFlowControlTest, StreamFlowControlBlockedDuration) {
+  StreamId id = 3;
+  QuicStreamState stream(id, conn_);
+  stream.currentWriteOffset = 400;
+  stream.flowControlState.peerAdvertisedMaxOffset = 400;
+  stream.writeBuffer.append(IOBuf::copyBuffer("1234"));
+  EXPECT_CALL(*transportInfoCb_, onStreamFlowControlBlocked()).Times(2);
+  maybeWriteBlockAfterSocketWrite(stream);
+  ASSERT_TRUE(stream.flowControlState.timeOfBlocked);
+  auto blockedTime = *stream.flowControlState.timeOfBlocked;
+  // Still blocked since the first time.
+  maybeWriteBlockAfterSocketWrite(stream);
+  EXPECT_EQ(blockedTime, *stream.flowControlState.timeOfBlocked);
+
+  // An update that doesn't move the limit doesn't end the block.
+  EXPECT_CALL(*transportInfoCb_, onStreamFlowControlBlockedDuration(_))
+      .Times(0);
+  handleStreamWindowUpdate(stream, 400, 1);
+  Mock::VerifyAndClearExpectations(transportInfoCb_.get());
+
+  EXPECT_CALL(*transportInfoCb_, onStreamFlowControlBlockedDuration(_))
+      .Times(1);
+  handleStreamWindowUpdate(stream, 500, 2);
+  EXPECT_FALSE(stream.flowControlState.timeOfBlocked);
+}
+
+TEST_F(QuicFlowControlTest, ConnFlowControlBlockedDuration) {
+  StreamId id = 3;
+  QuicStreamState stream(id, conn_);
+  conn_.flowControlState.sumCurWriteOffset = 200;
+  conn_.flowControlState.sumCurStreamBufferLen = 100;
+  conn_.flowControlState.peerAdvertisedMaxOffset = 300;
+  EXPECT_CALL(*transportInfoCb_, onConnFlowControlBlocked()).Times(1);
+  updateFlowControlOnWriteToSocket(stream, 100);
+  EXPECT_TRUE(conn_.flowControlState.timeOfBlocked);
+
+  EXPECT_CALL(*transportInfoCb_, onConnFlowControlBlockedDuration(_))
+      .Times(1);
+  handleConnWindowUpdate(conn_, MaxDataFrame(600), 1);
+  EXPECT_FALSE(conn_.flowControlState.timeOfBlocked);
+}
+
 TEST_F(QuicFlowControlTest, MaybeSendStreamWindowUpdateChangeWindowLarger) {
   StreamId id = 3;
   QuicStreamState stream(id, conn_);
@@ -620,6 +728,46 @@ TEST_F(QuicFlowControlTest, UpdateFlowControlOnRead) {
   EXPECT_EQ(event->update, getFlowControlEvent(700));
 }
 
+TEST_F(QuicFlowControlTest, ReceiveBufferPressureShrinksWindows) {
+  auto accountant = std::make_shared<ReceiveBufferAccountant>(1000);
+  ReceiveBufferAccountant::Account otherConn(accountant);
+  otherConn.update(900);
+  conn_.receiveBufferAccount = ReceiveBufferAccountant::Account(accountant);
+  conn_.flowControlState.sumMaxObservedOffset = 550;
+  conn_.flowControlState.sumCurReadOffset = 200;
+  conn_.flowControlState.windowSize = 400;
+  conn_.flowControlState.advertisedMaxOffset = 600;
+  StreamId id = 3;
+  QuicStreamState stream(id, conn_);
+  stream.currentReadOffset = 150;
+  stream.maxOffsetObserved = 200;
+  stream.flowControlState.windowSize = 100;
+  stream.flowControlState.advertisedMaxOffset = 250;
+
+  updateFlowControlOnStreamData(stream, stream.maxOffsetObserved, 210);
+  EXPECT_EQ(360, conn_.receiveBufferAccount.bufferedBytes());
+  EXPECT_EQ(1260, accountant->bufferedBytes());
+  EXPECT_EQ(600, generateMaxDataFrame(conn_).maximumData);
+  EXPECT_EQ(250, generateMaxStreamDataFrame(stream).maximumData);
+
+  // The smaller windows defer the updates.
+  stream.currentReadOffset = 210;
+  EXPECT_CALL(*transportInfoCb_, onConnFlowControlUpdate()).Times(0);
+  EXPECT_CALL(*transportInfoCb_, onStreamFlowControlUpdate()).Times(0);
+  updateFlowControlOnRead(stream, 150, Clock::now());
+  EXPECT_EQ(300, conn_.receiveBufferAccount.bufferedBytes());
+  EXPECT_FALSE(conn_.pendingEvents.connWindowUpdate);
+  EXPECT_FALSE(conn_.streamManager->pendingWindowUpdate(stream.id));
+
+  otherConn.update(0);
+  EXPECT_EQ(300, accountant->bufferedBytes());
+  EXPECT_EQ(660, generateMaxDataFrame(conn_).maximumData);
+  EXPECT_EQ(310, generateMaxStreamDataFrame(stream).maximumData);
+
+  conn_.receiveBufferAccount = ReceiveBufferAccountant::Account();
+  EXPECT_EQ(0, accountant->bufferedBytes());
+}
+
 TEST_F(QuicFlowControlTest, UpdateFlowControlOnWrite) {
   StreamId id = 3;
   QuicStreamState stream(id, conn_);
@@ -9,6 +9,8 @@
 #pragma once
 
 #include <folly/Optional.h>
+#include <folly/Range.h>
+#include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 
 namespace quic {
@@ -33,6 +35,59 @@ class Aead {
       const folly::IOBuf* associatedData,
       uint64_t seqNum) const = 0;
 
+  /**
+   * Encrypts plaintext inside the buffer it is stored in. The plaintext has to
+   * be a single unshared IOBuf with at least getCipherOverhead() bytes of
+   * tailroom, and the returned ciphertext lives in that same IOBuf. Will throw
+   * on error.
+   *
+   * The default implementation encrypts into a separate buffer and copies the
+   * result back.
+   */
+  virtual std::unique_ptr<folly::IOBuf> inplaceEncrypt(
+      std::unique_ptr<folly::IOBuf>&& plaintext,
+      const folly::IOBuf* associatedData,
+      uint64_t seqNum) const {
+    CHECK(!plaintext->isChained());
+    auto ciphertext = encrypt(plaintext->cloneOne(), associatedData, seqNum);
+    auto ciphertextLen = ciphertext->computeChainDataLength();
+    CHECK_LE(ciphertextLen, plaintext->length() + plaintext->tailroom());
+    if (ciphertext->data() != plaintext->data()) {
+      folly::io::Cursor(ciphertext.get())
+          .pull(plaintext->writableData(), ciphertextLen);
+    }
+    if (ciphertextLen > plaintext->length()) {
+      plaintext->append(ciphertextLen - plaintext->length());
+    } else {
+      plaintext->trimEnd(plaintext->length() - ciphertextLen);
+    }
+    return std::move(plaintext);
+  }
+
+  /**
+   * One packet of a batch encryption. buf holds the plaintext on input and the
+   * ciphertext once encryptBatch returns.
+   */
+  struct BatchEntry {
+    std::unique_ptr<folly::IOBuf> buf;
+    const folly::IOBuf* associatedData;
+    uint64_t seqNum;
+  };
+
+  /**
+   * Encrypts every entry of the batch with this key, as encrypt would. Will
+   * throw on error.
+   *
+   * Implementations can interleave the entries to hide the latency of the
+   * cipher. The default implementation encrypts them one at a time.
+   */
+  virtual void encryptBatch(folly::Range<BatchEntry*> entries) const {
+    for (auto& entry : entries) {
+      entry.buf =
+          encrypt(std::move(entry.buf), entry.associatedData, entry.seqNum);
+    }
+  }
+
   /**
    * Decrypt ciphertext. Will throw if the ciphertext does not decrypt
    * successfully.
@@ -57,10 +112,51 @@ class Aead {
       const folly::IOBuf* associatedData,
       uint64_t seqNum) const = 0;
 
+  /**
+   * Decrypts ciphertext inside the buffer it is stored in. The ciphertext has
+   * to be a single IOBuf, and the returned plaintext lives in that same IOBuf,
+   * so sub buffers of it can be handed out without copying. Will return none
+   * if the ciphertext does not decrypt successfully.
+   *
+   * The default implementation decrypts into a separate buffer and copies the
+   * result back.
+   */
+  virtual folly::Optional<std::unique_ptr<folly::IOBuf>> tryInplaceDecrypt(
+      std::unique_ptr<folly::IOBuf>&& ciphertext,
+      const folly::IOBuf* associatedData,
+      uint64_t seqNum) const {
+    CHECK(!ciphertext->isChained());
+    auto plaintext = tryDecrypt(ciphertext->cloneOne(), associatedData, seqNum);
+    if (!plaintext) {
+      return folly::none;
+    }
+    if (!*plaintext) {
+      ciphertext->trimEnd(ciphertext->length());
+      return std::move(ciphertext);
+    }
+    auto plaintextLen = (*plaintext)->computeChainDataLength();
+    CHECK_LE(plaintextLen, ciphertext->length());
+    if ((*plaintext)->data() != ciphertext->data()) {
+      folly::io::Cursor(plaintext->get())
+          .pull(ciphertext->writableData(), plaintextLen);
+    }
+    ciphertext->trimEnd(ciphertext->length() - plaintextLen);
+    return std::move(ciphertext);
+  }
+
   /**
    * Returns the number of bytes the aead will add to the plaintext (size of
    * ciphertext - size of plaintext).
    */
   virtual size_t getCipherOverhead() const = 0;
+
+  /**
+   * Returns an aead with the same key that can be used on another thread at
+   * the same time as this one, or nullptr if the implementation can't make
+   * one, which is what the default implementation does.
+   */
+  virtual std::unique_ptr<Aead> clone() const {
+    return nullptr;
+  }
 };
 } // namespace quic
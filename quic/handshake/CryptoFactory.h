@@ -65,6 +65,12 @@ class CryptoFactory {
   virtual std::unique_ptr<PacketNumberCipher> makePacketNumberCipher(
       folly::ByteRange baseSecret) const = 0;
 
+  /**
+   * Makes the cipher, with the fixed key of the QUIC-TLS draft, that computes
+   * the integrity tag of Retry packets.
+   */
+  virtual std::unique_ptr<Aead> makeRetryAead() const = 0;
+
   virtual ~CryptoFactory() = default;
 };
 
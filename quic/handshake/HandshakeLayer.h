@@ -11,12 +11,14 @@
 #include <quic/QuicConstants.h>
 #include <quic/codec/PacketNumberCipher.h>
 #include <quic/codec/Types.h>
+#include <quic/handshake/Aead.h>
 
 namespace quic {
 
 constexpr folly::StringPiece kQuicKeyLabel = "quic key";
 constexpr folly::StringPiece kQuicIVLabel = "quic iv";
 constexpr folly::StringPiece kQuicPNLabel = "quic hp";
+constexpr folly::StringPiece kQuicKeyUpdateLabel = "quic ku";
 
 class Handshake {
  public:
@@ -24,6 +26,28 @@ class Handshake {
 
   virtual const folly::Optional<std::string>& getApplicationProtocol()
       const = 0;
+
+  /**
+   * The name of the negotiated cipher suite, if the handshake has got that
+   * far.
+   */
+  virtual folly::Optional<std::string> getCipherSuite() const {
+    return folly::none;
+  }
+
+  /**
+   * The 1-RTT read or write cipher of the next key phase, for a key update.
+   * Each call moves that direction's secret on by a generation, the header
+   * protection keys stay the same. Returns nullptr before there are 1-RTT
+   * keys, or if the handshake can't update them.
+   */
+  virtual std::unique_ptr<Aead> getNextOneRttReadCipher() {
+    return nullptr;
+  }
+
+  virtual std::unique_ptr<Aead> getNextOneRttWriteCipher() {
+    return nullptr;
+  }
 };
 
 constexpr folly::StringPiece kQuicDraft22Salt =
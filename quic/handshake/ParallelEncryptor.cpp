@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/handshake/ParallelEncryptor.h>
+
+#include <folly/synchronization/Baton.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace quic {
+
+namespace {
+// Chunks per thread, so that a slow thread holds up less of the batch.
+constexpr size_t kChunksPerThread = 2;
+} // namespace
+
+struct ParallelEncryptor::Batch {
+  struct Helper {
+    // Set by whichever of the helper and the calling thread gets to it
+    // first. The calling thread only waits for helpers that got there first.
+    std::atomic<bool> claimed{false};
+    folly::Baton<> done;
+    std::exception_ptr error;
+  };
+
+  Batch(
+      folly::Range<Aead::BatchEntry*> entriesIn,
+      size_t numHelpers,
+      size_t numChunksIn)
+      : entries(entriesIn), numChunks(numChunksIn), helpers(numHelpers) {}
+
+  void run(const Aead& aead) {
+    size_t chunk;
+    while ((chunk = nextChunk.fetch_add(1)) < numChunks) {
+      auto begin = entries.begin() + chunk * entries.size() / numChunks;
+      auto end = entries.begin() + (chunk + 1) * entries.size() / numChunks;
+      aead.encryptBatch(folly::range(begin, end));
+    }
+  }
+
+  folly::Range<Aead::BatchEntry*> entries;
+  const size_t numChunks;
+  std::atomic<size_t> nextChunk{0};
+  std::vector<Helper> helpers;
+};
+
+ParallelEncryptor::ParallelEncryptor(std::shared_ptr<folly::Executor> executor)
+    : executor_(std::move(executor)) {
+  CHECK(executor_);
+}
+
+ParallelEncryptor::~ParallelEncryptor() = default;
+
+void ParallelEncryptor::encryptBatch(
+    const Aead& aead,
+    folly::Range<Aead::BatchEntry*> entries,
+    size_t maxHelpers) {
+  if (copiesOf_ != &aead) {
+    copies_.clear();
+    copiesOf_ = &aead;
+  }
+  while (copies_.size() < maxHelpers) {
+    auto copy = aead.clone();
+    if (!copy) {
+      break;
+    }
+    copies_.push_back(std::move(copy));
+  }
+  auto numHelpers = std::min(
+      std::min(copies_.size(), maxHelpers),
+      entries.size() ? entries.size() - 1 : 0);
+  if (numHelpers == 0) {
+    aead.encryptBatch(entries);
+    return;
+  }
+  auto batch = std::make_shared<Batch>(
+      entries,
+      numHelpers,
+      std::min(entries.size(), (numHelpers + 1) * kChunksPerThread));
+  for (size_t i = 0; i < numHelpers; ++i) {
+    try {
+      executor_->add([batch, i, copy = copies_[i].get()] {
+        auto& helper = batch->helpers[i];
+        if (helper.claimed.exchange(true)) {
+          return;
+        }
+        try {
+          batch->run(*copy);
+        } catch (...) {
+          helper.error = std::current_exception();
+        }
+        helper.done.post();
+      });
+    } catch (const std::exception& ex) {
+      VLOG(4) << "Failed to add encrypt helper: " << ex.what();
+      batch->helpers[i].claimed = true;
+      batch->helpers[i].done.post();
+    }
+  }
+  std::exception_ptr error;
+  try {
+    batch->run(aead);
+  } catch (...) {
+    error = std::current_exception();
+    // The helpers stop after their current chunk.
+    batch->nextChunk = batch->numChunks;
+  }
+  for (auto& helper : batch->helpers) {
+    if (!helper.claimed.exchange(true)) {
+      // Never started, and won't.
+      continue;
+    }
+    helper.done.wait();
+    if (!error && helper.error) {
+      error = helper.error;
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+} // namespace quic
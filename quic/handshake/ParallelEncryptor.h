@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Executor.h>
+#include <quic/handshake/Aead.h>
+
+#include <memory>
+#include <vector>
+
+namespace quic {
+
+/**
+ * Spreads the encryption of a batch of packets over the calling thread and
+ * helpers run on an executor, each with its own clone of the aead. The batch
+ * is cut into chunks that everyone takes in turn, so the calling thread does
+ * all of them itself if the executor is busy, and helpers that haven't started
+ * by the time it's done aren't waited for.
+ *
+ * Used by the one thread of a connection, it keeps the clones of the last
+ * aead it was given.
+ */
+class ParallelEncryptor {
+ public:
+  explicit ParallelEncryptor(std::shared_ptr<folly::Executor> executor);
+
+  ~ParallelEncryptor();
+
+  /**
+   * Encrypts every entry of the batch with aead, as Aead::encryptBatch would,
+   * with up to maxHelpers helpers. Falls back to aead.encryptBatch if aead
+   * can't be cloned. Will throw on error.
+   */
+  void encryptBatch(
+      const Aead& aead,
+      folly::Range<Aead::BatchEntry*> entries,
+      size_t maxHelpers);
+
+ private:
+  struct Batch;
+
+  std::shared_ptr<folly::Executor> executor_;
+  // Clones of copiesOf_, one per helper.
+  const Aead* copiesOf_{nullptr};
+  std::vector<std::unique_ptr<Aead>> copies_;
+};
+
+} // namespace quic
@@ -29,7 +29,8 @@ enum class TransportParameterId : uint64_t {
   max_ack_delay = 0x000b,
   disable_migration = 0x000c,
   preferred_address = 0x000d,
-  active_connection_id_limit = 0x000e
+  active_connection_id_limit = 0x000e,
+  max_datagram_frame_size = 0x0020
 };
 
 struct TransportParameter {
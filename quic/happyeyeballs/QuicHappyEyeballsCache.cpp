@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/happyeyeballs/QuicHappyEyeballsCache.h>
+
+#include <quic/state/StateData.h>
+
+namespace quic {
+
+QuicHappyEyeballsCache::QuicHappyEyeballsCache(
+    size_t capacity,
+    std::chrono::seconds maxAge)
+    : maxAge_(maxAge), cache_(capacity) {}
+
+void QuicHappyEyeballsCache::onRaceWon(
+    const std::string& destination,
+    sa_family_t family,
+    TimePoint now) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = cache_.find(destination);
+  if (it == cache_.end() || it->second.family != family) {
+    HappyEyeballsCacheEntry entry;
+    entry.family = family;
+    entry.wins = 1;
+    entry.recordTime = now;
+    cache_.set(destination, std::move(entry));
+    return;
+  }
+  ++it->second.wins;
+  it->second.recordTime = now;
+}
+
+void QuicHappyEyeballsCache::onConnectionClosed(
+    const std::string& destination,
+    const QuicConnectionStateBase& conn) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (conn.lossState.srtt == 0us) {
+    cache_.erase(destination);
+    return;
+  }
+  // Leaves recordTime alone, the entry is only as fresh as the last race.
+  auto it = cache_.find(destination);
+  if (it != cache_.end() &&
+      it->second.family == conn.peerAddress.getFamily()) {
+    it->second.srtt = conn.lossState.srtt;
+  }
+}
+
+folly::Optional<HappyEyeballsCacheEntry> QuicHappyEyeballsCache::get(
+    const std::string& destination,
+    TimePoint now) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = cache_.find(destination);
+  if (it == cache_.end()) {
+    return folly::none;
+  }
+  if (now - it->second.recordTime > maxAge_) {
+    cache_.erase(destination);
+    return folly::none;
+  }
+  return it->second;
+}
+
+void QuicHappyEyeballsCache::remove(const std::string& destination) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  cache_.erase(destination);
+}
+
+size_t QuicHappyEyeballsCache::size() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return cache_.size();
+}
+
+std::chrono::milliseconds happyEyeballsConnAttemptDelay(
+    const HappyEyeballsCacheEntry& entry) {
+  if (entry.srtt == 0us) {
+    return kHappyEyeballsV4Delay;
+  }
+  auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+      entry.srtt * 2);
+  return std::max(
+      kHappyEyeballsMinConnAttemptDelay,
+      std::min(delay, kHappyEyeballsV4Delay));
+}
+
+bool happyEyeballsShouldSkipRace(const HappyEyeballsCacheEntry& entry) {
+  return entry.wins >= kHappyEyeballsSkipRaceAfterWins;
+}
+
+} // namespace quic
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/QuicConstants.h>
+
+#include <folly/Optional.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <folly/net/NetOps.h>
+
+#include <mutex>
+#include <string>
+
+namespace quic {
+
+constexpr size_t kDefaultHappyEyeballsCacheSize = 1000;
+constexpr std::chrono::minutes kDefaultHappyEyeballsCacheMaxAge{10};
+
+struct QuicConnectionStateBase;
+
+/**
+ * Which address family won the last races to a destination.
+ */
+struct HappyEyeballsCacheEntry {
+  sa_family_t family{AF_UNSPEC};
+  // Races in a row that family won.
+  uint32_t wins{0};
+  // Of the last connection over family, 0 if it didn't get a sample.
+  std::chrono::microseconds srtt{0us};
+  // Of the last race, entries are only fresh for maxAge after it.
+  TimePoint recordTime;
+};
+
+/**
+ * An LRU cache of HappyEyeballsCacheEntry keyed by destination, usually the
+ * hostname. It is thread safe, so that it can be shared by all the client
+ * transports of a process.
+ */
+class QuicHappyEyeballsCache {
+ public:
+  explicit QuicHappyEyeballsCache(
+      size_t capacity = kDefaultHappyEyeballsCacheSize,
+      std::chrono::seconds maxAge = kDefaultHappyEyeballsCacheMaxAge);
+
+  void onRaceWon(
+      const std::string& destination,
+      sa_family_t family,
+      TimePoint now);
+
+  /**
+   * Records the rtt of conn. A connection that never heard from its peer
+   * drops the entry, the family it went by may no longer work.
+   */
+  void onConnectionClosed(
+      const std::string& destination,
+      const QuicConnectionStateBase& conn);
+
+  folly::Optional<HappyEyeballsCacheEntry> get(
+      const std::string& destination,
+      TimePoint now);
+
+  void remove(const std::string& destination);
+
+  size_t size() const;
+
+ private:
+  const std::chrono::seconds maxAge_;
+  mutable std::mutex mutex_;
+  folly::EvictingCacheMap<std::string, HappyEyeballsCacheEntry> cache_;
+};
+
+/**
+ * Delay before starting the connection attempt with the other family: twice
+ * the cached rtt, so that the cached family gets to answer first if it still
+ * works, between kHappyEyeballsMinConnAttemptDelay and kHappyEyeballsV4Delay.
+ */
+std::chrono::milliseconds happyEyeballsConnAttemptDelay(
+    const HappyEyeballsCacheEntry& entry);
+
+/**
+ * Whether the family in the entry has won often enough that the other one
+ * isn't worth racing.
+ */
+bool happyEyeballsShouldSkipRace(const HappyEyeballsCacheEntry& entry);
+
+} // namespace quic
@@ -59,6 +59,27 @@ void happyEyeballsAddSocket(
   connection.happyEyeballsState.secondSocket = std::move(socket);
 }
 
+void happyEyeballsSkipRace(
+    QuicConnectionStateBase& connection,
+    sa_family_t family) {
+  auto& happyEyeballsState = connection.happyEyeballsState;
+  if (!happyEyeballsState.v6PeerAddress.isInitialized() ||
+      !happyEyeballsState.v4PeerAddress.isInitialized()) {
+    return;
+  }
+  QUIC_TRACE(
+      happy_eyeballs,
+      connection,
+      "skip race",
+      family == AF_INET ? "keep v4" : "keep v6");
+  if (family == AF_INET) {
+    happyEyeballsState.v6PeerAddress = folly::SocketAddress();
+  } else {
+    happyEyeballsState.v4PeerAddress = folly::SocketAddress();
+  }
+  happyEyeballsState.secondSocket.reset();
+}
+
 void startHappyEyeballs(
     QuicConnectionStateBase& connection,
     folly::EventBase* evb,
@@ -103,6 +124,10 @@ void startHappyEyeballs(
           errMsgCallback,
           readCallback,
           options);
+      if (connection.transportSettings.pacingUsesTxTime &&
+          !enableTxTime(*connection.happyEyeballsState.secondSocket)) {
+        connection.transportSettings.pacingUsesTxTime = false;
+      }
     } catch (const std::exception&) {
       // If second socket bind throws exception, give it up
       connAttemptDelayTimeout.cancelTimeout();
@@ -155,6 +180,16 @@ void happyEyeballsSetUpSocket(
   if (transportSettings.enableSocketErrMsgCallback) {
     socket.setErrMessageCallback(errMsgCallback);
   }
+  if (transportSettings.shouldUseGROForRecv && !socket.setGRO(true)) {
+    VLOG(2) << "UDP GRO is not supported on this socket";
+  }
+  if (transportSettings.enableEcn) {
+    applyEcnSocketOptions(socket, sockFamily);
+  }
+  if (transportSettings.enableRecvTimestamps &&
+      !enableRecvTimestamps(socket)) {
+    VLOG(2) << "RX timestamps are not supported on this socket";
+  }
   socket.resumeRead(readCallback);
 }
 
@@ -33,6 +33,13 @@ void happyEyeballsAddSocket(
     QuicConnectionStateBase& connection,
     std::unique_ptr<folly::AsyncUDPSocket> socket);
 
+/**
+ * Only connects to the address of family, when there are both.
+ */
+void happyEyeballsSkipRace(
+    QuicConnectionStateBase& connection,
+    sa_family_t family);
+
 void startHappyEyeballs(
     QuicConnectionStateBase& connection,
     folly::EventBase* evb,
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <quic/happyeyeballs/QuicHappyEyeballsCache.h>
+#include <quic/state/StateData.h>
+
+using namespace std::chrono_literals;
+using namespace quic;
+
+TEST(QuicHappyEyeballsCacheTest, CountsWins) {
+  QuicHappyEyeballsCache cache;
+  auto now = Clock::now();
+  EXPECT_FALSE(cache.get("example.com", now));
+  cache.onRaceWon("example.com", AF_INET, now);
+  cache.onRaceWon("example.com", AF_INET, now);
+  auto entry = cache.get("example.com", now);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(AF_INET, entry->family);
+  EXPECT_EQ(2, entry->wins);
+
+  // The other family starts over.
+  cache.onRaceWon("example.com", AF_INET6, now);
+  entry = cache.get("example.com", now);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(AF_INET6, entry->family);
+  EXPECT_EQ(1, entry->wins);
+  EXPECT_FALSE(cache.get("example.org", now));
+}
+
+TEST(QuicHappyEyeballsCacheTest, ExpiresAndEvicts) {
+  QuicHappyEyeballsCache cache(1, 60s);
+  auto now = Clock::now();
+  cache.onRaceWon("example.com", AF_INET, now);
+  EXPECT_TRUE(cache.get("example.com", now + 60s));
+  EXPECT_FALSE(cache.get("example.com", now + 61s));
+  EXPECT_EQ(0, cache.size());
+
+  cache.onRaceWon("example.com", AF_INET, now);
+  cache.onRaceWon("example.org", AF_INET, now);
+  EXPECT_EQ(1, cache.size());
+  EXPECT_FALSE(cache.get("example.com", now));
+}
+
+TEST(QuicHappyEyeballsCacheTest, ConnectionClosed) {
+  QuicHappyEyeballsCache cache;
+  auto now = Clock::now();
+  cache.onRaceWon("example.com", AF_INET, now);
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  conn.peerAddress = folly::SocketAddress("1.2.3.4", 443);
+  conn.lossState.srtt = 30ms;
+  cache.onConnectionClosed("example.com", conn);
+  auto entry = cache.get("example.com", now);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(30ms, entry->srtt);
+  EXPECT_EQ(now, entry->recordTime);
+
+  // Never heard from the peer.
+  conn.lossState.srtt = 0us;
+  cache.onConnectionClosed("example.com", conn);
+  EXPECT_FALSE(cache.get("example.com", now));
+}
+
+TEST(QuicHappyEyeballsCacheTest, ConnAttemptDelay) {
+  HappyEyeballsCacheEntry entry;
+  entry.family = AF_INET;
+  entry.wins = 1;
+  EXPECT_EQ(kHappyEyeballsV4Delay, happyEyeballsConnAttemptDelay(entry));
+  entry.srtt = 20ms;
+  EXPECT_EQ(40ms, happyEyeballsConnAttemptDelay(entry));
+  entry.srtt = 1ms;
+  EXPECT_EQ(
+      kHappyEyeballsMinConnAttemptDelay, happyEyeballsConnAttemptDelay(entry));
+  entry.srtt = 1s;
+  EXPECT_EQ(kHappyEyeballsV4Delay, happyEyeballsConnAttemptDelay(entry));
+
+  EXPECT_FALSE(happyEyeballsShouldSkipRace(entry));
+  entry.wins = kHappyEyeballsSkipRaceAfterWins;
+  EXPECT_TRUE(happyEyeballsShouldSkipRace(entry));
+}
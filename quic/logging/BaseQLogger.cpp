@@ -2,6 +2,8 @@
 
 #include <quic/logging/BaseQLogger.h>
 
+#include <folly/lang/Assume.h>
+
 namespace {
 void addQuicSimpleFrameToEvent(
     quic::QLogPacketEvent* event,
@@ -69,8 +71,68 @@ void addQuicSimpleFrameToEvent(
       event->frames.push_back(std::make_unique<quic::HandshakeDoneFrameLog>());
       break;
     }
+    case quic::QuicSimpleFrame::Type::AckFrequencyFrame_E: {
+      const quic::AckFrequencyFrame& frame = *simpleFrame.asAckFrequencyFrame();
+      event->frames.push_back(std::make_unique<quic::AckFrequencyFrameLog>(
+          frame.sequenceNumber,
+          frame.packetTolerance,
+          frame.updateMaxAckDelay,
+          frame.ignoreOrder));
+      break;
+    }
+    case quic::QuicSimpleFrame::Type::RepairFrame_E: {
+      const quic::RepairFrame& frame = *simpleFrame.asRepairFrame();
+      event->frames.push_back(std::make_unique<quic::RepairFrameLog>(
+          frame.firstPacketNum, frame.packetMask));
+      break;
+    }
   }
 }
+
+quic::FrameType simpleFrameType(const quic::QuicSimpleFrame& simpleFrame) {
+  switch (simpleFrame.type()) {
+    case quic::QuicSimpleFrame::Type::PingFrame_E:
+      return quic::FrameType::PING;
+    case quic::QuicSimpleFrame::Type::StopSendingFrame_E:
+      return quic::FrameType::STOP_SENDING;
+    case quic::QuicSimpleFrame::Type::MinStreamDataFrame_E:
+      return quic::FrameType::MIN_STREAM_DATA;
+    case quic::QuicSimpleFrame::Type::ExpiredStreamDataFrame_E:
+      return quic::FrameType::EXPIRED_STREAM_DATA;
+    case quic::QuicSimpleFrame::Type::PathChallengeFrame_E:
+      return quic::FrameType::PATH_CHALLENGE;
+    case quic::QuicSimpleFrame::Type::PathResponseFrame_E:
+      return quic::FrameType::PATH_RESPONSE;
+    case quic::QuicSimpleFrame::Type::NewConnectionIdFrame_E:
+      return quic::FrameType::NEW_CONNECTION_ID;
+    case quic::QuicSimpleFrame::Type::MaxStreamsFrame_E:
+      return simpleFrame.asMaxStreamsFrame()->isForBidirectional
+          ? quic::FrameType::MAX_STREAMS_BIDI
+          : quic::FrameType::MAX_STREAMS_UNI;
+    case quic::QuicSimpleFrame::Type::RetireConnectionIdFrame_E:
+      return quic::FrameType::RETIRE_CONNECTION_ID;
+    case quic::QuicSimpleFrame::Type::HandshakeDoneFrame_E:
+      return quic::FrameType::HANDSHAKE_DONE;
+    case quic::QuicSimpleFrame::Type::AckFrequencyFrame_E:
+      return quic::FrameType::ACK_FREQUENCY;
+    case quic::QuicSimpleFrame::Type::RepairFrame_E:
+      return quic::FrameType::FEC_REPAIR;
+  }
+  folly::assume_unreachable();
+}
+
+quic::FrameType connectionCloseFrameType(
+    const quic::ConnectionCloseFrame& frame) {
+  return frame.errorCode.asApplicationErrorCode()
+      ? quic::FrameType::CONNECTION_CLOSE_APP_ERR
+      : quic::FrameType::CONNECTION_CLOSE;
+}
+
+quic::FrameType streamsBlockedFrameType(
+    const quic::StreamsBlockedFrame& frame) {
+  return frame.isForBidirectional ? quic::FrameType::STREAMS_BLOCKED_BIDI
+                                  : quic::FrameType::STREAMS_BLOCKED_UNI;
+}
 } // namespace
 
 namespace quic {
@@ -167,6 +229,12 @@ std::unique_ptr<QLogPacketEvent> BaseQLogger::createPacketEvent(
         event->frames.push_back(std::make_unique<ReadNewTokenFrameLog>());
         break;
       }
+      case QuicFrame::Type::DatagramFrame_E: {
+        const auto& frame = *quicFrame.asDatagramFrame();
+        event->frames.push_back(
+            std::make_unique<DatagramFrameLog>(frame.length));
+        break;
+      }
       case QuicFrame::Type::QuicSimpleFrame_E: {
         const auto& simpleFrame = *quicFrame.asQuicSimpleFrame();
         addQuicSimpleFrameToEvent(event.get(), simpleFrame);
@@ -268,6 +336,12 @@ std::unique_ptr<QLogPacketEvent> BaseQLogger::createPacketEvent(
             std::make_unique<CryptoFrameLog>(frame.offset, frame.len));
         break;
       }
+      case QuicWriteFrame::Type::DatagramFrame_E: {
+        const DatagramFrame& frame = *quicFrame.asDatagramFrame();
+        event->frames.push_back(
+            std::make_unique<DatagramFrameLog>(frame.length));
+        break;
+      }
       case QuicWriteFrame::Type::QuicSimpleFrame_E: {
         const QuicSimpleFrame& simpleFrame = *quicFrame.asQuicSimpleFrame();
         addQuicSimpleFrameToEvent(event.get(), simpleFrame);
@@ -300,4 +374,149 @@ std::unique_ptr<QLogVersionNegotiationEvent> BaseQLogger::createPacketEvent(
   return event;
 }
 
+std::unique_ptr<QLogCompactPacketEvent> BaseQLogger::createCompactPacketEvent(
+    const RegularQuicPacket& regularPacket,
+    uint64_t packetSize) {
+  auto event = std::make_unique<QLogCompactPacketEvent>();
+  event->refTime = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - refTimePoint);
+  event->packetSize = packetSize;
+  event->eventType = QLogEventType::PacketReceived;
+  const ShortHeader* shortHeader = regularPacket.header.asShort();
+  if (shortHeader) {
+    event->packetType = kShortHeaderPacketType.toString();
+  } else {
+    event->packetType =
+        toString(regularPacket.header.asLong()->getHeaderType());
+  }
+  if (event->packetType != toString(LongHeader::Types::Retry)) {
+    // A Retry packet does not include a packet number.
+    event->packetNum = regularPacket.header.getPacketSequenceNum();
+  }
+
+  for (const auto& quicFrame : regularPacket.frames) {
+    switch (quicFrame.type()) {
+      case QuicFrame::Type::PaddingFrame_E:
+        ++event->numPaddingFrames;
+        break;
+      case QuicFrame::Type::RstStreamFrame_E:
+        event->addFrameType(FrameType::RST_STREAM);
+        break;
+      case QuicFrame::Type::ConnectionCloseFrame_E:
+        event->addFrameType(
+            connectionCloseFrameType(*quicFrame.asConnectionCloseFrame()));
+        break;
+      case QuicFrame::Type::MaxDataFrame_E:
+        event->addFrameType(FrameType::MAX_DATA);
+        break;
+      case QuicFrame::Type::MaxStreamDataFrame_E:
+        event->addFrameType(FrameType::MAX_STREAM_DATA);
+        break;
+      case QuicFrame::Type::DataBlockedFrame_E:
+        event->addFrameType(FrameType::DATA_BLOCKED);
+        break;
+      case QuicFrame::Type::StreamDataBlockedFrame_E:
+        event->addFrameType(FrameType::STREAM_DATA_BLOCKED);
+        break;
+      case QuicFrame::Type::StreamsBlockedFrame_E:
+        event->addFrameType(
+            streamsBlockedFrameType(*quicFrame.asStreamsBlockedFrame()));
+        break;
+      case QuicFrame::Type::ReadAckFrame_E:
+        event->addFrameType(FrameType::ACK);
+        break;
+      case QuicFrame::Type::ReadStreamFrame_E: {
+        const auto& frame = *quicFrame.asReadStreamFrame();
+        event->addStreamRange(
+            frame.streamId, frame.offset, frame.data->length(), frame.fin);
+        break;
+      }
+      case QuicFrame::Type::ReadCryptoFrame_E:
+        event->addFrameType(FrameType::CRYPTO_FRAME);
+        break;
+      case QuicFrame::Type::ReadNewTokenFrame_E:
+        event->addFrameType(FrameType::NEW_TOKEN);
+        break;
+      case QuicFrame::Type::DatagramFrame_E:
+        event->addFrameType(FrameType::DATAGRAM);
+        break;
+      case QuicFrame::Type::QuicSimpleFrame_E:
+        event->addFrameType(simpleFrameType(*quicFrame.asQuicSimpleFrame()));
+        break;
+      case QuicFrame::Type::NoopFrame_E:
+        break;
+    }
+  }
+  return event;
+}
+
+std::unique_ptr<QLogCompactPacketEvent> BaseQLogger::createCompactPacketEvent(
+    const RegularQuicWritePacket& writePacket,
+    uint64_t packetSize) {
+  auto event = std::make_unique<QLogCompactPacketEvent>();
+  event->refTime = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - refTimePoint);
+  event->packetNum = writePacket.header.getPacketSequenceNum();
+  event->packetSize = packetSize;
+  event->eventType = QLogEventType::PacketSent;
+  const ShortHeader* shortHeader = writePacket.header.asShort();
+  if (shortHeader) {
+    event->packetType = kShortHeaderPacketType.toString();
+  } else {
+    event->packetType = toString(writePacket.header.asLong()->getHeaderType());
+  }
+
+  for (const auto& quicFrame : writePacket.frames) {
+    switch (quicFrame.type()) {
+      case QuicWriteFrame::Type::PaddingFrame_E:
+        ++event->numPaddingFrames;
+        break;
+      case QuicWriteFrame::Type::RstStreamFrame_E:
+        event->addFrameType(FrameType::RST_STREAM);
+        break;
+      case QuicWriteFrame::Type::ConnectionCloseFrame_E:
+        event->addFrameType(
+            connectionCloseFrameType(*quicFrame.asConnectionCloseFrame()));
+        break;
+      case QuicWriteFrame::Type::MaxDataFrame_E:
+        event->addFrameType(FrameType::MAX_DATA);
+        break;
+      case QuicWriteFrame::Type::MaxStreamDataFrame_E:
+        event->addFrameType(FrameType::MAX_STREAM_DATA);
+        break;
+      case QuicWriteFrame::Type::DataBlockedFrame_E:
+        event->addFrameType(FrameType::DATA_BLOCKED);
+        break;
+      case QuicWriteFrame::Type::StreamDataBlockedFrame_E:
+        event->addFrameType(FrameType::STREAM_DATA_BLOCKED);
+        break;
+      case QuicWriteFrame::Type::StreamsBlockedFrame_E:
+        event->addFrameType(
+            streamsBlockedFrameType(*quicFrame.asStreamsBlockedFrame()));
+        break;
+      case QuicWriteFrame::Type::WriteAckFrame_E:
+        event->addFrameType(FrameType::ACK);
+        break;
+      case QuicWriteFrame::Type::WriteStreamFrame_E: {
+        const auto& frame = *quicFrame.asWriteStreamFrame();
+        event->addStreamRange(
+            frame.streamId, frame.offset, frame.len, frame.fin);
+        break;
+      }
+      case QuicWriteFrame::Type::WriteCryptoFrame_E:
+        event->addFrameType(FrameType::CRYPTO_FRAME);
+        break;
+      case QuicWriteFrame::Type::DatagramFrame_E:
+        event->addFrameType(FrameType::DATAGRAM);
+        break;
+      case QuicWriteFrame::Type::QuicSimpleFrame_E:
+        event->addFrameType(simpleFrameType(*quicFrame.asQuicSimpleFrame()));
+        break;
+      case QuicWriteFrame::Type::NoopFrame_E:
+        break;
+    }
+  }
+  return event;
+}
+
 } // namespace quic
@@ -34,5 +34,13 @@ class BaseQLogger : public QLogger {
       const VersionNegotiationPacket& versionPacket,
       uint64_t packetSize,
       bool isPacketRecvd);
+
+  std::unique_ptr<QLogCompactPacketEvent> createCompactPacketEvent(
+      const RegularQuicPacket& regularPacket,
+      uint64_t packetSize);
+
+  std::unique_ptr<QLogCompactPacketEvent> createCompactPacketEvent(
+      const RegularQuicWritePacket& writePacket,
+      uint64_t packetSize);
 };
 } // namespace quic
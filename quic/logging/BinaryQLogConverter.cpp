@@ -0,0 +1,438 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/logging/BinaryQLogConverter.h>
+
+#include <quic/logging/BinaryQLogRing.h>
+
+#include <map>
+
+namespace {
+using quic::BinaryQLogDecoder;
+
+quic::QuicErrorCode getErrorCode(BinaryQLogDecoder& dec) {
+  auto type = static_cast<quic::QuicErrorCode::Type>(dec.getVarint());
+  auto value = dec.getVarint();
+  switch (type) {
+    case quic::QuicErrorCode::Type::LocalErrorCode_E:
+      return quic::LocalErrorCode(value);
+    case quic::QuicErrorCode::Type::TransportErrorCode_E:
+      return quic::TransportErrorCode(value);
+    case quic::QuicErrorCode::Type::ApplicationErrorCode_E:
+      break;
+  }
+  return quic::ApplicationErrorCode(value);
+}
+
+std::unique_ptr<quic::QLogFrame> getFrame(BinaryQLogDecoder& dec) {
+  using quic::BinaryQLogFrameType;
+  switch (static_cast<BinaryQLogFrameType>(dec.getVarint())) {
+    case BinaryQLogFrameType::Padding:
+      return std::make_unique<quic::PaddingFrameLog>(dec.getVarint());
+    case BinaryQLogFrameType::RstStream: {
+      auto streamId = dec.getVarint();
+      auto errorCode = dec.getVarint();
+      auto offset = dec.getVarint();
+      return std::make_unique<quic::RstStreamFrameLog>(
+          streamId, errorCode, offset);
+    }
+    case BinaryQLogFrameType::ConnectionClose: {
+      auto errorCode = getErrorCode(dec);
+      auto reasonPhrase = dec.getString();
+      auto closingFrameType = static_cast<quic::FrameType>(dec.getVarint());
+      return std::make_unique<quic::ConnectionCloseFrameLog>(
+          std::move(errorCode), std::move(reasonPhrase), closingFrameType);
+    }
+    case BinaryQLogFrameType::MaxData:
+      return std::make_unique<quic::MaxDataFrameLog>(dec.getVarint());
+    case BinaryQLogFrameType::MaxStreamData: {
+      auto streamId = dec.getVarint();
+      auto maximumData = dec.getVarint();
+      return std::make_unique<quic::MaxStreamDataFrameLog>(
+          streamId, maximumData);
+    }
+    case BinaryQLogFrameType::MaxStreams: {
+      auto maxStreams = dec.getVarint();
+      auto isForBidirectional = dec.getBool();
+      return std::make_unique<quic::MaxStreamsFrameLog>(
+          maxStreams, isForBidirectional);
+    }
+    case BinaryQLogFrameType::StreamsBlocked: {
+      auto streamLimit = dec.getVarint();
+      auto isForBidirectional = dec.getBool();
+      return std::make_unique<quic::StreamsBlockedFrameLog>(
+          streamLimit, isForBidirectional);
+    }
+    case BinaryQLogFrameType::Ping:
+      return std::make_unique<quic::PingFrameLog>();
+    case BinaryQLogFrameType::DataBlocked:
+      return std::make_unique<quic::DataBlockedFrameLog>(dec.getVarint());
+    case BinaryQLogFrameType::StreamDataBlocked: {
+      auto streamId = dec.getVarint();
+      auto dataLimit = dec.getVarint();
+      return std::make_unique<quic::StreamDataBlockedFrameLog>(
+          streamId, dataLimit);
+    }
+    case BinaryQLogFrameType::Ack: {
+      std::chrono::microseconds ackDelay(dec.getVarint());
+      auto numBlocks = dec.getVarint();
+      quic::ReadAckFrame::Vec ackBlocks;
+      for (uint64_t i = 0; i < numBlocks && !dec.failed(); ++i) {
+        auto start = dec.getVarint();
+        auto end = dec.getVarint();
+        ackBlocks.emplace_back(start, end);
+      }
+      return std::make_unique<quic::ReadAckFrameLog>(ackBlocks, ackDelay);
+    }
+    case BinaryQLogFrameType::Stream: {
+      auto streamId = dec.getVarint();
+      auto offset = dec.getVarint();
+      auto len = dec.getVarint();
+      auto fin = dec.getBool();
+      return std::make_unique<quic::StreamFrameLog>(streamId, offset, len, fin);
+    }
+    case BinaryQLogFrameType::Crypto: {
+      auto offset = dec.getVarint();
+      auto len = dec.getVarint();
+      return std::make_unique<quic::CryptoFrameLog>(offset, len);
+    }
+    case BinaryQLogFrameType::StopSending: {
+      auto streamId = dec.getVarint();
+      auto errorCode = dec.getVarint();
+      return std::make_unique<quic::StopSendingFrameLog>(streamId, errorCode);
+    }
+    case BinaryQLogFrameType::MinStreamData: {
+      auto streamId = dec.getVarint();
+      auto maximumData = dec.getVarint();
+      auto minimumStreamOffset = dec.getVarint();
+      return std::make_unique<quic::MinStreamDataFrameLog>(
+          streamId, maximumData, minimumStreamOffset);
+    }
+    case BinaryQLogFrameType::ExpiredStreamData: {
+      auto streamId = dec.getVarint();
+      auto minimumStreamOffset = dec.getVarint();
+      return std::make_unique<quic::ExpiredStreamDataFrameLog>(
+          streamId, minimumStreamOffset);
+    }
+    case BinaryQLogFrameType::PathChallenge:
+      return std::make_unique<quic::PathChallengeFrameLog>(dec.getVarint());
+    case BinaryQLogFrameType::PathResponse:
+      return std::make_unique<quic::PathResponseFrameLog>(dec.getVarint());
+    case BinaryQLogFrameType::NewConnectionId: {
+      auto sequence = dec.getVarint();
+      auto tokenBytes = dec.getBytes();
+      quic::StatelessResetToken token{};
+      if (tokenBytes.size() != token.size()) {
+        return nullptr;
+      }
+      std::copy(tokenBytes.begin(), tokenBytes.end(), token.begin());
+      return std::make_unique<quic::NewConnectionIdFrameLog>(sequence, token);
+    }
+    case BinaryQLogFrameType::RetireConnectionId:
+      return std::make_unique<quic::RetireConnectionIdFrameLog>(
+          dec.getVarint());
+    case BinaryQLogFrameType::NewToken:
+      return std::make_unique<quic::ReadNewTokenFrameLog>();
+    case BinaryQLogFrameType::HandshakeDone:
+      return std::make_unique<quic::HandshakeDoneFrameLog>();
+    case BinaryQLogFrameType::AckFrequency: {
+      auto sequence = dec.getVarint();
+      auto packetTolerance = dec.getVarint();
+      std::chrono::microseconds updateMaxAckDelay(dec.getVarint());
+      auto ignoreOrder = dec.getBool();
+      return std::make_unique<quic::AckFrequencyFrameLog>(
+          sequence, packetTolerance, updateMaxAckDelay, ignoreOrder);
+    }
+    case BinaryQLogFrameType::Datagram:
+      return std::make_unique<quic::DatagramFrameLog>(dec.getVarint());
+    case BinaryQLogFrameType::Repair: {
+      auto firstPacketNum = dec.getVarint();
+      auto packetMask = dec.getVarint();
+      return std::make_unique<quic::RepairFrameLog>(firstPacketNum, packetMask);
+    }
+  }
+  return nullptr;
+}
+
+std::unique_ptr<quic::QLogEvent> getPacketEvent(
+    BinaryQLogDecoder& dec,
+    quic::QLogEventType eventType,
+    std::chrono::microseconds refTime) {
+  auto event = std::make_unique<quic::QLogPacketEvent>();
+  event->refTime = refTime;
+  event->eventType = eventType;
+  auto packetType = dec.getVarint();
+  if (packetType == quic::kBinaryQLogShortHeaderPacketType) {
+    event->packetType = quic::kShortHeaderPacketType.toString();
+  } else {
+    event->packetType = quic::toString(static_cast<quic::LongHeader::Types>(
+        packetType - quic::kBinaryQLogLongHeaderPacketType));
+  }
+  event->packetNum = dec.getVarint();
+  event->packetSize = dec.getVarint();
+  while (!dec.empty() && !dec.failed()) {
+    auto frame = getFrame(dec);
+    if (!frame) {
+      return nullptr;
+    }
+    event->frames.push_back(std::move(frame));
+  }
+  return event;
+}
+
+std::unique_ptr<quic::QLogEvent> getVersionNegotiationEvent(
+    BinaryQLogDecoder& dec,
+    quic::QLogEventType eventType,
+    std::chrono::microseconds refTime) {
+  auto event = std::make_unique<quic::QLogVersionNegotiationEvent>();
+  event->refTime = refTime;
+  event->eventType = eventType;
+  event->packetType = quic::kVersionNegotiationPacketType;
+  event->packetSize = dec.getVarint();
+  std::vector<quic::QuicVersion> versions;
+  while (!dec.empty() && !dec.failed()) {
+    versions.push_back(static_cast<quic::QuicVersion>(dec.getVarint()));
+  }
+  event->versionLog = std::make_unique<quic::VersionNegotiationLog>(versions);
+  return event;
+}
+
+std::unique_ptr<quic::QLogEvent> getEvent(
+    BinaryQLogDecoder& dec,
+    quic::BinaryQLogRecordType type,
+    std::chrono::microseconds refTime,
+    quic::VantagePoint vantagePoint) {
+  using quic::BinaryQLogRecordType;
+  switch (type) {
+    case BinaryQLogRecordType::PacketReceived:
+      return getPacketEvent(dec, quic::QLogEventType::PacketReceived, refTime);
+    case BinaryQLogRecordType::PacketSent:
+      return getPacketEvent(dec, quic::QLogEventType::PacketSent, refTime);
+    case BinaryQLogRecordType::VersionNegotiationReceived:
+      return getVersionNegotiationEvent(
+          dec, quic::QLogEventType::PacketReceived, refTime);
+    case BinaryQLogRecordType::VersionNegotiationSent:
+      return getVersionNegotiationEvent(
+          dec, quic::QLogEventType::PacketSent, refTime);
+    case BinaryQLogRecordType::ConnectionClose: {
+      auto error = dec.getString();
+      auto reason = dec.getString();
+      auto drainConnection = dec.getBool();
+      auto sendCloseImmediately = dec.getBool();
+      return std::make_unique<quic::QLogConnectionCloseEvent>(
+          std::move(error),
+          std::move(reason),
+          drainConnection,
+          sendCloseImmediately,
+          refTime);
+    }
+    case BinaryQLogRecordType::TransportSummary: {
+      uint64_t values[10];
+      for (auto& value : values) {
+        value = dec.getVarint();
+      }
+      return std::make_unique<quic::QLogTransportSummaryEvent>(
+          values[0],
+          values[1],
+          values[2],
+          values[3],
+          values[4],
+          values[5],
+          values[6],
+          values[7],
+          values[8],
+          values[9],
+          refTime);
+    }
+    case BinaryQLogRecordType::CongestionMetricUpdate: {
+      auto bytesInFlight = dec.getVarint();
+      auto currentCwnd = dec.getVarint();
+      auto congestionEvent = dec.getString();
+      auto state = dec.getString();
+      auto recoveryState = dec.getString();
+      return std::make_unique<quic::QLogCongestionMetricUpdateEvent>(
+          bytesInFlight,
+          currentCwnd,
+          std::move(congestionEvent),
+          std::move(state),
+          std::move(recoveryState),
+          refTime);
+    }
+    case BinaryQLogRecordType::BandwidthEstUpdate: {
+      auto bytes = dec.getVarint();
+      std::chrono::microseconds interval(dec.getVarint());
+      return std::make_unique<quic::QLogBandwidthEstUpdateEvent>(
+          bytes, interval, refTime);
+    }
+    case BinaryQLogRecordType::AppLimitedUpdate:
+      return std::make_unique<quic::QLogAppLimitedUpdateEvent>(true, refTime);
+    case BinaryQLogRecordType::AppUnlimitedUpdate:
+      return std::make_unique<quic::QLogAppLimitedUpdateEvent>(false, refTime);
+    case BinaryQLogRecordType::PacingMetricUpdate: {
+      auto pacingBurstSize = dec.getVarint();
+      std::chrono::microseconds pacingInterval(dec.getVarint());
+      return std::make_unique<quic::QLogPacingMetricUpdateEvent>(
+          pacingBurstSize, pacingInterval, refTime);
+    }
+    case BinaryQLogRecordType::PacingObservation: {
+      auto actual = dec.getString();
+      auto expected = dec.getString();
+      auto conclusion = dec.getString();
+      return std::make_unique<quic::QLogPacingObservationEvent>(
+          std::move(actual),
+          std::move(expected),
+          std::move(conclusion),
+          refTime);
+    }
+    case BinaryQLogRecordType::AppIdleUpdate: {
+      auto idleEvent = dec.getString();
+      auto idle = dec.getBool();
+      return std::make_unique<quic::QLogAppIdleUpdateEvent>(
+          std::move(idleEvent), idle, refTime);
+    }
+    case BinaryQLogRecordType::PacketDrop: {
+      auto packetSize = dec.getVarint();
+      auto dropReason = dec.getString();
+      return std::make_unique<quic::QLogPacketDropEvent>(
+          packetSize, std::move(dropReason), refTime);
+    }
+    case BinaryQLogRecordType::DatagramReceived:
+      return std::make_unique<quic::QLogDatagramReceivedEvent>(
+          dec.getVarint(), refTime);
+    case BinaryQLogRecordType::LossAlarm: {
+      auto largestSent = dec.getVarint();
+      auto alarmCount = dec.getVarint();
+      auto outstandingPackets = dec.getVarint();
+      auto lossType = dec.getString();
+      return std::make_unique<quic::QLogLossAlarmEvent>(
+          largestSent,
+          alarmCount,
+          outstandingPackets,
+          std::move(lossType),
+          refTime);
+    }
+    case BinaryQLogRecordType::PacketsLost: {
+      auto largestLostPacketNum = dec.getVarint();
+      auto lostBytes = dec.getVarint();
+      auto lostPackets = dec.getVarint();
+      return std::make_unique<quic::QLogPacketsLostEvent>(
+          largestLostPacketNum, lostBytes, lostPackets, refTime);
+    }
+    case BinaryQLogRecordType::TransportStateUpdate:
+      return std::make_unique<quic::QLogTransportStateUpdateEvent>(
+          dec.getString(), refTime);
+    case BinaryQLogRecordType::PacketBuffered: {
+      auto packetNum = dec.getVarint();
+      auto protectionType = static_cast<quic::ProtectionType>(dec.getVarint());
+      auto packetSize = dec.getVarint();
+      return std::make_unique<quic::QLogPacketBufferedEvent>(
+          packetNum, protectionType, packetSize, refTime);
+    }
+    case BinaryQLogRecordType::MetricUpdate: {
+      std::chrono::microseconds latestRtt(dec.getVarint());
+      std::chrono::microseconds mrtt(dec.getVarint());
+      std::chrono::microseconds srtt(dec.getVarint());
+      std::chrono::microseconds ackDelay(dec.getVarint());
+      return std::make_unique<quic::QLogMetricUpdateEvent>(
+          latestRtt, mrtt, srtt, ackDelay, refTime);
+    }
+    case BinaryQLogRecordType::StreamStateUpdate: {
+      auto id = dec.getVarint();
+      auto update = dec.getString();
+      folly::Optional<std::chrono::milliseconds> timeSinceStreamCreation;
+      if (dec.getBool()) {
+        timeSinceStreamCreation = std::chrono::milliseconds(dec.getVarint());
+      }
+      return std::make_unique<quic::QLogStreamStateUpdateEvent>(
+          id,
+          std::move(update),
+          std::move(timeSinceStreamCreation),
+          vantagePoint,
+          refTime);
+    }
+    case BinaryQLogRecordType::ConnectionMigration:
+      return std::make_unique<quic::QLogConnectionMigrationEvent>(
+          dec.getBool(), vantagePoint, refTime);
+    case BinaryQLogRecordType::PathValidation:
+      return std::make_unique<quic::QLogPathValidationEvent>(
+          dec.getBool(), vantagePoint, refTime);
+    case BinaryQLogRecordType::WriteLoopEnd: {
+      auto reason = dec.getString();
+      auto packetsWritten = dec.getVarint();
+      auto batchFlushes = dec.getVarint();
+      return std::make_unique<quic::QLogWriteLoopEndEvent>(
+          std::move(reason), packetsWritten, batchFlushes, refTime);
+    }
+    case BinaryQLogRecordType::ConnectionStart:
+    case BinaryQLogRecordType::Dcid:
+    case BinaryQLogRecordType::Scid:
+      break;
+  }
+  return nullptr;
+}
+
+folly::Optional<quic::ConnectionId> getConnectionId(BinaryQLogDecoder& dec) {
+  auto bytes = dec.getBytes();
+  if (dec.failed() || bytes.size() > quic::kMaxConnectionIdSize) {
+    return folly::none;
+  }
+  return quic::ConnectionId(std::vector<uint8_t>(bytes.begin(), bytes.end()));
+}
+} // namespace
+
+namespace quic {
+
+std::vector<std::unique_ptr<FileQLogger>> convertBinaryQLog(
+    folly::ByteRange contents) {
+  std::map<uint64_t, std::unique_ptr<FileQLogger>> connections;
+  forEachBinaryQLogRecord(contents, [&](folly::ByteRange record) {
+    BinaryQLogDecoder dec(record);
+    auto connection = dec.getVarint();
+    auto type = static_cast<BinaryQLogRecordType>(dec.getVarint());
+    std::chrono::microseconds refTime(dec.getVarint());
+    if (dec.failed()) {
+      return;
+    }
+    if (type == BinaryQLogRecordType::ConnectionStart) {
+      auto vantagePoint = static_cast<VantagePoint>(dec.getVarint());
+      auto protocolType = dec.getString();
+      if (!dec.failed()) {
+        connections[connection] = std::make_unique<FileQLogger>(
+            vantagePoint, std::move(protocolType));
+      }
+      return;
+    }
+    auto it = connections.find(connection);
+    if (it == connections.end()) {
+      // Its start has been overwritten.
+      return;
+    }
+    auto& logger = it->second;
+    if (type == BinaryQLogRecordType::Dcid) {
+      logger->setDcid(getConnectionId(dec));
+      return;
+    }
+    if (type == BinaryQLogRecordType::Scid) {
+      logger->setScid(getConnectionId(dec));
+      return;
+    }
+    auto event = getEvent(dec, type, refTime, logger->vantagePoint);
+    if (event && !dec.failed()) {
+      logger->logs.push_back(std::move(event));
+    }
+  });
+  std::vector<std::unique_ptr<FileQLogger>> loggers;
+  for (auto& connection : connections) {
+    if (!connection.second->logs.empty()) {
+      loggers.push_back(std::move(connection.second));
+    }
+  }
+  return loggers;
+}
+
+} // namespace quic
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/logging/FileQLogger.h>
+
+namespace quic {
+
+/**
+ * Rebuilds the connections logged to a BinaryQLogRing file from its contents.
+ * Each comes back as a FileQLogger holding its events in the order they were
+ * logged, whose toDynamic() is the JSON a FileQLogger would have written for
+ * the connection. Connections whose start was overwritten in the ring, or
+ * which have no events left in it, are left out, and so are malformed
+ * records.
+ */
+std::vector<std::unique_ptr<FileQLogger>> convertBinaryQLog(
+    folly::ByteRange contents);
+
+} // namespace quic
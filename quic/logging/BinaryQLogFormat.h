@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Layout of the files written by BinaryQLogger.
+ *
+ * A file is a BinaryQLogFileHeader followed by numBlocks blocks of blockSize
+ * bytes, all in host byte order. Each block starts with a
+ * BinaryQLogBlockHeader and holds whole records, each a varint length
+ * followed by that many bytes: the varint connection, the varint
+ * BinaryQLogRecordType, the varint time since the connection's reference time
+ * in microseconds, and the fields of the record. Blocks are reused oldest
+ * first once the file is full, so it always holds the latest events.
+ *
+ * Varints are little endian base 128.
+ */
+
+namespace quic {
+
+constexpr uint32_t kBinaryQLogMagic = 0x474f4c51; // "QLOG"
+constexpr uint32_t kBinaryQLogFormatVersion = 1;
+
+struct BinaryQLogFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t blockSize;
+  uint32_t numBlocks;
+};
+
+struct BinaryQLogBlockHeader {
+  // Order the block was filled in, starting at 1. 0 for a block never used.
+  uint64_t sequence;
+  // Bytes of records after the header.
+  uint32_t usedBytes;
+  uint32_t reserved;
+};
+
+enum class BinaryQLogRecordType : uint8_t {
+  // vantage point, protocol type
+  ConnectionStart,
+  // connection id bytes
+  Dcid,
+  Scid,
+  // packet type, packet number, packet size, frames up to the end
+  PacketReceived,
+  PacketSent,
+  // packet size, versions up to the end
+  VersionNegotiationReceived,
+  VersionNegotiationSent,
+  ConnectionClose,
+  TransportSummary,
+  CongestionMetricUpdate,
+  BandwidthEstUpdate,
+  AppLimitedUpdate,
+  AppUnlimitedUpdate,
+  PacingMetricUpdate,
+  PacingObservation,
+  AppIdleUpdate,
+  PacketDrop,
+  DatagramReceived,
+  LossAlarm,
+  PacketsLost,
+  TransportStateUpdate,
+  PacketBuffered,
+  MetricUpdate,
+  StreamStateUpdate,
+  ConnectionMigration,
+  PathValidation,
+  WriteLoopEnd,
+};
+
+// One for each of the frame logs in QLoggerTypes.h.
+enum class BinaryQLogFrameType : uint8_t {
+  Padding,
+  RstStream,
+  ConnectionClose,
+  MaxData,
+  MaxStreamData,
+  MaxStreams,
+  StreamsBlocked,
+  Ping,
+  DataBlocked,
+  StreamDataBlocked,
+  Ack,
+  Stream,
+  Crypto,
+  StopSending,
+  MinStreamData,
+  ExpiredStreamData,
+  PathChallenge,
+  PathResponse,
+  NewConnectionId,
+  RetireConnectionId,
+  NewToken,
+  HandshakeDone,
+  AckFrequency,
+  Datagram,
+  Repair,
+};
+
+// Packet type of a long header packet is its LongHeader::Types plus this.
+constexpr uint8_t kBinaryQLogLongHeaderPacketType = 1;
+constexpr uint8_t kBinaryQLogShortHeaderPacketType = 0;
+
+constexpr size_t kBinaryQLogMaxVarintLength = 10;
+
+// Writes value to out, which has room for kBinaryQLogMaxVarintLength bytes,
+// and returns the bytes written.
+inline size_t encodeBinaryQLogVarint(uint64_t value, uint8_t* out) {
+  size_t length = 0;
+  while (value >= 0x80) {
+    out[length++] = static_cast<uint8_t>(value) | 0x80;
+    value >>= 7;
+  }
+  out[length++] = static_cast<uint8_t>(value);
+  return length;
+}
+
+class BinaryQLogEncoder {
+ public:
+  explicit BinaryQLogEncoder(std::vector<uint8_t>& out) : out_(out) {}
+
+  void putVarint(uint64_t value) {
+    uint8_t bytes[kBinaryQLogMaxVarintLength];
+    auto length = encodeBinaryQLogVarint(value, bytes);
+    out_.insert(out_.end(), bytes, bytes + length);
+  }
+
+  void putBool(bool value) {
+    out_.push_back(value ? 1 : 0);
+  }
+
+  void putBytes(folly::ByteRange bytes) {
+    putVarint(bytes.size());
+    out_.insert(out_.end(), bytes.begin(), bytes.end());
+  }
+
+  void putString(folly::StringPiece str) {
+    putBytes(folly::ByteRange(str));
+  }
+
+ private:
+  std::vector<uint8_t>& out_;
+};
+
+/**
+ * Reads what BinaryQLogEncoder wrote. Reading past the end returns zeroes
+ * and marks the decoder as failed, so a caller only checks once per record.
+ */
+class BinaryQLogDecoder {
+ public:
+  explicit BinaryQLogDecoder(folly::ByteRange in) : in_(in) {}
+
+  uint64_t getVarint() {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      if (in_.empty()) {
+        failed_ = true;
+        return 0;
+      }
+      uint8_t byte = in_.front();
+      in_.pop_front();
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        return value;
+      }
+    }
+    failed_ = true;
+    return 0;
+  }
+
+  bool getBool() {
+    return getVarint() != 0;
+  }
+
+  folly::ByteRange getBytes() {
+    auto length = getVarint();
+    if (length > in_.size()) {
+      failed_ = true;
+      in_.clear();
+      return folly::ByteRange();
+    }
+    auto bytes = in_.subpiece(0, length);
+    in_.advance(length);
+    return bytes;
+  }
+
+  std::string getString() {
+    auto bytes = getBytes();
+    return std::string(
+        reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  }
+
+  bool empty() const {
+    return in_.empty();
+  }
+
+  bool failed() const {
+    return failed_;
+  }
+
+ private:
+  folly::ByteRange in_;
+  bool failed_{false};
+};
+
+} // namespace quic
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/logging/BinaryQLogRing.h>
+
+#include <folly/Exception.h>
+#include <folly/portability/SysMman.h>
+#include <folly/portability/Unistd.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+
+namespace quic {
+
+BinaryQLogRing::BinaryQLogRing(
+    const std::string& path,
+    uint32_t numBlocks,
+    uint32_t blockSize)
+    : file_(path, O_RDWR | O_CREAT | O_TRUNC, 0644),
+      numBlocks_(numBlocks),
+      blockSize_(blockSize) {
+  CHECK_GT(numBlocks_, 0);
+  CHECK_GT(
+      blockSize_, sizeof(BinaryQLogBlockHeader) + kBinaryQLogMaxVarintLength);
+  CHECK_EQ(blockSize_ % alignof(BinaryQLogBlockHeader), 0);
+  mappingLength_ = sizeof(BinaryQLogFileHeader) +
+      static_cast<size_t>(numBlocks_) * blockSize_;
+  folly::checkUnixError(
+      ftruncate(file_.fd(), mappingLength_), "ftruncate failed: ", path);
+  void* mapping = mmap(
+      nullptr,
+      mappingLength_,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED,
+      file_.fd(),
+      0);
+  if (mapping == MAP_FAILED) {
+    folly::throwSystemError("mmap failed: ", path);
+  }
+  mapping_ = static_cast<uint8_t*>(mapping);
+  BinaryQLogFileHeader fileHeader{
+      kBinaryQLogMagic, kBinaryQLogFormatVersion, blockSize_, numBlocks_};
+  memcpy(mapping_, &fileHeader, sizeof(fileHeader));
+  startBlock(0);
+}
+
+BinaryQLogRing::~BinaryQLogRing() {
+  munmap(mapping_, mappingLength_);
+}
+
+BinaryQLogBlockHeader* BinaryQLogRing::blockHeader(uint32_t index) const {
+  return reinterpret_cast<BinaryQLogBlockHeader*>(
+      mapping_ + sizeof(BinaryQLogFileHeader) +
+      static_cast<size_t>(index) * blockSize_);
+}
+
+void BinaryQLogRing::startBlock(uint32_t index) {
+  currentBlock_ = index;
+  auto header = blockHeader(index);
+  header->usedBytes = 0;
+  header->reserved = 0;
+  header->sequence = ++sequence_;
+}
+
+bool BinaryQLogRing::append(folly::ByteRange record) {
+  uint8_t lengthBytes[kBinaryQLogMaxVarintLength];
+  size_t lengthLength = encodeBinaryQLogVarint(record.size(), lengthBytes);
+
+  const size_t capacity = blockSize_ - sizeof(BinaryQLogBlockHeader);
+  size_t total = lengthLength + record.size();
+  if (total > capacity) {
+    return false;
+  }
+  auto header = blockHeader(currentBlock_);
+  if (header->usedBytes + total > capacity) {
+    startBlock((currentBlock_ + 1) % numBlocks_);
+    header = blockHeader(currentBlock_);
+  }
+  uint8_t* out = reinterpret_cast<uint8_t*>(header + 1) + header->usedBytes;
+  memcpy(out, lengthBytes, lengthLength);
+  memcpy(out + lengthLength, record.data(), record.size());
+  // Only count the record once it is all there.
+  header->usedBytes += total;
+  return true;
+}
+
+bool forEachBinaryQLogRecord(
+    folly::ByteRange contents,
+    folly::FunctionRef<void(folly::ByteRange)> fn) {
+  BinaryQLogFileHeader fileHeader;
+  if (contents.size() < sizeof(fileHeader)) {
+    return false;
+  }
+  memcpy(&fileHeader, contents.data(), sizeof(fileHeader));
+  if (fileHeader.magic != kBinaryQLogMagic ||
+      fileHeader.version != kBinaryQLogFormatVersion ||
+      fileHeader.blockSize <= sizeof(BinaryQLogBlockHeader) ||
+      contents.size() < sizeof(fileHeader) +
+              static_cast<size_t>(fileHeader.numBlocks) *
+                  fileHeader.blockSize) {
+    return false;
+  }
+  std::vector<std::pair<uint64_t, folly::ByteRange>> blocks;
+  for (uint32_t i = 0; i < fileHeader.numBlocks; ++i) {
+    auto block = contents.subpiece(
+        sizeof(fileHeader) + static_cast<size_t>(i) * fileHeader.blockSize,
+        fileHeader.blockSize);
+    BinaryQLogBlockHeader header;
+    memcpy(&header, block.data(), sizeof(header));
+    if (header.sequence == 0) {
+      continue;
+    }
+    block.advance(sizeof(header));
+    blocks.emplace_back(
+        header.sequence,
+        block.subpiece(0, std::min<size_t>(header.usedBytes, block.size())));
+  }
+  std::sort(blocks.begin(), blocks.end(), [](const auto& a, const auto& b) {
+    return a.first < b.first;
+  });
+  for (auto& block : blocks) {
+    BinaryQLogDecoder decoder(block.second);
+    while (!decoder.empty()) {
+      auto record = decoder.getBytes();
+      if (decoder.failed()) {
+        break;
+      }
+      fn(record);
+    }
+  }
+  return true;
+}
+
+} // namespace quic
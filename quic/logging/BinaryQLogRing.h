@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <folly/Function.h>
+#include <quic/logging/BinaryQLogFormat.h>
+
+namespace quic {
+
+constexpr uint32_t kDefaultBinaryQLogBlockSize = 64 * 1024;
+
+/**
+ * A memory mapped file of BinaryQLogger records, laid out as described in
+ * BinaryQLogFormat.h, shared by the connections of one thread.
+ *
+ * Appending copies the record into the mapping, so the events of a process
+ * that crashes are still in the file. Once every block is used the oldest
+ * one is overwritten. Not thread safe.
+ */
+class BinaryQLogRing {
+ public:
+  /**
+   * Creates the file at path, replacing any file there, and maps it. Throws
+   * std::system_error if the file can't be created or mapped.
+   */
+  BinaryQLogRing(
+      const std::string& path,
+      uint32_t numBlocks,
+      uint32_t blockSize = kDefaultBinaryQLogBlockSize);
+
+  ~BinaryQLogRing();
+
+  BinaryQLogRing(const BinaryQLogRing&) = delete;
+  BinaryQLogRing& operator=(const BinaryQLogRing&) = delete;
+
+  /**
+   * Returns the number a new connection tags its records with.
+   */
+  uint64_t newConnection() {
+    return ++lastConnection_;
+  }
+
+  /**
+   * Appends a record. Returns false and drops it if it doesn't fit in a
+   * block.
+   */
+  bool append(folly::ByteRange record);
+
+ private:
+  BinaryQLogBlockHeader* blockHeader(uint32_t index) const;
+  void startBlock(uint32_t index);
+
+  folly::File file_;
+  uint8_t* mapping_{nullptr};
+  size_t mappingLength_{0};
+  const uint32_t numBlocks_;
+  const uint32_t blockSize_;
+  uint32_t currentBlock_{0};
+  uint64_t sequence_{0};
+  uint64_t lastConnection_{0};
+};
+
+/**
+ * Calls fn with each record of the contents of a ring file, oldest first.
+ * Returns false if the contents are not a ring file; a malformed block ends
+ * its records early.
+ */
+bool forEachBinaryQLogRecord(
+    folly::ByteRange contents,
+    folly::FunctionRef<void(folly::ByteRange)> fn);
+
+} // namespace quic
@@ -0,0 +1,656 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/logging/BinaryQLogger.h>
+
+namespace {
+void putFrameType(
+    quic::BinaryQLogEncoder& enc,
+    quic::BinaryQLogFrameType type) {
+  enc.putVarint(static_cast<uint8_t>(type));
+}
+
+void putErrorCode(
+    quic::BinaryQLogEncoder& enc,
+    const quic::QuicErrorCode& code) {
+  enc.putVarint(static_cast<uint64_t>(code.type()));
+  switch (code.type()) {
+    case quic::QuicErrorCode::Type::ApplicationErrorCode_E:
+      enc.putVarint(*code.asApplicationErrorCode());
+      break;
+    case quic::QuicErrorCode::Type::LocalErrorCode_E:
+      enc.putVarint(static_cast<uint64_t>(*code.asLocalErrorCode()));
+      break;
+    case quic::QuicErrorCode::Type::TransportErrorCode_E:
+      enc.putVarint(static_cast<uint64_t>(*code.asTransportErrorCode()));
+      break;
+  }
+}
+
+uint8_t packetType(const quic::PacketHeader& header) {
+  const quic::LongHeader* longHeader = header.asLong();
+  if (!longHeader) {
+    return quic::kBinaryQLogShortHeaderPacketType;
+  }
+  return quic::kBinaryQLogLongHeaderPacketType +
+      static_cast<uint8_t>(longHeader->getHeaderType());
+}
+
+void putSimpleFrame(
+    quic::BinaryQLogEncoder& enc,
+    const quic::QuicSimpleFrame& simpleFrame) {
+  using quic::BinaryQLogFrameType;
+  switch (simpleFrame.type()) {
+    case quic::QuicSimpleFrame::Type::PingFrame_E: {
+      putFrameType(enc, BinaryQLogFrameType::Ping);
+      break;
+    }
+    case quic::QuicSimpleFrame::Type::StopSendingFrame_E: {
+      const quic::StopSendingFrame& frame = *simpleFrame.asStopSendingFrame();
+      putFrameType(enc, BinaryQLogFrameType::StopSending);
+      enc.putVarint(frame.streamId);
+      enc.putVarint(frame.errorCode);
+      break;
+    }
+    case quic::QuicSimpleFrame::Type::MinStreamDataFrame_E: {
+      const quic::MinStreamDataFrame& frame =
+          *simpleFrame.asMinStreamDataFrame();
+      putFrameType(enc, BinaryQLogFrameType::MinStreamData);
+      enc.putVarint(frame.streamId);
+      enc.putVarint(frame.maximumData);
+      enc.putVarint(frame.minimumStreamOffset);
+      break;
+    }
+    case quic::QuicSimpleFrame::Type::ExpiredStreamDataFrame_E: {
+      const quic::ExpiredStreamDataFrame& frame =
+          *simpleFrame.asExpiredStreamDataFrame();
+      putFrameType(enc, BinaryQLogFrameType::ExpiredStreamData);
+      enc.putVarint(frame.streamId);
+      enc.putVarint(frame.minimumStreamOffset);
+      break;
+    }
+    case quic::QuicSimpleFrame::Type::PathChallengeFrame_E: {
+      putFrameType(enc, BinaryQLogFrameType::PathChallenge);
+      enc.putVarint(simpleFrame.asPathChallengeFrame()->pathData);
+      break;
+    }
+    case quic::QuicSimpleFrame::Type::PathResponseFrame_E: {
+      putFrameType(enc, BinaryQLogFrameType::PathResponse);
+      enc.putVarint(simpleFrame.asPathResponseFrame()->pathData);
+      break;
+    }
+    case quic::QuicSimpleFrame::Type::NewConnectionIdFrame_E: {
+      const quic::NewConnectionIdFrame& frame =
+          *simpleFrame.asNewConnectionIdFrame();
+      putFrameType(enc, BinaryQLogFrameType::NewConnectionId);
+      enc.putVarint(frame.sequenceNumber);
+      enc.putBytes(folly::ByteRange(frame.token.data(), frame.token.size()));
+      break;
+    }
+    case quic::QuicSimpleFrame::Type::MaxStreamsFrame_E: {
+      const quic::MaxStreamsFrame& frame = *simpleFrame.asMaxStreamsFrame();
+      putFrameType(enc, BinaryQLogFrameType::MaxStreams);
+      enc.putVarint(frame.maxStreams);
+      enc.putBool(frame.isForBidirectional);
+      break;
+    }
+    case quic::QuicSimpleFrame::Type::RetireConnectionIdFrame_E: {
+      putFrameType(enc, BinaryQLogFrameType::RetireConnectionId);
+      enc.putVarint(simpleFrame.asRetireConnectionIdFrame()->sequenceNumber);
+      break;
+    }
+    case quic::QuicSimpleFrame::Type::HandshakeDoneFrame_E: {
+      putFrameType(enc, BinaryQLogFrameType::HandshakeDone);
+      break;
+    }
+    case quic::QuicSimpleFrame::Type::AckFrequencyFrame_E: {
+      const quic::AckFrequencyFrame& frame = *simpleFrame.asAckFrequencyFrame();
+      putFrameType(enc, BinaryQLogFrameType::AckFrequency);
+      enc.putVarint(frame.sequenceNumber);
+      enc.putVarint(frame.packetTolerance);
+      enc.putVarint(frame.updateMaxAckDelay.count());
+      enc.putBool(frame.ignoreOrder);
+      break;
+    }
+    case quic::QuicSimpleFrame::Type::RepairFrame_E: {
+      const quic::RepairFrame& frame = *simpleFrame.asRepairFrame();
+      putFrameType(enc, BinaryQLogFrameType::Repair);
+      enc.putVarint(frame.firstPacketNum);
+      enc.putVarint(frame.packetMask);
+      break;
+    }
+  }
+}
+
+// The frames both kinds of packets have in common.
+template <typename Frame>
+bool putCommonFrame(quic::BinaryQLogEncoder& enc, const Frame& quicFrame) {
+  using quic::BinaryQLogFrameType;
+  using Type = typename Frame::Type;
+  switch (quicFrame.type()) {
+    case Type::RstStreamFrame_E: {
+      const auto& frame = *quicFrame.asRstStreamFrame();
+      putFrameType(enc, BinaryQLogFrameType::RstStream);
+      enc.putVarint(frame.streamId);
+      enc.putVarint(frame.errorCode);
+      enc.putVarint(frame.offset);
+      return true;
+    }
+    case Type::ConnectionCloseFrame_E: {
+      const auto& frame = *quicFrame.asConnectionCloseFrame();
+      putFrameType(enc, BinaryQLogFrameType::ConnectionClose);
+      putErrorCode(enc, frame.errorCode);
+      enc.putString(frame.reasonPhrase);
+      enc.putVarint(static_cast<uint64_t>(frame.closingFrameType));
+      return true;
+    }
+    case Type::MaxDataFrame_E: {
+      putFrameType(enc, BinaryQLogFrameType::MaxData);
+      enc.putVarint(quicFrame.asMaxDataFrame()->maximumData);
+      return true;
+    }
+    case Type::MaxStreamDataFrame_E: {
+      const auto& frame = *quicFrame.asMaxStreamDataFrame();
+      putFrameType(enc, BinaryQLogFrameType::MaxStreamData);
+      enc.putVarint(frame.streamId);
+      enc.putVarint(frame.maximumData);
+      return true;
+    }
+    case Type::DataBlockedFrame_E: {
+      putFrameType(enc, BinaryQLogFrameType::DataBlocked);
+      enc.putVarint(quicFrame.asDataBlockedFrame()->dataLimit);
+      return true;
+    }
+    case Type::StreamDataBlockedFrame_E: {
+      const auto& frame = *quicFrame.asStreamDataBlockedFrame();
+      putFrameType(enc, BinaryQLogFrameType::StreamDataBlocked);
+      enc.putVarint(frame.streamId);
+      enc.putVarint(frame.dataLimit);
+      return true;
+    }
+    case Type::StreamsBlockedFrame_E: {
+      const auto& frame = *quicFrame.asStreamsBlockedFrame();
+      putFrameType(enc, BinaryQLogFrameType::StreamsBlocked);
+      enc.putVarint(frame.streamLimit);
+      enc.putBool(frame.isForBidirectional);
+      return true;
+    }
+    case Type::QuicSimpleFrame_E: {
+      putSimpleFrame(enc, *quicFrame.asQuicSimpleFrame());
+      return true;
+    }
+    case Type::DatagramFrame_E: {
+      putFrameType(enc, BinaryQLogFrameType::Datagram);
+      enc.putVarint(quicFrame.asDatagramFrame()->length);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+} // namespace
+
+namespace quic {
+
+BinaryQLogger::BinaryQLogger(
+    VantagePoint vantagePointIn,
+    std::shared_ptr<BinaryQLogRing> ring,
+    std::string protocolTypeIn)
+    : QLogger(vantagePointIn, std::move(protocolTypeIn)),
+      ring_(std::move(ring)),
+      connection_(ring_->newConnection()) {
+  auto enc = startRecord(BinaryQLogRecordType::ConnectionStart);
+  enc.putVarint(static_cast<uint64_t>(vantagePoint));
+  enc.putString(protocolType);
+  finishRecord();
+}
+
+BinaryQLogEncoder BinaryQLogger::startRecord(BinaryQLogRecordType type) {
+  scratch_.clear();
+  BinaryQLogEncoder enc(scratch_);
+  enc.putVarint(connection_);
+  enc.putVarint(static_cast<uint8_t>(type));
+  enc.putVarint(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - refTimePoint)
+                    .count());
+  return enc;
+}
+
+void BinaryQLogger::finishRecord() {
+  if (!ring_->append(folly::range(scratch_))) {
+    VLOG(4) << "Dropping oversized qlog record of " << scratch_.size()
+            << " bytes";
+  }
+}
+
+void BinaryQLogger::setDcid(folly::Optional<ConnectionId> connID) {
+  if (connID.hasValue()) {
+    dcid = connID.value();
+    auto enc = startRecord(BinaryQLogRecordType::Dcid);
+    enc.putBytes(folly::ByteRange(dcid->data(), dcid->size()));
+    finishRecord();
+  }
+}
+
+void BinaryQLogger::setScid(folly::Optional<ConnectionId> connID) {
+  if (connID.hasValue()) {
+    scid = connID.value();
+    auto enc = startRecord(BinaryQLogRecordType::Scid);
+    enc.putBytes(folly::ByteRange(scid->data(), scid->size()));
+    finishRecord();
+  }
+}
+
+void BinaryQLogger::addPacket(
+    const RegularQuicPacket& regularPacket,
+    uint64_t packetSize) {
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::PacketReceived);
+  auto type = packetType(regularPacket.header);
+  enc.putVarint(type);
+  // A Retry packet does not include a packet number.
+  enc.putVarint(
+      type ==
+              kBinaryQLogLongHeaderPacketType +
+                  static_cast<uint8_t>(LongHeader::Types::Retry)
+          ? 0
+          : regularPacket.header.getPacketSequenceNum());
+  enc.putVarint(packetSize);
+  uint64_t numPaddingFrames = 0;
+  for (const auto& quicFrame : regularPacket.frames) {
+    if (putCommonFrame(enc, quicFrame)) {
+      continue;
+    }
+    switch (quicFrame.type()) {
+      case QuicFrame::Type::PaddingFrame_E: {
+        ++numPaddingFrames;
+        break;
+      }
+      case QuicFrame::Type::ReadAckFrame_E: {
+        const auto& frame = *quicFrame.asReadAckFrame();
+        putFrameType(enc, BinaryQLogFrameType::Ack);
+        enc.putVarint(frame.ackDelay.count());
+        enc.putVarint(frame.ackBlocks.size());
+        for (const auto& block : frame.ackBlocks) {
+          enc.putVarint(block.startPacket);
+          enc.putVarint(block.endPacket);
+        }
+        break;
+      }
+      case QuicFrame::Type::ReadStreamFrame_E: {
+        const auto& frame = *quicFrame.asReadStreamFrame();
+        putFrameType(enc, BinaryQLogFrameType::Stream);
+        enc.putVarint(frame.streamId);
+        enc.putVarint(frame.offset);
+        enc.putVarint(frame.data->length());
+        enc.putBool(frame.fin);
+        break;
+      }
+      case QuicFrame::Type::ReadCryptoFrame_E: {
+        const auto& frame = *quicFrame.asReadCryptoFrame();
+        putFrameType(enc, BinaryQLogFrameType::Crypto);
+        enc.putVarint(frame.offset);
+        enc.putVarint(frame.data->length());
+        break;
+      }
+      case QuicFrame::Type::ReadNewTokenFrame_E: {
+        putFrameType(enc, BinaryQLogFrameType::NewToken);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  if (numPaddingFrames > 0) {
+    putFrameType(enc, BinaryQLogFrameType::Padding);
+    enc.putVarint(numPaddingFrames);
+  }
+  finishRecord();
+}
+
+void BinaryQLogger::addPacket(
+    const RegularQuicWritePacket& writePacket,
+    uint64_t packetSize) {
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::PacketSent);
+  enc.putVarint(packetType(writePacket.header));
+  enc.putVarint(writePacket.header.getPacketSequenceNum());
+  enc.putVarint(packetSize);
+  uint64_t numPaddingFrames = 0;
+  for (const auto& quicFrame : writePacket.frames) {
+    if (putCommonFrame(enc, quicFrame)) {
+      continue;
+    }
+    switch (quicFrame.type()) {
+      case QuicWriteFrame::Type::PaddingFrame_E: {
+        ++numPaddingFrames;
+        break;
+      }
+      case QuicWriteFrame::Type::WriteAckFrame_E: {
+        const WriteAckFrame& frame = *quicFrame.asWriteAckFrame();
+        putFrameType(enc, BinaryQLogFrameType::Ack);
+        enc.putVarint(frame.ackDelay.count());
+        enc.putVarint(frame.ackBlocks.size());
+        for (const auto& block : frame.ackBlocks) {
+          enc.putVarint(block.start);
+          enc.putVarint(block.end);
+        }
+        break;
+      }
+      case QuicWriteFrame::Type::WriteStreamFrame_E: {
+        const WriteStreamFrame& frame = *quicFrame.asWriteStreamFrame();
+        putFrameType(enc, BinaryQLogFrameType::Stream);
+        enc.putVarint(frame.streamId);
+        enc.putVarint(frame.offset);
+        enc.putVarint(frame.len);
+        enc.putBool(frame.fin);
+        break;
+      }
+      case QuicWriteFrame::Type::WriteCryptoFrame_E: {
+        const WriteCryptoFrame& frame = *quicFrame.asWriteCryptoFrame();
+        putFrameType(enc, BinaryQLogFrameType::Crypto);
+        enc.putVarint(frame.offset);
+        enc.putVarint(frame.len);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  if (numPaddingFrames > 0) {
+    putFrameType(enc, BinaryQLogFrameType::Padding);
+    enc.putVarint(numPaddingFrames);
+  }
+  finishRecord();
+}
+
+void BinaryQLogger::addPacket(
+    const VersionNegotiationPacket& versionPacket,
+    uint64_t packetSize,
+    bool isPacketRecvd) {
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
+  auto enc = startRecord(
+      isPacketRecvd ? BinaryQLogRecordType::VersionNegotiationReceived
+                    : BinaryQLogRecordType::VersionNegotiationSent);
+  enc.putVarint(packetSize);
+  for (auto version : versionPacket.versions) {
+    enc.putVarint(static_cast<uint64_t>(version));
+  }
+  finishRecord();
+}
+
+void BinaryQLogger::addConnectionClose(
+    std::string error,
+    std::string reason,
+    bool drainConnection,
+    bool sendCloseImmediately) {
+  if (!shouldLog(QLogEventCategory::Connection)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::ConnectionClose);
+  enc.putString(error);
+  enc.putString(reason);
+  enc.putBool(drainConnection);
+  enc.putBool(sendCloseImmediately);
+  finishRecord();
+}
+
+void BinaryQLogger::addTransportSummary(
+    uint64_t totalBytesSent,
+    uint64_t totalBytesRecvd,
+    uint64_t sumCurWriteOffset,
+    uint64_t sumMaxObservedOffset,
+    uint64_t sumCurStreamBufferLen,
+    uint64_t totalBytesRetransmitted,
+    uint64_t totalStreamBytesCloned,
+    uint64_t totalBytesCloned,
+    uint64_t totalCryptoDataWritten,
+    uint64_t totalCryptoDataRecvd) {
+  if (!shouldLog(QLogEventCategory::Metric)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::TransportSummary);
+  enc.putVarint(totalBytesSent);
+  enc.putVarint(totalBytesRecvd);
+  enc.putVarint(sumCurWriteOffset);
+  enc.putVarint(sumMaxObservedOffset);
+  enc.putVarint(sumCurStreamBufferLen);
+  enc.putVarint(totalBytesRetransmitted);
+  enc.putVarint(totalStreamBytesCloned);
+  enc.putVarint(totalBytesCloned);
+  enc.putVarint(totalCryptoDataWritten);
+  enc.putVarint(totalCryptoDataRecvd);
+  finishRecord();
+}
+
+void BinaryQLogger::addCongestionMetricUpdate(
+    uint64_t bytesInFlight,
+    uint64_t currentCwnd,
+    std::string congestionEvent,
+    std::string state,
+    std::string recoveryState) {
+  if (!shouldLog(QLogEventCategory::Congestion)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::CongestionMetricUpdate);
+  enc.putVarint(bytesInFlight);
+  enc.putVarint(currentCwnd);
+  enc.putString(congestionEvent);
+  enc.putString(state);
+  enc.putString(recoveryState);
+  finishRecord();
+}
+
+void BinaryQLogger::addBandwidthEstUpdate(
+    uint64_t bytes,
+    std::chrono::microseconds interval) {
+  if (!shouldLog(QLogEventCategory::Metric)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::BandwidthEstUpdate);
+  enc.putVarint(bytes);
+  enc.putVarint(interval.count());
+  finishRecord();
+}
+
+void BinaryQLogger::addAppLimitedUpdate() {
+  if (!shouldLog(QLogEventCategory::Congestion)) {
+    return;
+  }
+  startRecord(BinaryQLogRecordType::AppLimitedUpdate);
+  finishRecord();
+}
+
+void BinaryQLogger::addAppUnlimitedUpdate() {
+  if (!shouldLog(QLogEventCategory::Congestion)) {
+    return;
+  }
+  startRecord(BinaryQLogRecordType::AppUnlimitedUpdate);
+  finishRecord();
+}
+
+void BinaryQLogger::addPacingMetricUpdate(
+    uint64_t pacingBurstSizeIn,
+    std::chrono::microseconds pacingIntervalIn) {
+  if (!shouldLog(QLogEventCategory::Congestion)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::PacingMetricUpdate);
+  enc.putVarint(pacingBurstSizeIn);
+  enc.putVarint(pacingIntervalIn.count());
+  finishRecord();
+}
+
+void BinaryQLogger::addPacingObservation(
+    std::string actual,
+    std::string expected,
+    std::string conclusion) {
+  if (!shouldLog(QLogEventCategory::Congestion)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::PacingObservation);
+  enc.putString(actual);
+  enc.putString(expected);
+  enc.putString(conclusion);
+  finishRecord();
+}
+
+void BinaryQLogger::addAppIdleUpdate(std::string idleEvent, bool idle) {
+  if (!shouldLog(QLogEventCategory::Congestion)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::AppIdleUpdate);
+  enc.putString(idleEvent);
+  enc.putBool(idle);
+  finishRecord();
+}
+
+void BinaryQLogger::addPacketDrop(size_t packetSize, std::string dropReason) {
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::PacketDrop);
+  enc.putVarint(packetSize);
+  enc.putString(dropReason);
+  finishRecord();
+}
+
+void BinaryQLogger::addDatagramReceived(uint64_t dataLen) {
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::DatagramReceived);
+  enc.putVarint(dataLen);
+  finishRecord();
+}
+
+void BinaryQLogger::addLossAlarm(
+    PacketNum largestSent,
+    uint64_t alarmCount,
+    uint64_t outstandingPackets,
+    std::string type) {
+  if (!shouldLog(QLogEventCategory::Recovery)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::LossAlarm);
+  enc.putVarint(largestSent);
+  enc.putVarint(alarmCount);
+  enc.putVarint(outstandingPackets);
+  enc.putString(type);
+  finishRecord();
+}
+
+void BinaryQLogger::addPacketsLost(
+    PacketNum largestLostPacketNum,
+    uint64_t lostBytes,
+    uint64_t lostPackets) {
+  if (!shouldLog(QLogEventCategory::Recovery)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::PacketsLost);
+  enc.putVarint(largestLostPacketNum);
+  enc.putVarint(lostBytes);
+  enc.putVarint(lostPackets);
+  finishRecord();
+}
+
+void BinaryQLogger::addTransportStateUpdate(std::string update) {
+  if (!shouldLog(QLogEventCategory::Connection)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::TransportStateUpdate);
+  enc.putString(update);
+  finishRecord();
+}
+
+void BinaryQLogger::addPacketBuffered(
+    PacketNum packetNum,
+    ProtectionType protectionType,
+    uint64_t packetSize) {
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::PacketBuffered);
+  enc.putVarint(packetNum);
+  enc.putVarint(static_cast<uint64_t>(protectionType));
+  enc.putVarint(packetSize);
+  finishRecord();
+}
+
+void BinaryQLogger::addMetricUpdate(
+    std::chrono::microseconds latestRtt,
+    std::chrono::microseconds mrtt,
+    std::chrono::microseconds srtt,
+    std::chrono::microseconds ackDelay) {
+  if (!shouldLog(QLogEventCategory::Metric)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::MetricUpdate);
+  enc.putVarint(latestRtt.count());
+  enc.putVarint(mrtt.count());
+  enc.putVarint(srtt.count());
+  enc.putVarint(ackDelay.count());
+  finishRecord();
+}
+
+void BinaryQLogger::addStreamStateUpdate(
+    StreamId id,
+    std::string update,
+    folly::Optional<std::chrono::milliseconds> timeSinceStreamCreation) {
+  if (!shouldLog(QLogEventCategory::Stream)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::StreamStateUpdate);
+  enc.putVarint(id);
+  enc.putString(update);
+  enc.putBool(timeSinceStreamCreation.has_value());
+  if (timeSinceStreamCreation) {
+    enc.putVarint(timeSinceStreamCreation->count());
+  }
+  finishRecord();
+}
+
+void BinaryQLogger::addConnectionMigrationUpdate(bool intentionalMigration) {
+  if (!shouldLog(QLogEventCategory::Connection)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::ConnectionMigration);
+  enc.putBool(intentionalMigration);
+  finishRecord();
+}
+
+void BinaryQLogger::addPathValidationEvent(bool success) {
+  if (!shouldLog(QLogEventCategory::Connection)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::PathValidation);
+  enc.putBool(success);
+  finishRecord();
+}
+
+void BinaryQLogger::addWriteLoopEnd(
+    std::string reason,
+    uint64_t packetsWritten,
+    uint64_t batchFlushes) {
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
+  auto enc = startRecord(BinaryQLogRecordType::WriteLoopEnd);
+  enc.putString(reason);
+  enc.putVarint(packetsWritten);
+  enc.putVarint(batchFlushes);
+  finishRecord();
+}
+
+} // namespace quic
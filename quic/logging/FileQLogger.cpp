@@ -9,7 +9,9 @@
 
 #include <fstream>
 
+#include <folly/FileUtil.h>
 #include <folly/json.h>
+#include <quic/logging/QLogFlusher.h>
 
 namespace quic {
 
@@ -27,21 +29,45 @@ void FileQLogger::setScid(folly::Optional<ConnectionId> connID) {
   }
 }
 
-void FileQLogger::setupStream() {
-  // create the output file
-  if (!dcid.hasValue()) {
-    LOG(ERROR) << "Error: No dcid found";
-    return;
+uint64_t FileQLogger::getMemoryUsage() const {
+  // Every event is taken to be a packet event, the most common kind, and
+  // their frames are left out.
+  return logs.capacity() * sizeof(std::unique_ptr<QLogEvent>) +
+      logs.size() * sizeof(QLogPacketEvent);
+}
+
+QLogFileStream::QLogFileStream(
+    std::string outputPath,
+    bool prettyJson,
+    bool asyncWrites)
+    : outputPath_(std::move(outputPath)),
+      prettyJson_(prettyJson),
+      asyncWrites_(asyncWrites) {}
+
+void QLogFileStream::write(folly::StringPiece data) {
+  if (writer_) {
+    writer_->writeMessage(data);
+  } else if (file_) {
+    folly::writeFull(file_.fd(), data.data(), data.size());
   }
+}
+
+void QLogFileStream::start(const folly::dynamic& base) {
+  // create the output file
   endLine_ = prettyJson_ ? "\n" : "";
-  std::string outputPath =
-      folly::to<std::string>(path_, "/", (dcid.value()).hex(), ".qlog");
-  std::ofstream file(outputPath);
-  writer_ = std::make_unique<folly::AsyncFileWriter>(outputPath);
+  if (asyncWrites_) {
+    std::ofstream file(outputPath_);
+    writer_ = std::make_unique<folly::AsyncFileWriter>(outputPath_);
+  } else {
+    try {
+      file_ = folly::File(outputPath_, O_WRONLY | O_CREAT | O_TRUNC);
+    } catch (const std::system_error& ex) {
+      LOG(ERROR) << "Error: Can't open qlog file: " << ex.what();
+    }
+  }
 
   // Create the base json
-  auto qLog = prettyJson_ ? folly::toPrettyJson(toDynamicBase())
-                          : folly::toJson(toDynamicBase());
+  auto qLog = prettyJson_ ? folly::toPrettyJson(base) : folly::toJson(base);
   baseJson_ << qLog;
 
   // start copying from base to outputFile, stop at events
@@ -50,7 +76,7 @@ void FileQLogger::setupStream() {
   while (getline(baseJson_, eventLine_)) {
     pos_ = eventLine_.find(token_);
     if (pos_ == std::string::npos) {
-      writer_->writeMessage(eventLine_ + endLine_);
+      write(eventLine_ + endLine_);
     } else {
       // Found the token
       for (char c : eventLine_) {
@@ -62,95 +88,158 @@ void FileQLogger::setupStream() {
         }
       }
       // write up to and including the token
-      writer_->writeMessage(std::string(&eventLine_[0], pos_ + token_.size()));
+      write(folly::StringPiece(&eventLine_[0], pos_ + token_.size()));
       break;
     }
   }
 }
 
-void FileQLogger::finishStream() {
+void QLogFileStream::writeEvent(const QLogEvent& event) {
+  numEvents_++;
+  startTime_ = (startTime_ == std::chrono::microseconds::zero())
+      ? event.refTime
+      : startTime_;
+  endTime_ = event.refTime;
+  auto eventJson = prettyJson_ ? folly::toPrettyJson(event.toDynamic())
+                               : folly::toJson(event.toDynamic());
+  std::stringstream eventBuffer;
+  std::string line;
+  eventBuffer << eventJson;
+
+  if (numEvents_ > 1) {
+    write(folly::StringPiece(","));
+  }
+
+  // add padding to every line in the event
+  while (getline(eventBuffer, line)) {
+    write(endLine_);
+    write(folly::to<std::string>(basePadding_, eventsPadding_, line));
+  }
+}
+
+void QLogFileStream::finish() {
   // finish copying the line that was stopped on
   std::string unfinishedLine(
       &eventLine_[pos_ + token_.size()],
       eventLine_.size() - pos_ - token_.size() - (prettyJson_ ? 0 : 1));
   if (!prettyJson_) {
-    writer_->writeMessage(unfinishedLine);
+    write(unfinishedLine);
   } else {
     // copy all the remaining lines but the last one
     std::string previousLine = eventsPadding_ + unfinishedLine;
     while (getline(baseJson_, eventLine_)) {
-      writer_->writeMessage(endLine_);
-      writer_->writeMessage(previousLine);
+      write(endLine_);
+      write(previousLine);
       previousLine = eventLine_;
     }
   }
-  writer_->writeMessage(folly::StringPiece(","));
-  writer_->writeMessage(endLine_);
+  write(folly::StringPiece(","));
+  write(endLine_);
 
   // generate and add the summary
-  auto summary = generateSummary(numEvents_, startTime_, endTime_);
+  auto summary = FileQLogger::generateSummary(numEvents_, startTime_, endTime_);
   auto summaryJson =
       prettyJson_ ? folly::toPrettyJson(summary) : folly::toJson(summary);
   std::stringstream summaryBuffer;
   std::string line;
-  writer_->writeMessage(
-      prettyJson_ ? (basePadding_ + "\"summary\" : ") : "\"summary\":");
+  write(prettyJson_ ? (basePadding_ + "\"summary\" : ") : "\"summary\":");
   summaryBuffer << summaryJson;
   std::string summaryPadding = "";
   // add padding to every line in the summary except the first
   while (getline(summaryBuffer, line)) {
-    writer_->writeMessage(
-        folly::to<std::string>(summaryPadding, line, endLine_));
+    write(folly::to<std::string>(summaryPadding, line, endLine_));
     summaryPadding = basePadding_;
   }
-  writer_->writeMessage(folly::StringPiece("}"));
+  write(folly::StringPiece("}"));
+  writer_.reset();
+  file_.close();
 }
 
-void FileQLogger::handleEvent(std::unique_ptr<QLogEvent> event) {
-  if (streaming_) {
-    numEvents_++;
-    startTime_ = (startTime_ == std::chrono::microseconds::zero())
-        ? event->refTime
-        : startTime_;
-    endTime_ = event->refTime;
-    auto eventJson = prettyJson_ ? folly::toPrettyJson(event->toDynamic())
-                                 : folly::toJson(event->toDynamic());
-    std::stringstream eventBuffer;
-    std::string line;
-    eventBuffer << eventJson;
-
-    if (numEvents_ > 1) {
-      writer_->writeMessage(folly::StringPiece(","));
-    }
-
-    // add padding to every line in the event
-    while (getline(eventBuffer, line)) {
-      writer_->writeMessage(endLine_);
-      writer_->writeMessage(
-          folly::to<std::string>(basePadding_, eventsPadding_, line));
-    }
+FileQLogger::FileQLogger(
+    VantagePoint vantagePointIn,
+    std::string protocolTypeIn,
+    std::string path,
+    bool prettyJson,
+    bool streaming,
+    std::shared_ptr<QLogFlusher> flusher)
+    : BaseQLogger(vantagePointIn, std::move(protocolTypeIn)),
+      path_(std::move(path)),
+      prettyJson_(prettyJson),
+      streaming_(streaming),
+      flusher_(std::move(flusher)) {}
+
+FileQLogger::~FileQLogger() {
+  if (!stream_) {
+    return;
+  }
+  if (flusher_) {
+    flusher_->finishStream(std::move(stream_));
+  } else {
+    stream_->finish();
+  }
+}
 
+void FileQLogger::setupStream() {
+  if (!dcid.hasValue()) {
+    LOG(ERROR) << "Error: No dcid found";
+    return;
+  }
+  std::string outputPath =
+      folly::to<std::string>(path_, "/", (dcid.value()).hex(), ".qlog");
+  stream_ = std::make_shared<QLogFileStream>(
+      std::move(outputPath), prettyJson_, !flusher_);
+  if (flusher_) {
+    flusher_->startStream(stream_, toDynamicBase());
   } else {
+    stream_->start(toDynamicBase());
+  }
+}
+
+void FileQLogger::handleEvent(std::unique_ptr<QLogEvent> event) {
+  if (!streaming_) {
     logs.push_back(std::move(event));
+  } else if (flusher_) {
+    if (stream_) {
+      flusher_->writeEvent(stream_, std::move(event));
+    }
+  } else if (stream_) {
+    stream_->writeEvent(*event);
   }
 }
 
 void FileQLogger::addPacket(
     const RegularQuicPacket& regularPacket,
     uint64_t packetSize) {
-  handleEvent(createPacketEvent(regularPacket, packetSize));
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
+  if (getConfig().compactPacketEvents) {
+    handleEvent(createCompactPacketEvent(regularPacket, packetSize));
+  } else {
+    handleEvent(createPacketEvent(regularPacket, packetSize));
+  }
 }
 
 void FileQLogger::addPacket(
     const RegularQuicWritePacket& writePacket,
     uint64_t packetSize) {
-  handleEvent(createPacketEvent(writePacket, packetSize));
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
+  if (getConfig().compactPacketEvents) {
+    handleEvent(createCompactPacketEvent(writePacket, packetSize));
+  } else {
+    handleEvent(createPacketEvent(writePacket, packetSize));
+  }
 }
 
 void FileQLogger::addPacket(
     const VersionNegotiationPacket& versionPacket,
     uint64_t packetSize,
     bool isPacketRecvd) {
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
   handleEvent(createPacketEvent(versionPacket, packetSize, isPacketRecvd));
 }
 
@@ -159,6 +248,9 @@ void FileQLogger::addConnectionClose(
     std::string reason,
     bool drainConnection,
     bool sendCloseImmediately) {
+  if (!shouldLog(QLogEventCategory::Connection)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
   handleEvent(std::make_unique<quic::QLogConnectionCloseEvent>(
@@ -180,6 +272,9 @@ void FileQLogger::addTransportSummary(
     uint64_t totalBytesCloned,
     uint64_t totalCryptoDataWritten,
     uint64_t totalCryptoDataRecvd) {
+  if (!shouldLog(QLogEventCategory::Metric)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
 
@@ -203,6 +298,9 @@ void FileQLogger::addCongestionMetricUpdate(
     std::string congestionEvent,
     std::string state,
     std::string recoveryState) {
+  if (!shouldLog(QLogEventCategory::Congestion)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
 
@@ -218,6 +316,9 @@ void FileQLogger::addCongestionMetricUpdate(
 void FileQLogger::addBandwidthEstUpdate(
     uint64_t bytes,
     std::chrono::microseconds interval) {
+  if (!shouldLog(QLogEventCategory::Metric)) {
+    return;
+  }
   handleEvent(std::make_unique<quic::QLogBandwidthEstUpdateEvent>(
       bytes,
       interval,
@@ -226,6 +327,9 @@ void FileQLogger::addBandwidthEstUpdate(
 }
 
 void FileQLogger::addAppLimitedUpdate() {
+  if (!shouldLog(QLogEventCategory::Congestion)) {
+    return;
+  }
   handleEvent(std::make_unique<quic::QLogAppLimitedUpdateEvent>(
       true,
       std::chrono::duration_cast<std::chrono::microseconds>(
@@ -233,6 +337,9 @@ void FileQLogger::addAppLimitedUpdate() {
 }
 
 void FileQLogger::addAppUnlimitedUpdate() {
+  if (!shouldLog(QLogEventCategory::Congestion)) {
+    return;
+  }
   handleEvent(std::make_unique<quic::QLogAppLimitedUpdateEvent>(
       false,
       std::chrono::duration_cast<std::chrono::microseconds>(
@@ -241,6 +348,9 @@ void FileQLogger::addAppUnlimitedUpdate() {
 void FileQLogger::addPacingMetricUpdate(
     uint64_t pacingBurstSizeIn,
     std::chrono::microseconds pacingIntervalIn) {
+  if (!shouldLog(QLogEventCategory::Congestion)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
 
@@ -252,6 +362,9 @@ void FileQLogger::addPacingObservation(
     std::string actual,
     std::string expect,
     std::string conclusion) {
+  if (!shouldLog(QLogEventCategory::Congestion)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
   handleEvent(std::make_unique<quic::QLogPacingObservationEvent>(
@@ -259,6 +372,9 @@ void FileQLogger::addPacingObservation(
 }
 
 void FileQLogger::addAppIdleUpdate(std::string idleEvent, bool idle) {
+  if (!shouldLog(QLogEventCategory::Congestion)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
 
@@ -267,6 +383,9 @@ void FileQLogger::addAppIdleUpdate(std::string idleEvent, bool idle) {
 }
 
 void FileQLogger::addPacketDrop(size_t packetSize, std::string dropReason) {
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
 
@@ -275,6 +394,9 @@ void FileQLogger::addPacketDrop(size_t packetSize, std::string dropReason) {
 }
 
 void FileQLogger::addDatagramReceived(uint64_t dataLen) {
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
 
@@ -287,6 +409,9 @@ void FileQLogger::addLossAlarm(
     uint64_t alarmCount,
     uint64_t outstandingPackets,
     std::string type) {
+  if (!shouldLog(QLogEventCategory::Recovery)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
 
@@ -298,6 +423,9 @@ void FileQLogger::addPacketsLost(
     PacketNum largestLostPacketNum,
     uint64_t lostBytes,
     uint64_t lostPackets) {
+  if (!shouldLog(QLogEventCategory::Recovery)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
 
@@ -306,6 +434,9 @@ void FileQLogger::addPacketsLost(
 }
 
 void FileQLogger::addTransportStateUpdate(std::string update) {
+  if (!shouldLog(QLogEventCategory::Connection)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
 
@@ -317,6 +448,9 @@ void FileQLogger::addPacketBuffered(
     PacketNum packetNum,
     ProtectionType protectionType,
     uint64_t packetSize) {
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
 
@@ -329,6 +463,9 @@ void FileQLogger::addMetricUpdate(
     std::chrono::microseconds mrtt,
     std::chrono::microseconds srtt,
     std::chrono::microseconds ackDelay) {
+  if (!shouldLog(QLogEventCategory::Metric)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
 
@@ -391,7 +528,7 @@ folly::dynamic FileQLogger::toDynamicBase() const {
 folly::dynamic FileQLogger::generateSummary(
     size_t numEvents,
     std::chrono::microseconds startTime,
-    std::chrono::microseconds endTime) const {
+    std::chrono::microseconds endTime) {
   folly::dynamic summaryObj = folly::dynamic::object;
   summaryObj[kQLogTraceCountField] =
       1; // hardcoded, we only support 1 trace right now
@@ -410,6 +547,9 @@ void FileQLogger::addStreamStateUpdate(
     quic::StreamId id,
     std::string update,
     folly::Optional<std::chrono::milliseconds> timeSinceStreamCreation) {
+  if (!shouldLog(QLogEventCategory::Stream)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
 
@@ -422,6 +562,9 @@ void FileQLogger::addStreamStateUpdate(
 }
 
 void FileQLogger::addConnectionMigrationUpdate(bool intentionalMigration) {
+  if (!shouldLog(QLogEventCategory::Connection)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
   handleEvent(std::make_unique<quic::QLogConnectionMigrationEvent>(
@@ -429,12 +572,28 @@ void FileQLogger::addConnectionMigrationUpdate(bool intentionalMigration) {
 }
 
 void FileQLogger::addPathValidationEvent(bool success) {
+  if (!shouldLog(QLogEventCategory::Connection)) {
+    return;
+  }
   auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
       std::chrono::steady_clock::now() - refTimePoint);
   handleEvent(std::make_unique<quic::QLogPathValidationEvent>(
       success, vantagePoint, refTime));
 }
 
+void FileQLogger::addWriteLoopEnd(
+    std::string reason,
+    uint64_t packetsWritten,
+    uint64_t batchFlushes) {
+  if (!shouldLog(QLogEventCategory::Packet)) {
+    return;
+  }
+  auto refTime = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - refTimePoint);
+  handleEvent(std::make_unique<quic::QLogWriteLoopEndEvent>(
+      std::move(reason), packetsWritten, batchFlushes, refTime));
+}
+
 void FileQLogger::outputLogsToFile(const std::string& path, bool prettyJson) {
   if (streaming_) {
     return;
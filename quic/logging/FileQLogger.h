@@ -9,6 +9,7 @@
 #pragma once
 #include <fstream>
 
+#include <folly/File.h>
 #include <folly/dynamic.h>
 #include <folly/logging/AsyncFileWriter.h>
 #include <quic/codec/Types.h>
@@ -18,25 +19,63 @@
 
 namespace quic {
 
+class QLogFlusher;
+
+/**
+ * The file a streaming FileQLogger writes to, and where in the JSON around
+ * them the events go. It is only used by one thread at a time: the
+ * transport's, or the QLogFlusher's if the logger has one.
+ */
+class QLogFileStream {
+ public:
+  /**
+   * With asyncWrites the file is written by a folly::AsyncFileWriter,
+   * otherwise directly by the calling thread.
+   */
+  QLogFileStream(std::string outputPath, bool prettyJson, bool asyncWrites);
+
+  void start(const folly::dynamic& base);
+  void writeEvent(const QLogEvent& event);
+  void finish();
+
+ private:
+  void write(folly::StringPiece data);
+
+  std::string outputPath_;
+  bool prettyJson_;
+  bool asyncWrites_;
+  std::unique_ptr<folly::AsyncFileWriter> writer_;
+  folly::File file_;
+
+  std::string basePadding_ = "  ";
+  std::string eventsPadding_ = "";
+  std::string eventLine_;
+  std::string token_;
+  std::string endLine_;
+  std::stringstream baseJson_;
+  size_t pos_{0};
+
+  int numEvents_ = 0;
+  std::chrono::microseconds startTime_ = std::chrono::microseconds::zero();
+  std::chrono::microseconds endTime_;
+};
+
 class FileQLogger : public BaseQLogger {
  public:
   std::vector<std::unique_ptr<QLogEvent>> logs;
+  /**
+   * A streaming logger given a flusher hands its events to the flusher's
+   * thread, which serializes and writes them.
+   */
   FileQLogger(
       VantagePoint vantagePointIn,
       std::string protocolTypeIn = kHTTP3ProtocolType,
       std::string path = "",
       bool prettyJson = true,
-      bool streaming = false)
-      : BaseQLogger(vantagePointIn, std::move(protocolTypeIn)),
-        path_(std::move(path)),
-        prettyJson_(prettyJson),
-        streaming_(streaming) {}
-
-  ~FileQLogger() override {
-    if (streaming_ && dcid.hasValue()) {
-      finishStream();
-    }
-  }
+      bool streaming = false,
+      std::shared_ptr<QLogFlusher> flusher = nullptr);
+
+  ~FileQLogger() override;
   void addPacket(const RegularQuicPacket& regularPacket, uint64_t packetSize)
       override;
   void addPacket(
@@ -107,39 +146,33 @@ class FileQLogger : public BaseQLogger {
       override;
   virtual void addConnectionMigrationUpdate(bool intentionalMigration) override;
   virtual void addPathValidationEvent(bool success) override;
+  void addWriteLoopEnd(
+      std::string reason,
+      uint64_t packetsWritten,
+      uint64_t batchFlushes) override;
 
   void outputLogsToFile(const std::string& path, bool prettyJson);
   folly::dynamic toDynamic() const;
   folly::dynamic toDynamicBase() const;
-  folly::dynamic generateSummary(
+  static folly::dynamic generateSummary(
       size_t numEvents,
       std::chrono::microseconds startTime,
-      std::chrono::microseconds endTime) const;
+      std::chrono::microseconds endTime);
 
   void setDcid(folly::Optional<ConnectionId> connID) override;
   void setScid(folly::Optional<ConnectionId> connID) override;
 
+  uint64_t getMemoryUsage() const override;
+
  private:
   void setupStream();
-  void finishStream();
   void handleEvent(std::unique_ptr<QLogEvent> event);
 
-  std::unique_ptr<folly::AsyncFileWriter> writer_;
-
   std::string path_;
-  std::string basePadding_ = "  ";
-  std::string eventsPadding_ = "";
-  std::string eventLine_;
-  std::string token_;
-  std::string endLine_;
-  std::stringstream baseJson_;
-
   bool prettyJson_;
   bool streaming_;
-  int numEvents_ = 0;
-  std::chrono::microseconds startTime_ = std::chrono::microseconds::zero();
-  std::chrono::microseconds endTime_;
-
-  size_t pos_;
+  std::shared_ptr<QLogFlusher> flusher_;
+  // Set once streaming has started.
+  std::shared_ptr<QLogFileStream> stream_;
 };
 } // namespace quic
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace quic {
+
+/**
+ * Groups of qlog events which can be logged or left out together.
+ */
+enum class QLogEventCategory : uint32_t {
+  // Packets sent, received, buffered and dropped.
+  Packet = 1 << 0,
+  // RTT samples, bandwidth estimates and transport summaries.
+  Metric = 1 << 1,
+  // Congestion controller, pacer and app limited updates.
+  Congestion = 1 << 2,
+  // Loss alarms and lost packets.
+  Recovery = 1 << 3,
+  // Stream state changes.
+  Stream = 1 << 4,
+  // Transport state changes, migration and closes.
+  Connection = 1 << 5,
+};
+
+constexpr uint32_t kQLogAllEvents = 0xffffffff;
+// Enough to follow a connection's congestion control without paying for
+// packet level events.
+constexpr uint32_t kQLogMetricAndCongestionEvents =
+    static_cast<uint32_t>(QLogEventCategory::Metric) |
+    static_cast<uint32_t>(QLogEventCategory::Congestion) |
+    static_cast<uint32_t>(QLogEventCategory::Recovery) |
+    static_cast<uint32_t>(QLogEventCategory::Connection);
+
+struct QLogConfig {
+  // Fraction of connections to attach a QLogger to, see shouldSample().
+  double sampleRate{1.0};
+  // QLogEventCategory bits of the events to log.
+  uint32_t eventMask{kQLogAllEvents};
+  // Log every event from when a connection has this many PTOs in a row.
+  // 0 never does.
+  uint32_t fullLoggingPtoCount{0};
+  // Log every event from when a connection's streams have been head of line
+  // blocked this many times. 0 never does.
+  uint32_t fullLoggingHolbCount{0};
+  // Log packets as a QLogCompactPacketEvent of frame types and stream ranges
+  // rather than one allocated log per frame.
+  bool compactPacketEvents{false};
+
+  /**
+   * Whether a new connection is one of the sampleRate that get logged.
+   */
+  bool shouldSample() const;
+};
+
+} // namespace quic
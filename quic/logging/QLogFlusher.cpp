@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/logging/QLogFlusher.h>
+
+#include <folly/system/ThreadName.h>
+
+namespace quic {
+
+QLogFlusher::QLogFlusher(size_t queueCapacity)
+    : queue_(queueCapacity), thread_([this] { run(); }) {}
+
+QLogFlusher::~QLogFlusher() {
+  queue_.blockingWrite(Task());
+  thread_.join();
+}
+
+void QLogFlusher::startStream(
+    std::shared_ptr<QLogFileStream> stream,
+    folly::dynamic base) {
+  Task task;
+  task.type = Task::Type::Start;
+  task.stream = std::move(stream);
+  task.base = std::make_unique<folly::dynamic>(std::move(base));
+  queue_.blockingWrite(std::move(task));
+}
+
+bool QLogFlusher::writeEvent(
+    std::shared_ptr<QLogFileStream> stream,
+    std::unique_ptr<QLogEvent> event) {
+  Task task;
+  task.type = Task::Type::Event;
+  task.stream = std::move(stream);
+  task.event = std::move(event);
+  if (!queue_.write(std::move(task))) {
+    numDroppedEvents_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void QLogFlusher::finishStream(std::shared_ptr<QLogFileStream> stream) {
+  Task task;
+  task.type = Task::Type::Finish;
+  task.stream = std::move(stream);
+  queue_.blockingWrite(std::move(task));
+}
+
+void QLogFlusher::run() {
+  folly::setThreadName("QLogFlusher");
+  while (true) {
+    Task task;
+    queue_.blockingRead(task);
+    switch (task.type) {
+      case Task::Type::Start:
+        task.stream->start(*task.base);
+        break;
+      case Task::Type::Event:
+        task.stream->writeEvent(*task.event);
+        break;
+      case Task::Type::Finish:
+        task.stream->finish();
+        break;
+      case Task::Type::Stop:
+        return;
+    }
+  }
+}
+
+} // namespace quic
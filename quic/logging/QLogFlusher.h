@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/MPMCQueue.h>
+#include <quic/logging/FileQLogger.h>
+
+#include <atomic>
+#include <thread>
+
+namespace quic {
+
+constexpr size_t kDefaultQLogFlusherQueueCapacity = 64 * 1024;
+
+/**
+ * Serializes and writes the events of streaming FileQLoggers on a thread of
+ * its own, so that neither JSON nor the disk holds up the transports.
+ *
+ * Loggers on any number of threads share it through a bounded lock-free
+ * queue. An event which finds the queue full is dropped and counted instead
+ * of waiting. Starting and finishing a stream do wait, so that every file is
+ * still complete JSON.
+ */
+class QLogFlusher {
+ public:
+  explicit QLogFlusher(
+      size_t queueCapacity = kDefaultQLogFlusherQueueCapacity);
+
+  /**
+   * Writes out everything queued before returning.
+   */
+  ~QLogFlusher();
+
+  void startStream(std::shared_ptr<QLogFileStream> stream, folly::dynamic base);
+
+  /**
+   * Returns false if the event was dropped.
+   */
+  bool writeEvent(
+      std::shared_ptr<QLogFileStream> stream,
+      std::unique_ptr<QLogEvent> event);
+
+  void finishStream(std::shared_ptr<QLogFileStream> stream);
+
+  uint64_t getNumDroppedEvents() const {
+    return numDroppedEvents_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Task {
+    enum class Type { Start, Event, Finish, Stop };
+    Type type{Type::Stop};
+    std::shared_ptr<QLogFileStream> stream;
+    std::unique_ptr<QLogEvent> event;
+    std::unique_ptr<folly::dynamic> base;
+  };
+
+  void run();
+
+  folly::MPMCQueue<Task> queue_;
+  std::atomic<uint64_t> numDroppedEvents_{0};
+  std::thread thread_;
+};
+
+} // namespace quic
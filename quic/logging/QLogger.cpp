@@ -8,10 +8,35 @@
 
 #include <quic/logging/QLogger.h>
 
+#include <folly/Random.h>
 #include <quic/codec/Types.h>
 
 namespace quic {
 
+bool QLogConfig::shouldSample() const {
+  return sampleRate >= 1.0 || folly::Random::randDouble01() < sampleRate;
+}
+
+void QLogger::setConfig(const QLogConfig& config) {
+  config_ = config;
+  eventMask_ = config.eventMask;
+}
+
+void QLogger::onPtoCount(uint32_t ptoCount) {
+  if (config_.fullLoggingPtoCount > 0 &&
+      ptoCount >= config_.fullLoggingPtoCount) {
+    eventMask_ = kQLogAllEvents;
+  }
+}
+
+void QLogger::onHolBlocked() {
+  ++holbCount_;
+  if (config_.fullLoggingHolbCount > 0 &&
+      holbCount_ >= config_.fullLoggingHolbCount) {
+    eventMask_ = kQLogAllEvents;
+  }
+}
+
 std::string getFlowControlEvent(int offset) {
   return "flow control event, new offset: " + folly::to<std::string>(offset);
 };
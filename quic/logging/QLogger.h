@@ -10,6 +10,7 @@
 
 #include <quic/codec/QuicConnectionId.h>
 #include <quic/codec/Types.h>
+#include <quic/logging/QLogConfig.h>
 #include <quic/logging/QLoggerConstants.h>
 
 namespace quic {
@@ -108,8 +109,47 @@ class QLogger {
       folly::Optional<std::chrono::milliseconds> timeSinceStreamCreation) = 0;
   virtual void addConnectionMigrationUpdate(bool intentionalMigration) = 0;
   virtual void addPathValidationEvent(bool success) = 0;
+  virtual void addWriteLoopEnd(
+      std::string reason,
+      uint64_t packetsWritten,
+      uint64_t batchFlushes) = 0;
   virtual void setDcid(folly::Optional<ConnectionId> connID) = 0;
   virtual void setScid(folly::Optional<ConnectionId> connID) = 0;
+
+  /**
+   * Roughly how many bytes the events held in memory take, for the memory
+   * accounting of the connection. Loggers that don't hold events return 0.
+   */
+  virtual uint64_t getMemoryUsage() const {
+    return 0;
+  }
+
+  /**
+   * Whether events of the category are logged. Implementations check it
+   * before building an event.
+   */
+  bool shouldLog(QLogEventCategory category) const {
+    return eventMask_ & static_cast<uint32_t>(category);
+  }
+
+  const QLogConfig& getConfig() const {
+    return config_;
+  }
+
+  void setConfig(const QLogConfig& config);
+
+  /**
+   * Tell the logger about the connection's count of PTOs in a row and about
+   * a stream becoming head of line blocked, which can turn on every event as
+   * set by the config.
+   */
+  void onPtoCount(uint32_t ptoCount);
+  void onHolBlocked();
+
+ private:
+  QLogConfig config_;
+  uint32_t eventMask_{kQLogAllEvents};
+  uint32_t holbCount_{0};
 };
 
 std::string getFlowControlEvent(int offset);
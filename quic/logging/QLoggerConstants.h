@@ -33,7 +33,12 @@ constexpr auto kPacketAckedInRecovery = "packet acked in recovery";
 constexpr auto kCopaInit = "copa init";
 constexpr auto kCongestionPacketSent = "congestion on packet sent";
 constexpr auto kCopaCheckAndUpdateDirection = "copa check and update direction";
+constexpr auto kCopaModeSwitch = "copa mode switch";
+constexpr auto kCopaDefaultMode = "default";
+constexpr auto kCopaCompetitiveMode = "competitive";
 constexpr auto kCongestionPacketLoss = "congestion packet loss";
+constexpr auto kCongestionPacketsCeMarked = "congestion packets ce marked";
+constexpr auto kCongestionLossUndo = "congestion loss undo";
 constexpr auto kAppLimited = "app limited";
 constexpr auto kAppUnlimited = "app unlimited";
 constexpr uint64_t kDefaultCwnd = 12320;
@@ -49,6 +54,7 @@ constexpr auto kUnexpectedProtectionLevel = "unexpected protection level";
 constexpr auto kBufferUnavailable = "buffer unavailable";
 constexpr auto kReset = "reset";
 constexpr auto kRetry = "retry";
+constexpr auto kDuplicate = "duplicate";
 constexpr auto kPtoAlarm = "pto alarm";
 constexpr auto kHandshakeAlarm = "handshake alarm";
 constexpr auto kLossTimeoutExpired = "loss timeout expired";
@@ -58,6 +64,7 @@ constexpr auto kTransportReady = "transport ready";
 constexpr auto kDerivedZeroRttReadCipher = "derived 0-rtt read cipher";
 constexpr auto kDerivedOneRttReadCipher = "derived 1-rtt read cipher";
 constexpr auto kDerivedOneRttWriteCipher = "derived 1-rtt write cipher";
+constexpr auto kOneRttKeyUpdate = "1-rtt key update";
 constexpr auto kZeroRttRejected = "zerortt rejected";
 constexpr auto kZeroRttAccepted = "zerortt accepted";
 constexpr auto kZeroRttAttempted = "zerortt attempted";
@@ -225,6 +225,31 @@ folly::dynamic HandshakeDoneFrameLog::toDynamic() const {
   return d;
 }
 
+folly::dynamic AckFrequencyFrameLog::toDynamic() const {
+  folly::dynamic d = folly::dynamic::object();
+  d["frame_type"] = toString(FrameType::ACK_FREQUENCY);
+  d["sequence"] = sequence;
+  d["packet_tolerance"] = packetTolerance;
+  d["update_max_ack_delay"] = updateMaxAckDelay.count();
+  d["ignore_order"] = ignoreOrder;
+  return d;
+}
+
+folly::dynamic RepairFrameLog::toDynamic() const {
+  folly::dynamic d = folly::dynamic::object();
+  d["frame_type"] = toString(FrameType::FEC_REPAIR);
+  d["first_packet_number"] = firstPacketNum;
+  d["packet_mask"] = packetMask;
+  return d;
+}
+
+folly::dynamic DatagramFrameLog::toDynamic() const {
+  folly::dynamic d = folly::dynamic::object();
+  d["frame_type"] = toString(FrameType::DATAGRAM);
+  d["length"] = length;
+  return d;
+}
+
 folly::dynamic VersionNegotiationLog::toDynamic() const {
   folly::dynamic d = folly::dynamic::object();
   d = folly::dynamic::array();
@@ -261,6 +286,123 @@ folly::dynamic QLogPacketEvent::toDynamic() const {
   return d;
 }
 
+namespace {
+// Every frame type a compact packet event can record, in logging order.
+constexpr FrameType kCompactFrameTypes[] = {
+    FrameType::PING,
+    FrameType::ACK,
+    FrameType::ACK_ECN,
+    FrameType::RST_STREAM,
+    FrameType::STOP_SENDING,
+    FrameType::CRYPTO_FRAME,
+    FrameType::NEW_TOKEN,
+    FrameType::MAX_DATA,
+    FrameType::MAX_STREAM_DATA,
+    FrameType::MAX_STREAMS_BIDI,
+    FrameType::MAX_STREAMS_UNI,
+    FrameType::DATA_BLOCKED,
+    FrameType::STREAM_DATA_BLOCKED,
+    FrameType::STREAMS_BLOCKED_BIDI,
+    FrameType::STREAMS_BLOCKED_UNI,
+    FrameType::NEW_CONNECTION_ID,
+    FrameType::RETIRE_CONNECTION_ID,
+    FrameType::PATH_CHALLENGE,
+    FrameType::PATH_RESPONSE,
+    FrameType::CONNECTION_CLOSE,
+    FrameType::CONNECTION_CLOSE_APP_ERR,
+    FrameType::HANDSHAKE_DONE,
+    FrameType::DATAGRAM,
+    FrameType::ACK_FREQUENCY,
+    FrameType::MIN_STREAM_DATA,
+    FrameType::EXPIRED_STREAM_DATA,
+    FrameType::FEC_REPAIR,
+};
+
+uint64_t compactFrameTypeBit(FrameType frameType) {
+  auto value = static_cast<uint8_t>(frameType);
+  if (value >= static_cast<uint8_t>(FrameType::STREAM) &&
+      value <= static_cast<uint8_t>(FrameType::STREAM_OFF_LEN_FIN)) {
+    value = static_cast<uint8_t>(FrameType::STREAM);
+  }
+  // The wire values of the extension frames are past 63.
+  switch (frameType) {
+    case FrameType::FEC_REPAIR:
+      return 1ULL << 60;
+    case FrameType::ACK_FREQUENCY:
+      return 1ULL << 61;
+    case FrameType::MIN_STREAM_DATA:
+      return 1ULL << 62;
+    case FrameType::EXPIRED_STREAM_DATA:
+      return 1ULL << 63;
+    default:
+      return 1ULL << value;
+  }
+}
+} // namespace
+
+void QLogCompactPacketEvent::addFrameType(FrameType frameType) {
+  frameTypes |= compactFrameTypeBit(frameType);
+}
+
+bool QLogCompactPacketEvent::hasFrameType(FrameType frameType) const {
+  return frameTypes & compactFrameTypeBit(frameType);
+}
+
+void QLogCompactPacketEvent::addStreamRange(
+    StreamId streamId,
+    uint64_t offset,
+    uint64_t len,
+    bool fin) {
+  addFrameType(FrameType::STREAM);
+  if (numStreamFrames < kMaxStreamRanges) {
+    streamRanges[numStreamFrames] = {streamId, offset, len, fin};
+  }
+  ++numStreamFrames;
+}
+
+folly::dynamic QLogCompactPacketEvent::toDynamic() const {
+  folly::dynamic d = folly::dynamic::array(
+      folly::to<std::string>(refTime.count()),
+      "TRANSPORT",
+      toString(eventType),
+      "DEFAULT");
+  folly::dynamic data = folly::dynamic::object();
+
+  data["header"] = folly::dynamic::object("packet_size", packetSize);
+  if (packetType != toString(LongHeader::Types::Retry)) {
+    data["header"]["packet_number"] = packetNum;
+    folly::dynamic frames = folly::dynamic::array();
+    for (auto frameType : kCompactFrameTypes) {
+      if (hasFrameType(frameType)) {
+        frames.push_back(
+            folly::dynamic::object("frame_type", toString(frameType)));
+      }
+    }
+    uint64_t numRanges = numStreamFrames < kMaxStreamRanges
+        ? numStreamFrames
+        : kMaxStreamRanges;
+    for (size_t i = 0; i < numRanges; ++i) {
+      const auto& range = streamRanges[i];
+      frames.push_back(StreamFrameLog(
+                           range.streamId, range.offset, range.len, range.fin)
+                           .toDynamic());
+    }
+    if (numStreamFrames > numRanges) {
+      frames.push_back(folly::dynamic::object(
+          "frame_type", toString(FrameType::STREAM))(
+          "omitted", numStreamFrames - numRanges));
+    }
+    if (numPaddingFrames > 0) {
+      frames.push_back(PaddingFrameLog(numPaddingFrames).toDynamic());
+    }
+    data["frames"] = std::move(frames);
+  }
+  data["packet_type"] = packetType;
+
+  d.push_back(std::move(data));
+  return d;
+}
+
 folly::dynamic QLogVersionNegotiationEvent::toDynamic() const {
   // creating a folly::dynamic array to hold the information corresponding to
   // the event fields relative_time, category, event_type, trigger, data
@@ -846,6 +988,34 @@ folly::dynamic QLogPathValidationEvent::toDynamic() const {
   return d;
 }
 
+QLogWriteLoopEndEvent::QLogWriteLoopEndEvent(
+    std::string reasonIn,
+    uint64_t packetsWrittenIn,
+    uint64_t batchFlushesIn,
+    std::chrono::microseconds refTimeIn)
+    : reason{std::move(reasonIn)},
+      packetsWritten{packetsWrittenIn},
+      batchFlushes{batchFlushesIn} {
+  eventType = QLogEventType::WriteLoopEnd;
+  refTime = refTimeIn;
+}
+
+folly::dynamic QLogWriteLoopEndEvent::toDynamic() const {
+  folly::dynamic d = folly::dynamic::array(
+      folly::to<std::string>(refTime.count()),
+      "TRANSPORT",
+      toString(eventType),
+      "DEFAULT");
+  folly::dynamic data = folly::dynamic::object();
+
+  data["reason"] = reason;
+  data["packets_written"] = packetsWritten;
+  data["batch_flushes"] = batchFlushes;
+
+  d.push_back(std::move(data));
+  return d;
+}
+
 std::string toString(QLogEventType type) {
   switch (type) {
     case QLogEventType::PacketSent:
@@ -890,6 +1060,8 @@ std::string toString(QLogEventType type) {
       return "CONNECTION_MIGRATION";
     case QLogEventType::PathValidation:
       return "PATH_VALIDATION";
+    case QLogEventType::WriteLoopEnd:
+      return "WRITE_LOOP_END";
   }
   LOG(WARNING) << "toString has unhandled QLog event type";
   return "UNKNOWN";
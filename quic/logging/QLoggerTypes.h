@@ -11,6 +11,7 @@
 #include <folly/dynamic.h>
 #include <quic/codec/Types.h>
 #include <quic/logging/QLoggerConstants.h>
+#include <array>
 #include <memory>
 #include <string>
 #include <vector>
@@ -287,6 +288,49 @@ class HandshakeDoneFrameLog : public QLogFrame {
   folly::dynamic toDynamic() const override;
 };
 
+class AckFrequencyFrameLog : public QLogFrame {
+ public:
+  uint64_t sequence;
+  uint64_t packetTolerance;
+  std::chrono::microseconds updateMaxAckDelay;
+  bool ignoreOrder;
+
+  AckFrequencyFrameLog(
+      uint64_t sequenceIn,
+      uint64_t packetToleranceIn,
+      std::chrono::microseconds updateMaxAckDelayIn,
+      bool ignoreOrderIn)
+      : sequence(sequenceIn),
+        packetTolerance(packetToleranceIn),
+        updateMaxAckDelay(updateMaxAckDelayIn),
+        ignoreOrder(ignoreOrderIn) {}
+
+  ~AckFrequencyFrameLog() override = default;
+  folly::dynamic toDynamic() const override;
+};
+
+class RepairFrameLog : public QLogFrame {
+ public:
+  uint64_t firstPacketNum;
+  uint64_t packetMask;
+
+  RepairFrameLog(uint64_t firstPacketNumIn, uint64_t packetMaskIn)
+      : firstPacketNum(firstPacketNumIn), packetMask(packetMaskIn) {}
+
+  ~RepairFrameLog() override = default;
+  folly::dynamic toDynamic() const override;
+};
+
+class DatagramFrameLog : public QLogFrame {
+ public:
+  uint64_t length;
+
+  explicit DatagramFrameLog(uint64_t lengthIn) : length(lengthIn) {}
+
+  ~DatagramFrameLog() override = default;
+  folly::dynamic toDynamic() const override;
+};
+
 class VersionNegotiationLog {
  public:
   std::vector<QuicVersion> versions;
@@ -318,7 +362,8 @@ enum class QLogEventType : uint32_t {
   AppLimitedUpdate,
   BandwidthEstUpdate,
   ConnectionMigration,
-  PathValidation
+  PathValidation,
+  WriteLoopEnd
 };
 
 std::string toString(QLogEventType type);
@@ -344,6 +389,42 @@ class QLogPacketEvent : public QLogEvent {
   folly::dynamic toDynamic() const override;
 };
 
+/**
+ * What a packet event records when QLogConfig::compactPacketEvents is set:
+ * one bit per frame type and the ranges of the first few stream frames,
+ * filled in without allocating.
+ */
+class QLogCompactPacketEvent : public QLogEvent {
+ public:
+  struct StreamRange {
+    StreamId streamId{0};
+    uint64_t offset{0};
+    uint64_t len{0};
+    bool fin{false};
+  };
+  static constexpr size_t kMaxStreamRanges = 4;
+
+  QLogCompactPacketEvent() = default;
+  ~QLogCompactPacketEvent() override = default;
+
+  void addFrameType(FrameType frameType);
+  bool hasFrameType(FrameType frameType) const;
+  void
+  addStreamRange(StreamId streamId, uint64_t offset, uint64_t len, bool fin);
+
+  std::string packetType;
+  PacketNum packetNum{0};
+  uint64_t packetSize{0};
+  // One bit per FrameType, with the STREAM variants sharing one.
+  uint64_t frameTypes{0};
+  uint64_t numPaddingFrames{0};
+  // Stream frames past the first kMaxStreamRanges only add to the count.
+  uint64_t numStreamFrames{0};
+  std::array<StreamRange, kMaxStreamRanges> streamRanges;
+
+  folly::dynamic toDynamic() const override;
+};
+
 class QLogVersionNegotiationEvent : public QLogEvent {
  public:
   QLogVersionNegotiationEvent() = default;
@@ -642,6 +723,21 @@ class QLogPathValidationEvent : public QLogEvent {
   VantagePoint vantagePoint_;
 };
 
+class QLogWriteLoopEndEvent : public QLogEvent {
+ public:
+  QLogWriteLoopEndEvent(
+      std::string reason,
+      uint64_t packetsWritten,
+      uint64_t batchFlushes,
+      std::chrono::microseconds refTime);
+  ~QLogWriteLoopEndEvent() override = default;
+  std::string reason;
+  uint64_t packetsWritten;
+  uint64_t batchFlushes;
+
+  folly::dynamic toDynamic() const override;
+};
+
 std::string toString(QLogEventType type);
 
 } // namespace quic
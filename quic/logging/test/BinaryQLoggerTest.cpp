@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/logging/BinaryQLogger.h>
+
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <gtest/gtest.h>
+#include <quic/common/test/TestUtils.h>
+#include <quic/logging/BinaryQLogConverter.h>
+
+using namespace testing;
+
+namespace quic::test {
+
+class BinaryQLoggerTest : public Test {
+ public:
+  std::string ringPath() const {
+    return (dir_.path() / "ring").string();
+  }
+
+  std::string readRing() const {
+    std::string contents;
+    CHECK(folly::readFile(ringPath().c_str(), contents));
+    return contents;
+  }
+
+  std::vector<std::unique_ptr<FileQLogger>> convert() const {
+    auto contents = readRing();
+    return convertBinaryQLog(folly::ByteRange(
+        reinterpret_cast<const uint8_t*>(contents.data()), contents.size()));
+  }
+
+  // Logs the same events to any QLogger.
+  static void logEvents(QLogger& q) {
+    q.setDcid(getTestConnectionId(1));
+    q.setScid(getTestConnectionId(2));
+    q.addPacket(createRegularQuicWritePacket(10, 0, 100, true), 130);
+
+    RegularQuicPacket readPacket(
+        ShortHeader(ProtectionType::KeyPhaseZero, getTestConnectionId(1), 7));
+    ReadAckFrame ackFrame;
+    ackFrame.ackDelay = std::chrono::microseconds(25);
+    ackFrame.ackBlocks.emplace_back(3, 5);
+    ackFrame.ackBlocks.emplace_back(0, 1);
+    readPacket.frames.emplace_back(std::move(ackFrame));
+    readPacket.frames.emplace_back(ConnectionCloseFrame(
+        QuicErrorCode(TransportErrorCode::PROTOCOL_VIOLATION),
+        "bad",
+        FrameType::STREAM));
+    readPacket.frames.emplace_back(PaddingFrame());
+    readPacket.frames.emplace_back(PaddingFrame());
+    q.addPacket(readPacket, 1200);
+
+    VersionNegotiationPacket versionPacket(
+        0, getTestConnectionId(1), getTestConnectionId(2));
+    versionPacket.versions = {QuicVersion::MVFST, QuicVersion::QUIC_DRAFT};
+    q.addPacket(versionPacket, 40, true);
+
+    q.addCongestionMetricUpdate(1000, 2000, "ack", "steady", "none");
+    q.addMetricUpdate(
+        std::chrono::microseconds(100),
+        std::chrono::microseconds(90),
+        std::chrono::microseconds(95),
+        std::chrono::microseconds(5));
+    q.addAppLimitedUpdate();
+    q.addStreamStateUpdate(4, kOnEOM, std::chrono::milliseconds(20));
+    q.addStreamStateUpdate(8, kAbort, folly::none);
+    q.addPacketDrop(99, "too small");
+    q.addConnectionClose("no error", "done", true, false);
+  }
+
+ private:
+  folly::test::TemporaryDirectory dir_;
+};
+
+TEST_F(BinaryQLoggerTest, ConvertsToFileQLoggerJson) {
+  auto ring = std::make_shared<BinaryQLogRing>(ringPath(), 4);
+  BinaryQLogger binaryLogger(VantagePoint::Server, ring, "some-protocol");
+  logEvents(binaryLogger);
+  FileQLogger fileLogger(VantagePoint::Server, "some-protocol");
+  logEvents(fileLogger);
+
+  auto loggers = convert();
+  ASSERT_EQ(loggers.size(), 1);
+  auto& converted = *loggers[0];
+  EXPECT_EQ(converted.vantagePoint, VantagePoint::Server);
+  EXPECT_EQ(converted.protocolType, "some-protocol");
+  EXPECT_EQ(converted.dcid, getTestConnectionId(1));
+  EXPECT_EQ(converted.scid, getTestConnectionId(2));
+  ASSERT_EQ(converted.logs.size(), fileLogger.logs.size());
+  for (size_t i = 0; i < converted.logs.size(); ++i) {
+    auto got = converted.logs[i]->toDynamic();
+    auto expected = fileLogger.logs[i]->toDynamic();
+    // Everything but the time of the event.
+    got[0] = expected[0];
+    EXPECT_EQ(got, expected) << "event " << i;
+  }
+}
+
+TEST_F(BinaryQLoggerTest, ConnectionsShareRing) {
+  auto ring = std::make_shared<BinaryQLogRing>(ringPath(), 4);
+  BinaryQLogger client(VantagePoint::Client, ring);
+  BinaryQLogger server(VantagePoint::Server, ring);
+  client.setDcid(getTestConnectionId(1));
+  server.setDcid(getTestConnectionId(2));
+  client.addTransportStateUpdate("client");
+  server.addTransportStateUpdate("server");
+  client.addDatagramReceived(10);
+
+  auto loggers = convert();
+  ASSERT_EQ(loggers.size(), 2);
+  EXPECT_EQ(loggers[0]->vantagePoint, VantagePoint::Client);
+  EXPECT_EQ(loggers[0]->dcid, getTestConnectionId(1));
+  EXPECT_EQ(loggers[0]->logs.size(), 2);
+  EXPECT_EQ(loggers[1]->vantagePoint, VantagePoint::Server);
+  EXPECT_EQ(loggers[1]->dcid, getTestConnectionId(2));
+  EXPECT_EQ(loggers[1]->logs.size(), 1);
+}
+
+TEST_F(BinaryQLoggerTest, OldestBlockOverwritten) {
+  auto ring = std::make_shared<BinaryQLogRing>(ringPath(), 2, 256);
+  BinaryQLogger oldLogger(VantagePoint::Server, ring);
+  oldLogger.addTransportStateUpdate("old");
+  BinaryQLogger logger(VantagePoint::Server, ring);
+  for (int i = 0; i < 100; ++i) {
+    logger.addDatagramReceived(i);
+  }
+  // The start of the first connection is gone, and so is the start of the
+  // second one, which was in the same block.
+  EXPECT_TRUE(convert().empty());
+
+  BinaryQLogger newLogger(VantagePoint::Server, ring);
+  newLogger.addDatagramReceived(1000);
+  auto loggers = convert();
+  ASSERT_EQ(loggers.size(), 1);
+  ASSERT_EQ(loggers[0]->logs.size(), 1);
+  auto event =
+      dynamic_cast<QLogDatagramReceivedEvent*>(loggers[0]->logs[0].get());
+  ASSERT_NE(event, nullptr);
+  EXPECT_EQ(event->dataLen, 1000);
+}
+
+TEST_F(BinaryQLoggerTest, OversizedRecordDropped) {
+  BinaryQLogRing ring(ringPath(), 2, 256);
+  std::vector<uint8_t> record(1000);
+  EXPECT_FALSE(ring.append(folly::range(record)));
+  record.resize(100);
+  EXPECT_TRUE(ring.append(folly::range(record)));
+}
+
+TEST_F(BinaryQLoggerTest, NotARingFile) {
+  folly::ByteRange contents(folly::StringPiece("not a qlog"));
+  EXPECT_TRUE(convertBinaryQLog(contents).empty());
+  EXPECT_FALSE(
+      forEachBinaryQLogRecord(contents, [](folly::ByteRange) { FAIL(); }));
+}
+
+} // namespace quic::test
@@ -15,6 +15,7 @@
 #include <quic/common/test/TestUtils.h>
 #include <quic/congestion_control/Bbr.h>
 #include <quic/logging/FileQLogger.h>
+#include <quic/logging/QLogFlusher.h>
 #include <chrono>
 
 using namespace testing;
@@ -1409,4 +1410,218 @@ TEST_F(QLoggerTest, NonPrettyStream) {
   EXPECT_EQ((bool)getline(file, s), false);
 }
 
+TEST_F(QLoggerTest, StreamThroughFlusher) {
+  auto dir = boost::filesystem::temp_directory_path().string();
+  auto outputPath = [&](FileQLogger* q) {
+    return folly::to<std::string>(dir, "/", (q->dcid.value()).hex(), ".qlog");
+  };
+  auto parseQLog = [](const std::string& path) {
+    std::ifstream file(path, std::ifstream::in);
+    std::string str(
+        (std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>());
+    folly::dynamic parsed = folly::parseJson(str);
+    for (auto& event : parsed["traces"][0]["events"]) {
+      event[0] = "31"; // hardcode reference time
+    }
+    parsed["traces"][0]["common_fields"]["dcid"] = "";
+    parsed["summary"]["max_duration"] = 0;
+    return parsed;
+  };
+  auto logEvents = [&](FileQLogger* q, uint8_t dcidByte) {
+    q->setDcid(ConnectionId(
+        std::vector<uint8_t>{dcidByte, 0x51, 0x4c, 0x47, 0x46, 0x4c}));
+    q->addPacket(createRegularQuicWritePacket(streamId, offset, len, fin), 10);
+    q->addTransportStateUpdate("update");
+    q->addPacketsLost(10, 100, 1);
+    EXPECT_EQ(q->logs.size(), 0);
+  };
+
+  uint8_t dcidByte = folly::Random::rand32(0, 0xff);
+  auto* inlineLogger = new FileQLogger(
+      VantagePoint::Server,
+      kHTTP3ProtocolType,
+      dir,
+      true /* prettyJson */,
+      true /* streaming */);
+  logEvents(inlineLogger, dcidByte);
+  auto inlinePath = outputPath(inlineLogger);
+  delete inlineLogger;
+
+  auto flusher = std::make_shared<QLogFlusher>();
+  auto* flushedLogger = new FileQLogger(
+      VantagePoint::Server,
+      kHTTP3ProtocolType,
+      dir,
+      true /* prettyJson */,
+      true /* streaming */,
+      flusher);
+  logEvents(flushedLogger, dcidByte + 1);
+  auto flushedPath = outputPath(flushedLogger);
+  delete flushedLogger;
+  EXPECT_EQ(flusher->getNumDroppedEvents(), 0);
+  // Drains the queue.
+  flusher.reset();
+
+  auto parsed = parseQLog(flushedPath);
+  EXPECT_EQ(parseQLog(inlinePath), parsed);
+  EXPECT_EQ(parsed["summary"]["total_event_count"], 3);
+}
+
+TEST_F(QLoggerTest, EventMask) {
+  FileQLogger q(VantagePoint::Client);
+  QLogConfig config;
+  config.eventMask = kQLogMetricAndCongestionEvents;
+  q.setConfig(config);
+  EXPECT_FALSE(q.shouldLog(QLogEventCategory::Packet));
+  EXPECT_TRUE(q.shouldLog(QLogEventCategory::Metric));
+
+  q.addPacket(createRegularQuicWritePacket(streamId, offset, len, fin), 10);
+  q.addPacketDrop(100, "drop");
+  q.addStreamStateUpdate(streamId, kAbort, folly::none);
+  EXPECT_EQ(q.logs.size(), 0);
+  q.addCongestionMetricUpdate(20, 30, kPersistentCongestion);
+  q.addMetricUpdate(10us, 11us, 12us, 13us);
+  ASSERT_EQ(q.logs.size(), 2);
+  EXPECT_EQ(q.logs[0]->eventType, QLogEventType::CongestionMetricUpdate);
+  EXPECT_EQ(q.logs[1]->eventType, QLogEventType::MetricUpdate);
+}
+
+TEST_F(QLoggerTest, PtoTurnsOnFullLogging) {
+  FileQLogger q(VantagePoint::Client);
+  QLogConfig config;
+  config.eventMask = kQLogMetricAndCongestionEvents;
+  config.fullLoggingPtoCount = 3;
+  q.setConfig(config);
+  q.onPtoCount(2);
+  EXPECT_FALSE(q.shouldLog(QLogEventCategory::Packet));
+  q.onPtoCount(3);
+  EXPECT_TRUE(q.shouldLog(QLogEventCategory::Packet));
+  q.addPacket(createRegularQuicWritePacket(streamId, offset, len, fin), 10);
+  EXPECT_EQ(q.logs.size(), 1);
+}
+
+TEST_F(QLoggerTest, HolBlockingTurnsOnFullLogging) {
+  FileQLogger q(VantagePoint::Client);
+  QLogConfig config;
+  config.eventMask = kQLogMetricAndCongestionEvents;
+  config.fullLoggingHolbCount = 2;
+  q.setConfig(config);
+  q.onHolBlocked();
+  EXPECT_FALSE(q.shouldLog(QLogEventCategory::Stream));
+  q.onHolBlocked();
+  EXPECT_TRUE(q.shouldLog(QLogEventCategory::Stream));
+}
+
+TEST_F(QLoggerTest, NoTriggers) {
+  FileQLogger q(VantagePoint::Client);
+  QLogConfig config;
+  config.eventMask = 0;
+  q.setConfig(config);
+  for (int i = 0; i < 100; ++i) {
+    q.onPtoCount(i);
+    q.onHolBlocked();
+  }
+  EXPECT_FALSE(q.shouldLog(QLogEventCategory::Connection));
+}
+
+TEST_F(QLoggerTest, Sampling) {
+  QLogConfig config;
+  EXPECT_TRUE(config.shouldSample());
+  config.sampleRate = 0;
+  EXPECT_FALSE(config.shouldSample());
+}
+
+TEST_F(QLoggerTest, CompactRegularPacketFollyDynamic) {
+  folly::dynamic expected = folly::parseJson(
+      R"([
+       [
+         "0",
+         "TRANSPORT",
+         "PACKET_RECEIVED",
+         "DEFAULT",
+         {
+           "frames": [
+             {
+               "frame_type": "PING"
+             },
+             {
+               "fin": true,
+               "frame_type": "STREAM",
+               "stream_id": "10",
+               "length": 0,
+               "offset": 0
+             },
+             {
+               "frame_type": "PADDING",
+               "num_frames": 2
+             }
+           ],
+           "header": {
+             "packet_number": 1,
+             "packet_size": 10
+           },
+           "packet_type": "1RTT"
+         }
+       ]
+     ])");
+
+  auto headerIn =
+      ShortHeader(ProtectionType::KeyPhaseZero, getTestConnectionId(1), 1);
+  RegularQuicPacket regularQuicPacket(std::move(headerIn));
+  regularQuicPacket.frames.emplace_back(ReadStreamFrame(streamId, offset, fin));
+  regularQuicPacket.frames.emplace_back(QuicSimpleFrame(PingFrame()));
+  regularQuicPacket.frames.emplace_back(PaddingFrame());
+  regularQuicPacket.frames.emplace_back(PaddingFrame());
+
+  FileQLogger q(VantagePoint::Client);
+  QLogConfig config;
+  config.compactPacketEvents = true;
+  q.setConfig(config);
+  q.addPacket(regularQuicPacket, 10);
+
+  folly::dynamic gotDynamic = q.toDynamic();
+  gotDynamic["traces"][0]["events"][0][0] = "0"; // hardcode reference time
+  folly::dynamic gotEvents = gotDynamic["traces"][0]["events"];
+  EXPECT_EQ(expected, gotEvents);
+}
+
+TEST_F(QLoggerTest, CompactWritePacket) {
+  RegularQuicWritePacket packet =
+      createRegularQuicWritePacket(streamId, offset, len, fin);
+  for (size_t i = 1; i <= QLogCompactPacketEvent::kMaxStreamRanges; ++i) {
+    packet.frames.emplace_back(
+        WriteStreamFrame(streamId + i, 100 * i, 10, false));
+  }
+  packet.frames.emplace_back(MaxDataFrame(1000));
+
+  FileQLogger q(VantagePoint::Client);
+  QLogConfig config;
+  config.compactPacketEvents = true;
+  q.setConfig(config);
+  q.addPacket(packet, 10);
+
+  ASSERT_EQ(q.logs.size(), 1);
+  auto event = dynamic_cast<QLogCompactPacketEvent*>(q.logs[0].get());
+  ASSERT_NE(event, nullptr);
+  EXPECT_EQ(event->eventType, QLogEventType::PacketSent);
+  EXPECT_EQ(event->packetSize, 10);
+  EXPECT_TRUE(event->hasFrameType(FrameType::STREAM));
+  EXPECT_TRUE(event->hasFrameType(FrameType::STREAM_OFF_LEN));
+  EXPECT_TRUE(event->hasFrameType(FrameType::MAX_DATA));
+  EXPECT_FALSE(event->hasFrameType(FrameType::ACK));
+  EXPECT_EQ(
+      event->numStreamFrames, QLogCompactPacketEvent::kMaxStreamRanges + 1);
+  EXPECT_EQ(event->streamRanges[0].streamId, streamId);
+  EXPECT_EQ(event->streamRanges[0].fin, fin);
+  EXPECT_EQ(event->streamRanges[1].offset, 100);
+  EXPECT_EQ(event->streamRanges[1].len, 10);
+
+  auto frames = event->toDynamic()[4]["frames"];
+  // MAX_DATA, the kept stream ranges and a count of the rest.
+  ASSERT_EQ(frames.size(), QLogCompactPacketEvent::kMaxStreamRanges + 2);
+  EXPECT_EQ(frames[0]["frame_type"], "MAX_DATA");
+  EXPECT_EQ(frames[frames.size() - 1]["omitted"], 1);
+}
+
 } // namespace quic::test
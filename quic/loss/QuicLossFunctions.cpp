@@ -8,6 +8,7 @@
 
 #include "quic/loss/QuicLossFunctions.h"
 #include "quic/state/QuicStreamFunctions.h"
+#include "quic/state/QuicTracepoints.h"
 
 namespace quic {
 
@@ -19,6 +20,16 @@ std::chrono::microseconds calculatePTO(const QuicConnectionStateBase& conn) {
       conn.lossState.maxAckDelay;
 }
 
+std::chrono::microseconds calculateTailLossProbeTimeout(
+    const QuicConnectionStateBase& conn) {
+  auto timeout = 2 * conn.lossState.srtt;
+  if (conn.outstandingPackets.size() <=
+      conn.outstandingHandshakePacketsCount + 1) {
+    timeout += conn.lossState.maxAckDelay;
+  }
+  return std::max<std::chrono::microseconds>(timeout, kMinTailLossProbeTimeout);
+}
+
 bool isPersistentCongestion(
     const QuicConnectionStateBase& conn,
     TimePoint lostPeriodStart,
@@ -39,10 +50,16 @@ void onPTOAlarm(QuicConnectionStateBase& conn) {
       conn.lossState.largestSent,
       conn.lossState.ptoCount,
       (uint64_t)conn.outstandingPackets.size());
+  QUIC_TRACEPOINT(
+      pto_alarm,
+      conn,
+      conn.lossState.ptoCount,
+      conn.outstandingPackets.size());
   QUIC_STATS(conn.statsCallback, onPTO);
   conn.lossState.ptoCount++;
   conn.lossState.totalPTOCount++;
   if (conn.qLogger) {
+    conn.qLogger->onPtoCount(conn.lossState.ptoCount);
     conn.qLogger->addLossAlarm(
         conn.lossState.largestSent,
         conn.lossState.ptoCount,
@@ -55,11 +72,104 @@ void onPTOAlarm(QuicConnectionStateBase& conn) {
   conn.pendingEvents.numProbePackets = kPacketToSendForPTO;
 }
 
+void recordLostPacket(
+    QuicConnectionStateBase& conn,
+    PacketNum packetNum,
+    PacketNumberSpace pnSpace,
+    PacketNum largestAcked,
+    TimePoint lossTime) {
+  auto& lostPackets = conn.lossState.recentlyLostPackets;
+  if (lostPackets.size() == kMaxRecentlyLostPackets) {
+    lostPackets.pop_front();
+  }
+  lostPackets.push_back({packetNum, pnSpace, largestAcked, lossTime});
+}
+
+void detectSpuriousLoss(
+    QuicConnectionStateBase& conn,
+    PacketNumberSpace pnSpace,
+    const ReadAckFrame& frame,
+    TimePoint ackReceiveTime) {
+  auto& lostPackets = conn.lossState.recentlyLostPackets;
+  // Lost packets are recorded in the order of their loss time.
+  auto trackingDuration = calculatePTO(conn) * kLostPacketTrackingPTOs;
+  while (!lostPackets.empty() &&
+         lostPackets.front().lossTime + trackingDuration < ackReceiveTime) {
+    lostPackets.pop_front();
+  }
+  auto lostPacketIt = lostPackets.begin();
+  while (lostPacketIt != lostPackets.end()) {
+    auto packetNum = lostPacketIt->packetNum;
+    bool acked = lostPacketIt->pnSpace == pnSpace &&
+        std::any_of(
+            frame.ackBlocks.begin(),
+            frame.ackBlocks.end(),
+            [packetNum](const auto& ackBlock) {
+              return ackBlock.startPacket <= packetNum &&
+                  packetNum <= ackBlock.endPacket;
+            });
+    if (!acked) {
+      lostPacketIt++;
+      continue;
+    }
+    VLOG(10) << __func__ << " spurious loss packetNum=" << packetNum
+             << " largestAcked=" << lostPacketIt->largestAcked << " " << conn;
+    QUIC_STATS(conn.statsCallback, onPacketSpuriousLoss);
+    ++conn.lossState.spuriousLossCount;
+    if (conn.transportSettings.adaptiveReordering) {
+      // The packet was reordered that far, and it took longer than the time
+      // threshold to be acked.
+      auto reordering = std::min<PacketNum>(
+          lostPacketIt->largestAcked - packetNum, kMaxReorderingThreshold);
+      conn.lossState.reorderingThreshold = std::max(
+          conn.lossState.reorderingThreshold,
+          static_cast<uint32_t>(reordering));
+      conn.lossState.reorderingWindowSteps = std::min<uint8_t>(
+          conn.lossState.reorderingWindowSteps + 1, kMaxReorderingWindowSteps);
+      conn.lossState.lossEventsSinceReorderingUpdate = 0;
+    }
+    if (conn.congestionController) {
+      conn.congestionController->undoLoss(lostPacketIt->lossTime);
+    }
+    lostPacketIt = lostPackets.erase(lostPacketIt);
+  }
+}
+
+void onLossEventForReordering(QuicConnectionStateBase& conn) {
+  if (!conn.transportSettings.adaptiveReordering) {
+    return;
+  }
+  if (++conn.lossState.lossEventsSinceReorderingUpdate <
+      kReorderingWindowDecayLossEvents) {
+    return;
+  }
+  conn.lossState.lossEventsSinceReorderingUpdate = 0;
+  if (conn.lossState.reorderingWindowSteps > 0) {
+    --conn.lossState.reorderingWindowSteps;
+  }
+  conn.lossState.reorderingThreshold =
+      std::max(kReorderingThreshold, conn.lossState.reorderingThreshold / 2);
+}
+
+void onLossEventForBatchSize(QuicConnectionStateBase& conn) {
+  if (!conn.transportSettings.adaptiveBatchSize || conn.burstTolerance == 0) {
+    return;
+  }
+  conn.burstTolerance = std::max<uint32_t>(1, conn.burstTolerance / 2);
+  conn.burstToleranceUpdateTime = Clock::now();
+}
+
 void markPacketLoss(
     QuicConnectionStateBase& conn,
     RegularQuicWritePacket& packet,
     bool processed,
     PacketNum currentPacketNum) {
+  QUIC_TRACEPOINT(
+      packet_lost,
+      conn,
+      static_cast<uint8_t>(packet.header.getPacketNumberSpace()),
+      currentPacketNum,
+      packet.frames.size());
   for (auto& packetFrame : packet.frames) {
     switch (packetFrame.type()) {
       case QuicWriteFrame::Type::MaxStreamDataFrame_E: {
@@ -29,6 +29,14 @@ WriteDataReason hasNonAckDataToWrite(const QuicConnectionStateBase& conn);
 
 std::chrono::microseconds calculatePTO(const QuicConnectionStateBase& conn);
 
+/**
+ * The first PTO when TransportSettings::tailLossProbe is set: 2 * srtt, plus
+ * the peer's max ack delay when a single packet is in flight since its ack
+ * can be delayed, and no less than kMinTailLossProbeTimeout.
+ */
+std::chrono::microseconds calculateTailLossProbeTimeout(
+    const QuicConnectionStateBase& conn);
+
 /**
  * Whether conn is having persistent congestion.
  *
@@ -60,7 +68,7 @@ inline std::ostream& operator<<(
 }
 
 template <class ClockType = Clock>
-std::pair<std::chrono::milliseconds, LossState::AlarmMethod>
+std::pair<std::chrono::microseconds, LossState::AlarmMethod>
 calculateAlarmDuration(const QuicConnectionStateBase& conn) {
   std::chrono::microseconds alarmDuration;
   folly::Optional<LossState::AlarmMethod> alarmMethod;
@@ -92,17 +100,22 @@ calculateAlarmDuration(const QuicConnectionStateBase& conn) {
     DCHECK_NE(lastSentPacketTime.time_since_epoch().count(), 0);
   } else {
     auto ptoTimeout = calculatePTO(conn);
+    if (conn.transportSettings.tailLossProbe && conn.lossState.ptoCount == 0 &&
+        conn.lossState.srtt != 0us) {
+      ptoTimeout = std::min(ptoTimeout, calculateTailLossProbeTimeout(conn));
+    }
     ptoTimeout *= 1ULL << std::min(conn.lossState.ptoCount, (uint32_t)31);
     alarmDuration = ptoTimeout;
     alarmMethod = LossState::AlarmMethod::PTO;
   }
   TimePoint now = ClockType::now();
-  std::chrono::milliseconds adjustedAlarmDuration{0};
+  std::chrono::microseconds adjustedAlarmDuration{0};
   // The alarm duration is calculated based on the last packet that was sent
-  // rather than the current time.
+  // rather than the current time. The timeout rounds it to the granularity of
+  // its timer.
   if (lastSentPacketTime + alarmDuration > now) {
     adjustedAlarmDuration =
-        std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
             lastSentPacketTime + alarmDuration - now);
   } else {
     auto lastSentPacketNum =
@@ -173,7 +186,7 @@ void setLossDetectionAlarm(QuicConnectionStateBase& conn, Timeout& timeout) {
   auto alarmDuration = calculateAlarmDuration<ClockType>(conn);
   conn.lossState.currentAlarmMethod = alarmDuration.second;
   VLOG(10) << __func__ << " setting transmission"
-           << " alarm=" << alarmDuration.first.count() << "ms"
+           << " alarm=" << alarmDuration.first.count() << "us"
            << " method=" << conn.lossState.currentAlarmMethod
            << " outstanding=" << totalPacketsOutstanding
            << " handshakePackets=" << conn.outstandingHandshakePacketsCount
@@ -182,6 +195,43 @@ void setLossDetectionAlarm(QuicConnectionStateBase& conn, Timeout& timeout) {
   conn.pendingEvents.setLossDetectionAlarm = false;
 }
 
+/**
+ * Remembers a packet declared lost by detectLossPackets, so that an ack that
+ * comes for it later can tell the loss was spurious.
+ */
+void recordLostPacket(
+    QuicConnectionStateBase& conn,
+    PacketNum packetNum,
+    PacketNumberSpace pnSpace,
+    PacketNum largestAcked,
+    TimePoint lossTime);
+
+/**
+ * Finds the recently lost packets of pnSpace that are acked by frame. Each of
+ * them counts as a spurious loss and is given to the congestion controller to
+ * undo. With adaptive reordering, it also widens the reordering thresholds so
+ * that the same reordering isn't taken as loss again.
+ *
+ * Lost packets that are past kLostPacketTrackingPTOs are forgotten.
+ */
+void detectSpuriousLoss(
+    QuicConnectionStateBase& conn,
+    PacketNumberSpace pnSpace,
+    const ReadAckFrame& frame,
+    TimePoint ackReceiveTime);
+
+/**
+ * With adaptive reordering, narrows the reordering thresholds back once
+ * enough loss events go by without a spurious loss.
+ */
+void onLossEventForReordering(QuicConnectionStateBase& conn);
+
+/**
+ * Halves the connection's burst tolerance, as its last bursts were too large
+ * for the path, if TransportSettings::adaptiveBatchSize is set.
+ */
+void onLossEventForBatchSize(QuicConnectionStateBase& conn);
+
 /*
  * This function should be invoked after some event that is possible to
  * trigger loss detection, for example: packets are acked
@@ -194,10 +244,12 @@ folly::Optional<CongestionController::LossEvent> detectLossPackets(
     TimePoint lossTime,
     PacketNumberSpace pnSpace) {
   getLossTime(conn, pnSpace).reset();
+  auto rtt = std::max(conn.lossState.srtt, conn.lossState.lrtt);
   std::chrono::microseconds delayUntilLost =
-      std::max(conn.lossState.srtt, conn.lossState.lrtt) *
-      conn.transportSettings.timeReorderingThreshDividend /
+      rtt * conn.transportSettings.timeReorderingThreshDividend /
       conn.transportSettings.timeReorderingThreshDivisor;
+  delayUntilLost +=
+      rtt * conn.lossState.reorderingWindowSteps / kReorderingWindowStepDivisor;
   VLOG(10) << __func__ << " outstanding=" << conn.outstandingPackets.size()
            << " largestAcked=" << largestAcked
            << " delayUntilLost=" << delayUntilLost.count() << "us"
@@ -226,6 +278,21 @@ folly::Optional<CongestionController::LossEvent> detectLossPackets(
       shouldSetTimer = true;
       break;
     }
+    if (conn.pathMtuState.phase != PathMtuState::Phase::Disabled) {
+      onPathMtuPacketLost(conn, pkt, lossTime);
+    }
+    if (pkt.isPathMtuProbe) {
+      // The probe was likely too large for the path, which says nothing about
+      // congestion. It only leaves the bytes in flight.
+      DCHECK(!pkt.associatedEvent);
+      if (conn.congestionController) {
+        conn.congestionController->onRemoveBytesFromInflight(pkt.encodedSize);
+      }
+      VLOG(10) << __func__ << " lost path mtu probe packetNum="
+               << currentPacketNum << " " << conn;
+      iter = conn.outstandingPackets.erase(iter);
+      continue;
+    }
     lossEvent.addLostPacket(pkt);
     if (pkt.associatedEvent) {
       DCHECK_GT(conn.outstandingClonedPacketsCount, 0);
@@ -236,6 +303,7 @@ folly::Optional<CongestionController::LossEvent> detectLossPackets(
     bool processed = pkt.associatedEvent &&
         !conn.outstandingPacketEvents.count(*pkt.associatedEvent);
     lossVisitor(conn, pkt.packet, processed, currentPacketNum);
+    recordLostPacket(conn, currentPacketNum, pnSpace, largestAcked, lossTime);
     // Remove the PacketEvent from the outstandingPacketEvents set
     if (pkt.associatedEvent) {
       conn.outstandingPacketEvents.erase(*pkt.associatedEvent);
@@ -282,6 +350,8 @@ folly::Optional<CongestionController::LossEvent> detectLossPackets(
         lossEvent.lostPackets);
 
     conn.lossState.rtxCount += lossEvent.lostPackets;
+    onLossEventForReordering(conn);
+    onLossEventForBatchSize(conn);
     if (conn.congestionController) {
       return lossEvent;
     }
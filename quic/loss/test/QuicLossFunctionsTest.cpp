@@ -33,7 +33,7 @@ namespace test {
 class MockLossTimeout {
  public:
   MOCK_METHOD0(cancelLossTimeout, void());
-  MOCK_METHOD1(scheduleLossTimeout, void(std::chrono::milliseconds));
+  MOCK_METHOD1(scheduleLossTimeout, void(std::chrono::microseconds));
   MOCK_METHOD0(isLossTimeoutScheduled, bool());
 };
 
@@ -665,6 +665,138 @@ TEST_F(QuicLossFunctionsTest, TestReorderingThreshold) {
   EXPECT_EQ(packetNum, 6);
 }
 
+TEST_F(QuicLossFunctionsTest, SpuriousLoss) {
+  auto conn = createConn();
+  recordLostPacket(*conn, 1, PacketNumberSpace::AppData, 9, Clock::now());
+  recordLostPacket(*conn, 2, PacketNumberSpace::Handshake, 9, Clock::now());
+  ReadAckFrame ackFrame;
+  ackFrame.largestAcked = 2;
+  ackFrame.ackBlocks.emplace_back(1, 2);
+  EXPECT_CALL(*transportInfoCb_, onPacketSpuriousLoss()).Times(1);
+  detectSpuriousLoss(
+      *conn, PacketNumberSpace::AppData, ackFrame, Clock::now());
+  EXPECT_EQ(1, conn->lossState.spuriousLossCount);
+  ASSERT_EQ(1, conn->lossState.recentlyLostPackets.size());
+  EXPECT_EQ(2, conn->lossState.recentlyLostPackets.front().packetNum);
+  // Without adaptive reordering the thresholds stay put.
+  EXPECT_EQ(kReorderingThreshold, conn->lossState.reorderingThreshold);
+  EXPECT_EQ(0, conn->lossState.reorderingWindowSteps);
+
+  for (PacketNum packetNum = 0; packetNum < kMaxRecentlyLostPackets + 1;
+       packetNum++) {
+    recordLostPacket(
+        *conn, packetNum, PacketNumberSpace::AppData, 100, Clock::now());
+  }
+  EXPECT_EQ(
+      kMaxRecentlyLostPackets, conn->lossState.recentlyLostPackets.size());
+}
+
+TEST_F(QuicLossFunctionsTest, SpuriousLossUndo) {
+  auto conn = createConn();
+  auto mockCongestionController = std::make_unique<MockCongestionController>();
+  auto rawCongestionController = mockCongestionController.get();
+  conn->congestionController = std::move(mockCongestionController);
+  auto lossTime = Clock::now();
+  recordLostPacket(*conn, 1, PacketNumberSpace::AppData, 9, lossTime);
+  recordLostPacket(*conn, 2, PacketNumberSpace::AppData, 9, lossTime + 1s);
+  ReadAckFrame ackFrame;
+  ackFrame.largestAcked = 2;
+  ackFrame.ackBlocks.emplace_back(1, 2);
+  // Packet 1 is too old to be acked late, it's just forgotten.
+  EXPECT_CALL(*rawCongestionController, undoLoss(lossTime + 1s)).Times(1);
+  detectSpuriousLoss(
+      *conn,
+      PacketNumberSpace::AppData,
+      ackFrame,
+      lossTime + 1s + calculatePTO(*conn));
+  EXPECT_EQ(1, conn->lossState.spuriousLossCount);
+  EXPECT_TRUE(conn->lossState.recentlyLostPackets.empty());
+}
+
+TEST_F(QuicLossFunctionsTest, AdaptiveReordering) {
+  auto conn = createConn();
+  conn->transportSettings.adaptiveReordering = true;
+  conn->lossState.srtt = 80ms;
+  recordLostPacket(*conn, 1, PacketNumberSpace::AppData, 9, Clock::now());
+  ReadAckFrame ackFrame;
+  ackFrame.largestAcked = 1;
+  ackFrame.ackBlocks.emplace_back(1, 1);
+  EXPECT_CALL(*transportInfoCb_, onPacketSpuriousLoss()).Times(1);
+  detectSpuriousLoss(
+      *conn, PacketNumberSpace::AppData, ackFrame, Clock::now());
+  EXPECT_EQ(1, conn->lossState.spuriousLossCount);
+  EXPECT_TRUE(conn->lossState.recentlyLostPackets.empty());
+  EXPECT_EQ(8, conn->lossState.reorderingThreshold);
+  EXPECT_EQ(1, conn->lossState.reorderingWindowSteps);
+
+  // Packet 1 is sent 100ms before the loss check, which is over 5/4 srtt but
+  // within the widened window. Packet 8 is not far enough either.
+  std::vector<PacketNum> lostPackets;
+  auto lossVisitor = [&](auto&, auto& packet, bool, PacketNum) {
+    lostPackets.push_back(packet.header.getPacketSequenceNum());
+  };
+  TimePoint startTime(1s);
+  for (int i = 0; i < 10; ++i) {
+    sendPacket(*conn, startTime, folly::none, PacketType::OneRtt);
+  }
+  auto firstPacketNum =
+      conn->outstandingPackets.front().packet.header.getPacketSequenceNum();
+  detectLossPackets<decltype(lossVisitor)>(
+      *conn,
+      firstPacketNum + 8,
+      lossVisitor,
+      startTime + 105ms,
+      PacketNumberSpace::AppData);
+  EXPECT_TRUE(lostPackets.empty());
+
+  // Loss events without a spurious loss narrow the window back.
+  for (uint32_t i = 0; i < kReorderingWindowDecayLossEvents; ++i) {
+    onLossEventForReordering(*conn);
+  }
+  EXPECT_EQ(kReorderingThreshold + 1, conn->lossState.reorderingThreshold);
+  EXPECT_EQ(0, conn->lossState.reorderingWindowSteps);
+}
+
+TEST_F(QuicLossFunctionsTest, LostPathMtuProbeIsNotCongestion) {
+  auto conn = createConn();
+  auto mockCongestionController = std::make_unique<MockCongestionController>();
+  auto rawCongestionController = mockCongestionController.get();
+  conn->congestionController = std::move(mockCongestionController);
+  EXPECT_CALL(*rawCongestionController, onPacketSent(_))
+      .WillRepeatedly(Return());
+  conn->udpSendPacketLen = 1200;
+  startPathMtuDiscovery(*conn, 1500);
+  ASSERT_TRUE(getNextPathMtuProbe(*conn, Clock::now()).has_value());
+  onPathMtuProbeSent(*conn);
+
+  TimePoint startTime(1s);
+  for (int i = 0; i < 4; ++i) {
+    sendPacket(*conn, startTime, folly::none, PacketType::OneRtt);
+  }
+  auto& probe = conn->outstandingPackets.front();
+  probe.isPathMtuProbe = true;
+  auto probeSize = probe.encodedSize;
+  auto probeNum = probe.packet.header.getPacketSequenceNum();
+
+  std::vector<PacketNum> lostPackets;
+  auto lossVisitor = [&](auto&, auto& packet, bool, PacketNum) {
+    lostPackets.push_back(packet.header.getPacketSequenceNum());
+  };
+  EXPECT_CALL(*rawCongestionController, onRemoveBytesFromInflight(probeSize));
+  auto lossEvent = detectLossPackets<decltype(lossVisitor)>(
+      *conn,
+      probeNum + 3,
+      lossVisitor,
+      startTime + 10s,
+      PacketNumberSpace::AppData);
+  ASSERT_TRUE(lossEvent.has_value());
+  EXPECT_EQ(2, lossEvent->lostPackets);
+  EXPECT_THAT(lostPackets, ElementsAre(probeNum + 1, probeNum + 2));
+  EXPECT_EQ(1, conn->outstandingPackets.size());
+  EXPECT_FALSE(conn->pathMtuState.probeInFlight);
+  EXPECT_EQ(1, conn->pathMtuState.probeLosses);
+}
+
 TEST_F(QuicLossFunctionsTest, TestHandleAckForLoss) {
   auto conn = createConn();
   auto mockQLogger = std::make_shared<MockQLogger>(VantagePoint::Server);
@@ -934,7 +1066,7 @@ TEST_F(QuicLossFunctionsTest, LossTimePreemptsCryptoTimer) {
   MockClock::mockNow = [=]() { return sendTime; };
   auto alarm = calculateAlarmDuration<MockClock>(*conn);
   EXPECT_EQ(
-      std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
           expectedDelayUntilLost),
       alarm.first);
   EXPECT_EQ(LossState::AlarmMethod::EarlyRetransmitOrReordering, alarm.second);
@@ -1134,6 +1266,30 @@ TEST_F(QuicLossFunctionsTest, AlarmDurationNonHandshakeOutstanding) {
   EXPECT_LT(duration.first, newDuration.first);
 }
 
+TEST_F(QuicLossFunctionsTest, AlarmDurationTailLossProbe) {
+  auto conn = createConn();
+  conn->transportSettings.tailLossProbe = true;
+  conn->lossState.srtt = 4ms;
+  conn->lossState.rttvar = 10ms;
+  conn->lossState.maxAckDelay = 25ms;
+  TimePoint lastPacketSentTime = Clock::now();
+  MockClock::mockNow = [=]() { return lastPacketSentTime; };
+  sendPacket(*conn, lastPacketSentTime, folly::none, PacketType::OneRtt);
+  // A single packet in flight waits for a delayed ack as well.
+  auto duration = calculateAlarmDuration<MockClock>(*conn);
+  EXPECT_EQ(LossState::AlarmMethod::PTO, duration.second);
+  EXPECT_EQ(33ms, duration.first);
+
+  sendPacket(*conn, lastPacketSentTime, folly::none, PacketType::OneRtt);
+  duration = calculateAlarmDuration<MockClock>(*conn);
+  EXPECT_EQ(kMinTailLossProbeTimeout, duration.first);
+
+  // Later PTOs back off from the full PTO.
+  conn->lossState.ptoCount = 1;
+  duration = calculateAlarmDuration<MockClock>(*conn);
+  EXPECT_EQ(138ms, duration.first);
+}
+
 TEST_F(QuicLossFunctionsTest, NoSkipLossVisitor) {
   auto conn = createConn();
   conn->congestionController.reset();
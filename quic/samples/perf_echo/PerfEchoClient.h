@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/Conv.h>
+#include <folly/container/F14Map.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+
+#include <quic/api/QuicSocket.h>
+#include <quic/client/QuicClientTransport.h>
+#include <quic/common/test/TestUtils.h>
+#include <quic/congestion_control/CongestionControllerFactory.h>
+#include <quic/fizz/client/handshake/FizzClientQuicHandshakeContext.h>
+
+namespace quic {
+namespace samples {
+
+struct PerfEchoClientOptions {
+  std::string host{"::1"};
+  uint16_t port{6667};
+  // An event loop thread each, sharing the connections between them.
+  uint32_t threads{1};
+  uint32_t connections{1};
+  // Requests each connection keeps in flight, one stream each.
+  uint32_t concurrency{16};
+  uint32_t requestSize{100};
+  std::chrono::seconds duration{10};
+  bool gso{true};
+};
+
+struct PerfEchoClientStats {
+  uint64_t requests{0};
+  uint64_t failedConnections{0};
+  std::vector<std::chrono::microseconds> latencies;
+
+  void merge(PerfEchoClientStats&& other) {
+    requests += other.requests;
+    failedConnections += other.failedConnections;
+    latencies.insert(
+        latencies.end(), other.latencies.begin(), other.latencies.end());
+  }
+};
+
+/**
+ * One connection of the load generator. Keeps concurrency requests in flight,
+ * each a stream with the same request written with EOF, and starts the next
+ * as soon as a response is complete. The request buffer is shared by all of
+ * them and only cloned, and responses are read with readSlices() and
+ * dropped.
+ */
+class PerfEchoConnection : public quic::QuicSocket::ConnectionCallback,
+                           public quic::QuicSocket::ReadCallback {
+ public:
+  PerfEchoConnection(
+      folly::EventBase* evb,
+      const folly::SocketAddress& addr,
+      const PerfEchoClientOptions& options,
+      const folly::IOBuf& request,
+      PerfEchoClientStats& stats)
+      : options_(options), request_(request), stats_(stats) {
+    auto fizzClientContext =
+        FizzClientQuicHandshakeContext::Builder()
+            .setCertificateVerifier(test::createTestCertificateVerifier())
+            .build();
+    client_ = std::make_shared<quic::QuicClientTransport>(
+        evb,
+        std::make_unique<folly::AsyncUDPSocket>(evb),
+        std::move(fizzClientContext));
+    client_->setHostname("perf_echo");
+    client_->addNewPeerAddress(addr);
+    client_->setCongestionControllerFactory(
+        std::make_shared<DefaultCongestionControllerFactory>());
+    auto settings = client_->getTransportSettings();
+    settings.connectUDP = true;
+    settings.shouldRecvBatch = true;
+    settings.maxRecvBatchSize = 32;
+    if (options_.gso) {
+      settings.batchingMode = QuicBatchingMode::BATCHING_MODE_GSO;
+      settings.maxBatchSize = 16;
+    }
+    settings.canIgnorePathMTU = true;
+    client_->setTransportSettings(settings);
+  }
+
+  ~PerfEchoConnection() override = default;
+
+  void start() {
+    client_->start(this);
+  }
+
+  void stop() {
+    running_ = false;
+    client_->close(folly::none);
+  }
+
+  void onTransportReady() noexcept override {
+    fillRequests();
+  }
+
+  void onNewBidirectionalStream(quic::StreamId id) noexcept override {
+    client_->stopSending(id, GenericApplicationErrorCode::UNKNOWN);
+  }
+
+  void onNewUnidirectionalStream(quic::StreamId id) noexcept override {
+    client_->stopSending(id, GenericApplicationErrorCode::UNKNOWN);
+  }
+
+  void onStopSending(
+      quic::StreamId /* id */,
+      quic::ApplicationErrorCode /* error */) noexcept override {}
+
+  void onConnectionEnd() noexcept override {
+    running_ = false;
+  }
+
+  void onConnectionError(
+      std::pair<quic::QuicErrorCode, std::string> error) noexcept override {
+    if (running_) {
+      LOG(ERROR) << "Connection error=" << toString(error.first) << " "
+                 << error.second;
+      ++stats_.failedConnections;
+    }
+    running_ = false;
+  }
+
+  void readAvailable(quic::StreamId id) noexcept override {
+    auto res = client_->readSlices(id, 0);
+    if (res.hasError()) {
+      LOG(ERROR) << "Read failed on stream=" << id
+                 << " error=" << toString(res.error());
+      return;
+    }
+    if (!res->second) {
+      return;
+    }
+    auto itr = startTimes_.find(id);
+    if (itr != startTimes_.end()) {
+      stats_.latencies.push_back(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              Clock::now() - itr->second));
+      ++stats_.requests;
+      startTimes_.erase(itr);
+    }
+    fillRequests();
+  }
+
+  void readError(
+      quic::StreamId id,
+      std::pair<quic::QuicErrorCode, folly::Optional<folly::StringPiece>>
+          error) noexcept override {
+    if (running_) {
+      LOG(ERROR) << "Read error on stream=" << id
+                 << " error=" << toString(error);
+    }
+    startTimes_.erase(id);
+  }
+
+ private:
+  void fillRequests() {
+    // A stream is only opened once the server gives credit for it, which
+    // comes back as the earlier streams close.
+    while (running_ && startTimes_.size() < options_.concurrency &&
+           client_->getNumOpenableBidirectionalStreams() > 0) {
+      auto id = client_->createBidirectionalStream().value();
+      client_->setReadCallback(id, this);
+      startTimes_.emplace(id, Clock::now());
+      auto res = client_->writeChain(id, request_.clone(), true, false);
+      if (res.hasError() || res.value()) {
+        LOG(ERROR) << "Request on stream=" << id << " not written";
+        startTimes_.erase(id);
+        client_->resetStream(id, GenericApplicationErrorCode::UNKNOWN);
+        return;
+      }
+    }
+  }
+
+  const PerfEchoClientOptions& options_;
+  const folly::IOBuf& request_;
+  PerfEchoClientStats& stats_;
+  std::shared_ptr<quic::QuicClientTransport> client_;
+  folly::F14FastMap<quic::StreamId, TimePoint> startTimes_;
+  bool running_{true};
+};
+
+/**
+ * Runs connections spread over threads against a PerfEchoServer for the
+ * given duration, and prints the requests per second and the latency
+ * percentiles of all of them.
+ */
+class PerfEchoClient {
+ public:
+  explicit PerfEchoClient(PerfEchoClientOptions options)
+      : options_(std::move(options)),
+        request_(folly::IOBuf::create(options_.requestSize)) {
+    request_->append(options_.requestSize);
+    memset(request_->writableData(), 'a', options_.requestSize);
+  }
+
+  void start() {
+    folly::SocketAddress addr;
+    addr.setFromHostPort(options_.host, options_.port);
+    auto numThreads = std::max<uint32_t>(1, options_.threads);
+    std::vector<std::unique_ptr<folly::ScopedEventBaseThread>> threads;
+    std::vector<PerfEchoClientStats> threadStats(numThreads);
+    std::vector<std::vector<std::unique_ptr<PerfEchoConnection>>> connections(
+        numThreads);
+    for (uint32_t i = 0; i < numThreads; ++i) {
+      threads.push_back(std::make_unique<folly::ScopedEventBaseThread>(
+          folly::to<std::string>("PerfEcho", i)));
+    }
+    for (uint32_t i = 0; i < options_.connections; ++i) {
+      auto thread = i % numThreads;
+      auto evb = threads[thread]->getEventBase();
+      evb->runInEventBaseThreadAndWait([&] {
+        connections[thread].push_back(std::make_unique<PerfEchoConnection>(
+            evb, addr, options_, *request_, threadStats[thread]));
+        connections[thread].back()->start();
+      });
+    }
+    LOG(INFO) << "Perf echo client running " << options_.connections
+              << " connections to " << addr.describe() << " for "
+              << options_.duration.count() << "s";
+    auto start = Clock::now();
+    std::this_thread::sleep_for(options_.duration);
+    for (uint32_t i = 0; i < numThreads; ++i) {
+      threads[i]->getEventBase()->runInEventBaseThreadAndWait([&] {
+        for (auto& connection : connections[i]) {
+          connection->stop();
+        }
+      });
+    }
+    auto elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    PerfEchoClientStats stats;
+    for (uint32_t i = 0; i < numThreads; ++i) {
+      threads[i]->getEventBase()->runInEventBaseThreadAndWait([&] {
+        stats.merge(std::move(threadStats[i]));
+        connections[i].clear();
+      });
+    }
+    printStats(stats, elapsed);
+  }
+
+ private:
+  static void printStats(PerfEchoClientStats& stats, double elapsed) {
+    std::cout << "requests: " << stats.requests << std::endl;
+    std::cout << "requests/s: " << stats.requests / elapsed << std::endl;
+    if (stats.failedConnections) {
+      std::cout << "failed connections: " << stats.failedConnections
+                << std::endl;
+    }
+    auto& latencies = stats.latencies;
+    if (latencies.empty()) {
+      return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double pct) {
+      auto index = std::min<size_t>(
+          latencies.size() - 1, latencies.size() * pct / 100);
+      return latencies[index].count();
+    };
+    std::cout << "latency us: p50=" << percentile(50)
+              << " p90=" << percentile(90) << " p99=" << percentile(99)
+              << " p99.9=" << percentile(99.9)
+              << " max=" << latencies.back().count() << std::endl;
+  }
+
+  PerfEchoClientOptions options_;
+  std::unique_ptr<folly::IOBuf> request_;
+};
+} // namespace samples
+} // namespace quic
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <glog/logging.h>
+
+#include <folly/container/F14Map.h>
+#include <folly/io/async/EventBase.h>
+
+#include <quic/api/QuicSocket.h>
+#include <quic/common/BufUtil.h>
+
+namespace quic {
+namespace samples {
+
+/**
+ * Echoes every bidirectional stream of one connection back as it arrives,
+ * rather than once the whole request is in, on any number of streams at once.
+ *
+ * The streams readable in a loop are handed over together through the
+ * BatchedStreamCallback, their data is read with readSlices(), which neither
+ * copies nor coalesces it, and the slices are written back as a chain, so the
+ * data goes from the received packets to the sent ones without a copy.
+ */
+class PerfEchoHandler : public quic::QuicSocket::ConnectionCallback,
+                        public quic::QuicSocket::ReadCallback,
+                        public quic::QuicSocket::WriteCallback,
+                        public quic::QuicSocket::BatchedStreamCallback {
+ public:
+  explicit PerfEchoHandler(folly::EventBase* evbIn) : evb(evbIn) {}
+
+  void setQuicSocket(std::shared_ptr<quic::QuicSocket> socket) {
+    sock = std::move(socket);
+    sock->setBatchedStreamCallback(this);
+  }
+
+  void onNewBidirectionalStream(quic::StreamId id) noexcept override {
+    sock->setReadCallback(id, this);
+  }
+
+  void onNewUnidirectionalStream(quic::StreamId id) noexcept override {
+    // There is no way to answer on it.
+    sock->stopSending(id, GenericApplicationErrorCode::UNKNOWN);
+  }
+
+  void onStopSending(
+      quic::StreamId id,
+      quic::ApplicationErrorCode /* error */) noexcept override {
+    streams_.erase(id);
+    sock->resetStream(id, GenericApplicationErrorCode::UNKNOWN);
+  }
+
+  void onConnectionEnd() noexcept override {
+    VLOG(4) << "Connection closed";
+    streams_.clear();
+  }
+
+  void onConnectionError(
+      std::pair<quic::QuicErrorCode, std::string> error) noexcept override {
+    VLOG(2) << "Connection error=" << toString(error.first) << " "
+            << error.second;
+    streams_.clear();
+  }
+
+  void readAvailable(quic::StreamId id) noexcept override {
+    readStream(id);
+  }
+
+  void readError(
+      quic::StreamId id,
+      std::pair<quic::QuicErrorCode, folly::Optional<folly::StringPiece>>
+          error) noexcept override {
+    VLOG(2) << "Read error on stream=" << id << " error=" << toString(error);
+    streams_.erase(id);
+  }
+
+  void onStreamsReadable(
+      const std::vector<quic::StreamId>& streams) noexcept override {
+    for (auto id : streams) {
+      readStream(id);
+    }
+  }
+
+  void onDeliveryAcks(
+      const std::vector<DeliveryAck>& /* acks */,
+      std::chrono::microseconds /* rtt */) noexcept override {}
+
+  void onStreamWriteReady(
+      quic::StreamId id,
+      uint64_t /* maxToSend */) noexcept override {
+    auto itr = streams_.find(id);
+    if (itr == streams_.end()) {
+      return;
+    }
+    itr->second.waitingForWrite = false;
+    echo(id, itr->second);
+  }
+
+  void onStreamWriteError(
+      quic::StreamId id,
+      std::pair<quic::QuicErrorCode, folly::Optional<folly::StringPiece>>
+          error) noexcept override {
+    VLOG(2) << "Write error on stream=" << id << " error=" << toString(error);
+    streams_.erase(id);
+  }
+
+  folly::EventBase* getEventBase() {
+    return evb;
+  }
+
+  folly::EventBase* evb;
+  std::shared_ptr<quic::QuicSocket> sock;
+
+ private:
+  struct PendingEcho {
+    BufQueue data;
+    bool eof{false};
+    bool waitingForWrite{false};
+  };
+
+  void readStream(quic::StreamId id) {
+    auto res = sock->readSlices(id, 0);
+    if (res.hasError()) {
+      VLOG(2) << "Read failed on stream=" << id
+              << " error=" << toString(res.error());
+      return;
+    }
+    auto& pending = streams_[id];
+    for (auto& slice : res->first) {
+      pending.data.append(std::move(slice));
+    }
+    pending.eof = res->second;
+    if (!pending.waitingForWrite) {
+      echo(id, pending);
+    }
+  }
+
+  void echo(quic::StreamId id, PendingEcho& pending) {
+    if (pending.data.empty() && !pending.eof) {
+      return;
+    }
+    auto res = sock->writeChain(id, pending.data.move(), pending.eof, false);
+    if (res.hasError()) {
+      VLOG(2) << "Write failed on stream=" << id
+              << " error=" << toString(res.error());
+      streams_.erase(id);
+    } else if (res.value()) {
+      // Flow control is full, the rest goes once there is room again.
+      pending.data.append(std::move(res.value()));
+      pending.waitingForWrite = true;
+      sock->notifyPendingWriteOnStream(id, this);
+    } else if (pending.eof) {
+      streams_.erase(id);
+    }
+  }
+
+  folly::F14FastMap<quic::StreamId, PendingEcho> streams_;
+};
+} // namespace samples
+} // namespace quic
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <quic/common/test/TestUtils.h>
+#include <quic/samples/perf_echo/PerfEchoHandler.h>
+#include <quic/server/QuicServer.h>
+#include <quic/server/QuicServerTransport.h>
+
+namespace quic {
+namespace samples {
+
+struct PerfEchoServerOptions {
+  std::string host{"::1"};
+  uint16_t port{6667};
+  // 0 for one per CPU.
+  size_t workers{0};
+  bool gso{true};
+  bool pacing{true};
+  bool zeroCopySend{false};
+};
+
+class PerfEchoServerTransportFactory : public quic::QuicServerTransportFactory {
+ public:
+  ~PerfEchoServerTransportFactory() override {
+    // Each handler goes away on its own worker thread, like its connection.
+    for (auto& entry : handlers_) {
+      entry.first->runImmediatelyOrRunInEventBaseThreadAndWait(
+          [&handlers = entry.second] { handlers.clear(); });
+    }
+  }
+
+  quic::QuicServerTransport::Ptr make(
+      folly::EventBase* evb,
+      std::unique_ptr<folly::AsyncUDPSocket> sock,
+      const folly::SocketAddress&,
+      std::shared_ptr<const fizz::server::FizzServerContext>
+          ctx) noexcept override {
+    CHECK_EQ(evb, sock->getEventBase());
+    auto handler = std::make_unique<PerfEchoHandler>(evb);
+    auto transport = quic::QuicServerTransport::make(
+        evb, std::move(sock), *handler, ctx);
+    handler->setQuicSocket(transport);
+    std::lock_guard<std::mutex> guard(mutex_);
+    handlers_[evb].push_back(std::move(handler));
+    return transport;
+  }
+
+ private:
+  // make() runs on every worker thread.
+  std::mutex mutex_;
+  std::map<folly::EventBase*, std::vector<std::unique_ptr<PerfEchoHandler>>>
+      handlers_;
+};
+
+/**
+ * The echo server set up for throughput: a worker per CPU, each reading
+ * batches of packets with recvmmsg, writing the packets of all its
+ * connections with one sendmmsg per loop, with GSO, and pacing BBR from one
+ * calendar queue.
+ */
+class PerfEchoServer {
+ public:
+  explicit PerfEchoServer(PerfEchoServerOptions options)
+      : options_(std::move(options)), server_(QuicServer::createQuicServer()) {
+    eventBase_.setName("perf_echo_server");
+    server_->setQuicServerTransportFactory(
+        std::make_unique<PerfEchoServerTransportFactory>());
+    auto serverCtx = quic::test::createServerCtx();
+    serverCtx->setClock(std::make_shared<fizz::SystemClock>());
+    server_->setFizzContext(serverCtx);
+    server_->setTransportSettings(makeTransportSettings(options_));
+  }
+
+  static TransportSettings makeTransportSettings(
+      const PerfEchoServerOptions& options) {
+    TransportSettings settings;
+    settings.shouldRecvBatch = true;
+    settings.maxRecvBatchSize = 32;
+    settings.useSharedEgressBatch = true;
+    if (options.gso) {
+      settings.batchingMode = QuicBatchingMode::BATCHING_MODE_GSO;
+      settings.maxBatchSize = 16;
+    }
+    if (options.pacing) {
+      settings.defaultCongestionController = CongestionControlType::BBR;
+      settings.pacingEnabled = true;
+      settings.pacingTimerTickInterval = std::chrono::microseconds(200);
+      settings.usePacingScheduler = true;
+    }
+    settings.enableZeroCopySend = options.zeroCopySend;
+    // Plenty of concurrent requests per connection.
+    settings.advertisedInitialMaxStreamsBidi = 1024;
+    settings.canIgnorePathMTU = true;
+    return settings;
+  }
+
+  void start() {
+    folly::SocketAddress addr;
+    addr.setFromHostPort(options_.host, options_.port);
+    server_->start(addr, options_.workers);
+    LOG(INFO) << "Perf echo server started at: " << addr.describe();
+    eventBase_.loopForever();
+  }
+
+ private:
+  PerfEchoServerOptions options_;
+  folly::EventBase eventBase_;
+  std::shared_ptr<quic::QuicServer> server_;
+};
+} // namespace samples
+} // namespace quic
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <glog/logging.h>
+
+#include <fizz/crypto/Utils.h>
+#include <folly/init/Init.h>
+#include <folly/portability/GFlags.h>
+
+#include <quic/samples/perf_echo/PerfEchoClient.h>
+#include <quic/samples/perf_echo/PerfEchoServer.h>
+
+DEFINE_string(host, "::1", "Perf echo server hostname/IP");
+DEFINE_int32(port, 6667, "Perf echo server port");
+DEFINE_string(mode, "server", "Mode to run in: 'client' or 'server'");
+DEFINE_uint32(workers, 0, "Server workers, 0 for one per CPU");
+DEFINE_bool(gso, true, "Write batches of packets with GSO");
+DEFINE_bool(pacing, true, "Pace the server's BBR from one scheduler a worker");
+DEFINE_bool(
+    zero_copy,
+    false,
+    "Write the server's GSO batches with MSG_ZEROCOPY");
+DEFINE_uint32(threads, 1, "Client threads");
+DEFINE_uint32(connections, 1, "Client connections, spread over the threads");
+DEFINE_uint32(concurrency, 16, "Requests each client connection keeps going");
+DEFINE_uint32(request_size, 100, "Bytes in each request");
+DEFINE_uint32(duration, 10, "Seconds the client runs for");
+
+using namespace quic::samples;
+
+int main(int argc, char* argv[]) {
+#if FOLLY_HAVE_LIBGFLAGS
+  // Enable glog logging to stderr by default.
+  gflags::SetCommandLineOptionWithMode(
+      "logtostderr", "1", gflags::SET_FLAGS_DEFAULT);
+#endif
+  gflags::ParseCommandLineFlags(&argc, &argv, false);
+  folly::Init init(&argc, &argv);
+  fizz::CryptoUtils::init();
+
+  if (FLAGS_mode == "server") {
+    PerfEchoServerOptions options;
+    options.host = FLAGS_host;
+    options.port = FLAGS_port;
+    options.workers = FLAGS_workers;
+    options.gso = FLAGS_gso;
+    options.pacing = FLAGS_pacing;
+    options.zeroCopySend = FLAGS_zero_copy;
+    PerfEchoServer server(std::move(options));
+    server.start();
+  } else if (FLAGS_mode == "client") {
+    if (FLAGS_host.empty() || FLAGS_port == 0) {
+      LOG(ERROR) << "PerfEchoClient expected --host and --port";
+      return -2;
+    }
+    PerfEchoClientOptions options;
+    options.host = FLAGS_host;
+    options.port = FLAGS_port;
+    options.threads = FLAGS_threads;
+    options.connections = FLAGS_connections;
+    options.concurrency = FLAGS_concurrency;
+    options.requestSize = FLAGS_request_size;
+    options.duration = std::chrono::seconds(FLAGS_duration);
+    options.gso = FLAGS_gso;
+    PerfEchoClient client(std::move(options));
+    client.start();
+  } else {
+    LOG(ERROR) << "Unknown mode specified: " << FLAGS_mode;
+    return -1;
+  }
+  return 0;
+}
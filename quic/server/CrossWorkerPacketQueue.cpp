@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/server/CrossWorkerPacketQueue.h>
+
+namespace quic {
+
+CrossWorkerPacketQueue::CrossWorkerPacketQueue(
+    size_t numSources,
+    size_t capacity) {
+  CHECK_GT(numSources, 0);
+  CHECK_GT(capacity, 0);
+  rings_.reserve(numSources);
+  for (size_t i = 0; i < numSources; ++i) {
+    // ProducerConsumerQueue keeps one slot empty.
+    rings_.push_back(
+        std::make_unique<folly::ProducerConsumerQueue<Packet>>(capacity + 1));
+  }
+}
+
+bool CrossWorkerPacketQueue::enqueue(
+    size_t source,
+    const folly::SocketAddress& client,
+    RoutingData& routingData,
+    NetworkData& networkData,
+    bool isForwardedData,
+    bool& needsWakeup) {
+  CHECK_LT(source, rings_.size());
+  // The arguments are only moved from if there is room for them.
+  if (!rings_[source]->write(
+          client,
+          std::move(routingData),
+          std::move(networkData),
+          isForwardedData)) {
+    needsWakeup = false;
+    return false;
+  }
+  // This pairs with the exchange in drain(), so that either the drain
+  // already scheduled sees this packet, or the caller schedules another one.
+  needsWakeup = !drainScheduled_.exchange(true, std::memory_order_acq_rel);
+  return true;
+}
+
+size_t CrossWorkerPacketQueue::drain(
+    folly::FunctionRef<void(Packet&)> callback) {
+  drainScheduled_.exchange(false, std::memory_order_acq_rel);
+  size_t drained = 0;
+  for (auto& ring : rings_) {
+    // Packets enqueued while draining are left to the next drain, so that a
+    // busy producer can't keep the consumer here.
+    auto pending = ring->sizeGuess();
+    while (pending-- > 0) {
+      auto packet = ring->frontPtr();
+      if (!packet) {
+        break;
+      }
+      callback(*packet);
+      ring->popFront();
+      ++drained;
+    }
+  }
+  return drained;
+}
+
+size_t CrossWorkerPacketQueue::numSources() const {
+  return rings_.size();
+}
+} // namespace quic
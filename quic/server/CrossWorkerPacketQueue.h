@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Function.h>
+#include <folly/ProducerConsumerQueue.h>
+#include <folly/SocketAddress.h>
+#include <quic/server/QuicServerPacketRouter.h>
+#include <quic/state/StateData.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace quic {
+
+// Number of packets each source worker can have in flight to one target worker
+// before falling back to posting them one by one.
+constexpr size_t kCrossWorkerPacketQueueSize = 1024;
+
+/**
+ * Packets handed off to one worker by the other workers. There is one ring
+ * per source worker, so each ring has a single producer and a single consumer
+ * and needs no lock. The consumer only needs one wakeup for all the packets
+ * enqueued before it drains.
+ */
+class CrossWorkerPacketQueue {
+ public:
+  struct Packet {
+    folly::SocketAddress client;
+    RoutingData routingData;
+    NetworkData networkData;
+    bool isForwardedData;
+
+    Packet(
+        const folly::SocketAddress& clientIn,
+        RoutingData&& routingDataIn,
+        NetworkData&& networkDataIn,
+        bool isForwardedDataIn)
+        : client(clientIn),
+          routingData(std::move(routingDataIn)),
+          networkData(std::move(networkDataIn)),
+          isForwardedData(isForwardedDataIn) {}
+  };
+
+  explicit CrossWorkerPacketQueue(
+      size_t numSources,
+      size_t capacity = kCrossWorkerPacketQueueSize);
+
+  /**
+   * Called on the thread of the source worker. If the ring is full, returns
+   * false and leaves the arguments untouched. Otherwise sets needsWakeup if
+   * the consumer has to be scheduled to drain.
+   */
+  bool enqueue(
+      size_t source,
+      const folly::SocketAddress& client,
+      RoutingData& routingData,
+      NetworkData& networkData,
+      bool isForwardedData,
+      bool& needsWakeup);
+
+  /**
+   * Called on the thread of the target worker. Hands every packet queued so
+   * far to the callback and returns how many there were.
+   */
+  size_t drain(folly::FunctionRef<void(Packet&)> callback);
+
+  size_t numSources() const;
+
+ private:
+  std::vector<std::unique_ptr<folly::ProducerConsumerQueue<Packet>>> rings_;
+  // Whether a drain has been scheduled and not yet started.
+  std::atomic<bool> drainScheduled_{false};
+};
+} // namespace quic
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/lang/Bits.h>
+#include <quic/codec/QuicConnectionId.h>
+
+#include <vector>
+
+namespace quic {
+
+/**
+ * A direct mapped table in front of a worker's connection id map. Server
+ * connection ids end in random bytes that we picked, so their tail indexes
+ * the table without hashing the whole id. A slot remembers the full id it was
+ * filled for, which is checked on lookup.
+ *
+ * Ids that collide with an occupied slot are simply not in the table, so a
+ * miss has to fall back to the map.
+ */
+template <typename T>
+class DirectConnectionIdTable {
+ public:
+  explicit DirectConnectionIdTable(size_t numSlots)
+      : slots_(folly::nextPowTwo(numSlots)) {
+    CHECK_GT(numSlots, 0);
+  }
+
+  // Returns nullptr on a miss.
+  const T* find(const ConnectionId& connId) const {
+    auto& slot = slots_[index(connId)];
+    if (slot.value && slot.connId == connId) {
+      return &slot.value;
+    }
+    return nullptr;
+  }
+
+  // Returns whether the id found a free slot.
+  bool insert(const ConnectionId& connId, const T& value) {
+    auto& slot = slots_[index(connId)];
+    if (slot.value) {
+      return slot.connId == connId;
+    }
+    slot.connId = connId;
+    slot.value = value;
+    return true;
+  }
+
+  void erase(const ConnectionId& connId) {
+    auto& slot = slots_[index(connId)];
+    if (slot.value && slot.connId == connId) {
+      slot.value = T();
+    }
+  }
+
+  void clear() {
+    for (auto& slot : slots_) {
+      slot.value = T();
+    }
+  }
+
+  size_t numSlots() const {
+    return slots_.size();
+  }
+
+ private:
+  struct Slot {
+    ConnectionId connId{std::vector<uint8_t>()};
+    T value;
+  };
+
+  size_t index(const ConnectionId& connId) const {
+    // The last bytes of the id, which are the random ones.
+    uint32_t tail = 0;
+    auto data = connId.data();
+    auto size = connId.size();
+    for (size_t i = size > sizeof(tail) ? size - sizeof(tail) : 0; i < size;
+         ++i) {
+      tail = (tail << 8) | data[i];
+    }
+    return tail & (slots_.size() - 1);
+  }
+
+  std::vector<Slot> slots_;
+};
+} // namespace quic
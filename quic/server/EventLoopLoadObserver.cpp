@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/server/EventLoopLoadObserver.h>
+
+namespace {
+// Weight of the newest sample is 1 / kBusyTimeSmoothing.
+constexpr double kBusyTimeSmoothing = 8;
+} // namespace
+
+namespace quic {
+
+EventLoopLoadObserver::EventLoopLoadObserver(
+    std::chrono::microseconds busyTimeThreshold,
+    std::shared_ptr<folly::EventBaseObserver> next)
+    : busyTimeThreshold_(busyTimeThreshold.count()), next_(std::move(next)) {}
+
+void EventLoopLoadObserver::loopSample(int64_t busyTime, int64_t idleTime) {
+  smoothedBusyTime_ += (busyTime - smoothedBusyTime_) / kBusyTimeSmoothing;
+  if (overloaded_) {
+    overloaded_ = smoothedBusyTime_ > busyTimeThreshold_ / 2;
+  } else {
+    overloaded_ = smoothedBusyTime_ > busyTimeThreshold_;
+  }
+  if (next_ && ++samplesSinceNext_ >= next_->getSampleRate()) {
+    samplesSinceNext_ = 0;
+    next_->loopSample(busyTime, idleTime);
+  }
+}
+
+std::chrono::microseconds EventLoopLoadObserver::getSmoothedBusyTime() const {
+  return std::chrono::microseconds(static_cast<int64_t>(smoothedBusyTime_));
+}
+
+void EventLoopLoadObserver::setNext(
+    std::shared_ptr<folly::EventBaseObserver> next) {
+  next_ = std::move(next);
+  samplesSinceNext_ = 0;
+}
+
+} // namespace quic
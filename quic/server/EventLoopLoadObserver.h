@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/io/async/EventBase.h>
+
+#include <chrono>
+#include <memory>
+
+namespace quic {
+
+/**
+ * Watches how long each loop of a worker's event base is busy for, and tells
+ * the worker when it is falling behind on its packets.
+ *
+ * The busy time is smoothed across loops. The loop is overloaded once the
+ * smoothed time goes over the threshold, and stays so until it drops under
+ * half of it, so that admission doesn't flap with each loop. An observer set
+ * on the event base before this one keeps getting its samples through it.
+ */
+class EventLoopLoadObserver : public folly::EventBaseObserver {
+ public:
+  EventLoopLoadObserver(
+      std::chrono::microseconds busyTimeThreshold,
+      std::shared_ptr<folly::EventBaseObserver> next = nullptr);
+
+  uint32_t getSampleRate() const override {
+    return 1;
+  }
+
+  void loopSample(int64_t busyTime, int64_t idleTime) override;
+
+  bool isOverloaded() const {
+    return overloaded_;
+  }
+
+  std::chrono::microseconds getSmoothedBusyTime() const;
+
+  void setNext(std::shared_ptr<folly::EventBaseObserver> next);
+
+ private:
+  const double busyTimeThreshold_;
+  double smoothedBusyTime_{0};
+  bool overloaded_{false};
+  std::shared_ptr<folly::EventBaseObserver> next_;
+  uint32_t samplesSinceNext_{0};
+};
+
+} // namespace quic
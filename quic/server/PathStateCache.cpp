@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/server/PathStateCache.h>
+
+#include <quic/state/StateData.h>
+
+namespace quic {
+
+PathStateCache::PathStateCache(size_t capacity, std::chrono::seconds maxAge)
+    : maxAge_(maxAge), cache_(capacity) {}
+
+void PathStateCache::update(
+    const folly::IPAddress& clientAddress,
+    const QuicConnectionStateBase& conn) {
+  if (!conn.congestionController || conn.lossState.srtt == 0us) {
+    return;
+  }
+  CachedPathState state;
+  state.srtt = conn.lossState.srtt;
+  state.minRtt = conn.lossState.mrtt;
+  state.congestionWindow = conn.congestionController->getCongestionWindow();
+  state.udpSendPacketLen = conn.udpSendPacketLen;
+  state.recordTime = Clock::now();
+  update(clientAddress, std::move(state));
+}
+
+void PathStateCache::update(
+    const folly::IPAddress& clientAddress,
+    CachedPathState state) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  cache_.set(networkOf(clientAddress), std::move(state));
+}
+
+folly::Optional<CachedPathState> PathStateCache::get(
+    const folly::IPAddress& clientAddress,
+    TimePoint now) {
+  auto network = networkOf(clientAddress);
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = cache_.find(network);
+  if (it == cache_.end()) {
+    return folly::none;
+  }
+  if (now - it->second.recordTime > maxAge_) {
+    cache_.erase(network);
+    return folly::none;
+  }
+  return it->second;
+}
+
+size_t PathStateCache::size() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return cache_.size();
+}
+
+folly::IPAddress PathStateCache::networkOf(const folly::IPAddress& address) {
+  if (address.isIPv4Mapped()) {
+    return address.createIPv4().mask(kPathStateV4PrefixLen);
+  }
+  return address.mask(
+      address.isV4() ? kPathStateV4PrefixLen : kPathStateV6PrefixLen);
+}
+
+void seedTransportSettingsFromPathState(
+    TransportSettings& settings,
+    const CachedPathState& state) {
+  if (state.srtt > 0us) {
+    settings.initialRtt = state.srtt;
+  }
+  if (state.udpSendPacketLen > 0) {
+    uint64_t cwndInMss = state.congestionWindow / state.udpSendPacketLen / 2;
+    settings.initCwndInMss = std::max(
+        settings.initCwndInMss, std::min(cwndInMss, settings.maxCwndInMss));
+  }
+  if (state.udpSendPacketLen > kDefaultUDPSendPacketLen) {
+    // The path MTU is probed first rather than assumed, the path may have
+    // changed since.
+    settings.pathMtuProbeHint = state.udpSendPacketLen;
+  }
+}
+} // namespace quic
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/IPAddress.h>
+#include <folly/Optional.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <quic/QuicConstants.h>
+#include <quic/state/TransportSettings.h>
+
+#include <mutex>
+
+namespace quic {
+
+constexpr size_t kDefaultPathStateCacheSize = 10000;
+constexpr std::chrono::minutes kDefaultPathStateCacheMaxAge{10};
+// Prefix lengths that paths are keyed by. Clients in the same /24 or /48 are
+// likely behind the same bottleneck.
+constexpr uint8_t kPathStateV4PrefixLen = 24;
+constexpr uint8_t kPathStateV6PrefixLen = 48;
+
+struct QuicConnectionStateBase;
+
+/**
+ * What a connection has learned about its path, kept when it closes so that
+ * the next connection from the same network starts with it.
+ */
+struct CachedPathState {
+  std::chrono::microseconds srtt{0us};
+  std::chrono::microseconds minRtt{0us};
+  uint64_t congestionWindow{0};
+  uint64_t udpSendPacketLen{kDefaultUDPSendPacketLen};
+  TimePoint recordTime;
+};
+
+/**
+ * An LRU cache of CachedPathState keyed by client network prefix. It is
+ * thread safe, so that it can be shared by the workers of a server.
+ */
+class PathStateCache {
+ public:
+  explicit PathStateCache(
+      size_t capacity = kDefaultPathStateCacheSize,
+      std::chrono::seconds maxAge = kDefaultPathStateCacheMaxAge);
+
+  /**
+   * Records the path state of conn, if it has an rtt sample and a congestion
+   * controller.
+   */
+  void update(
+      const folly::IPAddress& clientAddress,
+      const QuicConnectionStateBase& conn);
+
+  void update(const folly::IPAddress& clientAddress, CachedPathState state);
+
+  /**
+   * Returns the state recorded for the network of clientAddress, unless it is
+   * older than maxAge.
+   */
+  folly::Optional<CachedPathState> get(
+      const folly::IPAddress& clientAddress,
+      TimePoint now);
+
+  size_t size() const;
+
+  static folly::IPAddress networkOf(const folly::IPAddress& address);
+
+ private:
+  const std::chrono::seconds maxAge_;
+  mutable std::mutex mutex_;
+  folly::EvictingCacheMap<folly::IPAddress, CachedPathState> cache_;
+};
+
+/**
+ * Seeds the initial rtt and cwnd of settings from a cached path state. The
+ * cwnd starts at half of the cached one, and never below initCwndInMss nor
+ * above maxCwndInMss. A packet size larger than the default becomes the first
+ * path MTU probe.
+ */
+void seedTransportSettingsFromPathState(
+    TransportSettings& settings,
+    const CachedPathState& state);
+} // namespace quic
@@ -10,24 +10,45 @@
 
 #include <folly/Random.h>
 #include <folly/io/async/EventBaseManager.h>
+#include <folly/synchronization/Baton.h>
 #include <quic/codec/DefaultConnectionIdAlgo.h>
 #include <quic/codec/QuicHeaderCodec.h>
 #include <quic/server/QuicReusePortUDPSocketFactory.h>
 #include <quic/server/QuicServerTransport.h>
 #include <quic/server/QuicSharedUDPSocketFactory.h>
+#include <quic/server/ReusePortSteering.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace quic {
 
 namespace {
 // Determine which worker to route to
 // This **MUST** be kept in sync with the BPF program (if supplied)
-size_t getWorkerToRouteTo(
+QuicServerWorker* getWorkerToRouteTo(
     const RoutingData& routingData,
-    size_t numWorkers,
+    const std::vector<QuicServerWorker*>& workers,
     ConnectionIdAlgo* connIdAlgo) {
-  return connIdAlgo->parseConnectionId(routingData.destinationConnId)
-             ->workerId %
-      numWorkers;
+  auto params = connIdAlgo->tryParseConnectionId(routingData.destinationConnId);
+  return workers[params.value().workerId % workers.size()];
+}
+
+bool pinCurrentThreadToCpu(size_t cpu) {
+#ifdef __linux__
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  LOG_IF(WARNING, ret != 0)
+      << "Failed to pin worker thread to cpu=" << cpu << ", errno=" << ret;
+  return ret == 0;
+#else
+  LOG(WARNING) << "Pinning worker threads is not supported, cpu=" << cpu;
+  return false;
+#endif
 }
 } // namespace
 
@@ -60,6 +81,28 @@ void QuicServer::setCongestionControllerFactory(
   ccFactory_ = std::move(ccFactory);
 }
 
+void QuicServer::setPathStateCache(
+    std::shared_ptr<PathStateCache> pathStateCache) {
+  CHECK(!initialized_)
+      << "Path state cache must be set before the server is initialized";
+  pathStateCache_ = std::move(pathStateCache);
+}
+
+void QuicServer::setResumptionCache(
+    std::shared_ptr<ResumptionCache> resumptionCache) {
+  CHECK(!initialized_)
+      << "Resumption cache must be set before the server is initialized";
+  resumptionCache_ = std::move(resumptionCache);
+}
+
+void QuicServer::setReceiveBufferAccountant(
+    std::shared_ptr<ReceiveBufferAccountant> accountant) {
+  CHECK(!initialized_)
+      << "Receive buffer accountant must be set before the server is "
+      << "initialized";
+  receiveBufferAccountant_ = std::move(accountant);
+}
+
 void QuicServer::setSupportedVersion(const std::vector<QuicVersion>& versions) {
   supportedVersions_ = versions;
 }
@@ -86,20 +129,39 @@ void QuicServer::start(const folly::SocketAddress& address, size_t maxWorkers) {
   auto numWorkers = std::min(numCpu, maxWorkers);
   std::vector<folly::EventBase*> evbs;
   for (size_t i = 0; i < numWorkers; ++i) {
-    auto scopedEvb = std::make_unique<folly::ScopedEventBaseThread>();
-    workerEvbs_.push_back(std::move(scopedEvb));
-    if (evbObserver_) {
-      workerEvbs_.back()->getEventBase()->runInEventBaseThreadAndWait([&] {
-        workerEvbs_.back()->getEventBase()->setObserver(evbObserver_);
+    evbs.push_back(addWorkerEvb());
+  }
+  if (pinWorkersToCpus_) {
+    // The threads pin themselves in parallel.
+    std::atomic<bool> pinned{true};
+    std::vector<folly::Baton<>> pinnedBatons(numWorkers);
+    for (size_t i = 0; i < numWorkers; ++i) {
+      evbs[i]->runInEventBaseThread([&pinned, &pinnedBatons, cpu = i] {
+        if (!pinCurrentThreadToCpu(cpu)) {
+          pinned = false;
+        }
+        pinnedBatons[cpu].post();
       });
     }
-    auto workerEvb = workerEvbs_.back()->getEventBase();
-    evbs.push_back(workerEvb);
+    for (auto& baton : pinnedBatons) {
+      baton.wait();
+    }
+    workersPinned_ = pinned;
   }
   initialize(address, evbs, true /* useDefaultTransport */);
   start();
 }
 
+folly::EventBase* QuicServer::addWorkerEvb() {
+  workerEvbs_.push_back(std::make_unique<folly::ScopedEventBaseThread>());
+  auto workerEvb = workerEvbs_.back()->getEventBase();
+  if (evbObserver_) {
+    workerEvb->runInEventBaseThreadAndWait(
+        [&] { workerEvb->setObserver(evbObserver_); });
+  }
+  return workerEvb;
+}
+
 void QuicServer::initialize(
     const folly::SocketAddress& address,
     const std::vector<folly::EventBase*>& evbs,
@@ -140,42 +202,74 @@ void QuicServer::initializeWorkers(
   for (size_t i = 0; i < evbs.size(); ++i) {
     auto workerEvb = evbs[i];
     auto worker = newWorkerWithoutSocket();
-    if (useDefaultTransport) {
-      CHECK(transportFactory_) << "Transport factory is not set";
-      worker->setTransportFactory(transportFactory_.get());
-      worker->setFizzContext(ctx_);
-    }
-    if (healthCheckToken_) {
-      worker->setHealthCheckToken(*healthCheckToken_);
-    }
-    if (transportStatsFactory_) {
-      workerEvb->runInEventBaseThread(
-          [self = this->shared_from_this(),
-           workerEvb,
-           workerPtr = worker.get(),
-           transportStatsFactory = transportStatsFactory_.get()] {
-            if (self->shutdown_) {
-              return;
-            }
-            auto statsCallback = transportStatsFactory->make();
-            CHECK(statsCallback);
-            workerPtr->setTransportStatsCallback(std::move(statsCallback));
-          });
-    }
-    worker->setConnectionIdAlgo(connIdAlgoFactory_->make());
-    worker->setCongestionControllerFactory(ccFactory_);
-    worker->setWorkerId(i);
-    worker->setTransportSettingsOverrideFn(transportSettingsOverrideFn_);
+    setUpWorker(*worker, workerEvb, i, useDefaultTransport);
+    evbToWorkers_.emplace(workerEvb, worker.get());
+    std::lock_guard<std::mutex> guard(resizeMutex_);
     workers_.push_back(std::move(worker));
-    evbToWorkers_.emplace(workerEvb, workers_.back().get());
+    workerStates_.push_back(WorkerState::Running);
+  }
+  {
+    std::lock_guard<std::mutex> guard(resizeMutex_);
+    updateRoutes();
+  }
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    handoffQueues_.push_back(
+        std::make_unique<CrossWorkerPacketQueue>(workers_.size()));
   }
 }
 
+void QuicServer::setUpWorker(
+    QuicServerWorker& worker,
+    folly::EventBase* workerEvb,
+    size_t workerId,
+    bool useDefaultTransport) {
+  if (useDefaultTransport) {
+    CHECK(transportFactory_) << "Transport factory is not set";
+    auto acceptor = evbToAcceptors_.find(workerEvb);
+    worker.setTransportFactory(
+        acceptor != evbToAcceptors_.end() ? acceptor->second
+                                          : transportFactory_.get());
+    worker.setFizzContext(ctx_);
+  }
+  if (healthCheckToken_) {
+    worker.setHealthCheckToken(*healthCheckToken_);
+  }
+  if (transportStatsFactory_) {
+    workerEvb->runInEventBaseThread(
+        [self = this->shared_from_this(),
+         workerEvb,
+         workerPtr = &worker,
+         transportStatsFactory = transportStatsFactory_.get()] {
+          if (self->shutdown_) {
+            return;
+          }
+          auto statsCallback = transportStatsFactory->make();
+          CHECK(statsCallback);
+          workerPtr->setTransportStatsCallback(std::move(statsCallback));
+        });
+  }
+  worker.setConnectionIdAlgo(connIdAlgoFactory_->make());
+  worker.setCongestionControllerFactory(ccFactory_);
+  if (pathStateCache_) {
+    worker.setPathStateCache(pathStateCache_);
+  }
+  if (receiveBufferAccountant_) {
+    worker.setReceiveBufferAccountant(receiveBufferAccountant_);
+  }
+  if (resumptionCache_) {
+    worker.setResumptionCache(resumptionCache_);
+  }
+  worker.setWorkerId(workerId);
+  worker.setTransportSettingsOverrideFn(transportSettingsOverrideFn_);
+}
+
 std::unique_ptr<QuicServerWorker> QuicServer::newWorkerWithoutSocket() {
   auto worker = std::make_unique<QuicServerWorker>(this->shared_from_this());
   worker->setNewConnectionSocketFactory(socketFactory_.get());
+  worker->setConnectedSocketFactory(listenerSocketFactory_.get());
   worker->setSupportedVersions(supportedVersions_);
-  worker->setTransportSettings(transportSettings_);
+  worker->updateTransportSettings(
+      transportSettings_, transportSettingsVersion_.load());
   worker->rejectNewConnections(rejectNewConnections_);
   worker->setProcessId(processId_);
   worker->setHostId(hostId_);
@@ -229,8 +323,23 @@ void QuicServer::bindWorkersToSocket(
                 << " processId=" << (int)processId;
         worker->setSocket(std::move(workerSocket));
         worker->bind(self->boundAddress_);
+        if (self->workersPinned_) {
+          auto set = setIncomingCpu(worker->getFD(), idx);
+          LOG_IF(WARNING, set.hasError())
+              << "Failed to set incoming cpu of workerId="
+              << (int)worker->getWorkerId() << ", errno=" << set.error();
+        }
         if (idx == 0) {
           self->boundAddress_ = worker->getAddress();
+          // The rest of the workers join the group in order, and share the
+          // program attached to it.
+          if (self->steerByWorkerId_) {
+            auto attached = attachWorkerIdSteeringProgram(
+                worker->getFD(), self->workersPinned_);
+            LOG_IF(WARNING, attached.hasError())
+                << "Failed to steer packets by worker id, errno="
+                << attached.error();
+          }
         }
       }
       if (idx == (numWorkers - 1)) {
@@ -251,9 +360,15 @@ void QuicServer::start() {
     workerPtr_.reset(
         worker, [](auto /* worker */, folly::TLPDestructionMode) {});
   });
+  // Each worker warms up and starts on its own thread, all at once.
   for (auto& worker : workers_) {
     worker->getEventBase()->runInEventBaseThread(
-        [&worker] { worker->start(); });
+        [w = worker.get(), warmUp = warmUpWorkers_] {
+          if (warmUp) {
+            w->warmUp();
+          }
+          w->start();
+        });
   }
 }
 
@@ -270,17 +385,12 @@ void QuicServer::allowBeingTakenOver(const folly::SocketAddress& addr) {
         !worker->getEventBase()->isRunning() ||
         !worker->getEventBase()->isInEventBaseThread());
   }
-  // TODO workers_ (vector) is not protected against concurrent modifications
-  auto numWorkers = workers_.size();
-  for (size_t i = 0; i < numWorkers; ++i) {
-    auto workerEvb = workers_[i]->getEventBase();
+  for (auto worker : activeWorkers()) {
+    auto workerEvb = worker->getEventBase();
     workerEvb->runInEventBaseThreadAndWait([&] {
       std::lock_guard<std::mutex> guard(startMutex_);
       CHECK(initialized_);
       auto localListenSocket = listenerSocketFactory_->make(workerEvb, -1);
-      auto it = evbToWorkers_.find(workerEvb);
-      CHECK(it != evbToWorkers_.end());
-      auto worker = it->second;
       worker->allowBeingTakenOver(std::move(localListenSocket), addr);
     });
   }
@@ -304,7 +414,7 @@ folly::SocketAddress QuicServer::overrideTakeoverHandlerAddress(
         !worker->getEventBase()->isInEventBaseThread());
   }
   folly::SocketAddress boundAddress;
-  for (auto& worker : workers_) {
+  for (auto worker : activeWorkers()) {
     worker->getEventBase()->runInEventBaseThreadAndWait([&] {
       std::lock_guard<std::mutex> guard(startMutex_);
       CHECK(initialized_);
@@ -355,19 +465,30 @@ void QuicServer::routeDataToWorker(
   // Without this, when (bpf / kernel) hash and userspace hash get out of sync
   // (e.g. due to shuffling of sockets in the hash ring), it results in
   // very high amount of 'misses'
+  const auto& routes = getRoutes();
+  QuicServerWorker* worker = nullptr;
   if (routingData.isUsingClientConnId && workerPtr_) {
     CHECK(workerPtr_->getEventBase()->isInEventBaseThread());
-    workerPtr_->dispatchPacketData(
-        client,
-        std::move(routingData),
-        std::move(networkData),
-        isForwardedData);
-    return;
+    if (!workerPtr_->isDraining() ||
+        workerPtr_->getSrcToTransportMap().count(
+            std::make_pair(client, routingData.destinationConnId))) {
+      workerPtr_->dispatchPacketData(
+          client,
+          std::move(routingData),
+          std::move(networkData),
+          isForwardedData);
+      return;
+    }
+    // A draining worker takes no new connections. Pick by the connection id
+    // the client chose, so that its retransmissions follow it.
+    worker = routes.running
+                 [ConnectionIdHash()(routingData.destinationConnId) %
+                  routes.running.size()];
+  } else {
+    worker =
+        getWorkerToRouteTo(routingData, routes.byWorkerId, connIdAlgo_.get());
   }
-
-  auto workerToRunOn =
-      getWorkerToRouteTo(routingData, workers_.size(), connIdAlgo_.get());
-  auto& worker = workers_[workerToRunOn];
+  size_t workerToRunOn = worker->getWorkerId();
   VLOG_IF(4, !worker->getEventBase()->isInEventBaseThread())
       << " Routing to worker in different EVB, to workerId=" << workerToRunOn;
   folly::EventBase* workerEvb = worker->getEventBase();
@@ -380,11 +501,43 @@ void QuicServer::routeDataToWorker(
         isForwardedData);
     return;
   }
+  // Batch the handoff through the target's queue when coming from another
+  // worker, so that a burst of misrouted packets costs the target one wakeup.
+  if (workerPtr_ && workerToRunOn < handoffQueues_.size()) {
+    auto& queue = *handoffQueues_[workerToRunOn];
+    auto source = workerPtr_->getWorkerId();
+    bool needsWakeup = false;
+    if (source < queue.numSources() &&
+        queue.enqueue(
+            source,
+            client,
+            routingData,
+            networkData,
+            isForwardedData,
+            needsWakeup)) {
+      if (needsWakeup) {
+        workerEvb->runInEventBaseThread(
+            [server = this->shared_from_this(), w = worker, q = &queue]() {
+              if (server->shutdown_) {
+                return;
+              }
+              q->drain([w](CrossWorkerPacketQueue::Packet& packet) {
+                w->dispatchPacketData(
+                    packet.client,
+                    std::move(packet.routingData),
+                    std::move(packet.networkData),
+                    packet.isForwardedData);
+              });
+            });
+      }
+      return;
+    }
+  }
   worker->getEventBase()->runInEventBaseThread(
       [server = this->shared_from_this(),
        cl = client,
        routingData = std::move(routingData),
-       w = worker.get(),
+       w = worker,
        buf = std::move(networkData),
        isForwarded = isForwardedData]() mutable {
         if (server->shutdown_) {
@@ -424,6 +577,29 @@ void QuicServer::shutdown(LocalErrorCode error) {
         !worker->getEventBase()->isInEventBaseThread());
   }
   shutdown_ = true;
+  if (transportSettings_.shutdownConnectionsPerLoop > 0) {
+    // All workers close their connections at once, each in batches.
+    std::vector<folly::Baton<>> closedBatons(workers_.size());
+    std::vector<folly::Baton<>*> pending;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+      auto evb = workers_[i]->getEventBase();
+      if (!evb->isRunning()) {
+        continue;
+      }
+      pending.push_back(&closedBatons[i]);
+      evb->runInEventBaseThread(
+          [worker = workers_[i].get(),
+           baton = &closedBatons[i],
+           error,
+           perLoop = transportSettings_.shutdownConnectionsPerLoop] {
+            worker->closeAllConnections(
+                error, perLoop, [baton] { baton->post(); });
+          });
+    }
+    for (auto baton : pending) {
+      baton->wait();
+    }
+  }
   for (auto& worker : workers_) {
     worker->getEventBase()->runInEventBaseThreadAndWait([&] {
       worker->shutdownAllConnections(error);
@@ -448,13 +624,13 @@ void QuicServer::runOnAllWorkers(
   if (shutdown_) {
     return;
   }
-  for (auto& worker : workers_) {
+  for (auto worker : activeWorkers()) {
     worker->getEventBase()->runInEventBaseThread(
-        [&worker, self = this->shared_from_this(), func]() mutable {
+        [worker, self = this->shared_from_this(), func]() mutable {
           if (self->shutdown_) {
             return;
           }
-          func(worker.get());
+          func(worker);
         });
   }
 }
@@ -465,13 +641,13 @@ void QuicServer::runOnAllWorkersSync(
   if (shutdown_) {
     return;
   }
-  for (auto& worker : workers_) {
+  for (auto worker : activeWorkers()) {
     worker->getEventBase()->runInEventBaseThreadAndWait(
-        [&worker, self = this->shared_from_this(), func]() mutable {
+        [worker, self = this->shared_from_this(), func]() mutable {
           if (self->shutdown_) {
             return;
           }
-          func(worker.get());
+          func(worker);
         });
   }
 }
@@ -533,12 +709,344 @@ void QuicServer::setTransportSettings(TransportSettings transportSettings) {
   });
 }
 
+uint64_t QuicServer::updateTransportSettings(
+    TransportSettings transportSettings) {
+  auto version = ++transportSettingsVersion_;
+  transportSettings_ = transportSettings;
+  runOnAllWorkers([transportSettings, version](auto worker) mutable {
+    worker->updateTransportSettings(std::move(transportSettings), version);
+  });
+  return version;
+}
+
 void QuicServer::rejectNewConnections(bool reject) {
   rejectNewConnections_ = reject;
   runOnAllWorkers(
       [reject](auto worker) mutable { worker->rejectNewConnections(reject); });
 }
 
+std::vector<ConnectionCpuTime> QuicServer::getWorkerCpuTimes() {
+  std::vector<ConnectionCpuTime> cpuTimes;
+  runOnAllWorkersSync(
+      [&](auto worker) { cpuTimes.push_back(worker->getCpuTime()); });
+  return cpuTimes;
+}
+
+std::vector<ConnectionCpuTimeSample> QuicServer::getTopCpuConnections(
+    size_t n) {
+  std::vector<ConnectionCpuTimeSample> samples;
+  runOnAllWorkersSync([&](auto worker) {
+    auto workerSamples = worker->getTopCpuConnections(n);
+    samples.insert(
+        samples.end(),
+        std::make_move_iterator(workerSamples.begin()),
+        std::make_move_iterator(workerSamples.end()));
+  });
+  auto byTotal = [](const ConnectionCpuTimeSample& a,
+                    const ConnectionCpuTimeSample& b) {
+    return a.cpuTime.total() > b.cpuTime.total();
+  };
+  std::sort(samples.begin(), samples.end(), byTotal);
+  if (samples.size() > n) {
+    samples.resize(n);
+  }
+  return samples;
+}
+
+std::vector<ConnectionMemoryUsage> QuicServer::getWorkerMemoryUsages() {
+  std::vector<ConnectionMemoryUsage> memoryUsages;
+  runOnAllWorkersSync(
+      [&](auto worker) { memoryUsages.push_back(worker->getMemoryUsage()); });
+  return memoryUsages;
+}
+
+std::vector<ConnectionMemoryUsageSample> QuicServer::getTopMemoryConnections(
+    size_t n) {
+  std::vector<ConnectionMemoryUsageSample> samples;
+  runOnAllWorkersSync([&](auto worker) {
+    auto workerSamples = worker->getTopMemoryConnections(n);
+    samples.insert(
+        samples.end(),
+        std::make_move_iterator(workerSamples.begin()),
+        std::make_move_iterator(workerSamples.end()));
+  });
+  auto byTotal = [](const ConnectionMemoryUsageSample& a,
+                    const ConnectionMemoryUsageSample& b) {
+    return a.memoryUsage.total() > b.memoryUsage.total();
+  };
+  std::sort(samples.begin(), samples.end(), byTotal);
+  if (samples.size() > n) {
+    samples.resize(n);
+  }
+  return samples;
+}
+
+size_t QuicServer::rebalanceConnections(size_t maxConnections) {
+  // By number of connections, then worker id.
+  std::vector<std::pair<size_t, size_t>> numConnections;
+  runOnAllWorkersSync([&](auto worker) {
+    // Draining workers keep their connections until they end.
+    if (!worker->isDraining()) {
+      numConnections.emplace_back(
+          worker->getNumBoundConnections(), worker->getWorkerId());
+    }
+  });
+  if (numConnections.size() < 2) {
+    return 0;
+  }
+  auto minmax =
+      std::minmax_element(numConnections.begin(), numConnections.end());
+  size_t cold = minmax.first->second;
+  size_t hot = minmax.second->second;
+  // Half the difference evens the two out.
+  auto toMove = std::min(
+      maxConnections, (minmax.second->first - minmax.first->first) / 2);
+  if (toMove == 0) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> guard(startMutex_);
+  if (shutdown_) {
+    return 0;
+  }
+  size_t moved = 0;
+  auto& from = workers_[hot];
+  from->getEventBase()->runInEventBaseThreadAndWait(
+      [&, self = this->shared_from_this()] {
+        if (self->shutdown_) {
+          return;
+        }
+        moved = from->moveConnectionsTo(*workers_[cold], toMove);
+      });
+  VLOG(4) << "Rebalanced " << moved << " connections from workerId=" << hot
+          << " to workerId=" << cold;
+  return moved;
+}
+
+size_t QuicServer::addWorkers(size_t numWorkers) {
+  CHECK(initialized_);
+  CHECK(!workerEvbs_.empty())
+      << "Workers can only be added to a server running its own threads";
+  CHECK(!takeoverHandlerInitialized_);
+  size_t added = 0;
+  // The workers still draining are the quickest to bring back.
+  for (size_t id = 0; id < workers_.size() && added < numWorkers; ++id) {
+    auto worker = workers_[id].get();
+    {
+      std::lock_guard<std::mutex> guard(resizeMutex_);
+      if (shutdown_) {
+        return added;
+      }
+      if (workerStates_[id] != WorkerState::Draining) {
+        continue;
+      }
+    }
+    worker->getEventBase()->runInEventBaseThreadAndWait([&] {
+      std::lock_guard<std::mutex> guard(resizeMutex_);
+      // Unless it retired meanwhile.
+      if (!shutdown_ && workerStates_[id] == WorkerState::Draining) {
+        worker->stopDraining();
+        workerStates_[id] = WorkerState::Running;
+        updateRoutes();
+        ++added;
+      }
+    });
+  }
+  for (size_t id = 0;
+       id < std::numeric_limits<uint8_t>::max() && added < numWorkers;
+       ++id) {
+    if (id < workers_.size()) {
+      std::lock_guard<std::mutex> guard(resizeMutex_);
+      if (workerStates_[id] != WorkerState::Retired) {
+        continue;
+      }
+    }
+    if (shutdown_) {
+      break;
+    }
+    startWorker(id);
+    ++added;
+  }
+  VLOG(4) << "Added " << added << " workers";
+  return added;
+}
+
+void QuicServer::startWorker(size_t workerId) {
+  bool reused = workerId < workers_.size();
+  auto workerEvb =
+      reused ? workers_[workerId]->getEventBase() : addWorkerEvb();
+  if (!reused && workersPinned_) {
+    workerEvb->runInEventBaseThreadAndWait(
+        [cpu = workerId] { pinCurrentThreadToCpu(cpu); });
+  }
+  auto newWorker = newWorkerWithoutSocket();
+  setUpWorker(*newWorker, workerEvb, workerId, true /* useDefaultTransport */);
+  auto worker = newWorker.get();
+  workerEvb->runInEventBaseThreadAndWait([&] {
+    worker->setSocketOptions(&socketOptions_);
+    worker->setSocket(listenerSocketFactory_->make(workerEvb, -1));
+    // Joins the reuseport group of the other workers.
+    worker->bind(boundAddress_);
+    if (workersPinned_) {
+      auto set = setIncomingCpu(worker->getFD(), workerId);
+      LOG_IF(WARNING, set.hasError())
+          << "Failed to set incoming cpu of workerId=" << workerId
+          << ", errno=" << set.error();
+    }
+  });
+  std::unique_ptr<QuicServerWorker> retired;
+  {
+    std::lock_guard<std::mutex> startGuard(startMutex_);
+    std::lock_guard<std::mutex> guard(resizeMutex_);
+    evbToWorkers_[workerEvb] = worker;
+    if (reused) {
+      retired = std::move(workers_[workerId]);
+      workers_[workerId] = std::move(newWorker);
+      workerStates_[workerId] = WorkerState::Running;
+    } else {
+      workers_.push_back(std::move(newWorker));
+      workerStates_.push_back(WorkerState::Running);
+    }
+    updateRoutes();
+  }
+  workerEvb->runInEventBaseThreadAndWait([&] {
+    workerPtr_.reset(
+        worker, [](auto /* worker */, folly::TLPDestructionMode) {});
+    worker->start();
+  });
+  VLOG(4) << "Started workerId=" << workerId << " on " << boundAddress_;
+  if (retired) {
+    // Once every worker thread is past the routes that had the retired one,
+    // nothing hands it packets anymore but what is queued on its thread.
+    for (auto& evb : workerEvbs_) {
+      evb->getEventBase()->runInEventBaseThreadAndWait([] {});
+    }
+    workerEvb->runInEventBaseThread(
+        [retired = std::move(retired)]() mutable { retired.reset(); });
+  }
+}
+
+size_t QuicServer::removeWorkers(
+    size_t numWorkers,
+    std::chrono::milliseconds drainTimeout) {
+  CHECK(initialized_);
+  CHECK(!workerEvbs_.empty())
+      << "Workers can only be removed from a server running its own threads";
+  CHECK(!takeoverHandlerInitialized_);
+  std::vector<QuicServerWorker*> removing;
+  {
+    std::lock_guard<std::mutex> guard(resizeMutex_);
+    if (shutdown_) {
+      return 0;
+    }
+    // Highest ids first, so that the workers left keep their place in the
+    // reuseport group.
+    for (size_t id = workers_.size() - 1;
+         id > 0 && removing.size() < numWorkers;
+         --id) {
+      if (workerStates_[id] == WorkerState::Running) {
+        removing.push_back(workers_[id].get());
+      }
+    }
+  }
+  for (auto worker : removing) {
+    worker->getEventBase()->runInEventBaseThreadAndWait([&] {
+      std::lock_guard<std::mutex> guard(resizeMutex_);
+      auto id = worker->getWorkerId();
+      if (shutdown_ || workerStates_[id] != WorkerState::Running) {
+        return;
+      }
+      workerStates_[id] = WorkerState::Draining;
+      updateRoutes();
+      worker->drain(
+          drainTimeout, [self = this->shared_from_this(), worker] {
+            self->retireWorker(worker);
+          });
+    });
+  }
+  VLOG(4) << "Removing " << removing.size() << " workers";
+  return removing.size();
+}
+
+void QuicServer::retireWorker(QuicServerWorker* worker) {
+  CHECK(worker->getEventBase()->isInEventBaseThread());
+  {
+    std::lock_guard<std::mutex> guard(resizeMutex_);
+    auto id = worker->getWorkerId();
+    if (shutdown_ || workers_[id].get() != worker ||
+        workerStates_[id] != WorkerState::Draining) {
+      return;
+    }
+    workerStates_[id] = WorkerState::Retired;
+    updateRoutes();
+  }
+  VLOG(4) << "Retiring workerId=" << (uint32_t)worker->getWorkerId();
+  // Closes its socket too, which takes it out of the reuseport group.
+  worker->shutdownAllConnections(LocalErrorCode::SHUTTING_DOWN);
+  workerPtr_.reset();
+}
+
+size_t QuicServer::getNumWorkers() const {
+  std::lock_guard<std::mutex> guard(resizeMutex_);
+  return std::count(
+      workerStates_.begin(), workerStates_.end(), WorkerState::Running);
+}
+
+std::vector<QuicServerWorker*> QuicServer::activeWorkers() const {
+  std::lock_guard<std::mutex> guard(resizeMutex_);
+  std::vector<QuicServerWorker*> workers;
+  for (size_t id = 0; id < workers_.size(); ++id) {
+    if (workerStates_[id] != WorkerState::Retired) {
+      workers.push_back(workers_[id].get());
+    }
+  }
+  return workers;
+}
+
+void QuicServer::updateRoutes() {
+  auto routes = std::make_shared<WorkerRoutes>();
+  for (size_t id = 0; id < workers_.size(); ++id) {
+    if (workerStates_[id] == WorkerState::Running) {
+      routes->running.push_back(workers_[id].get());
+    }
+  }
+  CHECK(!routes->running.empty());
+  // The connections of a retired worker are gone, its ids go to any other.
+  for (size_t id = 0; id < workers_.size(); ++id) {
+    routes->byWorkerId.push_back(
+        workerStates_[id] == WorkerState::Retired
+            ? routes->running[id % routes->running.size()]
+            : workers_[id].get());
+  }
+  std::atomic_store(
+      &routes_, std::shared_ptr<const WorkerRoutes>(std::move(routes)));
+  routesVersion_.fetch_add(1, std::memory_order_release);
+}
+
+const QuicServer::WorkerRoutes& QuicServer::getRoutes() {
+  auto& local = *localRoutes_;
+  auto version = routesVersion_.load(std::memory_order_acquire);
+  // Only looked up again when they change.
+  if (!local.routes || local.version != version) {
+    local.routes = std::atomic_load(&routes_);
+    local.version = version;
+  }
+  return *local.routes;
+}
+
+void QuicServer::setSteerByWorkerId(bool steer) {
+  CHECK(!initialized_);
+  steerByWorkerId_ = steer;
+}
+
+void QuicServer::setPinWorkersToCpus(bool pin) {
+  CHECK(!initialized_);
+  pinWorkersToCpus_ = pin;
+}
+
+void QuicServer::setWarmUpWorkers(bool warmUp) {
+  warmUpWorkers_ = warmUp;
+}
+
 void QuicServer::enablePartialReliability(bool enabled) {
   transportSettings_.partialReliabilityEnabled = enabled;
   runOnAllWorkers([enabled](auto worker) mutable {
@@ -553,9 +1061,8 @@ void QuicServer::setEventBaseObserver(
   }
   workerEvbs_.front()->getEventBase()->runInEventBaseThreadAndWait(
       [&] { evbObserver_ = observer; });
-  runOnAllWorkers([observer](auto worker) {
-    worker->getEventBase()->setObserver(observer);
-  });
+  runOnAllWorkers(
+      [observer](auto worker) { worker->setEventBaseObserver(observer); });
 };
 
 void QuicServer::startPacketForwarding(const folly::SocketAddress& destAddr) {
@@ -571,15 +1078,15 @@ void QuicServer::stopPacketForwarding(std::chrono::milliseconds delay) {
   if (!initialized_ || shutdown_) {
     return;
   }
-  for (auto& worker : workers_) {
+  for (auto worker : activeWorkers()) {
     worker->getEventBase()->runInEventBaseThreadAndWait(
-        [&worker, self = this->shared_from_this(), delay]() mutable {
+        [worker, self = this->shared_from_this(), delay]() mutable {
           if (self->shutdown_) {
             return;
           }
           worker->getEventBase()->runAfterDelay(
-              [&worker, self]() mutable {
-                if (worker && !self->shutdown_) {
+              [worker, self]() mutable {
+                if (!self->shutdown_) {
                   worker->stopPacketForwarding();
                 }
               },
@@ -641,8 +1148,9 @@ int QuicServer::getListeningSocketFD() const {
 std::vector<int> QuicServer::getAllListeningSocketFDs() const noexcept {
   CHECK(initialized_) << "Quic server is not initialized. "
                       << "Consider calling waitUntilInitialized() before this ";
-  std::vector<int> sockets(workers_.size());
-  for (const auto& worker : workers_) {
+  // Retired workers have none, the server taking over binds in their place.
+  std::vector<int> sockets(workers_.size(), -1);
+  for (auto worker : activeWorkers()) {
     if (worker->getFD() != -1) {
       CHECK_LT(worker->getWorkerId(), workers_.size());
       sockets.at(worker->getWorkerId()) = worker->getFD();
@@ -664,7 +1172,7 @@ int QuicServer::getTakeoverHandlerSocketFD() const {
 std::vector<folly::EventBase*> QuicServer::getWorkerEvbs() const noexcept {
   CHECK(initialized_) << "Quic server is not initialized. ";
   std::vector<folly::EventBase*> ebvs;
-  for (const auto& worker : workers_) {
+  for (auto worker : activeWorkers()) {
     ebvs.push_back(worker->getEventBase());
   }
   return ebvs;
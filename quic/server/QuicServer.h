@@ -20,6 +20,7 @@
 #include <quic/QuicConstants.h>
 #include <quic/codec/ConnectionIdAlgo.h>
 #include <quic/congestion_control/CongestionControllerFactory.h>
+#include <quic/server/CrossWorkerPacketQueue.h>
 #include <quic/server/QuicServerTransportFactory.h>
 #include <quic/server/QuicServerWorker.h>
 #include <quic/server/QuicUDPSocketFactory.h>
@@ -27,6 +28,8 @@
 
 namespace quic {
 
+constexpr std::chrono::seconds kDefaultWorkerDrainTimeout{30};
+
 class QuicServer : public QuicServerWorker::WorkerCallback,
                    public std::enable_shared_from_this<QuicServer> {
  public:
@@ -64,7 +67,9 @@ class QuicServer : public QuicServerWorker::WorkerCallback,
   /*
    * Take in a function to supply overrides for transport parameters, given
    * the client address as input. This can be useful if we are running
-   * experiments.
+   * experiments, or to pick a congestion controller per peer, e.g. by setting
+   * TransportSettings::congestionControllerName to one registered with the
+   * DefaultCongestionControllerFactory.
    */
   void setTransportSettingsOverrideFn(TransportSettingsOverrideFn fn);
 
@@ -99,6 +104,29 @@ class QuicServer : public QuicServerWorker::WorkerCallback,
   void setCongestionControllerFactory(
       std::shared_ptr<CongestionControllerFactory> ccFactory);
 
+  /**
+   * Share one cache of learned path state between all the workers, instead
+   * of one per worker. Only used if TransportSettings::cachePathState is set.
+   * This must be set before the server is initialized.
+   */
+  void setPathStateCache(std::shared_ptr<PathStateCache> pathStateCache);
+
+  /**
+   * Share one cache of decoded resumption state between all the workers, to
+   * validate the app tokens of resumed sessions with. Pass the same cache to
+   * a CachingTicketCipher in the fizz context so that tickets skip decryption
+   * as well. This must be set before the server is initialized.
+   */
+  void setResumptionCache(std::shared_ptr<ResumptionCache> resumptionCache);
+
+  /**
+   * Set a process wide budget of bytes buffered for reading, shared by all
+   * the workers, on top of TransportSettings::workerReceiveBufferLimit.
+   * This must be set before the server is initialized.
+   */
+  void setReceiveBufferAccountant(
+      std::shared_ptr<ReceiveBufferAccountant> accountant);
+
   /**
    * Set list of supported QUICVersion for this server. These versions will be
    * used during the 'Version-Negotiation' phase with the client.
@@ -158,11 +186,113 @@ class QuicServer : public QuicServerWorker::WorkerCallback,
    */
   void setTransportSettings(TransportSettings transportSettings);
 
+  /**
+   * Like setTransportSettings, and also applies the fields which can change on
+   * a live connection, see copyLiveTransportSettings(), to the existing
+   * connections of every worker. Returns the version of the settings, which
+   * each worker reports with getTransportSettingsVersion() once it applied
+   * them. Rolling back is updating to the previous settings again.
+   */
+  uint64_t updateTransportSettings(TransportSettings transportSettings);
+
   /**
    * Tells the server to start rejecting any new connection
    */
   void rejectNewConnections(bool reject);
 
+  /**
+   * The time each worker's connections spent on its event loop, in the order
+   * of the workers. Needs TransportSettings::trackCpuTime, and blocks until
+   * every worker has answered.
+   */
+  std::vector<ConnectionCpuTime> getWorkerCpuTimes();
+
+  /**
+   * The n connections across all workers with the most time on the event
+   * loop, most first, to find the connections that load a worker.
+   */
+  std::vector<ConnectionCpuTimeSample> getTopCpuConnections(size_t n);
+
+  /**
+   * The memory each worker's connections hold, in the order of the workers.
+   * Blocks until every worker has answered.
+   */
+  std::vector<ConnectionMemoryUsage> getWorkerMemoryUsages();
+
+  /**
+   * The n connections across all workers holding the most memory, most
+   * first.
+   */
+  std::vector<ConnectionMemoryUsageSample> getTopMemoryConnections(size_t n);
+
+  /**
+   * Moves up to maxConnections idle connections, as per isDetachable(), from
+   * the worker with the most connections to the one with the fewest, and
+   * returns how many. Callbacks of a moved connection run on the thread of
+   * its new worker afterwards, so only call this if the application allows
+   * for that. Must not be called from a worker thread.
+   */
+  size_t rebalanceConnections(size_t maxConnections);
+
+  /**
+   * Starts up to numWorkers more workers and returns how many it started.
+   * Workers that are being removed are kept instead first, then the worker
+   * ids of the removed ones are reused, lowest first, before new ids are
+   * handed out, so the ids in use stay contiguous. Each new worker binds its
+   * own socket to the server's address, joining the reuseport group at the
+   * end. At most 255 workers, the worker ids the connection ids have room
+   * for. Only for servers started with start(address, maxWorkers), and not
+   * together with takeover. Must not be called from a worker thread.
+   */
+  size_t addWorkers(size_t numWorkers);
+
+  /**
+   * Removes up to numWorkers workers, the ones with the highest ids, and
+   * returns how many. Worker 0 is never removed. A removed worker gets no new
+   * connections. It keeps serving its own, along with the packets for their
+   * connection ids that reach the other workers, until they have all ended or
+   * drainTimeout passed; then the rest are closed and its socket leaves the
+   * reuseport group, whose share of the packets goes to the remaining
+   * workers. Connections rebalanceConnections() moved off a removed worker
+   * only keep the connection ids issued after the move. Same restrictions as
+   * addWorkers().
+   */
+  size_t removeWorkers(
+      size_t numWorkers,
+      std::chrono::milliseconds drainTimeout = kDefaultWorkerDrainTimeout);
+
+  /**
+   * The number of workers taking new connections.
+   */
+  size_t getNumWorkers() const;
+
+  /**
+   * Have the kernel pick the listening socket of a short header packet from
+   * the worker id in its connection id, instead of from the 4-tuple, so that
+   * packets of migrated clients don't need to be handed off between workers.
+   * Only valid with the default ConnectionIdAlgo, and must be set before the
+   * server starts.
+   */
+  void setSteerByWorkerId(bool steer);
+
+  /**
+   * Pin the thread of worker i to CPU i, and have the kernel prefer worker i's
+   * socket for packets received on CPU i, so a packet is handled on the core,
+   * and NUMA node, the NIC queue delivered it to. With setSteerByWorkerId,
+   * long header packets are steered by CPU this way. The buffers of a worker
+   * are allocated from its own thread, so they end up on its node too.
+   * Only applies to the workers start(address, maxWorkers) makes threads for,
+   * and must be set before then.
+   */
+  void setPinWorkersToCpus(bool pin);
+
+  /**
+   * Whether start() has every worker do the allocations of its first
+   * connections up front, see QuicServerWorker::warmUp(), before it starts
+   * reading. The workers warm up in parallel. On by default.
+   */
+  void setWarmUpWorkers(bool warmUp);
+
   /**
    * Tells the server to disable partial reliability in transport settings.
    * Any new connections negotiated after will have partial reliability enabled
@@ -324,6 +454,45 @@ class QuicServer : public QuicServerWorker::WorkerCallback,
 
   std::unique_ptr<QuicServerWorker> newWorkerWithoutSocket();
 
+  // Everything about a worker that doesn't need its thread.
+  void setUpWorker(
+      QuicServerWorker& worker,
+      folly::EventBase* workerEvb,
+      size_t workerId,
+      bool useDefaultTransport);
+
+  folly::EventBase* addWorkerEvb();
+
+  // Binds a new worker with the given id and starts it, in place of the
+  // retired one with that id if any.
+  void startWorker(size_t workerId);
+
+  // Called on the worker's thread once it has drained.
+  void retireWorker(QuicServerWorker* worker);
+
+  // Workers that aren't retired.
+  std::vector<QuicServerWorker*> activeWorkers() const;
+
+  // Publishes the workers to route to. Called with resizeMutex_ held.
+  void updateRoutes();
+
+  enum class WorkerState : uint8_t { Running, Draining, Retired };
+
+  struct WorkerRoutes {
+    // The worker for the connection ids of each worker id.
+    std::vector<QuicServerWorker*> byWorkerId;
+    // The workers that take new connections.
+    std::vector<QuicServerWorker*> running;
+  };
+
+  // The routes this thread last looked at.
+  struct LocalRoutes {
+    uint64_t version{0};
+    std::shared_ptr<const WorkerRoutes> routes;
+  };
+
+  const WorkerRoutes& getRoutes();
+
   // helper method to run the given function in all worker asynchronously
   void runOnAllWorkers(const std::function<void(QuicServerWorker*)>& func);
 
@@ -339,6 +508,7 @@ class QuicServer : public QuicServerWorker::WorkerCallback,
   std::atomic<bool> shutdown_{true};
   std::shared_ptr<const fizz::server::FizzServerContext> ctx_;
   TransportSettings transportSettings_;
+  std::atomic<uint64_t> transportSettingsVersion_{0};
   std::mutex startMutex_;
   std::atomic<bool> initialized_{false};
   std::atomic<bool> workersInitialized_{false};
@@ -352,6 +522,15 @@ class QuicServer : public QuicServerWorker::WorkerCallback,
   // their destruction
   folly::ThreadLocalPtr<QuicServerWorker> workerPtr_;
   folly::F14FastMap<folly::EventBase*, QuicServerWorker*> evbToWorkers_;
+  // Guards workers_ and workerStates_ for the worker threads. Only the
+  // thread controlling the server changes them, apart from retiring.
+  mutable std::mutex resizeMutex_;
+  std::vector<WorkerState> workerStates_;
+  std::shared_ptr<const WorkerRoutes> routes_;
+  std::atomic<uint64_t> routesVersion_{0};
+  folly::ThreadLocal<LocalRoutes> localRoutes_;
+  // Packets handed off to each worker by the other workers, by worker id.
+  std::vector<std::unique_ptr<CrossWorkerPacketQueue>> handoffQueues_;
   std::unique_ptr<QuicServerTransportFactory> transportFactory_;
   folly::F14FastMap<folly::EventBase*, QuicServerTransportFactory*>
       evbToAcceptors_;
@@ -361,6 +540,11 @@ class QuicServer : public QuicServerWorker::WorkerCallback,
   std::unique_ptr<QuicUDPSocketFactory> socketFactory_;
   // factory used to create specific instance of Congestion control algorithm
   std::shared_ptr<CongestionControllerFactory> ccFactory_;
+  // cache of learned path state shared by the workers, if any
+  std::shared_ptr<PathStateCache> pathStateCache_;
+  std::shared_ptr<ResumptionCache> resumptionCache_;
+  // budget of bytes buffered for reading shared by the workers, if any
+  std::shared_ptr<ReceiveBufferAccountant> receiveBufferAccountant_;
 
   std::shared_ptr<folly::EventBaseObserver> evbObserver_;
   folly::Optional<std::string> healthCheckToken_;
@@ -369,6 +553,11 @@ class QuicServer : public QuicServerWorker::WorkerCallback,
   ProcessId processId_{ProcessId::ZERO};
   uint16_t hostId_{0};
   bool rejectNewConnections_{false};
+  bool steerByWorkerId_{false};
+  bool pinWorkersToCpus_{false};
+  // Whether each worker is running on the CPU of its id.
+  bool workersPinned_{false};
+  bool warmUpWorkers_{true};
   // factory to create per worker QuicTransportStatsCallback
   std::unique_ptr<QuicTransportStatsCallbackFactory> transportStatsFactory_;
   // factory to create per worker ConnectionIdAlgo
@@ -13,6 +13,12 @@
 #include <quic/server/QuicServerPacketRouter.h>
 #include <quic/server/QuicServerWorker.h>
 
+#ifndef MSG_WAITFORONE
+#define RECVMMSG_FLAGS 0
+#else
+#define RECVMMSG_FLAGS MSG_WAITFORONE
+#endif
+
 namespace quic {
 
 /* Set max for the allocation of buffer to extract TakeoverProtocol related
@@ -104,6 +110,80 @@ void TakeoverHandlerCallback::onDataAvailable(
   takeoverPktHandler_.processForwardedPacket(client, std::move(data));
 }
 
+bool TakeoverHandlerCallback::shouldOnlyNotify() {
+  return transportSettings_.shouldRecvBatch;
+}
+
+void TakeoverHandlerCallback::onNotifyDataAvailable(
+    folly::AsyncUDPSocket& sock) noexcept {
+  folly::DelayedDestruction::DestructorGuard dg(this);
+  const size_t addrLen = sizeof(struct sockaddr_storage);
+  const size_t numPackets = transportSettings_.maxRecvBatchSize;
+  const size_t readBufferSize = transportSettings_.maxRecvPacketSize +
+      kMaxBufSizeForTakeoverEncapsulation;
+  recvmmsgStorage_.resize(numPackets);
+
+  auto& msgs = recvmmsgStorage_.msgs;
+  auto& addrs = recvmmsgStorage_.addrs;
+  auto& readBuffers = recvmmsgStorage_.readBuffers;
+  auto& iovecs = recvmmsgStorage_.iovecs;
+  for (size_t i = 0; i < numPackets; ++i) {
+    if (!readBuffers[i]) {
+      readBuffers[i] = folly::IOBuf::create(readBufferSize);
+    }
+    iovecs[i].iov_base = readBuffers[i]->writableData();
+    iovecs[i].iov_len = readBufferSize;
+
+    auto* rawAddr = reinterpret_cast<sockaddr*>(&addrs[i]);
+    rawAddr->sa_family = sock.address().getFamily();
+
+    struct msghdr* msg = &msgs[i].msg_hdr;
+    msg->msg_name = rawAddr;
+    msg->msg_namelen = addrLen;
+    msg->msg_iov = &iovecs[i];
+    msg->msg_iovlen = 1;
+    msg->msg_control = nullptr;
+    msg->msg_controllen = 0;
+  }
+
+  int numMsgsRecvd =
+      sock.recvmmsg(msgs.data(), numPackets, RECVMMSG_FLAGS, nullptr);
+  if (numMsgsRecvd < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return;
+    }
+    return onReadError(folly::AsyncSocketException(
+        folly::AsyncSocketException::INTERNAL_ERROR,
+        "::recvmmsg() failed",
+        errno));
+  }
+  VLOG(10) << "Worker=" << this << " Received " << numMsgsRecvd
+           << " (takeover) messages on thread=" << folly::getCurrentThreadID()
+           << ", workerId=" << static_cast<uint32_t>(worker_->getWorkerId());
+  for (int i = 0; i < numMsgsRecvd; ++i) {
+    QUIC_STATS(worker_->getStatsCallback(), onForwardedPacketReceived);
+    size_t bytesRead = msgs[i].msg_len;
+    if (bytesRead == 0 || (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+      continue;
+    }
+    folly::SocketAddress client;
+    try {
+      client.setFromSockaddr(
+          reinterpret_cast<sockaddr*>(&addrs[i]), msgs[i].msg_hdr.msg_namelen);
+    } catch (const std::exception& ex) {
+      VLOG(4) << "Dropping forwarded packet with invalid address: "
+              << ex.what();
+      continue;
+    }
+    Buf data = std::move(readBuffers[i]);
+    data->append(bytesRead);
+    takeoverPktHandler_.processForwardedPacket(client, std::move(data));
+    if (!socket_) {
+      return;
+    }
+  }
+}
+
 void TakeoverHandlerCallback::onReadError(
     const folly::AsyncSocketException& ex) noexcept {
   folly::DelayedDestruction::DestructorGuard dg(this);
@@ -167,8 +247,30 @@ void TakeoverPacketHandler::forwardPacket(Buf writeBuffer) {
     folly::SocketAddress localAddress;
     localAddress.setFromHostPort("::1", 0);
     pktForwardingSocket_->bind(localAddress);
+    // Forwarded packets have different sizes, so they can't share a GSO
+    // segment size.
+    batchWriter_ = BatchWriterFactory::makeBatchWriter(
+        *pktForwardingSocket_,
+        QuicBatchingMode::BATCHING_MODE_SENDMMSG,
+        kMaxForwardedPacketBatch);
+  }
+  auto size = writeBuffer->computeChainDataLength();
+  if (batchWriter_->needsFlush(size)) {
+    flushForwardedPackets();
+  }
+  if (batchWriter_->append(std::move(writeBuffer), size)) {
+    flushForwardedPackets();
+  }
+}
+
+void TakeoverPacketHandler::flushForwardedPackets() {
+  if (!batchWriter_ || batchWriter_->empty()) {
+    return;
   }
-  pktForwardingSocket_->write(pktForwardDestAddr_, std::move(writeBuffer));
+  // Like a single write, a partial or failed write just drops the rest,
+  // which the client will retransmit.
+  batchWriter_->write(*pktForwardingSocket_, pktForwardDestAddr_);
+  batchWriter_->reset();
 }
 
 std::unique_ptr<folly::AsyncUDPSocket> TakeoverPacketHandler::makeSocket(
@@ -251,6 +353,7 @@ void TakeoverPacketHandler::processForwardedPacket(
 
 void TakeoverPacketHandler::stop() {
   packetForwardingEnabled_ = false;
+  batchWriter_.reset();
   pktForwardingSocket_.reset();
 }
 } // namespace quic
@@ -11,6 +11,7 @@
 #include <folly/io/async/AsyncUDPSocket.h>
 
 #include <quic/QuicConstants.h>
+#include <quic/api/QuicBatchWriter.h>
 #include <quic/codec/ConnectionIdAlgo.h>
 #include <quic/server/QuicServerTransportFactory.h>
 #include <quic/server/QuicUDPSocketFactory.h>
@@ -32,6 +33,9 @@ enum class TakeoverProtocolVersion : uint32_t {
   V0 = 0x00000001,
 };
 
+// Max number of forwarded packets sent to the other server in one sendmmsg.
+constexpr size_t kMaxForwardedPacketBatch = kDefaultQuicMaxBatchSize;
+
 struct RoutingData {
   HeaderForm headerForm;
   bool isInitial;
@@ -81,6 +85,13 @@ class TakeoverPacketHandler {
 
   void processForwardedPacket(const folly::SocketAddress& client, Buf data);
 
+  /**
+   * Forwarded packets are held in a BatchWriter until this is called, or
+   * until kMaxForwardedPacketBatch of them are held, and then sent with one
+   * sendmmsg.
+   */
+  void flushForwardedPackets();
+
   void stop();
 
   TakeoverProtocolVersion getTakeoverProtocolVersion() const noexcept {
@@ -101,6 +112,8 @@ class TakeoverPacketHandler {
   std::unique_ptr<folly::AsyncUDPSocket> pktForwardingSocket_;
   bool packetForwardingEnabled_{false};
   QuicUDPSocketFactory* socketFactory_{nullptr};
+  // Encapsulated packets waiting for flushForwardedPackets().
+  std::unique_ptr<BatchWriter> batchWriter_;
 };
 
 /**
@@ -146,6 +159,12 @@ class TakeoverHandlerCallback : public folly::AsyncUDPSocket::ReadCallback,
       bool truncated,
       OnDataAvailableParams params) noexcept override;
 
+  // With TransportSettings::shouldRecvBatch, forwarded packets are read with
+  // recvmmsg, like the worker's own socket.
+  bool shouldOnlyNotify() override;
+
+  void onNotifyDataAvailable(folly::AsyncUDPSocket& sock) noexcept override;
+
   void onReadError(const folly::AsyncSocketException& ex) noexcept override;
 
   void onReadClosed() noexcept override;
@@ -159,5 +178,7 @@ class TakeoverHandlerCallback : public folly::AsyncUDPSocket::ReadCallback,
   folly::SocketAddress address_;
   std::unique_ptr<folly::AsyncUDPSocket> socket_;
   Buf readBuffer_;
+  // Message headers and read buffers reused across recvmmsg calls.
+  RecvmmsgStorage recvmmsgStorage_;
 };
 } // namespace quic
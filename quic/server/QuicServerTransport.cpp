@@ -8,6 +8,7 @@
 
 #include <quic/server/QuicServerTransport.h>
 
+#include <quic/common/SocketUtil.h>
 #include <quic/server/handshake/AppToken.h>
 #include <quic/server/handshake/DefaultAppTokenValidator.h>
 #include <quic/server/handshake/StatelessResetGenerator.h>
@@ -86,6 +87,61 @@ void QuicServerTransport::setConnectionIdAlgo(
   }
 }
 
+void QuicServerTransport::setBufAccessor(BufAccessor* bufAccessor) noexcept {
+  CHECK(bufAccessor);
+  if (conn_) {
+    conn_->bufAccessor = bufAccessor;
+  }
+}
+
+void QuicServerTransport::setPacketBufArena(
+    PacketBufArena* bufArena) noexcept {
+  CHECK(bufArena);
+  if (conn_) {
+    conn_->bufArena = bufArena;
+  }
+}
+
+void QuicServerTransport::setZeroCopyTracker(
+    ZeroCopySendTracker* zeroCopyTracker) noexcept {
+  CHECK(zeroCopyTracker);
+  if (conn_) {
+    conn_->zeroCopyTracker = zeroCopyTracker;
+  }
+}
+
+void QuicServerTransport::setEgressBatch(
+    SharedEgressBatch* egressBatch) noexcept {
+  CHECK(egressBatch);
+  egressBatch_ = egressBatch;
+  if (conn_ && !sharedSocket_) {
+    conn_->egressBatch = egressBatch;
+  }
+}
+
+void QuicServerTransport::setConnectedSocketFactory(
+    QuicUDPSocketFactory* socketFactory) noexcept {
+  CHECK(socketFactory);
+  connectedSocketFactory_ = socketFactory;
+}
+
+bool QuicServerTransport::usesConnectedSocket() const {
+  return sharedSocket_ != nullptr;
+}
+
+void QuicServerTransport::setTransportParametersCache(
+    ServerTransportParametersCache* cache) noexcept {
+  CHECK(cache);
+  if (serverConn_) {
+    serverConn_->transportParametersCache = cache;
+  }
+}
+
+void QuicServerTransport::setResumptionCache(
+    std::shared_ptr<ResumptionCache> resumptionCache) {
+  resumptionCache_ = std::move(resumptionCache);
+}
+
 void QuicServerTransport::setServerConnectionIdRejector(
     ServerConnectionIdRejector* connIdRejector) noexcept {
   CHECK(connIdRejector);
@@ -94,6 +150,13 @@ void QuicServerTransport::setServerConnectionIdRejector(
   }
 }
 
+void QuicServerTransport::setServerConnectionIdPool(
+    ServerConnectionIdPool* connIdPool) noexcept {
+  if (serverConn_) {
+    serverConn_->connIdPool = connIdPool;
+  }
+}
+
 void QuicServerTransport::setCongestionControllerFactory(
     std::shared_ptr<CongestionControllerFactory> ccFactory) {
   CHECK(ccFactory);
@@ -112,6 +175,10 @@ void QuicServerTransport::onReadData(
   bool waitingForFirstPacket = !hasReceivedPackets(*conn_);
   onServerReadData(*serverConn_, readData);
   processPendingData(true);
+  if (sharedSocket_ && conn_->peerAddress != connectedPeerAddress_) {
+    VLOG(4) << "Peer migrated off the connected socket " << *this;
+    moveToSharedSocket();
+  }
 
   if (closeState_ == CloseState::CLOSED) {
     return;
@@ -130,6 +197,7 @@ void QuicServerTransport::onReadData(
   maybeNotifyConnectionIdBound();
   maybeIssueConnectionIds();
   maybeNotifyTransportReady();
+  maybeMoveToConnectedSocket();
 }
 
 void QuicServerTransport::accept() {
@@ -140,7 +208,8 @@ void QuicServerTransport::accept() {
       evb_,
       ctx_,
       this,
-      std::make_unique<DefaultAppTokenValidator>(serverConn_));
+      std::make_unique<DefaultAppTokenValidator>(
+          serverConn_, resumptionCache_));
 }
 
 void QuicServerTransport::writeData() {
@@ -190,11 +259,24 @@ void QuicServerTransport::writeData() {
           *conn_->initialWriteCipher,
           *conn_->initialHeaderCipher,
           version);
+    } else if (conn_->handshakeWriteCipher) {
+      CHECK(conn_->handshakeWriteHeaderCipher);
+      writeLongClose(
+          *socket_,
+          *conn_,
+          srcConnId /* src */,
+          destConnId /* dst */,
+          LongHeader::Types::Handshake,
+          conn_->localConnectionError,
+          *conn_->handshakeWriteCipher,
+          *conn_->handshakeWriteHeaderCipher,
+          version);
     }
     return;
   }
 
-  if (!conn_->initialWriteCipher) {
+  if (!conn_->initialWriteCipher && !conn_->handshakeWriteCipher &&
+      !conn_->oneRttWriteCipher) {
     // This would be possible if we read a packet from the network which
     // could not be parsed later.
     return;
@@ -209,10 +291,11 @@ void QuicServerTransport::writeData() {
   CryptoStreamScheduler handshakeScheduler(
       *conn_,
       *getCryptoStream(*conn_->cryptoState, EncryptionLevel::Handshake));
-  if (initialScheduler.hasData() ||
-      (conn_->ackStates.initialAckState.needsToSendAckImmediately &&
-       hasAcksToSchedule(conn_->ackStates.initialAckState))) {
-    CHECK(conn_->initialWriteCipher);
+  // The keys of a space are gone once it's done with.
+  if (conn_->initialWriteCipher &&
+      (initialScheduler.hasData() ||
+       (conn_->ackStates.initialAckState.needsToSendAckImmediately &&
+        hasAcksToSchedule(conn_->ackStates.initialAckState)))) {
     CHECK(conn_->initialHeaderCipher);
     packetLimit -= writeCryptoAndAckDataToSocket(
         *socket_,
@@ -226,12 +309,13 @@ void QuicServerTransport::writeData() {
         packetLimit);
   }
   if (!packetLimit) {
+    writeCoalescedPackets(*socket_, *conn_);
     return;
   }
-  if (handshakeScheduler.hasData() ||
-      (conn_->ackStates.handshakeAckState.needsToSendAckImmediately &&
-       hasAcksToSchedule(conn_->ackStates.handshakeAckState))) {
-    CHECK(conn_->handshakeWriteCipher);
+  if (conn_->handshakeWriteCipher &&
+      (handshakeScheduler.hasData() ||
+       (conn_->ackStates.handshakeAckState.needsToSendAckImmediately &&
+        hasAcksToSchedule(conn_->ackStates.handshakeAckState)))) {
     CHECK(conn_->handshakeWriteHeaderCipher);
     packetLimit -= writeCryptoAndAckDataToSocket(
         *socket_,
@@ -245,6 +329,7 @@ void QuicServerTransport::writeData() {
         packetLimit);
   }
   if (!packetLimit) {
+    writeCoalescedPackets(*socket_, *conn_);
     return;
   }
   if (conn_->oneRttWriteCipher) {
@@ -259,6 +344,8 @@ void QuicServerTransport::writeData() {
         version,
         packetLimit);
   }
+  // The packets held back had no 1-RTT packet to go with.
+  writeCoalescedPackets(*socket_, *conn_);
 }
 
 void QuicServerTransport::closeTransport() {
@@ -284,6 +371,25 @@ void QuicServerTransport::unbindConnection() {
   }
 }
 
+bool QuicServerTransport::handOffDraining(
+    std::chrono::microseconds drainPeriod) {
+  // Packets of a connected socket don't go through the worker.
+  if (!conn_->transportSettings.compactDrainingState || !routingCb_ ||
+      usesConnectedSocket() || !conn_->serverConnectionId) {
+    return false;
+  }
+  Buf closePacket;
+  // A peer that closed the connection gets nothing more from us.
+  if (!conn_->peerConnectionError) {
+    closePacket = std::move(conn_->lastClosePacket);
+  }
+  return routingCb_->onConnectionDraining(
+      conn_->peerAddress,
+      conn_->selfConnectionIds,
+      std::move(closePacket),
+      drainPeriod);
+}
+
 bool QuicServerTransport::hasWriteCipher() const {
   return conn_->oneRttWriteCipher != nullptr;
 }
@@ -292,6 +398,15 @@ std::shared_ptr<QuicTransportBase> QuicServerTransport::sharedGuard() {
   return shared_from_this();
 }
 
+bool QuicServerTransport::isDetachable() {
+  return closeState_ == CloseState::OPEN && notifiedConnIdBound_ &&
+      hasWriteCipher() && conn_->outstandingPackets.empty() &&
+      conn_->streamManager->streamCount() == 0 &&
+      (!serverConn_->pendingOneRttData ||
+       serverConn_->pendingOneRttData->empty()) &&
+      !pingTimeout_.isScheduled() && !sharedSocket_;
+}
+
 void QuicServerTransport::setClientConnectionId(
     const ConnectionId& clientConnectionId) {
   conn_->clientConnectionId.assign(clientConnectionId);
@@ -363,7 +478,8 @@ void QuicServerTransport::processPendingData(bool async) {
             pendingPacket.peer,
             NetworkData(
                 std::move(pendingPacket.networkData.data),
-                pendingPacket.networkData.receiveTimePoint));
+                pendingPacket.networkData.receiveTimePoint,
+                pendingPacket.networkData.ecn));
         if (serverPtr->closeState_ == CloseState::CLOSED) {
           // The pending data could potentially contain a connection close, or
           // the app could have triggered a connection close with an error. It
@@ -474,4 +590,112 @@ void QuicServerTransport::maybeNotifyTransportReady() {
   }
 }
 
+void QuicServerTransport::maybeMoveToConnectedSocket() {
+  auto minBytes = conn_->transportSettings.serverConnectedSocketMinBytes;
+  if (!connectedSocketFactory_ || minBytes == 0 || connectedSocketTried_ ||
+      !notifiedConnIdBound_ || conn_->lossState.totalBytesSent < minBytes) {
+    return;
+  }
+  connectedSocketTried_ = true;
+  auto sock = connectedSocketFactory_->make(evb_, -1);
+  try {
+    // Next to the listener, on the same address and port.
+    sock->bind(serverConn_->serverAddr);
+  } catch (const folly::AsyncSocketException& ex) {
+    VLOG(4) << "Failed to bind connected socket: " << ex.what() << " "
+            << *this;
+    return;
+  }
+  if (sock->connect(conn_->peerAddress) != 0) {
+    VLOG(4) << "Failed to connect socket errno=" << errno << " " << *this;
+    return;
+  }
+  if (conn_->transportSettings.pacingUsesTxTime && !enableTxTime(*sock)) {
+    VLOG(4) << "SO_TXTIME is not supported on connected socket " << *this;
+    return;
+  }
+  sock->setDFAndTurnOffPMTU();
+  if (conn_->transportSettings.shouldUseGROForRecv && !sock->setGRO(true)) {
+    VLOG(4) << "UDP GRO is not supported on connected socket " << *this;
+  }
+  if (conn_->transportSettings.enableEcn) {
+    applyEcnSocketOptions(*sock, conn_->peerAddress.getFamily());
+  }
+  sock->resumeRead(&connectedSocketReadCallback_);
+  connectedPeerAddress_ = conn_->peerAddress;
+  sharedSocket_ = std::move(socket_);
+  socket_ = std::move(sock);
+  // Its packets now batch up on their own socket.
+  conn_->egressBatch = nullptr;
+  VLOG(4) << "Moved to connected socket " << *this;
+}
+
+void QuicServerTransport::moveToSharedSocket() {
+  if (!sharedSocket_) {
+    return;
+  }
+  auto sock = std::move(socket_);
+  socket_ = std::move(sharedSocket_);
+  conn_->egressBatch = egressBatch_;
+  if (sock) {
+    sock->pauseRead();
+    sock->close();
+    // This may be called from a read callback of sock.
+    evb_->runInLoop([sock = std::move(sock)]() mutable { sock.reset(); });
+  }
+}
+
+void QuicServerTransport::ConnectedSocketReadCallback::getReadBuffer(
+    void** buf,
+    size_t* len) noexcept {
+  const auto& settings = transport_.conn_->transportSettings;
+  auto readBufferSize = settings.maxRecvPacketSize;
+  if (settings.shouldUseGROForRecv) {
+    readBufferSize =
+        std::max<uint64_t>(readBufferSize, kDefaultGROReadBufferSize);
+  }
+  readBuffer_ = folly::IOBuf::create(readBufferSize);
+  *buf = readBuffer_->writableData();
+  *len = readBufferSize;
+}
+
+void QuicServerTransport::ConnectedSocketReadCallback::onDataAvailable(
+    const folly::SocketAddress& peer,
+    size_t len,
+    bool truncated,
+    OnDataAvailableParams params) noexcept {
+  auto packetReceiveTime = Clock::now();
+  Buf data = std::move(readBuffer_);
+  auto& conn = *transport_.conn_;
+  if (truncated) {
+    if (conn.qLogger) {
+      conn.qLogger->addPacketDrop(len, kUdpTruncated);
+    }
+    QUIC_TRACE(packet_drop, conn, "udp_truncated");
+    return;
+  }
+  data->append(len);
+  if (conn.qLogger) {
+    conn.qLogger->addDatagramReceived(len);
+  }
+  if (params.gro_ <= 0) {
+    NetworkData networkData(std::move(data), packetReceiveTime);
+    transport_.onNetworkData(peer, std::move(networkData));
+    return;
+  }
+  NetworkData networkData;
+  networkData.receiveTimePoint = packetReceiveTime;
+  networkData.totalData = len;
+  splitGROBuffer(std::move(data), params.gro_, networkData.packets);
+  transport_.onNetworkData(peer, std::move(networkData));
+}
+
+void QuicServerTransport::ConnectedSocketReadCallback::onReadError(
+    const folly::AsyncSocketException& ex) noexcept {
+  VLOG(4) << "Connected socket read error: " << ex.what() << " "
+          << transport_;
+  // The packets of the peer go to the worker again.
+  transport_.moveToSharedSocket();
+}
+
 } // namespace quic
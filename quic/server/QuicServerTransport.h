@@ -12,6 +12,8 @@
 #include <quic/api/QuicTransportFunctions.h>
 #include <quic/codec/ConnectionIdAlgo.h>
 #include <quic/congestion_control/CongestionControllerFactory.h>
+#include <quic/server/QuicUDPSocketFactory.h>
+#include <quic/server/handshake/ResumptionCache.h>
 #include <quic/server/handshake/ServerTransportParametersExtension.h>
 #include <quic/server/state/ServerConnectionIdRejector.h>
 #include <quic/server/state/ServerStateMachine.h>
@@ -45,6 +47,18 @@ class QuicServerTransport
         QuicServerTransport* transport,
         const SourceIdentity& address,
         const std::vector<ConnectionIdData>& connectionIdData) noexcept = 0;
+
+    // Called when the connection closes and would drain for drainPeriod.
+    // Returns whether the callback answers packets to these connection ids
+    // from peerAddress with closePacket, if any, until then, so that the
+    // transport can be unbound right away.
+    virtual bool onConnectionDraining(
+        const folly::SocketAddress& /* peerAddress */,
+        const std::vector<ConnectionIdData>& /* connectionIdData */,
+        Buf /* closePacket */,
+        std::chrono::microseconds /* drainPeriod */) noexcept {
+      return false;
+    }
   };
 
   static QuicServerTransport::Ptr make(
@@ -81,9 +95,63 @@ class QuicServerTransport
    */
   virtual void setConnectionIdAlgo(ConnectionIdAlgo* connIdAlgo) noexcept;
 
+  /**
+   * Set the output buffer for DataPathType::ContinuousMemory writes. The
+   * buffer is owned by the caller and has to outlive this transport.
+   */
+  virtual void setBufAccessor(BufAccessor* bufAccessor) noexcept;
+
+  /**
+   * Set the arena packet buffers are taken from. The arena is owned by the
+   * caller and has to outlive this transport.
+   */
+  virtual void setPacketBufArena(PacketBufArena* bufArena) noexcept;
+
+  /**
+   * Set the tracker of the MSG_ZEROCOPY sends on the socket of the worker.
+   * It's owned by the caller and has to outlive this transport.
+   */
+  virtual void setZeroCopyTracker(
+      ZeroCopySendTracker* zeroCopyTracker) noexcept;
+
+  /**
+   * Set the batch packets are queued in, to be written with the ones of the
+   * other transports on the same EventBase. The batch is owned by the caller
+   * and has to outlive this transport.
+   */
+  virtual void setEgressBatch(SharedEgressBatch* egressBatch) noexcept;
+
+  /**
+   * Set the factory the socket of its own is made with, once the connection
+   * has sent TransportSettings::serverConnectedSocketMinBytes. The factory
+   * must give sockets with SO_REUSEPORT set, is owned by the caller and has
+   * to outlive this transport.
+   */
+  virtual void setConnectedSocketFactory(
+      QuicUDPSocketFactory* socketFactory) noexcept;
+
+  // Whether the connection has moved onto a connected socket of its own.
+  bool usesConnectedSocket() const;
+
+  /**
+   * Set the cache the transport parameters are encoded through. The cache is
+   * owned by the caller and has to outlive this transport.
+   */
+  virtual void setTransportParametersCache(
+      ServerTransportParametersCache* cache) noexcept;
+
   void setServerConnectionIdRejector(
       ServerConnectionIdRejector* connIdRejector) noexcept;
 
+  // The pool may be null, for the connection to encode every id it issues.
+  void setServerConnectionIdPool(ServerConnectionIdPool* connIdPool) noexcept;
+
+  /**
+   * Set the cache that the app tokens of resumed sessions are decoded
+   * through. This must be set before accept().
+   */
+  void setResumptionCache(std::shared_ptr<ResumptionCache> resumptionCache);
+
   /**
    * Set factory to create specific congestion controller instances
    * for a given connection
@@ -103,9 +171,17 @@ class QuicServerTransport
   void writeData() override;
   void closeTransport() override;
   void unbindConnection() override;
+  bool handOffDraining(std::chrono::microseconds drainPeriod) override;
   bool hasWriteCipher() const override;
   std::shared_ptr<QuicTransportBase> sharedGuard() override;
 
+  /**
+   * Whether the connection is idle enough to be moved to another worker: its
+   * connection ids are bound, and it has no streams, nothing in flight and
+   * no ping outstanding.
+   */
+  bool isDetachable() override;
+
   const fizz::server::FizzServerContext& getCtx() {
     return *ctx_;
   }
@@ -122,6 +198,30 @@ class QuicServerTransport
   void maybeNotifyConnectionIdBound();
   void maybeWriteNewSessionTicket();
   void maybeIssueConnectionIds();
+  void maybeMoveToConnectedSocket();
+  void moveToSharedSocket();
+
+  // Reads of the connected socket, passed on like the ones the worker hands
+  // over.
+  class ConnectedSocketReadCallback
+      : public folly::AsyncUDPSocket::ReadCallback {
+   public:
+    explicit ConnectedSocketReadCallback(QuicServerTransport& transport)
+        : transport_(transport) {}
+
+    void getReadBuffer(void** buf, size_t* len) noexcept override;
+    void onDataAvailable(
+        const folly::SocketAddress& peer,
+        size_t len,
+        bool truncated,
+        OnDataAvailableParams params) noexcept override;
+    void onReadError(const folly::AsyncSocketException& ex) noexcept override;
+    void onReadClosed() noexcept override {}
+
+   private:
+    QuicServerTransport& transport_;
+    Buf readBuffer_;
+  };
 
  private:
   RoutingCallback* routingCb_{nullptr};
@@ -131,5 +231,15 @@ class QuicServerTransport
   bool newSessionTicketWritten_{false};
   bool connectionIdsIssued_{false};
   QuicServerConnectionState* serverConn_;
+  std::shared_ptr<ResumptionCache> resumptionCache_;
+  QuicUDPSocketFactory* connectedSocketFactory_{nullptr};
+  SharedEgressBatch* egressBatch_{nullptr};
+  // The socket on the worker fd while socket_ is the connected one.
+  std::unique_ptr<folly::AsyncUDPSocket> sharedSocket_;
+  folly::SocketAddress connectedPeerAddress_;
+  // Only tried once, the connection stays on the worker socket if it fails or
+  // the peer migrates.
+  bool connectedSocketTried_{false};
+  ConnectedSocketReadCallback connectedSocketReadCallback_{*this};
 };
 } // namespace quic
@@ -6,21 +6,44 @@
  *
  */
 
+#include <folly/ScopeGuard.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/SocketOptionMap.h>
 #include <folly/system/ThreadId.h>
 #include <quic/QuicConstants.h>
+#include <quic/codec/Decode.h>
+#include <quic/common/BufUtil.h>
 #include <quic/common/SocketUtil.h>
 #include <quic/common/Timers.h>
 
+#include <quic/fizz/handshake/FizzCryptoFactory.h>
 #include <quic/server/QuicServerWorker.h>
+#include <quic/server/SlidingWindowRateLimiter.h>
+#include <quic/server/TokenBucketRateLimiter.h>
 #include <quic/server/handshake/StatelessResetGenerator.h>
 
+#ifndef MSG_WAITFORONE
+#define RECVMMSG_FLAGS 0
+#else
+#define RECVMMSG_FLAGS MSG_WAITFORONE
+#endif
+
 namespace quic {
 
+namespace {
+// How often a draining worker checks whether its connections have ended.
+constexpr std::chrono::milliseconds kDrainCheckInterval{100};
+// TransportSettings::busyPollCpuBudgetPercent is a share of this.
+constexpr std::chrono::milliseconds kBusyPollBudgetPeriod{100};
+// How often the records of draining connections are checked for their end.
+constexpr std::chrono::milliseconds kDrainingSweepInterval{1000};
+} // namespace
+
 QuicServerWorker::QuicServerWorker(
     std::shared_ptr<QuicServerWorker::WorkerCallback> callback)
-    : callback_(callback), takeoverPktHandler_(this) {}
+    : callback_(callback),
+      bufArena_(std::make_unique<PacketBufArena>()),
+      takeoverPktHandler_(this) {}
 
 folly::EventBase* QuicServerWorker::getEventBase() const {
   return evb_;
@@ -88,6 +111,7 @@ QuicTransportStatsCallback* QuicServerWorker::getTransportStatsCallback() const
 void QuicServerWorker::setConnectionIdAlgo(
     std::unique_ptr<ConnectionIdAlgo> connIdAlgo) noexcept {
   CHECK(connIdAlgo);
+  connIdPool_.reset();
   connIdAlgo_ = std::move(connIdAlgo);
 }
 
@@ -97,12 +121,160 @@ void QuicServerWorker::setCongestionControllerFactory(
   ccFactory_ = ccFactory;
 }
 
+void QuicServerWorker::setPathStateCache(
+    std::shared_ptr<PathStateCache> pathStateCache) {
+  pathStateCache_ = std::move(pathStateCache);
+}
+
+void QuicServerWorker::setResumptionCache(
+    std::shared_ptr<ResumptionCache> resumptionCache) {
+  resumptionCache_ = std::move(resumptionCache);
+}
+
+void QuicServerWorker::setReceiveBufferAccountant(
+    std::shared_ptr<ReceiveBufferAccountant> accountant) {
+  receiveBufferAccountant_ = std::move(accountant);
+}
+
+void QuicServerWorker::warmUp() {
+  CHECK(socket_);
+  DCHECK(evb_->isInEventBaseThread());
+  bufArena_->prefill(kDefaultPacketBufArenaMaxSlabs);
+  if (!pacingTimer_) {
+    pacingTimer_ = TimerHighRes::newTimer(
+        evb_, transportSettings_.pacingTimerTickInterval);
+  }
+  if (!resetGenerator_ && transportSettings_.statelessResetTokenSecret) {
+    resetGenerator_ = std::make_unique<StatelessResetGenerator>(
+        *transportSettings_.statelessResetTokenSecret,
+        getAddress().getFullyQualified());
+  }
+  if (auto connIdPool = getConnectionIdPool()) {
+    connIdPool->fill();
+  }
+}
+
 void QuicServerWorker::start() {
   CHECK(socket_);
   if (!pacingTimer_) {
     pacingTimer_ = TimerHighRes::newTimer(
         evb_, transportSettings_.pacingTimerTickInterval);
   }
+  if (transportSettings_.cachePathState && !pathStateCache_) {
+    pathStateCache_ = std::make_shared<PathStateCache>();
+  }
+  if (transportSettings_.workerReceiveBufferLimit > 0) {
+    receiveBufferAccountant_ = std::make_shared<ReceiveBufferAccountant>(
+        transportSettings_.workerReceiveBufferLimit,
+        std::move(receiveBufferAccountant_));
+  }
+  if (transportSettings_.connectionIdTableSize > 0) {
+    connectionIdTable_ =
+        std::make_unique<DirectConnectionIdTable<QuicServerTransport::Ptr>>(
+            transportSettings_.connectionIdTableSize);
+  }
+  if (transportSettings_.retryNewConnectionRateLimit > 0 &&
+      !retryTokenGenerator_) {
+    CHECK(transportSettings_.statelessResetTokenSecret.has_value());
+    // The tokens are labelled, so they can share the stateless reset secret.
+    retryTokenGenerator_ = std::make_unique<RetryTokenGenerator>(
+        *transportSettings_.statelessResetTokenSecret);
+    retryAead_ = FizzCryptoFactory().makeRetryAead();
+    newConnectionRateLimiter_ = std::make_unique<SlidingWindowRateLimiter>(
+        transportSettings_.retryNewConnectionRateLimit,
+        std::chrono::seconds(1));
+    if (transportSettings_.maxRetriesPerSecond > 0) {
+      retryRateLimiter_ = std::make_unique<SlidingWindowRateLimiter>(
+          transportSettings_.maxRetriesPerSecond, std::chrono::seconds(1));
+    }
+  }
+  if (transportSettings_.maxStatelessResponsesPerSecond > 0 &&
+      !statelessResponseRateLimiter_) {
+    statelessResponseRateLimiter_ = std::make_unique<SlidingWindowRateLimiter>(
+        transportSettings_.maxStatelessResponsesPerSecond,
+        std::chrono::seconds(1));
+  }
+  if (transportSettings_.maxStatelessResponsesPerClientPerSecond > 0 &&
+      !clientStatelessResponseRateLimiters_) {
+    clientStatelessResponseRateLimiters_ =
+        std::make_unique<ClientRateLimiters>(
+            kStatelessResponseRateLimiterCacheSize);
+  }
+  if (transportSettings_.maxStatelessResponsesPerNetworkPerSecond > 0 &&
+      !networkStatelessResponseRateLimiter_) {
+    networkStatelessResponseRateLimiter_ = std::make_unique<SourceRateLimiter>(
+        transportSettings_.maxStatelessResponsesPerNetworkPerSecond,
+        std::chrono::seconds(1),
+        kSourceNetworkV4PrefixLength,
+        kSourceNetworkV6PrefixLength);
+  }
+  if (transportSettings_.maxNewConnectionsPerClientPerSecond > 0 &&
+      !clientNewConnectionRateLimiter_) {
+    clientNewConnectionRateLimiter_ = std::make_unique<SourceRateLimiter>(
+        transportSettings_.maxNewConnectionsPerClientPerSecond,
+        std::chrono::seconds(1),
+        kSourceAddressV4PrefixLength,
+        kSourceAddressV6PrefixLength);
+  }
+  if (transportSettings_.maxNewConnectionsPerNetworkPerSecond > 0 &&
+      !networkNewConnectionRateLimiter_) {
+    networkNewConnectionRateLimiter_ = std::make_unique<SourceRateLimiter>(
+        transportSettings_.maxNewConnectionsPerNetworkPerSecond,
+        std::chrono::seconds(1),
+        kSourceNetworkV4PrefixLength,
+        kSourceNetworkV6PrefixLength);
+  }
+  if (transportSettings_.overloadLoopBusyTime.count() > 0 && !loadObserver_) {
+    loadObserver_ = std::make_shared<EventLoopLoadObserver>(
+        transportSettings_.overloadLoopBusyTime, evb_->getObserver());
+    evb_->setObserver(loadObserver_);
+  }
+  if (transportSettings_.usePacingScheduler && !pacingScheduler_) {
+    pacingScheduler_ = std::make_shared<PacingScheduler>(pacingTimer_);
+  }
+  if (transportSettings_.useSharedEgressBatch && !egressBatch_) {
+    egressBatch_ = std::make_unique<SharedEgressBatch>(evb_);
+    egressBatch_->setBufArena(bufArena_.get());
+  }
+  if (transportSettings_.shouldUseGROForRecv && !socket_->setGRO(true)) {
+    VLOG(2) << "UDP GRO is not supported on worker=" << this;
+  }
+  if (transportSettings_.enableEcn) {
+    applyEcnSocketOptions(*socket_, socket_->address().getFamily());
+  }
+  if (transportSettings_.enableRecvTimestamps &&
+      !enableRecvTimestamps(*socket_)) {
+    VLOG(2) << "RX timestamps are not supported on worker=" << this;
+  }
+  if (transportSettings_.monitorSocketDrops) {
+    if (!transportSettings_.shouldRecvBatch) {
+      LOG(WARNING) << "Monitoring socket drops needs shouldRecvBatch, worker="
+                   << this;
+    } else if (!enableSocketDropCount(*socket_)) {
+      VLOG(2) << "SO_RXQ_OVFL is not supported on worker=" << this;
+    }
+  }
+  if (transportSettings_.busyPollWindow.count() > 0) {
+    if (!transportSettings_.shouldRecvBatch) {
+      LOG(WARNING) << "Busy polling needs shouldRecvBatch, worker=" << this;
+    } else if (!enableBusyPoll(*socket_, transportSettings_.busyPollWindow)) {
+      VLOG(2) << "SO_BUSY_POLL is not available on worker=" << this;
+    }
+  }
+  if (transportSettings_.enableZeroCopySend) {
+    if (enableZeroCopy(*socket_)) {
+      zeroCopyTracker_ = std::make_unique<ZeroCopySendTracker>(
+          socket_->getNetworkSocket(), bufArena_.get());
+      // The kernel says on the error queue when it's done with a send.
+      socket_->setErrMessageCallback(this);
+    } else {
+      VLOG(2) << "SO_ZEROCOPY is not supported on worker=" << this;
+    }
+  }
+  if (transportSettings_.pacingUsesTxTime && !enableTxTime(*socket_)) {
+    VLOG(2) << "SO_TXTIME is not supported on worker=" << this;
+    transportSettings_.pacingUsesTxTime = false;
+  }
   socket_->resumeRead(this);
   VLOG(10) << "Registered read on worker=" << this
            << " thread=" << folly::getCurrentThreadID()
@@ -111,6 +283,7 @@ void QuicServerWorker::start() {
 
 void QuicServerWorker::pauseRead() {
   CHECK(socket_);
+  busyPollCallback_.cancelLoopCallback();
   socket_->pauseRead();
 }
 
@@ -124,10 +297,20 @@ const folly::SocketAddress& QuicServerWorker::getAddress() const {
   return socket_->address();
 }
 
+uint64_t QuicServerWorker::getReadBufferSize() const {
+  auto readBufferSize = transportSettings_.maxRecvPacketSize;
+  if (transportSettings_.shouldUseGROForRecv) {
+    readBufferSize =
+        std::max<uint64_t>(readBufferSize, kDefaultGROReadBufferSize);
+  }
+  return readBufferSize;
+}
+
 void QuicServerWorker::getReadBuffer(void** buf, size_t* len) noexcept {
-  readBuffer_ = folly::IOBuf::create(transportSettings_.maxRecvPacketSize);
+  auto readBufferSize = getReadBufferSize();
+  readBuffer_ = folly::IOBuf::create(readBufferSize);
   *buf = readBuffer_->writableData();
-  *len = transportSettings_.maxRecvPacketSize;
+  *len = readBufferSize;
 }
 
 // Returns true if we either drop the packet or send a version
@@ -136,16 +319,24 @@ void QuicServerWorker::getReadBuffer(void** buf, size_t* len) noexcept {
 bool QuicServerWorker::maybeSendVersionNegotiationPacketOrDrop(
     const folly::SocketAddress& client,
     bool isInitial,
-    LongHeaderInvariant& invariant) {
-  folly::Optional<std::pair<VersionNegotiationPacket, Buf>>
-      versionNegotiationPacket;
-  if (rejectNewConnections_ && isInitial) {
-    VersionNegotiationPacketBuilder builder(
-        invariant.dstConnId,
-        invariant.srcConnId,
-        std::vector<QuicVersion>{QuicVersion::MVFST_INVALID});
+    LongHeaderInvariant& invariant,
+    const TimePoint& packetReceiveTime) {
+  // Only the connection ids differ between packets, the rest is made once.
+  Buf versionNegotiationPacket;
+  if ((rejectNewConnections_ || closingConnections_) && isInitial) {
+    if (!rejectionTemplate_) {
+      ConnectionId emptyConnId(nullptr, 0);
+      rejectionTemplate_ =
+          VersionNegotiationPacketBuilder(
+              emptyConnId,
+              emptyConnId,
+              std::vector<QuicVersion>{QuicVersion::MVFST_INVALID})
+              .buildPacket()
+              .second;
+    }
     versionNegotiationPacket =
-        folly::make_optional(std::move(builder).buildPacket());
+        VersionNegotiationPacketBuilder::patchConnectionIds(
+            *rejectionTemplate_, invariant.dstConnId, invariant.srcConnId);
   }
   if (!versionNegotiationPacket) {
     bool negotiationNeeded = std::find(
@@ -159,29 +350,94 @@ bool QuicServerWorker::maybeSendVersionNegotiationPacketOrDrop(
       return true;
     }
     if (negotiationNeeded) {
-      VersionNegotiationPacketBuilder builder(
-          invariant.dstConnId, invariant.srcConnId, supportedVersions_);
+      if (!versionNegotiationTemplate_) {
+        ConnectionId emptyConnId(nullptr, 0);
+        versionNegotiationTemplate_ =
+            VersionNegotiationPacketBuilder(
+                emptyConnId, emptyConnId, supportedVersions_)
+                .buildPacket()
+                .second;
+      }
       versionNegotiationPacket =
-          folly::make_optional(std::move(builder).buildPacket());
+          VersionNegotiationPacketBuilder::patchConnectionIds(
+              *versionNegotiationTemplate_,
+              invariant.dstConnId,
+              invariant.srcConnId);
     }
   }
   if (versionNegotiationPacket) {
+    if (shouldRateLimitStatelessResponse(client, packetReceiveTime)) {
+      VLOG(4) << "Version negotiation to client=" << client << " rate limited";
+      return true;
+    }
     VLOG(4) << "Version negotiation sent to client=" << client;
-    auto len = versionNegotiationPacket->second->computeChainDataLength();
+    auto len = versionNegotiationPacket->length();
     QUIC_STATS(statsCallback_, onWrite, len);
     QUIC_STATS(statsCallback_, onPacketProcessed);
     QUIC_STATS(statsCallback_, onPacketSent);
-    socket_->write(client, versionNegotiationPacket->second);
+    writeStatelessResponse(client, std::move(versionNegotiationPacket));
     return true;
   }
   return false;
 }
 
+bool QuicServerWorker::shouldRateLimitStatelessResponse(
+    const folly::SocketAddress& client,
+    const TimePoint& time) {
+  // A client over its own limit doesn't use up the worker's.
+  if (clientStatelessResponseRateLimiters_) {
+    auto clientIp = client.getIPAddress();
+    auto it = clientStatelessResponseRateLimiters_->find(clientIp);
+    if (it == clientStatelessResponseRateLimiters_->end()) {
+      auto limit = transportSettings_.maxStatelessResponsesPerClientPerSecond;
+      it = clientStatelessResponseRateLimiters_
+               ->insert(
+                   clientIp,
+                   std::make_unique<TokenBucketRateLimiter>(limit, limit))
+               .first;
+    }
+    if (it->second->check(time)) {
+      return true;
+    }
+  }
+  if (networkStatelessResponseRateLimiter_ &&
+      networkStatelessResponseRateLimiter_->check(
+          client.getIPAddress(), time)) {
+    return true;
+  }
+  return statelessResponseRateLimiter_ &&
+      statelessResponseRateLimiter_->check(time);
+}
+
+bool QuicServerWorker::shouldRateLimitNewConnection(
+    const folly::SocketAddress& client,
+    const TimePoint& time) {
+  // The client is counted against its network only if it is under its own
+  // limit, so that one client can't shut out its neighbours.
+  if (clientNewConnectionRateLimiter_ &&
+      clientNewConnectionRateLimiter_->check(client.getIPAddress(), time)) {
+    return true;
+  }
+  return networkNewConnectionRateLimiter_ &&
+      networkNewConnectionRateLimiter_->check(client.getIPAddress(), time);
+}
+
+void QuicServerWorker::writeStatelessResponse(
+    const folly::SocketAddress& client,
+    Buf packet) {
+  if (egressBatch_) {
+    egressBatch_->enqueue(
+        socket_->getNetworkSocket(), client, std::move(packet));
+    return;
+  }
+  socket_->write(client, packet);
+}
+
 void QuicServerWorker::onDataAvailable(
     const folly::SocketAddress& client,
     size_t len,
     bool truncated,
-    OnDataAvailableParams /*params*/) noexcept {
+    OnDataAvailableParams params) noexcept {
   // TODO: we can get better receive time accuracy than this, with
   // SO_TIMESTAMP or SIOCGSTAMP.
   auto packetReceiveTime = Clock::now();
@@ -197,16 +453,296 @@ void QuicServerWorker::onDataAvailable(
     return;
   }
   data->append(len);
-  QUIC_STATS(statsCallback_, onPacketReceived);
-  QUIC_STATS(statsCallback_, onRead, len);
-  handleNetworkData(client, std::move(data), packetReceiveTime);
+  handleReadData(
+      client,
+      std::move(data),
+      params.gro_ > 0 ? size_t(params.gro_) : 0,
+      packetReceiveTime);
+}
+
+bool QuicServerWorker::shouldOnlyNotify() {
+  return transportSettings_.shouldRecvBatch;
+}
+
+void QuicServerWorker::onNotifyDataAvailable(
+    folly::AsyncUDPSocket& sock) noexcept {
+  maybeBusyPoll(readBatch(sock));
+}
+
+int QuicServerWorker::readBatch(folly::AsyncUDPSocket& sock) {
+  const size_t addrLen = sizeof(struct sockaddr_storage);
+  const size_t numPackets = transportSettings_.maxRecvBatchSize;
+  const auto readBufferSize = getReadBufferSize();
+  recvmmsgStorage_.resize(numPackets);
+
+  auto& msgs = recvmmsgStorage_.msgs;
+  auto& addrs = recvmmsgStorage_.addrs;
+  auto& readBuffers = recvmmsgStorage_.readBuffers;
+  auto& iovecs = recvmmsgStorage_.iovecs;
+  auto& controls = recvmmsgStorage_.controls;
+
+  for (size_t i = 0; i < numPackets; ++i) {
+    // Buffers that were not handed out by the previous read are reused, only
+    // the ones that went to a transport need to be replaced.
+    if (!readBuffers[i]) {
+      readBuffers[i] = folly::IOBuf::create(readBufferSize);
+    }
+    iovecs[i].iov_base = readBuffers[i]->writableData();
+    iovecs[i].iov_len = readBufferSize;
+
+    auto* rawAddr = reinterpret_cast<sockaddr*>(&addrs[i]);
+    rawAddr->sa_family = sock.address().getFamily();
+
+    struct msghdr* msg = &msgs[i].msg_hdr;
+    msg->msg_name = rawAddr;
+    msg->msg_namelen = addrLen;
+    msg->msg_iov = &iovecs[i];
+    msg->msg_iovlen = 1;
+    if (transportSettings_.shouldUseGROForRecv ||
+        transportSettings_.enableEcn ||
+        transportSettings_.enableRecvTimestamps ||
+        transportSettings_.monitorSocketDrops) {
+      msg->msg_control = controls[i].data();
+      msg->msg_controllen = controls[i].size();
+    } else {
+      msg->msg_control = nullptr;
+      msg->msg_controllen = 0;
+    }
+  }
+
+  int numMsgsRecvd =
+      sock.recvmmsg(msgs.data(), numPackets, RECVMMSG_FLAGS, nullptr);
+  if (numMsgsRecvd < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      // Socket will notify us again when it is readable.
+      return 0;
+    }
+    sock.pauseRead();
+    onReadError(folly::AsyncSocketException(
+        folly::AsyncSocketException::INTERNAL_ERROR,
+        "::recvmmsg() failed",
+        errno));
+    return -1;
+  }
+
+  // Unless the kernel has timestamped them.
+  auto packetReceiveTime = Clock::now();
+  VLOG(10) << "Worker=" << this << " Received " << numMsgsRecvd
+           << " messages on thread=" << folly::getCurrentThreadID()
+           << " processId=" << (int)processId_;
+  CHECK_LE(numMsgsRecvd, int(numPackets));
+  batchingReads_ = true;
+  SCOPE_EXIT {
+    batchingReads_ = false;
+    flushPendingRoute();
+    takeoverPktHandler_.flushForwardedPackets();
+  };
+  for (int i = 0; i < numMsgsRecvd; ++i) {
+    size_t bytesRead = msgs[i].msg_len;
+    if (bytesRead == 0 || (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+      // Empty or truncated datagram, drop it and keep the buffer around.
+      continue;
+    }
+    folly::SocketAddress client;
+    try {
+      client.setFromSockaddr(
+          reinterpret_cast<sockaddr*>(&addrs[i]), msgs[i].msg_hdr.msg_namelen);
+    } catch (const std::exception& ex) {
+      VLOG(4) << "Dropping packet with invalid peer address: " << ex.what();
+      continue;
+    }
+    if (transportSettings_.monitorSocketDrops) {
+      auto dropCount = getSocketDropCount(msgs[i].msg_hdr);
+      if (dropCount && *dropCount != socketDropCount_) {
+        onSocketDropCount(*dropCount);
+      }
+    }
+    Buf data = std::move(readBuffers[i]);
+    data->append(bytesRead);
+    folly::Optional<TimePoint> kernelReceiveTime;
+    if (transportSettings_.enableRecvTimestamps) {
+      kernelReceiveTime = getRecvTimestamp(msgs[i].msg_hdr);
+    }
+    handleReadData(
+        client,
+        std::move(data),
+        getGROSegmentSize(msgs[i].msg_hdr),
+        kernelReceiveTime.value_or(packetReceiveTime),
+        transportSettings_.enableEcn ? getEcnCodepoint(msgs[i].msg_hdr)
+                                     : EcnCodepoint::NotEct);
+    if (shutdown_) {
+      return -1;
+    }
+  }
+  return numMsgsRecvd;
+}
+
+void QuicServerWorker::errMessage(const cmsghdr& cmsg) noexcept {
+  // Errors of the other packets on the socket are left to the transports to
+  // notice.
+  if (zeroCopyTracker_) {
+    zeroCopyTracker_->onErrMessage(cmsg);
+  }
+}
+
+void QuicServerWorker::errMessageError(
+    const folly::AsyncSocketException& ex) noexcept {
+  VLOG(4) << "Error reading the error queue: " << ex.what()
+          << " worker=" << this;
+}
+
+void QuicServerWorker::onSocketDropCount(uint32_t dropCount) {
+  // The count wraps around.
+  uint32_t drops = dropCount - socketDropCount_;
+  socketDropCount_ = dropCount;
+  VLOG(4) << "Kernel dropped " << drops << " packets on worker=" << this;
+  for (uint32_t i = 0; statsCallback_ && i < drops; ++i) {
+    QUIC_STATS(
+        statsCallback_,
+        onPacketDropped,
+        PacketDropReason::SOCKET_BUFFER_OVERFLOW);
+  }
+  auto maxSize = transportSettings_.maxSocketRecvBufferSize;
+  if (maxSize == 0 || socketRecvBufferAtLimit_) {
+    return;
+  }
+  auto size = getSocketRecvBufferSize(*socket_);
+  if (size == 0 || size >= maxSize) {
+    socketRecvBufferAtLimit_ = true;
+    return;
+  }
+  auto newSize = std::min<uint64_t>(uint64_t(size) * 2, maxSize);
+  if (!setSocketRecvBufferSize(*socket_, newSize) ||
+      getSocketRecvBufferSize(*socket_) <= size) {
+    // Most likely net.core.rmem_max.
+    VLOG(2) << "Can't grow the receive buffer past " << size
+            << " on worker=" << this;
+    socketRecvBufferAtLimit_ = true;
+    return;
+  }
+  VLOG(2) << "Grew the receive buffer to " << newSize << " on worker=" << this;
+}
+
+void QuicServerWorker::maybeBusyPoll(int numRead) {
+  // Not after an error, the socket isn't reading anymore.
+  if (transportSettings_.busyPollWindow.count() == 0 || numRead < 0 ||
+      shutdown_ || !socket_) {
+    return;
+  }
+  auto now = Clock::now();
+  if (numRead > 0) {
+    lastBusyPollPacketTime_ = now;
+  }
+  lastBusyPollTime_ = now;
+  if (now - busyPollPeriodStart_ >= kBusyPollBudgetPeriod) {
+    busyPollPeriodStart_ = now;
+    busyPollIdleTime_ = Clock::duration::zero();
+  }
+  auto budget = std::chrono::duration_cast<Clock::duration>(
+                    kBusyPollBudgetPeriod) *
+      transportSettings_.busyPollCpuBudgetPercent / 100;
+  if (now - lastBusyPollPacketTime_ >= transportSettings_.busyPollWindow ||
+      busyPollIdleTime_ > budget) {
+    // Back to waiting in epoll.
+    return;
+  }
+  if (!busyPollCallback_.isLoopCallbackScheduled()) {
+    // A pending loop callback makes the event loop poll without blocking.
+    evb_->runInLoop(&busyPollCallback_);
+  }
+}
+
+void QuicServerWorker::busyPoll() {
+  if (shutdown_ || !socket_) {
+    return;
+  }
+  auto numRead = readBatch(*socket_);
+  if (numRead == 0) {
+    // The loop iterations that found nothing are what the budget is for.
+    busyPollIdleTime_ += Clock::now() - lastBusyPollTime_;
+  }
+  maybeBusyPoll(numRead);
+}
+
+void QuicServerWorker::handleReadData(
+    const folly::SocketAddress& client,
+    Buf data,
+    size_t groSegmentSize,
+    const TimePoint& packetReceiveTime,
+    EcnCodepoint ecn) noexcept {
+  QUIC_STATS(statsCallback_, onRead, data->length());
+  if (groSegmentSize == 0 || data->length() <= groSegmentSize) {
+    QUIC_STATS(statsCallback_, onPacketReceived);
+    handleNetworkData(client, std::move(data), packetReceiveTime, false, ecn);
+    return;
+  }
+  // The kernel coalesced several datagrams from this client into one read,
+  // each of them needs to go through the routing logic on its own.
+  std::vector<Buf> packets;
+  splitGROBuffer(std::move(data), groSegmentSize, packets);
+  bool startedBatch = !batchingReads_;
+  batchingReads_ = true;
+  for (auto& packet : packets) {
+    QUIC_STATS(statsCallback_, onPacketReceived);
+    handleNetworkData(
+        client, std::move(packet), packetReceiveTime, false, ecn);
+  }
+  if (startedBatch) {
+    batchingReads_ = false;
+    flushPendingRoute();
+    takeoverPktHandler_.flushForwardedPackets();
+  }
+}
+
+void QuicServerWorker::addToPendingRoute(
+    const folly::SocketAddress& client,
+    ConnectionId connId,
+    Buf data,
+    const TimePoint& packetReceiveTime,
+    EcnCodepoint ecn) {
+  if (pendingRoute_ &&
+      (pendingRoute_->connId != connId || pendingRoute_->client != client)) {
+    flushPendingRoute();
+  }
+  if (!pendingRoute_) {
+    pendingRoute_.emplace(PendingRoute{
+        client,
+        std::move(connId),
+        NetworkData(std::move(data), packetReceiveTime, ecn)});
+    return;
+  }
+  auto& networkData = pendingRoute_->networkData;
+  networkData.totalData += data->computeChainDataLength();
+  networkData.packets.push_back(std::move(data));
+  networkData.setEcnCodepoints(networkData.packets.size() - 1, ecn);
+}
+
+void QuicServerWorker::flushPendingRoute() {
+  if (!pendingRoute_) {
+    return;
+  }
+  auto pending = std::move(*pendingRoute_);
+  pendingRoute_.reset();
+  if (shutdown_) {
+    return;
+  }
+  RoutingData routingData(
+      HeaderForm::Short, false, false, std::move(pending.connId), folly::none);
+  try {
+    forwardNetworkData(
+        pending.client, std::move(routingData), std::move(pending.networkData));
+  } catch (const std::exception& ex) {
+    QUIC_STATS(statsCallback_, onPacketDropped, PacketDropReason::PARSE_ERROR);
+    VLOG(6) << "Failed to route packets " << ex.what();
+  }
 }
 
 void QuicServerWorker::handleNetworkData(
     const folly::SocketAddress& client,
     Buf data,
     const TimePoint& packetReceiveTime,
-    bool isForwardedData) noexcept {
+    bool isForwardedData,
+    EcnCodepoint ecn) noexcept {
   try {
     if (shutdown_) {
       VLOG(4) << "Packet received after shutdown, dropping";
@@ -223,6 +759,9 @@ void QuicServerWorker::handleNetworkData(
           PacketDropReason::WORKER_NOT_INITIALIZED);
       return;
     }
+    if (tryHandlingAsHealthCheck(client, *data)) {
+      return;
+    }
     folly::io::Cursor cursor(data.get());
     if (!cursor.canAdvance(sizeof(uint8_t))) {
       VLOG(4) << "Dropping packet too small";
@@ -237,13 +776,21 @@ void QuicServerWorker::handleNetworkData(
       folly::Expected<ShortHeaderInvariant, TransportErrorCode>
           parsedShortHeader = parseShortHeaderInvariants(initialByte, cursor);
       if (!parsedShortHeader) {
-        if (!tryHandlingAsHealthCheck(client, *data)) {
-          QUIC_STATS(
-              statsCallback_, onPacketDropped, PacketDropReason::PARSE_ERROR);
-          VLOG(6) << "Failed to parse short header";
-        }
+        QUIC_STATS(
+            statsCallback_, onPacketDropped, PacketDropReason::PARSE_ERROR);
+        VLOG(6) << "Failed to parse short header";
         return;
       }
+      if (batchingReads_ && !isForwardedData) {
+        // Hold on to this packet in case the next ones in this read are for
+        // the same connection, so they reach the transport together.
+        return addToPendingRoute(
+            client,
+            std::move(parsedShortHeader->destinationConnId),
+            std::move(data),
+            packetReceiveTime,
+            ecn);
+      }
       RoutingData routingData(
           headerForm,
           false,
@@ -253,18 +800,18 @@ void QuicServerWorker::handleNetworkData(
       return forwardNetworkData(
           client,
           std::move(routingData),
-          NetworkData(std::move(data), packetReceiveTime),
+          NetworkData(std::move(data), packetReceiveTime, ecn),
           isForwardedData);
     }
 
+    // Keep the packets of a connection in the order they were received.
+    flushPendingRoute();
     folly::Expected<ParsedLongHeaderInvariant, TransportErrorCode>
         parsedLongHeader = parseLongHeaderInvariant(initialByte, cursor);
     if (!parsedLongHeader) {
-      if (!tryHandlingAsHealthCheck(client, *data)) {
-        QUIC_STATS(
-            statsCallback_, onPacketDropped, PacketDropReason::PARSE_ERROR);
-        VLOG(6) << "Failed to parse long header";
-      }
+      QUIC_STATS(
+          statsCallback_, onPacketDropped, PacketDropReason::PARSE_ERROR);
+      VLOG(6) << "Failed to parse long header";
       return;
     }
 
@@ -280,7 +827,10 @@ void QuicServerWorker::handleNetworkData(
     }
 
     if (maybeSendVersionNegotiationPacketOrDrop(
-            client, isInitial, parsedLongHeader->invariant)) {
+            client,
+            isInitial,
+            parsedLongHeader->invariant,
+            packetReceiveTime)) {
       return;
     }
 
@@ -302,7 +852,7 @@ void QuicServerWorker::handleNetworkData(
     return forwardNetworkData(
         client,
         std::move(routingData),
-        NetworkData(std::move(data), packetReceiveTime),
+        NetworkData(std::move(data), packetReceiveTime, ecn),
         isForwardedData);
   } catch (const std::exception& ex) {
     // Drop the packet.
@@ -314,22 +864,24 @@ void QuicServerWorker::handleNetworkData(
 bool QuicServerWorker::tryHandlingAsHealthCheck(
     const folly::SocketAddress& client,
     const folly::IOBuf& data) {
-  // If we cannot parse the long header then it is not a QUIC invariant
-  // packet, so just drop it after checking whether it could be a health
-  // check.
   if (!healthCheckToken_) {
     return false;
   }
+  // Most datagrams are told apart by their length alone.
+  const auto& token = *healthCheckToken_.value();
+  if (data.length() != token.length() && !data.isChained()) {
+    return false;
+  }
 
   folly::IOBufEqualTo eq;
   // TODO: make this constant time, the token might be secret, but we're
   // current assuming it's not.
-  if (eq(*healthCheckToken_.value(), data)) {
+  if (eq(token, data)) {
     // say that we are OK. The response is much smaller than the
     // request, so we are not creating an amplification vector. Also
     // ignore the error code.
     VLOG(4) << "Health check request, response=OK";
-    socket_->write(client, folly::IOBuf::copyBuffer("OK"));
+    socket_->write(client, healthCheckResponse_);
     return true;
   }
   return false;
@@ -347,10 +899,7 @@ void QuicServerWorker::forwardNetworkData(
     if (packetForwardingEnabled_ && !isForwardedData) {
       VLOG(3) << "Forwarding packet with unknown connId version from client="
               << client << " to another process";
-      auto recvTime = networkData.receiveTimePoint;
-      takeoverPktHandler_.forwardPacketToAnotherServer(
-          client, std::move(networkData).moveAllData(), recvTime);
-      QUIC_STATS(statsCallback_, onPacketForwarded);
+      forwardPacketsToAnotherServer(client, std::move(networkData));
       return;
     } else {
       VLOG(3) << "Dropping packet due to unknown connectionId version connId="
@@ -379,11 +928,30 @@ void QuicServerWorker::dispatchPacketData(
   DCHECK(socket_);
   QuicServerTransport::Ptr transport;
   bool dropPacket = false;
-  auto cit = connectionIdMap_.find(routingData.destinationConnId);
-  if (cit != connectionIdMap_.end()) {
+  const QuicServerTransport::Ptr* cached = connectionIdTable_
+      ? connectionIdTable_->find(routingData.destinationConnId)
+      : nullptr;
+  auto cit = cached ? connectionIdMap_.end()
+                    : connectionIdMap_.find(routingData.destinationConnId);
+  if (cached) {
+    transport = *cached;
+  } else if (cit != connectionIdMap_.end()) {
     transport = cit->second;
+    // The slot may have been freed since the id was added.
+    if (connectionIdTable_) {
+      connectionIdTable_->insert(routingData.destinationConnId, transport);
+    }
     VLOG(10) << "Found existing connection for CID="
              << routingData.destinationConnId.hex() << " " << *transport;
+  } else if (
+      !movedConnectionIds_.empty() &&
+      handOffToMovedConnection(
+          client, routingData, networkData, isForwardedData)) {
+    return;
+  } else if (
+      !drainingConnections_.empty() &&
+      handleDrainingConnection(client, routingData, networkData)) {
+    return;
   } else if (routingData.headerForm != HeaderForm::Long) {
     // Drop the packet if the header form is not long
     VLOG(3) << "Dropping non-long header packet with no connid match CID="
@@ -430,6 +998,19 @@ void QuicServerWorker::dispatchPacketData(
               PacketDropReason::INVALID_PACKET);
           return;
         }
+        if (shouldRateLimitNewConnection(
+                client, networkData.receiveTimePoint)) {
+          VLOG(3) << "Dropping initial packet over the source limit from "
+                  << "client=" << client;
+          QUIC_STATS(
+              statsCallback_,
+              onPacketDropped,
+              PacketDropReason::SOURCE_RATE_LIMITED);
+          return;
+        }
+        if (maybeSendRetryPacketOrDrop(client, networkData)) {
+          return;
+        }
         // create 'accepting' transport
         auto sock = makeSocket(getEventBase());
         auto trans = transportFactory_->make(
@@ -440,24 +1021,61 @@ void QuicServerWorker::dispatchPacketData(
         } else {
           CHECK(trans);
           trans->setPacingTimer(pacingTimer_);
+          trans->setPacingScheduler(pacingScheduler_);
+          if (receiveBufferAccountant_) {
+            trans->setReceiveBufferAccountant(receiveBufferAccountant_);
+          }
           trans->setRoutingCallback(this);
           trans->setSupportedVersions(supportedVersions_);
           trans->setOriginalPeerAddress(client);
           trans->setCongestionControllerFactory(ccFactory_);
+          folly::Optional<TransportSettings> overridenTransportSettings;
           if (transportSettingsOverrideFn_) {
-            folly::Optional<TransportSettings> overridenTransportSettings =
-                transportSettingsOverrideFn_(
-                    transportSettings_, client.getIPAddress());
-            if (overridenTransportSettings) {
-              trans->setTransportSettings(*overridenTransportSettings);
-            } else {
-              trans->setTransportSettings(transportSettings_);
-            }
+            overridenTransportSettings = transportSettingsOverrideFn_(
+                transportSettings_, client.getIPAddress());
+          }
+          const auto& settings = overridenTransportSettings
+              ? *overridenTransportSettings
+              : transportSettings_;
+          folly::Optional<CachedPathState> cachedPathState;
+          if (pathStateCache_ && settings.cachePathState) {
+            cachedPathState =
+                pathStateCache_->get(client.getIPAddress(), Clock::now());
+          }
+          if (cachedPathState) {
+            auto seededSettings = settings;
+            seedTransportSettingsFromPathState(
+                seededSettings, *cachedPathState);
+            trans->setTransportSettings(std::move(seededSettings));
           } else {
-            trans->setTransportSettings(transportSettings_);
+            trans->setTransportSettings(settings);
+          }
+          if (trans->getTransportSettings().dataPathType ==
+              DataPathType::ContinuousMemory) {
+            if (!bufAccessor_) {
+              bufAccessor_ = std::make_unique<SimpleBufAccessor>(
+                  kDefaultMaxUDPPayload *
+                  trans->getTransportSettings().maxBatchSize);
+            }
+            trans->setBufAccessor(bufAccessor_.get());
+          }
+          trans->setPacketBufArena(bufArena_.get());
+          if (zeroCopyTracker_) {
+            trans->setZeroCopyTracker(zeroCopyTracker_.get());
+          }
+          if (egressBatch_) {
+            trans->setEgressBatch(egressBatch_.get());
+          }
+          if (connectedSocketFactory_) {
+            trans->setConnectedSocketFactory(connectedSocketFactory_);
           }
+          trans->setTransportParametersCache(&transportParametersCache_);
           trans->setConnectionIdAlgo(connIdAlgo_.get());
           trans->setServerConnectionIdRejector(this);
+          trans->setServerConnectionIdPool(getConnectionIdPool());
+          if (resumptionCache_) {
+            trans->setResumptionCache(resumptionCache_);
+          }
           if (routingData.sourceConnId) {
             trans->setClientConnectionId(*routingData.sourceConnId);
           }
@@ -510,11 +1128,9 @@ void QuicServerWorker::dispatchPacketData(
     return;
   }
   auto connIdParam =
-      connIdAlgo_->parseConnectionId(routingData.destinationConnId);
-  if (connIdParam.hasError()) {
-    VLOG(3) << "Dropping packet due to DCID parsing error="
-            << connIdParam.error().what()
-            << ", errorCode=" << connIdParam.error().errorCode()
+      connIdAlgo_->tryParseConnectionId(routingData.destinationConnId);
+  if (!connIdParam) {
+    VLOG(3) << "Dropping packet due to DCID parsing error"
             << ", DCID=" << routingData.destinationConnId.hex()
             << ", workerId=" << (uint32_t)workerId_
             << ", hostId=" << (uint32_t)hostId_;
@@ -571,10 +1187,109 @@ void QuicServerWorker::dispatchPacketData(
   VLOG(4) << "Forwarding packet from client=" << client
           << " to another process, workerId=" << (uint32_t)workerId_
           << ", processId_=" << (uint32_t) static_cast<uint8_t>(processId_);
-  auto recvTime = networkData.receiveTimePoint;
-  takeoverPktHandler_.forwardPacketToAnotherServer(
-      client, std::move(networkData).moveAllData(), recvTime);
-  QUIC_STATS(statsCallback_, onPacketForwarded);
+  forwardPacketsToAnotherServer(client, std::move(networkData));
+}
+
+void QuicServerWorker::forwardPacketsToAnotherServer(
+    const folly::SocketAddress& client,
+    NetworkData&& networkData) {
+  // The other server expects exactly one UDP datagram per forwarded packet.
+  for (auto& packet : networkData.packets) {
+    takeoverPktHandler_.forwardPacketToAnotherServer(
+        client, std::move(packet), networkData.receiveTimePoint);
+    QUIC_STATS(statsCallback_, onPacketForwarded);
+  }
+  // A read batch flushes once it is done with all of its packets.
+  if (!batchingReads_) {
+    takeoverPktHandler_.flushForwardedPackets();
+  }
+}
+
+bool QuicServerWorker::maybeSendRetryPacketOrDrop(
+    const folly::SocketAddress& client,
+    const NetworkData& networkData) {
+  bool overloaded = isOverloaded();
+  if (!retryTokenGenerator_) {
+    if (overloaded) {
+      VLOG(3) << "Dropping initial packet while overloaded from client="
+              << client;
+      QUIC_STATS(
+          statsCallback_, onPacketDropped, PacketDropReason::SERVER_OVERLOADED);
+    }
+    return overloaded;
+  }
+  folly::io::Cursor cursor(networkData.packets.front().get());
+  uint8_t initialByte = cursor.readBE<uint8_t>();
+  auto parsedHeader = parseLongHeader(initialByte, cursor);
+  if (!parsedHeader || !parsedHeader->parsedLongHeader) {
+    VLOG(3) << "Dropping unparseable initial packet from client=" << client;
+    QUIC_STATS(statsCallback_, onPacketDropped, PacketDropReason::PARSE_ERROR);
+    return true;
+  }
+  const auto& header = parsedHeader->parsedLongHeader->header;
+  if (header.hasToken() &&
+      retryTokenGenerator_->validateToken(
+          folly::ByteRange(folly::StringPiece(header.getToken())),
+          client.getIPAddress(),
+          std::chrono::system_clock::now())) {
+    // The client has shown it can receive at its address.
+    return false;
+  }
+  if (!newConnectionRateLimiter_->check(networkData.receiveTimePoint) &&
+      !overloaded) {
+    return false;
+  }
+  if (header.hasToken()) {
+    // A client only follows one Retry, so another one would be wasted.
+    VLOG(3) << "Dropping initial packet with invalid token from client="
+            << client;
+    QUIC_STATS(
+        statsCallback_,
+        onPacketDropped,
+        PacketDropReason::INVALID_RETRY_TOKEN);
+    return true;
+  }
+  if (retryRateLimiter_ &&
+      retryRateLimiter_->check(networkData.receiveTimePoint)) {
+    VLOG(3) << "Dropping initial packet over the retry limit from client="
+            << client;
+    QUIC_STATS(
+        statsCallback_, onPacketDropped, PacketDropReason::SERVER_OVERLOADED);
+    return true;
+  }
+  sendRetryPacket(client, header);
+  return true;
+}
+
+void QuicServerWorker::sendRetryPacket(
+    const folly::SocketAddress& client,
+    const LongHeader& initialHeader) {
+  // The client's next Initial goes to this id, so it has to route back here.
+  auto retryConnId = connIdAlgo_->encodeConnectionId(ServerConnectionIdParams(
+      hostId_, static_cast<uint8_t>(processId_), workerId_));
+  if (retryConnId.hasError()) {
+    VLOG(3) << "Dropping initial packet, failed to encode retry CID="
+            << retryConnId.error().what();
+    QUIC_STATS(
+        statsCallback_, onPacketDropped, PacketDropReason::SERVER_OVERLOADED);
+    return;
+  }
+  auto token = retryTokenGenerator_->makeToken(
+      client.getIPAddress(),
+      initialHeader.getDestinationConnId(),
+      std::chrono::system_clock::now());
+  RetryPacketBuilder builder(
+      initialHeader.getVersion(),
+      *retryConnId,
+      initialHeader.getSourceConnId(),
+      token.range());
+  auto retryData = std::move(builder).buildPacket(
+      *retryAead_, initialHeader.getDestinationConnId());
+  auto retryDataLen = retryData->computeChainDataLength();
+  VLOG(4) << "Sending retry to client=" << client;
+  socket_->write(client, std::move(retryData));
+  QUIC_STATS(statsCallback_, onWrite, retryDataLen);
+  QUIC_STATS(statsCallback_, onPacketSent);
 }
 
 void QuicServerWorker::sendResetPacket(
@@ -586,19 +1301,39 @@ void QuicServerWorker::sendResetPacket(
     // Only send resets in response to short header packets.
     return;
   }
-  uint16_t packetSize = networkData.totalData;
+  // Size the reset after the packet that triggered it, which is the first one
+  // when several packets were batched together.
+  uint16_t packetSize = networkData.packets.empty()
+      ? 0
+      : networkData.packets.front()->computeChainDataLength();
   uint16_t maxResetPacketSize = std::min<uint16_t>(
       std::max<uint16_t>(kMinStatelessPacketSize, packetSize),
       kDefaultUDPSendPacketLen);
+  if (shouldRateLimitStatelessResponse(
+          client, networkData.receiveTimePoint)) {
+    VLOG(4) << "Stateless reset to client=" << client << " rate limited";
+    return;
+  }
   CHECK(transportSettings_.statelessResetTokenSecret.has_value());
-  StatelessResetGenerator generator(
-      *transportSettings_.statelessResetTokenSecret,
-      getAddress().getFullyQualified());
-  StatelessResetToken token = generator.generateToken(connId);
-  StatelessResetPacketBuilder builder(maxResetPacketSize, token);
-  auto resetData = std::move(builder).buildPacket();
-  auto resetDataLen = resetData->computeChainDataLength();
-  socket_->write(client, std::move(resetData));
+  if (!resetGenerator_) {
+    // The secret is extracted once, rather than for every reset.
+    resetGenerator_ = std::make_unique<StatelessResetGenerator>(
+        *transportSettings_.statelessResetTokenSecret,
+        getAddress().getFullyQualified());
+  }
+  if (!resetPacketBuf_) {
+    resetPacketBuf_ = bufArena_->allocate();
+  }
+  StatelessResetToken token = resetGenerator_->generateToken(connId);
+  resetPacketBuf_ = StatelessResetPacketBuilder(
+                        maxResetPacketSize, token, std::move(resetPacketBuf_))
+                        .buildPacket();
+  auto resetDataLen = resetPacketBuf_->length();
+  if (egressBatch_) {
+    writeStatelessResponse(client, std::move(resetPacketBuf_));
+  } else {
+    socket_->write(client, resetPacketBuf_);
+  }
   QUIC_STATS(statsCallback_, onWrite, resetDataLen);
   QUIC_STATS(statsCallback_, onPacketSent);
   QUIC_STATS(statsCallback_, onStatelessReset);
@@ -660,6 +1395,7 @@ TakeoverProtocolVersion QuicServerWorker::getTakeoverProtocolVersion() const
 
 void QuicServerWorker::setProcessId(enum ProcessId id) noexcept {
   processId_ = id;
+  connIdPool_.reset();
 }
 
 ProcessId QuicServerWorker::getProcessId() const noexcept {
@@ -668,6 +1404,7 @@ ProcessId QuicServerWorker::getProcessId() const noexcept {
 
 void QuicServerWorker::setWorkerId(uint8_t id) noexcept {
   workerId_ = id;
+  connIdPool_.reset();
 }
 
 uint8_t QuicServerWorker::getWorkerId() const noexcept {
@@ -676,6 +1413,7 @@ uint8_t QuicServerWorker::getWorkerId() const noexcept {
 
 void QuicServerWorker::setHostId(uint16_t hostId) noexcept {
   hostId_ = hostId;
+  connIdPool_.reset();
 }
 
 void QuicServerWorker::setNewConnectionSocketFactory(
@@ -684,6 +1422,11 @@ void QuicServerWorker::setNewConnectionSocketFactory(
   takeoverPktHandler_.setSocketFactory(socketFactory_);
 }
 
+void QuicServerWorker::setConnectedSocketFactory(
+    QuicUDPSocketFactory* factory) {
+  connectedSocketFactory_ = factory;
+}
+
 void QuicServerWorker::setTransportFactory(
     QuicServerTransportFactory* factory) {
   transportFactory_ = factory;
@@ -692,6 +1435,7 @@ void QuicServerWorker::setTransportFactory(
 void QuicServerWorker::setSupportedVersions(
     const std::vector<QuicVersion>& supportedVersions) {
   supportedVersions_ = supportedVersions;
+  versionNegotiationTemplate_.reset();
 }
 
 void QuicServerWorker::setFizzContext(
@@ -702,12 +1446,58 @@ void QuicServerWorker::setFizzContext(
 void QuicServerWorker::setTransportSettings(
     TransportSettings transportSettings) {
   transportSettings_ = transportSettings;
+  // The reset secret may have changed.
+  resetGenerator_.reset();
+  connIdPool_.reset();
+}
+
+void QuicServerWorker::updateTransportSettings(
+    TransportSettings transportSettings,
+    uint64_t version) {
+  if (version < transportSettingsVersion_) {
+    return;
+  }
+  transportSettingsVersion_ = version;
+  if (socket_) {
+    // SO_TXTIME is only turned on, or found to be missing, by start().
+    transportSettings.pacingUsesTxTime = transportSettings_.pacingUsesTxTime;
+  }
+  setTransportSettings(std::move(transportSettings));
+  for (const auto& entry : boundServerTransports_) {
+    auto transport = entry.first;
+    folly::Optional<TransportSettings> overridenTransportSettings;
+    if (transportSettingsOverrideFn_) {
+      overridenTransportSettings = transportSettingsOverrideFn_(
+          transportSettings_,
+          transport->getOriginalPeerAddress().getIPAddress());
+    }
+    transport->updateLiveTransportSettings(
+        overridenTransportSettings ? *overridenTransportSettings
+                                   : transportSettings_);
+  }
+}
+
+uint64_t QuicServerWorker::getTransportSettingsVersion() const {
+  return transportSettingsVersion_;
 }
 
 void QuicServerWorker::rejectNewConnections(bool rejectNewConnections) {
   rejectNewConnections_ = rejectNewConnections;
 }
 
+void QuicServerWorker::setEventBaseObserver(
+    std::shared_ptr<folly::EventBaseObserver> observer) {
+  if (loadObserver_) {
+    loadObserver_->setNext(std::move(observer));
+  } else {
+    evb_->setObserver(std::move(observer));
+  }
+}
+
+bool QuicServerWorker::isOverloaded() const {
+  return loadObserver_ && loadObserver_->isOverloaded();
+}
+
 void QuicServerWorker::enablePartialReliability(bool enabled) {
   transportSettings_.partialReliabilityEnabled = enabled;
 }
@@ -715,6 +1505,7 @@ void QuicServerWorker::enablePartialReliability(bool enabled) {
 void QuicServerWorker::setHealthCheckToken(
     const std::string& healthCheckToken) {
   healthCheckToken_ = folly::IOBuf::copyBuffer(healthCheckToken);
+  healthCheckResponse_ = folly::IOBuf::copyBuffer("OK");
 }
 
 std::unique_ptr<folly::AsyncUDPSocket> QuicServerWorker::makeSocket(
@@ -734,6 +1525,87 @@ QuicServerWorker::getConnectionIdMap() const {
   return connectionIdMap_;
 }
 
+ConnectionCpuTime QuicServerWorker::getCpuTime() const {
+  ConnectionCpuTime cpuTime = unboundConnectionsCpuTime_;
+  for (const auto& entry : boundServerTransports_) {
+    auto state = entry.first->getState();
+    if (state) {
+      cpuTime.merge(state->cpuTime);
+    }
+  }
+  return cpuTime;
+}
+
+std::vector<ConnectionCpuTimeSample> QuicServerWorker::getTopCpuConnections(
+    size_t n) const {
+  std::vector<ConnectionCpuTimeSample> samples;
+  samples.reserve(boundServerTransports_.size());
+  for (const auto& entry : boundServerTransports_) {
+    auto transport = entry.first;
+    auto state = transport->getState();
+    if (!state) {
+      continue;
+    }
+    samples.push_back(
+        {transport->getServerConnectionId(),
+         transport->getPeerAddress(),
+         state->cpuTime});
+  }
+  auto byTotal = [](const ConnectionCpuTimeSample& a,
+                    const ConnectionCpuTimeSample& b) {
+    return a.cpuTime.total() > b.cpuTime.total();
+  };
+  if (samples.size() > n) {
+    std::partial_sort(
+        samples.begin(), samples.begin() + n, samples.end(), byTotal);
+    samples.resize(n);
+  } else {
+    std::sort(samples.begin(), samples.end(), byTotal);
+  }
+  return samples;
+}
+
+ConnectionMemoryUsage QuicServerWorker::getMemoryUsage() const {
+  ConnectionMemoryUsage memoryUsage;
+  for (const auto& entry : boundServerTransports_) {
+    auto state = entry.first->getState();
+    if (state) {
+      memoryUsage.merge(getConnectionMemoryUsage(*state));
+    }
+  }
+  QUIC_STATS(statsCallback_, onMemoryUsage, memoryUsage);
+  return memoryUsage;
+}
+
+std::vector<ConnectionMemoryUsageSample>
+QuicServerWorker::getTopMemoryConnections(size_t n) const {
+  std::vector<ConnectionMemoryUsageSample> samples;
+  samples.reserve(boundServerTransports_.size());
+  for (const auto& entry : boundServerTransports_) {
+    auto transport = entry.first;
+    auto state = transport->getState();
+    if (!state) {
+      continue;
+    }
+    samples.push_back(
+        {transport->getServerConnectionId(),
+         transport->getPeerAddress(),
+         getConnectionMemoryUsage(*state)});
+  }
+  auto byTotal = [](const ConnectionMemoryUsageSample& a,
+                    const ConnectionMemoryUsageSample& b) {
+    return a.memoryUsage.total() > b.memoryUsage.total();
+  };
+  if (samples.size() > n) {
+    std::partial_sort(
+        samples.begin(), samples.begin() + n, samples.end(), byTotal);
+    samples.resize(n);
+  } else {
+    std::sort(samples.begin(), samples.end(), byTotal);
+  }
+  return samples;
+}
+
 const QuicServerWorker::SrcToTransportMap&
 QuicServerWorker::getSrcToTransportMap() const {
   return sourceAddressMap_;
@@ -755,9 +1627,13 @@ void QuicServerWorker::onConnectionIdAvailable(
     LOG(ERROR) << "connectionIdMap_ already has CID=" << id
                << " Is same transport: "
                << (existingTransportPtr == transportPtr);
-  } else if (boundServerTransports_.emplace(transportPtr, weakTransport)
-                 .second) {
-    QUIC_STATS(statsCallback_, onNewConnection);
+  } else {
+    if (connectionIdTable_) {
+      connectionIdTable_->insert(id, result.first->second);
+    }
+    if (boundServerTransports_.emplace(transportPtr, weakTransport).second) {
+      QUIC_STATS(statsCallback_, onNewConnection);
+    }
   }
 }
 
@@ -785,8 +1661,21 @@ void QuicServerWorker::onConnectionUnbound(
   transport->setRoutingCallback(nullptr);
   boundServerTransports_.erase(transport);
 
+  auto state = transport->getState();
+  if (pathStateCache_ && state && state->transportSettings.cachePathState) {
+    pathStateCache_->update(source.first.getIPAddress(), *state);
+  }
+  if (state) {
+    unboundConnectionsCpuTime_.merge(state->cpuTime);
+  }
+
   if (connectionIdData.size()) {
-    QUIC_STATS(statsCallback_, onConnectionClose, folly::none);
+    if (state) {
+      auto summary = state->getPerfSummary(Clock::now());
+      QUIC_STATS(statsCallback_, onConnectionClose, folly::none, &summary);
+    } else {
+      QUIC_STATS(statsCallback_, onConnectionClose, folly::none, nullptr);
+    }
   }
 
   for (auto& connId : connectionIdData) {
@@ -809,6 +1698,9 @@ void QuicServerWorker::onConnectionUnbound(
       }
     }
     connectionIdMap_.erase(connId.connId);
+    if (connectionIdTable_) {
+      connectionIdTable_->erase(connId.connId);
+    }
     if (incorrectTransportPtr != nullptr) {
       if (boundServerTransports_.find(incorrectTransportPtr) !=
           boundServerTransports_.end()) {
@@ -823,6 +1715,361 @@ void QuicServerWorker::onConnectionUnbound(
   sourceAddressMap_.erase(source);
 }
 
+size_t QuicServerWorker::getNumBoundConnections() const {
+  return boundServerTransports_.size();
+}
+
+bool QuicServerWorker::onConnectionDraining(
+    const folly::SocketAddress& peerAddress,
+    const std::vector<ConnectionIdData>& connectionIdData,
+    Buf closePacket,
+    std::chrono::microseconds drainPeriod) noexcept {
+  if (shutdown_ || !transportSettings_.compactDrainingState ||
+      connectionIdData.empty()) {
+    return false;
+  }
+  auto draining = std::make_shared<DrainingConnection>();
+  draining->peerAddress = peerAddress;
+  draining->closePacket = std::move(closePacket);
+  draining->expiry = Clock::now() + drainPeriod;
+  for (const auto& connIdData : connectionIdData) {
+    drainingConnections_[connIdData.connId] = draining;
+  }
+  if (!drainingSweepTimeout_.isScheduled()) {
+    evb_->timer().scheduleTimeout(
+        &drainingSweepTimeout_, kDrainingSweepInterval);
+  }
+  return true;
+}
+
+size_t QuicServerWorker::getNumDrainingConnectionIds() const {
+  return drainingConnections_.size();
+}
+
+bool QuicServerWorker::handleDrainingConnection(
+    const folly::SocketAddress& client,
+    const RoutingData& routingData,
+    const NetworkData& networkData) {
+  auto it = drainingConnections_.find(routingData.destinationConnId);
+  if (it == drainingConnections_.end()) {
+    return false;
+  }
+  auto& draining = *it->second;
+  if (networkData.receiveTimePoint >= draining.expiry) {
+    drainingConnections_.erase(it);
+    return false;
+  }
+  QUIC_STATS(
+      statsCallback_,
+      onPacketDropped,
+      PacketDropReason::SERVER_STATE_CLOSED);
+  if (++draining.packetsReceived < draining.nextReplyAt ||
+      !draining.closePacket || client != draining.peerAddress) {
+    return true;
+  }
+  draining.nextReplyAt *= 2;
+  VLOG(4) << "Sending close again to draining client=" << client
+          << " CID=" << routingData.destinationConnId;
+  writeStatelessResponse(client, draining.closePacket->clone());
+  return true;
+}
+
+void QuicServerWorker::sweepDrainingConnections() {
+  auto now = Clock::now();
+  for (auto it = drainingConnections_.begin();
+       it != drainingConnections_.end();) {
+    if (it->second->expiry <= now) {
+      it = drainingConnections_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (!drainingConnections_.empty()) {
+    evb_->timer().scheduleTimeout(
+        &drainingSweepTimeout_, kDrainingSweepInterval);
+  }
+}
+
+size_t QuicServerWorker::moveConnectionsTo(
+    QuicServerWorker& other,
+    size_t maxConnections) {
+  CHECK(evb_->isInEventBaseThread());
+  CHECK_NE(&other, this);
+  if (shutdown_ || maxConnections == 0) {
+    return 0;
+  }
+  // Forget the connections moved before that have gone away since.
+  for (auto it = movedConnectionIds_.begin();
+       it != movedConnectionIds_.end();) {
+    if (it->second.transport.expired()) {
+      it = movedConnectionIds_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  folly::F14FastMap<QuicServerTransport*, MovedTransport> moving;
+  for (auto& bound : boundServerTransports_) {
+    if (moving.size() >= maxConnections) {
+      break;
+    }
+    auto transport = bound.second.lock();
+    if (transport && transport->isDetachable()) {
+      moving.emplace(bound.first, MovedTransport{std::move(transport), {}});
+    }
+  }
+  if (moving.empty()) {
+    return 0;
+  }
+  for (auto& entry : connectionIdMap_) {
+    auto it = moving.find(entry.second.get());
+    if (it != moving.end()) {
+      it->second.connIds.push_back(entry.first);
+    }
+  }
+  std::vector<MovedTransport> moved;
+  for (auto& entry : moving) {
+    auto& transport = entry.second.transport;
+    for (auto& connId : entry.second.connIds) {
+      connectionIdMap_.erase(connId);
+      if (connectionIdTable_) {
+        connectionIdTable_->erase(connId);
+      }
+      movedConnectionIds_[connId] = MovedConnection{&other, transport};
+    }
+    boundServerTransports_.erase(entry.first);
+    VLOG(4) << "Moving connection to workerId=" << (uint32_t)other.workerId_
+            << " from workerId=" << (uint32_t)workerId_ << " " << *transport;
+    transport->detachEventBase();
+    moved.push_back(std::move(entry.second));
+  }
+  // Queued ahead of any packet handed on to other from here.
+  other.getEventBase()->runInEventBaseThread(
+      [callback = callback_,
+       target = &other,
+       moved = std::move(moved)]() mutable {
+        target->adoptConnections(std::move(moved));
+      });
+  return moving.size();
+}
+
+void QuicServerWorker::drain(
+    std::chrono::milliseconds timeout,
+    folly::Function<void()> drained) {
+  CHECK(evb_->isInEventBaseThread());
+  draining_ = true;
+  drainDeadline_ = Clock::now() + timeout;
+  drained_ = std::move(drained);
+  drainTimeout_.cancelTimeout();
+  evb_->timer().scheduleTimeout(&drainTimeout_, kDrainCheckInterval);
+}
+
+void QuicServerWorker::stopDraining() {
+  draining_ = false;
+  drained_ = nullptr;
+  drainTimeout_.cancelTimeout();
+}
+
+bool QuicServerWorker::isDraining() const {
+  return draining_;
+}
+
+void QuicServerWorker::checkDrained() {
+  if (!draining_ || shutdown_) {
+    return;
+  }
+  if ((!boundServerTransports_.empty() || !sourceAddressMap_.empty()) &&
+      Clock::now() < drainDeadline_) {
+    evb_->timer().scheduleTimeout(&drainTimeout_, kDrainCheckInterval);
+    return;
+  }
+  VLOG(4) << "Drained workerId=" << (uint32_t)workerId_
+          << " connections=" << boundServerTransports_.size();
+  auto drained = std::move(drained_);
+  drained_ = nullptr;
+  if (drained) {
+    drained();
+  }
+}
+
+void QuicServerWorker::closeAllConnections(
+    LocalErrorCode error,
+    size_t connectionsPerLoop,
+    folly::Function<void()> closed) {
+  CHECK(evb_->isInEventBaseThread());
+  if (shutdown_) {
+    closed();
+    return;
+  }
+  closingConnections_ = true;
+  closeError_ = error;
+  closeConnectionsPerLoop_ = std::max<size_t>(connectionsPerLoop, 1);
+  closeStart_ = Clock::now();
+  closeProgress_ = CloseProgress();
+  closeProgress_.remaining =
+      boundServerTransports_.size() + sourceAddressMap_.size();
+  closed_ = std::move(closed);
+  if (!egressBatch_) {
+    // Sends the close packets of each batch with one sendmmsg.
+    egressBatch_ = std::make_unique<SharedEgressBatch>(evb_);
+    egressBatch_->setBufArena(bufArena_.get());
+  }
+  closeConnectionsCallback_.cancelLoopCallback();
+  closeSomeConnections();
+}
+
+QuicServerWorker::CloseProgress QuicServerWorker::getCloseProgress() const {
+  return closeProgress_;
+}
+
+void QuicServerWorker::closeSomeConnections() {
+  if (!closingConnections_ || shutdown_) {
+    return;
+  }
+  // The transports stay routed while closing, so that they unbind themselves
+  // and are counted like any other closed connection.
+  std::vector<QuicServerTransport::Ptr> closing;
+  std::vector<QuicServerTransport::SourceIdentity> unbound;
+  for (auto& it : sourceAddressMap_) {
+    if (closing.size() == closeConnectionsPerLoop_) {
+      break;
+    }
+    closing.push_back(it.second);
+    unbound.push_back(it.first);
+  }
+  for (auto it = boundServerTransports_.begin();
+       it != boundServerTransports_.end() &&
+       closing.size() < closeConnectionsPerLoop_;) {
+    if (auto transport = it->second.lock()) {
+      closing.push_back(std::move(transport));
+      ++it;
+    } else {
+      it = boundServerTransports_.erase(it);
+    }
+  }
+  for (auto& transport : closing) {
+    if (egressBatch_) {
+      transport->setEgressBatch(egressBatch_.get());
+    }
+    transport->closeNow(std::make_pair(
+        QuicErrorCode(closeError_), std::string("shutting down")));
+  }
+  // Those without a connection id of ours don't unbind themselves.
+  for (auto& source : unbound) {
+    sourceAddressMap_.erase(source);
+  }
+  closeProgress_.closed += closing.size();
+  closeProgress_.remaining =
+      boundServerTransports_.size() + sourceAddressMap_.size();
+  closeProgress_.elapsed =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          Clock::now() - closeStart_);
+  VLOG(4) << "Closing connections workerId=" << (uint32_t)workerId_
+          << " closed=" << closeProgress_.closed
+          << " remaining=" << closeProgress_.remaining
+          << " elapsed=" << closeProgress_.elapsed.count() << "us";
+  if (closeProgress_.remaining > 0 && !closing.empty()) {
+    evb_->runInLoop(&closeConnectionsCallback_);
+    return;
+  }
+  closingConnections_ = false;
+  auto closed = std::move(closed_);
+  closed_ = nullptr;
+  if (closed) {
+    closed();
+  }
+}
+
+void QuicServerWorker::adoptConnections(std::vector<MovedTransport> moved) {
+  for (auto& entry : moved) {
+    auto& transport = entry.transport;
+    if (shutdown_) {
+      transport->setRoutingCallback(nullptr);
+      transport->setTransportStatsCallback(nullptr);
+      transport->attachEventBase(evb_);
+      transport->closeNow(std::make_pair(
+          QuicErrorCode(LocalErrorCode::SHUTTING_DOWN),
+          std::string("shutting down")));
+      continue;
+    }
+    transport->setRoutingCallback(this);
+    transport->setTransportStatsCallback(statsCallback_.get());
+    transport->setConnectionIdAlgo(connIdAlgo_.get());
+    transport->setServerConnectionIdRejector(this);
+    transport->setServerConnectionIdPool(getConnectionIdPool());
+    // The connection ids it issues from now on route here.
+    transport->setServerConnectionIdParams(ServerConnectionIdParams(
+        hostId_, static_cast<uint8_t>(processId_), workerId_));
+    transport->setPacingTimer(pacingTimer_);
+    transport->setPacingScheduler(pacingScheduler_);
+    if (transport->getTransportSettings().dataPathType ==
+        DataPathType::ContinuousMemory) {
+      if (!bufAccessor_) {
+        bufAccessor_ = std::make_unique<SimpleBufAccessor>(
+            kDefaultMaxUDPPayload *
+            transport->getTransportSettings().maxBatchSize);
+      }
+      transport->setBufAccessor(bufAccessor_.get());
+    }
+    transport->setPacketBufArena(bufArena_.get());
+    if (zeroCopyTracker_) {
+      transport->setZeroCopyTracker(zeroCopyTracker_.get());
+    }
+    if (egressBatch_) {
+      transport->setEgressBatch(egressBatch_.get());
+    }
+    if (connectedSocketFactory_) {
+      transport->setConnectedSocketFactory(connectedSocketFactory_);
+    }
+    transport->setTransportParametersCache(&transportParametersCache_);
+    for (auto& connId : entry.connIds) {
+      // It may be coming back.
+      movedConnectionIds_.erase(connId);
+      auto result = connectionIdMap_.emplace(connId, transport);
+      if (result.second && connectionIdTable_) {
+        connectionIdTable_->insert(connId, transport);
+      }
+    }
+    boundServerTransports_.emplace(transport.get(), transport);
+    transport->attachEventBase(evb_);
+  }
+}
+
+bool QuicServerWorker::handOffToMovedConnection(
+    const folly::SocketAddress& client,
+    RoutingData& routingData,
+    NetworkData& networkData,
+    bool isForwardedData) {
+  auto it = movedConnectionIds_.find(routingData.destinationConnId);
+  if (it == movedConnectionIds_.end()) {
+    return false;
+  }
+  if (it->second.transport.expired()) {
+    movedConnectionIds_.erase(it);
+    return false;
+  }
+  auto target = it->second.worker;
+  VLOG(10) << "Handing off packet for moved connection CID="
+           << routingData.destinationConnId.hex()
+           << " to workerId=" << (uint32_t)target->workerId_;
+  target->getEventBase()->runInEventBaseThread(
+      [callback = callback_,
+       target,
+       client,
+       routingData = std::move(routingData),
+       networkData = std::move(networkData),
+       isForwardedData]() mutable {
+        if (target->shutdown_) {
+          return;
+        }
+        target->dispatchPacketData(
+            client,
+            std::move(routingData),
+            std::move(networkData),
+            isForwardedData);
+      });
+  return true;
+}
+
 void QuicServerWorker::shutdownAllConnections(LocalErrorCode error) {
   VLOG(4) << "QuicServer shutdown all connections."
           << " addressMap=" << sourceAddressMap_.size()
@@ -831,6 +2078,14 @@ void QuicServerWorker::shutdownAllConnections(LocalErrorCode error) {
     return;
   }
   shutdown_ = true;
+  drainTimeout_.cancelTimeout();
+  busyPollCallback_.cancelLoopCallback();
+  drained_ = nullptr;
+  closeConnectionsCallback_.cancelLoopCallback();
+  closingConnections_ = false;
+  // Called once the connections below are closed.
+  auto closed = std::move(closed_);
+  closed_ = nullptr;
   if (socket_) {
     socket_->pauseRead();
   }
@@ -855,23 +2110,59 @@ void QuicServerWorker::shutdownAllConnections(LocalErrorCode error) {
       t->setTransportStatsCallback(nullptr);
       t->closeNow(
           std::make_pair(QuicErrorCode(error), std::string("shutting down")));
-      QUIC_STATS(statsCallback_, onConnectionClose, folly::none);
+      auto state = t->getState();
+      if (state) {
+        auto summary = state->getPerfSummary(Clock::now());
+        QUIC_STATS(statsCallback_, onConnectionClose, folly::none, &summary);
+      } else {
+        QUIC_STATS(statsCallback_, onConnectionClose, folly::none, nullptr);
+      }
     }
   }
   sourceAddressMap_.clear();
   connectionIdMap_.clear();
+  if (connectionIdTable_) {
+    connectionIdTable_->clear();
+  }
+  movedConnectionIds_.clear();
+  drainingSweepTimeout_.cancelTimeout();
+  drainingConnections_.clear();
   takeoverPktHandler_.stop();
   if (statsCallback_) {
     statsCallback_.reset();
   }
+  if (egressBatch_) {
+    // The close frames of the transports, while the socket is still open.
+    egressBatch_->flush();
+  }
   socket_.reset();
   takeoverCB_.reset();
+  if (closed) {
+    closed();
+  }
 }
 
 QuicServerWorker::~QuicServerWorker() {
   shutdownAllConnections(LocalErrorCode::SHUTTING_DOWN);
 }
 
+ServerConnectionIdPool* QuicServerWorker::getConnectionIdPool() {
+  if (!connIdPool_ && transportSettings_.connectionIdPoolSize > 0 &&
+      transportSettings_.statelessResetTokenSecret && connIdAlgo_ &&
+      socket_) {
+    connIdPool_ = std::make_unique<ServerConnectionIdPool>(
+        evb_,
+        transportSettings_.connectionIdPoolSize,
+        *connIdAlgo_,
+        ServerConnectionIdParams(
+            hostId_, static_cast<uint8_t>(processId_), workerId_),
+        *transportSettings_.statelessResetTokenSecret,
+        getAddress(),
+        this);
+  }
+  return connIdPool_.get();
+}
+
 bool QuicServerWorker::rejectConnectionId(const ConnectionId& candidate) const
     noexcept {
   return connectionIdMap_.find(candidate) != connectionIdMap_.end();
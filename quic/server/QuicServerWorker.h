@@ -8,23 +8,52 @@
 
 #pragma once
 
+#include <folly/Function.h>
+#include <folly/container/EvictingCacheMap.h>
 #include <folly/container/F14Map.h>
 #include <folly/container/F14Set.h>
 #include <folly/io/SocketOptionMap.h>
 #include <folly/io/async/AsyncUDPSocket.h>
+#include <folly/io/async/HHWheelTimer.h>
 
 #include <quic/codec/ConnectionIdAlgo.h>
+#include <quic/common/BufAccessor.h>
+#include <quic/common/PacingScheduler.h>
+#include <quic/common/PacketBufArena.h>
+#include <quic/common/SharedEgressBatch.h>
 #include <quic/common/Timers.h>
+#include <quic/common/ZeroCopySendTracker.h>
 #include <quic/congestion_control/CongestionControllerFactory.h>
+#include <quic/server/DirectConnectionIdTable.h>
+#include <quic/server/EventLoopLoadObserver.h>
+#include <quic/server/PathStateCache.h>
 #include <quic/server/QuicServerPacketRouter.h>
 #include <quic/server/QuicServerTransportFactory.h>
 #include <quic/server/QuicUDPSocketFactory.h>
+#include <quic/server/RateLimiter.h>
+#include <quic/server/SourceRateLimiter.h>
+#include <quic/server/handshake/RetryTokenGenerator.h>
+#include <quic/server/handshake/ServerTransportParametersCache.h>
+#include <quic/server/handshake/StatelessResetGenerator.h>
+#include <quic/server/state/ServerConnectionIdPool.h>
 #include <quic/server/state/ServerConnectionIdRejector.h>
+#include <quic/state/ConnectionCpuTime.h>
+#include <quic/state/ConnectionMemoryUsage.h>
 #include <quic/state/QuicTransportStatsCallback.h>
 
 namespace quic {
 
+// Clients a server worker keeps a stateless response rate limiter for.
+constexpr size_t kStatelessResponseRateLimiterCacheSize = 10000;
+// Bits of a client address that identify its host, and its network, for the
+// per source rate limits.
+constexpr uint8_t kSourceAddressV4PrefixLength = 32;
+constexpr uint8_t kSourceAddressV6PrefixLength = 64;
+constexpr uint8_t kSourceNetworkV4PrefixLength = 24;
+constexpr uint8_t kSourceNetworkV6PrefixLength = 48;
+
 class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
+                         public folly::AsyncUDPSocket::ErrMessageCallback,
                          public QuicServerTransport::RoutingCallback,
                          public ServerConnectionIdRejector {
  public:
@@ -57,7 +86,9 @@ class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
   /*
    * Take in a function to supply overrides for transport parameters, given
    * the client address as input. This can be useful if we are running
-   * experiments.
+   * experiments, or to pick a congestion controller per peer, e.g. by setting
+   * TransportSettings::congestionControllerName to one registered with the
+   * DefaultCongestionControllerFactory.
    */
   void setTransportSettingsOverrideFn(TransportSettingsOverrideFn fn);
 
@@ -78,6 +109,14 @@ class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
    */
   void bind(const folly::SocketAddress& address);
 
+  /**
+   * Does the allocations the first connections would otherwise pay for,
+   * from the worker's thread so they warm its allocator caches too: fills
+   * the packet buffer arena, and makes the pacing timer and the stateless
+   * reset generator. Must be called after bind() and before start().
+   */
+  void warmUp();
+
   /**
    * start reading data from the socket
    */
@@ -172,6 +211,13 @@ class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
 
   void setNewConnectionSocketFactory(QuicUDPSocketFactory* factory);
 
+  /**
+   * Set the factory transports make their connected sockets with, see
+   * TransportSettings::serverConnectedSocketMinBytes. It must give sockets
+   * with SO_REUSEPORT set, like the listening ones.
+   */
+  void setConnectedSocketFactory(QuicUDPSocketFactory* factory);
+
   void setTransportFactory(QuicServerTransportFactory* factory);
 
   void setSupportedVersions(const std::vector<QuicVersion>& supportedVersions);
@@ -181,11 +227,39 @@ class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
 
   void setTransportSettings(TransportSettings transportSettings);
 
+  /**
+   * Sets the settings of new connections like setTransportSettings, and
+   * applies the fields of them which can change on a live connection to the
+   * existing ones, through the override function if set. Settings older than
+   * the current version are ignored, so that updates which arrive out of
+   * order leave the latest in place. Socket options the worker set up when
+   * it started stay as they are.
+   */
+  void updateTransportSettings(
+      TransportSettings transportSettings,
+      uint64_t version);
+
+  // Version of the last settings given to updateTransportSettings.
+  uint64_t getTransportSettingsVersion() const;
+
   /**
    * If true, start to reject any new connection during handshake
    */
   void rejectNewConnections(bool rejectNewConnections);
 
+  /**
+   * Set the observer of the worker's event base. If
+   * TransportSettings::overloadLoopBusyTime is set, the worker keeps watching
+   * its loop and passes the samples on to the observer.
+   */
+  void setEventBaseObserver(std::shared_ptr<folly::EventBaseObserver> observer);
+
+  /**
+   * Whether the event loop is too busy to take new connections, as set by
+   * TransportSettings::overloadLoopBusyTime.
+   */
+  bool isOverloaded() const;
+
   /**
    * Enable/disable partial reliability on connection settings.
    */
@@ -225,6 +299,27 @@ class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
   void setCongestionControllerFactory(
       std::shared_ptr<CongestionControllerFactory> factory);
 
+  /**
+   * Set the cache of learned path state, which can be shared with other
+   * workers. Without one, the worker makes its own if
+   * TransportSettings::cachePathState is set.
+   */
+  void setPathStateCache(std::shared_ptr<PathStateCache> pathStateCache);
+
+  /**
+   * Set the cache of decoded resumption state, which can be shared with other
+   * workers, for the transports to validate app tokens with.
+   */
+  void setResumptionCache(std::shared_ptr<ResumptionCache> resumptionCache);
+
+  /**
+   * Set the budget of bytes buffered for reading shared with other workers.
+   * If TransportSettings::workerReceiveBufferLimit is set, the worker keeps
+   * its own budget under it.
+   */
+  void setReceiveBufferAccountant(
+      std::shared_ptr<ReceiveBufferAccountant> accountant);
+
   // Read callback
   void getReadBuffer(void** buf, size_t* len) noexcept override;
 
@@ -234,6 +329,14 @@ class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
       bool truncated,
       OnDataAvailableParams params) noexcept override;
 
+  bool shouldOnlyNotify() override;
+
+  /**
+   * Drains up to maxRecvBatchSize datagrams from the socket with a single
+   * recvmmsg call when TransportSettings::shouldRecvBatch is set.
+   */
+  void onNotifyDataAvailable(folly::AsyncUDPSocket& sock) noexcept override;
+
   // Routing callback
   /**
    * Called when a connecton id is available for a new connection (i.e flow)
@@ -259,6 +362,17 @@ class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
       const QuicServerTransport::SourceIdentity& source,
       const std::vector<ConnectionIdData>& connectionIdData) noexcept override;
 
+  /**
+   * Keeps a record of the connection ids and the close packet of a closed
+   * connection, if TransportSettings::compactDrainingState is set, and
+   * answers packets to the ids with the close until drainPeriod is over.
+   */
+  bool onConnectionDraining(
+      const folly::SocketAddress& peerAddress,
+      const std::vector<ConnectionIdData>& connectionIdData,
+      Buf closePacket,
+      std::chrono::microseconds drainPeriod) noexcept override;
+
   // From ServerConnectionIdRejector:
   bool rejectConnectionId(const ConnectionId& candidate) const
       noexcept override;
@@ -267,6 +381,12 @@ class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
 
   void onReadClosed() noexcept override;
 
+  // From ErrMessageCallback, only set with TransportSettings::
+  // enableZeroCopySend.
+  void errMessage(const cmsghdr& cmsg) noexcept override;
+
+  void errMessageError(const folly::AsyncSocketException& ex) noexcept override;
+
   void dispatchPacketData(
       const folly::SocketAddress& client,
       RoutingData&& routingData,
@@ -292,6 +412,88 @@ class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
 
   const SrcToTransportMap& getSrcToTransportMap() const;
 
+  /**
+   * The time this worker's connections spent on the event loop, including
+   * the connections that are gone. Only kept when
+   * TransportSettings::trackCpuTime is set.
+   */
+  ConnectionCpuTime getCpuTime() const;
+
+  /**
+   * The n connections with the most time on the event loop, most first.
+   */
+  std::vector<ConnectionCpuTimeSample> getTopCpuConnections(size_t n) const;
+
+  /**
+   * The memory this worker's connections hold now, which is also handed to
+   * the stats callback.
+   */
+  ConnectionMemoryUsage getMemoryUsage() const;
+
+  /**
+   * The n connections holding the most memory, most first, to find the ones
+   * to close before the process runs out.
+   */
+  std::vector<ConnectionMemoryUsageSample> getTopMemoryConnections(
+      size_t n) const;
+
+  /**
+   * The number of connections with bound connection ids.
+   */
+  size_t getNumBoundConnections() const;
+
+  /**
+   * The number of connection ids of closed connections that are draining
+   * here rather than in their transports.
+   */
+  size_t getNumDrainingConnectionIds() const;
+
+  /**
+   * Moves up to maxConnections detachable connections to other, another
+   * worker of the same server, and returns how many. Called on this worker's
+   * thread; the connections are attached to other on its thread after. The
+   * packets that still come here for their connection ids are handed on to
+   * other, the new ids they issue route to other directly.
+   */
+  size_t moveConnectionsTo(QuicServerWorker& other, size_t maxConnections);
+
+  /**
+   * Waits for this worker's connections to end, and calls drained on this
+   * worker's thread once they have or timeout passed, whichever is first.
+   * The server routes no new connections to a draining worker.
+   */
+  void drain(
+      std::chrono::milliseconds timeout,
+      folly::Function<void()> drained);
+
+  /**
+   * Cancels drain(), without calling drained.
+   */
+  void stopDraining();
+
+  bool isDraining() const;
+
+  /**
+   * Closes this worker's connections with error, connectionsPerLoop of them
+   * each loop iteration so that the packets of the others are still handled
+   * in between, and calls closed on this worker's thread once none are left.
+   * The close packets of an iteration go out together in the shared egress
+   * batch. New connections are turned away meanwhile.
+   */
+  void closeAllConnections(
+      LocalErrorCode error,
+      size_t connectionsPerLoop,
+      folly::Function<void()> closed);
+
+  struct CloseProgress {
+    size_t closed{0};
+    size_t remaining{0};
+    std::chrono::microseconds elapsed{0};
+  };
+
+  // How far the last closeAllConnections() got.
+  CloseProgress getCloseProgress() const;
+
   void shutdownAllConnections(LocalErrorCode error);
 
   // for unit test
@@ -304,10 +506,12 @@ class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
       const folly::SocketAddress& client,
       Buf data,
       const TimePoint& receiveTime,
-      bool isForwardedData = false) noexcept;
+      bool isForwardedData = false,
+      EcnCodepoint ecn = EcnCodepoint::NotEct) noexcept;
 
   /**
-   * Try handling the data as a health check.
+   * Try handling the data as a health check. This is done first on every
+   * datagram, before anything is parsed, so it only compares bytes.
    */
   bool tryHandlingAsHealthCheck(
       const folly::SocketAddress& client,
@@ -356,10 +560,186 @@ class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
       const NetworkData& networkData,
       const ConnectionId& connId);
 
+  // Size of the buffer handed to the socket for a single datagram read.
+  uint64_t getReadBufferSize() const;
+
+  /**
+   * Accounts for and routes the data of a single read, splitting it into
+   * datagrams first if the kernel coalesced them with UDP GRO.
+   */
+  void handleReadData(
+      const folly::SocketAddress& client,
+      Buf data,
+      size_t groSegmentSize,
+      const TimePoint& packetReceiveTime,
+      EcnCodepoint ecn = EcnCodepoint::NotEct) noexcept;
+
+  /**
+   * Queues a short header packet read as part of a batch. Back to back
+   * packets from the same client for the same connection id are routed as a
+   * single NetworkData.
+   */
+  void addToPendingRoute(
+      const folly::SocketAddress& client,
+      ConnectionId connId,
+      Buf data,
+      const TimePoint& packetReceiveTime,
+      EcnCodepoint ecn);
+
+  /**
+   * Routes the packets queued by addToPendingRoute, if any.
+   */
+  void flushPendingRoute();
+
+  void forwardPacketsToAnotherServer(
+      const folly::SocketAddress& client,
+      NetworkData&& networkData);
+
   bool maybeSendVersionNegotiationPacketOrDrop(
       const folly::SocketAddress& client,
       bool isInitial,
-      LongHeaderInvariant& invariant);
+      LongHeaderInvariant& invariant,
+      const TimePoint& packetReceiveTime);
+
+  /**
+   * Whether a version negotiation or stateless reset packet to client goes
+   * over the limits in the transport settings, in which case it isn't sent.
+   */
+  bool shouldRateLimitStatelessResponse(
+      const folly::SocketAddress& client,
+      const TimePoint& time);
+
+  /**
+   * Whether a new connection from client goes over the per source limits in
+   * the transport settings, in which case its Initial is dropped.
+   */
+  bool shouldRateLimitNewConnection(
+      const folly::SocketAddress& client,
+      const TimePoint& time);
+
+  // Sends a packet that belongs to no transport, in the shared egress batch
+  // if there is one.
+  void writeStatelessResponse(const folly::SocketAddress& client, Buf packet);
+
+  /**
+   * Decides whether an Initial with no transport for it starts one. Returns
+   * true if it doesn't, having either answered it with a Retry or dropped it,
+   * which happens to Initials without a valid token once new connections come
+   * faster than TransportSettings::retryNewConnectionRateLimit or while the
+   * worker is overloaded.
+   */
+  bool maybeSendRetryPacketOrDrop(
+      const folly::SocketAddress& client,
+      const NetworkData& networkData);
+
+  void sendRetryPacket(
+      const folly::SocketAddress& client,
+      const LongHeader& initialHeader);
+
+  struct MovedTransport {
+    QuicServerTransport::Ptr transport;
+    std::vector<ConnectionId> connIds;
+  };
+
+  /**
+   * Attaches the connections moveConnectionsTo() detached from another
+   * worker to this one.
+   */
+  void adoptConnections(std::vector<MovedTransport> moved);
+
+  /**
+   * Hands a packet for a connection that was moved to another worker on to
+   * it. Returns false if the connection id isn't one of those.
+   */
+  bool handOffToMovedConnection(
+      const folly::SocketAddress& client,
+      RoutingData& routingData,
+      NetworkData& networkData,
+      bool isForwardedData);
+
+  class DrainTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit DrainTimeout(QuicServerWorker& worker) : worker_(worker) {}
+
+    void timeoutExpired() noexcept override {
+      worker_.checkDrained();
+    }
+
+    void callbackCanceled() noexcept override {}
+
+   private:
+    QuicServerWorker& worker_;
+  };
+
+  void checkDrained();
+
+  class CloseConnectionsCallback : public folly::EventBase::LoopCallback {
+   public:
+    explicit CloseConnectionsCallback(QuicServerWorker& worker)
+        : worker_(worker) {}
+
+    void runLoopCallback() noexcept override {
+      worker_.closeSomeConnections();
+    }
+
+   private:
+    QuicServerWorker& worker_;
+  };
+
+  // Closes the next batch of closeAllConnections().
+  void closeSomeConnections();
+
+  class DrainingSweepTimeout : public folly::HHWheelTimer::Callback {
+   public:
+    explicit DrainingSweepTimeout(QuicServerWorker& worker)
+        : worker_(worker) {}
+
+    void timeoutExpired() noexcept override {
+      worker_.sweepDrainingConnections();
+    }
+
+    void callbackCanceled() noexcept override {}
+
+   private:
+    QuicServerWorker& worker_;
+  };
+
+  // Answers a packet to a draining connection, returns false if the
+  // destination connection id is not of one.
+  bool handleDrainingConnection(
+      const folly::SocketAddress& client,
+      const RoutingData& routingData,
+      const NetworkData& networkData);
+  void sweepDrainingConnections();
+
+  ServerConnectionIdPool* getConnectionIdPool();
+
+  class BusyPollCallback : public folly::EventBase::LoopCallback {
+   public:
+    explicit BusyPollCallback(QuicServerWorker& worker) : worker_(worker) {}
+
+    void runLoopCallback() noexcept override {
+      worker_.busyPoll();
+    }
+
+   private:
+    QuicServerWorker& worker_;
+  };
+
+  /**
+   * Reads one batch off sock with recvmmsg and handles it. Returns the number
+   * of datagrams read, or -1 if reading stopped.
+   */
+  int readBatch(folly::AsyncUDPSocket& sock);
+
+  // Keeps polling through the event loop after a read while
+  // TransportSettings::busyPollWindow and the budget allow.
+  void maybeBusyPoll(int numRead);
+  void busyPoll();
+
+  // Reports the packets the kernel dropped on the socket since the last count
+  // it handed out, and grows the receive buffer if it may.
+  void onSocketDropCount(uint32_t dropCount);
 
   std::unique_ptr<folly::AsyncUDPSocket> socket_;
   folly::SocketOptionMap* socketOptions_{nullptr};
@@ -368,27 +748,149 @@ class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
 
   // factories are owned by quic server
   QuicUDPSocketFactory* socketFactory_;
+  QuicUDPSocketFactory* connectedSocketFactory_{nullptr};
   QuicServerTransportFactory* transportFactory_;
   std::shared_ptr<CongestionControllerFactory> ccFactory_{nullptr};
+  std::shared_ptr<PathStateCache> pathStateCache_;
+  // Time of the connections that have been unbound.
+  ConnectionCpuTime unboundConnectionsCpuTime_;
+  std::shared_ptr<ResumptionCache> resumptionCache_;
+  std::shared_ptr<ReceiveBufferAccountant> receiveBufferAccountant_;
+
+  // Output buffer shared by all transports of this worker that write with
+  // DataPathType::ContinuousMemory. Declared before the transport maps so it
+  // outlives them.
+  std::unique_ptr<BufAccessor> bufAccessor_;
+  // Packet buffers shared by all transports of this worker.
+  std::unique_ptr<PacketBufArena> bufArena_;
+  // Packets of all transports of this worker, written once per loop, if
+  // TransportSettings::useSharedEgressBatch is set. Declared after bufArena_
+  // as it gives buffers back to it.
+  std::unique_ptr<SharedEgressBatch> egressBatch_;
+  // Set if TransportSettings::enableZeroCopySend and the socket supports it.
+  // Declared after bufArena_ as it gives buffers back to it.
+  std::unique_ptr<ZeroCopySendTracker> zeroCopyTracker_;
+  // Encoded transport parameters shared by all transports of this worker.
+  ServerTransportParametersCache transportParametersCache_;
 
   // A server transport's membership is exclusive to only one of these maps.
   ConnIdToTransportMap connectionIdMap_;
   SrcToTransportMap sourceAddressMap_;
+  // Looked up before connectionIdMap_, if
+  // TransportSettings::connectionIdTableSize is set.
+  std::unique_ptr<DirectConnectionIdTable<QuicServerTransport::Ptr>>
+      connectionIdTable_;
 
   // Contains every unique transport that is mapped in connectionIdMap_.
   folly::F14FastMap<QuicServerTransport*, std::weak_ptr<QuicServerTransport>>
       boundServerTransports_;
 
+  // Connection ids of the connections moved to other workers, until the
+  // connections go away.
+  struct MovedConnection {
+    QuicServerWorker* worker;
+    std::weak_ptr<QuicServerTransport> transport;
+  };
+  folly::F14FastMap<ConnectionId, MovedConnection, ConnectionIdHash>
+      movedConnectionIds_;
+
+  // What is left of a closed connection, shared by its connection ids, while
+  // TransportSettings::compactDrainingState has it drain here.
+  struct DrainingConnection {
+    folly::SocketAddress peerAddress;
+    // Null if the peer closed the connection, as it gets nothing back then.
+    Buf closePacket;
+    TimePoint expiry;
+    uint32_t packetsReceived{0};
+    // The close goes out again for the packet of this count, which doubles
+    // each time, so that the peer can't make us send more than it does.
+    uint32_t nextReplyAt{1};
+  };
+  folly::F14FastMap<
+      ConnectionId,
+      std::shared_ptr<DrainingConnection>,
+      ConnectionIdHash>
+      drainingConnections_;
+  DrainingSweepTimeout drainingSweepTimeout_{*this};
+
   Buf readBuffer_;
+  // Message headers and read buffers reused across recvmmsg calls.
+  RecvmmsgStorage recvmmsgStorage_;
+  // Set while the packets of a recvmmsg or GRO read are being handled.
+  bool batchingReads_{false};
+  struct PendingRoute {
+    folly::SocketAddress client;
+    ConnectionId connId;
+    NetworkData networkData;
+  };
+  folly::Optional<PendingRoute> pendingRoute_;
   bool shutdown_{false};
+  bool draining_{false};
+  TimePoint drainDeadline_;
+  folly::Function<void()> drained_;
+  DrainTimeout drainTimeout_{*this};
+  // State of closeAllConnections().
+  bool closingConnections_{false};
+  LocalErrorCode closeError_{LocalErrorCode::SHUTTING_DOWN};
+  size_t closeConnectionsPerLoop_{0};
+  TimePoint closeStart_;
+  CloseProgress closeProgress_;
+  folly::Function<void()> closed_;
+  CloseConnectionsCallback closeConnectionsCallback_{*this};
+  BusyPollCallback busyPollCallback_{*this};
+  // When the socket had packets last, and when it was last polled.
+  TimePoint lastBusyPollPacketTime_;
+  TimePoint lastBusyPollTime_;
+  // Time spent polling without reading anything in the current period.
+  TimePoint busyPollPeriodStart_;
+  Clock::duration busyPollIdleTime_{Clock::duration::zero()};
+  // Last count of socket drops read, the kernel counts from the start.
+  uint32_t socketDropCount_{0};
+  // Whether the receive buffer can't be grown any more.
+  bool socketRecvBufferAtLimit_{false};
   std::vector<QuicVersion> supportedVersions_;
   std::shared_ptr<const fizz::server::FizzServerContext> ctx_;
   TransportSettings transportSettings_;
+  uint64_t transportSettingsVersion_{0};
   folly::Optional<Buf> healthCheckToken_;
+  // Written back for every health check.
+  Buf healthCheckResponse_;
+  // Made by the first reset, and reused along with its buffer unless it goes
+  // out in the shared egress batch.
+  std::unique_ptr<StatelessResetGenerator> resetGenerator_;
+  Buf resetPacketBuf_;
   bool rejectNewConnections_{false};
   uint8_t workerId_{0};
   std::unique_ptr<ConnectionIdAlgo> connIdAlgo_;
   uint16_t hostId_{0};
+  // Made on first use if TransportSettings::connectionIdPoolSize is set, and
+  // again once what the ids are made from changes.
+  std::unique_ptr<ServerConnectionIdPool> connIdPool_;
+  // Set up if TransportSettings::retryNewConnectionRateLimit is set.
+  std::unique_ptr<RetryTokenGenerator> retryTokenGenerator_;
+  std::unique_ptr<Aead> retryAead_;
+  std::unique_ptr<RateLimiter> newConnectionRateLimiter_;
+  std::unique_ptr<RateLimiter> retryRateLimiter_;
+  // Set up if TransportSettings::maxStatelessResponsesPerSecond is set.
+  std::unique_ptr<RateLimiter> statelessResponseRateLimiter_;
+  // Set up if TransportSettings::maxStatelessResponsesPerClientPerSecond is
+  // set, with the least recently seen clients evicted first.
+  using ClientRateLimiters =
+      folly::EvictingCacheMap<folly::IPAddress, std::unique_ptr<RateLimiter>>;
+  std::unique_ptr<ClientRateLimiters> clientStatelessResponseRateLimiters_;
+  // Set up if TransportSettings::maxStatelessResponsesPerNetworkPerSecond is
+  // set.
+  std::unique_ptr<SourceRateLimiter> networkStatelessResponseRateLimiter_;
+  // Set up if TransportSettings::maxNewConnectionsPerClientPerSecond and
+  // maxNewConnectionsPerNetworkPerSecond are set.
+  std::unique_ptr<SourceRateLimiter> clientNewConnectionRateLimiter_;
+  std::unique_ptr<SourceRateLimiter> networkNewConnectionRateLimiter_;
+  // Version negotiation packets with empty connection ids, which are patched
+  // in for each client. Made when first needed.
+  Buf versionNegotiationTemplate_;
+  Buf rejectionTemplate_;
+  // Set up if TransportSettings::overloadLoopBusyTime is set.
+  std::shared_ptr<EventLoopLoadObserver> loadObserver_;
   // QuicServerWorker maintains ownership of the info stats callback
   std::unique_ptr<QuicTransportStatsCallback> statsCallback_;
 
@@ -398,7 +900,13 @@ class QuicServerWorker : public folly::AsyncUDPSocket::ReadCallback,
   TakeoverPacketHandler takeoverPktHandler_;
   bool packetForwardingEnabled_{false};
   using PacketDropReason = QuicTransportStatsCallback::PacketDropReason;
+  // The worker's microsecond timer, for pacing and, with
+  // TransportSettings::useHighResTimers, the loss and ack timers of its
+  // transports.
   TimerHighRes::SharedPtr pacingTimer_;
+  // Shared by the paced transports of this worker when
+  // TransportSettings::usePacingScheduler is set.
+  PacingScheduler::SharedPtr pacingScheduler_;
 
   // Used to override certain transport parameters, given the client address
   TransportSettingsOverrideFn transportSettingsOverrideFn_;
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/server/ReusePortSteering.h>
+
+#include <folly/portability/Sockets.h>
+#include <quic/codec/QuicConnectionId.h>
+
+#include <cerrno>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/filter.h>
+#endif
+
+namespace quic {
+
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+namespace {
+// The program sees the UDP payload. The server connection id of a short
+// header packet starts right after the first byte.
+constexpr uint32_t kShortHeaderConnIdOffset = 1;
+// Enough for the first byte and the bytes carrying the version and worker id.
+constexpr uint32_t kMinSteerablePacketLen = kShortHeaderConnIdOffset + 4;
+// Any index past the end of the group makes the kernel hash the packet.
+constexpr uint32_t kFallbackToHash = 0xffffffff;
+} // namespace
+
+folly::Expected<folly::Unit, int> attachWorkerIdSteeringProgram(
+    int fd,
+    bool steerByCpu) {
+  // Mirrors the layout of DefaultConnectionIdAlgo: the version in the top two
+  // bits of byte 0, and the worker id in the low six bits of byte 2 followed
+  // by the top two bits of byte 3.
+  std::vector<struct sock_filter> code = {
+      // Too short to be steered.
+      BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+      BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, kMinSteerablePacketLen, 0, 13),
+      // Long header.
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0),
+      BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x80, 11, 0),
+      // Connection id not from DefaultConnectionIdAlgo.
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, kShortHeaderConnIdOffset),
+      BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xc0),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, kShortVersionId << 6, 0, 8),
+      // workerId = (cid[2] & 0x3f) << 2 | cid[3] >> 6
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, kShortHeaderConnIdOffset + 2),
+      BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0x3f),
+      BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 2),
+      BPF_STMT(BPF_MISC | BPF_TAX, 0),
+      BPF_STMT(BPF_LD | BPF_B | BPF_ABS, kShortHeaderConnIdOffset + 3),
+      BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 6),
+      BPF_STMT(BPF_ALU | BPF_OR | BPF_X, 0),
+      BPF_STMT(BPF_RET | BPF_A, 0),
+  };
+  // What the jumps above skip to.
+  if (steerByCpu) {
+    code.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_CPU));
+    code.push_back(BPF_STMT(BPF_RET | BPF_A, 0));
+  } else {
+    code.push_back(BPF_STMT(BPF_RET | BPF_K, kFallbackToHash));
+  }
+  struct sock_fprog prog = {
+      static_cast<unsigned short>(code.size()), code.data()};
+  if (::setsockopt(
+          fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) !=
+      0) {
+    return folly::makeUnexpected(errno);
+  }
+  return folly::unit;
+}
+#else
+folly::Expected<folly::Unit, int> attachWorkerIdSteeringProgram(int, bool) {
+  return folly::makeUnexpected(ENOTSUP);
+}
+#endif
+
+#if defined(__linux__) && defined(SO_INCOMING_CPU)
+folly::Expected<folly::Unit, int> setIncomingCpu(int fd, int cpu) {
+  if (::setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) != 0) {
+    return folly::makeUnexpected(errno);
+  }
+  return folly::unit;
+}
+#else
+folly::Expected<folly::Unit, int> setIncomingCpu(int, int) {
+  return folly::makeUnexpected(ENOTSUP);
+}
+#endif
+} // namespace quic
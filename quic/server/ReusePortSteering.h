@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Expected.h>
+#include <folly/Unit.h>
+
+namespace quic {
+
+/**
+ * Attaches a SO_ATTACH_REUSEPORT_CBPF program to the reuseport group of the
+ * given bound socket. It picks the socket of a short header packet from the
+ * worker id that DefaultConnectionIdAlgo encodes in the server connection id,
+ * so the packet reaches its worker even after the client's 4-tuple changed.
+ * Long header packets, and anything it can't parse, get the kernel's 4-tuple
+ * hash as before.
+ *
+ * With steerByCpu, those go instead to the socket with the index of the CPU
+ * that received them, for when worker i is pinned to CPU i. Packets landing
+ * on CPUs past the end of the group are still hashed.
+ *
+ * This relies on the sockets having joined the group in worker id order, and
+ * is only correct with DefaultConnectionIdAlgo. Returns the errno on failure,
+ * or ENOTSUP where the platform has no such option.
+ */
+folly::Expected<folly::Unit, int> attachWorkerIdSteeringProgram(
+    int fd,
+    bool steerByCpu = false);
+
+/**
+ * Sets SO_INCOMING_CPU on the socket, so that a reuseport group without a
+ * steering program prefers it for packets received on cpu. Returns the errno
+ * on failure, or ENOTSUP where the platform has no such option.
+ */
+folly::Expected<folly::Unit, int> setIncomingCpu(int fd, int cpu);
+} // namespace quic
@@ -0,0 +1,95 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#include "SourceRateLimiter.h"
+
+#include <folly/Random.h>
+#include <folly/hash/SpookyHashV2.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace quic {
+
+SourceRateLimiter::SourceRateLimiter(
+    uint64_t count,
+    std::chrono::seconds window,
+    uint8_t v4PrefixLength,
+    uint8_t v6PrefixLength,
+    size_t width,
+    size_t depth)
+    : count_(count),
+      window_(window),
+      v4PrefixLength_(std::min<uint8_t>(v4PrefixLength, 32)),
+      v6PrefixLength_(std::min<uint8_t>(v6PrefixLength, 128)),
+      width_(std::max<size_t>(width, 1)),
+      depth_(std::max<size_t>(depth, 1)),
+      seed_(folly::Random::rand64()),
+      countsInCurWindow_(width_ * depth_),
+      countsInPrevWindow_(width_ * depth_),
+      cells_(depth_) {}
+
+void SourceRateLimiter::maybeStartWindow(TimePoint time) {
+  // This is the first time point.
+  if (!currentWindowStartPoint_) {
+    currentWindowStartPoint_ = time;
+  }
+  auto timeElapsedSinceCurWindow = time - currentWindowStartPoint_.value();
+  if (timeElapsedSinceCurWindow < window_) {
+    return;
+  }
+  auto windowsElapsed = timeElapsedSinceCurWindow / window_;
+  currentWindowStartPoint_.value() += window_ * windowsElapsed;
+  // If more than one window has elapsed, there were none in the previous
+  // window.
+  if (windowsElapsed == 1) {
+    std::swap(countsInPrevWindow_, countsInCurWindow_);
+  } else {
+    std::fill(countsInPrevWindow_.begin(), countsInPrevWindow_.end(), 0);
+  }
+  std::fill(countsInCurWindow_.begin(), countsInCurWindow_.end(), 0);
+}
+
+bool SourceRateLimiter::check(
+    const folly::IPAddress& address,
+    TimePoint time) {
+  maybeStartWindow(time);
+  folly::IPAddress source = address.isIPv4Mapped()
+      ? folly::IPAddress(address.createIPv4())
+      : address;
+  source = source.mask(source.isV4() ? v4PrefixLength_ : v6PrefixLength_);
+  uint64_t hash1 = seed_;
+  uint64_t hash2 = seed_ + 1;
+  folly::hash::SpookyHashV2::Hash128(
+      source.bytes(), source.byteCount(), &hash1, &hash2);
+  // Derives a cell per row from the two halves of one hash.
+  hash2 |= 1;
+  for (size_t row = 0; row < depth_; ++row) {
+    cells_[row] = row * width_ + (hash1 + row * hash2) % width_;
+  }
+
+  // The previous window counts for the part of it the sliding window still
+  // covers.
+  std::chrono::duration<double> timeLeftOfPrevWindow =
+      window_ - (time - currentWindowStartPoint_.value());
+  double prevWeight =
+      std::min(std::max(timeLeftOfPrevWindow / window_, 0.0), 1.0);
+  // Every row overcounts the source by the others sharing its cell, so the
+  // least of them is the closest.
+  double weightedCount = std::numeric_limits<double>::max();
+  for (auto cell : cells_) {
+    weightedCount = std::min(
+        weightedCount,
+        countsInPrevWindow_[cell] * prevWeight + countsInCurWindow_[cell] + 1);
+  }
+  bool limited = weightedCount > count_;
+  if (!limited) {
+    for (auto cell : cells_) {
+      if (countsInCurWindow_[cell] < std::numeric_limits<uint32_t>::max()) {
+        ++countsInCurWindow_[cell];
+      }
+    }
+  }
+  return limited;
+}
+
+} // namespace quic
@@ -0,0 +1,61 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#pragma once
+
+#include <folly/IPAddress.h>
+#include <quic/server/RateLimiter.h>
+
+#include <vector>
+
+namespace quic {
+
+/*
+ * Sliding window rate limiter, like SlidingWindowRateLimiter, of count events
+ * per window for each source, where the source of an event is its address
+ * masked to v4PrefixLength or v6PrefixLength bits. IPv4-mapped IPv6 addresses
+ * count as IPv4.
+ *
+ * The events are counted in a count-min sketch of depth rows of width
+ * counters, for the current and for the previous window, so the memory
+ * doesn't grow with the number of sources. A source sharing all of its
+ * counters with busier ones may be limited early, never late. The hashes are
+ * seeded at random, so that sources can't be picked to collide.
+ */
+class SourceRateLimiter {
+ public:
+  static constexpr size_t kDefaultWidth = 2048;
+  static constexpr size_t kDefaultDepth = 4;
+
+  SourceRateLimiter(
+      uint64_t count,
+      std::chrono::seconds window,
+      uint8_t v4PrefixLength,
+      uint8_t v6PrefixLength,
+      size_t width = kDefaultWidth,
+      size_t depth = kDefaultDepth);
+
+  /*
+   * Check if an event from address at a certain time should be rate limited.
+   * Returns true if it should be rate limited.
+   */
+  bool check(const folly::IPAddress& address, TimePoint time);
+
+ private:
+  void maybeStartWindow(TimePoint time);
+
+  const uint64_t count_;
+  const std::chrono::seconds window_;
+  const uint8_t v4PrefixLength_;
+  const uint8_t v6PrefixLength_;
+  const size_t width_;
+  const size_t depth_;
+  const uint64_t seed_;
+  folly::Optional<TimePoint> currentWindowStartPoint_{folly::none};
+  // depth_ rows of width_ counters.
+  std::vector<uint32_t> countsInCurWindow_;
+  std::vector<uint32_t> countsInPrevWindow_;
+  // Cells of the source being checked, one per row.
+  std::vector<size_t> cells_;
+};
+
+} // namespace quic
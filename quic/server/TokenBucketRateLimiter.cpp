@@ -0,0 +1,26 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#include "TokenBucketRateLimiter.h"
+
+#include <algorithm>
+
+namespace quic {
+
+bool TokenBucketRateLimiter::check(TimePoint time) {
+  if (lastRefill_ && time > *lastRefill_) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        time - *lastRefill_);
+    tokens_ = std::min<double>(
+        burst_, tokens_ + rate_ * (elapsed.count() / 1000000.0));
+  }
+  if (!lastRefill_ || time > *lastRefill_) {
+    lastRefill_ = time;
+  }
+  if (tokens_ < 1) {
+    return true;
+  }
+  tokens_ -= 1;
+  return false;
+}
+
+} // namespace quic
@@ -0,0 +1,28 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#pragma once
+
+#include <quic/server/RateLimiter.h>
+
+namespace quic {
+
+/*
+ * Token bucket rate limiter. The bucket holds up to burst tokens and refills
+ * at rate tokens per second, each event that isn't limited takes one. It
+ * starts full, so that a burst is allowed right away.
+ */
+class TokenBucketRateLimiter : public RateLimiter {
+ public:
+  TokenBucketRateLimiter(uint64_t rate, uint64_t burst)
+      : rate_(rate), burst_(burst), tokens_(burst) {}
+
+  bool check(TimePoint time) override;
+
+ private:
+  const uint64_t rate_;
+  const uint64_t burst_;
+  double tokens_;
+  folly::Optional<TimePoint> lastRefill_{folly::none};
+};
+
+} // namespace quic
@@ -12,6 +12,7 @@
 #include <quic/api/QuicSocket.h>
 #include <quic/api/QuicTransportFunctions.h>
 #include <quic/handshake/TransportParameters.h>
+#include <quic/server/handshake/ResumptionCache.h>
 #include <quic/server/state/ServerStateMachine.h>
 
 #include <fizz/server/ResumptionState.h>
@@ -28,8 +29,9 @@
 namespace quic {
 
 DefaultAppTokenValidator::DefaultAppTokenValidator(
-    QuicServerConnectionState* conn)
-    : conn_(conn) {}
+    QuicServerConnectionState* conn,
+    std::shared_ptr<ResumptionCache> resumptionCache)
+    : conn_(conn), resumptionCache_(std::move(resumptionCache)) {}
 
 bool DefaultAppTokenValidator::validate(
     const fizz::server::ResumptionState& resumptionState) const {
@@ -41,7 +43,17 @@ bool DefaultAppTokenValidator::validate(
     return false;
   }
 
-  auto appToken = decodeAppToken(*resumptionState.appToken);
+  // Either owns the token decoded here or holds the cached one.
+  folly::Optional<AppToken> decodedAppToken;
+  std::shared_ptr<const AppToken> cachedAppToken;
+  const AppToken* appToken = nullptr;
+  if (resumptionCache_) {
+    cachedAppToken = resumptionCache_->getAppToken(*resumptionState.appToken);
+    appToken = cachedAppToken.get();
+  } else {
+    decodedAppToken = decodeAppToken(*resumptionState.appToken);
+    appToken = decodedAppToken.get_pointer();
+  }
   if (!appToken) {
     VLOG(10) << "Failed to decode app token";
     return false;
@@ -126,8 +138,7 @@ bool DefaultAppTokenValidator::validate(
 
   conn_->transportParamsMatching = true;
 
-  if (!validateAndUpdateSourceToken(
-          *conn_, std::move(appToken->sourceAddresses))) {
+  if (!validateAndUpdateSourceToken(*conn_, appToken->sourceAddresses)) {
     VLOG(10) << "No exact match from source address token";
     return false;
   }
@@ -25,15 +25,22 @@ struct ResumptionState;
 
 namespace quic {
 struct QuicServerConnectionState;
+class ResumptionCache;
 
 class DefaultAppTokenValidator : public fizz::server::AppTokenValidator {
  public:
-  explicit DefaultAppTokenValidator(QuicServerConnectionState* conn);
+  /**
+   * App tokens are decoded through resumptionCache, if there is one.
+   */
+  explicit DefaultAppTokenValidator(
+      QuicServerConnectionState* conn,
+      std::shared_ptr<ResumptionCache> resumptionCache = nullptr);
 
   bool validate(const fizz::server::ResumptionState&) const override;
 
  private:
   QuicServerConnectionState* conn_;
+  std::shared_ptr<ResumptionCache> resumptionCache_;
 };
 
 } // namespace quic
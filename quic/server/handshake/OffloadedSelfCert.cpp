@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/server/handshake/OffloadedSelfCert.h>
+
+namespace quic {
+
+OffloadedSelfCert::OffloadedSelfCert(
+    std::shared_ptr<fizz::SelfCert> cert,
+    std::shared_ptr<folly::Executor> signExecutor)
+    : cert_(std::move(cert)), signExecutor_(std::move(signExecutor)) {
+  CHECK(cert_);
+  CHECK(signExecutor_);
+}
+
+std::string OffloadedSelfCert::getIdentity() const {
+  return cert_->getIdentity();
+}
+
+std::vector<std::string> OffloadedSelfCert::getAltIdentities() const {
+  return cert_->getAltIdentities();
+}
+
+std::vector<fizz::SignatureScheme> OffloadedSelfCert::getSigSchemes() const {
+  return cert_->getSigSchemes();
+}
+
+fizz::CertificateMsg OffloadedSelfCert::getCertMessage(
+    Buf certificateRequestContext) const {
+  return cert_->getCertMessage(std::move(certificateRequestContext));
+}
+
+fizz::CompressedCertificate OffloadedSelfCert::getCompressedCert(
+    fizz::CertificateCompressionAlgorithm algo) const {
+  return cert_->getCompressedCert(algo);
+}
+
+Buf OffloadedSelfCert::sign(
+    fizz::SignatureScheme scheme,
+    fizz::CertificateVerifyContext context,
+    folly::ByteRange toBeSigned) const {
+  return cert_->sign(scheme, context, toBeSigned);
+}
+
+folly::ssl::X509UniquePtr OffloadedSelfCert::getX509() const {
+  return cert_->getX509();
+}
+
+folly::Future<folly::Optional<Buf>> OffloadedSelfCert::signFuture(
+    fizz::SignatureScheme scheme,
+    fizz::CertificateVerifyContext context,
+    folly::ByteRange toBeSigned) const {
+  // The range is only valid for this call, so the executor gets a copy.
+  return folly::via(
+      signExecutor_.get(),
+      [cert = cert_,
+       scheme,
+       context,
+       data = folly::IOBuf::copyBuffer(toBeSigned)]() {
+        return folly::Optional<Buf>(
+            cert->sign(scheme, context, data->coalesce()));
+      });
+}
+} // namespace quic
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <fizz/server/AsyncSelfCert.h>
+#include <folly/Executor.h>
+#include <folly/futures/Future.h>
+#include <quic/common/BufUtil.h>
+
+namespace quic {
+
+/**
+ * A certificate whose signatures are computed on another executor.
+ *
+ * Signing the CertificateVerify is the most expensive step of a full
+ * handshake. fizz waits on signFuture() without blocking, continuing on the
+ * executor the handshake was initialized with, so a worker wrapping its certs
+ * in this keeps processing the packets of its other connections while a
+ * shared CPU pool does the signing.
+ *
+ * Everything else is forwarded to the wrapped certificate.
+ */
+class OffloadedSelfCert : public fizz::server::AsyncSelfCert {
+ public:
+  OffloadedSelfCert(
+      std::shared_ptr<fizz::SelfCert> cert,
+      std::shared_ptr<folly::Executor> signExecutor);
+
+  ~OffloadedSelfCert() override = default;
+
+  std::string getIdentity() const override;
+
+  std::vector<std::string> getAltIdentities() const override;
+
+  std::vector<fizz::SignatureScheme> getSigSchemes() const override;
+
+  fizz::CertificateMsg getCertMessage(
+      Buf certificateRequestContext = nullptr) const override;
+
+  fizz::CompressedCertificate getCompressedCert(
+      fizz::CertificateCompressionAlgorithm algo) const override;
+
+  Buf sign(
+      fizz::SignatureScheme scheme,
+      fizz::CertificateVerifyContext context,
+      folly::ByteRange toBeSigned) const override;
+
+  folly::ssl::X509UniquePtr getX509() const override;
+
+  folly::Future<folly::Optional<Buf>> signFuture(
+      fizz::SignatureScheme scheme,
+      fizz::CertificateVerifyContext context,
+      folly::ByteRange toBeSigned) const override;
+
+ private:
+  std::shared_ptr<fizz::SelfCert> cert_;
+  std::shared_ptr<folly::Executor> signExecutor_;
+};
+} // namespace quic
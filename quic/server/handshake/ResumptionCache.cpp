@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/server/handshake/ResumptionCache.h>
+
+#include <functional>
+
+namespace {
+std::string toKey(const folly::IOBuf& buf) {
+  std::string key;
+  key.reserve(buf.computeChainDataLength());
+  for (auto range : buf) {
+    key.append(reinterpret_cast<const char*>(range.data()), range.size());
+  }
+  return key;
+}
+} // namespace
+
+namespace quic {
+
+fizz::server::ResumptionState cloneResumptionState(
+    const fizz::server::ResumptionState& state) {
+  fizz::server::ResumptionState clone;
+  clone.version = state.version;
+  clone.cipher = state.cipher;
+  clone.resumptionSecret =
+      state.resumptionSecret ? state.resumptionSecret->clone() : nullptr;
+  clone.serverCert = state.serverCert;
+  clone.clientCert = state.clientCert;
+  clone.alpn = state.alpn;
+  clone.ticketAgeAdd = state.ticketAgeAdd;
+  clone.ticketIssueTime = state.ticketIssueTime;
+  clone.appToken = state.appToken ? state.appToken->clone() : nullptr;
+  clone.handshakeTime = state.handshakeTime;
+  return clone;
+}
+
+ResumptionCache::ResumptionCache(size_t capacity, size_t numStripes) {
+  CHECK_GT(numStripes, 0);
+  size_t stripeCapacity = std::max<size_t>(capacity / numStripes, 1);
+  for (size_t i = 0; i < numStripes; ++i) {
+    resumptionStates_.push_back(
+        std::make_unique<Stripe<fizz::server::ResumptionState>>(
+            stripeCapacity));
+    appTokens_.push_back(std::make_unique<Stripe<AppToken>>(stripeCapacity));
+  }
+}
+
+template <typename V>
+ResumptionCache::Stripe<V>& ResumptionCache::stripeFor(
+    Stripes<V>& stripes,
+    const std::string& key) {
+  return *stripes[std::hash<std::string>()(key) % stripes.size()];
+}
+
+template <typename V>
+size_t ResumptionCache::countEntries(const Stripes<V>& stripes) {
+  size_t count = 0;
+  for (const auto& stripe : stripes) {
+    std::lock_guard<std::mutex> guard(stripe->mutex);
+    count += stripe->entries.size();
+  }
+  return count;
+}
+
+folly::Optional<fizz::server::ResumptionState>
+ResumptionCache::getResumptionState(const folly::IOBuf& ticket) {
+  auto key = toKey(ticket);
+  auto& stripe = stripeFor(resumptionStates_, key);
+  std::shared_ptr<const fizz::server::ResumptionState> state;
+  {
+    std::lock_guard<std::mutex> guard(stripe.mutex);
+    auto it = stripe.entries.find(key);
+    if (it == stripe.entries.end()) {
+      return folly::none;
+    }
+    state = it->second;
+  }
+  // The buffers are cloned outside of the lock.
+  return cloneResumptionState(*state);
+}
+
+void ResumptionCache::putResumptionState(
+    const folly::IOBuf& ticket,
+    const fizz::server::ResumptionState& state) {
+  auto key = toKey(ticket);
+  auto entry = std::make_shared<const fizz::server::ResumptionState>(
+      cloneResumptionState(state));
+  auto& stripe = stripeFor(resumptionStates_, key);
+  std::lock_guard<std::mutex> guard(stripe.mutex);
+  stripe.entries.set(std::move(key), std::move(entry));
+}
+
+std::shared_ptr<const AppToken> ResumptionCache::getAppToken(
+    const folly::IOBuf& encoded) {
+  auto key = toKey(encoded);
+  auto& stripe = stripeFor(appTokens_, key);
+  {
+    std::lock_guard<std::mutex> guard(stripe.mutex);
+    auto it = stripe.entries.find(key);
+    if (it != stripe.entries.end()) {
+      return it->second;
+    }
+  }
+  auto decoded = decodeAppToken(encoded);
+  if (!decoded) {
+    return nullptr;
+  }
+  auto appToken = std::make_shared<const AppToken>(std::move(*decoded));
+  std::lock_guard<std::mutex> guard(stripe.mutex);
+  stripe.entries.set(std::move(key), appToken);
+  return appToken;
+}
+
+size_t ResumptionCache::numResumptionStates() const {
+  return countEntries(resumptionStates_);
+}
+
+size_t ResumptionCache::numAppTokens() const {
+  return countEntries(appTokens_);
+}
+
+CachingTicketCipher::CachingTicketCipher(
+    std::shared_ptr<fizz::server::TicketCipher> cipher,
+    std::shared_ptr<ResumptionCache> cache)
+    : cipher_(std::move(cipher)), cache_(std::move(cache)) {
+  CHECK(cipher_);
+  CHECK(cache_);
+}
+
+folly::Future<folly::Optional<
+    std::pair<std::unique_ptr<folly::IOBuf>, std::chrono::seconds>>>
+CachingTicketCipher::encrypt(fizz::server::ResumptionState resState) const {
+  auto state = cloneResumptionState(resState);
+  return cipher_->encrypt(std::move(resState))
+      .thenValue([cache = cache_, state = std::move(state)](
+                     folly::Optional<std::pair<
+                         std::unique_ptr<folly::IOBuf>,
+                         std::chrono::seconds>> ticket) {
+        if (ticket && ticket->first) {
+          cache->putResumptionState(*ticket->first, state);
+        }
+        return ticket;
+      });
+}
+
+folly::Future<
+    std::pair<fizz::PskType, folly::Optional<fizz::server::ResumptionState>>>
+CachingTicketCipher::decrypt(
+    std::unique_ptr<folly::IOBuf> encryptedTicket) const {
+  auto cached = cache_->getResumptionState(*encryptedTicket);
+  if (cached) {
+    return std::make_pair(fizz::PskType::Resumption, std::move(cached));
+  }
+  auto ticket = encryptedTicket->clone();
+  return cipher_->decrypt(std::move(encryptedTicket))
+      .thenValue([cache = cache_, ticket = std::move(ticket)](
+                     std::pair<
+                         fizz::PskType,
+                         folly::Optional<fizz::server::ResumptionState>>
+                         result) {
+        if (result.first == fizz::PskType::Resumption && result.second) {
+          cache->putResumptionState(*ticket, *result.second);
+        }
+        return result;
+      });
+}
+} // namespace quic
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <fizz/server/ResumptionState.h>
+#include <fizz/server/TicketCipher.h>
+#include <folly/Optional.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <folly/io/IOBuf.h>
+#include <quic/server/handshake/AppToken.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace quic {
+
+constexpr size_t kDefaultResumptionCacheSize = 100000;
+constexpr size_t kDefaultResumptionCacheStripes = 16;
+
+/**
+ * Returns a copy of state, with its buffers cloned.
+ */
+fizz::server::ResumptionState cloneResumptionState(
+    const fizz::server::ResumptionState& state);
+
+/**
+ * A cache of resumption state in decrypted and decoded form, so that resuming
+ * a session costs lookups instead of a ticket decryption and an AppToken
+ * decode.
+ *
+ * It is thread safe, so that it can be shared by the workers of a server, and
+ * split in stripes each with its own lock and its share of the capacity.
+ * Entries are keyed by the whole ticket or token, so a lookup never returns
+ * the state of another ticket.
+ */
+class ResumptionCache {
+ public:
+  explicit ResumptionCache(
+      size_t capacity = kDefaultResumptionCacheSize,
+      size_t numStripes = kDefaultResumptionCacheStripes);
+
+  /**
+   * Returns a copy of the state the ticket decrypts to, if it is cached.
+   */
+  folly::Optional<fizz::server::ResumptionState> getResumptionState(
+      const folly::IOBuf& ticket);
+
+  void putResumptionState(
+      const folly::IOBuf& ticket,
+      const fizz::server::ResumptionState& state);
+
+  /**
+   * Returns the decoded form of an encoded AppToken, decoding and caching it
+   * on a miss. Returns nullptr if it doesn't decode.
+   */
+  std::shared_ptr<const AppToken> getAppToken(const folly::IOBuf& encoded);
+
+  size_t numResumptionStates() const;
+
+  size_t numAppTokens() const;
+
+ private:
+  template <typename V>
+  struct Stripe {
+    explicit Stripe(size_t capacity) : entries(capacity) {}
+
+    std::mutex mutex;
+    folly::EvictingCacheMap<std::string, std::shared_ptr<const V>> entries;
+  };
+
+  template <typename V>
+  using Stripes = std::vector<std::unique_ptr<Stripe<V>>>;
+
+  template <typename V>
+  static Stripe<V>& stripeFor(Stripes<V>& stripes, const std::string& key);
+
+  template <typename V>
+  static size_t countEntries(const Stripes<V>& stripes);
+
+  Stripes<fizz::server::ResumptionState> resumptionStates_;
+  Stripes<AppToken> appTokens_;
+};
+
+/**
+ * A TicketCipher that looks tickets up in a ResumptionCache before
+ * decrypting them with another cipher. Tickets are cached as they are issued
+ * and as they are decrypted.
+ *
+ * A cached ticket still resumes after the wrapped cipher stops accepting it,
+ * until it is evicted; fizz checks the ticket age either way.
+ */
+class CachingTicketCipher : public fizz::server::TicketCipher {
+ public:
+  CachingTicketCipher(
+      std::shared_ptr<fizz::server::TicketCipher> cipher,
+      std::shared_ptr<ResumptionCache> cache);
+
+  ~CachingTicketCipher() override = default;
+
+  folly::Future<folly::Optional<
+      std::pair<std::unique_ptr<folly::IOBuf>, std::chrono::seconds>>>
+  encrypt(fizz::server::ResumptionState resState) const override;
+
+  folly::Future<
+      std::pair<fizz::PskType, folly::Optional<fizz::server::ResumptionState>>>
+  decrypt(std::unique_ptr<folly::IOBuf> encryptedTicket) const override;
+
+ private:
+  std::shared_ptr<fizz::server::TicketCipher> cipher_;
+  std::shared_ptr<ResumptionCache> cache_;
+};
+} // namespace quic
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/server/handshake/RetryTokenGenerator.h>
+
+#include <folly/io/Cursor.h>
+#include <folly/lang/Bits.h>
+#include <openssl/crypto.h>
+
+namespace {
+constexpr uint8_t kRetryTokenVersion = 1;
+constexpr size_t kSha256BlockLength = 64;
+// Keeps these tags apart from any other use of the same secret.
+constexpr folly::StringPiece kRetryTokenLabel{"quic retry token"};
+} // namespace
+
+namespace quic {
+
+RetryTokenGenerator::RetryTokenGenerator(
+    const RetryTokenSecret& secret,
+    std::chrono::seconds lifetime)
+    : lifetime_(lifetime) {
+  static_assert(
+      kRetryTokenSecretLength <= kSha256BlockLength,
+      "The key fits in a block and needs no hashing");
+  std::array<uint8_t, kSha256BlockLength> innerPad;
+  std::array<uint8_t, kSha256BlockLength> outerPad;
+  innerPad.fill(0x36);
+  outerPad.fill(0x5c);
+  for (size_t i = 0; i < secret.size(); ++i) {
+    innerPad[i] ^= secret[i];
+    outerPad[i] ^= secret[i];
+  }
+  SHA256_Init(&innerCtx_);
+  SHA256_Update(&innerCtx_, innerPad.data(), innerPad.size());
+  SHA256_Update(&innerCtx_, kRetryTokenLabel.data(), kRetryTokenLabel.size());
+  SHA256_Init(&outerCtx_);
+  SHA256_Update(&outerCtx_, outerPad.data(), outerPad.size());
+}
+
+RetryTokenGenerator::Tag RetryTokenGenerator::computeTag(
+    folly::ByteRange body,
+    const folly::IPAddress& clientIp) const {
+  Tag tag;
+  // The contexts hold no pointers, so copying them is all a new HMAC needs.
+  SHA256_CTX ctx = innerCtx_;
+  SHA256_Update(&ctx, body.data(), body.size());
+  // Map v4 addresses to v6, so that a client doesn't need the same family on
+  // both sides of a dual stack socket.
+  auto v6 = clientIp.isV4() ? clientIp.asV4().createIPv6() : clientIp.asV6();
+  auto addrBytes = v6.toByteArray();
+  SHA256_Update(&ctx, addrBytes.data(), addrBytes.size());
+  SHA256_Final(tag.data(), &ctx);
+  ctx = outerCtx_;
+  SHA256_Update(&ctx, tag.data(), tag.size());
+  SHA256_Final(tag.data(), &ctx);
+  return tag;
+}
+
+RetryToken RetryTokenGenerator::makeToken(
+    const folly::IPAddress& clientIp,
+    const ConnectionId& originalDstConnId,
+    std::chrono::system_clock::time_point now) const {
+  RetryToken token;
+  auto* out = token.data.data();
+  *out++ = kRetryTokenVersion;
+  uint64_t expiry = folly::Endian::big(static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::seconds>(
+          (now + lifetime_).time_since_epoch())
+          .count()));
+  memcpy(out, &expiry, sizeof(expiry));
+  out += sizeof(expiry);
+  *out++ = originalDstConnId.size();
+  memcpy(out, originalDstConnId.data(), originalDstConnId.size());
+  out += originalDstConnId.size();
+  size_t bodyLength = out - token.data.data();
+  auto tag =
+      computeTag(folly::ByteRange(token.data.data(), bodyLength), clientIp);
+  memcpy(out, tag.data(), kRetryTokenTagLength);
+  token.length = bodyLength + kRetryTokenTagLength;
+  return token;
+}
+
+folly::Optional<ConnectionId> RetryTokenGenerator::validateToken(
+    folly::ByteRange token,
+    const folly::IPAddress& clientIp,
+    std::chrono::system_clock::time_point now) const {
+  constexpr size_t kMinLength =
+      1 + sizeof(uint64_t) + 1 + kRetryTokenTagLength;
+  if (token.size() < kMinLength || token.size() > kRetryTokenMaxLength ||
+      token[0] != kRetryTokenVersion) {
+    return folly::none;
+  }
+  size_t connIdLength = token[1 + sizeof(uint64_t)];
+  size_t bodyLength = 1 + sizeof(uint64_t) + 1 + connIdLength;
+  if (connIdLength > kMaxConnectionIdSize ||
+      token.size() != bodyLength + kRetryTokenTagLength) {
+    return folly::none;
+  }
+  auto tag = computeTag(folly::ByteRange(token.data(), bodyLength), clientIp);
+  if (CRYPTO_memcmp(
+          tag.data(), token.data() + bodyLength, kRetryTokenTagLength) != 0) {
+    return folly::none;
+  }
+  uint64_t expiry;
+  memcpy(&expiry, token.data() + 1, sizeof(expiry));
+  auto expiryTime = std::chrono::system_clock::time_point(
+      std::chrono::seconds(folly::Endian::big(expiry)));
+  if (now > expiryTime) {
+    return folly::none;
+  }
+  auto connIdBuf = folly::IOBuf::wrapBufferAsValue(
+      token.data() + 1 + sizeof(uint64_t) + 1, connIdLength);
+  folly::io::Cursor cursor(&connIdBuf);
+  return ConnectionId(cursor, connIdLength);
+}
+} // namespace quic
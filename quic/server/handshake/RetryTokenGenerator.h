@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/IPAddress.h>
+#include <folly/Optional.h>
+#include <folly/Range.h>
+#include <openssl/sha.h>
+#include <quic/codec/QuicConnectionId.h>
+
+#include <array>
+#include <chrono>
+
+namespace quic {
+
+constexpr size_t kRetryTokenSecretLength = 32;
+// Bytes of the HMAC kept in a token.
+constexpr size_t kRetryTokenTagLength = 16;
+// version (1) + expiry in seconds (8) + odcid length (1) + odcid
+constexpr size_t kRetryTokenMaxLength =
+    1 + sizeof(uint64_t) + 1 + kMaxConnectionIdSize + kRetryTokenTagLength;
+// A token from a Retry is only good for the Initial that answers it.
+constexpr std::chrono::seconds kDefaultRetryTokenLifetime{10};
+
+using RetryTokenSecret = std::array<uint8_t, kRetryTokenSecretLength>;
+
+struct RetryToken {
+  std::array<uint8_t, kRetryTokenMaxLength> data;
+  size_t length{0};
+
+  folly::ByteRange range() const {
+    return folly::ByteRange(data.data(), length);
+  }
+};
+
+/**
+ * Makes and checks the address validation tokens sent in Retry packets.
+ *
+ * A token carries the original destination connection id of the client and
+ * an expiry time, authenticated together with the client's IP address with an
+ * HMAC-SHA256 whose key is set up once. Neither path allocates, and the tag is
+ * compared in constant time, so a flood of Initials with forged tokens costs
+ * one hash each.
+ */
+class RetryTokenGenerator {
+ public:
+  explicit RetryTokenGenerator(
+      const RetryTokenSecret& secret,
+      std::chrono::seconds lifetime = kDefaultRetryTokenLifetime);
+
+  RetryToken makeToken(
+      const folly::IPAddress& clientIp,
+      const ConnectionId& originalDstConnId,
+      std::chrono::system_clock::time_point now) const;
+
+  /**
+   * Returns the original destination connection id in the token, or none if
+   * the token is malformed, forged, expired or for another address.
+   */
+  folly::Optional<ConnectionId> validateToken(
+      folly::ByteRange token,
+      const folly::IPAddress& clientIp,
+      std::chrono::system_clock::time_point now) const;
+
+ private:
+  using Tag = std::array<uint8_t, SHA256_DIGEST_LENGTH>;
+
+  Tag computeTag(folly::ByteRange body, const folly::IPAddress& clientIp) const;
+
+  std::chrono::seconds lifetime_;
+  // SHA-256 states after absorbing the key XORed with ipad and with opad.
+  SHA256_CTX innerCtx_;
+  SHA256_CTX outerCtx_;
+};
+} // namespace quic
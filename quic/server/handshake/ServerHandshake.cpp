@@ -42,7 +42,10 @@ void ServerHandshake::initialize(
   auto cryptoFactory = std::make_shared<FizzCryptoFactory>();
   ctx->setFactory(cryptoFactory->getFizzFactory());
   cryptoFactory_ = std::move(cryptoFactory);
-  ctx->setSupportedCiphers({{fizz::CipherSuite::TLS_AES_128_GCM_SHA256}});
+  // A single tier, so that the client's order decides: it knows which it can
+  // do faster, e.g. ChaCha20-Poly1305 without AES hardware.
+  ctx->setSupportedCiphers({{fizz::CipherSuite::TLS_AES_128_GCM_SHA256,
+                             fizz::CipherSuite::TLS_CHACHA20_POLY1305_SHA256}});
   ctx->setVersionFallbackEnabled(false);
   // Since Draft-17, client won't sent EOED
   ctx->setOmitEarlyRecordLayer(true);
@@ -59,8 +62,12 @@ void ServerHandshake::initialize(
 void ServerHandshake::doHandshake(
     std::unique_ptr<folly::IOBuf> data,
     EncryptionLevel encryptionLevel) {
+  auto start = Clock::now();
   SCOPE_EXIT {
     inHandshakeStack_ = false;
+    conn_->handshakeTimings.handshakeProcessingTime +=
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - start);
   };
   inHandshakeStack_ = true;
   waitForData_ = false;
@@ -206,6 +213,29 @@ const folly::Optional<std::string>& ServerHandshake::getApplicationProtocol()
   return state_.alpn();
 }
 
+folly::Optional<std::string> ServerHandshake::getCipherSuite() const {
+  if (!state_.cipher()) {
+    return folly::none;
+  }
+  return fizz::toString(*state_.cipher());
+}
+
+std::unique_ptr<Aead> ServerHandshake::getNextOneRttReadCipher() {
+  if (oneRttReadSecret_.empty() || !state_.cipher()) {
+    return nullptr;
+  }
+  return cryptoFactory_->makeNextOneRttAead(
+      *state_.cipher(), oneRttReadSecret_);
+}
+
+std::unique_ptr<Aead> ServerHandshake::getNextOneRttWriteCipher() {
+  if (oneRttWriteSecret_.empty() || !state_.cipher()) {
+    return nullptr;
+  }
+  return cryptoFactory_->makeNextOneRttAead(
+      *state_.cipher(), oneRttWriteSecret_);
+}
+
 void ServerHandshake::onError(
     std::pair<std::string, TransportErrorCode> error) {
   VLOG(10) << "ServerHandshake error " << error.first;
@@ -321,6 +351,7 @@ void ServerHandshake::processPendingEvents() {
     folly::Optional<fizz::server::ServerStateMachine::ProcessingActions>
         actions;
     actionGuard_ = folly::DelayedDestruction::DestructorGuard(conn_);
+    auto start = Clock::now();
     if (!waitForData_) {
       switch (state_.readRecordLayer()->getEncryptionLevel()) {
         case fizz::EncryptionLevel::Plaintext:
@@ -346,6 +377,9 @@ void ServerHandshake::processPendingEvents() {
       actionGuard_ = folly::DelayedDestruction::DestructorGuard(nullptr);
       return;
     }
+    conn_->handshakeTimings.tlsProcessingTime +=
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - start);
     startActions(std::move(*actions));
   }
 }
@@ -436,7 +470,7 @@ void ServerHandshake::ActionMoveVisitor::operator()(
       kQuicKeyLabel,
       kQuicIVLabel);
   auto headerCipher = server_.cryptoFactory_->makePacketNumberCipher(
-      folly::range(secretAvailable.secret.secret));
+      *server_.state_.cipher(), folly::range(secretAvailable.secret.secret));
   switch (secretAvailable.secret.type.type()) {
     case fizz::SecretType::Type::EarlySecrets_E:
       switch (*secretAvailable.secret.type.asEarlySecrets()) {
@@ -465,10 +499,16 @@ void ServerHandshake::ActionMoveVisitor::operator()(
         case fizz::AppTrafficSecrets::ClientAppTraffic:
           server_.oneRttReadCipher_ = FizzAead::wrap(std::move(aead));
           server_.oneRttReadHeaderCipher_ = std::move(headerCipher);
+          server_.oneRttReadSecret_ = secretAvailable.secret.secret;
           break;
         case fizz::AppTrafficSecrets::ServerAppTraffic:
-          server_.oneRttWriteCipher_ = FizzAead::wrap(std::move(aead));
+          // Cloneable, so batches can be encrypted on several threads.
+          server_.oneRttWriteCipher_ = FizzAead::wrap(
+              std::move(aead),
+              server_.state_.context()->getFactory(),
+              *server_.state_.cipher());
           server_.oneRttWriteHeaderCipher_ = std::move(headerCipher);
+          server_.oneRttWriteSecret_ = secretAvailable.secret.secret;
           break;
       }
       break;
@@ -18,7 +18,7 @@
 
 #include <quic/QuicConstants.h>
 #include <quic/QuicException.h>
-#include <quic/handshake/CryptoFactory.h>
+#include <quic/fizz/handshake/FizzCryptoFactory.h>
 #include <quic/handshake/HandshakeLayer.h>
 #include <quic/server/handshake/AppToken.h>
 #include <quic/server/handshake/ServerTransportParametersExtension.h>
@@ -198,6 +198,12 @@ class ServerHandshake : public Handshake {
    */
   const folly::Optional<std::string>& getApplicationProtocol() const override;
 
+  folly::Optional<std::string> getCipherSuite() const override;
+
+  std::unique_ptr<Aead> getNextOneRttReadCipher() override;
+
+  std::unique_ptr<Aead> getNextOneRttWriteCipher() override;
+
   class ActionMoveVisitor : public boost::static_visitor<> {
    public:
     explicit ActionMoveVisitor(ServerHandshake& server);
@@ -272,6 +278,9 @@ class ServerHandshake : public Handshake {
   std::unique_ptr<Aead> handshakeWriteCipher_;
   std::unique_ptr<Aead> oneRttReadCipher_;
   std::unique_ptr<Aead> oneRttWriteCipher_;
+  // The 1-RTT secrets of the latest key phase derived, for key updates.
+  std::vector<uint8_t> oneRttReadSecret_;
+  std::vector<uint8_t> oneRttWriteSecret_;
   std::unique_ptr<Aead> zeroRttReadCipher_;
 
   std::unique_ptr<PacketNumberCipher> oneRttReadHeaderCipher_;
@@ -286,7 +295,7 @@ class ServerHandshake : public Handshake {
 
   Phase phase_{Phase::Handshake};
 
-  std::shared_ptr<CryptoFactory> cryptoFactory_;
+  std::shared_ptr<FizzCryptoFactory> cryptoFactory_;
   std::shared_ptr<ServerTransportParametersExtension> transportParams_;
 }; // namespace quic
 } // namespace quic
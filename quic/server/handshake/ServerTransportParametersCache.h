@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/QuicConstants.h>
+#include <quic/common/BufUtil.h>
+
+#include <folly/Optional.h>
+
+#include <deque>
+#include <tuple>
+
+namespace quic {
+
+constexpr size_t kMaxCachedServerTransportParameters = 4;
+
+/**
+ * Encodings of the server transport parameters that are the same for all the
+ * connections with the same settings, that is all of them but the stateless
+ * reset token. A server worker keeps one so that its handshakes only have to
+ * encode the token. The settings of a connection can be overridden per
+ * client, so it holds the encodings of the last few sets of settings.
+ *
+ * Not thread safe, it's meant to be used from the worker's EventBase.
+ */
+class ServerTransportParametersCache {
+ public:
+  struct Key {
+    QuicVersion encodingVersion;
+    uint64_t initialMaxData;
+    uint64_t initialMaxStreamDataBidiLocal;
+    uint64_t initialMaxStreamDataBidiRemote;
+    uint64_t initialMaxStreamDataUni;
+    uint64_t initialMaxStreamsBidi;
+    uint64_t initialMaxStreamsUni;
+    std::chrono::milliseconds idleTimeout;
+    uint64_t ackDelayExponent;
+    uint64_t maxRecvPacketSize;
+    TransportPartialReliabilitySetting partialReliability;
+    folly::Optional<std::chrono::microseconds> minAckDelay;
+    uint64_t maxDatagramFrameSize;
+    bool fecSupport;
+
+    bool operator==(const Key& other) const {
+      return tie() == other.tie();
+    }
+
+   private:
+    auto tie() const {
+      return std::tie(
+          encodingVersion,
+          initialMaxData,
+          initialMaxStreamDataBidiLocal,
+          initialMaxStreamDataBidiRemote,
+          initialMaxStreamDataUni,
+          initialMaxStreamsBidi,
+          initialMaxStreamsUni,
+          idleTimeout,
+          ackDelayExponent,
+          maxRecvPacketSize,
+          partialReliability,
+          minAckDelay,
+          maxDatagramFrameSize,
+          fecSupport);
+    }
+  };
+
+  /**
+   * Returns the encoding for key, calling encode() to make it if there is
+   * none yet.
+   */
+  template <typename EncodeFn>
+  const folly::IOBuf& getOrEncode(const Key& key, EncodeFn&& encode) {
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->first == key) {
+        if (it != entries_.begin()) {
+          auto entry = std::move(*it);
+          entries_.erase(it);
+          entries_.push_front(std::move(entry));
+        }
+        return *entries_.front().second;
+      }
+    }
+    if (entries_.size() >= kMaxCachedServerTransportParameters) {
+      entries_.pop_back();
+    }
+    entries_.emplace_front(key, encode());
+    return *entries_.front().second;
+  }
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+ private:
+  // Most recently used first.
+  std::deque<std::pair<Key, Buf>> entries_;
+};
+
+} // namespace quic
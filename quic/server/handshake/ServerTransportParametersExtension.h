@@ -10,6 +10,7 @@
 
 #include <fizz/server/ServerExtensions.h>
 #include <quic/fizz/handshake/FizzTransportParameters.h>
+#include <quic/server/handshake/ServerTransportParametersCache.h>
 #include <quic/server/handshake/StatelessResetGenerator.h>
 
 namespace quic {
@@ -28,7 +29,11 @@ class ServerTransportParametersExtension : public fizz::ServerExtensions {
       uint64_t ackDelayExponent,
       uint64_t maxRecvPacketSize,
       TransportPartialReliabilitySetting partialReliability,
-      const StatelessResetToken& token)
+      const StatelessResetToken& token,
+      folly::Optional<std::chrono::microseconds> minAckDelay = folly::none,
+      uint64_t maxDatagramFrameSize = 0,
+      bool fecSupport = false,
+      ServerTransportParametersCache* cache = nullptr)
       : encodingVersion_(encodingVersion),
         initialMaxData_(initialMaxData),
         initialMaxStreamDataBidiLocal_(initialMaxStreamDataBidiLocal),
@@ -40,7 +45,11 @@ class ServerTransportParametersExtension : public fizz::ServerExtensions {
         ackDelayExponent_(ackDelayExponent),
         maxRecvPacketSize_(maxRecvPacketSize),
         partialReliability_(partialReliability),
-        token_(token) {}
+        token_(token),
+        minAckDelay_(minAckDelay),
+        maxDatagramFrameSize_(maxDatagramFrameSize),
+        fecSupport_(fecSupport),
+        cache_(cache) {}
 
   ~ServerTransportParametersExtension() override = default;
 
@@ -57,52 +66,136 @@ class ServerTransportParametersExtension : public fizz::ServerExtensions {
     clientTransportParameters_ = std::move(clientParams);
 
     std::vector<fizz::Extension> exts;
+    if (!cache_) {
+      ServerTransportParameters params;
+      params.parameters = encodeSharedParameters();
+      params.parameters.push_back(encodeStatelessResetToken(token_));
+      exts.push_back(encodeExtension(params, encodingVersion_));
+      return exts;
+    }
+
+    const auto& shared = cache_->getOrEncode(getCacheKey(), [this]() {
+      auto buf = folly::IOBuf::create(0);
+      encodeParameters(encodeSharedParameters(), *buf);
+      return buf;
+    });
+    std::vector<TransportParameter> tokenParameter;
+    tokenParameter.push_back(encodeStatelessResetToken(token_));
+    auto token = folly::IOBuf::create(0);
+    encodeParameters(tokenParameter, *token);
+    fizz::Extension ext;
+    ext.extension_type = fizz::ExtensionType::quic_transport_parameters;
+    if (encodingVersion_ == QuicVersion::MVFST_D24) {
+      // The parameters are a vector with a 16 bit length in front.
+      ext.extension_data = folly::IOBuf::create(sizeof(uint16_t));
+      folly::io::Appender appender(ext.extension_data.get(), 0);
+      appender.writeBE<uint16_t>(folly::to<uint16_t>(
+          shared.computeChainDataLength() + token->computeChainDataLength()));
+      ext.extension_data->prependChain(shared.clone());
+    } else {
+      ext.extension_data = shared.clone();
+    }
+    ext.extension_data->prependChain(std::move(token));
+    exts.push_back(std::move(ext));
+    return exts;
+  }
 
-    ServerTransportParameters params;
-    params.parameters.push_back(encodeIntegerParameter(
+  folly::Optional<ClientTransportParameters> getClientTransportParams() {
+    return std::move(clientTransportParameters_);
+  }
+
+ private:
+  /**
+   * All the parameters but the stateless reset token, which are the same for
+   * all the connections with the same settings.
+   */
+  std::vector<TransportParameter> encodeSharedParameters() const {
+    std::vector<TransportParameter> parameters;
+    parameters.push_back(encodeIntegerParameter(
         TransportParameterId::initial_max_stream_data_bidi_local,
         initialMaxStreamDataBidiLocal_));
-    params.parameters.push_back(encodeIntegerParameter(
+    parameters.push_back(encodeIntegerParameter(
         TransportParameterId::initial_max_stream_data_bidi_remote,
         initialMaxStreamDataBidiRemote_));
-    params.parameters.push_back(encodeIntegerParameter(
+    parameters.push_back(encodeIntegerParameter(
         TransportParameterId::initial_max_stream_data_uni,
         initialMaxStreamDataUni_));
-    params.parameters.push_back(encodeIntegerParameter(
+    parameters.push_back(encodeIntegerParameter(
         TransportParameterId::initial_max_data, initialMaxData_));
-    params.parameters.push_back(encodeIntegerParameter(
+    parameters.push_back(encodeIntegerParameter(
         TransportParameterId::initial_max_streams_bidi,
         initialMaxStreamsBidi_));
-    params.parameters.push_back(encodeIntegerParameter(
+    parameters.push_back(encodeIntegerParameter(
         TransportParameterId::initial_max_streams_uni, initialMaxStreamsUni_));
-    params.parameters.push_back(encodeIntegerParameter(
+    parameters.push_back(encodeIntegerParameter(
         TransportParameterId::idle_timeout, idleTimeout_.count()));
-    params.parameters.push_back(encodeIntegerParameter(
+    parameters.push_back(encodeIntegerParameter(
         TransportParameterId::ack_delay_exponent, ackDelayExponent_));
-    params.parameters.push_back(encodeIntegerParameter(
+    parameters.push_back(encodeIntegerParameter(
         TransportParameterId::max_packet_size, maxRecvPacketSize_));
-    TransportParameter statelessReset;
-    statelessReset.parameter = TransportParameterId::stateless_reset_token;
-    statelessReset.value = folly::IOBuf::copyBuffer(token_);
-    params.parameters.push_back(std::move(statelessReset));
 
     uint64_t partialReliabilitySetting = 0;
     if (partialReliability_) {
       partialReliabilitySetting = 1;
     }
-    params.parameters.push_back(encodeIntegerParameter(
+    parameters.push_back(encodeIntegerParameter(
         static_cast<TransportParameterId>(kPartialReliabilityParameterId),
         partialReliabilitySetting));
 
-    exts.push_back(encodeExtension(params, encodingVersion_));
-    return exts;
+    if (minAckDelay_) {
+      parameters.push_back(encodeIntegerParameter(
+          static_cast<TransportParameterId>(kMinAckDelayParameterId),
+          minAckDelay_->count()));
+    }
+
+    if (maxDatagramFrameSize_ > 0) {
+      parameters.push_back(encodeIntegerParameter(
+          TransportParameterId::max_datagram_frame_size,
+          maxDatagramFrameSize_));
+    }
+
+    if (fecSupport_) {
+      parameters.push_back(encodeIntegerParameter(
+          static_cast<TransportParameterId>(kFecSupportParameterId), 1));
+    }
+    return parameters;
   }
 
-  folly::Optional<ClientTransportParameters> getClientTransportParams() {
-    return std::move(clientTransportParameters_);
+  /**
+   * Appends the parameters to buf the way encodeExtension() does, without the
+   * length of the vector for MVFST_D24.
+   */
+  void encodeParameters(
+      const std::vector<TransportParameter>& parameters,
+      folly::IOBuf& buf) const {
+    if (encodingVersion_ == QuicVersion::MVFST_D24) {
+      folly::io::Appender appender(&buf, 40);
+      for (const auto& param : parameters) {
+        fizz::detail::write(param, appender);
+      }
+    } else {
+      BufAppender appender(&buf, 40);
+      encodeVarintParams(parameters, appender);
+    }
+  }
+
+  ServerTransportParametersCache::Key getCacheKey() const {
+    return {encodingVersion_,
+            initialMaxData_,
+            initialMaxStreamDataBidiLocal_,
+            initialMaxStreamDataBidiRemote_,
+            initialMaxStreamDataUni_,
+            initialMaxStreamsBidi_,
+            initialMaxStreamsUni_,
+            idleTimeout_,
+            ackDelayExponent_,
+            maxRecvPacketSize_,
+            partialReliability_,
+            minAckDelay_,
+            maxDatagramFrameSize_,
+            fecSupport_};
   }
 
- private:
   QuicVersion encodingVersion_;
   uint64_t initialMaxData_;
   uint64_t initialMaxStreamDataBidiLocal_;
@@ -116,5 +209,9 @@ class ServerTransportParametersExtension : public fizz::ServerExtensions {
   TransportPartialReliabilitySetting partialReliability_;
   folly::Optional<ClientTransportParameters> clientTransportParameters_;
   StatelessResetToken token_;
+  folly::Optional<std::chrono::microseconds> minAckDelay_;
+  uint64_t maxDatagramFrameSize_;
+  bool fecSupport_;
+  ServerTransportParametersCache* cache_;
 };
 } // namespace quic
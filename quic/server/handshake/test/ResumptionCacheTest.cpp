@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/server/handshake/ResumptionCache.h>
+
+#include <folly/portability/GTest.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+namespace {
+fizz::server::ResumptionState makeResumptionState(const std::string& alpn) {
+  fizz::server::ResumptionState state;
+  state.version = fizz::ProtocolVersion::tls_1_3;
+  state.cipher = fizz::CipherSuite::TLS_AES_128_GCM_SHA256;
+  state.resumptionSecret = folly::IOBuf::copyBuffer("secret");
+  state.alpn = alpn;
+  state.ticketAgeAdd = 1;
+  state.appToken = folly::IOBuf::copyBuffer("appToken");
+  return state;
+}
+
+Buf encodeTestAppToken() {
+  AppToken appToken;
+  appToken.transportParams = createTicketTransportParameters(
+      kDefaultIdleTimeout.count(),
+      kDefaultUDPReadBufferSize,
+      kDefaultConnectionWindowSize,
+      kDefaultStreamWindowSize,
+      kDefaultStreamWindowSize,
+      kDefaultStreamWindowSize,
+      kDefaultMaxStreamsBidirectional,
+      kDefaultMaxStreamsUnidirectional);
+  appToken.sourceAddresses = {folly::IPAddress("1.2.3.4")};
+  appToken.version = QuicVersion::MVFST;
+  return encodeAppToken(appToken);
+}
+
+// Encrypts a state to its alpn and counts the decryptions.
+class CountingTicketCipher : public fizz::server::TicketCipher {
+ public:
+  folly::Future<folly::Optional<
+      std::pair<std::unique_ptr<folly::IOBuf>, std::chrono::seconds>>>
+  encrypt(fizz::server::ResumptionState state) const override {
+    return std::make_pair(
+        folly::IOBuf::copyBuffer(*state.alpn), std::chrono::seconds(100));
+  }
+
+  folly::Future<
+      std::pair<fizz::PskType, folly::Optional<fizz::server::ResumptionState>>>
+  decrypt(std::unique_ptr<folly::IOBuf> ticket) const override {
+    ++decrypts;
+    auto alpn = ticket->moveToFbString().toStdString();
+    if (alpn == "bad") {
+      return std::make_pair(fizz::PskType::Rejected, folly::none);
+    }
+    return std::make_pair(
+        fizz::PskType::Resumption, makeResumptionState(alpn));
+  }
+
+  mutable size_t decrypts{0};
+};
+} // namespace
+
+TEST(ResumptionCacheTest, PutAndGet) {
+  ResumptionCache cache;
+  auto ticket = folly::IOBuf::copyBuffer("ticket");
+  EXPECT_FALSE(cache.getResumptionState(*ticket));
+  cache.putResumptionState(*ticket, makeResumptionState("h3"));
+  auto state = cache.getResumptionState(*ticket);
+  ASSERT_TRUE(state.has_value());
+  EXPECT_EQ(state->alpn, std::string("h3"));
+  EXPECT_EQ(state->ticketAgeAdd, 1);
+  EXPECT_TRUE(folly::IOBufEqualTo()(
+      *state->resumptionSecret, *folly::IOBuf::copyBuffer("secret")));
+  EXPECT_TRUE(folly::IOBufEqualTo()(
+      *state->appToken, *folly::IOBuf::copyBuffer("appToken")));
+  EXPECT_FALSE(
+      cache.getResumptionState(*folly::IOBuf::copyBuffer("otherTicket")));
+}
+
+TEST(ResumptionCacheTest, ChainedTicket) {
+  ResumptionCache cache;
+  auto ticket = folly::IOBuf::copyBuffer("tic");
+  ticket->prependChain(folly::IOBuf::copyBuffer("ket"));
+  cache.putResumptionState(*ticket, makeResumptionState("h3"));
+  EXPECT_TRUE(cache.getResumptionState(*folly::IOBuf::copyBuffer("ticket")));
+}
+
+TEST(ResumptionCacheTest, Bounded) {
+  ResumptionCache cache(4 /* capacity */, 2 /* numStripes */);
+  for (int i = 0; i < 100; ++i) {
+    cache.putResumptionState(
+        *folly::IOBuf::copyBuffer(folly::to<std::string>("ticket", i)),
+        makeResumptionState("h3"));
+  }
+  EXPECT_LE(cache.numResumptionStates(), 4);
+  EXPECT_GT(cache.numResumptionStates(), 0);
+}
+
+TEST(ResumptionCacheTest, AppTokenDecodedOnce) {
+  ResumptionCache cache;
+  auto encoded = encodeTestAppToken();
+  auto appToken = cache.getAppToken(*encoded);
+  ASSERT_NE(appToken, nullptr);
+  EXPECT_EQ(appToken->version, QuicVersion::MVFST);
+  ASSERT_EQ(appToken->sourceAddresses.size(), 1);
+  EXPECT_EQ(appToken->sourceAddresses[0], folly::IPAddress("1.2.3.4"));
+  EXPECT_EQ(cache.getAppToken(*encoded), appToken);
+  EXPECT_EQ(cache.numAppTokens(), 1);
+}
+
+TEST(ResumptionCacheTest, AppTokenNotDecoded) {
+  ResumptionCache cache;
+  EXPECT_EQ(cache.getAppToken(*folly::IOBuf::copyBuffer("garbage")), nullptr);
+  EXPECT_EQ(cache.numAppTokens(), 0);
+}
+
+TEST(ResumptionCacheTest, CachingTicketCipherDecrypt) {
+  auto cipher = std::make_shared<CountingTicketCipher>();
+  auto cache = std::make_shared<ResumptionCache>();
+  CachingTicketCipher cachingCipher(cipher, cache);
+
+  for (int i = 0; i < 3; ++i) {
+    auto result = cachingCipher.decrypt(folly::IOBuf::copyBuffer("h3")).get();
+    EXPECT_EQ(result.first, fizz::PskType::Resumption);
+    ASSERT_TRUE(result.second.has_value());
+    EXPECT_EQ(result.second->alpn, std::string("h3"));
+  }
+  EXPECT_EQ(cipher->decrypts, 1);
+
+  // Rejected tickets are not cached.
+  for (int i = 0; i < 2; ++i) {
+    auto result = cachingCipher.decrypt(folly::IOBuf::copyBuffer("bad")).get();
+    EXPECT_EQ(result.first, fizz::PskType::Rejected);
+  }
+  EXPECT_EQ(cipher->decrypts, 3);
+}
+
+TEST(ResumptionCacheTest, CachingTicketCipherEncrypt) {
+  auto cipher = std::make_shared<CountingTicketCipher>();
+  auto cache = std::make_shared<ResumptionCache>();
+  CachingTicketCipher cachingCipher(cipher, cache);
+
+  auto ticket = cachingCipher.encrypt(makeResumptionState("hq")).get();
+  ASSERT_TRUE(ticket.has_value());
+  // The issued ticket resumes without a decryption.
+  auto result = cachingCipher.decrypt(std::move(ticket->first)).get();
+  EXPECT_EQ(result.first, fizz::PskType::Resumption);
+  EXPECT_EQ(result.second->alpn, std::string("hq"));
+  EXPECT_EQ(cipher->decrypts, 0);
+}
+
+} // namespace test
+} // namespace quic
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/server/handshake/RetryTokenGenerator.h>
+#include <folly/Random.h>
+#include <folly/portability/GTest.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+class RetryTokenGeneratorTest : public Test {
+ public:
+  void SetUp() override {
+    folly::Random::secureRandom(secret_.data(), secret_.size());
+  }
+
+ protected:
+  RetryTokenSecret secret_;
+  folly::IPAddress clientIp_{"1.2.3.4"};
+  ConnectionId odcid_{{0x14, 0x35, 0x22, 0x11, 0x01, 0x02, 0x03, 0x04}};
+  std::chrono::system_clock::time_point now_{std::chrono::system_clock::now()};
+};
+
+TEST_F(RetryTokenGeneratorTest, ValidToken) {
+  RetryTokenGenerator generator(secret_);
+  auto token = generator.makeToken(clientIp_, odcid_, now_);
+  auto connId = generator.validateToken(token.range(), clientIp_, now_);
+  ASSERT_TRUE(connId.has_value());
+  EXPECT_EQ(*connId, odcid_);
+}
+
+TEST_F(RetryTokenGeneratorTest, SameSecretOtherGenerator) {
+  RetryTokenGenerator generator1(secret_), generator2(secret_);
+  auto token = generator1.makeToken(clientIp_, odcid_, now_);
+  EXPECT_TRUE(generator2.validateToken(token.range(), clientIp_, now_));
+}
+
+TEST_F(RetryTokenGeneratorTest, EmptyConnectionId) {
+  RetryTokenGenerator generator(secret_);
+  ConnectionId emptyConnId{std::vector<uint8_t>()};
+  auto token = generator.makeToken(clientIp_, emptyConnId, now_);
+  auto connId = generator.validateToken(token.range(), clientIp_, now_);
+  ASSERT_TRUE(connId.has_value());
+  EXPECT_EQ(connId->size(), 0);
+}
+
+TEST_F(RetryTokenGeneratorTest, MappedAddress) {
+  RetryTokenGenerator generator(secret_);
+  auto token = generator.makeToken(clientIp_, odcid_, now_);
+  folly::IPAddress mapped("::ffff:1.2.3.4");
+  EXPECT_TRUE(generator.validateToken(token.range(), mapped, now_));
+}
+
+TEST_F(RetryTokenGeneratorTest, DifferentAddress) {
+  RetryTokenGenerator generator(secret_);
+  auto token = generator.makeToken(clientIp_, odcid_, now_);
+  EXPECT_FALSE(generator.validateToken(
+      token.range(), folly::IPAddress("1.2.3.5"), now_));
+}
+
+TEST_F(RetryTokenGeneratorTest, DifferentSecret) {
+  RetryTokenSecret otherSecret;
+  folly::Random::secureRandom(otherSecret.data(), otherSecret.size());
+  RetryTokenGenerator generator1(secret_), generator2(otherSecret);
+  auto token = generator1.makeToken(clientIp_, odcid_, now_);
+  EXPECT_FALSE(generator2.validateToken(token.range(), clientIp_, now_));
+}
+
+TEST_F(RetryTokenGeneratorTest, Expired) {
+  RetryTokenGenerator generator(secret_, std::chrono::seconds(10));
+  auto token = generator.makeToken(clientIp_, odcid_, now_);
+  EXPECT_TRUE(generator.validateToken(
+      token.range(), clientIp_, now_ + std::chrono::seconds(9)));
+  EXPECT_FALSE(generator.validateToken(
+      token.range(), clientIp_, now_ + std::chrono::seconds(11)));
+}
+
+TEST_F(RetryTokenGeneratorTest, Tampered) {
+  RetryTokenGenerator generator(secret_);
+  auto token = generator.makeToken(clientIp_, odcid_, now_);
+  for (size_t i = 0; i < token.length; ++i) {
+    auto tampered = token;
+    tampered.data[i] ^= 0x01;
+    EXPECT_FALSE(generator.validateToken(tampered.range(), clientIp_, now_))
+        << "byte " << i;
+  }
+}
+
+TEST_F(RetryTokenGeneratorTest, Truncated) {
+  RetryTokenGenerator generator(secret_);
+  auto token = generator.makeToken(clientIp_, odcid_, now_);
+  for (size_t length = 0; length < token.length; ++length) {
+    EXPECT_FALSE(generator.validateToken(
+        folly::ByteRange(token.data.data(), length), clientIp_, now_));
+  }
+}
+
+} // namespace test
+} // namespace quic
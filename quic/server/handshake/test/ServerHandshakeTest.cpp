@@ -18,6 +18,7 @@
 #include <fizz/protocol/test/Mocks.h>
 #include <fizz/server/test/Mocks.h>
 
+#include <folly/executors/ManualExecutor.h>
 #include <folly/io/async/SSLContext.h>
 #include <folly/io/async/ScopedEventBaseThread.h>
 #include <folly/io/async/test/MockAsyncTransport.h>
@@ -30,6 +31,7 @@
 #include <quic/fizz/handshake/QuicFizzFactory.h>
 #include <quic/handshake/HandshakeLayer.h>
 #include <quic/server/handshake/AppToken.h>
+#include <quic/server/handshake/OffloadedSelfCert.h>
 #include <quic/server/handshake/ServerHandshake.h>
 #include <quic/state/StateData.h>
 
@@ -504,6 +506,36 @@ TEST_F(ServerHandshakeWriteNSTTest, TestWriteNST) {
   EXPECT_TRUE(cache_->getPsk(kTestHostname.str()));
 }
 
+class ServerHandshakeOffloadedCertTest : public ServerHandshakeTest {
+ public:
+  void setupClientAndServerContext() override {
+    signExecutor_ = std::make_shared<folly::ManualExecutor>();
+    auto certManager = std::make_unique<fizz::server::CertManager>();
+    certManager->addCert(
+        std::make_shared<OffloadedSelfCert>(readCert(), signExecutor_), true);
+    serverCtx->setCertManager(std::move(certManager));
+  }
+
+ protected:
+  std::shared_ptr<folly::ManualExecutor> signExecutor_;
+};
+
+TEST_F(ServerHandshakeOffloadedCertTest, TestHandshakeSuccess) {
+  clientServerRound();
+  // The server flight waits on the signature from the executor.
+  EXPECT_GT(signExecutor_->drain(), 0);
+  evb.loop();
+  EXPECT_EQ(handshake->getPhase(), ServerHandshake::Phase::Handshake);
+  serverClientRound();
+  clientServerRound();
+  EXPECT_EQ(handshake->getPhase(), ServerHandshake::Phase::Established);
+  if (ex) {
+    std::rethrow_exception(ex);
+  }
+  expectOneRttCipher(true);
+  EXPECT_TRUE(handshakeSuccess);
+}
+
 class ServerHandshakePskTest : public ServerHandshakeTest {
  public:
   ~ServerHandshakePskTest() override = default;
@@ -21,14 +21,14 @@ using namespace fizz::test;
 namespace quic {
 namespace test {
 
-static ClientHello getClientHello() {
+static ClientHello getClientHello(QuicVersion version = QuicVersion::MVFST) {
   auto chlo = TestMessages::clientHello();
 
   ClientTransportParameters clientParams;
   clientParams.parameters.emplace_back(
       CustomIntegralTransportParameter(0xffff, 0xffff).encode());
 
-  chlo.extensions.push_back(encodeExtension(clientParams, QuicVersion::MVFST));
+  chlo.extensions.push_back(encodeExtension(clientParams, version));
 
   return chlo;
 }
@@ -70,5 +70,47 @@ TEST(ServerTransportParametersTest, TestGetExtensionsMissingClientParams) {
       generateStatelessResetToken());
   EXPECT_THROW(ext.getExtensions(TestMessages::clientHello()), FizzException);
 }
+TEST(ServerTransportParametersTest, TestGetExtensionsCached) {
+  for (auto version : {QuicVersion::MVFST, QuicVersion::MVFST_D24}) {
+    ServerTransportParametersCache cache;
+    auto makeExtension = [&](const StatelessResetToken& token,
+                             ServerTransportParametersCache* extCache) {
+      return std::make_unique<ServerTransportParametersExtension>(
+          version,
+          kDefaultConnectionWindowSize,
+          kDefaultStreamWindowSize,
+          kDefaultStreamWindowSize,
+          kDefaultStreamWindowSize,
+          std::numeric_limits<uint32_t>::max(),
+          std::numeric_limits<uint32_t>::max(),
+          kDefaultIdleTimeout,
+          kDefaultAckDelayExponent,
+          kDefaultUDPSendPacketLen,
+          kDefaultPartialReliability,
+          token,
+          folly::none,
+          0,
+          false,
+          extCache);
+    };
+    for (int i = 0; i < 2; i++) {
+      auto token = generateStatelessResetToken();
+      auto cached =
+          makeExtension(token, &cache)->getExtensions(getClientHello(version));
+      auto uncached =
+          makeExtension(token, nullptr)->getExtensions(getClientHello(version));
+      ASSERT_EQ(1, cached.size());
+      ASSERT_EQ(1, uncached.size());
+      EXPECT_TRUE(folly::IOBufEqualTo()(
+          cached[0].extension_data, uncached[0].extension_data));
+      auto serverParams = getServerExtension(cached, version);
+      ASSERT_TRUE(serverParams.has_value());
+      EXPECT_EQ(
+          token, *getStatelessResetTokenParameter(serverParams->parameters));
+    }
+    // The other parameters were only encoded the first time.
+    EXPECT_EQ(1, cache.size());
+  }
+}
 } // namespace test
 } // namespace quic
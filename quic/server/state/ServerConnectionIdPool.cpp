@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/server/state/ServerConnectionIdPool.h>
+
+namespace quic {
+
+ServerConnectionIdPool::ServerConnectionIdPool(
+    folly::EventBase* evb,
+    size_t capacity,
+    ConnectionIdAlgo& connIdAlgo,
+    ServerConnectionIdParams params,
+    const StatelessResetSecret& secret,
+    const folly::SocketAddress& serverAddr,
+    const ServerConnectionIdRejector* rejector)
+    : evb_(evb),
+      capacity_(capacity),
+      connIdAlgo_(connIdAlgo),
+      params_(std::move(params)),
+      secret_(secret),
+      serverAddr_(serverAddr),
+      rejector_(rejector),
+      resetGenerator_(secret, serverAddr.getFullyQualified()) {
+  if (evb_ && capacity_ > 0) {
+    evb_->runInLoop(this);
+  }
+}
+
+ServerConnectionIdPool::~ServerConnectionIdPool() {
+  cancelLoopCallback();
+}
+
+bool ServerConnectionIdPool::matches(
+    const ConnectionIdAlgo* connIdAlgo,
+    const ServerConnectionIdParams& params,
+    const StatelessResetSecret& secret,
+    const folly::SocketAddress& serverAddr) const {
+  return connIdAlgo == &connIdAlgo_ && params == params_ &&
+      secret == secret_ && serverAddr == serverAddr_;
+}
+
+folly::Optional<ServerConnectionIdPool::Entry> ServerConnectionIdPool::take() {
+  folly::Optional<Entry> entry;
+  while (!entries_.empty() && !entry) {
+    // Connections since the id was generated may have taken it.
+    if (!rejector_ || !rejector_->rejectConnectionId(entries_.front().connId)) {
+      entry = std::move(entries_.front());
+    }
+    entries_.pop_front();
+  }
+  if (evb_ && entries_.size() < capacity_ / 2 && !isLoopCallbackScheduled()) {
+    evb_->runInLoop(this);
+  }
+  return entry;
+}
+
+void ServerConnectionIdPool::fill() {
+  // Bounds the work when the rejector turns down most of the ids.
+  size_t attempts = 2 * capacity_;
+  while (entries_.size() < capacity_ && attempts-- > 0) {
+    auto encodedCid = connIdAlgo_.encodeConnectionId(params_);
+    if (encodedCid.hasError()) {
+      return;
+    }
+    if (rejector_ && rejector_->rejectConnectionId(*encodedCid)) {
+      continue;
+    }
+    auto token = resetGenerator_.generateToken(*encodedCid);
+    entries_.push_back(Entry{std::move(*encodedCid), std::move(token)});
+  }
+}
+
+void ServerConnectionIdPool::runLoopCallback() noexcept {
+  fill();
+}
+} // namespace quic
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Optional.h>
+#include <folly/SocketAddress.h>
+#include <folly/io/async/EventBase.h>
+#include <quic/codec/ConnectionIdAlgo.h>
+#include <quic/server/handshake/StatelessResetGenerator.h>
+#include <quic/server/state/ServerConnectionIdRejector.h>
+
+#include <deque>
+
+namespace quic {
+
+/**
+ * Server chosen connection ids of a worker, encoded along with their
+ * stateless reset tokens ahead of time, so that a connection issuing one
+ * during its handshake or for migration doesn't pay for the encoding nor the
+ * HKDF of the token on its packet path.
+ *
+ * Taking an id that leaves the pool below half of its capacity schedules a
+ * loop callback that fills it back up, after the packets of the loop.
+ */
+class ServerConnectionIdPool : private folly::EventBase::LoopCallback {
+ public:
+  struct Entry {
+    ConnectionId connId;
+    StatelessResetToken token;
+  };
+
+  /**
+   * The ids are encoded from params by connIdAlgo, and their tokens are for
+   * serverAddr. Ids the rejector rejects, when generated or taken, are
+   * dropped. evb may be null, in which case the pool is only filled by fill().
+   */
+  ServerConnectionIdPool(
+      folly::EventBase* evb,
+      size_t capacity,
+      ConnectionIdAlgo& connIdAlgo,
+      ServerConnectionIdParams params,
+      const StatelessResetSecret& secret,
+      const folly::SocketAddress& serverAddr,
+      const ServerConnectionIdRejector* rejector);
+
+  ~ServerConnectionIdPool() override;
+
+  /**
+   * Whether the ids of this pool are the ones a connection with these would
+   * make itself.
+   */
+  bool matches(
+      const ConnectionIdAlgo* connIdAlgo,
+      const ServerConnectionIdParams& params,
+      const StatelessResetSecret& secret,
+      const folly::SocketAddress& serverAddr) const;
+
+  /**
+   * Takes the oldest id that the rejector still accepts, or none if the pool
+   * ran out.
+   */
+  folly::Optional<Entry> take();
+
+  // Generates ids until the pool is at its capacity.
+  void fill();
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+ private:
+  void runLoopCallback() noexcept override;
+
+  folly::EventBase* evb_;
+  const size_t capacity_;
+  ConnectionIdAlgo& connIdAlgo_;
+  const ServerConnectionIdParams params_;
+  const StatelessResetSecret secret_;
+  const folly::SocketAddress serverAddr_;
+  const ServerConnectionIdRejector* rejector_;
+  StatelessResetGenerator resetGenerator_;
+  std::deque<Entry> entries_;
+};
+} // namespace quic
@@ -8,12 +8,14 @@
 
 #include <quic/server/state/ServerStateMachine.h>
 
+#include <folly/ScopeGuard.h>
 #include <quic/common/BufUtil.h>
 #include <quic/congestion_control/CongestionControllerFactory.h>
 #include <quic/fizz/handshake/FizzCryptoFactory.h>
 #include <quic/flowcontrol/QuicFlowController.h>
 #include <quic/handshake/TransportParameters.h>
 #include <quic/logging/QLoggerConstants.h>
+#include <quic/state/QuicFecFunctions.h>
 #include <quic/state/QuicPacingFunctions.h>
 #include <quic/state/QuicStreamFunctions.h>
 #include <quic/state/QuicTransportStatsCallback.h>
@@ -54,9 +56,20 @@ CongestionAndRttState moveCurrentCongestionAndRttState(
   state.lrtt = conn.lossState.lrtt;
   state.rttvar = conn.lossState.rttvar;
   state.mrtt = conn.lossState.mrtt;
+  state.udpSendPacketLen = conn.udpSendPacketLen;
+  state.pathMtuState = conn.pathMtuState;
   return state;
 }
 
+void restorePathMtuState(
+    QuicServerConnectionState& conn,
+    const PathMtuState& pathMtuState) {
+  // Whether a probe is in flight is about the connection, not the path.
+  bool probeInFlight = conn.pathMtuState.probeInFlight;
+  conn.pathMtuState = pathMtuState;
+  conn.pathMtuState.probeInFlight = probeInFlight;
+}
+
 void resetCongestionAndRttState(QuicServerConnectionState& conn) {
   CHECK(conn.congestionControllerFactory)
       << "CongestionControllerFactory is not set.";
@@ -67,26 +80,89 @@ void resetCongestionAndRttState(QuicServerConnectionState& conn) {
   conn.lossState.lrtt = 0us;
   conn.lossState.rttvar = 0us;
   conn.lossState.mrtt = kDefaultMinRtt;
+  if (conn.pathMtuState.phase != PathMtuState::Phase::Disabled) {
+    // The new path may not carry what the old one did, so the search starts
+    // over from the base size.
+    bool probeInFlight = conn.pathMtuState.probeInFlight;
+    conn.udpSendPacketLen = conn.pathMtuState.baseSize;
+    startPathMtuDiscovery(conn, conn.pathMtuState.maxSize);
+    conn.pathMtuState.probeInFlight = probeInFlight;
+  }
+}
+
+void restoreCongestionAndRttState(
+    QuicServerConnectionState& conn,
+    CongestionAndRttState& state) {
+  conn.congestionController = std::move(state.congestionController);
+  conn.lossState.srtt = state.srtt;
+  conn.lossState.lrtt = state.lrtt;
+  conn.lossState.rttvar = state.rttvar;
+  conn.lossState.mrtt = state.mrtt;
+  conn.udpSendPacketLen = state.udpSendPacketLen;
+  restorePathMtuState(conn, state.pathMtuState);
 }
 
 void recoverOrResetCongestionAndRttState(
     QuicServerConnectionState& conn,
     const folly::SocketAddress& peerAddress) {
+  auto now = Clock::now();
+  auto isStale = [now](const CongestionAndRttState& state) {
+    return now - state.recordTime > kTimeToRetainLastCongestionAndRttState;
+  };
   auto& lastState = conn.migrationState.lastCongestionAndRtt;
-  if (lastState && lastState->peerAddress == peerAddress &&
-      (Clock::now() - lastState->recordTime <=
-       kTimeToRetainLastCongestionAndRttState)) {
-    // recover from matched non-stale state
-    conn.congestionController = std::move(lastState->congestionController);
-    conn.lossState.srtt = lastState->srtt;
-    conn.lossState.lrtt = lastState->lrtt;
-    conn.lossState.rttvar = lastState->rttvar;
-    conn.lossState.mrtt = lastState->mrtt;
-    conn.migrationState.lastCongestionAndRtt = folly::none;
+  if (lastState && lastState->peerAddress == peerAddress) {
+    if (!isStale(*lastState)) {
+      // recover from matched non-stale state
+      restoreCongestionAndRttState(conn, *lastState);
+      conn.migrationState.lastCongestionAndRtt = folly::none;
+    } else {
+      resetCongestionAndRttState(conn);
+    }
+    return;
+  }
+  auto& earlierStates = conn.migrationState.earlierCongestionAndRtt;
+  earlierStates.erase(
+      std::remove_if(earlierStates.begin(), earlierStates.end(), isStale),
+      earlierStates.end());
+  auto it = std::find_if(
+      earlierStates.begin(),
+      earlierStates.end(),
+      [&peerAddress](const CongestionAndRttState& state) {
+        return state.peerAddress == peerAddress;
+      });
+  if (it != earlierStates.end()) {
+    restoreCongestionAndRttState(conn, *it);
+    earlierStates.erase(it);
   } else {
     resetCongestionAndRttState(conn);
   }
 }
+
+void rememberCongestionAndRttState(
+    QuicServerConnectionState& conn,
+    CongestionAndRttState state) {
+  auto& migrationState = conn.migrationState;
+  auto& earlierStates = migrationState.earlierCongestionAndRtt;
+  auto& lastState = migrationState.lastCongestionAndRtt;
+  if (lastState && lastState->peerAddress != state.peerAddress) {
+    earlierStates.push_back(std::move(*lastState));
+  }
+  const auto& peerAddress = state.peerAddress;
+  earlierStates.erase(
+      std::remove_if(
+          earlierStates.begin(),
+          earlierStates.end(),
+          [&peerAddress](const CongestionAndRttState& earlierState) {
+            return earlierState.peerAddress == peerAddress;
+          }),
+      earlierStates.end());
+  if (earlierStates.size() > kMaxEarlierCongestionAndRttStates) {
+    earlierStates.erase(
+        earlierStates.begin(),
+        earlierStates.end() - kMaxEarlierCongestionAndRttStates);
+  }
+  lastState = std::move(state);
+}
 } // namespace
 
 void processClientInitialParams(
@@ -118,6 +194,14 @@ void processClientInitialParams(
   auto partialReliability = getIntegerParameter(
       static_cast<TransportParameterId>(kPartialReliabilityParameterId),
       clientParams.parameters);
+  auto minAckDelay = getIntegerParameter(
+      static_cast<TransportParameterId>(kMinAckDelayParameterId),
+      clientParams.parameters);
+  auto maxDatagramFrameSize = getIntegerParameter(
+      TransportParameterId::max_datagram_frame_size, clientParams.parameters);
+  auto fecSupport = getIntegerParameter(
+      static_cast<TransportParameterId>(kFecSupportParameterId),
+      clientParams.parameters);
   auto activeConnectionIdLimit = getIntegerParameter(
       TransportParameterId::active_connection_id_limit,
       clientParams.parameters);
@@ -170,6 +254,9 @@ void processClientInitialParams(
     }
     conn.udpSendPacketLen = *packetSize;
   }
+  if (conn.transportSettings.enablePathMtuDiscovery) {
+    startPathMtuDiscovery(conn, *packetSize);
+  }
 
   conn.peerActiveConnectionIdLimit =
       activeConnectionIdLimit.value_or(kDefaultConnectionIdLimit);
@@ -180,6 +267,14 @@ void processClientInitialParams(
   }
   VLOG(10) << "conn.partialReliabilityEnabled="
            << conn.partialReliabilityEnabled;
+
+  if (minAckDelay) {
+    conn.peerMinAckDelay = std::chrono::microseconds(*minAckDelay);
+  }
+  if (maxDatagramFrameSize) {
+    conn.datagramState.maxWriteFrameSize = *maxDatagramFrameSize;
+  }
+  conn.fecState.peerSupported = fecSupport && *fecSupport != 0;
 }
 
 void updateHandshakeState(QuicServerConnectionState& conn) {
@@ -223,6 +318,8 @@ void updateHandshakeState(QuicServerConnectionState& conn) {
     QUIC_TRACE(fst_trace, conn, "derived 1-rtt write cipher");
     CHECK(!conn.oneRttWriteCipher.get());
     conn.oneRttWriteCipher = std::move(oneRttWriteCipher);
+    recordHandshakeTiming(
+        conn.handshakeTimings.oneRttKeysAvailable, conn.connectionTime);
 
     updatePacingOnKeyEstablished(conn);
 
@@ -249,6 +346,8 @@ void updateHandshakeState(QuicServerConnectionState& conn) {
   auto handshakeReadCipher = handshakeLayer->getHandshakeReadCipher();
   if (handshakeWriteCipher) {
     conn.handshakeWriteCipher = std::move(handshakeWriteCipher);
+    recordHandshakeTiming(
+        conn.handshakeTimings.handshakeKeysDerived, conn.connectionTime);
   }
   if (handshakeReadCipher) {
     conn.readCodec->setHandshakeReadCipher(std::move(handshakeReadCipher));
@@ -267,10 +366,18 @@ void updateHandshakeState(QuicServerConnectionState& conn) {
   if (handshakeLayer->isHandshakeDone()) {
     auto doneTime = conn.readCodec->getHandshakeDoneTime();
     if (!doneTime) {
-      conn.readCodec->onHandshakeDone(Clock::now());
+      auto now = Clock::now();
+      conn.readCodec->onHandshakeDone(now);
+      recordHandshakeTiming(
+          conn.handshakeTimings.handshakeDone, conn.connectionTime, now);
+      QUIC_STATS(conn.statsCallback, onHandshakeDone, conn.handshakeTimings);
       if (conn.version != QuicVersion::MVFST_D24) {
         sendSimpleFrame(conn, HandshakeDoneFrame());
       }
+      // The handshake is confirmed, which is when the server is done with
+      // the Handshake keys.
+      discardPacketNumberSpace(conn, PacketNumberSpace::Initial);
+      discardPacketNumberSpace(conn, PacketNumberSpace::Handshake);
     }
   }
 }
@@ -420,7 +527,7 @@ void onConnectionMigration(
       // remember its congestion state and rtt stats
       CongestionAndRttState state = moveCurrentCongestionAndRttState(conn);
       recoverOrResetCongestionAndRttState(conn, newPeerAddress);
-      conn.migrationState.lastCongestionAndRtt = std::move(state);
+      rememberCongestionAndRttState(conn, std::move(state));
     }
   }
 
@@ -495,7 +602,10 @@ void handleCipherUnavailable(
     ServerEvents::ReadData pendingReadData;
     pendingReadData.peer = readData.peer;
     pendingReadData.networkData = NetworkDataSingle(
-        std::move(originalData->packet), readData.networkData.receiveTimePoint);
+        std::move(originalData->packet),
+        readData.networkData.receiveTimePoint,
+        readData.networkData.ecn);
+    limitAckRanges(ackState, conn.transportSettings.maxAckRanges);
     pendingData->emplace_back(std::move(pendingReadData));
     VLOG(10) << "Adding pending data to "
              << toString(originalData->protectionType)
@@ -581,6 +691,10 @@ void onServerReadDataFromOpen(
     conn.serverConnectionId = newServerConnIdData->connId;
 
     QUIC_STATS(conn.statsCallback, onStatelessReset);
+    folly::Optional<std::chrono::microseconds> minAckDelay;
+    if (conn.transportSettings.advertiseMinAckDelay) {
+      minAckDelay = conn.transportSettings.minAckDelay;
+    }
     conn.serverHandshakeLayer->accept(
         std::make_shared<ServerTransportParametersExtension>(
             version,
@@ -594,7 +708,11 @@ void onServerReadDataFromOpen(
             conn.transportSettings.ackDelayExponent,
             conn.transportSettings.maxRecvPacketSize,
             conn.transportSettings.partialReliabilityEnabled,
-            *newServerConnIdData->token));
+            *newServerConnIdData->token,
+            minAckDelay,
+            conn.transportSettings.maxDatagramFrameSize,
+            conn.transportSettings.advertiseFecSupport,
+            conn.transportParametersCache));
     conn.transportParametersEncoded = true;
     CryptoFactory& cryptoFactory = *conn.serverHandshakeLayer->cryptoFactory_;
     conn.readCodec = std::make_unique<QuicReadCodec>(QuicNodeType::Server);
@@ -624,7 +742,29 @@ void onServerReadDataFromOpen(
        !udpData.empty() && processedPackets < kMaxNumCoalescedPackets;
        processedPackets++) {
     size_t dataSize = udpData.chainLength();
-    auto parsedPacket = conn.readCodec->parsePacket(udpData, conn.ackStates);
+    auto parsedPacket = [&] {
+      CpuTimeScope cpuTimeScope(
+          conn.cpuTime,
+          conn.transportSettings.trackCpuTime,
+          CpuTimeCategory::CRYPTO);
+      try {
+        return conn.readCodec->parsePacket(udpData, conn.ackStates);
+      } catch (const QuicTransportException& ex) {
+        if (ex.errorCode() == TransportErrorCode::PROTOCOL_VIOLATION) {
+          QUIC_STATS(
+              conn.statsCallback,
+              onPacketDropped,
+              PacketDropReason::PROTOCOL_VIOLATION);
+          if (conn.qLogger) {
+            conn.qLogger->addPacketDrop(
+                dataSize,
+                QuicTransportStatsCallback::toString(
+                    PacketDropReason::PROTOCOL_VIOLATION));
+          }
+        }
+        throw;
+      }
+    }();
     size_t packetSize = dataSize - udpData.chainLength();
 
     switch (parsedPacket.type()) {
@@ -672,46 +812,37 @@ void onServerReadDataFromOpen(
           conn.statsCallback, onPacketDropped, PacketDropReason::PARSE_ERROR);
       continue;
     }
+    SCOPE_EXIT {
+      if (conn.readCodec) {
+        conn.readCodec->recycleFrames(std::move(regularOptional->frames));
+      }
+    };
 
     auto protectionLevel = regularOptional->header.getProtectionType();
     auto encryptionLevel = protectionTypeToEncryptionLevel(protectionLevel);
 
     auto packetNum = regularOptional->header.getPacketSequenceNum();
     auto packetNumberSpace = regularOptional->header.getPacketNumberSpace();
+    if (isDuplicatePacket(getAckState(conn, packetNumberSpace), packetNum)) {
+      VLOG(10) << "drop duplicate packet=" << packetNum << " " << conn;
+      if (conn.qLogger) {
+        conn.qLogger->addPacketDrop(
+            packetSize,
+            QuicTransportStatsCallback::toString(
+                PacketDropReason::DUPLICATE_PACKET));
+      }
+      QUIC_STATS(
+          conn.statsCallback,
+          onPacketDropped,
+          PacketDropReason::DUPLICATE_PACKET);
+      continue;
+    }
 
+    // The codec already rejected Initial and Handshake packets with frames
+    // they can't carry.
     // TODO: enforce constraints on other protection levels.
     auto& regularPacket = *regularOptional;
 
-    bool isProtectedPacket = protectionLevel == ProtectionType::ZeroRtt ||
-        protectionLevel == ProtectionType::KeyPhaseZero ||
-        protectionLevel == ProtectionType::KeyPhaseOne;
-
-    if (!isProtectedPacket) {
-      for (auto& quicFrame : regularPacket.frames) {
-        auto isPadding = quicFrame.asPaddingFrame();
-        auto isAck = quicFrame.asReadAckFrame();
-        auto isClose = quicFrame.asConnectionCloseFrame();
-        auto isCrypto = quicFrame.asReadCryptoFrame();
-        auto isSimple = quicFrame.asQuicSimpleFrame();
-        auto isPing = isSimple ? isSimple->asPingFrame() : nullptr;
-        // TODO: add path challenge and response
-        if (!isPadding && !isAck && !isClose && !isCrypto && !isPing) {
-          QUIC_STATS(
-              conn.statsCallback,
-              onPacketDropped,
-              PacketDropReason::PROTOCOL_VIOLATION);
-          if (conn.qLogger) {
-            conn.qLogger->addPacketDrop(
-                packetSize,
-                QuicTransportStatsCallback::toString(
-                    PacketDropReason::PROTOCOL_VIOLATION));
-          }
-          throw QuicTransportException(
-              "Invalid frame", TransportErrorCode::PROTOCOL_VIOLATION);
-        }
-      }
-    }
-
     CHECK(conn.clientConnectionId);
     if (conn.qLogger) {
       conn.qLogger->addPacket(regularPacket, packetSize);
@@ -764,13 +895,27 @@ void onServerReadDataFromOpen(
 
     auto& ackState = getAckState(conn, packetNumberSpace);
     auto outOfOrder = updateLargestReceivedPacketNum(
-        ackState, packetNum, readData.networkData.receiveTimePoint);
+        ackState,
+        packetNum,
+        readData.networkData.receiveTimePoint,
+        readData.networkData.ecn);
+    if (packetNumberSpace == PacketNumberSpace::Initial) {
+      recordHandshakeTiming(
+          conn.handshakeTimings.firstInitialReceived,
+          conn.connectionTime,
+          readData.networkData.receiveTimePoint);
+    }
     DCHECK(hasReceivedPackets(conn));
 
     bool pktHasRetransmittableData = false;
     bool pktHasCryptoData = false;
     bool isNonProbingPacket = false;
 
+    if (packetNumberSpace == PacketNumberSpace::AppData) {
+      // Before the stream frames are moved out of the packet.
+      onFecSourcePacketReceived(conn, packetNum, regularPacket);
+    }
+
     // TODO: possibly drop the packet here, but rolling back state of
     // what we've already processed is difficult.
     for (auto& quicFrame : regularPacket.frames) {
@@ -974,6 +1119,13 @@ void onServerReadDataFromOpen(
         case QuicFrame::Type::PaddingFrame_E: {
           break;
         }
+        case QuicFrame::Type::DatagramFrame_E: {
+          VLOG(10) << "Server received datagram " << conn;
+          pktHasRetransmittableData = true;
+          isNonProbingPacket = true;
+          handleDatagram(conn, *quicFrame.asDatagramFrame());
+          break;
+        }
         case QuicFrame::Type::QuicSimpleFrame_E: {
           pktHasRetransmittableData = true;
           QuicSimpleFrame& simpleFrame = *quicFrame.asQuicSimpleFrame();
@@ -1026,7 +1178,14 @@ void onServerReadDataFromOpen(
     auto data = readDataFromCryptoStream(
         *getCryptoStream(*conn.cryptoState, encryptionLevel));
     if (data) {
-      conn.serverHandshakeLayer->doHandshake(std::move(data), encryptionLevel);
+      {
+        CpuTimeScope cpuTimeScope(
+            conn.cpuTime,
+            conn.transportSettings.trackCpuTime,
+            CpuTimeCategory::CRYPTO);
+        conn.serverHandshakeLayer->doHandshake(
+            std::move(data), encryptionLevel);
+      }
 
       try {
         updateHandshakeState(conn);
@@ -1051,6 +1210,11 @@ void onServerReadDataFromOpen(
         outOfOrder,
         pktHasRetransmittableData,
         pktHasCryptoData);
+    if (packetNumberSpace == PacketNumberSpace::Handshake) {
+      // The client has the Handshake keys, so it won't send Initial packets
+      // any more.
+      discardPacketNumberSpace(conn, PacketNumberSpace::Initial);
+    }
     QUIC_STATS(conn.statsCallback, onPacketProcessed);
   }
   VLOG_IF(4, !udpData.empty())
@@ -1097,7 +1261,13 @@ void onServerReadDataFromClosed(
         PacketDropReason::SERVER_STATE_CLOSED);
     return;
   }
-  auto parsedPacket = conn.readCodec->parsePacket(udpData, conn.ackStates);
+  auto parsedPacket = [&] {
+    CpuTimeScope cpuTimeScope(
+        conn.cpuTime,
+        conn.transportSettings.trackCpuTime,
+        CpuTimeCategory::CRYPTO);
+    return conn.readCodec->parsePacket(udpData, conn.ackStates);
+  }();
   switch (parsedPacket.type()) {
     case CodecResult::Type::CIPHER_UNAVAILABLE: {
       VLOG(10) << "drop cipher unavailable " << conn;
@@ -1148,6 +1318,11 @@ void onServerReadDataFromClosed(
         conn.statsCallback, onPacketDropped, PacketDropReason::PARSE_ERROR);
     return;
   }
+  SCOPE_EXIT {
+    if (conn.readCodec) {
+      conn.readCodec->recycleFrames(std::move(regularOptional->frames));
+    }
+  };
 
   auto& regularPacket = *regularOptional;
   auto packetNum = regularPacket.header.getPacketSequenceNum();
@@ -1209,6 +1384,22 @@ QuicServerConnectionState::createAndAddNewSelfConnId() {
 
   CHECK(transportSettings.statelessResetTokenSecret);
 
+  if (connIdPool &&
+      connIdPool->matches(
+          connIdAlgo,
+          *serverConnIdParams,
+          *transportSettings.statelessResetTokenSecret,
+          serverAddr)) {
+    auto entry = connIdPool->take();
+    if (entry) {
+      auto newConnIdData = ConnectionIdData{
+          std::move(entry->connId), nextSelfConnectionIdSequence++};
+      newConnIdData.token = std::move(entry->token);
+      selfConnectionIds.push_back(newConnIdData);
+      return newConnIdData;
+    }
+  }
+
   StatelessResetGenerator generator(
       transportSettings.statelessResetTokenSecret.value(),
       serverAddr.getFullyQualified());
@@ -20,6 +20,7 @@
 #include <quic/logging/QuicLogger.h>
 #include <quic/loss/QuicLossFunctions.h>
 #include <quic/server/handshake/ServerHandshake.h>
+#include <quic/server/state/ServerConnectionIdPool.h>
 #include <quic/server/state/ServerConnectionIdRejector.h>
 #include <quic/state/AckHandlers.h>
 #include <quic/state/QPRFunctions.h>
@@ -68,6 +69,10 @@ struct CongestionAndRttState {
   std::chrono::microseconds rttvar;
   // Minimum rtt
   std::chrono::microseconds mrtt;
+
+  // Packet size the path carries, and how far path MTU discovery got
+  uint64_t udpSendPacketLen{kDefaultUDPSendPacketLen};
+  PathMtuState pathMtuState;
 };
 
 struct ConnectionMigrationState {
@@ -78,6 +83,11 @@ struct ConnectionMigrationState {
 
   // Congestion state and rtt stats of last validated peer
   folly::Optional<CongestionAndRttState> lastCongestionAndRtt;
+
+  // The same for the validated peers before it, oldest first, at most one per
+  // address. A client flipping between a few networks finds each of them
+  // again, not only the one it just left.
+  std::vector<CongestionAndRttState> earlierCongestionAndRtt;
 };
 
 struct QuicServerConnectionState : public QuicConnectionStateBase {
@@ -104,6 +114,14 @@ struct QuicServerConnectionState : public QuicConnectionStateBase {
   // ServerConnectionIdRejector can reject a ConnectionId from ConnectionIdAlgo
   ServerConnectionIdRejector* connIdRejector{nullptr};
 
+  // Connection ids generated ahead of time by the worker, taken before
+  // encoding new ones when they are for the same params, secret and address.
+  ServerConnectionIdPool* connIdPool{nullptr};
+
+  // Shared by the connections of a worker, so that the transport parameters
+  // that don't change per connection are only encoded once.
+  ServerTransportParametersCache* transportParametersCache{nullptr};
+
   // Source address token that can be saved to client via PSK.
   // Address with higher index is more recently used.
   std::vector<folly::IPAddress> tokenSourceAddresses;
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <folly/io/IOBuf.h>
+#include <quic/server/CrossWorkerPacketQueue.h>
+
+#include <thread>
+
+using namespace quic;
+
+namespace {
+RoutingData makeRoutingData(uint8_t id) {
+  std::vector<uint8_t> cid(kDefaultConnectionIdSize, id);
+  return RoutingData(
+      HeaderForm::Short, false, false, ConnectionId(cid), folly::none);
+}
+
+NetworkData makeNetworkData(size_t len) {
+  return NetworkData(folly::IOBuf::create(len), Clock::now());
+}
+} // namespace
+
+TEST(CrossWorkerPacketQueueTest, OneWakeupPerBatch) {
+  CrossWorkerPacketQueue queue(2);
+  folly::SocketAddress client("1.2.3.4", 1234);
+  size_t wakeups = 0;
+  for (uint8_t i = 0; i < 4; ++i) {
+    auto routingData = makeRoutingData(i);
+    auto networkData = makeNetworkData(10);
+    bool needsWakeup = false;
+    EXPECT_TRUE(queue.enqueue(
+        i % 2, client, routingData, networkData, false, needsWakeup));
+    wakeups += needsWakeup ? 1 : 0;
+  }
+  EXPECT_EQ(1, wakeups);
+
+  std::vector<ConnectionId> drained;
+  EXPECT_EQ(4, queue.drain([&](CrossWorkerPacketQueue::Packet& packet) {
+    EXPECT_EQ(client, packet.client);
+    EXPECT_EQ(1, packet.networkData.packets.size());
+    drained.push_back(packet.routingData.destinationConnId);
+  }));
+  // Packets from one source keep their order.
+  ASSERT_EQ(4, drained.size());
+  EXPECT_EQ(makeRoutingData(0).destinationConnId, drained[0]);
+  EXPECT_EQ(makeRoutingData(2).destinationConnId, drained[1]);
+  EXPECT_EQ(0, queue.drain([](CrossWorkerPacketQueue::Packet&) {}));
+
+  // The next packet after a drain needs a new wakeup.
+  auto routingData = makeRoutingData(5);
+  auto networkData = makeNetworkData(10);
+  bool needsWakeup = false;
+  EXPECT_TRUE(
+      queue.enqueue(0, client, routingData, networkData, true, needsWakeup));
+  EXPECT_TRUE(needsWakeup);
+}
+
+TEST(CrossWorkerPacketQueueTest, FullRingLeavesPacket) {
+  CrossWorkerPacketQueue queue(1, 1);
+  folly::SocketAddress client("1.2.3.4", 1234);
+  auto routingData = makeRoutingData(0);
+  auto networkData = makeNetworkData(10);
+  bool needsWakeup = false;
+  EXPECT_TRUE(
+      queue.enqueue(0, client, routingData, networkData, false, needsWakeup));
+  EXPECT_TRUE(needsWakeup);
+
+  auto fullRoutingData = makeRoutingData(1);
+  auto fullNetworkData = makeNetworkData(10);
+  EXPECT_FALSE(queue.enqueue(
+      0, client, fullRoutingData, fullNetworkData, false, needsWakeup));
+  EXPECT_FALSE(needsWakeup);
+  // The caller still owns the packet it couldn't hand off.
+  EXPECT_EQ(1, fullNetworkData.packets.size());
+  EXPECT_EQ(10, fullNetworkData.totalData);
+}
+
+TEST(CrossWorkerPacketQueueTest, ConcurrentProducers) {
+  constexpr size_t kNumSources = 4;
+  constexpr size_t kPacketsPerSource = 1000;
+  CrossWorkerPacketQueue queue(kNumSources, 64);
+  folly::SocketAddress client("1.2.3.4", 1234);
+  std::atomic<size_t> wakeups{0};
+  std::vector<std::thread> producers;
+  for (size_t source = 0; source < kNumSources; ++source) {
+    producers.emplace_back([&, source] {
+      for (size_t i = 0; i < kPacketsPerSource;) {
+        auto routingData = makeRoutingData(source);
+        auto networkData = makeNetworkData(1);
+        bool needsWakeup = false;
+        if (queue.enqueue(
+                source, client, routingData, networkData, false, needsWakeup)) {
+          ++i;
+          if (needsWakeup) {
+            ++wakeups;
+          }
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  size_t drained = 0;
+  while (drained < kNumSources * kPacketsPerSource) {
+    drained += queue.drain([](CrossWorkerPacketQueue::Packet&) {});
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  EXPECT_EQ(kNumSources * kPacketsPerSource, drained);
+  EXPECT_GE(wakeups.load(), 1);
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <quic/server/DirectConnectionIdTable.h>
+
+#include <memory>
+
+using namespace quic;
+
+namespace {
+ConnectionId makeConnId(uint8_t head, uint8_t tail) {
+  return ConnectionId(std::vector<uint8_t>{head, 1, 2, 3, 4, 5, 6, tail});
+}
+} // namespace
+
+TEST(DirectConnectionIdTableTest, FindInsertErase) {
+  DirectConnectionIdTable<std::shared_ptr<int>> table(100);
+  EXPECT_EQ(128, table.numSlots());
+  auto value = std::make_shared<int>(1);
+  auto connId = makeConnId(0, 7);
+  EXPECT_EQ(nullptr, table.find(connId));
+  EXPECT_TRUE(table.insert(connId, value));
+  ASSERT_NE(nullptr, table.find(connId));
+  EXPECT_EQ(value, *table.find(connId));
+  // Same slot, different id.
+  EXPECT_EQ(nullptr, table.find(makeConnId(1, 7)));
+
+  table.erase(makeConnId(1, 7));
+  EXPECT_NE(nullptr, table.find(connId));
+  table.erase(connId);
+  EXPECT_EQ(nullptr, table.find(connId));
+  EXPECT_EQ(1, value.use_count());
+}
+
+TEST(DirectConnectionIdTableTest, CollisionKeepsFirst) {
+  DirectConnectionIdTable<std::shared_ptr<int>> table(16);
+  auto first = std::make_shared<int>(1);
+  auto second = std::make_shared<int>(2);
+  EXPECT_TRUE(table.insert(makeConnId(0, 3), first));
+  EXPECT_FALSE(table.insert(makeConnId(1, 3), second));
+  EXPECT_EQ(first, *table.find(makeConnId(0, 3)));
+  EXPECT_EQ(nullptr, table.find(makeConnId(1, 3)));
+  // Once freed, the slot can be taken by the other id.
+  table.erase(makeConnId(0, 3));
+  EXPECT_TRUE(table.insert(makeConnId(1, 3), second));
+  EXPECT_EQ(second, *table.find(makeConnId(1, 3)));
+
+  table.clear();
+  EXPECT_EQ(nullptr, table.find(makeConnId(1, 3)));
+  EXPECT_EQ(1, second.use_count());
+}
+
+TEST(DirectConnectionIdTableTest, ShortConnectionIds) {
+  DirectConnectionIdTable<std::shared_ptr<int>> table(16);
+  auto value = std::make_shared<int>(1);
+  ConnectionId empty(std::vector<uint8_t>{});
+  ConnectionId shortId(std::vector<uint8_t>{9});
+  EXPECT_TRUE(table.insert(empty, value));
+  EXPECT_TRUE(table.insert(shortId, value));
+  EXPECT_NE(nullptr, table.find(empty));
+  EXPECT_NE(nullptr, table.find(shortId));
+}
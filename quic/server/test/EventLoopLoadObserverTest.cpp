@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <quic/server/EventLoopLoadObserver.h>
+
+using namespace std::chrono_literals;
+using namespace quic;
+
+namespace {
+class CountingObserver : public folly::EventBaseObserver {
+ public:
+  explicit CountingObserver(uint32_t sampleRate) : sampleRate_(sampleRate) {}
+
+  uint32_t getSampleRate() const override {
+    return sampleRate_;
+  }
+
+  void loopSample(int64_t busyTime, int64_t /* idleTime */) override {
+    ++samples;
+    lastBusyTime = busyTime;
+  }
+
+  size_t samples{0};
+  int64_t lastBusyTime{0};
+
+ private:
+  uint32_t sampleRate_;
+};
+} // namespace
+
+TEST(EventLoopLoadObserverTest, OverloadedAfterSustainedBusyLoops) {
+  EventLoopLoadObserver observer(1000us);
+  EXPECT_FALSE(observer.isOverloaded());
+  // One long loop is smoothed away.
+  observer.loopSample(5000, 0);
+  EXPECT_FALSE(observer.isOverloaded());
+  for (int i = 0; i < 20; ++i) {
+    observer.loopSample(5000, 0);
+  }
+  EXPECT_TRUE(observer.isOverloaded());
+  EXPECT_GT(observer.getSmoothedBusyTime(), 1000us);
+}
+
+TEST(EventLoopLoadObserverTest, Hysteresis) {
+  EventLoopLoadObserver observer(1000us);
+  for (int i = 0; i < 50; ++i) {
+    observer.loopSample(2000, 0);
+  }
+  EXPECT_TRUE(observer.isOverloaded());
+  // Under the threshold but over half of it stays overloaded.
+  for (int i = 0; i < 100; ++i) {
+    observer.loopSample(800, 0);
+  }
+  EXPECT_TRUE(observer.isOverloaded());
+  for (int i = 0; i < 100; ++i) {
+    observer.loopSample(100, 1000);
+  }
+  EXPECT_FALSE(observer.isOverloaded());
+}
+
+TEST(EventLoopLoadObserverTest, ForwardsAtNextSampleRate) {
+  auto next = std::make_shared<CountingObserver>(4);
+  EventLoopLoadObserver observer(1000us, next);
+  for (int i = 0; i < 8; ++i) {
+    observer.loopSample(i, 0);
+  }
+  EXPECT_EQ(next->samples, 2);
+  EXPECT_EQ(next->lastBusyTime, 7);
+
+  auto other = std::make_shared<CountingObserver>(1);
+  observer.setNext(other);
+  observer.loopSample(10, 0);
+  EXPECT_EQ(next->samples, 2);
+  EXPECT_EQ(other->samples, 1);
+  observer.setNext(nullptr);
+  observer.loopSample(10, 0);
+  EXPECT_EQ(other->samples, 1);
+}
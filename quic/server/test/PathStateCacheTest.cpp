@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <quic/server/PathStateCache.h>
+
+using namespace std::chrono_literals;
+using namespace quic;
+
+namespace {
+CachedPathState makePathState(TimePoint recordTime) {
+  CachedPathState state;
+  state.srtt = 30ms;
+  state.minRtt = 20ms;
+  state.congestionWindow = 100 * kDefaultUDPSendPacketLen;
+  state.recordTime = recordTime;
+  return state;
+}
+} // namespace
+
+TEST(PathStateCacheTest, KeyedByNetwork) {
+  PathStateCache cache;
+  auto now = Clock::now();
+  cache.update(folly::IPAddress("10.1.2.3"), makePathState(now));
+  cache.update(folly::IPAddress("2401:db00:1:2::1"), makePathState(now));
+  EXPECT_EQ(2, cache.size());
+
+  EXPECT_TRUE(cache.get(folly::IPAddress("10.1.2.200"), now).has_value());
+  EXPECT_TRUE(cache.get(folly::IPAddress("::ffff:10.1.2.7"), now).has_value());
+  EXPECT_FALSE(cache.get(folly::IPAddress("10.1.3.3"), now).has_value());
+  EXPECT_TRUE(cache.get(folly::IPAddress("2401:db00:1:ff::2"), now));
+  EXPECT_FALSE(cache.get(folly::IPAddress("2401:db00:2:2::1"), now));
+}
+
+TEST(PathStateCacheTest, ExpiresAndEvicts) {
+  PathStateCache cache(1, 60s);
+  auto now = Clock::now();
+  cache.update(folly::IPAddress("10.1.2.3"), makePathState(now));
+  EXPECT_TRUE(cache.get(folly::IPAddress("10.1.2.3"), now + 60s));
+  EXPECT_FALSE(cache.get(folly::IPAddress("10.1.2.3"), now + 61s));
+  EXPECT_EQ(0, cache.size());
+
+  cache.update(folly::IPAddress("10.1.2.3"), makePathState(now));
+  cache.update(folly::IPAddress("10.9.9.9"), makePathState(now));
+  EXPECT_EQ(1, cache.size());
+  EXPECT_FALSE(cache.get(folly::IPAddress("10.1.2.3"), now));
+}
+
+TEST(PathStateCacheTest, SeedTransportSettings) {
+  TransportSettings settings;
+  settings.initCwndInMss = 10;
+  settings.maxCwndInMss = 40;
+  auto state = makePathState(Clock::now());
+  seedTransportSettingsFromPathState(settings, state);
+  EXPECT_EQ(30ms, settings.initialRtt);
+  // Half of the cached 100 packets, bounded by maxCwndInMss.
+  EXPECT_EQ(40, settings.initCwndInMss);
+
+  settings.maxCwndInMss = 2000;
+  seedTransportSettingsFromPathState(settings, state);
+  EXPECT_EQ(50, settings.initCwndInMss);
+
+  // Never lower than the configured initial cwnd.
+  state.congestionWindow = 4 * kDefaultUDPSendPacketLen;
+  seedTransportSettingsFromPathState(settings, state);
+  EXPECT_EQ(50, settings.initCwndInMss);
+}
@@ -349,6 +349,26 @@ void QuicServerWorkerTest::testSendReset(
   eventbase_.loop();
 }
 
+TEST_F(QuicServerWorkerTest, HealthCheckBeforeParsing) {
+  EXPECT_CALL(*socketPtr_, address()).WillRepeatedly(ReturnRef(fakeAddress_));
+  // Parses as a short header, but is answered without a lookup.
+  std::string token(64, 'h');
+  worker_->setHealthCheckToken(token);
+  EXPECT_CALL(*transportInfoCb_, onPacketDropped(_)).Times(0);
+  EXPECT_CALL(*transportInfoCb_, onStatelessReset()).Times(0);
+  EXPECT_CALL(*socketPtr_, write(kClientAddr, _))
+      .Times(2)
+      .WillRepeatedly(Invoke([&](const folly::SocketAddress&,
+                                 const std::unique_ptr<folly::IOBuf>& buf) {
+        EXPECT_EQ("OK", buf->clone()->moveToFbString().toStdString());
+        return 2;
+      }));
+  worker_->handleNetworkData(
+      kClientAddr, folly::IOBuf::copyBuffer(token), Clock::now());
+  worker_->handleNetworkData(
+      kClientAddr, folly::IOBuf::copyBuffer(token), Clock::now());
+}
+
 TEST_F(QuicServerWorkerTest, HostIdMismatchTestReset) {
   auto data = folly::IOBuf::copyBuffer("data");
   EXPECT_CALL(*socketPtr_, address()).WillRepeatedly(ReturnRef(fakeAddress_));
@@ -378,6 +398,104 @@ TEST_F(QuicServerWorkerTest, NoConnFoundTestReset) {
       QuicTransportStatsCallback::PacketDropReason::CONNECTION_NOT_FOUND);
 }
 
+TEST_F(QuicServerWorkerTest, RateLimitResets) {
+  EXPECT_CALL(*socketPtr_, address()).WillRepeatedly(ReturnRef(fakeAddress_));
+  TransportSettings settings;
+  settings.statelessResetTokenSecret = getRandSecret();
+  settings.maxStatelessResponsesPerSecond = 2;
+  settings.maxStatelessResponsesPerClientPerSecond = 1;
+  worker_->setTransportSettings(settings);
+  worker_->start();
+  worker_->stopPacketForwarding();
+  auto sendShortHeader = [&](const folly::SocketAddress& client,
+                             TimePoint now) {
+    worker_->dispatchPacketData(
+        client,
+        RoutingData(
+            HeaderForm::Short,
+            false,
+            false,
+            getTestConnectionId(hostId_),
+            folly::none),
+        NetworkData(folly::IOBuf::copyBuffer("data"), now));
+  };
+  folly::SocketAddress otherClient("::2", 1234);
+  folly::SocketAddress thirdClient("::3", 1234);
+  auto now = Clock::now();
+  EXPECT_CALL(*transportInfoCb_, onStatelessReset()).Times(3);
+  EXPECT_CALL(*socketPtr_, write(kClientAddr, _)).Times(1);
+  EXPECT_CALL(*socketPtr_, write(otherClient, _)).Times(1);
+  EXPECT_CALL(*socketPtr_, write(thirdClient, _)).Times(0);
+  sendShortHeader(kClientAddr, now);
+  // Over the limit of the client.
+  sendShortHeader(kClientAddr, now);
+  sendShortHeader(otherClient, now);
+  // Over the limit of the worker.
+  sendShortHeader(thirdClient, now);
+  Mock::VerifyAndClearExpectations(socketPtr_);
+
+  EXPECT_CALL(*socketPtr_, address()).WillRepeatedly(ReturnRef(fakeAddress_));
+  EXPECT_CALL(*socketPtr_, write(kClientAddr, _)).Times(1);
+  sendShortHeader(kClientAddr, now + std::chrono::seconds(2));
+}
+
+TEST_F(QuicServerWorkerTest, CompactDrainingConnection) {
+  EXPECT_CALL(*socketPtr_, address()).WillRepeatedly(ReturnRef(fakeAddress_));
+  TransportSettings settings;
+  settings.statelessResetTokenSecret = getRandSecret();
+  settings.compactDrainingState = true;
+  worker_->setTransportSettings(settings);
+  worker_->start();
+  worker_->stopPacketForwarding();
+
+  std::vector<ConnectionIdData> connIds;
+  connIds.emplace_back(getTestConnectionId(hostId_), 0);
+  connIds.emplace_back(getTestConnectionId(hostId_ + 0x100), 1);
+  EXPECT_TRUE(worker_->onConnectionDraining(
+      kClientAddr,
+      connIds,
+      folly::IOBuf::copyBuffer("close"),
+      std::chrono::seconds(1)));
+  EXPECT_EQ(worker_->getNumDrainingConnectionIds(), 2);
+
+  auto sendShortHeader = [&](const folly::SocketAddress& client,
+                             const ConnectionId& connId,
+                             TimePoint now) {
+    worker_->dispatchPacketData(
+        client,
+        RoutingData(HeaderForm::Short, false, false, connId, folly::none),
+        NetworkData(folly::IOBuf::copyBuffer("data"), now));
+  };
+  auto now = Clock::now();
+  folly::SocketAddress otherClient("::2", 1234);
+  // The close goes back for the 1st, 2nd and 4th packets, to either id, and
+  // only to the peer.
+  EXPECT_CALL(*transportInfoCb_, onStatelessReset()).Times(0);
+  EXPECT_CALL(*socketPtr_, write(kClientAddr, _))
+      .Times(3)
+      .WillRepeatedly(Invoke([&](const folly::SocketAddress&,
+                                 const std::unique_ptr<folly::IOBuf>& buf) {
+        EXPECT_EQ("close", buf->clone()->moveToFbString().toStdString());
+        return 5;
+      }));
+  EXPECT_CALL(*socketPtr_, write(otherClient, _)).Times(0);
+  sendShortHeader(kClientAddr, connIds[0].connId, now);
+  sendShortHeader(kClientAddr, connIds[1].connId, now);
+  sendShortHeader(kClientAddr, connIds[0].connId, now);
+  sendShortHeader(otherClient, connIds[0].connId, now);
+  sendShortHeader(kClientAddr, connIds[1].connId, now);
+  Mock::VerifyAndClearExpectations(socketPtr_);
+  Mock::VerifyAndClearExpectations(transportInfoCb_);
+
+  // Past the drain period the ids are unknown again.
+  EXPECT_CALL(*socketPtr_, address()).WillRepeatedly(ReturnRef(fakeAddress_));
+  EXPECT_CALL(*transportInfoCb_, onStatelessReset());
+  EXPECT_CALL(*socketPtr_, write(kClientAddr, _));
+  sendShortHeader(
+      kClientAddr, connIds[0].connId, now + std::chrono::seconds(2));
+  EXPECT_EQ(worker_->getNumDrainingConnectionIds(), 1);
+}
+
 TEST_F(QuicServerWorkerTest, QuicServerWorkerUnbindBeforeCidAvailable) {
   NiceMock<MockConnectionCallback> connCb;
   auto mockSock =
@@ -472,7 +590,7 @@ TEST_F(QuicServerWorkerTest, QuicServerMultipleConnIdsRouting) {
       NetworkData(data->clone(), Clock::now()));
   eventbase_.loop();
 
-  EXPECT_CALL(*transportInfoCb_, onConnectionClose(_)).Times(1);
+  EXPECT_CALL(*transportInfoCb_, onConnectionClose(_, _)).Times(1);
   EXPECT_CALL(*transport_, setRoutingCallback(nullptr));
   worker_->onConnectionUnbound(
       transport_.get(),
@@ -488,6 +606,136 @@ TEST_F(QuicServerWorkerTest, QuicServerMultipleConnIdsRouting) {
   transport_->QuicServerTransport::setRoutingCallback(nullptr);
 }
 
+TEST_F(QuicServerWorkerTest, MoveConnections) {
+  EXPECT_CALL(*socketPtr_, address()).WillRepeatedly(ReturnRef(fakeAddress_));
+  auto connId = getTestConnectionId(hostId_);
+  createQuicConnection(kClientAddr, connId);
+  EXPECT_CALL(*transportInfoCb_, onNewConnection());
+  worker_->onConnectionIdAvailable(transport_, connId);
+  EXPECT_CALL(*transport_, getClientChosenDestConnectionId())
+      .WillRepeatedly(Return(connId));
+  worker_->onConnectionIdBound(transport_);
+
+  auto otherSock = std::make_unique<NiceMock<folly::test::MockAsyncUDPSocket>>(
+      &eventbase_);
+  auto otherWorker = std::make_unique<QuicServerWorker>(workerCb_);
+  TransportSettings settings;
+  settings.statelessResetTokenSecret = getRandSecret();
+  otherWorker->setTransportSettings(settings);
+  otherWorker->setSocket(std::move(otherSock));
+  otherWorker->setWorkerId(7);
+  otherWorker->setProcessId(ProcessId::ONE);
+  otherWorker->setHostId(hostId_);
+  otherWorker->setConnectionIdAlgo(
+      std::make_unique<DefaultConnectionIdAlgo>());
+
+  // Not while it's busy.
+  EXPECT_CALL(*transport_, isDetachable()).WillOnce(Return(false));
+  EXPECT_EQ(0, worker_->moveConnectionsTo(*otherWorker, 5));
+
+  EXPECT_CALL(*transport_, isDetachable()).WillOnce(Return(true));
+  EXPECT_CALL(*transport_, detachEventBase());
+  EXPECT_EQ(1, worker_->moveConnectionsTo(*otherWorker, 5));
+  EXPECT_EQ(0, worker_->getNumBoundConnections());
+  EXPECT_EQ(0, worker_->getConnectionIdMap().count(connId));
+
+  EXPECT_CALL(*transport_, setRoutingCallback(otherWorker.get()));
+  EXPECT_CALL(*transport_, setServerConnectionIdParams(_))
+      .WillOnce(Invoke([](ServerConnectionIdParams params) {
+        EXPECT_EQ(params.workerId, 7);
+      }));
+  EXPECT_CALL(*transport_, attachEventBase(&eventbase_));
+  eventbase_.loop();
+  EXPECT_EQ(1, otherWorker->getNumBoundConnections());
+  EXPECT_EQ(1, otherWorker->getConnectionIdMap().count(connId));
+
+  // Packets that still come to the old worker are handed on.
+  auto data = folly::IOBuf::copyBuffer("data");
+  EXPECT_CALL(
+      *transport_, onNetworkData(kClientAddr, NetworkDataMatches(*data)));
+  RoutingData routingData(HeaderForm::Short, false, false, connId, folly::none);
+  worker_->dispatchPacketData(
+      kClientAddr,
+      std::move(routingData),
+      NetworkData(data->clone(), Clock::now()));
+  eventbase_.loop();
+
+  EXPECT_CALL(*transport_, setRoutingCallback(nullptr));
+  otherWorker->shutdownAllConnections(LocalErrorCode::SHUTTING_DOWN);
+}
+
+TEST_F(QuicServerWorkerTest, Drain) {
+  auto connId = getTestConnectionId(hostId_);
+  createQuicConnection(kClientAddr, connId);
+  bool drained = false;
+  worker_->drain(std::chrono::milliseconds(0), [&] { drained = true; });
+  EXPECT_TRUE(worker_->isDraining());
+  worker_->stopDraining();
+  EXPECT_FALSE(worker_->isDraining());
+  eventbase_.loop();
+  EXPECT_FALSE(drained);
+
+  // Past the timeout with the connection still there.
+  worker_->drain(std::chrono::milliseconds(0), [&] { drained = true; });
+  eventbase_.loop();
+  EXPECT_TRUE(drained);
+  EXPECT_EQ(1, worker_->getSrcToTransportMap().size());
+}
+
+TEST_F(QuicServerWorkerTest, CloseAllConnections) {
+  auto connId = getTestConnectionId(hostId_);
+  createQuicConnection(kClientAddr, connId);
+  EXPECT_CALL(*transport_, setEgressBatch(NotNull()));
+  EXPECT_CALL(*transport_, closeNow(_));
+  bool closed = false;
+  worker_->closeAllConnections(
+      LocalErrorCode::SHUTTING_DOWN, 1, [&] { closed = true; });
+  EXPECT_TRUE(closed);
+  EXPECT_EQ(0, worker_->getSrcToTransportMap().size());
+  auto progress = worker_->getCloseProgress();
+  EXPECT_EQ(1, progress.closed);
+  EXPECT_EQ(0, progress.remaining);
+}
+
+TEST_F(QuicServerWorkerTest, BusyPoll) {
+  TransportSettings settings;
+  settings.statelessResetTokenSecret = getRandSecret();
+  settings.shouldRecvBatch = true;
+  settings.busyPollWindow = std::chrono::seconds(10);
+  settings.busyPollCpuBudgetPercent = 0;
+  worker_->setTransportSettings(settings);
+  EXPECT_CALL(*socketPtr_, address()).WillRepeatedly(ReturnRef(fakeAddress_));
+  int numPackets = 3;
+  int reads = 0;
+  EXPECT_CALL(*socketPtr_, recvmmsg(_, _, _, nullptr))
+      .WillRepeatedly(Invoke([&](struct mmsghdr* msgs,
+                                 unsigned int,
+                                 unsigned int,
+                                 struct timespec*) {
+        ++reads;
+        if (numPackets-- > 0) {
+          // Empty, so it's dropped.
+          msgs[0].msg_len = 0;
+          return 1;
+        }
+        errno = EAGAIN;
+        return -1;
+      }));
+  // Polls through the loop while there are packets, and the first time
+  // there are none is already over the budget.
+  worker_->onNotifyDataAvailable(*socketPtr_);
+  eventbase_.loop();
+  EXPECT_EQ(4, reads);
+
+  settings.busyPollWindow = std::chrono::microseconds(0);
+  worker_->setTransportSettings(settings);
+  numPackets = 1;
+  reads = 0;
+  worker_->onNotifyDataAvailable(*socketPtr_);
+  eventbase_.loop();
+  EXPECT_EQ(1, reads);
+}
+
 TEST_F(QuicServerWorkerTest, QuicServerNewConnection) {
   EXPECT_CALL(*socketPtr_, address()).WillRepeatedly(ReturnRef(fakeAddress_));
   auto connId = getTestConnectionId(hostId_);
@@ -577,7 +825,7 @@ TEST_F(QuicServerWorkerTest, QuicServerNewConnection) {
       NetworkData(data->clone(), Clock::now()));
   eventbase_.loop();
 
-  EXPECT_CALL(*transportInfoCb_, onConnectionClose(_)).Times(2);
+  EXPECT_CALL(*transportInfoCb_, onConnectionClose(_, _)).Times(2);
   EXPECT_CALL(*transport_, setRoutingCallback(nullptr)).Times(2);
   worker_->onConnectionUnbound(
       transport_.get(),
@@ -632,6 +880,151 @@ TEST_F(QuicServerWorkerTest, QuicShedTest) {
   createQuicConnectionDuringShedding(kClientAddr, connId);
 }
 
+TEST_F(QuicServerWorkerTest, RetryOverNewConnectionRateLimit) {
+  TransportSettings settings;
+  settings.statelessResetTokenSecret = getRandSecret();
+  settings.retryNewConnectionRateLimit = 1;
+  worker_->setTransportSettings(settings);
+  worker_->start();
+  auto makeInitial = [](const ConnectionId& srcConnId,
+                        const ConnectionId& destConnId,
+                        const std::string& token) {
+    LongHeader header(
+        LongHeader::Types::Initial,
+        srcConnId,
+        destConnId,
+        1,
+        QuicVersion::MVFST,
+        token);
+    RegularQuicPacketBuilder builder(
+        kDefaultUDPSendPacketLen, std::move(header), 0);
+    auto packet = packetToBuf(std::move(builder).buildPacket());
+    packet->prependChain(createData(kMinInitialPacketSize));
+    return packet;
+  };
+  auto clientConnId = getTestConnectionId(0);
+
+  // The first connection is under the limit.
+  auto connId1 = getTestConnectionId(hostId_);
+  expectConnectionCreation(kClientAddr, connId1);
+  EXPECT_CALL(*transport_, onNetworkData(kClientAddr, _));
+  worker_->dispatchPacketData(
+      kClientAddr,
+      RoutingData(HeaderForm::Long, true, true, connId1, clientConnId),
+      NetworkData(makeInitial(clientConnId, connId1, ""), Clock::now()));
+  eventbase_.loop();
+
+  // The next one is asked to validate its address.
+  auto connId2 = getTestConnectionId(hostId_ + 1);
+  folly::Optional<RetryPacket> retry;
+  EXPECT_CALL(*factory_, _make(_, _, _, _)).Times(0);
+  EXPECT_CALL(*socketPtr_, write(kClientAddr, _))
+      .WillOnce(Invoke([&](const folly::SocketAddress&,
+                           const std::unique_ptr<folly::IOBuf>& buf) {
+        QuicReadCodec codec(QuicNodeType::Client);
+        AckStates ackStates;
+        auto packetQueue = bufToQueue(buf->clone());
+        auto res = codec.parsePacket(packetQueue, ackStates);
+        if (res.retryPacket()) {
+          retry.emplace(std::move(*res.retryPacket()));
+        }
+        return buf->computeChainDataLength();
+      }));
+  worker_->dispatchPacketData(
+      kClientAddr,
+      RoutingData(HeaderForm::Long, true, true, connId2, clientConnId),
+      NetworkData(makeInitial(clientConnId, connId2, ""), Clock::now()));
+  eventbase_.loop();
+  ASSERT_TRUE(retry.has_value());
+  EXPECT_EQ(retry->header.getDestinationConnId(), clientConnId);
+  auto retryConnId = retry->header.getSourceConnId();
+  EXPECT_EQ(
+      DefaultConnectionIdAlgo().parseConnectionId(retryConnId)->workerId, 42);
+  EXPECT_EQ(
+      worker_->getSrcToTransportMap().count(
+          std::make_pair(kClientAddr, connId2)),
+      0);
+
+  // A forged token is dropped instead of getting another Retry.
+  EXPECT_CALL(*socketPtr_, write(_, _)).Times(0);
+  EXPECT_CALL(
+      *transportInfoCb_,
+      onPacketDropped(PacketDropReason::INVALID_RETRY_TOKEN));
+  worker_->dispatchPacketData(
+      kClientAddr,
+      RoutingData(HeaderForm::Long, true, true, retryConnId, clientConnId),
+      NetworkData(
+          makeInitial(clientConnId, retryConnId, "forged token"),
+          Clock::now()));
+  eventbase_.loop();
+
+  // The Initial with the token from the Retry gets a connection.
+  expectConnectionCreation(kClientAddr, retryConnId);
+  EXPECT_CALL(*transport_, onNetworkData(kClientAddr, _));
+  worker_->dispatchPacketData(
+      kClientAddr,
+      RoutingData(HeaderForm::Long, true, true, retryConnId, clientConnId),
+      NetworkData(
+          makeInitial(clientConnId, retryConnId, retry->header.getToken()),
+          Clock::now()));
+  eventbase_.loop();
+  EXPECT_EQ(
+      worker_->getSrcToTransportMap().count(
+          std::make_pair(kClientAddr, retryConnId)),
+      1);
+}
+
+TEST_F(QuicServerWorkerTest, DropNewConnectionsWhileOverloaded) {
+  TransportSettings settings;
+  settings.overloadLoopBusyTime = std::chrono::microseconds(1000);
+  worker_->setTransportSettings(settings);
+  worker_->start();
+  auto observer = eventbase_.getObserver();
+  ASSERT_NE(observer, nullptr);
+  for (int i = 0; i < 50; ++i) {
+    observer->loopSample(100000, 0);
+  }
+  EXPECT_TRUE(worker_->isOverloaded());
+
+  auto clientConnId = getTestConnectionId(0);
+  auto connId = getTestConnectionId(hostId_);
+  auto makeInitial = [&]() {
+    LongHeader header(
+        LongHeader::Types::Initial,
+        clientConnId,
+        connId,
+        1,
+        QuicVersion::MVFST);
+    RegularQuicPacketBuilder builder(
+        kDefaultUDPSendPacketLen, std::move(header), 0);
+    auto packet = packetToBuf(std::move(builder).buildPacket());
+    packet->prependChain(createData(kMinInitialPacketSize));
+    return packet;
+  };
+  EXPECT_CALL(*factory_, _make(_, _, _, _)).Times(0);
+  EXPECT_CALL(
+      *transportInfoCb_, onPacketDropped(PacketDropReason::SERVER_OVERLOADED));
+  worker_->dispatchPacketData(
+      kClientAddr,
+      RoutingData(HeaderForm::Long, true, true, connId, clientConnId),
+      NetworkData(makeInitial(), Clock::now()));
+  eventbase_.loop();
+  Mock::VerifyAndClearExpectations(factory_.get());
+
+  // Once the loop catches up new connections are accepted again.
+  for (int i = 0; i < 100; ++i) {
+    observer->loopSample(0, 1000);
+  }
+  EXPECT_FALSE(worker_->isOverloaded());
+  expectConnectionCreation(kClientAddr, connId);
+  EXPECT_CALL(*transport_, onNetworkData(kClientAddr, _));
+  worker_->dispatchPacketData(
+      kClientAddr,
+      RoutingData(HeaderForm::Long, true, true, connId, clientConnId),
+      NetworkData(makeInitial(), Clock::now()));
+  eventbase_.loop();
+}
+
 TEST_F(QuicServerWorkerTest, ZeroLengthConnectionId) {
   auto data = createData(kDefaultUDPSendPacketLen);
   auto connId = ConnectionId(std::vector<uint8_t>());
@@ -805,7 +1198,7 @@ TEST_F(QuicServerWorkerTest, ShutdownQuicServer) {
   const auto& connIdMap = worker_->getConnectionIdMap();
   EXPECT_EQ(connIdMap.count(getTestConnectionId(hostId_)), 1);
 
-  EXPECT_CALL(*transportInfoCb_, onConnectionClose(_));
+  EXPECT_CALL(*transportInfoCb_, onConnectionClose(_, _));
   EXPECT_CALL(*transport_, setRoutingCallback(nullptr)).Times(2);
   EXPECT_CALL(*transport_, setTransportStatsCallback(nullptr)).Times(2);
   EXPECT_CALL(*transport_, close(_)).WillRepeatedly(Invoke([this](auto) {
@@ -844,7 +1237,7 @@ TEST_F(QuicServerWorkerTest, DestroyQuicServer) {
   const auto& connIdMap = worker_->getConnectionIdMap();
   EXPECT_EQ(connIdMap.count(getTestConnectionId(hostId_)), 1);
 
-  EXPECT_CALL(*transportInfoCb_, onConnectionClose(_));
+  EXPECT_CALL(*transportInfoCb_, onConnectionClose(_, _));
   EXPECT_CALL(*transport_, setRoutingCallback(nullptr)).Times(2);
   EXPECT_CALL(*transport_, setTransportStatsCallback(nullptr)).Times(2);
   EXPECT_CALL(*transport_, close(_)).WillRepeatedly(Invoke([this](auto) {
@@ -1113,6 +1506,173 @@ TEST_F(QuicServerWorkerTakeoverTest, QuicServerTakeoverForwarding) {
   testNoPacketForwarding(std::move(pkt), len, connId);
 }
 
+TEST_F(QuicServerWorkerTakeoverTest, QuicServerGROSplit) {
+  TransportSettings settings;
+  settings.shouldUseGROForRecv = true;
+  takeoverWorker_->setTransportSettings(settings);
+  ConnectionId connId = createConnIdForServer(ProcessId::ONE),
+               clientConnId = getTestConnectionId(clientHostId_);
+  takeoverWorker_->setProcessId(ProcessId::ONE);
+  StreamId id = 1;
+  auto buf = folly::IOBuf::copyBuffer("hello, world!");
+  auto packet = createInitialStream(clientConnId, connId, id, *buf, MVFST1);
+  packet->coalesce();
+  size_t packetLen = packet->length();
+
+  uint8_t* workerBuf = nullptr;
+  size_t workerBufLen = 0;
+  takeoverWorker_->getReadBuffer((void**)&workerBuf, &workerBufLen);
+  ASSERT_GE(workerBufLen, 2 * packetLen);
+  memcpy(workerBuf, packet->data(), packetLen);
+  memcpy(workerBuf + packetLen, packet->data(), packetLen);
+
+  EXPECT_CALL(*takeoverWorkerCb_, routeDataToWorkerLong(_, _, _, _))
+      .Times(2)
+      .WillRepeatedly(Invoke(
+          [&](const folly::SocketAddress& addr,
+              std::unique_ptr<RoutingData>& /* routingData */,
+              std::unique_ptr<NetworkData>& networkData,
+              bool isForwardedData) {
+            EXPECT_EQ(addr, clientAddr);
+            EXPECT_FALSE(isForwardedData);
+            EXPECT_EQ(packetLen, networkData->totalData);
+          }));
+  EXPECT_CALL(*transportInfoCb_, onRead(2 * packetLen));
+  EXPECT_CALL(*transportInfoCb_, onPacketReceived()).Times(2);
+  OnDataAvailableParams params;
+  params.gro_ = packetLen;
+  takeoverWorker_->onDataAvailable(clientAddr, 2 * packetLen, false, params);
+}
+
+TEST_F(QuicServerWorkerTakeoverTest, QuicServerRecvmmsg) {
+  TransportSettings settings;
+  settings.shouldRecvBatch = true;
+  settings.maxRecvBatchSize = 3;
+  takeoverWorker_->setTransportSettings(settings);
+  EXPECT_TRUE(takeoverWorker_->shouldOnlyNotify());
+  ConnectionId connId = createConnIdForServer(ProcessId::ONE),
+               clientConnId = getTestConnectionId(clientHostId_);
+  takeoverWorker_->setProcessId(ProcessId::ONE);
+  StreamId id = 1;
+  auto buf = folly::IOBuf::copyBuffer("hello, world!");
+  auto packet = createInitialStream(clientConnId, connId, id, *buf, MVFST1);
+  packet->coalesce();
+  size_t packetLen = packet->length();
+
+  folly::SocketAddress serverAddr("::1", 443);
+  NiceMock<folly::test::MockAsyncUDPSocket> sock(&evb_);
+  EXPECT_CALL(sock, address()).WillRepeatedly(ReturnRef(serverAddr));
+  std::vector<void*> readBufs;
+  EXPECT_CALL(sock, recvmmsg(_, 3, _, nullptr))
+      .WillOnce(Invoke([&](struct mmsghdr* msgs,
+                           unsigned int,
+                           unsigned int,
+                           struct timespec*) {
+        for (int i = 0; i < 2; ++i) {
+          auto& msg = msgs[i].msg_hdr;
+          memcpy(msg.msg_iov->iov_base, packet->data(), packetLen);
+          msgs[i].msg_len = packetLen;
+          clientAddr.getAddress(
+              reinterpret_cast<sockaddr_storage*>(msg.msg_name));
+          msg.msg_namelen = clientAddr.getActualSize();
+        }
+        readBufs.push_back(msgs[2].msg_hdr.msg_iov->iov_base);
+        return 2;
+      }))
+      .WillOnce(Invoke([&](struct mmsghdr* msgs,
+                           unsigned int,
+                           unsigned int,
+                           struct timespec*) {
+        readBufs.push_back(msgs[2].msg_hdr.msg_iov->iov_base);
+        errno = EAGAIN;
+        return -1;
+      }));
+  EXPECT_CALL(*takeoverWorkerCb_, routeDataToWorkerLong(_, _, _, _))
+      .Times(2)
+      .WillRepeatedly(Invoke(
+          [&](const folly::SocketAddress& addr,
+              std::unique_ptr<RoutingData>& /* routingData */,
+              std::unique_ptr<NetworkData>& networkData,
+              bool isForwardedData) {
+            EXPECT_EQ(addr, clientAddr);
+            EXPECT_FALSE(isForwardedData);
+            EXPECT_EQ(packetLen, networkData->totalData);
+          }));
+  EXPECT_CALL(*transportInfoCb_, onRead(packetLen)).Times(2);
+  EXPECT_CALL(*transportInfoCb_, onPacketReceived()).Times(2);
+  takeoverWorker_->onNotifyDataAvailable(sock);
+  takeoverWorker_->onNotifyDataAvailable(sock);
+  // The buffer that wasn't filled by the first read is reused by the second.
+  ASSERT_EQ(2, readBufs.size());
+  EXPECT_EQ(readBufs[0], readBufs[1]);
+}
+
+TEST_F(QuicServerWorkerTakeoverTest, QuicServerBatchShortHeaderPackets) {
+  TransportSettings settings;
+  settings.shouldUseGROForRecv = true;
+  takeoverWorker_->setTransportSettings(settings);
+  takeoverWorker_->setProcessId(ProcessId::ONE);
+  ConnectionId connId1 = createConnIdForServer(ProcessId::ONE);
+  ConnectionId connId2 = connId1;
+  connId2.data()[7] ^= 0x1;
+  auto clientConnId = getTestConnectionId(clientHostId_);
+  auto makePacket = [&](const ConnectionId& connId, PacketNum num) {
+    auto buf = folly::IOBuf::copyBuffer("wolverine");
+    auto packet = packetToBuf(
+        createStreamPacket(clientConnId, connId, num, 1, *buf, 0, 0));
+    packet->coalesce();
+    return packet;
+  };
+  // Segments are connId1, connId1, connId2, connId1. All but the last one
+  // must be the same size.
+  std::vector<Buf> packets;
+  packets.push_back(makePacket(connId1, 1));
+  packets.push_back(makePacket(connId1, 2));
+  packets.push_back(makePacket(connId2, 3));
+  packets.push_back(makePacket(connId1, 4));
+  size_t segmentSize = packets.front()->length();
+
+  uint8_t* workerBuf = nullptr;
+  size_t workerBufLen = 0;
+  takeoverWorker_->getReadBuffer((void**)&workerBuf, &workerBufLen);
+  size_t len = 0;
+  for (const auto& packet : packets) {
+    ASSERT_EQ(segmentSize, packet->length());
+    ASSERT_GE(workerBufLen, len + packet->length());
+    memcpy(workerBuf + len, packet->data(), packet->length());
+    len += packet->length();
+  }
+
+  std::vector<std::pair<ConnectionId, size_t>> routed;
+  EXPECT_CALL(*takeoverWorkerCb_, routeDataToWorkerShort(_, _, _, _))
+      .Times(3)
+      .WillRepeatedly(Invoke(
+          [&](const folly::SocketAddress& addr,
+              std::unique_ptr<RoutingData>& routingData,
+              std::unique_ptr<NetworkData>& networkData,
+              bool isForwardedData) {
+            EXPECT_EQ(addr, clientAddr);
+            EXPECT_FALSE(isForwardedData);
+            EXPECT_EQ(
+                networkData->packets.size() * segmentSize,
+                networkData->totalData);
+            routed.emplace_back(
+                routingData->destinationConnId, networkData->packets.size());
+          }));
+  EXPECT_CALL(*transportInfoCb_, onRead(len));
+  EXPECT_CALL(*transportInfoCb_, onPacketReceived()).Times(4);
+  OnDataAvailableParams params;
+  params.gro_ = segmentSize;
+  takeoverWorker_->onDataAvailable(clientAddr, len, false, params);
+  ASSERT_EQ(3, routed.size());
+  EXPECT_EQ(connId1, routed[0].first);
+  EXPECT_EQ(2, routed[0].second);
+  EXPECT_EQ(connId2, routed[1].first);
+  EXPECT_EQ(1, routed[1].second);
+  EXPECT_EQ(connId1, routed[2].first);
+  EXPECT_EQ(1, routed[2].second);
+}
+
 void QuicServerWorkerTakeoverTest::testPacketForwarding(
     Buf data,
     size_t len,
@@ -1493,6 +2053,33 @@ TEST_F(QuicServerTest, OtherEvbs) {
   runTest(evbs);
 }
 
+TEST_F(QuicServerTest, AddAndRemoveWorkers) {
+  initializeServer({});
+  auto numWorkers = server_->getNumWorkers();
+  EXPECT_EQ(2, server_->addWorkers(2));
+  EXPECT_EQ(numWorkers + 2, server_->getNumWorkers());
+  for (auto fd : server_->getAllListeningSocketFDs()) {
+    EXPECT_NE(-1, fd);
+  }
+
+  // Worker 0 stays.
+  EXPECT_EQ(numWorkers + 1, server_->removeWorkers(10, 0ms));
+  EXPECT_EQ(1, server_->getNumWorkers());
+  // Without connections they retire at their first check.
+  for (int i = 0; i < 100 && server_->getWorkerEvbs().size() > 1; ++i) {
+    std::this_thread::sleep_for(10ms);
+  }
+  EXPECT_EQ(1, server_->getWorkerEvbs().size());
+
+  // On the threads and ids of the retired ones.
+  EXPECT_EQ(1, server_->addWorkers(1));
+  EXPECT_EQ(2, server_->getNumWorkers());
+  auto fds = server_->getAllListeningSocketFDs();
+  ASSERT_EQ(numWorkers + 2, fds.size());
+  EXPECT_NE(-1, fds[1]);
+  EXPECT_EQ(-1, fds.back());
+}
+
 TEST_F(QuicServerTest, DontRouteDataAfterShutdown) {
   folly::ScopedEventBaseThread evbThread;
   std::vector<folly::EventBase*> evbs;
@@ -486,7 +486,8 @@ class QuicServerTransportTest : public Test {
     // have keys to write acks. This assumes that we will schedule crypto data
     // as soon as we can.
     EXPECT_FALSE(server->writeLooper()->isLoopCallbackScheduled());
-    EXPECT_FALSE(server->readLooper()->isLoopCallbackScheduled());
+    // Nor made yet, there are no streams to read.
+    EXPECT_EQ(nullptr, server->readLooper());
 
     expectWriteNewSessionTicket();
     // Once oneRtt keys are available, ServerTransport must call the
@@ -825,6 +826,9 @@ TEST_F(QuicServerTransportTest, IdleTimerNotResetOnDuplicatePacket) {
   server->idleTimeout().cancelTimeout();
   ASSERT_FALSE(server->idleTimeout().isScheduled());
   // Try delivering the same packet again
+  EXPECT_CALL(
+      *transportInfoCb_,
+      onPacketDropped(PacketDropReason::DUPLICATE_PACKET));
   deliverData(packet->clone(), false);
   ASSERT_FALSE(server->idleTimeout().isScheduled());
   EXPECT_CALL(*transportInfoCb_, onQuicStreamClosed());
@@ -886,6 +890,9 @@ TEST_F(QuicServerTransportTest, TimeoutsNotSetAfterClose) {
 }
 
 TEST_F(QuicServerTransportTest, IdleTimeoutExpired) {
+  // The idle timer was just refreshed, so expire it right away rather
+  // than rearming it for the rest of the idle period.
+  server->getNonConstConn().transportSettings.lazyIdleTimer = false;
   server->idleTimeout().timeoutExpired();
 
   EXPECT_FALSE(server->idleTimeout().isScheduled());
@@ -899,6 +906,9 @@ TEST_F(QuicServerTransportTest, IdleTimeoutExpired) {
 }
 
 TEST_F(QuicServerTransportTest, RecvDataAfterIdleTimeout) {
+  // The idle timer was just refreshed, so expire it right away rather
+  // than rearming it for the rest of the idle period.
+  server->getNonConstConn().transportSettings.lazyIdleTimer = false;
   server->idleTimeout().timeoutExpired();
 
   EXPECT_FALSE(server->idleTimeout().isScheduled());
@@ -1157,6 +1167,65 @@ TEST_F(QuicServerTransportTest, NoDataExceptCloseProcessedAfterClosing) {
   EXPECT_EQ(server->getConn().streamManager->streamCount(), 0);
 }
 
+TEST_F(QuicServerTransportTest, HandshakeTimings) {
+  auto timings = server->getTransportInfo().handshakeTimings;
+  ASSERT_TRUE(timings.firstInitialReceived.has_value());
+  ASSERT_TRUE(timings.firstInitialSent.has_value());
+  ASSERT_TRUE(timings.handshakeKeysDerived.has_value());
+  ASSERT_TRUE(timings.oneRttKeysAvailable.has_value());
+  ASSERT_TRUE(timings.handshakeDone.has_value());
+  EXPECT_LE(*timings.firstInitialReceived, *timings.handshakeKeysDerived);
+  EXPECT_LE(*timings.oneRttKeysAvailable, *timings.handshakeDone);
+  EXPECT_FALSE(timings.firstAppDataSent.has_value());
+  EXPECT_FALSE(timings.firstAppDataAcked.has_value());
+
+  StreamId streamId = server->createBidirectionalStream().value();
+  server->writeChain(streamId, IOBuf::copyBuffer("Aloha"), false, false);
+  loopForWrites();
+  timings = server->getTransportInfo().handshakeTimings;
+  ASSERT_TRUE(timings.firstAppDataSent.has_value());
+  EXPECT_GE(*timings.firstAppDataSent, *timings.handshakeDone);
+  EXPECT_FALSE(timings.firstAppDataAcked.has_value());
+}
+
+TEST_F(QuicServerTransportTest, WriteAcksDuringRead) {
+  server->getNonConstConn().transportSettings.readPacketsBeforeWrite = 1;
+  StreamId streamId = 4;
+  auto data = IOBuf::copyBuffer("hello");
+  auto makePacket = [&](PacketNum packetNum, uint64_t offset) {
+    return packetToBuf(createStreamPacket(
+        *clientConnectionId,
+        *server->getConn().serverConnectionId,
+        packetNum,
+        streamId,
+        *data,
+        0 /* cipherOverhead */,
+        0 /* largestAcked */,
+        folly::none /* longHeaderOverride */,
+        false,
+        folly::none,
+        offset));
+  };
+  // The second packet is out of order, which makes an ack due.
+  PacketNum packetNum = clientNextAppDataPacketNum;
+  clientNextAppDataPacketNum += 3;
+  NetworkData networkData;
+  networkData.receiveTimePoint = Clock::now();
+  networkData.packets.push_back(makePacket(packetNum + 1, data->length()));
+  networkData.packets.push_back(makePacket(packetNum, 0));
+  networkData.packets.push_back(makePacket(packetNum + 2, 2 * data->length()));
+  for (auto& packet : networkData.packets) {
+    networkData.totalData += packet->computeChainDataLength();
+  }
+  serverWrites.clear();
+  server->onNetworkData(clientAddr, std::move(networkData));
+  // Written before the loop gets to the write looper.
+  EXPECT_TRUE(verifyFramePresent(
+      serverWrites,
+      *makeClientEncryptedCodec(),
+      QuicFrame::Type::ReadAckFrame_E));
+}
+
 TEST_F(QuicServerTransportTest, TestOpenAckStreamFrame) {
   StreamId streamId = server->createBidirectionalStream().value();
 
@@ -2031,6 +2100,57 @@ TEST_F(QuicServerTransportTest, TestServerNotDetachable) {
   EXPECT_FALSE(server->isDetachable());
 }
 
+TEST_F(QuicServerTransportTest, MovesToConnectedSocket) {
+  NiceMock<MockQuicUDPSocketFactory> socketFactory;
+  server->setConnectedSocketFactory(&socketFactory);
+  auto& settings = server->getNonConstConn().transportSettings;
+  settings.serverConnectedSocketMinBytes =
+      server->getConn().lossState.totalBytesSent + 1000000;
+  EXPECT_CALL(socketFactory, _make(_, _)).Times(0);
+  auto data = IOBuf::copyBuffer("data");
+  recvEncryptedStream(4, *data);
+  EXPECT_FALSE(server->usesConnectedSocket());
+  Mock::VerifyAndClearExpectations(&socketFactory);
+
+  settings.serverConnectedSocketMinBytes = 1;
+  auto connectedSock = new NiceMock<folly::test::MockAsyncUDPSocket>(&evb);
+  folly::AsyncUDPSocket::ReadCallback* readCallback = nullptr;
+  EXPECT_CALL(socketFactory, _make(&evb, -1)).WillOnce(Return(connectedSock));
+  EXPECT_CALL(*connectedSock, bind(serverAddr));
+  EXPECT_CALL(*connectedSock, connect(clientAddr));
+  EXPECT_CALL(*connectedSock, resumeRead(_))
+      .WillOnce(SaveArg<0>(&readCallback));
+  std::vector<Buf> connectedWrites;
+  EXPECT_CALL(*connectedSock, write(_, _))
+      .WillRepeatedly(Invoke([&](const SocketAddress&,
+                                 const std::unique_ptr<folly::IOBuf>& buf) {
+        connectedWrites.push_back(buf->clone());
+        return buf->computeChainDataLength();
+      }));
+  recvEncryptedStream(4, *data, data->length());
+  EXPECT_TRUE(server->usesConnectedSocket());
+  EXPECT_FALSE(server->isDetachable());
+  ASSERT_NE(nullptr, readCallback);
+
+  // Writes now go out of the connected socket.
+  serverWrites.clear();
+  auto stream = server->createBidirectionalStream().value();
+  server->writeChain(stream, IOBuf::copyBuffer("hello"), true, false);
+  loopForWrites();
+  EXPECT_TRUE(serverWrites.empty());
+  EXPECT_FALSE(connectedWrites.empty());
+
+  // Until the socket fails, then it's back on the worker socket for good.
+  EXPECT_CALL(*connectedSock, close());
+  readCallback->onReadError(folly::AsyncSocketException(
+      folly::AsyncSocketException::INTERNAL_ERROR, "error"));
+  EXPECT_FALSE(server->usesConnectedSocket());
+  evb.loopOnce(EVLOOP_NONBLOCK);
+  EXPECT_CALL(socketFactory, _make(_, _)).Times(0);
+  recvEncryptedStream(4, *data, 2 * data->length());
+  EXPECT_FALSE(server->usesConnectedSocket());
+}
+
 TEST_F(QuicServerTransportTest, SetOriginalPeerAddressSetsPacketSize) {
   folly::SocketAddress v4Address("0.0.0.0", 0);
   ASSERT_TRUE(v4Address.getFamily() == AF_INET);
@@ -2618,6 +2738,62 @@ TEST_P(QuicServerTransportAllowMigrationTest, MigrateToValidatedPeer) {
   EXPECT_EQ(server->getConn().migrationState.lastCongestionAndRtt->mrtt, mrtt);
 }
 
+TEST_P(QuicServerTransportAllowMigrationTest, MigrateToEarlierValidatedPeer) {
+  folly::SocketAddress newPeer("100.101.102.103", 23456);
+  folly::SocketAddress otherPeer("200.101.102.103", 2345);
+  auto& migrationState = server->getNonConstConn().migrationState;
+  migrationState.previousPeerAddresses.push_back(newPeer);
+  migrationState.previousPeerAddresses.push_back(otherPeer);
+  CongestionAndRttState state;
+  state.peerAddress = newPeer;
+  state.recordTime = Clock::now();
+  state.congestionController = ccFactory_->makeCongestionController(
+      server->getNonConstConn(),
+      server->getNonConstConn().transportSettings.defaultCongestionController);
+  state.srtt = 1000us;
+  state.lrtt = 2000us;
+  state.rttvar = 3000us;
+  state.mrtt = 800us;
+  state.udpSendPacketLen = 1400;
+  auto earlierCongestionController = state.congestionController.get();
+  migrationState.earlierCongestionAndRtt.push_back(std::move(state));
+  CongestionAndRttState otherState;
+  otherState.peerAddress = otherPeer;
+  otherState.recordTime = Clock::now();
+  migrationState.lastCongestionAndRtt = std::move(otherState);
+
+  auto data = IOBuf::copyBuffer("bad data");
+  auto packetData = packetToBuf(createStreamPacket(
+      *clientConnectionId,
+      *server->getConn().serverConnectionId,
+      clientNextAppDataPacketNum++,
+      2,
+      *data,
+      0 /* cipherOverhead */,
+      0 /* largestAcked */));
+  auto srtt = server->getConn().lossState.srtt;
+  deliverData(std::move(packetData), false, &newPeer);
+
+  EXPECT_FALSE(server->getConn().pendingEvents.pathChallenge);
+  EXPECT_EQ(server->getConn().peerAddress, newPeer);
+  EXPECT_EQ(server->getConn().lossState.srtt, 1000us);
+  EXPECT_EQ(server->getConn().lossState.mrtt, 800us);
+  EXPECT_EQ(server->getConn().udpSendPacketLen, 1400);
+  EXPECT_EQ(
+      server->getConn().congestionController.get(),
+      earlierCongestionController);
+  ASSERT_TRUE(server->getConn().migrationState.lastCongestionAndRtt);
+  EXPECT_EQ(
+      server->getConn().migrationState.lastCongestionAndRtt->peerAddress,
+      clientAddr);
+  EXPECT_EQ(server->getConn().migrationState.lastCongestionAndRtt->srtt, srtt);
+  // The state of the other peer is still there for the next flip.
+  const auto& earlierStates =
+      server->getConn().migrationState.earlierCongestionAndRtt;
+  ASSERT_EQ(earlierStates.size(), 1);
+  EXPECT_EQ(earlierStates.front().peerAddress, otherPeer);
+}
+
 TEST_P(
     QuicServerTransportAllowMigrationTest,
     MigrateToUnvalidatedPeerOverwritesCachedRttState) {
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <folly/portability/Sockets.h>
+#include <folly/portability/Unistd.h>
+#include <quic/codec/DefaultConnectionIdAlgo.h>
+#include <quic/server/ReusePortSteering.h>
+
+#include <fcntl.h>
+#include <sched.h>
+
+using namespace quic;
+
+#ifdef __linux__
+namespace {
+constexpr size_t kNumSockets = 4;
+
+class ReusePortSteeringTest : public testing::Test {
+ public:
+  void SetUp() override {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (size_t i = 0; i < kNumSockets; ++i) {
+      int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+      ASSERT_GE(fd, 0);
+      sockets_.push_back(fd);
+      int one = 1;
+      ASSERT_EQ(
+          0, ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)));
+      ASSERT_EQ(0, ::bind(fd, (sockaddr*)&addr, sizeof(addr)));
+      ::fcntl(fd, F_SETFL, O_NONBLOCK);
+      if (i == 0) {
+        socklen_t len = sizeof(addr);
+        ASSERT_EQ(0, ::getsockname(fd, (sockaddr*)&addr, &len));
+      }
+    }
+    addr_ = addr;
+    client_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(client_, 0);
+  }
+
+  void TearDown() override {
+    for (auto fd : sockets_) {
+      ::close(fd);
+    }
+    ::close(client_);
+  }
+
+  // Returns the index of the socket that got the packet.
+  folly::Optional<size_t> sendAndReceive(const std::vector<uint8_t>& packet) {
+    ::sendto(
+        client_,
+        packet.data(),
+        packet.size(),
+        0,
+        (sockaddr*)&addr_,
+        sizeof(addr_));
+    for (int attempt = 0; attempt < 100; ++attempt) {
+      for (size_t i = 0; i < sockets_.size(); ++i) {
+        uint8_t buf[64];
+        if (::recv(sockets_[i], buf, sizeof(buf), 0) > 0) {
+          return i;
+        }
+      }
+      ::usleep(1000);
+    }
+    return folly::none;
+  }
+
+  std::vector<uint8_t> shortHeaderPacket(uint8_t workerId) {
+    ServerConnectionIdParams params(0, 0, workerId);
+    auto connId = *DefaultConnectionIdAlgo().encodeConnectionId(params);
+    std::vector<uint8_t> packet{0x40};
+    packet.insert(packet.end(), connId.data(), connId.data() + connId.size());
+    packet.resize(packet.size() + 20);
+    return packet;
+  }
+
+ protected:
+  std::vector<int> sockets_;
+  int client_{-1};
+  sockaddr_in addr_{};
+};
+} // namespace
+
+TEST_F(ReusePortSteeringTest, SteersShortHeaderByWorkerId) {
+  ASSERT_FALSE(attachWorkerIdSteeringProgram(sockets_[0]).hasError());
+  for (uint8_t workerId = 0; workerId < kNumSockets; ++workerId) {
+    auto index = sendAndReceive(shortHeaderPacket(workerId));
+    ASSERT_TRUE(index.has_value());
+    EXPECT_EQ(workerId, *index);
+  }
+}
+
+TEST_F(ReusePortSteeringTest, HashesWhatItCannotSteer) {
+  ASSERT_FALSE(attachWorkerIdSteeringProgram(sockets_[0]).hasError());
+  // A worker id past the end of the group, a long header and a runt packet
+  // all still reach some socket.
+  EXPECT_TRUE(sendAndReceive(shortHeaderPacket(kNumSockets + 1)).has_value());
+  auto longHeader = shortHeaderPacket(1);
+  longHeader[0] = 0xc0;
+  EXPECT_TRUE(sendAndReceive(longHeader).has_value());
+  EXPECT_TRUE(sendAndReceive({0x40, 0x40}).has_value());
+}
+
+TEST_F(ReusePortSteeringTest, SteersLongHeaderByCpu) {
+  ASSERT_FALSE(attachWorkerIdSteeringProgram(sockets_[0], true).hasError());
+  // Loopback packets are received on the CPU that sent them.
+  cpu_set_t original;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(original), &original));
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(1, &cpus);
+  if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+    // Needs a second cpu.
+    return;
+  }
+  auto longHeader = shortHeaderPacket(3);
+  longHeader[0] = 0xc0;
+  auto index = sendAndReceive(longHeader);
+  sched_setaffinity(0, sizeof(original), &original);
+  ASSERT_TRUE(index.has_value());
+  EXPECT_EQ(1, *index);
+  // Short headers still go by worker id.
+  index = sendAndReceive(shortHeaderPacket(3));
+  ASSERT_TRUE(index.has_value());
+  EXPECT_EQ(3, *index);
+}
+
+TEST_F(ReusePortSteeringTest, SetIncomingCpu) {
+  ASSERT_FALSE(setIncomingCpu(sockets_[2], 2).hasError());
+  int cpu = -1;
+  socklen_t len = sizeof(cpu);
+  ASSERT_EQ(
+      0, ::getsockopt(sockets_[2], SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len));
+  EXPECT_EQ(2, cpu);
+}
+#endif
@@ -158,5 +158,73 @@ TEST(ServerStateMachineTest, TestCidRejectedGiveUp) {
   EXPECT_EQ(rejectCounter, 16);
 }
 
+TEST(ServerStateMachineTest, TestAddConnIdFromPool) {
+  QuicServerConnectionState serverConn;
+  MockServerConnectionIdRejector mockRejector;
+  ServerConnectionIdParams serverCidParams(10, 11, 12);
+  MockConnectionIdAlgo mockCidAlgo;
+  StatelessResetSecret secret{};
+  folly::SocketAddress serverAddr("0.0.0.0", 770);
+
+  serverConn.connIdAlgo = &mockCidAlgo;
+  serverConn.connIdRejector = &mockRejector;
+  serverConn.serverConnIdParams = serverCidParams;
+  serverConn.transportSettings.statelessResetTokenSecret = secret;
+  serverConn.serverAddr = serverAddr;
+
+  ServerConnectionIdPool pool(
+      nullptr,
+      2,
+      mockCidAlgo,
+      serverCidParams,
+      secret,
+      serverAddr,
+      &mockRejector);
+  EXPECT_CALL(mockCidAlgo, encodeConnectionId(serverCidParams))
+      .WillOnce(Return(getTestConnectionId(0)))
+      .WillOnce(Return(getTestConnectionId(1)));
+  // The first pooled id is taken by another connection once it's pooled.
+  EXPECT_CALL(mockRejector, rejectConnectionIdNonConst(_))
+      .WillOnce(Return(false))
+      .WillOnce(Return(false))
+      .WillOnce(Return(true))
+      .WillOnce(Return(false));
+  pool.fill();
+  EXPECT_EQ(pool.size(), 2);
+  serverConn.connIdPool = &pool;
+
+  auto connIdData = serverConn.createAndAddNewSelfConnId();
+  ASSERT_TRUE(connIdData.has_value());
+  EXPECT_EQ(connIdData->connId, getTestConnectionId(1));
+  EXPECT_EQ(connIdData->sequenceNumber, 0);
+  StatelessResetGenerator generator(secret, serverAddr.getFullyQualified());
+  EXPECT_EQ(*connIdData->token, generator.generateToken(connIdData->connId));
+  EXPECT_EQ(pool.size(), 0);
+
+  // Once the pool is empty the id is encoded on the spot.
+  EXPECT_CALL(mockCidAlgo, encodeConnectionId(serverCidParams))
+      .WillOnce(Return(getTestConnectionId(2)));
+  EXPECT_CALL(mockRejector, rejectConnectionIdNonConst(_))
+      .WillOnce(Return(false));
+  connIdData = serverConn.createAndAddNewSelfConnId();
+  ASSERT_TRUE(connIdData.has_value());
+  EXPECT_EQ(connIdData->connId, getTestConnectionId(2));
+  EXPECT_EQ(connIdData->sequenceNumber, 1);
+
+  // Nor is a pool for another address used.
+  EXPECT_CALL(mockCidAlgo, encodeConnectionId(serverCidParams))
+      .WillOnce(Return(getTestConnectionId(3)))
+      .WillOnce(Return(getTestConnectionId(4)))
+      .WillOnce(Return(getTestConnectionId(5)));
+  EXPECT_CALL(mockRejector, rejectConnectionIdNonConst(_))
+      .WillRepeatedly(Return(false));
+  pool.fill();
+  serverConn.serverAddr = folly::SocketAddress("0.0.0.0", 771);
+  connIdData = serverConn.createAndAddNewSelfConnId();
+  ASSERT_TRUE(connIdData.has_value());
+  EXPECT_EQ(connIdData->connId, getTestConnectionId(5));
+  EXPECT_EQ(pool.size(), 2);
+}
+
 } // namespace test
 } // namespace quic
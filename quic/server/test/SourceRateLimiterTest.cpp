@@ -0,0 +1,68 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#include <gtest/gtest.h>
+
+#include <quic/server/SourceRateLimiter.h>
+
+using namespace std::chrono_literals;
+using namespace quic;
+
+TEST(SourceRateLimiterTest, LimitsEachSource) {
+  SourceRateLimiter limiter(2, 1s, 32, 64);
+  folly::IPAddress client("1.2.3.4");
+  folly::IPAddress other("1.2.3.5");
+  auto now = Clock::now();
+  EXPECT_FALSE(limiter.check(client, now));
+  EXPECT_FALSE(limiter.check(client, now));
+  EXPECT_TRUE(limiter.check(client, now));
+  EXPECT_FALSE(limiter.check(other, now));
+  EXPECT_FALSE(limiter.check(other, now));
+  EXPECT_TRUE(limiter.check(other, now));
+}
+
+TEST(SourceRateLimiterTest, LimitsNetwork) {
+  SourceRateLimiter limiter(2, 1s, 24, 48);
+  auto now = Clock::now();
+  EXPECT_FALSE(limiter.check(folly::IPAddress("1.2.3.4"), now));
+  EXPECT_FALSE(limiter.check(folly::IPAddress("1.2.3.5"), now));
+  EXPECT_TRUE(limiter.check(folly::IPAddress("1.2.3.6"), now));
+  // IPv4-mapped addresses are the same network.
+  EXPECT_TRUE(limiter.check(folly::IPAddress("::ffff:1.2.3.7"), now));
+  EXPECT_FALSE(limiter.check(folly::IPAddress("1.2.4.1"), now));
+
+  EXPECT_FALSE(limiter.check(folly::IPAddress("2001:db8::1"), now));
+  EXPECT_FALSE(limiter.check(folly::IPAddress("2001:db8:0:1::1"), now));
+  EXPECT_TRUE(limiter.check(folly::IPAddress("2001:db8:0:2::1"), now));
+}
+
+TEST(SourceRateLimiterTest, SlidingWindow) {
+  SourceRateLimiter limiter(4, 1s, 32, 64);
+  folly::IPAddress client("1.2.3.4");
+  auto now = Clock::now();
+  for (int i = 0; i < 4; i++) {
+    EXPECT_FALSE(limiter.check(client, now));
+  }
+  EXPECT_TRUE(limiter.check(client, now));
+  // Half of the previous window still counts.
+  now += 1500ms;
+  EXPECT_FALSE(limiter.check(client, now));
+  EXPECT_FALSE(limiter.check(client, now));
+  EXPECT_TRUE(limiter.check(client, now));
+  // Nothing is left after two windows.
+  now += 3s;
+  for (int i = 0; i < 4; i++) {
+    EXPECT_FALSE(limiter.check(client, now));
+  }
+  EXPECT_TRUE(limiter.check(client, now));
+}
+
+TEST(SourceRateLimiterTest, SharedCounters) {
+  // With a single counter every source is counted together, the sketch only
+  // ever overcounts.
+  SourceRateLimiter limiter(3, 1s, 32, 64, 1, 1);
+  auto now = Clock::now();
+  EXPECT_FALSE(limiter.check(folly::IPAddress("10.0.0.1"), now));
+  EXPECT_FALSE(limiter.check(folly::IPAddress("10.0.1.1"), now));
+  EXPECT_FALSE(limiter.check(folly::IPAddress("2001:db8::1"), now));
+  EXPECT_TRUE(limiter.check(folly::IPAddress("1.2.3.4"), now));
+}
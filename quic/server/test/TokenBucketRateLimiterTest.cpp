@@ -0,0 +1,40 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#include <gtest/gtest.h>
+
+#include <quic/server/TokenBucketRateLimiter.h>
+
+using namespace std::chrono_literals;
+using namespace quic;
+
+TEST(TokenBucketRateLimiterTest, AllowsBurst) {
+  TokenBucketRateLimiter limiter(1, 5);
+  auto now = Clock::now();
+  for (int i = 0; i < 5; i++) {
+    EXPECT_FALSE(limiter.check(now));
+  }
+  EXPECT_TRUE(limiter.check(now));
+}
+
+TEST(TokenBucketRateLimiterTest, Refills) {
+  TokenBucketRateLimiter limiter(10, 2);
+  auto now = Clock::now();
+  EXPECT_FALSE(limiter.check(now));
+  EXPECT_FALSE(limiter.check(now));
+  EXPECT_TRUE(limiter.check(now));
+  EXPECT_TRUE(limiter.check(now + 50ms));
+  EXPECT_FALSE(limiter.check(now + 100ms));
+  // Never past the burst.
+  now += 10s;
+  EXPECT_FALSE(limiter.check(now));
+  EXPECT_FALSE(limiter.check(now));
+  EXPECT_TRUE(limiter.check(now));
+}
+
+TEST(TokenBucketRateLimiterTest, OldTimeDoesNotRefill) {
+  TokenBucketRateLimiter limiter(10, 1);
+  auto now = Clock::now();
+  EXPECT_FALSE(limiter.check(now));
+  EXPECT_TRUE(limiter.check(now - 1s));
+  EXPECT_TRUE(limiter.check(now));
+}
@@ -9,9 +9,11 @@
 #include <quic/state/AckHandlers.h>
 
 #include <folly/Overload.h>
+#include <quic/congestion_control/DeliveryRateSampler.h>
 #include <quic/logging/QuicLogger.h>
 #include <quic/loss/QuicLossFunctions.h>
 #include <quic/state/QuicStateFunctions.h>
+#include <quic/state/QuicTracepoints.h>
 #include <iterator>
 
 namespace quic {
@@ -30,6 +32,10 @@ namespace quic {
  * always restrained to a single space. So we also need to skip packets that are
  * not in the current packet number space.
  *
+ * Acked packets are not erased as they are found: doing so would shift the
+ * tail of the list once per ack block. Instead the acked ranges are recorded,
+ * and the list is compacted in a single pass once all the blocks are
+ * processed.
  */
 
 void processAckFrame(
@@ -45,13 +51,25 @@ void processAckFrame(
   // Using kDefaultRxPacketsBeforeAckAfterInit to reseve for ackedPackets
   // container is a hueristic. Other quic implementations may have very
   // different acking policy. It's also possibly that all acked packets are pure
-  // acks which leads to different number of packets being acked usually.
-  ack.ackedPackets.reserve(kDefaultRxPacketsBeforeAckAfterInit);
+  // acks which leads to different number of packets being acked usually. A
+  // large cumulative ack, e.g. after recovery, reserves for what its blocks
+  // can cover instead of growing the container many times.
+  uint64_t ackBlocksLength = 0;
+  for (const auto& ackBlock : frame.ackBlocks) {
+    ackBlocksLength += ackBlock.endPacket - ackBlock.startPacket + 1;
+  }
+  ack.ackedPackets.reserve(std::max<uint64_t>(
+      kDefaultRxPacketsBeforeAckAfterInit,
+      std::min<uint64_t>(ackBlocksLength, conn.outstandingPackets.size())));
   auto currentPacketIt = getLastOutstandingPacket(conn, pnSpace);
   uint64_t handshakePacketAcked = 0;
   uint64_t clonedPacketsAcked = 0;
   folly::Optional<decltype(conn.lossState.lastAckedPacketSentTime)>
       lastAckedPacketSentTime;
+  // Forward [begin, end) ranges of acked packets, in descending order.
+  using OutstandingPacketIt = decltype(conn.outstandingPackets)::iterator;
+  SmallVec<std::pair<OutstandingPacketIt, OutstandingPacketIt>, 8>
+      ackedRanges;
   auto ackBlockIt = frame.ackBlocks.cbegin();
   while (ackBlockIt != frame.ackBlocks.cend() &&
          currentPacketIt != conn.outstandingPackets.rend()) {
@@ -88,17 +106,13 @@ void processAckFrame(
         // When the next packet is not in the same packet number space, we need
         // to skip it in current ack processing. If the iterator has moved, that
         // means we have found packets in the current space that are acked by
-        // this ack block. So the code erases the current iterator range and
-        // move the iterator to be the next search point.
+        // this ack block. So the code records the current iterator range and
+        // moves the iterator past the skipped packet.
         if (rPacketIt != eraseEnd) {
-          auto nextElem =
-              conn.outstandingPackets.erase(rPacketIt.base(), eraseEnd.base());
-          rPacketIt = std::reverse_iterator<decltype(nextElem)>(nextElem) + 1;
-          eraseEnd = rPacketIt;
-        } else {
-          rPacketIt++;
-          eraseEnd = rPacketIt;
+          ackedRanges.emplace_back(rPacketIt.base(), eraseEnd.base());
         }
+        rPacketIt++;
+        eraseEnd = rPacketIt;
         continue;
       }
       if (currentPacketNum < ackBlockIt->startPacket) {
@@ -111,6 +125,9 @@ void processAckFrame(
         ++handshakePacketAcked;
       }
       ack.ackedBytes += rPacketIt->encodedSize;
+      if (conn.pathMtuState.phase != PathMtuState::Phase::Disabled) {
+        onPathMtuPacketAcked(conn, *rPacketIt, ackReceiveTime);
+      }
       if (rPacketIt->associatedEvent) {
         ++clonedPacketsAcked;
       }
@@ -144,13 +161,9 @@ void processAckFrame(
         ack.mrttSample =
             std::min(ack.mrttSample.value_or(rttSample), rttSample);
       }
-      conn.lossState.totalBytesAcked += rPacketIt->encodedSize;
-      conn.lossState.totalBytesSentAtLastAck = conn.lossState.totalBytesSent;
-      conn.lossState.totalBytesAckedAtLastAck = conn.lossState.totalBytesAcked;
       if (!lastAckedPacketSentTime) {
         lastAckedPacketSentTime = rPacketIt->time;
       }
-      conn.lossState.lastAckedTime = ackReceiveTime;
       ack.ackedPackets.push_back(
           CongestionController::AckEvent::AckPacket::Builder()
               .setSentTime(rPacketIt->time)
@@ -161,22 +174,41 @@ void processAckFrame(
               .build());
       rPacketIt++;
     }
-    // Done searching for acked outstanding packets in current ack block. Erase
+    // Done searching for acked outstanding packets in current ack block. Record
     // the current iterator range which is the last batch of continuous
     // outstanding packets that are in this ack block. Move the iterator to be
     // the next search point.
     if (rPacketIt != eraseEnd) {
-      auto nextElem =
-          conn.outstandingPackets.erase(rPacketIt.base(), eraseEnd.base());
-      currentPacketIt = std::reverse_iterator<decltype(nextElem)>(nextElem);
-    } else {
-      currentPacketIt = rPacketIt;
+      ackedRanges.emplace_back(rPacketIt.base(), eraseEnd.base());
     }
+    currentPacketIt = rPacketIt;
     ackBlockIt++;
   }
+  // Compact the list: the packets between two acked ranges are moved down over
+  // the acked ones, starting from the lowest range, then the tail is erased.
+  if (!ackedRanges.empty()) {
+    auto writeIt = ackedRanges.back().first;
+    for (auto rangeIt = ackedRanges.rbegin(); rangeIt != ackedRanges.rend();
+         ++rangeIt) {
+      auto keepEnd = rangeIt + 1 == ackedRanges.rend()
+          ? conn.outstandingPackets.end()
+          : (rangeIt + 1)->first;
+      writeIt = std::move(rangeIt->second, keepEnd, writeIt);
+    }
+    conn.outstandingPackets.erase(writeIt, conn.outstandingPackets.end());
+  }
   if (lastAckedPacketSentTime) {
+    // The byte counters are updated once for the whole ack rather than for
+    // every acked packet.
+    conn.lossState.totalBytesAcked += ack.ackedBytes;
+    conn.lossState.totalBytesSentAtLastAck = conn.lossState.totalBytesSent;
+    conn.lossState.totalBytesAckedAtLastAck = conn.lossState.totalBytesAcked;
+    conn.lossState.lastAckedTime = ackReceiveTime;
     conn.lossState.lastAckedPacketSentTime = *lastAckedPacketSentTime;
   }
+  // Sampled once here, after totalBytesAcked has counted the whole ack, for
+  // every congestion controller to use.
+  ack.rateSample = sampleDeliveryRate(conn, ack);
   DCHECK_GE(conn.outstandingHandshakePacketsCount, handshakePacketAcked);
   conn.outstandingHandshakePacketsCount -= handshakePacketAcked;
   DCHECK_GE(conn.outstandingClonedPacketsCount, clonedPacketsAcked);
@@ -185,6 +217,29 @@ void processAckFrame(
   DCHECK_GE(
       updatedOustandingPacketsCount, conn.outstandingHandshakePacketsCount);
   DCHECK_GE(updatedOustandingPacketsCount, conn.outstandingClonedPacketsCount);
+  // ECN counts are cumulative, only their increase is news. A reordered ACK
+  // may carry smaller counts, which are ignored.
+  uint64_t newCeMarkedPackets = 0;
+  if (frame.ecnCounts) {
+    auto& peerEcnCounts = getAckState(conn, pnSpace).peerEcnCounts;
+    if (frame.ecnCounts->ce > peerEcnCounts.ce) {
+      newCeMarkedPackets = frame.ecnCounts->ce - peerEcnCounts.ce;
+    }
+    peerEcnCounts.ect0 = std::max(peerEcnCounts.ect0, frame.ecnCounts->ect0);
+    peerEcnCounts.ect1 = std::max(peerEcnCounts.ect1, frame.ecnCounts->ect1);
+    peerEcnCounts.ce = std::max(peerEcnCounts.ce, frame.ecnCounts->ce);
+  }
+  QUIC_TRACEPOINT(
+      ack_processed,
+      conn,
+      static_cast<uint8_t>(pnSpace),
+      frame.largestAcked,
+      ack.ackedPackets.size(),
+      ack.ackedBytes);
+  // Before loss detection, so that it runs with the widened reordering window.
+  if (!conn.lossState.recentlyLostPackets.empty()) {
+    detectSpuriousLoss(conn, pnSpace, frame, ackReceiveTime);
+  }
   auto lossEvent = handleAckForLoss(conn, lossVisitor, ack, pnSpace);
   if (conn.congestionController &&
       (ack.largestAckedPacket.has_value() || lossEvent)) {
@@ -195,8 +250,14 @@ void processAckFrame(
           *lossEvent->smallestLostSentTime,
           *lossEvent->largestLostSentTime);
     }
+    auto largestAckedSentTime = ack.largestAckedPacketSentTime;
+    bool hasLargestAcked = ack.largestAckedPacket.has_value();
     conn.congestionController->onPacketAckOrLoss(
         std::move(ack), std::move(lossEvent));
+    if (newCeMarkedPackets > 0 && hasLargestAcked) {
+      conn.congestionController->onPacketsCeMarked(
+          newCeMarkedPackets, largestAckedSentTime);
+    }
   }
 }
 
@@ -11,8 +11,61 @@
 #include <quic/codec/Types.h>
 #include <quic/common/IntervalSet.h>
 
+#include <bitset>
+
 namespace quic {
 
+// Number of packet numbers up to the largest received one that
+// ReceivedPacketWindow remembers.
+constexpr size_t kReceivedPacketWindowSize = 4096;
+
+/**
+ * Which of the last kReceivedPacketWindowSize packet numbers up to the largest
+ * one were received, in a bitmap indexed by the packet number modulo the
+ * window size. Unlike the ack blocks this isn't trimmed as acks are sent, so
+ * it always answers for the whole window.
+ */
+class ReceivedPacketWindow {
+ public:
+  /**
+   * Whether packetNum is at most kReceivedPacketWindowSize - 1 below the
+   * largest packet number, so that contains() knows about it.
+   */
+  bool inWindow(PacketNum packetNum) const {
+    return largest_ && packetNum <= *largest_ &&
+        packetNum + kReceivedPacketWindowSize > *largest_;
+  }
+
+  bool contains(PacketNum packetNum) const {
+    return inWindow(packetNum) &&
+        bits_.test(packetNum % kReceivedPacketWindowSize);
+  }
+
+  /**
+   * Slides the window forward if packetNum is the largest so far. Packets that
+   * fall below the window are forgotten.
+   */
+  void insert(PacketNum packetNum) {
+    if (!largest_ || packetNum >= *largest_ + kReceivedPacketWindowSize) {
+      bits_.reset();
+      largest_ = packetNum;
+    } else if (packetNum > *largest_) {
+      // Whatever was there is from a whole window ago.
+      for (PacketNum num = *largest_ + 1; num < packetNum; ++num) {
+        bits_.reset(num % kReceivedPacketWindowSize);
+      }
+      largest_ = packetNum;
+    } else if (!inWindow(packetNum)) {
+      return;
+    }
+    bits_.set(packetNum % kReceivedPacketWindowSize);
+  }
+
+ private:
+  std::bitset<kReceivedPacketWindowSize> bits_;
+  folly::Optional<PacketNum> largest_;
+};
+
 // Ack and PacketNumber states. This is per-packet number space.
 struct AckState {
   AckBlocks acks;
@@ -39,6 +92,17 @@ struct AckState {
   folly::Optional<PacketNum> largestReceivedAtLastCloseSent;
   // Next PacketNum we will send for packet in this packet number space
   PacketNum nextPacketNum{0};
+  // Encoding of acks from the last ACK frame written, reused while acks
+  // doesn't change.
+  mutable AckBlocksEncoding acksEncoding;
+  // ECN codepoints of the packets received in this space, echoed back to the
+  // peer in ACK_ECN frames.
+  EcnCounts ecnCounts;
+  // Largest ECN counts the peer reported for our packets in this space.
+  EcnCounts peerEcnCounts;
+  // Received packet numbers near the largest one, for finding duplicates
+  // without searching acks.
+  ReceivedPacketWindow receivedPackets;
 };
 
 struct AckStates {
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Optional.h>
+#include <folly/SocketAddress.h>
+#include <folly/chrono/Hardware.h>
+#include <quic/codec/QuicConnectionId.h>
+
+#include <array>
+#include <cstdint>
+
+namespace quic {
+
+enum class CpuTimeCategory : uint8_t {
+  // Processing received packets, other than decoding them.
+  READ,
+  // Building packets and writing them to the socket, other than encryption.
+  WRITE,
+  // Decrypting and decoding received packets, encrypting sent ones, and the
+  // TLS handshake.
+  CRYPTO,
+  // Calls into the application's callbacks.
+  CALLBACKS,
+  // NOTE: MAX should always be at the end
+  MAX
+};
+
+inline const char* toString(CpuTimeCategory category) {
+  switch (category) {
+    case CpuTimeCategory::READ:
+      return "READ";
+    case CpuTimeCategory::WRITE:
+      return "WRITE";
+    case CpuTimeCategory::CRYPTO:
+      return "CRYPTO";
+    case CpuTimeCategory::CALLBACKS:
+      return "CALLBACKS";
+    case CpuTimeCategory::MAX:
+      return "MAX";
+  }
+  return "UNKNOWN";
+}
+
+/**
+ * The time a connection spent on the event loop, in units of
+ * folly::hardware_timestamp() (TSC ticks on x86). Only kept when
+ * TransportSettings::trackCpuTime is set.
+ */
+struct ConnectionCpuTime {
+  std::array<uint64_t, static_cast<size_t>(CpuTimeCategory::MAX)> ticks{};
+  // The category being timed and when it was last charged, MAX if none.
+  CpuTimeCategory current{CpuTimeCategory::MAX};
+  uint64_t lastTimestamp{0};
+
+  uint64_t get(CpuTimeCategory category) const {
+    return ticks[static_cast<size_t>(category)];
+  }
+
+  uint64_t total() const {
+    uint64_t sum = 0;
+    for (auto t : ticks) {
+      sum += t;
+    }
+    return sum;
+  }
+
+  void merge(const ConnectionCpuTime& other) {
+    for (size_t i = 0; i < ticks.size(); ++i) {
+      ticks[i] += other.ticks[i];
+    }
+  }
+
+  /**
+   * Charges the time since the last switch to the current category and starts
+   * timing category. Returns the category that was being timed.
+   */
+  CpuTimeCategory switchTo(CpuTimeCategory category) {
+    auto now = folly::hardware_timestamp();
+    if (current != CpuTimeCategory::MAX) {
+      ticks[static_cast<size_t>(current)] += now - lastTimestamp;
+    }
+    lastTimestamp = now;
+    auto previous = current;
+    current = category;
+    return previous;
+  }
+};
+
+/**
+ * Charges the time it is alive to category. A scope inside another one pauses
+ * the outer one, so time is only charged once, to the innermost category.
+ */
+class CpuTimeScope {
+ public:
+  CpuTimeScope(
+      ConnectionCpuTime& cpuTime,
+      bool enabled,
+      CpuTimeCategory category)
+      : cpuTime_(enabled ? &cpuTime : nullptr) {
+    if (cpuTime_) {
+      previous_ = cpuTime_->switchTo(category);
+    }
+  }
+
+  ~CpuTimeScope() {
+    if (cpuTime_) {
+      cpuTime_->switchTo(previous_);
+    }
+  }
+
+  CpuTimeScope(const CpuTimeScope&) = delete;
+  CpuTimeScope& operator=(const CpuTimeScope&) = delete;
+
+ private:
+  ConnectionCpuTime* cpuTime_;
+  CpuTimeCategory previous_{CpuTimeCategory::MAX};
+};
+
+/**
+ * One connection's time, as returned when looking for the most expensive
+ * connections of a server.
+ */
+struct ConnectionCpuTimeSample {
+  folly::Optional<ConnectionId> serverConnectionId;
+  folly::SocketAddress peerAddress;
+  ConnectionCpuTime cpuTime;
+};
+} // namespace quic
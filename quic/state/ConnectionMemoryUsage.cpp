@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/state/ConnectionMemoryUsage.h>
+
+#include <quic/logging/QLogger.h>
+#include <quic/state/StateData.h>
+
+namespace quic {
+
+namespace {
+// Frames of a written packet that fit in the packet itself.
+constexpr size_t kInlineWriteFrames = 4;
+
+uint64_t bufferBytes(const folly::IOBuf* buf) {
+  if (!buf) {
+    return 0;
+  }
+  uint64_t bytes = 0;
+  auto current = buf;
+  do {
+    bytes += current->capacity();
+    current = current->next();
+  } while (current != buf);
+  return bytes;
+}
+
+uint64_t bufferBytes(const std::deque<StreamBuffer>& buffers) {
+  uint64_t bytes = buffers.size() * sizeof(StreamBuffer);
+  for (const auto& buffer : buffers) {
+    bytes += bufferBytes(buffer.data.front());
+  }
+  return bytes;
+}
+
+void addStream(
+    ConnectionMemoryUsage& usage,
+    MemoryCategory category,
+    const QuicStreamLike& stream) {
+  usage.add(
+      category,
+      bufferBytes(stream.readBuffer) + bufferBytes(stream.writeBuffer.front()));
+  auto retransmissionCategory = category == MemoryCategory::CRYPTO
+      ? MemoryCategory::CRYPTO
+      : MemoryCategory::RETRANSMISSION_BUFFERS;
+  uint64_t retransmissionBytes = bufferBytes(stream.lossBuffer);
+  for (const auto& entry : stream.retransmissionBuffer) {
+    retransmissionBytes += sizeof(entry) + sizeof(StreamBuffer) +
+        bufferBytes(entry.second->data.front());
+  }
+  usage.add(retransmissionCategory, retransmissionBytes);
+}
+} // namespace
+
+ConnectionMemoryUsage getConnectionMemoryUsage(
+    const QuicConnectionStateBase& conn) {
+  ConnectionMemoryUsage usage;
+  if (conn.streamManager) {
+    conn.streamManager->streamStateForEach([&](const QuicStreamState& stream) {
+      usage.add(MemoryCategory::STREAM_BUFFERS, sizeof(QuicStreamState));
+      addStream(usage, MemoryCategory::STREAM_BUFFERS, stream);
+    });
+  }
+  if (conn.cryptoState) {
+    addStream(usage, MemoryCategory::CRYPTO, conn.cryptoState->initialStream);
+    addStream(
+        usage, MemoryCategory::CRYPTO, conn.cryptoState->handshakeStream);
+    addStream(usage, MemoryCategory::CRYPTO, conn.cryptoState->oneRttStream);
+  }
+  uint64_t outstandingBytes =
+      conn.outstandingPackets.size() * sizeof(OutstandingPacket);
+  for (const auto& packet : conn.outstandingPackets) {
+    const auto& frames = packet.packet.frames;
+    if (frames.capacity() > kInlineWriteFrames) {
+      outstandingBytes += frames.capacity() * sizeof(QuicWriteFrame);
+    }
+  }
+  usage.add(MemoryCategory::OUTSTANDING_PACKETS, outstandingBytes);
+  if (conn.qLogger) {
+    usage.add(MemoryCategory::QLOG, conn.qLogger->getMemoryUsage());
+  }
+  return usage;
+}
+} // namespace quic
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Optional.h>
+#include <folly/SocketAddress.h>
+#include <quic/codec/QuicConnectionId.h>
+
+#include <array>
+#include <cstdint>
+
+namespace quic {
+
+struct QuicConnectionStateBase;
+
+enum class MemoryCategory : uint8_t {
+  // Data received and not read yet, and data written and not sent yet.
+  STREAM_BUFFERS,
+  // Stream data sent and not acked yet, including the data declared lost.
+  RETRANSMISSION_BUFFERS,
+  // Packets in outstandingPackets, with their frames.
+  OUTSTANDING_PACKETS,
+  // Buffered handshake data of the crypto streams.
+  CRYPTO,
+  // qlog events held in memory.
+  QLOG,
+  // NOTE: MAX should always be at the end
+  MAX
+};
+
+inline const char* toString(MemoryCategory category) {
+  switch (category) {
+    case MemoryCategory::STREAM_BUFFERS:
+      return "STREAM_BUFFERS";
+    case MemoryCategory::RETRANSMISSION_BUFFERS:
+      return "RETRANSMISSION_BUFFERS";
+    case MemoryCategory::OUTSTANDING_PACKETS:
+      return "OUTSTANDING_PACKETS";
+    case MemoryCategory::CRYPTO:
+      return "CRYPTO";
+    case MemoryCategory::QLOG:
+      return "QLOG";
+    case MemoryCategory::MAX:
+      return "MAX";
+  }
+  return "UNKNOWN";
+}
+
+/**
+ * Approximately how many bytes the containers of a connection that grow with
+ * its traffic hold. Buffers count for their capacity rather than the data in
+ * them, and a buffer shared by several containers counts in each of them.
+ */
+struct ConnectionMemoryUsage {
+  std::array<uint64_t, static_cast<size_t>(MemoryCategory::MAX)> bytes{};
+
+  uint64_t get(MemoryCategory category) const {
+    return bytes[static_cast<size_t>(category)];
+  }
+
+  void add(MemoryCategory category, uint64_t n) {
+    bytes[static_cast<size_t>(category)] += n;
+  }
+
+  uint64_t total() const {
+    uint64_t sum = 0;
+    for (auto b : bytes) {
+      sum += b;
+    }
+    return sum;
+  }
+
+  void merge(const ConnectionMemoryUsage& other) {
+    for (size_t i = 0; i < bytes.size(); ++i) {
+      bytes[i] += other.bytes[i];
+    }
+  }
+};
+
+/**
+ * Walks the containers of conn and adds up what they hold. It is linear in
+ * the buffers and packets the connection has, so it is meant to be called
+ * when asked for, not on every packet.
+ */
+ConnectionMemoryUsage getConnectionMemoryUsage(
+    const QuicConnectionStateBase& conn);
+
+/**
+ * One connection's memory, as returned when looking for the connections of a
+ * server that hold the most.
+ */
+struct ConnectionMemoryUsageSample {
+  folly::Optional<ConnectionId> serverConnectionId;
+  folly::SocketAddress peerAddress;
+  ConnectionMemoryUsage memoryUsage;
+};
+} // namespace quic
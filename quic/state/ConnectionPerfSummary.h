@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+
+namespace quic {
+
+/**
+ * A fixed size summary of how a connection performed, cheap enough to be
+ * aggregated for every connection without qlog. Durations that were still
+ * ongoing are counted up to when the summary is taken.
+ */
+struct ConnectionPerfSummary {
+  uint64_t totalBytesSent{0};
+  uint64_t totalBytesAcked{0};
+  uint64_t totalBytesRetransmitted{0};
+  uint32_t rtxCount{0};
+  uint32_t ptoCount{0};
+  uint32_t spuriousLossCount{0};
+  // Zero without an rtt sample.
+  std::chrono::microseconds minRtt{0};
+  std::chrono::microseconds srtt{0};
+  // Time the congestion controller allowed no writes.
+  std::chrono::microseconds cwndLimitedTime{0};
+  // Time the application had less than a packet to write.
+  std::chrono::microseconds appLimitedTime{0};
+};
+
+static_assert(
+    std::is_trivially_copyable<ConnectionPerfSummary>::value,
+    "ConnectionPerfSummary must stay a plain copyable struct");
+} // namespace quic
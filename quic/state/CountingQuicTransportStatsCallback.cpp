@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/state/CountingQuicTransportStatsCallback.h>
+
+#include <folly/lang/Bits.h>
+
+#include <cmath>
+
+namespace {
+constexpr size_t kSubBucketBits = 3;
+
+template <size_t N>
+void addArray(
+    std::array<uint64_t, N>& to,
+    const std::array<uint64_t, N>& from) {
+  for (size_t i = 0; i < N; ++i) {
+    to[i] += from[i];
+  }
+}
+
+template <size_t N>
+void loadArray(
+    std::array<uint64_t, N>& to,
+    const std::array<std::atomic<uint64_t>, N>& from) {
+  for (size_t i = 0; i < N; ++i) {
+    to[i] += from[i].load(std::memory_order_relaxed);
+  }
+}
+} // namespace
+
+namespace quic {
+
+constexpr size_t QuicStatsHistogramSnapshot::kSubBuckets;
+constexpr size_t QuicStatsHistogramSnapshot::kNumBuckets;
+
+static_assert(
+    QuicStatsHistogramSnapshot::kSubBuckets == 1 << kSubBucketBits,
+    "Sub buckets are indexed by the bits after the leading one");
+
+size_t QuicStatsHistogramSnapshot::bucketIndex(uint64_t value) {
+  if (value < kSubBuckets) {
+    return value;
+  }
+  size_t msb = folly::findLastSet(value) - 1;
+  size_t sub = (value >> (msb - kSubBucketBits)) & (kSubBuckets - 1);
+  return kSubBuckets + (msb - kSubBucketBits) * kSubBuckets + sub;
+}
+
+uint64_t QuicStatsHistogramSnapshot::bucketLowerBound(size_t index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  size_t msb = (index - kSubBuckets) / kSubBuckets + kSubBucketBits;
+  uint64_t sub = (index - kSubBuckets) % kSubBuckets;
+  return (uint64_t(1) << msb) | (sub << (msb - kSubBucketBits));
+}
+
+void QuicStatsHistogramSnapshot::merge(
+    const QuicStatsHistogramSnapshot& other) {
+  addArray(buckets, other.buckets);
+  count += other.count;
+  sum += other.sum;
+}
+
+uint64_t QuicStatsHistogramSnapshot::percentile(double pct) const {
+  // Buckets are read one at a time while the worker writes, so they can be a
+  // few values off count.
+  uint64_t total = 0;
+  for (auto bucket : buckets) {
+    total += bucket;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  auto rank = std::max<uint64_t>(1, std::ceil(total * pct / 100));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return bucketLowerBound(i);
+    }
+  }
+  return bucketLowerBound(kNumBuckets - 1);
+}
+
+void QuicTransportStatsSnapshot::merge(
+    const QuicTransportStatsSnapshot& other) {
+  addArray(counters, other.counters);
+  addArray(packetsDropped, other.packetsDropped);
+  addArray(connectionCloses, other.connectionCloses);
+  addArray(socketWriteErrors, other.socketWriteErrors);
+  addArray(writeLoopEnds, other.writeLoopEnds);
+  rtt.merge(other.rtt);
+  packetSize.merge(other.packetSize);
+  handshakeTime.merge(other.handshakeTime);
+  packetsPerBatch.merge(other.packetsPerBatch);
+  pacingBurstSize.merge(other.pacingBurstSize);
+  pacingTimerLateness.merge(other.pacingTimerLateness);
+  pacingIntervalError.merge(other.pacingIntervalError);
+}
+
+void QuicTransportStatsCounters::Histogram::snapshot(
+    QuicStatsHistogramSnapshot& out) const {
+  loadArray(out.buckets, buckets_);
+  out.count += count_.load(std::memory_order_relaxed);
+  out.sum += sum_.load(std::memory_order_relaxed);
+}
+
+void QuicTransportStatsCounters::snapshot(
+    QuicTransportStatsSnapshot& out) const {
+  loadArray(out.counters, counters_);
+  loadArray(out.packetsDropped, packetsDropped_);
+  loadArray(out.connectionCloses, connectionCloses_);
+  loadArray(out.socketWriteErrors, socketWriteErrors_);
+  loadArray(out.writeLoopEnds, writeLoopEnds_);
+  rtt_.snapshot(out.rtt);
+  packetSize_.snapshot(out.packetSize);
+  handshakeTime_.snapshot(out.handshakeTime);
+  packetsPerBatch_.snapshot(out.packetsPerBatch);
+  pacingBurstSize_.snapshot(out.pacingBurstSize);
+  pacingTimerLateness_.snapshot(out.pacingTimerLateness);
+  pacingIntervalError_.snapshot(out.pacingIntervalError);
+}
+
+std::shared_ptr<QuicTransportStatsCounters>
+QuicTransportStatsCollector::makeCounters() {
+  auto counters = std::make_shared<QuicTransportStatsCounters>();
+  std::lock_guard<std::mutex> guard(mutex_);
+  counters_.push_back(counters);
+  return counters;
+}
+
+QuicTransportStatsSnapshot QuicTransportStatsCollector::snapshot() const {
+  QuicTransportStatsSnapshot snapshot;
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (const auto& counters : counters_) {
+    counters->snapshot(snapshot);
+  }
+  return snapshot;
+}
+
+std::vector<QuicTransportStatsSnapshot>
+QuicTransportStatsCollector::snapshotPerWorker() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  std::vector<QuicTransportStatsSnapshot> snapshots(counters_.size());
+  for (size_t i = 0; i < counters_.size(); ++i) {
+    counters_[i]->snapshot(snapshots[i]);
+  }
+  return snapshots;
+}
+
+void CountingQuicTransportStatsCallback::onConnectionClose(
+    folly::Optional<ConnectionCloseReason> reason,
+    const ConnectionPerfSummary* summary) {
+  counters_->onConnectionClose(reason.value_or(ConnectionCloseReason::NONE));
+  if (summary && summary->srtt.count() > 0) {
+    counters_->addRtt(summary->srtt.count());
+  }
+}
+
+} // namespace quic
@@ -0,0 +1,436 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/lang/Align.h>
+#include <quic/state/QuicTransportStatsCallback.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace quic {
+
+enum class QuicStatsCounter : uint8_t {
+  PacketsReceived,
+  DuplicatedPacketsReceived,
+  OutOfOrderPacketsReceived,
+  PacketsProcessed,
+  PacketsSent,
+  PacketRetransmissions,
+  PacketsForwarded,
+  ForwardedPacketsReceived,
+  ForwardedPacketsProcessed,
+  ClientInitialsReceived,
+  NewConnections,
+  NewStreams,
+  StreamsClosed,
+  StreamsReset,
+  ConnFlowControlUpdates,
+  ConnFlowControlBlocked,
+  StatelessResets,
+  StreamFlowControlUpdates,
+  StreamFlowControlBlocked,
+  CwndBlocked,
+  PTOs,
+  SpuriousLosses,
+  BytesRead,
+  BytesWritten,
+  HotLoopMitigations,
+  // NOTE: MAX should always be at the end
+  MAX
+};
+
+/**
+ * Counts of values in log-linear buckets: exact below kSubBuckets, then
+ * kSubBuckets buckets per power of two, so a bucket is within 1/kSubBuckets
+ * of any value in it.
+ */
+struct QuicStatsHistogramSnapshot {
+  static constexpr size_t kSubBuckets = 8;
+  static constexpr size_t kNumBuckets = kSubBuckets * 62;
+
+  std::array<uint64_t, kNumBuckets> buckets{};
+  uint64_t count{0};
+  uint64_t sum{0};
+
+  static size_t bucketIndex(uint64_t value);
+  static uint64_t bucketLowerBound(size_t index);
+
+  void merge(const QuicStatsHistogramSnapshot& other);
+
+  /**
+   * Lower bound of the bucket holding the given percentile, in [0, 100].
+   * 0 when empty.
+   */
+  uint64_t percentile(double pct) const;
+};
+
+/**
+ * A plain copy of a worker's counters which exporters can merge and read at
+ * leisure.
+ */
+struct QuicTransportStatsSnapshot {
+  using PacketDropReason = QuicTransportStatsCallback::PacketDropReason;
+  using ConnectionCloseReason =
+      QuicTransportStatsCallback::ConnectionCloseReason;
+  using SocketErrorType = QuicTransportStatsCallback::SocketErrorType;
+
+  std::array<uint64_t, static_cast<size_t>(QuicStatsCounter::MAX)> counters{};
+  std::array<uint64_t, static_cast<size_t>(PacketDropReason::MAX)>
+      packetsDropped{};
+  // Closes without a reason count as NONE.
+  std::array<uint64_t, static_cast<size_t>(ConnectionCloseReason::MAX)>
+      connectionCloses{};
+  std::array<uint64_t, static_cast<size_t>(SocketErrorType::MAX)>
+      socketWriteErrors{};
+  std::array<uint64_t, static_cast<size_t>(WriteLoopEndReason::MAX)>
+      writeLoopEnds{};
+  // Smoothed rtt of closed connections which had a sample, in microseconds.
+  QuicStatsHistogramSnapshot rtt;
+  // Sizes of the reads from and writes to the socket.
+  QuicStatsHistogramSnapshot packetSize;
+  // From the first packet to handshake done, in microseconds.
+  QuicStatsHistogramSnapshot handshakeTime;
+  // Packets written in each flush of a batch.
+  QuicStatsHistogramSnapshot packetsPerBatch;
+  // Packets in each paced burst, how late its pacing timer fired, and how far
+  // the time since the previous burst was from the pacing interval, the last
+  // two in microseconds.
+  QuicStatsHistogramSnapshot pacingBurstSize;
+  QuicStatsHistogramSnapshot pacingTimerLateness;
+  QuicStatsHistogramSnapshot pacingIntervalError;
+
+  uint64_t get(QuicStatsCounter counter) const {
+    return counters[static_cast<size_t>(counter)];
+  }
+
+  void merge(const QuicTransportStatsSnapshot& other);
+};
+
+/**
+ * The counters of one worker. Only that worker's thread writes them, so an
+ * increment is a relaxed load and store rather than a locked add, and any
+ * thread can take a snapshot without stopping it.
+ */
+class QuicTransportStatsCounters {
+ public:
+  void increment(QuicStatsCounter counter, uint64_t value = 1) noexcept {
+    add(counters_[static_cast<size_t>(counter)], value);
+  }
+
+  void onPacketDropped(
+      QuicTransportStatsCallback::PacketDropReason reason) noexcept {
+    add(packetsDropped_[static_cast<size_t>(reason)], 1);
+  }
+
+  void onConnectionClose(
+      QuicTransportStatsCallback::ConnectionCloseReason reason) noexcept {
+    add(connectionCloses_[static_cast<size_t>(reason)], 1);
+  }
+
+  void onSocketWriteError(
+      QuicTransportStatsCallback::SocketErrorType errorType) noexcept {
+    add(socketWriteErrors_[static_cast<size_t>(errorType)], 1);
+  }
+
+  void onWriteLoopEnd(WriteLoopEndReason reason) noexcept {
+    add(writeLoopEnds_[static_cast<size_t>(reason)], 1);
+  }
+
+  void addPacketsPerBatch(uint64_t packets) noexcept {
+    packetsPerBatch_.addValue(packets);
+  }
+
+  void addRtt(uint64_t rttUs) noexcept {
+    rtt_.addValue(rttUs);
+  }
+
+  void addPacketSize(uint64_t size) noexcept {
+    packetSize_.addValue(size);
+  }
+
+  void addHandshakeTime(uint64_t handshakeTimeUs) noexcept {
+    handshakeTime_.addValue(handshakeTimeUs);
+  }
+
+  void addPacedWrite(
+      uint64_t burstPackets,
+      uint64_t timerLatenessUs,
+      uint64_t intervalErrorUs) noexcept {
+    pacingBurstSize_.addValue(burstPackets);
+    pacingTimerLateness_.addValue(timerLatenessUs);
+    pacingIntervalError_.addValue(intervalErrorUs);
+  }
+
+  /**
+   * Adds the current counts to the snapshot. Safe from any thread.
+   */
+  void snapshot(QuicTransportStatsSnapshot& out) const;
+
+ private:
+  using Counter = std::atomic<uint64_t>;
+
+  static void add(Counter& counter, uint64_t value) noexcept {
+    counter.store(
+        counter.load(std::memory_order_relaxed) + value,
+        std::memory_order_relaxed);
+  }
+
+  class Histogram {
+   public:
+    void addValue(uint64_t value) noexcept {
+      add(buckets_[QuicStatsHistogramSnapshot::bucketIndex(value)], 1);
+      add(count_, 1);
+      add(sum_, value);
+    }
+
+    void snapshot(QuicStatsHistogramSnapshot& out) const;
+
+   private:
+    std::array<Counter, QuicStatsHistogramSnapshot::kNumBuckets> buckets_{};
+    Counter count_{0};
+    Counter sum_{0};
+  };
+
+  // Keeps the hot counters off the cache lines of other allocations.
+  char padBegin_[folly::hardware_destructive_interference_size];
+  std::array<Counter, static_cast<size_t>(QuicStatsCounter::MAX)> counters_{};
+  std::array<
+      Counter,
+      static_cast<size_t>(QuicTransportStatsCallback::PacketDropReason::MAX)>
+      packetsDropped_{};
+  std::array<
+      Counter,
+      static_cast<size_t>(
+          QuicTransportStatsCallback::ConnectionCloseReason::MAX)>
+      connectionCloses_{};
+  std::array<
+      Counter,
+      static_cast<size_t>(QuicTransportStatsCallback::SocketErrorType::MAX)>
+      socketWriteErrors_{};
+  std::array<Counter, static_cast<size_t>(WriteLoopEndReason::MAX)>
+      writeLoopEnds_{};
+  Histogram rtt_;
+  Histogram packetSize_;
+  Histogram handshakeTime_;
+  Histogram packetsPerBatch_;
+  Histogram pacingBurstSize_;
+  Histogram pacingTimerLateness_;
+  Histogram pacingIntervalError_;
+  char padEnd_[folly::hardware_destructive_interference_size];
+};
+
+/**
+ * Keeps the counters of every worker for an exporter to snapshot. Counters
+ * outlive their worker, so totals don't drop when a worker goes away.
+ */
+class QuicTransportStatsCollector {
+ public:
+  std::shared_ptr<QuicTransportStatsCounters> makeCounters();
+
+  /**
+   * The sum of all the workers' counters.
+   */
+  QuicTransportStatsSnapshot snapshot() const;
+
+  /**
+   * One snapshot per worker, in the order they were made.
+   */
+  std::vector<QuicTransportStatsSnapshot> snapshotPerWorker() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<QuicTransportStatsCounters>> counters_;
+};
+
+/**
+ * A QuicTransportStatsCallback which only counts, for deployments without
+ * their own stats.
+ */
+class CountingQuicTransportStatsCallback final
+    : public QuicTransportStatsCallback {
+ public:
+  explicit CountingQuicTransportStatsCallback(
+      std::shared_ptr<QuicTransportStatsCounters> counters)
+      : counters_(std::move(counters)) {}
+
+  ~CountingQuicTransportStatsCallback() override = default;
+
+  void onPacketReceived() override {
+    counters_->increment(QuicStatsCounter::PacketsReceived);
+  }
+
+  void onDuplicatedPacketReceived() override {
+    counters_->increment(QuicStatsCounter::DuplicatedPacketsReceived);
+  }
+
+  void onOutOfOrderPacketReceived() override {
+    counters_->increment(QuicStatsCounter::OutOfOrderPacketsReceived);
+  }
+
+  void onPacketProcessed() override {
+    counters_->increment(QuicStatsCounter::PacketsProcessed);
+  }
+
+  void onPacketSent() override {
+    counters_->increment(QuicStatsCounter::PacketsSent);
+  }
+
+  void onPacketRetransmission() override {
+    counters_->increment(QuicStatsCounter::PacketRetransmissions);
+  }
+
+  void onPacketDropped(PacketDropReason reason) override {
+    counters_->onPacketDropped(reason);
+  }
+
+  void onPacketForwarded() override {
+    counters_->increment(QuicStatsCounter::PacketsForwarded);
+  }
+
+  void onForwardedPacketReceived() override {
+    counters_->increment(QuicStatsCounter::ForwardedPacketsReceived);
+  }
+
+  void onForwardedPacketProcessed() override {
+    counters_->increment(QuicStatsCounter::ForwardedPacketsProcessed);
+  }
+
+  void onClientInitialReceived() override {
+    counters_->increment(QuicStatsCounter::ClientInitialsReceived);
+  }
+
+  void onNewConnection() override {
+    counters_->increment(QuicStatsCounter::NewConnections);
+  }
+
+  void onConnectionClose(
+      folly::Optional<ConnectionCloseReason> reason,
+      const ConnectionPerfSummary* summary) override;
+
+  void onNewQuicStream() override {
+    counters_->increment(QuicStatsCounter::NewStreams);
+  }
+
+  void onQuicStreamClosed() override {
+    counters_->increment(QuicStatsCounter::StreamsClosed);
+  }
+
+  void onQuicStreamReset() override {
+    counters_->increment(QuicStatsCounter::StreamsReset);
+  }
+
+  void onConnFlowControlUpdate() override {
+    counters_->increment(QuicStatsCounter::ConnFlowControlUpdates);
+  }
+
+  void onConnFlowControlBlocked() override {
+    counters_->increment(QuicStatsCounter::ConnFlowControlBlocked);
+  }
+
+  void onStatelessReset() override {
+    counters_->increment(QuicStatsCounter::StatelessResets);
+  }
+
+  void onStreamFlowControlUpdate() override {
+    counters_->increment(QuicStatsCounter::StreamFlowControlUpdates);
+  }
+
+  void onStreamFlowControlBlocked() override {
+    counters_->increment(QuicStatsCounter::StreamFlowControlBlocked);
+  }
+
+  void onCwndBlocked() override {
+    counters_->increment(QuicStatsCounter::CwndBlocked);
+  }
+
+  void onStreamHolBlockedDuration(std::chrono::microseconds) override {}
+
+  void onConnFlowControlBlockedDuration(std::chrono::microseconds) override {}
+
+  void onStreamFlowControlBlockedDuration(std::chrono::microseconds) override {
+  }
+
+  void onCwndBlockedDuration(std::chrono::microseconds) override {}
+
+  void onHandshakeDone(const HandshakeTimings& timings) override {
+    if (timings.handshakeDone) {
+      counters_->addHandshakeTime(timings.handshakeDone->count());
+    }
+  }
+
+  void onPTO() override {
+    counters_->increment(QuicStatsCounter::PTOs);
+  }
+
+  void onPacketSpuriousLoss() override {
+    counters_->increment(QuicStatsCounter::SpuriousLosses);
+  }
+
+  void onRead(size_t bufSize) override {
+    counters_->increment(QuicStatsCounter::BytesRead, bufSize);
+    counters_->addPacketSize(bufSize);
+  }
+
+  void onWrite(size_t bufSize) override {
+    counters_->increment(QuicStatsCounter::BytesWritten, bufSize);
+    counters_->addPacketSize(bufSize);
+  }
+
+  void onUDPSocketWriteError(SocketErrorType errorType) override {
+    counters_->onSocketWriteError(errorType);
+  }
+
+  void onWriteLoopEnd(WriteLoopEndReason reason, uint64_t) override {
+    counters_->onWriteLoopEnd(reason);
+  }
+
+  void onBatchFlushed(uint64_t packets, uint64_t) override {
+    counters_->addPacketsPerBatch(packets);
+  }
+
+  void onPacedWrite(
+      uint64_t burstPackets,
+      std::chrono::microseconds timerLateness,
+      std::chrono::microseconds intervalError) override {
+    counters_->addPacedWrite(
+        burstPackets, timerLateness.count(), intervalError.count());
+  }
+
+  void onMemoryUsage(const ConnectionMemoryUsage&) override {}
+
+  void onHotLoopMitigation(HotLoopMitigation) override {
+    counters_->increment(QuicStatsCounter::HotLoopMitigations);
+  }
+
+ private:
+  std::shared_ptr<QuicTransportStatsCounters> counters_;
+};
+
+class CountingQuicTransportStatsCallbackFactory
+    : public QuicTransportStatsCallbackFactory {
+ public:
+  explicit CountingQuicTransportStatsCallbackFactory(
+      std::shared_ptr<QuicTransportStatsCollector> collector)
+      : collector_(std::move(collector)) {}
+
+  ~CountingQuicTransportStatsCallbackFactory() override = default;
+
+  std::unique_ptr<QuicTransportStatsCallback> make() override {
+    return std::make_unique<CountingQuicTransportStatsCallback>(
+        collector_->makeCounters());
+  }
+
+ private:
+  std::shared_ptr<QuicTransportStatsCollector> collector_;
+};
+} // namespace quic
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Optional.h>
+#include <quic/QuicConstants.h>
+
+#include <chrono>
+
+namespace quic {
+
+/**
+ * When each step of a handshake happened, counted from the start of the
+ * connection, and how much CPU time the handshake took. Comparing the two
+ * tells whether a slow handshake waited on the network or on the host.
+ */
+struct HandshakeTimings {
+  folly::Optional<std::chrono::microseconds> firstInitialReceived;
+  // Carries the ServerHello on a server and the ClientHello on a client.
+  folly::Optional<std::chrono::microseconds> firstInitialSent;
+  folly::Optional<std::chrono::microseconds> handshakeKeysDerived;
+  folly::Optional<std::chrono::microseconds> oneRttKeysAvailable;
+  folly::Optional<std::chrono::microseconds> handshakeDone;
+  // Stream data, not crypto data.
+  folly::Optional<std::chrono::microseconds> firstAppDataSent;
+  folly::Optional<std::chrono::microseconds> firstAppDataAcked;
+
+  // Spent in the server handshake layer processing crypto data, and spent in
+  // the TLS state machine. Asynchronous work, such as signing on another
+  // executor, is in neither.
+  std::chrono::microseconds handshakeProcessingTime{0};
+  std::chrono::microseconds tlsProcessingTime{0};
+};
+
+/**
+ * Sets timing to the time since connectionTime unless it is already set.
+ */
+inline void recordHandshakeTiming(
+    folly::Optional<std::chrono::microseconds>& timing,
+    TimePoint connectionTime,
+    TimePoint time) {
+  if (!timing) {
+    timing = std::chrono::duration_cast<std::chrono::microseconds>(
+        time - connectionTime);
+  }
+}
+
+inline void recordHandshakeTiming(
+    folly::Optional<std::chrono::microseconds>& timing,
+    TimePoint connectionTime) {
+  if (!timing) {
+    recordHandshakeTiming(timing, connectionTime, Clock::now());
+  }
+}
+} // namespace quic
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/state/PathMtuDiscovery.h>
+
+#include <quic/state/StateData.h>
+
+namespace quic {
+
+namespace {
+void maybeEndSearch(PathMtuState& state, TimePoint now) {
+  if (state.high < state.low + kPathMtuSearchGranularity) {
+    state.phase = PathMtuState::Phase::SearchComplete;
+    state.nextSearchTime = now + kPathMtuRaiseTimeout;
+  }
+}
+} // namespace
+
+void startPathMtuDiscovery(
+    QuicConnectionStateBase& conn,
+    uint64_t peerMaxPacketSize) {
+  auto& state = conn.pathMtuState;
+  state = PathMtuState();
+  uint64_t maxSize =
+      std::min(peerMaxPacketSize, conn.transportSettings.maxPathMtuProbeSize);
+  if (conn.transportSettings.dataPathType == DataPathType::ContinuousMemory) {
+    // The shared output buffer only has room for packets up to this size.
+    maxSize = std::min<uint64_t>(maxSize, kDefaultMaxUDPPayload);
+  }
+  if (maxSize <= conn.udpSendPacketLen) {
+    return;
+  }
+  state.phase = PathMtuState::Phase::Searching;
+  state.baseSize = conn.udpSendPacketLen;
+  state.maxSize = maxSize;
+  state.low = conn.udpSendPacketLen;
+  state.high = maxSize;
+  auto hint = conn.transportSettings.pathMtuProbeHint;
+  if (hint > state.low && hint <= state.high) {
+    state.probeSize = hint;
+  }
+  VLOG(10) << "Path MTU search from=" << state.low << " to=" << state.high
+           << " " << conn;
+}
+
+folly::Optional<uint64_t> getNextPathMtuProbe(
+    QuicConnectionStateBase& conn,
+    TimePoint now) {
+  auto& state = conn.pathMtuState;
+  if (state.phase == PathMtuState::Phase::SearchComplete &&
+      state.nextSearchTime && now >= *state.nextSearchTime) {
+    // The path may carry larger packets by now.
+    state.phase = PathMtuState::Phase::Searching;
+    state.low = conn.udpSendPacketLen;
+    state.high = state.maxSize;
+    state.probeSize = 0;
+    state.probeLosses = 0;
+    state.nextSearchTime.clear();
+    maybeEndSearch(state, now);
+  }
+  if (state.phase != PathMtuState::Phase::Searching || state.probeInFlight) {
+    return folly::none;
+  }
+  if (state.probeSize == 0) {
+    // The largest size first, which most paths that carry more than the base
+    // size carry, then halving the range.
+    state.probeSize = state.high == state.maxSize
+        ? state.high
+        : state.low + (state.high - state.low + 1) / 2;
+  }
+  return state.probeSize;
+}
+
+void onPathMtuProbeSent(QuicConnectionStateBase& conn) {
+  conn.pathMtuState.probeInFlight = true;
+}
+
+void onPathMtuPacketAcked(
+    QuicConnectionStateBase& conn,
+    const OutstandingPacket& packet,
+    TimePoint ackTime) {
+  auto& state = conn.pathMtuState;
+  if (packet.encodedSize > state.baseSize) {
+    state.largePacketLosses = 0;
+  }
+  if (!packet.isPathMtuProbe) {
+    return;
+  }
+  state.probeInFlight = false;
+  if (state.phase != PathMtuState::Phase::Searching) {
+    return;
+  }
+  state.probeLosses = 0;
+  state.probeSize = 0;
+  state.low = std::max<uint64_t>(state.low, packet.encodedSize);
+  if (state.low > conn.udpSendPacketLen) {
+    VLOG(4) << "Path MTU raised from=" << conn.udpSendPacketLen
+            << " to=" << state.low << " " << conn;
+    conn.udpSendPacketLen = state.low;
+  }
+  maybeEndSearch(state, ackTime);
+}
+
+void onPathMtuPacketLost(
+    QuicConnectionStateBase& conn,
+    const OutstandingPacket& packet,
+    TimePoint lossTime) {
+  auto& state = conn.pathMtuState;
+  if (packet.isPathMtuProbe) {
+    state.probeInFlight = false;
+    if (state.phase != PathMtuState::Phase::Searching ||
+        ++state.probeLosses < kMaxPathMtuProbes) {
+      return;
+    }
+    state.probeLosses = 0;
+    state.probeSize = 0;
+    state.high = std::min<uint64_t>(state.high, packet.encodedSize - 1);
+    maybeEndSearch(state, lossTime);
+    return;
+  }
+  if (state.phase == PathMtuState::Phase::Disabled ||
+      packet.encodedSize <= state.baseSize ||
+      ++state.largePacketLosses < kPathMtuBlackHoleThreshold) {
+    return;
+  }
+  VLOG(2) << "Path MTU black hole, falling back from="
+          << conn.udpSendPacketLen << " to=" << state.baseSize << " " << conn;
+  conn.udpSendPacketLen = state.baseSize;
+  state.phase = PathMtuState::Phase::SearchComplete;
+  state.nextSearchTime = lossTime + kPathMtuRaiseTimeout;
+  state.largePacketLosses = 0;
+  state.probeLosses = 0;
+  state.probeSize = 0;
+}
+
+} // namespace quic
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/QuicConstants.h>
+
+#include <folly/Optional.h>
+
+namespace quic {
+
+struct OutstandingPacket;
+struct QuicConnectionStateBase;
+
+/**
+ * State of the search for the largest packet size the path carries, following
+ * RFC 8899. Once the peer's transport parameters are known, padded PING probes
+ * are sent one at a time for sizes between udpSendPacketLen and the largest
+ * size the peer and the settings allow. An acked probe raises udpSendPacketLen
+ * to its size; a size whose probes are lost kMaxPathMtuProbes times in a row
+ * is taken not to fit. Lost probes aren't a signal of congestion.
+ *
+ * If packets larger than the size the search started from keep getting lost
+ * afterwards, the path has become a black hole for them. udpSendPacketLen then
+ * falls back to that size, and the search starts over after a while.
+ */
+struct PathMtuState {
+  enum class Phase : uint8_t {
+    // Not searching, and never will on this connection.
+    Disabled,
+    Searching,
+    // Until nextSearchTime.
+    SearchComplete,
+  };
+
+  Phase phase{Phase::Disabled};
+  // Packet size when the search started, known to work.
+  uint64_t baseSize{kDefaultUDPSendPacketLen};
+  // Largest size worth searching for.
+  uint64_t maxSize{kDefaultUDPSendPacketLen};
+  // Sizes up to low are known to work, sizes above high not to.
+  uint64_t low{kDefaultUDPSendPacketLen};
+  uint64_t high{kDefaultUDPSendPacketLen};
+  // Size of the next probe, 0 if it's yet to be picked.
+  uint64_t probeSize{0};
+  // Whether a probe is waiting for its ack.
+  bool probeInFlight{false};
+  // Probes of probeSize lost in a row.
+  uint8_t probeLosses{0};
+  // Packets larger than baseSize lost since one was last acked.
+  uint64_t largePacketLosses{0};
+  folly::Optional<TimePoint> nextSearchTime;
+};
+
+/**
+ * Starts searching for a larger udpSendPacketLen, up to the peer's
+ * max_packet_size and transportSettings.maxPathMtuProbeSize.
+ */
+void startPathMtuDiscovery(
+    QuicConnectionStateBase& conn,
+    uint64_t peerMaxPacketSize);
+
+/**
+ * Returns the size of the probe to send now, if any. It starts a new search
+ * once nextSearchTime has passed.
+ */
+folly::Optional<uint64_t> getNextPathMtuProbe(
+    QuicConnectionStateBase& conn,
+    TimePoint now);
+
+void onPathMtuProbeSent(QuicConnectionStateBase& conn);
+
+/**
+ * To be called for every acked and lost packet, probe or not.
+ */
+void onPathMtuPacketAcked(
+    QuicConnectionStateBase& conn,
+    const OutstandingPacket& packet,
+    TimePoint ackTime);
+
+void onPathMtuPacketLost(
+    QuicConnectionStateBase& conn,
+    const OutstandingPacket& packet,
+    TimePoint lossTime);
+
+} // namespace quic
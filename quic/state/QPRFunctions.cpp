@@ -34,25 +34,23 @@ void shrinkBuffers(std::deque<StreamBuffer>& buffers, uint64_t offset) {
   }
 }
 
-void shrinkBuffers(
-    folly::F14FastMap<uint64_t, std::unique_ptr<StreamBuffer>>& buffers,
-    uint64_t offset) {
-  // Do a linear search of the entire buffer, there can be exactly one trimmed
-  // buffer, since we are changing the offset for that single buffer we need to
-  // change the offset in the StreamBuffer, but keep it keyed on the same
-  // offset as before so we still remove it on ack.
-  for (auto itr = buffers.begin(); itr != buffers.end();) {
-    if (itr->second->offset >= offset) {
-      itr++;
-      continue;
+void shrinkBuffers(RetransmissionBuffer& buffers, uint64_t offset) {
+  // The buffers are sorted and don't overlap, so there can be exactly one
+  // trimmed buffer. Since we are changing the offset for that single buffer we
+  // need to change the offset in the StreamBuffer, but keep it keyed on the
+  // same offset as before so we still remove it on ack.
+  while (!buffers.empty()) {
+    auto curr = buffers.begin();
+    if (curr->second->offset >= offset) {
+      break;
     }
-    if (itr->second->offset + itr->second->data.chainLength() <= offset) {
-      itr = buffers.erase(itr);
+    if (curr->second->offset + curr->second->data.chainLength() <= offset) {
+      buffers.erase(curr);
     } else {
-      uint64_t amount = offset - itr->second->offset;
-      itr->second->data.trimStartAtMost(amount);
-      itr->second->offset += amount;
-      itr++;
+      uint64_t amount = offset - curr->second->offset;
+      curr->second->data.trimStartAtMost(amount);
+      curr->second->offset += amount;
+      break;
     }
   }
 }
@@ -222,6 +220,37 @@ folly::Optional<uint64_t> advanceMinimumRetransmittableOffset(
   return minimumStreamOffset;
 }
 
+folly::Optional<uint64_t> expireStreamDataPastDeadline(
+    QuicStreamState* stream,
+    TimePoint now) {
+  auto& deadlines = stream->writeDeadlines;
+  // The deadlines of later writes may be earlier if the time to live was
+  // changed, and the data before them goes too.
+  folly::Optional<uint64_t> expiredOffset;
+  for (const auto& deadline : deadlines) {
+    if (deadline.second <= now) {
+      expiredOffset = std::max(expiredOffset.value_or(0), deadline.first);
+    }
+  }
+  if (!expiredOffset) {
+    return folly::none;
+  }
+  while (!deadlines.empty() && deadlines.front().first <= *expiredOffset) {
+    deadlines.pop_front();
+  }
+  auto& retransmissionBuffer = stream->retransmissionBuffer;
+  bool undelivered = stream->currentWriteOffset < *expiredOffset ||
+      (!stream->lossBuffer.empty() &&
+       stream->lossBuffer.front().offset < *expiredOffset) ||
+      (!retransmissionBuffer.empty() &&
+       retransmissionBuffer.begin()->second->offset < *expiredOffset);
+  if (!undelivered) {
+    // It made it in time, the peer doesn't need to hear about it.
+    return folly::none;
+  }
+  return advanceMinimumRetransmittableOffset(stream, *expiredOffset);
+}
+
 void onRecvExpiredStreamDataFrame(
     QuicStreamState* stream,
     const ExpiredStreamDataFrame& frame) {
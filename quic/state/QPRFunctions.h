@@ -35,6 +35,14 @@ folly::Optional<uint64_t> advanceMinimumRetransmittableOffset(
     QuicStreamState* stream,
     uint64_t minimumRetransmittableOffset);
 
+/**
+ * advance the minimum retransmittable offset for a stream past the writes
+ * whose deadline is before now, unless all of their data was acked already
+ */
+folly::Optional<uint64_t> expireStreamDataPastDeadline(
+    QuicStreamState* stream,
+    TimePoint now);
+
 /**
  * processing upon receipt of ExpiredStreamDataFrame
  */
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/state/QuicFecFunctions.h>
+
+#include <quic/codec/QuicInteger.h>
+#include <quic/state/stream/StreamReceiveHandlers.h>
+
+#include <folly/io/Cursor.h>
+#include <folly/lang/Bits.h>
+
+#include <cstring>
+
+namespace quic {
+
+namespace {
+
+void xorBytes(uint8_t* out, const uint8_t* in, size_t len) {
+  // A word at a time, which the compiler is free to widen further.
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t outWord;
+    uint64_t inWord;
+    memcpy(&outWord, out + i, sizeof(outWord));
+    memcpy(&inWord, in + i, sizeof(inWord));
+    outWord ^= inWord;
+    memcpy(out + i, &outWord, sizeof(outWord));
+  }
+  for (; i < len; ++i) {
+    out[i] ^= in[i];
+  }
+}
+
+/**
+ * XORs symbol into repairSymbol, a single buffer of our own which is padded
+ * with zeroes first if it's the shorter one.
+ */
+void xorInto(folly::IOBuf& repairSymbol, const folly::IOBuf& symbol) {
+  DCHECK(!repairSymbol.isChained() && !repairSymbol.isShared());
+  auto length = symbol.computeChainDataLength();
+  if (repairSymbol.length() < length) {
+    auto padding = length - repairSymbol.length();
+    if (repairSymbol.tailroom() < padding) {
+      repairSymbol.reserve(0, padding);
+    }
+    memset(repairSymbol.writableTail(), 0, padding);
+    repairSymbol.append(padding);
+  }
+  auto out = repairSymbol.writableData();
+  for (auto range : symbol) {
+    xorBytes(out, range.data(), range.size());
+    out += range.size();
+  }
+}
+
+Buf copySymbol(const folly::IOBuf& symbol) {
+  auto length = symbol.computeChainDataLength();
+  auto copy = folly::IOBuf::create(length);
+  folly::io::Cursor cursor(&symbol);
+  cursor.pull(copy->writableData(), length);
+  copy->append(length);
+  return copy;
+}
+
+std::deque<std::pair<PacketNum, Buf>>::iterator findSymbol(
+    std::deque<std::pair<PacketNum, Buf>>& symbols,
+    PacketNum packetNum) {
+  return std::lower_bound(
+      symbols.begin(),
+      symbols.end(),
+      packetNum,
+      [](const auto& symbol, PacketNum num) { return symbol.first < num; });
+}
+
+} // namespace
+
+Buf encodeFecSourceSymbol(const std::vector<FecSourceFrame>& frames) {
+  size_t length = 0;
+  for (const auto& frame : frames) {
+    length += quicIntegerSize(frame.streamId) + quicIntegerSize(frame.offset) +
+        quicIntegerSize(frame.len) + sizeof(uint8_t) + frame.len;
+  }
+  if (length > std::numeric_limits<uint16_t>::max()) {
+    return nullptr;
+  }
+  auto symbol = folly::IOBuf::create(sizeof(uint16_t) + length);
+  folly::io::Appender appender(symbol.get(), 0);
+  auto appendOp = [&](auto val) { appender.writeBE(val); };
+  appender.writeBE<uint16_t>(length);
+  for (const auto& frame : frames) {
+    encodeQuicInteger(frame.streamId, appendOp);
+    encodeQuicInteger(frame.offset, appendOp);
+    encodeQuicInteger(frame.len, appendOp);
+    appender.writeBE<uint8_t>(frame.fin ? 1 : 0);
+    auto left = frame.len;
+    if (left > 0) {
+      for (auto range : *frame.data) {
+        auto len = std::min<uint64_t>(left, range.size());
+        appender.push(range.data(), len);
+        left -= len;
+        if (left == 0) {
+          break;
+        }
+      }
+    }
+    DCHECK_EQ(left, 0);
+  }
+  return symbol;
+}
+
+folly::Optional<std::vector<ReadStreamFrame>> decodeFecSourceSymbol(
+    const folly::IOBuf& symbol) {
+  folly::io::Cursor cursor(&symbol);
+  if (!cursor.canAdvance(sizeof(uint16_t))) {
+    return folly::none;
+  }
+  size_t left = cursor.readBE<uint16_t>();
+  if (left == 0 || !cursor.canAdvance(left)) {
+    return folly::none;
+  }
+  std::vector<ReadStreamFrame> frames;
+  while (left > 0) {
+    auto streamId = decodeQuicInteger(cursor, left);
+    if (!streamId) {
+      return folly::none;
+    }
+    left -= streamId->second;
+    auto offset = decodeQuicInteger(cursor, left);
+    if (!offset) {
+      return folly::none;
+    }
+    left -= offset->second;
+    auto len = decodeQuicInteger(cursor, left);
+    if (!len) {
+      return folly::none;
+    }
+    left -= len->second;
+    if (left < sizeof(uint8_t) + len->first) {
+      return folly::none;
+    }
+    auto fin = cursor.readBE<uint8_t>();
+    if (fin > 1) {
+      return folly::none;
+    }
+    Buf data;
+    cursor.clone(data, len->first);
+    left -= sizeof(uint8_t) + len->first;
+    frames.emplace_back(
+        streamId->first, offset->first, std::move(data), fin == 1);
+  }
+  return frames;
+}
+
+void onFecSourcePacketSent(
+    QuicConnectionStateBase& conn,
+    const RegularQuicWritePacket& packet) {
+  if (!conn.fecState.peerSupported ||
+      conn.transportSettings.fecWindowSize == 0 ||
+      packet.header.getPacketNumberSpace() != PacketNumberSpace::AppData) {
+    return;
+  }
+  std::vector<FecSourceFrame> frames;
+  for (const auto& frame : packet.frames) {
+    const WriteStreamFrame* streamFrame = frame.asWriteStreamFrame();
+    if (!streamFrame) {
+      continue;
+    }
+    // The frames have been written to the retransmission buffers already.
+    auto stream = conn.streamManager->findStream(streamFrame->streamId);
+    if (!stream) {
+      return;
+    }
+    auto itr = stream->retransmissionBuffer.find(streamFrame->offset);
+    if (itr == stream->retransmissionBuffer.end() ||
+        itr->second->data.chainLength() < streamFrame->len) {
+      return;
+    }
+    frames.push_back(FecSourceFrame{
+        streamFrame->streamId,
+        streamFrame->offset,
+        itr->second->data.front(),
+        streamFrame->len,
+        streamFrame->fin});
+  }
+  if (frames.empty()) {
+    return;
+  }
+  auto symbol = encodeFecSourceSymbol(frames);
+  uint64_t overhead = kMaxFecRepairPacketOverhead + kMaxFecRepairFrameOverhead;
+  if (!symbol || conn.udpSendPacketLen < overhead ||
+      symbol->length() > conn.udpSendPacketLen - overhead) {
+    // It wouldn't fit in the repair frame.
+    return;
+  }
+
+  auto& fecState = conn.fecState;
+  auto packetNum = packet.header.getPacketSequenceNum();
+  if (fecState.sourcePacketMask != 0 &&
+      packetNum - fecState.firstSourcePacket >= kMaxFecWindowSize) {
+    flushFecRepair(conn);
+  }
+  if (fecState.sourcePacketMask == 0) {
+    fecState.firstSourcePacket = packetNum;
+    fecState.repairSymbol = std::move(symbol);
+  } else {
+    xorInto(*fecState.repairSymbol, *symbol);
+  }
+  fecState.sourcePacketMask |= 1ULL << (packetNum - fecState.firstSourcePacket);
+  uint64_t windowSize = std::min<uint64_t>(
+      conn.transportSettings.fecWindowSize, kMaxFecWindowSize);
+  if (folly::popcount(fecState.sourcePacketMask) >= windowSize) {
+    flushFecRepair(conn);
+  }
+}
+
+void flushFecRepair(QuicConnectionStateBase& conn) {
+  auto& fecState = conn.fecState;
+  if (fecState.sourcePacketMask == 0) {
+    return;
+  }
+  conn.pendingEvents.frames.emplace_back(RepairFrame(
+      fecState.firstSourcePacket,
+      fecState.sourcePacketMask,
+      std::move(fecState.repairSymbol)));
+  fecState.sourcePacketMask = 0;
+  fecState.repairSymbol = nullptr;
+}
+
+void onFecSourcePacketReceived(
+    QuicConnectionStateBase& conn,
+    PacketNum packetNum,
+    const RegularQuicPacket& packet) {
+  if (!conn.transportSettings.advertiseFecSupport) {
+    return;
+  }
+  std::vector<FecSourceFrame> frames;
+  for (const auto& frame : packet.frames) {
+    const ReadStreamFrame* streamFrame = frame.asReadStreamFrame();
+    if (streamFrame) {
+      frames.push_back(FecSourceFrame{
+          streamFrame->streamId,
+          streamFrame->offset,
+          streamFrame->data.get(),
+          streamFrame->data ? streamFrame->data->computeChainDataLength() : 0,
+          streamFrame->fin});
+    }
+  }
+  if (frames.empty()) {
+    return;
+  }
+  auto symbol = encodeFecSourceSymbol(frames);
+  if (!symbol) {
+    return;
+  }
+  auto& symbols = conn.fecState.receivedSymbols;
+  auto itr = findSymbol(symbols, packetNum);
+  if (itr != symbols.end() && itr->first == packetNum) {
+    // Recovered already.
+    return;
+  }
+  symbols.emplace(itr, packetNum, std::move(symbol));
+  while (symbols.size() > kMaxFecReceivedSymbols) {
+    conn.fecState.largestDroppedSymbol = symbols.front().first;
+    symbols.pop_front();
+  }
+}
+
+void onFecRepairFrameReceived(
+    QuicConnectionStateBase& conn,
+    const RepairFrame& frame) {
+  auto& fecState = conn.fecState;
+  auto& dropped = fecState.largestDroppedSymbol;
+  if (!frame.symbol || (dropped && frame.firstPacketNum <= *dropped)) {
+    return;
+  }
+  auto& symbols = fecState.receivedSymbols;
+  auto recovered = copySymbol(*frame.symbol);
+  folly::Optional<PacketNum> missing;
+  for (unsigned i = 0; i < kMaxFecWindowSize; ++i) {
+    if (!(frame.packetMask & (1ULL << i))) {
+      continue;
+    }
+    PacketNum packetNum = frame.firstPacketNum + i;
+    auto itr = findSymbol(symbols, packetNum);
+    if (itr == symbols.end() || itr->first != packetNum) {
+      if (missing) {
+        // More than one is lost, this repair is no use.
+        return;
+      }
+      missing = packetNum;
+      continue;
+    }
+    if (itr->second->computeChainDataLength() > recovered->length()) {
+      VLOG(4) << "FEC source symbol longer than repair symbol " << conn;
+      return;
+    }
+    xorInto(*recovered, *itr->second);
+  }
+  if (!missing) {
+    return;
+  }
+  auto frames = decodeFecSourceSymbol(*recovered);
+  if (!frames) {
+    VLOG(4) << "Bad FEC repair for packet " << *missing << " " << conn;
+    return;
+  }
+  folly::io::Cursor cursor(recovered.get());
+  recovered->trimEnd(
+      recovered->length() - sizeof(uint16_t) - cursor.readBE<uint16_t>());
+  symbols.emplace(
+      findSymbol(symbols, *missing), *missing, std::move(recovered));
+  ++fecState.numRecoveredPackets;
+  VLOG(10) << "Recovered packet " << *missing << " from FEC repair " << conn;
+  for (auto& streamFrame : *frames) {
+    auto stream = conn.streamManager->getStream(streamFrame.streamId);
+    // Ignore data from closed streams that we don't have the state for any
+    // more.
+    if (stream) {
+      receiveReadStreamFrameSMHandler(*stream, std::move(streamFrame));
+    }
+  }
+}
+
+} // namespace quic
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/codec/Types.h>
+#include <quic/state/StateData.h>
+
+namespace quic {
+
+/**
+ * Forward error correction of the stream data in 1-RTT packets, so that a
+ * lost packet can be rebuilt instead of waiting for its retransmission.
+ *
+ * Each packet with stream data is a source symbol: a 2 byte length of what
+ * follows, then for each of its stream frames the stream id, offset and
+ * length as quic integers, a byte for the fin, and the data. Sender and
+ * receiver both build it from the frames, the encryption and the header
+ * don't come into it. Every fecWindowSize source packets the sender sends a
+ * FEC_REPAIR frame with the XOR of their symbols, the shorter ones padded
+ * with zeroes, and which packets they were. Once the receiver has all of
+ * them but one, XORing the ones it has into the repair symbol leaves the
+ * missing one, whose stream frames are read as if they had arrived.
+ */
+
+struct FecSourceFrame {
+  StreamId streamId;
+  uint64_t offset;
+  // The stream data, which may be longer than len.
+  const folly::IOBuf* data;
+  uint64_t len;
+  bool fin;
+};
+
+Buf encodeFecSourceSymbol(const std::vector<FecSourceFrame>& frames);
+
+/**
+ * Returns the stream frames of a source symbol, or folly::none if it isn't
+ * one. Padding past the length of the symbol is ignored.
+ */
+folly::Optional<std::vector<ReadStreamFrame>> decodeFecSourceSymbol(
+    const folly::IOBuf& symbol);
+
+/**
+ * XORs the source symbol of a packet that was just sent into the repair
+ * symbol being built, and queues a FEC_REPAIR frame once it covers enough
+ * packets. Packets whose stream data isn't all in the retransmission buffers,
+ * or whose symbol wouldn't fit in a packet, aren't covered.
+ */
+void onFecSourcePacketSent(
+    QuicConnectionStateBase& conn,
+    const RegularQuicWritePacket& packet);
+
+/**
+ * Queues a FEC_REPAIR frame for the packets covered so far, if any, e.g.
+ * when there is nothing more to send for a while.
+ */
+void flushFecRepair(QuicConnectionStateBase& conn);
+
+/**
+ * Keeps the source symbol of a 1-RTT packet that was received, for the
+ * FEC_REPAIR frames that cover it.
+ */
+void onFecSourcePacketReceived(
+    QuicConnectionStateBase& conn,
+    PacketNum packetNum,
+    const RegularQuicPacket& packet);
+
+/**
+ * Rebuilds the packet a FEC_REPAIR frame covers if it is the only one of them
+ * that didn't arrive, and reads its stream frames.
+ */
+void onFecRepairFrameReceived(
+    QuicConnectionStateBase& conn,
+    const RepairFrame& frame);
+
+} // namespace quic
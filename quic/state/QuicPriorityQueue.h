@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/state/RoundRobinStreamSet.h>
+
+#include <glog/logging.h>
+#include <array>
+
+namespace quic {
+
+// Stream priorities follow the HTTP/3 extensible priority scheme: there are
+// kNumPriorityUrgencies urgency levels, 0 being the most urgent one.
+using PriorityUrgency = uint8_t;
+constexpr PriorityUrgency kNumPriorityUrgencies = 8;
+
+struct Priority {
+  PriorityUrgency urgency;
+  // Whether the stream's data can be interleaved with other streams of the
+  // same urgency (round robin), or is better delivered in one go (sequential).
+  bool incremental;
+
+  constexpr Priority(PriorityUrgency urgencyIn, bool incrementalIn)
+      : urgency(urgencyIn), incremental(incrementalIn) {}
+
+  bool operator==(const Priority& other) const {
+    return urgency == other.urgency && incremental == other.incremental;
+  }
+
+  bool operator!=(const Priority& other) const {
+    return !(*this == other);
+  }
+};
+
+// Streams are incremental by default, which keeps plain round robin between
+// streams that never had a priority set.
+constexpr Priority kDefaultPriority(3, true);
+
+/**
+ * Writable streams bucketed by priority. Each bucket is a RoundRobinStreamSet,
+ * so adding, removing and moving a stream between priorities are all O(1).
+ * Buckets are ordered by urgency first. Within one urgency, sequential streams
+ * are served before incremental ones.
+ */
+class PriorityQueue {
+ public:
+  static constexpr size_t kNumLevels = kNumPriorityUrgencies * 2;
+
+  bool insert(StreamId id, const Priority& priority) {
+    if (!level(priority).insert(id)) {
+      return false;
+    }
+    ++size_;
+    return true;
+  }
+
+  bool erase(StreamId id, const Priority& priority) {
+    if (!level(priority).erase(id)) {
+      return false;
+    }
+    --size_;
+    return true;
+  }
+
+  bool contains(StreamId id, const Priority& priority) const {
+    return level(priority).contains(id);
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  void clear() {
+    for (auto& level : levels_) {
+      level.clear();
+    }
+    size_ = 0;
+  }
+
+  RoundRobinStreamSet& level(const Priority& priority) {
+    return levels_[levelIndex(priority)];
+  }
+
+  const RoundRobinStreamSet& level(const Priority& priority) const {
+    return levels_[levelIndex(priority)];
+  }
+
+  /**
+   * Call the given function on every non empty level, most urgent first, with
+   * whether that level is incremental. Stops once the function returns false.
+   */
+  template <typename Func>
+  void forEachLevel(Func&& func) {
+    for (size_t i = 0; i < kNumLevels; ++i) {
+      if (!levels_[i].empty() && !func(levels_[i], (i % 2) == 1)) {
+        return;
+      }
+    }
+  }
+
+ private:
+  static size_t levelIndex(const Priority& priority) {
+    DCHECK_LT(priority.urgency, kNumPriorityUrgencies);
+    return priority.urgency * 2 + (priority.incremental ? 1 : 0);
+  }
+
+  std::array<RoundRobinStreamSet, kNumLevels> levels_;
+  size_t size_{0};
+};
+
+} // namespace quic
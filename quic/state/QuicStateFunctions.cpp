@@ -10,6 +10,7 @@
 
 #include <quic/common/TimeUtil.h>
 #include <quic/logging/QuicLogger.h>
+#include <quic/state/QuicStreamFunctions.h>
 
 namespace {
 std::deque<quic::OutstandingPacket>::reverse_iterator
@@ -82,6 +83,18 @@ void updateAckSendStateOnRecvPacket(
         ? conn.transportSettings.rxPacketsBeforeAckAfterInit
         : conn.transportSettings.rxPacketsBeforeAckBeforeInit;
   }
+  // The peer's ACK_FREQUENCY only governs the application data space.
+  const auto& ackFrequency = conn.ackFrequencyState.received;
+  if (ackFrequency && &ackState == &conn.ackStates.appDataAckState) {
+    if (pktHasRetransmittableData || ackState.numRxPacketsRecvd) {
+      // The packet counters are narrow, so cap what the peer asks for.
+      thresh = std::min(
+          ackFrequency->packetTolerance, kMaxAckFrequencyPacketTolerance);
+    }
+    if (ackFrequency->ignoreOrder) {
+      pktOutOfOrder = false;
+    }
+  }
   if (pktHasRetransmittableData) {
     if (pktHasCryptoData || pktOutOfOrder ||
         ++ackState.numRxPacketsRecvd + ackState.numNonRxPacketsRecvd >=
@@ -151,11 +164,41 @@ void updateAckSendStateOnSentPacketWithAcks(
   ackState.largestAckScheduled = largestAckScheduled;
 }
 
+bool isDuplicatePacket(const AckState& ackState, PacketNum packetNum) {
+  if (!ackState.largestReceivedPacketNum ||
+      packetNum > *ackState.largestReceivedPacketNum) {
+    return false;
+  }
+  if (ackState.receivedPackets.inWindow(packetNum)) {
+    return ackState.receivedPackets.contains(packetNum);
+  }
+  auto it = std::lower_bound(
+      ackState.acks.cbegin(),
+      ackState.acks.cend(),
+      packetNum,
+      [](const AckBlocks::interval_type& interval, PacketNum num) {
+        return interval.end < num;
+      });
+  return it != ackState.acks.cend() && it->start <= packetNum;
+}
+
+void limitAckRanges(AckState& ackState, uint64_t maxRanges) {
+  if (ackState.acks.size() <= maxRanges) {
+    return;
+  }
+  auto dropUpTo = std::prev(ackState.acks.cend(), maxRanges + 1)->end;
+  ackState.acks.withdraw({0, dropUpTo});
+}
+
 bool isConnectionPaced(const QuicConnectionStateBase& conn) noexcept {
   return (
       conn.transportSettings.pacingEnabled && conn.canBePaced && conn.pacer);
 }
 
+bool isConnectionPacedByTxTime(const QuicConnectionStateBase& conn) noexcept {
+  return conn.transportSettings.pacingUsesTxTime && isConnectionPaced(conn);
+}
+
 AckState& getAckState(
     QuicConnectionStateBase& conn,
     PacketNumberSpace pnSpace) noexcept {
@@ -275,6 +318,36 @@ bool hasReceivedPackets(const QuicConnectionStateBase& conn) noexcept {
       conn.ackStates.appDataAckState.largestReceivedPacketNum;
 }
 
+void addSentPayload(
+    QuicConnectionStateBase& conn,
+    PacketNum packetNum,
+    Buf body) {
+  DCHECK(
+      conn.sentPayloads.empty() || conn.sentPayloads.back().first < packetNum);
+  conn.sentPayloads.emplace_back(packetNum, std::move(body));
+  const auto maxSize = conn.transportSettings.sentPayloadCacheSize;
+  while (conn.sentPayloads.size() > maxSize) {
+    if (conn.bufArena) {
+      conn.bufArena->recycle(std::move(conn.sentPayloads.front().second));
+    }
+    conn.sentPayloads.pop_front();
+  }
+}
+
+const folly::IOBuf* findSentPayload(
+    const QuicConnectionStateBase& conn,
+    PacketNum packetNum) {
+  auto it = std::lower_bound(
+      conn.sentPayloads.begin(),
+      conn.sentPayloads.end(),
+      packetNum,
+      [](const auto& payload, PacketNum num) { return payload.first < num; });
+  if (it == conn.sentPayloads.end() || it->first != packetNum) {
+    return nullptr;
+  }
+  return it->second.get();
+}
+
 folly::Optional<TimePoint>& getLossTime(
     QuicConnectionStateBase& conn,
     PacketNumberSpace pnSpace) noexcept {
@@ -311,4 +384,182 @@ std::pair<folly::Optional<TimePoint>, PacketNumberSpace> earliestTimeAndSpace(
   return res;
 }
 
+void handleDatagram(QuicConnectionStateBase& conn, DatagramFrame& frame) {
+  auto maxFrameSize = conn.transportSettings.maxDatagramFrameSize;
+  if (maxFrameSize == 0) {
+    throw QuicTransportException(
+        "Received DATAGRAM frame without advertising support",
+        TransportErrorCode::PROTOCOL_VIOLATION,
+        FrameType::DATAGRAM);
+  }
+  // The limit covers the whole frame, which we can only bound from above
+  // without its encoding.
+  if (frame.length > maxFrameSize) {
+    throw QuicTransportException(
+        "DATAGRAM frame too large",
+        TransportErrorCode::PROTOCOL_VIOLATION,
+        FrameType::DATAGRAM);
+  }
+  auto& readBuffer = conn.datagramState.readBuffer;
+  if (readBuffer.size() >= conn.transportSettings.datagramReadBufferSize) {
+    if (readBuffer.empty()) {
+      return;
+    }
+    readBuffer.pop_front();
+  }
+  readBuffer.emplace_back(std::move(frame.data));
+}
+
+void discardPacketNumberSpace(
+    QuicConnectionStateBase& conn,
+    PacketNumberSpace pnSpace) {
+  QuicCryptoStream* cryptoStream;
+  switch (pnSpace) {
+    case PacketNumberSpace::Initial:
+      if (!conn.initialWriteCipher &&
+          (!conn.readCodec || !conn.readCodec->getInitialCipher())) {
+        return;
+      }
+      conn.initialWriteCipher = nullptr;
+      conn.initialHeaderCipher = nullptr;
+      if (conn.readCodec) {
+        conn.readCodec->setInitialReadCipher(nullptr);
+        conn.readCodec->setInitialHeaderCipher(nullptr);
+      }
+      cryptoStream = &conn.cryptoState->initialStream;
+      break;
+    case PacketNumberSpace::Handshake:
+      if (!conn.handshakeWriteCipher &&
+          (!conn.readCodec || !conn.readCodec->getHandshakeReadCipher())) {
+        return;
+      }
+      conn.handshakeWriteCipher = nullptr;
+      conn.handshakeWriteHeaderCipher = nullptr;
+      if (conn.readCodec) {
+        conn.readCodec->setHandshakeReadCipher(nullptr);
+        conn.readCodec->setHandshakeHeaderCipher(nullptr);
+      }
+      cryptoStream = &conn.cryptoState->handshakeStream;
+      break;
+    case PacketNumberSpace::AppData:
+      LOG(FATAL) << "AppData keys can't be discarded";
+      return;
+  }
+  VLOG(10) << nodeToString(conn.nodeType) << " discarding " << pnSpace
+           << " keys " << conn;
+
+  uint64_t bytesInFlight = 0;
+  auto itr = conn.outstandingPackets.begin();
+  while (itr != conn.outstandingPackets.end()) {
+    if (itr->packet.header.getPacketNumberSpace() != pnSpace) {
+      ++itr;
+      continue;
+    }
+    bytesInFlight += itr->encodedSize;
+    if (itr->isHandshake) {
+      DCHECK(conn.outstandingHandshakePacketsCount);
+      --conn.outstandingHandshakePacketsCount;
+    }
+    itr = conn.outstandingPackets.erase(itr);
+  }
+  if (conn.congestionController && bytesInFlight > 0) {
+    conn.congestionController->onRemoveBytesFromInflight(bytesInFlight);
+  }
+
+  // Nothing more will be sent or acked in the space.
+  auto& ackState = getAckState(conn, pnSpace);
+  ackState.acks = AckBlocks();
+  ackState.needsToSendAckImmediately = false;
+  ackState.numRxPacketsRecvd = 0;
+  ackState.numNonRxPacketsRecvd = 0;
+  conn.lossState.lossTimes[pnSpace] = folly::none;
+  releaseCryptoStream(*cryptoStream);
+}
+
+ProtectionType getOneRttWriteKeyPhase(const QuicConnectionStateBase& conn) {
+  return conn.oneRttKeyUpdateState.writeKeyGeneration % 2
+      ? ProtectionType::KeyPhaseOne
+      : ProtectionType::KeyPhaseZero;
+}
+
+void updateOneRttKeys(QuicConnectionStateBase& conn) {
+  if (!conn.handshakeLayer || !conn.oneRttWriteCipher || !conn.readCodec ||
+      !conn.readCodec->getOneRttReadCipher()) {
+    return;
+  }
+  auto& keyUpdateState = conn.oneRttKeyUpdateState;
+  auto readKeyGeneration = conn.readCodec->getOneRttReadKeyGeneration();
+  bool followPeer = readKeyGeneration > keyUpdateState.writeKeyGeneration;
+  // Not before the handshake is done, nor while the peer hasn't followed the
+  // last one or acked a packet with the current keys.
+  auto interval = conn.transportSettings.oneRttKeyUpdatePacketInterval;
+  bool startKeyUpdate = interval > 0 &&
+      keyUpdateState.packetsInWritePhase >= interval &&
+      readKeyGeneration == keyUpdateState.writeKeyGeneration &&
+      conn.readCodec->getHandshakeDoneTime() &&
+      keyUpdateState.firstPacketInWritePhase &&
+      conn.ackStates.appDataAckState.largestAckedByPeer >=
+          *keyUpdateState.firstPacketInWritePhase &&
+      conn.readCodec->getNextOneRttReadCipher();
+  if ((followPeer || startKeyUpdate) && keyUpdateState.nextWriteCipher) {
+    VLOG(10) << nodeToString(conn.nodeType) << " updating 1-RTT write keys "
+             << (followPeer ? "after peer " : "") << conn;
+    if (conn.qLogger) {
+      conn.qLogger->addTransportStateUpdate(kOneRttKeyUpdate);
+    }
+    conn.oneRttWriteCipher = std::move(keyUpdateState.nextWriteCipher);
+    ++keyUpdateState.writeKeyGeneration;
+    keyUpdateState.firstPacketInWritePhase = folly::none;
+    keyUpdateState.packetsInWritePhase = 0;
+  }
+  if (!keyUpdateState.nextWriteCipher) {
+    keyUpdateState.nextWriteCipher =
+        conn.handshakeLayer->getNextOneRttWriteCipher();
+  }
+  if (!conn.readCodec->getNextOneRttReadCipher()) {
+    conn.readCodec->setNextOneRttReadCipher(
+        conn.handshakeLayer->getNextOneRttReadCipher());
+  }
+}
+
+void copyLiveTransportSettings(
+    TransportSettings& settings,
+    const TransportSettings& updated) {
+  settings.pacingEnabled = updated.pacingEnabled;
+  settings.minBurstPackets = updated.minBurstPackets;
+  settings.pacingTimerTickInterval = updated.pacingTimerTickInterval;
+  settings.defaultCongestionController = updated.defaultCongestionController;
+  settings.minCwndInMss = updated.minCwndInMss;
+  settings.maxCwndInMss = updated.maxCwndInMss;
+  settings.bbrConfig = updated.bbrConfig;
+  settings.cubicConfig = updated.cubicConfig;
+  settings.copaConfig = updated.copaConfig;
+  settings.writeConnectionDataPacketsLimit =
+      updated.writeConnectionDataPacketsLimit;
+  settings.writeLimitRttFraction = updated.writeLimitRttFraction;
+  settings.loopWorkBudget = updated.loopWorkBudget;
+  settings.maxBatchSize = updated.maxBatchSize;
+  settings.rxPacketsBeforeAckInitThreshold =
+      updated.rxPacketsBeforeAckInitThreshold;
+  settings.rxPacketsBeforeAckBeforeInit = updated.rxPacketsBeforeAckBeforeInit;
+  settings.rxPacketsBeforeAckAfterInit = updated.rxPacketsBeforeAckAfterInit;
+}
+
+void compactIdleConnection(QuicConnectionStateBase& conn) {
+  if (conn.streamManager) {
+    conn.streamManager->shrinkToFit();
+  }
+  if (conn.cryptoState) {
+    conn.cryptoState->initialStream.shrinkToFit();
+    conn.cryptoState->handshakeStream.shrinkToFit();
+    conn.cryptoState->oneRttStream.shrinkToFit();
+  }
+  conn.outstandingPackets.shrink_to_fit();
+  if (conn.readCodec) {
+    conn.readCodec->releaseFrameBuffer();
+  }
+  conn.datagramState.readBuffer.shrink_to_fit();
+  conn.datagramState.writeBuffer.shrink_to_fit();
+}
+
 } // namespace quic
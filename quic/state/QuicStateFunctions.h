@@ -36,6 +36,9 @@ void updateRtt(
 
 bool isConnectionPaced(const QuicConnectionStateBase& conn) noexcept;
 
+// Whether the connection is paced by the kernel through SCM_TXTIME.
+bool isConnectionPacedByTxTime(const QuicConnectionStateBase& conn) noexcept;
+
 AckState& getAckState(
     QuicConnectionStateBase& conn,
     PacketNumberSpace pnSpace) noexcept;
@@ -56,14 +59,16 @@ void increaseNextPacketNum(
     PacketNumberSpace pnSpace) noexcept;
 
 /**
- * Update largestReceivedPacketNum in ackState with packetNum. Return if the
- * current packetNum is received out of order.
+ * Update largestReceivedPacketNum in ackState with packetNum, and count the ECN
+ * codepoint the packet arrived with. Return if the current packetNum is
+ * received out of order.
  */
 template <typename ClockType = quic::Clock>
 bool updateLargestReceivedPacketNum(
     AckState& ackState,
     PacketNum packetNum,
-    TimePoint receivedTime) {
+    TimePoint receivedTime,
+    EcnCodepoint ecn = EcnCodepoint::NotEct) {
   PacketNum expectedNextPacket = 0;
   if (ackState.largestReceivedPacketNum) {
     expectedNextPacket = *ackState.largestReceivedPacketNum + 1;
@@ -71,6 +76,20 @@ bool updateLargestReceivedPacketNum(
   ackState.largestReceivedPacketNum = std::max<PacketNum>(
       ackState.largestReceivedPacketNum.value_or(packetNum), packetNum);
   ackState.acks.insert(packetNum);
+  ackState.receivedPackets.insert(packetNum);
+  switch (ecn) {
+    case EcnCodepoint::Ect0:
+      ackState.ecnCounts.ect0++;
+      break;
+    case EcnCodepoint::Ect1:
+      ackState.ecnCounts.ect1++;
+      break;
+    case EcnCodepoint::Ce:
+      ackState.ecnCounts.ce++;
+      break;
+    case EcnCodepoint::NotEct:
+      break;
+  }
   if (ackState.largestReceivedPacketNum == packetNum) {
     ackState.largestRecvdPacketTime = receivedTime;
   }
@@ -78,6 +97,18 @@ bool updateLargestReceivedPacketNum(
   return expectedNextPacket != packetNum;
 }
 
+/**
+ * Whether packetNum was received already in the space of ackState. This is a
+ * bitmap lookup near the largest received packet number, further below only
+ * what is left in ackState.acks is known.
+ */
+bool isDuplicatePacket(const AckState& ackState, PacketNum packetNum);
+
+/**
+ * Drops the oldest ranges of ackState.acks until at most maxRanges are left.
+ */
+void limitAckRanges(AckState& ackState, uint64_t maxRanges);
+
 std::deque<OutstandingPacket>::iterator getNextOutstandingPacket(
     QuicConnectionStateBase& conn,
     PacketNumberSpace packetNumberSpace,
@@ -92,6 +123,23 @@ std::deque<OutstandingPacket>::reverse_iterator getLastOutstandingPacket(
 
 bool hasReceivedPackets(const QuicConnectionStateBase& conn) noexcept;
 
+/**
+ * Keeps body as the plaintext of the AppData packet packetNum, dropping the
+ * oldest one past TransportSettings::sentPayloadCacheSize.
+ */
+void addSentPayload(
+    QuicConnectionStateBase& conn,
+    PacketNum packetNum,
+    Buf body);
+
+/**
+ * The plaintext body kept for the AppData packet packetNum, null if there is
+ * none.
+ */
+const folly::IOBuf* findSentPayload(
+    const QuicConnectionStateBase& conn,
+    PacketNum packetNum);
+
 bool hasReceivedPacketsAtLastCloseSent(
     const QuicConnectionStateBase& conn) noexcept;
 
@@ -113,4 +161,53 @@ std::pair<folly::Optional<TimePoint>, PacketNumberSpace> earliestLossTimer(
 std::pair<folly::Optional<TimePoint>, PacketNumberSpace> earliestTimeAndSpace(
     const EnumArray<PacketNumberSpace, folly::Optional<TimePoint>>& times,
     bool considerAppData) noexcept;
+
+/**
+ * Buffers a received DATAGRAM frame for the app, dropping the oldest buffered
+ * datagram if the read buffer is full. Throws if we did not advertise support
+ * for DATAGRAM frames or the frame is larger than we advertised.
+ */
+void handleDatagram(QuicConnectionStateBase& conn, DatagramFrame& frame);
+
+/**
+ * Discards the keys of the Initial or Handshake packet number space (RFC
+ * 9001, section 4.9), and with them everything else kept for it: its ack
+ * state, loss timer and crypto stream. Its outstanding packets are taken out
+ * of the bytes in flight without being declared lost.
+ */
+void discardPacketNumberSpace(
+    QuicConnectionStateBase& conn,
+    PacketNumberSpace pnSpace);
+
+/**
+ * The key phase to write 1-RTT packets in.
+ */
+ProtectionType getOneRttWriteKeyPhase(const QuicConnectionStateBase& conn);
+
+/**
+ * Keeps 1-RTT key updates (RFC 9001, section 6) going after reading packets.
+ * The write keys follow a key update the peer started, and we start one once
+ * the write keys have protected oneRttKeyUpdatePacketInterval packets. The
+ * ciphers of the next key phase are derived here too, ahead of the packets
+ * that need them.
+ */
+void updateOneRttKeys(QuicConnectionStateBase& conn);
+
+/**
+ * Copies the fields of updated which can change on a live connection into
+ * settings: pacing, congestion control parameters, write limits, the batch
+ * size and the ack thresholds. The others only take effect on new
+ * connections.
+ */
+void copyLiveTransportSettings(
+    TransportSettings& settings,
+    const TransportSettings& updated);
+
+/**
+ * Gives back the storage that the containers of an idle connection grew to
+ * for its past peaks: its streams and their buffers, the crypto streams,
+ * the outstanding packets and the read codec's frames. Nothing is lost, the
+ * containers grow again with the next packets.
+ */
+void compactIdleConnection(QuicConnectionStateBase& conn);
 } // namespace quic
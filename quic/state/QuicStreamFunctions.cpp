@@ -12,6 +12,7 @@
 #include <quic/logging/QuicLogger.h>
 #include <quic/state/QuicStreamUtilities.h>
 
+#include <folly/Function.h>
 #include <folly/io/Cursor.h>
 #include <algorithm>
 
@@ -27,7 +28,11 @@ void prependToBuf(quic::Buf& buf, quic::Buf toAppend) {
 
 namespace quic {
 
-void writeDataToQuicStream(QuicStreamState& stream, Buf data, bool eof) {
+void writeDataToQuicStream(
+    QuicStreamState& stream,
+    Buf data,
+    bool eof,
+    bool mayCopy) {
   uint64_t len = 0;
   if (data) {
     len = data->computeChainDataLength();
@@ -37,7 +42,12 @@ void writeDataToQuicStream(QuicStreamState& stream, Buf data, bool eof) {
     // write a blocked frame first time the stream becomes blocked
     maybeWriteBlockAfterAPIWrite(stream);
   }
-  stream.writeBuffer.append(std::move(data));
+  auto chunkSize = stream.conn.transportSettings.writeBufferChunkSize;
+  if (chunkSize > 0 && mayCopy) {
+    stream.writeBuffer.append(std::move(data), chunkSize);
+  } else {
+    stream.writeBuffer.append(std::move(data));
+  }
   if (eof) {
     auto bufferSize =
         stream.writeBuffer.front() ? stream.writeBuffer.chainLength() : 0;
@@ -113,6 +123,18 @@ void appendDataToReadBufferCommon(
     return;
   }
 
+  // Data that arrives in order, or past every hole, only touches the last
+  // buffer, so skip the search.
+  auto& lastBuffer = readBuffer.back();
+  auto lastBufferEnd = lastBuffer.offset + lastBuffer.data.chainLength();
+  if (buffer.offset > lastBufferEnd) {
+    readBuffer.emplace_back(std::move(buffer));
+    return;
+  } else if (buffer.offset == lastBufferEnd) {
+    lastBuffer.data.append(std::move(buffer.data));
+    return;
+  }
+
   // Start overlap will point to the first buffer that overlaps with the
   // current buffer and End overlap will point to the last buffer that overlaps.
   // They must always be set together.
@@ -149,7 +171,7 @@ void appendDataToReadBufferCommon(
       // Left overlap. Done.
       it->data.trimStartAtMost(currentEnd - it->offset);
       if (it->data.chainLength() > 0) {
-        current->data.append(it->data.move());
+        current->data.append(std::move(it->data));
       }
       if (!startOverlap) {
         startOverlap = it;
@@ -174,7 +196,7 @@ void appendDataToReadBufferCommon(
         currentEnd > itEnd) {
       // Right overlap. Not done.
       current->data.trimStartAtMost(itEnd - current->offset);
-      it->data.append(current->data.move());
+      it->data.append(std::move(current->data));
       current = &(*it);
       currentAlreadyInserted = true;
       DCHECK(!startOverlap);
@@ -213,6 +235,9 @@ void appendDataToReadBuffer(QuicStreamState& stream, StreamBuffer buffer) {
         updateFlowControlOnStreamData(
             stream, previousMaxOffsetObserved, bufferEndOffset);
       });
+  if (stream.appReadBuffer) {
+    fillAppReadBuffer(stream);
+  }
 }
 
 void appendDataToReadBuffer(QuicCryptoStream& stream, StreamBuffer buffer) {
@@ -220,13 +245,18 @@ void appendDataToReadBuffer(QuicCryptoStream& stream, StreamBuffer buffer) {
       stream, std::move(buffer), [](uint64_t, uint64_t) {});
 }
 
-std::pair<Buf, bool> readDataInOrderFromReadBuffer(
+namespace {
+/**
+ * Reads up to amount bytes in order from the read buffer, handing each slice
+ * of a read buffer entry to sink, or dropping it when sink is nullptr. Returns
+ * whether the FIN for the stream was read.
+ */
+bool readInOrderFromReadBuffer(
     QuicStreamLike& stream,
     uint64_t amount,
-    bool sinkData) {
+    folly::FunctionRef<void(Buf)>* sink) {
   auto remaining = amount;
   bool eof = false;
-  Buf data;
   while ((amount == 0 || remaining != 0) && !stream.readBuffer.empty()) {
     auto curr = stream.readBuffer.begin();
     if (curr->offset > stream.currentReadOffset) {
@@ -245,7 +275,7 @@ std::pair<Buf, bool> readDataInOrderFromReadBuffer(
     uint64_t toRead =
         std::min<uint64_t>(currSize, amount == 0 ? currSize : remaining);
     std::unique_ptr<folly::IOBuf> splice;
-    if (sinkData) {
+    if (!sink) {
       curr->data.trimStart(toRead);
     } else {
       splice = curr->data.splitAtMost(toRead);
@@ -256,24 +286,26 @@ std::pair<Buf, bool> readDataInOrderFromReadBuffer(
       eof = curr->eof;
       stream.readBuffer.pop_front();
     }
-    if (!sinkData) {
-      prependToBuf(data, std::move(splice));
+    if (sink) {
+      (*sink)(std::move(splice));
     }
     if (amount != 0) {
       remaining -= toRead;
     }
     stream.currentReadOffset += toRead;
   }
-  return std::make_pair(std::move(data), eof);
-}
-
-Buf readDataFromCryptoStream(QuicCryptoStream& stream, uint64_t amount) {
-  return readDataInOrderFromReadBuffer(stream, amount).first;
+  return eof;
 }
 
-std::pair<Buf, bool> readDataFromQuicStream(
+/**
+ * Reads from a QUIC stream with readFn, which reads up to amount bytes from
+ * the read buffer and returns whether it read the FIN, and does the flow
+ * control and eof bookkeeping common to all the reads. Returns whether EOF
+ * was reached.
+ */
+bool readFromQuicStreamCommon(
     QuicStreamState& stream,
-    uint64_t amount) {
+    folly::FunctionRef<void()> readFn) {
   auto eof = stream.finalReadOffset &&
       stream.currentReadOffset >= *stream.finalReadOffset;
   if (eof) {
@@ -282,13 +314,11 @@ std::pair<Buf, bool> readDataFromQuicStream(
     }
     stream.conn.streamManager->updateReadableStreams(stream);
     stream.conn.streamManager->updatePeekableStreams(stream);
-    return std::make_pair(nullptr, true);
+    return true;
   }
 
   uint64_t lastReadOffset = stream.currentReadOffset;
-
-  Buf data;
-  std::tie(data, eof) = readDataInOrderFromReadBuffer(stream, amount);
+  readFn();
   // Update flow control before handling eof as eof is not subject to flow
   // control
   updateFlowControlOnRead(stream, lastReadOffset, Clock::now());
@@ -299,9 +329,97 @@ std::pair<Buf, bool> readDataFromQuicStream(
   }
   stream.conn.streamManager->updateReadableStreams(stream);
   stream.conn.streamManager->updatePeekableStreams(stream);
+  return eof;
+}
+} // namespace
+
+std::pair<Buf, bool> readDataInOrderFromReadBuffer(
+    QuicStreamLike& stream,
+    uint64_t amount,
+    bool sinkData) {
+  Buf data;
+  if (sinkData) {
+    auto eof = readInOrderFromReadBuffer(stream, amount, nullptr);
+    return std::make_pair(nullptr, eof);
+  }
+  auto append = [&](Buf splice) { prependToBuf(data, std::move(splice)); };
+  folly::FunctionRef<void(Buf)> sink(append);
+  auto eof = readInOrderFromReadBuffer(stream, amount, &sink);
+  return std::make_pair(std::move(data), eof);
+}
+
+Buf readDataFromCryptoStream(QuicCryptoStream& stream, uint64_t amount) {
+  return readDataInOrderFromReadBuffer(stream, amount).first;
+}
+
+std::pair<Buf, bool> readDataFromQuicStream(
+    QuicStreamState& stream,
+    uint64_t amount) {
+  Buf data;
+  auto eof = readFromQuicStreamCommon(stream, [&] {
+    data = readDataInOrderFromReadBuffer(stream, amount).first;
+  });
   return std::make_pair(std::move(data), eof);
 }
 
+std::pair<std::vector<Buf>, bool> readSlicesFromQuicStream(
+    QuicStreamState& stream,
+    uint64_t amount) {
+  std::vector<Buf> slices;
+  auto append = [&](Buf splice) {
+    // Unchain the IOBufs of each packet instead of chaining the packets.
+    while (splice) {
+      auto rest = splice->pop();
+      if (!splice->empty()) {
+        slices.push_back(std::move(splice));
+      }
+      splice = std::move(rest);
+    }
+  };
+  folly::FunctionRef<void(Buf)> sink(append);
+  auto eof = readFromQuicStreamCommon(
+      stream, [&] { readInOrderFromReadBuffer(stream, amount, &sink); });
+  return std::make_pair(std::move(slices), eof);
+}
+
+void fillAppReadBuffer(QuicStreamState& stream) {
+  CHECK(stream.appReadBuffer);
+  auto& appReadBuffer = *stream.appReadBuffer;
+  auto space = appReadBuffer.buffer.size() - appReadBuffer.filled;
+  if (space == 0) {
+    return;
+  }
+  uint64_t lastReadOffset = stream.currentReadOffset;
+  auto copy = [&](Buf splice) {
+    auto len = splice->computeChainDataLength();
+    folly::io::Cursor cursor(splice.get());
+    cursor.pull(appReadBuffer.buffer.data() + appReadBuffer.filled, len);
+    appReadBuffer.filled += len;
+  };
+  folly::FunctionRef<void(Buf)> sink(copy);
+  readInOrderFromReadBuffer(stream, space, &sink);
+  if (stream.currentReadOffset == lastReadOffset) {
+    return;
+  }
+  updateFlowControlOnRead(stream, lastReadOffset, Clock::now());
+  stream.conn.streamManager->updateReadableStreams(stream);
+  stream.conn.streamManager->updatePeekableStreams(stream);
+}
+
+std::pair<size_t, bool> takeAppReadBuffer(QuicStreamState& stream) {
+  CHECK(stream.appReadBuffer);
+  auto filled = stream.appReadBuffer->filled;
+  stream.appReadBuffer = folly::none;
+  bool eof = stream.finalReadOffset &&
+      stream.currentReadOffset == *stream.finalReadOffset;
+  if (eof) {
+    stream.currentReadOffset += 1;
+  }
+  stream.conn.streamManager->updateReadableStreams(stream);
+  stream.conn.streamManager->updatePeekableStreams(stream);
+  return std::make_pair(filled, eof);
+}
+
 void peekDataFromQuicStream(
     QuicStreamState& stream,
     const folly::Function<void(StreamId id, const folly::Range<PeekIterator>&)
@@ -408,6 +526,20 @@ void cancelHandshakeCryptoStreamRetransmissions(QuicCryptoState& cryptoState) {
   cryptoState.handshakeStream.lossBuffer.clear();
 }
 
+void releaseCryptoStream(QuicCryptoStream& stream) {
+  // Unlike clear(), swapping with empty containers frees their storage.
+  std::deque<StreamBuffer>().swap(stream.readBuffer);
+  std::deque<StreamBuffer>().swap(stream.lossBuffer);
+  stream.retransmissionBuffer = RetransmissionBuffer();
+  stream.ackedIntervals = QuicStreamLike::AckedIntervals();
+  stream.writeBuffer.move();
+}
+
+void releaseHandshakeCryptoStreams(QuicCryptoState& cryptoState) {
+  releaseCryptoStream(cryptoState.initialStream);
+  releaseCryptoStream(cryptoState.handshakeStream);
+}
+
 QuicCryptoStream* getCryptoStream(
     QuicCryptoState& cryptoState,
     EncryptionLevel encryptionLevel) {
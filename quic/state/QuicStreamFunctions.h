@@ -15,11 +15,17 @@ namespace quic {
 
 /**
  * Adds data to the end of the write buffer of the QUIC stream. This
- * data will be written onto the socket.
+ * data will be written onto the socket. If mayCopy is false the data is
+ * always chained into the write buffer, even if it is smaller than the
+ * writeBufferChunkSize transport setting.
  *
  * @throws QuicTransportException on error.
  */
-void writeDataToQuicStream(QuicStreamState& stream, Buf data, bool eof);
+void writeDataToQuicStream(
+    QuicStreamState& stream,
+    Buf data,
+    bool eof,
+    bool mayCopy = true);
 
 /**
  * Adds data to the end of the write buffer of the QUIC crypto stream. This
@@ -52,6 +58,28 @@ std::pair<Buf, bool> readDataFromQuicStream(
     QuicStreamState& state,
     uint64_t amount = 0);
 
+/**
+ * Same as readDataFromQuicStream, but returns the data as the IOBufs it was
+ * received in, each one unchained and still pointing into the packet it came
+ * in, instead of chaining them into one Buf.
+ */
+std::pair<std::vector<Buf>, bool> readSlicesFromQuicStream(
+    QuicStreamState& state,
+    uint64_t amount = 0);
+
+/**
+ * Copies the in-order data of the stream into its appReadBuffer, as much as
+ * fits, and updates flow control for it. The FIN is left to
+ * takeAppReadBuffer, like it is left to the read functions.
+ */
+void fillAppReadBuffer(QuicStreamState& state);
+
+/**
+ * Unsets the appReadBuffer of the stream, which must be set. Returns how many
+ * bytes were copied into it and whether EOF was reached on the stream.
+ */
+std::pair<size_t, bool> takeAppReadBuffer(QuicStreamState& state);
+
 /**
  * Reads data from the QUIC crypto data if data exists.
  * amount == 0 reads all the pending data in the stream.
@@ -124,6 +152,21 @@ std::pair<Buf, bool> readDataInOrderFromReadBuffer(
  */
 void cancelHandshakeCryptoStreamRetransmissions(QuicCryptoState& cryptoStream);
 
+/**
+ * Frees everything a crypto stream holds once neither side needs its data
+ * any more, including the memory its buffers grew to. The offsets are kept,
+ * so that what the peer sends again is recognized as old.
+ */
+void releaseCryptoStream(QuicCryptoStream& stream);
+
+/**
+ * Frees everything the initial and handshake crypto streams hold once the
+ * handshake is done and neither side needs their data any more, including
+ * the memory their buffers grew to. The offsets are kept, so that what the
+ * peer sends again is recognized as old.
+ */
+void releaseHandshakeCryptoStreams(QuicCryptoState& cryptoState);
+
 /**
  * Returns the appropriate crypto stream for the protection type of the packet.
  */
@@ -12,6 +12,91 @@
 
 namespace quic {
 
+QuicStreamStatePool::~QuicStreamStatePool() {
+  for (auto storage : free_) {
+    ::operator delete(storage);
+  }
+}
+
+QuicStreamStatePool::Ptr QuicStreamStatePool::create(
+    StreamId id,
+    QuicConnectionStateBase& conn) {
+  void* storage;
+  if (free_.empty()) {
+    storage = ::operator new(sizeof(QuicStreamState));
+  } else {
+    storage = free_.back();
+    free_.pop_back();
+  }
+  QuicStreamState* stream;
+  try {
+    stream = new (storage) QuicStreamState(id, conn);
+  } catch (...) {
+    free_.push_back(storage);
+    throw;
+  }
+  return Ptr(stream, Deleter{this});
+}
+
+void QuicStreamStatePool::releaseFree() {
+  for (auto storage : free_) {
+    ::operator delete(storage);
+  }
+  free_.clear();
+  free_.shrink_to_fit();
+}
+
+void QuicStreamStatePool::destroy(QuicStreamState* stream) {
+  stream->~QuicStreamState();
+  if (free_.size() < maxFree_) {
+    free_.push_back(stream);
+  } else {
+    ::operator delete(stream);
+  }
+}
+
+void QuicStreamManager::shrinkToFit() {
+  streamPool_.releaseFree();
+  if (streams_.bucket_count() > 2 * streams_.size()) {
+    // The states stay where they are, only their pointers move.
+    folly::F14FastMap<StreamId, QuicStreamStatePool::Ptr> streams;
+    streams.reserve(streams_.size());
+    for (auto& stream : streams_) {
+      streams.emplace(stream.first, std::move(stream.second));
+    }
+    streams_ = std::move(streams);
+  }
+  for (auto& stream : streams_) {
+    stream.second->shrinkToFit();
+    stream.second->writeDeadlines.shrink_to_fit();
+  }
+  newPeerStreams_.shrink_to_fit();
+  if (blockedStreams_.empty()) {
+    blockedStreams_ = decltype(blockedStreams_)();
+  }
+  if (stopSendingStreams_.empty()) {
+    stopSendingStreams_ = decltype(stopSendingStreams_)();
+  }
+  for (auto set :
+       {&dataExpiredStreams_,
+        &dataRejectedStreams_,
+        &windowUpdates_,
+        &flowControlUpdated_,
+        &lossStreams_,
+        &readableStreams_,
+        &peekableStreams_,
+        &deliverableStreams_,
+        &closedStreams_}) {
+    set->shrinkToFit();
+  }
+}
+
+std::pair<QuicStreamState*, bool> QuicStreamManager::emplaceStream(
+    StreamId streamId) {
+  auto it = streams_.emplace(streamId, streamPool_.create(streamId, conn_));
+  return std::make_pair(it.first->second.get(), it.second);
+}
+
 /**
  * Updates the head of line blocked time for the stream. This should be called
  * on new data received or even data being read from the stream.
@@ -37,10 +122,12 @@ static void updateHolBlockedTime(QuicStreamState& stream) {
     // If we were previously HOL blocked, we're not any more.
     // Update the total HOLB time and reset the latch.
     if (stream.lastHolbTime) {
-      stream.totalHolbTime +=
-          std::chrono::duration_cast<std::chrono::microseconds>(
-              Clock::now() - *stream.lastHolbTime);
+      auto holbTime = std::chrono::duration_cast<std::chrono::microseconds>(
+          Clock::now() - *stream.lastHolbTime);
+      stream.totalHolbTime += holbTime;
       stream.lastHolbTime = folly::none;
+      QUIC_STATS(
+          stream.conn.statsCallback, onStreamHolBlockedDuration, holbTime);
     }
     return;
   }
@@ -53,6 +140,9 @@ static void updateHolBlockedTime(QuicStreamState& stream) {
   // If we were previously not HOL blocked, we are now.
   stream.lastHolbTime = Clock::now();
   stream.holbCount++;
+  if (stream.conn.qLogger) {
+    stream.conn.qLogger->onHolBlocked();
+  }
 }
 
 static bool isStreamUnopened(
@@ -65,7 +155,7 @@ static bool isStreamUnopened(
 // Returns false if the stream is closed or already opened.
 static LocalErrorCode openPeerStreamIfNotClosed(
     StreamId streamId,
-    folly::F14FastSet<StreamId>& openStreams,
+    StreamIdRangeSet& openStreams,
     StreamId& nextAcceptableStreamId,
     StreamId maxStreamId,
     std::vector<StreamId>& newStreams) {
@@ -78,10 +168,9 @@ static LocalErrorCode openPeerStreamIfNotClosed(
 
   StreamId start = nextAcceptableStreamId;
   auto numNewStreams = (streamId - start) / detail::kStreamIncrement;
-  openStreams.reserve(openStreams.size() + numNewStreams);
+  openStreams.insertRange(start, streamId);
   newStreams.reserve(newStreams.size() + numNewStreams);
   while (start <= streamId) {
-    openStreams.emplace(start);
     newStreams.push_back(start);
     start += detail::kStreamIncrement;
   }
@@ -94,7 +183,7 @@ static LocalErrorCode openPeerStreamIfNotClosed(
 
 static LocalErrorCode openLocalStreamIfNotClosed(
     StreamId streamId,
-    folly::F14FastSet<StreamId>& openStreams,
+    StreamIdRangeSet& openStreams,
     StreamId& nextAcceptableStreamId,
     StreamId maxStreamId) {
   if (streamId < nextAcceptableStreamId) {
@@ -104,13 +193,7 @@ static LocalErrorCode openLocalStreamIfNotClosed(
     return LocalErrorCode::STREAM_LIMIT_EXCEEDED;
   }
 
-  StreamId start = nextAcceptableStreamId;
-  auto numNewStreams = (streamId - start) / detail::kStreamIncrement;
-  openStreams.reserve(openStreams.size() + numNewStreams);
-  while (start <= streamId) {
-    openStreams.emplace(start);
-    start += detail::kStreamIncrement;
-  }
+  openStreams.insertRange(nextAcceptableStreamId, streamId);
 
   if (streamId >= nextAcceptableStreamId) {
     nextAcceptableStreamId = streamId + detail::kStreamIncrement;
@@ -139,7 +222,7 @@ QuicStreamState* QuicStreamManager::findStream(StreamId streamId) {
   if (lookup == streams_.end()) {
     return nullptr;
   } else {
-    return &lookup->second;
+    return lookup->second.get();
   }
 }
 
@@ -230,16 +313,13 @@ QuicStreamManager::getOrCreateOpenedLocalStream(StreamId streamId) {
       : openBidirectionalLocalStreams_;
   if (openLocalStreams.count(streamId)) {
     // Open a lazily created stream.
-    auto it = streams_.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(streamId),
-        std::forward_as_tuple(streamId, conn_));
+    auto it = emplaceStream(streamId);
     QUIC_STATS(conn_.statsCallback, onNewQuicStream);
     if (!it.second) {
       throw QuicTransportException(
           "Creating an active stream", TransportErrorCode::STREAM_STATE_ERROR);
     }
-    return &it.first->second;
+    return it.first;
   }
   return nullptr;
 }
@@ -252,7 +332,7 @@ QuicStreamState* QuicStreamManager::getStream(StreamId streamId) {
   }
   auto it = streams_.find(streamId);
   if (it != streams_.end()) {
-    return &it->second;
+    return it->second.get();
   }
   auto stream = getOrCreateOpenedLocalStream(streamId);
   auto nextAcceptableStreamId = isUnidirectionalStream(streamId)
@@ -313,19 +393,16 @@ QuicStreamManager::getOrCreatePeerStream(StreamId streamId) {
   // TODO when we can rely on C++17, this is a good candidate for try_emplace.
   auto peerStream = streams_.find(streamId);
   if (peerStream != streams_.end()) {
-    return &peerStream->second;
+    return peerStream->second.get();
   }
   auto& openPeerStreams = isUnidirectionalStream(streamId)
       ? openUnidirectionalPeerStreams_
       : openBidirectionalPeerStreams_;
   if (openPeerStreams.count(streamId)) {
     // Stream was already open, create the state for it lazily.
-    auto it = streams_.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(streamId),
-        std::forward_as_tuple(streamId, conn_));
+    auto it = emplaceStream(streamId);
     QUIC_STATS(conn_.statsCallback, onNewQuicStream);
-    return &it.first->second;
+    return it.first;
   }
 
   auto& nextAcceptableStreamId = isUnidirectionalStream(streamId)
@@ -348,12 +425,9 @@ QuicStreamManager::getOrCreatePeerStream(StreamId streamId) {
         "Exceeded stream limit.", TransportErrorCode::STREAM_LIMIT_ERROR);
   }
 
-  auto it = streams_.emplace(
-      std::piecewise_construct,
-      std::forward_as_tuple(streamId),
-      std::forward_as_tuple(streamId, conn_));
+  auto it = emplaceStream(streamId);
   QUIC_STATS(conn_.statsCallback, onNewQuicStream);
-  return &it.first->second;
+  return it.first;
 }
 
 folly::Expected<QuicStreamState*, LocalErrorCode>
@@ -386,13 +460,10 @@ QuicStreamManager::createStream(StreamId streamId) {
   if (openedResult != LocalErrorCode::NO_ERROR) {
     return folly::makeUnexpected(openedResult);
   }
-  auto it = streams_.emplace(
-      std::piecewise_construct,
-      std::forward_as_tuple(streamId),
-      std::forward_as_tuple(streamId, conn_));
+  auto it = emplaceStream(streamId);
   QUIC_STATS(conn_.statsCallback, onNewQuicStream);
   updateAppIdleState();
-  return &it.first->second;
+  return it.first;
 }
 
 void QuicStreamManager::removeClosedStream(StreamId streamId) {
@@ -402,10 +473,10 @@ void QuicStreamManager::removeClosedStream(StreamId streamId) {
     return;
   }
   VLOG(10) << "Removing closed stream=" << streamId;
-  DCHECK(it->second.inTerminalStates());
+  DCHECK(it->second->inTerminalStates());
   readableStreams_.erase(streamId);
   peekableStreams_.erase(streamId);
-  writableStreams_.erase(streamId);
+  writableStreams_.erase(streamId, it->second->priority);
   writableControlStreams_.erase(streamId);
   blockedStreams_.erase(streamId);
   deliverableStreams_.erase(streamId);
@@ -415,7 +486,7 @@ void QuicStreamManager::removeClosedStream(StreamId streamId) {
   flowControlUpdated_.erase(streamId);
   dataRejectedStreams_.erase(streamId);
   dataExpiredStreams_.erase(streamId);
-  if (it->second.isControl) {
+  if (it->second->isControl) {
     DCHECK_GT(numControlStreams_, 0);
     numControlStreams_--;
   }
@@ -520,6 +591,18 @@ void QuicStreamManager::setStreamAsControl(QuicStreamState& stream) {
   updateAppIdleState();
 }
 
+void QuicStreamManager::setStreamPriority(
+    QuicStreamState& stream,
+    const Priority& priority) {
+  if (stream.priority == priority) {
+    return;
+  }
+  if (!stream.isControl && writableStreams_.erase(stream.id, stream.priority)) {
+    writableStreams_.insert(stream.id, priority);
+  }
+  stream.priority = priority;
+}
+
 bool QuicStreamManager::isAppIdle() const {
   return isAppIdle_;
 }
@@ -12,7 +12,10 @@
 #include <folly/container/F14Set.h>
 #include <quic/QuicConstants.h>
 #include <quic/codec/Types.h>
+#include <quic/state/QuicPriorityQueue.h>
+#include <quic/state/RoundRobinStreamSet.h>
 #include <quic/state/StreamData.h>
+#include <quic/state/StreamIdSet.h>
 #include <quic/state/TransportSettings.h>
 #include <numeric>
 #include <set>
@@ -23,6 +26,47 @@ namespace detail {
 constexpr uint8_t kStreamIncrement = 0x04;
 }
 
+/**
+ * Keeps the storage of destroyed streams to construct new ones in, up to a
+ * limit. A QuicStreamState is large, and short lived request streams are
+ * opened and closed at a high rate.
+ */
+class QuicStreamStatePool {
+ public:
+  struct Deleter {
+    QuicStreamStatePool* pool;
+
+    void operator()(QuicStreamState* stream) const {
+      pool->destroy(stream);
+    }
+  };
+
+  using Ptr = std::unique_ptr<QuicStreamState, Deleter>;
+
+  explicit QuicStreamStatePool(size_t maxFree = kDefaultMaxFreeStreamStates)
+      : maxFree_(maxFree) {}
+
+  ~QuicStreamStatePool();
+
+  QuicStreamStatePool(const QuicStreamStatePool&) = delete;
+  QuicStreamStatePool& operator=(const QuicStreamStatePool&) = delete;
+
+  Ptr create(StreamId id, QuicConnectionStateBase& conn);
+
+  size_t numFree() const {
+    return free_.size();
+  }
+
+  // Frees the storage kept for new streams.
+  void releaseFree();
+
+ private:
+  void destroy(QuicStreamState* stream);
+
+  std::vector<void*> free_;
+  size_t maxFree_;
+};
+
 class QuicStreamManager {
  public:
   explicit QuicStreamManager(
@@ -155,6 +199,13 @@ class QuicStreamManager {
     newPeerStreams_.clear();
   }
 
+  /*
+   * Gives back the storage that the stream map, the stream sets and the
+   * buffers of the streams grew to, for a connection that has gone idle. It
+   * grows again as the connection is used.
+   */
+  void shrinkToFit();
+
   /*
    * Clear all the currently open streams.
    */
@@ -179,7 +230,7 @@ class QuicStreamManager {
    */
   void streamStateForEach(const std::function<void(QuicStreamState&)>& f) {
     for (auto& s : streams_) {
-      f(s.second);
+      f(*s.second);
     }
   }
 
@@ -195,21 +246,20 @@ class QuicStreamManager {
     return !lossStreams_.empty();
   }
 
-  // TODO figure out a better interface here.
   /*
    * Returns a mutable reference to the container holding the writable stream
-   * IDs.
+   * IDs, bucketed by priority. Each bucket also tracks which of its streams is
+   * scheduled next.
    */
-  auto& writableStreams() {
+  PriorityQueue& writableStreams() {
     return writableStreams_;
   }
 
-  // TODO figure out a better interface here.
   /*
-   * Returns a mutable reference to the container holding the writable stream
-   * IDs.
+   * Returns a mutable reference to the container holding the writable control
+   * stream IDs. The container also tracks which stream is scheduled next.
    */
-  auto& writableControlStreams() {
+  RoundRobinStreamSet& writableControlStreams() {
     return writableControlStreams_;
   }
 
@@ -224,8 +274,12 @@ class QuicStreamManager {
    * Returns if the current writable streams contains the given id.
    */
   bool writableContains(StreamId streamId) const {
-    return writableStreams_.count(streamId) > 0 ||
-        writableControlStreams_.count(streamId) > 0;
+    if (writableControlStreams_.contains(streamId)) {
+      return true;
+    }
+    auto it = streams_.find(streamId);
+    return it != streams_.end() &&
+        writableStreams_.contains(streamId, it->second->priority);
   }
 
   /*
@@ -235,7 +289,7 @@ class QuicStreamManager {
     if (stream.isControl) {
       writableControlStreams_.insert(stream.id);
     } else {
-      writableStreams_.insert(stream.id);
+      writableStreams_.insert(stream.id, stream.priority);
     }
   }
 
@@ -246,10 +300,16 @@ class QuicStreamManager {
     if (stream.isControl) {
       writableControlStreams_.erase(stream.id);
     } else {
-      writableStreams_.erase(stream.id);
+      writableStreams_.erase(stream.id, stream.priority);
     }
   }
 
+  /*
+   * Change the priority of the stream, moving it to its new bucket if it is
+   * currently writable.
+   */
+  void setStreamPriority(QuicStreamState& stream, const Priority& priority);
+
   /*
    * Clear the writable streams.
    */
@@ -665,6 +725,10 @@ class QuicStreamManager {
   // time of calling
   void updateAppIdleState();
 
+  // Makes the state of a new stream and adds it to streams_, unless there is
+  // one with that id already.
+  std::pair<QuicStreamState*, bool> emplaceStream(StreamId streamId);
+
   QuicStreamState* FOLLY_NULLABLE
   getOrCreateOpenedLocalStream(StreamId streamId);
 
@@ -733,19 +797,22 @@ class QuicStreamManager {
   uint64_t numControlStreams_{0};
 
   // Bidirectional streams that are opened by the peer on the connection.
-  folly::F14FastSet<StreamId> openBidirectionalPeerStreams_;
+  StreamIdRangeSet openBidirectionalPeerStreams_;
 
   // Unidirectional streams that are opened by the peer on the connection.
-  folly::F14FastSet<StreamId> openUnidirectionalPeerStreams_;
+  StreamIdRangeSet openUnidirectionalPeerStreams_;
 
   // Bidirectional streams that are opened locally on the connection.
-  folly::F14FastSet<StreamId> openBidirectionalLocalStreams_;
+  StreamIdRangeSet openBidirectionalLocalStreams_;
 
   // Unidirectional streams that are opened locally on the connection.
-  folly::F14FastSet<StreamId> openUnidirectionalLocalStreams_;
+  StreamIdRangeSet openUnidirectionalLocalStreams_;
+
+  // Has to outlive streams_, which gives the streams back to it.
+  QuicStreamStatePool streamPool_;
 
   // A map of streams that are active.
-  folly::F14FastMap<StreamId, QuicStreamState> streams_;
+  folly::F14FastMap<StreamId, QuicStreamStatePool::Ptr> streams_;
 
   // Recently opened peer streams.
   std::vector<StreamId> newPeerStreams_;
@@ -757,38 +824,38 @@ class QuicStreamManager {
   folly::F14FastMap<StreamId, ApplicationErrorCode> stopSendingStreams_;
 
   // Set of streams that have expired data
-  folly::F14FastSet<StreamId> dataExpiredStreams_;
+  StreamIdSet dataExpiredStreams_;
 
   // Set of streams that have rejected data
-  folly::F14FastSet<StreamId> dataRejectedStreams_;
+  StreamIdSet dataRejectedStreams_;
 
   // Streams that had their stream window change and potentially need a window
   // update sent
-  folly::F14FastSet<StreamId> windowUpdates_;
+  StreamIdSet windowUpdates_;
 
   // Streams that had their flow control updated
-  folly::F14FastSet<StreamId> flowControlUpdated_;
+  StreamIdSet flowControlUpdated_;
 
   // Data structure to keep track of stream that have detected lost data
-  folly::F14FastSet<StreamId> lossStreams_;
+  StreamIdSet lossStreams_;
 
   // Set of streams that have pending reads
-  folly::F14FastSet<StreamId> readableStreams_;
+  StreamIdSet readableStreams_;
 
   // Set of streams that have pending peeks
-  folly::F14FastSet<StreamId> peekableStreams_;
+  StreamIdSet peekableStreams_;
 
   // Set of !control streams that have writable data
-  std::set<StreamId> writableStreams_;
+  PriorityQueue writableStreams_;
 
   // Set of control streams that have writable data
-  std::set<StreamId> writableControlStreams_;
+  RoundRobinStreamSet writableControlStreams_;
 
   // Streams that may be able to callback DeliveryCallback
-  folly::F14FastSet<StreamId> deliverableStreams_;
+  StreamIdSet deliverableStreams_;
 
   // Streams that are closed but we still have state for
-  folly::F14FastSet<StreamId> closedStreams_;
+  StreamIdSet closedStreams_;
 
   // Record whether or not we are app-idle.
   bool isAppIdle_{false};
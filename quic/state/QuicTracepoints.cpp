@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/state/QuicTracepoints.h>
+
+FOLLY_SDT_DEFINE_SEMAPHORE(quic, packet_recv)
+FOLLY_SDT_DEFINE_SEMAPHORE(quic, packet_sent)
+FOLLY_SDT_DEFINE_SEMAPHORE(quic, ack_processed)
+FOLLY_SDT_DEFINE_SEMAPHORE(quic, packet_lost)
+FOLLY_SDT_DEFINE_SEMAPHORE(quic, pto_alarm)
+FOLLY_SDT_DEFINE_SEMAPHORE(quic, batch_flush)
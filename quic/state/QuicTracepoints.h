@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/tracing/StaticTracepoint.h>
+#include <quic/state/StateData.h>
+
+/**
+ * Static tracepoints of the "quic" provider, to follow packets with tools
+ * such as bpftrace without qlog, e.g.
+ *
+ *   bpftrace -e 'usdt:/path/to/binary:quic:packet_sent { @[arg0] = count(); }'
+ *
+ * The first argument of every tracepoint is the hash of the local connection
+ * id, see tracepointConnectionId(). Each tracepoint has a semaphore so the
+ * arguments are only computed when a tracer is attached.
+ *
+ * packet_recv(connId, datagramSize)
+ * packet_sent(connId, packetNumSpace, packetNum, encodedSize)
+ * ack_processed(connId, packetNumSpace, largestAcked, ackedPackets, ackedBytes)
+ * packet_lost(connId, packetNumSpace, packetNum, numFrames)
+ * pto_alarm(connId, ptoCount, outstandingPackets)
+ * batch_flush(connId, packets, bytes)
+ */
+FOLLY_SDT_DECLARE_SEMAPHORE(quic, packet_recv);
+FOLLY_SDT_DECLARE_SEMAPHORE(quic, packet_sent);
+FOLLY_SDT_DECLARE_SEMAPHORE(quic, ack_processed);
+FOLLY_SDT_DECLARE_SEMAPHORE(quic, packet_lost);
+FOLLY_SDT_DECLARE_SEMAPHORE(quic, pto_alarm);
+FOLLY_SDT_DECLARE_SEMAPHORE(quic, batch_flush);
+
+#define QUIC_TRACEPOINT(name, conn, ...)                               \
+  do {                                                                 \
+    if (FOLLY_SDT_IS_ENABLED(quic, name)) {                            \
+      FOLLY_SDT_WITH_SEMAPHORE(                                        \
+          quic, name, quic::tracepointConnectionId(conn), __VA_ARGS__); \
+    }                                                                  \
+  } while (false)
+
+namespace quic {
+
+/**
+ * The hash of the connection id this end chose, which stays the same for the
+ * connection unless it is migrated to a new one. 0 before it is chosen.
+ */
+inline uint32_t tracepointConnectionId(const QuicConnectionStateBase& conn) {
+  const auto& connId = conn.nodeType == QuicNodeType::Server
+      ? conn.serverConnectionId
+      : conn.clientConnectionId;
+  return connId ? ConnectionIdHash()(*connId) : 0;
+}
+} // namespace quic
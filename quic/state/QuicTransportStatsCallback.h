@@ -11,6 +11,12 @@
 #include <folly/Optional.h>
 #include <folly/functional/Invoke.h>
 #include <folly/io/async/EventBase.h>
+#include <quic/QuicConstants.h>
+#include <quic/state/ConnectionMemoryUsage.h>
+#include <quic/state/ConnectionPerfSummary.h>
+#include <quic/state/HandshakeTimings.h>
+#include <quic/state/WriteLoopStats.h>
+#include <chrono>
 #include <string>
 
 namespace quic {
@@ -40,6 +46,11 @@ class QuicTransportStatsCallback {
     SERVER_SHUTDOWN,
     INITIAL_CONNID_SMALL,
     CANNOT_MAKE_TRANSPORT,
+    INVALID_RETRY_TOKEN,
+    SERVER_OVERLOADED,
+    SOCKET_BUFFER_OVERFLOW,
+    DUPLICATE_PACKET,
+    SOURCE_RATE_LIMITED,
     // NOTE: MAX should always be at the end
     MAX
   };
@@ -90,8 +101,10 @@ class QuicTransportStatsCallback {
   // connection level metrics:
   virtual void onNewConnection() = 0;
 
+  // summary is null when the connection state is already gone.
   virtual void onConnectionClose(
-      folly::Optional<ConnectionCloseReason> reason = folly::none) = 0;
+      folly::Optional<ConnectionCloseReason> reason = folly::none,
+      const ConnectionPerfSummary* summary = nullptr) = 0;
 
   // stream level metrics
   virtual void onNewQuicStream() = 0;
@@ -113,9 +126,27 @@ class QuicTransportStatsCallback {
 
   virtual void onCwndBlocked() = 0;
 
+  // how long a block lasted, reported once it ends
+  virtual void onStreamHolBlockedDuration(
+      std::chrono::microseconds duration) = 0;
+
+  virtual void onConnFlowControlBlockedDuration(
+      std::chrono::microseconds duration) = 0;
+
+  virtual void onStreamFlowControlBlockedDuration(
+      std::chrono::microseconds duration) = 0;
+
+  virtual void onCwndBlockedDuration(std::chrono::microseconds duration) = 0;
+
+  // when the server's handshake is done, with the timings so far
+  virtual void onHandshakeDone(const HandshakeTimings& timings) = 0;
+
   // retransmission timeout counter
   virtual void onPTO() = 0;
 
+  // packets declared lost that the peer acked later
+  virtual void onPacketSpuriousLoss() = 0;
+
   // metrics to track bytes read from / written to wire
   virtual void onRead(size_t bufSize) = 0;
 
@@ -123,6 +154,28 @@ class QuicTransportStatsCallback {
 
   virtual void onUDPSocketWriteError(SocketErrorType errorType) = 0;
 
+  // why a write loop stopped, and how many packets it wrote
+  virtual void onWriteLoopEnd(
+      WriteLoopEndReason reason,
+      uint64_t packetsWritten) = 0;
+
+  // packets written to the socket in one syscall
+  virtual void onBatchFlushed(uint64_t packets, uint64_t bytes) = 0;
+
+  // each burst of a paced connection written when its pacing timer fired:
+  // the packets in it, how late the timer fired, and how far the time since
+  // the previous burst was from the pacing interval
+  virtual void onPacedWrite(
+      uint64_t burstPackets,
+      std::chrono::microseconds timerLateness,
+      std::chrono::microseconds intervalError) = 0;
+
+  // the memory held by the worker's connections, each time it is added up
+  virtual void onMemoryUsage(const ConnectionMemoryUsage& usage) = 0;
+
+  // a mitigation applied to a connection that loops hot
+  virtual void onHotLoopMitigation(HotLoopMitigation mitigation) = 0;
+
   static const char* toString(ConnectionCloseReason reason) {
     switch (reason) {
       case ConnectionCloseReason::NONE:
@@ -168,6 +221,16 @@ class QuicTransportStatsCallback {
         return "INITIAL_CONNID_SMALL";
       case PacketDropReason::CANNOT_MAKE_TRANSPORT:
         return "CANNOT_MAKE_TRANSPORT";
+      case PacketDropReason::INVALID_RETRY_TOKEN:
+        return "INVALID_RETRY_TOKEN";
+      case PacketDropReason::SERVER_OVERLOADED:
+        return "SERVER_OVERLOADED";
+      case PacketDropReason::SOCKET_BUFFER_OVERFLOW:
+        return "SOCKET_BUFFER_OVERFLOW";
+      case PacketDropReason::DUPLICATE_PACKET:
+        return "DUPLICATE_PACKET";
+      case PacketDropReason::SOURCE_RATE_LIMITED:
+        return "SOURCE_RATE_LIMITED";
       case PacketDropReason::MAX:
         return "MAX";
       default:
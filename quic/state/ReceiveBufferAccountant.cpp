@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/state/ReceiveBufferAccountant.h>
+
+#include <glog/logging.h>
+
+namespace quic {
+
+ReceiveBufferAccountant::Account::Account(
+    std::shared_ptr<ReceiveBufferAccountant> accountant)
+    : accountant_(std::move(accountant)) {}
+
+ReceiveBufferAccountant::Account::Account(Account&& other) noexcept
+    : accountant_(std::move(other.accountant_)),
+      bufferedBytes_(other.bufferedBytes_) {
+  other.bufferedBytes_ = 0;
+}
+
+ReceiveBufferAccountant::Account& ReceiveBufferAccountant::Account::operator=(
+    Account&& other) noexcept {
+  if (this != &other) {
+    release();
+    accountant_ = std::move(other.accountant_);
+    bufferedBytes_ = other.bufferedBytes_;
+    other.bufferedBytes_ = 0;
+  }
+  return *this;
+}
+
+ReceiveBufferAccountant::Account::~Account() {
+  release();
+}
+
+void ReceiveBufferAccountant::Account::update(uint64_t bufferedBytes) noexcept {
+  if (!accountant_ || bufferedBytes == bufferedBytes_) {
+    return;
+  }
+  if (bufferedBytes > bufferedBytes_) {
+    accountant_->add(bufferedBytes - bufferedBytes_);
+  } else {
+    accountant_->remove(bufferedBytes_ - bufferedBytes);
+  }
+  bufferedBytes_ = bufferedBytes;
+}
+
+uint64_t ReceiveBufferAccountant::Account::bufferedBytes() const noexcept {
+  return bufferedBytes_;
+}
+
+bool ReceiveBufferAccountant::Account::underPressure() const noexcept {
+  return accountant_ && accountant_->underPressure();
+}
+
+void ReceiveBufferAccountant::Account::release() noexcept {
+  if (accountant_) {
+    accountant_->remove(bufferedBytes_);
+  }
+  bufferedBytes_ = 0;
+}
+
+ReceiveBufferAccountant::ReceiveBufferAccountant(
+    uint64_t limit,
+    std::shared_ptr<ReceiveBufferAccountant> parent)
+    : limit_(limit), parent_(std::move(parent)) {}
+
+void ReceiveBufferAccountant::add(uint64_t bytes) noexcept {
+  bufferedBytes_.fetch_add(bytes, std::memory_order_relaxed);
+  if (parent_) {
+    parent_->add(bytes);
+  }
+}
+
+void ReceiveBufferAccountant::remove(uint64_t bytes) noexcept {
+  DCHECK_GE(bufferedBytes(), bytes);
+  bufferedBytes_.fetch_sub(bytes, std::memory_order_relaxed);
+  if (parent_) {
+    parent_->remove(bytes);
+  }
+}
+
+uint64_t ReceiveBufferAccountant::bufferedBytes() const noexcept {
+  return bufferedBytes_.load(std::memory_order_relaxed);
+}
+
+uint64_t ReceiveBufferAccountant::limit() const noexcept {
+  return limit_;
+}
+
+bool ReceiveBufferAccountant::underPressure() const noexcept {
+  return bufferedBytes() >= limit_ || (parent_ && parent_->underPressure());
+}
+} // namespace quic
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace quic {
+
+// Flow control windows are divided by this while the receive buffers are over
+// budget.
+constexpr uint64_t kReceiveBufferPressureWindowDivisor = 4;
+
+/**
+ * Keeps track of the bytes received but not yet read by the application
+ * across many connections, e.g. those of a server worker. Once they reach
+ * limit, the connections sharing it advertise smaller flow control windows,
+ * which also defers their window updates, until the application catches up.
+ *
+ * An accountant can have a parent, e.g. one per process above the one per
+ * worker, which sees the bytes of all its children. It is thread safe.
+ */
+class ReceiveBufferAccountant {
+ public:
+  /**
+   * The share of a single connection. It reports the difference each time
+   * the connection's buffered bytes change, and gives them all back when it
+   * goes away. A default constructed Account isn't accounted anywhere.
+   */
+  class Account {
+   public:
+    Account() = default;
+    explicit Account(std::shared_ptr<ReceiveBufferAccountant> accountant);
+    Account(Account&& other) noexcept;
+    Account& operator=(Account&& other) noexcept;
+    ~Account();
+
+    void update(uint64_t bufferedBytes) noexcept;
+
+    uint64_t bufferedBytes() const noexcept;
+
+    bool underPressure() const noexcept;
+
+   private:
+    void release() noexcept;
+
+    std::shared_ptr<ReceiveBufferAccountant> accountant_;
+    uint64_t bufferedBytes_{0};
+  };
+
+  explicit ReceiveBufferAccountant(
+      uint64_t limit,
+      std::shared_ptr<ReceiveBufferAccountant> parent = nullptr);
+
+  void add(uint64_t bytes) noexcept;
+
+  void remove(uint64_t bytes) noexcept;
+
+  uint64_t bufferedBytes() const noexcept;
+
+  uint64_t limit() const noexcept;
+
+  /**
+   * Whether this accountant or any of its parents is at its limit.
+   */
+  bool underPressure() const noexcept;
+
+ private:
+  const uint64_t limit_;
+  std::shared_ptr<ReceiveBufferAccountant> parent_;
+  std::atomic<uint64_t> bufferedBytes_{0};
+};
+} // namespace quic
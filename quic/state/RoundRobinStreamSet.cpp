@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/state/RoundRobinStreamSet.h>
+
+#include <glog/logging.h>
+
+namespace quic {
+
+bool RoundRobinStreamSet::insert(StreamId id) {
+  if (links_.empty()) {
+    links_.emplace(id, Links{id, id});
+    nextScheduled_ = id;
+    return true;
+  }
+  auto nextIt = links_.find(nextScheduled_);
+  DCHECK(nextIt != links_.end());
+  auto prevId = nextIt->second.prev;
+  if (!links_.emplace(id, Links{prevId, nextScheduled_}).second) {
+    return false;
+  }
+  // The emplace may have rehashed, so look the neighbours up again.
+  links_.find(nextScheduled_)->second.prev = id;
+  links_.find(prevId)->second.next = id;
+  return true;
+}
+
+bool RoundRobinStreamSet::erase(StreamId id) {
+  auto it = links_.find(id);
+  if (it == links_.end()) {
+    return false;
+  }
+  auto links = it->second;
+  links_.erase(it);
+  if (links_.empty()) {
+    return true;
+  }
+  links_.find(links.prev)->second.next = links.next;
+  links_.find(links.next)->second.prev = links.prev;
+  if (nextScheduled_ == id) {
+    nextScheduled_ = links.next;
+  }
+  return true;
+}
+
+void RoundRobinStreamSet::clear() {
+  links_.clear();
+}
+
+StreamId RoundRobinStreamSet::getNextScheduled() const {
+  DCHECK(!links_.empty());
+  return nextScheduled_;
+}
+
+void RoundRobinStreamSet::setNextScheduled(StreamId id) {
+  if (contains(id)) {
+    nextScheduled_ = id;
+  }
+}
+
+StreamId RoundRobinStreamSet::following(StreamId id) const {
+  auto it = links_.find(id);
+  CHECK(it != links_.end()) << "Stream not in set, id=" << id;
+  return it->second.next;
+}
+
+} // namespace quic
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/container/F14Map.h>
+#include <quic/codec/Types.h>
+
+namespace quic {
+
+/**
+ * A set of stream ids kept as a circular doubly linked list, with a cursor
+ * pointing at the stream that should be served next. Adding, removing and
+ * looking up a stream are all O(1) and never allocate a node: the links are
+ * stored by value in a flat hash map keyed by stream id.
+ *
+ * Streams are served in the order they were added. A newly added stream goes
+ * right before the cursor, i.e. at the end of the current round. Removing the
+ * stream under the cursor moves the cursor to the following stream.
+ */
+class RoundRobinStreamSet {
+ public:
+  RoundRobinStreamSet() = default;
+
+  /**
+   * Adds the stream. Returns false if it was already present.
+   */
+  bool insert(StreamId id);
+
+  /**
+   * Removes the stream. Returns false if it was not present.
+   */
+  bool erase(StreamId id);
+
+  bool contains(StreamId id) const {
+    return links_.find(id) != links_.end();
+  }
+
+  size_t count(StreamId id) const {
+    return contains(id) ? 1 : 0;
+  }
+
+  bool empty() const {
+    return links_.empty();
+  }
+
+  size_t size() const {
+    return links_.size();
+  }
+
+  void clear();
+
+  /**
+   * The stream that should be served next. Must not be called on an empty set.
+   */
+  StreamId getNextScheduled() const;
+
+  /**
+   * Moves the cursor to the given stream. It is a no-op if the stream is not
+   * in the set.
+   */
+  void setNextScheduled(StreamId id);
+
+  /**
+   * The stream that comes after the given one in round robin order. The given
+   * stream must be in the set.
+   */
+  StreamId following(StreamId id) const;
+
+ private:
+  struct Links {
+    StreamId prev;
+    StreamId next;
+  };
+
+  folly::F14FastMap<StreamId, Links> links_;
+  StreamId nextScheduled_{0};
+};
+
+} // namespace quic
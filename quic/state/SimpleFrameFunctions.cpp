@@ -9,6 +9,8 @@
 #include "SimpleFrameFunctions.h"
 
 #include <quic/QuicConstants.h>
+#include <quic/common/TimeUtil.h>
+#include <quic/state/QuicFecFunctions.h>
 #include <quic/state/QuicStateFunctions.h>
 #include <quic/state/QuicStreamFunctions.h>
 #include <quic/state/stream/StreamSendHandlers.h>
@@ -73,6 +75,16 @@ folly::Optional<QuicSimpleFrame> updateSimpleFrameOnPacketClone(
       return QuicSimpleFrame(frame);
     case QuicSimpleFrame::Type::HandshakeDoneFrame_E:
       return QuicSimpleFrame(frame);
+    case QuicSimpleFrame::Type::AckFrequencyFrame_E:
+      // Only the latest ACK_FREQUENCY is worth sending again.
+      if (!conn.ackFrequencyState.sent ||
+          *frame.asAckFrequencyFrame() != *conn.ackFrequencyState.sent) {
+        return folly::none;
+      }
+      return QuicSimpleFrame(frame);
+    case QuicSimpleFrame::Type::RepairFrame_E:
+      // The symbol isn't kept, and the packets it covers are retransmitted.
+      return folly::none;
   }
   folly::assume_unreachable();
 }
@@ -148,6 +160,15 @@ void updateSimpleFrameOnPacketLoss(
     case QuicSimpleFrame::Type::HandshakeDoneFrame_E:
       conn.pendingEvents.frames.push_back(frame);
       break;
+    case QuicSimpleFrame::Type::AckFrequencyFrame_E:
+      if (conn.ackFrequencyState.sent &&
+          *frame.asAckFrequencyFrame() == *conn.ackFrequencyState.sent) {
+        conn.pendingEvents.frames.push_back(frame);
+      }
+      break;
+    case QuicSimpleFrame::Type::RepairFrame_E:
+      // Its packets are retransmitted instead.
+      break;
   }
 }
 
@@ -298,11 +319,84 @@ bool updateSimpleFrameOnPacketReceived(
             TransportErrorCode::PROTOCOL_VIOLATION,
             FrameType::HANDSHAKE_DONE);
       }
-      // TODO cipher dropping
+      // The handshake is confirmed.
+      discardPacketNumberSpace(conn, PacketNumberSpace::Initial);
+      discardPacketNumberSpace(conn, PacketNumberSpace::Handshake);
+      return true;
+    }
+    case QuicSimpleFrame::Type::AckFrequencyFrame_E: {
+      const AckFrequencyFrame& ackFrequency = *frame.asAckFrequencyFrame();
+      if (!conn.transportSettings.advertiseMinAckDelay) {
+        throw QuicTransportException(
+            "Received ACK_FREQUENCY without advertising min_ack_delay.",
+            TransportErrorCode::PROTOCOL_VIOLATION,
+            FrameType::ACK_FREQUENCY);
+      }
+      if (ackFrequency.updateMaxAckDelay <
+          conn.transportSettings.minAckDelay) {
+        throw QuicTransportException(
+            "ACK_FREQUENCY max ack delay below min_ack_delay.",
+            TransportErrorCode::PROTOCOL_VIOLATION,
+            FrameType::ACK_FREQUENCY);
+      }
+      auto& received = conn.ackFrequencyState.received;
+      // Frames can be reordered, only a larger sequence number is newer.
+      if (!received || ackFrequency.sequenceNumber > received->sequenceNumber) {
+        received = ackFrequency;
+      }
+      return true;
+    }
+    case QuicSimpleFrame::Type::RepairFrame_E: {
+      if (!conn.transportSettings.advertiseFecSupport) {
+        throw QuicTransportException(
+            "Received FEC_REPAIR without advertising support for it.",
+            TransportErrorCode::PROTOCOL_VIOLATION,
+            FrameType::FEC_REPAIR);
+      }
+      onFecRepairFrameReceived(conn, *frame.asRepairFrame());
       return true;
     }
   }
   folly::assume_unreachable();
 }
 
+void updateAckFrequency(QuicConnectionStateBase& conn) {
+  if (!conn.transportSettings.sendAckFrequency || !conn.peerMinAckDelay ||
+      !conn.congestionController || !conn.oneRttWriteCipher ||
+      conn.lossState.srtt == 0us) {
+    return;
+  }
+  // Roughly kAckFrequencyAcksPerCwnd acks per congestion window.
+  uint64_t packetTolerance = conn.congestionController->getCongestionWindow() /
+      conn.udpSendPacketLen / kAckFrequencyAcksPerCwnd;
+  packetTolerance = std::max(packetTolerance, kMinAckFrequencyPacketTolerance);
+  packetTolerance = std::min(packetTolerance, kMaxAckFrequencyPacketTolerance);
+  auto& sent = conn.ackFrequencyState.sent;
+  // Only bother the peer when the tolerance at least doubles or halves.
+  if (sent && packetTolerance < sent->packetTolerance * 2 &&
+      packetTolerance * 2 > sent->packetTolerance) {
+    return;
+  }
+  auto factoredRtt = std::chrono::duration_cast<std::chrono::microseconds>(
+      kAckTimerFactor * conn.lossState.srtt);
+  auto updateMaxAckDelay =
+      timeMax(*conn.peerMinAckDelay, timeMin(kMaxAckTimeout, factoredRtt));
+  AckFrequencyFrame frame(
+      conn.ackFrequencyState.nextSequenceNumber++,
+      packetTolerance,
+      updateMaxAckDelay,
+      false /* ignoreOrder */);
+  // A newer frame supersedes one that hasn't been written yet.
+  auto& frames = conn.pendingEvents.frames;
+  auto itr = std::find_if(frames.begin(), frames.end(), [](const auto& f) {
+    return f.type() == QuicSimpleFrame::Type::AckFrequencyFrame_E;
+  });
+  if (itr != frames.end()) {
+    *itr = frame;
+  } else {
+    sendSimpleFrame(conn, frame);
+  }
+  sent = frame;
+}
+
 } // namespace quic
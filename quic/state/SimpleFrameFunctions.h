@@ -58,4 +58,11 @@ bool updateSimpleFrameOnPacketReceived(
     const QuicSimpleFrame& frameIn,
     PacketNum packetNum,
     bool fromChangedPeerAddress);
+
+/*
+ * Ask the peer for an ack rate that matches the current congestion window by
+ * scheduling an ACK_FREQUENCY frame, if it supports them and the rate changed
+ * enough since the last one we sent.
+ */
+void updateAckFrequency(QuicConnectionStateBase& conn);
 } // namespace quic
@@ -12,6 +12,7 @@
 namespace quic {
 QuicStreamState::QuicStreamState(StreamId idIn, QuicConnectionStateBase& connIn)
     : conn(connIn), id(idIn) {
+  earlyDataAllowed = conn.transportSettings.earlyDataAllowedByDefault;
   // Note: this will set a windowSize for a locally-initiated unidirectional
   // stream even though that value is meaningless.
   flowControlState.windowSize = isUnidirectionalStream(idIn)
@@ -153,6 +154,34 @@ CongestionController::AckEvent::AckPacket::Builder::build() && {
       isAppLimited);
 }
 
+ConnectionPerfSummary QuicConnectionStateBase::getPerfSummary(
+    TimePoint now) const {
+  ConnectionPerfSummary summary;
+  summary.totalBytesSent = lossState.totalBytesSent;
+  summary.totalBytesAcked = lossState.totalBytesAcked;
+  summary.totalBytesRetransmitted = lossState.totalBytesRetransmitted;
+  summary.rtxCount = lossState.rtxCount;
+  summary.ptoCount = lossState.totalPTOCount;
+  summary.spuriousLossCount = lossState.spuriousLossCount;
+  if (lossState.srtt != 0us) {
+    summary.minRtt = lossState.mrtt;
+    summary.srtt = lossState.srtt;
+  }
+  summary.cwndLimitedTime = totalCwndBlockedTime;
+  if (cwndBlockedTime && now > *cwndBlockedTime) {
+    summary.cwndLimitedTime +=
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            now - *cwndBlockedTime);
+  }
+  summary.appLimitedTime = totalAppLimitedTime;
+  if (appLimitedTime && now > *appLimitedTime) {
+    summary.appLimitedTime +=
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            now - *appLimitedTime);
+  }
+  return summary;
+}
+
 bool QuicConnectionStateBase::retireAndSwitchPeerConnectionIds() {
   const auto end = peerConnectionIds.end();
   auto replacementConnIdDataIt{end};
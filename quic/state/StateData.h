@@ -13,15 +13,25 @@
 #include <quic/codec/QuicReadCodec.h>
 #include <quic/codec/QuicWriteCodec.h>
 #include <quic/codec/Types.h>
+#include <quic/common/BufAccessor.h>
 #include <quic/common/EnumArray.h>
+#include <quic/common/PacketBufArena.h>
+#include <quic/congestion_control/Bandwidth.h>
 #include <quic/handshake/HandshakeLayer.h>
+#include <quic/handshake/ParallelEncryptor.h>
 #include <quic/logging/QLogger.h>
 #include <quic/state/AckStates.h>
+#include <quic/state/ConnectionCpuTime.h>
+#include <quic/state/ConnectionPerfSummary.h>
+#include <quic/state/HandshakeTimings.h>
+#include <quic/state/PathMtuDiscovery.h>
 #include <quic/state/PendingPathRateLimiter.h>
 #include <quic/state/QuicStreamManager.h>
 #include <quic/state/QuicTransportStatsCallback.h>
+#include <quic/state/ReceiveBufferAccountant.h>
 #include <quic/state/StreamData.h>
 #include <quic/state/TransportSettings.h>
+#include <quic/state/WriteLoopStats.h>
 
 #include <folly/Optional.h>
 #include <folly/io/IOBuf.h>
@@ -29,7 +39,10 @@
 #include <folly/io/async/DelayedDestruction.h>
 #include <folly/io/async/HHWheelTimer.h>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <deque>
 #include <list>
 #include <numeric>
 #include <queue>
@@ -41,30 +54,82 @@ struct RecvmmsgStorage {
   std::vector<struct sockaddr_storage> addrs;
   std::vector<Buf> readBuffers;
   std::vector<struct iovec> iovecs;
+  // Room for the UDP GRO segment size, the ECN codepoint, the RX timestamp
+  // and the socket drop count cmsgs of each message.
+  std::vector<std::array<
+      char,
+      2 * CMSG_SPACE(sizeof(int)) + CMSG_SPACE(3 * sizeof(struct timespec)) +
+          CMSG_SPACE(sizeof(uint32_t))>>
+      controls;
 
   void resize(size_t numPackets) {
     msgs.resize(numPackets);
     addrs.resize(numPackets);
     readBuffers.resize(numPackets);
     iovecs.resize(numPackets);
+    controls.resize(numPackets);
   }
 };
 
 struct NetworkData {
   TimePoint receiveTimePoint;
   std::vector<std::unique_ptr<folly::IOBuf>> packets;
+  // ECN codepoints of packets, by index. Packets past the end of it were not
+  // ECN marked.
+  std::vector<EcnCodepoint> ecnCodepoints;
+  // Kernel receive times of packets, by index. Packets past the end of it
+  // were received at receiveTimePoint.
+  std::vector<TimePoint> receiveTimePoints;
   RecvmmsgStorage recvmmsgStorage;
   size_t totalData{0};
 
   NetworkData() = default;
-  NetworkData(Buf&& buf, const TimePoint& receiveTime)
+  NetworkData(
+      Buf&& buf,
+      const TimePoint& receiveTime,
+      EcnCodepoint ecn = EcnCodepoint::NotEct)
       : receiveTimePoint(receiveTime) {
     if (buf) {
       totalData = buf->computeChainDataLength();
       packets.emplace_back(std::move(buf));
+      setEcnCodepoints(0, ecn);
     }
   }
 
+  // Sets the ECN codepoint of packets[firstIndex] up to the last packet, which
+  // all came in the same datagram.
+  void setEcnCodepoints(size_t firstIndex, EcnCodepoint ecn) {
+    if (ecn == EcnCodepoint::NotEct && firstIndex >= ecnCodepoints.size()) {
+      return;
+    }
+    if (ecnCodepoints.size() < packets.size()) {
+      ecnCodepoints.resize(packets.size(), EcnCodepoint::NotEct);
+    }
+    std::fill(ecnCodepoints.begin() + firstIndex, ecnCodepoints.end(), ecn);
+  }
+
+  EcnCodepoint getEcnCodepoint(size_t index) const {
+    return index < ecnCodepoints.size() ? ecnCodepoints[index]
+                                        : EcnCodepoint::NotEct;
+  }
+
+  // Sets the receive time of packets[firstIndex] up to the last packet, which
+  // all came in the same datagram. The packets before it that have none are
+  // given the time too, they can't have come in any later.
+  void setReceiveTimePoints(size_t firstIndex, TimePoint receiveTime) {
+    DCHECK_GE(packets.size(), firstIndex);
+    receiveTimePoints.resize(packets.size(), receiveTime);
+    std::fill(
+        receiveTimePoints.begin() + firstIndex,
+        receiveTimePoints.end(),
+        receiveTime);
+  }
+
+  TimePoint getReceiveTimePoint(size_t index) const {
+    return index < receiveTimePoints.size() ? receiveTimePoints[index]
+                                            : receiveTimePoint;
+  }
+
   std::unique_ptr<folly::IOBuf> moveAllData() && {
     std::unique_ptr<folly::IOBuf> buf;
     for (size_t i = 0; i < packets.size(); ++i) {
@@ -82,13 +147,15 @@ struct NetworkDataSingle {
   std::unique_ptr<folly::IOBuf> data;
   TimePoint receiveTimePoint;
   size_t totalData{0};
+  EcnCodepoint ecn{EcnCodepoint::NotEct};
 
   NetworkDataSingle() = default;
 
   NetworkDataSingle(
       std::unique_ptr<folly::IOBuf> buf,
-      const TimePoint& receiveTime)
-      : data(std::move(buf)), receiveTimePoint(receiveTime) {
+      const TimePoint& receiveTime,
+      EcnCodepoint ecnIn = EcnCodepoint::NotEct)
+      : data(std::move(buf)), receiveTimePoint(receiveTime), ecn(ecnIn) {
     if (data) {
       totalData += data->computeChainDataLength();
     }
@@ -159,6 +226,9 @@ struct OutstandingPacket {
    */
   bool isAppLimited{false};
 
+  // Whether the packet is a path MTU probe, whose loss doesn't mean congestion.
+  bool isPathMtuProbe{false};
+
   OutstandingPacket(
       RegularQuicWritePacket packetIn,
       TimePoint timeIn,
@@ -211,9 +281,28 @@ struct Pacer {
    */
   virtual uint64_t getCachedWriteBatchSize() const = 0;
 
+  /**
+   * API for Transport to get the earliest departure time of a packet of
+   * packetSize bytes when pacing is done by the kernel, which also moves the
+   * pacing clock past that packet.
+   *
+   * currentTime: a packet is never scheduled to leave before currentTime.
+   */
+  virtual TimePoint getDepartureTime(
+      TimePoint currentTime,
+      uint64_t packetSize) = 0;
+
   virtual void setAppLimited(bool limited) = 0;
   virtual void onPacketSent() = 0;
   virtual void onPacketsLoss() = 0;
+
+  /**
+   * API for Transport to cap the pacing rate at what the application wants to
+   * send at, in bytes per second, or to lift the cap with folly::none. While
+   * capped, writes are paced even when the connection is app limited.
+   */
+  virtual void setMaxPacingRate(
+      folly::Optional<uint64_t> maxRateBytesPerSec) = 0;
 };
 
 struct PacingRate {
@@ -275,6 +364,14 @@ struct CongestionController {
     }
   };
 
+  // A delivery rate measured over the packets acked by one AckEvent.
+  struct DeliveryRateSample {
+    Bandwidth bandwidth;
+    // Whether the sample comes from a packet sent while app-limited, so that
+    // it may underestimate the path's bandwidth.
+    bool isAppLimited{false};
+  };
+
   struct AckEvent {
     /**
      * The reason that this is an optional type, is that we construct an
@@ -289,6 +386,8 @@ struct CongestionController {
     // The minimal RTT sample among packets acked by this AckEvent. This RTT
     // includes ack delay.
     folly::Optional<std::chrono::microseconds> mrttSample;
+    // Delivery rate sampled by processAckFrame, see sampleDeliveryRate().
+    folly::Optional<DeliveryRateSample> rateSample;
 
     struct AckPacket {
       // Packet sent time when this acked pakcet was first sent.
@@ -355,6 +454,28 @@ struct CongestionController {
       folly::Optional<AckEvent>,
       folly::Optional<LossEvent>) = 0;
 
+  /**
+   * Notify congestion controller that the peer reported newly CE marked
+   * packets in an ACK_ECN frame.
+   * ceMarkedPackets: the increase of the CE count reported by the peer.
+   * largestAckedSentTime: sent time of the largest packet acked by the frame,
+   *                       to tell a new congestion event from one of the
+   *                       current recovery period.
+   * Controllers that don't use ECN can ignore it.
+   */
+  virtual void onPacketsCeMarked(
+      uint64_t /* ceMarkedPackets */,
+      TimePoint /* largestAckedSentTime */) {}
+
+  /**
+   * Notify congestion controller that a packet it was told was lost has been
+   * acked by the peer, so the loss was spurious.
+   * lossTime: the lossTime of the LossEvent the packet was part of.
+   * Controllers may revert the reduction of a recovery period once all of
+   * its losses turn out to be spurious.
+   */
+  virtual void undoLoss(TimePoint /* lossTime */) {}
+
   /**
    * Return the number of bytes that the congestion controller
    * will allow you to write.
@@ -366,6 +487,15 @@ struct CongestionController {
    * controller.
    */
   virtual uint64_t getCongestionWindow() const = 0;
+
+  /**
+   * Return the controller's estimate of the delivery rate of the path, or none
+   * if it doesn't model bandwidth or has no sample yet.
+   */
+  virtual folly::Optional<Bandwidth> getBandwidth() const {
+    return folly::none;
+  }
+
   /**
    * Notify congestion controller that the connection has become idle or active
    * in the sense that there are active non-control streams.
@@ -445,6 +575,23 @@ struct LossState {
   PacketNum largestSent{0};
   // Reordering threshold used
   uint32_t reorderingThreshold{kReorderingThreshold};
+  // Packet declared lost by detectLossPackets, with the largest acked packet
+  // and the lossTime of the LossEvent then.
+  struct LostPacket {
+    PacketNum packetNum;
+    PacketNumberSpace pnSpace;
+    PacketNum largestAcked;
+    TimePoint lossTime;
+  };
+  // The most recent packets declared lost, up to kMaxRecentlyLostPackets.
+  std::deque<LostPacket> recentlyLostPackets;
+  // Number of packets declared lost that were acked later
+  uint32_t spuriousLossCount{0};
+  // Extra time reordering window, in rtt / kReorderingWindowStepDivisor, with
+  // adaptive reordering.
+  uint8_t reorderingWindowSteps{0};
+  // Loss events since the reordering window was last changed
+  uint32_t lossEventsSinceReorderingUpdate{0};
   // Timer for time reordering detection or early retransmit alarm.
   EnumArray<PacketNumberSpace, folly::Optional<TimePoint>> lossTimes;
   // Current method by which the loss detection alarm is set.
@@ -494,6 +641,8 @@ class Logger;
 class CongestionControllerFactory;
 class LoopDetectorCallback;
 class PendingPathRateLimiter;
+class SharedEgressBatch;
+class ZeroCopySendTracker;
 
 struct QuicConnectionStateBase : public folly::DelayedDestruction {
   virtual ~QuicConnectionStateBase() = default;
@@ -543,6 +692,11 @@ struct QuicConnectionStateBase : public folly::DelayedDestruction {
   // Number of packets are clones or cloned.
   uint64_t outstandingClonedPacketsCount{0};
 
+  // Plaintext bodies of the last TransportSettings::sentPayloadCacheSize
+  // AppData packets sent, sorted by PacketNum. Some may be acked or lost
+  // already.
+  std::deque<std::pair<PacketNum, Buf>> sentPayloads;
+
   // The read codec to decrypt and decode packets.
   std::unique_ptr<QuicReadCodec> readCodec;
 
@@ -561,6 +715,23 @@ struct QuicConnectionStateBase : public folly::DelayedDestruction {
   // Write cipher for 1-RTT data
   std::unique_ptr<Aead> oneRttWriteCipher;
 
+  // 1-RTT key updates (RFC 9001, section 6) of the write keys.
+  struct OneRttKeyUpdateState {
+    // Key updates of the write keys so far. The key phase bit of the packets
+    // written is its parity.
+    uint64_t writeKeyGeneration{0};
+    // The write cipher of the next key phase, derived ahead of time so that
+    // a key update doesn't hold up the write path.
+    std::unique_ptr<Aead> nextWriteCipher;
+    // The first packet written with the current write keys. We can't start
+    // another key update until the peer acks one of those.
+    folly::Optional<PacketNum> firstPacketInWritePhase;
+    // 1-RTT packets written with the current write keys.
+    uint64_t packetsInWritePhase{0};
+  };
+
+  OneRttKeyUpdateState oneRttKeyUpdateState;
+
   // Write cipher for packets with initial keys.
   std::unique_ptr<Aead> initialWriteCipher;
 
@@ -571,9 +742,19 @@ struct QuicConnectionStateBase : public folly::DelayedDestruction {
   // TODO: move this back into the client state
   std::unique_ptr<Aead> zeroRttWriteCipher;
 
+  // Bytes written in 0-RTT packets, counted against
+  // TransportSettings::maxZeroRttBytes.
+  uint64_t zeroRttBytesSent{0};
+
   // Time at which the connection started.
   TimePoint connectionTime;
 
+  HandshakeTimings handshakeTimings;
+
+  WriteLoopStats writeLoopStats;
+
+  ConnectionCpuTime cpuTime;
+
   // The received active_connection_id_limit transport parameter from the peer.
   uint64_t peerActiveConnectionIdLimit{0};
 
@@ -704,11 +885,29 @@ struct QuicConnectionStateBase : public folly::DelayedDestruction {
     uint64_t peerAdvertisedInitialMaxStreamOffsetUni{0};
     // Time at which the last flow control update was sent by the transport.
     folly::Optional<TimePoint> timeOfLastFlowControlUpdate;
+    // Time since which writes are blocked by the peer's flow control, if they
+    // are.
+    folly::Optional<TimePoint> timeOfBlocked;
   };
 
   // Current state of flow control.
   ConnectionFlowControlState flowControlState;
 
+  // When the write in progress runs out of TransportSettings::loopWorkBudget.
+  folly::Optional<TimePoint> loopWorkDeadline;
+
+  // Time since which the congestion controller allows no writes, if it
+  // doesn't, and the total of the previous such periods.
+  folly::Optional<TimePoint> cwndBlockedTime;
+  std::chrono::microseconds totalCwndBlockedTime{0us};
+  // Same for the application having less than a packet to write.
+  folly::Optional<TimePoint> appLimitedTime;
+  std::chrono::microseconds totalAppLimitedTime{0us};
+
+  // Share of the bytes buffered for reading in a budget shared with other
+  // connections, if any.
+  ReceiveBufferAccountant::Account receiveBufferAccount;
+
   // The outstanding path challenge
   folly::Optional<PathChallengeFrame> outstandingPathValidation;
 
@@ -729,12 +928,8 @@ struct QuicConnectionStateBase : public folly::DelayedDestruction {
   // max_packet_size in Transport Parameters and PMTU
   uint64_t udpSendPacketLen{kDefaultUDPSendPacketLen};
 
-  struct PacketSchedulingState {
-    StreamId nextScheduledStream{0};
-    StreamId nextScheduledControlStream{0};
-  };
-
-  PacketSchedulingState schedulingState;
+  // Search for a larger udpSendPacketLen.
+  PathMtuState pathMtuState;
 
   // The packet number of the latest packet that contains a MaxDataFrame sent
   // out by us.
@@ -749,6 +944,42 @@ struct QuicConnectionStateBase : public folly::DelayedDestruction {
   // Track stats for various server events
   QuicTransportStatsCallback* statsCallback{nullptr};
 
+  // Output buffer used by DataPathType::ContinuousMemory. Owned by whoever
+  // owns the socket, i.e. the server worker or the client transport.
+  BufAccessor* bufAccessor{nullptr};
+
+  // Slabs for packets built with DataPathType::ChainedMemory, shared by all
+  // connections on the same EventBase.
+  PacketBufArena* bufArena{nullptr};
+
+  // Set if TransportSettings::useSharedEgressBatch, packets are then queued
+  // here to be written with the ones of the other connections on the same
+  // EventBase.
+  SharedEgressBatch* egressBatch{nullptr};
+
+  // Set if TransportSettings::enableZeroCopySend and the socket supports it.
+  // Owned by whoever owns the socket, like bufAccessor.
+  ZeroCopySendTracker* zeroCopyTracker{nullptr};
+
+  // Encrypted long header packets held back by TransportSettings::
+  // coalescePackets, to go out in the same datagram as the next packet
+  // written.
+  Buf coalescedPackets;
+
+  // The last connection close packet sent, kept if TransportSettings::
+  // compactDrainingState is set so that it can be sent again while draining.
+  Buf lastClosePacket;
+
+  // Packets a batch may hold with TransportSettings::adaptiveBatchSize, as
+  // far as losses tell: halved on each loss event, and grown back by one for
+  // each round trip without one. 0 until the first write.
+  uint32_t burstTolerance{0};
+  TimePoint burstToleranceUpdateTime;
+
+  // Set if batches of packets can be encrypted on other threads too, see
+  // TransportSettings::encryptOffloadMinBatchSize.
+  std::unique_ptr<ParallelEncryptor> parallelEncryptor;
+
   struct HappyEyeballsState {
     // Delay timer
     folly::HHWheelTimer::Callback* connAttemptDelayTimeout{nullptr};
@@ -786,6 +1017,52 @@ struct QuicConnectionStateBase : public folly::DelayedDestruction {
   // Whether or not both ends agree to use partial reliability
   bool partialReliabilityEnabled{false};
 
+  // min_ack_delay advertised by the peer, if it supports ACK_FREQUENCY.
+  folly::Optional<std::chrono::microseconds> peerMinAckDelay;
+
+  struct AckFrequencyState {
+    // The ACK_FREQUENCY frame with the largest sequence number received from
+    // the peer, which overrides the default ack thresholds.
+    folly::Optional<AckFrequencyFrame> received;
+    // The ACK_FREQUENCY frame we last asked the peer to follow.
+    folly::Optional<AckFrequencyFrame> sent;
+    uint64_t nextSequenceNumber{0};
+  };
+
+  AckFrequencyState ackFrequencyState;
+
+  struct DatagramState {
+    // max_datagram_frame_size advertised by the peer, 0 if it does not support
+    // DATAGRAM frames.
+    uint64_t maxWriteFrameSize{0};
+    // Received and not read by the app yet. Both buffers drop the oldest
+    // datagram when full.
+    std::deque<Buf> readBuffer;
+    // Written by the app and not sent yet.
+    std::deque<Buf> writeBuffer;
+  };
+
+  DatagramState datagramState;
+
+  struct FecState {
+    // Whether the peer advertised that it takes FEC_REPAIR frames.
+    bool peerSupported{false};
+    // The packets the repair symbol being built covers, as a mask of packet
+    // numbers from firstSourcePacket.
+    PacketNum firstSourcePacket{0};
+    uint64_t sourcePacketMask{0};
+    Buf repairSymbol;
+    // Source symbols of the packets received lately, by packet number, for
+    // the repair frames still to come.
+    std::deque<std::pair<PacketNum, Buf>> receivedSymbols;
+    // Repair frames for packets up to this one can't be used any more, their
+    // symbols may have been dropped.
+    folly::Optional<PacketNum> largestDroppedSymbol;
+    uint64_t numRecoveredPackets{0};
+  };
+
+  FecState fecState;
+
   // Debug information. Currently only used to debug busy loop of Transport
   // WriteLooper.
   struct WriteDebugState {
@@ -801,8 +1078,19 @@ struct QuicConnectionStateBase : public folly::DelayedDestruction {
     NoReadReason noReadReason{NoReadReason::READ_OK};
   };
 
+  // Reads and write loop runs of the connection in the current hotLoopWindow,
+  // with the bytes they moved.
+  struct HotLoopState {
+    TimePoint windowStart;
+    uint64_t wakeups{0};
+    uint64_t bytes{0};
+    // The last mitigation applied, the next one escalates from it.
+    HotLoopMitigation mitigation{HotLoopMitigation::NONE};
+  };
+
   WriteDebugState writeDebugState;
   ReadDebugState readDebugState;
+  HotLoopState hotLoopState;
 
   std::shared_ptr<LoopDetectorCallback> loopDetectorCallback;
 
@@ -823,6 +1111,8 @@ struct QuicConnectionStateBase : public folly::DelayedDestruction {
    * Return true if replacement succeeds.
    */
   bool retireAndSwitchPeerConnectionIds();
+
+  ConnectionPerfSummary getPerfSummary(TimePoint now) const;
 };
 
 std::ostream& operator<<(std::ostream& os, const QuicConnectionStateBase& st);
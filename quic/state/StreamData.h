@@ -11,6 +11,9 @@
 #include <folly/container/F14Map.h>
 #include <quic/QuicConstants.h>
 #include <quic/codec/Types.h>
+#include <quic/state/QuicPriorityQueue.h>
+
+#include <deque>
 
 namespace quic {
 
@@ -26,6 +29,115 @@ struct StreamBuffer {
   StreamBuffer& operator=(StreamBuffer&& other) = default;
 };
 
+/**
+ * Buffers keyed by offset and kept sorted by it in a single deque, with the
+ * subset of the map interface the transport needs. New stream data is always
+ * inserted past everything that is buffered, and acks mostly arrive in the
+ * order the data was sent, so nearly every insert and erase is at either end.
+ */
+class RetransmissionBuffer {
+ public:
+  using value_type = std::pair<uint64_t, std::unique_ptr<StreamBuffer>>;
+  using container_type = std::deque<value_type>;
+  using iterator = container_type::iterator;
+  using const_iterator = container_type::const_iterator;
+
+  std::pair<iterator, bool> emplace(
+      uint64_t offset,
+      std::unique_ptr<StreamBuffer> buffer) {
+    if (buffers_.empty() || buffers_.back().first < offset) {
+      buffers_.emplace_back(offset, std::move(buffer));
+      return std::make_pair(std::prev(buffers_.end()), true);
+    }
+    auto itr = lowerBound(offset);
+    if (itr != buffers_.end() && itr->first == offset) {
+      return std::make_pair(itr, false);
+    }
+    return std::make_pair(
+        buffers_.emplace(itr, offset, std::move(buffer)), true);
+  }
+
+  template <class KeyTuple, class ValueTuple>
+  std::pair<iterator, bool>
+  emplace(std::piecewise_construct_t, KeyTuple&& key, ValueTuple&& value) {
+    return emplace(std::get<0>(key), std::move(std::get<0>(value)));
+  }
+
+  iterator find(uint64_t offset) {
+    if (!buffers_.empty() && buffers_.front().first == offset) {
+      return buffers_.begin();
+    }
+    auto itr = lowerBound(offset);
+    return itr != buffers_.end() && itr->first == offset ? itr
+                                                         : buffers_.end();
+  }
+
+  const_iterator find(uint64_t offset) const {
+    return const_cast<RetransmissionBuffer*>(this)->find(offset);
+  }
+
+  std::unique_ptr<StreamBuffer>& at(uint64_t offset) {
+    auto itr = find(offset);
+    if (itr == buffers_.end()) {
+      throw std::out_of_range("RetransmissionBuffer::at");
+    }
+    return itr->second;
+  }
+
+  const std::unique_ptr<StreamBuffer>& at(uint64_t offset) const {
+    return const_cast<RetransmissionBuffer*>(this)->at(offset);
+  }
+
+  iterator erase(const_iterator itr) {
+    return buffers_.erase(itr);
+  }
+
+  size_t size() const {
+    return buffers_.size();
+  }
+
+  bool empty() const {
+    return buffers_.empty();
+  }
+
+  void clear() {
+    buffers_.clear();
+  }
+
+  void shrinkToFit() {
+    buffers_.shrink_to_fit();
+  }
+
+  iterator begin() {
+    return buffers_.begin();
+  }
+
+  iterator end() {
+    return buffers_.end();
+  }
+
+  const_iterator begin() const {
+    return buffers_.begin();
+  }
+
+  const_iterator end() const {
+    return buffers_.end();
+  }
+
+ private:
+  iterator lowerBound(uint64_t offset) {
+    return std::lower_bound(
+        buffers_.begin(),
+        buffers_.end(),
+        offset,
+        [](const value_type& buffer, uint64_t target) {
+          return buffer.first < target;
+        });
+  }
+
+  container_type buffers_;
+};
+
 struct QuicStreamLike {
   QuicStreamLike() = default;
 
@@ -33,6 +145,13 @@ struct QuicStreamLike {
 
   virtual ~QuicStreamLike() = default;
 
+  // Gives back the storage the buffers grew to, for an idle stream.
+  void shrinkToFit() {
+    readBuffer.shrink_to_fit();
+    retransmissionBuffer.shrinkToFit();
+    lossBuffer.shrink_to_fit();
+  }
+
   // List of bytes that have been read and buffered. We need to buffer
   // bytes in case we get bytes out of order.
   std::deque<StreamBuffer> readBuffer;
@@ -40,16 +159,16 @@ struct QuicStreamLike {
   // List of bytes that have been written to the QUIC layer.
   BufQueue writeBuffer{};
 
-  // Stores a map of offset:buffers which have been written to the socket and
-  // are currently un-acked. Each one represents one StreamFrame that was
-  // written. We need to buffer these because these might be retransmitted in
-  // the future. These are associated with the starting offset of the buffer.
+  // Stores offset:buffers which have been written to the socket and are
+  // currently un-acked, sorted by offset. Each one represents one StreamFrame
+  // that was written. We need to buffer these because these might be
+  // retransmitted in the future. These are associated with the starting offset
+  // of the buffer.
   // Note: the offset in the StreamBuffer itself can be >= the offset on which
   // it is keyed due to partial reliability - when data is skipped the offset
   // in the StreamBuffer may be incremented, but the keyed offset must remain
   // the same so it can be removed from the buffer on ACK.
-  folly::F14FastMap<uint64_t, std::unique_ptr<StreamBuffer>>
-      retransmissionBuffer;
+  RetransmissionBuffer retransmissionBuffer;
 
   // Tracks intervals which we have received ACKs for. E.g. in the case of all
   // data being acked this would contain one internval from 0 -> the largest
@@ -74,6 +193,15 @@ struct QuicStreamLike {
   // N.B. used in QUIC partial reliability
   uint64_t minimumRetransmittableOffset{0};
 
+  // How long the data written to the stream from now on is worth sending,
+  // if it expires at all.
+  // N.B. used in QUIC partial reliability
+  folly::Optional<std::chrono::milliseconds> writeTimeToLive;
+
+  // When the writes made with a time to live expire, with the offset the data
+  // of each ends at, in the order they were written.
+  std::deque<std::pair<uint64_t, TimePoint>> writeDeadlines;
+
   // Offset of the next expected bytes that we need to read from
   // the read buffer.
   uint64_t currentReadOffset{0};
@@ -106,7 +234,7 @@ struct QuicStreamLike {
     if (!lossBuffer.empty() && lossItr != lossBuffer.begin() &&
         std::prev(lossItr)->offset + std::prev(lossItr)->data.chainLength() ==
             buf->offset) {
-      std::prev(lossItr)->data.append(buf->data.move());
+      std::prev(lossItr)->data.append(std::move(buf->data));
       std::prev(lossItr)->eof = buf->eof;
     } else {
       lossBuffer.insert(lossItr, std::move(*buf));
@@ -173,6 +301,9 @@ struct QuicStreamState : public QuicStreamLike {
     uint64_t peerAdvertisedMaxOffset{0};
     // Time at which the last flow control update was sent by the transport.
     folly::Optional<TimePoint> timeOfLastFlowControlUpdate;
+    // Time since which writes are blocked by the peer's flow control, if they
+    // are.
+    folly::Optional<TimePoint> timeOfBlocked;
   };
 
   StreamFlowControlState flowControlState;
@@ -198,6 +329,19 @@ struct QuicStreamState : public QuicStreamLike {
   // congestion control with control streams still active.
   bool isControl{false};
 
+  // Scheduling priority of the stream's data, set by the app via
+  // setStreamPriority.
+  Priority priority{kDefaultPriority};
+
+  // Whether the stream's data may go out in 0-RTT packets, which the peer
+  // could see replayed. Set by the app via setStreamEarlyData.
+  bool earlyDataAllowed{true};
+
+  // Bytes left of the stream's turn when incremental streams share the
+  // connection in deficit round robin (streamSchedulingQuantum). Negative
+  // when its last frame overdrew the turn.
+  int64_t sendQuantumLeft{0};
+
   // The last time we detected we were head of line blocked on the stream.
   folly::Optional<Clock::time_point> lastHolbTime;
 
@@ -208,6 +352,15 @@ struct QuicStreamState : public QuicStreamLike {
   // lastHolbTime indicates whether the stream is HOL blocked at the moment.
   uint32_t holbCount{0};
 
+  // A buffer of the application, set via setReadBuffer, that in-order data is
+  // copied into as it arrives instead of being kept in the read buffer, and
+  // how much of it is filled.
+  struct AppReadBuffer {
+    folly::MutableByteRange buffer;
+    size_t filled{0};
+  };
+  folly::Optional<AppReadBuffer> appReadBuffer;
+
   // Returns true if both send and receive state machines are in a terminal
   // state
   bool inTerminalStates() const {
@@ -243,7 +396,8 @@ struct QuicStreamState : public QuicStreamLike {
   bool hasReadableData() const {
     return (readBuffer.size() > 0 &&
             currentReadOffset == readBuffer.front().offset) ||
-        (finalReadOffset && currentReadOffset == *finalReadOffset);
+        (finalReadOffset && currentReadOffset == *finalReadOffset) ||
+        (appReadBuffer && appReadBuffer->filled > 0);
   }
 
   bool hasPeekableData() const {
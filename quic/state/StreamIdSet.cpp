@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/state/StreamIdSet.h>
+
+#include <folly/lang/Bits.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+
+namespace quic {
+
+namespace {
+constexpr uint64_t kBitsPerWord = 64;
+} // namespace
+
+StreamId StreamIdSet::const_iterator::operator*() const {
+  return bit_ * kNumStreamTypes + type_;
+}
+
+StreamIdSet::const_iterator& StreamIdSet::const_iterator::operator++() {
+  ++bit_;
+  settle();
+  return *this;
+}
+
+void StreamIdSet::const_iterator::settle() {
+  while (type_ < kNumStreamTypes) {
+    const auto& bitmap = set_->bitmaps_[type_];
+    uint64_t firstBit = bitmap.firstWord * kBitsPerWord;
+    if (bit_ < firstBit) {
+      bit_ = firstBit;
+    }
+    size_t index = (bit_ / kBitsPerWord) - bitmap.firstWord;
+    if (index < bitmap.words.size()) {
+      // Only the bits at or after bit_ in the first word.
+      uint64_t word = bitmap.words[index] & (~0ULL << (bit_ % kBitsPerWord));
+      while (!word && ++index < bitmap.words.size()) {
+        word = bitmap.words[index];
+      }
+      if (word) {
+        bit_ = (bitmap.firstWord + index) * kBitsPerWord +
+            folly::findFirstSet(word) - 1;
+        return;
+      }
+    }
+    ++type_;
+    bit_ = 0;
+  }
+}
+
+bool StreamIdSet::insert(StreamId id) {
+  auto& bitmap = bitmaps_[typeOf(id)];
+  uint64_t bit = bitOf(id);
+  uint64_t wordIndex = bit / kBitsPerWord;
+  if (wordIndex < bitmap.firstWord ||
+      wordIndex >= bitmap.firstWord + bitmap.words.size()) {
+    // Growing, which is when the words that are no longer used go away.
+    compact(bitmap);
+    if (bitmap.words.empty()) {
+      bitmap.firstWord = wordIndex;
+      bitmap.words.push_back(0);
+    } else if (wordIndex < bitmap.firstWord) {
+      bitmap.words.insert(
+          bitmap.words.begin(), bitmap.firstWord - wordIndex, 0);
+      bitmap.firstWord = wordIndex;
+    } else {
+      bitmap.words.resize(wordIndex - bitmap.firstWord + 1, 0);
+    }
+  }
+  auto& word = bitmap.words[wordIndex - bitmap.firstWord];
+  uint64_t mask = 1ULL << (bit % kBitsPerWord);
+  if (word & mask) {
+    return false;
+  }
+  word |= mask;
+  ++bitmap.size;
+  ++size_;
+  return true;
+}
+
+size_t StreamIdSet::erase(StreamId id) {
+  auto& bitmap = bitmaps_[typeOf(id)];
+  uint64_t wordIndex = bitOf(id) / kBitsPerWord;
+  if (wordIndex < bitmap.firstWord ||
+      wordIndex >= bitmap.firstWord + bitmap.words.size()) {
+    return 0;
+  }
+  auto& word = bitmap.words[wordIndex - bitmap.firstWord];
+  uint64_t mask = 1ULL << (bitOf(id) % kBitsPerWord);
+  if (!(word & mask)) {
+    return 0;
+  }
+  word &= ~mask;
+  --bitmap.size;
+  --size_;
+  return 1;
+}
+
+StreamIdSet::const_iterator StreamIdSet::erase(const_iterator it) {
+  erase(*it);
+  return ++it;
+}
+
+size_t StreamIdSet::count(StreamId id) const {
+  const auto& bitmap = bitmaps_[typeOf(id)];
+  uint64_t wordIndex = bitOf(id) / kBitsPerWord;
+  if (wordIndex < bitmap.firstWord ||
+      wordIndex >= bitmap.firstWord + bitmap.words.size()) {
+    return 0;
+  }
+  uint64_t mask = 1ULL << (bitOf(id) % kBitsPerWord);
+  return (bitmap.words[wordIndex - bitmap.firstWord] & mask) ? 1 : 0;
+}
+
+void StreamIdSet::clear() {
+  for (auto& bitmap : bitmaps_) {
+    // Keeps the capacity, the set is usually filled again soon.
+    bitmap.words.clear();
+    bitmap.firstWord = 0;
+    bitmap.size = 0;
+  }
+  size_ = 0;
+}
+
+void StreamIdSet::shrinkToFit() {
+  for (auto& bitmap : bitmaps_) {
+    compact(bitmap);
+    bitmap.words.shrink_to_fit();
+  }
+}
+
+StreamIdSet::const_iterator StreamIdSet::begin() const {
+  const_iterator it(this, 0, 0);
+  it.settle();
+  return it;
+}
+
+void StreamIdSet::compact(Bitmap& bitmap) {
+  if (bitmap.size == 0) {
+    bitmap.words.clear();
+    return;
+  }
+  while (bitmap.words.back() == 0) {
+    bitmap.words.pop_back();
+  }
+  auto firstUsed = std::find_if(
+      bitmap.words.begin(), bitmap.words.end(), [](uint64_t word) {
+        return word != 0;
+      });
+  bitmap.firstWord += firstUsed - bitmap.words.begin();
+  bitmap.words.erase(bitmap.words.begin(), firstUsed);
+}
+
+StreamIdRangeSet::const_iterator& StreamIdRangeSet::const_iterator::
+operator++() {
+  if (id_ < interval_->end) {
+    id_ += Intervals::interval_type::unitValue();
+  } else if (++interval_ != end_) {
+    id_ = interval_->start;
+  } else {
+    id_ = 0;
+  }
+  return *this;
+}
+
+void StreamIdRangeSet::insertRange(StreamId start, StreamId end) {
+  DCHECK(intervals_.empty() || start > intervals_.back().end);
+  DCHECK_EQ(
+      start % Intervals::interval_type::unitValue(),
+      end % Intervals::interval_type::unitValue());
+  intervals_.insert(start, end);
+  size_ += (end - start) / Intervals::interval_type::unitValue() + 1;
+}
+
+size_t StreamIdRangeSet::erase(StreamId id) {
+  if (find(id) == end()) {
+    return 0;
+  }
+  intervals_.withdraw({id, id});
+  --size_;
+  return 1;
+}
+
+StreamIdRangeSet::const_iterator StreamIdRangeSet::erase(const_iterator it) {
+  StreamId id = *it;
+  erase(id);
+  // Withdrawing may split the range, which moves the others around.
+  return atOrAfter(id + Intervals::interval_type::unitValue());
+}
+
+StreamIdRangeSet::const_iterator StreamIdRangeSet::find(StreamId id) const {
+  auto it = atOrAfter(id);
+  return it != end() && *it == id ? it : end();
+}
+
+StreamIdRangeSet::const_iterator StreamIdRangeSet::atOrAfter(
+    StreamId id) const {
+  auto interval = std::lower_bound(
+      intervals_.cbegin(),
+      intervals_.cend(),
+      id,
+      [](const Intervals::interval_type& interval, StreamId id) {
+        return interval.end < id;
+      });
+  if (interval == intervals_.cend()) {
+    return end();
+  }
+  return const_iterator(
+      interval, intervals_.cend(), std::max(interval->start, id));
+}
+
+} // namespace quic
@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/codec/Types.h>
+#include <quic/common/IntervalSet.h>
+
+#include <array>
+#include <iterator>
+#include <vector>
+
+namespace quic {
+
+/**
+ * A set of stream ids kept as one bitmap per stream type, indexed by the
+ * position of the stream among the streams of its type. Each bitmap only
+ * spans the words between the smallest and the largest id it held since it
+ * was last compacted, and the streams of a connection that are live at once
+ * are close together, so the bitmaps stay a few words long.
+ *
+ * Adding, removing and looking up a stream is a bit operation, and iterating
+ * skips 64 streams per empty word. Iteration is in increasing order of
+ * stream id within each type. Erasing never moves the bitmaps, so it doesn't
+ * invalidate iterators; inserting may.
+ */
+class StreamIdSet {
+ public:
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = StreamId;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const StreamId*;
+    using reference = StreamId;
+
+    const_iterator() = default;
+
+    StreamId operator*() const;
+
+    const_iterator& operator++();
+
+    const_iterator operator++(int) {
+      auto prev = *this;
+      ++*this;
+      return prev;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return type_ == other.type_ && bit_ == other.bit_;
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class StreamIdSet;
+
+    const_iterator(const StreamIdSet* set, size_t type, uint64_t bit)
+        : set_(set), type_(type), bit_(bit) {}
+
+    // Moves to the first stream at or after the current position.
+    void settle();
+
+    const StreamIdSet* set_{nullptr};
+    // kNumStreamTypes at the end.
+    size_t type_{kNumStreamTypes};
+    // Index of the bit in the bitmap of type_.
+    uint64_t bit_{0};
+  };
+
+  using iterator = const_iterator;
+  using value_type = StreamId;
+
+  /**
+   * Adds the stream. Returns false if it was already present.
+   */
+  bool insert(StreamId id);
+
+  bool emplace(StreamId id) {
+    return insert(id);
+  }
+
+  /**
+   * Removes the stream. Returns the number of streams removed.
+   */
+  size_t erase(StreamId id);
+
+  /**
+   * Removes the stream at the iterator, and returns the one after it.
+   */
+  const_iterator erase(const_iterator it);
+
+  size_t count(StreamId id) const;
+
+  const_iterator find(StreamId id) const {
+    return count(id) ? iteratorAt(id) : end();
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  void clear();
+
+  /**
+   * Frees the words of the bitmaps that no stream uses, which clear() and
+   * erase() keep.
+   */
+  void shrinkToFit();
+
+  const_iterator begin() const;
+
+  const_iterator end() const {
+    return const_iterator(this, kNumStreamTypes, 0);
+  }
+
+  const_iterator cbegin() const {
+    return begin();
+  }
+
+  const_iterator cend() const {
+    return end();
+  }
+
+ private:
+  // Client and server, bidirectional and unidirectional.
+  static constexpr size_t kNumStreamTypes = 4;
+
+  struct Bitmap {
+    // Index of the first word of words in the full bitmap of the type.
+    uint64_t firstWord{0};
+    std::vector<uint64_t> words;
+    // Number of streams of the type in the set.
+    size_t size{0};
+  };
+
+  static size_t typeOf(StreamId id) {
+    return id & (kNumStreamTypes - 1);
+  }
+
+  static uint64_t bitOf(StreamId id) {
+    return id / kNumStreamTypes;
+  }
+
+  const_iterator iteratorAt(StreamId id) const {
+    return const_iterator(this, typeOf(id), bitOf(id));
+  }
+
+  // Drops the empty words of the bitmap at both ends.
+  static void compact(Bitmap& bitmap);
+
+  std::array<Bitmap, kNumStreamTypes> bitmaps_;
+  size_t size_{0};
+};
+
+/**
+ * A set of stream ids of one stream type, kept as ranges of consecutive ids.
+ * Opening stream n implicitly opens every stream of its type below it, which
+ * is a single range however far the peer jumps ahead. Ids are only ever
+ * added past the largest one in the set.
+ */
+class StreamIdRangeSet {
+ public:
+  using Intervals = IntervalSet<StreamId, 4>;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = StreamId;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const StreamId*;
+    using reference = StreamId;
+
+    const_iterator() = default;
+
+    StreamId operator*() const {
+      return id_;
+    }
+
+    const_iterator& operator++();
+
+    const_iterator operator++(int) {
+      auto prev = *this;
+      ++*this;
+      return prev;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return interval_ == other.interval_ && id_ == other.id_;
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class StreamIdRangeSet;
+
+    const_iterator(
+        Intervals::const_iterator interval,
+        Intervals::const_iterator end,
+        StreamId id)
+        : interval_(interval), end_(end), id_(id) {}
+
+    Intervals::const_iterator interval_;
+    Intervals::const_iterator end_;
+    StreamId id_{0};
+  };
+
+  using iterator = const_iterator;
+  using value_type = StreamId;
+
+  /**
+   * Adds the streams from start to end, both included. start has to be past
+   * every stream in the set.
+   */
+  void insertRange(StreamId start, StreamId end);
+
+  bool insert(StreamId id) {
+    insertRange(id, id);
+    return true;
+  }
+
+  bool emplace(StreamId id) {
+    return insert(id);
+  }
+
+  /**
+   * Removes the stream. Returns the number of streams removed.
+   */
+  size_t erase(StreamId id);
+
+  /**
+   * Removes the stream at the iterator, and returns the one after it.
+   */
+  const_iterator erase(const_iterator it);
+
+  size_t count(StreamId id) const {
+    return find(id) != end() ? 1 : 0;
+  }
+
+  const_iterator find(StreamId id) const;
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  /**
+   * Number of streams, not of ranges.
+   */
+  size_t size() const {
+    return size_;
+  }
+
+  const Intervals& intervals() const {
+    return intervals_;
+  }
+
+  void clear() {
+    intervals_.clear();
+    size_ = 0;
+  }
+
+  const_iterator begin() const {
+    return atOrAfter(0);
+  }
+
+  const_iterator end() const {
+    return const_iterator(intervals_.cend(), intervals_.cend(), 0);
+  }
+
+  const_iterator cbegin() const {
+    return begin();
+  }
+
+  const_iterator cend() const {
+    return end();
+  }
+
+ private:
+  // The first stream that is id or larger.
+  const_iterator atOrAfter(StreamId id) const;
+
+  Intervals intervals_;
+  size_t size_{0};
+};
+
+} // namespace quic
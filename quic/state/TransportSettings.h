@@ -11,6 +11,7 @@
 #include <quic/QuicConstants.h>
 #include <quic/codec/QuicConnectionId.h>
 #include <chrono>
+#include <string>
 
 namespace quic {
 
@@ -39,6 +40,41 @@ struct BbrConfig {
   bool drainToTarget{false};
 };
 
+struct CopaConfig {
+  /**
+   * Whether Copa switches to competitive mode when the queue hasn't been
+   * nearly empty for competitiveModeRtts rtts, which means buffer filling cross
+   * traffic. Competitive mode grows 1 / delta by 1 per rtt and halves it upon
+   * loss, instead of keeping delta at latencyFactor.
+   */
+  bool competitiveModeEnabled{false};
+
+  // The queue is nearly empty when the standing rtt is within this fraction of
+  // (max rtt - min rtt) above the min rtt.
+  double nearlyEmptyQueueThreshold{kCopaNearlyEmptyQueueThreshold};
+
+  // Number of rtts without a nearly empty queue before competitive mode.
+  uint8_t competitiveModeRtts{kCopaCompetitiveModeRtts};
+
+  // Lower bound of delta in competitive mode.
+  double minCompetitiveDelta{kCopaMinCompetitiveDelta};
+};
+
+struct CubicConfig {
+  /**
+   * Whether slow start is exited with HyStart++ (RFC 9406), which goes
+   * through Conservative Slow Start rounds once the rtt starts to increase,
+   * instead of the delay increase and ack train methods.
+   */
+  bool hystartPlusPlus{false};
+
+  // Conservative Slow Start grows cwnd by 1 / cssGrowthDivisor of slow start.
+  uint8_t cssGrowthDivisor{kHystartPlusPlusCssGrowthDivisor};
+
+  // Number of Conservative Slow Start rounds before congestion avoidance.
+  uint8_t cssRounds{kHystartPlusPlusCssRounds};
+};
+
 struct TransportSettings {
   // The initial connection window advertised to the peer.
   uint64_t advertisedInitialConnectionWindowSize{kDefaultConnectionWindowSize};
@@ -53,25 +89,61 @@ struct TransportSettings {
   uint32_t maxPacketsToBuffer{kDefaultMaxBufferedPackets};
   // Idle timeout to advertise to the peer.
   std::chrono::milliseconds idleTimeout{kDefaultIdleTimeout};
+  // Keep the idle timer armed when activity pushes its deadline later, and
+  // rearm it for the rest when it fires, instead of rescheduling it for every
+  // packet.
+  bool lazyIdleTimer{true};
+  // Time without activity after which a connection gives back the storage
+  // its containers grew to, see compactIdleConnection(). 0 to never do it.
+  std::chrono::milliseconds idleCompactionTimeout{0};
   // Ack delay exponent to use.
   uint64_t ackDelayExponent{kDefaultAckDelayExponent};
   // Default congestion controller type.
   CongestionControlType defaultCongestionController{
       CongestionControlType::Cubic};
+  // Name of a custom congestion controller registered with
+  // DefaultCongestionControllerFactory, which takes precedence over
+  // defaultCongestionController when it is registered.
+  std::string congestionControllerName;
+  // Whether connections start from the rtt and cwnd that earlier connections
+  // learned about the same network. The server keeps a PathStateCache for
+  // that, the client uses what comes with a resumed 0-rtt session.
+  bool cachePathState{false};
+  // Whether NewReno and Cubic send through a recovery period with
+  // Proportional Rate Reduction (RFC 6937), in step with the acks, instead of
+  // waiting for the bytes in flight to drain below the reduced cwnd.
+  bool proportionalRateReduction{false};
   // Param to determine sensitivity of CongestionController to latency. Only
-  // used by COPA.
+  // used by COPA, as its default mode delta.
   folly::Optional<double> latencyFactor;
   // The max UDP packet size we are willing to receive.
   uint64_t maxRecvPacketSize{kDefaultUDPReadBufferSize};
   // Can we ignore the path mtu when sending a packet. This is useful for
   // testing.
   bool canIgnorePathMTU{false};
+  // Whether to search for a larger packet size with padded PING probes, as
+  // in RFC 8899, up to the smaller of maxPathMtuProbeSize and the peer's
+  // max_packet_size.
+  bool enablePathMtuDiscovery{false};
+  uint64_t maxPathMtuProbeSize{kDefaultMaxPathMtuProbeSize};
+  // Packet size to probe first, such as the one an earlier connection found
+  // on the same path. 0 for none.
+  uint64_t pathMtuProbeHint{0};
   // Whether or not to use a connected UDP socket on the client. This should
   // only be used in environments where you know your IP address does not
   // change. See AsyncUDPSocket::connect for the caveats.
   bool connectUDP{false};
+  // Bytes a server connection sends before it moves off the worker socket
+  // onto a UDP socket of its own, connected to the peer. 0 never moves it.
+  // The new socket joins the SO_REUSEPORT group of the listener, and the
+  // kernel prefers it over the group for packets from the peer.
+  uint64_t serverConnectedSocketMinBytes{0};
   // Maximum number of consecutive PTOs before the connection is torn down.
   uint16_t maxNumPTOs{kDefaultMaxNumPTO};
+  // Arm the first PTO as a tail loss probe, after about 2 * srtt rather than
+  // the full PTO, so that a lost tail of a short response is retransmitted
+  // sooner. Further PTOs back off from the full PTO as usual.
+  bool tailLossProbe{false};
   // Whether to turn off PMTUD on the socket
   bool turnoffPMTUD{false};
   // Whether to listen to socket error
@@ -80,29 +152,99 @@ struct TransportSettings {
   bool pacingEnabled{false};
   // The minimum number of packets to burst out during pacing
   uint64_t minBurstPackets{kDefaultMinBurstPackets};
-  // Pacing timer tick interval
+  // Pacing timer tick interval, also the granularity of the loss and ack
+  // timers with useHighResTimers.
   std::chrono::microseconds pacingTimerTickInterval{
       kDefaultPacingTimerTickInterval};
+  // Whether paced writes hand every packet to the kernel with an SCM_TXTIME
+  // departure time for the fq qdisc to enforce, instead of writing a burst per
+  // pacing timer tick. Turned off if the socket doesn't support SO_TXTIME.
+  bool pacingUsesTxTime{false};
+  // Whether the server paces all the connections of a worker from a single
+  // calendar queue on the pacing timer, instead of each connection keeping
+  // its own timeout on it.
+  bool usePacingScheduler{false};
+  // Whether the loss, PTO and ack timers run on the high res timer the server
+  // worker shares for pacing, at the granularity of pacingTimerTickInterval,
+  // instead of the EventBase's millisecond wheel. Low RTT paths otherwise get
+  // their ack delays and PTOs rounded to milliseconds.
+  bool useHighResTimers{false};
+  // Bytes an incremental stream may write per turn when it shares the
+  // connection with the other streams of its priority level, deficit round
+  // robin style. Smaller quanta interleave streams within packets, so small
+  // responses don't wait behind bulk transfers. 0 lets each stream write as
+  // much as fits, and the next packet start with the stream the last one
+  // stopped at.
+  uint64_t streamSchedulingQuantum{0};
+  // A connection loops hot when, over hotLoopWindow, it wakes up for reads and
+  // writes at least hotLoopMinWakeups times and moves fewer than
+  // hotLoopMinBytesPerWakeup bytes per wakeup on average, e.g. a buggy peer
+  // making it spin. Each window it keeps doing so gets the next mitigation:
+  // pacing it, sending more packets per pacing burst, then closing it. 0
+  // turns the detection off.
+  uint64_t hotLoopMinBytesPerWakeup{0};
+  uint64_t hotLoopMinWakeups{kDefaultHotLoopMinWakeups};
+  std::chrono::milliseconds hotLoopWindow{kDefaultHotLoopWindow};
+  // Whether the server writes the packets of all the connections of a worker
+  // with one sendmmsg call at the end of each loop, instead of each connection
+  // writing its own. Connections paced with SCM_TXTIME still write their own.
+  bool useSharedEgressBatch{false};
   ZeroRttSourceTokenMatchingPolicy zeroRttSourceTokenMatchingPolicy{
       ZeroRttSourceTokenMatchingPolicy::LIMIT_IF_NO_EXACT_MATCH};
   bool attemptEarlyData{true};
+  // Whether the data of new streams may be sent in 0-RTT packets. Apps whose
+  // requests aren't all replay safe can turn this off and allow it per stream
+  // with QuicSocket::setStreamEarlyData.
+  bool earlyDataAllowedByDefault{true};
+  // Bytes the client writes in 0-RTT packets before the handshake completes,
+  // on top of the limits from the cached transport parameters. 0 for no
+  // limit beyond those.
+  uint64_t maxZeroRttBytes{0};
   // Maximum number of packets the connection will write in
   // writeConnectionDataToSocket.
   uint64_t writeConnectionDataPacketsLimit{
       kDefaultWriteConnectionDataPacketLimit};
   // Fraction of RTT that is used to limit how long a write function can loop
   DurationRep writeLimitRttFraction{kDefaultWriteLimitRttFraction};
+  // Time a transport may spend in one run of its write loop, or of its read
+  // callbacks, before it yields the EventBase to the other transports on it
+  // and carries on in the next loop. At least one packet is written, or one
+  // callback invoked, each time. 0 for no limit.
+  std::chrono::microseconds loopWorkBudget{0us};
+  // While reading a batch of packets, write the acks that are due after this
+  // many packets, or this long, before reading on, so that a large burst
+  // doesn't hold back the acks the peer clocks its sending on. 0 for no limit.
+  uint32_t readPacketsBeforeWrite{0};
+  std::chrono::microseconds readTimeBeforeWrite{0us};
+  // Write a packet of only acks, when they are all there is to write, straight
+  // from the ack state, without going through the frame schedulers.
+  bool ackOnlyFastPath{false};
   // Frequency of sending flow control updates. We can send one update every
   // flowControlRttFrequency * RTT if the flow control changes.
   uint16_t flowControlRttFrequency{2};
   // Frequency of sending flow control updates. We can send one update every
   // flowControlWindowFrequency * window if the flow control changes.
   uint16_t flowControlWindowFrequency{2};
+  // Double the connection or a stream flow control window whenever the
+  // application consumes it in under kReceiveWindowAutotuneRttMultiplier RTTs,
+  // up to min(maxReceiveWindowSize, totalBufferSpaceAvailable).
+  bool autotuneReceiveWindow{false};
+  uint64_t maxReceiveWindowSize{kDefaultMaxReceiveWindowSize};
   // batching mode
   QuicBatchingMode batchingMode{QuicBatchingMode::BATCHING_MODE_NONE};
   // maximum number of packets we can batch. This does not apply to
   // BATCHING_MODE_NONE
   uint32_t maxBatchSize{kDefaultQuicMaxBatchSize};
+  // Whether each connection sizes its batches, up to maxBatchSize, from its
+  // congestion window, its pacing burst and the bursts it has been losing
+  // packets in, see getWriteBatchSize().
+  bool adaptiveBatchSize{false};
+  // With an encrypt executor set on the transport, batches of at least this
+  // many packets are encrypted on it as well as on the transport's thread,
+  // spread over at most encryptOffloadMaxHelpers of its threads. Only the
+  // DataPathType::ChainedMemory path encrypts in batches.
+  uint32_t encryptOffloadMinBatchSize{8};
+  uint32_t encryptOffloadMaxHelpers{3};
   // Sets network unreachable to be a non fatal error. In some environments,
   // EHOSTUNREACH or ENETUNREACH could just be because the routing table is
   // being setup. This option makes those non fatal connection errors.
@@ -131,11 +273,109 @@ struct TransportSettings {
       kDefaultRxPacketsBeforeAckInitThreshold};
   uint16_t rxPacketsBeforeAckBeforeInit{kDefaultRxPacketsBeforeAckBeforeInit};
   uint16_t rxPacketsBeforeAckAfterInit{kDefaultRxPacketsBeforeAckAfterInit};
+  // Whether to advertise min_ack_delay, which allows the peer to tune our ack
+  // rate with ACK_FREQUENCY frames.
+  bool advertiseMinAckDelay{false};
+  // The smallest ack delay the peer may ask us for.
+  std::chrono::microseconds minAckDelay{kDefaultMinAckDelay};
+  // Whether to send ACK_FREQUENCY frames to a peer that advertised
+  // min_ack_delay, asking for fewer acks as the congestion window grows.
+  bool sendAckFrequency{false};
+  // Most disjoint ranges of received packet numbers kept to ack, per packet
+  // number space. The oldest ones are dropped past it; if our acks for them
+  // were lost the peer retransmits what they carried.
+  uint64_t maxAckRanges{kDefaultMaxAckRanges};
+  // Largest DATAGRAM frame we accept, type and length included, advertised as
+  // max_datagram_frame_size. 0 doesn't advertise it, which turns datagrams
+  // off in both directions for the peer.
+  uint16_t maxDatagramFrameSize{0};
+  // DATAGRAMs received and not read yet, and written and not sent yet, that
+  // are kept. Past these the oldest ones are dropped.
+  uint32_t datagramReadBufferSize{kDefaultMaxDatagramsBuffered};
+  uint32_t datagramWriteBufferSize{kDefaultMaxDatagramsBuffered};
+  // Whether to advertise that we take FEC_REPAIR frames and recover the lost
+  // packets they cover.
+  bool advertiseFecSupport{false};
+  // Send a FEC_REPAIR frame after about this many packets of stream data to
+  // a peer that advertised support for it, 0 never sends them. Capped at
+  // kMaxFecWindowSize.
+  uint32_t fecWindowSize{0};
+  // How much of a file given to writeFile() is read into the write buffer of
+  // its stream, and not sent yet, at most. The rest is read as it drains.
+  uint64_t fileWriteBufferSize{kDefaultFileWriteBufferSize};
+  // The longest time stream data is held back while a connection is corked
+  // with setCork() and less than a packet of it is buffered.
+  std::chrono::milliseconds maxCorkDelay{kDefaultMaxCorkDelay};
+  // The longest time flow control updates are held back, when there is
+  // nothing else to write, for an ack or data packet to carry them. 0 sends
+  // them right away.
+  std::chrono::milliseconds maxWindowUpdateDelay{0};
   // Limits the amount of data that should be buffered in a QuicSocket.
   // If the amount of data in the buffer equals or exceeds this amount, then
   // the callback registered through notifyPendingWriteOnConnection() will
   // not be called
   uint64_t totalBufferSpaceAvailable{kDefaultBufferSpaceAvailable};
+  // Like TCP_NOTSENT_LOWAT: the write ready callbacks are only called while
+  // less than this much written data is unsent, on the connection and on the
+  // stream, and for no more than what is left below it. 0 for no limit.
+  uint64_t notSentLowWatermark{0};
+  // Raise notSentLowWatermark to the congestion window, so that what is
+  // buffered can always fill it.
+  bool autoNotSentLowWatermark{false};
+  // Limit on the bytes received but not yet read across all the connections of
+  // a server worker, 0 for none. Past it the flow control windows advertised
+  // are divided by kReceiveBufferPressureWindowDivisor.
+  uint64_t workerReceiveBufferLimit{0};
+  // Number of slots in the direct mapped table a server worker looks up
+  // connection ids in before its map, 0 for no table.
+  uint32_t connectionIdTableSize{0};
+  // Connection ids, with their stateless reset tokens, that a server worker
+  // generates ahead of the connections issuing them, 0 to generate each one
+  // when it is issued.
+  uint32_t connectionIdPoolSize{0};
+  // Whether a server connection that closes hands its connection ids and its
+  // close packet to its worker and is freed, rather than staying around until
+  // the end of its drain period to answer packets with the close.
+  bool compactDrainingState{false};
+  // Connections each server worker closes per loop iteration when the server
+  // shuts down, with the workers closing theirs at the same time. 0 to close
+  // them all in one go, one worker after the other.
+  uint32_t shutdownConnectionsPerLoop{0};
+  // New connections a server worker accepts each second from clients which
+  // have not validated their address. Past it Initials without a valid token
+  // are answered with a Retry. 0 never sends a Retry.
+  uint64_t retryNewConnectionRateLimit{0};
+  // Retries a server worker sends each second, past which it drops Initials
+  // without a valid token instead. 0 for no limit.
+  uint64_t maxRetriesPerSecond{0};
+  // Version negotiation and stateless reset packets a server worker sends
+  // each second, past which the packets that would trigger them are dropped
+  // without an answer. 0 for no limit.
+  uint64_t maxStatelessResponsesPerSecond{0};
+  // The same for each client IP address, which may also send a burst of that
+  // many at once. 0 for no limit.
+  uint64_t maxStatelessResponsesPerClientPerSecond{0};
+  // The same for each client network, a /24 for IPv4 and a /48 for IPv6, so
+  // that many clients behind a NAT or in one subnet can't use up the worker's
+  // limit. 0 for no limit.
+  uint64_t maxStatelessResponsesPerNetworkPerSecond{0};
+  // New connections a server worker accepts each second from each client
+  // address, a /64 for IPv6, and from each client network, past which their
+  // Initials are dropped before they count towards
+  // retryNewConnectionRateLimit. Counted in a fixed size sketch, whatever the
+  // number of clients. 0 for no limit.
+  uint64_t maxNewConnectionsPerClientPerSecond{0};
+  uint64_t maxNewConnectionsPerNetworkPerSecond{0};
+  // Smoothed time a server worker's event loop may be busy for each loop
+  // before the worker sheds new connections: it answers Initials without a
+  // valid token with a Retry if retryNewConnectionRateLimit is set, and drops
+  // them otherwise. 0 never sheds.
+  std::chrono::microseconds overloadLoopBusyTime{0};
+  // Stream writes shorter than this are copied into buffers of this size
+  // instead of being chained into the stream's write buffer, so that many
+  // small writes don't turn into many IOBuf clones when frames are split off.
+  // 0 disables the copy.
+  uint64_t writeBufferChunkSize{0};
   // Whether or not to advertise partial reliability capability
   bool partialReliabilityEnabled{false};
   // Whether the endpoint allows peer to migrate to new address
@@ -156,18 +396,72 @@ struct TransportSettings {
   bool shouldRecvBatch{false};
   // Whether or not use recvmmsg when shouldRecvBatch is true.
   bool shouldUseRecvmmsgForBatchRecv{false};
+  // Whether or not to enable UDP GRO on the socket, so that the kernel can
+  // hand us several datagrams from the same peer in a single read.
+  bool shouldUseGROForRecv{false};
+  // How long a server worker keeps polling its socket once it has read a
+  // packet, instead of waiting in epoll for the next one, 0 never polls.
+  // Only with shouldRecvBatch. The socket gets SO_BUSY_POLL too.
+  std::chrono::microseconds busyPollWindow{0};
+  // Percent of the time a worker may spend polling without reading anything.
+  // Past it, the worker waits in epoll until the end of the period.
+  uint32_t busyPollCpuBudgetPercent{10};
+  // Whether to mark sent packets with ECT(0), read the ECN codepoint of
+  // received ones, and report the counts in ACK_ECN frames.
+  bool enableEcn{false};
+  // Whether to take the receive time of packets from the kernel's software
+  // RX timestamps, so that time spent in the event loop before the read
+  // doesn't end up in the RTT and delivery rate samples. Only the reads that
+  // go through recvmsg / recvmmsg get them, i.e. the batched reads of the
+  // server worker and the client reads.
+  bool enableRecvTimestamps{false};
+  // Whether server workers read the count of packets the kernel dropped for
+  // want of room in the receive buffer of their socket, and report them to
+  // the stats callback. Only with shouldRecvBatch.
+  bool monitorSocketDrops{false};
+  // With monitorSocketDrops, the SO_RCVBUF up to which a worker doubles the
+  // receive buffer of its socket whenever the kernel drops packets, 0 leaves
+  // it as configured. The kernel caps it at net.core.rmem_max.
+  uint32_t maxSocketRecvBufferSize{0};
+  // Whether large GSO batches are written with MSG_ZEROCOPY, so the kernel
+  // sends them from our buffers instead of copying them. Needs
+  // enableSocketErrMsgCallback on the client, for the kernel's completions.
+  bool enableZeroCopySend{false};
   // Config struct for BBR
   BbrConfig bbrConfig;
+  // Config struct for Cubic
+  CubicConfig cubicConfig;
+  // Config struct for Copa
+  CopaConfig copaConfig;
   // A packet is considered loss when a packet that's sent later by at least
   // timeReorderingThreshold * RTT is acked by peer.
   DurationRep timeReorderingThreshDividend{
       kDefaultTimeReorderingThreshDividend};
   DurationRep timeReorderingThreshDivisor{kDefaultTimeReorderingThreshDivisor};
+  // Widen the reordering thresholds above when the peer acks packets that
+  // were declared lost, and narrow them back as losses turn out to be real.
+  bool adaptiveReordering{false};
+  // Whether to send the Initial, Handshake and 1-RTT packets of a write in as
+  // few datagrams as they fit in, instead of a datagram each. Server Initials
+  // are no longer padded to a full datagram then.
+  bool coalescePackets{false};
   // Whether to close client transport on read error from socket
   bool closeClientOnReadError{false};
+  // Whether to account each connection's event loop time to reading,
+  // writing, crypto and callbacks, see ConnectionCpuTime.
+  bool trackCpuTime{false};
   // A temporary type to control DataPath write style. Will be gone after we
   // are done with experiment.
   DataPathType dataPathType{DataPathType::ChainedMemory};
+  // Plaintext bodies of its most recent AppData packets a connection keeps,
+  // so that a clone of one whose frames are all unchanged reuses the body as
+  // is instead of being rebuilt frame by frame. Only the
+  // DataPathType::ChainedMemory path keeps them. 0 keeps none.
+  uint32_t sentPayloadCacheSize{0};
+  // 1-RTT packets to write with the same keys before updating them, to stay
+  // within the usage limits of the AEAD. Key updates the peer starts are
+  // followed either way. 0 never starts one.
+  uint64_t oneRttKeyUpdatePacketInterval{0};
 };
 
 } // namespace quic
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace quic {
+
+/**
+ * Why a call to writeConnectionDataToSocket stopped writing.
+ */
+enum class WriteLoopEndReason : uint8_t {
+  // Nothing left to write, or nothing that fit in a packet.
+  APP_LIMITED,
+  // No writable bytes: the congestion window, or the amplification limit
+  // before the peer's address is validated.
+  CWND_LIMITED,
+  // writeConnectionDataPacketsLimit, or the number of probes to send.
+  PACKET_LIMIT,
+  // The pacer's burst size.
+  PACING_LIMIT,
+  // Wrote for longer than srtt / writeLimitRttFraction.
+  TIME_LIMIT,
+  // Wrote for longer than TransportSettings::loopWorkBudget.
+  WORK_BUDGET,
+  SOCKET_ERROR,
+  // NOTE: MAX should always be at the end
+  MAX
+};
+
+inline const char* toString(WriteLoopEndReason reason) {
+  switch (reason) {
+    case WriteLoopEndReason::APP_LIMITED:
+      return "APP_LIMITED";
+    case WriteLoopEndReason::CWND_LIMITED:
+      return "CWND_LIMITED";
+    case WriteLoopEndReason::PACKET_LIMIT:
+      return "PACKET_LIMIT";
+    case WriteLoopEndReason::PACING_LIMIT:
+      return "PACING_LIMIT";
+    case WriteLoopEndReason::TIME_LIMIT:
+      return "TIME_LIMIT";
+    case WriteLoopEndReason::WORK_BUDGET:
+      return "WORK_BUDGET";
+    case WriteLoopEndReason::SOCKET_ERROR:
+      return "SOCKET_ERROR";
+    case WriteLoopEndReason::MAX:
+      return "MAX";
+  }
+  return "UNKNOWN";
+}
+
+/**
+ * How a connection's write loops went. A flush is one socket write of a
+ * batch, so packetsFlushed / batchFlushes is the average number of GSO
+ * segments or sendmmsg messages per syscall.
+ */
+struct WriteLoopStats {
+  std::array<uint64_t, static_cast<size_t>(WriteLoopEndReason::MAX)>
+      endReasons{};
+  uint64_t writeLoops{0};
+  uint64_t packetsWritten{0};
+  uint64_t batchFlushes{0};
+  uint64_t packetsFlushed{0};
+  uint64_t bytesFlushed{0};
+
+  uint64_t numEnded(WriteLoopEndReason reason) const {
+    return endReasons[static_cast<size_t>(reason)];
+  }
+};
+} // namespace quic
@@ -88,6 +88,9 @@ void sendRstSMHandler(QuicStreamState& stream, ApplicationErrorCode errorCode) {
 void sendAckSMHandler(
     QuicStreamState& stream,
     const WriteStreamFrame& ackedFrame) {
+  recordHandshakeTiming(
+      stream.conn.handshakeTimings.firstAppDataAcked,
+      stream.conn.connectionTime);
   switch (stream.sendState) {
     case StreamSendState::Open_E: {
       // Clean up the acked buffers from the retransmissionBuffer.
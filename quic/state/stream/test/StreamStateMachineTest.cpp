@@ -13,6 +13,7 @@
 
 #include <quic/api/QuicTransportFunctions.h>
 #include <quic/codec/DefaultConnectionIdAlgo.h>
+#include <quic/common/test/AllocationCounter.h>
 #include <quic/common/test/TestUtils.h>
 #include <quic/state/QuicStreamFunctions.h>
 #include <quic/state/stream/StreamReceiveHandlers.h>
@@ -69,6 +70,30 @@ TEST_F(QuicOpenStateTest, ReadStreamDataNotFin) {
   EXPECT_EQ(stream.recvState, StreamRecvState::Open_E);
 }
 
+TEST_F(QuicOpenStateTest, ReadInOrderDataNoAllocations) {
+  auto conn = createConn();
+  StreamId id = 5;
+  QuicStreamState stream(id, *conn);
+  uint64_t offset = 0;
+  auto receive = [&](bool measure) {
+    ReadStreamFrame frame(id, offset, false);
+    frame.data = IOBuf::copyBuffer("hey");
+    offset += frame.data->computeChainDataLength();
+    if (measure) {
+      EXPECT_NO_ALLOCATIONS(
+          receiveReadStreamFrameSMHandler(stream, std::move(frame)));
+    } else {
+      receiveReadStreamFrameSMHandler(stream, std::move(frame));
+    }
+    readDataFromQuicStream(stream);
+  };
+  // The first frames set up the read buffer.
+  receive(false);
+  receive(false);
+  receive(true);
+  EXPECT_EQ(stream.currentReadOffset, offset);
+}
+
 TEST_F(QuicOpenStateTest, ReadInvalidData) {
   auto conn = createConn();
   StreamId id = 5;
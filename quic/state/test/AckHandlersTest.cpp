@@ -9,6 +9,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <quic/common/test/AllocationCounter.h>
 #include <quic/common/test/TestUtils.h>
 
 #include <quic/logging/test/Mocks.h>
@@ -301,6 +302,65 @@ TEST_P(AckHandlersTest, TestNonSequentialPacketNumbers) {
       remainingPackets.end()));
 }
 
+TEST_P(AckHandlersTest, TestAckBlocksWithOtherSpaces) {
+  QuicServerConnectionState conn;
+  conn.lossState.reorderingThreshold = 10;
+  conn.lossState.srtt = 10s;
+  auto otherSpace = GetParam() == PacketNumberSpace::AppData
+      ? PacketNumberSpace::Handshake
+      : PacketNumberSpace::AppData;
+  // Packets of another space are interleaved after every third packet.
+  for (PacketNum packetNum = 0; packetNum < 10; packetNum++) {
+    auto regularPacket = createNewPacket(packetNum, GetParam());
+    regularPacket.frames.emplace_back(WriteStreamFrame(packetNum, 0, 0, true));
+    conn.outstandingPackets.emplace_back(OutstandingPacket(
+        std::move(regularPacket), Clock::now(), 1, false, packetNum));
+    if (packetNum % 3 == 0) {
+      conn.outstandingPackets.emplace_back(OutstandingPacket(
+          createNewPacket(packetNum, otherSpace),
+          Clock::now(),
+          1,
+          false,
+          packetNum));
+    }
+  }
+
+  ReadAckFrame ackFrame;
+  ackFrame.largestAcked = 9;
+  ackFrame.ackBlocks.emplace_back(8, 9);
+  ackFrame.ackBlocks.emplace_back(4, 6);
+  ackFrame.ackBlocks.emplace_back(0, 1);
+  std::vector<PacketNum> ackedPackets;
+  std::vector<PacketNum> lostPackets;
+  processAckFrame(
+      conn,
+      GetParam(),
+      ackFrame,
+      [&](const auto& outstandingPacket, const auto&, const ReadAckFrame&) {
+        ackedPackets.push_back(
+            outstandingPacket.packet.header.getPacketSequenceNum());
+      },
+      testLossHandler(lostPackets),
+      Clock::now());
+  EXPECT_EQ(std::vector<PacketNum>({9, 8, 6, 5, 4, 1, 0}), ackedPackets);
+
+  std::vector<std::pair<PacketNum, PacketNumberSpace>> expected = {
+      {0, otherSpace},
+      {2, GetParam()},
+      {3, GetParam()},
+      {3, otherSpace},
+      {6, otherSpace},
+      {7, GetParam()},
+      {9, otherSpace}};
+  std::vector<std::pair<PacketNum, PacketNumberSpace>> remaining;
+  for (const auto& packet : conn.outstandingPackets) {
+    remaining.emplace_back(
+        packet.packet.header.getPacketSequenceNum(),
+        packet.packet.header.getPacketNumberSpace());
+  }
+  EXPECT_EQ(expected, remaining);
+}
+
 TEST_P(AckHandlersTest, AckVisitorForAckTest) {
   QuicServerConnectionState conn;
   conn.connectionTime = Clock::now();
@@ -893,6 +953,186 @@ TEST_P(AckHandlersTest, AckEventCreation) {
       ackTime);
 }
 
+TEST_P(AckHandlersTest, AckEventRateSample) {
+  QuicServerConnectionState conn;
+  auto mockCongestionController = std::make_unique<MockCongestionController>();
+  auto rawCongestionController = mockCongestionController.get();
+  conn.congestionController = std::move(mockCongestionController);
+
+  auto ackTime = Clock::now();
+  for (PacketNum packetNum = 0; packetNum < 2; packetNum++) {
+    auto regularPacket = createNewPacket(packetNum, GetParam());
+    WriteStreamFrame frame(packetNum, 0, 0, true);
+    regularPacket.frames.emplace_back(std::move(frame));
+    OutstandingPacket sentPacket(
+        std::move(regularPacket),
+        ackTime - 100ms + 50ms * packetNum,
+        1000,
+        false /* handshake */,
+        1000 * (packetNum + 1));
+    sentPacket.isAppLimited = packetNum == 1;
+    conn.outstandingPackets.emplace_back(sentPacket);
+  }
+
+  ReadAckFrame ackFrame;
+  ackFrame.largestAcked = 1;
+  ackFrame.ackBlocks.emplace_back(0, 1);
+  EXPECT_CALL(*rawCongestionController, onPacketAckOrLoss(_, _))
+      .Times(1)
+      .WillOnce(Invoke([&](auto ack, auto /* loss */) {
+        // Neither packet has last acked info, so each is its size over its
+        // rtt and the later one is faster.
+        ASSERT_TRUE(ack->rateSample.has_value());
+        EXPECT_EQ(1000 * 1000 / 50, ack->rateSample->bandwidth.normalize());
+        EXPECT_TRUE(ack->rateSample->isAppLimited);
+      }));
+
+  processAckFrame(
+      conn,
+      GetParam(),
+      ackFrame,
+      [](const auto&, const auto&, const auto&) {},
+      [](auto&, auto&, bool, PacketNum) {},
+      ackTime);
+}
+
+TEST_P(AckHandlersTest, LargeCumulativeAck) {
+  QuicServerConnectionState conn;
+  auto mockCongestionController = std::make_unique<MockCongestionController>();
+  auto rawCongestionController = mockCongestionController.get();
+  conn.congestionController = std::move(mockCongestionController);
+
+  auto sentTime = Clock::now() - 100ms;
+  conn.lossState.totalBytesSent = 200 * 100;
+  for (PacketNum packetNum = 0; packetNum < 200; packetNum++) {
+    auto regularPacket = createNewPacket(packetNum, GetParam());
+    WriteStreamFrame frame(3, packetNum * 100, 100, false);
+    regularPacket.frames.emplace_back(std::move(frame));
+    conn.outstandingPackets.emplace_back(OutstandingPacket(
+        std::move(regularPacket),
+        sentTime,
+        100,
+        false /* handshake */,
+        100 * (packetNum + 1)));
+  }
+
+  ReadAckFrame ackFrame;
+  ackFrame.largestAcked = 199;
+  ackFrame.ackBlocks.emplace_back(0, 199);
+  EXPECT_CALL(*rawCongestionController, onPacketAckOrLoss(_, _))
+      .Times(1)
+      .WillOnce(Invoke([&](auto ack, auto /* loss */) {
+        EXPECT_EQ(200, ack->ackedPackets.size());
+        EXPECT_EQ(200 * 100, ack->ackedBytes);
+      }));
+  uint32_t visited = 0;
+  auto ackTime = Clock::now();
+  processAckFrame(
+      conn,
+      GetParam(),
+      ackFrame,
+      [&](const auto&, const auto&, const auto&) { ++visited; },
+      [](auto&, auto&, bool, PacketNum) {},
+      ackTime);
+  EXPECT_EQ(200, visited);
+  EXPECT_TRUE(conn.outstandingPackets.empty());
+  EXPECT_EQ(200 * 100, conn.lossState.totalBytesAcked);
+  EXPECT_EQ(200 * 100, conn.lossState.totalBytesAckedAtLastAck);
+  EXPECT_EQ(200 * 100, conn.lossState.totalBytesSentAtLastAck);
+  ASSERT_TRUE(conn.lossState.lastAckedTime.has_value());
+  EXPECT_EQ(ackTime, *conn.lossState.lastAckedTime);
+  ASSERT_TRUE(conn.lossState.lastAckedPacketSentTime.has_value());
+  EXPECT_EQ(sentTime, *conn.lossState.lastAckedPacketSentTime);
+}
+
+TEST_P(AckHandlersTest, AckEcnCeMarks) {
+  QuicServerConnectionState conn;
+  auto mockCongestionController = std::make_unique<MockCongestionController>();
+  auto rawCongestionController = mockCongestionController.get();
+  conn.congestionController = std::move(mockCongestionController);
+
+  TimePoint largestSentTime;
+  for (PacketNum packetNum = 0; packetNum < 4; packetNum++) {
+    auto regularPacket = createNewPacket(packetNum, GetParam());
+    WriteStreamFrame frame(packetNum * 4, 0, 0, true);
+    regularPacket.frames.emplace_back(std::move(frame));
+    largestSentTime =
+        Clock::now() - 100ms + std::chrono::milliseconds(packetNum);
+    conn.outstandingPackets.emplace_back(OutstandingPacket(
+        std::move(regularPacket),
+        largestSentTime,
+        1,
+        false /* handshake */,
+        packetNum));
+  }
+  auto processAck = [&](PacketNum start, PacketNum end, EcnCounts counts) {
+    ReadAckFrame ackFrame;
+    ackFrame.largestAcked = end;
+    ackFrame.ackBlocks.emplace_back(start, end);
+    ackFrame.ecnCounts = counts;
+    processAckFrame(
+        conn,
+        GetParam(),
+        ackFrame,
+        [](const auto&, const auto&, const auto&) {},
+        [](auto&, auto&, bool, PacketNum) {},
+        Clock::now());
+  };
+
+  EcnCounts counts;
+  counts.ect0 = 1;
+  counts.ce = 1;
+  EXPECT_CALL(*rawCongestionController, onPacketAckOrLoss(_, _)).Times(3);
+  EXPECT_CALL(*rawCongestionController, onPacketsCeMarked(1, _)).Times(1);
+  processAck(0, 1, counts);
+
+  // No new CE mark, no callback.
+  counts.ect0 = 2;
+  processAck(2, 2, counts);
+
+  counts.ce = 3;
+  EXPECT_CALL(*rawCongestionController, onPacketsCeMarked(2, largestSentTime))
+      .Times(1);
+  processAck(3, 3, counts);
+  EXPECT_EQ(2, getAckState(conn, GetParam()).peerEcnCounts.ect0);
+  EXPECT_EQ(3, getAckState(conn, GetParam()).peerEcnCounts.ce);
+}
+
+TEST_P(AckHandlersTest, AckAllocations) {
+  QuicServerConnectionState conn;
+  conn.lossState.srtt = 10s;
+  auto sentTime = Clock::now() - 100ms;
+  for (PacketNum packetNum = 0; packetNum < 10; packetNum++) {
+    auto regularPacket = createNewPacket(packetNum, GetParam());
+    WriteStreamFrame frame(3, packetNum * 100, 100, false);
+    regularPacket.frames.emplace_back(std::move(frame));
+    conn.lossState.totalBytesSent += 100;
+    conn.outstandingPackets.emplace_back(OutstandingPacket(
+        std::move(regularPacket),
+        sentTime,
+        100,
+        false /* handshake */,
+        conn.lossState.totalBytesSent));
+  }
+  auto processAck = [&](PacketNum packetNum) {
+    ReadAckFrame ackFrame;
+    ackFrame.largestAcked = packetNum;
+    ackFrame.ackBlocks.emplace_back(0, packetNum);
+    processAckFrame(
+        conn,
+        GetParam(),
+        ackFrame,
+        [](const auto&, const auto&, const auto&) {},
+        [](auto&, auto&, bool, PacketNum) {},
+        Clock::now());
+  };
+  processAck(0);
+  // Only the acked packets of the AckEvent handed to the congestion
+  // controller.
+  EXPECT_ALLOCATIONS_AT_MOST(1, processAck(1));
+  EXPECT_EQ(8, conn.outstandingPackets.size());
+}
+
 INSTANTIATE_TEST_CASE_P(
     AckHandlersTests,
     AckHandlersTest,
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/state/CountingQuicTransportStatsCallback.h>
+
+#include <folly/portability/GTest.h>
+
+#include <thread>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+using PacketDropReason = QuicTransportStatsCallback::PacketDropReason;
+using ConnectionCloseReason = QuicTransportStatsCallback::ConnectionCloseReason;
+
+TEST(QuicStatsHistogramTest, Buckets) {
+  for (uint64_t value = 0; value < QuicStatsHistogramSnapshot::kSubBuckets;
+       ++value) {
+    EXPECT_EQ(QuicStatsHistogramSnapshot::bucketIndex(value), value);
+  }
+  size_t lastIndex = 0;
+  for (uint64_t value : {8ULL, 9ULL, 100ULL, 1000ULL, 123456ULL, ~0ULL}) {
+    auto index = QuicStatsHistogramSnapshot::bucketIndex(value);
+    EXPECT_GT(index, lastIndex);
+    EXPECT_LT(index, QuicStatsHistogramSnapshot::kNumBuckets);
+    auto lower = QuicStatsHistogramSnapshot::bucketLowerBound(index);
+    EXPECT_LE(lower, value);
+    EXPECT_GE(lower, value - value / QuicStatsHistogramSnapshot::kSubBuckets);
+    EXPECT_EQ(QuicStatsHistogramSnapshot::bucketIndex(lower), index);
+    lastIndex = index;
+  }
+}
+
+TEST(QuicStatsHistogramTest, Percentile) {
+  QuicStatsHistogramSnapshot histogram;
+  EXPECT_EQ(histogram.percentile(50), 0);
+  for (uint64_t value = 1; value <= 100; ++value) {
+    ++histogram.buckets[QuicStatsHistogramSnapshot::bucketIndex(value)];
+  }
+  EXPECT_EQ(histogram.percentile(0), 1);
+  EXPECT_EQ(histogram.percentile(50), 48);
+  EXPECT_EQ(histogram.percentile(100), 96);
+}
+
+TEST(CountingQuicTransportStatsCallbackTest, Counts) {
+  auto collector = std::make_shared<QuicTransportStatsCollector>();
+  CountingQuicTransportStatsCallbackFactory factory(collector);
+  auto stats = factory.make();
+  stats->onPacketReceived();
+  stats->onPacketReceived();
+  stats->onPacketSent();
+  stats->onRead(1000);
+  stats->onWrite(1200);
+  stats->onPacketDropped(PacketDropReason::PARSE_ERROR);
+  ConnectionPerfSummary summary;
+  summary.srtt = std::chrono::microseconds(5000);
+  stats->onConnectionClose(ConnectionCloseReason::IDLE_TIMEOUT, &summary);
+  stats->onConnectionClose(folly::none, nullptr);
+  HandshakeTimings timings;
+  timings.handshakeDone = std::chrono::microseconds(20000);
+  stats->onHandshakeDone(timings);
+
+  auto snapshot = collector->snapshot();
+  EXPECT_EQ(snapshot.get(QuicStatsCounter::PacketsReceived), 2);
+  EXPECT_EQ(snapshot.get(QuicStatsCounter::PacketsSent), 1);
+  EXPECT_EQ(snapshot.get(QuicStatsCounter::BytesRead), 1000);
+  EXPECT_EQ(snapshot.get(QuicStatsCounter::BytesWritten), 1200);
+  EXPECT_EQ(
+      snapshot.packetsDropped[static_cast<size_t>(
+          PacketDropReason::PARSE_ERROR)],
+      1);
+  EXPECT_EQ(
+      snapshot.connectionCloses[static_cast<size_t>(
+          ConnectionCloseReason::IDLE_TIMEOUT)],
+      1);
+  EXPECT_EQ(
+      snapshot.connectionCloses[static_cast<size_t>(
+          ConnectionCloseReason::NONE)],
+      1);
+  EXPECT_EQ(snapshot.packetSize.count, 2);
+  EXPECT_EQ(snapshot.packetSize.sum, 2200);
+  EXPECT_EQ(snapshot.rtt.count, 1);
+  EXPECT_EQ(snapshot.rtt.sum, 5000);
+  EXPECT_EQ(snapshot.handshakeTime.count, 1);
+}
+
+TEST(CountingQuicTransportStatsCallbackTest, PacedWrites) {
+  auto collector = std::make_shared<QuicTransportStatsCollector>();
+  CountingQuicTransportStatsCallbackFactory factory(collector);
+  auto stats = factory.make();
+  stats->onPacedWrite(
+      4, std::chrono::microseconds(100), std::chrono::microseconds(150));
+  stats->onPacedWrite(
+      2, std::chrono::microseconds(0), std::chrono::microseconds(50));
+  auto snapshot = collector->snapshot();
+  EXPECT_EQ(snapshot.pacingBurstSize.count, 2);
+  EXPECT_EQ(snapshot.pacingBurstSize.sum, 6);
+  EXPECT_EQ(snapshot.pacingTimerLateness.sum, 100);
+  EXPECT_EQ(snapshot.pacingIntervalError.sum, 200);
+  EXPECT_EQ(snapshot.pacingIntervalError.percentile(100), 150);
+}
+
+TEST(CountingQuicTransportStatsCallbackTest, MergeWorkers) {
+  auto collector = std::make_shared<QuicTransportStatsCollector>();
+  CountingQuicTransportStatsCallbackFactory factory(collector);
+  auto stats1 = factory.make();
+  auto stats2 = factory.make();
+  stats1->onNewConnection();
+  stats2->onNewConnection();
+  stats2->onNewConnection();
+  // A worker's counts stay after it goes away.
+  stats2.reset();
+
+  auto perWorker = collector->snapshotPerWorker();
+  ASSERT_EQ(perWorker.size(), 2);
+  EXPECT_EQ(perWorker[0].get(QuicStatsCounter::NewConnections), 1);
+  EXPECT_EQ(perWorker[1].get(QuicStatsCounter::NewConnections), 2);
+  EXPECT_EQ(collector->snapshot().get(QuicStatsCounter::NewConnections), 3);
+
+  QuicTransportStatsSnapshot merged;
+  merged.merge(perWorker[0]);
+  merged.merge(perWorker[1]);
+  EXPECT_EQ(merged.get(QuicStatsCounter::NewConnections), 3);
+}
+
+TEST(CountingQuicTransportStatsCallbackTest, SnapshotWhileCounting) {
+  auto collector = std::make_shared<QuicTransportStatsCollector>();
+  CountingQuicTransportStatsCallbackFactory factory(collector);
+  auto stats = factory.make();
+  constexpr uint64_t kPackets = 100000;
+  std::thread worker([&] {
+    for (uint64_t i = 0; i < kPackets; ++i) {
+      stats->onPacketReceived();
+    }
+  });
+  uint64_t last = 0;
+  for (int i = 0; i < 100; ++i) {
+    auto received =
+        collector->snapshot().get(QuicStatsCounter::PacketsReceived);
+    EXPECT_GE(received, last);
+    last = received;
+  }
+  worker.join();
+  EXPECT_EQ(
+      collector->snapshot().get(QuicStatsCounter::PacketsReceived), kPackets);
+}
+
+} // namespace test
+} // namespace quic
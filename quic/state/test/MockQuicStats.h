@@ -29,7 +29,11 @@ class MockQuicStats : public QuicTransportStatsCallback {
   MOCK_METHOD0(onForwardedPacketProcessed, void());
   MOCK_METHOD0(onClientInitialReceived, void());
   MOCK_METHOD0(onNewConnection, void());
-  MOCK_METHOD1(onConnectionClose, void(folly::Optional<ConnectionCloseReason>));
+  MOCK_METHOD2(
+      onConnectionClose,
+      void(
+          folly::Optional<ConnectionCloseReason>,
+          const ConnectionPerfSummary*));
   MOCK_METHOD0(onNewQuicStream, void());
   MOCK_METHOD0(onQuicStreamClosed, void());
   MOCK_METHOD0(onQuicStreamReset, void());
@@ -39,7 +43,24 @@ class MockQuicStats : public QuicTransportStatsCallback {
   MOCK_METHOD0(onStreamFlowControlUpdate, void());
   MOCK_METHOD0(onStreamFlowControlBlocked, void());
   MOCK_METHOD0(onCwndBlocked, void());
+  MOCK_METHOD1(onStreamHolBlockedDuration, void(std::chrono::microseconds));
+  MOCK_METHOD1(
+      onConnFlowControlBlockedDuration,
+      void(std::chrono::microseconds));
+  MOCK_METHOD1(
+      onStreamFlowControlBlockedDuration,
+      void(std::chrono::microseconds));
+  MOCK_METHOD1(onCwndBlockedDuration, void(std::chrono::microseconds));
+  MOCK_METHOD1(onHandshakeDone, void(const HandshakeTimings&));
+  MOCK_METHOD2(onWriteLoopEnd, void(WriteLoopEndReason, uint64_t));
+  MOCK_METHOD2(onBatchFlushed, void(uint64_t, uint64_t));
+  MOCK_METHOD3(
+      onPacedWrite,
+      void(uint64_t, std::chrono::microseconds, std::chrono::microseconds));
+  MOCK_METHOD1(onMemoryUsage, void(const ConnectionMemoryUsage&));
+  MOCK_METHOD1(onHotLoopMitigation, void(HotLoopMitigation));
   MOCK_METHOD0(onPTO, void());
+  MOCK_METHOD0(onPacketSpuriousLoss, void());
   MOCK_METHOD1(onRead, void(size_t));
   MOCK_METHOD1(onWrite, void(size_t));
   MOCK_METHOD1(onUDPSocketWriteError, void(SocketErrorType));
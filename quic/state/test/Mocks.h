@@ -22,8 +22,11 @@ class MockCongestionController : public CongestionController {
   MOCK_METHOD2(
       onPacketAckOrLoss,
       void(folly::Optional<AckEvent>, folly::Optional<LossEvent>));
+  MOCK_METHOD2(onPacketsCeMarked, void(uint64_t, TimePoint));
+  MOCK_METHOD1(undoLoss, void(TimePoint));
   MOCK_CONST_METHOD0(getWritableBytes, uint64_t());
   MOCK_CONST_METHOD0(getCongestionWindow, uint64_t());
+  MOCK_CONST_METHOD0(getBandwidth, folly::Optional<Bandwidth>());
   MOCK_METHOD0(onSpuriousLoss, void());
   MOCK_CONST_METHOD0(type, CongestionControlType());
   GMOCK_METHOD2_(, , , setAppIdle, void(bool, TimePoint));
@@ -38,9 +41,11 @@ class MockPacer : public Pacer {
   MOCK_CONST_METHOD0(getTimeUntilNextWrite, std::chrono::microseconds());
   MOCK_METHOD1(updateAndGetWriteBatchSize, uint64_t(TimePoint));
   MOCK_CONST_METHOD0(getCachedWriteBatchSize, uint64_t());
+  MOCK_METHOD2(getDepartureTime, TimePoint(TimePoint, uint64_t));
   MOCK_METHOD1(setAppLimited, void(bool));
   MOCK_METHOD0(onPacketSent, void());
   MOCK_METHOD0(onPacketsLoss, void());
+  MOCK_METHOD1(setMaxPacingRate, void(folly::Optional<uint64_t>));
 };
 
 class MockPendingPathRateLimiter : public PendingPathRateLimiter {
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/state/PathMtuDiscovery.h>
+
+#include <gtest/gtest.h>
+
+#include <quic/common/test/TestUtils.h>
+#include <quic/state/StateData.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+class PathMtuDiscoveryTest : public Test {
+ public:
+  void SetUp() override {
+    conn_.udpSendPacketLen = 1200;
+    conn_.transportSettings.maxPathMtuProbeSize = 1500;
+  }
+
+  OutstandingPacket makePacket(uint32_t size, bool probe) {
+    RegularQuicWritePacket packet(ShortHeader(
+        ProtectionType::KeyPhaseZero, getTestConnectionId(), nextPacketNum_++));
+    OutstandingPacket outstandingPacket(
+        std::move(packet), Clock::now(), size, false, size);
+    outstandingPacket.isPathMtuProbe = probe;
+    return outstandingPacket;
+  }
+
+  // Sends the next probe and returns it.
+  OutstandingPacket sendProbe() {
+    auto size = getNextPathMtuProbe(conn_, now_);
+    EXPECT_TRUE(size.has_value());
+    onPathMtuProbeSent(conn_);
+    EXPECT_FALSE(getNextPathMtuProbe(conn_, now_).has_value());
+    return makePacket(size.value_or(0), true);
+  }
+
+ protected:
+  QuicConnectionStateBase conn_{QuicNodeType::Client};
+  TimePoint now_{Clock::now()};
+  PacketNum nextPacketNum_{0};
+};
+
+TEST_F(PathMtuDiscoveryTest, NothingToSearch) {
+  startPathMtuDiscovery(conn_, 1200);
+  EXPECT_EQ(PathMtuState::Phase::Disabled, conn_.pathMtuState.phase);
+  EXPECT_FALSE(getNextPathMtuProbe(conn_, now_).has_value());
+}
+
+TEST_F(PathMtuDiscoveryTest, LargestSizeFirst) {
+  startPathMtuDiscovery(conn_, 9000);
+  auto probe = sendProbe();
+  EXPECT_EQ(1500, probe.encodedSize);
+  onPathMtuPacketAcked(conn_, probe, now_);
+  EXPECT_EQ(1500, conn_.udpSendPacketLen);
+  EXPECT_EQ(PathMtuState::Phase::SearchComplete, conn_.pathMtuState.phase);
+  EXPECT_FALSE(getNextPathMtuProbe(conn_, now_).has_value());
+}
+
+TEST_F(PathMtuDiscoveryTest, BinarySearch) {
+  startPathMtuDiscovery(conn_, 1500);
+  // The path carries 1400 bytes.
+  while (conn_.pathMtuState.phase == PathMtuState::Phase::Searching) {
+    auto probe = sendProbe();
+    if (probe.encodedSize <= 1400) {
+      onPathMtuPacketAcked(conn_, probe, now_);
+    } else {
+      onPathMtuPacketLost(conn_, probe, now_);
+    }
+  }
+  EXPECT_LE(conn_.udpSendPacketLen, 1400);
+  EXPECT_GT(conn_.udpSendPacketLen + kPathMtuSearchGranularity, 1400);
+
+  // Searches again after a while, from the size it found.
+  now_ += kPathMtuRaiseTimeout;
+  auto size = getNextPathMtuProbe(conn_, now_);
+  ASSERT_TRUE(size.has_value());
+  EXPECT_EQ(1500, *size);
+}
+
+TEST_F(PathMtuDiscoveryTest, ProbesSizeAgainBeforeGivingUp) {
+  startPathMtuDiscovery(conn_, 1500);
+  for (uint8_t i = 0; i + 1 < kMaxPathMtuProbes; ++i) {
+    auto probe = sendProbe();
+    EXPECT_EQ(1500, probe.encodedSize);
+    onPathMtuPacketLost(conn_, probe, now_);
+  }
+  auto probe = sendProbe();
+  EXPECT_EQ(1500, probe.encodedSize);
+  onPathMtuPacketLost(conn_, probe, now_);
+  EXPECT_EQ(1499, conn_.pathMtuState.high);
+  EXPECT_GT(1500, sendProbe().encodedSize);
+  EXPECT_EQ(1200, conn_.udpSendPacketLen);
+}
+
+TEST_F(PathMtuDiscoveryTest, Hint) {
+  conn_.transportSettings.pathMtuProbeHint = 1350;
+  startPathMtuDiscovery(conn_, 1500);
+  auto probe = sendProbe();
+  EXPECT_EQ(1350, probe.encodedSize);
+  onPathMtuPacketAcked(conn_, probe, now_);
+  EXPECT_EQ(1350, conn_.udpSendPacketLen);
+  EXPECT_EQ(1500, sendProbe().encodedSize);
+}
+
+TEST_F(PathMtuDiscoveryTest, BlackHole) {
+  startPathMtuDiscovery(conn_, 1500);
+  auto probe = sendProbe();
+  onPathMtuPacketAcked(conn_, probe, now_);
+  ASSERT_EQ(1500, conn_.udpSendPacketLen);
+
+  // Small packets don't count, and an acked large one resets the count.
+  for (uint64_t i = 0; i + 1 < kPathMtuBlackHoleThreshold; ++i) {
+    onPathMtuPacketLost(conn_, makePacket(1500, false), now_);
+    onPathMtuPacketLost(conn_, makePacket(1000, false), now_);
+  }
+  onPathMtuPacketAcked(conn_, makePacket(1500, false), now_);
+  for (uint64_t i = 0; i + 1 < kPathMtuBlackHoleThreshold; ++i) {
+    onPathMtuPacketLost(conn_, makePacket(1500, false), now_);
+  }
+  EXPECT_EQ(1500, conn_.udpSendPacketLen);
+
+  onPathMtuPacketLost(conn_, makePacket(1500, false), now_);
+  EXPECT_EQ(1200, conn_.udpSendPacketLen);
+  EXPECT_FALSE(getNextPathMtuProbe(conn_, now_).has_value());
+  EXPECT_TRUE(
+      getNextPathMtuProbe(conn_, now_ + kPathMtuRaiseTimeout).has_value());
+}
+
+} // namespace test
+} // namespace quic
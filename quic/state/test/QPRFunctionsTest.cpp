@@ -137,6 +137,40 @@ TEST_F(QPRFunctionsTest, AdvanceMinimumRetransmittableOffset) {
   }
 }
 
+TEST_F(QPRFunctionsTest, ExpireStreamDataPastDeadline) {
+  auto stream = conn.streamManager->createNextBidirectionalStream().value();
+  auto now = Clock::now();
+  auto buf = folly::IOBuf::copyBuffer("aaaaaaaaaa");
+  stream->currentWriteOffset = 30;
+  stream->writeDeadlines.emplace_back(10, now - std::chrono::milliseconds(1));
+  stream->writeDeadlines.emplace_back(20, now + std::chrono::milliseconds(1));
+  stream->writeDeadlines.emplace_back(30, now + std::chrono::milliseconds(2));
+
+  // case1. nothing below 10 is unacked
+  stream->retransmissionBuffer.emplace(
+      20, std::make_unique<StreamBuffer>(buf->clone(), 20));
+  EXPECT_FALSE(expireStreamDataPastDeadline(stream, now).has_value());
+  EXPECT_EQ(stream->writeDeadlines.size(), 2);
+  EXPECT_TRUE(conn.pendingEvents.frames.empty());
+
+  // case2. the data from 10 to 20 is lost, and expires with the data before
+  // the earlier deadline
+  stream->lossBuffer.emplace_back(buf->clone(), 10);
+  stream->writeDeadlines.back().second = now;
+  auto result = expireStreamDataPastDeadline(stream, now);
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(*result, 30);
+  EXPECT_TRUE(stream->writeDeadlines.empty());
+  EXPECT_TRUE(stream->lossBuffer.empty());
+  EXPECT_TRUE(stream->retransmissionBuffer.empty());
+  EXPECT_EQ(stream->minimumRetransmittableOffset, 30);
+  ASSERT_EQ(conn.pendingEvents.frames.size(), 1);
+  auto expiredFrame =
+      conn.pendingEvents.frames.front().asExpiredStreamDataFrame();
+  ASSERT_NE(expiredFrame, nullptr);
+  EXPECT_EQ(expiredFrame->minimumStreamOffset, 30);
+}
+
 TEST_F(QPRFunctionsTest, RecvMinStreamDataFrame) {
   auto stream = conn.streamManager->createNextBidirectionalStream().value();
 
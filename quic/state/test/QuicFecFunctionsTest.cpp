@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <quic/common/test/TestUtils.h>
+#include <quic/server/state/ServerStateMachine.h>
+#include <quic/state/QuicFecFunctions.h>
+
+using namespace folly;
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+class QuicFecFunctionsTest : public Test {
+ public:
+  void SetUp() override {
+    initialize(sender);
+    initialize(receiver);
+    sender.fecState.peerSupported = true;
+    receiver.transportSettings.advertiseFecSupport = true;
+  }
+
+  void initialize(QuicServerConnectionState& conn) {
+    conn.flowControlState.peerAdvertisedInitialMaxStreamOffsetBidiLocal =
+        kDefaultStreamWindowSize;
+    conn.flowControlState.peerAdvertisedInitialMaxStreamOffsetBidiRemote =
+        kDefaultStreamWindowSize;
+    conn.flowControlState.peerAdvertisedInitialMaxStreamOffsetUni =
+        kDefaultStreamWindowSize;
+    conn.flowControlState.peerAdvertisedMaxOffset =
+        kDefaultConnectionWindowSize;
+    conn.streamManager->setMaxLocalBidirectionalStreams(
+        kDefaultMaxStreamsBidirectional);
+  }
+
+  void sendPacket(
+      QuicStreamState& stream,
+      PacketNum packetNum,
+      uint64_t offset,
+      const std::string& data) {
+    stream.retransmissionBuffer.emplace(
+        offset,
+        std::make_unique<StreamBuffer>(
+            folly::IOBuf::copyBuffer(data), offset, false));
+    RegularQuicWritePacket packet(ShortHeader(
+        ProtectionType::KeyPhaseZero, getTestConnectionId(), packetNum));
+    packet.frames.push_back(
+        WriteStreamFrame(stream.id, offset, data.size(), false));
+    onFecSourcePacketSent(sender, packet);
+  }
+
+  void receivePacket(
+      QuicStreamState& stream,
+      PacketNum packetNum,
+      uint64_t offset,
+      const std::string& data) {
+    RegularQuicPacket packet(ShortHeader(
+        ProtectionType::KeyPhaseZero, getTestConnectionId(), packetNum));
+    packet.frames.push_back(ReadStreamFrame(
+        stream.id, offset, folly::IOBuf::copyBuffer(data), false));
+    onFecSourcePacketReceived(receiver, packetNum, packet);
+  }
+
+  QuicServerConnectionState sender;
+  QuicServerConnectionState receiver;
+};
+
+TEST_F(QuicFecFunctionsTest, SourceSymbol) {
+  auto data = folly::IOBuf::copyBuffer("hello world");
+  std::vector<FecSourceFrame> frames;
+  frames.push_back(FecSourceFrame{4, 100, data.get(), 5, false});
+  frames.push_back(FecSourceFrame{8, 0, data.get(), 11, true});
+  auto symbol = encodeFecSourceSymbol(frames);
+  ASSERT_NE(nullptr, symbol);
+  // The padding from XORing in longer symbols doesn't matter.
+  symbol->prependChain(folly::IOBuf::copyBuffer(std::string(10, '\0')));
+
+  auto decoded = decodeFecSourceSymbol(*symbol);
+  ASSERT_TRUE(decoded.has_value());
+  ASSERT_EQ(2, decoded->size());
+  EXPECT_EQ(4, (*decoded)[0].streamId);
+  EXPECT_EQ(100, (*decoded)[0].offset);
+  EXPECT_EQ("hello", (*decoded)[0].data->moveToFbString().toStdString());
+  EXPECT_FALSE((*decoded)[0].fin);
+  EXPECT_EQ(8, (*decoded)[1].streamId);
+  EXPECT_EQ(0, (*decoded)[1].offset);
+  EXPECT_EQ("hello world", (*decoded)[1].data->moveToFbString().toStdString());
+  EXPECT_TRUE((*decoded)[1].fin);
+
+  // Longer than what follows.
+  auto truncated = folly::IOBuf::copyBuffer(std::string("\0\5\4", 3));
+  EXPECT_FALSE(decodeFecSourceSymbol(*truncated).has_value());
+}
+
+TEST_F(QuicFecFunctionsTest, RecoverLostPacket) {
+  sender.transportSettings.fecWindowSize = 2;
+  auto sendStream =
+      sender.streamManager->createNextBidirectionalStream().value();
+  auto recvStream =
+      receiver.streamManager->createNextBidirectionalStream().value();
+
+  sendPacket(*sendStream, 1, 0, "hello");
+  EXPECT_TRUE(sender.pendingEvents.frames.empty());
+  sendPacket(*sendStream, 3, 5, "world!");
+  ASSERT_EQ(1, sender.pendingEvents.frames.size());
+  auto repair = sender.pendingEvents.frames.front().asRepairFrame();
+  ASSERT_NE(nullptr, repair);
+  EXPECT_EQ(1, repair->firstPacketNum);
+  EXPECT_EQ(0b101, repair->packetMask);
+  EXPECT_EQ(0, sender.fecState.sourcePacketMask);
+
+  // Both are missing.
+  onFecRepairFrameReceived(receiver, *repair);
+  EXPECT_EQ(0, receiver.fecState.numRecoveredPackets);
+
+  // Packet 1 is lost.
+  receivePacket(*recvStream, 3, 5, "world!");
+  onFecRepairFrameReceived(receiver, *repair);
+  EXPECT_EQ(1, receiver.fecState.numRecoveredPackets);
+  ASSERT_EQ(1, recvStream->readBuffer.size());
+  EXPECT_EQ(0, recvStream->readBuffer.front().offset);
+  auto recovered = recvStream->readBuffer.front().data.move();
+  EXPECT_EQ("hello", recovered->moveToFbString().toStdString());
+
+  // Nothing is missing any more.
+  onFecRepairFrameReceived(receiver, *repair);
+  EXPECT_EQ(1, receiver.fecState.numRecoveredPackets);
+}
+
+TEST_F(QuicFecFunctionsTest, FlushPartialWindow) {
+  sender.transportSettings.fecWindowSize = 4;
+  auto stream = sender.streamManager->createNextBidirectionalStream().value();
+  sendPacket(*stream, 0, 0, "hello");
+  EXPECT_TRUE(sender.pendingEvents.frames.empty());
+  flushFecRepair(sender);
+  ASSERT_EQ(1, sender.pendingEvents.frames.size());
+  auto repair = sender.pendingEvents.frames.front().asRepairFrame();
+  ASSERT_NE(nullptr, repair);
+  EXPECT_EQ(0, repair->firstPacketNum);
+  EXPECT_EQ(1, repair->packetMask);
+  flushFecRepair(sender);
+  EXPECT_EQ(1, sender.pendingEvents.frames.size());
+
+  // Too far from the first packet to be covered by the same repair.
+  sendPacket(*stream, 10, 5, "a");
+  sendPacket(*stream, 10 + kMaxFecWindowSize, 6, "b");
+  ASSERT_EQ(2, sender.pendingEvents.frames.size());
+  repair = sender.pendingEvents.frames.back().asRepairFrame();
+  ASSERT_NE(nullptr, repair);
+  EXPECT_EQ(10, repair->firstPacketNum);
+  EXPECT_EQ(1, repair->packetMask);
+}
+
+} // namespace test
+} // namespace quic
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <quic/state/QuicPriorityQueue.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+TEST(QuicPriorityQueueTest, InsertErase) {
+  PriorityQueue queue;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_TRUE(queue.insert(0, kDefaultPriority));
+  EXPECT_FALSE(queue.insert(0, kDefaultPriority));
+  EXPECT_TRUE(queue.insert(4, Priority(0, false)));
+  EXPECT_TRUE(queue.insert(8, Priority(7, true)));
+  EXPECT_EQ(3, queue.size());
+  EXPECT_TRUE(queue.contains(4, Priority(0, false)));
+  EXPECT_FALSE(queue.contains(4, Priority(0, true)));
+  EXPECT_EQ(1, queue.level(Priority(7, true)).size());
+
+  // Erasing from the wrong level is a no-op.
+  EXPECT_FALSE(queue.erase(8, kDefaultPriority));
+  EXPECT_EQ(3, queue.size());
+  EXPECT_TRUE(queue.erase(8, Priority(7, true)));
+  EXPECT_EQ(2, queue.size());
+
+  queue.clear();
+  EXPECT_TRUE(queue.empty());
+  EXPECT_TRUE(queue.level(kDefaultPriority).empty());
+}
+
+TEST(QuicPriorityQueueTest, ForEachLevelOrder) {
+  PriorityQueue queue;
+  queue.insert(0, Priority(5, true));
+  queue.insert(4, Priority(1, true));
+  queue.insert(8, Priority(1, false));
+  queue.insert(12, Priority(0, true));
+
+  std::vector<std::pair<StreamId, bool>> visited;
+  queue.forEachLevel([&](RoundRobinStreamSet& level, bool incremental) {
+    visited.emplace_back(level.getNextScheduled(), incremental);
+    return true;
+  });
+  std::vector<std::pair<StreamId, bool>> expected = {
+      {12, true}, {8, false}, {4, true}, {0, true}};
+  EXPECT_EQ(expected, visited);
+
+  size_t calls = 0;
+  queue.forEachLevel([&](RoundRobinStreamSet&, bool) {
+    ++calls;
+    return false;
+  });
+  EXPECT_EQ(1, calls);
+}
+
+} // namespace test
+} // namespace quic
@@ -80,6 +80,86 @@ TEST_P(UpdateLargestReceivedPacketNumTest, ReceiveOld) {
       currentLargestReceived);
 }
 
+TEST_P(UpdateLargestReceivedPacketNumTest, CountEcnCodepoints) {
+  QuicServerConnectionState conn;
+  auto& ackState = getAckState(conn, GetParam());
+  updateLargestReceivedPacketNum(ackState, 1, Clock::now());
+  updateLargestReceivedPacketNum(
+      ackState, 2, Clock::now(), EcnCodepoint::Ect0);
+  updateLargestReceivedPacketNum(
+      ackState, 3, Clock::now(), EcnCodepoint::Ect0);
+  updateLargestReceivedPacketNum(
+      ackState, 4, Clock::now(), EcnCodepoint::Ect1);
+  updateLargestReceivedPacketNum(ackState, 5, Clock::now(), EcnCodepoint::Ce);
+  EXPECT_EQ(2, ackState.ecnCounts.ect0);
+  EXPECT_EQ(1, ackState.ecnCounts.ect1);
+  EXPECT_EQ(1, ackState.ecnCounts.ce);
+}
+
+TEST_P(UpdateLargestReceivedPacketNumTest, DuplicatePackets) {
+  QuicServerConnectionState conn;
+  auto& ackState = getAckState(conn, GetParam());
+  EXPECT_FALSE(isDuplicatePacket(ackState, 0));
+  updateLargestReceivedPacketNum(ackState, 0, Clock::now());
+  updateLargestReceivedPacketNum(ackState, 5, Clock::now());
+  EXPECT_TRUE(isDuplicatePacket(ackState, 0));
+  EXPECT_TRUE(isDuplicatePacket(ackState, 5));
+  EXPECT_FALSE(isDuplicatePacket(ackState, 3));
+  EXPECT_FALSE(isDuplicatePacket(ackState, 6));
+  updateLargestReceivedPacketNum(ackState, 3, Clock::now());
+  EXPECT_TRUE(isDuplicatePacket(ackState, 3));
+
+  // Sliding by a whole window forgets the old bits, acks still has them.
+  PacketNum next = 5 + kReceivedPacketWindowSize;
+  updateLargestReceivedPacketNum(ackState, next, Clock::now());
+  EXPECT_FALSE(ackState.receivedPackets.inWindow(5));
+  EXPECT_TRUE(ackState.receivedPackets.inWindow(6));
+  EXPECT_FALSE(ackState.receivedPackets.contains(6));
+  EXPECT_TRUE(isDuplicatePacket(ackState, 5));
+  EXPECT_TRUE(isDuplicatePacket(ackState, next));
+  EXPECT_FALSE(isDuplicatePacket(ackState, next - 1));
+  ackState.acks.withdraw({0, 5});
+  EXPECT_FALSE(isDuplicatePacket(ackState, 5));
+}
+
+TEST(ReceivedPacketWindowTest, SlideAndLookup) {
+  ReceivedPacketWindow window;
+  EXPECT_FALSE(window.inWindow(0));
+  window.insert(1);
+  window.insert(2);
+  window.insert(3);
+  window.insert(kReceivedPacketWindowSize);
+  EXPECT_TRUE(window.contains(1));
+  EXPECT_TRUE(window.contains(kReceivedPacketWindowSize));
+  EXPECT_FALSE(window.contains(kReceivedPacketWindowSize - 1));
+  EXPECT_FALSE(window.inWindow(0));
+  // The bits of 1 and 2 are reused for the packets skipped on the way.
+  window.insert(kReceivedPacketWindowSize + 3);
+  EXPECT_FALSE(window.contains(kReceivedPacketWindowSize + 1));
+  EXPECT_FALSE(window.contains(kReceivedPacketWindowSize + 2));
+  EXPECT_TRUE(window.contains(kReceivedPacketWindowSize + 3));
+  EXPECT_FALSE(window.inWindow(3));
+  // Too old to remember.
+  window.insert(3);
+  EXPECT_FALSE(window.contains(3));
+  EXPECT_FALSE(window.contains(kReceivedPacketWindowSize + 4));
+}
+
+TEST_P(UpdateLargestReceivedPacketNumTest, LimitAckRanges) {
+  QuicServerConnectionState conn;
+  auto& ackState = getAckState(conn, GetParam());
+  // Every other packet, so each one is a range of its own.
+  for (PacketNum packetNum = 0; packetNum < 10; packetNum += 2) {
+    updateLargestReceivedPacketNum(ackState, packetNum, Clock::now());
+  }
+  limitAckRanges(ackState, 5);
+  EXPECT_EQ(5, ackState.acks.size());
+  limitAckRanges(ackState, 3);
+  ASSERT_EQ(3, ackState.acks.size());
+  EXPECT_EQ(4, ackState.acks.front().start);
+  EXPECT_EQ(8, ackState.acks.back().end);
+}
+
 INSTANTIATE_TEST_CASE_P(
     UpdateLargestReceivedPacketNumTests,
     UpdateLargestReceivedPacketNumTest,
@@ -356,6 +436,27 @@ TEST_P(UpdateAckStateTest, UpdateAckSendStateOnRecvPacketsNonRxOutOfOrder) {
   EXPECT_FALSE(verifyToScheduleAckTimeout(conn));
 }
 
+TEST_F(UpdateAckStateTest, UpdateAckSendStateOnRecvPacketsAckFrequency) {
+  // The peer's ACK_FREQUENCY replaces the default thresholds for AppData.
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  conn.ackFrequencyState.received = AckFrequencyFrame(0, 5, 25ms, true);
+  auto& ackState = conn.ackStates.appDataAckState;
+  for (size_t i = 0; i < 4; i++) {
+    // Out of order packets don't trigger an ack either, since ignoreOrder is
+    // set.
+    updateAckSendStateOnRecvPacket(conn, ackState, i % 2, true, false);
+    EXPECT_FALSE(verifyToAckImmediately(conn, ackState));
+    EXPECT_TRUE(verifyToScheduleAckTimeout(conn));
+  }
+  updateAckSendStateOnRecvPacket(conn, ackState, false, true, false);
+  EXPECT_TRUE(verifyToAckImmediately(conn, ackState));
+
+  // The handshake space keeps acking out of order packets right away.
+  auto& handshakeAckState = conn.ackStates.handshakeAckState;
+  updateAckSendStateOnRecvPacket(conn, handshakeAckState, true, true, false);
+  EXPECT_TRUE(verifyToAckImmediately(conn, handshakeAckState));
+}
+
 INSTANTIATE_TEST_CASE_P(
     UpdateAckStateTests,
     UpdateAckStateTest,
@@ -531,6 +632,23 @@ TEST_F(QuicStateFunctionsTest, IsConnectionPaced) {
   EXPECT_FALSE(isConnectionPaced(state));
 }
 
+TEST_F(QuicStateFunctionsTest, SentPayloads) {
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  conn.transportSettings.sentPayloadCacheSize = 2;
+  addSentPayload(conn, 1, folly::IOBuf::copyBuffer("one"));
+  addSentPayload(conn, 3, folly::IOBuf::copyBuffer("three"));
+  EXPECT_EQ("one", findSentPayload(conn, 1)->clone()->moveToFbString());
+  EXPECT_EQ(nullptr, findSentPayload(conn, 2));
+  EXPECT_EQ("three", findSentPayload(conn, 3)->clone()->moveToFbString());
+
+  // The oldest one goes first.
+  addSentPayload(conn, 4, folly::IOBuf::copyBuffer("four"));
+  EXPECT_EQ(2, conn.sentPayloads.size());
+  EXPECT_EQ(nullptr, findSentPayload(conn, 1));
+  EXPECT_NE(nullptr, findSentPayload(conn, 3));
+  EXPECT_NE(nullptr, findSentPayload(conn, 4));
+}
+
 TEST_F(QuicStateFunctionsTest, GetOutstandingPackets) {
   QuicConnectionStateBase conn(QuicNodeType::Client);
   conn.outstandingPackets.emplace_back(
@@ -651,6 +769,180 @@ TEST_P(QuicStateFunctionsTest, CloseTranportStateChange) {
   EXPECT_TRUE(conn.pendingEvents.closeTransport);
 }
 
+class FakeKeyUpdateHandshake : public Handshake {
+ public:
+  const folly::Optional<std::string>& getApplicationProtocol() const override {
+    return alpn_;
+  }
+
+  std::unique_ptr<Aead> getNextOneRttReadCipher() override {
+    ++nextReadCiphers;
+    return createNoOpAead();
+  }
+
+  std::unique_ptr<Aead> getNextOneRttWriteCipher() override {
+    ++nextWriteCiphers;
+    return createNoOpAead();
+  }
+
+  int nextReadCiphers{0};
+  int nextWriteCiphers{0};
+
+ private:
+  folly::Optional<std::string> alpn_;
+};
+
+TEST_F(QuicStateFunctionsTest, UpdateOneRttKeys) {
+  QuicConnectionStateBase conn(QuicNodeType::Server);
+  auto handshake = std::make_unique<FakeKeyUpdateHandshake>();
+  auto rawHandshake = handshake.get();
+  conn.handshakeLayer = std::move(handshake);
+  conn.readCodec = std::make_unique<QuicReadCodec>(QuicNodeType::Server);
+  // Nothing to do before there are 1-RTT keys.
+  updateOneRttKeys(conn);
+  EXPECT_EQ(0, rawHandshake->nextWriteCiphers);
+
+  conn.oneRttWriteCipher = createNoOpAead();
+  conn.readCodec->setOneRttReadCipher(createNoOpAead());
+  updateOneRttKeys(conn);
+  EXPECT_EQ(1, rawHandshake->nextWriteCiphers);
+  EXPECT_EQ(1, rawHandshake->nextReadCiphers);
+  EXPECT_NE(nullptr, conn.readCodec->getNextOneRttReadCipher());
+  EXPECT_EQ(ProtectionType::KeyPhaseZero, getOneRttWriteKeyPhase(conn));
+  updateOneRttKeys(conn);
+  EXPECT_EQ(1, rawHandshake->nextWriteCiphers);
+  EXPECT_EQ(1, rawHandshake->nextReadCiphers);
+
+  // Not until the handshake is done and the peer acks a packet written with
+  // the current keys.
+  auto& keyUpdateState = conn.oneRttKeyUpdateState;
+  conn.transportSettings.oneRttKeyUpdatePacketInterval = 2;
+  keyUpdateState.firstPacketInWritePhase = 5;
+  keyUpdateState.packetsInWritePhase = 2;
+  conn.ackStates.appDataAckState.largestAckedByPeer = 5;
+  updateOneRttKeys(conn);
+  EXPECT_EQ(ProtectionType::KeyPhaseZero, getOneRttWriteKeyPhase(conn));
+  conn.readCodec->onHandshakeDone(Clock::now());
+  conn.ackStates.appDataAckState.largestAckedByPeer = 4;
+  updateOneRttKeys(conn);
+  EXPECT_EQ(ProtectionType::KeyPhaseZero, getOneRttWriteKeyPhase(conn));
+
+  conn.ackStates.appDataAckState.largestAckedByPeer = 5;
+  auto nextWriteCipher = keyUpdateState.nextWriteCipher.get();
+  updateOneRttKeys(conn);
+  EXPECT_EQ(ProtectionType::KeyPhaseOne, getOneRttWriteKeyPhase(conn));
+  EXPECT_EQ(nextWriteCipher, conn.oneRttWriteCipher.get());
+  EXPECT_FALSE(keyUpdateState.firstPacketInWritePhase.has_value());
+  EXPECT_EQ(0, keyUpdateState.packetsInWritePhase);
+  // The one after is ready already.
+  EXPECT_EQ(2, rawHandshake->nextWriteCiphers);
+  EXPECT_NE(nullptr, keyUpdateState.nextWriteCipher);
+
+  // Nor another one before the peer follows.
+  keyUpdateState.firstPacketInWritePhase = 10;
+  keyUpdateState.packetsInWritePhase = 2;
+  conn.ackStates.appDataAckState.largestAckedByPeer = 10;
+  updateOneRttKeys(conn);
+  EXPECT_EQ(ProtectionType::KeyPhaseOne, getOneRttWriteKeyPhase(conn));
+}
+
+TEST_F(QuicStateFunctionsTest, CopyLiveTransportSettings) {
+  TransportSettings settings;
+  TransportSettings updated;
+  updated.pacingEnabled = !settings.pacingEnabled;
+  updated.defaultCongestionController = CongestionControlType::BBR;
+  updated.cubicConfig.hystartPlusPlus = true;
+  updated.writeConnectionDataPacketsLimit = 1;
+  updated.rxPacketsBeforeAckBeforeInit = 1;
+  updated.maxBatchSize = 1;
+  updated.idleTimeout = settings.idleTimeout + std::chrono::seconds(1);
+  updated.advertiseMinAckDelay = !settings.advertiseMinAckDelay;
+  copyLiveTransportSettings(settings, updated);
+  EXPECT_EQ(updated.pacingEnabled, settings.pacingEnabled);
+  EXPECT_EQ(CongestionControlType::BBR, settings.defaultCongestionController);
+  EXPECT_TRUE(settings.cubicConfig.hystartPlusPlus);
+  EXPECT_EQ(1, settings.writeConnectionDataPacketsLimit);
+  EXPECT_EQ(1, settings.rxPacketsBeforeAckBeforeInit);
+  EXPECT_EQ(1, settings.maxBatchSize);
+  // Fixed for the life of a connection.
+  EXPECT_NE(updated.idleTimeout, settings.idleTimeout);
+  EXPECT_NE(updated.advertiseMinAckDelay, settings.advertiseMinAckDelay);
+}
+
+TEST_F(QuicStateFunctionsTest, DiscardPacketNumberSpace) {
+  QuicConnectionStateBase conn(QuicNodeType::Client);
+  conn.cryptoState = std::make_unique<QuicCryptoState>();
+  conn.readCodec = std::make_unique<QuicReadCodec>(QuicNodeType::Client);
+  auto mockCongestionController = std::make_unique<MockCongestionController>();
+  auto rawCongestionController = mockCongestionController.get();
+  conn.congestionController = std::move(mockCongestionController);
+  conn.initialWriteCipher = createNoOpAead();
+  conn.initialHeaderCipher = createNoOpHeaderCipher();
+  conn.readCodec->setInitialReadCipher(createNoOpAead());
+  conn.readCodec->setInitialHeaderCipher(createNoOpHeaderCipher());
+  conn.handshakeWriteCipher = createNoOpAead();
+  conn.handshakeWriteHeaderCipher = createNoOpHeaderCipher();
+  conn.readCodec->setHandshakeReadCipher(createNoOpAead());
+  conn.readCodec->setHandshakeHeaderCipher(createNoOpHeaderCipher());
+
+  conn.outstandingPackets.emplace_back(
+      makeTestLongPacket(LongHeader::Types::Initial),
+      Clock::now(),
+      135,
+      true,
+      0);
+  conn.outstandingPackets.emplace_back(
+      makeTestLongPacket(LongHeader::Types::Handshake),
+      Clock::now(),
+      1217,
+      true,
+      0);
+  conn.outstandingPackets.emplace_back(
+      makeTestShortPacket(), Clock::now(), 5556, false, 0);
+  conn.outstandingPackets.emplace_back(
+      makeTestLongPacket(LongHeader::Types::Initial),
+      Clock::now(),
+      56,
+      true,
+      0);
+  conn.outstandingHandshakePacketsCount = 3;
+  conn.ackStates.initialAckState.acks.insert(0, 3);
+  conn.ackStates.initialAckState.needsToSendAckImmediately = true;
+  conn.lossState.lossTimes[PacketNumberSpace::Initial] = Clock::now();
+  conn.cryptoState->initialStream.writeBuffer.append(
+      folly::IOBuf::copyBuffer("hello"));
+
+  // They're no longer in flight, but they weren't lost either.
+  EXPECT_CALL(*rawCongestionController, onRemoveBytesFromInflight(135 + 56));
+  EXPECT_CALL(*rawCongestionController, onPacketAckOrLoss(_, _)).Times(0);
+  discardPacketNumberSpace(conn, PacketNumberSpace::Initial);
+  EXPECT_EQ(nullptr, conn.initialWriteCipher);
+  EXPECT_EQ(nullptr, conn.initialHeaderCipher);
+  EXPECT_EQ(nullptr, conn.readCodec->getInitialCipher());
+  EXPECT_NE(nullptr, conn.handshakeWriteCipher);
+  EXPECT_EQ(2, conn.outstandingPackets.size());
+  EXPECT_EQ(1, conn.outstandingHandshakePacketsCount);
+  EXPECT_TRUE(conn.ackStates.initialAckState.acks.empty());
+  EXPECT_FALSE(conn.ackStates.initialAckState.needsToSendAckImmediately);
+  EXPECT_FALSE(conn.lossState.lossTimes[PacketNumberSpace::Initial]);
+  EXPECT_TRUE(conn.cryptoState->initialStream.writeBuffer.empty());
+  Mock::VerifyAndClearExpectations(rawCongestionController);
+
+  // Only once.
+  EXPECT_CALL(*rawCongestionController, onRemoveBytesFromInflight(_))
+      .Times(0);
+  discardPacketNumberSpace(conn, PacketNumberSpace::Initial);
+  Mock::VerifyAndClearExpectations(rawCongestionController);
+
+  EXPECT_CALL(*rawCongestionController, onRemoveBytesFromInflight(1217));
+  discardPacketNumberSpace(conn, PacketNumberSpace::Handshake);
+  EXPECT_EQ(nullptr, conn.handshakeWriteCipher);
+  EXPECT_EQ(nullptr, conn.readCodec->getHandshakeReadCipher());
+  ASSERT_EQ(1, conn.outstandingPackets.size());
+  EXPECT_EQ(5556, conn.outstandingPackets.front().encodedSize);
+  EXPECT_EQ(0, conn.outstandingHandshakePacketsCount);
+}
+
 INSTANTIATE_TEST_CASE_P(
     QuicStateFunctionsTests,
     QuicStateFunctionsTest,
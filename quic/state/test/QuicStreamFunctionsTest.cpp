@@ -9,6 +9,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <quic/api/QuicSocket.h>
 #include <quic/state/QuicStreamFunctions.h>
 #include <quic/state/QuicStreamUtilities.h>
 
@@ -16,6 +17,7 @@
 #include <quic/common/test/TestUtils.h>
 #include <quic/fizz/client/handshake/FizzClientQuicHandshakeContext.h>
 #include <quic/server/state/ServerStateMachine.h>
+#include <quic/state/test/MockQuicStats.h>
 
 using namespace folly;
 using namespace testing;
@@ -149,6 +151,108 @@ TEST_F(QuicStreamFunctionsTest, TestReadDataWrittenInOrder) {
   EXPECT_TRUE(readData4.second);
 }
 
+TEST_F(QuicStreamFunctionsTest, TestReadSlicesWrittenInOrder) {
+  auto stream = conn.streamManager->createNextBidirectionalStream().value();
+  auto buf1 = IOBuf::copyBuffer("I just met you ");
+  buf1->prependChain(IOBuf::copyBuffer("and this is crazy. "));
+
+  auto buf2 = IOBuf::copyBuffer("Here's my number ");
+  buf2->prependChain(IOBuf::copyBuffer("so call me maybe"));
+
+  appendDataToReadBuffer(*stream, StreamBuffer(buf1->clone(), 0));
+  appendDataToReadBuffer(
+      *stream,
+      StreamBuffer(buf2->clone(), buf1->computeChainDataLength(), true));
+
+  auto toStrings = [](const std::vector<Buf>& slices) {
+    std::vector<std::string> strings;
+    for (const auto& slice : slices) {
+      EXPECT_FALSE(slice->isChained());
+      strings.push_back(slice->clone()->moveToFbString().toStdString());
+    }
+    return strings;
+  };
+
+  auto readData1 = readSlicesFromQuicStream(*stream, 10);
+  EXPECT_EQ(
+      std::vector<std::string>({"I just met"}), toStrings(readData1.first));
+  EXPECT_FALSE(readData1.second);
+
+  auto readData2 = readSlicesFromQuicStream(*stream, 30);
+  EXPECT_EQ(
+      std::vector<std::string>({" you ", "and this is crazy. ", "Here's"}),
+      toStrings(readData2.first));
+  EXPECT_FALSE(readData2.second);
+
+  auto readData3 = readSlicesFromQuicStream(*stream);
+  EXPECT_EQ(
+      std::vector<std::string>({" my number ", "so call me maybe"}),
+      toStrings(readData3.first));
+  EXPECT_TRUE(readData3.second);
+  EXPECT_EQ(stream->currentReadOffset, 68);
+}
+
+TEST_F(QuicStreamFunctionsTest, TestAppReadBuffer) {
+  auto stream = conn.streamManager->createNextBidirectionalStream().value();
+  appendDataToReadBuffer(
+      *stream, StreamBuffer(IOBuf::copyBuffer("I just met you "), 0));
+
+  std::array<uint8_t, 20> buffer;
+  stream->appReadBuffer =
+      QuicStreamState::AppReadBuffer{folly::MutableByteRange(buffer)};
+  fillAppReadBuffer(*stream);
+  EXPECT_EQ(stream->appReadBuffer->filled, 15);
+  EXPECT_TRUE(stream->readBuffer.empty());
+  EXPECT_TRUE(stream->hasReadableData());
+
+  // Only what fits is copied, the rest is kept in the read buffer.
+  appendDataToReadBuffer(
+      *stream, StreamBuffer(IOBuf::copyBuffer("and this is crazy"), 15, true));
+  EXPECT_EQ(stream->appReadBuffer->filled, 20);
+  EXPECT_EQ(stream->currentReadOffset, 20);
+  EXPECT_EQ(stream->readBuffer.front().data.chainLength(), 12);
+  EXPECT_EQ(
+      std::string(buffer.begin(), buffer.end()), "I just met you and t");
+  auto result = takeAppReadBuffer(*stream);
+  EXPECT_EQ(result.first, 20);
+  EXPECT_FALSE(result.second);
+  EXPECT_FALSE(stream->appReadBuffer.hasValue());
+
+  stream->appReadBuffer =
+      QuicStreamState::AppReadBuffer{folly::MutableByteRange(buffer)};
+  fillAppReadBuffer(*stream);
+  result = takeAppReadBuffer(*stream);
+  EXPECT_EQ(result.first, 12);
+  EXPECT_TRUE(result.second);
+  EXPECT_EQ(
+      std::string(buffer.begin(), buffer.begin() + 12), "his is crazy");
+  EXPECT_EQ(stream->currentReadOffset, 33);
+}
+
+TEST_F(QuicStreamFunctionsTest, TestPeekDataToIovecs) {
+  auto stream = conn.streamManager->createNextBidirectionalStream().value();
+  auto buf1 = IOBuf::copyBuffer("I just met you ");
+  buf1->prependChain(IOBuf::copyBuffer("and this is crazy. "));
+  appendDataToReadBuffer(*stream, StreamBuffer(buf1->clone(), 0));
+  // Not contiguous with the first buffer.
+  appendDataToReadBuffer(
+      *stream, StreamBuffer(IOBuf::copyBuffer("maybe"), 100, true));
+
+  std::vector<struct iovec> iovecs;
+  size_t bytes = 0;
+  peekDataFromQuicStream(
+      *stream, [&](StreamId, const folly::Range<PeekIterator>& peekData) {
+        bytes = QuicSocket::peekDataToIovecs(peekData, iovecs);
+      });
+  EXPECT_EQ(bytes, buf1->computeChainDataLength());
+  ASSERT_EQ(iovecs.size(), 2);
+  EXPECT_EQ(iovecs[0].iov_len, 15);
+  EXPECT_EQ(iovecs[1].iov_len, 19);
+  EXPECT_EQ(
+      std::string(static_cast<const char*>(iovecs[1].iov_base), 19),
+      "and this is crazy. ");
+}
+
 TEST_F(QuicStreamFunctionsTest, TestPeekAndConsumeContiguousData) {
   auto stream = conn.streamManager->createNextBidirectionalStream().value();
   auto streamLastMaxOffset = stream->maxOffsetObserved;
@@ -1432,6 +1536,26 @@ TEST_F(QuicStreamFunctionsTest, HolbTimingFirstBufferHOLBlocked) {
   EXPECT_EQ(1, stream->holbCount);
 }
 
+TEST_F(QuicStreamFunctionsTest, HolbTimingReportsDuration) {
+  MockQuicStats stats;
+  conn.statsCallback = &stats;
+  auto stream = conn.streamManager->createNextBidirectionalStream().value();
+  appendDataToReadBuffer(*stream, StreamBuffer(IOBuf::copyBuffer("just"), 2));
+  EXPECT_CALL(stats, onStreamHolBlockedDuration(_)).Times(0);
+  conn.streamManager->updateReadableStreams(*stream);
+  EXPECT_TRUE(stream->lastHolbTime);
+  Mock::VerifyAndClearExpectations(&stats);
+
+  appendDataToReadBuffer(*stream, StreamBuffer(IOBuf::copyBuffer("I "), 0));
+  std::chrono::microseconds reported{0};
+  EXPECT_CALL(stats, onStreamHolBlockedDuration(_))
+      .WillOnce(SaveArg<0>(&reported));
+  conn.streamManager->updateReadableStreams(*stream);
+  EXPECT_FALSE(stream->lastHolbTime);
+  EXPECT_EQ(stream->totalHolbTime, reported);
+  conn.statsCallback = nullptr;
+}
+
 TEST_F(QuicStreamFunctionsTest, HolbTimingReadingEntireStream) {
   auto stream = conn.streamManager->createNextBidirectionalStream().value();
   auto buf1 = IOBuf::copyBuffer("just");
@@ -1978,6 +2102,35 @@ TEST_F(QuicStreamFunctionsTest, AckCryptoStream) {
   EXPECT_EQ(conn.cryptoState->handshakeStream.retransmissionBuffer.size(), 0);
 }
 
+TEST_F(QuicStreamFunctionsTest, ReleaseHandshakeCryptoStreams) {
+  auto data = IOBuf::copyBuffer("SHLO");
+  auto& initialStream = conn.cryptoState->initialStream;
+  auto& handshakeStream = conn.cryptoState->handshakeStream;
+  auto& oneRttStream = conn.cryptoState->oneRttStream;
+  for (auto stream : {&initialStream, &handshakeStream, &oneRttStream}) {
+    stream->retransmissionBuffer.emplace(
+        0, std::make_unique<StreamBuffer>(data->clone(), 0));
+    stream->lossBuffer.emplace_back(data->clone(), 4);
+    stream->readBuffer.emplace_back(data->clone(), 20);
+    stream->writeBuffer.append(data->clone());
+    stream->currentWriteOffset = 8;
+    stream->currentReadOffset = 10;
+  }
+  releaseHandshakeCryptoStreams(*conn.cryptoState);
+  for (auto stream : {&initialStream, &handshakeStream}) {
+    EXPECT_TRUE(stream->retransmissionBuffer.empty());
+    EXPECT_TRUE(stream->lossBuffer.empty());
+    EXPECT_TRUE(stream->readBuffer.empty());
+    EXPECT_TRUE(stream->writeBuffer.empty());
+    EXPECT_EQ(stream->currentWriteOffset, 8);
+    EXPECT_EQ(stream->currentReadOffset, 10);
+  }
+  EXPECT_EQ(oneRttStream.retransmissionBuffer.size(), 1);
+  EXPECT_EQ(oneRttStream.lossBuffer.size(), 1);
+  EXPECT_EQ(oneRttStream.readBuffer.size(), 1);
+  EXPECT_FALSE(oneRttStream.writeBuffer.empty());
+}
+
 TEST_F(QuicStreamFunctionsTest, AckCryptoStreamOffsetLengthMismatch) {
   auto chlo = IOBuf::copyBuffer("CHLO");
   auto& cryptoStream = conn.cryptoState->handshakeStream;
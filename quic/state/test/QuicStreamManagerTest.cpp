@@ -210,6 +210,36 @@ TEST_F(QuicStreamManagerTest, StreamLimitWindowedUpdate) {
   EXPECT_FALSE(manager.remoteUnidirectionalStreamLimitUpdate());
 }
 
+TEST_F(QuicStreamManagerTest, ShrinkToFit) {
+  auto& manager = *conn.streamManager;
+  for (int i = 0; i < 100; i++) {
+    auto stream = manager.getStream(i * detail::kStreamIncrement);
+    stream->readBuffer.emplace_back(folly::IOBuf::copyBuffer("data"), 0);
+    manager.readableStreams().insert(stream->id);
+  }
+  for (int i = 1; i < 100; i++) {
+    auto stream = manager.getStream(i * detail::kStreamIncrement);
+    stream->readBuffer.clear();
+    stream->sendState = StreamSendState::Closed_E;
+    stream->recvState = StreamRecvState::Closed_E;
+    manager.removeClosedStream(stream->id);
+  }
+  auto remaining = manager.getStream(0);
+  manager.shrinkToFit();
+
+  // The stream left keeps its state, and its place in the sets.
+  EXPECT_EQ(1, manager.streamCount());
+  EXPECT_EQ(remaining, manager.getStream(0));
+  EXPECT_EQ(1, remaining->readBuffer.size());
+  EXPECT_EQ(1, manager.readableStreams().count(0));
+  EXPECT_EQ(nullptr, manager.getStream(4));
+
+  // And the manager grows again.
+  auto stream = manager.getStream(100 * detail::kStreamIncrement);
+  ASSERT_NE(nullptr, stream);
+  EXPECT_EQ(2, manager.streamCount());
+}
+
 TEST_F(QuicStreamManagerTest, StreamLimitNoWindowedUpdate) {
   auto& manager = *conn.streamManager;
   conn.transportSettings.advertisedInitialMaxStreamsBidi = 100;
@@ -279,5 +309,37 @@ TEST_F(QuicStreamManagerTest, StreamLimitIncrementUni) {
   EXPECT_EQ(s.value()->id, max + detail::kStreamIncrement);
 }
 
+TEST_F(QuicStreamManagerTest, ClosedStreamStorageIsReused) {
+  auto& manager = *conn.streamManager;
+  auto stream = manager.createNextBidirectionalStream().value();
+  stream->writeBuffer.append(folly::IOBuf::copyBuffer("stale"));
+  QuicStreamState* closedStream = stream;
+  StreamId closedId = stream->id;
+  stream->sendState = StreamSendState::Closed_E;
+  stream->recvState = StreamRecvState::Closed_E;
+  manager.removeClosedStream(stream->id);
+
+  // The new stream is made in the storage of the closed one, from scratch.
+  auto newStream = manager.createNextBidirectionalStream().value();
+  EXPECT_EQ(closedStream, newStream);
+  EXPECT_EQ(closedId + detail::kStreamIncrement, newStream->id);
+  EXPECT_TRUE(newStream->writeBuffer.empty());
+  EXPECT_EQ(StreamSendState::Open_E, newStream->sendState);
+}
+
+TEST(QuicStreamStatePoolTest, KeepsUpToMaxFree) {
+  QuicServerConnectionState conn;
+  QuicStreamStatePool pool(1);
+  auto stream1 = pool.create(0, conn);
+  auto stream2 = pool.create(4, conn);
+  EXPECT_EQ(0, pool.numFree());
+  stream1.reset();
+  stream2.reset();
+  EXPECT_EQ(1, pool.numFree());
+  auto stream3 = pool.create(8, conn);
+  EXPECT_EQ(0, pool.numFree());
+  EXPECT_EQ(8, stream3->id);
+}
+
 } // namespace test
 } // namespace quic
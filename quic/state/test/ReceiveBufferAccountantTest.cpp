@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/state/ReceiveBufferAccountant.h>
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+TEST(ReceiveBufferAccountantTest, AccountsUpdates) {
+  auto accountant = std::make_shared<ReceiveBufferAccountant>(1000);
+  ReceiveBufferAccountant::Account first(accountant);
+  ReceiveBufferAccountant::Account second(accountant);
+  first.update(600);
+  second.update(300);
+  EXPECT_EQ(900, accountant->bufferedBytes());
+  EXPECT_FALSE(first.underPressure());
+
+  second.update(400);
+  EXPECT_EQ(1000, accountant->bufferedBytes());
+  EXPECT_TRUE(first.underPressure());
+  EXPECT_TRUE(second.underPressure());
+
+  first.update(100);
+  EXPECT_EQ(500, accountant->bufferedBytes());
+  EXPECT_FALSE(second.underPressure());
+}
+
+TEST(ReceiveBufferAccountantTest, ReleasedWithAccount) {
+  auto accountant = std::make_shared<ReceiveBufferAccountant>(1000);
+  {
+    ReceiveBufferAccountant::Account account(accountant);
+    account.update(700);
+    ReceiveBufferAccountant::Account moved(std::move(account));
+    EXPECT_EQ(700, moved.bufferedBytes());
+    EXPECT_EQ(0, account.bufferedBytes());
+    EXPECT_EQ(700, accountant->bufferedBytes());
+
+    ReceiveBufferAccountant::Account other(accountant);
+    other.update(100);
+    other = std::move(moved);
+    EXPECT_EQ(700, accountant->bufferedBytes());
+  }
+  EXPECT_EQ(0, accountant->bufferedBytes());
+}
+
+TEST(ReceiveBufferAccountantTest, NoAccountant) {
+  ReceiveBufferAccountant::Account account;
+  account.update(1000);
+  EXPECT_FALSE(account.underPressure());
+}
+
+TEST(ReceiveBufferAccountantTest, ParentPressure) {
+  auto parent = std::make_shared<ReceiveBufferAccountant>(1000);
+  auto worker1 = std::make_shared<ReceiveBufferAccountant>(800, parent);
+  auto worker2 = std::make_shared<ReceiveBufferAccountant>(800, parent);
+  ReceiveBufferAccountant::Account first(worker1);
+  ReceiveBufferAccountant::Account second(worker2);
+  first.update(500);
+  EXPECT_EQ(500, parent->bufferedBytes());
+  EXPECT_FALSE(second.underPressure());
+
+  second.update(500);
+  EXPECT_EQ(1000, parent->bufferedBytes());
+  EXPECT_LT(worker2->bufferedBytes(), worker2->limit());
+  EXPECT_TRUE(second.underPressure());
+
+  second.update(0);
+  EXPECT_EQ(500, parent->bufferedBytes());
+  EXPECT_FALSE(second.underPressure());
+}
+} // namespace test
+} // namespace quic
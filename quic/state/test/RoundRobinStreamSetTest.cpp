@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <gtest/gtest.h>
+
+#include <quic/state/RoundRobinStreamSet.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+namespace {
+
+std::vector<StreamId> oneRound(const RoundRobinStreamSet& set) {
+  std::vector<StreamId> ids;
+  if (set.empty()) {
+    return ids;
+  }
+  auto start = set.getNextScheduled();
+  auto id = start;
+  do {
+    ids.push_back(id);
+    id = set.following(id);
+  } while (id != start);
+  return ids;
+}
+
+} // namespace
+
+TEST(RoundRobinStreamSetTest, InsertErase) {
+  RoundRobinStreamSet set;
+  EXPECT_TRUE(set.empty());
+  EXPECT_TRUE(set.insert(8));
+  EXPECT_FALSE(set.insert(8));
+  EXPECT_TRUE(set.insert(0));
+  EXPECT_TRUE(set.insert(4));
+  EXPECT_EQ(3, set.size());
+  EXPECT_TRUE(set.contains(0));
+  EXPECT_EQ(1, set.count(4));
+  EXPECT_EQ(0, set.count(12));
+  EXPECT_EQ(std::vector<StreamId>({8, 0, 4}), oneRound(set));
+
+  EXPECT_TRUE(set.erase(0));
+  EXPECT_FALSE(set.erase(0));
+  EXPECT_EQ(std::vector<StreamId>({8, 4}), oneRound(set));
+  EXPECT_TRUE(set.erase(8));
+  EXPECT_TRUE(set.erase(4));
+  EXPECT_TRUE(set.empty());
+
+  EXPECT_TRUE(set.insert(12));
+  EXPECT_EQ(12, set.getNextScheduled());
+  EXPECT_EQ(12, set.following(12));
+}
+
+TEST(RoundRobinStreamSetTest, InsertBeforeCursor) {
+  RoundRobinStreamSet set;
+  set.insert(0);
+  set.insert(4);
+  set.insert(8);
+  set.setNextScheduled(4);
+  // New streams are served at the end of the current round.
+  set.insert(12);
+  EXPECT_EQ(std::vector<StreamId>({4, 8, 0, 12}), oneRound(set));
+}
+
+TEST(RoundRobinStreamSetTest, EraseCursor) {
+  RoundRobinStreamSet set;
+  set.insert(0);
+  set.insert(4);
+  set.insert(8);
+  set.setNextScheduled(4);
+  set.erase(4);
+  EXPECT_EQ(8, set.getNextScheduled());
+  set.erase(8);
+  EXPECT_EQ(0, set.getNextScheduled());
+
+  // Stream that is not in the set can't be scheduled.
+  set.setNextScheduled(4);
+  EXPECT_EQ(0, set.getNextScheduled());
+}
+
+TEST(RoundRobinStreamSetTest, Clear) {
+  RoundRobinStreamSet set;
+  for (StreamId id = 0; id < 400; id += 4) {
+    set.insert(id);
+  }
+  EXPECT_EQ(100, set.size());
+  set.clear();
+  EXPECT_TRUE(set.empty());
+  set.insert(2);
+  EXPECT_EQ(std::vector<StreamId>({2}), oneRound(set));
+}
+
+} // namespace test
+} // namespace quic
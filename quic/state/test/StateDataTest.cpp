@@ -10,6 +10,7 @@
 #include <gtest/gtest.h>
 
 #include <quic/common/test/TestUtils.h>
+#include <quic/state/ConnectionMemoryUsage.h>
 #include <quic/state/StateData.h>
 
 using namespace quic;
@@ -68,6 +69,74 @@ TEST_F(StateDataTest, MultipleLostPacketsEvent) {
   EXPECT_EQ(110, *loss.largestLostPacketNum);
 }
 
+TEST_F(StateDataTest, PerfSummary) {
+  QuicConnectionStateBase conn(QuicNodeType::Server);
+  auto summary = conn.getPerfSummary(Clock::now());
+  EXPECT_EQ(0, summary.totalBytesSent);
+  EXPECT_EQ(0us, summary.minRtt);
+  EXPECT_EQ(0us, summary.cwndLimitedTime);
+
+  conn.lossState.totalBytesSent = 3000;
+  conn.lossState.totalBytesAcked = 2000;
+  conn.lossState.totalBytesRetransmitted = 500;
+  conn.lossState.rtxCount = 2;
+  conn.lossState.totalPTOCount = 1;
+  conn.lossState.spuriousLossCount = 1;
+  conn.lossState.mrtt = 10ms;
+  conn.lossState.srtt = 15ms;
+  auto now = Clock::now();
+  conn.totalCwndBlockedTime = 5ms;
+  conn.cwndBlockedTime = now - 2ms;
+  conn.totalAppLimitedTime = 7ms;
+  summary = conn.getPerfSummary(now);
+  EXPECT_EQ(3000, summary.totalBytesSent);
+  EXPECT_EQ(2000, summary.totalBytesAcked);
+  EXPECT_EQ(500, summary.totalBytesRetransmitted);
+  EXPECT_EQ(2, summary.rtxCount);
+  EXPECT_EQ(1, summary.ptoCount);
+  EXPECT_EQ(1, summary.spuriousLossCount);
+  EXPECT_EQ(10ms, summary.minRtt);
+  EXPECT_EQ(15ms, summary.srtt);
+  // The ongoing cwnd limited period counts up to now.
+  EXPECT_EQ(7ms, summary.cwndLimitedTime);
+  EXPECT_EQ(7ms, summary.appLimitedTime);
+}
+
+TEST_F(StateDataTest, RetransmissionBufferSorted) {
+  RetransmissionBuffer buffer;
+  for (uint64_t offset : {20, 30, 0, 10}) {
+    EXPECT_TRUE(buffer
+                    .emplace(
+                        offset,
+                        std::make_unique<StreamBuffer>(
+                            buildRandomInputData(10), offset))
+                    .second);
+  }
+  EXPECT_FALSE(buffer
+                   .emplace(
+                       10,
+                       std::make_unique<StreamBuffer>(
+                           buildRandomInputData(10), 10))
+                   .second);
+  EXPECT_EQ(4, buffer.size());
+  uint64_t expectedOffset = 0;
+  for (const auto& entry : buffer) {
+    EXPECT_EQ(expectedOffset, entry.first);
+    EXPECT_EQ(expectedOffset, entry.second->offset);
+    expectedOffset += 10;
+  }
+
+  EXPECT_EQ(buffer.end(), buffer.find(5));
+  EXPECT_EQ(20, buffer.at(20)->offset);
+  EXPECT_THROW(buffer.at(40), std::out_of_range);
+  buffer.erase(buffer.find(20));
+  EXPECT_EQ(buffer.end(), buffer.find(20));
+  EXPECT_EQ(30, buffer.find(30)->second->offset);
+  buffer.erase(buffer.find(0));
+  EXPECT_EQ(10, buffer.begin()->first);
+  EXPECT_EQ(2, buffer.size());
+}
+
 constexpr size_t kRtt{100000};
 
 class PendingPathRateLimiterTest : public Test {
@@ -144,5 +213,94 @@ TEST_F(PendingPathRateLimiterTest, TestCreditRefreshOnInfrequentSends) {
       maxWindowBytes);
 }
 
+namespace {
+void spin() {
+  auto start = folly::hardware_timestamp();
+  while (folly::hardware_timestamp() == start) {
+  }
+}
+} // namespace
+
+TEST_F(StateDataTest, CpuTimeScopes) {
+  ConnectionCpuTime cpuTime;
+  {
+    CpuTimeScope read(cpuTime, true, CpuTimeCategory::READ);
+    spin();
+    {
+      CpuTimeScope crypto(cpuTime, true, CpuTimeCategory::CRYPTO);
+      spin();
+      // Not tracked, so the time stays with crypto.
+      CpuTimeScope callbacks(cpuTime, false, CpuTimeCategory::CALLBACKS);
+      spin();
+    }
+    auto readBefore = cpuTime.get(CpuTimeCategory::READ);
+    auto cryptoBefore = cpuTime.get(CpuTimeCategory::CRYPTO);
+    EXPECT_GT(readBefore, 0);
+    EXPECT_GT(cryptoBefore, 0);
+    spin();
+    EXPECT_EQ(cpuTime.get(CpuTimeCategory::READ), readBefore);
+    EXPECT_EQ(cpuTime.get(CpuTimeCategory::CRYPTO), cryptoBefore);
+  }
+  EXPECT_EQ(cpuTime.current, CpuTimeCategory::MAX);
+  EXPECT_EQ(cpuTime.get(CpuTimeCategory::CALLBACKS), 0);
+  EXPECT_EQ(cpuTime.get(CpuTimeCategory::WRITE), 0);
+  EXPECT_EQ(
+      cpuTime.total(),
+      cpuTime.get(CpuTimeCategory::READ) +
+          cpuTime.get(CpuTimeCategory::CRYPTO));
+
+  auto total = cpuTime.total();
+  {
+    CpuTimeScope write(cpuTime, false, CpuTimeCategory::WRITE);
+    spin();
+  }
+  EXPECT_EQ(cpuTime.total(), total);
+
+  ConnectionCpuTime merged;
+  merged.merge(cpuTime);
+  merged.merge(cpuTime);
+  EXPECT_EQ(merged.total(), 2 * total);
+}
+
+TEST_F(StateDataTest, ConnectionMemoryUsage) {
+  QuicConnectionStateBase conn(QuicNodeType::Server);
+  EXPECT_EQ(getConnectionMemoryUsage(conn).total(), 0);
+
+  conn.streamManager = std::make_unique<QuicStreamManager>(
+      conn, conn.nodeType, conn.transportSettings);
+  auto stream = conn.streamManager->createNextBidirectionalStream().value();
+  stream->writeBuffer.append(folly::IOBuf::create(1000));
+  stream->retransmissionBuffer.emplace(
+      0, std::make_unique<StreamBuffer>(folly::IOBuf::create(2000), 0));
+  conn.cryptoState = std::make_unique<QuicCryptoState>();
+  conn.cryptoState->handshakeStream.readBuffer.emplace_back(
+      folly::IOBuf::create(3000), 0);
+  conn.outstandingPackets.push_back(makeTestingWritePacket(0, 100, 100));
+
+  auto usage = getConnectionMemoryUsage(conn);
+  EXPECT_GE(usage.get(MemoryCategory::STREAM_BUFFERS), 1000);
+  EXPECT_GE(usage.get(MemoryCategory::RETRANSMISSION_BUFFERS), 2000);
+  EXPECT_GE(usage.get(MemoryCategory::CRYPTO), 3000);
+  EXPECT_EQ(
+      usage.get(MemoryCategory::OUTSTANDING_PACKETS),
+      sizeof(OutstandingPacket));
+  EXPECT_EQ(usage.get(MemoryCategory::QLOG), 0);
+  EXPECT_EQ(
+      usage.total(),
+      usage.get(MemoryCategory::STREAM_BUFFERS) +
+          usage.get(MemoryCategory::RETRANSMISSION_BUFFERS) +
+          usage.get(MemoryCategory::CRYPTO) +
+          usage.get(MemoryCategory::OUTSTANDING_PACKETS));
+
+  stream->retransmissionBuffer.clear();
+  auto after = getConnectionMemoryUsage(conn);
+  EXPECT_EQ(after.get(MemoryCategory::RETRANSMISSION_BUFFERS), 0);
+
+  ConnectionMemoryUsage merged;
+  merged.merge(after);
+  merged.merge(after);
+  EXPECT_EQ(merged.total(), 2 * after.total());
+}
+
 } // namespace test
 } // namespace quic
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/state/StreamIdSet.h>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+namespace quic {
+namespace test {
+
+namespace {
+std::vector<StreamId> toVector(const StreamIdSet& set) {
+  return std::vector<StreamId>(set.begin(), set.end());
+}
+} // namespace
+
+TEST(StreamIdSetTest, InsertEraseCount) {
+  StreamIdSet set;
+  EXPECT_TRUE(set.empty());
+  EXPECT_TRUE(set.insert(4));
+  EXPECT_FALSE(set.insert(4));
+  EXPECT_TRUE(set.emplace(3));
+  EXPECT_EQ(2, set.size());
+  EXPECT_EQ(1, set.count(4));
+  EXPECT_EQ(1, set.count(3));
+  EXPECT_EQ(0, set.count(8));
+  EXPECT_EQ(0, set.count(5));
+  EXPECT_EQ(1, set.erase(4));
+  EXPECT_EQ(0, set.erase(4));
+  EXPECT_EQ(0, set.erase(1000));
+  EXPECT_EQ(1, set.size());
+  set.clear();
+  EXPECT_TRUE(set.empty());
+  EXPECT_EQ(set.begin(), set.end());
+}
+
+TEST(StreamIdSetTest, IteratesByTypeInOrder) {
+  StreamIdSet set;
+  for (StreamId id : {1001, 6, 1, 2, 0, 4000, 4, 3}) {
+    set.insert(id);
+  }
+  EXPECT_THAT(toVector(set), ElementsAre(0, 4, 4000, 1, 1001, 2, 6, 3));
+  EXPECT_EQ(4000, *set.find(4000));
+  EXPECT_EQ(set.end(), set.find(8));
+}
+
+TEST(StreamIdSetTest, IterateWhileErasing) {
+  StreamIdSet set;
+  for (StreamId id = 0; id < 1000; id += 4) {
+    set.insert(id);
+  }
+  auto it = set.begin();
+  while (it != set.end()) {
+    if (*it % 8 == 0) {
+      it = set.erase(it);
+    } else {
+      // Erasing another stream doesn't disturb the iterator.
+      set.erase(*it + 4);
+      ++it;
+    }
+  }
+  // 0 is erased, 4 erases 8 and so on.
+  EXPECT_EQ(125, set.size());
+  for (auto id : set) {
+    EXPECT_EQ(4, id % 8);
+  }
+}
+
+TEST(StreamIdSetTest, SlidingWindow) {
+  StreamIdSet set;
+  // Streams are opened and closed in order, far past the first ones.
+  for (StreamId id = 0; id < 1000000; id += 4) {
+    set.insert(id);
+    if (id >= 400) {
+      set.erase(id - 400);
+    }
+  }
+  EXPECT_EQ(100, set.size());
+  auto ids = toVector(set);
+  ASSERT_EQ(100, ids.size());
+  EXPECT_EQ(1000000 - 400, ids.front());
+  EXPECT_EQ(1000000 - 4, ids.back());
+  // Going back before the window still works.
+  set.insert(1);
+  set.insert(0);
+  EXPECT_EQ(1, set.count(0));
+  EXPECT_EQ(0, toVector(set).front());
+}
+
+TEST(StreamIdSetTest, ShrinkToFit) {
+  StreamIdSet set;
+  for (StreamId id = 0; id < 4000; id += 4) {
+    set.insert(id);
+  }
+  for (StreamId id = 0; id < 3996; id += 4) {
+    set.erase(id);
+  }
+  set.insert(1);
+  set.shrinkToFit();
+  EXPECT_THAT(toVector(set), ElementsAre(3996, 1));
+  EXPECT_TRUE(set.insert(8));
+  EXPECT_THAT(toVector(set), ElementsAre(8, 3996, 1));
+  set.clear();
+  set.shrinkToFit();
+  EXPECT_TRUE(set.empty());
+  EXPECT_TRUE(set.insert(4));
+  EXPECT_THAT(toVector(set), ElementsAre(4));
+}
+
+TEST(StreamIdRangeSetTest, OpenFarAhead) {
+  StreamIdRangeSet set;
+  set.insertRange(0, 4 * 9999);
+  EXPECT_EQ(10000, set.size());
+  EXPECT_EQ(1, set.intervals().size());
+  EXPECT_EQ(1, set.count(4 * 5000));
+  EXPECT_EQ(0, set.count(4 * 10000));
+
+  EXPECT_EQ(1, set.erase(4 * 5000));
+  EXPECT_EQ(0, set.erase(4 * 5000));
+  EXPECT_EQ(9999, set.size());
+  EXPECT_EQ(2, set.intervals().size());
+  EXPECT_EQ(0, set.count(4 * 5000));
+
+  // Adjacent to the last range.
+  set.insertRange(4 * 10000, 4 * 10001);
+  EXPECT_EQ(2, set.intervals().size());
+  EXPECT_EQ(10001, set.size());
+}
+
+TEST(StreamIdRangeSetTest, IterateAndErase) {
+  StreamIdRangeSet set;
+  set.insertRange(1, 17);
+  set.insertRange(25, 25);
+  EXPECT_THAT(
+      std::vector<StreamId>(set.begin(), set.end()),
+      ElementsAre(1, 5, 9, 13, 17, 25));
+  auto it = std::find(set.begin(), set.end(), 9);
+  ASSERT_NE(it, set.end());
+  it = set.erase(it);
+  ASSERT_NE(it, set.end());
+  EXPECT_EQ(13, *it);
+  it = set.erase(std::find(set.begin(), set.end(), 17));
+  EXPECT_EQ(25, *it);
+  EXPECT_EQ(set.end(), set.erase(it));
+  EXPECT_THAT(
+      std::vector<StreamId>(set.begin(), set.end()), ElementsAre(1, 5, 13));
+  set.clear();
+  EXPECT_TRUE(set.empty());
+  EXPECT_EQ(set.begin(), set.end());
+}
+
+} // namespace test
+} // namespace quic
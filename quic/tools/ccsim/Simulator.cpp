@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/tools/ccsim/Simulator.h>
+
+#include <quic/congestion_control/CongestionControllerFactory.h>
+#include <quic/congestion_control/Pacer.h>
+#include <quic/loss/QuicLossFunctions.h>
+#include <quic/server/state/ServerStateMachine.h>
+#include <quic/state/AckHandlers.h>
+#include <quic/state/QuicStateFunctions.h>
+
+namespace quic {
+namespace ccsim {
+
+SimClock::time_point SimClock::now_;
+
+namespace {
+// The stream all the data of a flow goes on.
+constexpr StreamId kSimStreamId = 0;
+} // namespace
+
+double FlowStats::goodput() const {
+  if (activeTime.count() <= 0) {
+    return 0;
+  }
+  return bytesDelivered * 8.0 * std::micro::den / activeTime.count();
+}
+
+std::chrono::microseconds FlowStats::meanRtt() const {
+  return rttSamples ? totalRtt / rttSamples : std::chrono::microseconds(0);
+}
+
+/**
+ * A sender and its receiver. The sender side is a connection state driven
+ * the way the transport drives it, the receiver only keeps what it needs to
+ * ack.
+ */
+class Simulator::Flow {
+ public:
+  Flow(Simulator& sim, FlowConfig config, uint8_t index)
+      : sim_(sim),
+        config_(config),
+        connId_(std::vector<uint8_t>{0xcc, index}),
+        lossVisitor_([this](auto&, auto&, bool, PacketNum) {
+          ++stats_.packetsLost;
+        }) {
+    conn_.udpSendPacketLen = sim_.config_.packetSize;
+    conn_.lossState.maxAckDelay = sim_.config_.maxAckDelay;
+    bool bbr = config_.congestionControl == CongestionControlType::BBR ||
+        config_.congestionControl == CongestionControlType::BBR2;
+    if (sim_.config_.pacing || bbr) {
+      // Paced with departure times, the way a kernel pacing with SCM_TXTIME
+      // holds the packets back, so that no pacing timer needs simulating.
+      conn_.transportSettings.pacingEnabled = true;
+      conn_.transportSettings.pacingUsesTxTime = true;
+      conn_.pacer = std::make_unique<DefaultPacer>(
+          conn_,
+          bbr ? kMinCwndInMssForBbr : conn_.transportSettings.minCwndInMss);
+    }
+    conn_.congestionController =
+        DefaultCongestionControllerFactory().makeCongestionController(
+            conn_, config_.congestionControl);
+    CHECK(conn_.congestionController)
+        << "No congestion controller for "
+        << congestionControlTypeToString(config_.congestionControl);
+    stats_.congestionControl = config_.congestionControl;
+  }
+
+  void start() {
+    startTime_ = SimClock::now();
+    write();
+  }
+
+  void finish() {
+    if (startTime_) {
+      stats_.activeTime =
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              SimClock::now() - *startTime_);
+    }
+  }
+
+  const FlowStats& stats() const {
+    return stats_;
+  }
+
+  const FlowConfig& config() const {
+    return config_;
+  }
+
+  void onPacketReceived(PacketNum packetNum, uint64_t size) {
+    ++stats_.packetsDelivered;
+    stats_.bytesDelivered += size;
+    bool outOfOrder = largestReceived_ && packetNum != *largestReceived_ + 1;
+    if (!largestReceived_ || packetNum > *largestReceived_) {
+      largestReceived_ = packetNum;
+      largestReceivedTime_ = SimClock::now();
+    }
+    received_.insert(packetNum);
+    if (received_.size() > kDefaultMaxAckRanges) {
+      received_.withdraw(received_.front());
+    }
+    if (outOfOrder || ++packetsToAck_ >= sim_.config_.packetsPerAck) {
+      sendAck();
+    } else if (!ackTimerScheduled_) {
+      ackTimerScheduled_ = true;
+      auto generation = ackTimerGeneration_;
+      sim_.schedule(
+          SimClock::now() + sim_.config_.maxAckDelay, [this, generation] {
+            if (generation == ackTimerGeneration_) {
+              sendAck();
+            }
+          });
+    }
+  }
+
+  // What setLossDetectionAlarm needs of a timeout.
+  void cancelLossTimeout() {
+    ++lossTimerGeneration_;
+    lossTimerScheduled_ = false;
+  }
+
+  bool isLossTimeoutScheduled() const {
+    return lossTimerScheduled_;
+  }
+
+  void scheduleLossTimeout(std::chrono::microseconds timeout) {
+    lossTimerScheduled_ = true;
+    auto generation = ++lossTimerGeneration_;
+    sim_.schedule(SimClock::now() + timeout, [this, generation] {
+      if (generation == lossTimerGeneration_) {
+        lossTimerScheduled_ = false;
+        onLossTimeout();
+      }
+    });
+  }
+
+ private:
+  void write() {
+    if (closed_) {
+      return;
+    }
+    auto now = SimClock::now();
+    auto size = sim_.config_.packetSize;
+    while (conn_.pendingEvents.numProbePackets > 0 ||
+           conn_.congestionController->getWritableBytes() >= size) {
+      if (conn_.pendingEvents.numProbePackets > 0) {
+        --conn_.pendingEvents.numProbePackets;
+      }
+      auto departure =
+          conn_.pacer ? conn_.pacer->getDepartureTime(now, size) : now;
+      sendPacket(departure, size);
+    }
+    setLossDetectionAlarm<Flow, SimClock>(conn_, *this);
+  }
+
+  // The bookkeeping updateConnection does for a packet with stream data.
+  void sendPacket(TimePoint departure, uint64_t size) {
+    auto packetNum = getNextPacketNum(conn_, PacketNumberSpace::AppData);
+    RegularQuicWritePacket packet(
+        ShortHeader(ProtectionType::KeyPhaseZero, connId_, packetNum));
+    packet.frames.push_back(
+        WriteStreamFrame(kSimStreamId, streamOffset_, size, false));
+    streamOffset_ += size;
+    increaseNextPacketNum(conn_, PacketNumberSpace::AppData);
+    conn_.lossState.largestSent =
+        std::max(conn_.lossState.largestSent, packetNum);
+    conn_.pendingEvents.setLossDetectionAlarm = true;
+    conn_.lossState.totalBytesSent += size;
+    conn_.outstandingPackets.emplace_back(
+        std::move(packet),
+        departure,
+        size,
+        false,
+        conn_.lossState.totalBytesSent);
+    auto& pkt = conn_.outstandingPackets.back();
+    pkt.isAppLimited = conn_.congestionController->isAppLimited();
+    if (conn_.lossState.lastAckedTime.has_value() &&
+        conn_.lossState.lastAckedPacketSentTime.has_value()) {
+      pkt.lastAckedPacketInfo.emplace(
+          *conn_.lossState.lastAckedPacketSentTime,
+          *conn_.lossState.lastAckedTime,
+          conn_.lossState.totalBytesSentAtLastAck,
+          conn_.lossState.totalBytesAckedAtLastAck);
+    }
+    conn_.congestionController->onPacketSent(pkt);
+    if (conn_.pacer) {
+      conn_.pacer->onPacketSent();
+    }
+    conn_.lossState.lastRetransmittablePacketSentTime = pkt.time;
+    ++stats_.packetsSent;
+    sim_.sendData(*this, departure, packetNum);
+  }
+
+  void sendAck() {
+    packetsToAck_ = 0;
+    ackTimerScheduled_ = false;
+    ++ackTimerGeneration_;
+    ReadAckFrame ack;
+    ack.largestAcked = *largestReceived_;
+    ack.ackDelay = std::chrono::duration_cast<std::chrono::microseconds>(
+        SimClock::now() - largestReceivedTime_);
+    for (auto it = received_.crbegin(); it != received_.crend(); ++it) {
+      ack.ackBlocks.emplace_back(it->start, it->end);
+    }
+    sim_.schedule(
+        SimClock::now() + sim_.config_.bottleneck.delay + config_.extraRtt,
+        [this, ack = std::move(ack)] { onAck(ack); });
+  }
+
+  void onAck(const ReadAckFrame& ack) {
+    if (closed_) {
+      return;
+    }
+    auto bytesAcked = conn_.lossState.totalBytesAcked;
+    processAckFrame(
+        conn_,
+        PacketNumberSpace::AppData,
+        ack,
+        [](auto&, auto&, auto&) {},
+        lossVisitor_,
+        SimClock::now());
+    if (conn_.lossState.totalBytesAcked > bytesAcked) {
+      auto rtt = conn_.lossState.lrtt;
+      ++stats_.rttSamples;
+      stats_.totalRtt += rtt;
+      stats_.minRtt =
+          stats_.rttSamples == 1 ? rtt : std::min(stats_.minRtt, rtt);
+      stats_.maxRtt = std::max(stats_.maxRtt, rtt);
+    }
+    write();
+  }
+
+  void onLossTimeout() {
+    try {
+      onLossDetectionAlarm<LossVisitor, SimClock>(conn_, lossVisitor_);
+    } catch (const QuicInternalException& ex) {
+      LOG(WARNING) << congestionControlTypeToString(config_.congestionControl)
+                   << " flow closed: " << ex.what();
+      closed_ = true;
+      return;
+    }
+    write();
+  }
+
+  Simulator& sim_;
+  FlowConfig config_;
+  ConnectionId connId_;
+  QuicServerConnectionState conn_;
+  LossVisitor lossVisitor_;
+  FlowStats stats_;
+  folly::Optional<TimePoint> startTime_;
+  uint64_t streamOffset_{0};
+  bool closed_{false};
+  bool lossTimerScheduled_{false};
+  uint64_t lossTimerGeneration_{0};
+
+  // Receiver.
+  AckBlocks received_;
+  folly::Optional<PacketNum> largestReceived_;
+  TimePoint largestReceivedTime_;
+  uint64_t packetsToAck_{0};
+  bool ackTimerScheduled_{false};
+  uint64_t ackTimerGeneration_{0};
+};
+
+Simulator::Simulator(SimulatorConfig config)
+    : config_(std::move(config)), bottleneck_(config_.bottleneck) {}
+
+Simulator::~Simulator() = default;
+
+void Simulator::addFlow(FlowConfig config) {
+  CHECK_LT(flows_.size(), std::numeric_limits<uint8_t>::max());
+  flows_.push_back(
+      std::make_unique<Flow>(*this, config, (uint8_t)flows_.size()));
+}
+
+void Simulator::schedule(TimePoint time, std::function<void()> fn) {
+  events_.push(Event{time, nextSeq_++, std::move(fn)});
+}
+
+void Simulator::sendData(Flow& flow, TimePoint departure, PacketNum packetNum) {
+  auto size = config_.packetSize;
+  // The link sees the packets in the order they leave, whichever flow they're
+  // from.
+  schedule(departure, [this, &flow, packetNum, size] {
+    auto arrival = bottleneck_.onPacket(SimClock::now(), size);
+    if (arrival) {
+      schedule(*arrival, [&flow, packetNum, size] {
+        flow.onPacketReceived(packetNum, size);
+      });
+    }
+  });
+}
+
+std::vector<FlowStats> Simulator::run() {
+  // The controllers end their rounds and recovery periods at the latest send
+  // time they have seen, or now if that's later. Virtual time starts well
+  // after now, so that it is always the send time.
+  start_ = Clock::now() + std::chrono::hours(24);
+  end_ = start_ + config_.duration;
+  SimClock::now_ = start_;
+  for (auto& flow : flows_) {
+    auto rawFlow = flow.get();
+    schedule(
+        start_ + flow->config().startTime, [rawFlow] { rawFlow->start(); });
+  }
+  while (!events_.empty() && events_.top().time <= end_) {
+    // The function may schedule more events, take it off the queue first.
+    auto fn = std::move(const_cast<Event&>(events_.top()).fn);
+    SimClock::now_ = events_.top().time;
+    events_.pop();
+    fn();
+  }
+  SimClock::now_ = end_;
+  std::vector<FlowStats> stats;
+  for (auto& flow : flows_) {
+    flow->finish();
+    stats.push_back(flow->stats());
+  }
+  return stats;
+}
+
+double Simulator::fairnessIndex(const std::vector<FlowStats>& stats) {
+  double sum = 0;
+  double sumOfSquares = 0;
+  for (const auto& flowStats : stats) {
+    auto goodput = flowStats.goodput();
+    sum += goodput;
+    sumOfSquares += goodput * goodput;
+  }
+  if (sumOfSquares == 0) {
+    return 1;
+  }
+  return sum * sum / (stats.size() * sumOfSquares);
+}
+
+} // namespace ccsim
+} // namespace quic
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <quic/QuicConstants.h>
+#include <quic/tools/tperf/NetworkImpairment.h>
+
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+
+namespace quic {
+namespace ccsim {
+
+/**
+ * Virtual time of the simulation, for the loss functions that take a
+ * ClockType. Only the Simulator moves it, from one event to the next.
+ */
+class SimClock {
+ public:
+  using time_point = Clock::time_point;
+  using duration = Clock::duration;
+
+  static time_point now() {
+    return now_;
+  }
+
+ private:
+  friend class Simulator;
+  static time_point now_;
+};
+
+struct FlowConfig {
+  CongestionControlType congestionControl{CongestionControlType::Cubic};
+  // When the flow starts sending, after the start of the simulation.
+  std::chrono::microseconds startTime{0};
+  // Added to the round trip of the bottleneck, on the way back, to compare
+  // flows that have different round trips.
+  std::chrono::microseconds extraRtt{0};
+};
+
+struct SimulatorConfig {
+  // The link all the flows send their data through. The acks come back over
+  // a path with the same delay that neither queues nor loses them.
+  tperf::NetworkImpairmentConfig bottleneck;
+  std::chrono::microseconds duration{10s};
+  uint64_t packetSize{kDefaultUDPSendPacketLen};
+  bool pacing{true};
+  // Receivers ack every this many packets, after maxAckDelay at the latest,
+  // and right away when a packet comes out of order.
+  uint64_t packetsPerAck{kDefaultRxPacketsBeforeAckAfterInit};
+  std::chrono::microseconds maxAckDelay{kMaxAckTimeout};
+};
+
+struct FlowStats {
+  CongestionControlType congestionControl;
+  uint64_t packetsSent{0};
+  uint64_t packetsDelivered{0};
+  uint64_t bytesDelivered{0};
+  // Packets the loss functions declared lost, spuriously or not.
+  uint64_t packetsLost{0};
+  uint64_t rttSamples{0};
+  std::chrono::microseconds minRtt{0};
+  std::chrono::microseconds maxRtt{0};
+  std::chrono::microseconds totalRtt{0};
+  // How long the flow was sending for.
+  std::chrono::microseconds activeTime{0};
+
+  // Bits a second the receiver got.
+  double goodput() const;
+
+  std::chrono::microseconds meanRtt() const;
+};
+
+/**
+ * Discrete event simulation of flows sharing a bottleneck link. The flows run
+ * the real congestion controllers, pacer, ack processing and loss detection
+ * on their own connection state, the link, the receivers and the clock are
+ * simulated. Runs take no wall clock time to speak of, and give the same
+ * result for the same config.
+ *
+ * The flows always have data to send, lost packets are not resent as new
+ * data is just as good to them.
+ */
+class Simulator {
+ public:
+  explicit Simulator(SimulatorConfig config);
+  ~Simulator();
+
+  void addFlow(FlowConfig config);
+
+  /**
+   * Runs the simulation for the configured duration, once.
+   */
+  std::vector<FlowStats> run();
+
+  /**
+   * Jain's fairness index of the goodputs: 1 when all the flows get the same,
+   * down to 1 / n when one flow gets everything.
+   */
+  static double fairnessIndex(const std::vector<FlowStats>& stats);
+
+ private:
+  class Flow;
+
+  struct Event {
+    TimePoint time;
+    // Breaks ties in the order of scheduling, to stay deterministic.
+    uint64_t seq;
+    std::function<void()> fn;
+
+    bool operator>(const Event& other) const {
+      return time != other.time ? time > other.time : seq > other.seq;
+    }
+  };
+
+  void schedule(TimePoint time, std::function<void()> fn);
+  void sendData(Flow& flow, TimePoint departure, PacketNum packetNum);
+
+  SimulatorConfig config_;
+  tperf::NetworkImpairment bottleneck_;
+  std::vector<std::unique_ptr<Flow>> flows_;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+  uint64_t nextSeq_{0};
+  TimePoint start_;
+  TimePoint end_;
+};
+
+} // namespace ccsim
+} // namespace quic
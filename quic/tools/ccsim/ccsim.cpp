@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <glog/logging.h>
+
+#include <folly/String.h>
+#include <folly/init/Init.h>
+#include <folly/portability/GFlags.h>
+
+#include <quic/tools/ccsim/Simulator.h>
+
+DEFINE_string(
+    congestion,
+    "cubic",
+    "Comma separated congestion controllers of the flows, one flow each: "
+    "newreno/cubic/copa/bbr/bbr2");
+DEFINE_int32(duration, 30, "Simulated seconds");
+DEFINE_uint64(bandwidth_mbps, 10, "Bottleneck bandwidth in Mb/s");
+DEFINE_uint32(delay_ms, 20, "One way delay of the path in ms");
+DEFINE_uint32(
+    queue_ms,
+    100,
+    "Packets that would wait longer than this at the bottleneck are dropped");
+DEFINE_double(loss, 0, "Random loss rate of the bottleneck");
+DEFINE_uint32(jitter_ms, 0, "Delay jitter of the bottleneck in ms");
+DEFINE_uint32(
+    start_interval_ms,
+    0,
+    "Time between the starts of consecutive flows in ms");
+DEFINE_uint32(
+    extra_rtt_ms,
+    0,
+    "Round trip added to each flow after the first, times its index, in ms");
+DEFINE_uint64(packets_per_ack, 2, "Packets the receivers ack at once");
+DEFINE_bool(pacing, true, "Pace the flows, BBR flows are always paced");
+DEFINE_uint64(seed, 0, "Seed of the loss and jitter of the bottleneck");
+
+using namespace quic;
+using namespace quic::ccsim;
+
+int main(int argc, char* argv[]) {
+#if FOLLY_HAVE_LIBGFLAGS
+  // Enable glog logging to stderr by default.
+  gflags::SetCommandLineOptionWithMode(
+      "logtostderr", "1", gflags::SET_FLAGS_DEFAULT);
+#endif
+  gflags::ParseCommandLineFlags(&argc, &argv, false);
+  folly::Init init(&argc, &argv);
+
+  SimulatorConfig config;
+  config.duration = std::chrono::seconds(FLAGS_duration);
+  config.bottleneck.bandwidth = FLAGS_bandwidth_mbps * 1000 * 1000 / 8;
+  config.bottleneck.delay = std::chrono::milliseconds(FLAGS_delay_ms);
+  config.bottleneck.maxQueueDelay = std::chrono::milliseconds(FLAGS_queue_ms);
+  config.bottleneck.lossRate = FLAGS_loss;
+  config.bottleneck.jitter = std::chrono::milliseconds(FLAGS_jitter_ms);
+  config.bottleneck.seed = FLAGS_seed;
+  config.packetsPerAck = FLAGS_packets_per_ack;
+  config.pacing = FLAGS_pacing;
+  Simulator simulator(config);
+
+  std::vector<std::string> congestionControls;
+  folly::split(',', FLAGS_congestion, congestionControls, true);
+  for (size_t i = 0; i < congestionControls.size(); ++i) {
+    auto type = congestionControlStrToType(congestionControls[i]);
+    if (!type || *type == CongestionControlType::None) {
+      LOG(ERROR) << "Unknown congestion controller " << congestionControls[i];
+      return 1;
+    }
+    FlowConfig flow;
+    flow.congestionControl = *type;
+    flow.startTime = std::chrono::milliseconds(FLAGS_start_interval_ms * i);
+    flow.extraRtt = std::chrono::milliseconds(FLAGS_extra_rtt_ms * i);
+    simulator.addFlow(flow);
+  }
+  if (congestionControls.empty()) {
+    LOG(ERROR) << "No flows to simulate";
+    return 1;
+  }
+
+  auto stats = simulator.run();
+  constexpr double bitsPerMegabit = 1000 * 1000;
+  double totalGoodput = 0;
+  for (size_t i = 0; i < stats.size(); ++i) {
+    const auto& flowStats = stats[i];
+    totalGoodput += flowStats.goodput();
+    LOG(INFO) << "Flow " << i << " "
+              << congestionControlTypeToString(flowStats.congestionControl)
+              << ": goodput=" << flowStats.goodput() / bitsPerMegabit
+              << "Mb/s sent=" << flowStats.packetsSent
+              << " delivered=" << flowStats.packetsDelivered
+              << " lost=" << flowStats.packetsLost
+              << " rtt min/mean/max=" << flowStats.minRtt.count() / 1000.0
+              << "/" << flowStats.meanRtt().count() / 1000.0 << "/"
+              << flowStats.maxRtt.count() / 1000.0 << "ms";
+  }
+  LOG(INFO) << "Link utilization: "
+            << totalGoodput / (FLAGS_bandwidth_mbps * bitsPerMegabit);
+  LOG(INFO) << "Jain's fairness index: " << Simulator::fairnessIndex(stats);
+  return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/tools/ccsim/Simulator.h>
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+namespace quic {
+namespace ccsim {
+namespace test {
+
+SimulatorConfig makeConfig() {
+  SimulatorConfig config;
+  config.duration = 10s;
+  config.bottleneck.bandwidth = 10 * 1000 * 1000 / 8;
+  config.bottleneck.delay = 20ms;
+  config.bottleneck.maxQueueDelay = 50ms;
+  config.bottleneck.lossRate = 0.001;
+  config.bottleneck.seed = 7;
+  return config;
+}
+
+std::vector<FlowStats> runFlows(
+    const std::vector<CongestionControlType>& types) {
+  Simulator simulator(makeConfig());
+  for (auto type : types) {
+    FlowConfig flow;
+    flow.congestionControl = type;
+    simulator.addFlow(flow);
+  }
+  return simulator.run();
+}
+
+class SimulatorTest : public TestWithParam<CongestionControlType> {};
+
+TEST_P(SimulatorTest, SingleFlow) {
+  auto config = makeConfig();
+  auto stats = runFlows({GetParam()});
+  ASSERT_EQ(1, stats.size());
+  EXPECT_EQ(10s, stats[0].activeTime);
+  EXPECT_GT(stats[0].packetsDelivered, 0);
+  EXPECT_LE(stats[0].packetsDelivered, stats[0].packetsSent);
+  // Can't beat the bottleneck, or its round trip.
+  EXPECT_LE(stats[0].goodput(), config.bottleneck.bandwidth * 8);
+  EXPECT_GT(stats[0].goodput(), config.bottleneck.bandwidth * 8 / 2);
+  EXPECT_GE(stats[0].minRtt, config.bottleneck.delay * 2);
+  EXPECT_LE(
+      stats[0].maxRtt,
+      config.bottleneck.delay * 2 + config.bottleneck.maxQueueDelay +
+          config.maxAckDelay + 10ms);
+}
+
+TEST_P(SimulatorTest, SameConfigSameResult) {
+  auto first = runFlows({GetParam(), GetParam()});
+  auto second = runFlows({GetParam(), GetParam()});
+  ASSERT_EQ(first.size(), second.size());
+  for (size_t i = 0; i < first.size(); ++i) {
+    EXPECT_EQ(first[i].packetsSent, second[i].packetsSent);
+    EXPECT_EQ(first[i].bytesDelivered, second[i].bytesDelivered);
+    EXPECT_EQ(first[i].packetsLost, second[i].packetsLost);
+    EXPECT_EQ(first[i].totalRtt, second[i].totalRtt);
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(
+    SimulatorTests,
+    SimulatorTest,
+    Values(
+        CongestionControlType::NewReno,
+        CongestionControlType::Cubic,
+        CongestionControlType::Copa,
+        CongestionControlType::BBR,
+        CongestionControlType::BBR2));
+
+TEST(SimulatorFairnessTest, FairnessIndex) {
+  std::vector<FlowStats> stats(2);
+  stats[0].activeTime = stats[1].activeTime = 1s;
+  stats[0].bytesDelivered = stats[1].bytesDelivered = 1000;
+  EXPECT_DOUBLE_EQ(1, Simulator::fairnessIndex(stats));
+  stats[1].bytesDelivered = 0;
+  EXPECT_DOUBLE_EQ(0.5, Simulator::fairnessIndex(stats));
+}
+
+} // namespace test
+} // namespace ccsim
+} // namespace quic
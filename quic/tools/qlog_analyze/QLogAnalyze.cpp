@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <glog/logging.h>
+
+#include <folly/FileUtil.h>
+#include <folly/init/Init.h>
+#include <folly/json.h>
+#include <folly/portability/GFlags.h>
+
+#include <quic/logging/BinaryQLogConverter.h>
+#include <quic/tools/qlog_analyze/QLogAnalyzer.h>
+
+#include <iostream>
+
+DEFINE_string(input, "", "qlog to analyze, JSON or a binary qlog ring file");
+DEFINE_bool(binary, false, "The input is a binary qlog ring file");
+DEFINE_double(
+    cwnd_limited_threshold,
+    0.5,
+    "Fraction of time cwnd limited past which it is an anomaly");
+DEFINE_double(
+    retransmission_threshold,
+    0.05,
+    "Retransmission rate past which it is an anomaly");
+DEFINE_double(
+    spurious_loss_threshold,
+    0.2,
+    "Fraction of spurious losses past which it is an anomaly");
+DEFINE_uint64(
+    send_burst_threshold,
+    32,
+    "Packets sent at once past which it is an anomaly");
+DEFINE_bool(pretty_json, true, "Write indented JSON");
+
+int main(int argc, char* argv[]) {
+#if FOLLY_HAVE_LIBGFLAGS
+  // Enable glog logging to stderr by default.
+  gflags::SetCommandLineOptionWithMode(
+      "logtostderr", "1", gflags::SET_FLAGS_DEFAULT);
+#endif
+  gflags::ParseCommandLineFlags(&argc, &argv, false);
+  folly::Init init(&argc, &argv);
+
+  std::string contents;
+  if (FLAGS_input.empty() ||
+      !folly::readFile(FLAGS_input.c_str(), contents)) {
+    LOG(ERROR) << "Can't read input file: " << FLAGS_input;
+    return 1;
+  }
+
+  std::vector<folly::dynamic> qlogs;
+  if (FLAGS_binary) {
+    auto loggers = quic::convertBinaryQLog(folly::ByteRange(
+        reinterpret_cast<const uint8_t*>(contents.data()), contents.size()));
+    for (const auto& logger : loggers) {
+      qlogs.push_back(logger->toDynamic());
+    }
+  } else {
+    try {
+      qlogs.push_back(folly::parseJson(contents));
+    } catch (const std::exception& ex) {
+      LOG(ERROR) << "Can't parse " << FLAGS_input << ": " << ex.what();
+      return 1;
+    }
+  }
+
+  quic::qlog_analyze::AnalyzerThresholds thresholds;
+  thresholds.cwndLimitedFraction = FLAGS_cwnd_limited_threshold;
+  thresholds.retransmissionRate = FLAGS_retransmission_threshold;
+  thresholds.spuriousLossRate = FLAGS_spurious_loss_threshold;
+  thresholds.maxSendBurst = FLAGS_send_burst_threshold;
+
+  // One report per connection, in the order of the input.
+  folly::dynamic reports = folly::dynamic::array;
+  for (const auto& qlog : qlogs) {
+    auto analysis = quic::qlog_analyze::analyzeQLog(qlog, thresholds);
+    if (analysis.hasError()) {
+      LOG(ERROR) << "Can't analyze qlog: " << analysis.error();
+      return 1;
+    }
+    reports.push_back(quic::qlog_analyze::toDynamic(*analysis));
+  }
+  std::cout << (FLAGS_pretty_json ? folly::toPrettyJson(reports)
+                                  : folly::toJson(reports))
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/tools/qlog_analyze/QLogAnalyzer.h>
+
+#include <folly/Conv.h>
+#include <folly/json.h>
+#include <quic/logging/QLoggerConstants.h>
+
+#include <algorithm>
+
+namespace quic {
+namespace qlog_analyze {
+
+namespace {
+
+// The FileQLogger event_fields: relative_time, CATEGORY, EVENT_TYPE, TRIGGER,
+// DATA.
+constexpr size_t kTimeIndex = 0;
+constexpr size_t kTypeIndex = 2;
+constexpr size_t kDataIndex = 4;
+
+/**
+ * Time spent in a state that the trace turns on and off, like app limited.
+ */
+class StateTimer {
+ public:
+  void update(bool on, std::chrono::microseconds now) {
+    if (on && !since_) {
+      since_ = now;
+    } else if (!on && since_) {
+      total_ += now - *since_;
+      since_ = folly::none;
+    }
+  }
+
+  std::chrono::microseconds total(std::chrono::microseconds end) const {
+    return since_ ? total_ + (end - *since_) : total_;
+  }
+
+ private:
+  folly::Optional<std::chrono::microseconds> since_;
+  std::chrono::microseconds total_{0};
+};
+
+uint64_t getUInt(const folly::dynamic& data, const char* field) {
+  auto value = data.get_ptr(field);
+  // Some fields, like a STREAM frame's stream_id, are logged as strings.
+  return value && !value->isNull() ? value->asInt() : 0;
+}
+
+std::chrono::microseconds percentile(
+    const std::vector<std::chrono::microseconds>& sorted,
+    double pct) {
+  auto index =
+      std::min<size_t>(sorted.size() - 1, sorted.size() * pct / 100);
+  return sorted[index];
+}
+
+double fraction(double part, double whole) {
+  return whole > 0 ? part / whole : 0;
+}
+
+void checkAbove(
+    std::vector<Anomaly>& anomalies,
+    const char* metric,
+    double value,
+    double threshold,
+    const char* description) {
+  if (value > threshold) {
+    anomalies.push_back({metric, value, threshold, description});
+  }
+}
+
+void findAnomalies(
+    QLogAnalysis& analysis,
+    const AnalyzerThresholds& thresholds) {
+  auto& anomalies = analysis.anomalies;
+  checkAbove(
+      anomalies,
+      "cwnd_limited_fraction",
+      analysis.cwndLimitedFraction,
+      thresholds.cwndLimitedFraction,
+      "Sending is mostly held back by the congestion window");
+  checkAbove(
+      anomalies,
+      "flow_control_limited_fraction",
+      analysis.flowControlLimitedFraction,
+      thresholds.flowControlLimitedFraction,
+      "The peer's connection flow control window is too small");
+  checkAbove(
+      anomalies,
+      "retransmission_rate",
+      analysis.retransmissionRate,
+      thresholds.retransmissionRate,
+      "High retransmission rate");
+  checkAbove(
+      anomalies,
+      "spurious_loss_rate",
+      analysis.spuriousLossRate,
+      thresholds.spuriousLossRate,
+      "Many losses were spurious, loss detection is too aggressive");
+  if (analysis.rtt.samples > 0 && analysis.rtt.min.count() > 0) {
+    checkAbove(
+        anomalies,
+        "rtt_inflation",
+        double(analysis.rtt.p99.count()) / analysis.rtt.min.count(),
+        thresholds.rttInflation,
+        "p99 RTT is far above min RTT, queues are building up");
+  }
+  checkAbove(
+      anomalies,
+      "max_send_burst",
+      analysis.pacing.maxSendBurst,
+      thresholds.maxSendBurst,
+      "Packets are sent in large bursts");
+  for (const auto& stream : analysis.blockedStreams) {
+    if (stream.second.maxBlocked > thresholds.streamBlocked) {
+      anomalies.push_back(
+          {folly::to<std::string>("stream_blocked_us.", stream.first),
+           double(stream.second.maxBlocked.count()),
+           double(thresholds.streamBlocked.count()),
+           "Stream waited long on the peer's stream flow control"});
+    }
+  }
+}
+
+} // namespace
+
+folly::Expected<QLogAnalysis, std::string> analyzeQLog(
+    const folly::dynamic& qlog,
+    const AnalyzerThresholds& thresholds) {
+  if (!qlog.isObject()) {
+    return folly::makeUnexpected(std::string("QLog is not an object"));
+  }
+  auto traces = qlog.get_ptr("traces");
+  if (!traces || !traces->isArray() || traces->empty()) {
+    return folly::makeUnexpected(std::string("QLog has no traces"));
+  }
+  const auto& trace = (*traces)[0];
+  auto events = trace.get_ptr("events");
+  if (!events || !events->isArray()) {
+    return folly::makeUnexpected(std::string("Trace has no events"));
+  }
+
+  QLogAnalysis analysis;
+  if (auto vantagePoint = trace.get_ptr("vantage_point")) {
+    if (auto type = vantagePoint->get_ptr("type")) {
+      analysis.vantagePoint = type->asString();
+    }
+  }
+
+  StateTimer cwndLimited;
+  StateTimer appLimited;
+  StateTimer flowControlLimited;
+  std::map<uint64_t, std::chrono::microseconds> streamBlockedSince;
+  std::vector<std::chrono::microseconds> rtts;
+  uint64_t targetBurstTotal = 0;
+  folly::Optional<std::chrono::microseconds> lastSendTime;
+  uint64_t currentSendBurst = 0;
+  uint64_t sendBurstTotal = 0;
+  folly::Optional<uint64_t> summaryBytesSent;
+  folly::Optional<uint64_t> summaryBytesRetransmitted;
+
+  auto endSendBurst = [&] {
+    if (currentSendBurst > 0) {
+      ++analysis.pacing.sendBursts;
+      sendBurstTotal += currentSendBurst;
+      analysis.pacing.maxSendBurst =
+          std::max(analysis.pacing.maxSendBurst, currentSendBurst);
+    }
+  };
+
+  folly::Optional<std::chrono::microseconds> start;
+  std::chrono::microseconds now{0};
+  for (const auto& event : *events) {
+    if (!event.isArray() || event.size() <= kDataIndex ||
+        !event[kDataIndex].isObject()) {
+      return folly::makeUnexpected(
+          folly::to<std::string>("Malformed event: ", folly::toJson(event)));
+    }
+    try {
+      now = std::chrono::microseconds(event[kTimeIndex].asInt());
+    } catch (const std::exception& ex) {
+      return folly::makeUnexpected(
+          folly::to<std::string>("Bad event time: ", ex.what()));
+    }
+    if (!start) {
+      start = now;
+    }
+    const auto& type = event[kTypeIndex].asString();
+    const auto& data = event[kDataIndex];
+
+    if (type == "PACKET_SENT") {
+      ++analysis.packetsSent;
+      if (auto header = data.get_ptr("header")) {
+        analysis.bytesSent += getUInt(*header, "packet_size");
+      }
+      if (lastSendTime && *lastSendTime == now) {
+        ++currentSendBurst;
+      } else {
+        endSendBurst();
+        currentSendBurst = 1;
+      }
+      lastSendTime = now;
+      if (auto frames = data.get_ptr("frames")) {
+        for (const auto& frame : *frames) {
+          auto frameType = frame.getDefault("frame_type", "").asString();
+          if (frameType == "DATA_BLOCKED") {
+            flowControlLimited.update(true, now);
+          } else if (frameType == "STREAM_DATA_BLOCKED") {
+            // Only the first of the blocked frames sent for the same limit.
+            streamBlockedSince.emplace(getUInt(frame, "stream_id"), now);
+          }
+        }
+      }
+    } else if (type == "PACKET_RECEIVED") {
+      if (auto frames = data.get_ptr("frames")) {
+        for (const auto& frame : *frames) {
+          auto frameType = frame.getDefault("frame_type", "").asString();
+          if (frameType == "MAX_DATA") {
+            flowControlLimited.update(false, now);
+          } else if (frameType == "MAX_STREAM_DATA") {
+            auto id = getUInt(frame, "stream_id");
+            auto itr = streamBlockedSince.find(id);
+            if (itr != streamBlockedSince.end()) {
+              auto blocked = now - itr->second;
+              auto& stream = analysis.blockedStreams[id];
+              ++stream.blockedCount;
+              stream.totalBlocked += blocked;
+              stream.maxBlocked = std::max(stream.maxBlocked, blocked);
+              streamBlockedSince.erase(itr);
+            }
+          }
+        }
+      }
+    } else if (type == "CONGESTION_METRIC_UPDATE") {
+      cwndLimited.update(
+          getUInt(data, "bytes_in_flight") >= getUInt(data, "current_cwnd"),
+          now);
+      if (data.getDefault("congestion_event", "").asString() ==
+          kCongestionLossUndo) {
+        ++analysis.spuriousLossEvents;
+      }
+    } else if (type == "APP_LIMITED_UPDATE") {
+      appLimited.update(
+          data.getDefault("app_limited", "").asString() == kAppLimited, now);
+    } else if (type == "PACKETS_LOST") {
+      ++analysis.lossEvents;
+      analysis.packetsLost += getUInt(data, "lost_packets");
+      analysis.bytesLost += getUInt(data, "lost_bytes");
+    } else if (type == "METRIC_UPDATE") {
+      if (data.get_ptr("latest_rtt")) {
+        rtts.emplace_back(getUInt(data, "latest_rtt"));
+      }
+    } else if (type == "PACING_METRIC_UPDATE") {
+      auto burst = getUInt(data, "pacing_burst_size");
+      ++analysis.pacing.updates;
+      targetBurstTotal += burst;
+      analysis.pacing.maxTargetBurst =
+          std::max(analysis.pacing.maxTargetBurst, burst);
+    } else if (type == "TRANSPORT_SUMMARY") {
+      summaryBytesSent = getUInt(data, "total_bytes_sent");
+      summaryBytesRetransmitted = getUInt(data, "total_bytes_retransmitted");
+    }
+  }
+  endSendBurst();
+
+  auto end = now;
+  analysis.duration = start ? end - *start : std::chrono::microseconds(0);
+  auto duration = double(analysis.duration.count());
+  analysis.cwndLimitedFraction =
+      fraction(cwndLimited.total(end).count(), duration);
+  analysis.appLimitedFraction =
+      fraction(appLimited.total(end).count(), duration);
+  analysis.flowControlLimitedFraction =
+      fraction(flowControlLimited.total(end).count(), duration);
+  // Streams still blocked when the trace ends.
+  for (const auto& blocked : streamBlockedSince) {
+    auto& stream = analysis.blockedStreams[blocked.first];
+    ++stream.blockedCount;
+    stream.totalBlocked += end - blocked.second;
+    stream.maxBlocked = std::max(stream.maxBlocked, end - blocked.second);
+  }
+
+  if (summaryBytesSent && *summaryBytesSent > 0) {
+    analysis.retransmissionRate =
+        fraction(*summaryBytesRetransmitted, *summaryBytesSent);
+  } else {
+    analysis.retransmissionRate =
+        fraction(analysis.bytesLost, analysis.bytesSent);
+  }
+  analysis.lossRate = fraction(analysis.packetsLost, analysis.packetsSent);
+  analysis.spuriousLossRate =
+      fraction(analysis.spuriousLossEvents, analysis.lossEvents);
+
+  if (!rtts.empty()) {
+    std::sort(rtts.begin(), rtts.end());
+    analysis.rtt.samples = rtts.size();
+    analysis.rtt.min = rtts.front();
+    analysis.rtt.p50 = percentile(rtts, 50);
+    analysis.rtt.p90 = percentile(rtts, 90);
+    analysis.rtt.p99 = percentile(rtts, 99);
+    analysis.rtt.max = rtts.back();
+  }
+  analysis.pacing.meanTargetBurst =
+      fraction(targetBurstTotal, analysis.pacing.updates);
+  analysis.pacing.meanSendBurst =
+      fraction(sendBurstTotal, analysis.pacing.sendBursts);
+
+  findAnomalies(analysis, thresholds);
+  return analysis;
+}
+
+folly::dynamic toDynamic(const QLogAnalysis& analysis) {
+  folly::dynamic json = folly::dynamic::object;
+  json["vantage_point"] = analysis.vantagePoint;
+  json["duration_us"] = analysis.duration.count();
+  json["cwnd_limited_fraction"] = analysis.cwndLimitedFraction;
+  json["app_limited_fraction"] = analysis.appLimitedFraction;
+  json["flow_control_limited_fraction"] = analysis.flowControlLimitedFraction;
+  json["packets_sent"] = analysis.packetsSent;
+  json["bytes_sent"] = analysis.bytesSent;
+  json["packets_lost"] = analysis.packetsLost;
+  json["bytes_lost"] = analysis.bytesLost;
+  json["loss_events"] = analysis.lossEvents;
+  json["spurious_loss_events"] = analysis.spuriousLossEvents;
+  json["retransmission_rate"] = analysis.retransmissionRate;
+  json["loss_rate"] = analysis.lossRate;
+  json["spurious_loss_rate"] = analysis.spuriousLossRate;
+  json["rtt_us"] = folly::dynamic::object("samples", analysis.rtt.samples)(
+      "min", analysis.rtt.min.count())("p50", analysis.rtt.p50.count())(
+      "p90", analysis.rtt.p90.count())("p99", analysis.rtt.p99.count())(
+      "max", analysis.rtt.max.count());
+  json["pacing"] = folly::dynamic::object("updates", analysis.pacing.updates)(
+      "mean_target_burst", analysis.pacing.meanTargetBurst)(
+      "max_target_burst", analysis.pacing.maxTargetBurst)(
+      "send_bursts", analysis.pacing.sendBursts)(
+      "mean_send_burst", analysis.pacing.meanSendBurst)(
+      "max_send_burst", analysis.pacing.maxSendBurst);
+  folly::dynamic streams = folly::dynamic::object;
+  for (const auto& stream : analysis.blockedStreams) {
+    streams[folly::to<std::string>(stream.first)] =
+        folly::dynamic::object("blocked_count", stream.second.blockedCount)(
+            "total_blocked_us", stream.second.totalBlocked.count())(
+            "max_blocked_us", stream.second.maxBlocked.count());
+  }
+  json["blocked_streams"] = std::move(streams);
+  folly::dynamic anomalies = folly::dynamic::array;
+  for (const auto& anomaly : analysis.anomalies) {
+    anomalies.push_back(folly::dynamic::object("metric", anomaly.metric)(
+        "value", anomaly.value)("threshold", anomaly.threshold)(
+        "description", anomaly.description));
+  }
+  json["anomalies"] = std::move(anomalies);
+  return json;
+}
+
+} // namespace qlog_analyze
+} // namespace quic
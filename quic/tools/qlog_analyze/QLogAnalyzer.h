@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Expected.h>
+#include <folly/Optional.h>
+#include <folly/dynamic.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace quic {
+namespace qlog_analyze {
+
+struct RttDistribution {
+  uint64_t samples{0};
+  std::chrono::microseconds min{0};
+  std::chrono::microseconds p50{0};
+  std::chrono::microseconds p90{0};
+  std::chrono::microseconds p99{0};
+  std::chrono::microseconds max{0};
+};
+
+struct PacingStats {
+  // From the pacer's own PACING_METRIC_UPDATE events.
+  uint64_t updates{0};
+  double meanTargetBurst{0};
+  uint64_t maxTargetBurst{0};
+  // Packets actually sent at the same timestamp, which is what the peer sees.
+  uint64_t sendBursts{0};
+  double meanSendBurst{0};
+  uint64_t maxSendBurst{0};
+};
+
+/**
+ * How long a stream waited on the peer's flow control, from each
+ * STREAM_DATA_BLOCKED sent until the MAX_STREAM_DATA that lifted it.
+ */
+struct StreamBlocking {
+  uint64_t blockedCount{0};
+  std::chrono::microseconds totalBlocked{0};
+  std::chrono::microseconds maxBlocked{0};
+};
+
+struct Anomaly {
+  std::string metric;
+  double value;
+  double threshold;
+  std::string description;
+};
+
+/**
+ * Limits past which the analyzer reports an anomaly. Fractions are of the
+ * whole trace, rates are of the packets or bytes sent.
+ */
+struct AnalyzerThresholds {
+  double cwndLimitedFraction{0.5};
+  double flowControlLimitedFraction{0.1};
+  double retransmissionRate{0.05};
+  double spuriousLossRate{0.2};
+  // p99 over min RTT.
+  double rttInflation{4.0};
+  uint64_t maxSendBurst{32};
+  std::chrono::microseconds streamBlocked{std::chrono::milliseconds(100)};
+};
+
+struct QLogAnalysis {
+  std::string vantagePoint;
+  std::chrono::microseconds duration{0};
+
+  // Of duration, spent with bytes in flight at the congestion window, with
+  // nothing to send, and blocked on the connection flow control window.
+  double cwndLimitedFraction{0};
+  double appLimitedFraction{0};
+  double flowControlLimitedFraction{0};
+
+  uint64_t packetsSent{0};
+  uint64_t bytesSent{0};
+  uint64_t packetsLost{0};
+  uint64_t bytesLost{0};
+  uint64_t lossEvents{0};
+  uint64_t spuriousLossEvents{0};
+  // Retransmitted bytes over bytes sent, from the transport summary when the
+  // trace has one and from the lost bytes otherwise.
+  double retransmissionRate{0};
+  double lossRate{0};
+  // Losses the congestion controller undid, over all loss events.
+  double spuriousLossRate{0};
+
+  RttDistribution rtt;
+  PacingStats pacing;
+  std::map<uint64_t, StreamBlocking> blockedStreams;
+
+  std::vector<Anomaly> anomalies;
+};
+
+/**
+ * Analyzes the first trace of a qlog in the FileQLogger JSON form, which is
+ * also what convertBinaryQLog() gives for a binary log.
+ */
+folly::Expected<QLogAnalysis, std::string> analyzeQLog(
+    const folly::dynamic& qlog,
+    const AnalyzerThresholds& thresholds = AnalyzerThresholds());
+
+folly::dynamic toDynamic(const QLogAnalysis& analysis);
+
+} // namespace qlog_analyze
+} // namespace quic
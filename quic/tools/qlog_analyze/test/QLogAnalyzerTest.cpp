@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/tools/qlog_analyze/QLogAnalyzer.h>
+
+#include <folly/Conv.h>
+#include <gtest/gtest.h>
+
+namespace quic {
+namespace qlog_analyze {
+namespace test {
+
+class QLogAnalyzerTest : public ::testing::Test {
+ protected:
+  void addEvent(uint64_t time, const char* type, folly::dynamic data) {
+    events_.push_back(folly::dynamic::array(
+        folly::to<std::string>(time), "CATEGORY", type, "DEFAULT", data));
+  }
+
+  void addSent(uint64_t time, folly::dynamic frames = folly::dynamic::array) {
+    addEvent(
+        time,
+        "PACKET_SENT",
+        folly::dynamic::object(
+            "header",
+            folly::dynamic::object("packet_size", 1000)("packet_number", 0))(
+            "frames", frames)("packet_type", "1RTT"));
+  }
+
+  void addReceived(uint64_t time, folly::dynamic frames) {
+    addEvent(
+        time,
+        "PACKET_RECEIVED",
+        folly::dynamic::object(
+            "header",
+            folly::dynamic::object("packet_size", 50)("packet_number", 0))(
+            "frames", frames)("packet_type", "1RTT"));
+  }
+
+  void addCongestion(
+      uint64_t time,
+      uint64_t inflight,
+      uint64_t cwnd,
+      const char* event = "congestion packet ack") {
+    addEvent(
+        time,
+        "CONGESTION_METRIC_UPDATE",
+        folly::dynamic::object("bytes_in_flight", inflight)(
+            "current_cwnd", cwnd)("congestion_event", event)("state", "")(
+            "recovery_state", ""));
+  }
+
+  folly::dynamic qlog() {
+    return folly::dynamic::object(
+        "traces",
+        folly::dynamic::array(folly::dynamic::object(
+            "vantage_point", folly::dynamic::object("type", "server"))(
+            "events", events_)));
+  }
+
+  folly::dynamic events_{folly::dynamic::array};
+};
+
+TEST_F(QLogAnalyzerTest, Errors) {
+  EXPECT_TRUE(analyzeQLog(folly::dynamic::array()).hasError());
+  EXPECT_TRUE(
+      analyzeQLog(folly::dynamic::object("traces", folly::dynamic::array))
+          .hasError());
+  events_.push_back(folly::dynamic::array("1", "CATEGORY"));
+  EXPECT_TRUE(analyzeQLog(qlog()).hasError());
+}
+
+TEST_F(QLogAnalyzerTest, LimitedFractions) {
+  addCongestion(0, 0, 10000);
+  addCongestion(100, 10000, 10000);
+  addCongestion(300, 5000, 10000);
+  addEvent(
+      400,
+      "APP_LIMITED_UPDATE",
+      folly::dynamic::object("app_limited", "app limited"));
+  addEvent(
+      500,
+      "APP_LIMITED_UPDATE",
+      folly::dynamic::object("app_limited", "app unlimited"));
+  addSent(
+      600,
+      folly::dynamic::array(folly::dynamic::object(
+          "frame_type", "DATA_BLOCKED")("data_limit", 1)));
+  addReceived(
+      700,
+      folly::dynamic::array(
+          folly::dynamic::object("frame_type", "MAX_DATA")("maximum_data", 2)));
+  addCongestion(1000, 0, 10000);
+
+  auto analysis = analyzeQLog(qlog());
+  ASSERT_TRUE(analysis.hasValue()) << analysis.error();
+  EXPECT_EQ("server", analysis->vantagePoint);
+  EXPECT_EQ(std::chrono::microseconds(1000), analysis->duration);
+  EXPECT_DOUBLE_EQ(0.2, analysis->cwndLimitedFraction);
+  EXPECT_DOUBLE_EQ(0.1, analysis->appLimitedFraction);
+  EXPECT_DOUBLE_EQ(0.1, analysis->flowControlLimitedFraction);
+}
+
+TEST_F(QLogAnalyzerTest, LossAndRetransmission) {
+  for (int i = 0; i < 10; ++i) {
+    addSent(i * 10);
+  }
+  addEvent(
+      100,
+      "PACKETS_LOST",
+      folly::dynamic::object("largest_lost_packet_num", 3)("lost_bytes", 2000)(
+          "lost_packets", 2));
+  addEvent(
+      110,
+      "PACKETS_LOST",
+      folly::dynamic::object("largest_lost_packet_num", 4)("lost_bytes", 1000)(
+          "lost_packets", 1));
+  addCongestion(120, 0, 10000, "congestion loss undo");
+
+  auto analysis = analyzeQLog(qlog());
+  ASSERT_TRUE(analysis.hasValue());
+  EXPECT_EQ(10, analysis->packetsSent);
+  EXPECT_EQ(3, analysis->packetsLost);
+  EXPECT_DOUBLE_EQ(0.3, analysis->lossRate);
+  // No transport summary, so from the lost bytes.
+  EXPECT_DOUBLE_EQ(0.3, analysis->retransmissionRate);
+  EXPECT_DOUBLE_EQ(0.5, analysis->spuriousLossRate);
+
+  addEvent(
+      200,
+      "TRANSPORT_SUMMARY",
+      folly::dynamic::object("total_bytes_sent", 10000)(
+          "total_bytes_retransmitted", 500));
+  analysis = analyzeQLog(qlog());
+  ASSERT_TRUE(analysis.hasValue());
+  EXPECT_DOUBLE_EQ(0.05, analysis->retransmissionRate);
+}
+
+TEST_F(QLogAnalyzerTest, RttAndPacing) {
+  for (int i = 1; i <= 100; ++i) {
+    addEvent(
+        i,
+        "METRIC_UPDATE",
+        folly::dynamic::object("latest_rtt", i * 1000)("min_rtt", 1000)(
+            "smoothed_rtt", 1000)("ack_delay", 0));
+  }
+  addEvent(
+      200,
+      "PACING_METRIC_UPDATE",
+      folly::dynamic::object("pacing_burst_size", 4)("pacing_interval", 100));
+  addEvent(
+      300,
+      "PACING_METRIC_UPDATE",
+      folly::dynamic::object("pacing_burst_size", 10)("pacing_interval", 100));
+  // Bursts of 3 and 1.
+  addSent(400);
+  addSent(400);
+  addSent(400);
+  addSent(500);
+
+  AnalyzerThresholds thresholds;
+  thresholds.maxSendBurst = 2;
+  auto analysis = analyzeQLog(qlog(), thresholds);
+  ASSERT_TRUE(analysis.hasValue());
+  EXPECT_EQ(100, analysis->rtt.samples);
+  EXPECT_EQ(std::chrono::microseconds(1000), analysis->rtt.min);
+  EXPECT_EQ(std::chrono::microseconds(51000), analysis->rtt.p50);
+  EXPECT_EQ(std::chrono::microseconds(100000), analysis->rtt.p99);
+  EXPECT_EQ(std::chrono::microseconds(100000), analysis->rtt.max);
+  EXPECT_EQ(2, analysis->pacing.updates);
+  EXPECT_DOUBLE_EQ(7, analysis->pacing.meanTargetBurst);
+  EXPECT_EQ(10, analysis->pacing.maxTargetBurst);
+  EXPECT_EQ(2, analysis->pacing.sendBursts);
+  EXPECT_DOUBLE_EQ(2, analysis->pacing.meanSendBurst);
+  EXPECT_EQ(3, analysis->pacing.maxSendBurst);
+
+  std::vector<std::string> metrics;
+  for (const auto& anomaly : analysis->anomalies) {
+    metrics.push_back(anomaly.metric);
+  }
+  EXPECT_EQ(
+      (std::vector<std::string>{"rtt_inflation", "max_send_burst"}), metrics);
+}
+
+TEST_F(QLogAnalyzerTest, StreamBlocking) {
+  auto blocked = [](uint64_t id) {
+    return folly::dynamic::array(folly::dynamic::object(
+        "frame_type", "STREAM_DATA_BLOCKED")("stream_id", id)("data_limit", 1));
+  };
+  auto unblocked = [](uint64_t id) {
+    return folly::dynamic::array(folly::dynamic::object(
+        "frame_type", "MAX_STREAM_DATA")("stream_id", id)("maximum_data", 2));
+  };
+  addSent(0, blocked(4));
+  // Sent again for the same limit.
+  addSent(100, blocked(4));
+  addSent(100, blocked(8));
+  addReceived(1000, unblocked(4));
+  addSent(2000, blocked(4));
+  addReceived(2500, unblocked(4));
+  addSent(300000);
+
+  auto analysis = analyzeQLog(qlog());
+  ASSERT_TRUE(analysis.hasValue());
+  ASSERT_EQ(2, analysis->blockedStreams.size());
+  const auto& stream4 = analysis->blockedStreams.at(4);
+  EXPECT_EQ(2, stream4.blockedCount);
+  EXPECT_EQ(std::chrono::microseconds(1500), stream4.totalBlocked);
+  EXPECT_EQ(std::chrono::microseconds(1000), stream4.maxBlocked);
+  // Never unblocked, so until the end of the trace.
+  const auto& stream8 = analysis->blockedStreams.at(8);
+  EXPECT_EQ(std::chrono::microseconds(299900), stream8.maxBlocked);
+  ASSERT_EQ(1, analysis->anomalies.size());
+  EXPECT_EQ("stream_blocked_us.8", analysis->anomalies[0].metric);
+
+  auto json = toDynamic(*analysis);
+  EXPECT_EQ(299900, json["blocked_streams"]["8"]["max_blocked_us"].asInt());
+  EXPECT_EQ(1, json["anomalies"].size());
+}
+
+} // namespace test
+} // namespace qlog_analyze
+} // namespace quic
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <glog/logging.h>
+
+#include <folly/FileUtil.h>
+#include <folly/init/Init.h>
+#include <folly/json.h>
+#include <folly/portability/GFlags.h>
+
+#include <quic/logging/BinaryQLogConverter.h>
+
+DEFINE_string(input, "", "Binary qlog ring file to convert");
+DEFINE_string(output_dir, ".", "Directory to write one .qlog per connection");
+DEFINE_bool(pretty_json, true, "Write indented JSON");
+
+int main(int argc, char* argv[]) {
+#if FOLLY_HAVE_LIBGFLAGS
+  // Enable glog logging to stderr by default.
+  gflags::SetCommandLineOptionWithMode(
+      "logtostderr", "1", gflags::SET_FLAGS_DEFAULT);
+#endif
+  gflags::ParseCommandLineFlags(&argc, &argv, false);
+  folly::Init init(&argc, &argv);
+
+  std::string contents;
+  if (FLAGS_input.empty() ||
+      !folly::readFile(FLAGS_input.c_str(), contents)) {
+    LOG(ERROR) << "Can't read input file: " << FLAGS_input;
+    return 1;
+  }
+  auto loggers = quic::convertBinaryQLog(folly::ByteRange(
+      reinterpret_cast<const uint8_t*>(contents.data()), contents.size()));
+  size_t unnamed = 0;
+  for (const auto& logger : loggers) {
+    // A connection whose dcid was overwritten is named by its position.
+    auto name = logger->dcid.has_value()
+        ? logger->dcid->hex()
+        : folly::to<std::string>("unknown-", unnamed++);
+    auto path = folly::to<std::string>(FLAGS_output_dir, "/", name, ".qlog");
+    auto json = FLAGS_pretty_json ? folly::toPrettyJson(logger->toDynamic())
+                                  : folly::toJson(logger->toDynamic());
+    if (!folly::writeFile(json, path.c_str())) {
+      LOG(ERROR) << "Can't write to: " << path;
+      return 1;
+    }
+  }
+  LOG(INFO) << "Converted " << loggers.size() << " connections";
+  return 0;
+}
@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/tools/read_replay/ReadReplay.h>
+
+#include <quic/api/QuicTransportFunctions.h>
+#include <quic/codec/QuicPacketBuilder.h>
+#include <quic/codec/QuicReadCodec.h>
+#include <quic/codec/QuicWriteCodec.h>
+#include <quic/fizz/handshake/FizzCryptoFactory.h>
+#include <quic/flowcontrol/QuicFlowController.h>
+#include <quic/logging/QLoggerConstants.h>
+#include <quic/logging/QLoggerTypes.h>
+#include <quic/server/state/ServerStateMachine.h>
+#include <quic/state/AckHandlers.h>
+#include <quic/state/QuicStateFunctions.h>
+#include <quic/state/QuicStreamFunctions.h>
+#include <quic/state/stream/StreamReceiveHandlers.h>
+
+#include <algorithm>
+
+namespace quic {
+namespace read_replay {
+
+namespace {
+constexpr QuicVersion kReplayVersion = QuicVersion::MVFST;
+
+// Where the fields of a qlog event are.
+constexpr size_t kEventTimeField = 0;
+constexpr size_t kEventTypeField = 2;
+constexpr size_t kEventDataField = 4;
+
+std::unique_ptr<QuicServerConnectionState> makeConnection(
+    const std::vector<StreamId>& streams) {
+  auto conn = std::make_unique<QuicServerConnectionState>();
+  // A trace shouldn't fail on the limits of the state it's replayed on.
+  auto& settings = conn->transportSettings;
+  settings.advertisedInitialConnectionWindowSize = kEightByteLimit;
+  settings.advertisedInitialBidiLocalStreamWindowSize = kEightByteLimit;
+  settings.advertisedInitialBidiRemoteStreamWindowSize = kEightByteLimit;
+  settings.advertisedInitialUniStreamWindowSize = kEightByteLimit;
+  settings.advertisedInitialMaxStreamsBidi = kMaxMaxStreams;
+  settings.advertisedInitialMaxStreamsUni = kMaxMaxStreams;
+  updateFlowControlStateWithSettings(conn->flowControlState, settings);
+  conn->streamManager = std::make_unique<QuicStreamManager>(
+      *conn, conn->nodeType, settings);
+  conn->streamManager->setMaxLocalBidirectionalStreams(kMaxMaxStreams);
+  conn->streamManager->setMaxLocalUnidirectionalStreams(kMaxMaxStreams);
+  for (auto id : streams) {
+    if (isLocalStream(conn->nodeType, id)) {
+      conn->streamManager->createStream(id);
+    } else {
+      conn->streamManager->getStream(id);
+    }
+  }
+  return conn;
+}
+
+void handleFrame(
+    QuicServerConnectionState& conn,
+    QuicFrame& quicFrame,
+    PacketNum packetNum,
+    TimePoint receiveTime) {
+  switch (quicFrame.type()) {
+    case QuicFrame::Type::ReadAckFrame_E:
+      processAckFrame(
+          conn,
+          PacketNumberSpace::AppData,
+          *quicFrame.asReadAckFrame(),
+          [](const auto&, const auto&, const auto&) {},
+          [](auto&, auto&, bool, PacketNum) {},
+          receiveTime);
+      break;
+    case QuicFrame::Type::ReadStreamFrame_E: {
+      auto& frame = *quicFrame.asReadStreamFrame();
+      auto stream = conn.streamManager->getStream(frame.streamId);
+      if (stream) {
+        receiveReadStreamFrameSMHandler(*stream, std::move(frame));
+      }
+      break;
+    }
+    case QuicFrame::Type::MaxDataFrame_E:
+      handleConnWindowUpdate(conn, *quicFrame.asMaxDataFrame(), packetNum);
+      break;
+    case QuicFrame::Type::MaxStreamDataFrame_E: {
+      auto& frame = *quicFrame.asMaxStreamDataFrame();
+      auto stream = conn.streamManager->getStream(frame.streamId);
+      if (stream) {
+        handleStreamWindowUpdate(*stream, frame.maximumData, packetNum);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+} // namespace
+
+double ReadReplayStats::nsPerPacket() const {
+  return packets ? double(time.count()) / packets : 0;
+}
+
+double ReadReplayStats::allocationsPerPacket() const {
+  return packets ? double(allocations) / packets : 0;
+}
+
+ReadReplay::ReadReplay()
+    : connId_(std::vector<uint8_t>(kDefaultConnectionIdSize, 0x11)) {}
+
+folly::Expected<ReadReplay, std::string> ReadReplay::fromQLog(
+    const folly::dynamic& qlog) {
+  auto traces = qlog.get_ptr("traces");
+  if (!traces || !traces->isArray() || traces->empty()) {
+    return folly::makeUnexpected(std::string("No trace in the qlog"));
+  }
+  const auto& trace = (*traces)[0];
+  auto vantagePoint = trace.get_ptr("vantage_point");
+  if (!vantagePoint ||
+      vantagePoint->getDefault("type", "").asString() !=
+          kQLogServerVantagePoint) {
+    return folly::makeUnexpected(std::string("Not the qlog of a server"));
+  }
+  auto events = trace.get_ptr("events");
+  if (!events || !events->isArray()) {
+    return folly::makeUnexpected(std::string("No events in the qlog"));
+  }
+
+  ReadReplay replay;
+  FizzCryptoFactory cryptoFactory;
+  auto aead =
+      cryptoFactory.getClientInitialCipher(replay.connId_, kReplayVersion);
+  auto headerCipher = cryptoFactory.makeClientInitialHeaderCipher(
+      replay.connId_, kReplayVersion);
+  auto packetSent = toString(QLogEventType::PacketSent);
+  auto packetReceived = toString(QLogEventType::PacketReceived);
+  for (const auto& event : *events) {
+    if (!event.isArray() || event.size() <= kEventDataField) {
+      continue;
+    }
+    auto type = event[kEventTypeField].asString();
+    bool received = type == packetReceived;
+    if (!received && type != packetSent) {
+      continue;
+    }
+    const auto& data = event[kEventDataField];
+    auto packetType = data.get_ptr("packet_type");
+    auto header = data.get_ptr("header");
+    if (!packetType || packetType->asString() != kShortHeaderPacketType ||
+        !header || !header->get_ptr("packet_number")) {
+      continue;
+    }
+    auto time = std::chrono::microseconds(event[kEventTimeField].asInt());
+    auto packetNum = (PacketNum)(*header)["packet_number"].asInt();
+    auto size = (uint64_t)header->getDefault("packet_size", 0).asInt();
+    if (received) {
+      auto frames = data.getDefault("frames", folly::dynamic::array());
+      replay.addReceivedPacket(
+          time, packetNum, size, frames, *aead, *headerCipher);
+    } else {
+      replay.steps_.push_back(Step{time, packetNum, size, nullptr});
+    }
+  }
+  if (replay.numReceivedPackets() == 0) {
+    return folly::makeUnexpected(
+        std::string("No short header packets received in the qlog"));
+  }
+  std::sort(replay.streams_.begin(), replay.streams_.end());
+  replay.streams_.erase(
+      std::unique(replay.streams_.begin(), replay.streams_.end()),
+      replay.streams_.end());
+  return replay;
+}
+
+void ReadReplay::addReceivedPacket(
+    std::chrono::microseconds time,
+    PacketNum packetNum,
+    uint64_t size,
+    const folly::dynamic& frames,
+    const Aead& aead,
+    const PacketNumberCipher& headerCipher) {
+  uint64_t limit = std::max<uint64_t>(size, kDefaultMaxUDPPayload);
+  RegularQuicPacketBuilder builder(
+      limit,
+      ShortHeader(ProtectionType::KeyPhaseZero, connId_, packetNum),
+      0 /* largestAcked */);
+  builder.setCipherOverhead(aead.getCipherOverhead());
+
+  auto ackType = toString(FrameType::ACK);
+  auto streamType = toString(FrameType::STREAM);
+  auto paddingType = toString(FrameType::PADDING);
+  auto pingType = toString(FrameType::PING);
+  auto maxDataType = toString(FrameType::MAX_DATA);
+  auto maxStreamDataType = toString(FrameType::MAX_STREAM_DATA);
+  for (const auto& frame : frames) {
+    auto type = frame.getDefault("frame_type", "").asString();
+    bool written = false;
+    if (type == ackType && frame.get_ptr("acked_ranges")) {
+      AckBlocks ackBlocks;
+      for (const auto& range : frame["acked_ranges"]) {
+        ackBlocks.insert(range[0].asInt(), range[1].asInt());
+      }
+      if (!ackBlocks.empty()) {
+        AckFrameMetaData meta(
+            ackBlocks,
+            std::chrono::microseconds(frame.getDefault("ack_delay", 0).asInt()),
+            kDefaultAckDelayExponent);
+        written = writeAckFrame(meta, builder).has_value();
+      }
+    } else if (type == streamType && frame.get_ptr("length")) {
+      StreamId id = frame["stream_id"].asInt();
+      uint64_t len = frame["length"].asInt();
+      auto dataLen = writeStreamFrameHeader(
+          builder,
+          id,
+          frame["offset"].asInt(),
+          len,
+          len,
+          frame.getDefault("fin", false).asBool());
+      if (dataLen) {
+        auto data = folly::IOBuf::create(*dataLen);
+        memset(data->writableData(), 0, *dataLen);
+        data->append(*dataLen);
+        writeStreamFrameData(builder, std::move(data), *dataLen);
+        streams_.push_back(id);
+        written = true;
+      }
+    } else if (type == paddingType) {
+      auto numFrames = frame.getDefault("num_frames", 1).asInt();
+      for (int64_t i = 0; i < numFrames; ++i) {
+        writeFrame(PaddingFrame(), builder);
+      }
+      written = true;
+    } else if (type == pingType) {
+      written = writeSimpleFrame(PingFrame(), builder) > 0;
+    } else if (type == maxDataType) {
+      written =
+          writeFrame(MaxDataFrame(frame["maximum_data"].asInt()), builder) > 0;
+    } else if (type == maxStreamDataType) {
+      StreamId id = frame["stream_id"].asInt();
+      written = writeFrame(
+                    MaxStreamDataFrame(id, frame["maximum_data"].asInt()),
+                    builder) > 0;
+      streams_.push_back(id);
+    }
+    if (!written) {
+      ++skippedFrames_;
+    }
+  }
+  // Up to the logged size, and so that there is always enough of a body to
+  // sample the header protection from.
+  uint64_t minSize = std::max<uint64_t>(
+      size,
+      builder.getHeaderBytes() + aead.getCipherOverhead() +
+          kMaxPacketNumEncodingSize);
+  while (builder.remainingSpaceInPkt() > 0 &&
+         limit - builder.remainingSpaceInPkt() < minSize) {
+    writeFrame(PaddingFrame(), builder);
+  }
+
+  auto packet = std::move(builder).buildPacket();
+  auto packetBuf = packet.header->clone();
+  packetBuf->coalesce();
+  auto body = packet.body ? packet.body->clone() : folly::IOBuf::create(0);
+  auto encryptedBody =
+      aead.encrypt(std::move(body), packetBuf.get(), packetNum);
+  encryptedBody->coalesce();
+  encryptPacketHeader(
+      HeaderForm::Short,
+      packetBuf->writableData(),
+      packetBuf->length(),
+      encryptedBody->data(),
+      encryptedBody->length(),
+      headerCipher);
+  packetBuf->prependChain(std::move(encryptedBody));
+  packetBuf->coalesce();
+  steps_.push_back(Step{time, packetNum, size, std::move(packetBuf)});
+}
+
+size_t ReadReplay::numReceivedPackets() const {
+  return std::count_if(steps_.begin(), steps_.end(), [](const auto& step) {
+    return step.packet != nullptr;
+  });
+}
+
+ReadReplayStats ReadReplay::replay(AllocationCounter countAllocations) const {
+  auto conn = makeConnection(streams_);
+  FizzCryptoFactory cryptoFactory;
+  QuicReadCodec codec(QuicNodeType::Server);
+  codec.setOneRttReadCipher(
+      cryptoFactory.getClientInitialCipher(connId_, kReplayVersion));
+  codec.setOneRttHeaderCipher(
+      cryptoFactory.makeClientInitialHeaderCipher(connId_, kReplayVersion));
+  codec.setServerConnectionId(connId_);
+
+  ReadReplayStats stats;
+  auto start = Clock::now();
+  for (const auto& step : steps_) {
+    auto time = start + step.time;
+    if (!step.packet) {
+      // The bookkeeping updateConnection does, for the acks to find.
+      RegularQuicWritePacket packet(
+          ShortHeader(ProtectionType::KeyPhaseZero, connId_, step.packetNum));
+      conn->lossState.largestSent =
+          std::max(conn->lossState.largestSent, step.packetNum);
+      conn->lossState.totalBytesSent += step.size;
+      conn->outstandingPackets.emplace_back(
+          std::move(packet),
+          time,
+          step.size,
+          false,
+          conn->lossState.totalBytesSent);
+      conn->congestionController->onPacketSent(
+          conn->outstandingPackets.back());
+      continue;
+    }
+    BufQueue queue(
+        folly::IOBuf::copyBuffer(step.packet->data(), step.packet->length()));
+    auto allocationsBefore = countAllocations ? countAllocations() : 0;
+    auto readStart = Clock::now();
+    try {
+      auto result = codec.parsePacket(queue, conn->ackStates);
+      auto regularPacket = result.regularPacket();
+      if (!regularPacket) {
+        ++stats.failures;
+      } else {
+        auto packetNum = regularPacket->header.getPacketSequenceNum();
+        auto& ackState = getAckState(*conn, PacketNumberSpace::AppData);
+        if (!isDuplicatePacket(ackState, packetNum)) {
+          updateLargestReceivedPacketNum(ackState, packetNum, time);
+          for (auto& frame : regularPacket->frames) {
+            handleFrame(*conn, frame, packetNum, time);
+          }
+        }
+        stats.frames += regularPacket->frames.size();
+        codec.recycleFrames(std::move(regularPacket->frames));
+      }
+    } catch (const std::exception& ex) {
+      VLOG(4) << "Replay of packet=" << step.packetNum
+              << " failed: " << ex.what();
+      ++stats.failures;
+    }
+    stats.time += Clock::now() - readStart;
+    if (countAllocations) {
+      stats.allocations += countAllocations() - allocationsBefore;
+    }
+    ++stats.packets;
+    stats.bytes += step.packet->length();
+
+    // What the application would read, so that it doesn't pile up.
+    for (auto id : streams_) {
+      auto stream = conn->streamManager->findStream(id);
+      if (stream && !stream->readBuffer.empty()) {
+        readDataFromQuicStream(*stream);
+      }
+    }
+  }
+  return stats;
+}
+
+} // namespace read_replay
+} // namespace quic
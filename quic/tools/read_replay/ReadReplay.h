@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Expected.h>
+#include <folly/dynamic.h>
+
+#include <quic/QuicConstants.h>
+#include <quic/codec/QuicConnectionId.h>
+#include <quic/codec/Types.h>
+
+#include <string>
+#include <vector>
+
+namespace quic {
+
+class Aead;
+class PacketNumberCipher;
+
+namespace read_replay {
+
+struct ReadReplayStats {
+  uint64_t packets{0};
+  uint64_t bytes{0};
+  uint64_t frames{0};
+  // Packets the codec couldn't parse or a handler threw on.
+  uint64_t failures{0};
+  // Spent parsing and handling the packets, not setting them up.
+  std::chrono::nanoseconds time{0};
+  uint64_t allocations{0};
+
+  double nsPerPacket() const;
+  double allocationsPerPacket() const;
+};
+
+/**
+ * Returns the number of allocations made so far, for the replay to tell how
+ * many it makes.
+ */
+using AllocationCounter = uint64_t (*)();
+
+/**
+ * The received packets of a connection, rebuilt from its qlog, to benchmark
+ * the read path with: the codec, the ack handling and the stream frame
+ * handlers, in the order the connection got the packets. Replays run the
+ * same on a new connection state every time.
+ *
+ * The qlog doesn't have the payloads, so the packets are encoded again from
+ * the frames logged for them, with stream data of zeros, and padded to the
+ * logged size. They are encrypted with AES-GCM keys like the initial ones.
+ * Frames other than acks, stream frames, padding, pings and flow control
+ * updates are left out, and so are those of compact packet events, which
+ * don't log enough to encode them.
+ */
+class ReadReplay {
+ public:
+  /**
+   * Loads the short header packets of the qlog of a server, in the JSON
+   * FileQLogger::toDynamic() returns.
+   */
+  static folly::Expected<ReadReplay, std::string> fromQLog(
+      const folly::dynamic& qlog);
+
+  size_t numReceivedPackets() const;
+
+  // Logged frames that were left out of the packets.
+  uint64_t skippedFrames() const {
+    return skippedFrames_;
+  }
+
+  /**
+   * Reads all the packets once. Counts the allocations with countAllocations
+   * if it's set.
+   */
+  ReadReplayStats replay(AllocationCounter countAllocations = nullptr) const;
+
+ private:
+  ReadReplay();
+
+  void addReceivedPacket(
+      std::chrono::microseconds time,
+      PacketNum packetNum,
+      uint64_t size,
+      const folly::dynamic& frames,
+      const Aead& aead,
+      const PacketNumberCipher& headerCipher);
+
+  struct Step {
+    std::chrono::microseconds time;
+    PacketNum packetNum;
+    uint64_t size;
+    // Encrypted packet, only for received packets.
+    Buf packet;
+  };
+
+  ConnectionId connId_;
+  std::vector<Step> steps_;
+  std::vector<StreamId> streams_;
+  uint64_t skippedFrames_{0};
+};
+
+} // namespace read_replay
+} // namespace quic
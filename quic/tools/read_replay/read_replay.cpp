@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <glog/logging.h>
+
+#include <folly/FileUtil.h>
+#include <folly/init/Init.h>
+#include <folly/json.h>
+#include <folly/portability/GFlags.h>
+
+#include <quic/logging/BinaryQLogConverter.h>
+#include <quic/tools/read_replay/ReadReplay.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+DEFINE_string(input, "", "qlog of a server connection to replay");
+DEFINE_bool(
+    binary,
+    false,
+    "The input is a binary qlog ring instead of a JSON qlog");
+DEFINE_uint32(
+    connection,
+    0,
+    "Which connection of the binary qlog ring to replay, in ring order");
+DEFINE_uint32(iterations, 100, "Times to replay the received packets");
+
+namespace {
+std::atomic<uint64_t> allocations{0};
+
+uint64_t countAllocations() {
+  return allocations.load(std::memory_order_relaxed);
+}
+} // namespace
+
+// Counts the allocations of the whole process, the replay only takes the
+// difference across the packets it reads.
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+using namespace quic;
+using namespace quic::read_replay;
+
+int main(int argc, char* argv[]) {
+#if FOLLY_HAVE_LIBGFLAGS
+  // Enable glog logging to stderr by default.
+  gflags::SetCommandLineOptionWithMode(
+      "logtostderr", "1", gflags::SET_FLAGS_DEFAULT);
+#endif
+  gflags::ParseCommandLineFlags(&argc, &argv, false);
+  folly::Init init(&argc, &argv);
+
+  std::string contents;
+  if (FLAGS_input.empty() ||
+      !folly::readFile(FLAGS_input.c_str(), contents)) {
+    LOG(ERROR) << "Can't read input file: " << FLAGS_input;
+    return 1;
+  }
+  folly::dynamic qlog;
+  if (FLAGS_binary) {
+    auto loggers = convertBinaryQLog(folly::ByteRange(
+        reinterpret_cast<const uint8_t*>(contents.data()), contents.size()));
+    if (FLAGS_connection >= loggers.size()) {
+      LOG(ERROR) << "The ring has " << loggers.size() << " connections";
+      return 1;
+    }
+    qlog = loggers[FLAGS_connection]->toDynamic();
+  } else {
+    qlog = folly::parseJson(contents);
+  }
+
+  auto replay = ReadReplay::fromQLog(qlog);
+  if (replay.hasError()) {
+    LOG(ERROR) << "Can't replay " << FLAGS_input << ": " << replay.error();
+    return 1;
+  }
+  LOG(INFO) << "Replaying " << replay->numReceivedPackets() << " packets, "
+            << replay->skippedFrames() << " frames left out";
+
+  ReadReplayStats total;
+  for (uint32_t i = 0; i < FLAGS_iterations; ++i) {
+    auto stats = replay->replay(&countAllocations);
+    total.packets += stats.packets;
+    total.bytes += stats.bytes;
+    total.frames += stats.frames;
+    total.failures += stats.failures;
+    total.time += stats.time;
+    total.allocations += stats.allocations;
+  }
+  LOG(INFO) << "packets=" << total.packets << " frames=" << total.frames
+            << " failures=" << total.failures;
+  LOG(INFO) << "ns/packet=" << total.nsPerPacket()
+            << " allocations/packet=" << total.allocationsPerPacket()
+            << " MB/s="
+            << (total.time.count() ? total.bytes * 1000.0 / total.time.count()
+                                   : 0);
+  return 0;
+}
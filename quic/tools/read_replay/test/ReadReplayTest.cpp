@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/tools/read_replay/ReadReplay.h>
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+namespace quic {
+namespace read_replay {
+namespace test {
+
+folly::dynamic packetEvent(
+    uint64_t time,
+    folly::StringPiece eventType,
+    folly::StringPiece packetType,
+    PacketNum packetNum,
+    folly::dynamic frames = folly::dynamic::array()) {
+  folly::dynamic data = folly::dynamic::object(
+      "header",
+      folly::dynamic::object("packet_size", 1000)("packet_number", packetNum))(
+      "frames", std::move(frames))("packet_type", packetType);
+  return folly::dynamic::array(
+      folly::to<std::string>(time),
+      "TRANSPORT",
+      eventType,
+      "DEFAULT",
+      std::move(data));
+}
+
+folly::dynamic makeQLog(folly::StringPiece vantagePoint) {
+  auto events = folly::dynamic::array(
+      packetEvent(0, "PACKET_RECEIVED", "INITIAL", 0),
+      packetEvent(100, "PACKET_SENT", "1RTT", 0),
+      packetEvent(200, "PACKET_SENT", "1RTT", 1),
+      packetEvent(
+          300,
+          "PACKET_RECEIVED",
+          "1RTT",
+          0,
+          folly::dynamic::array(
+              folly::dynamic::object("frame_type", "STREAM")("stream_id", "0")(
+                  "offset", 0)("length", 100)("fin", false),
+              folly::dynamic::object("frame_type", "ACK")(
+                  "acked_ranges", folly::dynamic::array(folly::dynamic::array(
+                                      0, 0)))("ack_delay", 25))),
+      packetEvent(400, "PACKET_SENT", "1RTT", 2),
+      packetEvent(
+          500,
+          "PACKET_RECEIVED",
+          "1RTT",
+          1,
+          folly::dynamic::array(
+              folly::dynamic::object("frame_type", "ACK")(
+                  "acked_ranges", folly::dynamic::array(folly::dynamic::array(
+                                      1, 2)))("ack_delay", 25),
+              folly::dynamic::object("frame_type", "MAX_DATA")(
+                  "maximum_data", 100000),
+              // Compact events only log the frame types.
+              folly::dynamic::object("frame_type", "CRYPTO_FRAME"))));
+  folly::dynamic trace = folly::dynamic::object(
+      "vantage_point", folly::dynamic::object("type", vantagePoint))(
+      "events", std::move(events));
+  return folly::dynamic::object("traces", folly::dynamic::array(trace));
+}
+
+TEST(ReadReplayTest, LoadsShortHeaderPackets) {
+  auto replay = ReadReplay::fromQLog(makeQLog("server"));
+  ASSERT_TRUE(replay.hasValue()) << replay.error();
+  EXPECT_EQ(2, replay->numReceivedPackets());
+  EXPECT_EQ(1, replay->skippedFrames());
+}
+
+TEST(ReadReplayTest, OnlyServerQLogs) {
+  EXPECT_TRUE(ReadReplay::fromQLog(makeQLog("client")).hasError());
+  EXPECT_TRUE(ReadReplay::fromQLog(folly::dynamic::object).hasError());
+}
+
+TEST(ReadReplayTest, ReplaysAllPackets) {
+  auto replay = ReadReplay::fromQLog(makeQLog("server"));
+  ASSERT_TRUE(replay.hasValue()) << replay.error();
+  auto stats = replay->replay();
+  EXPECT_EQ(2, stats.packets);
+  EXPECT_EQ(0, stats.failures);
+  EXPECT_EQ(2000, stats.bytes);
+  // The padding comes back as one frame per packet.
+  EXPECT_EQ(5, stats.frames);
+  EXPECT_GT(stats.nsPerPacket(), 0);
+
+  // Every replay starts over.
+  auto again = replay->replay();
+  EXPECT_EQ(stats.packets, again.packets);
+  EXPECT_EQ(stats.frames, again.frames);
+  EXPECT_EQ(0, again.failures);
+}
+
+TEST(ReadReplayTest, CountsAllocationsPerPacket) {
+  auto replay = ReadReplay::fromQLog(makeQLog("server"));
+  ASSERT_TRUE(replay.hasValue()) << replay.error();
+  // Goes up by one each time it's asked, once on each side of a packet.
+  static uint64_t calls;
+  calls = 0;
+  auto stats = replay->replay([]() -> uint64_t { return calls++; });
+  EXPECT_EQ(2, stats.allocations);
+  EXPECT_EQ(1, stats.allocationsPerPacket());
+  EXPECT_EQ(0, ReadReplayStats().allocationsPerPacket());
+}
+
+} // namespace test
+} // namespace read_replay
+} // namespace quic
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/io/Cursor.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/AsyncUDPSocket.h>
+#include <quic/server/QuicUDPSocketFactory.h>
+#include <quic/tools/tperf/NetworkImpairment.h>
+
+#include <atomic>
+#include <map>
+
+namespace quic {
+namespace tperf {
+
+/**
+ * A socket whose sends go through a NetworkImpairment: they are dropped, or
+ * written to the real socket when the impairment says they arrive. Each GSO
+ * segment is a packet of its own. Only sends are impaired, so both ends of a
+ * connection need one to impair both directions.
+ */
+class ImpairedUDPSocket : public folly::AsyncUDPSocket {
+ public:
+  ImpairedUDPSocket(
+      folly::EventBase* evb,
+      const NetworkImpairmentConfig& config)
+      : folly::AsyncUDPSocket(evb),
+        impairment_(config),
+        sendTimeout_(*this, evb) {}
+
+  ~ImpairedUDPSocket() override {
+    sendTimeout_.cancelTimeout();
+  }
+
+  ssize_t write(
+      const folly::SocketAddress& address,
+      const std::unique_ptr<folly::IOBuf>& buf) override {
+    auto len = buf->computeChainDataLength();
+    impair(address, buf->clone(), len);
+    return len;
+  }
+
+  ssize_t writeGSO(
+      const folly::SocketAddress& address,
+      const std::unique_ptr<folly::IOBuf>& buf,
+      int gso) override {
+    if (gso <= 0) {
+      return write(address, buf);
+    }
+    auto len = buf->computeChainDataLength();
+    folly::io::Cursor cursor(buf.get());
+    while (!cursor.isAtEnd()) {
+      auto segmentLen = std::min<size_t>(gso, cursor.totalLength());
+      std::unique_ptr<folly::IOBuf> segment;
+      cursor.clone(segment, segmentLen);
+      impair(address, std::move(segment), segmentLen);
+    }
+    return len;
+  }
+
+  int writem(
+      const folly::SocketAddress& address,
+      const std::unique_ptr<folly::IOBuf>* bufs,
+      size_t count) override {
+    for (size_t i = 0; i < count; ++i) {
+      write(address, bufs[i]);
+    }
+    return count;
+  }
+
+  int writemGSO(
+      const folly::SocketAddress& address,
+      const std::unique_ptr<folly::IOBuf>* bufs,
+      size_t count,
+      const int* gso) override {
+    for (size_t i = 0; i < count; ++i) {
+      writeGSO(address, bufs[i], gso ? gso[i] : 0);
+    }
+    return count;
+  }
+
+ private:
+  class SendTimeout : public folly::AsyncTimeout {
+   public:
+    SendTimeout(ImpairedUDPSocket& socket, folly::EventBase* evb)
+        : folly::AsyncTimeout(evb), socket_(socket) {}
+
+    void timeoutExpired() noexcept override {
+      socket_.sendArrived();
+    }
+
+   private:
+    ImpairedUDPSocket& socket_;
+  };
+
+  struct PendingPacket {
+    folly::SocketAddress address;
+    std::unique_ptr<folly::IOBuf> buf;
+  };
+
+  void impair(
+      const folly::SocketAddress& address,
+      std::unique_ptr<folly::IOBuf> buf,
+      size_t len) {
+    auto arrival = impairment_.onPacket(Clock::now(), len);
+    if (!arrival) {
+      VLOG(10) << "Impairment dropped packet of size=" << len;
+      return;
+    }
+    bool first = pending_.empty() || *arrival < pending_.begin()->first;
+    pending_.emplace(*arrival, PendingPacket{address, std::move(buf)});
+    if (first) {
+      scheduleSend();
+    }
+  }
+
+  void sendArrived() {
+    auto now = Clock::now();
+    while (!pending_.empty() && pending_.begin()->first <= now) {
+      auto& packet = pending_.begin()->second;
+      // AsyncUDPSocket::write() goes through the virtual writeGSO().
+      folly::AsyncUDPSocket::writeGSO(packet.address, packet.buf, 0);
+      pending_.erase(pending_.begin());
+    }
+    if (!pending_.empty()) {
+      scheduleSend();
+    }
+  }
+
+  void scheduleSend() {
+    auto wait = std::chrono::duration_cast<std::chrono::microseconds>(
+        pending_.begin()->first - Clock::now());
+    sendTimeout_.cancelTimeout();
+    sendTimeout_.scheduleTimeoutHighRes(
+        std::max(wait, std::chrono::microseconds(0)));
+  }
+
+  NetworkImpairment impairment_;
+  // By arrival time, in the order they were sent for equal times.
+  std::multimap<TimePoint, PendingPacket> pending_;
+  SendTimeout sendTimeout_;
+};
+
+/**
+ * Makes ImpairedUDPSockets, set up the way QuicSharedUDPSocketFactory sets
+ * up its sockets. Each socket gets the seed of the config plus the number of
+ * sockets made before it, so a run is reproducible for the same sequence of
+ * sockets.
+ */
+class ImpairedUDPSocketFactory : public QuicUDPSocketFactory {
+ public:
+  explicit ImpairedUDPSocketFactory(const NetworkImpairmentConfig& config)
+      : config_(config) {}
+
+  ~ImpairedUDPSocketFactory() override = default;
+
+  std::unique_ptr<folly::AsyncUDPSocket> make(folly::EventBase* evb, int fd)
+      override {
+    auto config = config_;
+    config.seed += numSockets_++;
+    auto sock = std::make_unique<ImpairedUDPSocket>(evb, config);
+    if (fd != -1) {
+      sock->setFD(
+          folly::NetworkSocket::fromFd(fd),
+          folly::AsyncUDPSocket::FDOwnership::SHARED);
+      sock->setDFAndTurnOffPMTU();
+    }
+    return sock;
+  }
+
+ private:
+  NetworkImpairmentConfig config_;
+  std::atomic<uint64_t> numSockets_{0};
+};
+} // namespace tperf
+} // namespace quic
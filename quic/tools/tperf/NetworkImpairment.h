@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#pragma once
+
+#include <folly/Optional.h>
+#include <quic/QuicConstants.h>
+
+#include <algorithm>
+#include <random>
+
+namespace quic {
+namespace tperf {
+
+struct NetworkImpairmentConfig {
+  // One way delay added to every packet.
+  std::chrono::microseconds delay{0};
+  // Up to this much is added to or taken off the delay of a packet. Packets
+  // stay in order unless they are reordered below.
+  std::chrono::microseconds jitter{0};
+  // Probability that a packet is lost, when the Gilbert-Elliott model below
+  // is off.
+  double lossRate{0};
+  // Gilbert-Elliott model, on when geGoodToBad is set. A packet first moves
+  // the channel between the good and the bad state with the probabilities
+  // below, then is lost with the loss rate of the state.
+  double geGoodToBad{0};
+  double geBadToGood{0};
+  double geLossGood{0};
+  double geLossBad{1};
+  // Probability that a packet is held back by reorderDelay, letting the
+  // packets after it overtake it.
+  double reorderRate{0};
+  std::chrono::microseconds reorderDelay{0};
+  // Bytes a second the link carries, 0 for no limit.
+  uint64_t bandwidth{0};
+  // Packets that would wait longer than this for the link are dropped.
+  std::chrono::microseconds maxQueueDelay{100ms};
+  uint64_t seed{0};
+
+  bool enabled() const {
+    return delay.count() > 0 || jitter.count() > 0 || lossRate > 0 ||
+        geGoodToBad > 0 || reorderRate > 0 || bandwidth > 0;
+  }
+};
+
+/**
+ * Decides the fate of each packet sent on an emulated link: when it gets to
+ * the other end, or that it is dropped. The decisions only depend on the seed
+ * and on the sizes and send times of the packets.
+ */
+class NetworkImpairment {
+ public:
+  explicit NetworkImpairment(const NetworkImpairmentConfig& config)
+      : config_(config), rng_(config.seed) {}
+
+  /**
+   * When a packet of size bytes sent at now arrives, or none if it is lost.
+   */
+  folly::Optional<TimePoint> onPacket(TimePoint now, size_t size) {
+    if (isLost()) {
+      return folly::none;
+    }
+    auto departure = now;
+    if (config_.bandwidth > 0) {
+      departure = std::max(now, linkFreeTime_);
+      if (departure - now > config_.maxQueueDelay) {
+        return folly::none;
+      }
+      linkFreeTime_ = departure +
+          std::chrono::microseconds(size * 1000000 / config_.bandwidth);
+      departure = linkFreeTime_;
+    }
+    auto delay = config_.delay;
+    if (config_.jitter.count() > 0) {
+      delay += std::chrono::microseconds(
+          std::uniform_int_distribution<int64_t>(
+              -config_.jitter.count(), config_.jitter.count())(rng_));
+      delay = std::max(delay, std::chrono::microseconds(0));
+    }
+    auto arrival = departure + delay;
+    if (chance(config_.reorderRate)) {
+      return arrival + config_.reorderDelay;
+    }
+    arrival = std::max(arrival, lastArrival_);
+    lastArrival_ = arrival;
+    return arrival;
+  }
+
+ private:
+  bool chance(double probability) {
+    return probability > 0 &&
+        std::uniform_real_distribution<double>(0, 1)(rng_) < probability;
+  }
+
+  bool isLost() {
+    if (config_.geGoodToBad > 0) {
+      if (badState_) {
+        badState_ = !chance(config_.geBadToGood);
+      } else {
+        badState_ = chance(config_.geGoodToBad);
+      }
+      return chance(badState_ ? config_.geLossBad : config_.geLossGood);
+    }
+    return chance(config_.lossRate);
+  }
+
+  NetworkImpairmentConfig config_;
+  std::mt19937_64 rng_;
+  bool badState_{false};
+  TimePoint linkFreeTime_;
+  TimePoint lastArrival_;
+};
+} // namespace tperf
+} // namespace quic
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ *
+ */
+
+#include <quic/tools/tperf/NetworkImpairment.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace testing;
+
+namespace quic::tperf::test {
+
+std::vector<folly::Optional<TimePoint>> runPackets(
+    const NetworkImpairmentConfig& config,
+    TimePoint start,
+    size_t numPackets) {
+  NetworkImpairment impairment(config);
+  std::vector<folly::Optional<TimePoint>> arrivals;
+  for (size_t i = 0; i < numPackets; ++i) {
+    arrivals.push_back(
+        impairment.onPacket(start + std::chrono::microseconds(i * 100), 1000));
+  }
+  return arrivals;
+}
+
+TEST(NetworkImpairmentTest, Disabled) {
+  NetworkImpairmentConfig config;
+  EXPECT_FALSE(config.enabled());
+  auto now = Clock::now();
+  NetworkImpairment impairment(config);
+  EXPECT_EQ(now, impairment.onPacket(now, 1000));
+}
+
+TEST(NetworkImpairmentTest, SameSeedSameDecisions) {
+  NetworkImpairmentConfig config;
+  config.lossRate = 0.2;
+  config.delay = 10ms;
+  config.jitter = 5ms;
+  config.reorderRate = 0.1;
+  config.reorderDelay = 20ms;
+  config.seed = 7;
+  auto start = Clock::now();
+  EXPECT_EQ(runPackets(config, start, 1000), runPackets(config, start, 1000));
+  auto other = config;
+  other.seed = 8;
+  EXPECT_NE(runPackets(config, start, 1000), runPackets(other, start, 1000));
+}
+
+TEST(NetworkImpairmentTest, LossRate) {
+  NetworkImpairmentConfig config;
+  config.lossRate = 0.1;
+  auto arrivals = runPackets(config, Clock::now(), 10000);
+  auto lost = std::count(arrivals.begin(), arrivals.end(), folly::none);
+  EXPECT_GT(lost, 800);
+  EXPECT_LT(lost, 1200);
+}
+
+TEST(NetworkImpairmentTest, GilbertElliottBursts) {
+  NetworkImpairmentConfig config;
+  config.geGoodToBad = 0.01;
+  config.geBadToGood = 0.25;
+  auto arrivals = runPackets(config, Clock::now(), 10000);
+  size_t lost = 0;
+  size_t bursts = 0;
+  for (size_t i = 0; i < arrivals.size(); ++i) {
+    if (!arrivals[i]) {
+      lost++;
+      if (i == 0 || arrivals[i - 1]) {
+        bursts++;
+      }
+    }
+  }
+  ASSERT_GT(bursts, 0);
+  // Bad states last 4 packets on average, and lose all of them.
+  EXPECT_GT(double(lost) / bursts, 2.5);
+}
+
+TEST(NetworkImpairmentTest, BandwidthSpacing) {
+  NetworkImpairmentConfig config;
+  // 1000 byte packets take 1ms each.
+  config.bandwidth = 1000 * 1000;
+  config.maxQueueDelay = 5ms;
+  NetworkImpairment impairment(config);
+  auto now = Clock::now();
+  for (int i = 1; i <= 6; ++i) {
+    EXPECT_EQ(
+        now + std::chrono::milliseconds(i), impairment.onPacket(now, 1000));
+  }
+  // The queue is full.
+  EXPECT_EQ(folly::none, impairment.onPacket(now, 1000));
+  EXPECT_EQ(now + 7ms, impairment.onPacket(now + 2ms, 1000));
+}
+
+TEST(NetworkImpairmentTest, JitterKeepsOrder) {
+  NetworkImpairmentConfig config;
+  config.delay = 10ms;
+  config.jitter = 5ms;
+  auto start = Clock::now();
+  auto arrivals = runPackets(config, start, 1000);
+  for (size_t i = 0; i < arrivals.size(); ++i) {
+    ASSERT_TRUE(arrivals[i].has_value());
+    EXPECT_GE(*arrivals[i], start + std::chrono::microseconds(i * 100) + 5ms);
+    if (i > 0) {
+      EXPECT_GE(*arrivals[i], *arrivals[i - 1]);
+    }
+  }
+}
+
+TEST(NetworkImpairmentTest, Reorder) {
+  NetworkImpairmentConfig config;
+  config.delay = 1ms;
+  config.reorderRate = 0.1;
+  config.reorderDelay = 10ms;
+  auto arrivals = runPackets(config, Clock::now(), 1000);
+  size_t overtaken = 0;
+  for (size_t i = 1; i < arrivals.size(); ++i) {
+    ASSERT_TRUE(arrivals[i].has_value());
+    if (*arrivals[i] < *arrivals[i - 1]) {
+      overtaken++;
+    }
+  }
+  EXPECT_GT(overtaken, 50);
+  EXPECT_LT(overtaken, 150);
+}
+
+} // namespace quic::tperf::test
@@ -10,17 +10,26 @@
 
 #include <fizz/crypto/Utils.h>
 #include <folly/init/Init.h>
+#include <folly/io/Cursor.h>
 #include <folly/io/async/HHWheelTimer.h>
+#include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/lang/Assume.h>
 #include <folly/portability/GFlags.h>
 #include <folly/stats/Histogram.h>
 
+#include <random>
+#include <thread>
+
 #include <quic/client/QuicClientTransport.h>
+#include <quic/common/BufUtil.h>
 #include <quic/common/test/TestUtils.h>
 #include <quic/congestion_control/CongestionControllerFactory.h>
 #include <quic/fizz/client/handshake/FizzClientQuicHandshakeContext.h>
 #include <quic/server/QuicServer.h>
 #include <quic/server/QuicServerTransport.h>
 #include <quic/server/QuicSharedUDPSocketFactory.h>
+#include <quic/tools/tperf/ImpairedUDPSocket.h>
 #include <quic/tools/tperf/PacingObserver.h>
 #include <quic/tools/tperf/TperfQLogger.h>
 
@@ -34,8 +43,17 @@ DEFINE_uint64(
     "Amount of data written to stream each iteration");
 DEFINE_uint64(writes_per_loop, 5, "Amount of socket writes per event loop");
 DEFINE_uint64(window, 64 * 1024, "Flow control window size");
-DEFINE_string(congestion, "newreno", "newreno/cubic/bbr/none");
+DEFINE_string(congestion, "newreno", "newreno/cubic/bbr/bbr2/none");
 DEFINE_bool(pacing, false, "Enable pacing");
+DEFINE_bool(
+    pacing_txtime,
+    false,
+    "Pace with SCM_TXTIME departure times instead of the pacing timer "
+    "(server only, needs the fq qdisc)");
+DEFINE_bool(
+    pacing_scheduler,
+    false,
+    "Pace all the connections of a server worker from one shared scheduler");
 DEFINE_bool(gso, false, "Enable GSO writes to the socket");
 DEFINE_uint32(
     client_transport_timer_resolution_ms,
@@ -66,10 +84,101 @@ DEFINE_uint32(
         quic::kDefaultV4UDPSendPacketLen,
         quic::kDefaultV6UDPSendPacketLen),
     "Maximum packet size to advertise to the peer.");
+DEFINE_string(
+    workload,
+    "bulk",
+    "bulk/requests: bulk has the server send on num_streams streams for the "
+    "whole test. requests has the clients send requests on bidirectional "
+    "streams, one at a time per connection, and the server respond to them. "
+    "The client and the server must use the same workload.");
+DEFINE_uint32(
+    client_connections,
+    1,
+    "Number of client connections to make with the requests workload");
+DEFINE_uint32(
+    client_threads,
+    1,
+    "Number of threads to spread the client connections over");
+DEFINE_double(
+    connection_rate,
+    0,
+    "New client connections per second. 0 makes them all at once.");
+DEFINE_uint64(
+    requests_per_connection,
+    0,
+    "Number of requests a client connection makes before it closes. "
+    "0 keeps making requests for the whole duration of the test.");
+DEFINE_string(
+    request_size,
+    "64",
+    "Request size in bytes: N, uniform:MIN-MAX or exp:MEAN. "
+    "Requests are at least 8 bytes.");
+DEFINE_string(
+    response_size,
+    "4096",
+    "Response size in bytes: N, uniform:MIN-MAX or exp:MEAN");
+// The impairments apply to the packets this end sends. Give the same ones to
+// the client and the server to impair both directions.
+DEFINE_uint32(impair_delay_ms, 0, "One way delay added to sent packets");
+DEFINE_uint32(impair_jitter_ms, 0, "Random +/- variation of the delay");
+DEFINE_double(impair_loss, 0, "Probability that a sent packet is lost");
+DEFINE_double(
+    impair_ge_good_to_bad,
+    0,
+    "Gilbert-Elliott loss: probability to move from the good state to the "
+    "bad one. Setting it replaces impair_loss.");
+DEFINE_double(
+    impair_ge_bad_to_good,
+    0,
+    "Gilbert-Elliott loss: probability to move from the bad state to the "
+    "good one");
+DEFINE_double(
+    impair_ge_loss_good,
+    0,
+    "Gilbert-Elliott loss: loss probability in the good state");
+DEFINE_double(
+    impair_ge_loss_bad,
+    1,
+    "Gilbert-Elliott loss: loss probability in the bad state");
+DEFINE_double(
+    impair_reorder,
+    0,
+    "Probability that a sent packet is held back by impair_reorder_delay_ms");
+DEFINE_uint32(impair_reorder_delay_ms, 10, "Delay of reordered packets");
+DEFINE_double(
+    impair_bandwidth_mbps,
+    0,
+    "Bandwidth of the emulated link in Mb/s, 0 for no limit");
+DEFINE_uint32(
+    impair_max_queue_delay_ms,
+    100,
+    "Packets that would queue longer than this for the link are dropped");
+DEFINE_uint64(
+    impair_seed,
+    0,
+    "Seed of the impairments, for runs that drop the same packets");
 
 namespace quic {
 namespace tperf {
 
+// A request starts with the size of the response to it.
+constexpr size_t kRequestHeaderSize = sizeof(uint64_t);
+
+/**
+ * A chain of exactly len bytes.
+ */
+Buf createBuffer(uint64_t len, uint64_t blockSize) {
+  auto buf = folly::IOBuf::create(0);
+  while (len > 0) {
+    auto next = folly::IOBuf::create(std::min(len, blockSize));
+    auto toAppend = std::min<uint64_t>(len, next->tailroom());
+    next->append(toAppend);
+    len -= toAppend;
+    buf->prependChain(std::move(next));
+  }
+  return buf;
+}
+
 class ServerStreamHandler : public quic::QuicSocket::ConnectionCallback,
                             public quic::QuicSocket::ReadCallback,
                             public quic::QuicSocket::WriteCallback {
@@ -78,18 +187,20 @@ class ServerStreamHandler : public quic::QuicSocket::ConnectionCallback,
       folly::EventBase* evbIn,
       uint64_t blockSize,
       uint32_t numStreams,
-      uint64_t maxBytesPerStream)
+      uint64_t maxBytesPerStream,
+      bool serveRequests)
       : evb_(evbIn),
         blockSize_(blockSize),
         numStreams_(numStreams),
-        maxBytesPerStream_(maxBytesPerStream) {}
+        maxBytesPerStream_(maxBytesPerStream),
+        serveRequests_(serveRequests) {}
 
   void setQuicSocket(std::shared_ptr<quic::QuicSocket> socket) {
     sock_ = socket;
   }
 
   void onNewBidirectionalStream(quic::StreamId id) noexcept override {
-    LOG(INFO) << "Got bidirectional stream id=" << id;
+    VLOG(5) << "Got bidirectional stream id=" << id;
     sock_->setReadCallback(id, this);
   }
 
@@ -115,6 +226,10 @@ class ServerStreamHandler : public quic::QuicSocket::ConnectionCallback,
   }
 
   void onTransportReady() noexcept override {
+    if (serveRequests_) {
+      VLOG(4) << "Waiting for requests from client.";
+      return;
+    }
     LOG(INFO) << "Starting sends to client.";
     for (uint32_t i = 0; i < numStreams_; i++) {
       createNewStream();
@@ -147,7 +262,37 @@ class ServerStreamHandler : public quic::QuicSocket::ConnectionCallback,
   }
 
   void readAvailable(quic::StreamId id) noexcept override {
-    LOG(INFO) << "read available for stream id=" << id;
+    if (!serveRequests_) {
+      LOG(INFO) << "read available for stream id=" << id;
+      return;
+    }
+    auto readData = sock_->read(id, 0);
+    if (readData.hasError()) {
+      LOG(ERROR) << "Failed read from stream=" << id
+                 << ", error=" << toString(readData.error());
+      return;
+    }
+    auto& request = requests_[id];
+    if (readData->first) {
+      request.append(std::move(readData->first));
+    }
+    if (!readData->second) {
+      return;
+    }
+    if (request.chainLength() < kRequestHeaderSize) {
+      LOG(ERROR) << "Request too short on stream=" << id;
+      requests_.erase(id);
+      sock_->resetStream(id, GenericApplicationErrorCode::UNKNOWN);
+      return;
+    }
+    folly::io::Cursor cursor(request.front());
+    auto responseSize = cursor.readBE<uint64_t>();
+    requests_.erase(id);
+    auto res = sock_->writeChain(
+        id, createBuffer(responseSize, blockSize_), true, false, nullptr);
+    if (res.hasError()) {
+      LOG(ERROR) << "Got error on write: " << quic::toString(res.error());
+    }
   }
 
   void readError(
@@ -210,7 +355,9 @@ class ServerStreamHandler : public quic::QuicSocket::ConnectionCallback,
   uint64_t blockSize_;
   uint32_t numStreams_;
   uint64_t maxBytesPerStream_;
+  bool serveRequests_;
   std::unordered_map<quic::StreamId, uint64_t> bytesPerStream_;
+  std::unordered_map<quic::StreamId, BufQueue> requests_;
 };
 
 class TPerfServerTransportFactory : public quic::QuicServerTransportFactory {
@@ -220,10 +367,12 @@ class TPerfServerTransportFactory : public quic::QuicServerTransportFactory {
   explicit TPerfServerTransportFactory(
       uint64_t blockSize,
       uint32_t numStreams,
-      uint64_t maxBytesPerStream)
+      uint64_t maxBytesPerStream,
+      bool serveRequests)
       : blockSize_(blockSize),
         numStreams_(numStreams),
-        maxBytesPerStream_(maxBytesPerStream) {}
+        maxBytesPerStream_(maxBytesPerStream),
+        serveRequests_(serveRequests) {}
 
   quic::QuicServerTransport::Ptr make(
       folly::EventBase* evb,
@@ -233,7 +382,7 @@ class TPerfServerTransportFactory : public quic::QuicServerTransportFactory {
           ctx) noexcept override {
     CHECK_EQ(evb, sock->getEventBase());
     auto serverHandler = std::make_unique<ServerStreamHandler>(
-        evb, blockSize_, numStreams_, maxBytesPerStream_);
+        evb, blockSize_, numStreams_, maxBytesPerStream_, serveRequests_);
     auto transport = quic::QuicServerTransport::make(
         evb, std::move(sock), *serverHandler, ctx);
     if (!FLAGS_server_qlogger_path.empty()) {
@@ -267,6 +416,7 @@ class TPerfServerTransportFactory : public quic::QuicServerTransportFactory {
   uint64_t blockSize_;
   uint32_t numStreams_;
   uint64_t maxBytesPerStream_;
+  bool serveRequests_;
 };
 
 class TPerfServer {
@@ -282,12 +432,17 @@ class TPerfServer {
       bool pacing,
       uint32_t numStreams,
       uint64_t maxBytesPerStream,
-      uint32_t maxReceivePacketSize)
+      uint32_t maxReceivePacketSize,
+      bool serveRequests,
+      std::unique_ptr<QuicUDPSocketFactory> socketFactory)
       : host_(host), port_(port), server_(QuicServer::createQuicServer()) {
     eventBase_.setName("tperf_server");
+    if (socketFactory) {
+      server_->setQuicUDPSocketFactory(std::move(socketFactory));
+    }
     server_->setQuicServerTransportFactory(
         std::make_unique<TPerfServerTransportFactory>(
-            blockSize, numStreams, maxBytesPerStream));
+            blockSize, numStreams, maxBytesPerStream, serveRequests));
     auto serverCtx = quic::test::createServerCtx();
     serverCtx->setClock(std::make_shared<fizz::SystemClock>());
     server_->setFizzContext(serverCtx);
@@ -299,6 +454,8 @@ class TPerfServer {
     if (pacing) {
       settings.pacingTimerTickInterval = 200us;
     }
+    settings.pacingUsesTxTime = FLAGS_pacing_txtime;
+    settings.usePacingScheduler = FLAGS_pacing_scheduler;
     if (gso) {
       settings.batchingMode = QuicBatchingMode::BATCHING_MODE_GSO;
       settings.maxBatchSize = 16;
@@ -324,6 +481,51 @@ class TPerfServer {
   std::shared_ptr<quic::QuicServer> server_;
 };
 
+std::shared_ptr<quic::QuicClientTransport> makeClientTransport(
+    folly::EventBase* evb,
+    QuicUDPSocketFactory& socketFactory,
+    const folly::SocketAddress& addr,
+    uint64_t window,
+    bool gso,
+    quic::CongestionControlType congestionControlType,
+    uint32_t maxReceivePacketSize) {
+  auto sock = socketFactory.make(evb, -1);
+  auto fizzClientContext =
+      FizzClientQuicHandshakeContext::Builder()
+          .setCertificateVerifier(test::createTestCertificateVerifier())
+          .build();
+  auto quicClient = std::make_shared<quic::QuicClientTransport>(
+      evb, std::move(sock), std::move(fizzClientContext));
+  quicClient->setHostname("tperf");
+  quicClient->addNewPeerAddress(addr);
+  quicClient->setCongestionControllerFactory(
+      std::make_shared<DefaultCongestionControllerFactory>());
+  auto settings = quicClient->getTransportSettings();
+  settings.advertisedInitialUniStreamWindowSize = window;
+  // Responses come on the client's bidirectional streams.
+  settings.advertisedInitialBidiLocalStreamWindowSize = window;
+  // TODO figure out what actually to do with conn flow control and not sent
+  // limit.
+  settings.advertisedInitialConnectionWindowSize =
+      std::numeric_limits<uint32_t>::max();
+  settings.connectUDP = true;
+  settings.shouldRecvBatch = true;
+  settings.defaultCongestionController = congestionControlType;
+  if (congestionControlType == quic::CongestionControlType::BBR ||
+      congestionControlType == quic::CongestionControlType::BBR2) {
+    settings.pacingEnabled = true;
+    settings.pacingTimerTickInterval = 200us;
+  }
+  if (gso) {
+    settings.batchingMode = QuicBatchingMode::BATCHING_MODE_GSO;
+    settings.maxBatchSize = 16;
+  }
+  settings.maxRecvPacketSize = maxReceivePacketSize;
+  settings.canIgnorePathMTU = true;
+  quicClient->setTransportSettings(settings);
+  return quicClient;
+}
+
 class TPerfClient : public quic::QuicSocket::ConnectionCallback,
                     public quic::QuicSocket::ReadCallback,
                     public quic::QuicSocket::WriteCallback,
@@ -337,7 +539,8 @@ class TPerfClient : public quic::QuicSocket::ConnectionCallback,
       uint64_t window,
       bool gso,
       quic::CongestionControlType congestionControlType,
-      uint32_t maxReceivePacketSize)
+      uint32_t maxReceivePacketSize,
+      std::unique_ptr<QuicUDPSocketFactory> socketFactory)
       : host_(host),
         port_(port),
         eventBase_(transportTimerResolution),
@@ -345,7 +548,8 @@ class TPerfClient : public quic::QuicSocket::ConnectionCallback,
         window_(window),
         gso_(gso),
         congestionControlType_(congestionControlType),
-        maxReceivePacketSize_(maxReceivePacketSize) {
+        maxReceivePacketSize_(maxReceivePacketSize),
+        socketFactory_(std::move(socketFactory)) {
     eventBase_.setName("tperf_client");
   }
 
@@ -460,37 +664,14 @@ class TPerfClient : public quic::QuicSocket::ConnectionCallback,
   void start() {
     folly::SocketAddress addr(host_.c_str(), port_);
 
-    auto sock = std::make_unique<folly::AsyncUDPSocket>(&eventBase_);
-    auto fizzClientContext =
-        FizzClientQuicHandshakeContext::Builder()
-            .setCertificateVerifier(test::createTestCertificateVerifier())
-            .build();
-    quicClient_ = std::make_shared<quic::QuicClientTransport>(
-        &eventBase_, std::move(sock), std::move(fizzClientContext));
-    quicClient_->setHostname("tperf");
-    quicClient_->addNewPeerAddress(addr);
-    quicClient_->setCongestionControllerFactory(
-        std::make_shared<DefaultCongestionControllerFactory>());
-    auto settings = quicClient_->getTransportSettings();
-    settings.advertisedInitialUniStreamWindowSize = window_;
-    // TODO figure out what actually to do with conn flow control and not sent
-    // limit.
-    settings.advertisedInitialConnectionWindowSize =
-        std::numeric_limits<uint32_t>::max();
-    settings.connectUDP = true;
-    settings.shouldRecvBatch = true;
-    settings.defaultCongestionController = congestionControlType_;
-    if (congestionControlType_ == quic::CongestionControlType::BBR) {
-      settings.pacingEnabled = true;
-      settings.pacingTimerTickInterval = 200us;
-    }
-    if (gso_) {
-      settings.batchingMode = QuicBatchingMode::BATCHING_MODE_GSO;
-      settings.maxBatchSize = 16;
-    }
-    settings.maxRecvPacketSize = maxReceivePacketSize_;
-    settings.canIgnorePathMTU = true;
-    quicClient_->setTransportSettings(settings);
+    quicClient_ = makeClientTransport(
+        &eventBase_,
+        *socketFactory_,
+        addr,
+        window_,
+        gso_,
+        congestionControlType_,
+        maxReceivePacketSize_);
 
     LOG(INFO) << "TPerfClient connecting to " << addr.describe();
     quicClient_->start(this);
@@ -516,6 +697,386 @@ class TPerfClient : public quic::QuicSocket::ConnectionCallback,
   bool gso_;
   quic::CongestionControlType congestionControlType_;
   uint32_t maxReceivePacketSize_;
+  std::unique_ptr<QuicUDPSocketFactory> socketFactory_;
+};
+
+/**
+ * How the sizes of requests or responses are picked: N, uniform:MIN-MAX or
+ * exp:MEAN.
+ */
+class SizeDistribution {
+ public:
+  static SizeDistribution parse(const std::string& spec) {
+    SizeDistribution dist;
+    folly::StringPiece type;
+    folly::StringPiece params;
+    if (!folly::split(':', spec, type, params)) {
+      dist.min_ = folly::to<uint64_t>(spec);
+      dist.max_ = dist.min_;
+      return dist;
+    }
+    if (type == "uniform") {
+      folly::StringPiece min;
+      folly::StringPiece max;
+      if (!folly::split('-', params, min, max)) {
+        throw std::invalid_argument(
+            folly::to<std::string>("Bad uniform size distribution ", spec));
+      }
+      dist.type_ = Type::Uniform;
+      dist.min_ = folly::to<uint64_t>(min);
+      dist.max_ = folly::to<uint64_t>(max);
+      if (dist.min_ > dist.max_) {
+        throw std::invalid_argument(
+            folly::to<std::string>("Bad uniform size distribution ", spec));
+      }
+    } else if (type == "exp") {
+      dist.type_ = Type::Exponential;
+      dist.mean_ = folly::to<double>(params);
+    } else {
+      throw std::invalid_argument(
+          folly::to<std::string>("Unknown size distribution ", spec));
+    }
+    return dist;
+  }
+
+  uint64_t sample(std::mt19937_64& rng) const {
+    switch (type_) {
+      case Type::Fixed:
+        return min_;
+      case Type::Uniform:
+        return std::uniform_int_distribution<uint64_t>(min_, max_)(rng);
+      case Type::Exponential:
+        return static_cast<uint64_t>(
+            std::exponential_distribution<double>(1 / mean_)(rng));
+    }
+    folly::assume_unreachable();
+  }
+
+ private:
+  enum class Type { Fixed, Uniform, Exponential };
+
+  Type type_{Type::Fixed};
+  uint64_t min_{0};
+  uint64_t max_{0};
+  double mean_{0};
+};
+
+struct LoadStats {
+  uint64_t bytesReceived{0};
+  uint64_t requests{0};
+  uint64_t connectionErrors{0};
+  // In microseconds.
+  std::vector<uint64_t> handshakeLatencies;
+  std::vector<uint64_t> requestLatencies;
+
+  void merge(LoadStats&& other) {
+    bytesReceived += other.bytesReceived;
+    requests += other.requests;
+    connectionErrors += other.connectionErrors;
+    handshakeLatencies.insert(
+        handshakeLatencies.end(),
+        other.handshakeLatencies.begin(),
+        other.handshakeLatencies.end());
+    requestLatencies.insert(
+        requestLatencies.end(),
+        other.requestLatencies.begin(),
+        other.requestLatencies.end());
+  }
+};
+
+struct LoadConfig {
+  folly::SocketAddress addr;
+  std::chrono::milliseconds transportTimerResolution;
+  std::chrono::seconds duration;
+  uint64_t window;
+  bool gso;
+  quic::CongestionControlType congestionControlType;
+  uint32_t maxReceivePacketSize;
+  uint64_t requestsPerConnection;
+  SizeDistribution requestSize;
+  SizeDistribution responseSize;
+  // Shared by the workers' threads.
+  std::shared_ptr<QuicUDPSocketFactory> socketFactory;
+};
+
+class TPerfLoadWorker;
+
+/**
+ * A client connection making one request after another.
+ */
+class TPerfLoadConnection : public quic::QuicSocket::ConnectionCallback,
+                            public quic::QuicSocket::ReadCallback {
+ public:
+  TPerfLoadConnection(TPerfLoadWorker& worker, const LoadConfig& config)
+      : worker_(worker), config_(config) {}
+
+  void start(folly::EventBase* evb);
+
+  void close() {
+    if (quicClient_) {
+      quicClient_->closeNow(folly::none);
+      quicClient_.reset();
+    }
+  }
+
+  void onTransportReady() noexcept override;
+
+  void readAvailable(quic::StreamId streamId) noexcept override;
+
+  void readError(
+      quic::StreamId streamId,
+      std::pair<quic::QuicErrorCode, folly::Optional<folly::StringPiece>>
+          error) noexcept override {
+    LOG(ERROR) << "TPerfLoadConnection read error on stream=" << streamId
+               << " error=" << toString(error);
+  }
+
+  void onNewBidirectionalStream(quic::StreamId /*id*/) noexcept override {}
+
+  void onNewUnidirectionalStream(quic::StreamId /*id*/) noexcept override {}
+
+  void onStopSending(
+      quic::StreamId /*id*/,
+      quic::ApplicationErrorCode /*error*/) noexcept override {}
+
+  void onConnectionEnd() noexcept override {
+    VLOG(5) << "TPerfLoadConnection connection end";
+  }
+
+  void onConnectionError(
+      std::pair<quic::QuicErrorCode, std::string> error) noexcept override;
+
+ private:
+  void sendRequest();
+
+  TPerfLoadWorker& worker_;
+  const LoadConfig& config_;
+  std::shared_ptr<quic::QuicClientTransport> quicClient_;
+  TimePoint connectStart_;
+  TimePoint requestStart_;
+  uint64_t requestsSent_{0};
+};
+
+/**
+ * Runs connections on an event loop of its own thread and collects their
+ * stats.
+ */
+class TPerfLoadWorker {
+ public:
+  TPerfLoadWorker(const LoadConfig& config, std::vector<TimePoint> startTimes)
+      : config_(config),
+        startTimes_(std::move(startTimes)),
+        eventBase_(config.transportTimerResolution),
+        rng_(folly::randomNumberSeed()) {}
+
+  /**
+   * Runs the connections until the duration of the test is over, and returns
+   * their stats.
+   */
+  LoadStats run() {
+    eventBase_.setName("tperf_load");
+    auto now = Clock::now();
+    for (auto startTime : startTimes_) {
+      auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+          startTime - now);
+      eventBase_.runAfterDelay(
+          [this] {
+            connections_.push_back(
+                std::make_unique<TPerfLoadConnection>(*this, config_));
+            connections_.back()->start(&eventBase_);
+          },
+          std::max<int64_t>(delay.count(), 0));
+    }
+    eventBase_.runAfterDelay(
+        [this] {
+          for (auto& connection : connections_) {
+            connection->close();
+          }
+          eventBase_.terminateLoopSoon();
+        },
+        std::chrono::duration_cast<std::chrono::milliseconds>(config_.duration)
+            .count());
+    eventBase_.loopForever();
+    connections_.clear();
+    return std::move(stats_);
+  }
+
+  LoadStats& stats() {
+    return stats_;
+  }
+
+  std::mt19937_64& rng() {
+    return rng_;
+  }
+
+ private:
+  const LoadConfig& config_;
+  std::vector<TimePoint> startTimes_;
+  folly::EventBase eventBase_;
+  std::mt19937_64 rng_;
+  LoadStats stats_;
+  std::vector<std::unique_ptr<TPerfLoadConnection>> connections_;
+};
+
+void TPerfLoadConnection::start(folly::EventBase* evb) {
+  quicClient_ = makeClientTransport(
+      evb,
+      *config_.socketFactory,
+      config_.addr,
+      config_.window,
+      config_.gso,
+      config_.congestionControlType,
+      config_.maxReceivePacketSize);
+  connectStart_ = Clock::now();
+  quicClient_->start(this);
+}
+
+void TPerfLoadConnection::onTransportReady() noexcept {
+  worker_.stats().handshakeLatencies.push_back(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          Clock::now() - connectStart_)
+          .count());
+  sendRequest();
+}
+
+void TPerfLoadConnection::sendRequest() {
+  if (config_.requestsPerConnection > 0 &&
+      requestsSent_ == config_.requestsPerConnection) {
+    quicClient_->close(folly::none);
+    return;
+  }
+  auto stream = quicClient_->createBidirectionalStream();
+  if (stream.hasError()) {
+    LOG(ERROR) << "TPerfLoadConnection failed to create stream, error="
+               << toString(stream.error());
+    return;
+  }
+  quicClient_->setReadCallback(*stream, this);
+  auto requestSize = std::max<uint64_t>(
+      config_.requestSize.sample(worker_.rng()), kRequestHeaderSize);
+  auto request = createBuffer(requestSize, requestSize);
+  folly::io::RWPrivateCursor cursor(request.get());
+  cursor.writeBE<uint64_t>(config_.responseSize.sample(worker_.rng()));
+  requestStart_ = Clock::now();
+  requestsSent_++;
+  auto res = quicClient_->writeChain(*stream, std::move(request), true, false);
+  if (res.hasError()) {
+    LOG(ERROR) << "TPerfLoadConnection failed write, error="
+               << toString(res.error());
+  }
+}
+
+void TPerfLoadConnection::readAvailable(quic::StreamId streamId) noexcept {
+  auto readData = quicClient_->read(streamId, 0);
+  if (readData.hasError()) {
+    LOG(ERROR) << "TPerfLoadConnection failed read from stream=" << streamId
+               << ", error=" << toString(readData.error());
+    return;
+  }
+  auto& stats = worker_.stats();
+  if (readData->first) {
+    stats.bytesReceived += readData->first->computeChainDataLength();
+  }
+  if (readData->second) {
+    stats.requests++;
+    stats.requestLatencies.push_back(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - requestStart_)
+            .count());
+    sendRequest();
+  }
+}
+
+void TPerfLoadConnection::onConnectionError(
+    std::pair<quic::QuicErrorCode, std::string> error) noexcept {
+  LOG(ERROR) << "TPerfLoadConnection error: " << toString(error.first);
+  worker_.stats().connectionErrors++;
+}
+
+/**
+ * Makes numConnections connections over numThreads threads, at
+ * connectionRate connections a second, each making requests for the
+ * duration of the test.
+ */
+class TPerfLoadClient {
+ public:
+  TPerfLoadClient(
+      LoadConfig config,
+      uint32_t numConnections,
+      uint32_t numThreads,
+      double connectionRate)
+      : config_(std::move(config)),
+        numConnections_(numConnections),
+        numThreads_(numThreads),
+        connectionRate_(connectionRate) {}
+
+  void start() {
+    LOG(INFO) << "TPerfLoadClient making " << numConnections_
+              << " connections to " << config_.addr.describe() << " over "
+              << numThreads_ << " threads";
+    auto now = Clock::now();
+    std::vector<std::vector<TimePoint>> startTimes(numThreads_);
+    for (uint32_t i = 0; i < numConnections_; ++i) {
+      auto startTime = now;
+      if (connectionRate_ > 0) {
+        startTime += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::duration<double>(i / connectionRate_));
+      }
+      startTimes[i % numThreads_].push_back(startTime);
+    }
+    std::vector<LoadStats> workerStats(numThreads_);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < numThreads_; ++i) {
+      threads.emplace_back([&, i] {
+        TPerfLoadWorker worker(config_, std::move(startTimes[i]));
+        workerStats[i] = worker.run();
+      });
+    }
+    LoadStats stats;
+    for (uint32_t i = 0; i < numThreads_; ++i) {
+      threads[i].join();
+      stats.merge(std::move(workerStats[i]));
+    }
+    report(stats);
+  }
+
+ private:
+  void report(LoadStats& stats) {
+    constexpr double bytesPerMegabit = 131072;
+    auto seconds = config_.duration.count();
+    LOG(INFO) << "Received " << stats.bytesReceived << " bytes in "
+              << stats.requests << " responses in " << seconds << " seconds.";
+    LOG(INFO) << "Overall throughput: "
+              << (stats.bytesReceived / bytesPerMegabit) / seconds << "Mb/s";
+    LOG(INFO) << "Requests per second: "
+              << static_cast<double>(stats.requests) / seconds;
+    LOG(INFO) << "Connections: " << stats.handshakeLatencies.size() << " of "
+              << numConnections_ << " ready, " << stats.connectionErrors
+              << " errors";
+    logPercentiles("Handshake latency", stats.handshakeLatencies);
+    logPercentiles("Request latency", stats.requestLatencies);
+  }
+
+  static void logPercentiles(
+      const std::string& name,
+      std::vector<uint64_t>& latencies) {
+    if (latencies.empty()) {
+      return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double pct) {
+      return latencies[std::min<size_t>(
+          latencies.size() * pct / 100, latencies.size() - 1)];
+    };
+    LOG(INFO) << name << " us: p50=" << percentile(50)
+              << " p90=" << percentile(90) << " p99=" << percentile(99)
+              << " max=" << latencies.back();
+  }
+
+  LoadConfig config_;
+  uint32_t numConnections_;
+  uint32_t numThreads_;
+  double connectionRate_;
 };
 
 } // namespace tperf
@@ -531,6 +1092,8 @@ quic::CongestionControlType flagsToCongestionControlType(
     return quic::CongestionControlType::NewReno;
   } else if (congestionControlType == "bbr") {
     return quic::CongestionControlType::BBR;
+  } else if (congestionControlType == "bbr2") {
+    return quic::CongestionControlType::BBR2;
   } else if (congestionControlType == "copa") {
     return quic::CongestionControlType::Copa;
   } else if (congestionControlType == "none") {
@@ -540,6 +1103,33 @@ quic::CongestionControlType flagsToCongestionControlType(
       "Unknown congestion controller ", congestionControlType));
 }
 
+NetworkImpairmentConfig flagsToImpairmentConfig() {
+  NetworkImpairmentConfig config;
+  config.delay = std::chrono::milliseconds(FLAGS_impair_delay_ms);
+  config.jitter = std::chrono::milliseconds(FLAGS_impair_jitter_ms);
+  config.lossRate = FLAGS_impair_loss;
+  config.geGoodToBad = FLAGS_impair_ge_good_to_bad;
+  config.geBadToGood = FLAGS_impair_ge_bad_to_good;
+  config.geLossGood = FLAGS_impair_ge_loss_good;
+  config.geLossBad = FLAGS_impair_ge_loss_bad;
+  config.reorderRate = FLAGS_impair_reorder;
+  config.reorderDelay =
+      std::chrono::milliseconds(FLAGS_impair_reorder_delay_ms);
+  config.bandwidth = FLAGS_impair_bandwidth_mbps * 1000 * 1000 / 8;
+  config.maxQueueDelay =
+      std::chrono::milliseconds(FLAGS_impair_max_queue_delay_ms);
+  config.seed = FLAGS_impair_seed;
+  return config;
+}
+
+std::unique_ptr<QuicUDPSocketFactory> makeSocketFactory(
+    const NetworkImpairmentConfig& impairment) {
+  if (impairment.enabled()) {
+    return std::make_unique<ImpairedUDPSocketFactory>(impairment);
+  }
+  return std::make_unique<QuicSharedUDPSocketFactory>();
+}
+
 int main(int argc, char* argv[]) {
 #if FOLLY_HAVE_LIBGFLAGS
   // Enable glog logging to stderr by default.
@@ -550,6 +1140,15 @@ int main(int argc, char* argv[]) {
   folly::Init init(&argc, &argv);
   fizz::CryptoUtils::init();
 
+  if (FLAGS_workload != "bulk" && FLAGS_workload != "requests") {
+    LOG(ERROR) << "Unknown workload " << FLAGS_workload;
+    return 1;
+  }
+  bool serveRequests = FLAGS_workload == "requests";
+  auto impairment = flagsToImpairmentConfig();
+  if (impairment.enabled()) {
+    LOG(INFO) << "Impairing sent packets with seed=" << impairment.seed;
+  }
   if (FLAGS_mode == "server") {
     TPerfServer server(
         FLAGS_host,
@@ -562,7 +1161,9 @@ int main(int argc, char* argv[]) {
         FLAGS_pacing,
         FLAGS_num_streams,
         FLAGS_bytes_per_stream,
-        FLAGS_max_receive_packet_size);
+        FLAGS_max_receive_packet_size,
+        serveRequests,
+        impairment.enabled() ? makeSocketFactory(impairment) : nullptr);
     server.start();
   } else if (FLAGS_mode == "client") {
     if (FLAGS_num_streams != 1) {
@@ -573,6 +1174,37 @@ int main(int argc, char* argv[]) {
       LOG(ERROR) << "bytes_per_stream option is server only";
       return 1;
     }
+    if (serveRequests) {
+      if (FLAGS_client_connections == 0 || FLAGS_client_threads == 0) {
+        LOG(ERROR) << "client_connections and client_threads must be > 0";
+        return 1;
+      }
+      LoadConfig config{
+          folly::SocketAddress(FLAGS_host, FLAGS_port),
+          std::chrono::milliseconds(
+              FLAGS_client_transport_timer_resolution_ms),
+          std::chrono::seconds(FLAGS_duration),
+          FLAGS_window,
+          FLAGS_gso,
+          flagsToCongestionControlType(FLAGS_congestion),
+          FLAGS_max_receive_packet_size,
+          FLAGS_requests_per_connection,
+          SizeDistribution::parse(FLAGS_request_size),
+          SizeDistribution::parse(FLAGS_response_size),
+          makeSocketFactory(impairment)};
+      TPerfLoadClient client(
+          std::move(config),
+          FLAGS_client_connections,
+          std::min(FLAGS_client_threads, FLAGS_client_connections),
+          FLAGS_connection_rate);
+      client.start();
+      return 0;
+    }
+    if (FLAGS_client_connections != 1 || FLAGS_client_threads != 1) {
+      LOG(ERROR) << "client_connections and client_threads options need "
+                 << "the requests workload";
+      return 1;
+    }
     TPerfClient client(
         FLAGS_host,
         FLAGS_port,
@@ -581,7 +1213,8 @@ int main(int argc, char* argv[]) {
         FLAGS_window,
         FLAGS_gso,
         flagsToCongestionControlType(FLAGS_congestion),
-        FLAGS_max_receive_packet_size);
+        FLAGS_max_receive_packet_size,
+        makeSocketFactory(impairment));
     client.start();
   }
   return 0;